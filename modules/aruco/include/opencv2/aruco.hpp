@@ -125,6 +125,12 @@ enum CornerRefineMethod{
  *   than 128 or not) (default 5.0)
  * - errorCorrectionRate error correction rate respect to the maximun error correction capability
  *   for each dictionary. (default 0.6).
+ * - decimationMinMarkerSize: expected minimum side of the markers in pixels of the input image. If it
+ *   is positive, the candidates are searched on the image downscaled so that such markers have
+ *   decimationMinSideLength pixels per side, and the corners are refined on the input image with
+ *   subpixel accuracy. Speeds up the detection on high resolution images (default 0, no downscaling).
+ * - decimationMinSideLength: side of the smallest markers in pixels of the downscaled image
+ *   (default 32).
  */
 struct CV_EXPORTS_W DetectorParameters {
 
@@ -152,6 +158,8 @@ struct CV_EXPORTS_W DetectorParameters {
     CV_PROP_RW double maxErroneousBitsInBorderRate;
     CV_PROP_RW double minOtsuStdDev;
     CV_PROP_RW double errorCorrectionRate;
+    CV_PROP_RW int decimationMinMarkerSize;
+    CV_PROP_RW int decimationMinSideLength;
 };
 
 
@@ -188,6 +196,68 @@ CV_EXPORTS_W void detectMarkers(InputArray image, const Ptr<Dictionary> &diction
 
 
 
+/**
+ * @brief Marker detection in a video stream
+ *
+ * The tracker keeps the markers detected in the previous frames and searches them only inside
+ * the regions predicted from their last positions and velocities. The whole frame is scanned
+ * at the first frame, once per fullScanInterval frames (to find new markers) and when any of the
+ * tracked markers is not found in its region.
+ * The results of a full frame scan are the same as the results of detectMarkers().
+ */
+class CV_EXPORTS_W ArucoTracker {
+
+    public:
+    ArucoTracker();
+
+    /**
+     * @brief Create a tracker
+     *
+     * @param dictionary indicates the type of markers that will be searched
+     * @param parameters marker detection parameters
+     */
+    CV_WRAP static Ptr<ArucoTracker> create(const Ptr<Dictionary> &dictionary,
+                                            const Ptr<DetectorParameters> &parameters = DetectorParameters::create());
+
+    /**
+     * @brief Detect the markers in the next frame of the stream
+     *
+     * @param image input image
+     * @param corners vector of detected marker corners, see detectMarkers()
+     * @param ids vector of identifiers of the detected markers
+     * @param cameraMatrix optional input 3x3 floating-point camera matrix
+     * @param distCoeff optional vector of distortion coefficients
+     */
+    CV_WRAP void detectMarkers(InputArray image, OutputArrayOfArrays corners, OutputArray ids,
+                               InputArray cameraMatrix = noArray(), InputArray distCoeff = noArray());
+
+    /**
+     * @brief Forget the tracked markers, so the next frame is scanned entirely
+     */
+    CV_WRAP void reset();
+
+    /// indicates the type of markers that will be searched
+    CV_PROP Ptr<Dictionary> dictionary;
+
+    /// marker detection parameters
+    CV_PROP Ptr<DetectorParameters> parameters;
+
+    /// the whole frame is scanned at least once per fullScanInterval frames (default 30)
+    CV_PROP_RW int fullScanInterval;
+
+    /// margin of the search region around the predicted marker position, relative to the
+    /// marker size (default 0.5)
+    CV_PROP_RW double regionMarginRate;
+
+    private:
+    int framesSinceFullScan;
+    std::vector< std::vector< Point2f > > trackedCorners;
+    std::vector< int > trackedIds;
+    std::vector< Point2f > trackedVelocities;
+};
+
+
+
 /**
  * @brief Pose estimation for single markers
  *
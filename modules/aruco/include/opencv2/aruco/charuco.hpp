@@ -259,6 +259,58 @@ CV_EXPORTS_W double calibrateCameraCharuco(
 
 
 
+/**
+ * @brief Detect the chessboard corners of a ChArUco board in a set of images
+ *
+ * @param images input images of the board. They must have 1 or 3 channels.
+ * @param board layout of ChArUco board.
+ * @param charucoCorners output vector of the interpolated chessboard corners per image
+ * (e.g. std::vector<std::vector<cv::Point2f>>). It is empty for the images where no corner is found.
+ * @param charucoIds output vector of the chessboard corners identifiers per image
+ * (e.g. std::vector<std::vector<int>>).
+ * @param parameters marker detection parameters, see detectMarkers.
+ * @param minMarkers number of adjacent markers that must be detected to return a charuco corner.
+ *
+ * It is equivalent to calling detectMarkers and interpolateCornersCharuco (without camera
+ * parameters) for each image, but the images are processed in parallel.
+ * The function returns the number of images where some corners are found.
+ */
+CV_EXPORTS_W int detectCharucoBoardBatch(InputArrayOfArrays images, const Ptr<CharucoBoard> &board,
+                                         OutputArrayOfArrays charucoCorners,
+                                         OutputArrayOfArrays charucoIds,
+                                         const Ptr<DetectorParameters> &parameters = DetectorParameters::create(),
+                                         int minMarkers = 2);
+
+
+
+/**
+ * @brief Calibrate a camera using a set of images of a ChArUco board
+ *
+ * @param images input images of the board, all of them must have the same size.
+ * @param board layout of ChArUco board.
+ * @param cameraMatrix Output 3x3 floating-point camera matrix, see calibrateCameraCharuco.
+ * @param distCoeffs Output vector of distortion coefficients, see calibrateCameraCharuco.
+ * @param rvecs Output vector of rotation vectors estimated for each used image.
+ * @param tvecs Output vector of translation vectors estimated for each used image.
+ * @param usedImages Output vector of indices of the images used for the calibration.
+ * @param parameters marker detection parameters, see detectMarkers.
+ * @param flags flags Different flags  for the calibration process (see #calibrateCamera for details).
+ * @param criteria Termination criteria for the iterative optimization algorithm.
+ *
+ * The corners are detected by detectCharucoBoardBatch. The images where the detected corners are
+ * not enough for the pose estimation are skipped, and the corners of the rest of the images are
+ * passed to the solver at once. The function returns the final re-projection error.
+ */
+CV_EXPORTS_W double calibrateCameraCharucoBatch(
+    InputArrayOfArrays images, const Ptr<CharucoBoard> &board,
+    InputOutputArray cameraMatrix, InputOutputArray distCoeffs,
+    OutputArrayOfArrays rvecs = noArray(), OutputArrayOfArrays tvecs = noArray(),
+    OutputArray usedImages = noArray(),
+    const Ptr<DetectorParameters> &parameters = DetectorParameters::create(), int flags = 0,
+    TermCriteria criteria = TermCriteria(TermCriteria::COUNT + TermCriteria::EPS, 30, DBL_EPSILON));
+
+
+
 /**
  * @brief Detect ChArUco Diamond markers
  *
@@ -48,6 +48,8 @@ namespace aruco {
 //! @{
 
 
+class DictionaryIndex;
+
 /**
  * @brief Dictionary/Set of markers. It contains the inner codification
  *
@@ -57,6 +59,9 @@ namespace aruco {
  * - each row contains all 4 rotations of the marker, so its length is `4*nbytes`
  *
  * `bytesList.ptr(i)[k*nbytes + j]` is then the j-th byte of i-th marker, in its k-th rotation.
+ *
+ * identify() uses a hash index of bytesList which is built at the first call. The index is rebuilt
+ * if bytesList is reallocated or resized, but not if its data is modified in place.
  */
 class CV_EXPORTS_W Dictionary {
 
@@ -127,6 +132,9 @@ class CV_EXPORTS_W Dictionary {
       * @brief Transform list of bytes to matrix of bits
       */
     static Mat getBitsFromByteList(const Mat &byteList, int markerSize);
+
+    private:
+    mutable Ptr<DictionaryIndex> index; // lookup index of bytesList used by identify()
 };
 
 
@@ -0,0 +1,64 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace perf;
+using std::tr1::make_tuple;
+using std::tr1::get;
+
+typedef std::tr1::tuple<Size, int> Size_WinSizes;
+typedef perf::TestBaseWithParam<Size_WinSizes> Size_WinSizes_Detection;
+
+// Grid of markers of the given dictionary on white background, with some gradient of the illumination
+static Mat createMarkersImage(Size size, const Ptr<aruco::Dictionary> &dictionary, int markerSize)
+{
+    Mat img(size, CV_8UC1);
+    for (int y = 0; y < size.height; y++)
+        for (int x = 0; x < size.width; x++)
+            img.at<uchar>(y, x) = saturate_cast<uchar>(255 - 80 * (x + y) / (size.width + size.height));
+
+    const int step = markerSize * 2;
+    int id = 0;
+    for (int y = markerSize / 2; y + markerSize < size.height; y += step)
+    {
+        for (int x = markerSize / 2; x + markerSize < size.width; x += step)
+        {
+            Mat marker;
+            aruco::drawMarker(dictionary, id, markerSize, marker);
+            marker.copyTo(img(Rect(x, y, markerSize, markerSize)), marker == 0);
+            id = (id + 1) % dictionary->bytesList.rows;
+        }
+    }
+    return img;
+}
+
+PERF_TEST_P(Size_WinSizes_Detection, detectMarkers,
+            testing::Combine(testing::Values(Size(640, 480), Size(1920, 1080), Size(3840, 2160)),
+                             testing::Values(3, 10)))
+{
+    const Size size = get<0>(GetParam());
+    const int winSizeStep = get<1>(GetParam());
+
+    Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(aruco::DICT_6X6_250);
+    Mat img = createMarkersImage(size, dictionary, size.width / 20);
+
+    Ptr<aruco::DetectorParameters> params = aruco::DetectorParameters::create();
+    params->adaptiveThreshWinSizeStep = winSizeStep;
+
+    vector<vector<Point2f> > corners;
+    vector<int> ids;
+
+    declare.in(img).time(60);
+
+    TEST_CYCLE()
+    {
+        aruco::detectMarkers(img, dictionary, corners, ids, params);
+    }
+
+    EXPECT_FALSE(ids.empty());
+    SANITY_CHECK_NOTHING();
+}
@@ -98,6 +98,8 @@ static bool readDetectorParameters(string filename, Ptr<aruco::DetectorParameter
     fs["maxErroneousBitsInBorderRate"] >> params->maxErroneousBitsInBorderRate;
     fs["minOtsuStdDev"] >> params->minOtsuStdDev;
     fs["errorCorrectionRate"] >> params->errorCorrectionRate;
+    fs["decimationMinMarkerSize"] >> params->decimationMinMarkerSize;
+    fs["decimationMinSideLength"] >> params->decimationMinSideLength;
     return true;
 }
 
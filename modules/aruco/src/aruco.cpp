@@ -40,6 +40,10 @@ the use of this software, even if advised of the possibility of such damage.
 #include "opencv2/aruco.hpp"
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include "opencv2/core/hal/intrin.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
 
 namespace cv {
 namespace aruco {
@@ -72,7 +76,9 @@ DetectorParameters::DetectorParameters()
       perspectiveRemoveIgnoredMarginPerCell(0.13),
       maxErroneousBitsInBorderRate(0.35),
       minOtsuStdDev(5.0),
-      errorCorrectionRate(0.6) {}
+      errorCorrectionRate(0.6),
+      decimationMinMarkerSize(0),
+      decimationMinSideLength(32) {}
 
 
 /**
@@ -110,6 +116,116 @@ static void _threshold(InputArray _in, OutputArray _out, int winSize, double con
 }
 
 
+/**
+  * ParallelLoopBody class for the thresholding of the image rows with several window sizes.
+  * The result for each window size is equal to adaptiveThreshold() with ADAPTIVE_THRESH_MEAN_C and
+  * THRESH_BINARY_INV. Called from function _thresholdAllScales()
+  */
+class ThresholdScalesParallel : public ParallelLoopBody {
+    public:
+    ThresholdScalesParallel(const Mat &_grey, const Mat &_sum, int _border,
+                            const vector< int > &_winSizes, int _delta, vector< Mat > &_thresholds)
+        : grey(_grey), sum(_sum), border(_border), winSizes(_winSizes), delta(_delta),
+          thresholds(_thresholds) {}
+
+    void operator()(const Range &range) const {
+        const int width = grey.cols;
+        for(int y = range.start; y < range.end; y++) {
+            const uchar *src = grey.ptr(y);
+            for(size_t s = 0; s < winSizes.size(); s++) {
+                const int winSize = winSizes[s], r = winSize / 2, area = winSize * winSize;
+                // the window of pixel x starts at column x + border - r of the padded image
+                const int *top = sum.ptr< int >(y + border - r) + border - r;
+                const int *bottom = sum.ptr< int >(y + border + r + 1) + border - r;
+                uchar *dst = thresholds[s].ptr(y);
+
+                // mean = round(windowSum / area), dst = src - mean > -delta ? 0 : 255, that is
+                // dst = 2 * windowSum < (2 * (src + delta) - 1) * area ? 0 : 255.
+                // The sums are computed modulo 2^32, the window sums fit to int.
+                const int bias = (2 * delta - 1) * area;
+                int x = 0;
+#if CV_SIMD128
+                v_int32x4 v2area = v_setall_s32(2 * area), vbias = v_setall_s32(bias);
+                for(; x <= width - 16; x += 16) {
+                    v_int32x4 m[4];
+                    for(int k = 0; k < 4; k++) {
+                        const int i = x + 4 * k;
+                        v_uint32x4 windowSum = v_reinterpret_as_u32(v_load(bottom + i + winSize)) -
+                                               v_reinterpret_as_u32(v_load(bottom + i)) -
+                                               v_reinterpret_as_u32(v_load(top + i + winSize)) +
+                                               v_reinterpret_as_u32(v_load(top + i));
+                        v_int32x4 lhs = v_reinterpret_as_s32(windowSum + windowSum);
+                        v_int32x4 rhs = v_reinterpret_as_s32(v_load_expand_q(src + i)) * v2area + vbias;
+                        m[k] = lhs < rhs;
+                    }
+                    v_int8x16 mask = v_pack(v_pack(m[0], m[1]), v_pack(m[2], m[3]));
+                    v_store(dst + x, ~v_reinterpret_as_u8(mask));
+                }
+#endif
+                for(; x < width; x++) {
+                    int windowSum = (int)((unsigned)bottom[x + winSize] - (unsigned)bottom[x] -
+                                          (unsigned)top[x + winSize] + (unsigned)top[x]);
+                    dst[x] = 2 * windowSum < 2 * area * src[x] + bias ? 0 : 255;
+                }
+            }
+        }
+    }
+
+    private:
+    ThresholdScalesParallel &operator=(const ThresholdScalesParallel &);
+
+    const Mat &grey;
+    const Mat &sum;
+    int border;
+    const vector< int > &winSizes;
+    int delta;
+    vector< Mat > &thresholds;
+};
+
+
+/**
+  * @brief Threshold input image using adaptive thresholding with several window sizes at once.
+  * The box filter means of all window sizes are computed from one integral image of the image
+  * with replicated borders. Returns false if the windows are too large for 32-bit arithmetic
+  */
+static bool _thresholdAllScales(const Mat &grey, const vector< int > &winSizes, double constant,
+                                vector< Mat > &thresholds) {
+
+    CV_Assert(grey.type() == CV_8UC1 && !winSizes.empty());
+    const int delta = cvFloor(constant);
+    const int maxWinSize = *max_element(winSizes.begin(), winSizes.end());
+    CV_Assert(maxWinSize >= 3 && maxWinSize % 2 == 1);
+
+    // 2 * (255 + |delta|) * area should fit to int
+    if((double)maxWinSize * maxWinSize * 2 * (255 + std::abs(delta) + 1) >= INT_MAX) return false;
+
+    const int border = maxWinSize / 2;
+    Mat padded;
+    copyMakeBorder(grey, padded, border, border, border, border, BORDER_REPLICATE);
+
+    // integral image with unsigned wrap-around, the differences of sums are exact
+    Mat sum(padded.rows + 1, padded.cols + 1, CV_32S, Scalar::all(0));
+    for(int y = 0; y < padded.rows; y++) {
+        const uchar *src = padded.ptr(y);
+        const unsigned *prev = sum.ptr< unsigned >(y);
+        unsigned *dst = sum.ptr< unsigned >(y + 1);
+        unsigned rowSum = 0;
+        for(int x = 0; x < padded.cols; x++) {
+            rowSum += src[x];
+            dst[x + 1] = prev[x + 1] + rowSum;
+        }
+    }
+
+    thresholds.resize(winSizes.size());
+    for(size_t s = 0; s < winSizes.size(); s++)
+        thresholds[s].create(grey.size(), CV_8UC1);
+
+    parallel_for_(Range(0, grey.rows),
+                  ThresholdScalesParallel(grey, sum, border, winSizes, delta, thresholds));
+    return true;
+}
+
+
 /**
   * @brief Given a tresholded image, find the contours, calculate their polygonal approximation
   * and take those that accomplish some conditions
@@ -275,9 +391,10 @@ class DetectInitialCandidatesParallel : public ParallelLoopBody {
     DetectInitialCandidatesParallel(const Mat *_grey,
                                     vector< vector< vector< Point2f > > > *_candidatesArrays,
                                     vector< vector< vector< Point > > > *_contoursArrays,
-                                    const Ptr<DetectorParameters> &_params)
+                                    const Ptr<DetectorParameters> &_params,
+                                    const vector< Mat > *_thresholds = 0)
         : grey(_grey), candidatesArrays(_candidatesArrays), contoursArrays(_contoursArrays),
-          params(_params) {}
+          params(_params), thresholds(_thresholds) {}
 
     void operator()(const Range &range) const {
         const int begin = range.start;
@@ -286,9 +403,12 @@ class DetectInitialCandidatesParallel : public ParallelLoopBody {
         for(int i = begin; i < end; i++) {
             int currScale =
                 params->adaptiveThreshWinSizeMin + i * params->adaptiveThreshWinSizeStep;
-            // threshold
+            // threshold, unless it is already done for all the scales
             Mat thresh;
-            _threshold(*grey, thresh, currScale, params->adaptiveThreshConstant);
+            if(thresholds)
+                thresh = (*thresholds)[i];
+            else
+                _threshold(*grey, thresh, currScale, params->adaptiveThreshConstant);
 
             // detect rectangles
             _findMarkerContours(thresh, (*candidatesArrays)[i], (*contoursArrays)[i],
@@ -305,6 +425,7 @@ class DetectInitialCandidatesParallel : public ParallelLoopBody {
     vector< vector< vector< Point2f > > > *candidatesArrays;
     vector< vector< vector< Point > > > *contoursArrays;
     const Ptr<DetectorParameters> &params;
+    const vector< Mat > *thresholds;
 };
 
 
@@ -339,9 +460,18 @@ static void _detectInitialCandidates(const Mat &grey, vector< vector< Point2f >
     //                        params.minCornerDistance, params.minDistanceToBorder);
     //}
 
+    // the thresholds of all the scales are computed in one pass over the image
+    vector< int > winSizes((size_t) nScales);
+    for(int i = 0; i < nScales; i++)
+        winSizes[i] = (params->adaptiveThreshWinSizeMin + i * params->adaptiveThreshWinSizeStep) | 1;
+    vector< Mat > thresholds;
+    bool thresholded = grey.type() == CV_8UC1 &&
+                       _thresholdAllScales(grey, winSizes, params->adaptiveThreshConstant, thresholds);
+
     // this is the parallel call for the previous commented loop (result is equivalent)
     parallel_for_(Range(0, nScales), DetectInitialCandidatesParallel(&grey, &candidatesArrays,
-                                                                     &contoursArrays, params));
+                                                                     &contoursArrays, params,
+                                                                     thresholded ? &thresholds : 0));
 
     // join candidates
     for(int i = 0; i < nScales; i++) {
@@ -380,6 +510,92 @@ static void _detectCandidates(InputArray _image, vector< vector< Point2f > >& ca
 }
 
 
+/**
+ * @brief Scale of the image used for candidates search, 1 if the search is done on the input image
+ */
+static double _getDecimationScale(Size imageSize, const Ptr<DetectorParameters> &_params) {
+
+    if(_params->decimationMinMarkerSize <= 0) return 1.;
+    CV_Assert(_params->decimationMinSideLength > 0);
+
+    double scale = min(1., double(_params->decimationMinSideLength) / _params->decimationMinMarkerSize);
+    // the downscaled image should be large enough to contain a marker
+    if(cvRound(scale * min(imageSize.width, imageSize.height)) < _params->decimationMinSideLength)
+        return 1.;
+    return scale;
+}
+
+
+/**
+ * @brief Detect square candidates in the downscaled image. The resulting corners and contours
+ * are in coordinates of the input image.
+ */
+static void _detectCandidatesDecimated(const Mat &grey, double scale,
+                                       vector< vector< Point2f > >& candidatesOut,
+                                       vector< vector< Point > >& contoursOut,
+                                       const Ptr<DetectorParameters> &_params) {
+
+    Mat small;
+    resize(grey, small, Size(cvRound(grey.cols * scale), cvRound(grey.rows * scale)), 0, 0,
+           INTER_AREA);
+    const double scaleX = double(grey.cols) / small.cols;
+    const double scaleY = double(grey.rows) / small.rows;
+
+    // the rates are relative to the image size, only the distance in pixels is changed
+    Ptr<DetectorParameters> smallParams = makePtr<DetectorParameters>(*_params);
+    smallParams->minDistanceToBorder = (int)ceil(_params->minDistanceToBorder * scale);
+
+    _detectCandidates(small, candidatesOut, contoursOut, smallParams);
+
+    // pixel centers are mapped to pixel centers
+    for(unsigned int i = 0; i < candidatesOut.size(); i++) {
+        for(unsigned int j = 0; j < candidatesOut[i].size(); j++) {
+            Point2f &p = candidatesOut[i][j];
+            p = Point2f(float((p.x + 0.5) * scaleX - 0.5), float((p.y + 0.5) * scaleY - 0.5));
+        }
+    }
+    for(unsigned int i = 0; i < contoursOut.size(); i++) {
+        for(unsigned int j = 0; j < contoursOut[i].size(); j++) {
+            Point &p = contoursOut[i][j];
+            p = Point(cvRound((p.x + 0.5) * scaleX - 0.5), cvRound((p.y + 0.5) * scaleY - 0.5));
+        }
+    }
+}
+
+
+/**
+  * @brief Sample the image at the nearest pixels of the perspective grid, it is equivalent to
+  * warpPerspective() with INTER_NEAREST and BORDER_CONSTANT but without its setup cost, which
+  * dominates for the small images of the markers. transformation maps the input image to the output
+  */
+static void _sampleNearestPerspective(const Mat &image, const Mat &transformation, int size,
+                                      Mat &out) {
+
+    CV_Assert(image.type() == CV_8UC1 && transformation.type() == CV_64FC1);
+
+    // inverse map, as in warpPerspective()
+    Matx33d M;
+    invert(transformation, M);
+    out.create(size, size, CV_8UC1);
+
+    for(int y = 0; y < size; y++) {
+        const double X0 = M(0, 1) * y + M(0, 2), Y0 = M(1, 1) * y + M(1, 2),
+                     W0 = M(2, 1) * y + M(2, 2);
+        uchar *dst = out.ptr(y);
+        for(int x = 0; x < size; x++) {
+            double W = W0 + M(2, 0) * x;
+            W = W ? 1. / W : 0;
+            double fX = std::max((double)INT_MIN, std::min((double)INT_MAX, (X0 + M(0, 0) * x) * W));
+            double fY = std::max((double)INT_MIN, std::min((double)INT_MAX, (Y0 + M(1, 0) * x) * W));
+            int X = saturate_cast< int >(fX), Y = saturate_cast< int >(fY);
+            dst[x] = (unsigned)X < (unsigned)image.cols && (unsigned)Y < (unsigned)image.rows
+                         ? image.at< uchar >(Y, X)
+                         : 0;
+        }
+    }
+}
+
+
 /**
   * @brief Given an input image and candidate corners, extract the bits of the candidate, including
   * the border bits
@@ -408,8 +624,7 @@ static Mat _extractBits(InputArray _image, InputArray _corners, int markerSize,
 
     // remove perspective
     Mat transformation = getPerspectiveTransform(_corners, resultImgCorners);
-    warpPerspective(_image, resultImg, transformation, Size(resultImgSize, resultImgSize),
-                    INTER_NEAREST);
+    _sampleNearestPerspective(_image.getMat(), transformation, resultImgSize, resultImg);
 
     // output image containing the bits
     Mat bits(markerSizeWithBorders, markerSizeWithBorders, CV_8UC1, Scalar::all(0));
@@ -433,16 +648,28 @@ static Mat _extractBits(InputArray _image, InputArray _corners, int markerSize,
     // now extract code, first threshold using Otsu
     threshold(resultImg, resultImg, 125, 255, THRESH_BINARY | THRESH_OTSU);
 
-    // for each cell
+    // cell of each row and column of the result image, -1 for the cell margins
+    vector< int > cellIdx(resultImgSize, -1);
+    for(int i = 0; i < resultImgSize; i++) {
+        int offset = i % cellSize;
+        if(offset >= cellMarginPixels && offset < cellSize - cellMarginPixels) cellIdx[i] = i / cellSize;
+    }
+
+    // count white pixels on each cell in a single pass over the image to assign its value
+    Mat counts(markerSizeWithBorders, markerSizeWithBorders, CV_32SC1, Scalar::all(0));
+    for(int y = 0; y < resultImgSize; y++) {
+        if(cellIdx[y] < 0) continue;
+        const uchar *src = resultImg.ptr(y);
+        int *cellCounts = counts.ptr< int >(cellIdx[y]);
+        for(int x = 0; x < resultImgSize; x++) {
+            if(cellIdx[x] >= 0 && src[x]) cellCounts[cellIdx[x]]++;
+        }
+    }
+
+    const int cellPixels = (cellSize - 2 * cellMarginPixels) * (cellSize - 2 * cellMarginPixels);
     for(int y = 0; y < markerSizeWithBorders; y++) {
         for(int x = 0; x < markerSizeWithBorders; x++) {
-            int Xstart = x * (cellSize) + cellMarginPixels;
-            int Ystart = y * (cellSize) + cellMarginPixels;
-            Mat square = resultImg(Rect(Xstart, Ystart, cellSize - 2 * cellMarginPixels,
-                                        cellSize - 2 * cellMarginPixels));
-            // count white pixels on each cell to assign its value
-            size_t nZ = (size_t) countNonZero(square);
-            if(nZ > square.total() / 2) bits.at< unsigned char >(y, x) = 1;
+            if(counts.at< int >(y, x) > cellPixels / 2) bits.at< unsigned char >(y, x) = 1;
         }
     }
 
@@ -957,21 +1184,19 @@ class MarkerContourParallel : public ParallelLoopBody {
 
 
 /**
-  */
-void detectMarkers(InputArray _image, const Ptr<Dictionary> &_dictionary, OutputArrayOfArrays _corners,
-                   OutputArray _ids, const Ptr<DetectorParameters> &_params,
-                   OutputArrayOfArrays _rejectedImgPoints, InputArrayOfArrays camMatrix, InputArrayOfArrays distCoeff) {
-
-    CV_Assert(!_image.empty());
-
-    Mat grey;
-    _convertToGrey(_image.getMat(), grey);
+ * @brief Detect, identify and filter the markers in the grey image (steps 1-3 of detectMarkers)
+ */
+static void _detectMarkers(const Mat &grey, const Ptr<Dictionary> &_dictionary,
+                           vector< vector< Point2f > > &candidates, vector< int > &ids,
+                           vector< vector< Point > > &contours, const Ptr<DetectorParameters> &_params,
+                           OutputArrayOfArrays _rejectedImgPoints = noArray()) {
 
     /// STEP 1: Detect marker candidates
-    vector< vector< Point2f > > candidates;
-    vector< vector< Point > > contours;
-    vector< int > ids;
-    _detectCandidates(grey, candidates, contours, _params);
+    const double decimationScale = _getDecimationScale(grey.size(), _params);
+    if(decimationScale < 1.)
+        _detectCandidatesDecimated(grey, decimationScale, candidates, contours, _params);
+    else
+        _detectCandidates(grey, candidates, contours, _params);
 
     /// STEP 2: Check candidate codification (identify markers)
     _identifyCandidates(grey, candidates, contours, _dictionary, candidates, ids, _params,
@@ -980,9 +1205,28 @@ void detectMarkers(InputArray _image, const Ptr<Dictionary> &_dictionary, Output
     /// STEP 3: Filter detected markers;
     _filterDetectedMarkers(candidates, ids, contours);
 
-    // copy to output arrays
-    _copyVector2Output(candidates, _corners);
-    Mat(ids).copyTo(_ids);
+    /// STEP 3b: Corners found on the downscaled image are refined on the input image. The window
+    /// covers the error of the corner position which is up to one pixel of the downscaled image
+    if(decimationScale < 1. && !candidates.empty()) {
+        CV_Assert(_params->cornerRefinementMaxIterations > 0 && _params->cornerRefinementMinAccuracy > 0);
+        Ptr<DetectorParameters> refineParams = makePtr<DetectorParameters>(*_params);
+        refineParams->cornerRefinementWinSize =
+            max(_params->cornerRefinementWinSize, (int)ceil(1. / decimationScale));
+        parallel_for_(Range(0, (int)candidates.size()),
+                      MarkerSubpixelParallel(&grey, candidates, refineParams));
+    }
+}
+
+
+/**
+ * @brief Refine the corners of the detected markers (step 4 of detectMarkers)
+ */
+static void _refineMarkerCorners(const Mat &grey, vector< vector< Point2f > > &candidates,
+                                 vector< vector< Point > > &contours,
+                                 const Ptr<DetectorParameters> &_params, const Mat &camMatrix,
+                                 const Mat &distCoeff) {
+
+    if(candidates.empty()) return;
 
     /// STEP 4: Corner refinement :: use corner subpix
     if( _params->cornerRefinementMethod == CORNER_REFINE_SUBPIX ) {
@@ -990,8 +1234,8 @@ void detectMarkers(InputArray _image, const Ptr<Dictionary> &_dictionary, Output
                   _params->cornerRefinementMinAccuracy > 0);
 
         //// do corner refinement for each of the detected markers
-        // for (unsigned int i = 0; i < _corners.cols(); i++) {
-        //    cornerSubPix(grey, _corners.getMat(i),
+        // for (unsigned int i = 0; i < candidates.size(); i++) {
+        //    cornerSubPix(grey, candidates[i],
         //                 Size(params.cornerRefinementWinSize, params.cornerRefinementWinSize),
         //                 Size(-1, -1), TermCriteria(TermCriteria::MAX_ITER | TermCriteria::EPS,
         //                                            params.cornerRefinementMaxIterations,
@@ -999,22 +1243,361 @@ void detectMarkers(InputArray _image, const Ptr<Dictionary> &_dictionary, Output
         //}
 
         // this is the parallel call for the previous commented loop (result is equivalent)
-        parallel_for_(Range(0, _corners.cols()),
-                      MarkerSubpixelParallel(&grey, _corners, _params));
+        parallel_for_(Range(0, (int)candidates.size()),
+                      MarkerSubpixelParallel(&grey, candidates, _params));
     }
 
     /// STEP 4, Optional : Corner refinement :: use contour container
     if( _params->cornerRefinementMethod == CORNER_REFINE_CONTOUR){
 
-        if(! _ids.empty()){
+        // do corner refinement using the contours for each detected markers
+        parallel_for_(Range(0, (int)candidates.size()), MarkerContourParallel(contours, candidates, camMatrix, distCoeff));
+    }
+}
+
+
+/**
+  */
+void detectMarkers(InputArray _image, const Ptr<Dictionary> &_dictionary, OutputArrayOfArrays _corners,
+                   OutputArray _ids, const Ptr<DetectorParameters> &_params,
+                   OutputArrayOfArrays _rejectedImgPoints, InputArrayOfArrays camMatrix, InputArrayOfArrays distCoeff) {
+
+    CV_Assert(!_image.empty());
+
+    Mat grey;
+    _convertToGrey(_image.getMat(), grey);
+
+    /// STEPS 1-3: Detect and identify the markers
+    vector< vector< Point2f > > candidates;
+    vector< vector< Point > > contours;
+    vector< int > ids;
+    _detectMarkers(grey, _dictionary, candidates, ids, contours, _params, _rejectedImgPoints);
 
-            // do corner refinement using the contours for each detected markers
-            parallel_for_(Range(0, _corners.cols()), MarkerContourParallel(contours, candidates, camMatrix.getMat(), distCoeff.getMat()));
+    /// STEP 4: Corner refinement
+    _refineMarkerCorners(grey, candidates, contours, _params, camMatrix.getMat(), distCoeff.getMat());
 
-            // copy the corners to the output array
-            _copyVector2Output(candidates, _corners);
+    // copy to output arrays
+    _copyVector2Output(candidates, _corners);
+    Mat(ids).copyTo(_ids);
+}
+
+
+
+/**
+  */
+ArucoTracker::ArucoTracker()
+    : fullScanInterval(30),
+      regionMarginRate(0.5),
+      framesSinceFullScan(0) {}
+
+
+/**
+  */
+Ptr<ArucoTracker> ArucoTracker::create(const Ptr<Dictionary> &_dictionary,
+                                       const Ptr<DetectorParameters> &_params) {
+    Ptr<ArucoTracker> tracker = makePtr<ArucoTracker>();
+    tracker->dictionary = _dictionary;
+    tracker->parameters = _params;
+    return tracker;
+}
+
+
+/**
+  */
+void ArucoTracker::reset() {
+    framesSinceFullScan = 0;
+    trackedCorners.clear();
+    trackedIds.clear();
+    trackedVelocities.clear();
+}
+
+
+/**
+ * @brief Search regions of the tracked markers, the overlapped regions are merged
+ */
+static vector< Rect > _getTrackedRegions(Size imageSize, const vector< vector< Point2f > > &corners,
+                                         const vector< Point2f > &velocities, double marginRate,
+                                         int minDistanceToBorder) {
+
+    vector< Rect > regions;
+    Rect imageRect(Point(0, 0), imageSize);
+    for(unsigned int i = 0; i < corners.size(); i++) {
+        Rect2f box = boundingRect(Mat(corners[i]));
+        box.x += velocities[i].x;
+        box.y += velocities[i].y;
+        // the marker must stay farther than minDistanceToBorder from the region border
+        float margin = float(max(box.width, box.height) * marginRate) + minDistanceToBorder + 1;
+        Rect region(Point(cvFloor(box.x - margin), cvFloor(box.y - margin)),
+                    Point(cvCeil(box.x + box.width + margin), cvCeil(box.y + box.height + margin)));
+        region &= imageRect;
+        if(region.area() > 0) regions.push_back(region);
+    }
+
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(unsigned int i = 0; i < regions.size() && !merged; i++) {
+            for(unsigned int j = i + 1; j < regions.size(); j++) {
+                if((regions[i] & regions[j]).area() > 0) {
+                    regions[i] |= regions[j];
+                    regions.erase(regions.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+    return regions;
+}
+
+
+/**
+ * @brief Detect the markers inside of the regions of the grey image
+ */
+static void _detectMarkersInRegions(const Mat &grey, const vector< Rect > &regions,
+                                    const Ptr<Dictionary> &_dictionary,
+                                    vector< vector< Point2f > > &candidates, vector< int > &ids,
+                                    vector< vector< Point > > &contours,
+                                    const Ptr<DetectorParameters> &_params) {
+
+    const double imageMaxSize = max(grey.cols, grey.rows);
+    for(unsigned int r = 0; r < regions.size(); r++) {
+        const Rect &region = regions[r];
+
+        // perimeter rates are relative to the image size, keep the same limits in pixels
+        Ptr<DetectorParameters> regionParams = makePtr<DetectorParameters>(*_params);
+        const double rate = imageMaxSize / max(region.width, region.height);
+        regionParams->minMarkerPerimeterRate = _params->minMarkerPerimeterRate * rate;
+        regionParams->maxMarkerPerimeterRate = _params->maxMarkerPerimeterRate * rate;
+
+        vector< vector< Point2f > > regionCandidates;
+        vector< vector< Point > > regionContours;
+        vector< int > regionIds;
+        _detectMarkers(grey(region), _dictionary, regionCandidates, regionIds, regionContours,
+                       regionParams);
+
+        const Point2f offset((float)region.x, (float)region.y);
+        for(unsigned int i = 0; i < regionCandidates.size(); i++) {
+            for(unsigned int j = 0; j < regionCandidates[i].size(); j++)
+                regionCandidates[i][j] += offset;
+            for(unsigned int j = 0; j < regionContours[i].size(); j++)
+                regionContours[i][j] += region.tl();
+            candidates.push_back(regionCandidates[i]);
+            contours.push_back(regionContours[i]);
+            ids.push_back(regionIds[i]);
+        }
+    }
+}
+
+
+/**
+  */
+void ArucoTracker::detectMarkers(InputArray _image, OutputArrayOfArrays _corners, OutputArray _ids,
+                                 InputArray camMatrix, InputArray distCoeff) {
+
+    CV_Assert(!_image.empty() && !dictionary.empty() && !parameters.empty());
+    CV_Assert(regionMarginRate >= 0);
+
+    Mat grey;
+    _convertToGrey(_image.getMat(), grey);
+
+    vector< vector< Point2f > > candidates;
+    vector< vector< Point > > contours;
+    vector< int > ids;
+
+    bool fullScan = trackedIds.empty() || framesSinceFullScan + 1 >= fullScanInterval;
+    if(!fullScan) {
+        vector< Rect > regions = _getTrackedRegions(grey.size(), trackedCorners, trackedVelocities,
+                                                    regionMarginRate, parameters->minDistanceToBorder);
+        _detectMarkersInRegions(grey, regions, dictionary, candidates, ids, contours, parameters);
+
+        // the lost markers are searched in the whole frame
+        for(unsigned int i = 0; i < trackedIds.size() && !fullScan; i++) {
+            if(find(ids.begin(), ids.end(), trackedIds[i]) == ids.end()) fullScan = true;
+        }
+    }
+
+    if(fullScan) {
+        candidates.clear();
+        contours.clear();
+        ids.clear();
+        _detectMarkers(grey, dictionary, candidates, ids, contours, parameters);
+        framesSinceFullScan = 0;
+    } else
+        framesSinceFullScan++;
+
+    _refineMarkerCorners(grey, candidates, contours, parameters, camMatrix.getMat(),
+                         distCoeff.getMat());
+
+    // velocity is the shift of the marker center since the previous frame
+    vector< Point2f > velocities(ids.size(), Point2f(0, 0));
+    for(unsigned int i = 0; i < ids.size(); i++) {
+        for(unsigned int j = 0; j < trackedIds.size(); j++) {
+            if(trackedIds[j] != ids[i]) continue;
+            Point2f shift(0, 0);
+            for(int c = 0; c < 4; c++)
+                shift += (candidates[i][c] - trackedCorners[j][c]) * 0.25f;
+            velocities[i] = shift;
+            break;
         }
     }
+    trackedCorners = candidates;
+    trackedIds = ids;
+    trackedVelocities = velocities;
+
+    _copyVector2Output(candidates, _corners);
+    Mat(ids).copyTo(_ids);
+}
+
+
+
+/**
+  * @brief Skew-symmetric matrix of a vector, v x w = _skew(v) * w
+  */
+static inline Matx33d _skew(const Vec3d &v) {
+    return Matx33d(0, -v[2], v[1],
+                   v[2], 0, -v[0],
+                   -v[1], v[0], 0);
+}
+
+
+
+/**
+  * @brief Rotation matrix of a rotation vector (Rodrigues formula)
+  */
+static Matx33d _rotationFromVector(const Vec3d &w) {
+    double theta = norm(w);
+    Matx33d K = _skew(w);
+    if(theta < 1e-12) return Matx33d::eye() + K;
+    double a = sin(theta) / theta;
+    double b = (1. - cos(theta)) / (theta * theta);
+    return Matx33d::eye() + a * K + b * (K * K);
+}
+
+
+
+/**
+  * @brief Initial pose of a square marker from its undistorted (normalized) corners.
+  * The homography from the marker plane to the image is computed in closed form and decomposed
+  * into a rotation and a translation. Returns false for degenerate corners.
+  */
+static bool _squarePoseFromHomography(const Point2d *q, double halfLength, Matx33d &R, Vec3d &t) {
+
+    // homography from the unit square (0,0),(1,0),(1,1),(0,1) to the four corners
+    double sx = q[0].x - q[1].x + q[2].x - q[3].x;
+    double sy = q[0].y - q[1].y + q[2].y - q[3].y;
+    double dx1 = q[1].x - q[2].x, dx2 = q[3].x - q[2].x;
+    double dy1 = q[1].y - q[2].y, dy2 = q[3].y - q[2].y;
+    double den = dx1 * dy2 - dx2 * dy1;
+    if(std::abs(den) < DBL_EPSILON) return false;
+    double g = (sx * dy2 - dx2 * sy) / den;
+    double h = (dx1 * sy - sx * dy1) / den;
+    Matx33d Hs(q[1].x - q[0].x + g * q[1].x, q[3].x - q[0].x + h * q[3].x, q[0].x,
+               q[1].y - q[0].y + g * q[1].y, q[3].y - q[0].y + h * q[3].y, q[0].y,
+               g, h, 1);
+
+    // marker plane (X, Y) to unit square, see _getSingleMarkerObjectPoints()
+    double s = 0.5 / halfLength;
+    Matx33d H = Hs * Matx33d(s, 0, 0.5,
+                             0, -s, 0.5,
+                             0, 0, 1);
+
+    // H = lambda * [r1 r2 t]
+    Vec3d h1(H(0, 0), H(1, 0), H(2, 0)), h2(H(0, 1), H(1, 1), H(2, 1));
+    Vec3d h3(H(0, 2), H(1, 2), H(2, 2));
+    double n1 = norm(h1), n2 = norm(h2);
+    if(n1 < DBL_EPSILON || n2 < DBL_EPSILON) return false;
+    double lambda = std::sqrt(n1 * n2);
+    // the marker is in front of the camera
+    if(h3[2] < 0) lambda = -lambda;
+    t = h3 * (1. / lambda);
+
+    // closest orthonormal pair to the first two columns, split symmetrically
+    Vec3d a = h1 * (1. / n1), b = h2 * (1. / n2);
+    Vec3d c = a + b, d = a - b;
+    double nc = norm(c), nd = norm(d);
+    if(nc < DBL_EPSILON || nd < DBL_EPSILON) return false;
+    c *= CV_SQRT2 / (2. * nc);
+    d *= CV_SQRT2 / (2. * nd);
+    Vec3d r1 = c + d, r2 = c - d;
+    if(lambda < 0) {
+        r1 = -r1;
+        r2 = -r2;
+    }
+    Vec3d r3 = r1.cross(r2);
+    R = Matx33d(r1[0], r2[0], r3[0],
+                r1[1], r2[1], r3[1],
+                r1[2], r2[2], r3[2]);
+    return true;
+}
+
+
+
+/**
+  * @brief Gauss-Newton refinement of a marker pose, minimizing the reprojection error of the four
+  * corners in normalized image coordinates
+  */
+static void _refineSquarePose(const Vec3d *objPoints, const Point2d *q, Matx33d &R, Vec3d &t) {
+
+    const int maxIterations = 10;
+    double prevErr = DBL_MAX;
+    Matx33d prevR = R;
+    Vec3d prevT = t;
+
+    for(int iter = 0; iter <= maxIterations; iter++) {
+        double JtJ[6][6] = { { 0 } }, Jte[6] = { 0 };
+        double err = 0;
+        bool valid = true;
+        for(int k = 0; k < 4; k++) {
+            Vec3d Xr = R * objPoints[k];
+            Vec3d Xc = Xr + t;
+            if(Xc[2] <= DBL_EPSILON) {
+                valid = false;
+                break;
+            }
+            double iz = 1. / Xc[2];
+            double x = Xc[0] * iz, y = Xc[1] * iz;
+            double e[2] = { x - q[k].x, y - q[k].y };
+            err += e[0] * e[0] + e[1] * e[1];
+
+            // projection derivatives w.r.t. a small rotation w (R <- exp(w) * R) and t
+            Vec3d dP[2] = { Vec3d(iz, 0, -x * iz), Vec3d(0, iz, -y * iz) };
+            for(int r = 0; r < 2; r++) {
+                Vec3d dw = Xr.cross(dP[r]);
+                double j[6] = { dw[0], dw[1], dw[2], dP[r][0], dP[r][1], dP[r][2] };
+                for(int m = 0; m < 6; m++) {
+                    Jte[m] += j[m] * e[r];
+                    for(int n = m; n < 6; n++)
+                        JtJ[m][n] += j[m] * j[n];
+                }
+            }
+        }
+
+        // keep the previous pose if the step did not improve it
+        if(!valid || err >= prevErr) {
+            R = prevR;
+            t = prevT;
+            break;
+        }
+        if(iter == maxIterations) break;
+        prevErr = err;
+        prevR = R;
+        prevT = t;
+
+        Matx66d A;
+        Vec6d b;
+        for(int m = 0; m < 6; m++) {
+            b[m] = Jte[m];
+            for(int n = m; n < 6; n++)
+                A(m, n) = A(n, m) = JtJ[m][n];
+        }
+        Vec6d delta;
+        if(!solve(A, b, delta, DECOMP_CHOLESKY)) break;
+
+        R = _rotationFromVector(Vec3d(-delta[0], -delta[1], -delta[2])) * R;
+        t -= Vec3d(delta[3], delta[4], delta[5]);
+        if(norm(delta) < 1e-12) break;
+    }
 }
 
 
@@ -1025,26 +1608,42 @@ void detectMarkers(InputArray _image, const Ptr<Dictionary> &_dictionary, Output
   */
 class SinglePoseEstimationParallel : public ParallelLoopBody {
     public:
-    SinglePoseEstimationParallel(Mat& _markerObjPoints, InputArrayOfArrays _corners,
-                                 InputArray _cameraMatrix, InputArray _distCoeffs,
-                                 Mat& _rvecs, Mat& _tvecs)
-        : markerObjPoints(_markerObjPoints), corners(_corners), cameraMatrix(_cameraMatrix),
-          distCoeffs(_distCoeffs), rvecs(_rvecs), tvecs(_tvecs) {}
+    SinglePoseEstimationParallel(const Mat& _markerObjPoints, const Mat& _normCorners,
+                                 InputArrayOfArrays _corners, InputArray _cameraMatrix,
+                                 InputArray _distCoeffs, Mat& _rvecs, Mat& _tvecs)
+        : markerObjPoints(_markerObjPoints), normCorners(_normCorners), corners(_corners),
+          cameraMatrix(_cameraMatrix), distCoeffs(_distCoeffs), rvecs(_rvecs), tvecs(_tvecs) {}
 
     void operator()(const Range &range) const {
         const int begin = range.start;
         const int end = range.end;
 
+        Vec3d objPoints[4];
+        for(int k = 0; k < 4; k++)
+            objPoints[k] = markerObjPoints.ptr< Vec3f >(0)[k];
+        double halfLength = objPoints[1][0];
+
         for(int i = begin; i < end; i++) {
-            solvePnP(markerObjPoints, corners.getMat(i), cameraMatrix, distCoeffs,
-                    rvecs.at<Vec3d>(i), tvecs.at<Vec3d>(i));
+            const Point2d *q = normCorners.ptr< Point2d >(4 * i);
+            Matx33d R;
+            Vec3d t;
+            if(!_squarePoseFromHomography(q, halfLength, R, t)) {
+                // degenerate corners, leave them to the generic solver
+                solvePnP(markerObjPoints, corners.getMat(i), cameraMatrix, distCoeffs,
+                         rvecs.at<Vec3d>(i), tvecs.at<Vec3d>(i));
+                continue;
+            }
+            _refineSquarePose(objPoints, q, R, t);
+            Rodrigues(R, rvecs.at<Vec3d>(i));
+            tvecs.at<Vec3d>(i) = t;
         }
     }
 
     private:
     SinglePoseEstimationParallel &operator=(const SinglePoseEstimationParallel &); // to quiet MSVC
 
-    Mat& markerObjPoints;
+    const Mat& markerObjPoints;
+    const Mat& normCorners;
     InputArrayOfArrays corners;
     InputArray cameraMatrix, distCoeffs;
     Mat& rvecs, tvecs;
@@ -1069,16 +1668,23 @@ void estimatePoseSingleMarkers(InputArrayOfArrays _corners, float markerLength,
 
     Mat rvecs = _rvecs.getMat(), tvecs = _tvecs.getMat();
 
-    //// for each marker, calculate its pose
-    // for (int i = 0; i < nMarkers; i++) {
-    //    solvePnP(markerObjPoints, _corners.getMat(i), _cameraMatrix, _distCoeffs,
-    //             _rvecs.getMat(i), _tvecs.getMat(i));
-    //}
+    if(nMarkers > 0) {
+        // undistort the corners of all the markers at once, to normalized image coordinates
+        Mat imgPoints(4 * nMarkers, 1, CV_64FC2), normCorners;
+        for(int i = 0; i < nMarkers; i++) {
+            Mat markerCorners = _corners.getMat(i);
+            CV_Assert(markerCorners.total() == 4 && markerCorners.channels() == 2);
+            Mat dst = imgPoints.rowRange(4 * i, 4 * i + 4);
+            markerCorners.reshape(2, 4).convertTo(dst, CV_64F);
+        }
+        undistortPoints(imgPoints, normCorners, _cameraMatrix, _distCoeffs);
 
-    // this is the parallel call for the previous commented loop (result is equivalent)
-    parallel_for_(Range(0, nMarkers),
-                  SinglePoseEstimationParallel(markerObjPoints, _corners, _cameraMatrix,
-                                               _distCoeffs, rvecs, tvecs));
+        // each marker pose is estimated in closed form from its corners and refined by a few
+        // Gauss-Newton iterations, which is much cheaper than a solvePnP call per marker
+        parallel_for_(Range(0, nMarkers),
+                      SinglePoseEstimationParallel(markerObjPoints, normCorners, _corners,
+                                                   _cameraMatrix, _distCoeffs, rvecs, tvecs));
+    }
     if(_objPoints.needed()){
         markerObjPoints.convertTo(_objPoints, -1);
     }
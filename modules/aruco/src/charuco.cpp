@@ -40,6 +40,7 @@ the use of this software, even if advised of the possibility of such damage.
 #include "opencv2/aruco/charuco.hpp"
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include <algorithm>
 
 
 namespace cv {
@@ -272,33 +273,38 @@ static int _filterCornersWithoutMinMarkers(const Ptr<CharucoBoard> &_board,
 
 
 /**
-  * ParallelLoopBody class for the parallelization of the charuco corners subpixel refinement
-  * Called from function _selectAndRefineChessboardCorners()
+  * ParallelLoopBody class for the parallelization of the charuco corners subpixel refinement.
+  * The corners are sorted by their window sizes, and each run of corners with the same window size
+  * is refined by a single cornerSubPix() call. Called from function _selectAndRefineChessboardCorners()
   */
 class CharucoSubpixelParallel : public ParallelLoopBody {
     public:
     CharucoSubpixelParallel(const Mat *_grey, vector< Point2f > *_filteredChessboardImgPoints,
-                            vector< Size > *_filteredWinSizes, const Ptr<DetectorParameters> &_params)
+                            const vector< Size > *_filteredWinSizes, const vector< int > *_order,
+                            const Ptr<DetectorParameters> &_params)
         : grey(_grey), filteredChessboardImgPoints(_filteredChessboardImgPoints),
-          filteredWinSizes(_filteredWinSizes), params(_params) {}
+          filteredWinSizes(_filteredWinSizes), order(_order), params(_params) {}
 
     void operator()(const Range &range) const {
-        const int begin = range.start;
-        const int end = range.end;
+        vector< Point2f > in;
+        for(int begin = range.start; begin < range.end;) {
+            Size winSize = (*filteredWinSizes)[(*order)[begin]];
+            int end = begin + 1;
+            while(end < range.end && (*filteredWinSizes)[(*order)[end]] == winSize)
+                end++;
 
-        for(int i = begin; i < end; i++) {
-            vector< Point2f > in;
-            in.push_back((*filteredChessboardImgPoints)[i]);
-            Size winSize = (*filteredWinSizes)[i];
-            if(winSize.height == -1 || winSize.width == -1)
-                winSize = Size(params->cornerRefinementWinSize, params->cornerRefinementWinSize);
+            in.resize(end - begin);
+            for(int i = begin; i < end; i++)
+                in[i - begin] = (*filteredChessboardImgPoints)[(*order)[i]];
 
             cornerSubPix(*grey, in, winSize, Size(),
                          TermCriteria(TermCriteria::MAX_ITER | TermCriteria::EPS,
                                       params->cornerRefinementMaxIterations,
                                       params->cornerRefinementMinAccuracy));
 
-            (*filteredChessboardImgPoints)[i] = in[0];
+            for(int i = begin; i < end; i++)
+                (*filteredChessboardImgPoints)[(*order)[i]] = in[i - begin];
+            begin = end;
         }
     }
 
@@ -307,11 +313,25 @@ class CharucoSubpixelParallel : public ParallelLoopBody {
 
     const Mat *grey;
     vector< Point2f > *filteredChessboardImgPoints;
-    vector< Size > *filteredWinSizes;
+    const vector< Size > *filteredWinSizes;
+    const vector< int > *order;
     const Ptr<DetectorParameters> &params;
 };
 
 
+/**
+  * @brief Comparison of corner indices by their refinement window sizes
+  */
+struct WinSizeLess {
+    WinSizeLess(const vector< Size > &_winSizes) : winSizes(&_winSizes) {}
+    bool operator()(int a, int b) const {
+        const Size &sa = (*winSizes)[a], &sb = (*winSizes)[b];
+        return sa.width < sb.width || (sa.width == sb.width && sa.height < sb.height);
+    }
+    const vector< Size > *winSizes;
+};
+
+
 
 
 /**
@@ -352,24 +372,22 @@ static int _selectAndRefineChessboardCorners(InputArray _allCorners, InputArray
 
     const Ptr<DetectorParameters> params = DetectorParameters::create(); // use default params for corner refinement
 
-    //// For each of the charuco corners, apply subpixel refinement using its correspondind winSize
-    // for(unsigned int i=0; i<filteredChessboardImgPoints.size(); i++) {
-    //    vector<Point2f> in;
-    //    in.push_back(filteredChessboardImgPoints[i]);
-    //    Size winSize = filteredWinSizes[i];
-    //    if(winSize.height == -1 || winSize.width == -1)
-    //        winSize = Size(params.cornerRefinementWinSize, params.cornerRefinementWinSize);
-    //    cornerSubPix(grey, in, winSize, Size(),
-    //                 TermCriteria(TermCriteria::MAX_ITER | TermCriteria::EPS,
-    //                              params->cornerRefinementMaxIterations,
-    //                              params->cornerRefinementMinAccuracy));
-    //    filteredChessboardImgPoints[i] = in[0];
-    //}
-
-    // this is the parallel call for the previous commented loop (result is equivalent)
-    parallel_for_(
-        Range(0, (int)filteredChessboardImgPoints.size()),
-        CharucoSubpixelParallel(&grey, &filteredChessboardImgPoints, &filteredWinSizes, params));
+    // default window size for the corners which are not limited by the closest markers
+    for(unsigned int i = 0; i < filteredWinSizes.size(); i++) {
+        if(filteredWinSizes[i].height == -1 || filteredWinSizes[i].width == -1)
+            filteredWinSizes[i] = Size(params->cornerRefinementWinSize, params->cornerRefinementWinSize);
+    }
+
+    // cornerSubPix() refines each corner independently, so the corners with equal window sizes
+    // are grouped and refined together (result is equivalent to the refinement one by one)
+    vector< int > order(filteredChessboardImgPoints.size());
+    for(unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), WinSizeLess(filteredWinSizes));
+
+    parallel_for_(Range(0, (int)order.size()),
+                  CharucoSubpixelParallel(&grey, &filteredChessboardImgPoints, &filteredWinSizes,
+                                          &order, params));
 
     // parse output
     Mat(filteredChessboardImgPoints).copyTo(_selectedCorners);
@@ -729,6 +747,148 @@ double calibrateCameraCharuco(InputArrayOfArrays _charucoCorners, InputArrayOfAr
 }
 
 
+
+/**
+  * ParallelLoopBody class for the parallelization of the charuco corners detection in several images
+  * Called from function _detectCharucoBoardBatch()
+  */
+class CharucoBatchDetectionParallel : public ParallelLoopBody {
+    public:
+    CharucoBatchDetectionParallel(const vector< Mat > &_images, const Ptr<CharucoBoard> &_board,
+                                  const Ptr<DetectorParameters> &_params, int _minMarkers,
+                                  vector< vector< Point2f > > &_charucoCorners,
+                                  vector< vector< int > > &_charucoIds)
+        : images(_images), board(_board), params(_params), minMarkers(_minMarkers),
+          charucoCorners(_charucoCorners), charucoIds(_charucoIds) {}
+
+    void operator()(const Range &range) const {
+        for(int i = range.start; i < range.end; i++) {
+            vector< vector< Point2f > > markerCorners;
+            vector< int > markerIds;
+            detectMarkers(images[i], board->dictionary, markerCorners, markerIds, params);
+            if(markerIds.empty()) continue;
+
+            interpolateCornersCharuco(markerCorners, markerIds, images[i], board, charucoCorners[i],
+                                      charucoIds[i], noArray(), noArray(), minMarkers);
+        }
+    }
+
+    private:
+    CharucoBatchDetectionParallel &operator=(const CharucoBatchDetectionParallel &); // to quiet MSVC
+
+    const vector< Mat > &images;
+    const Ptr<CharucoBoard> &board;
+    const Ptr<DetectorParameters> &params;
+    int minMarkers;
+    vector< vector< Point2f > > &charucoCorners;
+    vector< vector< int > > &charucoIds;
+};
+
+
+/**
+  * @brief Detect the charuco corners in all the images, in parallel over the images
+  */
+static void _detectCharucoBoardBatch(InputArrayOfArrays _images, const Ptr<CharucoBoard> &_board,
+                                     const Ptr<DetectorParameters> &_params, int minMarkers,
+                                     vector< Mat > &images,
+                                     vector< vector< Point2f > > &charucoCorners,
+                                     vector< vector< int > > &charucoIds) {
+
+    CV_Assert(!_board.empty() && !_params.empty());
+    _images.getMatVector(images);
+    for(unsigned int i = 0; i < images.size(); i++)
+        CV_Assert(!images[i].empty() && (images[i].channels() == 1 || images[i].channels() == 3));
+
+    charucoCorners.assign(images.size(), vector< Point2f >());
+    charucoIds.assign(images.size(), vector< int >());
+    parallel_for_(Range(0, (int)images.size()),
+                  CharucoBatchDetectionParallel(images, _board, _params, minMarkers, charucoCorners,
+                                                charucoIds));
+}
+
+
+/**
+  * @brief Copy a vector of vectors to an output array of arrays, one column matrix per vector
+  */
+template< typename T >
+static void _copyVectors2Output(const vector< vector< T > > &vec, OutputArrayOfArrays out, int type) {
+    out.create((int)vec.size(), 1, type);
+    for(unsigned int i = 0; i < vec.size(); i++) {
+        out.create((int)vec[i].size(), 1, type, i, true);
+        if(vec[i].empty()) continue;
+        Mat m = out.getMat(i);
+        Mat(vec[i]).copyTo(m);
+    }
+}
+
+
+
+/**
+  */
+int detectCharucoBoardBatch(InputArrayOfArrays _images, const Ptr<CharucoBoard> &_board,
+                            OutputArrayOfArrays _charucoCorners, OutputArrayOfArrays _charucoIds,
+                            const Ptr<DetectorParameters> &_params, int minMarkers) {
+
+    vector< Mat > images;
+    vector< vector< Point2f > > charucoCorners;
+    vector< vector< int > > charucoIds;
+    _detectCharucoBoardBatch(_images, _board, _params, minMarkers, images, charucoCorners,
+                             charucoIds);
+
+    int nDetected = 0;
+    for(unsigned int i = 0; i < charucoIds.size(); i++)
+        if(!charucoIds[i].empty()) nDetected++;
+
+    _copyVectors2Output(charucoCorners, _charucoCorners, CV_32FC2);
+    _copyVectors2Output(charucoIds, _charucoIds, CV_32SC1);
+    return nDetected;
+}
+
+
+
+/**
+  */
+double calibrateCameraCharucoBatch(InputArrayOfArrays _images, const Ptr<CharucoBoard> &_board,
+                                   InputOutputArray _cameraMatrix, InputOutputArray _distCoeffs,
+                                   OutputArrayOfArrays _rvecs, OutputArrayOfArrays _tvecs,
+                                   OutputArray _usedImages, const Ptr<DetectorParameters> &_params,
+                                   int flags, TermCriteria criteria) {
+
+    vector< Mat > images;
+    vector< vector< Point2f > > charucoCorners;
+    vector< vector< int > > charucoIds;
+    _detectCharucoBoardBatch(_images, _board, _params, 2, images, charucoCorners, charucoIds);
+    CV_Assert(!images.empty());
+
+    // accumulate the correspondences of the images with enough corners
+    Size imageSize = images[0].size();
+    vector< vector< Point3f > > allObjPoints;
+    vector< vector< Point2f > > allImgPoints;
+    vector< int > usedImages;
+    for(unsigned int i = 0; i < images.size(); i++) {
+        CV_Assert(images[i].size() == imageSize);
+
+        vector< Point3f > objPoints;
+        objPoints.reserve(charucoIds[i].size());
+        for(unsigned int j = 0; j < charucoIds[i].size(); j++)
+            objPoints.push_back(_board->chessboardCorners[charucoIds[i][j]]);
+        if(!_arePointsEnoughForPoseEstimation(objPoints)) continue;
+
+        allObjPoints.push_back(objPoints);
+        allImgPoints.push_back(charucoCorners[i]);
+        usedImages.push_back(i);
+    }
+
+    if(usedImages.empty())
+        CV_Error(Error::StsBadArg, "Charuco board is not detected in any of the images");
+
+    if(_usedImages.needed()) Mat(usedImages).copyTo(_usedImages);
+
+    return calibrateCamera(allObjPoints, allImgPoints, imageSize, _cameraMatrix, _distCoeffs,
+                           _rvecs, _tvecs, flags, criteria);
+}
+
+
 /**
  */
 void detectCharucoDiamond(InputArray _image, InputArrayOfArrays _markerCorners,
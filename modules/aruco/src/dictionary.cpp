@@ -40,8 +40,10 @@ the use of this software, even if advised of the possibility of such damage.
 #include "opencv2/aruco/dictionary.hpp"
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include <opencv2/core/utility.hpp>
 #include "predefined_dictionaries.hpp"
 #include "opencv2/core/hal/hal.hpp"
+#include <algorithm>
 
 namespace cv {
 namespace aruco {
@@ -90,6 +92,135 @@ Ptr<Dictionary> Dictionary::get(int dict) {
 }
 
 
+/**
+ * @brief Number of set bits of a 64-bit word
+ */
+static inline int _popcount64(uint64 x) {
+#if defined __GNUC__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & CV_BIG_UINT(0x5555555555555555));
+    x = (x & CV_BIG_UINT(0x3333333333333333)) + ((x >> 2) & CV_BIG_UINT(0x3333333333333333));
+    x = (x + (x >> 4)) & CV_BIG_UINT(0x0f0f0f0f0f0f0f0f);
+    return (int)((x * CV_BIG_UINT(0x0101010101010101)) >> 56);
+#endif
+}
+
+
+/**
+ * @brief Lookup index of the marker codes with limited Hamming distance.
+ * Codes in all 4 rotations are packed to 64-bit words. The codes are split to maxDistance + 1
+ * disjoint chunks of bits and each chunk has a sorted table (multi-index hashing): a code at
+ * distance up to maxDistance matches exactly at least one of its chunks. If the chunks are too
+ * short to be selective, all the codes are scanned with popcount.
+ */
+class DictionaryIndex {
+    public:
+    DictionaryIndex(const Mat &_bytesList, int _markerSize, int _maxDistance)
+        : data(_bytesList.data), rows(_bytesList.rows), cols(_bytesList.cols),
+          markerSize(_markerSize), maxDistance(_maxDistance) {
+
+        nbytes = (markerSize * markerSize + 7) / 8;
+        CV_Assert(nbytes <= 8 && _bytesList.type() == CV_8UC4 && cols == nbytes);
+
+        codes.resize((size_t)rows * 4);
+        for(int m = 0; m < rows; m++)
+            for(int r = 0; r < 4; r++)
+                codes[m * 4 + r] = packCode(_bytesList.ptr(m) + r * nbytes, nbytes);
+
+        // shorter chunks select too many codes
+        const int minChunkBits = 6;
+        const int nbits = nbytes * 8;
+        if(maxDistance < 0 || nbits / (maxDistance + 1) < minChunkBits) return;
+
+        const int nchunks = maxDistance + 1;
+        tables.resize(nchunks);
+        for(int c = 0; c < nchunks; c++) {
+            int begin = c * nbits / nchunks, end = (c + 1) * nbits / nchunks;
+            chunkShifts.push_back(begin);
+            chunkMasks.push_back(end - begin == 64 ? ~(uint64)0 : (((uint64)1 << (end - begin)) - 1));
+
+            vector< pair< uint64, int > > &table = tables[c];
+            table.resize(codes.size());
+            for(size_t i = 0; i < codes.size(); i++)
+                table[i] = make_pair((codes[i] >> chunkShifts[c]) & chunkMasks[c], (int)i);
+            sort(table.begin(), table.end());
+        }
+    }
+
+    bool isValidFor(const Mat &_bytesList, int _markerSize, int _maxDistance) const {
+        return data == _bytesList.data && rows == _bytesList.rows && cols == _bytesList.cols &&
+               markerSize == _markerSize && maxDistance == _maxDistance;
+    }
+
+    static uint64 packCode(const uchar *bytes, int n) {
+        uint64 code = 0;
+        for(int i = 0; i < n; i++)
+            code = (code << 8) | bytes[i];
+        return code;
+    }
+
+    /**
+     * @brief Returns the first marker with any rotation at distance up to maxDistance from the code,
+     * and the rotation of this marker with the minimum distance. Returns -1 if there is no such marker
+     */
+    int find(uint64 code, int &rotation) const {
+        int marker = -1;
+        if(maxDistance < 0) return marker;
+
+        if(tables.empty()) {
+            // codes are ordered by marker, so the first match is the result
+            for(size_t i = 0; i < codes.size(); i++) {
+                if(_popcount64(codes[i] ^ code) <= maxDistance) {
+                    marker = (int)(i / 4);
+                    break;
+                }
+            }
+        } else {
+            for(size_t c = 0; c < tables.size(); c++) {
+                const vector< pair< uint64, int > > &table = tables[c];
+                uint64 key = (code >> chunkShifts[c]) & chunkMasks[c];
+                vector< pair< uint64, int > >::const_iterator it =
+                    lower_bound(table.begin(), table.end(), make_pair(key, -1));
+                // codes with the same chunk are ordered by marker too
+                for(; it != table.end() && it->first == key; ++it) {
+                    int m = it->second / 4;
+                    if(marker >= 0 && m >= marker) break;
+                    if(_popcount64(codes[it->second] ^ code) <= maxDistance) {
+                        marker = m;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if(marker >= 0) {
+            int minDistance = markerSize * markerSize + 1;
+            for(int r = 0; r < 4; r++) {
+                int distance = _popcount64(codes[marker * 4 + r] ^ code);
+                if(distance < minDistance) {
+                    minDistance = distance;
+                    rotation = r;
+                }
+            }
+        }
+        return marker;
+    }
+
+    private:
+    const uchar *data;
+    int rows, cols, markerSize, maxDistance, nbytes;
+    vector< uint64 > codes;
+    vector< int > chunkShifts;
+    vector< uint64 > chunkMasks;
+    vector< vector< pair< uint64, int > > > tables;
+};
+
+
+// protects Dictionary::index which may be requested from several threads
+static Mutex dictionaryIndexMutex;
+
+
 /**
  */
 bool Dictionary::identify(const Mat &onlyBits, int &idx, int &rotation,
@@ -104,6 +235,19 @@ bool Dictionary::identify(const Mat &onlyBits, int &idx, int &rotation,
 
     idx = -1; // by default, not found
 
+    if(candidateBytes.cols <= 8 && bytesList.type() == CV_8UC4 && bytesList.cols == candidateBytes.cols) {
+        Ptr<DictionaryIndex> currentIndex;
+        {
+            AutoLock lock(dictionaryIndexMutex);
+            if(index.empty() || !index->isValidFor(bytesList, markerSize, maxCorrectionRecalculed))
+                index = makePtr<DictionaryIndex>(bytesList, markerSize, maxCorrectionRecalculed);
+            currentIndex = index;
+        }
+        idx = currentIndex->find(DictionaryIndex::packCode(candidateBytes.ptr(), candidateBytes.cols),
+                                 rotation);
+        return idx != -1;
+    }
+
     // search closest marker in dict
     for(int m = 0; m < bytesList.rows; m++) {
         int currentMinDistance = markerSize * markerSize + 1;
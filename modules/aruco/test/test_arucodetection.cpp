@@ -40,6 +40,9 @@ the use of this software, even if advised of the possibility of such damage.
 #include "test_precomp.hpp"
 #include <opencv2/aruco.hpp>
 #include <string>
+#include <algorithm>
+#include <climits>
+#include "opencv2/core/hal/hal.hpp"
 
 using namespace std;
 using namespace cv;
@@ -378,6 +381,236 @@ void CV_ArucoDetectionMarkerSize::run(int) {
 }
 
 
+/**
+ * @brief Check marker detection on the downscaled image with the corners refined on the input image
+ */
+class CV_ArucoDetectionDecimated : public cvtest::BaseTest {
+    public:
+    CV_ArucoDetectionDecimated();
+
+    protected:
+    void run(int);
+};
+
+
+CV_ArucoDetectionDecimated::CV_ArucoDetectionDecimated() {}
+
+
+void CV_ArucoDetectionDecimated::run(int) {
+
+    Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(aruco::DICT_6X6_250);
+    const int markerSide = 240;
+    const int nMarkersX = 4, nMarkersY = 3;
+
+    // create synthetic high resolution image
+    Mat img(nMarkersY * 2 * markerSide, nMarkersX * 2 * markerSide, CV_8UC1, Scalar::all(255));
+    vector< vector< Point2f > > groundTruthCorners;
+    vector< int > groundTruthIds;
+    for(int y = 0; y < nMarkersY; y++) {
+        for(int x = 0; x < nMarkersX; x++) {
+            Mat marker;
+            int id = 10 + (y * nMarkersX + x) * 7;
+            aruco::drawMarker(dictionary, id, markerSide, marker);
+            Point firstCorner(markerSide / 2 + 2 * markerSide * x + 3 * y,
+                              markerSide / 2 + 2 * markerSide * y + 5 * x);
+            Mat aux = img.colRange(firstCorner.x, firstCorner.x + markerSide)
+                          .rowRange(firstCorner.y, firstCorner.y + markerSide);
+            marker.copyTo(aux);
+
+            vector< Point2f > corners(4);
+            corners[0] = Point2f(firstCorner) - Point2f(0.5f, 0.5f);
+            corners[1] = corners[0] + Point2f((float)markerSide, 0);
+            corners[2] = corners[0] + Point2f((float)markerSide, (float)markerSide);
+            corners[3] = corners[0] + Point2f(0, (float)markerSide);
+            groundTruthCorners.push_back(corners);
+            groundTruthIds.push_back(id);
+        }
+    }
+
+    Ptr<aruco::DetectorParameters> params = aruco::DetectorParameters::create();
+    params->decimationMinMarkerSize = markerSide / 2;
+
+    vector< vector< Point2f > > corners;
+    vector< int > ids;
+    aruco::detectMarkers(img, dictionary, corners, ids, params);
+
+    if(ids.size() != groundTruthIds.size()) {
+        ts->printf(cvtest::TS::LOG, "Incorrect number of detected markers");
+        ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+        return;
+    }
+    for(unsigned int i = 0; i < groundTruthIds.size(); i++) {
+        int idx = -1;
+        for(unsigned int j = 0; j < ids.size(); j++) {
+            if(groundTruthIds[i] == ids[j]) {
+                idx = (int)j;
+                break;
+            }
+        }
+        if(idx == -1) {
+            ts->printf(cvtest::TS::LOG, "Marker not detected");
+            ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+            return;
+        }
+        // corners are refined to subpixel accuracy on the full resolution image
+        for(int c = 0; c < 4; c++) {
+            double dist = norm(groundTruthCorners[i][c] - corners[idx][c]);
+            if(dist > 1.) {
+                ts->printf(cvtest::TS::LOG, "Incorrect marker corners position");
+                ts->set_failed_test_info(cvtest::TS::FAIL_BAD_ACCURACY);
+                return;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Check tracking of the markers in the predicted regions of a video stream
+ */
+class CV_ArucoTracking : public cvtest::BaseTest {
+    public:
+    CV_ArucoTracking();
+
+    protected:
+    void run(int);
+};
+
+
+CV_ArucoTracking::CV_ArucoTracking() {}
+
+
+void CV_ArucoTracking::run(int) {
+
+    Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(aruco::DICT_6X6_250);
+    Ptr<aruco::DetectorParameters> params = aruco::DetectorParameters::create();
+    Ptr<aruco::ArucoTracker> tracker = aruco::ArucoTracker::create(dictionary, params);
+    tracker->fullScanInterval = 4;
+
+    const int markerSide = 80;
+    const int nFrames = 12;
+    const int idA = 3, idB = 17, idC = 42;
+    const int appearanceFrame = 6, firstFullScanAfterAppearance = 8;
+
+    for(int f = 0; f < nFrames; f++) {
+        // two moving markers and a static one which appears later
+        Mat img(480, 640, CV_8UC1, Scalar::all(255));
+        int ids_[] = { idA, idB, idC };
+        Point positions[] = { Point(50 + 4 * f, 60 + 3 * f), Point(400 - 3 * f, 100 + 2 * f),
+                              Point(250, 320) };
+        for(int m = 0; m < 3; m++) {
+            if(ids_[m] == idC && f < appearanceFrame) continue;
+            Mat marker;
+            aruco::drawMarker(dictionary, ids_[m], markerSide, marker);
+            marker.copyTo(img(Rect(positions[m], Size(markerSide, markerSide))));
+        }
+
+        vector< vector< Point2f > > corners, refCorners;
+        vector< int > ids, refIds;
+        tracker->detectMarkers(img, corners, ids);
+        aruco::detectMarkers(img, dictionary, refCorners, refIds, params);
+
+        for(unsigned int i = 0; i < ids.size(); i++) {
+            vector< int >::iterator it = find(refIds.begin(), refIds.end(), ids[i]);
+            if(it == refIds.end()) {
+                ts->printf(cvtest::TS::LOG, "Incorrect marker id");
+                ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+                return;
+            }
+            for(int c = 0; c < 4; c++) {
+                double dist = norm(corners[i][c] - refCorners[it - refIds.begin()][c]);
+                if(dist > 0.5) {
+                    ts->printf(cvtest::TS::LOG, "Incorrect marker corners position");
+                    ts->set_failed_test_info(cvtest::TS::FAIL_BAD_ACCURACY);
+                    return;
+                }
+            }
+        }
+
+        bool foundA = find(ids.begin(), ids.end(), idA) != ids.end();
+        bool foundB = find(ids.begin(), ids.end(), idB) != ids.end();
+        bool foundC = find(ids.begin(), ids.end(), idC) != ids.end();
+        if(!foundA || !foundB || (f >= firstFullScanAfterAppearance && !foundC)) {
+            ts->printf(cvtest::TS::LOG, "Marker not detected in frame %d", f);
+            ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Check the indexed dictionary lookup against the exhaustive search
+ */
+class CV_ArucoDictionaryIdentify : public cvtest::BaseTest {
+    public:
+    CV_ArucoDictionaryIdentify();
+
+    protected:
+    void run(int);
+};
+
+
+CV_ArucoDictionaryIdentify::CV_ArucoDictionaryIdentify() {}
+
+
+void CV_ArucoDictionaryIdentify::run(int) {
+
+    RNG rng(1234);
+    int dictionaries[] = { aruco::DICT_4X4_1000, aruco::DICT_5X5_250, aruco::DICT_6X6_1000,
+                           aruco::DICT_7X7_50, aruco::DICT_ARUCO_ORIGINAL };
+    double rates[] = { 0., 0.5, 1. };
+
+    for(int d = 0; d < 5; d++) {
+        Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(dictionaries[d]);
+        for(int r = 0; r < 3; r++) {
+            int maxDistance = int(double(dictionary->maxCorrectionBits) * rates[r]);
+            for(int i = 0; i < 200; i++) {
+                // rotated marker with some flipped bits
+                int id = rng.uniform(0, dictionary->bytesList.rows);
+                Mat bits = aruco::Dictionary::getBitsFromByteList(
+                    dictionary->bytesList.rowRange(id, id + 1), dictionary->markerSize);
+                for(int k = rng.uniform(0, 4); k > 0; k--) {
+                    transpose(bits, bits);
+                    flip(bits, bits, 1);
+                }
+                for(int k = rng.uniform(0, maxDistance + 3); k > 0; k--) {
+                    uchar &b = bits.at< uchar >(rng.uniform(0, bits.rows), rng.uniform(0, bits.cols));
+                    b = 1 - b;
+                }
+
+                int expectedId = -1, expectedRotation = -1;
+                for(int m = 0; m < dictionary->bytesList.rows && expectedId < 0; m++) {
+                    if(dictionary->getDistanceToId(bits, m) <= maxDistance) expectedId = m;
+                }
+                if(expectedId >= 0) {
+                    Mat allBytes = aruco::Dictionary::getByteListFromBits(bits);
+                    int minDistance = INT_MAX;
+                    for(int rot = 0; rot < 4; rot++) {
+                        int distance = cv::hal::normHamming(
+                            dictionary->bytesList.ptr(expectedId) + rot * allBytes.cols,
+                            allBytes.ptr(), allBytes.cols);
+                        if(distance < minDistance) {
+                            minDistance = distance;
+                            expectedRotation = rot;
+                        }
+                    }
+                }
+
+                int idx = -1, rotation = -1;
+                bool found = dictionary->identify(bits, idx, rotation, rates[r]);
+                if(found != (expectedId >= 0) || idx != expectedId ||
+                   (found && rotation != expectedRotation)) {
+                    ts->printf(cvtest::TS::LOG, "Dictionary::identify differs from exhaustive search");
+                    ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+
 /**
  * @brief Check error correction in marker bits
  */
@@ -503,7 +736,66 @@ TEST(CV_ArucoDetectionMarkerSize, algorithmic) {
     test.safe_run();
 }
 
+TEST(CV_ArucoDetectionDecimated, algorithmic) {
+    CV_ArucoDetectionDecimated test;
+    test.safe_run();
+}
+
+TEST(CV_ArucoTracking, algorithmic) {
+    CV_ArucoTracking test;
+    test.safe_run();
+}
+
+TEST(CV_ArucoDictionaryIdentify, algorithmic) {
+    CV_ArucoDictionaryIdentify test;
+    test.safe_run();
+}
+
 TEST(CV_ArucoBitCorrection, algorithmic) {
     CV_ArucoBitCorrection test;
     test.safe_run();
 }
+
+TEST(CV_ArucoSinglePoseEstimation, accuracy) {
+    Mat cameraMatrix = (Mat_<double>(3, 3) << 650, 0, 320, 0, 640, 240, 0, 0, 1);
+    Mat distCoeffs = (Mat_<double>(1, 5) << -0.2, 0.1, 0.001, -0.002, 0);
+    const float markerLength = 0.05f;
+    vector< Point3f > objPoints;
+    objPoints.push_back(Point3f(-markerLength / 2.f, markerLength / 2.f, 0));
+    objPoints.push_back(Point3f(markerLength / 2.f, markerLength / 2.f, 0));
+    objPoints.push_back(Point3f(markerLength / 2.f, -markerLength / 2.f, 0));
+    objPoints.push_back(Point3f(-markerLength / 2.f, -markerLength / 2.f, 0));
+
+    // project markers with known poses, some of them seen at steep angles
+    RNG rng(0x5157);
+    const int nMarkers = 50;
+    vector< Vec3d > gtRvecs, gtTvecs;
+    vector< vector< Point2f > > corners;
+    for(int i = 0; i < nMarkers; i++) {
+        Vec3d rvec(rng.uniform(-1., 1.), rng.uniform(-1., 1.), rng.uniform(-CV_PI, CV_PI));
+        Vec3d tvec(rng.uniform(-0.1, 0.1), rng.uniform(-0.1, 0.1), rng.uniform(0.3, 1.));
+        vector< Point2f > markerCorners;
+        projectPoints(objPoints, rvec, tvec, cameraMatrix, distCoeffs, markerCorners);
+        gtRvecs.push_back(rvec);
+        gtTvecs.push_back(tvec);
+        corners.push_back(markerCorners);
+    }
+
+    vector< Vec3d > rvecs, tvecs;
+    aruco::estimatePoseSingleMarkers(corners, markerLength, cameraMatrix, distCoeffs, rvecs, tvecs);
+    ASSERT_EQ(nMarkers, (int)rvecs.size());
+    ASSERT_EQ(nMarkers, (int)tvecs.size());
+
+    for(int i = 0; i < nMarkers; i++) {
+        Matx33d R, gtR;
+        Rodrigues(rvecs[i], R);
+        Rodrigues(gtRvecs[i], gtR);
+        EXPECT_LE(norm(R - gtR), 1e-3) << "marker " << i;
+        EXPECT_LE(norm(tvecs[i] - gtTvecs[i]), 1e-4) << "marker " << i;
+
+        vector< Point2f > projected;
+        projectPoints(objPoints, rvecs[i], tvecs[i], cameraMatrix, distCoeffs, projected);
+        for(int c = 0; c < 4; c++)
+            EXPECT_LE(norm(projected[c] - corners[i][c]), 0.01) << "marker " << i;
+    }
+}
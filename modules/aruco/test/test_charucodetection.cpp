@@ -547,6 +547,109 @@ void CV_CharucoDiamondDetection::run(int) {
 
 
 
+/**
+ * @brief Check Charuco detection and calibration over a batch of images
+ */
+class CV_CharucoBatchCalibration : public cvtest::BaseTest {
+    public:
+    CV_CharucoBatchCalibration();
+
+    protected:
+    void run(int);
+};
+
+
+CV_CharucoBatchCalibration::CV_CharucoBatchCalibration() {}
+
+
+void CV_CharucoBatchCalibration::run(int) {
+
+    Mat cameraMatrix = Mat::eye(3, 3, CV_64FC1);
+    Size imgSize(500, 500);
+    Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(aruco::DICT_6X6_250);
+    Ptr<aruco::CharucoBoard> board = aruco::CharucoBoard::create(4, 4, 0.03f, 0.015f, dictionary);
+
+    cameraMatrix.at< double >(0, 0) = cameraMatrix.at< double >(1, 1) = 650;
+    cameraMatrix.at< double >(0, 2) = imgSize.width / 2;
+    cameraMatrix.at< double >(1, 2) = imgSize.height / 2;
+
+    // synthetic images from different perspectives, the last one without the board
+    vector< Mat > images;
+    for(int yaw = 0; yaw < 360; yaw += 60) {
+        for(int pitch = 40; pitch <= 70; pitch += 30) {
+            Mat rvec, tvec;
+            images.push_back(projectCharucoBoard(board, cameraMatrix, deg2rad(pitch), deg2rad(yaw),
+                                                 0.3, imgSize, 1, rvec, tvec));
+        }
+    }
+    images.push_back(Mat(imgSize, CV_8UC1, Scalar::all(255)));
+
+    Ptr<aruco::DetectorParameters> params = aruco::DetectorParameters::create();
+    params->minDistanceToBorder = 3;
+
+    // batch detection should be equal to the detection image by image
+    vector< vector< Point2f > > batchCorners;
+    vector< vector< int > > batchIds;
+    int nDetected = aruco::detectCharucoBoardBatch(images, board, batchCorners, batchIds, params);
+    if(batchCorners.size() != images.size() || batchIds.size() != images.size() ||
+       nDetected != (int)images.size() - 1) {
+        ts->printf(cvtest::TS::LOG, "Batch detection returned wrong number of images");
+        ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+        return;
+    }
+
+    for(unsigned int i = 0; i < images.size(); i++) {
+        vector< vector< Point2f > > markerCorners;
+        vector< int > markerIds;
+        vector< Point2f > charucoCorners;
+        vector< int > charucoIds;
+        aruco::detectMarkers(images[i], dictionary, markerCorners, markerIds, params);
+        if(!markerIds.empty())
+            aruco::interpolateCornersCharuco(markerCorners, markerIds, images[i], board,
+                                             charucoCorners, charucoIds);
+
+        if(charucoIds != batchIds[i] || charucoCorners.size() != batchCorners[i].size()) {
+            ts->printf(cvtest::TS::LOG, "Batch detection differs from single image detection");
+            ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+            return;
+        }
+        for(unsigned int j = 0; j < charucoCorners.size(); j++) {
+            if(norm(charucoCorners[j] - batchCorners[i][j]) > 1e-4) {
+                ts->printf(cvtest::TS::LOG, "Batch detection differs from single image detection");
+                ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+                return;
+            }
+        }
+    }
+
+    // calibration
+    Mat estimatedCameraMatrix, distCoeffs;
+    vector< Mat > rvecs, tvecs;
+    vector< int > usedImages;
+    int flags = CALIB_ZERO_TANGENT_DIST | CALIB_FIX_K1 | CALIB_FIX_K2 | CALIB_FIX_K3;
+    double repError = aruco::calibrateCameraCharucoBatch(images, board, estimatedCameraMatrix,
+                                                         distCoeffs, rvecs, tvecs, usedImages,
+                                                         params, flags);
+
+    if(usedImages.empty() || usedImages.size() > images.size() - 1 ||
+       rvecs.size() != usedImages.size() || usedImages.back() == (int)images.size() - 1) {
+        ts->printf(cvtest::TS::LOG, "Wrong images used for calibration");
+        ts->set_failed_test_info(cvtest::TS::FAIL_MISMATCH);
+        return;
+    }
+
+    if(repError > 1. ||
+       std::abs(estimatedCameraMatrix.at< double >(0, 0) - cameraMatrix.at< double >(0, 0)) > 20. ||
+       std::abs(estimatedCameraMatrix.at< double >(1, 1) - cameraMatrix.at< double >(1, 1)) > 20.) {
+        ts->printf(cvtest::TS::LOG, "Calibration error too high");
+        ts->set_failed_test_info(cvtest::TS::FAIL_BAD_ACCURACY);
+        return;
+    }
+}
+
+
+
+
 TEST(CV_CharucoDetection, accuracy) {
     CV_CharucoDetection test;
     test.safe_run();
@@ -562,3 +665,8 @@ TEST(CV_CharucoDiamondDetection, accuracy) {
     CV_CharucoDiamondDetection test;
     test.safe_run();
 }
+
+TEST(CV_CharucoBatchCalibration, accuracy) {
+    CV_CharucoBatchCalibration test;
+    test.safe_run();
+}
@@ -240,6 +240,66 @@ createBackgroundSubtractorCNT(int minPixelStability = 15,
                               int maxPixelStability = 15*60,
                               bool isParallel = true);
 
+/** @brief Background subtraction based on counting for a batch of video streams.
+
+Runs the algorithm of BackgroundSubtractorCNT on several streams of same-sized frames at once, the
+models of all the streams are stacked in one buffer. It gives the same masks as one BackgroundSubtractorCNT
+per stream, with a much smaller overhead per frame when the streams are many and the frames small.
+ */
+class CV_EXPORTS_W BackgroundSubtractorCNTBatch : public Algorithm
+{
+public:
+    /** @brief Updates the models with the next frame of every stream and computes the foreground masks.
+
+    @param images Next frames of the streams, 8-bit of the same size, the i-th image belongs to the i-th stream.
+    A change of the number of streams or of the frame size reinitializes the models.
+    @param fgmasks Output foreground masks of the streams, 8-bit binary images.
+    @param learningRate Same as for BackgroundSubtractorCNT::apply.
+     */
+    CV_WRAP virtual void apply(InputArrayOfArrays images, OutputArrayOfArrays fgmasks, double learningRate=-1) = 0;
+
+    /** @brief Computes the background images of the streams.
+     */
+    CV_WRAP virtual void getBackgroundImages(OutputArrayOfArrays backgroundImages) const = 0;
+
+    /** @brief Returns the number of streams of the current models.
+    */
+    CV_WRAP virtual int getNumStreams() const = 0;
+
+    /** @brief Returns number of frames with same pixel color to consider stable.
+    */
+    CV_WRAP virtual int getMinPixelStability() const = 0;
+    /** @brief Sets the number of frames with same pixel color to consider stable.
+    */
+    CV_WRAP virtual void setMinPixelStability(int value) = 0;
+
+    /** @brief Returns maximum allowed credit for a pixel in history.
+    */
+    CV_WRAP virtual int getMaxPixelStability() const = 0;
+    /** @brief Sets the maximum allowed credit for a pixel in history.
+    */
+    CV_WRAP virtual void setMaxPixelStability(int value) = 0;
+
+    /** @brief Returns if we're giving a pixel credit for being stable for a long time.
+    */
+    CV_WRAP virtual bool getUseHistory() const = 0;
+    /** @brief Sets if we're giving a pixel credit for being stable for a long time.
+    */
+    CV_WRAP virtual void setUseHistory(bool value) = 0;
+};
+
+/** @brief Creates a CNT Background Subtractor for a batch of streams
+
+@param minPixelStability number of frames with same pixel color to consider stable
+@param useHistory determines if we're giving a pixel credit for being stable for a long time
+@param maxPixelStability maximum allowed credit for a pixel in history
+ */
+
+CV_EXPORTS_W Ptr<BackgroundSubtractorCNTBatch>
+createBackgroundSubtractorCNTBatch(int minPixelStability = 15,
+                                   bool useHistory = true,
+                                   int maxPixelStability = 15*60);
+
 //! @}
 
 }
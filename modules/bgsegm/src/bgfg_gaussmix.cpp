@@ -41,6 +41,7 @@
 //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <float.h>
 
 // to make sure we can use these short names
@@ -117,8 +118,9 @@ public:
         // for each gaussian mixture of each pixel bg model we store ...
         // the mixture sort key (w/sum_of_variances), the mixture weight (w),
         // the mean (nchannels values) and
-        // the diagonal covariance matrix (another nchannels values)
-        bgmodel.create( 1, frameSize.height*frameSize.width*nmixtures*(2 + 2*nchannels), CV_32F );
+        // the diagonal covariance matrix (another nchannels values),
+        // each of them in its own plane (a row of the model) with a value per pixel
+        bgmodel.create( nmixtures*(2 + 2*nchannels), frameSize.height*frameSize.width, CV_32F );
         bgmodel = Scalar::all(0);
     }
 
@@ -171,272 +173,281 @@ protected:
 };
 
 
-template<typename VT> struct MixData
+// The model is stored plane by plane: for every mixture the sort keys (w/sum_of_variances),
+// the weights, then the means and the variances of the channels, with one value per pixel
+// in each plane. The mixtures of neighbor pixels are then contiguous in memory.
+template<int cn> struct MixPlanes
 {
-    float sortKey;
-    float weight;
-    VT mean;
-    VT var;
+    enum { SORT_KEY = 0, WEIGHT = 1, MEAN = 2, VAR = 2 + cn, NFIELDS = 2 + 2*cn };
+
+    MixPlanes(Mat& bgmodel, int pixel) : data(bgmodel.ptr<float>() + pixel), step(bgmodel.step1()) {}
+
+    float& sortKey(int k) const { return data[(k*NFIELDS + SORT_KEY)*step]; }
+    float& weight(int k) const { return data[(k*NFIELDS + WEIGHT)*step]; }
+    float& mean(int k, int c) const { return data[(k*NFIELDS + MEAN + c)*step]; }
+    float& var(int k, int c) const { return data[(k*NFIELDS + VAR + c)*step]; }
+
+    // exchanges the mixtures k and k+1
+    void swap(int k) const
+    {
+        for( int f = 0; f < NFIELDS; f++ )
+            std::swap( data[(k*NFIELDS + f)*step], data[((k + 1)*NFIELDS + f)*step] );
+    }
+
+    float* data;
+    size_t step;
 };
 
+struct MOGParams
+{
+    int K;
+    float alpha, T, vT;
+    float w0, sk0, var0, minVar;
+};
 
-static void process8uC1( const Mat& image, Mat& fgmask, double learningRate,
-                         Mat& bgmodel, int nmixtures, double backgroundRatio,
-                         double varThreshold, double noiseSigma )
+template<int cn> static inline uchar updatePixel( const MixPlanes<cn>& m, const uchar* src, const MOGParams& p )
 {
-    int x, y, k, k1, rows = image.rows, cols = image.cols;
-    float alpha = (float)learningRate, T = (float)backgroundRatio, vT = (float)varThreshold;
-    int K = nmixtures;
-    MixData<float>* mptr = (MixData<float>*)bgmodel.data;
+    const int K = p.K;
+    float wsum = 0;
+    float pix[cn];
+    for( int c = 0; c < cn; c++ )
+        pix[c] = src[c];
+    int k, k1, kHit = -1, kForeground = -1;
+
+    for( k = 0; k < K; k++ )
+    {
+        float w = m.weight(k);
+        wsum += w;
+        if( w < FLT_EPSILON )
+            break;
+        float diff[cn], d2 = 0, varSum = 0;
+        for( int c = 0; c < cn; c++ )
+        {
+            diff[c] = pix[c] - m.mean(k, c);
+            d2 += diff[c]*diff[c];
+            varSum += m.var(k, c);
+        }
+        if( d2 < p.vT*varSum )
+        {
+            wsum -= w;
+            float dw = p.alpha*(1.f - w);
+            m.weight(k) = w + dw;
+            varSum = 0;
+            for( int c = 0; c < cn; c++ )
+            {
+                float var = m.var(k, c);
+                m.mean(k, c) += p.alpha*diff[c];
+                var = std::max(var + p.alpha*(diff[c]*diff[c] - var), p.minVar);
+                m.var(k, c) = var;
+                varSum += var;
+            }
+            m.sortKey(k) = w/std::sqrt(varSum);
 
-    const float w0 = (float)defaultInitialWeight;
-    const float sk0 = (float)(w0/(defaultNoiseSigma*2));
-    const float var0 = (float)(defaultNoiseSigma*defaultNoiseSigma*4);
-    const float minVar = (float)(noiseSigma*noiseSigma);
+            for( k1 = k-1; k1 >= 0; k1-- )
+            {
+                if( m.sortKey(k1) >= m.sortKey(k1+1) )
+                    break;
+                m.swap(k1);
+            }
+
+            kHit = k1+1;
+            break;
+        }
+    }
 
-    for( y = 0; y < rows; y++ )
+    if( kHit < 0 ) // no appropriate gaussian mixture found at all, remove the weakest mixture and create a new one
     {
-        const uchar* src = image.ptr<uchar>(y);
-        uchar* dst = fgmask.ptr<uchar>(y);
+        kHit = k = std::min(k, K-1);
+        wsum += p.w0 - m.weight(k);
+        m.weight(k) = p.w0;
+        for( int c = 0; c < cn; c++ )
+        {
+            m.mean(k, c) = pix[c];
+            m.var(k, c) = p.var0;
+        }
+        m.sortKey(k) = p.sk0;
+    }
+    else
+        for( ; k < K; k++ )
+            wsum += m.weight(k);
+
+    float wscale = 1.f/wsum;
+    wsum = 0;
+    for( k = 0; k < K; k++ )
+    {
+        wsum += m.weight(k) *= wscale;
+        m.sortKey(k) *= wscale;
+        if( wsum > p.T && kForeground < 0 )
+            kForeground = k+1;
+    }
 
-        if( alpha > 0 )
+    return (uchar)(-(kHit >= kForeground));
+}
+
+template<int cn> static inline uchar classifyPixel( const MixPlanes<cn>& m, const uchar* src, const MOGParams& p )
+{
+    const int K = p.K;
+    int k, kHit = -1, kForeground = -1;
+
+    for( k = 0; k < K; k++ )
+    {
+        if( m.weight(k) < FLT_EPSILON )
+            break;
+        float d2 = 0, varSum = 0;
+        for( int c = 0; c < cn; c++ )
         {
-            for( x = 0; x < cols; x++, mptr += K )
-            {
-                float wsum = 0;
-                float pix = src[x];
-                int kHit = -1, kForeground = -1;
-
-                for( k = 0; k < K; k++ )
-                {
-                    float w = mptr[k].weight;
-                    wsum += w;
-                    if( w < FLT_EPSILON )
-                        break;
-                    float mu = mptr[k].mean;
-                    float var = mptr[k].var;
-                    float diff = pix - mu;
-                    float d2 = diff*diff;
-                    if( d2 < vT*var )
-                    {
-                        wsum -= w;
-                        float dw = alpha*(1.f - w);
-                        mptr[k].weight = w + dw;
-                        mptr[k].mean = mu + alpha*diff;
-                        var = std::max(var + alpha*(d2 - var), minVar);
-                        mptr[k].var = var;
-                        mptr[k].sortKey = w/std::sqrt(var);
-
-                        for( k1 = k-1; k1 >= 0; k1-- )
-                        {
-                            if( mptr[k1].sortKey >= mptr[k1+1].sortKey )
-                                break;
-                            std::swap( mptr[k1], mptr[k1+1] );
-                        }
-
-                        kHit = k1+1;
-                        break;
-                    }
-                }
-
-                if( kHit < 0 ) // no appropriate gaussian mixture found at all, remove the weakest mixture and create a new one
-                {
-                    kHit = k = std::min(k, K-1);
-                    wsum += w0 - mptr[k].weight;
-                    mptr[k].weight = w0;
-                    mptr[k].mean = pix;
-                    mptr[k].var = var0;
-                    mptr[k].sortKey = sk0;
-                }
-                else
-                    for( ; k < K; k++ )
-                        wsum += mptr[k].weight;
-
-                float wscale = 1.f/wsum;
-                wsum = 0;
-                for( k = 0; k < K; k++ )
-                {
-                    wsum += mptr[k].weight *= wscale;
-                    mptr[k].sortKey *= wscale;
-                    if( wsum > T && kForeground < 0 )
-                        kForeground = k+1;
-                }
-
-                dst[x] = (uchar)(-(kHit >= kForeground));
-            }
+            float diff = src[c] - m.mean(k, c);
+            d2 += diff*diff;
+            varSum += m.var(k, c);
         }
-        else
+        if( d2 < p.vT*varSum )
+        {
+            kHit = k;
+            break;
+        }
+    }
+
+    if( kHit >= 0 )
+    {
+        float wsum = 0;
+        for( k = 0; k < K; k++ )
         {
-            for( x = 0; x < cols; x++, mptr += K )
+            wsum += m.weight(k);
+            if( wsum > p.T )
             {
-                float pix = src[x];
-                int kHit = -1, kForeground = -1;
-
-                for( k = 0; k < K; k++ )
-                {
-                    if( mptr[k].weight < FLT_EPSILON )
-                        break;
-                    float mu = mptr[k].mean;
-                    float var = mptr[k].var;
-                    float diff = pix - mu;
-                    float d2 = diff*diff;
-                    if( d2 < vT*var )
-                    {
-                        kHit = k;
-                        break;
-                    }
-                }
-
-                if( kHit >= 0 )
-                {
-                    float wsum = 0;
-                    for( k = 0; k < K; k++ )
-                    {
-                        wsum += mptr[k].weight;
-                        if( wsum > T )
-                        {
-                            kForeground = k+1;
-                            break;
-                        }
-                    }
-                }
-
-                dst[x] = (uchar)(kHit < 0 || kHit >= kForeground ? 255 : 0);
+                kForeground = k+1;
+                break;
             }
         }
     }
-}
 
+    return (uchar)(kHit < 0 || kHit >= kForeground ? 255 : 0);
+}
 
-static void process8uC3( const Mat& image, Mat& fgmask, double learningRate,
-                         Mat& bgmodel, int nmixtures, double backgroundRatio,
-                         double varThreshold, double noiseSigma )
+#if CV_SIMD128
+// Updates the 4 pixels starting at m.data which match their first (the most probable) mixture,
+// with the same computations as updatePixel. Returns the mask of the updated pixels.
+template<int cn> static inline int updateFirstMixture4( const MixPlanes<cn>& m, const uchar* src, const MOGParams& p,
+                                                        uchar* dst )
 {
-    int x, y, k, k1, rows = image.rows, cols = image.cols;
-    float alpha = (float)learningRate, T = (float)backgroundRatio, vT = (float)varThreshold;
-    int K = nmixtures;
+    const v_float32x4 zero = v_setzero_f32(), one = v_setall_f32(1.f), alpha = v_setall_f32(p.alpha);
 
-    const float w0 = (float)defaultInitialWeight;
-    const float sk0 = (float)(w0/(defaultNoiseSigma*2*std::sqrt(3.)));
-    const float var0 = (float)(defaultNoiseSigma*defaultNoiseSigma*4);
-    const float minVar = (float)(noiseSigma*noiseSigma);
-    MixData<Vec3f>* mptr = (MixData<Vec3f>*)bgmodel.data;
+    v_float32x4 w = v_load(&m.weight(0));
+    v_float32x4 diff[cn], d2 = zero, varSum = zero;
+    for( int c = 0; c < cn; c++ )
+    {
+        float buf[4];
+        for( int i = 0; i < 4; i++ )
+            buf[i] = src[i*cn + c];
+        diff[c] = v_load(buf) - v_load(&m.mean(0, c));
+        d2 += diff[c]*diff[c];
+        varSum += v_load(&m.var(0, c));
+    }
 
-    for( y = 0; y < rows; y++ )
+    v_float32x4 hit = (w >= v_setall_f32(FLT_EPSILON)) & (d2 < v_setall_f32(p.vT)*varSum);
+    int hitMask = v_signmask(hit);
+    if( hitMask == 0 )
+        return 0;
+
+    // the mixture stays the first one, no reordering is needed
+    v_float32x4 w1 = w + alpha*(one - w);
+    varSum = zero;
+    for( int c = 0; c < cn; c++ )
+    {
+        v_float32x4 mean = v_load(&m.mean(0, c)), var = v_load(&m.var(0, c));
+        v_store(&m.mean(0, c), v_select(hit, mean + alpha*diff[c], mean));
+        var = v_select(hit, v_max(var + alpha*(diff[c]*diff[c] - var), v_setall_f32(p.minVar)), var);
+        v_store(&m.var(0, c), var);
+        varSum += var;
+    }
+    v_float32x4 sk1 = w/v_sqrt(varSum);
+
+    v_float32x4 wsum = w1;
+    for( int k = 1; k < p.K; k++ )
+        wsum += v_load(&m.weight(k));
+
+    v_float32x4 wscale = one/wsum;
+    wsum = zero;
+    for( int k = 0; k < p.K; k++ )
+    {
+        v_float32x4 wk = k == 0 ? w1 : v_load(&m.weight(k));
+        v_float32x4 sk = k == 0 ? sk1 : v_load(&m.sortKey(k));
+        wk = v_select(hit, wk*wscale, k == 0 ? w : wk);
+        v_store(&m.weight(k), wk);
+        v_store(&m.sortKey(k), v_select(hit, sk*wscale, k == 0 ? v_load(&m.sortKey(0)) : sk));
+        wsum += wk;
+    }
+
+    // the weights only grow, so the pixel is background if they all exceed T
+    int bgMask = v_signmask(wsum > v_setall_f32(p.T));
+    for( int i = 0; i < 4; i++ )
+        if( hitMask & (1 << i) )
+            dst[i] = (bgMask & (1 << i)) ? 0 : 255;
+
+    return hitMask;
+}
+#endif
+
+template<int cn> static void process8u( const Mat& image, Mat& fgmask, Mat& bgmodel, const MOGParams& p,
+                                        const Range& rows )
+{
+    const int cols = image.cols;
+
+    for( int y = rows.start; y < rows.end; y++ )
     {
         const uchar* src = image.ptr<uchar>(y);
         uchar* dst = fgmask.ptr<uchar>(y);
+        const int pixel0 = y*cols;
+        int x = 0;
 
-        if( alpha > 0 )
+        if( p.alpha > 0 )
         {
-            for( x = 0; x < cols; x++, mptr += K )
+#if CV_SIMD128
+            for( ; x <= cols - 4; x += 4 )
             {
-                float wsum = 0;
-                Vec3f pix(src[x*3], src[x*3+1], src[x*3+2]);
-                int kHit = -1, kForeground = -1;
-
-                for( k = 0; k < K; k++ )
-                {
-                    float w = mptr[k].weight;
-                    wsum += w;
-                    if( w < FLT_EPSILON )
-                        break;
-                    Vec3f mu = mptr[k].mean;
-                    Vec3f var = mptr[k].var;
-                    Vec3f diff = pix - mu;
-                    float d2 = diff.dot(diff);
-                    if( d2 < vT*(var[0] + var[1] + var[2]) )
-                    {
-                        wsum -= w;
-                        float dw = alpha*(1.f - w);
-                        mptr[k].weight = w + dw;
-                        mptr[k].mean = mu + alpha*diff;
-                        var = Vec3f(std::max(var[0] + alpha*(diff[0]*diff[0] - var[0]), minVar),
-                                    std::max(var[1] + alpha*(diff[1]*diff[1] - var[1]), minVar),
-                                    std::max(var[2] + alpha*(diff[2]*diff[2] - var[2]), minVar));
-                        mptr[k].var = var;
-                        mptr[k].sortKey = w/std::sqrt(var[0] + var[1] + var[2]);
-
-                        for( k1 = k-1; k1 >= 0; k1-- )
-                        {
-                            if( mptr[k1].sortKey >= mptr[k1+1].sortKey )
-                                break;
-                            std::swap( mptr[k1], mptr[k1+1] );
-                        }
-
-                        kHit = k1+1;
-                        break;
-                    }
-                }
-
-                if( kHit < 0 ) // no appropriate gaussian mixture found at all, remove the weakest mixture and create a new one
-                {
-                    kHit = k = std::min(k, K-1);
-                    wsum += w0 - mptr[k].weight;
-                    mptr[k].weight = w0;
-                    mptr[k].mean = pix;
-                    mptr[k].var = Vec3f(var0, var0, var0);
-                    mptr[k].sortKey = sk0;
-                }
-                else
-                    for( ; k < K; k++ )
-                        wsum += mptr[k].weight;
-
-                float wscale = 1.f/wsum;
-                wsum = 0;
-                for( k = 0; k < K; k++ )
-                {
-                    wsum += mptr[k].weight *= wscale;
-                    mptr[k].sortKey *= wscale;
-                    if( wsum > T && kForeground < 0 )
-                        kForeground = k+1;
-                }
-
-                dst[x] = (uchar)(-(kHit >= kForeground));
+                int hitMask = updateFirstMixture4<cn>( MixPlanes<cn>(bgmodel, pixel0 + x), src + x*cn, p, dst + x );
+                for( int i = 0; i < 4; i++ )
+                    if( !(hitMask & (1 << i)) )
+                        dst[x + i] = updatePixel<cn>( MixPlanes<cn>(bgmodel, pixel0 + x + i), src + (x + i)*cn, p );
             }
+#endif
+            for( ; x < cols; x++ )
+                dst[x] = updatePixel<cn>( MixPlanes<cn>(bgmodel, pixel0 + x), src + x*cn, p );
         }
         else
         {
-            for( x = 0; x < cols; x++, mptr += K )
-            {
-                Vec3f pix(src[x*3], src[x*3+1], src[x*3+2]);
-                int kHit = -1, kForeground = -1;
-
-                for( k = 0; k < K; k++ )
-                {
-                    if( mptr[k].weight < FLT_EPSILON )
-                        break;
-                    Vec3f mu = mptr[k].mean;
-                    Vec3f var = mptr[k].var;
-                    Vec3f diff = pix - mu;
-                    float d2 = diff.dot(diff);
-                    if( d2 < vT*(var[0] + var[1] + var[2]) )
-                    {
-                        kHit = k;
-                        break;
-                    }
-                }
-
-                if( kHit >= 0 )
-                {
-                    float wsum = 0;
-                    for( k = 0; k < K; k++ )
-                    {
-                        wsum += mptr[k].weight;
-                        if( wsum > T )
-                        {
-                            kForeground = k+1;
-                            break;
-                        }
-                    }
-                }
-
-                dst[x] = (uchar)(kHit < 0 || kHit >= kForeground ? 255 : 0);
-            }
+            for( ; x < cols; x++ )
+                dst[x] = classifyPixel<cn>( MixPlanes<cn>(bgmodel, pixel0 + x), src + x*cn, p );
         }
     }
 }
 
+class MOGInvoker : public ParallelLoopBody
+{
+public:
+    MOGInvoker(const Mat& _image, Mat& _fgmask, Mat& _bgmodel, const MOGParams& _params)
+        : image(_image), fgmask(_fgmask), bgmodel(_bgmodel), params(_params)
+    {
+    }
+
+    // the pixels are independent, every range of rows is processed on its own
+    void operator()(const Range& range) const
+    {
+        if( image.channels() == 1 )
+            process8u<1>( image, fgmask, bgmodel, params, range );
+        else
+            process8u<3>( image, fgmask, bgmodel, params, range );
+    }
+
+private:
+    const Mat& image;
+    Mat& fgmask;
+    Mat& bgmodel;
+    MOGParams params;
+
+    MOGInvoker& operator=(const MOGInvoker&);
+};
+
 void BackgroundSubtractorMOGImpl::apply(InputArray _image, OutputArray _fgmask, double learningRate)
 {
     Mat image = _image.getMat();
@@ -453,12 +464,20 @@ void BackgroundSubtractorMOGImpl::apply(InputArray _image, OutputArray _fgmask,
     learningRate = learningRate >= 0 && nframes > 1 ? learningRate : 1./std::min( nframes, history );
     CV_Assert(learningRate >= 0);
 
-    if( image.type() == CV_8UC1 )
-        process8uC1( image, fgmask, learningRate, bgmodel, nmixtures, backgroundRatio, varThreshold, noiseSigma );
-    else if( image.type() == CV_8UC3 )
-        process8uC3( image, fgmask, learningRate, bgmodel, nmixtures, backgroundRatio, varThreshold, noiseSigma );
-    else
+    if( image.type() != CV_8UC1 && image.type() != CV_8UC3 )
         CV_Error( Error::StsUnsupportedFormat, "Only 1- and 3-channel 8-bit images are supported in BackgroundSubtractorMOG" );
+
+    MOGParams params;
+    params.K = nmixtures;
+    params.alpha = (float)learningRate;
+    params.T = (float)backgroundRatio;
+    params.vT = (float)varThreshold;
+    params.w0 = (float)defaultInitialWeight;
+    params.sk0 = (float)(params.w0/(defaultNoiseSigma*2*std::sqrt((double)image.channels())));
+    params.var0 = (float)(defaultNoiseSigma*defaultNoiseSigma*4);
+    params.minVar = (float)(noiseSigma*noiseSigma);
+
+    parallel_for_(Range(0, image.rows), MOGInvoker(image, fgmask, bgmodel, params), image.total()/(double)(1<<16));
 }
 
 Ptr<BackgroundSubtractorMOG> createBackgroundSubtractorMOG(int history, int nmixtures,
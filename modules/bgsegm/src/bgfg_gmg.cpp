@@ -50,6 +50,7 @@
 
 #include "precomp.hpp"
 #include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <limits>
 
 namespace cv
@@ -74,6 +75,7 @@ public:
         smoothingRadius = 7;
         updateBackgroundModel = true;
         minVal_ = maxVal_ = 0;
+        compactColors_ = false;
         name_ = "BackgroundSubtractor.GMG";
     }
 
@@ -194,8 +196,8 @@ private:
     String name_;
 
     Mat_<int> nfeatures_;
-    Mat_<unsigned int> colors_;
-    Mat_<float> weights_;
+    Mat features_;
+    bool compactColors_;
 
     Mat buf_;
 };
@@ -217,75 +219,127 @@ void BackgroundSubtractorGMGImpl::initialize(Size frameSize, double minVal, doub
     frameNum_ = 0;
 
     nfeatures_.create(frameSize_);
-    colors_.create(frameSize_.area(), maxFeatures);
-    weights_.create(frameSize_.area(), maxFeatures);
-
     nfeatures_.setTo(Scalar::all(0));
+
+    // the features are allocated by apply, their size depends on the number of channels
+    features_.release();
+}
+
+// The weights of the features are 16-bit fixed point numbers, GMG_WEIGHT_ONE being 1.0.
+// In the training mode they count the occurrences of the colors, until the normalization
+// at the last training frame.
+static const int GMG_WEIGHT_ONE = 65535;
+
+// Number of bits needed for the quantized values of a channel, from 0 to quantizationLevels
+static int quantizationBits(int quantizationLevels)
+{
+    int bits = 1;
+    while ((1 << bits) <= quantizationLevels)
+        ++bits;
+    return bits;
 }
 
-static float findFeature(unsigned int color, const unsigned int* colors, const float* weights, int nfeatures)
+template <typename ColorT> static int findFeature(ColorT color, const ColorT* colors, int nfeatures)
 {
     for (int i = 0; i < nfeatures; ++i)
     {
         if (color == colors[i])
-            return weights[i];
+            return i;
     }
 
-    // not in histogram, so return 0.
-    return 0.0f;
+    // not in histogram
+    return -1;
 }
 
-static void normalizeHistogram(float* weights, int nfeatures)
+#if CV_SIMD128
+static int findFeature(ushort color, const ushort* colors, int nfeatures)
 {
-    float total = 0.0f;
-    for (int i = 0; i < nfeatures; ++i)
-        total += weights[i];
-
-    if (total != 0.0f)
+    int i = 0;
+    const v_uint16x8 v_color = v_setall_u16(color);
+    for (; i <= nfeatures - 8; i += 8)
     {
-        for (int i = 0; i < nfeatures; ++i)
-            weights[i] /= total;
+        int mask = v_signmask(v_load(colors + i) == v_color);
+        if (mask != 0)
+        {
+            for (int j = 0; ; ++j)
+                if (mask & (1 << j))
+                    return i + j;
+        }
     }
+    for (; i < nfeatures; ++i)
+    {
+        if (color == colors[i])
+            return i;
+    }
+    return -1;
 }
 
-static bool insertFeature(unsigned int color, float weight, unsigned int* colors, float* weights, int& nfeatures, int maxFeatures)
+static int findFeature(unsigned int color, const unsigned int* colors, int nfeatures)
 {
-    int idx = -1;
-    for (int i = 0; i < nfeatures; ++i)
+    int i = 0;
+    const v_uint32x4 v_color = v_setall_u32(color);
+    for (; i <= nfeatures - 4; i += 4)
     {
-        if (color == colors[i])
+        int mask = v_signmask(v_load(colors + i) == v_color);
+        if (mask != 0)
         {
-            // feature in histogram
-            weight += weights[i];
-            idx = i;
-            break;
+            for (int j = 0; ; ++j)
+                if (mask & (1 << j))
+                    return i + j;
         }
     }
+    for (; i < nfeatures; ++i)
+    {
+        if (color == colors[i])
+            return i;
+    }
+    return -1;
+}
+#endif
+
+static void normalizeHistogram(ushort* weights, int nfeatures)
+{
+    uint64 total = 0;
+    for (int i = 0; i < nfeatures; ++i)
+        total += weights[i];
+
+    if (total != 0)
+    {
+        for (int i = 0; i < nfeatures; ++i)
+            weights[i] = (ushort)((weights[i] * (uint64)GMG_WEIGHT_ONE + total / 2) / total);
+    }
+}
+
+template <typename ColorT>
+static bool insertFeature(ColorT color, int weight, ColorT* colors, ushort* weights, int& nfeatures, int maxFeatures)
+{
+    int idx = findFeature(color, colors, nfeatures);
 
     if (idx >= 0)
     {
-        // move feature to beginning of list
+        // feature in histogram, move it to beginning of list
+        weight += weights[idx];
 
-        ::memmove(colors + 1, colors, idx * sizeof(unsigned int));
-        ::memmove(weights + 1, weights, idx * sizeof(float));
+        ::memmove(colors + 1, colors, idx * sizeof(ColorT));
+        ::memmove(weights + 1, weights, idx * sizeof(ushort));
 
         colors[0] = color;
-        weights[0] = weight;
+        weights[0] = saturate_cast<ushort>(weight);
     }
     else if (nfeatures == maxFeatures)
     {
         // discard oldest feature
 
-        ::memmove(colors + 1, colors, (nfeatures - 1) * sizeof(unsigned int));
-        ::memmove(weights + 1, weights, (nfeatures - 1) * sizeof(float));
+        ::memmove(colors + 1, colors, (nfeatures - 1) * sizeof(ColorT));
+        ::memmove(weights + 1, weights, (nfeatures - 1) * sizeof(ushort));
 
         colors[0] = color;
-        weights[0] = weight;
+        weights[0] = saturate_cast<ushort>(weight);
     }
     else
     {
         colors[nfeatures] = color;
-        weights[nfeatures] = weight;
+        weights[nfeatures] = saturate_cast<ushort>(weight);
 
         ++nfeatures;
 
@@ -297,14 +351,17 @@ static bool insertFeature(unsigned int color, float weight, unsigned int* colors
 
 template <typename T> struct Quantization
 {
-    static unsigned int apply(const void* src_, int x, int cn, double minVal, double maxVal, int quantizationLevels)
+    static unsigned int apply(const void* src_, int x, int cn, double minVal, double maxVal, int quantizationLevels, int bits)
     {
         const T* src = static_cast<const T*>(src_);
         src += x * cn;
 
         unsigned int res = 0;
-        for (int i = 0, shift = 0; i < cn; ++i, ++src, shift += 8)
-            res |= static_cast<int>((*src - minVal) * quantizationLevels / (maxVal - minVal)) << shift;
+        for (int i = 0, shift = 0; i < cn; ++i, ++src, shift += bits)
+        {
+            int level = static_cast<int>((*src - minVal) * quantizationLevels / (maxVal - minVal));
+            res |= (unsigned int)std::min(std::max(level, 0), quantizationLevels) << shift;
+        }
 
         return res;
     }
@@ -313,26 +370,34 @@ template <typename T> struct Quantization
 class GMG_LoopBody : public ParallelLoopBody
 {
 public:
-    GMG_LoopBody(const Mat& frame, const Mat& fgmask, const Mat_<int>& nfeatures, const Mat_<unsigned int>& colors, const Mat_<float>& weights,
+    GMG_LoopBody(const Mat& frame, const Mat& fgmask, const Mat_<int>& nfeatures, const Mat& features, bool compactColors,
                  int maxFeatures, double learningRate, int numInitializationFrames, int quantizationLevels, double backgroundPrior, double decisionThreshold,
                  double maxVal, double minVal, int frameNum, bool updateBackgroundModel) :
-        frame_(frame), fgmask_(fgmask), nfeatures_(nfeatures), colors_(colors), weights_(weights),
+        frame_(frame), fgmask_(fgmask), nfeatures_(nfeatures), features_(features), compactColors_(compactColors),
         maxFeatures_(maxFeatures), learningRate_(learningRate), numInitializationFrames_(numInitializationFrames), quantizationLevels_(quantizationLevels),
         backgroundPrior_(backgroundPrior), decisionThreshold_(decisionThreshold), updateBackgroundModel_(updateBackgroundModel),
         maxVal_(maxVal), minVal_(minVal), frameNum_(frameNum)
     {
     }
 
-    void operator() (const Range& range) const;
+    void operator() (const Range& range) const
+    {
+        if (compactColors_)
+            process<ushort>(range);
+        else
+            process<unsigned int>(range);
+    }
 
 private:
+    template <typename ColorT> void process(const Range& range) const;
+
     Mat frame_;
 
     mutable Mat_<uchar> fgmask_;
 
     mutable Mat_<int> nfeatures_;
-    mutable Mat_<unsigned int> colors_;
-    mutable Mat_<float> weights_;
+    mutable Mat features_;
+    bool compactColors_;
 
     int     maxFeatures_;
     double  learningRate_;
@@ -347,9 +412,9 @@ private:
     int frameNum_;
 };
 
-void GMG_LoopBody::operator() (const Range& range) const
+template <typename ColorT> void GMG_LoopBody::process(const Range& range) const
 {
-    typedef unsigned int (*func_t)(const void* src_, int x, int cn, double minVal, double maxVal, int quantizationLevels);
+    typedef unsigned int (*func_t)(const void* src_, int x, int cn, double minVal, double maxVal, int quantizationLevels, int bits);
     static const func_t funcs[] =
     {
         Quantization<uchar>::apply,
@@ -365,6 +430,10 @@ void GMG_LoopBody::operator() (const Range& range) const
     CV_Assert(func != 0);
 
     const int cn = frame_.channels();
+    const int bits = compactColors_ ? quantizationBits(quantizationLevels_) : 8;
+
+    const int learningWeight = cvRound(learningRate_ * GMG_WEIGHT_ONE);
+    const unsigned int decay = (unsigned int)cvRound((1.0 - learningRate_) * (GMG_WEIGHT_ONE + 1));
 
     for (int y = range.start, featureIdx = y * frame_.cols; y < range.end; ++y)
     {
@@ -375,10 +444,10 @@ void GMG_LoopBody::operator() (const Range& range) const
         for (int x = 0; x < frame_.cols; ++x, ++featureIdx)
         {
             int nfeatures = nfeatures_row[x];
-            unsigned int* colors = colors_[featureIdx];
-            float* weights = weights_[featureIdx];
+            ColorT* colors = features_.ptr<ColorT>(featureIdx);
+            ushort* weights = (ushort*)(colors + maxFeatures_);
 
-            unsigned int newFeatureColor = func(frame_row, x, cn, minVal_, maxVal_, quantizationLevels_);
+            ColorT newFeatureColor = (ColorT)func(frame_row, x, cn, minVal_, maxVal_, quantizationLevels_, bits);
 
             bool isForeground = false;
 
@@ -386,7 +455,8 @@ void GMG_LoopBody::operator() (const Range& range) const
             {
                 // typical operation
 
-                const double weight = findFeature(newFeatureColor, colors, weights, nfeatures);
+                const int idx = findFeature(newFeatureColor, colors, nfeatures);
+                const double weight = idx >= 0 ? weights[idx] * (1.0 / GMG_WEIGHT_ONE) : 0.0;
 
                 // see Godbehere, Matsukawa, Goldberg (2012) for reasoning behind this implementation of Bayes rule
                 const double posterior = (weight * backgroundPrior_) / (weight * backgroundPrior_ + (1.0 - weight) * (1.0 - backgroundPrior_));
@@ -398,9 +468,9 @@ void GMG_LoopBody::operator() (const Range& range) const
                 if (updateBackgroundModel_)
                 {
                     for (int i = 0; i < nfeatures; ++i)
-                        weights[i] *= (float)(1.0f - learningRate_);
+                        weights[i] = (ushort)((weights[i] * decay) >> 16);
 
-                    bool inserted = insertFeature(newFeatureColor, (float)learningRate_, colors, weights, nfeatures, maxFeatures_);
+                    bool inserted = insertFeature(newFeatureColor, learningWeight, colors, weights, nfeatures, maxFeatures_);
 
                     if (inserted)
                     {
@@ -413,7 +483,8 @@ void GMG_LoopBody::operator() (const Range& range) const
             {
                 // training-mode update
 
-                insertFeature(newFeatureColor, 1.0f, colors, weights, nfeatures, maxFeatures_);
+                insertFeature(newFeatureColor, 1, colors, weights, nfeatures, maxFeatures_);
+                nfeatures_row[x] = nfeatures;
 
                 if (frameNum_ == numInitializationFrames_ - 1)
                     normalizeHistogram(weights, nfeatures);
@@ -449,10 +520,22 @@ void BackgroundSubtractorGMGImpl::apply(InputArray _frame, OutputArray _fgmask,
         initialize(frame.size(), minval, maxval);
     }
 
+    // The colors are packed in 16 bits when their quantized channels fit, and the features
+    // of a pixel are stored together: maxFeatures colors followed by maxFeatures weights
+    const bool compactColors = frame.channels() * quantizationBits(quantizationLevels) <= 16;
+    const size_t colorSize = compactColors ? sizeof(ushort) : sizeof(unsigned int);
+    const int featuresSize = (int)alignSize(maxFeatures * (colorSize + sizeof(ushort)), (int)colorSize);
+    if (features_.rows != frameSize_.area() || features_.cols != featuresSize || compactColors != compactColors_)
+    {
+        features_.create(frameSize_.area(), featuresSize, CV_8UC1);
+        compactColors_ = compactColors;
+        nfeatures_.setTo(Scalar::all(0));
+    }
+
     _fgmask.create(frameSize_, CV_8UC1);
     Mat fgmask = _fgmask.getMat();
 
-    GMG_LoopBody body(frame, fgmask, nfeatures_, colors_, weights_,
+    GMG_LoopBody body(frame, fgmask, nfeatures_, features_, compactColors_,
                       maxFeatures, learningRate, numInitializationFrames, quantizationLevels, backgroundPrior, decisionThreshold,
                       maxVal_, minVal_, frameNum_, updateBackgroundModel);
     parallel_for_(Range(0, frame.rows), body, frame.total()/(double)(1<<16));
@@ -472,8 +555,7 @@ void BackgroundSubtractorGMGImpl::release()
     frameSize_ = Size();
 
     nfeatures_.release();
-    colors_.release();
-    weights_.release();
+    features_.release();
     buf_.release();
 }
 
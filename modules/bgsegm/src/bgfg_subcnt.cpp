@@ -43,6 +43,7 @@
 
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <functional>
 
 namespace cv
@@ -415,6 +416,336 @@ Ptr<BackgroundSubtractorCNT> createBackgroundSubtractorCNT(int minPixelStability
     return makePtr<BackgroundSubtractorCNTImpl>(minPixelStability, useHistory, maxStability, isParallel);
 }
 
+
+// The models of the stream batch are planes of ints, stacked stream by stream in one buffer
+enum { CNT_STABILITY = 0, CNT_HISTORY, CNT_HISTORY_STABILITY, CNT_BACKGROUND, CNT_PLANES };
+
+struct CNTBatchParams
+{
+    int minPixelStability;
+    int maxPixelStability;
+    int threshold;
+    int thresholdHistory;
+    bool useHistory;
+};
+
+// Same as BGSubtractPixel
+static inline bool cntSubtractPixel(const CNTBatchParams& p, int currColor, int prevColor, int& stability, int& background)
+{
+    if (abs(currColor - prevColor) < p.threshold)
+    {
+        ++stability;
+        if (stability == p.minPixelStability)
+        {
+            --stability;
+            background = prevColor;
+            return false;
+        }
+        return true;
+    }
+    stability = 0;
+    return true;
+}
+
+// Same as BGSubtractPixelWithHistory
+static inline bool cntSubtractPixelWithHistory(const CNTBatchParams& p, int currColor, int prevColor,
+                                               int& stability, int& historyColor, int& historyStability, int& background)
+{
+    if (abs(currColor - historyColor) < p.thresholdHistory)
+    {
+        stability = 0;
+        if (historyStability < p.maxPixelStability)
+            ++historyStability;
+        if (historyStability <= p.minPixelStability)
+            return true;
+        background = historyColor;
+        return false;
+    }
+    if (abs(currColor - prevColor) < p.threshold)
+    {
+        if (stability < p.maxPixelStability)
+            ++stability;
+        if (stability > p.minPixelStability)
+        {
+            if (stability >= historyStability)
+            {
+                historyColor = currColor;
+                historyStability = stability;
+                background = historyColor;
+                return false;
+            }
+            if (historyStability > 0)
+                --historyStability;
+        }
+        return true;
+    }
+    stability = 0;
+    if (historyStability > 0)
+        --historyStability;
+    return true;
+}
+
+#if CV_SIMD128
+// Both the SIMD versions give the masks of the foreground pixels, the branches above are replaced by selections
+static inline v_int32x4 cntSubtractPixel(const v_int32x4& minStability, const v_int32x4& threshold,
+                                         const v_int32x4& curr, const v_int32x4& prev, v_int32x4& stability, v_int32x4& background)
+{
+    const v_int32x4 d = curr - prev;
+    const v_int32x4 same = (d < threshold) & (d > v_setzero_s32() - threshold);
+    stability = (stability + v_setall_s32(1)) & same;
+    const v_int32x4 stable = same & (stability == minStability);
+    stability += stable; // the mask is -1
+    background = v_select(stable, prev, background);
+    return ~stable;
+}
+
+static inline v_int32x4 cntSubtractPixelWithHistory(const v_int32x4& minStability, const v_int32x4& maxStability,
+                                                    const v_int32x4& threshold, const v_int32x4& thresholdHistory,
+                                                    const v_int32x4& curr, const v_int32x4& prev,
+                                                    v_int32x4& stability, v_int32x4& historyColor,
+                                                    v_int32x4& historyStability, v_int32x4& background)
+{
+    const v_int32x4 zero = v_setzero_s32();
+    const v_int32x4 dh = curr - historyColor, dp = curr - prev;
+    const v_int32x4 sameAsHistory = (dh < thresholdHistory) & (dh > zero - thresholdHistory);
+    const v_int32x4 sameAsPrev = (dp < threshold) & (dp > zero - threshold) & ~sameAsHistory;
+
+    const v_int32x4 histIncr = historyStability - (historyStability < maxStability);
+    const v_int32x4 histDecr = historyStability + (historyStability > zero);
+    const v_int32x4 stabIncr = stability - (stability < maxStability);
+
+    const v_int32x4 historyBackground = sameAsHistory & (histIncr > minStability);
+    const v_int32x4 stable = sameAsPrev & (stabIncr > minStability);
+    const v_int32x4 newHistory = stable & (stabIncr >= historyStability);
+    const v_int32x4 keepHistory = sameAsPrev & ~stable;
+
+    background = v_select(newHistory, curr, v_select(historyBackground, historyColor, background));
+    historyStability = v_select(sameAsHistory, histIncr,
+                                v_select(newHistory, stabIncr, v_select(keepHistory, historyStability, histDecr)));
+    historyColor = v_select(newHistory, curr, historyColor);
+    stability = stabIncr & sameAsPrev;
+    return ~(newHistory | historyBackground);
+}
+#endif
+
+class CNTBatchInvoker : public ParallelLoopBody
+{
+public:
+    CNTBatchInvoker(Mat_<int>& _model, const Mat& _frames, Mat& _prevFrames, std::vector<Mat>& _fgmasks,
+                    const CNTBatchParams& _params)
+        : model(_model), frames(_frames), prevFrames(_prevFrames), fgmasks(_fgmasks), params(_params)
+    {
+    }
+
+    // Iterate rows of the stacked streams
+    void operator()(const Range& range) const
+    {
+        const int rows = fgmasks[0].rows, cols = frames.cols;
+        const int planeRows = frames.rows;
+        for (int r = range.start; r < range.end; ++r)
+        {
+            int* stability = model[CNT_STABILITY * planeRows + r];
+            int* history = model[CNT_HISTORY * planeRows + r];
+            int* historyStability = model[CNT_HISTORY_STABILITY * planeRows + r];
+            int* background = model[CNT_BACKGROUND * planeRows + r];
+            const uchar* frameRow = frames.ptr<uchar>(r);
+            uchar* prevFrameRow = prevFrames.ptr<uchar>(r);
+            uchar* fgMaskRow = fgmasks[r / rows].ptr<uchar>(r % rows);
+
+            int c = 0;
+#if CV_SIMD128
+            const v_int32x4 minStability = v_setall_s32(params.minPixelStability);
+            const v_int32x4 maxStability = v_setall_s32(params.maxPixelStability);
+            const v_int32x4 threshold = v_setall_s32(params.threshold);
+            const v_int32x4 thresholdHistory = v_setall_s32(params.thresholdHistory);
+            for (; c <= cols - 8; c += 8)
+            {
+                v_int32x4 fg[2];
+                for (int k = 0; k < 2; ++k)
+                {
+                    const int x = c + k * 4;
+                    const v_int32x4 curr = v_reinterpret_as_s32(v_load_expand_q(frameRow + x));
+                    const v_int32x4 prev = v_reinterpret_as_s32(v_load_expand_q(prevFrameRow + x));
+                    v_int32x4 stab = v_load(stability + x), bg = v_load(background + x);
+                    if (params.useHistory)
+                    {
+                        v_int32x4 hist = v_load(history + x), histStab = v_load(historyStability + x);
+                        fg[k] = cntSubtractPixelWithHistory(minStability, maxStability, threshold, thresholdHistory,
+                                                            curr, prev, stab, hist, histStab, bg);
+                        v_store(history + x, hist);
+                        v_store(historyStability + x, histStab);
+                    }
+                    else
+                    {
+                        fg[k] = cntSubtractPixel(minStability, threshold, curr, prev, stab, bg);
+                    }
+                    v_store(stability + x, stab);
+                    v_store(background + x, bg);
+                }
+                v_pack_store(fgMaskRow + c, v_reinterpret_as_u16(v_pack(fg[0], fg[1])));
+            }
+#endif
+            for (; c < cols; ++c)
+            {
+                bool isForeground = params.useHistory ?
+                    cntSubtractPixelWithHistory(params, frameRow[c], prevFrameRow[c], stability[c], history[c],
+                                                historyStability[c], background[c]) :
+                    cntSubtractPixel(params, frameRow[c], prevFrameRow[c], stability[c], background[c]);
+                fgMaskRow[c] = isForeground ? 255 : 0;
+            }
+
+            memcpy(prevFrameRow, frameRow, cols);
+        }
+    }
+
+private:
+    Mat_<int>& model;
+    const Mat& frames;
+    Mat& prevFrames;
+    std::vector<Mat>& fgmasks;
+    CNTBatchParams params;
+
+    CNTBatchInvoker& operator=(const CNTBatchInvoker&);
+};
+
+class BackgroundSubtractorCNTBatchImpl : public BackgroundSubtractorCNTBatch
+{
+public:
+    BackgroundSubtractorCNTBatchImpl(int minStability, bool _useHistory, int maxStability)
+        : minPixelStability(minStability),
+          maxPixelStability(maxStability),
+          threshold(5),
+          useHistory(_useHistory),
+          nstreams(0)
+    {
+    }
+
+    virtual void apply(InputArrayOfArrays images, OutputArrayOfArrays fgmasks, double learningRate);
+    virtual void getBackgroundImages(OutputArrayOfArrays backgroundImages) const;
+
+    int getNumStreams() const { return nstreams; }
+
+    int getMinPixelStability() const { return minPixelStability; }
+    void setMinPixelStability(int value)
+    {
+        CV_Assert(value > 0 && value < maxPixelStability);
+        minPixelStability = value;
+    }
+
+    int getMaxPixelStability() const { return maxPixelStability; }
+    void setMaxPixelStability(int value)
+    {
+        CV_Assert(value > minPixelStability);
+        maxPixelStability = value;
+    }
+
+    bool getUseHistory() const { return useHistory; }
+    void setUseHistory(bool value) { useHistory = value; }
+
+private:
+    int minPixelStability;
+    int maxPixelStability;
+    int threshold;
+    bool useHistory;
+
+    int nstreams;
+    Size frameSize;
+    Mat_<int> model;  // CNT_PLANES planes of nstreams*frameSize.height rows
+    Mat frames;       // the gray frames of the streams stacked vertically
+    Mat prevFrames;
+    std::vector<Mat> masks;
+};
+
+void BackgroundSubtractorCNTBatchImpl::apply(InputArrayOfArrays images, OutputArrayOfArrays _fgmasks, double learningRate)
+{
+    const int n = (int)images.total();
+    CV_Assert(n > 0);
+    const Size size = images.size(0);
+    CV_Assert(size.area() > 0);
+
+    bool needToInitialize = model.empty() || learningRate >= 1 || n != nstreams || size != frameSize;
+    if (needToInitialize)
+    {
+        nstreams = n;
+        frameSize = size;
+        frames.create(n * size.height, size.width, CV_8U);
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        Mat image = images.getMat(i);
+        CV_Assert(image.depth() == CV_8U && image.size() == frameSize);
+        Mat stacked = frames.rowRange(i * frameSize.height, (i + 1) * frameSize.height);
+        if (image.channels() != 1)
+            cvtColor(image, stacked, COLOR_BGR2GRAY);
+        else
+            image.copyTo(stacked);
+    }
+
+    if (needToInitialize)
+    {   // Usually done only once
+        model = Mat_<int>::zeros(CNT_PLANES * frames.rows, frames.cols);
+        frames.convertTo(model.rowRange(CNT_HISTORY * frames.rows, (CNT_HISTORY + 1) * frames.rows), CV_32S);
+        frames.copyTo(prevFrames);
+    }
+
+    _fgmasks.create(n, 1, CV_8U);
+    masks.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        _fgmasks.create(frameSize, CV_8U, i);
+        masks[i] = _fgmasks.getMat(i);
+    }
+
+    CNTBatchParams params;
+    params.minPixelStability = minPixelStability;
+    params.useHistory = useHistory && learningRate != 0;
+    if (params.useHistory)
+    {
+        double scaleMaxStability = 1.0;
+        if (learningRate > 0 && learningRate < 1.0)
+        {
+            scaleMaxStability = learningRate;
+        }
+        params.maxPixelStability = int(maxPixelStability * scaleMaxStability);
+        params.threshold = threshold;
+        params.thresholdHistory = 30;
+    }
+    else
+    {
+        params.maxPixelStability = maxPixelStability;
+        params.threshold = threshold * 3;
+        params.thresholdHistory = 0;
+    }
+
+    // at least one stripe per stream
+    parallel_for_(Range(0, frames.rows), CNTBatchInvoker(model, frames, prevFrames, masks, params),
+                  std::max(n, getNumThreads()));
+
+    // do not keep the buffers of the caller alive
+    for (int i = 0; i < n; ++i)
+        masks[i].release();
+}
+
+void BackgroundSubtractorCNTBatchImpl::getBackgroundImages(OutputArrayOfArrays _backgroundImages) const
+{
+    CV_Assert(! model.empty());
+
+    _backgroundImages.create(nstreams, 1, CV_8U);
+    const int rows = frameSize.height;
+    for (int i = 0; i < nstreams; ++i)
+    {
+        _backgroundImages.create(frameSize, CV_8U, i);
+        Mat backgroundImage = _backgroundImages.getMat(i);
+        const int start = CNT_BACKGROUND * frames.rows + i * rows;
+        model.rowRange(start, start + rows).convertTo(backgroundImage, CV_8U);
+    }
+}
+
+Ptr<BackgroundSubtractorCNTBatch> createBackgroundSubtractorCNTBatch(int minPixelStability, bool useHistory, int maxStability)
+{
+    return makePtr<BackgroundSubtractorCNTBatchImpl>(minPixelStability, useHistory, maxStability);
+}
 }
 }
 
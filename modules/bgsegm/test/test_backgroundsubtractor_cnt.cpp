@@ -0,0 +1,68 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+using namespace cv;
+using namespace cv::bgsegm;
+
+static void testCNTBatch(bool useHistory, double learningRate)
+{
+    const int nstreams = 5;
+    const Size size(37, 23); // odd width to cover the scalar tails
+    RNG rng(12345);
+
+    std::vector<Mat> backgrounds(nstreams);
+    std::vector<Ptr<BackgroundSubtractorCNT> > single(nstreams);
+    for (int i = 0; i < nstreams; i++)
+    {
+        backgrounds[i].create(size, i % 2 ? CV_8UC3 : CV_8UC1);
+        rng.fill(backgrounds[i], RNG::UNIFORM, 0, 256);
+        single[i] = createBackgroundSubtractorCNT(3, useHistory, 20);
+    }
+    Ptr<BackgroundSubtractorCNTBatch> batch = createBackgroundSubtractorCNTBatch(3, useHistory, 20);
+
+    std::vector<Mat> frames(nstreams), fgmasks;
+    Mat expected, noise;
+    for (int t = 0; t < 30; t++)
+    {
+        for (int i = 0; i < nstreams; i++)
+        {
+            noise.create(size, backgrounds[i].type());
+            rng.fill(noise, RNG::UNIFORM, 0, t % 7 == 3 ? 60 : 4);
+            add(backgrounds[i], noise, frames[i]);
+            frames[i](Rect(rng.uniform(0, 30), rng.uniform(0, 16), 7, 7)).setTo(Scalar::all(rng.uniform(0, 256)));
+        }
+
+        batch->apply(frames, fgmasks, learningRate);
+        ASSERT_EQ(nstreams, batch->getNumStreams());
+        ASSERT_EQ((size_t)nstreams, fgmasks.size());
+        for (int i = 0; i < nstreams; i++)
+        {
+            single[i]->apply(frames[i], expected, learningRate);
+            ASSERT_EQ(CV_8UC1, fgmasks[i].type());
+            ASSERT_EQ(0, cvtest::norm(expected, fgmasks[i], NORM_INF)) << "stream " << i << ", frame " << t;
+        }
+    }
+
+    std::vector<Mat> backgroundImages;
+    batch->getBackgroundImages(backgroundImages);
+    ASSERT_EQ((size_t)nstreams, backgroundImages.size());
+    for (int i = 0; i < nstreams; i++)
+    {
+        single[i]->getBackgroundImage(expected);
+        EXPECT_EQ(0, cvtest::norm(expected, backgroundImages[i], NORM_INF)) << "stream " << i;
+    }
+}
+
+TEST(BackgroundSubtractor_CNTBatch, sameAsSingleStream)
+{
+    testCNTBatch(false, -1);
+}
+
+TEST(BackgroundSubtractor_CNTBatch, sameAsSingleStreamWithHistory)
+{
+    testCNTBatch(true, -1);
+    testCNTBatch(true, 0.5);
+}
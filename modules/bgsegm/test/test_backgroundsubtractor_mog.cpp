@@ -0,0 +1,48 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+using namespace cv;
+using namespace cv::bgsegm;
+
+static void testMOGStaticScene(int type)
+{
+    RNG rng(12345);
+    Mat background(61, 67, type); // odd width to cover the scalar tails
+    rng.fill(background, RNG::UNIFORM, 40, 100);
+
+    Ptr<BackgroundSubtractorMOG> mog = createBackgroundSubtractorMOG();
+    Mat frame, noise(background.size(), type), fgmask;
+    for (int i = 0; i < 40; i++)
+    {
+        rng.fill(noise, RNG::UNIFORM, 0, 4);
+        add(background, noise, frame);
+        mog->apply(frame, fgmask);
+    }
+    ASSERT_EQ(CV_8UC1, fgmask.type());
+    EXPECT_EQ(0, countNonZero(fgmask));
+
+    // an object far from the background colors is detected
+    const Rect object(20, 10, 23, 17);
+    frame(object).setTo(Scalar::all(220));
+    mog->apply(frame, fgmask);
+    EXPECT_EQ(object.area(), countNonZero(fgmask(object)));
+    EXPECT_EQ(object.area(), countNonZero(fgmask));
+
+    // the classification without learning agrees
+    Mat fgmask0;
+    mog->apply(frame, fgmask0, 0);
+    EXPECT_EQ(object.area(), countNonZero(fgmask0(object)));
+}
+
+TEST(BackgroundSubtractor_MOG, staticSceneGray)
+{
+    testMOGStaticScene(CV_8UC1);
+}
+
+TEST(BackgroundSubtractor_MOG, staticSceneColor)
+{
+    testMOGStaticScene(CV_8UC3);
+}
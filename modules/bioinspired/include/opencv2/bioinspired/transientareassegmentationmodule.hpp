@@ -195,6 +195,14 @@ public:
  */
 CV_EXPORTS_W Ptr<TransientAreasSegmentationModule> createTransientAreasSegmentationModule(Size inputSize);
 
+/** @brief runs the segmentation of several streams in parallel, one frame per stream
+@param modules : the segmentation modules of the streams
+@param inputsToSegment : the images to process, the i-th one is given to the run method of the i-th module
+@param channelIndex : the channel to process in case of multichannel images
+@relates bioinspired::TransientAreasSegmentationModule
+ */
+CV_EXPORTS void runTransientAreasSegmentationBatch(const std::vector<Ptr<TransientAreasSegmentationModule> > &modules, InputArrayOfArrays inputsToSegment, const int channelIndex=0);
+
 //! @}
 
 }} // namespaces end : cv and bioinspired
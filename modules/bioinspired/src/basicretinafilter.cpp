@@ -67,6 +67,7 @@
 #include <iostream>
 #include <cstdlib>
 #include "basicretinafilter.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <cmath>
 
 
@@ -445,146 +446,281 @@ float BasicRetinaFilter::_squaringSpatiotemporalLPfilter(const float *inputFrame
 }
 
 /////////////////////////////////////////////////
-// standard version of the 1D low pass filters
+// 1D low pass filter kernels
 
-//  horizontal causal filter which adds the input inside
-void BasicRetinaFilter::_horizontalCausalFilter(float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
+void horizontalCausalFilterRows(const float *inputFrame, float *outputFrame, int rowStart, int rowEnd, int nbColumns, float a, float tau, bool squareInput)
 {
-
-
-    //#pragma omp parallel for
-    for (unsigned int IDrow=IDrowStart; IDrow<IDrowEnd; ++IDrow)
+    int IDrow=rowStart;
+#if CV_SIMD128
+    // 4 rows at once, one per lane : the 4x4 blocks are transposed so that a vector holds a column of the 4 rows
+    const v_float32x4 v_a=v_setall_f32(a), v_tau=v_setall_f32(tau);
+    for (; IDrow<=rowEnd-4; IDrow+=4)
     {
-        register float* outputPTR=outputFrame+(IDrowStart+IDrow)*_filterOutput.getNBcolumns();
-        register float result=0;
-        for (unsigned int index=0; index<_filterOutput.getNBcolumns(); ++index)
+        float* outputPTR=outputFrame+IDrow*nbColumns;
+        const float* inputPTR=inputFrame ? inputFrame+IDrow*nbColumns : 0;
+        v_float32x4 result=v_setzero_f32();
+        int index=0;
+        for (; index<=nbColumns-4; index+=4)
         {
-            result = *(outputPTR)+  _a* result;
-            *(outputPTR++) = result;
+            v_float32x4 c[4], t[4];
+            v_transpose4x4(v_load(outputPTR+index), v_load(outputPTR+nbColumns+index),
+                           v_load(outputPTR+2*nbColumns+index), v_load(outputPTR+3*nbColumns+index), t[0], t[1], t[2], t[3]);
+            if (inputPTR)
+            {
+                v_float32x4 in[4];
+                v_transpose4x4(v_load(inputPTR+index), v_load(inputPTR+nbColumns+index),
+                               v_load(inputPTR+2*nbColumns+index), v_load(inputPTR+3*nbColumns+index), in[0], in[1], in[2], in[3]);
+                if (squareInput)
+                {
+                    for (int k=0; k<4; ++k)
+                        t[k] = result = in[k]*in[k] + v_tau*t[k] + v_a*result;
+                }
+                else
+                {
+                    for (int k=0; k<4; ++k)
+                        t[k] = result = in[k] + v_tau*t[k] + v_a*result;
+                }
+            }
+            else
+            {
+                for (int k=0; k<4; ++k)
+                    t[k] = result = t[k] + v_a*result;
+            }
+            v_transpose4x4(t[0], t[1], t[2], t[3], c[0], c[1], c[2], c[3]);
+            for (int k=0; k<4; ++k)
+                v_store(outputPTR+k*nbColumns+index, c[k]);
+        }
+        float results[4];
+        v_store(results, result);
+        for (int k=0; k<4; ++k)
+        {
+            float* outputRow=outputPTR+k*nbColumns;
+            const float* inputRow=inputPTR ? inputPTR+k*nbColumns : 0;
+            for (int i=index; i<nbColumns; ++i)
+            {
+                if (!inputRow)
+                    results[k] = outputRow[i] + a*results[k];
+                else if (squareInput)
+                    results[k] = inputRow[i]*inputRow[i] + tau*outputRow[i] + a*results[k];
+                else
+                    results[k] = inputRow[i] + tau*outputRow[i] + a*results[k];
+                outputRow[i] = results[k];
+            }
+        }
+    }
+#endif
+    for (; IDrow<rowEnd; ++IDrow)
+    {
+        float* outputPTR=outputFrame+IDrow*nbColumns;
+        float result=0;
+        if (inputFrame && squareInput)
+        {
+            const float* inputPTR=inputFrame+IDrow*nbColumns;
+            for (int index=0; index<nbColumns; ++index)
+            {
+                result = *(inputPTR)**(inputPTR) + tau**(outputPTR)+  a* result;
+                *(outputPTR++) = result;
+                ++inputPTR;
+            }
+        }
+        else if (inputFrame)
+        {
+            const float* inputPTR=inputFrame+IDrow*nbColumns;
+            for (int index=0; index<nbColumns; ++index)
+            {
+                result = *(inputPTR++) + tau**(outputPTR)+  a* result;
+                *(outputPTR++) = result;
+            }
+        }
+        else
+        {
+            for (int index=0; index<nbColumns; ++index)
+            {
+                result = *(outputPTR)+  a* result;
+                *(outputPTR++) = result;
+            }
         }
     }
 }
-//  horizontal causal filter which adds the input inside
-void BasicRetinaFilter::_horizontalCausalFilter_addInput(const float *inputFrame, float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
+
+void horizontalAnticausalFilterRows(float *outputFrame, int rowStart, int rowEnd, int nbColumns, float a, float gain)
 {
-#ifdef MAKE_PARALLEL
-        cv::parallel_for_(cv::Range(IDrowStart,IDrowEnd), Parallel_horizontalCausalFilter_addInput(inputFrame, outputFrame, IDrowStart, _filterOutput.getNBcolumns(), _a, _tau));
-#else
-    for (unsigned int IDrow=IDrowStart; IDrow<IDrowEnd; ++IDrow)
+    int IDrow=rowStart;
+#if CV_SIMD128
+    const v_float32x4 v_a=v_setall_f32(a), v_gain=v_setall_f32(gain);
+    for (; IDrow<=rowEnd-4; IDrow+=4)
     {
-        register float* outputPTR=outputFrame+(IDrowStart+IDrow)*_filterOutput.getNBcolumns();
-        register const float* inputPTR=inputFrame+(IDrowStart+IDrow)*_filterOutput.getNBcolumns();
-        register float result=0;
-        for (unsigned int index=0; index<_filterOutput.getNBcolumns(); ++index)
+        float* outputPTR=outputFrame+IDrow*nbColumns;
+        v_float32x4 result=v_setzero_f32();
+        int index=nbColumns-4;
+        for (; index>=0; index-=4)
         {
-            result = *(inputPTR++) + _tau**(outputPTR)+  _a* result;
-            *(outputPTR++) = result;
+            v_float32x4 c[4], t[4];
+            v_transpose4x4(v_load(outputPTR+index), v_load(outputPTR+nbColumns+index),
+                           v_load(outputPTR+2*nbColumns+index), v_load(outputPTR+3*nbColumns+index), t[0], t[1], t[2], t[3]);
+            for (int k=3; k>=0; --k)
+            {
+                result = t[k] + v_a*result;
+                t[k] = v_gain*result;
+            }
+            v_transpose4x4(t[0], t[1], t[2], t[3], c[0], c[1], c[2], c[3]);
+            for (int k=0; k<4; ++k)
+                v_store(outputPTR+k*nbColumns+index, c[k]);
+        }
+        float results[4];
+        v_store(results, result);
+        for (int k=0; k<4; ++k)
+        {
+            float* outputRow=outputPTR+k*nbColumns;
+            for (int i=index+3; i>=0; --i)
+            {
+                results[k] = outputRow[i] + a*results[k];
+                outputRow[i] = gain*results[k];
+            }
         }
     }
 #endif
+    for (; IDrow<rowEnd; ++IDrow)
+    {
+        float* outputPTR=outputFrame+(IDrow+1)*nbColumns-1;
+        float result=0;
+        for (int index=0; index<nbColumns; ++index)
+        {
+            result = *(outputPTR)+  a* result;
+            *(outputPTR--) = gain*result;
+        }
+    }
 }
 
-//  horizontal anticausal filter  (basic way, no add on)
-void BasicRetinaFilter::_horizontalAnticausalFilter(float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
+void verticalCausalFilterColumns(float *outputFrame, int columnStart, int columnEnd, int nbRows, int nbColumns, float a)
 {
+    // the results of the columns are kept in a row buffer and the rows are swept in memory order
+    AutoBuffer<float> _results(columnEnd-columnStart);
+    float* results=_results;
+    for (int i=0; i<columnEnd-columnStart; ++i)
+        results[i]=0;
 
-#ifdef MAKE_PARALLEL
-        cv::parallel_for_(cv::Range(IDrowStart,IDrowEnd), Parallel_horizontalAnticausalFilter(outputFrame, IDrowEnd, _filterOutput.getNBcolumns(), _a ));
-#else
-    for (unsigned int IDrow=IDrowStart; IDrow<IDrowEnd; ++IDrow)
+    for (int index=0; index<nbRows; ++index)
     {
-        register float* outputPTR=outputFrame+(IDrowEnd-IDrow)*(_filterOutput.getNBcolumns())-1;
-        register float result=0;
-        for (unsigned int index=0; index<_filterOutput.getNBcolumns(); ++index)
+        float* outputPTR=outputFrame+index*nbColumns+columnStart;
+        int IDcolumn=0;
+#if CV_SIMD128
+        const v_float32x4 v_a=v_setall_f32(a);
+        for (; IDcolumn<=columnEnd-columnStart-4; IDcolumn+=4)
         {
-            result = *(outputPTR)+  _a* result;
-            *(outputPTR--) = result;
+            v_float32x4 result=v_load(outputPTR+IDcolumn) + v_a*v_load(results+IDcolumn);
+            v_store(outputPTR+IDcolumn, result);
+            v_store(results+IDcolumn, result);
         }
-    }
 #endif
+        for (; IDcolumn<columnEnd-columnStart; ++IDcolumn)
+            outputPTR[IDcolumn] = results[IDcolumn] = outputPTR[IDcolumn] + a * results[IDcolumn];
+    }
 }
 
-//  horizontal anticausal filter which multiplies the output by _gain
-void BasicRetinaFilter::_horizontalAnticausalFilter_multGain(float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
+void verticalAnticausalFilterColumns(float *outputFrame, int columnStart, int columnEnd, int nbRows, int nbColumns, float a, float gain)
 {
+    AutoBuffer<float> _results(columnEnd-columnStart);
+    float* results=_results;
+    for (int i=0; i<columnEnd-columnStart; ++i)
+        results[i]=0;
 
-    //#pragma omp parallel for
-    for (unsigned int IDrow=IDrowStart; IDrow<IDrowEnd; ++IDrow)
+    for (int index=nbRows-1; index>=0; --index)
     {
-        register float* outputPTR=outputFrame+(IDrowEnd-IDrow)*(_filterOutput.getNBcolumns())-1;
-        register float result=0;
-        for (unsigned int index=0; index<_filterOutput.getNBcolumns(); ++index)
+        float* outputPTR=outputFrame+index*nbColumns+columnStart;
+        int IDcolumn=0;
+#if CV_SIMD128
+        const v_float32x4 v_a=v_setall_f32(a), v_gain=v_setall_f32(gain);
+        for (; IDcolumn<=columnEnd-columnStart-4; IDcolumn+=4)
+        {
+            v_float32x4 result=v_load(outputPTR+IDcolumn) + v_a*v_load(results+IDcolumn);
+            v_store(outputPTR+IDcolumn, v_gain*result);
+            v_store(results+IDcolumn, result);
+        }
+#endif
+        for (; IDcolumn<columnEnd-columnStart; ++IDcolumn)
         {
-            result = *(outputPTR)+  _a* result;
-            *(outputPTR--) = _gain*result;
+            results[IDcolumn] = outputPTR[IDcolumn] + a * results[IDcolumn];
+            outputPTR[IDcolumn] = gain*results[IDcolumn];
         }
     }
 }
 
-//  vertical anticausal filter
-void BasicRetinaFilter::_verticalCausalFilter(float *outputFrame, unsigned int IDcolumnStart, unsigned int IDcolumnEnd)
+// the rows are given to the threads by groups of 8 and the columns by blocks of 64 so that the kernels work on whole vectors
+static inline double rowStripes(unsigned int nbRows) { return std::max(1., nbRows/8.); }
+static inline double columnStripes(unsigned int nbColumns) { return std::max(1., nbColumns/64.); }
+
+/////////////////////////////////////////////////
+// standard version of the 1D low pass filters
+
+//  horizontal causal filter which adds the input inside
+void BasicRetinaFilter::_horizontalCausalFilter(float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
 {
 #ifdef MAKE_PARALLEL
-        cv::parallel_for_(cv::Range(IDcolumnStart,IDcolumnEnd), Parallel_verticalCausalFilter(outputFrame, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a ));
+        cv::parallel_for_(cv::Range(IDrowStart,IDrowEnd), Parallel_horizontalCausalFilter_addInput(NULL, outputFrame, IDrowStart, _filterOutput.getNBcolumns(), _a, _tau), rowStripes(IDrowEnd-IDrowStart));
 #else
-        for (unsigned int IDcolumn=IDcolumnStart; IDcolumn<IDcolumnEnd; ++IDcolumn)
-    {
-        register float result=0;
-        register float *outputPTR=outputFrame+IDcolumn;
+    horizontalCausalFilterRows(NULL, outputFrame, 2*IDrowStart, IDrowStart+IDrowEnd, _filterOutput.getNBcolumns(), _a, _tau);
+#endif
+}
+//  horizontal causal filter which adds the input inside
+void BasicRetinaFilter::_horizontalCausalFilter_addInput(const float *inputFrame, float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
+{
+#ifdef MAKE_PARALLEL
+        cv::parallel_for_(cv::Range(IDrowStart,IDrowEnd), Parallel_horizontalCausalFilter_addInput(inputFrame, outputFrame, IDrowStart, _filterOutput.getNBcolumns(), _a, _tau), rowStripes(IDrowEnd-IDrowStart));
+#else
+    horizontalCausalFilterRows(inputFrame, outputFrame, 2*IDrowStart, IDrowStart+IDrowEnd, _filterOutput.getNBcolumns(), _a, _tau);
+#endif
+}
 
-        for (unsigned int index=0; index<_filterOutput.getNBrows(); ++index)
-        {
-            result = *(outputPTR) + _a * result;
-            *(outputPTR) = result;
-            outputPTR+=_filterOutput.getNBcolumns();
+//  horizontal anticausal filter  (basic way, no add on)
+void BasicRetinaFilter::_horizontalAnticausalFilter(float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
+{
 
-        }
-    }
+#ifdef MAKE_PARALLEL
+        cv::parallel_for_(cv::Range(IDrowStart,IDrowEnd), Parallel_horizontalAnticausalFilter(outputFrame, IDrowEnd, _filterOutput.getNBcolumns(), _a ), rowStripes(IDrowEnd-IDrowStart));
+#else
+    horizontalAnticausalFilterRows(outputFrame, 0, IDrowEnd-IDrowStart, _filterOutput.getNBcolumns(), _a, 1.f);
 #endif
 }
 
+//  horizontal anticausal filter which multiplies the output by _gain
+void BasicRetinaFilter::_horizontalAnticausalFilter_multGain(float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
+{
+#ifdef MAKE_PARALLEL
+        cv::parallel_for_(cv::Range(IDrowStart,IDrowEnd), Parallel_horizontalAnticausalFilter(outputFrame, IDrowEnd, _filterOutput.getNBcolumns(), _a, _gain ), rowStripes(IDrowEnd-IDrowStart));
+#else
+    horizontalAnticausalFilterRows(outputFrame, 0, IDrowEnd-IDrowStart, _filterOutput.getNBcolumns(), _a, _gain);
+#endif
+}
 
-//  vertical anticausal filter (basic way, no add on)
-void BasicRetinaFilter::_verticalAnticausalFilter(float *outputFrame, unsigned int IDcolumnStart, unsigned int IDcolumnEnd)
+//  vertical anticausal filter
+void BasicRetinaFilter::_verticalCausalFilter(float *outputFrame, unsigned int IDcolumnStart, unsigned int IDcolumnEnd)
 {
-    float* offset=outputFrame+_filterOutput.getNBpixels()-_filterOutput.getNBcolumns();
-    //#pragma omp parallel for
-    for (unsigned int IDcolumn=IDcolumnStart; IDcolumn<IDcolumnEnd; ++IDcolumn)
-    {
-        register float result=0;
-        register float *outputPTR=offset+IDcolumn;
+#ifdef MAKE_PARALLEL
+        cv::parallel_for_(cv::Range(IDcolumnStart,IDcolumnEnd), Parallel_verticalCausalFilter(outputFrame, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a ), columnStripes(IDcolumnEnd-IDcolumnStart));
+#else
+    verticalCausalFilterColumns(outputFrame, IDcolumnStart, IDcolumnEnd, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a);
+#endif
+}
 
-        for (unsigned int index=0; index<_filterOutput.getNBrows(); ++index)
-        {
-            result = *(outputPTR) + _a * result;
-            *(outputPTR) = result;
-            outputPTR-=_filterOutput.getNBcolumns();
 
-        }
-    }
+//  vertical anticausal filter (basic way, no add on)
+void BasicRetinaFilter::_verticalAnticausalFilter(float *outputFrame, unsigned int IDcolumnStart, unsigned int IDcolumnEnd)
+{
+#ifdef MAKE_PARALLEL
+        cv::parallel_for_(cv::Range(IDcolumnStart,IDcolumnEnd), Parallel_verticalAnticausalFilter_multGain(outputFrame, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a, 1.f ), columnStripes(IDcolumnEnd-IDcolumnStart));
+#else
+    verticalAnticausalFilterColumns(outputFrame, IDcolumnStart, IDcolumnEnd, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a, 1.f);
+#endif
 }
 
 //  vertical anticausal filter which multiplies the output by _gain
 void BasicRetinaFilter::_verticalAnticausalFilter_multGain(float *outputFrame, unsigned int IDcolumnStart, unsigned int IDcolumnEnd)
 {
 #ifdef MAKE_PARALLEL
-        cv::parallel_for_(cv::Range(IDcolumnStart,IDcolumnEnd), Parallel_verticalAnticausalFilter_multGain(outputFrame, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a, _gain ));
+        cv::parallel_for_(cv::Range(IDcolumnStart,IDcolumnEnd), Parallel_verticalAnticausalFilter_multGain(outputFrame, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a, _gain ), columnStripes(IDcolumnEnd-IDcolumnStart));
 #else
-        float* offset=outputFrame+_filterOutput.getNBpixels()-_filterOutput.getNBcolumns();
-    //#pragma omp parallel for
-    for (unsigned int IDcolumn=IDcolumnStart; IDcolumn<IDcolumnEnd; ++IDcolumn)
-    {
-        register float result=0;
-        register float *outputPTR=offset+IDcolumn;
-
-        for (unsigned int index=0; index<_filterOutput.getNBrows(); ++index)
-        {
-            result = *(outputPTR) + _a * result;
-            *(outputPTR) = _gain*result;
-            outputPTR-=_filterOutput.getNBcolumns();
-
-        }
-    }
+    verticalAnticausalFilterColumns(outputFrame, IDcolumnStart, IDcolumnEnd, _filterOutput.getNBrows(), _filterOutput.getNBcolumns(), _a, _gain);
 #endif
 }
 
@@ -594,41 +730,21 @@ void BasicRetinaFilter::_verticalAnticausalFilter_multGain(float *outputFrame, u
 // -> squaring horizontal causal filter
 void BasicRetinaFilter::_squaringHorizontalCausalFilter(const float *inputFrame, float *outputFrame, unsigned int IDrowStart, unsigned int IDrowEnd)
 {
-    register float* outputPTR=outputFrame+IDrowStart*_filterOutput.getNBcolumns();
-    register const float* inputPTR=inputFrame+IDrowStart*_filterOutput.getNBcolumns();
-    for (unsigned int IDrow=IDrowStart; IDrow<IDrowEnd; ++IDrow)
-    {
-        register float result=0;
-        for (unsigned int index=0; index<_filterOutput.getNBcolumns(); ++index)
-        {
-            result = *(inputPTR)**(inputPTR) + _tau**(outputPTR)+  _a* result;
-            *(outputPTR++) = result;
-            ++inputPTR;
-        }
-    }
+#ifdef MAKE_PARALLEL
+        cv::parallel_for_(cv::Range(IDrowStart,IDrowEnd), Parallel_horizontalCausalFilter_addInput(inputFrame, outputFrame, 0, _filterOutput.getNBcolumns(), _a, _tau, true), rowStripes(IDrowEnd-IDrowStart));
+#else
+    horizontalCausalFilterRows(inputFrame, outputFrame, IDrowStart, IDrowEnd, _filterOutput.getNBcolumns(), _a, _tau, true);
+#endif
 }
 
 //  vertical anticausal filter that returns the mean value of its result
 float BasicRetinaFilter::_verticalAnticausalFilter_returnMeanValue(float *outputFrame, unsigned int IDcolumnStart, unsigned int IDcolumnEnd)
 {
-    register float meanValue=0;
-    float* offset=outputFrame+_filterOutput.getNBpixels()-_filterOutput.getNBcolumns();
-    for (unsigned int IDcolumn=IDcolumnStart; IDcolumn<IDcolumnEnd; ++IDcolumn)
-    {
-        register float result=0;
-        register float *outputPTR=offset+IDcolumn;
-
-        for (unsigned int index=0; index<_filterOutput.getNBrows(); ++index)
-        {
-            result = *(outputPTR) + _a * result;
-            *(outputPTR) = _gain*result;
-            meanValue+=*(outputPTR);
-            outputPTR-=_filterOutput.getNBcolumns();
-
-        }
-    }
+    _verticalAnticausalFilter_multGain(outputFrame, IDcolumnStart, IDcolumnEnd);
 
-    return meanValue/(float)_filterOutput.getNBpixels();
+    // summed with a double accumulator after the parallel filtering
+    const Mat output(_filterOutput.getNBrows(), _filterOutput.getNBcolumns(), CV_32F, outputFrame);
+    return (float)(cv::sum(output.colRange(IDcolumnStart, IDcolumnEnd))[0]/(double)_filterOutput.getNBpixels());
 }
 
 // LP filter with integration in specific areas (regarding true values of a binary parameters image)
@@ -116,6 +116,18 @@ namespace cv
 {
 namespace bioinspired
 {
+    /**
+    * 1D recursive low pass filters shared by the parallel functors, they process blocks of rows or columns in place:
+    * result = input + tau*output + a*result for the causal filters (result = output + a*result if input is NULL,
+    * the input is squared if squareInput is set)
+    * and output = gain*result for the anticausal ones, where result = output + a*result.
+    * The rows are filtered 4 at once by transposing 4x4 blocks and the columns by sweeping the rows of the block.
+    */
+    void horizontalCausalFilterRows(const float *inputFrame, float *outputFrame, int rowStart, int rowEnd, int nbColumns, float a, float tau, bool squareInput=false);
+    void horizontalAnticausalFilterRows(float *outputFrame, int rowStart, int rowEnd, int nbColumns, float a, float gain);
+    void verticalCausalFilterColumns(float *outputFrame, int columnStart, int columnEnd, int nbRows, int nbColumns, float a);
+    void verticalAnticausalFilterColumns(float *outputFrame, int columnStart, int columnEnd, int nbRows, int nbColumns, float a, float gain);
+
     class BasicRetinaFilter
     {
     public:
@@ -472,11 +484,11 @@ namespace bioinspired
         private:
             float *outputFrame;
             unsigned int IDrowEnd, nbColumns;
-            float filterParam_a;
+            float filterParam_a, filterParam_gain;
         public:
             // constructor which takes the input image pointer reference reference and limits
-            Parallel_horizontalAnticausalFilter(float *bufferToProcess, const unsigned int idEnd, const unsigned int nbCols, const float a )
-                :outputFrame(bufferToProcess), IDrowEnd(idEnd), nbColumns(nbCols), filterParam_a(a)
+            Parallel_horizontalAnticausalFilter(float *bufferToProcess, const unsigned int idEnd, const unsigned int nbCols, const float a, const float gain=1.f )
+                :outputFrame(bufferToProcess), IDrowEnd(idEnd), nbColumns(nbCols), filterParam_a(a), filterParam_gain(gain)
             {
 #ifdef DEBUG_TBB
                 std::cout<<"Parallel_horizontalAnticausalFilter::Parallel_horizontalAnticausalFilter :"
@@ -496,16 +508,8 @@ namespace bioinspired
                     //<<"\n\t last index="<<filterParam
                     <<std::endl;
 #endif
-                for (int IDrow=r.start; IDrow!=r.end; ++IDrow)
-                {
-                    register float* outputPTR=outputFrame+(IDrowEnd-IDrow)*(nbColumns)-1;
-                    register float result=0;
-                    for (unsigned int index=0; index<nbColumns; ++index)
-                    {
-                        result = *(outputPTR)+  filterParam_a* result;
-                        *(outputPTR--) = result;
-                    }
-                }
+                // the row of index IDrow is the row IDrowEnd-1-IDrow
+                horizontalAnticausalFilterRows(outputFrame, (int)IDrowEnd-r.end, (int)IDrowEnd-r.start, nbColumns, filterParam_a, filterParam_gain);
             }
         };
 
@@ -516,22 +520,13 @@ namespace bioinspired
             float *outputFrame;
             unsigned int IDrowStart, nbColumns;
             float filterParam_a, filterParam_tau;
+            bool squareInput;
         public:
-            Parallel_horizontalCausalFilter_addInput(const float *bufferToAddAsInputProcess, float *bufferToProcess, const unsigned int idStart, const unsigned int nbCols,  const float a,  const float tau)
-                :inputFrame(bufferToAddAsInputProcess), outputFrame(bufferToProcess), IDrowStart(idStart), nbColumns(nbCols), filterParam_a(a), filterParam_tau(tau){}
+            Parallel_horizontalCausalFilter_addInput(const float *bufferToAddAsInputProcess, float *bufferToProcess, const unsigned int idStart, const unsigned int nbCols,  const float a,  const float tau, const bool square=false)
+                :inputFrame(bufferToAddAsInputProcess), outputFrame(bufferToProcess), IDrowStart(idStart), nbColumns(nbCols), filterParam_a(a), filterParam_tau(tau), squareInput(square){}
 
             virtual void operator()( const Range& r ) const {
-                for (int IDrow=r.start; IDrow!=r.end; ++IDrow)
-                {
-                    register float* outputPTR=outputFrame+(IDrowStart+IDrow)*nbColumns;
-                    register const float* inputPTR=inputFrame+(IDrowStart+IDrow)*nbColumns;
-                    register float result=0;
-                    for (unsigned int index=0; index<nbColumns; ++index)
-                    {
-                        result = *(inputPTR++) + filterParam_tau**(outputPTR)+  filterParam_a* result;
-                        *(outputPTR++) = result;
-                    }
-                }
+                horizontalCausalFilterRows(inputFrame, outputFrame, IDrowStart+r.start, IDrowStart+r.end, nbColumns, filterParam_a, filterParam_tau, squareInput);
             }
         };
 
@@ -546,19 +541,7 @@ namespace bioinspired
                 :outputFrame(bufferToProcess), nbRows(nbRws), nbColumns(nbCols), filterParam_a(a){}
 
             virtual void operator()( const Range& r ) const {
-                for (int IDcolumn=r.start; IDcolumn!=r.end; ++IDcolumn)
-                {
-                    register float result=0;
-                    register float *outputPTR=outputFrame+IDcolumn;
-
-                    for (unsigned int index=0; index<nbRows; ++index)
-                    {
-                        result = *(outputPTR) + filterParam_a * result;
-                        *(outputPTR) = result;
-                        outputPTR+=nbColumns;
-
-                    }
-                }
+                verticalCausalFilterColumns(outputFrame, r.start, r.end, nbRows, nbColumns, filterParam_a);
             }
         };
 
@@ -573,20 +556,7 @@ namespace bioinspired
                 :outputFrame(bufferToProcess), nbRows(nbRws), nbColumns(nbCols), filterParam_a(a), filterParam_gain(gain){}
 
             virtual void operator()( const Range& r ) const {
-                float* offset=outputFrame+nbColumns*nbRows-nbColumns;
-                for (int IDcolumn=r.start; IDcolumn!=r.end; ++IDcolumn)
-                {
-                    register float result=0;
-                    register float *outputPTR=offset+IDcolumn;
-
-                    for (unsigned int index=0; index<nbRows; ++index)
-                    {
-                        result = *(outputPTR) + filterParam_a * result;
-                        *(outputPTR) = filterParam_gain*result;
-                        outputPTR-=nbColumns;
-
-                    }
-                }
+                verticalAnticausalFilterColumns(outputFrame, r.start, r.end, nbRows, nbColumns, filterParam_a, filterParam_gain);
             }
         };
 
@@ -610,7 +610,8 @@ bool RetinaImpl::ocl_getParvo(OutputArray retinaOutput_parvo)
 
 void RetinaImpl::getParvo(OutputArray retinaOutput_parvo)
 {
-    CV_OCL_RUN((_ocl_retina != 0) && retinaOutput_parvo.isUMat(), ocl_getParvo(retinaOutput_parvo));
+    // the frames of the OpenCL retina are read back from it, whatever the output kind
+    CV_OCL_RUN((_ocl_retina != 0), ocl_getParvo(retinaOutput_parvo));
 
     if (_retinaFilter->getColorMode())
     {
@@ -634,7 +635,7 @@ bool RetinaImpl::ocl_getMagno(OutputArray retinaOutput_magno)
 
 void RetinaImpl::getMagno(OutputArray retinaOutput_magno)
 {
-    CV_OCL_RUN((_ocl_retina != 0) && retinaOutput_magno.isUMat(), ocl_getMagno(retinaOutput_magno));
+    CV_OCL_RUN((_ocl_retina != 0), ocl_getMagno(retinaOutput_magno));
 
     // reallocate output buffer (if necessary)
     _convertValarrayBuffer2cvMat(_retinaFilter->getMovingContours(), _retinaFilter->getOutputNBrows(), _retinaFilter->getOutputNBcolumns(), false, retinaOutput_magno);
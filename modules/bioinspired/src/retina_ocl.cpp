@@ -329,7 +329,9 @@ void RetinaOCLImpl::run(InputArray input)
 
 void RetinaOCLImpl::getParvo(OutputArray output)
 {
-    UMat &retinaOutput_parvo = output.getUMatRef();
+    // the result stays on the device for UMat outputs, other outputs receive a copy
+    UMat tmp;
+    UMat &retinaOutput_parvo = output.isUMat() ? output.getUMatRef() : tmp;
     if (_retinaFilter->getColorMode())
     {
         // reallocate output buffer (if necessary)
@@ -340,13 +342,18 @@ void RetinaOCLImpl::getParvo(OutputArray output)
         // reallocate output buffer (if necessary)
         convertToInterleaved(_retinaFilter->getContours(), false, retinaOutput_parvo);
     }
+    if (!output.isUMat())
+        tmp.copyTo(output);
     //retinaOutput_parvo/=255.0;
 }
 void RetinaOCLImpl::getMagno(OutputArray output)
 {
-    UMat &retinaOutput_magno = output.getUMatRef();
+    UMat tmp;
+    UMat &retinaOutput_magno = output.isUMat() ? output.getUMatRef() : tmp;
     // reallocate output buffer (if necessary)
     convertToInterleaved(_retinaFilter->getMovingContours(), false, retinaOutput_magno);
+    if (!output.isUMat())
+        tmp.copyTo(output);
     //retinaOutput_magno/=255.0;
 }
 // private method called by constructors
@@ -374,7 +381,13 @@ void RetinaOCLImpl::_init(const cv::Size inputSz, const bool colorMode, int colo
 
 bool RetinaOCLImpl::convertToColorPlanes(const UMat& input, UMat &output)
 {
-    UMat convert_input;
+    if(input.channels() == 1)
+    {
+        // the pipeline works on device side only, the conversion is the only copy of the input
+        input.convertTo(output, CV_32F);
+        return false;
+    }
+    UMat &convert_input = _inputConvertBuffer;
     input.convertTo(convert_input, CV_32F);
     if(convert_input.channels() == 3 || convert_input.channels() == 4)
     {
@@ -390,11 +403,6 @@ bool RetinaOCLImpl::convertToColorPlanes(const UMat& input, UMat &output)
         cv::split(convert_input, channel_splits);
         return true;
     }
-    else if(convert_input.channels() == 1)
-    {
-        convert_input.copyTo(output);
-        return false;
-    }
     else
     {
         CV_Error(-1, "Retina ocl only support 1, 3, 4 channel input");
@@ -403,21 +411,23 @@ bool RetinaOCLImpl::convertToColorPlanes(const UMat& input, UMat &output)
 }
 void RetinaOCLImpl::convertToInterleaved(const UMat& input, bool colorMode, UMat &output)
 {
-    input.convertTo(output, CV_8U);
     if(colorMode)
     {
+        // the planes are converted in a persistent buffer, then merged in the output
+        UMat &planes = _outputConvertBuffer;
+        input.convertTo(planes, CV_8U);
         int numOfSplits = input.rows / getInputSize().height;
         std::vector<UMat> channel_splits(numOfSplits);
         for(int i = 0; i < static_cast<int>(channel_splits.size()); i ++)
         {
             channel_splits[i] =
-                output(Rect(Point(0, _retinaFilter->getInputNBrows() * (numOfSplits - i - 1)), getInputSize()));
+                planes(Rect(Point(0, _retinaFilter->getInputNBrows() * (numOfSplits - i - 1)), getInputSize()));
         }
         merge(channel_splits, output);
     }
     else
     {
-        //...
+        input.convertTo(output, CV_8U);
     }
 }
 
@@ -721,7 +731,8 @@ void normalizeGrayOutputNearZeroCentreredSigmoide(UMat &inputPicture, UMat &outp
 void centerReductImageLuminance(UMat &inputoutput)
 {
     Scalar mean, stddev;
-    cv::meanStdDev(inputoutput.getMat(ACCESS_READ), mean, stddev);
+    // computed on the device, only the two values are read back
+    cv::meanStdDev(inputoutput, mean, stddev);
 
     Context ctx = Context::getDefault();
     size_t globalSize[] = {(size_t)inputoutput.cols / 4, (size_t)inputoutput.rows};
@@ -1210,13 +1221,12 @@ void RetinaColor::runColorDemultiplexing(
         multiply(_demultiplexedTempBuffer, _colorLocalDensity, _demultiplexedColorFrame);
 
         std::vector<UMat> m;
-        UMat _luminance_concat;
 
         m.push_back(_luminance);
         m.push_back(_luminance);
         m.push_back(_luminance);
-        vconcat(m, _luminance_concat);
-        add(_demultiplexedColorFrame, _luminance_concat, _demultiplexedColorFrame);
+        vconcat(m, _luminanceConcat);
+        add(_demultiplexedColorFrame, _luminanceConcat, _demultiplexedColorFrame);
     }
     // eliminate saturated colors by simple clipping values to the input range
     clipRGBOutput_0_maxInputValue(_demultiplexedColorFrame, maxInputValue);
@@ -382,6 +382,7 @@ protected:
     UMat _chrominance;
     UMat _colorLocalDensity;
     UMat _imageGradient;
+    UMat _luminanceConcat;
 
     float _pR, _pG, _pB;
     bool _objectInit;
@@ -669,6 +670,9 @@ public:
 protected:
     RetinaParameters _retinaParameters;
     UMat _inputBuffer;
+    // persistent conversion buffers, the frames stay on the device from run to getParvo/getMagno
+    UMat _inputConvertBuffer;
+    UMat _outputConvertBuffer;
     RetinaFilter* _retinaFilter;
     bool convertToColorPlanes(const UMat& input, UMat &output);
     void convertToInterleaved(const UMat& input, bool colorMode, UMat &output);
@@ -76,6 +76,7 @@
 
 #include "precomp.hpp"
 #include "basicretinafilter.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include <sstream>
 
@@ -86,6 +87,42 @@ namespace cv
 namespace bioinspired
 {
 
+/* The segmentation of the pixels of a range when only the local maximums are detected:
+ * the neighborhood energy larger than the context one by thresholdON and the local energy larger than the neighborhood one by thresholdON
+ */
+class Parallel_segmentation: public cv::ParallelLoopBody
+{
+private:
+    const float *localMotion, *neighborhoodMotion, *contextMotion;
+    bool *segmentedAreas;
+    float thresholdON;
+public:
+    Parallel_segmentation(const float *localMot, const float *neighborhoodMot, const float *contextMot, bool *segmented, const float threshold)
+        :localMotion(localMot), neighborhoodMotion(neighborhoodMot), contextMotion(contextMot), segmentedAreas(segmented), thresholdON(threshold) {}
+
+    virtual void operator()( const Range& r ) const {
+        int index=r.start;
+#if CV_SIMD128
+        const v_float32x4 v_zero=v_setzero_f32(), v_threshold=v_setall_f32(thresholdON);
+        for (; index<=r.end-4; index+=4)
+        {
+            const v_float32x4 neighborhood=v_load(neighborhoodMotion+index);
+            const v_float32x4 generalMotionContextDecision=neighborhood-v_load(contextMotion+index);
+            const int mask=v_signmask((generalMotionContextDecision>v_zero) & (generalMotionContextDecision>v_threshold)
+                                      & ((v_load(localMotion+index)-neighborhood)>v_threshold));
+            for (int k=0; k<4; ++k)
+                segmentedAreas[index+k]=((mask>>k)&1)!=0;
+        }
+#endif
+        for (; index<r.end; ++index)
+        {
+            const float generalMotionContextDecision=neighborhoodMotion[index]-contextMotion[index];
+            segmentedAreas[index]=generalMotionContextDecision>0 && generalMotionContextDecision>thresholdON
+                                  && (localMotion[index]-neighborhoodMotion[index])>thresholdON;
+        }
+    }
+};
+
 class TransientAreasSegmentationModuleImpl : protected BasicRetinaFilter
 {
 public:
@@ -243,6 +280,36 @@ private:
     TransientAreasSegmentationModuleImpl _segmTool;
 };
 
+// runs the modules of a batch, one stream per task
+class Parallel_runSegmentationBatch: public cv::ParallelLoopBody
+{
+private:
+    const std::vector<Ptr<TransientAreasSegmentationModule> > &modules;
+    const std::vector<Mat> &inputs;
+    int channelIndex;
+public:
+    Parallel_runSegmentationBatch(const std::vector<Ptr<TransientAreasSegmentationModule> > &mods, const std::vector<Mat> &inputsToSegment, const int channel)
+        :modules(mods), inputs(inputsToSegment), channelIndex(channel) {}
+
+    virtual void operator()( const Range& r ) const {
+        for (int i=r.start; i<r.end; ++i)
+            modules[i]->run(inputs[i], channelIndex);
+    }
+private:
+    Parallel_runSegmentationBatch& operator=(const Parallel_runSegmentationBatch&);
+};
+
+void runTransientAreasSegmentationBatch(const std::vector<Ptr<TransientAreasSegmentationModule> > &modules, InputArrayOfArrays inputsToSegment, const int channelIndex)
+{
+    std::vector<Mat> inputs;
+    inputsToSegment.getMatVector(inputs);
+    CV_Assert(inputs.size() == modules.size());
+    for (size_t i=0; i<modules.size(); ++i)
+        CV_Assert(!modules[i].empty());
+
+    cv::parallel_for_(cv::Range(0, (int)modules.size()), Parallel_runSegmentationBatch(modules, inputs, channelIndex));
+}
+
 /**
 * allocator
 * @param Size : size of the images input to segment (output will be the same size)
@@ -459,6 +526,11 @@ void TransientAreasSegmentationModuleImpl::_run(const std::valarray<float> &inpu
     _spatiotemporalLPfilter(&_localMotion[0], &_contextMotionEnergy[0], 2);
 
     // compute the ON and OFF ways (positive and negative values of the difference of the two filterings)
+#ifndef USE_LOCALMINIMUMS
+    cv::parallel_for_(cv::Range(0, getNBpixels()),
+                      Parallel_segmentation(&_localMotion[0], &_neighborhoodMotion[0], &_contextMotionEnergy[0], &_segmentedAreas[0], _segmentationParameters.thresholdON),
+                      getNBpixels()/(double)(1<<16));
+#else
     float*localMotionPTR=&_localMotion[0], *neighborhoodMotionPTR=&_neighborhoodMotion[0], *contextMotionPTR=&_contextMotionEnergy[0];
 
     // float meanEnergy=LPfilter2.sum()/(float)_LPfilter2.size();
@@ -479,7 +551,6 @@ void TransientAreasSegmentationModuleImpl::_run(const std::valarray<float> &inpu
             else
                 *segmentationPicturePTR=false;
         }
-#ifdef USE_LOCALMINIMUMS
         else  // local minimum should be detected in this case
         {
             /* apply segmentation for non moving objects
@@ -494,11 +565,9 @@ void TransientAreasSegmentationModuleImpl::_run(const std::valarray<float> &inpu
                 *segmentationPicturePTR+=(*neighborhoodMotionPTR-*localMotionPTR>_segmentationParameters.thresholdOFF)*127;
             }
         }
-#else
-        else
-            *segmentationPicturePTR=false;
 #endif
     }
+#endif
     /*
 #ifdef SEGMENTATIONDEBUG
     std::cout<<"ON: max, min="<<_localMotionON.min()<<", "<<_localMotionON.max();
@@ -525,11 +594,9 @@ void TransientAreasSegmentationModuleImpl::_convertValarrayBuffer2cvMat(const st
     Mat outMat = outBuffer.getMat();
     for (unsigned int i=0;i<nbRows;++i)
     {
+        unsigned char* outRow=outMat.ptr<unsigned char>(i);
         for (unsigned int j=0;j<nbColumns;++j)
-        {
-            cv::Point2d pixel(j,i);
-            outMat.at<unsigned char>(pixel)=(unsigned char)*(valarrayPTR++);
-        }
+            outRow[j]=(unsigned char)*(valarrayPTR++);
     }
 }
 
@@ -0,0 +1,46 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+using namespace cv;
+using namespace cv::bioinspired;
+
+TEST(Bioinspired_TransientAreasSegmentation, batchMatchesSingleStreams)
+{
+    const int nstreams = 3;
+    const Size size(65, 47); // odd sizes to cover the scalar tails of the filters
+    RNG rng(12345);
+
+    std::vector<Ptr<TransientAreasSegmentationModule> > single, batch;
+    for (int i = 0; i < nstreams; i++)
+    {
+        single.push_back(createTransientAreasSegmentationModule(size));
+        batch.push_back(createTransientAreasSegmentationModule(size));
+    }
+
+    std::vector<Mat> frames(nstreams);
+    Mat expected, actual;
+    for (int t = 0; t < 10; t++)
+    {
+        for (int i = 0; i < nstreams; i++)
+        {
+            frames[i] = Mat::zeros(size, CV_8UC1);
+            // a moving bright block over a noisy background
+            rng.fill(frames[i], RNG::UNIFORM, 0, 10);
+            frames[i](Rect(5 + 3 * t + i, 10, 12, 15)).setTo(Scalar::all(255));
+            single[i]->run(frames[i]);
+        }
+        runTransientAreasSegmentationBatch(batch, frames);
+
+        for (int i = 0; i < nstreams; i++)
+        {
+            single[i]->getSegmentationPicture(expected);
+            batch[i]->getSegmentationPicture(actual);
+            ASSERT_EQ(size, actual.size());
+            ASSERT_EQ(0, cvtest::norm(expected, actual, NORM_INF)) << "stream " << i << ", frame " << t;
+        }
+    }
+    EXPECT_GT(countNonZero(actual), 0);
+}
@@ -165,7 +165,7 @@ private:
 
     void findRowNonZero(const Mat& row, Mat& idx);
 
-    void computeJacobianExtrinsic(const Mat& extrinsicParams, Mat& JTJ_inv, Mat& JTE);
+    void computeExtrinsicStep(const Mat& extrinsicParams, Mat& G);
 
     void computePhotoCameraJacobian(const Mat& rvecPhoto, const Mat& tvecPhoto, const Mat& rvecCamera,
         const Mat& tvecCamera, Mat& rvecTran, Mat& tvecTran, const Mat& objectPoints, const Mat& imagePoints, const Mat& K,
@@ -204,6 +204,8 @@ private:
     std::vector<cv::Mat> _distortCoeffs;
     std::vector<cv::Mat> _xi;
     std::vector<std::vector<Mat> > _omEachCamera, _tEachCamera;
+
+    friend class ExtrinsicEdgeInvoker;
 };
 
 //! @}
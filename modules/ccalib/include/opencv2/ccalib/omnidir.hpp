@@ -40,6 +40,7 @@
 //M*/
 
 #include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 #include <vector>
 
 #ifndef __OPENCV_OMNIDIR_HPP__
@@ -151,6 +152,37 @@ namespace omnidir
     CV_EXPORTS_W void undistortImage(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D, InputArray xi, int flags,
         InputArray Knew = cv::noArray(), const Size& new_size = Size(), InputArray R = Mat::eye(3, 3, CV_64F));
 
+    /** @brief Rectification of omnidirectional images with fixed parameters, such as the frames of a camera rig.
+
+    The maps are computed once by omnidir::initUndistortRectifyMap as CV_16SC2 and CV_16UC1 fixed-point maps,
+    and every frame is rectified by cv::remap with them.
+    */
+    class CV_EXPORTS Rectifier
+    {
+    public:
+        /** @brief Computes the rectification maps, see omnidir::initUndistortRectifyMap for the parameters.
+        */
+        Rectifier(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P, const Size& size, int flags);
+
+        /** @brief Rectifies an image taken by the camera.
+
+        @param distorted The input omnidirectional image.
+        @param undistorted The output undistorted image, of the size given to the constructor.
+        @param interpolation Interpolation method, see cv::remap. INTER_AREA is not supported.
+        @param borderMode Pixel extrapolation method, see cv::remap.
+        @param borderValue Value used with BORDER_CONSTANT.
+        */
+        void rectify(InputArray distorted, OutputArray undistorted, int interpolation = INTER_LINEAR,
+            int borderMode = BORDER_CONSTANT, const Scalar& borderValue = Scalar()) const;
+
+        const Mat& getMap1() const { return map1; }
+        const Mat& getMap2() const { return map2; }
+        Size getSize() const { return map1.size(); }
+
+    private:
+        Mat map1, map2;
+    };
+
     /** @brief Perform omnidirectional camera calibration, the default depth of outputs is CV_64F.
 
     @param objectPoints Vector of vector of Vec3f object points in world (pattern) coordinate.
@@ -84,6 +84,8 @@ public:
         Ptr<DescriptorMatcher> matcher = DescriptorMatcher::create("BruteForce-L1"));
 
     /* @brief Load pattern image and compute features for pattern
+    The features of the pattern are added to the matcher and its index is trained once here,
+    it is reused for all the images matched afterwards.
     @param patternImage image for "random" pattern generated by RandomPatternGenerator, run it first.
     */
     void loadPattern(cv::Mat patternImage);
@@ -97,6 +99,18 @@ public:
     */
     void computeObjectImagePoints(std::vector<cv::Mat> inputImages);
 
+    /* @brief Compute object and image points for a batch of images, the images are processed in parallel.
+    The points are not stored inside the class.
+
+    @param inputImages vector of 8-bit grayscale images containing "random" pattern.
+    @param imagePoints output image points of every input image, empty if the image has no more than
+    nminiMatch matches.
+    @param objectPoints output object points of every input image, empty if the image has no more than
+    nminiMatch matches.
+    */
+    void computeObjectImagePointsForBatch(const std::vector<cv::Mat>& inputImages,
+        std::vector<cv::Mat>& imagePoints, std::vector<cv::Mat>& objectPoints);
+
     //void computeObjectImagePoints2(std::vector<cv::Mat> inputImages);
 
     /* @brief Compute object and image points for a single image. It returns a vector<Mat> that
@@ -365,9 +365,9 @@ double MultiCameraCalibration::optimizeExtrinsics()
             (_criteria.type == 3 && (change <= _criteria.epsilon || iter >= _criteria.maxCount)))
             break;
         double alpha_smooth2 = 1 - std::pow(1 - alpha_smooth, (double)iter + 1.0);
-        Mat JTJ_inv, JTError;
-        this->computeJacobianExtrinsic(extrinParam, JTJ_inv, JTError);
-        Mat G = alpha_smooth2*JTJ_inv * JTError;
+        Mat G;
+        this->computeExtrinsicStep(extrinParam, G);
+        G *= alpha_smooth2;
         if (G.depth() == CV_64F)
         {
             G.convertTo(G, CV_32F);
@@ -400,70 +400,157 @@ double MultiCameraCalibration::optimizeExtrinsics()
     return error;
 }
 
-void MultiCameraCalibration::computeJacobianExtrinsic(const Mat& extrinsicParams, Mat& JTJ_inv, Mat& JTE)
+/* Normal equation blocks of the edges in range. An edge only involves the pose of its pattern vertex and the
+ * pose of its camera vertex, none for the first camera.
+ */
+class ExtrinsicEdgeInvoker : public ParallelLoopBody
 {
-    int nParam = (int)extrinsicParams.total();
-    int nEdge = (int)_edgeList.size();
-    std::vector<int> pointsLocation(nEdge+1, 0);
+public:
+    ExtrinsicEdgeInvoker(MultiCameraCalibration& _calibration, const Mat& _extrinsicParams,
+        std::vector<Mat>& _JTJ, std::vector<Mat>& _JTE) :
+        calibration(_calibration), extrinsicParams(_extrinsicParams), JTJ(_JTJ), JTE(_JTE)
+    {}
 
-    for (int edgeIdx = 0; edgeIdx < nEdge; ++edgeIdx)
+    void operator()(const Range& range) const
     {
-        int nPoints = (int)_objectPointsForEachCamera[_edgeList[edgeIdx].cameraVertex][_edgeList[edgeIdx].photoIndex].total();
-        pointsLocation[edgeIdx+1] = pointsLocation[edgeIdx] + nPoints*2;
+        for (int edgeIdx = range.start; edgeIdx < range.end; ++edgeIdx)
+        {
+            const MultiCameraCalibration::edge& e = calibration._edgeList[edgeIdx];
+            int photoVertex = e.photoVertex;
+            int photoIndex = e.photoIndex;
+            int cameraVertex = e.cameraVertex;
+
+            Mat objectPoints = calibration._objectPointsForEachCamera[cameraVertex][photoIndex];
+            Mat imagePoints = calibration._imagePointsForEachCamera[cameraVertex][photoIndex];
+
+            Mat rvecTran, tvecTran;
+            Mat R = e.transform.rowRange(0, 3).colRange(0, 3);
+            tvecTran = e.transform.rowRange(0, 3).col(3);
+            cv::Rodrigues(R, rvecTran);
+
+            Mat rvecPhoto = extrinsicParams.colRange((photoVertex-1)*6, (photoVertex-1)*6 + 3);
+            Mat tvecPhoto = extrinsicParams.colRange((photoVertex-1)*6 + 3, (photoVertex-1)*6 + 6);
+
+            Mat rvecCamera, tvecCamera;
+            if (cameraVertex > 0)
+            {
+                rvecCamera = extrinsicParams.colRange((cameraVertex-1)*6, (cameraVertex-1)*6 + 3);
+                tvecCamera = extrinsicParams.colRange((cameraVertex-1)*6 + 3, (cameraVertex-1)*6 + 6);
+            }
+            else
+            {
+                rvecCamera = Mat::zeros(3, 1, CV_32F);
+                tvecCamera = Mat::zeros(3, 1, CV_32F);
+            }
+
+            Mat jacobianPhoto, jacobianCamera, error;
+            calibration.computePhotoCameraJacobian(rvecPhoto, tvecPhoto, rvecCamera, tvecCamera, rvecTran, tvecTran,
+                objectPoints, imagePoints, calibration._cameraMatrix[cameraVertex], calibration._distortCoeffs[cameraVertex],
+                calibration._xi[cameraVertex], jacobianPhoto, jacobianCamera, error);
+
+            // [photo, camera] columns, the camera ones are dropped for the first camera
+            Mat J;
+            if (cameraVertex > 0)
+                hconcat(jacobianPhoto, jacobianCamera, J);
+            else
+                J = jacobianPhoto;
+            gemm(J, J, 1, noArray(), 0, JTJ[edgeIdx], GEMM_1_T);
+            gemm(J, error, 1, noArray(), 0, JTE[edgeIdx], GEMM_1_T);
+        }
     }
 
-    JTJ_inv = Mat(nParam, nParam, CV_64F);
-    JTE = Mat(nParam, 1, CV_64F);
+private:
+    MultiCameraCalibration& calibration;
+    const Mat& extrinsicParams;
+    std::vector<Mat>& JTJ;
+    std::vector<Mat>& JTE;
 
-    Mat J = Mat::zeros(pointsLocation[nEdge], nParam, CV_64F);
-    Mat E = Mat::zeros(pointsLocation[nEdge], 1, CV_64F);
+    ExtrinsicEdgeInvoker& operator=(const ExtrinsicEdgeInvoker&);
+};
 
-    for (int edgeIdx = 0; edgeIdx < nEdge; ++edgeIdx)
-    {
-        int photoVertex = _edgeList[edgeIdx].photoVertex;
-        int photoIndex = _edgeList[edgeIdx].photoIndex;
-        int cameraVertex = _edgeList[edgeIdx].cameraVertex;
+/* Gauss-Newton step of the extrinsic parameters. The normal equations are block sparse: a pattern pose is only
+ * linked to the cameras that see it, so the pattern poses are eliminated with the Schur complement and only
+ * the system of the camera poses is solved densely.
+ */
+void MultiCameraCalibration::computeExtrinsicStep(const Mat& extrinsicParams, Mat& G)
+{
+    int nParam = (int)extrinsicParams.total();
+    int nEdge = (int)_edgeList.size();
+    int nCameraParam = (_nCamera - 1) * 6;
+    int nPhoto = (int)_vertexList.size() - _nCamera;
+    // added to the diagonal in case JTJ is singular
+    const double damping = 1e-10;
 
-        Mat objectPoints = _objectPointsForEachCamera[cameraVertex][photoIndex];
-        Mat imagePoints = _imagePointsForEachCamera[cameraVertex][photoIndex];
+    std::vector<Mat> edgeJTJ(nEdge), edgeJTE(nEdge);
+    parallel_for_(Range(0, nEdge), ExtrinsicEdgeInvoker(*this, extrinsicParams, edgeJTJ, edgeJTE));
 
-        Mat rvecTran, tvecTran;
-        Mat R = _edgeList[edgeIdx].transform.rowRange(0, 3).colRange(0, 3);
-        tvecTran = _edgeList[edgeIdx].transform.rowRange(0, 3).col(3);
-        cv::Rodrigues(R, rvecTran);
+    std::vector<std::vector<int> > photoEdges(nPhoto);
+    for (int edgeIdx = 0; edgeIdx < nEdge; ++edgeIdx)
+        photoEdges[_edgeList[edgeIdx].photoVertex - _nCamera].push_back(edgeIdx);
 
-        Mat rvecPhoto = extrinsicParams.colRange((photoVertex-1)*6, (photoVertex-1)*6 + 3);
-        Mat tvecPhoto = extrinsicParams.colRange((photoVertex-1)*6 + 3, (photoVertex-1)*6 + 6);
+    // camera blocks, then the Schur complement of every pattern block
+    Mat C = damping * Mat::eye(nCameraParam, nCameraParam, CV_64F);
+    Mat bc = Mat::zeros(nCameraParam, 1, CV_64F);
+    for (int edgeIdx = 0; edgeIdx < nEdge; ++edgeIdx)
+    {
+        int c = _edgeList[edgeIdx].cameraVertex - 1;
+        if (c < 0)
+            continue;
+        C(Rect(c*6, c*6, 6, 6)) += edgeJTJ[edgeIdx](Rect(6, 6, 6, 6));
+        bc.rowRange(c*6, c*6 + 6) += edgeJTE[edgeIdx].rowRange(6, 12);
+    }
 
-        Mat rvecCamera, tvecCamera;
-        if (cameraVertex > 0)
+    std::vector<Mat> photoInv(nPhoto), photoJTE(nPhoto);
+    for (int p = 0; p < nPhoto; ++p)
+    {
+        Mat P = damping * Mat::eye(6, 6, CV_64F);
+        photoJTE[p] = Mat::zeros(6, 1, CV_64F);
+        for (size_t k = 0; k < photoEdges[p].size(); ++k)
         {
-            rvecCamera = extrinsicParams.colRange((cameraVertex-1)*6, (cameraVertex-1)*6 + 3);
-            tvecCamera = extrinsicParams.colRange((cameraVertex-1)*6 + 3, (cameraVertex-1)*6 + 6);
+            int edgeIdx = photoEdges[p][k];
+            P += edgeJTJ[edgeIdx](Rect(0, 0, 6, 6));
+            photoJTE[p] += edgeJTE[edgeIdx].rowRange(0, 6);
         }
-        else
+        invert(P, photoInv[p], DECOMP_LU);
+
+        for (size_t k1 = 0; k1 < photoEdges[p].size(); ++k1)
         {
-            rvecCamera = Mat::zeros(3, 1, CV_32F);
-            tvecCamera = Mat::zeros(3, 1, CV_32F);
+            int e1 = photoEdges[p][k1], c1 = _edgeList[e1].cameraVertex - 1;
+            if (c1 < 0)
+                continue;
+            // W^T P^-1 of the camera c1
+            Mat WtPinv = edgeJTJ[e1](Rect(0, 6, 6, 6)) * photoInv[p];
+            bc.rowRange(c1*6, c1*6 + 6) -= WtPinv * photoJTE[p];
+            for (size_t k2 = 0; k2 < photoEdges[p].size(); ++k2)
+            {
+                int e2 = photoEdges[p][k2], c2 = _edgeList[e2].cameraVertex - 1;
+                if (c2 < 0)
+                    continue;
+                C(Rect(c2*6, c1*6, 6, 6)) -= WtPinv * edgeJTJ[e2](Rect(6, 0, 6, 6));
+            }
         }
+    }
+
+    Mat xc;
+    if (nCameraParam > 0)
+        cv::solve(C, bc, xc, DECOMP_LU);
 
-        Mat jacobianPhoto, jacobianCamera, error;
-        computePhotoCameraJacobian(rvecPhoto, tvecPhoto, rvecCamera, tvecCamera, rvecTran, tvecTran,
-            objectPoints, imagePoints, this->_cameraMatrix[cameraVertex], this->_distortCoeffs[cameraVertex],
-            this->_xi[cameraVertex], jacobianPhoto, jacobianCamera, error);
-        if (cameraVertex > 0)
+    // back substitution of the pattern poses
+    G = Mat::zeros(nParam, 1, CV_64F);
+    if (nCameraParam > 0)
+        xc.copyTo(G.rowRange(0, nCameraParam));
+    for (int p = 0; p < nPhoto; ++p)
+    {
+        Mat rhs = photoJTE[p].clone();
+        for (size_t k = 0; k < photoEdges[p].size(); ++k)
         {
-            jacobianCamera.copyTo(J.rowRange(pointsLocation[edgeIdx], pointsLocation[edgeIdx+1]).
-                colRange((cameraVertex-1)*6, cameraVertex*6));
+            int edgeIdx = photoEdges[p][k], c = _edgeList[edgeIdx].cameraVertex - 1;
+            if (c >= 0)
+                rhs -= edgeJTJ[edgeIdx](Rect(6, 0, 6, 6)) * xc.rowRange(c*6, c*6 + 6);
         }
-        jacobianPhoto.copyTo(J.rowRange(pointsLocation[edgeIdx], pointsLocation[edgeIdx+1]).
-            colRange((photoVertex-1)*6, photoVertex*6));
-        error.copyTo(E.rowRange(pointsLocation[edgeIdx], pointsLocation[edgeIdx+1]));
+        Mat xp = photoInv[p] * rhs;
+        xp.copyTo(G.rowRange(nCameraParam + p*6, nCameraParam + p*6 + 6));
     }
-    //std::cout << J.t() * J << std::endl;
-    JTJ_inv = (J.t() * J + 1e-10).inv();
-    JTE = J.t() * E;
-
 }
 void MultiCameraCalibration::computePhotoCameraJacobian(const Mat& rvecPhoto, const Mat& tvecPhoto, const Mat& rvecCamera,
     const Mat& tvecCamera, Mat& rvecTran, Mat& tvecTran, const Mat& objectPoints, const Mat& imagePoints, const Mat& K,
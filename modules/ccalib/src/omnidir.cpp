@@ -58,6 +58,7 @@
  */
 #include "precomp.hpp"
 #include "opencv2/ccalib/omnidir.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <fstream>
 #include <iostream>
 namespace cv { namespace
@@ -337,6 +338,163 @@ void cv::omnidir::undistortPoints( InputArray distorted, OutputArray undistorted
 }
 
 
+namespace cv { namespace
+{
+    /* Rows of the rectification maps. The rays of a row are computed first (straight from the inverse
+     * camera matrix for RECTIFY_PERSPECTIVE, through the rectified surface otherwise), then they are
+     * projected to the unit sphere, to the image plane and distorted two at a time.
+     */
+    class OmnidirRectifyMapInvoker : public ParallelLoopBody
+    {
+    public:
+        OmnidirRectifyMapInvoker(const Vec2d& _f, const Vec2d& _c, double _s, double _xi, const Vec2d& _k, const Vec2d& _p,
+                                 const Matx33d& _iK, const Matx33d& _iR, int _flags, int _m1type, Mat& _map1, Mat& _map2) :
+            f(_f), c(_c), s(_s), xi(_xi), k(_k), p(_p), iK(_iK), iR(_iR), flags(_flags), m1type(_m1type),
+            map1(_map1), map2(_map2)
+        {}
+
+        void operator()(const Range& range) const
+        {
+            const int width = map1.cols;
+            std::vector<double> buffer(width * 5);
+            double *X = &buffer[0], *Y = X + width, *W = Y + width, *U = W + width, *V = U + width;
+
+            for (int i = range.start; i < range.end; ++i)
+            {
+                computeRays(i, X, Y, W);
+                project(X, Y, W, U, V);
+
+                float* m1f = map1.ptr<float>(i);
+                float* m2f = map2.ptr<float>(i);
+                short*  m1 = (short*)m1f;
+                ushort* m2 = (ushort*)m2f;
+                for (int j = 0; j < width; ++j)
+                {
+                    if( m1type == CV_16SC2 )
+                    {
+                        int iu = cv::saturate_cast<int>(U[j]*cv::INTER_TAB_SIZE);
+                        int iv = cv::saturate_cast<int>(V[j]*cv::INTER_TAB_SIZE);
+                        m1[j*2+0] = (short)(iu >> cv::INTER_BITS);
+                        m1[j*2+1] = (short)(iv >> cv::INTER_BITS);
+                        m2[j] = (ushort)((iv & (cv::INTER_TAB_SIZE-1))*cv::INTER_TAB_SIZE + (iu & (cv::INTER_TAB_SIZE-1)));
+                    }
+                    else if( m1type == CV_32FC1 )
+                    {
+                        m1f[j] = (float)U[j];
+                        m2f[j] = (float)V[j];
+                    }
+                }
+            }
+        }
+
+    private:
+        void computeRays(int i, double* X, double* Y, double* W) const
+        {
+            const int width = map1.cols;
+            if (flags == omnidir::RECTIFY_PERSPECTIVE)
+            {
+                for (int j = 0; j < width; ++j)
+                {
+                    X[j] = i*iK(0, 1) + iK(0, 2) + j*iK(0, 0);
+                    Y[j] = i*iK(1, 1) + iK(1, 2) + j*iK(1, 0);
+                    W[j] = i*iK(2, 1) + iK(2, 2) + j*iK(2, 0);
+                }
+                return;
+            }
+
+            for (int j = 0; j < width; ++j)
+            {
+                // for RECTIFY_LONGLATI, theta and h are longittude and latitude
+                double theta = i*iK(0, 1) + iK(0, 2) + j*iK(0, 0),
+                       h     = i*iK(1, 1) + iK(1, 2) + j*iK(1, 0);
+                double _xt = 0.0, _yt = 0.0, _wt = 0.0;
+                if (flags == omnidir::RECTIFY_CYLINDRICAL)
+                {
+                    _xt = std::cos(theta);
+                    _yt = std::sin(theta);
+                    _wt = h;
+                }
+                else if (flags == omnidir::RECTIFY_LONGLATI)
+                {
+                    _xt = -std::cos(theta);
+                    _yt = -std::sin(theta) * std::cos(h);
+                    _wt = std::sin(theta) * std::sin(h);
+                }
+                else if (flags == omnidir::RECTIFY_STEREOGRAPHIC)
+                {
+                    double a = theta*theta + h*h + 4;
+                    double b = -2*theta*theta - 2*h*h;
+                    double c2 = theta*theta + h*h -4;
+
+                    _yt = (-b-std::sqrt(b*b - 4*a*c2))/(2*a);
+                    _xt = theta*(1 - _yt) / 2;
+                    _wt = h*(1 - _yt) / 2;
+                }
+                X[j] = iR(0,0)*_xt + iR(0,1)*_yt + iR(0,2)*_wt;
+                Y[j] = iR(1,0)*_xt + iR(1,1)*_yt + iR(1,2)*_wt;
+                W[j] = iR(2,0)*_xt + iR(2,1)*_yt + iR(2,2)*_wt;
+            }
+        }
+
+        void project(const double* X, const double* Y, const double* W, double* U, double* V) const
+        {
+            const int width = map1.cols;
+            int j = 0;
+#if CV_SIMD128_64F
+            const v_float64x2 vxi = v_setall_f64(xi), one = v_setall_f64(1.), two = v_setall_f64(2.);
+            const v_float64x2 k0 = v_setall_f64(k[0]), k1 = v_setall_f64(k[1]), p0 = v_setall_f64(p[0]), p1 = v_setall_f64(p[1]);
+            const v_float64x2 f0 = v_setall_f64(f[0]), f1 = v_setall_f64(f[1]), vs = v_setall_f64(s);
+            const v_float64x2 c0 = v_setall_f64(c[0]), c1 = v_setall_f64(c[1]);
+            for (; j <= width - 2; j += 2)
+            {
+                v_float64x2 x = v_load(X + j), y = v_load(Y + j), w = v_load(W + j);
+                // project back to unit sphere, then to image plane
+                v_float64x2 r = v_sqrt(x*x + y*y + w*w);
+                v_float64x2 den = w + vxi*r;
+                v_float64x2 xu = x / den, yu = y / den;
+                // add distortion
+                v_float64x2 r2 = xu*xu + yu*yu;
+                v_float64x2 radial = one + k0*r2 + k1*r2*r2;
+                v_float64x2 xd = radial*xu + two*p0*xu*yu + p1*(r2 + two*xu*xu);
+                v_float64x2 yd = radial*yu + p0*(r2 + two*yu*yu) + two*p1*xu*yu;
+                // to image pixel
+                v_store(U + j, f0*xd + vs*yd + c0);
+                v_store(V + j, f1*yd + c1);
+            }
+#endif
+            for (; j < width; ++j)
+            {
+                // project back to unit sphere
+                double r = sqrt(X[j]*X[j] + Y[j]*Y[j] + W[j]*W[j]);
+                double Xs = X[j] / r;
+                double Ys = Y[j] / r;
+                double Zs = W[j] / r;
+                // project to image plane
+                double xu = Xs / (Zs + xi),
+                       yu = Ys / (Zs + xi);
+                // add distortion
+                double r2 = xu*xu + yu*yu;
+                double r4 = r2*r2;
+                double xd = (1+k[0]*r2+k[1]*r4)*xu + 2*p[0]*xu*yu + p[1]*(r2+2*xu*xu);
+                double yd = (1+k[0]*r2+k[1]*r4)*yu + p[0]*(r2+2*yu*yu) + 2*p[1]*xu*yu;
+                // to image pixel
+                U[j] = f[0]*xd + s*yd + c[0];
+                V[j] = f[1]*yd + c[1];
+            }
+        }
+
+        Vec2d f, c;
+        double s, xi;
+        Vec2d k, p;
+        Matx33d iK, iR;
+        int flags, m1type;
+        Mat& map1;
+        Mat& map2;
+
+        OmnidirRectifyMapInvoker& operator=(const OmnidirRectifyMapInvoker&);
+    };
+}}
+
 /////////////////////////////////////////////////////////////////////////////
 //////// cv::omnidir::initUndistortRectifyMap
 void cv::omnidir::initUndistortRectifyMap(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
@@ -399,131 +557,10 @@ void cv::omnidir::initUndistortRectifyMap(InputArray K, InputArray D, InputArray
     cv::Matx33d iK = PP.inv(cv::DECOMP_SVD);
     cv::Matx33d iR = RR.inv(cv::DECOMP_SVD);
 
-    if (flags == omnidir::RECTIFY_PERSPECTIVE)
-    {
-        for (int i = 0; i < size.height; ++i)
-        {
-            float* m1f = map1.getMat().ptr<float>(i);
-            float* m2f = map2.getMat().ptr<float>(i);
-            short*  m1 = (short*)m1f;
-            ushort* m2 = (ushort*)m2f;
-
-            double _x = i*iKR(0, 1) + iKR(0, 2),
-                   _y = i*iKR(1, 1) + iKR(1, 2),
-                   _w = i*iKR(2, 1) + iKR(2, 2);
-            for(int j = 0; j < size.width; ++j, _x+=iKR(0,0), _y+=iKR(1,0), _w+=iKR(2,0))
-            {
-                // project back to unit sphere
-                double r = sqrt(_x*_x + _y*_y + _w*_w);
-                double Xs = _x / r;
-                double Ys = _y / r;
-                double Zs = _w / r;
-                // project to image plane
-                double xu = Xs / (Zs + _xi),
-                    yu = Ys / (Zs + _xi);
-                // add distortion
-                double r2 = xu*xu + yu*yu;
-                double r4 = r2*r2;
-                double xd = (1+k[0]*r2+k[1]*r4)*xu + 2*p[0]*xu*yu + p[1]*(r2+2*xu*xu);
-                double yd = (1+k[0]*r2+k[1]*r4)*yu + p[0]*(r2+2*yu*yu) + 2*p[1]*xu*yu;
-                // to image pixel
-                double u = f[0]*xd + s*yd + c[0];
-                double v = f[1]*yd + c[1];
-
-                if( m1type == CV_16SC2 )
-                {
-                    int iu = cv::saturate_cast<int>(u*cv::INTER_TAB_SIZE);
-                    int iv = cv::saturate_cast<int>(v*cv::INTER_TAB_SIZE);
-                    m1[j*2+0] = (short)(iu >> cv::INTER_BITS);
-                    m1[j*2+1] = (short)(iv >> cv::INTER_BITS);
-                    m2[j] = (ushort)((iv & (cv::INTER_TAB_SIZE-1))*cv::INTER_TAB_SIZE + (iu & (cv::INTER_TAB_SIZE-1)));
-                }
-                else if( m1type == CV_32FC1 )
-                {
-                    m1f[j] = (float)u;
-                    m2f[j] = (float)v;
-                }
-            }
-        }
-    }
-    else if(flags == omnidir::RECTIFY_CYLINDRICAL || flags == omnidir::RECTIFY_LONGLATI ||
-        flags == omnidir::RECTIFY_STEREOGRAPHIC)
-    {
-        for (int i = 0; i < size.height; ++i)
-        {
-            float* m1f = map1.getMat().ptr<float>(i);
-            float* m2f = map2.getMat().ptr<float>(i);
-            short*  m1 = (short*)m1f;
-            ushort* m2 = (ushort*)m2f;
-
-            // for RECTIFY_LONGLATI, theta and h are longittude and latitude
-            double theta = i*iK(0, 1) + iK(0, 2),
-                   h     = i*iK(1, 1) + iK(1, 2);
-
-            for (int j = 0; j < size.width; ++j, theta+=iK(0,0), h+=iK(1,0))
-            {
-                double _xt = 0.0, _yt = 0.0, _wt = 0.0;
-                if (flags == omnidir::RECTIFY_CYLINDRICAL)
-                {
-                    //_xt = std::sin(theta);
-                    //_yt = h;
-                    //_wt = std::cos(theta);
-                    _xt = std::cos(theta);
-                    _yt = std::sin(theta);
-                    _wt = h;
-                }
-                else if (flags == omnidir::RECTIFY_LONGLATI)
-                {
-                    _xt = -std::cos(theta);
-                    _yt = -std::sin(theta) * std::cos(h);
-                    _wt = std::sin(theta) * std::sin(h);
-                }
-                else if (flags == omnidir::RECTIFY_STEREOGRAPHIC)
-                {
-                    double a = theta*theta + h*h + 4;
-                    double b = -2*theta*theta - 2*h*h;
-                    double c2 = theta*theta + h*h -4;
-
-                    _yt = (-b-std::sqrt(b*b - 4*a*c2))/(2*a);
-                    _xt = theta*(1 - _yt) / 2;
-                    _wt = h*(1 - _yt) / 2;
-                }
-                double _x = iR(0,0)*_xt + iR(0,1)*_yt + iR(0,2)*_wt;
-                double _y = iR(1,0)*_xt + iR(1,1)*_yt + iR(1,2)*_wt;
-                double _w = iR(2,0)*_xt + iR(2,1)*_yt + iR(2,2)*_wt;
-
-                double r = sqrt(_x*_x + _y*_y + _w*_w);
-                double Xs = _x / r;
-                double Ys = _y / r;
-                double Zs = _w / r;
-                // project to image plane
-                double xu = Xs / (Zs + _xi),
-                       yu = Ys / (Zs + _xi);
-                // add distortion
-                double r2 = xu*xu + yu*yu;
-                double r4 = r2*r2;
-                double xd = (1+k[0]*r2+k[1]*r4)*xu + 2*p[0]*xu*yu + p[1]*(r2+2*xu*xu);
-                double yd = (1+k[0]*r2+k[1]*r4)*yu + p[0]*(r2+2*yu*yu) + 2*p[1]*xu*yu;
-                // to image pixel
-                double u = f[0]*xd + s*yd + c[0];
-                double v = f[1]*yd + c[1];
-
-                if( m1type == CV_16SC2 )
-                {
-                    int iu = cv::saturate_cast<int>(u*cv::INTER_TAB_SIZE);
-                    int iv = cv::saturate_cast<int>(v*cv::INTER_TAB_SIZE);
-                    m1[j*2+0] = (short)(iu >> cv::INTER_BITS);
-                    m1[j*2+1] = (short)(iv >> cv::INTER_BITS);
-                    m2[j] = (ushort)((iv & (cv::INTER_TAB_SIZE-1))*cv::INTER_TAB_SIZE + (iu & (cv::INTER_TAB_SIZE-1)));
-                }
-                else if( m1type == CV_32FC1 )
-                {
-                    m1f[j] = (float)u;
-                    m2f[j] = (float)v;
-                }
-            }
-        }
-    }
+    Mat _map1 = map1.getMat(), _map2 = map2.getMat();
+    cv::parallel_for_(Range(0, size.height),
+        OmnidirRectifyMapInvoker(f, c, s, _xi, k, p, flags == omnidir::RECTIFY_PERSPECTIVE ? iKR : iK, iR,
+                                 flags, m1type, _map1, _map2));
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -534,9 +571,23 @@ void cv::omnidir::undistortImage(InputArray distorted, OutputArray undistorted,
 {
     Size size = new_size.area() != 0 ? new_size : distorted.size();
 
-    cv::Mat map1, map2;
-    omnidir::initUndistortRectifyMap(K, D, xi, R, Knew, size, CV_16SC2, map1, map2, flags);
-    cv::remap(distorted, undistorted, map1, map2, INTER_LINEAR, BORDER_CONSTANT);
+    Rectifier(K, D, xi, R, Knew, size, flags).rectify(distorted, undistorted);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::Rectifier
+
+cv::omnidir::Rectifier::Rectifier(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+    const Size& size, int flags)
+{
+    CV_Assert(size.area() > 0);
+    omnidir::initUndistortRectifyMap(K, D, xi, R, P, size, CV_16SC2, map1, map2, flags);
+}
+
+void cv::omnidir::Rectifier::rectify(InputArray distorted, OutputArray undistorted, int interpolation,
+    int borderMode, const Scalar& borderValue) const
+{
+    cv::remap(distorted, undistorted, map1, map2, interpolation, borderMode, borderValue);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -839,6 +890,319 @@ void cv::omnidir::internal::initializeStereoCalibration(InputArrayOfArrays objec
     xi2 = _xi2m.at<double>(0);
 }
 
+namespace cv { namespace
+{
+    /* Normal equations of the calibrations, where every view has its own 6 extrinsic parameters and the other
+     * parameters (the intrinsics, and the pose between the cameras for stereo) are shared by all views.
+     * The Jacobian is never built: every view stores its blocks U_i = Jv^T*Jv, W_i = Jv^T*Js and
+     * S_i = Js^T*Js, where Jv and Js are the Jacobians of its errors with respect to its own and the shared
+     * parameters. The system is solved with the Schur complement of the view blocks, the memory grows linearly
+     * with the number of views and the buffers are reused between iterations.
+     */
+    class OmnidirNormalEquations
+    {
+    public:
+        // Mono calibration, the parameters are encoded by omnidir::internal::encodeParameters
+        void computeMono(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints, const Mat& parameters, int flags);
+        // Stereo calibration, the parameters are encoded by omnidir::internal::encodeParametersStereo
+        void computeStereo(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints1, InputArrayOfArrays imagePoints2,
+            const Mat& parameters, int flags);
+
+        /* Gauss-Newton step (JTJ + epsilon)^-1 * JTE over the free parameters, as a column of all the parameters with
+         * zeros for the fixed ones. epsilon is added to every element of JTJ: the rank one update is handled by
+         * the Sherman-Morrison formula so that the sparsity is kept.
+         */
+        void solve(double epsilon, Mat& G);
+        // Diagonal of JTJ^-1 as a column of all the parameters, zero for the fixed ones
+        void inverseDiagonal(Mat& diag);
+
+        // Stores the blocks of the view i from the Jacobians of its errors e
+        void setView(int i, const Mat& Jv, const Mat& Js, const Mat& e);
+
+    private:
+        void init(int nViews, int viewOffset, const std::vector<int>& sharedIdx, const std::vector<int>& idx);
+        // Schur complement of the free shared parameters, the inverses of the view blocks are kept
+        void reduce();
+
+        int viewOffset, nParams;
+        std::vector<int> sharedIdx;
+        std::vector<int> freeShared;
+        std::vector<Mat> U, W, S, bv, bs;
+        std::vector<Mat> Uinv, Wr;
+        Mat schur, rhs;
+    };
+
+    /* Jacobian blocks of the views in range. The views of a mono calibration are projected by a single camera,
+     * the ones of a stereo calibration by the two cameras, through the pose between them for the second one.
+     */
+    class OmnidirViewJacobianInvoker : public ParallelLoopBody
+    {
+    public:
+        OmnidirViewJacobianInvoker(OmnidirNormalEquations& _equations, const std::vector<Mat>& _objectPoints,
+            const std::vector<Mat>& _imagePoints1, const std::vector<Mat>& _imagePoints2, const Mat& _parameters) :
+            equations(_equations), objectPoints(_objectPoints), imagePoints1(_imagePoints1), imagePoints2(_imagePoints2),
+            parameters(_parameters)
+        {}
+
+        void operator()(const Range& range) const
+        {
+            for (int i = range.start; i < range.end; ++i)
+            {
+                if (imagePoints2.empty())
+                    computeMonoView(i);
+                else
+                    computeStereoView(i);
+            }
+        }
+
+    private:
+        static void camera(const double* para, int offset, Matx33d& K, Matx14d& D, double& xi)
+        {
+            K = Matx33d(para[offset], para[offset+2], para[offset+3],
+                0,    para[offset+1], para[offset+4],
+                0,    0,  1);
+            D = Matx14d(para[offset+6], para[offset+7], para[offset+8], para[offset+9]);
+            xi = para[offset+5];
+        }
+
+        void computeMonoView(int i) const
+        {
+            int n = (int)objectPoints.size();
+            Matx33d K;
+            Matx14d D;
+            double xi;
+            camera(parameters.ptr<double>(), 6*n, K, D, xi);
+
+            Mat objPoints, imgPoints;
+            objectPoints[i].copyTo(objPoints);
+            imagePoints1[i].copyTo(imgPoints);
+            objPoints = objPoints.reshape(3, (int)objPoints.total());
+            imgPoints = imgPoints.reshape(2, (int)imgPoints.total());
+            Mat om = parameters.colRange(i*6, i*6+3);
+            Mat T = parameters.colRange(i*6+3, (i+1)*6);
+
+            Mat imgProj, jacobian;
+            omnidir::projectPoints(objPoints, imgProj, om, T, K, xi, D, jacobian);
+            Mat projError = imgPoints - imgProj;
+
+            equations.setView(i, jacobian.colRange(0, 6), jacobian.colRange(6, 16),
+                projError.reshape(1, 2*(int)projError.total()));
+        }
+
+        void computeStereoView(int i) const
+        {
+            int n = (int)objectPoints.size();
+            int offset1 = (n + 1) * 6;
+            Matx33d K1, K2;
+            Matx14d D1, D2;
+            double xi1, xi2;
+            camera(parameters.ptr<double>(), offset1, K1, D1, xi1);
+            camera(parameters.ptr<double>(), offset1 + 10, K2, D2, xi2);
+
+            int nPoints = (int)objectPoints[i].total();
+            Mat objPoints, imgPoints1, imgPoints2;
+            objectPoints[i].copyTo(objPoints);
+            imagePoints1[i].copyTo(imgPoints1);
+            imagePoints2[i].copyTo(imgPoints2);
+            objPoints = objPoints.reshape(3, nPoints);
+            imgPoints1 = imgPoints1.reshape(2, nPoints);
+            imgPoints2 = imgPoints2.reshape(2, nPoints);
+            Mat om = parameters.colRange(0, 3), T = parameters.colRange(3, 6);
+            Mat om1 = parameters.colRange((1 + i) * 6, (1 + i) * 6 + 3);
+            Mat T1 = parameters.colRange((1 + i) * 6 + 3, (i + 1) * 6 + 6);
+
+            // the shared parameters are the pose between the cameras, then the intrinsics of both cameras
+            Mat Jv = Mat::zeros(4*nPoints, 6, CV_64F), Js = Mat::zeros(4*nPoints, 26, CV_64F);
+            Mat e(4*nPoints, 1, CV_64F);
+
+            // jacobian for left image
+            Mat imgProj1, jacobian1;
+            omnidir::projectPoints(objPoints, imgProj1, om1, T1, K1, xi1, D1, jacobian1);
+            Mat(imgPoints1 - imgProj1).reshape(1, 2*nPoints).copyTo(e.rowRange(0, 2*nPoints));
+            jacobian1.colRange(0, 6).copyTo(Jv.rowRange(0, 2*nPoints));
+            jacobian1.colRange(6, 16).copyTo(Js(Rect(6, 0, 10, 2*nPoints)));
+
+            //jacobian for right image
+            Mat om2, T2, dom2dom1, dom2dT1, dom2dom, dom2dT, dT2dom1, dT2dT1, dT2dom, dT2dT;
+            omnidir::internal::compose_motion(om1, T1, om, T, om2, T2, dom2dom1, dom2dT1, dom2dom, dom2dT, dT2dom1, dT2dT1, dT2dom, dT2dT);
+            Mat imgProj2, jacobian2;
+            omnidir::projectPoints(objPoints, imgProj2, om2, T2, K2, xi2, D2, jacobian2);
+            Mat(imgPoints2 - imgProj2).reshape(1, 2*nPoints).copyTo(e.rowRange(2*nPoints, 4*nPoints));
+            Mat dxrdom = jacobian2.colRange(0, 3) * dom2dom + jacobian2.colRange(3, 6) * dT2dom;
+            Mat dxrdT = jacobian2.colRange(0, 3) * dom2dT + jacobian2.colRange(3, 6) * dT2dT;
+            Mat dxrdom1 = jacobian2.colRange(0, 3) * dom2dom1 + jacobian2.colRange(3, 6) * dT2dom1;
+            Mat dxrdT1 = jacobian2.colRange(0, 3) * dom2dT1 + jacobian2.colRange(3, 6) * dT2dT1;
+
+            dxrdom1.copyTo(Jv(Rect(0, 2*nPoints, 3, 2*nPoints)));
+            dxrdT1.copyTo(Jv(Rect(3, 2*nPoints, 3, 2*nPoints)));
+            dxrdom.copyTo(Js(Rect(0, 2*nPoints, 3, 2*nPoints)));
+            dxrdT.copyTo(Js(Rect(3, 2*nPoints, 3, 2*nPoints)));
+            jacobian2.colRange(6, 16).copyTo(Js(Rect(16, 2*nPoints, 10, 2*nPoints)));
+
+            equations.setView(i, Jv, Js, e);
+        }
+
+        OmnidirNormalEquations& equations;
+        const std::vector<Mat>& objectPoints;
+        const std::vector<Mat>& imagePoints1;
+        const std::vector<Mat>& imagePoints2;
+        const Mat& parameters;
+
+        OmnidirViewJacobianInvoker& operator=(const OmnidirViewJacobianInvoker&);
+    };
+
+    void OmnidirNormalEquations::init(int nViews, int _viewOffset, const std::vector<int>& _sharedIdx,
+        const std::vector<int>& idx)
+    {
+        viewOffset = _viewOffset;
+        sharedIdx = _sharedIdx;
+        nParams = (int)idx.size();
+        freeShared.clear();
+        for (int k = 0; k < (int)sharedIdx.size(); ++k)
+        {
+            if (idx[sharedIdx[k]])
+                freeShared.push_back(k);
+        }
+        U.resize(nViews);
+        W.resize(nViews);
+        S.resize(nViews);
+        bv.resize(nViews);
+        bs.resize(nViews);
+        Uinv.resize(nViews);
+        Wr.resize(nViews);
+    }
+
+    void OmnidirNormalEquations::setView(int i, const Mat& Jv, const Mat& Js, const Mat& e)
+    {
+        gemm(Jv, Jv, 1, noArray(), 0, U[i], GEMM_1_T);
+        gemm(Jv, Js, 1, noArray(), 0, W[i], GEMM_1_T);
+        gemm(Js, Js, 1, noArray(), 0, S[i], GEMM_1_T);
+        gemm(Jv, e, 1, noArray(), 0, bv[i], GEMM_1_T);
+        gemm(Js, e, 1, noArray(), 0, bs[i], GEMM_1_T);
+    }
+
+    void OmnidirNormalEquations::computeMono(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints,
+        const Mat& parameters, int flags)
+    {
+        CV_Assert(!objectPoints.empty() && objectPoints.type() == CV_64FC3);
+        CV_Assert(!imagePoints.empty() && imagePoints.type() == CV_64FC2);
+        std::vector<Mat> _objectPoints, _imagePoints;
+        objectPoints.getMatVector(_objectPoints);
+        imagePoints.getMatVector(_imagePoints);
+
+        int n = (int)_objectPoints.size();
+        std::vector<int> idx, shared;
+        omnidir::internal::flags2idx(flags, idx, n);
+        for (int k = 0; k < 10; ++k)
+            shared.push_back(6*n + k);
+        init(n, 0, shared, idx);
+
+        Mat para = parameters.reshape(1, 1);
+        parallel_for_(Range(0, n), OmnidirViewJacobianInvoker(*this, _objectPoints, _imagePoints, std::vector<Mat>(), para));
+        reduce();
+    }
+
+    void OmnidirNormalEquations::computeStereo(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints1,
+        InputArrayOfArrays imagePoints2, const Mat& parameters, int flags)
+    {
+        CV_Assert(!objectPoints.empty() && objectPoints.type() == CV_64FC3);
+        CV_Assert(!imagePoints1.empty() && imagePoints1.type() == CV_64FC2);
+        CV_Assert(!imagePoints2.empty() && imagePoints2.type() == CV_64FC2);
+        CV_Assert((imagePoints1.total() == imagePoints2.total()) && (imagePoints1.total() == objectPoints.total()));
+        std::vector<Mat> _objectPoints, _imagePoints1, _imagePoints2;
+        objectPoints.getMatVector(_objectPoints);
+        imagePoints1.getMatVector(_imagePoints1);
+        imagePoints2.getMatVector(_imagePoints2);
+
+        int n = (int)_objectPoints.size();
+        std::vector<int> idx, shared;
+        omnidir::internal::flags2idxStereo(flags, idx, n);
+        for (int k = 0; k < 6; ++k)
+            shared.push_back(k);
+        for (int k = 0; k < 20; ++k)
+            shared.push_back(6*(n + 1) + k);
+        init(n, 6, shared, idx);
+
+        Mat para = parameters.reshape(1, 1);
+        parallel_for_(Range(0, n), OmnidirViewJacobianInvoker(*this, _objectPoints, _imagePoints1, _imagePoints2, para));
+        reduce();
+    }
+
+    void OmnidirNormalEquations::reduce()
+    {
+        const int m = (int)freeShared.size();
+        schur = Mat::zeros(m, m, CV_64F);
+        // right hand sides JTE and the ones of the rank one update
+        rhs = Mat::zeros(m, 2, CV_64F);
+        rhs.col(1).setTo(Scalar::all(1));
+
+        Mat Bv(6, 2, CV_64F), tmp;
+        for (int i = 0; i < (int)U.size(); ++i)
+        {
+            for (int k = 0; k < m; ++k)
+            {
+                rhs.at<double>(k, 0) += bs[i].at<double>(freeShared[k]);
+                for (int l = 0; l < m; ++l)
+                    schur.at<double>(k, l) += S[i].at<double>(freeShared[k], freeShared[l]);
+            }
+            Wr[i].create(6, m, CV_64F);
+            for (int k = 0; k < m; ++k)
+                W[i].col(freeShared[k]).copyTo(Wr[i].col(k));
+
+            invert(U[i], Uinv[i], DECOMP_LU);
+            bv[i].copyTo(Bv.col(0));
+            Bv.col(1).setTo(Scalar::all(1));
+
+            // S - W^T U^-1 W and b_s - W^T U^-1 b_v
+            tmp = Wr[i].t() * Uinv[i];
+            schur -= tmp * Wr[i];
+            rhs -= tmp * Bv;
+        }
+    }
+
+    void OmnidirNormalEquations::solve(double epsilon, Mat& G)
+    {
+        const int m = (int)freeShared.size();
+        Mat xs;
+        cv::solve(schur, rhs, xs, DECOMP_LU);
+
+        // solutions of JTJ x = JTE and JTJ y = 1
+        Mat x = Mat::zeros(nParams, 2, CV_64F);
+        for (int k = 0; k < m; ++k)
+            xs.row(k).copyTo(x.row(sharedIdx[freeShared[k]]));
+        Mat Bv(6, 2, CV_64F);
+        for (int i = 0; i < (int)U.size(); ++i)
+        {
+            bv[i].copyTo(Bv.col(0));
+            Bv.col(1).setTo(Scalar::all(1));
+            Mat xv = Uinv[i] * (Bv - Wr[i] * xs);
+            xv.copyTo(x.rowRange(viewOffset + 6*i, viewOffset + 6*i + 6));
+        }
+
+        Scalar sums = sum(x.col(0)), sumy = sum(x.col(1));
+        G = x.col(0) - x.col(1) * (epsilon * sums[0] / (1 + epsilon * sumy[0]));
+    }
+
+    void OmnidirNormalEquations::inverseDiagonal(Mat& diag)
+    {
+        const int m = (int)freeShared.size();
+        Mat schurInv;
+        invert(schur, schurInv, DECOMP_LU);
+
+        diag = Mat::zeros(nParams, 1, CV_64F);
+        for (int k = 0; k < m; ++k)
+            diag.at<double>(sharedIdx[freeShared[k]]) = schurInv.at<double>(k, k);
+        for (int i = 0; i < (int)U.size(); ++i)
+        {
+            // view block of the inverse: U^-1 + U^-1 W S^-1 W^T U^-1
+            Mat tmp = Uinv[i] * Wr[i];
+            Mat block = Uinv[i] + tmp * schurInv * tmp.t();
+            for (int k = 0; k < 6; ++k)
+                diag.at<double>(viewOffset + 6*i + k) = block.at<double>(k, k);
+        }
+    }
+}}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// cv::omnidir::internal::computeJacobian
 
@@ -1114,6 +1478,7 @@ double cv::omnidir::calibrate(InputArrayOfArrays patternPoints, InputArrayOfArra
     const double alpha_smooth = 0.01;
     //const double thresh_cond = 1e6;
     double change = 1;
+    OmnidirNormalEquations normalEquations;
     for(int iter = 0; ; ++iter)
     {
         if ((criteria.type == 1 && iter >= criteria.maxCount)  ||
@@ -1121,14 +1486,13 @@ double cv::omnidir::calibrate(InputArrayOfArrays patternPoints, InputArrayOfArra
             (criteria.type == 3 && (change <= criteria.epsilon || iter >= criteria.maxCount)))
             break;
         double alpha_smooth2 = 1 - std::pow(1 - alpha_smooth, (double)iter + 1.0);
-        Mat JTJ_inv, JTError;
 		double epsilon = 0.01 * std::pow(0.9, (double)iter/10);
-        cv::omnidir::internal::computeJacobian(_patternPoints, _imagePoints, currentParam, JTJ_inv, JTError, flags, epsilon);
+        normalEquations.computeMono(_patternPoints, _imagePoints, currentParam, flags);
 
         // Gauss - Newton
-        Mat G = alpha_smooth2*JTJ_inv * JTError;
-
-        omnidir::internal::fillFixed(G, flags, n);
+        Mat G;
+        normalEquations.solve(epsilon, G);
+        G *= alpha_smooth2;
 
         finalParam = currentParam + G.t();
 
@@ -1265,6 +1629,7 @@ double cv::omnidir::stereoCalibrate(InputOutputArrayOfArrays objectPoints, Input
     // optimization
     const double alpha_smooth = 0.01;
     double change = 1;
+    OmnidirNormalEquations normalEquations;
     for(int iter = 0; ; ++iter)
     {
         if ((criteria.type == 1 && iter >= criteria.maxCount)  ||
@@ -1272,16 +1637,14 @@ double cv::omnidir::stereoCalibrate(InputOutputArrayOfArrays objectPoints, Input
             (criteria.type == 3 && (change <= criteria.epsilon || iter >= criteria.maxCount)))
             break;
         double alpha_smooth2 = 1 - std::pow(1 - alpha_smooth, (double)iter + 1.0);
-        Mat JTJ_inv, JTError;
 		double epsilon = 0.01 * std::pow(0.9, (double)iter/10);
 
-        cv::omnidir::internal::computeJacobianStereo(_objectPointsFilt, _imagePoints1Filt, _imagePoints2Filt, currentParam,
-			JTJ_inv, JTError, flags, epsilon);
+        normalEquations.computeStereo(_objectPointsFilt, _imagePoints1Filt, _imagePoints2Filt, currentParam, flags);
 
         // Gauss - Newton
-        Mat G = alpha_smooth2*JTJ_inv * JTError;
-
-        omnidir::internal::fillFixedStereo(G, flags, n);
+        Mat G;
+        normalEquations.solve(epsilon, G);
+        G *= alpha_smooth2;
 
         finalParam = currentParam + G.t();
 
@@ -1779,11 +2142,13 @@ void cv::omnidir::internal::estimateUncertainties(InputArrayOfArrays objectPoint
     sigma_x *= sqrt(2.0*(double)reprojError.total()/(2.0*(double)reprojError.total() - 1.0));
     double s = sigma_x.at<double>(0);
 
-    Mat _JTJ_inv, _JTE;
-    computeJacobian(objectPoints, imagePoints, parameters, _JTJ_inv, _JTE, flags, 0.0);
-    sqrt(_JTJ_inv, _JTJ_inv);
+    OmnidirNormalEquations normalEquations;
+    normalEquations.computeMono(objectPoints, imagePoints, parameters.getMat(), flags);
+    Mat JTJ_inv_diag;
+    normalEquations.inverseDiagonal(JTJ_inv_diag);
+    sqrt(JTJ_inv_diag, JTJ_inv_diag);
 
-    errors = 3 * s * _JTJ_inv.diag();
+    errors = 3 * s * JTJ_inv_diag;
 
     checkFixed(errors, flags, n);
 
@@ -1867,11 +2232,13 @@ void cv::omnidir::internal::estimateUncertaintiesStereo(InputArrayOfArrays objec
     sigma_x *= sqrt(2.0*(double)reprojErrorAll.total()/(2.0*(double)reprojErrorAll.total() - 1.0));
     double s = sigma_x.at<double>(0);
 
-    Mat _JTJ_inv, _JTE;
-    computeJacobianStereo(objectPoints, imagePoints1, imagePoints2, _parameters, _JTJ_inv, _JTE, flags, 0.0);
-    cv::sqrt(_JTJ_inv, _JTJ_inv);
+    OmnidirNormalEquations normalEquations;
+    normalEquations.computeStereo(objectPoints, imagePoints1, imagePoints2, _parameters, flags);
+    Mat JTJ_inv_diag;
+    normalEquations.inverseDiagonal(JTJ_inv_diag);
+    cv::sqrt(JTJ_inv_diag, JTJ_inv_diag);
 
-    errors = 3 * s * _JTJ_inv.diag();
+    errors = 3 * s * JTJ_inv_diag;
 
     rms = 0;
 
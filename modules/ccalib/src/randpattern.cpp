@@ -58,6 +58,42 @@
 using namespace std;
 
 namespace cv { namespace randpattern {
+
+namespace
+{
+
+/* Every image is detected, described and matched with the pattern independently,
+ * the trained index of the pattern is shared by all of them.
+ */
+class RandomPatternImagesInvoker : public ParallelLoopBody
+{
+public:
+    RandomPatternImagesInvoker(RandomPatternCornerFinder& _finder, const std::vector<Mat>& _inputImages,
+        std::vector<Mat>& _imagePoints, std::vector<Mat>& _objectPoints) :
+        finder(_finder), inputImages(_inputImages), imagePoints(_imagePoints), objectPoints(_objectPoints)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        for (int i = range.start; i < range.end; ++i)
+        {
+            std::vector<Mat> r = finder.computeObjectImagePointsForSingle(inputImages[i]);
+            imagePoints[i] = r[0];
+            objectPoints[i] = r[1];
+        }
+    }
+
+private:
+    RandomPatternCornerFinder& finder;
+    const std::vector<Mat>& inputImages;
+    std::vector<Mat>& imagePoints;
+    std::vector<Mat>& objectPoints;
+
+    RandomPatternImagesInvoker& operator=(const RandomPatternImagesInvoker&);
+};
+
+}
+
 RandomPatternCornerFinder::RandomPatternCornerFinder(float patternWidth, float patternHeight,
     int nminiMatch, int depth, int verbose, int showExtraction, Ptr<FeatureDetector> detector, Ptr<DescriptorExtractor> descriptor,
     Ptr<DescriptorMatcher> matcher)
@@ -80,15 +116,40 @@ void RandomPatternCornerFinder::computeObjectImagePoints(std::vector<cv::Mat> in
     CV_Assert(!_patternImage.empty());
     CV_Assert(inputImages.size() > 0);
 
+    std::vector<Mat> imagePoints, objectPoints;
+    computeObjectImagePointsForBatch(inputImages, imagePoints, objectPoints);
+    for (int i = 0; i < (int)inputImages.size(); ++i)
+    {
+        if (!imagePoints[i].empty())
+        {
+            _imagePoints.push_back(imagePoints[i]);
+            _objectPonits.push_back(objectPoints[i]);
+        }
+    }
+}
+
+void RandomPatternCornerFinder::computeObjectImagePointsForBatch(const std::vector<cv::Mat>& inputImages,
+    std::vector<cv::Mat>& imagePoints, std::vector<cv::Mat>& objectPoints)
+{
+    CV_Assert(!_patternImage.empty());
+
     int nImages = (int)inputImages.size();
-    std::vector<Mat> imageObjectPoints;
+    imagePoints.assign(nImages, Mat());
+    objectPoints.assign(nImages, Mat());
+
+    RandomPatternImagesInvoker invoker(*this, inputImages, imagePoints, objectPoints);
+    // the correspondences are shown in windows, one image after another
+    if (_showExtraction || _verbose)
+        invoker(Range(0, nImages));
+    else
+        parallel_for_(Range(0, nImages), invoker);
+
     for (int i = 0; i < nImages; ++i)
     {
-        imageObjectPoints = computeObjectImagePointsForSingle(inputImages[i]);
-        if ((int)imageObjectPoints[0].total() > _nminiMatch)
+        if ((int)imagePoints[i].total() <= _nminiMatch)
         {
-            _imagePoints.push_back(imageObjectPoints[0]);
-            _objectPonits.push_back(imageObjectPoints[1]);
+            imagePoints[i].release();
+            objectPoints[i].release();
         }
     }
 }
@@ -162,7 +223,10 @@ void RandomPatternCornerFinder::crossCheckMatching( Ptr<DescriptorMatcher>& desc
 {
     filteredMatches12.clear();
     std::vector<std::vector<DMatch> > matches12, matches21;
-    descriptorMatcher->knnMatch( descriptors1, descriptors2, matches12, knn );
+    // descriptors2 are the pattern ones the matcher is trained with in loadPattern, the trained index
+    // is only queried here so it can be shared by the images; the reverse direction is matched
+    // with a temporary copy of the matcher
+    descriptorMatcher->knnMatch( descriptors1, matches12, knn );
     descriptorMatcher->knnMatch( descriptors2, descriptors1, matches21, knn );
     for( size_t m = 0; m < matches12.size(); m++ )
     {
@@ -247,6 +311,10 @@ void RandomPatternCornerFinder::loadPattern(cv::Mat patternImage)
     _detector->detect(patternImage, _keypointsPattern);
     _descriptor->compute(patternImage, _keypointsPattern, _descriptorPattern);
     _descriptorPattern.convertTo(_descriptorPattern, CV_32F);
+
+    _matcher->clear();
+    _matcher->add(std::vector<Mat>(1, _descriptorPattern));
+    _matcher->train();
 }
 
 std::vector<cv::Mat> RandomPatternCornerFinder::computeObjectImagePointsForSingle(cv::Mat inputImage)
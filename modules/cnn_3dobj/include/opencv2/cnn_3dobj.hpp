@@ -199,6 +199,17 @@ namespace cnn_3dobj
         @param isrgb Option for choice of using RGB images or not.
          */
         CV_WRAP static void writeBinaryfile(String filenameImg, const char* binaryPath, const char* headerPath, int num_item, int label_class, int x, int y, int z, int isrgb);
+
+        /** @brief Write many images to the binary files at once, equivalent to calling writeBinaryfile for each of them.
+         The images are read in parallel and appended to the files in chunks, which are only opened once.
+        @param filenameImg Paths of the images.
+        @param binaryPath Path which will output a binary file.
+        @param headerPath Path which header belongs to.
+        @param num_item Number of samples.
+        @param labels Class label and pose labels of X, Y and Z of each image.
+        @param isrgb Option for choice of using RGB images or not.
+         */
+        CV_WRAP static void writeBinaryfiles(const std::vector<String>& filenameImg, const char* binaryPath, const char* headerPath, int num_item, const std::vector<Vec4i>& labels, int isrgb);
     };
 
 /** @brief Caffe based 3D images descriptor.
@@ -215,8 +226,10 @@ namespace cnn_3dobj
         bool net_set;
         int net_ready;
         cv::Mat mean_;
+        cv::Scalar mean_value_;
         String deviceType;
         int deviceId;
+        int batch_size;
 
         /** @brief Load the mean file in binaryproto format if it is needed.
         @param mean_file Path of mean file which stores the mean of training images, it is usually generated by Caffe tool.
@@ -233,6 +246,11 @@ namespace cnn_3dobj
          */
         void preprocess(const cv::Mat& img, std::vector<cv::Mat>* input_channels);
 
+        /** @brief Extract features from images by forwarding them through the net in batches of batch_size.
+         The features are written to the rows of a preallocated output.
+         */
+        void extractBatched(const std::vector<cv::Mat>& img, OutputArray feature, const String& feature_blob);
+
         public:
         /** @brief Set the device for feature extraction, if the GPU is used, there should be a device_id.
         @param device_type CPU or GPU.
@@ -268,8 +286,20 @@ namespace cnn_3dobj
          */
         void loadNet(const String& model_file, const String& trained_file, const String& mean_file = "");
 
+        /** @brief Set the number of images stacked into one input blob by extract.
+         Larger batches are faster, especially on GPU, but need more memory.
+        @param batch_size Number of images forwarded together, 16 by default.
+         */
+        void setBatchSize(int batch_size);
+
+        /** @brief Get the number of images stacked into one input blob by extract.
+         */
+        int getBatchSize();
+
         /** @brief Extract features from a single image or from a vector of images.
          If loadNet was not called before, this method invocation will fail.
+         The images are forwarded in batches, see setBatchSize. When the GPU is used and OpenCV is built
+         with the CUDA modules, the images are resized and normalized on the GPU.
         @param inputimg Input images.
         @param feature Output features.
         @param feature_blob Layer which the feature is extracted from.
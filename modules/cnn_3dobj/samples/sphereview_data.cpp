@@ -265,6 +265,9 @@ int main(int argc, char *argv[])
     do
     {
         cnt_img = 0;
+        /* Images written to the binary files after rendering, with their labels. */
+        std::vector<String> binary_images;
+        std::vector<Vec4i> binary_labels;
         for(int pose = 0; pose < static_cast<int>(campos.size()); pose++){
             /* Add light. */
             // double alpha1 = rand()%(314/2)/100;
@@ -320,11 +323,16 @@ int main(int argc, char *argv[])
             myWindow.saveScreenshot(filename);
             if (binary_out)
             {
-            /* Write images into binary files for further using in CNN training. */
-                ViewSphere.writeBinaryfile(filename, binaryPath, headerPath,static_cast<int>(campos.size())*num_class, label_class, static_cast<int>(campos.at(pose).x*100), static_cast<int>(campos.at(pose).y*100), static_cast<int>(campos.at(pose).z*100), rgb_use);
+                binary_images.push_back(filename);
+                binary_labels.push_back(Vec4i(label_class, static_cast<int>(campos.at(pose).x*100), static_cast<int>(campos.at(pose).y*100), static_cast<int>(campos.at(pose).z*100)));
             }
             cnt_img++;
         }
+        if (binary_out)
+        {
+        /* Write images into binary files for further using in CNN training. */
+            ViewSphere.writeBinaryfiles(binary_images, binaryPath, headerPath, static_cast<int>(campos.size())*num_class, binary_labels, rgb_use);
+        }
     } while (cnt_img != campos.size());
     imglabel.close();
     return 1;
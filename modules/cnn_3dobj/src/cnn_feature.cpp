@@ -1,13 +1,63 @@
 #include "precomp.hpp"
+#include <algorithm>
 using namespace caffe;
 
 namespace cv
 {
 namespace cnn_3dobj
 {
+#ifdef HAVE_CNN_3DOBJ_CUDA_PREPROCESSING
+    /* Convert the images of a batch to the input image format of the network on the GPU.
+     * The separate planes are written directly to the input layer in device memory,
+     * so the input blob never goes through the host. */
+    static void preprocessBatchGpu(const std::vector<cv::Mat>& img, int start, int count,
+        Blob<float>* input_layer, const cv::Size& input_geometry, const cv::Scalar* mean_value)
+    {
+        int num_channels = input_layer->channels();
+        int width = input_layer->width();
+        int height = input_layer->height();
+        float* input_data = input_layer->mutable_gpu_data();
+        cuda::GpuMat src, sample, sample_resized, sample_float, sample_normalized;
+        std::vector<cuda::GpuMat> input_channels(num_channels);
+        for (int i = 0; i < count; ++i)
+        {
+            src.upload(img[start + i]);
+            if (src.channels() == 3 && num_channels == 1)
+                cuda::cvtColor(src, sample, COLOR_BGR2GRAY);
+            else if (src.channels() == 4 && num_channels == 1)
+                cuda::cvtColor(src, sample, COLOR_BGRA2GRAY);
+            else if (src.channels() == 4 && num_channels == 3)
+                cuda::cvtColor(src, sample, COLOR_BGRA2BGR);
+            else if (src.channels() == 1 && num_channels == 3)
+                cuda::cvtColor(src, sample, COLOR_GRAY2BGR);
+            else
+                sample = src;
+            if (sample.size() != input_geometry)
+                cuda::resize(sample, sample_resized, input_geometry);
+            else
+                sample_resized = sample;
+            sample_resized.convertTo(sample_float, CV_32F);
+            if (mean_value)
+                cuda::subtract(sample_float, *mean_value, sample_normalized);
+            else
+                sample_normalized = sample_float;
+            for (int c = 0; c < num_channels; ++c)
+            {
+                input_channels[c] = cuda::GpuMat(height, width, CV_32FC1, input_data);
+                input_data += width * height;
+            }
+            if (num_channels == 1)
+                sample_normalized.copyTo(input_channels[0]);
+            else
+                cuda::split(sample_normalized, input_channels);
+        }
+    }
+#endif
+
     descriptorExtractor::descriptorExtractor(const String& device_type, int device_id)
     {
         net_ready = 0;
+        batch_size = 16;
         if (strcmp(device_type.c_str(), "CPU") == 0 || strcmp(device_type.c_str(), "GPU") == 0)
         {
             if (strcmp(device_type.c_str(), "CPU") == 0)
@@ -144,61 +194,99 @@ namespace cnn_3dobj
          * filled with this value. */
         cv::Scalar channel_mean = cv::mean(mean);
         mean_ = cv::Mat(input_geometry, mean.type(), channel_mean);
+        mean_value_ = channel_mean;
+    };
+
+    void descriptorExtractor::setBatchSize(int batch_size_)
+    {
+        if (batch_size_ > 0)
+            batch_size = batch_size_;
+        else
+            std::cout << "Error: Batch size must be positive." << std::endl;
+    };
+
+    int descriptorExtractor::getBatchSize()
+    {
+        return batch_size;
     };
 
     void descriptorExtractor::extract(InputArrayOfArrays inputimg, OutputArray feature, String feature_blob)
     {
         if (net_ready)
         {
-            Blob<float>* input_layer = convnet->input_blobs()[0];
-            input_layer->Reshape(1, num_channels,
-            input_geometry.height, input_geometry.width);
-            /* Forward dimension change to all layers. */
-            convnet->Reshape();
-            std::vector<cv::Mat> input_channels;
-            wrapInput(&input_channels);
-            if (inputimg.kind() == 65536)
+            std::vector<Mat> img;
+            if (inputimg.kind() == _InputArray::MAT)
             {/* this is a Mat */
-                Mat img = inputimg.getMat();
-                preprocess(img, &input_channels);
-                convnet->ForwardPrefilled();
-                /* Copy the output layer to a std::vector */
-                Blob<float>* output_layer = convnet->blob_by_name(feature_blob).get();
-                const float* begin = output_layer->cpu_data();
-                const float* end = begin + output_layer->channels();
-                std::vector<float> featureVec = std::vector<float>(begin, end);
-                cv::Mat feature_mat = cv::Mat(featureVec, true).t();
-                feature_mat.copyTo(feature);
+                img.push_back(inputimg.getMat());
             }
             else
             {/* This is a vector<Mat> */
-                vector<Mat> img;
                 inputimg.getMatVector(img);
-                Mat feature_vector;
-                for (unsigned int i = 0; i < img.size(); ++i)
-                {
-                    preprocess(img[i], &input_channels);
-                    convnet->ForwardPrefilled();
-                    /* Copy the output layer to a std::vector */
-                    Blob<float>* output_layer = convnet->blob_by_name(feature_blob).get();
-                    const float* begin = output_layer->cpu_data();
-                    const float* end = begin + output_layer->channels();
-                    std::vector<float> featureVec = std::vector<float>(begin, end);
-                    if (i == 0)
-                    {
-                        feature_vector = cv::Mat(featureVec, true).t();
-                        int dim_feature = feature_vector.cols;
-                        feature_vector.resize(img.size(), dim_feature);
-                    }
-                    feature_vector.row(i) = cv::Mat(featureVec, true).t();
-                }
-                feature_vector.copyTo(feature);
             }
+            extractBatched(img, feature, feature_blob);
         }
         else
           std::cout << "Device must be set properly using constructor and the net must be set in advance using loadNet.";
     };
 
+    void descriptorExtractor::extractBatched(const std::vector<cv::Mat>& img, OutputArray feature, const String& feature_blob)
+    {
+        int total = (int)img.size();
+        if (total == 0)
+        {
+            feature.release();
+            return;
+        }
+        Blob<float>* input_layer = convnet->input_blobs()[0];
+        Mat feature_mat;
+        for (int start = 0; start < total; start += batch_size)
+        {
+            int count = std::min(batch_size, total - start);
+            if (input_layer->num() != count)
+            {
+                input_layer->Reshape(count, num_channels,
+                input_geometry.height, input_geometry.width);
+                /* Forward dimension change to all layers. */
+                convnet->Reshape();
+            }
+#ifdef HAVE_CNN_3DOBJ_CUDA_PREPROCESSING
+            if (strcmp(deviceType.c_str(), "GPU") == 0)
+            {
+                preprocessBatchGpu(img, start, count, input_layer, input_geometry,
+                    net_ready == 2 ? &mean_value_ : NULL);
+            }
+            else
+#endif
+            {
+                /* The channels of all the images of the batch, image after image. */
+                std::vector<cv::Mat> input_channels;
+                wrapInput(&input_channels);
+                for (int i = 0; i < count; ++i)
+                {
+                    std::vector<cv::Mat> image_channels(input_channels.begin() + i * num_channels,
+                        input_channels.begin() + (i + 1) * num_channels);
+                    preprocess(img[start + i], &image_channels);
+                    if (image_channels[0].data != input_channels[i * num_channels].data)
+                        std::cout << "Input channels are not wrapping the input layer of the network." << std::endl;
+                }
+            }
+            convnet->ForwardPrefilled();
+            /* Copy the output layer to the rows of the feature matrix */
+            Blob<float>* output_layer = convnet->blob_by_name(feature_blob).get();
+            if (feature_mat.empty())
+            {
+                feature.create(total, output_layer->channels(), CV_32F);
+                feature_mat = feature.getMat();
+            }
+            const float* output_data = output_layer->cpu_data();
+            for (int i = 0; i < count; ++i)
+            {
+                const float* begin = output_data + output_layer->offset(i);
+                std::copy(begin, begin + feature_mat.cols, feature_mat.ptr<float>(start + i));
+            }
+        }
+    };
+
     /* Wrap the input layer of the network in separate cv::Mat objects
      * (one per channel). This way we save one memcpy operation and we
      * don't need to rely on cudaMemcpy2D. The last preprocessing
@@ -243,17 +331,15 @@ namespace cnn_3dobj
         else
             sample_resized.convertTo(sample_float, CV_32FC1);
         cv::Mat sample_normalized;
+        /* The mean image is filled with the mean pixel value. */
         if (net_ready == 2)
-            cv::subtract(sample_float, mean_, sample_normalized);
+            cv::subtract(sample_float, mean_value_, sample_normalized);
         else
             sample_normalized = sample_float;
         /* This operation will write the separate BGR planes directly to the
          * input layer of the network because it is wrapped by the cv::Mat
          * objects in input_channels. */
         cv::split(sample_normalized, *input_channels);
-        if (reinterpret_cast<float*>(input_channels->at(0).data)
-      != convnet->input_blobs()[0]->cpu_data())
-            std::cout << "Input channels are not wrapping the input layer of the network." << std::endl;
     };
 } /* namespace cnn_3dobj */
 } /* namespace cv */
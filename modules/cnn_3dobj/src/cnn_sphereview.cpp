@@ -1,4 +1,5 @@
 #include "precomp.hpp"
+#include <algorithm>
 using namespace cv;
 using namespace std;
 
@@ -6,6 +7,60 @@ namespace cv
 {
 namespace cnn_3dobj
 {
+namespace
+{
+    /* Orders indices of view points by the X coordinate of the points. */
+    struct CompareX
+    {
+        const std::vector<cv::Point3d>& pos;
+        CompareX(const std::vector<cv::Point3d>& pos_) : pos(pos_) {}
+        bool operator()(int a, int b) const { return pos[a].x < pos[b].x; }
+    };
+
+    /* Append the pixels of an image to a buffer in the layout of the binary files:
+     * row after row, and plane after plane for color images. */
+    void appendImage(const cv::Mat& img, int isrgb, std::vector<char>& buffer)
+    {
+        std::vector<cv::Mat> planes;
+        if (isrgb == 0)
+            planes.push_back(img);
+        else
+            cv::split(img, planes);
+        for (unsigned int i = 0; i < planes.size(); i++)
+        {
+            for (int r = 0; r < planes[i].rows; r++)
+            {
+                const char* row = reinterpret_cast<const char*>(planes[i].ptr(r));
+                buffer.insert(buffer.end(), row, row + planes[i].cols*planes[i].elemSize());
+            }
+        }
+    }
+
+    /* Read and lay out a chunk of images in parallel, one buffer per image. */
+    class ImageEncoder : public cv::ParallelLoopBody
+    {
+    public:
+        ImageEncoder(const std::vector<String>& filenames_, int start_, int isrgb_, std::vector<std::vector<char> >* buffers_)
+            : filenames(filenames_), start(start_), isrgb(isrgb_), buffers(buffers_) {}
+
+        void operator()(const cv::Range& range) const
+        {
+            for (int i = range.start; i < range.end; i++)
+            {
+                std::vector<char>& buffer = (*buffers)[i];
+                buffer.clear();
+                appendImage(cv::imread(filenames[start + i], isrgb), isrgb, buffer);
+            }
+        }
+
+    private:
+        const std::vector<String>& filenames;
+        int start;
+        int isrgb;
+        std::vector<std::vector<char> >* buffers;
+    };
+}
+
     icoSphere::icoSphere(float radius_in, int depth_in)
     {
         X = 0.5f;
@@ -29,21 +84,46 @@ namespace cnn_3dobj
             subdivide(vdata[tindices[i][0]], vdata[tindices[i][1]],
               vdata[tindices[i][2]], depth_in);
         }
-        CameraPos_temp.push_back(CameraPos[0]);
-        for (unsigned int j = 1; j < CameraPos.size(); ++j)
+        /* A view point is kept if no earlier one is closer than diff on every axis.
+         * Sorting the points by X restricts the search to the points with a close X. */
+        std::vector<int> order(CameraPos.size());
+        for (int i = 0; i < (int)order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), CompareX(CameraPos));
+        std::vector<uchar> duplicated(CameraPos.size(), 0);
+        for (int s = 0; s < (int)order.size(); ++s)
         {
-            for (unsigned int k = 0; k < j; ++k)
+            int j = order[s];
+            for (int t = s - 1; t >= 0 && !duplicated[j]; --t)
+            {
+                int k = order[t];
+                float dist_x, dist_y, dist_z;
+                dist_x = (float)((CameraPos.at(k).x-CameraPos.at(j).x) * (CameraPos.at(k).x-CameraPos.at(j).x));
+                if (dist_x >= diff)
+                    break;
+                dist_y = (float)((CameraPos.at(k).y-CameraPos.at(j).y) * (CameraPos.at(k).y-CameraPos.at(j).y));
+                dist_z = (float)((CameraPos.at(k).z-CameraPos.at(j).z) * (CameraPos.at(k).z-CameraPos.at(j).z));
+                if (k < j && dist_y < diff && dist_z < diff)
+                    duplicated[j] = 1;
+            }
+            for (int t = s + 1; t < (int)order.size() && !duplicated[j]; ++t)
             {
+                int k = order[t];
                 float dist_x, dist_y, dist_z;
-                dist_x = (CameraPos.at(k).x-CameraPos.at(j).x) * (CameraPos.at(k).x-CameraPos.at(j).x);
-                dist_y = (CameraPos.at(k).y-CameraPos.at(j).y) * (CameraPos.at(k).y-CameraPos.at(j).y);
-                dist_z = (CameraPos.at(k).z-CameraPos.at(j).z) * (CameraPos.at(k).z-CameraPos.at(j).z);
-                if (dist_x < diff && dist_y < diff && dist_z < diff)
+                dist_x = (float)((CameraPos.at(k).x-CameraPos.at(j).x) * (CameraPos.at(k).x-CameraPos.at(j).x));
+                if (dist_x >= diff)
                     break;
-                else if (k == j-1)
-                    CameraPos_temp.push_back(CameraPos[j]);
+                dist_y = (float)((CameraPos.at(k).y-CameraPos.at(j).y) * (CameraPos.at(k).y-CameraPos.at(j).y));
+                dist_z = (float)((CameraPos.at(k).z-CameraPos.at(j).z) * (CameraPos.at(k).z-CameraPos.at(j).z));
+                if (k < j && dist_y < diff && dist_z < diff)
+                    duplicated[j] = 1;
             }
         }
+        for (unsigned int j = 0; j < CameraPos.size(); ++j)
+        {
+            if (!duplicated[j])
+                CameraPos_temp.push_back(CameraPos[j]);
+        }
         CameraPos = CameraPos_temp;
         cout << "View points in total: " << CameraPos.size() << endl;
         cout << "The coordinate of view point: " << endl;
@@ -68,14 +148,7 @@ namespace cnn_3dobj
 
     void icoSphere::add(float v[])
     {
-        Point3f temp_Campos;
-        std::vector<float>* temp = new std::vector<float>;
-        for (int k = 0; k < 3; ++k)
-        {
-            temp->push_back(v[k]);
-        }
-        temp_Campos.x = temp->at(0);temp_Campos.y = temp->at(1);temp_Campos.z = temp->at(2);
-        CameraPos.push_back(temp_Campos);
+        CameraPos.push_back(Point3f(v[0], v[1], v[2]));
     };
 
     void icoSphere::subdivide(float v1[], float v2[], float v3[], int depth)
@@ -90,9 +163,7 @@ namespace cnn_3dobj
             add(v3);
             return;
         }
-        float* v12 = new float[3];
-        float* v23 = new float[3];
-        float* v31 = new float[3];
+        float v12[3], v23[3], v31[3];
         for (int i = 0; i < 3; ++i)
         {
             v12[i] = (v1[i] + v2[i]) / 2;
@@ -261,5 +332,43 @@ namespace cnn_3dobj
         img_file.close();
         lab_file.close();
     };
+
+    void icoSphere::writeBinaryfiles(const std::vector<String>& filenameImg, const char* binaryPath, const char* headerPath, int num_item, const std::vector<Vec4i>& labels, int isrgb)
+    {
+        CV_Assert(filenameImg.size() == labels.size());
+        (void)headerPath;
+        String binPathimg = String(binaryPath) + "image";
+        String binPathlab = String(binaryPath) + "label";
+        if (!std::ifstream(binPathimg.c_str()))
+        {
+            cout << "Creating the training data at: " << binaryPath << ". " << endl;
+            createHeader(num_item, 64, 64, binaryPath);
+        }
+        else
+            cout <<"Concatenating the training data at: " << binaryPath << ". " << endl;
+        std::ofstream img_file(binPathimg.c_str(), ios::out|ios::binary|ios::app);
+        std::ofstream lab_file(binPathlab.c_str(), ios::out|ios::binary|ios::app);
+
+        /* The images of a chunk are decoded in parallel and written in one go, in order. */
+        const int chunk_size = 256;
+        std::vector<std::vector<char> > buffers(chunk_size);
+        std::vector<char> label_buffer;
+        int total = (int)filenameImg.size();
+        for (int start = 0; start < total; start += chunk_size)
+        {
+            int count = std::min(chunk_size, total - start);
+            cv::parallel_for_(cv::Range(0, count), ImageEncoder(filenameImg, start, isrgb, &buffers));
+            label_buffer.clear();
+            for (int i = 0; i < count; i++)
+            {
+                if (!buffers[i].empty())
+                    img_file.write(&buffers[i][0], buffers[i].size());
+                const Vec4i& label = labels[start + i];
+                for (int c = 0; c < 4; c++)
+                    label_buffer.push_back((char)(signed char)label[c]);
+            }
+            lab_file.write(&label_buffer[0], label_buffer.size());
+        }
+    };
 } /* namespace cnn_3dobj */
 } /* namespace cv */
@@ -43,5 +43,13 @@ the use of this software, even if advised of the possibility of such damage.
 #define __OPENCV_CNN_3DOBJ_PRECOMP_HPP__
 
 #include <opencv2/cnn_3dobj.hpp>
+#include "opencv2/opencv_modules.hpp"
+
+#if defined(HAVE_OPENCV_CUDAARITHM) && defined(HAVE_OPENCV_CUDAIMGPROC) && defined(HAVE_OPENCV_CUDAWARPING) && !defined(CPU_ONLY)
+#  define HAVE_CNN_3DOBJ_CUDA_PREPROCESSING
+#  include "opencv2/cudaarithm.hpp"
+#  include "opencv2/cudaimgproc.hpp"
+#  include "opencv2/cudawarping.hpp"
+#endif
 
 #endif
@@ -0,0 +1,148 @@
+#ifndef CVVISUAL_CAPTURE_HPP
+#define CVVISUAL_CAPTURE_HPP
+
+#include <string>
+#include <cstddef>
+
+#include "opencv2/core.hpp"
+
+#include "debug_mode.hpp"
+
+#ifdef CV_DOXYGEN
+#define CVVISUAL_DEBUGMODE
+#endif
+
+namespace cvv
+{
+
+//! @addtogroup cvv
+//! @{
+
+namespace impl
+{
+// implementation outside API
+CV_EXPORTS void setCaptureMode(bool active, size_t capacity, bool copyImages);
+CV_EXPORTS void showCapturedCalls();
+CV_EXPORTS void startCaptureDump(const std::string &directory);
+CV_EXPORTS void stopCaptureDump();
+CV_EXPORTS size_t droppedCalls();
+CV_EXPORTS void startSessionRecording(const std::string &path);
+CV_EXPORTS void showSession(const std::string &path);
+} // namespace impl
+
+#ifdef CVVISUAL_DEBUGMODE
+/** @brief Enables or disables the capture mode.
+
+In capture mode the debug calls do not open the GUI. They are recorded in a ring buffer and the
+calling thread continues at once. When the buffer is full, the oldest call is dropped. The recorded
+calls are shown by showCapturedCalls() or finalShow(), or written to files by startCaptureDump()
+or startSessionRecording().
+Calls may be recorded from several threads.
+
+@param active Whether the capture mode is enabled. Disabling it keeps the recorded calls.
+@param capacity Maximal number of recorded calls.
+@param copyImages If false, images given as cv::Mat are recorded by reference instead of being
+copied, so the caller must not write into them afterwards. Images without a reference counter
+(e.g. wrapping user memory) are always copied.
+ */
+static inline void setCaptureMode(bool active, size_t capacity = 256,
+                                  bool copyImages = false)
+{
+	impl::setCaptureMode(active, capacity, copyImages);
+}
+
+/** @brief Shows the recorded calls in the debug GUI.
+
+Must be called from the thread owning the GUI (usually the main thread). Returns when the user
+continues the program execution.
+ */
+static inline void showCapturedCalls()
+{
+	if (debugMode())
+	{
+		impl::showCapturedCalls();
+	}
+}
+
+/** @brief Starts a thread writing the recorded calls to files.
+
+Each call is written to *directory*/call_*id*.yml.gz with cv::FileStorage as soon as it is
+recorded, and is not shown in the GUI anymore.
+@param directory Existing directory the files are written to.
+ */
+static inline void startCaptureDump(const ::std::string &directory)
+{
+	impl::startCaptureDump(directory);
+}
+
+/** @brief Starts a thread appending the recorded calls to a session file.
+
+The file holds the images, compressed, and the data of the calls. It can be inspected later, on
+another machine, with showSession(). It stays readable if the program is killed while writing it.
+Only one of startCaptureDump() and startSessionRecording() can be active at a time.
+@param path Path of the session file, which is overwritten.
+ */
+static inline void startSessionRecording(const ::std::string &path)
+{
+	impl::startSessionRecording(path);
+}
+
+/** @brief Shows the calls of a session file in the debug GUI.
+
+The images are read from the file when they are first shown, the overview only uses thumbnails.
+Must be called from the thread owning the GUI (usually the main thread). Returns when the user
+continues the program execution.
+@param path Path of a file written by startSessionRecording().
+ */
+static inline void showSession(const ::std::string &path)
+{
+	if (debugMode())
+	{
+		impl::showSession(path);
+	}
+}
+
+/** @brief Writes the calls still recorded and stops the thread started by startCaptureDump() or
+startSessionRecording().
+ */
+static inline void stopCaptureDump()
+{
+	impl::stopCaptureDump();
+}
+
+/** @brief Returns the number of calls dropped because the ring buffer was full.
+ */
+static inline size_t droppedCalls()
+{
+	return impl::droppedCalls();
+}
+#else
+static inline void setCaptureMode(bool, size_t = 256, bool = false)
+{
+}
+static inline void showCapturedCalls()
+{
+}
+static inline void startCaptureDump(const ::std::string &)
+{
+}
+static inline void stopCaptureDump()
+{
+}
+static inline size_t droppedCalls()
+{
+	return 0;
+}
+static inline void startSessionRecording(const ::std::string &)
+{
+}
+static inline void showSession(const ::std::string &)
+{
+}
+#endif
+
+//! @}
+
+} // namespace cvv
+
+#endif
@@ -23,7 +23,7 @@ OverviewTableRow::OverviewTableRow(util::Reference<const impl::Call> call)
 	{
 		QPixmap img;
 		std::tie(std::ignore, img) =
-		    qtutil::convertMatToQPixmap(call->matrixAt(i));
+		    qtutil::convertMatToQPixmap(call->thumbnailAt(i));
 		imgs.push_back(std::move(img));
 	}
 	description_ = QString(call_->description());
@@ -22,7 +22,24 @@ Call::Call(impl::CallMetaData callData, QString type, QString description,
       calltype{ std::move(type) }, description_{ std::move(description) },
       requestedView_{ std::move(requestedView) }
 {
+}
 
+cv::Mat Call::thumbnailAt(size_t index) const
+{
+	if (imageLoader_ && index < matrixCount())
+	{
+		return imageLoader_->thumbnail(index);
+	}
+	return matrixAt(index);
+}
+
+const cv::Mat &Call::loadedMatrix(size_t index, cv::Mat &storage) const
+{
+	if (imageLoader_ && storage.empty())
+	{
+		storage = imageLoader_->load(index);
+	}
+	return storage;
 }
 }
 } // namespaces cvv::impl
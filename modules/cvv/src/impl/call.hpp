@@ -1,6 +1,7 @@
 #ifndef CVVISUAL_CALL_HPP
 #define CVVISUAL_CALL_HPP
 
+#include <memory>
 #include <utility>
 
 #include <QString>
@@ -21,6 +22,29 @@ namespace impl
  */
 size_t newCallId();
 
+/**
+ * @brief Source of the images of a call that are only loaded when they are
+ * accessed.
+ */
+class ImageLoader
+{
+      public:
+	virtual ~ImageLoader()
+	{
+	}
+
+	/**
+	 * @brief Loads the n'th matrix of the call.
+	 */
+	virtual cv::Mat load(size_t index) const = 0;
+
+	/**
+	 * @brief Returns a downscaled version of the n'th matrix of the call,
+	 * without loading the matrix.
+	 */
+	virtual cv::Mat thumbnail(size_t index) const = 0;
+};
+
 /**
  * @brief Baseclass for all calls. Provides access to the common functionality.
  */
@@ -59,6 +83,23 @@ class Call
 	 */
 	virtual const cv::Mat &matrixAt(size_t index) const = 0;
 
+	/**
+	 * @brief Returns the n'th matrix, or a downscaled version of it if the
+	 * matrices of the call are loaded on demand.
+	 *
+	 * Intended for previews that shall not load every matrix.
+	 */
+	cv::Mat thumbnailAt(size_t index) const;
+
+	/**
+	 * @brief Sets the source the empty matrices of the call are loaded from
+	 * on their first access.
+	 */
+	void setImageLoader(std::shared_ptr<const ImageLoader> loader)
+	{
+		imageLoader_ = std::move(loader);
+	}
+
 	/**
 	 * @brief provides a description of the call.
 	 */
@@ -104,11 +145,18 @@ class Call
 	Call &operator=(const Call &) = default;
 	Call &operator=(Call &&) = default;
 
+	/**
+	 * @brief Returns storage, after loading the n'th matrix into it if it
+	 * is empty and an ImageLoader was set.
+	 */
+	const cv::Mat &loadedMatrix(size_t index, cv::Mat &storage) const;
+
 	impl::CallMetaData metaData_;
 	size_t id;
 	QString calltype;
 	QString description_;
 	QString requestedView_;
+	std::shared_ptr<const ImageLoader> imageLoader_;
 };
 }
 } // namespaces
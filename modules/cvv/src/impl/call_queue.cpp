@@ -0,0 +1,217 @@
+#include "call_queue.hpp"
+
+#include <stdexcept>
+
+#include "data_controller.hpp"
+#include "match_call.hpp"
+
+namespace cvv
+{
+namespace impl
+{
+
+void writeCallFile(const Call &call, const std::string &directory)
+{
+	cv::FileStorage fs{ directory + "/call_" +
+		                std::to_string(call.getId()) + ".yml.gz",
+		            cv::FileStorage::WRITE };
+	fs << "id" << static_cast<int>(call.getId());
+	fs << "type" << call.type().toStdString();
+	fs << "description" << call.description().toStdString();
+	fs << "view" << call.requestedView().toStdString();
+
+	const auto &data = call.metaData();
+	if (data.isKnown)
+	{
+		fs << "file" << data.file;
+		fs << "line" << static_cast<int>(data.line);
+		fs << "function" << data.function;
+	}
+
+	fs << "images"
+	   << "[";
+	for (size_t i = 0; i < call.matrixCount(); i++)
+	{
+		fs << call.matrixAt(i);
+	}
+	fs << "]";
+
+	auto match = dynamic_cast<const MatchCall *>(&call);
+	if (match)
+	{
+		cv::write(fs, "keypoints1", match->keyPoints1());
+		cv::write(fs, "keypoints2", match->keyPoints2());
+		cv::write(fs, "matches", match->matches());
+		fs << "useTrainDescriptor"
+		   << static_cast<int>(match->usesTrainDescriptor());
+	}
+}
+
+CallQueue::~CallQueue()
+{
+	stopDump();
+}
+
+void CallQueue::setMode(bool active, size_t capacity, bool copyImages)
+{
+	if (capacity == 0)
+	{
+		throw std::invalid_argument{ "the capacity must not be 0" };
+	}
+	std::lock_guard<std::mutex> lock{ mutex };
+	resize(capacity);
+	copyImages_ = copyImages;
+	active_ = active;
+}
+
+cv::Mat CallQueue::matrix(cv::InputArray array) const
+{
+	if (!active_ || copyImages_ || array.kind() != cv::_InputArray::MAT)
+	{
+		return array.getMat().clone();
+	}
+	// only reference-counted data outlives the caller's array
+	cv::Mat mat = array.getMat();
+	return mat.u ? mat : mat.clone();
+}
+
+void CallQueue::push(std::unique_ptr<Call> call)
+{
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (ring.empty())
+		{
+			resize(256);
+		}
+		if (count == ring.size())
+		{
+			popFront();
+			dropped_++;
+		}
+		ring[(head + count) % ring.size()] = std::move(call);
+		count++;
+	}
+	available.notify_one();
+}
+
+std::vector<std::unique_ptr<Call>> CallQueue::takeAll()
+{
+	std::lock_guard<std::mutex> lock{ mutex };
+	std::vector<std::unique_ptr<Call>> calls;
+	calls.reserve(count);
+	while (count)
+	{
+		calls.push_back(popFront());
+	}
+	return calls;
+}
+
+void CallQueue::startDump(std::function<void(const Call &)> write)
+{
+	stopDump();
+	dumpCall = std::move(write);
+	dumper = std::thread{ &CallQueue::dumpLoop, this };
+}
+
+void CallQueue::stopDump()
+{
+	if (!dumper.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		stopDumper = true;
+	}
+	available.notify_all();
+	dumper.join();
+	stopDumper = false;
+	dumpCall = nullptr;
+}
+
+size_t CallQueue::dropped() const
+{
+	std::lock_guard<std::mutex> lock{ mutex };
+	return dropped_;
+}
+
+void CallQueue::dumpLoop()
+{
+	std::unique_lock<std::mutex> lock{ mutex };
+	while (true)
+	{
+		available.wait(lock, [this]
+		               { return count != 0 || stopDumper; });
+		if (count == 0)
+		{
+			return;
+		}
+		auto call = popFront();
+		// writing may be slow, the instrumented threads keep recording
+		lock.unlock();
+		dumpCall(*call);
+		call.reset();
+		lock.lock();
+	}
+}
+
+void CallQueue::resize(size_t capacity)
+{
+	if (capacity == ring.size())
+	{
+		return;
+	}
+	std::vector<std::unique_ptr<Call>> newRing(capacity);
+	while (count > capacity)
+	{
+		popFront();
+		dropped_++;
+	}
+	size_t newCount = count;
+	for (size_t i = 0; i < newCount; i++)
+	{
+		newRing[i] = popFront();
+	}
+	ring = std::move(newRing);
+	head = 0;
+	count = newCount;
+}
+
+std::unique_ptr<Call> CallQueue::popFront()
+{
+	auto call = std::move(ring[head]);
+	head = (head + 1) % ring.size();
+	count--;
+	return call;
+}
+
+CallQueue &callQueue()
+{
+	static CallQueue queue;
+	return queue;
+}
+
+void submitCall(std::unique_ptr<Call> call)
+{
+	auto &queue = callQueue();
+	if (queue.active())
+	{
+		queue.push(std::move(call));
+	}
+	else
+	{
+		dataController().addCall(std::move(call));
+	}
+}
+
+size_t moveCapturedCalls()
+{
+	auto calls = callQueue().takeAll();
+	for (auto &call : calls)
+	{
+		dataController().addCall(std::move(call), false);
+	}
+	return calls.size();
+}
+}
+} // namespaces cvv::impl
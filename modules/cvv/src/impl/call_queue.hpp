@@ -0,0 +1,141 @@
+#ifndef CVVISUAL_CALL_QUEUE_HPP
+#define CVVISUAL_CALL_QUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv2/core.hpp"
+
+#include "call.hpp"
+
+namespace cvv
+{
+namespace impl
+{
+
+/**
+ * @brief Bounded ring buffer of the calls recorded in capture mode.
+ *
+ * Calls are pushed by the instrumented threads and taken by the GUI or by a
+ * dumper thread writing them to files.
+ */
+class CallQueue
+{
+      public:
+	CallQueue() = default;
+
+	/**
+	 * @brief Stops the dumper thread.
+	 */
+	~CallQueue();
+
+	/**
+	 * @brief Enables or disables the capture mode.
+	 *
+	 * Shrinking the capacity drops the oldest calls.
+	 */
+	void setMode(bool active, size_t capacity, bool copyImages);
+
+	bool active() const
+	{
+		return active_;
+	}
+
+	/**
+	 * @brief Returns a matrix holding the data of the given array as
+	 * required by the current mode: a reference or a deep copy.
+	 */
+	cv::Mat matrix(cv::InputArray array) const;
+
+	/**
+	 * @brief Records a call, dropping the oldest one if the buffer is full.
+	 */
+	void push(std::unique_ptr<Call> call);
+
+	/**
+	 * @brief Removes all recorded calls from the buffer, oldest first.
+	 */
+	std::vector<std::unique_ptr<Call>> takeAll();
+
+	/**
+	 * @brief Starts a thread taking each recorded call and passing it to
+	 * the given function.
+	 */
+	void startDump(std::function<void(const Call &)> write);
+
+	/**
+	 * @brief Writes the calls still recorded, stops the dumper thread and
+	 * destroys the function passed to startDump().
+	 */
+	void stopDump();
+
+	/**
+	 * @brief Returns the number of calls dropped because the buffer was
+	 * full.
+	 */
+	size_t dropped() const;
+
+      private:
+	void dumpLoop();
+
+	void resize(size_t capacity);
+
+	std::unique_ptr<Call> popFront();
+
+	mutable std::mutex mutex;
+	std::condition_variable available;
+	std::vector<std::unique_ptr<Call>> ring;
+	size_t head = 0;
+	size_t count = 0;
+	size_t dropped_ = 0;
+	std::atomic<bool> active_{ false };
+	std::atomic<bool> copyImages_{ true };
+
+	std::thread dumper;
+	std::function<void(const Call &)> dumpCall;
+	bool stopDumper = false;
+};
+
+/**
+ * Provides access to the global CallQueue.
+ */
+CallQueue &callQueue();
+
+/**
+ * @brief Returns the data of an image passed to a debug call, as it shall
+ * be stored in the Call object.
+ */
+inline cv::Mat callMatrix(cv::InputArray array)
+{
+	return callQueue().matrix(array);
+}
+
+/**
+ * @brief Writes a call to <directory>/call_<id>.yml.gz.
+ */
+void writeCallFile(const Call &call, const std::string &directory);
+
+/**
+ * @brief Records the call in capture mode, otherwise adds it to the global
+ * data-controller.
+ */
+void submitCall(std::unique_ptr<Call> call);
+
+/**
+ * @brief Adds the recorded calls to the global data-controller without
+ * showing the GUI.
+ *
+ * @returns the number of calls added.
+ */
+size_t moveCapturedCalls();
+
+}
+} // namespaces cvv::impl
+
+#endif
@@ -0,0 +1,62 @@
+#include "opencv2/cvv/capture.hpp"
+
+#include "call_queue.hpp"
+#include "data_controller.hpp"
+#include "session.hpp"
+
+namespace cvv
+{
+namespace impl
+{
+
+void setCaptureMode(bool active, size_t capacity, bool copyImages)
+{
+	callQueue().setMode(active, capacity, copyImages);
+}
+
+void showCapturedCalls()
+{
+	if (moveCapturedCalls() != 0)
+	{
+		dataController().callUI();
+	}
+}
+
+void startCaptureDump(const std::string &directory)
+{
+	callQueue().startDump([directory](const Call &call)
+	                      { writeCallFile(call, directory); });
+}
+
+void stopCaptureDump()
+{
+	callQueue().stopDump();
+}
+
+size_t droppedCalls()
+{
+	return callQueue().dropped();
+}
+
+void startSessionRecording(const std::string &path)
+{
+	auto writer = std::make_shared<SessionWriter>(
+	    QString::fromLocal8Bit(path.c_str()));
+	callQueue().startDump([writer](const Call &call)
+	                      { writer->write(call); });
+}
+
+void showSession(const std::string &path)
+{
+	auto calls = readSession(QString::fromLocal8Bit(path.c_str()));
+	for (auto &call : calls)
+	{
+		dataController().addCall(std::move(call), false);
+	}
+	if (!calls.empty())
+	{
+		dataController().callUI();
+	}
+}
+}
+} // namespaces cvv::impl
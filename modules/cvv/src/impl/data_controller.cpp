@@ -27,12 +27,15 @@ class CallEquality
 };
 }
 
-void DataController::addCall(std::unique_ptr<Call> call)
+void DataController::addCall(std::unique_ptr<Call> call, bool showUI)
 {
 	auto ref = util::makeRef(*call);
 	calls.push_back(std::move(call));
 	viewController.addCall(ref);
-	callUI();
+	if (showUI)
+	{
+		callUI();
+	}
 }
 
 void DataController::removeCall(size_t Id)
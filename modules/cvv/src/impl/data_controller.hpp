@@ -28,8 +28,11 @@ class DataController
 
 	/**
 	 * Add a new call to the calls-list.
+	 *
+	 * @param showUI whether to pass control to the View-controller
+	 * afterwards.
 	 */
-	void addCall(std::unique_ptr<Call> call);
+	void addCall(std::unique_ptr<Call> call, bool showUI = true);
 
 	/**
 	 * Remove a call.
@@ -1,6 +1,6 @@
 #include "filter_call.hpp"
 
-#include "data_controller.hpp"
+#include "call_queue.hpp"
 
 #include "../util/util.hpp"
 
@@ -14,7 +14,7 @@ FilterCall::FilterCall(cv::InputArray in, cv::InputArray out,
                        QString description, QString requestedView)
     : Call( data,                   std::move(type),
 	    std::move(description), std::move(requestedView) ),
-      input_{ in.getMat().clone() }, output_{ out.getMat().clone() }
+      input_{ callMatrix(in) }, output_{ callMatrix(out) }
 {
 }
 
@@ -35,7 +35,7 @@ void debugFilterCall(cv::InputArray original, cv::InputArray result,
                      const CallMetaData &data, const char *description,
                      const char *view, const char *filter)
 {
-	dataController().addCall(util::make_unique<FilterCall>(
+	submitCall(util::make_unique<FilterCall>(
 	    original, result, data, filter,
 	    description ? QString::fromLocal8Bit(description)
 	                : QString{ "<no description>" },
@@ -36,22 +36,22 @@ class FilterCall : public Call
 	 */
 	const cv::Mat &original() const
 	{
-		return input_;
+		return loadedMatrix(0, input_);
 	}
 	/**
 	 * @returns the filtered image
 	 */
 	const cv::Mat &result() const
 	{
-		return output_;
+		return loadedMatrix(1, output_);
 	}
 
       private:
 	// TODO: in case we REALLY want to support several input-images: make
 	// this a std::vector
 	// TODO: those are typedefs for references, make it clean:
-	cv::Mat input_;
-	cv::Mat output_;
+	mutable cv::Mat input_;
+	mutable cv::Mat output_;
 };
 
 /**
@@ -1,5 +1,6 @@
 #include "opencv2/cvv/final_show.hpp"
 
+#include "call_queue.hpp"
 #include "data_controller.hpp"
 
 namespace cvv
@@ -9,6 +10,8 @@ namespace impl
 
 void finalShow()
 {
+	callQueue().stopDump();
+	moveCapturedCalls();
 	auto &controller = impl::dataController();
 	if (controller.numCalls() != 0)
 	{
@@ -4,7 +4,7 @@
 
 #include <QString>
 
-#include "data_controller.hpp"
+#include "call_queue.hpp"
 
 #include "../util/util.hpp"
 
@@ -20,8 +20,8 @@ MatchCall::MatchCall(cv::InputArray img1, std::vector<cv::KeyPoint> keypoints1,
                      bool useTrainDescriptor)
     : Call( data,                   std::move(type),
 	    std::move(description), std::move(requestedView) ),
-      img1_{ img1.getMat().clone() }, keypoints1_{ std::move(keypoints1) },
-      img2_{ img2.getMat().clone() }, keypoints2_{ std::move(keypoints2) },
+      img1_{ callMatrix(img1) }, keypoints1_{ std::move(keypoints1) },
+      img2_{ callMatrix(img2) }, keypoints2_{ std::move(keypoints2) },
       matches_{ std::move(matches) }, usesTrainDescriptor_{ useTrainDescriptor }
 {
 }
@@ -45,7 +45,7 @@ void debugMatchCall(cv::InputArray img1, std::vector<cv::KeyPoint> keypoints1,
                     const char *description, const char *view,
                     bool useTrainDescriptor)
 {
-	dataController().addCall(util::make_unique<MatchCall>(
+	submitCall(util::make_unique<MatchCall>(
 	    img1, std::move(keypoints1), img2, std::move(keypoints2),
 	    std::move(matches), data, "match",
 	    description ? QString::fromLocal8Bit(description)
@@ -41,7 +41,7 @@ class MatchCall : public Call
 	 */
 	const cv::Mat &img1() const
 	{
-		return img1_;
+		return loadedMatrix(0, img1_);
 	}
 
 	/**
@@ -49,7 +49,7 @@ class MatchCall : public Call
 	 */
 	const cv::Mat &img2() const
 	{
-		return img2_;
+		return loadedMatrix(1, img2_);
 	}
 
 	/**
@@ -82,9 +82,9 @@ class MatchCall : public Call
 	}
 
       private:
-	cv::Mat img1_;
+	mutable cv::Mat img1_;
 	std::vector<cv::KeyPoint> keypoints1_;
-	cv::Mat img2_;
+	mutable cv::Mat img2_;
 	std::vector<cv::KeyPoint> keypoints2_;
 	std::vector<cv::DMatch> matches_;
 	bool usesTrainDescriptor_;
@@ -0,0 +1,404 @@
+#include "session.hpp"
+
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#include <QByteArray>
+
+#include "opencv2/imgproc.hpp"
+
+#include "filter_call.hpp"
+#include "match_call.hpp"
+#include "single_image_call.hpp"
+
+#include "../util/util.hpp"
+
+namespace cvv
+{
+namespace impl
+{
+
+namespace
+{
+
+const QString sessionMagic{ "cvv-session" };
+const quint32 sessionVersion = 1;
+const int thumbnailSize = 160;
+
+enum CallKind : quint8
+{
+	SingleImageKind,
+	FilterKind,
+	MatchKind
+};
+
+void prepareStream(QDataStream &stream)
+{
+	stream.setVersion(QDataStream::Qt_5_0);
+	stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+void writeMat(QDataStream &stream, const cv::Mat &mat)
+{
+	cv::Mat data = mat.dims <= 2 ? mat : cv::Mat{};
+	if (!data.isContinuous())
+	{
+		data = data.clone();
+	}
+	stream << qint32(data.rows) << qint32(data.cols) << qint32(data.type());
+	if (data.empty())
+	{
+		stream << QByteArray{};
+		return;
+	}
+	// favour speed, the session is written while the program runs
+	stream << qCompress(data.data,
+	                    static_cast<int>(data.total() * data.elemSize()), 1);
+}
+
+cv::Mat decodeMat(qint32 rows, qint32 cols, qint32 type,
+                  const QByteArray &bytes)
+{
+	if (rows <= 0 || cols <= 0)
+	{
+		return cv::Mat{};
+	}
+	cv::Mat mat(rows, cols, type);
+	QByteArray raw = qUncompress(bytes);
+	if (static_cast<size_t>(raw.size()) != mat.total() * mat.elemSize())
+	{
+		throw std::runtime_error{ "corrupt image in cvv session file" };
+	}
+	std::memcpy(mat.data, raw.constData(), raw.size());
+	return mat;
+}
+
+cv::Mat readMat(QDataStream &stream)
+{
+	qint32 rows, cols, type;
+	QByteArray bytes;
+	stream >> rows >> cols >> type >> bytes;
+	if (stream.status() != QDataStream::Ok)
+	{
+		return cv::Mat{};
+	}
+	return decodeMat(rows, cols, type, bytes);
+}
+
+cv::Mat makeThumbnail(const cv::Mat &mat)
+{
+	int longest = std::max(mat.rows, mat.cols);
+	if (mat.empty() || mat.dims > 2 || longest <= thumbnailSize)
+	{
+		return mat;
+	}
+	// nearest neighbour handles every depth and channel count
+	double scale = static_cast<double>(thumbnailSize) / longest;
+	cv::Mat thumbnail;
+	cv::resize(mat, thumbnail, cv::Size{}, scale, scale, cv::INTER_NEAREST);
+	return thumbnail;
+}
+
+void writeKeyPoints(QDataStream &stream, const std::vector<cv::KeyPoint> &keypoints)
+{
+	stream << quint32(keypoints.size());
+	for (const auto &keypoint : keypoints)
+	{
+		stream << keypoint.pt.x << keypoint.pt.y << keypoint.size
+		       << keypoint.angle << keypoint.response
+		       << qint32(keypoint.octave) << qint32(keypoint.class_id);
+	}
+}
+
+std::vector<cv::KeyPoint> readKeyPoints(QDataStream &stream)
+{
+	quint32 count = 0;
+	stream >> count;
+	std::vector<cv::KeyPoint> keypoints;
+	for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+	{
+		cv::KeyPoint keypoint;
+		qint32 octave, classId;
+		stream >> keypoint.pt.x >> keypoint.pt.y >> keypoint.size >>
+		    keypoint.angle >> keypoint.response >> octave >> classId;
+		keypoint.octave = octave;
+		keypoint.class_id = classId;
+		keypoints.push_back(keypoint);
+	}
+	return keypoints;
+}
+
+void writeMatches(QDataStream &stream, const std::vector<cv::DMatch> &matches)
+{
+	stream << quint32(matches.size());
+	for (const auto &match : matches)
+	{
+		stream << qint32(match.queryIdx) << qint32(match.trainIdx)
+		       << qint32(match.imgIdx) << match.distance;
+	}
+}
+
+std::vector<cv::DMatch> readMatches(QDataStream &stream)
+{
+	quint32 count = 0;
+	stream >> count;
+	std::vector<cv::DMatch> matches;
+	for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+	{
+		qint32 queryIdx, trainIdx, imgIdx;
+		float distance;
+		stream >> queryIdx >> trainIdx >> imgIdx >> distance;
+		matches.emplace_back(queryIdx, trainIdx, imgIdx, distance);
+	}
+	return matches;
+}
+
+/**
+ * @brief An opened session file, shared by the calls read from it.
+ */
+class SessionFile
+{
+      public:
+	SessionFile(const QString &path) : file{ path }
+	{
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			throw std::runtime_error{
+				"can't open cvv session file " +
+				path.toStdString()
+			};
+		}
+	}
+
+	/**
+	 * @brief Returns a string that lives as long as the file, for the
+	 * CallMetaData of the calls.
+	 */
+	const char *string(const QString &str)
+	{
+		return strings.insert(str.toStdString()).first->c_str();
+	}
+
+	QFile file;
+
+      private:
+	std::set<std::string> strings;
+};
+
+/**
+ * @brief The matrices of a call read from a session file.
+ */
+class SessionImages : public ImageLoader
+{
+      public:
+	struct Entry
+	{
+		qint32 rows;
+		qint32 cols;
+		qint32 type;
+		qint64 offset;
+		cv::Mat thumbnail;
+	};
+
+	SessionImages(std::shared_ptr<SessionFile> session)
+	    : session_{ std::move(session) }
+	{
+	}
+
+	cv::Mat load(size_t index) const override
+	{
+		const Entry &entry = entries.at(index);
+		QFile &file = session_->file;
+		if (!file.seek(entry.offset))
+		{
+			throw std::runtime_error{ "can't read cvv session file" };
+		}
+		QDataStream stream{ &file };
+		prepareStream(stream);
+		QByteArray bytes;
+		stream >> bytes;
+		return decodeMat(entry.rows, entry.cols, entry.type, bytes);
+	}
+
+	cv::Mat thumbnail(size_t index) const override
+	{
+		return entries.at(index).thumbnail;
+	}
+
+	std::vector<Entry> entries;
+
+      private:
+	std::shared_ptr<SessionFile> session_;
+};
+}
+
+SessionWriter::SessionWriter(const QString &path) : file{ path }
+{
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		throw std::runtime_error{ "can't create cvv session file " +
+			                  path.toStdString() };
+	}
+	stream.setDevice(&file);
+	prepareStream(stream);
+	stream << sessionMagic << sessionVersion;
+}
+
+void SessionWriter::write(const Call &call)
+{
+	auto match = dynamic_cast<const MatchCall *>(&call);
+	CallKind kind;
+	if (match)
+	{
+		kind = MatchKind;
+	}
+	else if (dynamic_cast<const FilterCall *>(&call))
+	{
+		kind = FilterKind;
+	}
+	else if (dynamic_cast<const SingleImageCall *>(&call))
+	{
+		kind = SingleImageKind;
+	}
+	else
+	{
+		return;
+	}
+
+	const auto &data = call.metaData();
+	stream << quint8(kind) << call.type() << call.description()
+	       << call.requestedView() << data.isKnown;
+	if (data.isKnown)
+	{
+		stream << QString{ data.file } << QString{ data.function }
+		       << quint64(data.line);
+	}
+
+	stream << quint32(call.matrixCount());
+	for (size_t i = 0; i < call.matrixCount(); i++)
+	{
+		writeMat(stream, makeThumbnail(call.matrixAt(i)));
+	}
+	if (match)
+	{
+		writeKeyPoints(stream, match->keyPoints1());
+		writeKeyPoints(stream, match->keyPoints2());
+		writeMatches(stream, match->matches());
+		stream << match->usesTrainDescriptor();
+	}
+	for (size_t i = 0; i < call.matrixCount(); i++)
+	{
+		writeMat(stream, call.matrixAt(i));
+	}
+
+	// keep the file readable if the program dies
+	file.flush();
+}
+
+std::vector<std::unique_ptr<Call>> readSession(const QString &path)
+{
+	auto session = std::make_shared<SessionFile>(path);
+	QDataStream stream{ &session->file };
+	prepareStream(stream);
+
+	QString magic;
+	quint32 version = 0;
+	stream >> magic >> version;
+	if (magic != sessionMagic || version != sessionVersion)
+	{
+		throw std::runtime_error{ path.toStdString() +
+			                  " is no cvv session file" };
+	}
+
+	std::vector<std::unique_ptr<Call>> calls;
+	while (!stream.atEnd())
+	{
+		quint8 kind;
+		QString type, description, view;
+		bool isKnown = false;
+		QString file, function;
+		quint64 line = 0;
+		stream >> kind >> type >> description >> view >> isKnown;
+		if (isKnown)
+		{
+			stream >> file >> function >> line;
+		}
+
+		quint32 count = 0;
+		stream >> count;
+		auto images = std::make_shared<SessionImages>(session);
+		for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok;
+		     i++)
+		{
+			SessionImages::Entry entry{};
+			entry.thumbnail = readMat(stream);
+			images->entries.push_back(std::move(entry));
+		}
+
+		std::vector<cv::KeyPoint> keypoints1, keypoints2;
+		std::vector<cv::DMatch> matches;
+		bool useTrainDescriptor = true;
+		if (kind == MatchKind)
+		{
+			keypoints1 = readKeyPoints(stream);
+			keypoints2 = readKeyPoints(stream);
+			matches = readMatches(stream);
+			stream >> useTrainDescriptor;
+		}
+
+		// only remember where the matrices are
+		for (auto &entry : images->entries)
+		{
+			quint32 size = 0;
+			stream >> entry.rows >> entry.cols >> entry.type;
+			entry.offset = session->file.pos();
+			stream >> size;
+			if (size != 0xFFFFFFFF)
+			{
+				stream.skipRawData(size);
+			}
+		}
+
+		// a truncated last record is dropped
+		if (stream.status() != QDataStream::Ok)
+		{
+			break;
+		}
+
+		CallMetaData data =
+		    isKnown ? CallMetaData{ session->string(file), line,
+			                    session->string(function) }
+		            : CallMetaData{};
+		std::unique_ptr<Call> call;
+		switch (kind)
+		{
+		case MatchKind:
+			call = util::make_unique<MatchCall>(
+			    cv::Mat{}, std::move(keypoints1), cv::Mat{},
+			    std::move(keypoints2), std::move(matches), data, type,
+			    description, view, useTrainDescriptor);
+			break;
+		case FilterKind:
+			call = util::make_unique<FilterCall>(
+			    cv::Mat{}, cv::Mat{}, data, type, description, view);
+			break;
+		case SingleImageKind:
+			call = util::make_unique<SingleImageCall>(
+			    cv::Mat{}, data, type, description, view);
+			break;
+		default:
+			throw std::runtime_error{ "corrupt cvv session file " +
+				                  path.toStdString() };
+		}
+		if (images->entries.size() == call->matrixCount())
+		{
+			call->setImageLoader(images);
+		}
+		calls.push_back(std::move(call));
+	}
+	return calls;
+}
+}
+} // namespaces cvv::impl
@@ -0,0 +1,62 @@
+#ifndef CVVISUAL_SESSION_HPP
+#define CVVISUAL_SESSION_HPP
+
+#include <memory>
+#include <vector>
+
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+
+#include "call.hpp"
+
+namespace cvv
+{
+namespace impl
+{
+
+/**
+ * @brief Appends calls to a session file.
+ *
+ * A session file starts with a header and then holds one record per call:
+ * its type, description, requested view and location, a thumbnail of each
+ * matrix, the keypoints and matches of match-calls, and finally the
+ * matrices. The matrices are compressed with zlib. The records are written
+ * one after the other, so a file whose writing was interrupted can still be
+ * read up to its last complete record.
+ */
+class SessionWriter
+{
+      public:
+	/**
+	 * @brief Creates the file.
+	 * @throws std::runtime_error if the file can't be opened.
+	 */
+	SessionWriter(const QString &path);
+
+	/**
+	 * @brief Appends a call to the file.
+	 */
+	void write(const Call &call);
+
+      private:
+	QFile file;
+	QDataStream stream;
+};
+
+/**
+ * @brief Reads the calls of a session file.
+ *
+ * Only the descriptions, the thumbnails, the keypoints and the matches are
+ * read at once. The matrices are read from the file when they are first
+ * accessed.
+ *
+ * @throws std::runtime_error if the file can't be opened or is no session
+ * file.
+ */
+std::vector<std::unique_ptr<Call>> readSession(const QString &path);
+
+}
+} // namespaces cvv::impl
+
+#endif
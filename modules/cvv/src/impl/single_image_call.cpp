@@ -2,7 +2,7 @@
 
 #include <QString>
 
-#include "data_controller.hpp"
+#include "call_queue.hpp"
 
 #include "../util/util.hpp"
 
@@ -16,7 +16,7 @@ SingleImageCall::SingleImageCall(cv::InputArray img, impl::CallMetaData data,
                                  QString requestedView)
     : Call( data,                   std::move(type),
 	    std::move(description), std::move(requestedView) ),
-      img{ img.getMat().clone() }
+      img{ callMatrix(img) }
 {
 }
 
@@ -26,14 +26,14 @@ const cv::Mat &SingleImageCall::matrixAt(size_t index) const
 	{
 		throw std::out_of_range{ "" };
 	}
-	return img;
+	return mat();
 }
 
 void debugSingleImageCall(cv::InputArray img, const CallMetaData &data,
                           const char *description, const char *view,
                           const char *filter)
 {
-	dataController().addCall(util::make_unique<SingleImageCall>(
+	submitCall(util::make_unique<SingleImageCall>(
 	    img, data, filter, description ? QString::fromLocal8Bit(description)
 	                                   : QString{ "<no description>" },
 	    view ? QString::fromLocal8Bit(view) : QString{}));
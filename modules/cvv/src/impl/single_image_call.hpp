@@ -36,11 +36,11 @@ class SingleImageCall : public Call
 	 */
 	const cv::Mat &mat() const
 	{
-		return img;
+		return loadedMatrix(0, img);
 	}
 
       private:
-	cv::Mat img;
+	mutable cv::Mat img;
 };
 
 /**
@@ -0,0 +1,90 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef OPENCV_DATASETS_PREFETCH_HPP
+#define OPENCV_DATASETS_PREFETCH_HPP
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+namespace cv
+{
+namespace datasets
+{
+
+//! @addtogroup datasets
+//! @{
+
+#ifdef CV_CXX11
+/** @brief Decodes the images of a dataset in batches ahead of the training or benchmark loop.
+
+A worker thread reads the batches in order and decodes the images of every batch in parallel, up to
+@p queueSize batches are kept ready while the caller processes the current one. The paths are usually
+collected from the objects returned by Dataset::getTrain(), Dataset::getTest() or Dataset::getValidation().
+
+The images and the blob returned by next() point to buffers reused for the following batches, they stay
+valid until the next call of next(). Clone them to keep the data longer.
+ */
+class CV_EXPORTS ImagePrefetcher
+{
+public:
+    /** @brief Time spent by the prefetcher and its caller, in seconds. */
+    struct Stats
+    {
+        Stats() : waitTime(0), blockedTime(0), decodeTime(0), batches(0), images(0), failed(0) {}
+
+        double waitTime;    //!< the caller waited for a batch in next(), the loading is the bottleneck
+        double blockedTime; //!< the worker waited for the caller to release a batch, the processing is the bottleneck
+        double decodeTime;  //!< the worker read, decoded and converted the images
+        int batches;        //!< number of batches returned by next()
+        int images;         //!< number of images returned by next()
+        int failed;         //!< number of images which can't be read, they are returned empty
+    };
+
+    /** @brief Starts the worker thread.
+     *  @param files paths of the images.
+     *  @param batchSize number of images in a batch, the last batch may be smaller.
+     *  @param queueSize maximal number of decoded batches waiting for the caller.
+     *  @param flags flags passed to imread(), IMREAD_COLOR or IMREAD_GRAYSCALE if the blob is requested.
+     *  @param size if not empty, the images are resized to it and gathered into a blob.
+     *  @param scale multiplier of the blob values.
+     */
+    ImagePrefetcher(const std::vector<std::string>& files, int batchSize, int queueSize = 2,
+                    int flags = IMREAD_COLOR, Size size = Size(), double scale = 1.0);
+
+    /** @brief Stops the worker thread, the batches left are dropped. */
+    ~ImagePrefetcher();
+
+    /** @brief Returns the next batch, false if all the images have been returned.
+     *  @param images decoded images, resized if the size was passed to the constructor.
+     *  @param blob 4-dimensional CV_32F blob of the batch with NCHW layout (see dnn::blobFromImages()),
+     *  ready for dnn::Net::setInput(). It is empty if the size wasn't passed to the constructor. The
+     *  samples of the images which can't be read are filled by zeros.
+     */
+    bool next(std::vector<Mat>& images, Mat& blob);
+
+    /** @overload */
+    bool next(std::vector<Mat>& images);
+
+    /** @brief Returns the time spent so far. */
+    Stats getStats() const;
+
+private:
+    ImagePrefetcher(const ImagePrefetcher&);
+    ImagePrefetcher& operator=(const ImagePrefetcher&);
+
+    struct Impl;
+    Ptr<Impl> impl;
+};
+#endif
+
+//! @}
+
+}
+}
+
+#endif
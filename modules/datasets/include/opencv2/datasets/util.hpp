@@ -66,6 +66,16 @@ void CV_EXPORTS createDirectory(const std::string &path);
 
 void CV_EXPORTS getDirList(const std::string &dirName, std::vector<std::string> &fileNames);
 
+/** @brief Reads a list of strings stored by writeIndexCache.
+
+Returns false if the file is missing, damaged or was written with another key. The key identifies
+the state of the dataset the index was built from, for example the list of its top level folders.
+ */
+bool CV_EXPORTS readIndexCache(const std::string &fileName, const std::string &key, std::vector<std::string> &entries);
+
+/** @brief Stores a list of strings in a binary index file, returns false if the file can't be written. */
+bool CV_EXPORTS writeIndexCache(const std::string &fileName, const std::string &key, const std::vector<std::string> &entries);
+
 //! @}
 
 }
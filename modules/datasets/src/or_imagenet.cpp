@@ -42,6 +42,8 @@
 #include "opencv2/datasets/or_imagenet.hpp"
 #include "opencv2/datasets/util.hpp"
 
+#include <opencv2/core/utility.hpp>
+
 #include <map>
 
 namespace cv
@@ -51,6 +53,31 @@ namespace datasets
 
 using namespace std;
 
+// The folders of the synsets are listed in parallel, it's the longest part of the loading
+class SynsetListInvoker : public ParallelLoopBody
+{
+public:
+    SynsetListInvoker(const string &_pathTrain, const vector<string> &_synsets, vector< vector<string> > &_fileNames) :
+        pathTrain(_pathTrain), synsets(_synsets), fileNames(_fileNames)
+    {
+    }
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int i=range.start; i<range.end; ++i)
+        {
+            getDirList(pathTrain + synsets[i] + "/", fileNames[i]);
+        }
+    }
+
+private:
+    const string &pathTrain;
+    const vector<string> &synsets;
+    vector< vector<string> > &fileNames;
+
+    SynsetListInvoker& operator=(const SynsetListInvoker&);
+};
+
 class OR_imagenetImp : public OR_imagenet
 {
 public:
@@ -106,19 +133,50 @@ void OR_imagenetImp::loadDataset(const string &path)
         labels.insert(make_pair(syn, number));
     }
 
+    // The train images are listed once and stored in an index next to the dataset,
+    // the index is valid while the list of synsets is the same.
     string pathTrain(path + "train/");
-    vector<string> fileNames;
-    getDirList(pathTrain, fileNames);
-    for (vector<string>::iterator it=fileNames.begin(); it!=fileNames.end(); ++it)
+    vector<string> synsets;
+    getDirList(pathTrain, synsets);
+    string key;
+    for (vector<string>::iterator it=synsets.begin(); it!=synsets.end(); ++it)
+    {
+        key += *it + "\n";
+    }
+
+    string indexFile(path + "train_index.cache");
+    vector<string> index;
+    if (!readIndexCache(indexFile, key, index))
+    {
+        vector< vector<string> > fileNames(synsets.size());
+        parallel_for_(Range(0, (int)synsets.size()), SynsetListInvoker(pathTrain, synsets, fileNames));
+
+        // synset, followed by the number of its images and their names
+        for (size_t i=0; i<synsets.size(); ++i)
+        {
+            index.push_back(synsets[i]);
+            char numberStr[16];
+            sprintf(numberStr, "%u", (unsigned int)fileNames[i].size());
+            index.push_back(numberStr);
+            index.insert(index.end(), fileNames[i].begin(), fileNames[i].end());
+        }
+        writeIndexCache(indexFile, key, index);
+    }
+
+    for (size_t i=0; i+1<index.size(); )
     {
-        string pathSyn((*it) + "/");
-        vector<string> fileNamesSyn;
-        getDirList((pathTrain + pathSyn), fileNamesSyn);
-        for (vector<string>::iterator itSyn=fileNamesSyn.begin(); itSyn!=fileNamesSyn.end(); ++itSyn)
+        const string &syn = index[i];
+        int id = labels[syn];
+        size_t numImages = (size_t)atoi(index[i+1].c_str());
+        string pathSyn("train/" + syn + "/");
+        i += 2;
+
+        train.back().reserve(train.back().size() + numImages);
+        for (size_t j=0; j<numImages && i<index.size(); ++j, ++i)
         {
             Ptr<OR_imagenetObj> curr(new OR_imagenetObj);
-            curr->image = "train/" + pathSyn + *itSyn;
-            curr->id = labels[*it];
+            curr->image = pathSyn + index[i];
+            curr->id = id;
 
             train.back().push_back(curr);
         }
@@ -0,0 +1,273 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "opencv2/datasets/prefetch.hpp"
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#ifdef CV_CXX11
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <exception>
+
+namespace cv
+{
+namespace datasets
+{
+
+using namespace std;
+
+// Buffers of a batch, they are reused by the following batches once the caller releases them
+struct PrefetchBatch
+{
+    vector<Mat> images, resized, converted;
+    Mat blob;
+    int count;
+    int failed;
+};
+
+class DecodeInvoker : public ParallelLoopBody
+{
+public:
+    DecodeInvoker(const vector<string> &_files, int _first, int _flags, Size _size, double _scale,
+                  PrefetchBatch &_batch, vector<uchar> &_failed) :
+        files(_files), first(_first), flags(_flags), size(_size), scale(_scale), batch(_batch), failed(_failed)
+    {
+    }
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int i = range.start; i < range.end; ++i)
+        {
+            Mat img = imread(files[first + i], flags);
+            failed[i] = img.empty();
+
+            if (size.area() == 0)
+            {
+                batch.images[i] = img;
+                continue;
+            }
+
+            const int channels = batch.blob.size[1];
+            if (img.empty())
+            {
+                batch.images[i].release();
+                Mat(channels * size.height, size.width, CV_32F, batch.blob.ptr(i)).setTo(0);
+                continue;
+            }
+            CV_Assert(img.channels() == channels);
+
+            resize(img, batch.resized[i], size);
+            batch.images[i] = batch.resized[i];
+
+            // the planes are headers of the blob, split() writes into them
+            batch.resized[i].convertTo(batch.converted[i], CV_32F, scale);
+            vector<Mat> planes(channels);
+            for (int c = 0; c < channels; ++c)
+                planes[c] = Mat(size, CV_32F, batch.blob.ptr<float>(i, c));
+            split(batch.converted[i], planes);
+        }
+    }
+
+private:
+    const vector<string> &files;
+    int first;
+    int flags;
+    Size size;
+    double scale;
+    PrefetchBatch &batch;
+    vector<uchar> &failed;
+
+    DecodeInvoker& operator=(const DecodeInvoker&);
+};
+
+struct ImagePrefetcher::Impl
+{
+    typedef chrono::steady_clock Clock;
+
+    Impl(const vector<string> &files_, int batchSize_, int queueSize_, int flags_, Size size_, double scale_) :
+        files(files_), batchSize(batchSize_), flags(flags_), size(size_), scale(scale_),
+        pool(queueSize_ + 1), held(0), finished(false), stopped(false)
+    {
+        CV_Assert(batchSize > 0 && queueSize_ > 0);
+        CV_Assert(size.area() == 0 || (size.width > 0 && size.height > 0));
+        CV_Assert(size.area() == 0 || flags == IMREAD_COLOR || flags == IMREAD_GRAYSCALE);
+
+        const int channels = flags == IMREAD_GRAYSCALE ? 1 : 3;
+        for (size_t k = 0; k < pool.size(); ++k)
+        {
+            PrefetchBatch &batch = pool[k];
+            batch.images.resize(batchSize);
+            batch.count = batch.failed = 0;
+            if (size.area() > 0)
+            {
+                batch.resized.resize(batchSize);
+                batch.converted.resize(batchSize);
+                const int blobSize[] = {batchSize, channels, size.height, size.width};
+                batch.blob.create(4, blobSize, CV_32F);
+            }
+            freeBatches.push_back(&batch);
+        }
+
+        worker = thread(&Impl::run, this);
+    }
+
+    ~Impl()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopped = true;
+        }
+        cond.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void run()
+    {
+        try
+        {
+            vector<uchar> failed(batchSize);
+            for (int first = 0; first < (int)files.size(); first += batchSize)
+            {
+                PrefetchBatch *batch;
+                {
+                    unique_lock<mutex> lock(mtx);
+                    const Clock::time_point start = Clock::now();
+                    cond.wait(lock, [this]{ return stopped || !freeBatches.empty(); });
+                    stats.blockedTime += chrono::duration<double>(Clock::now() - start).count();
+                    if (stopped)
+                        return;
+                    batch = freeBatches.front();
+                    freeBatches.pop_front();
+                }
+
+                const Clock::time_point start = Clock::now();
+                batch->count = min(batchSize, (int)files.size() - first);
+                parallel_for_(Range(0, batch->count), DecodeInvoker(files, first, flags, size, scale, *batch, failed));
+                batch->failed = 0;
+                for (int i = 0; i < batch->count; ++i)
+                    batch->failed += failed[i];
+                const double decodeTime = chrono::duration<double>(Clock::now() - start).count();
+
+                {
+                    lock_guard<mutex> lock(mtx);
+                    stats.decodeTime += decodeTime;
+                    readyBatches.push_back(batch);
+                }
+                cond.notify_all();
+            }
+        }
+        catch (...)
+        {
+            lock_guard<mutex> lock(mtx);
+            error = current_exception();
+        }
+
+        {
+            lock_guard<mutex> lock(mtx);
+            finished = true;
+        }
+        cond.notify_all();
+    }
+
+    bool next(vector<Mat> &images, Mat &blob)
+    {
+        unique_lock<mutex> lock(mtx);
+        if (held)
+        {
+            freeBatches.push_back(held);
+            held = 0;
+            cond.notify_all();
+        }
+
+        const Clock::time_point start = Clock::now();
+        cond.wait(lock, [this]{ return finished || !readyBatches.empty(); });
+        stats.waitTime += chrono::duration<double>(Clock::now() - start).count();
+
+        if (readyBatches.empty())
+        {
+            if (error)
+                rethrow_exception(error);
+            images.clear();
+            blob.release();
+            return false;
+        }
+
+        held = readyBatches.front();
+        readyBatches.pop_front();
+        stats.batches++;
+        stats.images += held->count;
+        stats.failed += held->failed;
+
+        images.assign(held->images.begin(), held->images.begin() + held->count);
+        if (held->blob.empty())
+            blob.release();
+        else if (held->count == batchSize)
+            blob = held->blob;
+        else
+        {
+            int blobSize[] = {held->count, held->blob.size[1], held->blob.size[2], held->blob.size[3]};
+            blob = Mat(4, blobSize, CV_32F, held->blob.data);
+        }
+        return true;
+    }
+
+    Stats getStats()
+    {
+        lock_guard<mutex> lock(mtx);
+        return stats;
+    }
+
+    vector<string> files;
+    int batchSize;
+    int flags;
+    Size size;
+    double scale;
+
+    vector<PrefetchBatch> pool;
+    deque<PrefetchBatch*> freeBatches, readyBatches;
+    PrefetchBatch *held;
+    Stats stats;
+
+    mutex mtx;
+    condition_variable cond;
+    bool finished, stopped;
+    exception_ptr error;
+    thread worker;
+};
+
+ImagePrefetcher::ImagePrefetcher(const vector<string> &files, int batchSize, int queueSize, int flags, Size size, double scale) :
+    impl(new Impl(files, batchSize, queueSize, flags, size, scale))
+{
+}
+
+ImagePrefetcher::~ImagePrefetcher()
+{
+}
+
+bool ImagePrefetcher::next(vector<Mat> &images, Mat &blob)
+{
+    return impl->next(images, blob);
+}
+
+bool ImagePrefetcher::next(vector<Mat> &images)
+{
+    Mat blob;
+    return impl->next(images, blob);
+}
+
+ImagePrefetcher::Stats ImagePrefetcher::getStats() const
+{
+    return impl->getStats();
+}
+
+}
+}
+
+#endif // CV_CXX11
@@ -42,6 +42,8 @@
 #include "opencv2/datasets/slam_kitti.hpp"
 #include "opencv2/datasets/util.hpp"
 
+#include <opencv2/core/utility.hpp>
+
 namespace cv
 {
 namespace datasets
@@ -72,42 +74,40 @@ void SLAM_kittiImp::load(const string &path)
     loadDataset(path);
 }
 
-void SLAM_kittiImp::loadDataset(const string &path)
+// Every sequence is loaded independently: the file lists if they are not taken from the index,
+// the times, the calibration and the poses.
+class SequenceLoadInvoker : public ParallelLoopBody
 {
-    train.push_back(vector< Ptr<Object> >());
-    test.push_back(vector< Ptr<Object> >());
-    validation.push_back(vector< Ptr<Object> >());
-
-    string pathSequence(path + "sequences/");
-    vector<string> fileNames;
-    getDirList(pathSequence, fileNames);
-    for (vector<string>::iterator it=fileNames.begin(); it!=fileNames.end(); ++it)
+public:
+    SequenceLoadInvoker(const string &_path, bool _listFiles, vector< Ptr<SLAM_kittiObj> > &_sequences) :
+        path(_path), listFiles(_listFiles), sequences(_sequences)
     {
-        Ptr<SLAM_kittiObj> curr(new SLAM_kittiObj);
-        curr->name = *it;
-
-        string currPath(pathSequence + curr->name);
+    }
 
-        // loading velodyne
-        string pathVelodyne(currPath + "/velodyne/");
-        vector<string> velodyneNames;
-        getDirList(pathVelodyne, velodyneNames);
-        for (vector<string>::iterator itV=velodyneNames.begin(); itV!=velodyneNames.end(); ++itV)
+    virtual void operator()(const Range &range) const
+    {
+        for (int s=range.start; s<range.end; ++s)
         {
-            curr->velodyne.push_back(*itV);
+            loadSequence(*sequences[s]);
         }
+    }
+
+private:
+    void loadSequence(SLAM_kittiObj &curr) const
+    {
+        string currPath(path + "sequences/" + curr.name);
 
-        // loading gray & color images
-        for (unsigned int i=0; i<=3; ++i)
+        if (listFiles)
         {
-            char tmp[2];
-            sprintf(tmp, "%u", i);
-            string pathImage(currPath + "/image_" + tmp + "/");
-            vector<string> imageNames;
-            getDirList(pathImage, imageNames);
-            for (vector<string>::iterator itImage=imageNames.begin(); itImage!=imageNames.end(); ++itImage)
+            // loading velodyne
+            getDirList(currPath + "/velodyne/", curr.velodyne);
+
+            // loading gray & color images
+            for (unsigned int i=0; i<=3; ++i)
             {
-                curr->images[i].push_back(*itImage);
+                char tmp[2];
+                sprintf(tmp, "%u", i);
+                getDirList(currPath + "/image_" + tmp + "/", curr.images[i]);
             }
         }
 
@@ -116,7 +116,7 @@ void SLAM_kittiImp::loadDataset(const string &path)
         string line;
         while (getline(infile, line))
         {
-            curr->times.push_back(atof(line.c_str()));
+            curr.times.push_back(atof(line.c_str()));
         }
 
         // loading calibration
@@ -129,12 +129,12 @@ void SLAM_kittiImp::loadDataset(const string &path)
             vector<string>::iterator itE=elems.begin();
             for (++itE; itE!=elems.end(); ++itE)
             {
-                curr->p[i].push_back(atof((*itE).c_str()));
+                curr.p[i].push_back(atof((*itE).c_str()));
             }
         }
 
         // loading poses
-        ifstream infile3((path + "poses/" + curr->name + ".txt").c_str());
+        ifstream infile3((path + "poses/" + curr.name + ".txt").c_str());
         while (getline(infile3, line))
         {
             pose p;
@@ -151,10 +151,106 @@ void SLAM_kittiImp::loadDataset(const string &path)
                 p.elem[i] = atof((*itE).c_str());
             }
 
-            curr->posesArray.push_back(p);
+            curr.posesArray.push_back(p);
         }
+    }
+
+    const string &path;
+    bool listFiles;
+    vector< Ptr<SLAM_kittiObj> > &sequences;
+
+    SequenceLoadInvoker& operator=(const SequenceLoadInvoker&);
+};
+
+static void appendList(vector<string> &index, const vector<string> &list)
+{
+    char numberStr[16];
+    sprintf(numberStr, "%u", (unsigned int)list.size());
+    index.push_back(numberStr);
+    index.insert(index.end(), list.begin(), list.end());
+}
 
-        train.back().push_back(curr);
+static bool readList(const vector<string> &index, size_t &pos, vector<string> &list)
+{
+    if (pos >= index.size())
+    {
+        return false;
+    }
+    size_t count = (size_t)atoi(index[pos++].c_str());
+    if (pos + count > index.size())
+    {
+        return false;
+    }
+    list.assign(index.begin() + pos, index.begin() + pos + count);
+    pos += count;
+    return true;
+}
+
+void SLAM_kittiImp::loadDataset(const string &path)
+{
+    train.push_back(vector< Ptr<Object> >());
+    test.push_back(vector< Ptr<Object> >());
+    validation.push_back(vector< Ptr<Object> >());
+
+    string pathSequence(path + "sequences/");
+    vector<string> fileNames;
+    getDirList(pathSequence, fileNames);
+
+    vector< Ptr<SLAM_kittiObj> > sequences;
+    string key;
+    for (vector<string>::iterator it=fileNames.begin(); it!=fileNames.end(); ++it)
+    {
+        Ptr<SLAM_kittiObj> curr(new SLAM_kittiObj);
+        curr->name = *it;
+        sequences.push_back(curr);
+        key += *it + "\n";
+    }
+
+    // The file lists of the sequences are stored in an index next to the dataset: per sequence
+    // the velodyne list and the lists of the 4 images, each as a count followed by the names
+    string indexFile(path + "sequences_index.cache");
+    vector<string> index;
+    bool cached = readIndexCache(indexFile, key, index);
+    size_t pos = 0;
+    for (size_t s=0; cached && s<sequences.size(); ++s)
+    {
+        cached = readList(index, pos, sequences[s]->velodyne);
+        for (unsigned int i=0; cached && i<=3; ++i)
+        {
+            cached = readList(index, pos, sequences[s]->images[i]);
+        }
+    }
+    if (!cached)
+    {
+        for (size_t s=0; s<sequences.size(); ++s)
+        {
+            sequences[s]->velodyne.clear();
+            for (unsigned int i=0; i<=3; ++i)
+            {
+                sequences[s]->images[i].clear();
+            }
+        }
+    }
+
+    parallel_for_(Range(0, (int)sequences.size()), SequenceLoadInvoker(path, !cached, sequences));
+
+    if (!cached)
+    {
+        index.clear();
+        for (size_t s=0; s<sequences.size(); ++s)
+        {
+            appendList(index, sequences[s]->velodyne);
+            for (unsigned int i=0; i<=3; ++i)
+            {
+                appendList(index, sequences[s]->images[i]);
+            }
+        }
+        writeIndexCache(indexFile, key, index);
+    }
+
+    for (size_t s=0; s<sequences.size(); ++s)
+    {
+        train.back().push_back(sequences[s]);
     }
 }
 
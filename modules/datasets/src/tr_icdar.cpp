@@ -45,6 +45,8 @@
 #include <sstream>
 #include <fstream>
 
+#include <opencv2/core/utility.hpp>
+
 
 namespace cv
 {
@@ -65,10 +67,10 @@ public:
 private:
     void loadDataset(const string &path);
 
-    void objParseFiles(const string &path, int img_id, vector<Ptr <Object> > &out);
+    void loadImages(const string &path, int numImages, vector<Ptr <Object> > &out);
 };
 
-void TR_icdarImp::objParseFiles(const string &path, int img_id, vector<Ptr <Object> > &out)
+static void objParseFiles(const string &path, int img_id, Ptr<Object> &out)
 {
     Ptr<TR_icdarObj> curr(new TR_icdarObj);
 
@@ -136,7 +138,52 @@ void TR_icdarImp::objParseFiles(const string &path, int img_id, vector<Ptr <Obje
     }
     infile.close();
 
-    out.push_back(curr);
+    out = curr;
+}
+
+// The descriptions of the images are parsed in parallel, the errors are reported once all the workers stopped
+class ImagesParseInvoker : public ParallelLoopBody
+{
+public:
+    ImagesParseInvoker(const string &_path, vector< Ptr<Object> > &_objects, vector<string> &_errors) :
+        path(_path), objects(_objects), errors(_errors)
+    {
+    }
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int i=range.start; i<range.end; ++i)
+        {
+            try
+            {
+                objParseFiles(path, i+1, objects[i]);
+            }
+            catch (const cv::Exception &e)
+            {
+                errors[i] = e.err;
+            }
+        }
+    }
+
+private:
+    const string &path;
+    vector< Ptr<Object> > &objects;
+    vector<string> &errors;
+
+    ImagesParseInvoker& operator=(const ImagesParseInvoker&);
+};
+
+void TR_icdarImp::loadImages(const string &path, int numImages, vector<Ptr <Object> > &out)
+{
+    vector< Ptr<Object> > objects(numImages);
+    vector<string> errors(numImages);
+    parallel_for_(Range(0, numImages), ImagesParseInvoker(path, objects, errors));
+
+    for (int i=0; i<numImages; ++i)
+    {
+        if (!errors[i].empty()) CV_Error(Error::StsBadArg, errors[i].c_str());
+    }
+    out.insert(out.end(), objects.begin(), objects.end());
 }
 
 /*TR_icdarImp::TR_icdarImp(const string &path)
@@ -159,12 +206,10 @@ void TR_icdarImp::loadDataset(const string &path)
     string test_path (path + "/test/");
 
     // loading 229 train images descriptions
-    for (int i=1; i<230; i++)
-        objParseFiles(train_path, i, train.back());
+    loadImages(train_path, 229, train.back());
 
     // loading 233 test images descriptions
-    for (int i=1; i<234; i++)
-        objParseFiles(test_path, i, test.back());
+    loadImages(test_path, 233, test.back());
 }
 
 Ptr<TR_icdar> TR_icdar::create()
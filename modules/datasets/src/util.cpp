@@ -42,6 +42,7 @@
 #include "opencv2/datasets/util.hpp"
 
 #include <cstdlib>
+#include <cstring>
 
 #include <sstream>
 
@@ -116,5 +117,77 @@ void getDirList(const string &dirName, vector<string> &fileNames)
 #endif
 }
 
+static const char indexCacheMagic[8] = { 'O', 'C', 'V', 'D', 'S', 'I', 'D', 'X' };
+static const unsigned int indexCacheVersion = 1;
+
+static bool readIndexString(ifstream &infile, string &str)
+{
+    unsigned int length = 0;
+    if (!infile.read((char *)&length, sizeof(length)) || length > (1u << 24))
+    {
+        return false;
+    }
+    str.resize(length);
+    return length == 0 || infile.read(&str[0], length);
+}
+
+static void writeIndexString(ofstream &outfile, const string &str)
+{
+    unsigned int length = (unsigned int)str.size();
+    outfile.write((const char *)&length, sizeof(length));
+    outfile.write(str.data(), length);
+}
+
+bool readIndexCache(const string &fileName, const string &key, vector<string> &entries)
+{
+    ifstream infile(fileName.c_str(), ios::binary);
+    if (!infile.is_open())
+    {
+        return false;
+    }
+
+    char magic[sizeof(indexCacheMagic)];
+    unsigned int version = 0, count = 0;
+    string storedKey;
+    if (!infile.read(magic, sizeof(magic)) || memcmp(magic, indexCacheMagic, sizeof(magic)) != 0 ||
+        !infile.read((char *)&version, sizeof(version)) || version != indexCacheVersion ||
+        !readIndexString(infile, storedKey) || storedKey != key ||
+        !infile.read((char *)&count, sizeof(count)))
+    {
+        return false;
+    }
+
+    vector<string> stored(count);
+    for (unsigned int i=0; i<count; ++i)
+    {
+        if (!readIndexString(infile, stored[i]))
+        {
+            return false;
+        }
+    }
+    entries.swap(stored);
+    return true;
+}
+
+bool writeIndexCache(const string &fileName, const string &key, const vector<string> &entries)
+{
+    ofstream outfile(fileName.c_str(), ios::binary | ios::trunc);
+    if (!outfile.is_open())
+    {
+        return false;
+    }
+
+    unsigned int count = (unsigned int)entries.size();
+    outfile.write(indexCacheMagic, sizeof(indexCacheMagic));
+    outfile.write((const char *)&indexCacheVersion, sizeof(indexCacheVersion));
+    writeIndexString(outfile, key);
+    outfile.write((const char *)&count, sizeof(count));
+    for (unsigned int i=0; i<count; ++i)
+    {
+        writeIndexString(outfile, entries[i]);
+    }
+    return outfile.good();
+}
+
 }
 }
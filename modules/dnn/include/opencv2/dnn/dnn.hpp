@@ -45,6 +45,9 @@
 #include <vector>
 #include <opencv2/core.hpp>
 #include <opencv2/dnn/dict.hpp>
+#ifdef CV_CXX11
+#include <future>
+#endif
 
 namespace cv
 {
@@ -61,7 +64,8 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
     enum Backend
     {
         DNN_BACKEND_DEFAULT,
-        DNN_BACKEND_HALIDE
+        DNN_BACKEND_HALIDE,
+        DNN_BACKEND_OPENCL  //!< Blobs are kept on OpenCL device as cv::UMat during the forward pass.
     };
 
     /**
@@ -215,6 +219,20 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
          */
         virtual Ptr<BackendNode> initHalide(const std::vector<Ptr<BackendWrapper> > &inputs);
 
+        /**
+         * @brief Computes layer output on OpenCL device.
+         * @param[in] inputs Input blobs on device.
+         * @param[out] outputs Allocated output blobs on device.
+         * @param[out] internals Allocated internal blobs on device.
+         * @returns false if layer can't be computed on device for current
+         * parameters. In this case the default implementation is used.
+         *
+         * Called instead of forward() for DNN_BACKEND_OPENCL if supportBackend()
+         * returns true for it. Device blobs have the same shapes as host ones.
+         */
+        virtual bool forwardOCL(std::vector<UMat*> &inputs, std::vector<UMat> &outputs,
+                                std::vector<UMat> &internals);
+
        /**
         * @brief Automatic Halide scheduling based on layer hyper-parameters.
         * @param[in] node Backend node with Halide functions.
@@ -240,6 +258,58 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
          */
         virtual Ptr<BackendNode> tryAttach(const Ptr<BackendNode>& node);
 
+        /**
+         * @brief Switches layer to computations with 8-bit integer weights and inputs.
+         * @param[in] inputMaxAbs maximal absolute value of layer input observed at calibration.
+         * @returns true if layer supports quantized computations.
+         * @see Net::enableInt8
+         */
+        virtual bool tryQuantize(float inputMaxAbs);
+
+        /**
+         * @brief Switches layer to half precision storage of weights.
+         * @returns true if layer's weights are stored in half precision.
+         * @see Net::enableFP16
+         */
+        virtual bool tryConvertFp16();
+
+        /**
+         * @brief Tries to fuse the next layer into the current one.
+         * @param[in] top layer which consumes the only output of the current layer.
+         * @returns true if @p top is fused and mustn't be computed separately.
+         * @see Net::enableFusion
+         *
+         * Actual for DNN_BACKEND_DEFAULT. In example, convolution folds batch
+         * normalization into its weights and applies activation on its output.
+         */
+        virtual bool tryFuse(Ptr<Layer>& top);
+
+        /**
+         * @brief Returns parameters of layers with channel-wise multiplication and addition.
+         * @param[out] scale Channel-wise multipliers. Total number of values should
+         *                   be equal to number of channels.
+         * @param[out] shift Channel-wise offsets. Total number of values should
+         *                   be equal to number of channels.
+         *
+         * Some layers can fuse their transformations with further layers.
+         * In example, convolution + batch normalization. This way base layer
+         * use weights from layer after it. Fused layer is skipped.
+         * By default, @p scale and @p shift are empty that means layer has no
+         * element-wise multiplications or additions.
+         */
+        virtual void getScaleShift(Mat& scale, Mat& shift) const;
+
+        /**
+         * @brief Returns a copy of the layer which shares learned parameters with it.
+         * @returns Empty pointer by default that means the layer is created again
+         * from its parameters.
+         * @see Net::clone
+         *
+         * Copy must not share buffers which are modified during the forward pass
+         * because original and copied layers might be used simultaneously.
+         */
+        virtual Ptr<Layer> clone() const;
+
         virtual bool getMemoryShapes(const std::vector<MatShape> &inputs,
                                      const int requiredOutputs,
                                      std::vector<MatShape> &outputs,
@@ -276,6 +346,14 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
         /** Returns true if there are no layers in the network. */
         CV_WRAP bool empty() const;
 
+        /** @brief Creates a copy of the network which shares learned weights with this one.
+         *  @details The copy has its own intermediate blobs so copies might be used for
+         *  inference in separate threads simultaneously. Call it after the first forward pass
+         *  to share weights prepared by layers (i.e. fused or quantized ones) as well.
+         *  Weights mustn't be changed by setParam() while copies are in use.
+         */
+        CV_WRAP Net clone() const;
+
         /** @brief Adds new layer to the net.
          *  @param name   unique name of the adding layer.
          *  @param type   typename of the adding layer (type must be registered in LayerRegister).
@@ -346,6 +424,19 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
           */
         CV_WRAP Mat forward(const String& outputName = String());
 
+#ifdef CV_CXX11
+        /** @brief Runs forward pass asynchronously to compute output of layer with name @p outputName.
+         *  @param outputName name for layer which output is needed to get
+         *  @return future holding blob for first output of specified layer.
+         *  @details Layers which don't depend on each other (i.e. branches of Inception
+         *  blocks or SSD heads) are computed by different threads. Memory is planned so
+         *  blobs of such layers never intersect, that might increase memory consumption.
+         *  Network mustn't be modified or used until the result is ready.
+         *  Layers of backends other than DNN_BACKEND_DEFAULT are computed sequentially.
+         */
+        std::future<Mat> forwardAsync(const String& outputName = String());
+#endif
+
         /** @brief Runs forward pass to compute output of layer with name @p outputName.
          *  @param outputBlobs contains all output blobs for specified layer.
          *  @param outputName name for layer which output is needed to get
@@ -387,6 +478,20 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
          */
         void setHalideScheduler(const String& scheduler);
 
+        /**
+         * @brief Enables or disables autotuning of Halide schedules.
+         * @param[in] autotuning true to benchmark candidate schedules of Halide layers.
+         * @param[in] cacheFile Path to YAML file with the best schedules found before.
+         * @see setHalideScheduler
+         *
+         * Layers which aren't represented in scheduling file get the fastest of
+         * candidate tilings and vectorizations during the first forward pass.
+         * Schedules are saved to the file for every shape of layer and host CPU,
+         * so the next runs on the same machine load them without benchmarking.
+         * Empty path means that found schedules aren't saved.
+         */
+        void enableHalideAutotuning(bool autotuning, const String& cacheFile = String());
+
         /**
          * @brief Ask network to use specific computation backend where it supported.
          * @param[in] backendId backend identifier.
@@ -394,6 +499,34 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
          */
         void setPreferableBackend(int backendId);
 
+        /** @brief Enables or disables layers fusion in the network.
+         *  @param fusion true to enable the fusion, false to disable. The fusion is enabled by default.
+         *  @details Batch normalization, scale and activation layers which follow a convolution
+         *  are merged into it before memory allocation (only for DNN_BACKEND_DEFAULT).
+         *  Weights of fused layers are modified, so outputs of such convolutions can't be retrieved
+         *  unchanged after the first forward pass. Call this method before forward() to get them.
+         */
+        CV_WRAP void enableFusion(bool fusion);
+
+        /** @brief Switches network to computations with 8-bit integers where it's supported.
+         *  @param calibrationBlobs set of input blobs used to estimate ranges of layers inputs.
+         *  @param inputName name of the network input calibration blobs are passed to (see setInput()).
+         *  @details Network makes forward pass for every calibration blob and collects maximal absolute
+         *  values of layers inputs. Then weights of convolution and fully connected layers are quantized
+         *  with per output channel scales and their inputs are quantized with per tensor scales.
+         *  Products are accumulated in 32-bit integers. Works only for DNN_BACKEND_DEFAULT.
+         */
+        CV_WRAP void enableInt8(const std::vector<Mat>& calibrationBlobs, const String& inputName = "");
+
+        /** @brief Stores weights of convolution and fully connected layers in half precision.
+         *  @details Weights are converted after layers fusion at the next forward pass and
+         *  stored as CV_16S matrices of half precision values (see cv::convertFp16). They are
+         *  converted to single precision by blocks inside the layers so memory footprint
+         *  and bandwidth of weights are halved. Computations and blobs stay in single precision.
+         *  Works only for DNN_BACKEND_DEFAULT, the conversion can't be reverted.
+         */
+        CV_WRAP void enableFP16();
+
         /** @brief Sets the new value for the layer output blob
          *  @param name descriptor of the updating layer output blob.
          *  @param blob new blob.
@@ -492,6 +625,8 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
           * @param netInputShapes vector of shapes for all net inputs.
           * @param weights output parameter to store resulting bytes for weights.
           * @param blobs output parameter to store resulting bytes for intermediate blobs.
+          * @details Intermediate blobs which aren't used at the same time share memory,
+          * so @p blobs is a peak memory consumption planned for the forward pass.
           */
          CV_WRAP void getMemoryConsumption(const std::vector<MatShape>& netInputShapes,
                                            size_t& weights, size_t& blobs) const;
@@ -521,11 +656,79 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
          CV_WRAP void getMemoryConsumption(const MatShape& netInputShape,
                                            std::vector<int>& layerIds, std::vector<size_t>& weights,
                                            std::vector<size_t>& blobs) const;
+
+         /** @brief Returns overall time for inference and timings (in ticks) for layers.
+          * @param[out] timings vector for tick timings for all layers. Indexes correspond
+          * to layers ids, the element of the network input layer is always zero.
+          * @return overall ticks for model inference.
+          * @details Timings are measured at the last forward pass. Layers fused with
+          * others (see enableFusion()) or not computed at all have zero timings.
+          * Divide by cv::getTickFrequency() to get seconds.
+          */
+         CV_WRAP int64 getPerfProfile(CV_OUT std::vector<double>& timings);
+
+         /** @brief Writes timings of the last forward pass in Chrome trace event format.
+          * @param path path to output JSON file. It might be opened at chrome://tracing.
+          * @details Every computed layer is a complete event which category is a layer type.
+          * Arguments of event are layer id, backend that computed the layer and fusion flag.
+          */
+         CV_WRAP void writePerfTrace(const String& path);
+    private:
+
+        struct Impl;
+        Ptr<Impl> impl;
+    };
+
+#ifdef CV_CXX11
+    /** @brief Gathers independent inference requests into batches and runs them through a single forward pass.
+     *
+     * Requests pushed from any number of threads are accumulated by a worker thread
+     * until either @p maxBatchSize requests with the same shape are waiting or the oldest
+     * of them has been waiting for @p maxLatency milliseconds. The gathered blobs are
+     * stacked along the first axis, passed through Net::forward() once and the output
+     * is split back by the first axis, so every caller receives its own result.
+     *
+     * The network is owned by the queue while it is running: don't call Net::forward()
+     * or Net::setInput() for the same Net instance from other threads.
+     *
+     * @note The first dimension of the requested output must be equal to the batch size.
+     * Otherwise the error is reported through the futures of the batch requests.
+     */
+    class CV_EXPORTS InferenceQueue
+    {
+    public:
+        /** @brief Creates the queue and starts its worker thread.
+         *  @param net network used for computations.
+         *  @param maxBatchSize maximal number of requests processed by a single forward pass.
+         *  @param maxLatency maximal time in milliseconds the first request of a batch waits for others.
+         *  @param inputName name of the network input the batch is passed to (see Net::setInput()).
+         *  @param outputName name of the layer which output is returned (see Net::forward()).
+         */
+        InferenceQueue(const Net& net, int maxBatchSize, double maxLatency,
+                       const String& inputName = String(), const String& outputName = String());
+
+        /** @brief Processes all the pending requests and stops the worker thread. */
+        ~InferenceQueue();
+
+        /** @brief Adds a request to the queue.
+         *  @param blob input blob with the batch dimension equal to 1 (see blobFromImage()).
+         *  @returns future holding the output blob with the batch dimension equal to 1.
+         */
+        std::future<Mat> push(const Mat& blob);
+
+        /** @brief Processes all the pending requests and stops the worker thread.
+         *  @details Requests pushed after this call are rejected with an error.
+         */
+        void stop();
+
     private:
+        InferenceQueue(const InferenceQueue&);
+        InferenceQueue& operator=(const InferenceQueue&);
 
         struct Impl;
         Ptr<Impl> impl;
     };
+#endif
 
     /** @brief Small interface class for loading trained serialized models of different dnn-frameworks. */
     class CV_EXPORTS_W Importer
@@ -541,19 +744,26 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
     /** @brief Creates the importer of <a href="http://caffe.berkeleyvision.org">Caffe</a> framework network.
      *  @param prototxt   path to the .prototxt file with text description of the network architecture.
      *  @param caffeModel path to the .caffemodel file with learned network.
+     *  @param mapWeights  map @p caffeModel into memory and use weights from there without copying.
      *  @returns Pointer to the created importer, NULL in failure cases.
+     *
+     *  Mapped weights are shared between the processes loading the same model
+     *  until one of them changes the blobs. The file is kept mapped while the
+     *  loaded blobs are in use so it must not be modified meanwhile.
      */
-    CV_EXPORTS_W Ptr<Importer> createCaffeImporter(const String &prototxt, const String &caffeModel = String());
+    CV_EXPORTS_W Ptr<Importer> createCaffeImporter(const String &prototxt, const String &caffeModel = String(),
+                                                   bool mapWeights = false);
 
     /** @brief Reads a network model stored in Caffe model files.
       * @details This is shortcut consisting from createCaffeImporter and Net::populateNet calls.
       */
-    CV_EXPORTS_W Net readNetFromCaffe(const String &prototxt, const String &caffeModel = String());
+    CV_EXPORTS_W Net readNetFromCaffe(const String &prototxt, const String &caffeModel = String(),
+                                      bool mapWeights = false);
 
     /** @brief Reads a network model stored in Tensorflow model file.
       * @details This is shortcut consisting from createTensorflowImporter and Net::populateNet calls.
       */
-    CV_EXPORTS_W Net readNetFromTensorflow(const String &model);
+    CV_EXPORTS_W Net readNetFromTensorflow(const String &model, bool mapWeights = false);
 
     /** @brief Reads a network model stored in Torch model file.
       * @details This is shortcut consisting from createTorchImporter and Net::populateNet calls.
@@ -562,9 +772,13 @@ namespace dnn //! This namespace is used for dnn module functionlaity.
 
     /** @brief Creates the importer of <a href="http://www.tensorflow.org">TensorFlow</a> framework network.
      *  @param model   path to the .pb file with binary protobuf description of the network architecture.
+     *  @param mapWeights map @p model into memory and read weights from there, see createCaffeImporter().
      *  @returns Pointer to the created importer, NULL in failure cases.
+     *
+     *  Four-dimensional kernels are reordered from NHWC layout so only the rest
+     *  of blobs refer to the mapped file.
      */
-    CV_EXPORTS Ptr<Importer> createTensorflowImporter(const String &model);
+    CV_EXPORTS Ptr<Importer> createTensorflowImporter(const String &model, bool mapWeights = false);
 
     /** @brief Creates the importer of <a href="http://torch.ch">Torch7</a> framework network.
      *  @param filename path to the file, dumped from Torch by using torch.save() function.
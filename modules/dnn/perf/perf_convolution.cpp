@@ -103,4 +103,131 @@ PERF_TEST_P( ConvolutionPerfTest, perf, Combine(
     SANITY_CHECK_NOTHING();
 }
 
+typedef tuple<Size, MatShape, StrideSize> DepthwiseConvParam; //kernel_size, inp shape, stride
+typedef TestBaseWithParam<DepthwiseConvParam> DepthwiseConvolutionPerfTest;
+
+PERF_TEST_P( DepthwiseConvolutionPerfTest, perf, Combine(
+    Values(Size(3, 3), Size(5, 5)),
+    Values(blobShape(1,  32, 112, 112),
+           blobShape(1, 128,  56,  56),
+           blobShape(1, 512,  14,  14)),
+    StrideSize::all())
+)
+{
+    RNG rng(0);
+
+    DepthwiseConvParam params = GetParam();
+    int ksz     = get<0>(params).width;
+    MatShape inpShape = get<1>(params);
+    int stride  = (int)get<2>(params);
+
+    int channels = inpShape[1];
+    int wgtSize[] = { channels, 1, ksz, ksz };
+    int biasSize[] = { channels, 1, 1, 1 };
+    const int wtype = CV_32F;
+    Mat wgtBlob(4, wgtSize, wtype), biasBlob(4, biasSize, wtype);
+    Mat inpBlob(4, &inpShape[0], wtype);
+    rng.fill(biasBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(wgtBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(inpBlob, RNG::UNIFORM, -1, +1);
+
+    LayerParams lp;
+    lp.set("num_output", channels);
+    lp.set("group", channels);
+    lp.set("stride", stride);
+    lp.set("kernel_size", ksz);
+    lp.set("pad", ksz / 2);
+    lp.blobs.reserve(2);
+    lp.blobs.push_back(wgtBlob);
+    lp.blobs.push_back(biasBlob);
+
+    std::vector<Mat*> inpBlobs(1, &inpBlob);
+    std::vector<Mat> outBlobs, internalBlobs;
+
+    cv::setNumThreads(cv::getNumberOfCPUs());
+
+    Ptr<Layer> layer = cv::dnn::LayerFactory::createLayerInstance("Convolution", lp);
+    std::vector<MatShape> inputShapes(1, shape(inpBlob)), outShapes, internals;
+    layer->getMemoryShapes(inputShapes, 0, outShapes, internals);
+    for (int i = 0; i < outShapes.size(); i++)
+    {
+        outBlobs.push_back(Mat(outShapes[i], CV_32F));
+    }
+
+    layer->finalize(inpBlobs, outBlobs);
+
+    Mat outBlob2D = outBlobs[0].reshape(1, outBlobs[0].size[0]);
+    declare.out(outBlob2D).tbb_threads(cv::getNumThreads());
+
+    TEST_CYCLE_N(10)
+    {
+        layer->forward(inpBlobs, outBlobs, internalBlobs);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+typedef tuple<InpShapeNumOut, bool> WinogradConvParam; //inp shape, use winograd
+typedef TestBaseWithParam<WinogradConvParam> WinogradConvolutionPerfTest;
+
+PERF_TEST_P( WinogradConvolutionPerfTest, perf, Combine(
+    Values(make_pair(blobShape(1,  64, 112, 112),  64),
+           make_pair(blobShape(1, 128,  56,  56), 128),
+           make_pair(blobShape(1, 256,  28,  28), 256),
+           make_pair(blobShape(1, 512,  14,  14), 512)),
+    Bool())
+)
+{
+    RNG rng(0);
+
+    WinogradConvParam params = GetParam();
+    MatShape inpShape = get<0>(params).first;
+    int outCn   = get<0>(params).second;
+    bool winograd = get<1>(params);
+
+    int inpCn = inpShape[1];
+    int wgtSize[] = { outCn, inpCn, 3, 3 };
+    int biasSize[] = { outCn, 1, 1, 1 };
+    const int wtype = CV_32F;
+    Mat wgtBlob(4, wgtSize, wtype), biasBlob(4, biasSize, wtype);
+    Mat inpBlob(4, &inpShape[0], wtype);
+    rng.fill(biasBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(wgtBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(inpBlob, RNG::UNIFORM, -1, +1);
+
+    LayerParams lp;
+    lp.set("num_output", outCn);
+    lp.set("kernel_size", 3);
+    lp.set("pad", 1);
+    lp.set("winograd", winograd);
+    lp.blobs.reserve(2);
+    lp.blobs.push_back(wgtBlob);
+    lp.blobs.push_back(biasBlob);
+
+    std::vector<Mat*> inpBlobs(1, &inpBlob);
+    std::vector<Mat> outBlobs, internalBlobs;
+
+    cv::setNumThreads(cv::getNumberOfCPUs());
+
+    Ptr<Layer> layer = cv::dnn::LayerFactory::createLayerInstance("Convolution", lp);
+    std::vector<MatShape> inputShapes(1, shape(inpBlob)), outShapes, internals;
+    layer->getMemoryShapes(inputShapes, 0, outShapes, internals);
+    for (int i = 0; i < outShapes.size(); i++)
+    {
+        outBlobs.push_back(Mat(outShapes[i], CV_32F));
+    }
+
+    layer->finalize(inpBlobs, outBlobs);
+
+    Mat outBlob2D = outBlobs[0].reshape(1, outBlobs[0].size[0]);
+    declare.out(outBlob2D).tbb_threads(cv::getNumThreads());
+
+    TEST_CYCLE_N(10)
+    {
+        layer->forward(inpBlobs, outBlobs, internalBlobs);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
 }
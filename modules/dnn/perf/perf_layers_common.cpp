@@ -0,0 +1,127 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
+
+namespace cvtest
+{
+
+using std::tr1::tuple;
+using std::tr1::get;
+using namespace perf;
+using namespace testing;
+using namespace cv;
+using namespace cv::dnn;
+
+// Hand-tuned kernels (AVX2 on x86, NEON on ARM) are chosen at runtime
+// by checkHardwareSupport() so they are compared with generic ones
+// by switching optimized code off.
+class FastKernelPerfTest : public TestBaseWithParam<tuple<int, bool> > // number of outputs, use optimized kernels
+{
+public:
+    void setUp(const Ptr<Layer>& layer_, const Mat& inpBlob_)
+    {
+        layer = layer_;
+        inpBlob = inpBlob_;
+        inpBlobs.assign(1, &inpBlob);
+
+        std::vector<MatShape> inputShapes(1, shape(inpBlob)), outShapes, internals;
+        layer->getMemoryShapes(inputShapes, 0, outShapes, internals);
+        for (size_t i = 0; i < outShapes.size(); i++)
+            outBlobs.push_back(Mat(outShapes[i], CV_32F));
+        for (size_t i = 0; i < internals.size(); i++)
+        {
+            internalBlobs.push_back(Mat());
+            if (total(internals[i]))
+                internalBlobs.back().create(internals[i], CV_32F);
+        }
+        layer->finalize(inpBlobs, outBlobs);
+
+        useOptimized = cv::useOptimized();
+        cv::setUseOptimized(get<1>(GetParam()));
+    }
+
+    void TearDown()
+    {
+        cv::setUseOptimized(useOptimized);
+        TestBaseWithParam<tuple<int, bool> >::TearDown();
+    }
+
+    Ptr<Layer> layer;
+    Mat inpBlob;
+    std::vector<Mat*> inpBlobs;
+    std::vector<Mat> outBlobs, internalBlobs;
+    bool useOptimized;
+};
+
+typedef FastKernelPerfTest FastConvPerfTest;
+typedef FastKernelPerfTest FastGEMM1TPerfTest;
+
+PERF_TEST_P( FastConvPerfTest, perf, Combine(Values(64, 256), Bool()) )
+{
+    RNG rng(0);
+    int outCn = get<0>(GetParam());
+
+    int inpSize[] = { 1, 64, 56, 56 };
+    int wgtSize[] = { outCn, 64, 3, 3 };
+    int biasSize[] = { outCn, 1, 1, 1 };
+    Mat inpBlob(4, inpSize, CV_32F), wgtBlob(4, wgtSize, CV_32F), biasBlob(4, biasSize, CV_32F);
+    rng.fill(inpBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(wgtBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(biasBlob, RNG::UNIFORM, -1, +1);
+
+    LayerParams lp;
+    lp.set("num_output", outCn);
+    lp.set("kernel_size", 3);
+    lp.set("pad", 1);
+    lp.set("winograd", false);  // Winograd engine doesn't use the kernels.
+    lp.blobs.push_back(wgtBlob);
+    lp.blobs.push_back(biasBlob);
+    Ptr<Layer> layer = LayerFactory::createLayerInstance("Convolution", lp);
+
+    setUp(layer, inpBlob);
+
+    Mat outBlob2D = outBlobs[0].reshape(1, outBlobs[0].size[0]);
+    declare.out(outBlob2D);
+
+    TEST_CYCLE_N(10)
+    {
+        layer->forward(inpBlobs, outBlobs, internalBlobs);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P( FastGEMM1TPerfTest, perf, Combine(Values(1000, 4096), Bool()) )
+{
+    RNG rng(0);
+    int numOut = get<0>(GetParam());
+    const int vecSize = 4096;
+
+    Mat inpBlob(1, vecSize, CV_32F), wgtBlob(numOut, vecSize, CV_32F), biasBlob(1, numOut, CV_32F);
+    rng.fill(inpBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(wgtBlob, RNG::UNIFORM, -1, +1);
+    rng.fill(biasBlob, RNG::UNIFORM, -1, +1);
+
+    LayerParams lp;
+    lp.set("num_output", numOut);
+    lp.blobs.push_back(wgtBlob);
+    lp.blobs.push_back(biasBlob);
+    Ptr<Layer> layer = LayerFactory::createLayerInstance("InnerProduct", lp);
+
+    setUp(layer, inpBlob);
+
+    Mat outBlob2D = outBlobs[0].reshape(1, outBlobs[0].size[0]);
+    declare.out(outBlob2D);
+
+    TEST_CYCLE_N(10)
+    {
+        layer->forward(inpBlobs, outBlobs, internalBlobs);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+}
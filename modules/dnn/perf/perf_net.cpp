@@ -0,0 +1,153 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
+#include <algorithm>
+
+namespace cvtest
+{
+
+using std::tr1::tuple;
+using std::tr1::get;
+using namespace perf;
+using namespace testing;
+using namespace cv;
+using namespace cv::dnn;
+
+// Model-level benchmarks. Besides of default perf metrics every test
+// records latency percentiles, throughput and memory consumption
+// as properties of the report so regressions can be tracked by them.
+
+static std::vector<int> availableBackends()
+{
+    std::vector<int> backends(1, DNN_BACKEND_DEFAULT);
+#ifdef HAVE_HALIDE
+    backends.push_back(DNN_BACKEND_HALIDE);
+#endif
+#ifdef HAVE_OPENCL
+    backends.push_back(DNN_BACKEND_OPENCL);
+#endif
+    return backends;
+}
+
+typedef tuple<int, int> NetParam; // backend, batch size
+
+class DNNNetPerfTest : public TestBaseWithParam<NetParam>
+{
+public:
+    void processNet(const std::string& weights, const std::string& proto,
+                    const std::string& halideScheduler, Size inpSize,
+                    const std::string& outputLayer, const std::string& framework)
+    {
+        int backend = get<0>(GetParam());
+        int batchSize = get<1>(GetParam());
+
+        Net net;
+        if (framework == "caffe")
+            net = readNetFromCaffe(findDataFile(proto), findDataFile(weights));
+        else if (framework == "tensorflow")
+            net = readNetFromTensorflow(findDataFile(weights));
+        else if (framework == "torch")
+            net = readNetFromTorch(findDataFile(weights));
+        else
+            CV_Error(Error::StsNotImplemented, "Unknown framework " + framework);
+        ASSERT_FALSE(net.empty());
+
+        std::vector<Mat> images(batchSize);
+        for (int i = 0; i < batchSize; ++i)
+        {
+            images[i].create(inpSize, CV_32FC3);
+            randu(images[i], 0.0f, 255.0f);
+        }
+        Mat inp = blobFromImages(images, 1.0, false);
+
+        net.setInput(inp);
+        net.setPreferableBackend(backend);
+        if (backend == DNN_BACKEND_HALIDE)
+            net.setHalideScheduler(halideScheduler.empty() ? "" : findDataFile(halideScheduler, false));
+
+        size_t weightsMemory = 0, blobsMemory = 0;
+        net.getMemoryConsumption(shape(inp), weightsMemory, blobsMemory);
+
+        // Warmup run initializes backend.
+        net.forward(outputLayer);
+
+        std::vector<double> latencies;
+        TEST_CYCLE()
+        {
+            int64 t = getTickCount();
+            net.forward(outputLayer);
+            latencies.push_back((getTickCount() - t) * 1000.0 / getTickFrequency());
+        }
+
+        if (!latencies.empty())
+        {
+            std::sort(latencies.begin(), latencies.end());
+            double p50 = percentile(latencies, 50), p90 = percentile(latencies, 90),
+                   p99 = percentile(latencies, 99);
+            RecordProperty("latency_p50_ms", cv::format("%.3f", p50));
+            RecordProperty("latency_p90_ms", cv::format("%.3f", p90));
+            RecordProperty("latency_p99_ms", cv::format("%.3f", p99));
+            RecordProperty("throughput_fps", cv::format("%.2f", batchSize * 1000.0 / p50));
+        }
+        RecordProperty("weights_memory_mb", cv::format("%.2f", weightsMemory / 1048576.0));
+        RecordProperty("blobs_memory_mb", cv::format("%.2f", blobsMemory / 1048576.0));
+
+        SANITY_CHECK_NOTHING();
+    }
+
+    // Nearest-rank percentile of sorted values.
+    static double percentile(const std::vector<double>& sorted, int p)
+    {
+        size_t idx = (sorted.size() * p + 99) / 100;
+        return sorted[std::min(std::max(idx, (size_t)1), sorted.size()) - 1];
+    }
+};
+
+#define NET_PERF_PARAMS Combine(ValuesIn(availableBackends()), Values(1, 4))
+
+PERF_TEST_P(DNNNetPerfTest, AlexNet, NET_PERF_PARAMS)
+{
+    processNet("dnn/bvlc_alexnet.caffemodel", "dnn/bvlc_alexnet.prototxt",
+               "dnn/halide_scheduler_alexnet.yml", Size(227, 227), "prob", "caffe");
+}
+
+PERF_TEST_P(DNNNetPerfTest, GoogLeNet, NET_PERF_PARAMS)
+{
+    processNet("dnn/bvlc_googlenet.caffemodel", "dnn/bvlc_googlenet.prototxt",
+               "", Size(224, 224), "prob", "caffe");
+}
+
+PERF_TEST_P(DNNNetPerfTest, ResNet_50, NET_PERF_PARAMS)
+{
+    processNet("dnn/ResNet-50-model.caffemodel", "dnn/ResNet-50-deploy.prototxt",
+               "dnn/halide_scheduler_resnet_50.yml", Size(224, 224), "prob", "caffe");
+}
+
+PERF_TEST_P(DNNNetPerfTest, SqueezeNet_v1_1, NET_PERF_PARAMS)
+{
+    processNet("dnn/squeezenet_v1_1.caffemodel", "dnn/squeezenet_v1_1.prototxt",
+               "dnn/halide_scheduler_squeezenet_v1_1.yml", Size(227, 227), "prob", "caffe");
+}
+
+PERF_TEST_P(DNNNetPerfTest, MobileNet_SSD, NET_PERF_PARAMS)
+{
+    processNet("dnn/MobileNetSSD_deploy.caffemodel", "dnn/MobileNetSSD_deploy.prototxt",
+               "", Size(300, 300), "detection_out", "caffe");
+}
+
+PERF_TEST_P(DNNNetPerfTest, Inception_5h, NET_PERF_PARAMS)
+{
+    processNet("dnn/tensorflow_inception_graph.pb", "",
+               "dnn/halide_scheduler_inception_5h.yml", Size(224, 224), "softmax2", "tensorflow");
+}
+
+PERF_TEST_P(DNNNetPerfTest, ENet, NET_PERF_PARAMS)
+{
+    processNet("dnn/Enet-model-best.net", "", "dnn/halide_scheduler_enet.yml",
+               Size(512, 256), "", "torch");
+}
+
+}
@@ -0,0 +1,77 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
+
+namespace cvtest
+{
+
+using std::tr1::tuple;
+using std::tr1::get;
+using namespace perf;
+using namespace testing;
+using namespace cv;
+using namespace cv::dnn;
+
+CV_ENUM(PoolingType, PoolingLayer::MAX, PoolingLayer::AVE);
+
+typedef tuple<PoolingType, Size, int, MatShape> PoolingParam; //type, kernel, stride, inp shape
+typedef TestBaseWithParam<PoolingParam> PoolingPerfTest;
+
+static inline MatShape blobShape(int count, int nplanes, int height, int width)
+{
+    int data[] = {count, nplanes, height, width};
+    return MatShape(data, data+4);
+}
+
+PERF_TEST_P( PoolingPerfTest, perf, Combine(
+    PoolingType::all(),
+    Values(Size(2, 2), Size(3, 3)),
+    Values(1, 2),
+    Values(blobShape(1,  64, 112, 112),
+           blobShape(1, 256,  28,  28)))
+)
+{
+    PoolingParam params = GetParam();
+    int type = get<0>(params);
+    int ksz = get<1>(params).width;
+    int stride = get<2>(params);
+    MatShape inpShape = get<3>(params);
+
+    Mat inpBlob(inpShape, CV_32F);
+    randu(inpBlob, -1.0f, 1.0f);
+
+    LayerParams lp;
+    lp.set("pool", String(type == PoolingLayer::MAX ? "max" : "ave"));
+    lp.set("kernel_size", ksz);
+    lp.set("stride", stride);
+
+    std::vector<Mat*> inpBlobs(1, &inpBlob);
+    std::vector<Mat> outBlobs, internalBlobs;
+
+    cv::setNumThreads(cv::getNumberOfCPUs());
+
+    Ptr<Layer> layer = cv::dnn::LayerFactory::createLayerInstance("Pooling", lp);
+    std::vector<MatShape> inputShapes(1, shape(inpBlob)), outShapes, internals;
+    layer->getMemoryShapes(inputShapes, 0, outShapes, internals);
+    for (size_t i = 0; i < outShapes.size(); i++)
+    {
+        outBlobs.push_back(Mat(outShapes[i], CV_32F));
+    }
+
+    layer->finalize(inpBlobs, outBlobs);
+
+    Mat outBlob2D = outBlobs[0].reshape(1, outBlobs[0].size[0]);
+    declare.out(outBlob2D).tbb_threads(cv::getNumThreads());
+
+    TEST_CYCLE_N(10)
+    {
+        layer->forward(inpBlobs, outBlobs, internalBlobs);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+}
@@ -0,0 +1,70 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
+
+namespace cvtest
+{
+
+using std::tr1::tuple;
+using std::tr1::get;
+using namespace perf;
+using namespace testing;
+using namespace cv;
+using namespace cv::dnn;
+
+typedef tuple<MatShape, bool> SoftmaxParam; //inp shape, log softmax
+typedef TestBaseWithParam<SoftmaxParam> SoftmaxPerfTest;
+
+static inline MatShape blobShape(int count, int nplanes, int height, int width)
+{
+    int data[] = {count, nplanes, height, width};
+    return MatShape(data, data+4);
+}
+
+PERF_TEST_P( SoftmaxPerfTest, perf, Combine(
+    Values(blobShape(1, 1000,   1,   1),
+           blobShape(32, 1000,  1,   1),
+           blobShape(1,   21, 256, 256)),
+    Bool())
+)
+{
+    SoftmaxParam params = GetParam();
+    MatShape inpShape = get<0>(params);
+    bool logSoftMax = get<1>(params);
+
+    Mat inpBlob(inpShape, CV_32F);
+    randu(inpBlob, -10.0f, 10.0f);
+
+    LayerParams lp;
+    lp.set("log_softmax", logSoftMax);
+
+    std::vector<Mat*> inpBlobs(1, &inpBlob);
+    std::vector<Mat> outBlobs, internalBlobs;
+
+    cv::setNumThreads(cv::getNumberOfCPUs());
+
+    Ptr<Layer> layer = cv::dnn::LayerFactory::createLayerInstance("Softmax", lp);
+    std::vector<MatShape> inputShapes(1, shape(inpBlob)), outShapes, internals;
+    layer->getMemoryShapes(inputShapes, 0, outShapes, internals);
+    for (size_t i = 0; i < outShapes.size(); i++)
+        outBlobs.push_back(Mat(outShapes[i], CV_32F));
+    for (size_t i = 0; i < internals.size(); i++)
+        internalBlobs.push_back(Mat(internals[i], CV_32F));
+
+    layer->finalize(inpBlobs, outBlobs);
+
+    Mat outBlob2D = outBlobs[0].reshape(1, outBlobs[0].size[0]);
+    declare.out(outBlob2D).tbb_threads(cv::getNumThreads());
+
+    TEST_CYCLE_N(10)
+    {
+        layer->forward(inpBlobs, outBlobs, internalBlobs);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+}
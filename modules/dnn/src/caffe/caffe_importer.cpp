@@ -54,6 +54,8 @@ using namespace cv::dnn;
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include "caffe_io.hpp"
+#include "../mapped_file.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
 
 using ::google::protobuf::RepeatedField;
 using ::google::protobuf::RepeatedPtrField;
@@ -78,14 +80,52 @@ class CaffeImporter : public Importer
     caffe::NetParameter net;
     caffe::NetParameter netBinary;
 
+    // Weights which are read directly from mapped .caffemodel file.
+    // Keys are indices of layer and blob in netBinary.
+    std::map<std::pair<int, int>, Mat> mappedData;
+
 public:
 
-    CaffeImporter(const char *pototxt, const char *caffeModel)
+    CaffeImporter(const char *pototxt, const char *caffeModel, bool mapWeights)
     {
         ReadNetParamsFromTextFileOrDie(pototxt, &net);
 
         if (caffeModel && caffeModel[0])
-            ReadNetParamsFromBinaryFileOrDie(caffeModel, &netBinary);
+        {
+            if (mapWeights)
+                readMappedBinary(caffeModel);
+            else
+                ReadNetParamsFromBinaryFileOrDie(caffeModel, &netBinary);
+        }
+    }
+
+    // Parses model without blobs data (NetParameter.layer.blobs.data and
+    // NetParameter.layers.blobs.data for V1 format) which is used from mapping.
+    // Upgrade from V1 format keeps the order of layers and blobs.
+    void readMappedBinary(const char *caffeModel)
+    {
+        Ptr<MappedFile> mappedModel = makePtr<MappedFile>(caffeModel);
+
+        static const int layerBlobsData[] = {100, 7, 5};
+        static const int layersV1BlobsData[] = {2, 6, 5};
+        std::vector<std::vector<int> > paths(2);
+        paths[0].assign(layerBlobsData, layerBlobsData + 3);
+        paths[1].assign(layersV1BlobsData, layersV1BlobsData + 3);
+
+        std::string skeleton;
+        std::vector<StrippedField> stripped;
+        stripProtobuf(mappedModel->data(), mappedModel->size(), paths, 0, skeleton, stripped);
+
+        ReadNetParamsFromBinaryBufferOrDie(skeleton.data(), skeleton.size(), &netBinary);
+
+        for (size_t i = 0; i < stripped.size(); i++)
+        {
+            const StrippedField& field = stripped[i];
+            CV_Assert(field.indices.size() == 2 && field.size % sizeof(float) == 0);
+            std::pair<int, int> key(field.indices[0], field.indices[1]);
+            mappedData[key] = wrapMappedData(mappedModel, mappedModel->data() + field.offset,
+                                             shape((int)(field.size / sizeof(float))), CV_32F);
+        }
     }
 
     void addParam(const Message &msg, const FieldDescriptor *field, cv::dnn::LayerParams &params)
@@ -213,11 +253,18 @@ public:
             CV_Error(Error::StsError, "Unknown shape of input blob");
     }
 
-    void blobFromProto(const caffe::BlobProto &pbBlob, cv::Mat &dstBlob)
+    void blobFromProto(const caffe::BlobProto &pbBlob, cv::Mat &dstBlob, const Mat &mapped = Mat())
     {
         MatShape shape;
         blobShapeFromProto(pbBlob, shape);
 
+        if (!mapped.empty())
+        {
+            CV_Assert(pbBlob.data_size() == 0 && mapped.total() == total(shape));
+            dstBlob = reinterpretMat(mapped, shape, CV_32F);
+            return;
+        }
+
         dstBlob.create((int)shape.size(), &shape[0], CV_32F);
         CV_Assert(pbBlob.data_size() == (int)dstBlob.total());
 
@@ -246,7 +293,10 @@ public:
         layerParams.blobs.resize(binLayer.blobs_size());
         for (int bi = 0; bi < binLayer.blobs_size(); bi++)
         {
-            blobFromProto(binLayer.blobs(bi), layerParams.blobs[bi]);
+            std::map<std::pair<int, int>, Mat>::const_iterator it =
+                mappedData.find(std::make_pair(li, bi));
+            blobFromProto(binLayer.blobs(bi), layerParams.blobs[bi],
+                          it != mappedData.end() ? it->second : Mat());
         }
     }
 
@@ -357,14 +407,15 @@ public:
 
 }
 
-Ptr<Importer> cv::dnn::createCaffeImporter(const String &prototxt, const String &caffeModel)
+Ptr<Importer> cv::dnn::createCaffeImporter(const String &prototxt, const String &caffeModel,
+                                           bool mapWeights)
 {
-    return Ptr<Importer>(new CaffeImporter(prototxt.c_str(), caffeModel.c_str()));
+    return Ptr<Importer>(new CaffeImporter(prototxt.c_str(), caffeModel.c_str(), mapWeights));
 }
 
 #else //HAVE_PROTOBUF
 
-Ptr<Importer> cv::dnn::createCaffeImporter(const String&, const String&)
+Ptr<Importer> cv::dnn::createCaffeImporter(const String&, const String&, bool)
 {
     CV_Error(cv::Error::StsNotImplemented, "libprotobuf required to import data from Caffe models");
     return Ptr<Importer>();
@@ -372,9 +423,10 @@ Ptr<Importer> cv::dnn::createCaffeImporter(const String&, const String&)
 
 #endif //HAVE_PROTOBUF
 
-Net cv::dnn::readNetFromCaffe(const String &prototxt, const String &caffeModel /*= String()*/)
+Net cv::dnn::readNetFromCaffe(const String &prototxt, const String &caffeModel /*= String()*/,
+                              bool mapWeights /*= false*/)
 {
-    Ptr<Importer> caffeImporter = createCaffeImporter(prototxt, caffeModel);
+    Ptr<Importer> caffeImporter = createCaffeImporter(prototxt, caffeModel, mapWeights);
     Net net;
     if (caffeImporter)
         caffeImporter->populateNet(net);
@@ -1132,6 +1132,14 @@ bool ReadProtoFromBinaryFile(const char* filename, Message* proto) {
     return success;
 }
 
+bool ReadProtoFromBinaryBuffer(const char* data, size_t len, Message* proto) {
+    ArrayInputStream raw_input(data, (int)len);
+    CodedInputStream coded_input(&raw_input);
+    coded_input.SetTotalBytesLimit(kProtoReadBytesLimit, 536870912);
+
+    return proto->ParseFromCodedStream(&coded_input);
+}
+
 void ReadNetParamsFromTextFileOrDie(const char* param_file,
                                     NetParameter* param) {
   CHECK(ReadProtoFromTextFile(param_file, param))
@@ -1146,6 +1154,13 @@ void ReadNetParamsFromBinaryFileOrDie(const char* param_file,
   UpgradeNetAsNeeded(param_file, param);
 }
 
+void ReadNetParamsFromBinaryBufferOrDie(const char* data, size_t len,
+                                        NetParameter* param) {
+  CHECK(ReadProtoFromBinaryBuffer(data, len, param))
+      << "Failed to parse NetParameter buffer";
+  UpgradeNetAsNeeded("memory buffer", param);
+}
+
 }
 }
 #endif
@@ -102,6 +102,9 @@ void ReadNetParamsFromTextFileOrDie(const char* param_file,
 void ReadNetParamsFromBinaryFileOrDie(const char* param_file,
                                       caffe::NetParameter* param);
 
+void ReadNetParamsFromBinaryBufferOrDie(const char* data, size_t len,
+                                        caffe::NetParameter* param);
+
 }
 }
 #endif
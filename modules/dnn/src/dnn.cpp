@@ -41,13 +41,22 @@
 
 #include "precomp.hpp"
 #include "op_halide.hpp"
+#include "op_opencl.hpp"
 #include "halide_scheduler.hpp"
 #include <set>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <iterator>
 #include <opencv2/dnn/shape_utils.hpp>
+#ifdef CV_CXX11
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#endif
 
 using namespace cv;
 using namespace cv::dnn;
@@ -301,9 +310,12 @@ private:
 
 struct LayerData
 {
-    LayerData() {}
+    LayerData() : outputsOnHost(true), outputsOnDevice(false),
+                  timeStart(0), timeTicks(0), timeBackend(DNN_BACKEND_DEFAULT) {}
     LayerData(int _id, const String &_name, const String &_type, LayerParams &_params)
-        : id(_id), name(_name), type(_type), params(_params)
+        : id(_id), name(_name), type(_type), params(_params),
+          outputsOnHost(true), outputsOnDevice(false),
+          timeStart(0), timeTicks(0), timeBackend(DNN_BACKEND_DEFAULT)
     {
         //add logging info
         params.name = name;
@@ -323,11 +335,21 @@ struct LayerData
     std::vector<Mat> outputBlobs;
     std::vector<Mat*> inputBlobs;
     std::vector<Mat> internals;
+    // Device blobs for OpenCL backend. They have the same shapes as host ones.
+    std::vector<UMat> umatOutputs;
+    std::vector<UMat> umatInternals;
+    // Flags that the actual values of outputs are on host or on device.
+    bool outputsOnHost, outputsOnDevice;
     // Computation nodes of implemented backends (except DEFAULT).
     std::map<int, Ptr<BackendNode> > backendNodes;
     // Flag for skip layer computation for specific backend.
     std::map<int, bool> skipFlags;
 
+    // Measurements of the last forward pass: start time and duration in ticks
+    // and the backend which computed the layer. Zero start means no computations.
+    int64 timeStart, timeTicks;
+    int timeBackend;
+
     int flag;
 
     Ptr<Layer> getLayerInstance()
@@ -362,13 +384,56 @@ struct DataLayer : public Layer
         outNames.assign(names.begin(), names.end());
     }
 
+    Ptr<Layer> clone() const
+    {
+        return Ptr<Layer>(new DataLayer(*this));
+    }
+
 private:
     std::vector<String> outNames;
 };
 
+// Returns true if output of the layer is the same data as its input with
+// another shape (i.e. Reshape). Such layers never modify their inputs so they
+// might work in-place even if the input has other consumers.
+static bool isViewLayer(const LayerData &ld, const LayerShapes& layerShapes)
+{
+    if (!layerShapes.supportInPlace || layerShapes.in.size() != 1 ||
+        layerShapes.out.size() != 1)
+        return false;
+    if (ld.type == "Flatten" || ld.type == "Permute")
+        return true;  // Permute supports in-place only if it doesn't move data.
+    if (ld.type != "Reshape")
+        return false;
+    if (!ld.params.get<bool>("reorder_dims", false))
+        return true;
+    // The same condition as Reshape layer uses to enable reordering.
+    const MatShape &inpShape = layerShapes.in[0], &outShape = layerShapes.out[0];
+    const size_t minDims = std::min(inpShape.size(), outShape.size());
+    for (size_t i = 0; i < minDims; ++i)
+    {
+        if (inpShape[i] != outShape[i])
+            return false;
+    }
+    return true;
+}
+
+// Manages memory of layers outputs and internal blobs. Allocation is made
+// in two passes. At the first one layers are traversed in the execution order
+// to find out which outputs might be computed in-place and when every memory
+// buffer is used first and last time. Then buffers are packed into a single
+// arena so buffers with overlapping lifetimes never intersect. At the second
+// pass layers blobs are bound to the planned arena regions.
+// If layers might be computed concurrently (see Net::forwardAsync) buffers
+// share memory only if all the users of one of them are computed before
+// the other one is produced.
+// Inputs of concatenation layer might be placed inside its output buffer
+// so the producers write results right to the place of concatenation.
 struct BlobManager
 {
 public:
+    BlobManager() : arenaSize(0), step(0), currentLayer(-1) {}
+
     // Increase references counter to layer output.
     void addReference(const LayerPin& lp)
     {
@@ -421,6 +486,7 @@ public:
     }
 
     // Decrease references counter to allocated memory inside specific blob.
+    // Memory becomes free after the current step if there are no references.
     void releaseReference(const LayerPin& lp)
     {
         std::map<LayerPin, LayerPin>::iterator mapIt = reuseMap.find(lp);
@@ -430,6 +496,12 @@ public:
         CV_Assert(refIt != refCounter.end());
         CV_Assert(refIt->second > 0);
         refIt->second -= 1;
+
+        std::map<LayerPin, MemoryBuffer>::iterator bufIt = buffers.find(refIt->first);
+        CV_Assert(bufIt != buffers.end());
+        bufIt->second.users.push_back(currentLayer);
+        if (refIt->second == 0)
+            bufIt->second.lastUse = step;
     }
 
     void releaseReferences(const std::vector<LayerPin>& pins)
@@ -440,146 +512,373 @@ public:
         }
     }
 
-    void reuseOrCreate(const MatShape& shape, const LayerPin& lp, Mat& dst)
-    {
-        std::map<LayerPin, Mat>::iterator hostIt;
-        std::map<LayerPin, int>::iterator refIt;
-
-        const int targetTotal = total(shape);
-        Mat bestBlob;
-        int bestBlobTotal = INT_MAX;
-        LayerPin bestBlobPin;
-        for (hostIt = memHosts.begin(); hostIt != memHosts.end(); ++hostIt)
-        {
-            refIt = refCounter.find(hostIt->first);
-            // Use only blobs that had references before because if not,
-            // it might be used as output.
-            if (refIt != refCounter.end() && refIt->second == 0)
-            {
-                Mat& unusedBlob = hostIt->second;
-                if (unusedBlob.total() >= targetTotal &&
-                    unusedBlob.total() < bestBlobTotal)
-                {
-                    bestBlobPin = hostIt->first;
-                    bestBlob = unusedBlob;
-                    bestBlobTotal = unusedBlob.total();
-                }
-            }
-        }
-        if (!bestBlob.empty())
-        {
-            reuse(bestBlobPin, lp);
-            dst = Mat(shape, CV_32F, bestBlob.data);
-        }
-        else
-        {
-            // if dst already has been allocated with total(shape) elements,
-            // it won't be recrreated and pointer of dst.data remains the same.
-            dst.create(shape, CV_32F);
-            addHost(lp, dst);
-        }
-    }
-
-    void allocateBlobsForLayer(LayerData &ld, const LayerShapes& layerShapes,
-                               std::vector<LayerPin>& pinsForInternalBlobs)
+    // Registers memory buffers for outputs and internal blobs of the layer.
+    // Layers must be planned in the execution order. Outputs of the network
+    // input layer (id=0) are set by user so they are not placed in the arena.
+    void planBlobsForLayer(const LayerData &ld, const LayerShapes& layerShapes,
+                           std::vector<LayerPin>& pinsForInternalBlobs)
     {
         pinsForInternalBlobs.clear();
-
-        std::vector<Mat>& outputBlobs = ld.outputBlobs,
-                &internalBlobs = ld.internals;
+        step += 1;
+        currentLayer = ld.id;
 
         const ShapesVec& outShapes = layerShapes.out,
                 internalShapes = layerShapes.internal;
-
-        outputBlobs.resize(std::max((size_t)1, outShapes.size())); //layer produce at least one output blob
-        internalBlobs.resize(internalShapes.size());
+        const int numOutputs = std::max((size_t)1, outShapes.size());
 
         CV_Assert(ld.requiredOutputs.size() <= outShapes.size());
 
-        // Check that layer could work in-place.
-        bool inPlace = false;
-        if (layerShapes.supportInPlace)
+        // Check that layer could work in-place. Fused layers are skipped
+        // so their outputs always share memory with inputs.
+        std::map<int, bool>::const_iterator skipIt = ld.skipFlags.find(DNN_BACKEND_DEFAULT);
+        bool inPlace = skipIt != ld.skipFlags.end() && skipIt->second;
+        if (!inPlace && layerShapes.supportInPlace)
         {
-            if (ld.inputBlobs.size() == 1)
+            if (ld.inputBlobsId.size() == 1)
             {
                 // Get number of references to the input memory.
                 int numRef = numReferences(ld.inputBlobsId[0]);
                 // If current layer is one and only customer of this blob.
-                inPlace = numRef == 1;
+                inPlace = numRef == 1 || isViewLayer(ld, layerShapes);
             }
         }
 
-        ShapesVec shapes(outShapes);
-        shapes.insert(shapes.end(), internalShapes.begin(), internalShapes.end());
-        std::vector<Mat*> blobs;
-        for(int i = 0; i < outputBlobs.size(); i++)
+        for(int i = 0; i < internalShapes.size(); i++)
         {
-            blobs.push_back(&outputBlobs[i]);
+            if (total(internalShapes[i]))
+            {
+                pinsForInternalBlobs.push_back(LayerPin(ld.id, numOutputs + i));
+            }
         }
 
-        for(int i = 0; i < internalBlobs.size(); i++)
+        addReferences(pinsForInternalBlobs);
+
+        for(int i = 0; i < outShapes.size(); i++)
+        {
+            if (total(outShapes[i]))
+            {
+                LayerPin blobPin(ld.id, i);
+                if (inPlace)
+                {
+                    reuse(ld.inputBlobsId[0], blobPin);
+                    buffers[reuseMap[blobPin]].users.push_back(ld.id);
+                }
+                else
+                    addBuffer(blobPin, total(outShapes[i]) * sizeof(float), ld.id == 0);
+            }
+        }
+
+        for(int i = 0; i < internalShapes.size(); i++)
         {
-            blobs.push_back(&internalBlobs[i]);
             if (total(internalShapes[i]))
             {
-                pinsForInternalBlobs.push_back(LayerPin(ld.id, ld.outputBlobs.size() + i));
+                addBuffer(LayerPin(ld.id, numOutputs + i),
+                          total(internalShapes[i]) * sizeof(float), false);
             }
         }
+    }
 
-        addReferences(pinsForInternalBlobs);
+    // Places inputs of the concatenation layer into its output buffer so
+    // the layer has nothing to copy. It's possible if the concatenated parts
+    // are contiguous (all the dimensions before the axis are 1) and the layer
+    // is the only consumer of the input memory. Must be called right after
+    // planBlobsForLayer for the concatenation layer.
+    void planConcatInputs(const LayerData &ld, const LayerShapes& layerShapes, int axis)
+    {
+        if (layerShapes.out.size() != 1 || total(layerShapes.out[0]) == 0)
+            return;
 
-        std::map<int, std::vector<int> > idxSizes;
-        for(int i = 0; i < shapes.size(); i++)
+        const MatShape& outShape = layerShapes.out[0];
+        axis = clamp(axis, outShape);
+        for (int i = 0; i < axis; ++i)
         {
-            idxSizes[total(shapes[i])].push_back(i);
+            if (outShape[i] != 1)
+                return;
         }
 
-        std::map<int, std::vector<int> >::reverse_iterator it;
-        for(it = idxSizes.rbegin(); it != idxSizes.rend(); it++)
+        const LayerPin outPin(ld.id, 0);
+        std::map<LayerPin, LayerPin>::iterator outIt = reuseMap.find(outPin);
+        if (outIt == reuseMap.end() || !(outIt->second == outPin))
+            return;
+        MemoryBuffer& outBuf = buffers[outPin];
+
+        size_t offset = 0;
+        for (size_t i = 0; i < ld.inputBlobsId.size(); ++i)
         {
-            for(int j = 0; j < it->second.size(); j++)
+            const size_t bytes = total(layerShapes.in[i]) * sizeof(float);
+            if (bytes && numReferences(ld.inputBlobsId[i]) == 1)
             {
-                int index = it->second[j];
-                if (total(shapes[index]))
+                MemoryBuffer& buf = buffers[reuseMap[ld.inputBlobsId[i]]];
+                if (!buf.external && !buf.parent.valid() &&
+                    buf.size == alignSize(bytes, arenaAlignment))
                 {
-                    LayerPin blobPin(ld.id, index);
-                    if (index < outShapes.size() && inPlace)
-                    {
-                        CV_Assert(ld.inputBlobs[0]->total() == total(shapes[index]));
-                        ld.outputBlobs[index] = ld.inputBlobs[0]->reshape(1, shapes[index]);
-                        reuse(ld.inputBlobsId[0], blobPin);
-                    }
-                    else
-                    {
-                        reuseOrCreate(shapes[index], blobPin, *blobs[index]);
-                    }
+                    buf.parent = outPin;
+                    buf.viewOffset = offset;
+                    // Output buffer is busy since the input is produced.
+                    outBuf.firstUse = std::min(outBuf.firstUse, buf.firstUse);
                 }
             }
+            offset += bytes;
         }
     }
 
+    // Assigns offsets of planned buffers inside the arena. Greedy approach:
+    // the biggest buffers are placed first at the lowest offset which doesn't
+    // conflict with already placed buffers used at the same time.
+    // <precedes>[a][b] is true if layer <a> is always computed before layer <b>.
+    // It's used instead of the execution order if layers are computed concurrently.
+    void planArena(const std::vector<std::vector<bool> >* precedes = 0)
+    {
+        std::vector<std::pair<size_t, LayerPin> > order;
+        std::map<LayerPin, MemoryBuffer>::iterator it;
+        for (it = buffers.begin(); it != buffers.end(); ++it)
+        {
+            if (!it->second.external && !it->second.parent.valid() && it->second.size)
+                order.push_back(std::make_pair(it->second.size, it->first));
+        }
+        std::stable_sort(order.begin(), order.end(), greaterBySize);
+
+        arenaSize = 0;
+        std::vector<MemoryBuffer*> placed;
+        std::vector<std::pair<size_t, size_t> > busy;
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            MemoryBuffer& buf = buffers[order[i].second];
+
+            busy.clear();
+            for (size_t j = 0; j < placed.size(); ++j)
+            {
+                const MemoryBuffer& other = *placed[j];
+                if (intersect(other, buf, precedes))
+                    busy.push_back(std::make_pair(other.offset, other.offset + other.size));
+            }
+            std::sort(busy.begin(), busy.end());
+
+            size_t offset = 0;
+            for (size_t j = 0; j < busy.size(); ++j)
+            {
+                if (offset + buf.size <= busy[j].first)
+                    break;
+                offset = std::max(offset, busy[j].second);
+            }
+            buf.offset = offset;
+            arenaSize = std::max(arenaSize, offset + buf.size);
+            placed.push_back(&buf);
+        }
+    }
+
+    // Allocates the arena planned by planArena(). Memory is kept between
+    // reallocations if it's enough to store the new plan. Device arena has
+    // the same layout so blobs have the same offsets on host and device.
+    void allocateArena(bool useOpenCL)
+    {
+        const size_t arenaTotal = arenaSize / sizeof(float);
+        if (arena.total() < arenaTotal)
+        {
+            arena.release();
+            arena.create(1, (int)arenaTotal, CV_32F);
+        }
+
+        if (!useOpenCL)
+            umatArena.release();
+        else if (umatArena.cols != arena.cols)
+            umatArena.create(1, arena.cols, CV_32F);
+    }
+
+    // Returns device blob which corresponds to the host one.
+    UMat deviceBlob(const Mat& m) const
+    {
+        if (m.empty())
+            return UMat();
+
+        CV_Assert(m.isContinuous() && m.type() == CV_32F);
+        if (!arena.empty() && m.data >= arena.data && m.data < arena.dataend)
+        {
+            int offset = (int)((m.data - arena.data) / sizeof(float));
+            UMat view = umatArena.colRange(offset, offset + (int)m.total());
+            return view.reshape(1, m.dims, m.size.p);
+        }
+        // Blobs outside of the arena (network inputs) have own memory.
+        return UMat(m.dims, m.size.p, CV_32F);
+    }
+
+    // Binds outputs and internal blobs of layer to the planned memory.
+    void allocateBlobsForLayer(LayerData &ld, const LayerShapes& layerShapes)
+    {
+        std::vector<Mat>& outputBlobs = ld.outputBlobs,
+                &internalBlobs = ld.internals;
+
+        const ShapesVec& outShapes = layerShapes.out,
+                internalShapes = layerShapes.internal;
+
+        outputBlobs.resize(std::max((size_t)1, outShapes.size())); //layer produce at least one output blob
+        internalBlobs.resize(internalShapes.size());
+
+        for(int i = 0; i < outShapes.size(); i++)
+        {
+            if (total(outShapes[i]))
+                bindBlob(ld, LayerPin(ld.id, i), outShapes[i], outputBlobs[i]);
+        }
+
+        for(int i = 0; i < internalShapes.size(); i++)
+        {
+            if (total(internalShapes[i]))
+                bindBlob(ld, LayerPin(ld.id, outputBlobs.size() + i), internalShapes[i],
+                         internalBlobs[i]);
+        }
+    }
+
+    // Returns number of bytes are required to store all the planned blobs.
+    size_t getMemoryConsumption() const
+    {
+        size_t bytes = arenaSize;
+        std::map<LayerPin, MemoryBuffer>::const_iterator it;
+        for (it = buffers.begin(); it != buffers.end(); ++it)
+        {
+            if (it->second.external)
+                bytes += it->second.size;
+        }
+        return bytes;
+    }
+
+    // Copies planned buffers of another manager. Memory of arena is kept.
+    void copyPlan(const BlobManager& src)
+    {
+        refCounter = src.refCounter;
+        reuseMap = src.reuseMap;
+        buffers = src.buffers;
+        arenaSize = src.arenaSize;
+        step = src.step;
+        currentLayer = src.currentLayer;
+    }
+
     // Clear internal state. Calls before an every reallocation.
     void reset()
     {
         refCounter.clear();
         reuseMap.clear();
-        memHosts.clear();
+        buffers.clear();
+        arenaSize = 0;
+        step = 0;
+        currentLayer = -1;
     }
 
 private:
-    // Register allocated memory.
-    void addHost(const LayerPin& lp, const Mat& mat)
+    struct MemoryBuffer
+    {
+        MemoryBuffer() : size(0), offset(0), firstUse(0), lastUse(INT_MAX), external(false),
+                         viewOffset(0) {}
+
+        size_t size;    // Number of bytes.
+        size_t offset;  // Offset in bytes from the beginning of the arena.
+        int firstUse, lastUse;  // Steps of the first and the last usage.
+        bool external;  // Memory isn't managed by arena.
+        std::vector<int> users;  // Ids of layers which use the buffer. The first one produces it.
+        // Buffer which this one is a part of. Such buffers aren't placed in
+        // the arena, they are at <viewOffset> bytes from the parent's beginning.
+        LayerPin parent;
+        size_t viewOffset;
+    };
+
+    // Returns offset of the buffer from the beginning of the arena.
+    size_t arenaOffset(const LayerPin& lp)
     {
-        CV_Assert(memHosts.find(lp) == memHosts.end());
+        size_t offset = 0;
+        const MemoryBuffer* buf = &buffers[lp];
+        while (buf->parent.valid())
+        {
+            offset += buf->viewOffset;
+            buf = &buffers[buf->parent];
+        }
+        return offset + buf->offset;
+    }
+
+    // Returns true if all the users of <a> are computed before <b> is produced.
+    static bool usedBefore(const MemoryBuffer& a, const MemoryBuffer& b,
+                           const std::vector<std::vector<bool> >& precedes)
+    {
+        if (a.lastUse == INT_MAX)
+            return false;  // Kept till the end of forward pass.
+        const int producer = b.users[0];
+        for (size_t i = 0; i < a.users.size(); ++i)
+        {
+            if (!precedes[a.users[i]][producer])
+                return false;
+        }
+        return true;
+    }
+
+    // Returns true if buffers might be used at the same time.
+    static bool intersect(const MemoryBuffer& a, const MemoryBuffer& b,
+                          const std::vector<std::vector<bool> >* precedes)
+    {
+        if (!precedes)
+            return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+        return !usedBefore(a, b, *precedes) && !usedBefore(b, a, *precedes);
+    }
+
+    // Alignment of buffers in the arena (in bytes).
+    enum { arenaAlignment = 64 };
+
+    static bool greaterBySize(const std::pair<size_t, LayerPin>& a,
+                              const std::pair<size_t, LayerPin>& b)
+    {
+        return a.first > b.first;
+    }
+
+    // Register memory that would be allocated for specific pin.
+    void addBuffer(const LayerPin& lp, size_t size, bool external)
+    {
+        CV_Assert(reuseMap.find(lp) == reuseMap.end());
         reuseMap[lp] = lp;
-        memHosts[lp] = mat;
+
+        MemoryBuffer& buf = buffers[lp];
+        buf.size = alignSize(size, arenaAlignment);
+        buf.firstUse = step;
+        buf.external = external;
+        buf.users.push_back(currentLayer);
+    }
+
+    void bindBlob(LayerData &ld, const LayerPin& lp, const MatShape& shape, Mat& dst)
+    {
+        std::map<LayerPin, LayerPin>::iterator mapIt = reuseMap.find(lp);
+        CV_Assert(mapIt != reuseMap.end());
+        if (!(mapIt->second == lp))
+        {
+            // In-place computations.
+            CV_Assert(ld.inputBlobs.size() == 1 && ld.inputBlobs[0]->total() == total(shape));
+            dst = ld.inputBlobs[0]->reshape(1, shape);
+            return;
+        }
+
+        const MemoryBuffer& buf = buffers[lp];
+        if (buf.external)
+        {
+            // if dst already has been allocated with total(shape) elements,
+            // it won't be recrreated and pointer of dst.data remains the same.
+            dst.create(shape, CV_32F);
+        }
+        else
+        {
+            const size_t offset = arenaOffset(lp);
+            CV_Assert(offset + total(shape) * sizeof(float) <= arena.total() * sizeof(float));
+            dst = Mat(shape, CV_32F, arena.data + offset);
+        }
     }
 
     std::map<LayerPin, int> refCounter;
     // Maps pin to origin blob (for whom memory was allocated firstly).
     // For origin blobs key == value.
     std::map<LayerPin, LayerPin> reuseMap;
-    std::map<LayerPin, Mat> memHosts;
+    // Memory buffers of origin blobs.
+    std::map<LayerPin, MemoryBuffer> buffers;
+    size_t arenaSize;
+    Mat arena;
+    UMat umatArena;
+    // Index of currently planned layer in the execution order.
+    int step;
+    // Id of currently planned layer.
+    int currentLayer;
 };
 
 struct Net::Impl
@@ -601,6 +900,11 @@ struct Net::Impl
         lastLayerId = 1;
         netWasAllocated = false;
         preferableBackend = DNN_BACKEND_DEFAULT;
+        calibrating = false;
+        fusion = true;
+        halideAutotuning = false;
+        concurrentForward = false;
+        fp16 = false;
     }
 
     Ptr<DataLayer> netInputLayer;
@@ -611,6 +915,10 @@ struct Net::Impl
     BlobManager blobManager;
     int preferableBackend;
     String halideConfigFile;
+    // Benchmark candidate schedules of Halide layers which aren't found
+    // in the cache (see Net::enableHalideAutotuning).
+    bool halideAutotuning;
+    String halideTuningCache;
     // Backend-specific wrapping manager.
     BackendWrapManager backendWrapper;
 
@@ -618,11 +926,35 @@ struct Net::Impl
 
     bool netWasAllocated;
 
+    // Collect ranges of layers inputs during forward passes (see Net::enableInt8).
+    bool calibrating;
+    std::map<int, float> inputRanges;
+    bool fusion;
+    // Memory is planned so independent layers might be computed at the same time.
+    bool concurrentForward;
+    // Weights are converted to half precision after fusion (see Net::enableFP16).
+    bool fp16;
+
+    // Shapes of layers and memory plans for distinct shapes of network inputs and
+    // kept blobs, so switching between them needs only binding of blobs. Plans depend
+    // on network structure and fusion, so they are dropped when these are changed.
+    struct AllocationPlan
+    {
+        LayersShapesMap layersShapes;
+        BlobManager planner;
+    };
+    typedef std::map<std::pair<ShapesVec, std::vector<LayerPin> >, AllocationPlan> PlansMap;
+    PlansMap allocationPlans;
+    enum { maxAllocationPlans = 16 };
+
     void compileHalide()
     {
         CV_Assert(preferableBackend == DNN_BACKEND_HALIDE);
 
         HalideScheduler scheduler(halideConfigFile);
+        Ptr<HalideAutotuner> tuner;
+        if (halideAutotuning)
+            tuner = Ptr<HalideAutotuner>(new HalideAutotuner(halideTuningCache));
         MapIdToLayerData::iterator it;
         for (it = layers.begin(); it != layers.end(); ++it)
         {
@@ -632,6 +964,19 @@ struct Net::Impl
             {
                 CV_Assert(!ld.backendNodes[DNN_BACKEND_HALIDE].empty());
                 bool scheduled = scheduler.process(ld.backendNodes[DNN_BACKEND_HALIDE]);
+                if (!scheduled && !tuner.empty())
+                {
+                    const std::string key = halideLayerKey(it);
+                    HalideSchedule schedule;
+                    if (!tuner->find(key, schedule))
+                    {
+                        schedule = tuneHalide(it);
+                        tuner->add(key, schedule);
+                    }
+                    HalideAutotuner::apply(schedule, layer, ld.backendNodes[DNN_BACKEND_HALIDE],
+                                           ld.inputBlobs, ld.outputBlobs);
+                    scheduled = true;
+                }
                 if (!scheduled)
                 {
                     // Use automatic scheduling provided by layer.
@@ -644,6 +989,109 @@ struct Net::Impl
         }
     }
 
+    // Creates Halide pipeline of the layer and the layers attached to it at initBackend().
+    // Attached layers follow the base one and are skipped.
+    Ptr<BackendNode> initHalideNode(MapIdToLayerData::iterator it,
+                                    const std::vector<Ptr<BackendWrapper> >& inputs)
+    {
+        Ptr<BackendNode> node = it->second.layerInstance->initHalide(inputs);
+        for (++it; it != layers.end() && it->second.skipFlags[DNN_BACKEND_HALIDE]; ++it)
+        {
+            node = it->second.layerInstance->tryAttach(node);
+            CV_Assert(!node.empty());
+        }
+        return node;
+    }
+
+    static void writeShape(std::ostream& s, const MatShape& shape)
+    {
+        s << " ";
+        for (size_t i = 0; i < shape.size(); ++i)
+            s << (i ? "x" : "") << shape[i];
+    }
+
+    // Types of the layer and attached ones, shapes of inputs, outputs and weights.
+    std::string halideLayerKey(MapIdToLayerData::iterator it)
+    {
+        const LayerData &ld = it->second;
+        std::ostringstream ss;
+        ss << ld.type;
+        MapIdToLayerData::iterator attachedIt = it;
+        for (++attachedIt; attachedIt != layers.end() &&
+                           attachedIt->second.skipFlags[DNN_BACKEND_HALIDE]; ++attachedIt)
+            ss << "+" << attachedIt->second.type;
+
+        ss << " in";
+        for (size_t i = 0; i < ld.inputBlobs.size(); ++i)
+            writeShape(ss, shape(*ld.inputBlobs[i]));
+        ss << " out";
+        for (size_t i = 0; i < ld.outputBlobs.size(); ++i)
+            writeShape(ss, shape(ld.outputBlobs[i]));
+        ss << " blobs";
+        const std::vector<Mat>& blobs = ld.layerInstance->blobs;
+        for (size_t i = 0; i < blobs.size(); ++i)
+            writeShape(ss, shape(blobs[i]));
+        return ss.str();
+    }
+
+    // Benchmarks candidate schedules of the layer and returns the fastest one.
+    // Every candidate gets its own pipeline over random blobs because layer's
+    // blobs might be shared with the other layers.
+    HalideSchedule tuneHalide(MapIdToLayerData::iterator it)
+    {
+        const int numRuns = 5;
+        LayerData &ld = it->second;
+
+        std::vector<Mat> inputs(ld.inputBlobs.size()), outputs(ld.outputBlobs.size());
+        std::vector<Mat*> inputPtrs(inputs.size());
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            inputs[i].create(shape(*ld.inputBlobs[i]), ld.inputBlobs[i]->type());
+            randu(inputs[i], -1.0f, 1.0f);
+            inputPtrs[i] = &inputs[i];
+        }
+        for (size_t i = 0; i < outputs.size(); ++i)
+            outputs[i].create(shape(ld.outputBlobs[i]), ld.outputBlobs[i]->type());
+
+        BackendWrapManager wrapper;
+        std::vector<Ptr<BackendWrapper> > inpWrappers = wrapper.wrap(inputs, DNN_BACKEND_HALIDE);
+        std::vector<Ptr<BackendWrapper> > outWrappers = wrapper.wrap(outputs, DNN_BACKEND_HALIDE);
+
+        std::vector<HalideSchedule> candidates = HalideAutotuner::candidates(shape(outputs[0]));
+        HalideSchedule best = candidates[0];
+        int64 bestTime = -1;
+        for (size_t i = 0; i < candidates.size(); ++i)
+        {
+            int64 minTime = -1;
+            try
+            {
+                Ptr<BackendNode> node = initHalideNode(it, inpWrappers);
+                HalideAutotuner::apply(candidates[i], ld.layerInstance, node,
+                                       inputPtrs, outputs);
+                dnn::compileHalide(outputs, node, DNN_TARGET_CPU);
+                forwardHalide(outWrappers, node);  // Warm up.
+                for (int j = 0; j < numRuns; ++j)
+                {
+                    int64 t = getTickCount();
+                    forwardHalide(outWrappers, node);
+                    t = getTickCount() - t;
+                    minTime = minTime < 0 ? t : std::min(minTime, t);
+                }
+            }
+            catch (...)
+            {
+                // Schedule isn't applicable to the pipeline.
+                continue;
+            }
+            if (bestTime < 0 || minTime < bestTime)
+            {
+                best = candidates[i];
+                bestTime = minTime;
+            }
+        }
+        return best;
+    }
+
     void setUpNet(const std::vector<LayerPin>& blobsToKeep_ = std::vector<LayerPin>())
     {
         if (!netWasAllocated || this->blobsToKeep != blobsToKeep_)
@@ -657,6 +1105,9 @@ struct Net::Impl
                 }
             }
 
+            fuseLayers(blobsToKeep_);
+            if (fp16)
+                convertWeightsFp16();
             allocateLayers(blobsToKeep_);
             computeNetOutputLayers();
             initBackend();
@@ -816,6 +1267,7 @@ struct Net::Impl
 
         addLayerInput(ldInp, inNum, LayerPin(outLayerId, outNum));
         ldOut.requiredOutputs.insert(outNum);
+        allocationPlans.clear();
     }
 
     void computeNetOutputLayers()
@@ -842,7 +1294,9 @@ struct Net::Impl
     void initBackend()
     {
         backendWrapper.reset();
-        if (preferableBackend == DNN_BACKEND_DEFAULT)
+        // OpenCL backend has no backend nodes, layers are computed by forwardOCL().
+        if (preferableBackend == DNN_BACKEND_DEFAULT ||
+            preferableBackend == DNN_BACKEND_OPENCL)
             return;
 
         // Iterator to current layer.
@@ -902,6 +1356,72 @@ struct Net::Impl
         }
     }
 
+    // Layers keep converted weights so it's done once.
+    void convertWeightsFp16()
+    {
+        MapIdToLayerData::iterator it;
+        for (it = layers.begin(); it != layers.end(); ++it)
+        {
+            LayerData &ld = it->second;
+            if (ld.id != 0 && !ld.skipFlags[DNN_BACKEND_DEFAULT])
+                ld.getLayerInstance()->tryConvertFp16();
+        }
+    }
+
+    // Merges layers into the preceding ones if it's possible (see Layer::tryFuse).
+    // Fused layers are skipped at forward pass and their outputs share memory
+    // with outputs of base layers. Layers are fused only over the blobs which
+    // have the single consumer and mustn't be kept.
+    void fuseLayers(const std::vector<LayerPin>& blobsToKeep_)
+    {
+        if (!fusion || (preferableBackend != DNN_BACKEND_DEFAULT &&
+                        preferableBackend != DNN_BACKEND_OPENCL))
+            return;
+
+        std::map<LayerPin, std::vector<int> > consumers;
+        MapIdToLayerData::iterator it;
+        for (it = layers.begin(); it != layers.end(); ++it)
+        {
+            const std::vector<LayerPin>& inputs = it->second.inputBlobsId;
+            for (size_t i = 0; i < inputs.size(); i++)
+                consumers[inputs[i]].push_back(it->first);
+        }
+
+        for (it = layers.begin(); it != layers.end(); ++it)
+        {
+            LayerData &ld = it->second;
+            if (ld.id == 0 || ld.skipFlags[DNN_BACKEND_DEFAULT])
+                continue;
+
+            Ptr<Layer> layer = ld.getLayerInstance();
+            // The last layer of fused chain, i.e. conv -> bn -> scale -> relu.
+            LayerData *tail = &ld;
+            for (;;)
+            {
+                LayerPin pin(tail->id, 0);
+                std::map<LayerPin, std::vector<int> >::iterator consumersIt = consumers.find(pin);
+                if (tail->requiredOutputs.size() != 1 || consumersIt == consumers.end() ||
+                    consumersIt->second.size() != 1 ||
+                    std::find(blobsToKeep_.begin(), blobsToKeep_.end(), pin) != blobsToKeep_.end())
+                    break;
+
+                LayerData &ldTop = layers[consumersIt->second[0]];
+                if (ldTop.inputBlobsId.size() != 1)
+                    break;
+
+                // Layer might be already fused at the previous allocation.
+                if (!ldTop.skipFlags[DNN_BACKEND_DEFAULT])
+                {
+                    Ptr<Layer> layerTop = ldTop.getLayerInstance();
+                    if (!layer->tryFuse(layerTop))
+                        break;
+                    ldTop.skipFlags[DNN_BACKEND_DEFAULT] = true;
+                }
+                tail = &ldTop;
+            }
+        }
+    }
+
     #define CV_RETHROW_ERROR(err, newmsg)\
         cv::error(err.code, newmsg, err.func.c_str(), err.file.c_str(), err.line)
 
@@ -954,8 +1474,8 @@ struct Net::Impl
 
         CV_Assert(layerShapesIt != layersShapes.end());
 
-        std::vector<LayerPin> pinsForInternalBlobs;
-        blobManager.allocateBlobsForLayer(ld, layerShapesIt->second, pinsForInternalBlobs);
+        blobManager.allocateBlobsForLayer(ld, layerShapesIt->second);
+        bindDeviceBlobs(ld);
 
         Ptr<Layer> layerPtr = ld.getLayerInstance();
         {
@@ -971,13 +1491,173 @@ struct Net::Impl
 #endif
         }
 
-        // After allocation of layer, we decrease counters to it's input blobs.
-        blobManager.releaseReferences(ld.inputBlobsId);
-        blobManager.releaseReferences(pinsForInternalBlobs);
-
         ld.flag = 1;
     }
 
+    bool useOpenCL() const
+    {
+        return preferableBackend == DNN_BACKEND_OPENCL && haveOpenCL();
+    }
+
+    void bindDeviceBlobs(LayerData &ld)
+    {
+        ld.umatOutputs.clear();
+        ld.umatInternals.clear();
+        ld.outputsOnHost = true;
+        ld.outputsOnDevice = false;
+        if (!useOpenCL())
+            return;
+
+        ld.umatOutputs.resize(ld.outputBlobs.size());
+        for (size_t i = 0; i < ld.outputBlobs.size(); i++)
+            ld.umatOutputs[i] = blobManager.deviceBlob(ld.outputBlobs[i]);
+
+        ld.umatInternals.resize(ld.internals.size());
+        for (size_t i = 0; i < ld.internals.size(); i++)
+            ld.umatInternals[i] = blobManager.deviceBlob(ld.internals[i]);
+    }
+
+    // Copies outputs of the layer to device or to host if they are not
+    // actual there. Used only for OpenCL backend.
+    void syncOutputs(LayerData &ld, bool toDevice)
+    {
+        if (toDevice ? ld.outputsOnDevice : ld.outputsOnHost)
+            return;
+
+        CV_Assert(ld.umatOutputs.size() == ld.outputBlobs.size());
+        for (size_t i = 0; i < ld.outputBlobs.size(); i++)
+        {
+            if (ld.outputBlobs[i].empty())
+                continue;
+            if (toDevice)
+                ld.outputBlobs[i].copyTo(ld.umatOutputs[i]);
+            else
+                ld.umatOutputs[i].copyTo(ld.outputBlobs[i]);
+        }
+        ld.outputsOnHost = ld.outputsOnDevice = true;
+    }
+
+    // Computes layer on device if it's possible. Blobs are copied between host
+    // and device only if the layer is computed on the other side than its inputs.
+    void forwardLayerOCL(LayerData &ld)
+    {
+        Ptr<Layer> layer = ld.layerInstance;
+        if (ld.skipFlags[DNN_BACKEND_DEFAULT])
+        {
+            // Fused layer shares memory with its input so values are at the same place.
+            CV_Assert(ld.inputBlobsId.size() == 1);
+            const LayerData &ldInp = layers[ld.inputBlobsId[0].lid];
+            ld.outputsOnHost = ldInp.outputsOnHost;
+            ld.outputsOnDevice = ldInp.outputsOnDevice;
+            return;
+        }
+
+        if (useOpenCL() && layer->supportBackend(DNN_BACKEND_OPENCL))
+        {
+            std::vector<UMat*> inputs(ld.inputBlobsId.size());
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                LayerData &ldInp = layers[ld.inputBlobsId[i].lid];
+                syncOutputs(ldInp, true);
+                inputs[i] = &ldInp.umatOutputs[ld.inputBlobsId[i].oid];
+            }
+            if (layer->forwardOCL(inputs, ld.umatOutputs, ld.umatInternals))
+            {
+                ld.outputsOnHost = false;
+                ld.outputsOnDevice = true;
+                ld.timeBackend = DNN_BACKEND_OPENCL;
+                return;
+            }
+        }
+
+        for (size_t i = 0; i < ld.inputBlobsId.size(); i++)
+            syncOutputs(layers[ld.inputBlobsId[i].lid], false);
+        layer->forward(ld.inputBlobs, ld.outputBlobs, ld.internals);
+        ld.outputsOnHost = true;
+        ld.outputsOnDevice = false;
+    }
+
+    // Computes in-place computations and lifetimes of all the blobs to plan
+    // the memory arena. Layers are processed in the order of forward pass.
+    void planMemory(BlobManager& manager, const LayersShapesMap& layersShapes,
+                    const std::vector<LayerPin>& blobsToKeep_)
+    {
+        MapIdToLayerData::iterator it;
+        manager.reset();
+        for (it = layers.begin(); it != layers.end(); ++it)
+        {
+            const LayerData& ld = it->second;
+            manager.addReferences(ld.inputBlobsId);
+        }
+
+        for (int i = 0; i < blobsToKeep_.size(); i++)
+        {
+            manager.addReference(blobsToKeep_[i]);
+        }
+
+        // Parts of concatenation are placed in one buffer. It's done only
+        // for the backends which compute layers by OpenCV on host memory and
+        // if the buffer's users are computed one by one.
+        const bool concatInPlace = !concurrentForward &&
+                                   (preferableBackend == DNN_BACKEND_DEFAULT ||
+                                    preferableBackend == DNN_BACKEND_OPENCL);
+
+        std::vector<LayerPin> pinsForInternalBlobs;
+        for (it = layers.begin(); it != layers.end(); ++it)
+        {
+            const LayerData& ld = it->second;
+            LayersShapesMap::const_iterator layerShapesIt = layersShapes.find(ld.id);
+            CV_Assert(layerShapesIt != layersShapes.end());
+
+            manager.planBlobsForLayer(ld, layerShapesIt->second, pinsForInternalBlobs);
+            if (concatInPlace)
+            {
+                Ptr<ConcatLayer> concat = ld.layerInstance.dynamicCast<ConcatLayer>();
+                if (!concat.empty())
+                    manager.planConcatInputs(ld, layerShapesIt->second, concat->axis);
+            }
+
+            // After allocation of layer, we decrease counters to it's input blobs.
+            manager.releaseReferences(ld.inputBlobsId);
+            manager.releaseReferences(pinsForInternalBlobs);
+        }
+
+        if (concurrentForward)
+        {
+            std::vector<std::vector<bool> > precedes;
+            getLayersPrecedence(precedes);
+            manager.planArena(&precedes);
+        }
+        else
+            manager.planArena();
+    }
+
+    // precedes[a][b] is true if layer <b> takes inputs from layer <a>
+    // directly or through the other layers. Layers inputs are always
+    // produced by layers with lower ids.
+    void getLayersPrecedence(std::vector<std::vector<bool> >& precedes)
+    {
+        const int numIds = layers.rbegin()->first + 1;
+        precedes.assign(numIds, std::vector<bool>(numIds, false));
+        MapIdToLayerData::iterator it;
+        for (it = layers.begin(); it != layers.end(); ++it)
+        {
+            const int id = it->first;
+            const std::vector<LayerPin>& inputs = it->second.inputBlobsId;
+            for (size_t i = 0; i < inputs.size(); ++i)
+            {
+                const int producer = inputs[i].lid;
+                CV_Assert(producer < id);
+                precedes[producer][id] = true;
+                for (int j = 0; j < producer; ++j)
+                {
+                    if (precedes[j][producer])
+                        precedes[j][id] = true;
+                }
+            }
+        }
+    }
+
     void allocateLayers(const std::vector<LayerPin>& blobsToKeep_)
     {
         MapIdToLayerData::iterator it;
@@ -991,20 +1671,23 @@ struct Net::Impl
             CV_Assert(layers[0].outputBlobs[i].total());
             inputShapes.push_back(shape(layers[0].outputBlobs[i]));
         }
-        LayersShapesMap layersShapes;
-        getLayersShapes(inputShapes, layersShapes);
 
-        blobManager.reset();
-        for (it = layers.begin(); it != layers.end(); ++it)
+        PlansMap::key_type planKey(inputShapes, blobsToKeep_);
+        PlansMap::iterator planIt = allocationPlans.find(planKey);
+        if (planIt == allocationPlans.end())
         {
-            const LayerData& ld = it->second;
-            blobManager.addReferences(ld.inputBlobsId);
+            if (allocationPlans.size() >= maxAllocationPlans)
+                allocationPlans.clear();
+            planIt = allocationPlans.insert(std::make_pair(planKey, AllocationPlan())).first;
+            AllocationPlan& plan = planIt->second;
+            getLayersShapes(inputShapes, plan.layersShapes);
+            planMemory(plan.planner, plan.layersShapes, blobsToKeep_);
         }
+        const LayersShapesMap& layersShapes = planIt->second.layersShapes;
 
-        for (int i = 0; i < blobsToKeep_.size(); i++)
-        {
-            blobManager.addReference(blobsToKeep_[i]);
-        }
+        // Arena only grows so it isn't reallocated for the shapes which fit it.
+        blobManager.copyPlan(planIt->second.planner);
+        blobManager.allocateArena(useOpenCL());
 
         for (it = layers.begin(); it != layers.end(); it++)
         {
@@ -1015,14 +1698,34 @@ struct Net::Impl
 
     void forwardLayer(LayerData &ld)
     {
+        ld.timeStart = getTickCount();
+        ld.timeBackend = DNN_BACKEND_DEFAULT;
+
         Ptr<Layer> layer = ld.layerInstance;
-        if (preferableBackend == DNN_BACKEND_DEFAULT ||
-            !layer->supportBackend(preferableBackend))
+        if (calibrating && !ld.inputBlobs.empty() && !ld.inputBlobs[0]->empty())
+        {
+            float maxAbs = (float)norm(*ld.inputBlobs[0], NORM_INF);
+            std::map<int, float>::iterator it = inputRanges.find(ld.id);
+            if (it == inputRanges.end())
+                inputRanges[ld.id] = maxAbs;
+            else
+                it->second = std::max(it->second, maxAbs);
+        }
+
+        if (preferableBackend == DNN_BACKEND_OPENCL)
+        {
+            forwardLayerOCL(ld);
+        }
+        else if (preferableBackend == DNN_BACKEND_DEFAULT ||
+                 !layer->supportBackend(preferableBackend))
         {
-            layer->forward(ld.inputBlobs, ld.outputBlobs, ld.internals);
+            // Fused layers are computed by the base ones.
+            if (!ld.skipFlags[DNN_BACKEND_DEFAULT])
+                layer->forward(ld.inputBlobs, ld.outputBlobs, ld.internals);
         }
         else if (!ld.skipFlags[preferableBackend])
         {
+            ld.timeBackend = preferableBackend;
             std::vector<Ptr<BackendWrapper> > outputs =
                 backendWrapper.wrap(ld.outputBlobs, preferableBackend);
             Ptr<BackendNode> node = ld.backendNodes[preferableBackend];
@@ -1036,6 +1739,7 @@ struct Net::Impl
             }
         }
 
+        ld.timeTicks = getTickCount() - ld.timeStart;
         ld.flag = 1;
     }
 
@@ -1045,7 +1749,10 @@ struct Net::Impl
         {
             MapIdToLayerData::iterator it;
             for (it = layers.begin(); it != layers.end(); it++)
+            {
                 it->second.flag = 0;
+                it->second.timeStart = it->second.timeTicks = 0;
+            }
         }
 
         //already was forwarded
@@ -1066,6 +1773,95 @@ struct Net::Impl
         forwardLayer(ld);
     }
 
+#ifdef CV_CXX11
+    // The same as forwardToLayer but layers which don't depend on each other
+    // are computed by different threads. Layer is ready to be computed when
+    // all the layers it takes inputs from are done. Memory must be planned
+    // for concurrent computations (see concurrentForward).
+    void forwardToLayerConcurrent(LayerData &target, int numThreads)
+    {
+        CV_Assert(concurrentForward);
+        MapIdToLayerData::iterator it;
+        for (it = layers.begin(); it != layers.end(); it++)
+        {
+            it->second.flag = 0;
+            it->second.timeStart = it->second.timeTicks = 0;
+        }
+
+        // Number of not computed producers of every layer and lists of consumers.
+        std::map<int, int> numPending;
+        std::map<int, std::vector<int> > consumers;
+        std::deque<int> ready;
+        int numLeft = 0;
+        for (it = layers.begin(); it != layers.end() && it->first <= target.id; ++it)
+        {
+            const std::vector<LayerPin>& inputs = it->second.inputBlobsId;
+            std::set<int> producers;
+            for (size_t i = 0; i < inputs.size(); ++i)
+                producers.insert(inputs[i].lid);
+            for (std::set<int>::iterator p = producers.begin(); p != producers.end(); ++p)
+                consumers[*p].push_back(it->first);
+            numPending[it->first] = (int)producers.size();
+            if (producers.empty())
+                ready.push_back(it->first);
+            ++numLeft;
+        }
+
+        std::mutex mtx;
+        std::condition_variable cond;
+        std::exception_ptr error;
+        // Workers take the lowest ready layer ids first to keep the order of
+        // sequential forward pass when there are no independent branches.
+        auto worker = [&]()
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            for (;;)
+            {
+                cond.wait(lock, [&]{ return !ready.empty() || numLeft == 0 || error; });
+                if (numLeft == 0 || error)
+                    break;
+                const int id = ready.front();
+                ready.pop_front();
+                lock.unlock();
+
+                try
+                {
+                    forwardLayer(layers[id]);
+                }
+                catch (...)
+                {
+                    lock.lock();
+                    if (!error)
+                        error = std::current_exception();
+                    cond.notify_all();
+                    break;
+                }
+
+                lock.lock();
+                --numLeft;
+                std::vector<int>& next = consumers[id];
+                for (size_t i = 0; i < next.size(); ++i)
+                {
+                    std::map<int, int>::iterator pendingIt = numPending.find(next[i]);
+                    if (pendingIt != numPending.end() && --pendingIt->second == 0)
+                        ready.insert(std::upper_bound(ready.begin(), ready.end(), next[i]), next[i]);
+                }
+                cond.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < numThreads; ++i)
+            threads.push_back(std::thread(worker));
+        worker();
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+#endif  // CV_CXX11
+
     void forwardAll()
     {
         forwardToLayer(layers.rbegin()->second, true);
@@ -1138,6 +1934,8 @@ struct Net::Impl
             CV_Error(Error::StsOutOfRange, "Layer \"" + ld.name + "\" produce only " + toString(ld.outputBlobs.size()) +
                                            " outputs, the #" + toString(pin.oid) + " was requsted");
         }
+        if (!ld.umatOutputs.empty())
+            syncOutputs(ld, false);
         return ld.outputBlobs[pin.oid];
     }
 
@@ -1172,6 +1970,7 @@ int Net::addLayer(const String &name, const String &type, LayerParams &params)
     int id = ++impl->lastLayerId;
     impl->layerNameToId.insert(std::make_pair(name, id));
     impl->layers.insert(std::make_pair(id, LayerData(id, name, type, params)));
+    impl->allocationPlans.clear();
 
     return id;
 }
@@ -1226,6 +2025,35 @@ Mat Net::forward(const String& outputName)
     return impl->getBlob(layerName);
 }
 
+#ifdef CV_CXX11
+std::future<Mat> Net::forwardAsync(const String& outputName)
+{
+    String layerName = outputName;
+
+    if (layerName.empty())
+        layerName = getLayerNames().back();
+
+    if (!impl->concurrentForward)
+    {
+        impl->concurrentForward = true;
+        impl->netWasAllocated = false;
+        impl->allocationPlans.clear();
+    }
+    impl->setUpNet();
+    const int lid = impl->getLayerData(layerName).id;
+
+    // Only default backend's layers are safe to be computed concurrently.
+    const int numThreads = impl->preferableBackend == DNN_BACKEND_DEFAULT ?
+                           std::max(getNumThreads(), 1) : 1;
+    Ptr<Impl> netImpl = impl;
+    return std::async(std::launch::async, [netImpl, layerName, lid, numThreads]()
+    {
+        netImpl->forwardToLayerConcurrent(netImpl->getLayerData(lid), numThreads);
+        return netImpl->getBlob(layerName);
+    });
+}
+#endif  // CV_CXX11
+
 void Net::forward(std::vector<Mat>& outputBlobs, const String& outputName)
 {
     impl->setUpNet();
@@ -1239,6 +2067,8 @@ void Net::forward(std::vector<Mat>& outputBlobs, const String& outputName)
 
     LayerPin pin = impl->getPinByAlias(layerName);
     LayerData &ld = impl->layers[pin.lid];
+    if (!ld.umatOutputs.empty())
+        impl->syncOutputs(ld, false);
     outputBlobs = ld.outputBlobs;
 }
 
@@ -1293,11 +2123,191 @@ void Net::forward(std::vector<std::vector<Mat> >& outputBlobs,
 
 void Net::setPreferableBackend(int backendId)
 {
-    impl->netWasAllocated = impl->netWasAllocated &&
-                            impl->preferableBackend == backendId;
+    if (impl->preferableBackend != backendId)
+    {
+        impl->netWasAllocated = false;
+        impl->allocationPlans.clear();
+    }
     impl->preferableBackend = backendId;
 }
 
+int64 Net::getPerfProfile(std::vector<double>& timings)
+{
+    timings.assign(impl->layers.rbegin()->first + 1, 0.0);
+    int64 total = 0;
+    Impl::MapIdToLayerData::iterator it;
+    for (it = impl->layers.begin(); it != impl->layers.end(); ++it)
+    {
+        if (it->first == 0)
+            continue;
+        timings[it->first] = (double)it->second.timeTicks;
+        total += it->second.timeTicks;
+    }
+    return total;
+}
+
+static String escapeJson(const String& str)
+{
+    std::ostringstream ss;
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        char c = str[i];
+        if (c == '"' || c == '\\')
+            ss << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            ss << format("\\u%04x", (int)(unsigned char)c);
+        else
+            ss << c;
+    }
+    return ss.str();
+}
+
+void Net::writePerfTrace(const String& path)
+{
+    std::ofstream out(path.c_str());
+    if (!out.is_open())
+        CV_Error(Error::StsError, "Can't open file \"" + path + "\" to write a trace");
+
+    // Trace events timestamps and durations are in microseconds.
+    const double usPerTick = 1e6 / getTickFrequency();
+    int64 origin = 0;
+    Impl::MapIdToLayerData::iterator it;
+    for (it = impl->layers.begin(); it != impl->layers.end(); ++it)
+    {
+        int64 start = it->second.timeStart;
+        if (start != 0 && (origin == 0 || start < origin))
+            origin = start;
+    }
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (it = impl->layers.begin(); it != impl->layers.end(); ++it)
+    {
+        const LayerData& ld = it->second;
+        if (ld.id == 0 || ld.timeStart == 0)
+            continue;
+        const char* backend = ld.timeBackend == DNN_BACKEND_HALIDE ? "HALIDE" : "DEFAULT";
+        std::map<int, bool>::const_iterator skipIt = ld.skipFlags.find(DNN_BACKEND_DEFAULT);
+        bool fused = skipIt != ld.skipFlags.end() && skipIt->second;
+
+        out << (first ? "\n" : ",\n");
+        out << "{\"name\":\"" << escapeJson(ld.name) << "\",\"cat\":\"" << escapeJson(ld.type)
+            << "\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+            << format(",\"ts\":%.3f,\"dur\":%.3f", (ld.timeStart - origin) * usPerTick,
+                      ld.timeTicks * usPerTick)
+            << ",\"args\":{\"id\":" << ld.id << ",\"backend\":\"" << backend
+            << "\",\"fused\":" << (fused ? "true" : "false") << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+}
+
+Net Net::clone() const
+{
+    Net dst;
+    Impl& dstImpl = *dst.impl;
+    dstImpl.layers.clear();
+
+    MapIdToLayerData::const_iterator it;
+    for (it = impl->layers.begin(); it != impl->layers.end(); ++it)
+    {
+        const LayerData& src = it->second;
+        LayerData& ld = dstImpl.layers.insert(std::make_pair(src.id, LayerData())).first->second;
+        ld.id = src.id;
+        ld.name = src.name;
+        ld.type = src.type;
+        ld.params = src.params;  // Shallow copy of learned blobs.
+        ld.inputBlobsId = src.inputBlobsId;
+        ld.inputLayersId = src.inputLayersId;
+        ld.requiredOutputs = src.requiredOutputs;
+
+        // Layers which can't be copied are created from the parameters again.
+        if (!src.layerInstance.empty())
+            ld.layerInstance = src.layerInstance->clone();
+
+        std::map<int, bool>::const_iterator skipIt = src.skipFlags.find(DNN_BACKEND_DEFAULT);
+        if (skipIt != src.skipFlags.end())
+            ld.skipFlags[DNN_BACKEND_DEFAULT] = skipIt->second;
+    }
+
+    // Fused layers stay skipped so the base layers must be copied with fused weights.
+    MapIdToLayerData::iterator dstIt;
+    for (dstIt = dstImpl.layers.begin(); dstIt != dstImpl.layers.end(); ++dstIt)
+    {
+        LayerData& ld = dstIt->second;
+        if (ld.skipFlags[DNN_BACKEND_DEFAULT] && !ld.inputBlobsId.empty() &&
+            dstImpl.layers[ld.inputBlobsId[0].lid].layerInstance.empty())
+        {
+            CV_Error(Error::StsNotImplemented, "Layer \"" + ld.name + "\" is fused into layer "
+                     "which can't be cloned. Disable fusion (see enableFusion) to clone the network");
+        }
+    }
+
+    dstImpl.netInputLayer = dstImpl.layers[0].layerInstance.dynamicCast<DataLayer>();
+    CV_Assert(!dstImpl.netInputLayer.empty());
+    dstImpl.layerNameToId = impl->layerNameToId;
+    dstImpl.lastLayerId = impl->lastLayerId;
+    dstImpl.preferableBackend = impl->preferableBackend;
+    dstImpl.halideConfigFile = impl->halideConfigFile;
+    dstImpl.halideAutotuning = impl->halideAutotuning;
+    dstImpl.halideTuningCache = impl->halideTuningCache;
+    dstImpl.fusion = impl->fusion;
+    dstImpl.concurrentForward = impl->concurrentForward;
+    dstImpl.fp16 = impl->fp16;
+    dstImpl.inputRanges = impl->inputRanges;
+    return dst;
+}
+
+void Net::enableFusion(bool fusion)
+{
+    if (impl->fusion != fusion)
+    {
+        impl->fusion = fusion;
+        impl->netWasAllocated = false;
+        impl->allocationPlans.clear();
+    }
+}
+
+void Net::enableInt8(const std::vector<Mat>& calibrationBlobs, const String& inputName)
+{
+    CV_Assert(!calibrationBlobs.empty());
+    CV_Assert(impl->preferableBackend == DNN_BACKEND_DEFAULT);
+
+    impl->inputRanges.clear();
+    impl->calibrating = true;
+    try
+    {
+        for (size_t i = 0; i < calibrationBlobs.size(); i++)
+        {
+            setInput(calibrationBlobs[i], inputName);
+            forward();
+        }
+    }
+    catch (...)
+    {
+        impl->calibrating = false;
+        throw;
+    }
+    impl->calibrating = false;
+
+    std::map<int, float>::iterator it;
+    for (it = impl->inputRanges.begin(); it != impl->inputRanges.end(); ++it)
+    {
+        LayerData &ld = impl->getLayerData(it->first);
+        ld.getLayerInstance()->tryQuantize(it->second);
+    }
+    impl->inputRanges.clear();
+}
+
+void Net::enableFP16()
+{
+    if (!impl->fp16)
+    {
+        impl->fp16 = true;
+        impl->netWasAllocated = false;
+    }
+}
+
 void Net::setInputsNames(const std::vector<String> &inputBlobNames)
 {
     impl->netInputLayer->setNames(inputBlobNames);
@@ -1320,6 +2330,8 @@ void Net::setInput(const Mat &blob_, const String& name)
         blob_.copyTo(ld.outputBlobs[pin.oid]);
     else
         ld.outputBlobs[pin.oid] = blob_.clone();
+    ld.outputsOnHost = true;
+    ld.outputsOnDevice = false;
 
     impl->netWasAllocated = impl->netWasAllocated && oldShape;
 }
@@ -1575,12 +2587,18 @@ void Net::getMemoryConsumption(const std::vector<MatShape>& netInputShapes,
     std::vector<size_t> w, b;
     getMemoryConsumption(netInputShapes, layerIds, w, b);
 
-    weights = blobs = 0;
+    weights = 0;
     for(int i = 0; i < layerIds.size(); i++)
     {
         weights += w[i];
-        blobs += b[i];
     }
+
+    Impl::LayersShapesMap layersShapes;
+    impl->getLayersShapes(netInputShapes, layersShapes);
+
+    BlobManager planner;
+    impl->planMemory(planner, layersShapes, std::vector<LayerPin>());
+    blobs = planner.getMemoryConsumption();
 }
 
 void Net::getMemoryConsumption(const int layerId,
@@ -1644,6 +2662,12 @@ void Net::setHalideScheduler(const String& scheduler)
     impl->halideConfigFile = scheduler;
 }
 
+void Net::enableHalideAutotuning(bool autotuning, const String& cacheFile)
+{
+    impl->halideAutotuning = autotuning;
+    impl->halideTuningCache = cacheFile;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 Importer::~Importer() {}
@@ -1697,6 +2721,37 @@ Ptr<BackendNode> Layer::tryAttach(const Ptr<BackendNode>& node)
     return Ptr<BackendNode>();
 }
 
+bool Layer::tryQuantize(float)
+{
+    return false;
+}
+
+bool Layer::tryConvertFp16()
+{
+    return false;
+}
+
+bool Layer::tryFuse(Ptr<Layer>&)
+{
+    return false;
+}
+
+Ptr<Layer> Layer::clone() const
+{
+    return Ptr<Layer>();
+}
+
+bool Layer::forwardOCL(std::vector<UMat*>&, std::vector<UMat>&, std::vector<UMat>&)
+{
+    return false;
+}
+
+void Layer::getScaleShift(Mat& scale, Mat& shift) const
+{
+    scale = Mat();
+    shift = Mat();
+}
+
 template <typename T>
 static void vecToPVec(const std::vector<T> &v, std::vector<T*> &pv)
 {
@@ -256,5 +256,152 @@ bool HalideScheduler::process(Ptr<BackendNode>& node)
     return false;
 }
 
+static std::string hostTarget()
+{
+#ifdef HAVE_HALIDE
+    // Parallel schedules depend on the number of cores as well as on
+    // the instruction set.
+    return format("%s-%dcores", Halide::get_host_target().to_string().c_str(),
+                  getNumberOfCPUs());
+#else
+    return std::string();
+#endif  // HAVE_HALIDE
+}
+
+HalideAutotuner::HalideAutotuner(const std::string& cacheFile_)
+    : cacheFile(cacheFile_), target(hostTarget()), modified(false)
+{
+    if (cacheFile.empty())
+        return;
+    FileStorage fs;
+    try
+    {
+        fs.open(cacheFile, FileStorage::READ);
+    }
+    catch (const cv::Exception&)
+    {
+        // Broken cache is replaced by the new one.
+    }
+    if (!fs.isOpened())
+        return;
+
+    FileNode schedulesNode = fs["schedules"];
+    for (FileNodeIterator it = schedulesNode.begin(); it != schedulesNode.end(); ++it)
+    {
+        const FileNode& node = *it;
+        std::string entryTarget, layer;
+        node["target"] >> entryTarget;
+        node["layer"] >> layer;
+        HalideSchedule schedule((int)node["pattern"], (int)node["split"],
+                                (int)node["vectorize"]);
+        if (!entryTarget.empty() && !layer.empty())
+            schedules[entryTarget + "|" + layer] = schedule;
+    }
+}
+
+HalideAutotuner::~HalideAutotuner()
+{
+    if (cacheFile.empty() || !modified)
+        return;
+    try
+    {
+        FileStorage fs(cacheFile, FileStorage::WRITE);
+        if (!fs.isOpened())
+            return;
+        fs << "schedules" << "[";
+        std::map<std::string, HalideSchedule>::const_iterator it;
+        for (it = schedules.begin(); it != schedules.end(); ++it)
+        {
+            size_t sep = it->first.find('|');
+            fs << "{" << "target" << it->first.substr(0, sep)
+                      << "layer" << it->first.substr(sep + 1)
+                      << "pattern" << it->second.pattern
+                      << "split" << it->second.split
+                      << "vectorize" << it->second.vectorize << "}";
+        }
+        fs << "]";
+    }
+    catch (const cv::Exception&)
+    {
+        // Don't throw from destructor. Schedules will be found again next time.
+    }
+}
+
+bool HalideAutotuner::find(const std::string& key, HalideSchedule& schedule) const
+{
+    std::map<std::string, HalideSchedule>::const_iterator it;
+    it = schedules.find(target + "|" + key);
+    if (it == schedules.end())
+        return false;
+    schedule = it->second;
+    return true;
+}
+
+void HalideAutotuner::add(const std::string& key, const HalideSchedule& schedule)
+{
+    schedules[target + "|" + key] = schedule;
+    modified = true;
+}
+
+std::vector<HalideSchedule> HalideAutotuner::candidates(const MatShape& outShape)
+{
+    int outW, outH, outC, outN;
+    getCanonicalSize(outShape, &outW, &outH, &outC, &outN);
+
+    std::vector<HalideSchedule> res(1, HalideSchedule(HalideSchedule::LAYER_DEFAULT));
+    static const int vectorWidths[] = {4, 8, 16};
+    for (int i = 0; i < 3; ++i)
+    {
+        const int vec = vectorWidths[i];
+        if (vec > outW)
+            break;
+        res.push_back(HalideSchedule(HalideSchedule::CHANNELS, 0, vec));
+        for (int rows = 2; rows <= 8 && rows <= outH; rows *= 2)
+            res.push_back(HalideSchedule(HalideSchedule::ROWS, rows, vec));
+        for (int channels = 4; channels <= 16 && channels <= outC; channels *= 2)
+            res.push_back(HalideSchedule(HalideSchedule::CHANNEL_BLOCKS, channels, vec));
+    }
+    return res;
+}
+
+void HalideAutotuner::apply(const HalideSchedule& schedule, const Ptr<Layer>& layer,
+                            Ptr<BackendNode>& node, const std::vector<Mat*>& inputs,
+                            const std::vector<Mat>& outputs)
+{
+    if (schedule.pattern == HalideSchedule::LAYER_DEFAULT)
+    {
+        layer->applyHalideScheduler(node, inputs, outputs);
+        return;
+    }
+#ifdef HAVE_HALIDE
+    CV_Assert(!node.empty());
+    Halide::Func& top = node.dynamicCast<HalideBackendNode>()->funcs.back();
+    Halide::Var x("x"), y("y"), c("c"), n("n"), tile("tile"),
+                xo("xo"), xi("xi"), yo("yo"), yi("yi"), co("co"), ci("ci");
+    switch (schedule.pattern)
+    {
+    case HalideSchedule::CHANNELS:
+        top.reorder(x, y, c, n).fuse(c, n, tile);
+        break;
+    case HalideSchedule::ROWS:
+        top.split(y, yo, yi, schedule.split)
+           .reorder(x, yi, c, yo, n)
+           .fuse(yo, n, tile);
+        break;
+    case HalideSchedule::CHANNEL_BLOCKS:
+        top.split(c, co, ci, schedule.split)
+           .reorder(x, ci, y, co, n)
+           .fuse(co, n, tile);
+        break;
+    default:
+        CV_Error(Error::StsNotImplemented, format("Unknown scheduling pattern %d",
+                                                  schedule.pattern));
+    }
+    top.parallel(tile)
+       .split(x, xo, xi, schedule.vectorize)
+       .vectorize(xi);
+#endif  // HAVE_HALIDE
+}
+
 }  // namespace dnn
 }  // namespace cv
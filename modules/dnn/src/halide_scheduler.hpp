@@ -31,6 +31,55 @@ private:
     FileStorage fs;
 };
 
+// Generic schedule of the top Halide function over x, y, c, n variables.
+struct HalideSchedule
+{
+    enum Pattern
+    {
+        LAYER_DEFAULT = 0,  // Layer::applyHalideScheduler.
+        CHANNELS = 1,       // Parallel over channels (whole planes).
+        ROWS = 2,           // Parallel over tiles of <split> rows.
+        CHANNEL_BLOCKS = 3  // Parallel over blocks of <split> channels.
+    };
+
+    HalideSchedule(int pattern_ = LAYER_DEFAULT, int split_ = 0, int vectorize_ = 0)
+        : pattern(pattern_), split(split_), vectorize(vectorize_) {}
+
+    int pattern;
+    int split;
+    int vectorize;  // Vectorization factor of x.
+};
+
+// Keeps the best schedules found by benchmarking of candidates (see Net::enableHalideAutotuning).
+// Schedules are stored in YAML file for every layer's key and host CPU so the next
+// runs of the same network apply them without exploration.
+class HalideAutotuner
+{
+public:
+    HalideAutotuner(const std::string& cacheFile);
+
+    // Writes updated cache back to the file.
+    ~HalideAutotuner();
+
+    // Returns true if schedule for layer's key was found for the current CPU.
+    bool find(const std::string& key, HalideSchedule& schedule) const;
+
+    void add(const std::string& key, const HalideSchedule& schedule);
+
+    // Candidate schedules for the output of the given shape. The first one is LAYER_DEFAULT.
+    static std::vector<HalideSchedule> candidates(const MatShape& outShape);
+
+    static void apply(const HalideSchedule& schedule, const Ptr<Layer>& layer,
+                      Ptr<BackendNode>& node, const std::vector<Mat*>& inputs,
+                      const std::vector<Mat>& outputs);
+
+private:
+    std::string cacheFile, target;
+    // Schedules of all the CPUs found in the cache. The key is CPU + layer's key.
+    std::map<std::string, HalideSchedule> schedules;
+    bool modified;
+};
+
 }  // namespace dnn
 }  // namespace cv
 
@@ -0,0 +1,195 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "precomp.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
+
+#ifdef CV_CXX11
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <exception>
+
+namespace cv
+{
+namespace dnn
+{
+
+struct InferenceQueue::Impl
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request
+    {
+        Mat blob;
+        std::promise<Mat> result;
+        Clock::time_point arrival;
+    };
+
+    Impl(const Net& net_, int maxBatchSize_, double maxLatency_,
+         const String& inputName_, const String& outputName_)
+        : net(net_), inputName(inputName_), outputName(outputName_),
+          maxBatchSize(maxBatchSize_), stopped(false)
+    {
+        CV_Assert(!net.empty());
+        CV_Assert(maxBatchSize > 0 && maxLatency_ >= 0);
+        maxLatency = std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double, std::milli>(maxLatency_));
+        worker = std::thread(&Impl::run, this);
+    }
+
+    ~Impl()
+    {
+        stop();
+    }
+
+    std::future<Mat> push(const Mat& blob)
+    {
+        CV_Assert(blob.dims >= 2 && blob.size[0] == 1 && blob.type() == CV_32F);
+
+        Request req;
+        req.blob = blob.isContinuous() ? blob : blob.clone();
+        req.arrival = Clock::now();
+        std::future<Mat> res = req.result.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (stopped)
+                CV_Error(Error::StsError, "Inference queue is stopped");
+            queue.push_back(std::move(req));
+        }
+        cond.notify_one();
+        return res;
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopped = true;
+        }
+        cond.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // Number of leading requests that have the same shape as the first one.
+    // Only such requests might be stacked into a single batch.
+    size_t compatibleRequests() const
+    {
+        const MatShape firstShape = shape(queue.front().blob);
+        size_t num = 1;
+        while (num < queue.size() && (int)num < maxBatchSize &&
+               shape(queue[num].blob) == firstShape)
+            ++num;
+        return num;
+    }
+
+    void run()
+    {
+        std::vector<Request> batch;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cond.wait(lock, [this]{ return stopped || !queue.empty(); });
+                if (queue.empty())
+                    break;  // Stopped and all the requests have been processed.
+
+                // Wait for the batch to be filled up before the latency budget expires.
+                // If request of another shape is arrived there is no reason to wait more.
+                const Clock::time_point deadline = queue.front().arrival + maxLatency;
+                cond.wait_until(lock, deadline, [this]{
+                    size_t num = compatibleRequests();
+                    return stopped || (int)num == maxBatchSize || num < queue.size();
+                });
+
+                size_t num = compatibleRequests();
+                batch.clear();
+                for (size_t i = 0; i < num; ++i)
+                {
+                    batch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+            processBatch(batch);
+        }
+    }
+
+    void processBatch(std::vector<Request>& batch)
+    {
+        size_t numDone = 0;
+        try
+        {
+            const int batchSize = (int)batch.size();
+            MatShape inpShape = shape(batch[0].blob);
+            inpShape[0] = batchSize;
+
+            Mat inp(inpShape, CV_32F);
+            const size_t sampleSize = batch[0].blob.total() * batch[0].blob.elemSize();
+            for (int i = 0; i < batchSize; ++i)
+                memcpy(inp.ptr(i), batch[i].blob.data, sampleSize);
+
+            net.setInput(inp, inputName);
+            Mat out = net.forward(outputName);
+
+            if (out.dims < 1 || out.size[0] != batchSize)
+                CV_Error(Error::StsUnmatchedSizes, "Output blob \"" + outputName +
+                         "\" has first dimension different from the batch size");
+
+            MatShape outShape = shape(out);
+            outShape[0] = 1;
+            for (int i = 0; i < batchSize; ++i)
+            {
+                // Output blobs are reused between forward passes, so copy the result.
+                Mat sample(outShape, out.type(), out.ptr(i));
+                batch[i].result.set_value(sample.clone());
+                ++numDone;
+            }
+        }
+        catch (...)
+        {
+            std::exception_ptr err = std::current_exception();
+            for (size_t i = numDone; i < batch.size(); ++i)
+                batch[i].result.set_exception(err);
+        }
+    }
+
+    Net net;
+    String inputName, outputName;
+    int maxBatchSize;
+    Clock::duration maxLatency;
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::deque<Request> queue;
+    bool stopped;
+    std::thread worker;
+};
+
+InferenceQueue::InferenceQueue(const Net& net, int maxBatchSize, double maxLatency,
+                               const String& inputName, const String& outputName)
+    : impl(new Impl(net, maxBatchSize, maxLatency, inputName, outputName))
+{
+}
+
+InferenceQueue::~InferenceQueue()
+{
+}
+
+std::future<Mat> InferenceQueue::push(const Mat& blob)
+{
+    return impl->push(blob);
+}
+
+void InferenceQueue::stop()
+{
+    impl->stop();
+}
+
+}
+}
+
+#endif  // CV_CXX11
@@ -46,10 +46,9 @@ public:
                backendId == DNN_BACKEND_HALIDE && haveHalide();
     }
 
-    void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
+    void getScaleShift(Mat& scale, Mat& shift) const
     {
         CV_Assert(blobs.size() >= 2);
-        CV_Assert(inputs.size() == 1);
 
         float varMeanScale = 1.f;
         if (!hasWeights && !hasBias) {
@@ -58,13 +57,33 @@ public:
                 varMeanScale = 1/varMeanScale;
         }
 
-        Mat invStdMat;
-        cv::pow(blobs[1]*varMeanScale + epsilon, -0.5, invStdMat);
+        const int weightsBlobIndex = 2;
+        const int biasBlobIndex = weightsBlobIndex + hasWeights;
+        const int numChannels = (int)blobs[0].total();
 
-        Mat &inpBlob = *inputs[0];
+        scale.create(1, numChannels, CV_32F);
+        shift.create(1, numChannels, CV_32F);
+        for (int i = 0; i < numChannels; ++i)
+        {
+            float mean = blobs[0].at<float>(i)*varMeanScale;
+            float invstd = 1.f / std::sqrt(blobs[1].at<float>(i)*varMeanScale + epsilon);
+            float w = hasWeights ? blobs[weightsBlobIndex].at<float>(i) : 1;
+            float b = hasBias ? blobs[biasBlobIndex].at<float>(i) : 0;
+            scale.at<float>(i) = w*invstd;
+            shift.at<float>(i) = b - mean*w*invstd;
+        }
+    }
 
-        int weightsBlobIndex = 2;
-        int biasBlobIndex = weightsBlobIndex + hasWeights;
+    void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
+    {
+        CV_Assert(blobs.size() >= 2);
+        CV_Assert(inputs.size() == 1);
+
+        Mat scale, shift;
+        getScaleShift(scale, shift);
+
+        Mat &inpBlob = *inputs[0];
+        CV_Assert((size_t)inpBlob.size[1] == scale.total());
 
         int rows = inpBlob.size[2];
         int cols = inpBlob.size[3];
@@ -73,23 +92,13 @@ public:
         {
             Mat &outBlob = outputs[ii];
 
-            if (hasWeights)
-                CV_Assert(inpBlob.size[1] == blobs[weightsBlobIndex].total());
-
-            if (hasBias)
-                CV_Assert(inpBlob.size[1] == blobs[biasBlobIndex].total());
-
             for(int num = 0; num < outBlob.size[0]; num++)
             {
                 for (int n = 0; n < outBlob.size[1]; n++)
                 {
-                    float mean = blobs[0].at<float>(n)*varMeanScale;
-                    double invstd = invStdMat.at<float>(n);
-                    float w = hasWeights ? blobs[weightsBlobIndex].at<float>(n) : 1;
-                    float b = hasBias ? blobs[biasBlobIndex].at<float>(n) : 0;
                     Mat inpBlobPlane(rows, cols, CV_32F, inpBlob.ptr<float>(num, n));
                     Mat outBlobPlane(rows, cols, CV_32F, outBlob.ptr<float>(num, n));
-                    inpBlobPlane.convertTo(outBlobPlane, CV_32F, w*invstd, b - mean*w*invstd);
+                    inpBlobPlane.convertTo(outBlobPlane, CV_32F, scale.at<float>(n), shift.at<float>(n));
                 }
             }
         }
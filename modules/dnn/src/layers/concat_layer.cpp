@@ -103,7 +103,10 @@ public:
         for (size_t i = 0; i < inputs.size(); i++)
         {
             ranges[cAxis].end = ranges[cAxis].start + inputs[i]->size[cAxis];
-            inputs[i]->copyTo(outMat(&ranges[0]));
+            Mat part = outMat(&ranges[0]);
+            // Input might be already computed in the output (see BlobManager).
+            if (part.data != inputs[i]->data)
+                inputs[i]->copyTo(part);
             ranges[cAxis].start = ranges[cAxis].end;
         }
     }
@@ -44,8 +44,14 @@
 #include "op_im2col.hpp"
 #include "op_blas.hpp"
 #include "op_halide.hpp"
+#include "op_int8.hpp"
+#include "op_fp16.hpp"
+#include "../op_opencl.hpp"
 #include "opencv2/core/hal/intrin.hpp"
 #include <iostream>
+#ifdef HAVE_OPENCL
+#include "opencl_kernels_dnn.hpp"
+#endif
 
 namespace cv
 {
@@ -106,6 +112,11 @@ public:
         (dilation.height == 1 && dilation.width == 1);
     }
     bool setActivation(const Ptr<ActivationLayer>& ) { return false; }
+    // Every group has a single input and a single output channel.
+    bool isDepthwise(int inpCn) const
+    {
+        return inpCn > 1 && blobs[0].size[1] == 1 && blobs[0].size[0] == inpCn;
+    }
 
     virtual void applyHalideScheduler(Ptr<BackendNode>& node,
                                       const std::vector<Mat*> &inputs,
@@ -122,6 +133,18 @@ public:
         if (outW == 1 || outH <= 2)
             return;
 
+        if (isDepthwise(inputs[0]->size[1]))
+        {
+            // Reduction is only over kernel window so channels are processed
+            // in parallel without splitting of rows.
+            top.reorder(x, y, c, n)
+               .fuse(c, n, tile)
+               .parallel(tile)
+               .vectorize(x, outW >= 8 ? 8 : outW);
+            padded_input.compute_at(top, tile);
+            return;
+        }
+
         if (is1x1() || outC <= 16)
             top.reorder(x, c, y)
                .split(y, yo, yi, 2)
@@ -147,8 +170,54 @@ class ConvolutionLayerImpl : public BaseConvolutionLayerImpl
 {
 public:
     enum { VEC_ALIGN = 8 };
-    Mat weightsMat;
+    // Aligned copies of weights and biases which are used in computations.
+    // They differ from blobs if batch normalization or scale layer is fused.
+    Mat weightsMat, biasMat;
     Ptr<ActivationLayer> activ;
+    // Weights transformed for Winograd engine, see WinogradConv.
+    Mat winogradWeights;
+    bool winogradEnabled, useWinograd;
+
+    // Half precision copy of weightsMat which replaces it, see tryConvertFp16().
+    Mat weightsFp16;
+
+    // Quantized weights and scales of products, see tryQuantize().
+    Mat weightsInt8, inputInt8;
+    std::vector<float> outputScales;
+    float inputScale;
+    bool useInt8;
+
+#ifdef HAVE_OPENCL
+    // Device copies of weightsMat and biasMat (broadcasted over output plane)
+    // and a buffer for unrolled input, see forwardOCL().
+    UMat umatWeights, umatBias, umatCol;
+#endif
+
+    ConvolutionLayerImpl() : winogradEnabled(true), useWinograd(false),
+                             inputScale(1.f), useInt8(false) {}
+
+    void finalize(const std::vector<Mat*> &inputs, std::vector<Mat> &outputs)
+    {
+        BaseConvolutionLayerImpl::finalize(inputs, outputs);
+        initWeights();
+
+        // Transformed weights don't depend on input shape. They are kept
+        // to be shared by copies of the layer, see clone().
+        useWinograd = winogradEnabled && canUseWinograd(*inputs[0], outputs[0]);
+        if (useWinograd && winogradWeights.empty())
+            WinogradConv::transformWeights(weightsMat, winogradWeights);
+    }
+
+    // Winograd convolution requires more memory and gives speedup only if
+    // there are enough channels to amortize input and output transforms.
+    bool canUseWinograd(const Mat& input, const Mat& output) const
+    {
+        int ngroups = input.size[1] / blobs[0].size[1];
+        return kernel == Size(3, 3) && stride == Size(1, 1) && dilation == Size(1, 1) &&
+               ngroups == 1 && input.type() == CV_32F &&
+               input.size[1] >= 16 && output.size[1] >= 16 &&
+               output.size[2] >= 4 && output.size[3] >= 4;
+    }
 
     MatShape computeColRowShape(const MatShape &inpShape, const MatShape &outShape) const
     {
@@ -197,6 +266,72 @@ public:
 
     bool setActivation(const Ptr<ActivationLayer>& layer) { activ = layer; return true; }
 
+    void initWeights()
+    {
+        if( !weightsMat.empty() || !weightsFp16.empty() )
+            return;
+
+        int outCn = blobs[0].size[0];
+        Mat wm = blobs[0].reshape(1, outCn);
+        int newcols = (int)alignSize(wm.step1(), VEC_ALIGN);
+        Mat wm_buffer = Mat::zeros(outCn, newcols, wm.type());
+        weightsMat = wm_buffer.colRange(0, wm.cols);
+        wm.copyTo(weightsMat);
+
+        if( hasBias() )
+            blobs[1].reshape(1, outCn).copyTo(biasMat);
+        else
+            biasMat = Mat::zeros(outCn, 1, CV_32F);
+    }
+
+    // Folds channel-wise multiplication and addition of the next layer:
+    // conv(x)*scale + shift = conv'(x) with weights*scale and bias*scale + shift.
+    void fuseWeights(const Mat& scale, const Mat& shift)
+    {
+        initWeights();
+        winogradWeights.release();
+#ifdef HAVE_OPENCL
+        umatWeights.release();
+        umatBias.release();
+#endif
+        int outCn = weightsMat.rows;
+        CV_Assert((scale.empty() || scale.total() == (size_t)outCn) &&
+                  (shift.empty() || shift.total() == (size_t)outCn));
+        CV_Assert((scale.empty() || scale.type() == CV_32F) &&
+                  (shift.empty() || shift.type() == CV_32F));
+
+        for( int i = 0; i < outCn; i++ )
+        {
+            float s = scale.empty() ? 1.f : scale.ptr<float>()[i];
+            float b = shift.empty() ? 0.f : shift.ptr<float>()[i];
+            Mat w = weightsMat.row(i);
+            w *= s;
+            biasMat.at<float>(i) = biasMat.at<float>(i)*s + b;
+        }
+    }
+
+    virtual bool tryFuse(Ptr<Layer>& top)
+    {
+        // Weights can't be changed after quantization and multiplication
+        // can't be moved over the activation.
+        if( useInt8 || activ )
+            return false;
+
+        Mat scale, shift;
+        top->getScaleShift(scale, shift);
+        if( !scale.empty() || !shift.empty() )
+        {
+            // Half precision weights aren't modified.
+            if( !weightsFp16.empty() )
+                return false;
+            fuseWeights(scale, shift);
+            return true;
+        }
+
+        Ptr<ActivationLayer> activLayer = top.dynamicCast<ActivationLayer>();
+        return !activLayer.empty() && setActivation(activLayer);
+    }
+
     virtual Ptr<BackendNode> initHalide(const std::vector<Ptr<BackendWrapper> > &inputs)
     {
 #ifdef HAVE_HALIDE
@@ -226,20 +361,12 @@ public:
 
         Halide::RDom r(0, kernel.width, 0, kernel.height, 0, inpGroupCn);
 
+        // The first input channel of the group is computed directly instead
+        // of the chain of selects which is as long as the number of groups
+        // (i.e. depthwise convolution has a group per channel).
         Halide::Expr kc = r.z;
         if (group > 1)
-        {
-            int outCnBound = outGroupCn;
-            int inpChBound = inpGroupCn;
-            Halide::Expr shift = select(c < outCnBound, 0, inpChBound);
-            for (int i = 2; i < group; ++i)
-            {
-                outCnBound += outGroupCn;
-                inpChBound += inpGroupCn;
-                shift = select(c < outCnBound, shift, inpChBound);
-            }
-            kc += shift;
-        }
+            kc += (c / outGroupCn) * inpGroupCn;
 
         Halide::Expr kx = x * stride.width - pad.width + r.x * dilation.width;
         Halide::Expr ky = y * stride.height - pad.height + r.y * dilation.height;
@@ -273,6 +400,7 @@ public:
         const ActivationLayer* activ_;
         bool is1x1_;
         bool useAVX2;
+        bool useNEON;
 
         ParallelConv() {}
 
@@ -286,7 +414,7 @@ public:
                        weights.rows == output.size[1] &&
                        weights.cols == (input.size[1]/ngroups)*kernel.width*kernel.height &&
                        input.type() == output.type() &&
-                       input.type() == weights.type() &&
+                       (weights.type() == CV_32F || weights.type() == CV_16S) &&
                        input.type() == CV_32F &&
                        input.isContinuous() &&
                        output.isContinuous() &&
@@ -308,6 +436,7 @@ public:
             int k, outCn = output.size[1];
             p.is1x1_ = kernel == Size(0,0) && pad == Size(0, 0);
             p.useAVX2 = checkHardwareSupport(CPU_AVX2);
+            p.useNEON = checkHardwareSupport(CPU_NEON);
 
             int ncn = std::min(inpCn, (int)BLK_SIZE_CN);
             p.ofstab_.resize(kernel.width*kernel.height*ncn);
@@ -374,14 +503,19 @@ public:
 
             const float* data_inp0_ = input_->ptr<float>();
             const int* ofstab = &ofstab_[0];
-            const float* wptr_orig_ = weights_->ptr<float>();
-            size_t wstep = weights_->step1();
+            // Half precision weights are converted for every block of input channels.
+            const bool fp16 = weights_->type() == CV_16S;
+            const float* wptr_orig_ = fp16 ? 0 : weights_->ptr<float>();
+            const size_t wstep_orig = weights_->step1();
             const float* biasvec = &biasvec_[0];
             float* data_out0_ = output_->ptr<float>();
             size_t rowbufsz = (size_t)karea*BLK_SIZE_CN*BLK_SIZE;
             const int valignBytes = (int)(valign*sizeof(float));
             AutoBuffer<float> rowbuf0_(rowbufsz + valignBytes);
             float* rowbuf0 = alignPtr((float*)rowbuf0_, valignBytes);
+            size_t wbufsz = fp16 ? outCn*alignSize(karea*BLK_SIZE_CN, valign) : 0;
+            AutoBuffer<float> wbuf0_(wbufsz + valignBytes);
+            float* wbuf0 = alignPtr((float*)wbuf0_, valignBytes);
 
             // we clear the buffer once; ultimately, it lets us to avoid
             // tail processing after running the unrolled/vectorized loop.
@@ -404,7 +538,7 @@ public:
                 const float* data_inp0 = data_inp0_ + subsampleIdx*inpPlaneSize*inpCn;
                 float* data_out0 = data_out0_ + subsampleIdx*outPlaneSize*outCn;
                 int startOutCn = (subsampleIdx % ngroups)*outCn;
-                const float* wptr_orig = wptr_orig_ + wstep*startOutCn;
+                const float* wptr_orig = fp16 ? 0 : wptr_orig_ + wstep_orig*startOutCn;
                 const float* biasptr = biasvec + startOutCn;
 
                 for( int cn0 = 0; cn0 < inpCn; cn0 += BLK_SIZE_CN )
@@ -412,7 +546,22 @@ public:
                     int cn1 = std::min(cn0 + BLK_SIZE_CN, inpCn);
                     int ncn = cn1 - cn0, vsz = karea*ncn;
                     int vsz_a = (int)alignSize(vsz, valign);
-                    const float* wptr = wptr_orig + cn0*karea;
+                    const float* wptr;
+                    size_t wstep;
+                    if( fp16 )
+                    {
+                        // Rows are padded so the aligned block is inside of them.
+                        for( i = 0; i < outCn; i++ )
+                            convertFp16ToFp32(weights_->ptr<short>(startOutCn + i) + cn0*karea,
+                                              wbuf0 + (size_t)i*vsz_a, vsz_a);
+                        wptr = wbuf0;
+                        wstep = vsz_a;
+                    }
+                    else
+                    {
+                        wptr = wptr_orig + cn0*karea;
+                        wstep = wstep_orig;
+                    }
 
                     for( int ofs0 = stripeStart; ofs0 < stripeEnd; ofs0 += BLK_SIZE )
                     {
@@ -489,6 +638,11 @@ public:
                         if(useAVX2)
                             fastConv_avx2(wptr, wstep, biasptr, rowbuf0, data_out0 + ofs0, outShape, bsz, vsz, vsz_a, cn0 == 0);
                         else
+                    #endif
+                    #if CV_DNN_TRY_NEON
+                        if(useNEON)
+                            fastConv_neon(wptr, wstep, biasptr, rowbuf0, data_out0 + ofs0, outShape, bsz, vsz, vsz_a, cn0 == 0);
+                        else
                     #endif
                         for( int i = 0; i < outCn; i += 2 )
                         {
@@ -588,6 +742,585 @@ public:
         }
     };
 
+    // Winograd minimal filtering algorithm F(2x2, 3x3). Every 2x2 output tile
+    // is computed from 4x4 input tile by 16 multiplications per input channel
+    // instead of 36 ones of direct convolution:
+    //   Y = A^T [ sum_c (G g_c G^T) .* (B^T d_c B) ] A
+    // Element-wise products over channels are done as 16 independent matrix
+    // multiplications of transformed weights and transformed input tiles.
+    class WinogradConv : public cv::ParallelLoopBody
+    {
+    public:
+        enum { TILE_BLK = 32, NCOEFFS = 16 };
+
+        const Mat* input_;
+        const Mat* weights_;
+        Mat* output_;
+        Size pad_;
+        int tilesH_, tilesW_, nblocks_;
+        std::vector<float> biasvec_;
+
+        WinogradConv() {}
+
+        // Transforms weights of shape [outCn x inpCn x 3 x 3] to the matrix of
+        // shape [16*outCn x inpCn], so the coefficient k of filter U = G g G^T
+        // for output channel oc and input channel ic is at (k*outCn + oc, ic).
+        static void transformWeights(const Mat& weights, Mat& dst)
+        {
+            // Weights are stored as [outCn x inpCn*3*3] matrix.
+            CV_Assert(weights.dims == 2 && weights.cols % 9 == 0 && weights.type() == CV_32F);
+            int outCn = weights.rows, inpCn = weights.cols / 9;
+            dst.create(NCOEFFS*outCn, inpCn, CV_32F);
+
+            for( int oc = 0; oc < outCn; oc++ )
+                for( int ic = 0; ic < inpCn; ic++ )
+                {
+                    const float* g = weights.ptr<float>(oc) + ic*9;
+                    float tmp[4][3], u[4][4];
+                    for( int j = 0; j < 3; j++ )
+                    {
+                        float g0 = g[j], g1 = g[3 + j], g2 = g[6 + j];
+                        tmp[0][j] = g0;
+                        tmp[1][j] = 0.5f*(g0 + g1 + g2);
+                        tmp[2][j] = 0.5f*(g0 - g1 + g2);
+                        tmp[3][j] = g2;
+                    }
+                    for( int i = 0; i < 4; i++ )
+                    {
+                        float t0 = tmp[i][0], t1 = tmp[i][1], t2 = tmp[i][2];
+                        u[i][0] = t0;
+                        u[i][1] = 0.5f*(t0 + t1 + t2);
+                        u[i][2] = 0.5f*(t0 - t1 + t2);
+                        u[i][3] = t2;
+                    }
+                    for( int k = 0; k < NCOEFFS; k++ )
+                        dst.at<float>(k*outCn + oc, ic) = u[k/4][k%4];
+                }
+        }
+
+        static void run( const Mat& input, Mat& output, const Mat& weights,
+                         const Mat& bias, Size pad, const ActivationLayer* activ )
+        {
+            int batchSize = input.size[0], outCn = output.size[1];
+            CV_Assert( input.dims == 4 && output.dims == 4 &&
+                       batchSize == output.size[0] &&
+                       weights.rows == NCOEFFS*outCn && weights.cols == input.size[1] &&
+                       input.type() == CV_32F && output.type() == CV_32F &&
+                       weights.type() == CV_32F &&
+                       input.isContinuous() && output.isContinuous() &&
+                       (bias.empty() || (bias.isContinuous() && bias.type() == CV_32F &&
+                                         bias.total() == (size_t)outCn)));
+            WinogradConv p;
+
+            p.input_ = &input;
+            p.weights_ = &weights;
+            p.output_ = &output;
+            p.pad_ = pad;
+            p.tilesH_ = (output.size[2] + 1)/2;
+            p.tilesW_ = (output.size[3] + 1)/2;
+            p.nblocks_ = (p.tilesH_*p.tilesW_ + TILE_BLK - 1)/TILE_BLK;
+
+            p.biasvec_.assign(outCn, 0.f);
+            if( !bias.empty() )
+                for( int k = 0; k < outCn; k++ )
+                    p.biasvec_[k] = bias.at<float>(k);
+
+            parallel_for_(Range(0, batchSize*p.nblocks_), p);
+
+            if( activ )
+            {
+                size_t outPlaneSize = (size_t)output.size[2]*output.size[3];
+                for( int n = 0; n < batchSize; n++ )
+                {
+                    float* data_out = output.ptr<float>(n);
+                    activ->forwardSlice(data_out, data_out, (int)outPlaneSize, outPlaneSize, 0, outCn);
+                }
+            }
+        }
+
+        virtual void operator ()(const Range &r) const
+        {
+            int inpCn = input_->size[1], height = input_->size[2], width = input_->size[3];
+            int outCn = output_->size[1], outH = output_->size[2], outW = output_->size[3];
+            int tilesW = tilesW_, ntiles = tilesH_*tilesW_;
+            int pad_h = pad_.height, pad_w = pad_.width;
+            size_t inpPlaneSize = (size_t)width*height;
+            size_t outPlaneSize = (size_t)outW*outH;
+            size_t wstep = weights_->step1();
+            const float* biasvec = &biasvec_[0];
+
+            // transformed input tiles: [16 x inpCn x TILE_BLK]
+            // and their products with transformed weights: [16 x outCn x TILE_BLK]
+            AutoBuffer<float> vbuf_((size_t)NCOEFFS*inpCn*TILE_BLK);
+            AutoBuffer<float> mbuf_((size_t)NCOEFFS*outCn*TILE_BLK);
+            float* vbuf = vbuf_;
+            float* mbuf = mbuf_;
+
+            for( int stripe = r.start; stripe < r.end; stripe++ )
+            {
+                int n = stripe / nblocks_;
+                int tile0 = (stripe - n*nblocks_)*TILE_BLK;
+                int tile1 = std::min(tile0 + (int)TILE_BLK, ntiles);
+                const float* data_inp0 = input_->ptr<float>(n);
+                float* data_out0 = output_->ptr<float>(n);
+
+                // incomplete block: the tail must not contain NaNs or Infs
+                if( tile1 - tile0 < TILE_BLK )
+                    memset(vbuf, 0, (size_t)NCOEFFS*inpCn*TILE_BLK*sizeof(vbuf[0]));
+
+                // input transform V = B^T d B
+                for( int ic = 0; ic < inpCn; ic++ )
+                {
+                    const float* data_inp = data_inp0 + ic*inpPlaneSize;
+                    float* vptr = vbuf + ic*TILE_BLK;
+                    for( int t = tile0; t < tile1; t++ )
+                    {
+                        int ty = t / tilesW, tx = t - ty*tilesW;
+                        int y0 = ty*2 - pad_h, x0 = tx*2 - pad_w;
+                        float d[4][4], tmp[4][4];
+
+                        if( 0 <= y0 && y0 + 4 <= height && 0 <= x0 && x0 + 4 <= width )
+                        {
+                            for( int i = 0; i < 4; i++ )
+                            {
+                                const float* inprow = data_inp + (y0 + i)*width + x0;
+                                d[i][0] = inprow[0]; d[i][1] = inprow[1];
+                                d[i][2] = inprow[2]; d[i][3] = inprow[3];
+                            }
+                        }
+                        else
+                        {
+                            for( int i = 0; i < 4; i++ )
+                                for( int j = 0; j < 4; j++ )
+                                {
+                                    int y = y0 + i, x = x0 + j;
+                                    d[i][j] = 0 <= y && y < height && 0 <= x && x < width ?
+                                              data_inp[y*width + x] : 0.f;
+                                }
+                        }
+
+                        for( int j = 0; j < 4; j++ )
+                        {
+                            tmp[0][j] = d[0][j] - d[2][j];
+                            tmp[1][j] = d[1][j] + d[2][j];
+                            tmp[2][j] = d[2][j] - d[1][j];
+                            tmp[3][j] = d[1][j] - d[3][j];
+                        }
+
+                        float* v = vptr + (t - tile0);
+                        size_t vstep = (size_t)inpCn*TILE_BLK;
+                        for( int i = 0; i < 4; i++, v += vstep*4 )
+                        {
+                            v[0] = tmp[i][0] - tmp[i][2];
+                            v[vstep] = tmp[i][1] + tmp[i][2];
+                            v[vstep*2] = tmp[i][2] - tmp[i][1];
+                            v[vstep*3] = tmp[i][1] - tmp[i][3];
+                        }
+                    }
+                }
+
+                // M_k = U_k * V_k for every coefficient k
+                for( int k = 0; k < NCOEFFS; k++ )
+                {
+                    const float* vptr0 = vbuf + (size_t)k*inpCn*TILE_BLK;
+                    const float* wptr0 = weights_->ptr<float>(k*outCn);
+                    float* mptr0 = mbuf + (size_t)k*outCn*TILE_BLK;
+
+                    for( int oc = 0; oc < outCn; oc++ )
+                    {
+                        const float* wptr = wptr0 + oc*wstep;
+                        float* mptr = mptr0 + oc*TILE_BLK;
+                    #if CV_SIMD128
+                        v_float32x4 s0 = v_setzero_f32(), s1 = v_setzero_f32(),
+                                    s2 = v_setzero_f32(), s3 = v_setzero_f32(),
+                                    s4 = v_setzero_f32(), s5 = v_setzero_f32(),
+                                    s6 = v_setzero_f32(), s7 = v_setzero_f32();
+                        for( int ic = 0; ic < inpCn; ic++ )
+                        {
+                            const float* vptr = vptr0 + ic*TILE_BLK;
+                            v_float32x4 w = v_setall_f32(wptr[ic]);
+                            s0 += w*v_load(vptr);
+                            s1 += w*v_load(vptr + 4);
+                            s2 += w*v_load(vptr + 8);
+                            s3 += w*v_load(vptr + 12);
+                            s4 += w*v_load(vptr + 16);
+                            s5 += w*v_load(vptr + 20);
+                            s6 += w*v_load(vptr + 24);
+                            s7 += w*v_load(vptr + 28);
+                        }
+                        v_store(mptr, s0);
+                        v_store(mptr + 4, s1);
+                        v_store(mptr + 8, s2);
+                        v_store(mptr + 12, s3);
+                        v_store(mptr + 16, s4);
+                        v_store(mptr + 20, s5);
+                        v_store(mptr + 24, s6);
+                        v_store(mptr + 28, s7);
+                    #else
+                        for( int j = 0; j < TILE_BLK; j++ )
+                            mptr[j] = 0.f;
+                        for( int ic = 0; ic < inpCn; ic++ )
+                        {
+                            const float* vptr = vptr0 + ic*TILE_BLK;
+                            float w = wptr[ic];
+                            for( int j = 0; j < TILE_BLK; j++ )
+                                mptr[j] += w*vptr[j];
+                        }
+                    #endif
+                    }
+                }
+
+                // output transform Y = A^T M A
+                size_t mstep = (size_t)outCn*TILE_BLK;
+                for( int oc = 0; oc < outCn; oc++ )
+                {
+                    float* data_out = data_out0 + oc*outPlaneSize;
+                    const float* mptr = mbuf + oc*TILE_BLK;
+                    float bias = biasvec[oc];
+                    for( int t = tile0; t < tile1; t++ )
+                    {
+                        const float* m = mptr + (t - tile0);
+                        float tmp[2][4];
+                        for( int j = 0; j < 4; j++ )
+                        {
+                            float m0 = m[mstep*j], m1 = m[mstep*(4 + j)],
+                                  m2 = m[mstep*(8 + j)], m3 = m[mstep*(12 + j)];
+                            tmp[0][j] = m0 + m1 + m2;
+                            tmp[1][j] = m1 - m2 - m3;
+                        }
+
+                        int ty = t / tilesW, tx = t - ty*tilesW;
+                        int y0 = ty*2, x0 = tx*2;
+                        for( int i = 0; i < 2 && y0 + i < outH; i++ )
+                        {
+                            float* outptr = data_out + (y0 + i)*outW + x0;
+                            outptr[0] = tmp[i][0] + tmp[i][1] + tmp[i][2] + bias;
+                            if( x0 + 1 < outW )
+                                outptr[1] = tmp[i][1] - tmp[i][2] - tmp[i][3] + bias;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    // Depthwise convolution (every group has a single input and a single
+    // output channel) is computed directly over the input planes. Unrolled
+    // rows would be as short as the kernel so GEMM-like loops don't pay off.
+    // Output row is split into interior part where the kernel doesn't cross
+    // the borders (vectorized for stride 1) and the rest of pixels.
+    class DepthwiseConv : public cv::ParallelLoopBody
+    {
+    public:
+        const Mat* input_;
+        const Mat* weights_;
+        const Mat* bias_;
+        Mat* output_;
+        Size kernel_, pad_, stride_;
+        int nstripes_;
+        const ActivationLayer* activ_;
+
+        DepthwiseConv() : input_(0), weights_(0), bias_(0), output_(0),
+                          nstripes_(0), activ_(0) {}
+
+        static bool canRun(const Mat& input, const Mat& output, int ngroups, Size dilation)
+        {
+            return input.type() == CV_32F && ngroups > 1 &&
+                   input.size[1] == ngroups && output.size[1] == ngroups &&
+                   dilation == Size(1, 1);
+        }
+
+        static void run( const Mat& input, Mat& output, const Mat& weights, const Mat& bias,
+                         Size kernel, Size pad, Size stride, int nstripes,
+                         const ActivationLayer* activ )
+        {
+            CV_Assert( input.dims == 4 && output.dims == 4 &&
+                       input.size[0] == output.size[0] &&
+                       input.size[1] == output.size[1] &&
+                       weights.rows == input.size[1] && weights.cols == kernel.area() &&
+                       (weights.type() == CV_32F || weights.type() == CV_16S) &&
+                       bias.total() == (size_t)input.size[1] &&
+                       input.type() == CV_32F && output.type() == CV_32F &&
+                       input.isContinuous() && output.isContinuous() );
+
+            DepthwiseConv p;
+            p.input_ = &input;
+            p.weights_ = &weights;
+            p.bias_ = &bias;
+            p.output_ = &output;
+            p.kernel_ = kernel; p.pad_ = pad; p.stride_ = stride;
+            p.activ_ = activ;
+
+            int nplanes = input.size[0]*input.size[1];
+            p.nstripes_ = std::max(std::min(nstripes, nplanes), 1);
+            parallel_for_(Range(0, p.nstripes_), p, p.nstripes_);
+        }
+
+        virtual void operator ()(const Range &r0) const
+        {
+            int channels = input_->size[1], height = input_->size[2], width = input_->size[3];
+            int outH = output_->size[2], outW = output_->size[3];
+            int kernel_h = kernel_.height, kernel_w = kernel_.width;
+            int pad_h = pad_.height, pad_w = pad_.width;
+            int stride_h = stride_.height, stride_w = stride_.width;
+            size_t inpPlaneSize = (size_t)height*width, outPlaneSize = (size_t)outH*outW;
+
+            int nplanes = input_->size[0]*channels;
+            int plane0 = (int)((int64)r0.start*nplanes/nstripes_);
+            int plane1 = (int)((int64)r0.end*nplanes/nstripes_);
+
+            // Output columns [x0, x1) use input pixels only inside of the row.
+            int x0 = std::min(outW, (pad_w + stride_w - 1)/stride_w);
+            int x1 = width - kernel_w + pad_w >= 0 ?
+                     std::min(outW, (width - kernel_w + pad_w)/stride_w + 1) : 0;
+            x1 = std::max(x0, x1);
+
+            const bool fp16 = weights_->type() == CV_16S;
+            AutoBuffer<float> wbuf(kernel_h*kernel_w);
+
+            for( int plane = plane0; plane < plane1; plane++ )
+            {
+                int c = plane % channels;
+                const float* inptr = input_->ptr<float>() + plane*inpPlaneSize;
+                float* outptr = output_->ptr<float>() + plane*outPlaneSize;
+                const float* wptr = wbuf;
+                if( fp16 )
+                    convertFp16ToFp32(weights_->ptr<short>(c), wbuf, kernel_h*kernel_w);
+                else
+                    wptr = weights_->ptr<float>(c);
+                float biasval = bias_->ptr<float>()[c];
+
+                for( int y = 0; y < outH; y++ )
+                {
+                    int y_in = y*stride_h - pad_h;
+                    int ky0 = std::max(0, -y_in), ky1 = std::min(kernel_h, height - y_in);
+                    float* outrow = outptr + y*outW;
+
+                    for( int x = 0; x < outW; )
+                    {
+                        if( x == x0 && x0 < x1 )
+                        {
+                            int j = x0;
+                        #if CV_SIMD128
+                            if( stride_w == 1 )
+                            {
+                                for( ; j <= x1 - 4; j += 4 )
+                                {
+                                    v_float32x4 s0 = v_setall_f32(biasval);
+                                    for( int ky = ky0; ky < ky1; ky++ )
+                                    {
+                                        const float* sptr = inptr + (y_in + ky)*width + j - pad_w;
+                                        const float* w = wptr + ky*kernel_w;
+                                        for( int kx = 0; kx < kernel_w; kx++ )
+                                            s0 += v_setall_f32(w[kx])*v_load(sptr + kx);
+                                    }
+                                    v_store(outrow + j, s0);
+                                }
+                            }
+                        #endif
+                            for( ; j < x1; j++ )
+                            {
+                                float s0 = biasval;
+                                for( int ky = ky0; ky < ky1; ky++ )
+                                {
+                                    const float* sptr = inptr + (y_in + ky)*width + j*stride_w - pad_w;
+                                    const float* w = wptr + ky*kernel_w;
+                                    for( int kx = 0; kx < kernel_w; kx++ )
+                                        s0 += w[kx]*sptr[kx];
+                                }
+                                outrow[j] = s0;
+                            }
+                            x = x1;
+                            continue;
+                        }
+
+                        int x_in = x*stride_w - pad_w;
+                        int kx0 = std::max(0, -x_in), kx1 = std::min(kernel_w, width - x_in);
+                        float s0 = biasval;
+                        for( int ky = ky0; ky < ky1; ky++ )
+                        {
+                            const float* sptr = inptr + (y_in + ky)*width + x_in;
+                            const float* w = wptr + ky*kernel_w;
+                            for( int kx = kx0; kx < kx1; kx++ )
+                                s0 += w[kx]*sptr[kx];
+                        }
+                        outrow[x] = s0;
+                        x++;
+                    }
+                }
+
+                if( activ_ )
+                    activ_->forwardSlice(outptr, outptr, (int)outPlaneSize, outPlaneSize, c, c + 1);
+            }
+        }
+    };
+
+    // Convolution of quantized input and weights: im2row is done for blocks
+    // of output pixels and dot products are accumulated in 32-bit integers.
+    class ParallelConvInt8 : public cv::ParallelLoopBody
+    {
+    public:
+        enum { BLK_SIZE = 32 };
+
+        const Mat* input_;
+        const Mat* weights_;
+        Mat* output_;
+        const float* scales_;
+        Size kernel_, pad_, stride_, dilation_;
+        int ngroups_, stripesPerSample_;
+        std::vector<int> ofstab_;
+        std::vector<float> biasvec_;
+        const ActivationLayer* activ_;
+
+        ParallelConvInt8() {}
+
+        static void run( const Mat& input, Mat& output,
+                         const Mat& weights, const std::vector<float>& scales, const Mat& bias,
+                         Size kernel, Size pad, Size stride, Size dilation,
+                         int ngroups, int nstripes, const ActivationLayer* activ )
+        {
+            CV_Assert( input.dims == 4 && output.dims == 4 &&
+                       input.size[0] == output.size[0] &&
+                       weights.rows == output.size[1] &&
+                       weights.cols >= (input.size[1]/ngroups)*kernel.width*kernel.height &&
+                       (int)scales.size() == weights.rows &&
+                       input.type() == CV_8S && weights.type() == CV_8S &&
+                       output.type() == CV_32F &&
+                       input.isContinuous() && output.isContinuous() &&
+                       (bias.empty() || (bias.isContinuous() && bias.type() == CV_32F &&
+                                         bias.total() == (size_t)output.size[1])));
+            ParallelConvInt8 p;
+
+            p.input_ = &input;
+            p.weights_ = &weights;
+            p.output_ = &output;
+            p.scales_ = &scales[0];
+            p.kernel_ = kernel; p.pad_ = pad; p.stride_ = stride; p.dilation_ = dilation;
+            p.ngroups_ = ngroups;
+            p.activ_ = activ;
+
+            int inpCn = input.size[1]/ngroups, width = input.size[3], height = input.size[2];
+            int outCn = output.size[1];
+            int batchSize = input.size[0]*ngroups;
+            p.stripesPerSample_ = std::max(nstripes/batchSize, 1);
+
+            p.ofstab_.resize(kernel.width*kernel.height*inpCn);
+            for( int k = 0; k < inpCn; k++ )
+                for( int k_r = 0; k_r < kernel.height; k_r++ )
+                    for( int k_c = 0; k_c < kernel.width; k_c++ )
+                        p.ofstab_[(k*kernel.height + k_r)*kernel.width + k_c] =
+                        (k*height + k_r*dilation.height)*width + k_c*dilation.width;
+
+            p.biasvec_.assign(outCn, 0.f);
+            if( !bias.empty() )
+                for( int k = 0; k < outCn; k++ )
+                    p.biasvec_[k] = bias.at<float>(k);
+
+            parallel_for_(Range(0, batchSize*p.stripesPerSample_), p, nstripes);
+        }
+
+        virtual void operator ()(const Range &r) const
+        {
+            int ngroups = ngroups_;
+            int outW = output_->size[3], outH = output_->size[2], outCn = output_->size[1]/ngroups;
+            int width = input_->size[3], height = input_->size[2], inpCn = input_->size[1]/ngroups;
+            int kernel_w = kernel_.width, kernel_h = kernel_.height;
+            int pad_w = pad_.width, pad_h = pad_.height;
+            int stride_w = stride_.width, stride_h = stride_.height;
+            int dilation_w = dilation_.width, dilation_h = dilation_.height;
+            int karea = kernel_w*kernel_h, vsz = karea*inpCn;
+            int vsz_a = weights_->cols;
+            size_t inpPlaneSize = (size_t)width*height;
+            size_t outPlaneSize = (size_t)outW*outH;
+            int stripesPerSample = stripesPerSample_;
+            size_t stripeSize = (outPlaneSize + stripesPerSample - 1)/stripesPerSample;
+            const int* ofstab = &ofstab_[0];
+
+            // the tail of every row must match with zero padding of weights
+            AutoBuffer<schar> rowbuf_((size_t)BLK_SIZE*vsz_a);
+            schar* rowbuf0 = rowbuf_;
+            memset(rowbuf0, 0, (size_t)BLK_SIZE*vsz_a);
+
+            for( int stripe = r.start; stripe < r.end; stripe++ )
+            {
+                int subsampleIdx = stripe/stripesPerSample;
+                int stripeStart = (int)std::min((stripe - subsampleIdx*stripesPerSample)*stripeSize, outPlaneSize);
+                int stripeEnd = (int)std::min(stripeStart + stripeSize, outPlaneSize);
+                const schar* data_inp0 = input_->ptr<schar>() + subsampleIdx*inpPlaneSize*inpCn;
+                float* data_out0 = output_->ptr<float>() + subsampleIdx*outPlaneSize*outCn;
+                int startOutCn = (subsampleIdx % ngroups)*outCn;
+
+                for( int ofs0 = stripeStart; ofs0 < stripeEnd; ofs0 += BLK_SIZE )
+                {
+                    int ofs1 = std::min(ofs0 + (int)BLK_SIZE, stripeEnd);
+
+                    for( int ofs = ofs0; ofs < ofs1; ofs++ )
+                    {
+                        int out_i = ofs / outW;
+                        int out_j = ofs - out_i * outW;
+                        schar* rowbuf = rowbuf0 + (ofs - ofs0)*vsz_a;
+
+                        int in_i = out_i * stride_h - pad_h;
+                        int in_j = out_j * stride_w - pad_w;
+                        const schar* imgptr = data_inp0 + in_i*width + in_j;
+
+                        if( 0 <= in_i && in_i < height - (kernel_h-1)*dilation_h &&
+                            0 <= in_j && in_j < width - (kernel_w-1)*dilation_w )
+                        {
+                            for( int k = 0; k < vsz; k++ )
+                                rowbuf[k] = imgptr[ofstab[k]];
+                        }
+                        else
+                        {
+                            for( int k = 0; k < inpCn; k++ )
+                                for( int i = 0; i < kernel_h; i++ )
+                                    for( int j = 0; j < kernel_w; j++ )
+                                    {
+                                        int y = in_i + i*dilation_h, x = in_j + j*dilation_w;
+                                        rowbuf[(k*kernel_h + i)*kernel_w + j] =
+                                            0 <= y && y < height && 0 <= x && x < width ?
+                                            data_inp0[k*inpPlaneSize + y*width + x] : 0;
+                                    }
+                        }
+                    }
+
+                    for( int oc = 0; oc < outCn; oc++ )
+                    {
+                        const schar* wptr = weights_->ptr<schar>(startOutCn + oc);
+                        float scale = scales_[startOutCn + oc];
+                        float bias = biasvec_[startOutCn + oc];
+                        float* outptr = data_out0 + oc*outPlaneSize;
+                        for( int ofs = ofs0; ofs < ofs1; ofs++ )
+                        {
+                            int s = dotInt8(wptr, rowbuf0 + (ofs - ofs0)*vsz_a, vsz_a);
+                            outptr[ofs] = s*scale + bias;
+                        }
+                    }
+                }
+
+                if( activ_ && stripeStart < stripeEnd )
+                    activ_->forwardSlice(data_out0 + stripeStart, data_out0 + stripeStart,
+                                         (int)(stripeEnd - stripeStart),
+                                         outPlaneSize, startOutCn, startOutCn + outCn);
+            }
+        }
+    };
+
+    virtual bool tryQuantize(float inputMaxAbs)
+    {
+        if (!(inputMaxAbs > 0.f) || blobs[0].type() != CV_32F)
+            return false;
+
+        inputScale = inputMaxAbs / 127.f;
+        initWeights();
+        quantizeWeightsInt8(weightsMat, weightsInt8, outputScales);
+        // Products of quantized values are scaled by both weights and input scales.
+        for (size_t i = 0; i < outputScales.size(); i++)
+            outputScales[i] *= inputScale;
+        useInt8 = true;
+        return true;
+    }
+
     void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
     {
         CV_Assert(inputs.size() == (size_t)1 && inputs[0]->size[1] % blobs[0].size[1] == 0);
@@ -596,28 +1329,164 @@ public:
 
         int outCn = blobs[0].size[0];
 
-        if( weightsMat.empty() )
+        if( useInt8 )
         {
-            Mat wm = blobs[0].reshape(1, outCn);
-            if( wm.step1() % VEC_ALIGN != 0 )
-            {
-                int newcols = (int)alignSize(wm.step1(), VEC_ALIGN);
-                Mat wm_buffer = Mat(outCn, newcols, wm.type());
-                Mat wm_padding = wm_buffer.colRange(wm.cols, newcols);
-                wm_padding.setTo(Scalar::all(0.));
-                Mat wm_aligned = wm_buffer.colRange(0, wm.cols);
-                wm.copyTo(wm_aligned);
-                wm = wm_aligned;
-            }
-            weightsMat = wm;
+            const Mat& input = *inputs[0];
+            CV_Assert(input.isContinuous() && input.type() == CV_32F);
+            inputInt8.create(input.dims, input.size, CV_8S);
+            quantizeInt8(input.ptr<float>(), inputInt8.ptr<schar>(), input.total(), 1.f / inputScale);
+
+            int nstripes = std::max(getNumThreads(), 1);
+            ParallelConvInt8::run(inputInt8, outputs[0], weightsInt8, outputScales, biasMat,
+                                  kernel, pad, stride, dilation, ngroups, nstripes, activ.get());
+            return;
         }
-        Mat biasesMat = hasBias() ? blobs[1].reshape(1, outCn) : Mat();
+
+        if( useWinograd )
+        {
+            WinogradConv::run(*inputs[0], outputs[0], winogradWeights, biasMat, pad, activ.get());
+            return;
+        }
+
+        initWeights();
+        const Mat& weights = weightsFp16.empty() ? weightsMat : weightsFp16;
+        CV_Assert(weights.rows == outCn);
 
         int nstripes = std::max(getNumThreads(), 1);
-        ParallelConv::run(*inputs[0], outputs[0], weightsMat, biasesMat,
+        if( DepthwiseConv::canRun(*inputs[0], outputs[0], ngroups, dilation) )
+        {
+            DepthwiseConv::run(*inputs[0], outputs[0], weights, biasMat,
+                               kernel, pad, stride, nstripes, activ.get());
+            return;
+        }
+
+        ParallelConv::run(*inputs[0], outputs[0], weights, biasMat,
                           kernel, pad, stride, dilation, ngroups, nstripes, activ.get());
     }
 
+    virtual bool supportBackend(int backendId)
+    {
+        if( !weightsFp16.empty() )
+            return backendId == DNN_BACKEND_DEFAULT;
+        return BaseConvolutionLayerImpl::supportBackend(backendId) ||
+               backendId == DNN_BACKEND_OPENCL && haveOpenCL();
+    }
+
+    // Winograd engine isn't used because transformed weights are
+    // stored in single precision.
+    virtual bool tryConvertFp16()
+    {
+        if( !weightsFp16.empty() )
+            return true;
+        if( useInt8 || blobs[0].type() != CV_32F )
+            return false;
+
+        initWeights();
+        convertWeightsFp16(weightsMat, weightsFp16);
+        weightsMat.release();
+        winogradWeights.release();
+        winogradEnabled = useWinograd = false;
+#ifdef HAVE_OPENCL
+        umatWeights.release();
+#endif
+        // Source weights are kept in the same precision for getParam().
+        Mat wm;
+        convertFp16(blobs[0].reshape(1, blobs[0].size[0]), wm);
+        blobs[0] = wm.reshape(1, blobs[0].dims, blobs[0].size.p);
+        return true;
+    }
+
+    // Prepared (fused, transformed or quantized) weights are shared with the copy.
+    virtual Ptr<Layer> clone() const
+    {
+        Ptr<ConvolutionLayerImpl> layer(new ConvolutionLayerImpl(*this));
+        layer->inputInt8.release();
+#ifdef HAVE_OPENCL
+        layer->umatCol.release();
+#endif
+        return layer;
+    }
+
+    // Convolution as im2col followed by matrix multiplication for every
+    // sample and group: output[outCn x outPlane] = weights * col + bias.
+    bool forwardOCL(std::vector<UMat*> &inputs, std::vector<UMat> &outputs, std::vector<UMat> &)
+    {
+#ifdef HAVE_OPENCL
+        if( useInt8 || dilation != Size(1, 1) )
+            return false;
+
+        const UMat& input = *inputs[0];
+        UMat& output = outputs[0];
+        CV_Assert(inputs.size() == (size_t)1 && input.dims == 4 && input.type() == CV_32F);
+        CV_Assert(input.size[1] % blobs[0].size[1] == 0);
+
+        int batchSize = input.size[0], inpCn = input.size[1];
+        int inpH = input.size[2], inpW = input.size[3];
+        int outCn = output.size[1], outH = output.size[2], outW = output.size[3];
+        int ngroups = inpCn / blobs[0].size[1];
+        int inpGroupCn = inpCn / ngroups, outGroupCn = outCn / ngroups;
+        int inpPlane = inpH * inpW, outPlane = outH * outW;
+        int ksize = inpGroupCn * kernel.area();
+
+        initWeights();
+        if( umatWeights.empty() )
+            weightsMat.copyTo(umatWeights);
+        if( umatBias.cols != outPlane )
+            Mat(biasMat * Mat::ones(1, outPlane, CV_32F)).copyTo(umatBias);
+
+        bool direct = is1x1() && pad == Size(0, 0);
+        ocl::Kernel im2colKernel;
+        if( !direct )
+        {
+            im2colKernel.create("im2col", ocl::dnn::im2col_oclsrc, "-DT=float");
+            if( im2colKernel.empty() )
+                return false;
+            umatCol.create(ksize, outPlane, CV_32F);
+        }
+
+        UMat inpMat = oclView2D(input, batchSize * inpCn);
+        UMat outMat = oclView2D(output, batchSize * outCn);
+        for( int n = 0; n < batchSize; n++ )
+        {
+            for( int g = 0; g < ngroups; g++ )
+            {
+                int inpRow = n * inpCn + g * inpGroupCn;
+                UMat col;
+                if( direct )
+                    col = inpMat.rowRange(inpRow, inpRow + inpGroupCn);
+                else
+                {
+                    ocl::Kernel& k = im2colKernel.args(ocl::KernelArg::PtrReadOnly(input),
+                                                 oclOffset(input) + inpRow * inpPlane,
+                                                 inpGroupCn, inpH, inpW, kernel.height, kernel.width,
+                                                 pad.height, pad.width, stride.height, stride.width,
+                                                 outH, outW, ocl::KernelArg::PtrWriteOnly(umatCol), 0);
+                    if( !runKernel1D(k, (size_t)inpGroupCn * outPlane) )
+                        return false;
+                    col = umatCol;
+                }
+
+                Range outRows(g * outGroupCn, (g + 1) * outGroupCn);
+                UMat dst = outMat.rowRange(n * outCn + outRows.start, n * outCn + outRows.end);
+                cv::gemm(umatWeights.rowRange(outRows), col, 1,
+                         umatBias.rowRange(outRows), 1, dst);
+            }
+        }
+
+        if( activ )
+        {
+            // OpenCL implementations of activations work in-place.
+            std::vector<UMat*> activInputs(1, &output);
+            std::vector<UMat> activOutputs(1, output), activInternals;
+            if( !activ->forwardOCL(activInputs, activOutputs, activInternals) )
+                return false;
+        }
+        return true;
+#else
+        return false;
+#endif  // HAVE_OPENCL
+    }
+
     virtual int64 getFLOPS(const std::vector<MatShape> &inputs,
                            const std::vector<MatShape> &outputs) const
     {
@@ -835,8 +1704,9 @@ static void initConvDeconvLayerFromCaffe(Ptr<BaseConvolutionLayer> l, const Laye
 
 Ptr<BaseConvolutionLayer> ConvolutionLayer::create(const LayerParams &params)
 {
-    Ptr<BaseConvolutionLayer> l(new ConvolutionLayerImpl);
+    Ptr<ConvolutionLayerImpl> l(new ConvolutionLayerImpl);
     initConvDeconvLayerFromCaffe(l, params);
+    l->winogradEnabled = params.get<bool>("winograd", true);
     return l;
 }
 
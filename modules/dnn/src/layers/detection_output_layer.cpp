@@ -41,6 +41,7 @@
 
 #include "../precomp.hpp"
 #include "layers_common.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <float.h>
 #include <string>
 #include <caffe.pb.h>
@@ -76,8 +77,167 @@ bool SortScorePairDescend(const std::pair<float, T>& pair1,
     return pair1.first > pair2.first;
 }
 
+// Orders pairs by score and pairs with the same score by index, i.e. the same
+// order as stable sort by score gives.
+static bool SortScoreIndexPairDescend(const std::pair<float, int>& pair1,
+                                      const std::pair<float, int>& pair2)
+{
+    return pair1.first > pair2.first ||
+           (pair1.first == pair2.first && pair1.second < pair2.second);
+}
+
+}
+
+// Decoded bboxes of one label stored by coordinates for vectorized processing.
+struct BBoxesSoA
+{
+    std::vector<float> xmin, ymin, xmax, ymax, size;
+};
+
+// Returns true if the bbox overlaps any of the first <num> bboxes of <kept>
+// with jaccard overlap (IoU) greater than <threshold>.
+static bool overlapsAny(const BBoxesSoA& bboxes, int idx, const BBoxesSoA& kept,
+                        int num, float threshold)
+{
+    const float xmin = bboxes.xmin[idx], ymin = bboxes.ymin[idx];
+    const float xmax = bboxes.xmax[idx], ymax = bboxes.ymax[idx];
+    const float size = bboxes.size[idx];
+    int k = 0;
+#if CV_SIMD128
+    v_float32x4 vxmin = v_setall_f32(xmin), vymin = v_setall_f32(ymin);
+    v_float32x4 vxmax = v_setall_f32(xmax), vymax = v_setall_f32(ymax);
+    v_float32x4 vsize = v_setall_f32(size), vthreshold = v_setall_f32(threshold);
+    v_float32x4 zero = v_setzero_f32();
+    for (; k <= num - 4; k += 4)
+    {
+        v_float32x4 width = v_min(vxmax, v_load(&kept.xmax[k])) - v_max(vxmin, v_load(&kept.xmin[k]));
+        v_float32x4 height = v_min(vymax, v_load(&kept.ymax[k])) - v_max(vymin, v_load(&kept.ymin[k]));
+        v_float32x4 intersection = width * height;
+        v_float32x4 overlap = intersection / (vsize + v_load(&kept.size[k]) - intersection);
+        // Boxes without intersection have zero overlap.
+        v_float32x4 suppressed = (width > zero) & (height > zero) & (overlap > vthreshold);
+        if (v_signmask(suppressed))
+            return true;
+    }
+#endif
+    for (; k < num; ++k)
+    {
+        float width = std::min(xmax, kept.xmax[k]) - std::max(xmin, kept.xmin[k]);
+        float height = std::min(ymax, kept.ymax[k]) - std::max(ymin, kept.ymin[k]);
+        if (width > 0 && height > 0)
+        {
+            float intersection = width * height;
+            if (intersection / (size + kept.size[k] - intersection) > threshold)
+                return true;
+        }
+    }
+    return false;
 }
 
+// Get top_k scores higher than the threshold with corresponding indices
+// sorted in descending order.
+static void getTopScores(const std::vector<float>& scores, const float threshold, const int top_k,
+                         std::vector<std::pair<float, int> >& score_index_vec)
+{
+    score_index_vec.clear();
+    for (size_t i = 0; i < scores.size(); ++i)
+    {
+        if (scores[i] > threshold)
+            score_index_vec.push_back(std::make_pair(scores[i], (int)i));
+    }
+
+    // Only the kept part is sorted.
+    if (top_k > -1 && top_k < (int)score_index_vec.size())
+    {
+        std::partial_sort(score_index_vec.begin(), score_index_vec.begin() + top_k,
+                          score_index_vec.end(), util::SortScoreIndexPairDescend);
+        score_index_vec.resize(top_k);
+    }
+    else
+    {
+        std::sort(score_index_vec.begin(), score_index_vec.end(),
+                  util::SortScoreIndexPairDescend);
+    }
+}
+
+// Do non maximum suppression given bboxes and scores.
+// Inspired by Piotr Dollar's NMS implementation in EdgeBox.
+// https://goo.gl/jV3JYS
+//    bboxes: a set of bounding boxes.
+//    scores: a set of corresponding confidences.
+//    score_threshold: a threshold used to filter detection results.
+//    nms_threshold: a threshold used in non maximum suppression.
+//    top_k: if not -1, keep at most top_k picked indices.
+//    indices: the kept indices of bboxes after nms.
+static void applyNMSFast(const BBoxesSoA& bboxes, const std::vector<float>& scores,
+                         const float score_threshold, const float nms_threshold,
+                         const int top_k, std::vector<int>& indices)
+{
+    CV_Assert(bboxes.xmin.size() == scores.size());
+
+    std::vector<std::pair<float, int> > score_index_vec;
+    getTopScores(scores, score_threshold, top_k, score_index_vec);
+
+    // Kept bboxes are copied to compare them with the next ones contiguously.
+    BBoxesSoA kept;
+    const size_t maxKept = score_index_vec.size();
+    kept.xmin.resize(maxKept);
+    kept.ymin.resize(maxKept);
+    kept.xmax.resize(maxKept);
+    kept.ymax.resize(maxKept);
+    kept.size.resize(maxKept);
+
+    indices.clear();
+    int numKept = 0;
+    for (size_t i = 0; i < score_index_vec.size(); ++i)
+    {
+        const int idx = score_index_vec[i].second;
+        if (overlapsAny(bboxes, idx, kept, numKept, nms_threshold))
+            continue;
+        indices.push_back(idx);
+        kept.xmin[numKept] = bboxes.xmin[idx];
+        kept.ymin[numKept] = bboxes.ymin[idx];
+        kept.xmax[numKept] = bboxes.xmax[idx];
+        kept.ymax[numKept] = bboxes.ymax[idx];
+        kept.size[numKept] = bboxes.size[idx];
+        ++numKept;
+    }
+}
+
+// Applies NMS for the classes of one image in parallel.
+class NMSInvoker : public ParallelLoopBody
+{
+public:
+    NMSInvoker(const std::vector<const BBoxesSoA*>& bboxes,
+               const std::vector<const std::vector<float>*>& scores,
+               float confidenceThreshold, float nmsThreshold, int topK,
+               std::vector<std::vector<int> >& indices)
+        : bboxes_(bboxes), scores_(scores), confidenceThreshold_(confidenceThreshold),
+          nmsThreshold_(nmsThreshold), topK_(topK), indices_(indices)
+    {
+    }
+
+    void operator()(const Range& range) const
+    {
+        for (int c = range.start; c < range.end; ++c)
+        {
+            // Background class has no bboxes.
+            if (bboxes_[c])
+            {
+                applyNMSFast(*bboxes_[c], *scores_[c], confidenceThreshold_,
+                             nmsThreshold_, topK_, indices_[c]);
+            }
+        }
+    }
+
+private:
+    const std::vector<const BBoxesSoA*>& bboxes_;
+    const std::vector<const std::vector<float>*>& scores_;
+    float confidenceThreshold_, nmsThreshold_;
+    int topK_;
+    std::vector<std::vector<int> >& indices_;
+};
+
 class DetectionOutputLayerImpl : public DetectionOutputLayer
 {
 public:
@@ -237,6 +397,10 @@ public:
 
         int numKept = 0;
         std::vector<std::map<int, std::vector<int> > > allIndices;
+        std::map<int, BBoxesSoA> labelBBoxes;
+        std::vector<const BBoxesSoA*> classBBoxes(_numClasses);
+        std::vector<const std::vector<float>*> classScores(_numClasses);
+        std::vector<std::vector<int> > classIndices(_numClasses);
         for (int i = 0; i < num; ++i)
         {
             const LabelBBox& decodeBBoxes = allDecodedBBoxes[i];
@@ -244,6 +408,10 @@ public:
             allConfidenceScores[i];
             std::map<int, std::vector<int> > indices;
             int numDetections = 0;
+            for (LabelBBox::const_iterator it = decodeBBoxes.begin(); it != decodeBBoxes.end(); ++it)
+                GetBBoxesSoA(it->second, labelBBoxes[it->first]);
+
+            std::fill(classBBoxes.begin(), classBBoxes.end(), (const BBoxesSoA*)0);
             for (int c = 0; c < (int)_numClasses; ++c)
             {
                 if (c == _backgroundLabelId)
@@ -265,11 +433,21 @@ public:
                     util::make_error<int>("Could not find location predictions for label ", label);
                     continue;
                 }
-                const std::vector<caffe::NormalizedBBox>& bboxes =
-                decodeBBoxes.find(label)->second;
-                ApplyNMSFast(bboxes, scores, _confidenceThreshold, _nmsThreshold, 1.0,
-                             _topK, &(indices[c]));
-                numDetections += indices[c].size();
+                classBBoxes[c] = &labelBBoxes[label];
+                classScores[c] = &scores;
+            }
+
+            // Classes are independent so NMS is applied to them concurrently.
+            parallel_for_(Range(0, (int)_numClasses),
+                          NMSInvoker(classBBoxes, classScores, _confidenceThreshold,
+                                     _nmsThreshold, _topK, classIndices));
+            for (int c = 0; c < (int)_numClasses; ++c)
+            {
+                if (classBBoxes[c])
+                {
+                    indices[c].swap(classIndices[c]);
+                    numDetections += indices[c].size();
+                }
             }
             if (_keepTopK > -1 && numDetections > _keepTopK)
             {
@@ -295,8 +473,9 @@ public:
                     }
                 }
                 // Keep outputs k results per image.
-                std::sort(scoreIndexPairs.begin(), scoreIndexPairs.end(),
-                          util::SortScorePairDescend<std::pair<int, int> >);
+                std::partial_sort(scoreIndexPairs.begin(), scoreIndexPairs.begin() + _keepTopK,
+                                  scoreIndexPairs.end(),
+                                  util::SortScorePairDescend<std::pair<int, int> >);
                 scoreIndexPairs.resize(_keepTopK);
                 // Store the new indices.
                 std::map<int, std::vector<int> > newIndices;
@@ -660,129 +839,23 @@ public:
         }
     }
 
-    // Do non maximum suppression given bboxes and scores.
-    // Inspired by Piotr Dollar's NMS implementation in EdgeBox.
-    // https://goo.gl/jV3JYS
-    //    bboxes: a set of bounding boxes.
-    //    scores: a set of corresponding confidences.
-    //    score_threshold: a threshold used to filter detection results.
-    //    nms_threshold: a threshold used in non maximum suppression.
-    //    top_k: if not -1, keep at most top_k picked indices.
-    //    indices: the kept indices of bboxes after nms.
-    void ApplyNMSFast(const std::vector<caffe::NormalizedBBox>& bboxes,
-          const std::vector<float>& scores, const float score_threshold,
-          const float nms_threshold, const float eta, const int top_k,
-          std::vector<int>* indices) {
-      // Sanity check.
-      CV_Assert(bboxes.size() == scores.size());
-
-      // Get top_k scores (with corresponding indices).
-      std::vector<std::pair<float, int> > score_index_vec;
-      GetMaxScoreIndex(scores, score_threshold, top_k, &score_index_vec);
-
-      // Do nms.
-      float adaptive_threshold = nms_threshold;
-      indices->clear();
-      while (score_index_vec.size() != 0) {
-        const int idx = score_index_vec.front().second;
-        bool keep = true;
-        for (int k = 0; k < indices->size(); ++k) {
-          if (keep) {
-            const int kept_idx = (*indices)[k];
-            float overlap = JaccardOverlap(bboxes[idx], bboxes[kept_idx]);
-            keep = overlap <= adaptive_threshold;
-          } else {
-            break;
-          }
-        }
-        if (keep) {
-          indices->push_back(idx);
-        }
-        score_index_vec.erase(score_index_vec.begin());
-        if (keep && eta < 1 && adaptive_threshold > 0.5) {
-          adaptive_threshold *= eta;
-        }
-      }
-    }
-
-    // Get max scores with corresponding indices.
-    //    scores: a set of scores.
-    //    threshold: only consider scores higher than the threshold.
-    //    top_k: if -1, keep all; otherwise, keep at most top_k.
-    //    score_index_vec: store the sorted (score, index) pair.
-    void GetMaxScoreIndex(const std::vector<float>& scores, const float threshold,const int top_k,
-                          std::vector<std::pair<float, int> >* score_index_vec)
+    // Copy bboxes to the structure of arrays.
+    void GetBBoxesSoA(const std::vector<caffe::NormalizedBBox>& bboxes, BBoxesSoA& soa)
     {
-        // Generate index score pairs.
-        for (size_t i = 0; i < scores.size(); ++i)
-        {
-            if (scores[i] > threshold)
-            {
-                score_index_vec->push_back(std::make_pair(scores[i], i));
-            }
-        }
-
-        // Sort the score pair according to the scores in descending order
-        std::stable_sort(score_index_vec->begin(), score_index_vec->end(),
-                         util::SortScorePairDescend<int>);
-
-        // Keep top_k scores if needed.
-        if (top_k > -1 && top_k < (int)score_index_vec->size())
-        {
-            score_index_vec->resize(top_k);
-        }
-    }
-
-    // Compute the intersection between two bboxes.
-    void IntersectBBox(const caffe::NormalizedBBox& bbox1,
-                       const caffe::NormalizedBBox& bbox2,
-                       caffe::NormalizedBBox* intersect_bbox) {
-        if (bbox2.xmin() > bbox1.xmax() || bbox2.xmax() < bbox1.xmin() ||
-            bbox2.ymin() > bbox1.ymax() || bbox2.ymax() < bbox1.ymin())
-        {
-            // Return [0, 0, 0, 0] if there is no intersection.
-            intersect_bbox->set_xmin(0);
-            intersect_bbox->set_ymin(0);
-            intersect_bbox->set_xmax(0);
-            intersect_bbox->set_ymax(0);
-        }
-        else
-        {
-            intersect_bbox->set_xmin(std::max(bbox1.xmin(), bbox2.xmin()));
-            intersect_bbox->set_ymin(std::max(bbox1.ymin(), bbox2.ymin()));
-            intersect_bbox->set_xmax(std::min(bbox1.xmax(), bbox2.xmax()));
-            intersect_bbox->set_ymax(std::min(bbox1.ymax(), bbox2.ymax()));
-        }
-    }
-
-    // Compute the jaccard (intersection over union IoU) overlap between two bboxes.
-    float JaccardOverlap(const caffe::NormalizedBBox& bbox1,
-                         const caffe::NormalizedBBox& bbox2,
-                         const bool normalized=true)
-    {
-        caffe::NormalizedBBox intersect_bbox;
-        IntersectBBox(bbox1, bbox2, &intersect_bbox);
-        float intersect_width, intersect_height;
-        if (normalized)
-        {
-            intersect_width = intersect_bbox.xmax() - intersect_bbox.xmin();
-            intersect_height = intersect_bbox.ymax() - intersect_bbox.ymin();
-        }
-        else
-        {
-            intersect_width = intersect_bbox.xmax() - intersect_bbox.xmin() + 1;
-            intersect_height = intersect_bbox.ymax() - intersect_bbox.ymin() + 1;
-        }
-        if (intersect_width > 0 && intersect_height > 0)
-        {
-            float intersect_size = intersect_width * intersect_height;
-            float bbox1_size = BBoxSize(bbox1);
-            float bbox2_size = BBoxSize(bbox2);
-            return intersect_size / (bbox1_size + bbox2_size - intersect_size);
-        }
-        else
+        const size_t numBBoxes = bboxes.size();
+        soa.xmin.resize(numBBoxes);
+        soa.ymin.resize(numBBoxes);
+        soa.xmax.resize(numBBoxes);
+        soa.ymax.resize(numBBoxes);
+        soa.size.resize(numBBoxes);
+        for (size_t i = 0; i < numBBoxes; ++i)
         {
-            return 0.;
+            const caffe::NormalizedBBox& bbox = bboxes[i];
+            soa.xmin[i] = bbox.xmin();
+            soa.ymin[i] = bbox.ymin();
+            soa.xmax[i] = bbox.xmax();
+            soa.ymax[i] = bbox.ymax();
+            soa.size[i] = BBoxSize(bbox);
         }
     }
 };
@@ -1,7 +1,11 @@
 #include "../precomp.hpp"
 #include "op_halide.hpp"
+#include "../op_opencl.hpp"
 #include "opencv2/imgproc.hpp"
 #include <opencv2/dnn/shape_utils.hpp>
+#ifdef HAVE_OPENCL
+#include "opencl_kernels_dnn.hpp"
+#endif
 
 namespace cv
 {
@@ -13,6 +17,21 @@ using std::exp;
 using std::tanh;
 using std::pow;
 
+#ifdef HAVE_OPENCL
+// Runs kernel from activations.cl with (count, src, src_offset, dst, dst_offset) arguments.
+static bool runActivationKernel(const char* name, const UMat& src, UMat& dst,
+                                const String& opts = String())
+{
+    ocl::Kernel kernel(name, ocl::dnn::activations_oclsrc, "-DT=float " + opts);
+    if (kernel.empty())
+        return false;
+    int count = (int)src.total();
+    kernel.args(count, ocl::KernelArg::PtrReadOnly(src), oclOffset(src),
+                ocl::KernelArg::PtrWriteOnly(dst), oclOffset(dst));
+    return runKernel1D(kernel, count);
+}
+#endif  // HAVE_OPENCL
+
 template<typename Func>
 class ElementWiseLayer : public Func::Layer
 {
@@ -68,7 +87,23 @@ public:
     virtual bool supportBackend(int backendId)
     {
         return backendId == DNN_BACKEND_DEFAULT ||
-               backendId == DNN_BACKEND_HALIDE && haveHalide();
+               backendId == DNN_BACKEND_HALIDE && haveHalide() ||
+               backendId == DNN_BACKEND_OPENCL && haveOpenCL();
+    }
+
+    bool forwardOCL(std::vector<UMat*> &inputs, std::vector<UMat> &outputs, std::vector<UMat> &)
+    {
+#ifdef HAVE_OPENCL
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            CV_Assert(inputs[i]->total() == outputs[i].total() && inputs[i]->type() == CV_32F);
+            if (!func.applyOCL(*inputs[i], outputs[i]))
+                return false;
+        }
+        return true;
+#else
+        return false;
+#endif  // HAVE_OPENCL
     }
 
     virtual Ptr<BackendNode> tryAttach(const Ptr<BackendNode>& node)
@@ -201,6 +236,22 @@ struct ReLUFunctor
     }
 #endif  // HAVE_HALIDE
 
+#ifdef HAVE_OPENCL
+    bool applyOCL(const UMat& src, UMat& dst) const
+    {
+        if (slope == 0.f)
+            return runActivationKernel("ReLUForward", src, dst, "-DRELU_NO_SLOPE");
+
+        ocl::Kernel kernel("ReLUForward", ocl::dnn::activations_oclsrc, "-DT=float");
+        if (kernel.empty())
+            return false;
+        int count = (int)src.total();
+        kernel.args(count, ocl::KernelArg::PtrReadOnly(src), oclOffset(src),
+                    ocl::KernelArg::PtrWriteOnly(dst), oclOffset(dst), slope);
+        return runKernel1D(kernel, count);
+    }
+#endif  // HAVE_OPENCL
+
     int64 getFLOPSPerElement() const { return 1; }
 };
 
@@ -228,6 +279,13 @@ struct TanHFunctor
     }
 #endif  // HAVE_HALIDE
 
+#ifdef HAVE_OPENCL
+    bool applyOCL(const UMat& src, UMat& dst) const
+    {
+        return runActivationKernel("TanHForward", src, dst);
+    }
+#endif  // HAVE_OPENCL
+
     int64 getFLOPSPerElement() const { return 1; }
 };
 
@@ -255,6 +313,13 @@ struct SigmoidFunctor
     }
 #endif  // HAVE_HALIDE
 
+#ifdef HAVE_OPENCL
+    bool applyOCL(const UMat& src, UMat& dst) const
+    {
+        return runActivationKernel("SigmoidForward", src, dst);
+    }
+#endif  // HAVE_OPENCL
+
     int64 getFLOPSPerElement() const { return 3; }
 };
 
@@ -282,6 +347,13 @@ struct AbsValFunctor
     }
 #endif  // HAVE_HALIDE
 
+#ifdef HAVE_OPENCL
+    bool applyOCL(const UMat& src, UMat& dst) const
+    {
+        return runActivationKernel("AbsValForward", src, dst);
+    }
+#endif  // HAVE_OPENCL
+
     int64 getFLOPSPerElement() const { return 1; }
 };
 
@@ -309,6 +381,11 @@ struct BNLLFunctor
     }
 #endif  // HAVE_HALIDE
 
+#ifdef HAVE_OPENCL
+    // BNLLForward kernel computes log(1 + exp(x)) that differs from apply().
+    bool applyOCL(const UMat&, UMat&) const { return false; }
+#endif  // HAVE_OPENCL
+
     int64 getFLOPSPerElement() const { return 5; }
 };
 
@@ -367,6 +444,19 @@ struct PowerFunctor
     }
 #endif  // HAVE_HALIDE
 
+#ifdef HAVE_OPENCL
+    bool applyOCL(const UMat& src, UMat& dst) const
+    {
+        ocl::Kernel kernel("PowForward", ocl::dnn::activations_oclsrc, "-DT=float");
+        if (kernel.empty())
+            return false;
+        int count = (int)src.total();
+        kernel.args(count, ocl::KernelArg::PtrReadOnly(src), oclOffset(src),
+                    ocl::KernelArg::PtrWriteOnly(dst), oclOffset(dst), power, scale, shift);
+        return runKernel1D(kernel, count);
+    }
+#endif  // HAVE_OPENCL
+
     int64 getFLOPSPerElement() const { return power == 1 ? 2 : 10; }
 };
 
@@ -426,6 +516,10 @@ struct ChannelsPReLUFunctor
     }
 #endif  // HAVE_HALIDE
 
+#ifdef HAVE_OPENCL
+    bool applyOCL(const UMat&, UMat&) const { return false; }
+#endif  // HAVE_OPENCL
+
     int64 getFLOPSPerElement() const { return 1; }
 };
 
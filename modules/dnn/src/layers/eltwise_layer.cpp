@@ -42,6 +42,7 @@
 #include "../precomp.hpp"
 #include "layers_common.hpp"
 #include "op_halide.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -53,6 +54,8 @@ class EltwiseLayerImpl : public EltwiseLayer
 public:
     EltwiseOp op;
     std::vector<int> coeffs;
+    Mat fusedScale, fusedShift;
+    Ptr<ActivationLayer> activ;
 
     EltwiseLayerImpl(const LayerParams& params)
     {
@@ -108,48 +111,193 @@ public:
         return false;
     }
 
-    void forward(std::vector<Mat *> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
+    // Scale and shift of the fused layers (x*scale + shift) are applied
+    // before the fused activation.
+    virtual bool tryFuse(Ptr<Layer>& top)
     {
-        Mat& output = outputs[0];
-        switch (op)
+        // Multiplication can't be moved over the activation.
+        if( activ )
+            return false;
+
+        Mat scale, shift;
+        top->getScaleShift(scale, shift);
+        if( !scale.empty() || !shift.empty() )
         {
-            case SUM:
-                CV_Assert(coeffs.size() == 0 || coeffs.size() == inputs.size());
-                if (0 < coeffs.size())
+            CV_Assert((scale.empty() || scale.type() == CV_32F) &&
+                      (shift.empty() || shift.type() == CV_32F));
+            if( !scale.empty() )
+            {
+                scale = scale.reshape(1, 1);
+                fusedScale = fusedScale.empty() ? scale.clone() : fusedScale.mul(scale);
+                if( !fusedShift.empty() )
+                    fusedShift = fusedShift.mul(scale);
+            }
+            if( !shift.empty() )
+            {
+                shift = shift.reshape(1, 1);
+                fusedShift = fusedShift.empty() ? shift.clone() : fusedShift + shift;
+            }
+            return true;
+        }
+
+        activ = top.dynamicCast<ActivationLayer>();
+        return !activ.empty();
+    }
+
+    // Fused scale, shift and activation are shared with the copy.
+    virtual Ptr<Layer> clone() const
+    {
+        return Ptr<Layer>(new EltwiseLayerImpl(*this));
+    }
+
+    // Computes the operation over all the inputs, the fused per-channel
+    // scale and shift and the fused activation in a single pass. Stripes are
+    // split at plane boundaries and processed by small blocks so every
+    // stage reads the data written by the previous one from cache.
+    class EltwiseInvoker : public ParallelLoopBody
+    {
+    public:
+        enum { BLOCK_SIZE = 1024 };
+
+        const Mat** srcs;
+        int nsrcs;
+        Mat* dst;
+        std::vector<float> coeffs;
+        EltwiseOp op;
+        const float* scale;
+        const float* shift;
+        const ActivationLayer* activ;
+        int channels;
+        size_t planeSize;
+        int nstripes;
+
+        EltwiseInvoker() : srcs(0), nsrcs(0), dst(0), op(EltwiseLayer::SUM), scale(0), shift(0),
+                           activ(0), channels(0), planeSize(0), nstripes(0) {}
+
+        static void run(const Mat** srcs, int nsrcs, Mat& dst, const std::vector<int>& coeffs,
+                        EltwiseOp op, const Mat& scale, const Mat& shift,
+                        const Ptr<ActivationLayer>& activ, int nstripes)
+        {
+            CV_Assert(nsrcs >= 2 && dst.dims >= 2 && dst.type() == CV_32F && dst.isContinuous());
+            CV_Assert(coeffs.empty() || coeffs.size() == (size_t)nsrcs);
+            for( int i = 0; i < nsrcs; i++ )
+            {
+                CV_Assert(srcs[i]->size == dst.size && srcs[i]->type() == CV_32F &&
+                          srcs[i]->isContinuous());
+            }
+
+            EltwiseInvoker p;
+            p.srcs = srcs;
+            p.nsrcs = nsrcs;
+            p.dst = &dst;
+            p.coeffs.assign(coeffs.begin(), coeffs.end());
+            p.op = op;
+            p.channels = dst.size[1];
+            p.planeSize = dst.total() / ((size_t)dst.size[0] * p.channels);
+            CV_Assert(scale.empty() || scale.total() == (size_t)p.channels);
+            CV_Assert(shift.empty() || shift.total() == (size_t)p.channels);
+            p.scale = scale.empty() ? 0 : scale.ptr<float>();
+            p.shift = shift.empty() ? 0 : shift.ptr<float>();
+            p.activ = activ.get();
+            p.nstripes = nstripes;
+            parallel_for_(Range(0, nstripes), p, nstripes);
+        }
+
+        void operator()(const Range& r) const
+        {
+            size_t total = dst->total();
+            size_t stripeSize = (total + nstripes - 1)/nstripes;
+            size_t stripeStart = r.start*stripeSize;
+            size_t stripeEnd = std::min(r.end*stripeSize, total);
+            const float* coeffsptr = coeffs.empty() ? 0 : &coeffs[0];
+            float* dstptr0 = dst->ptr<float>();
+
+            for( size_t ofs = stripeStart; ofs < stripeEnd; )
+            {
+                size_t planeIdx = ofs / planeSize;
+                int c = (int)(planeIdx % channels);
+                int len = (int)std::min(std::min(stripeEnd, (planeIdx + 1)*planeSize) - ofs,
+                                        (size_t)BLOCK_SIZE);
+                float* dstptr = dstptr0 + ofs;
+
+                for( int k = 1; k < nsrcs; k++ )
                 {
-                    output.setTo(0.);
-                    for (size_t i = 0; i < inputs.size(); i++)
+                    const float* aptr = k == 1 ? srcs[0]->ptr<float>() + ofs : dstptr;
+                    const float* bptr = srcs[k]->ptr<float>() + ofs;
+                    int j = 0;
+
+                    if( op == EltwiseLayer::SUM )
                     {
-                        output += *inputs[i] * coeffs[i];
+                        float ca = k == 1 && coeffsptr ? coeffsptr[0] : 1.f;
+                        float cb = coeffsptr ? coeffsptr[k] : 1.f;
+                    #if CV_SIMD128
+                        v_float32x4 ca4 = v_setall_f32(ca), cb4 = v_setall_f32(cb);
+                        for( ; j <= len - 8; j += 8 )
+                        {
+                            v_float32x4 a0 = v_load(aptr + j), a1 = v_load(aptr + j + 4);
+                            v_float32x4 b0 = v_load(bptr + j), b1 = v_load(bptr + j + 4);
+                            v_store(dstptr + j, a0*ca4 + b0*cb4);
+                            v_store(dstptr + j + 4, a1*ca4 + b1*cb4);
+                        }
+                    #endif
+                        for( ; j < len; j++ )
+                            dstptr[j] = aptr[j]*ca + bptr[j]*cb;
                     }
-                }
-                else
-                {
-                    add(*inputs[0], *inputs[1], output);
-                    for (size_t i = 2; i < inputs.size(); i++)
+                    else if( op == EltwiseLayer::PROD )
                     {
-                        output += *inputs[i];
+                    #if CV_SIMD128
+                        for( ; j <= len - 8; j += 8 )
+                        {
+                            v_store(dstptr + j, v_load(aptr + j)*v_load(bptr + j));
+                            v_store(dstptr + j + 4, v_load(aptr + j + 4)*v_load(bptr + j + 4));
+                        }
+                    #endif
+                        for( ; j < len; j++ )
+                            dstptr[j] = aptr[j]*bptr[j];
+                    }
+                    else
+                    {
+                    #if CV_SIMD128
+                        for( ; j <= len - 8; j += 8 )
+                        {
+                            v_store(dstptr + j, v_max(v_load(aptr + j), v_load(bptr + j)));
+                            v_store(dstptr + j + 4, v_max(v_load(aptr + j + 4), v_load(bptr + j + 4)));
+                        }
+                    #endif
+                        for( ; j < len; j++ )
+                            dstptr[j] = std::max(aptr[j], bptr[j]);
                     }
                 }
-                break;
-            case PROD:
-                output.setTo(1.);
-                for (size_t i = 0; i < inputs.size(); i++)
-                {
-                    output = output.mul(*inputs[i]);
-                }
-                break;
-            case MAX:
-                cv::max(*inputs[0], *inputs[1], output);
-                for (size_t i = 2; i < inputs.size(); i++)
+
+                if( scale || shift )
                 {
-                    cv::max(output, *inputs[i], output);
+                    float s = scale ? scale[c] : 1.f, b = shift ? shift[c] : 0.f;
+                    int j = 0;
+                #if CV_SIMD128
+                    v_float32x4 s4 = v_setall_f32(s), b4 = v_setall_f32(b);
+                    for( ; j <= len - 8; j += 8 )
+                    {
+                        v_store(dstptr + j, v_load(dstptr + j)*s4 + b4);
+                        v_store(dstptr + j + 4, v_load(dstptr + j + 4)*s4 + b4);
+                    }
+                #endif
+                    for( ; j < len; j++ )
+                        dstptr[j] = dstptr[j]*s + b;
                 }
-                break;
-            default:
-                CV_Assert(0);
-                break;
+
+                if( activ )
+                    activ->forwardSlice(dstptr, dstptr, len, planeSize, c, c + 1);
+                ofs += len;
+            }
         }
+    };
+
+    void forward(std::vector<Mat *> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
+    {
+        CV_Assert(outputs.size() == 1);
+        const int nstripes = getNumThreads();
+        EltwiseInvoker::run((const Mat**)&inputs[0], (int)inputs.size(), outputs[0],
+                            coeffs, op, fusedScale, fusedShift, activ, nstripes);
     }
 
     virtual Ptr<BackendNode> initHalide(const std::vector<Ptr<BackendWrapper> > &input)
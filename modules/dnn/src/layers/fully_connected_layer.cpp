@@ -43,6 +43,8 @@
 #include "layers_common.hpp"
 #include "op_blas.hpp"
 #include "op_halide.hpp"
+#include "op_int8.hpp"
+#include "op_fp16.hpp"
 #include <opencv2/dnn/shape_utils.hpp>
 
 namespace cv
@@ -56,6 +58,7 @@ public:
     enum { VEC_ALIGN = 8 };
 
     FullyConnectedLayerImpl(const LayerParams& params)
+        : useInt8(false), inputScale(1.f)
     {
         setParamsFrom(params);
         CV_Assert(1 <= blobs.size() && blobs.size() <= 2);
@@ -108,18 +111,21 @@ public:
     virtual bool supportBackend(int backendId)
     {
         return backendId == DNN_BACKEND_DEFAULT ||
-               backendId == DNN_BACKEND_HALIDE && haveHalide() && axis == 1;
+               backendId == DNN_BACKEND_HALIDE && haveHalide() && axis == 1 &&
+               weightsFp16.empty();
     }
 
     class FullConnected : public ParallelLoopBody
     {
     public:
+        enum { FP16_BLK_SIZE = 16 };
+
         FullConnected(const Mat& srcMat, const Mat& weights, const Mat& biasMat, Mat& dstMat, int nstripes)
         {
             CV_Assert( srcMat.dims == 2 && srcMat.cols == weights.cols &&
                        dstMat.rows == srcMat.rows && dstMat.cols == weights.rows &&
-                       srcMat.type() == weights.type() && weights.type() == dstMat.type() &&
-                       srcMat.type() == CV_32F &&
+                       srcMat.type() == dstMat.type() && srcMat.type() == CV_32F &&
+                       (weights.type() == CV_32F || weights.type() == CV_16S) &&
                        (biasMat.empty() || (biasMat.type() == srcMat.type() &&
                         biasMat.isContinuous() && (int)biasMat.total() == dstMat.cols)) );
 
@@ -129,6 +135,7 @@ public:
             dstMat_ = &dstMat;
             nstripes_ = nstripes;
             useAVX2_ = checkHardwareSupport(CPU_AVX2);
+            useNEON_ = checkHardwareSupport(CPU_NEON);
         }
 
         void operator()(const Range& r) const
@@ -143,58 +150,86 @@ public:
             size_t stripeEnd = r.end == nstripes ? total : std::min(r.end*stripeSize, total);
             size_t wstep = weights_->step1();
 
+            // Half precision weights are converted by blocks of rows.
+            const bool fp16 = weights_->type() == CV_16S;
+            AutoBuffer<float> wbuf0_(fp16 ? FP16_BLK_SIZE*wstep + VEC_ALIGN : 0);
+            float* wbuf0 = alignPtr((float*)wbuf0_, (int)(VEC_ALIGN*sizeof(float)));
+
             for( size_t ofs = stripeStart; ofs < stripeEnd; )
             {
                 int sampleIdx = (int)(ofs / nw0);
                 int delta = (int)(ofs - (size_t)sampleIdx*nw0);
                 const float* sptr = srcMat_->ptr<float>(sampleIdx);
-                const float* wptr = weights_->ptr<float>(delta);
                 float* dptr = dstMat_->ptr<float>(sampleIdx) + delta;
                 const float* biasptr = biasMat_->ptr<float>() + delta;
                 int nw = std::min(nw0 - delta, (int)(stripeEnd - ofs));
 
-            #if CV_DNN_TRY_AVX2
-                if( useAVX2_ )
-                    fastGEMM1T_avx2( sptr, wptr, wstep, biasptr, dptr, nw, vecsize);
+                if( fp16 )
+                {
+                    for( int i0 = 0; i0 < nw; i0 += FP16_BLK_SIZE )
+                    {
+                        int n = std::min(nw - i0, (int)FP16_BLK_SIZE);
+                        for( int i = 0; i < n; i++ )
+                            convertFp16ToFp32(weights_->ptr<short>(delta + i0 + i),
+                                              wbuf0 + i*wstep, (int)wstep);
+                        dotRows(sptr, wbuf0, wstep, biasptr + i0, dptr + i0, n, vecsize);
+                    }
+                }
                 else
-            #endif
+                    dotRows(sptr, weights_->ptr<float>(delta), wstep, biasptr, dptr, nw, vecsize);
+                ofs += nw;
+            }
+        }
+
+        // dst[i] = dot(src, weights[i]) + bias[i] for <nw> rows of weights.
+        void dotRows(const float* sptr, const float* wptr, size_t wstep, const float* biasptr,
+                     float* dptr, int nw, int vecsize) const
+        {
+        #if CV_DNN_TRY_AVX2
+            if( useAVX2_ )
+                fastGEMM1T_avx2( sptr, wptr, wstep, biasptr, dptr, nw, vecsize);
+            else
+        #endif
+        #if CV_DNN_TRY_NEON
+            if( useNEON_ )
+                fastGEMM1T_neon( sptr, wptr, wstep, biasptr, dptr, nw, vecsize);
+            else
+        #endif
+            {
+                int i = 0, k;
+
+        #if CV_SIMD128
+                for( ; i <= nw - 4; i += 4, wptr += 4*wstep )
                 {
-                    int i = 0, k;
+                    vfloat32x4 vs0 = v_setall_f32(0.f), vs1 = v_setall_f32(0.f);
+                    vfloat32x4 vs2 = v_setall_f32(0.f), vs3 = v_setall_f32(0.f);
 
-            #if CV_SIMD128
-                    for( ; i <= nw - 4; i += 4, wptr += 4*wstep )
+                    for( k = 0; k < vecsize; k += 4 )
                     {
-                        vfloat32x4 vs0 = v_setall_f32(0.f), vs1 = v_setall_f32(0.f);
-                        vfloat32x4 vs2 = v_setall_f32(0.f), vs3 = v_setall_f32(0.f);
-
-                        for( k = 0; k < vecsize; k += 4 )
-                        {
-                            vfloat32x4 v = v_load(sptr + k);
-                            vs0 += v*v_load_aligned(wptr + k);
-                            vs1 += v*v_load_aligned(wptr + wstep + k);
-                            vs2 += v*v_load_aligned(wptr + wstep*2 + k);
-                            vs3 += v*v_load_aligned(wptr + wstep*3 + k);
-                        }
-
-                        vfloat32x4 s = v_reduce_sum4(vs0, vs1, vs2, vs3);
-                        s += v_load(biasptr + i);
-                        v_store(dptr + i, s);
+                        vfloat32x4 v = v_load(sptr + k);
+                        vs0 += v*v_load_aligned(wptr + k);
+                        vs1 += v*v_load_aligned(wptr + wstep + k);
+                        vs2 += v*v_load_aligned(wptr + wstep*2 + k);
+                        vs3 += v*v_load_aligned(wptr + wstep*3 + k);
                     }
-            #endif
 
-                    for( ; i < nw; i++, wptr += wstep )
+                    vfloat32x4 s = v_reduce_sum4(vs0, vs1, vs2, vs3);
+                    s += v_load(biasptr + i);
+                    v_store(dptr + i, s);
+                }
+        #endif
+
+                for( ; i < nw; i++, wptr += wstep )
+                {
+                    float s0=biasptr[i];
+
+                    for( k = 0; k < vecsize; k++ )
                     {
-                        float s0=biasptr[i];
-
-                        for( k = 0; k < vecsize; k++ )
-                        {
-                            float v = sptr[k];
-                            s0 += v*wptr[k];
-                        }
-                        dptr[i] = s0;
+                        float v = sptr[k];
+                        s0 += v*wptr[k];
                     }
+                    dptr[i] = s0;
                 }
-                ofs += nw;
             }
         }
 
@@ -202,8 +237,95 @@ public:
         Mat* dstMat_;
         int nstripes_;
         bool useAVX2_;
+        bool useNEON_;
+    };
+
+    // The same as FullConnected but for quantized inputs and weights.
+    class FullConnectedInt8 : public ParallelLoopBody
+    {
+    public:
+        FullConnectedInt8(const Mat& srcMat, const Mat& weights, const std::vector<float>& scales,
+                          const Mat& biasMat, Mat& dstMat, int nstripes)
+        {
+            CV_Assert( srcMat.dims == 2 && srcMat.cols == weights.cols &&
+                       dstMat.rows == srcMat.rows && dstMat.cols == weights.rows &&
+                       srcMat.type() == CV_8S && weights.type() == CV_8S &&
+                       dstMat.type() == CV_32F && (int)scales.size() == weights.rows &&
+                       (biasMat.empty() || (biasMat.type() == CV_32F &&
+                        biasMat.isContinuous() && (int)biasMat.total() == dstMat.cols)) );
+
+            srcMat_ = &srcMat;
+            weights_ = &weights;
+            scales_ = &scales[0];
+            biasMat_ = &biasMat;
+            dstMat_ = &dstMat;
+            nstripes_ = nstripes;
+        }
+
+        void operator()(const Range& r) const
+        {
+            int nsamples = srcMat_->rows;
+            int nw0 = weights_->rows;
+            int vecsize = srcMat_->cols;
+            int nstripes = nstripes_;
+            size_t total = (size_t)nsamples*nw0;
+            size_t stripeSize = (total + nstripes - 1)/nstripes;
+            size_t stripeStart = r.start*stripeSize;
+            size_t stripeEnd = r.end == nstripes ? total : std::min(r.end*stripeSize, total);
+
+            for( size_t ofs = stripeStart; ofs < stripeEnd; )
+            {
+                int sampleIdx = (int)(ofs / nw0);
+                int delta = (int)(ofs - (size_t)sampleIdx*nw0);
+                const schar* sptr = srcMat_->ptr<schar>(sampleIdx);
+                float* dptr = dstMat_->ptr<float>(sampleIdx) + delta;
+                const float* biasptr = biasMat_->ptr<float>() + delta;
+                const float* scaleptr = scales_ + delta;
+                int nw = std::min(nw0 - delta, (int)(stripeEnd - ofs));
+
+                for( int i = 0; i < nw; i++ )
+                {
+                    int s = dotInt8(sptr, weights_->ptr<schar>(delta + i), vecsize);
+                    dptr[i] = s*scaleptr[i] + biasptr[i];
+                }
+                ofs += nw;
+            }
+        }
+
+        const Mat *srcMat_, *weights_, *biasMat_;
+        const float* scales_;
+        Mat* dstMat_;
+        int nstripes_;
     };
 
+    virtual bool tryQuantize(float inputMaxAbs)
+    {
+        if (!(inputMaxAbs > 0.f) || !weightsFp16.empty())
+            return false;
+
+        inputScale = inputMaxAbs / 127.f;
+        quantizeWeightsInt8(weightsMat, weightsInt8, outputScales);
+        // Products of quantized values are scaled by both weights and input scales.
+        for (size_t i = 0; i < outputScales.size(); i++)
+            outputScales[i] *= inputScale;
+        useInt8 = true;
+        return true;
+    }
+
+    virtual bool tryConvertFp16()
+    {
+        if (!weightsFp16.empty())
+            return true;
+        if (useInt8)
+            return false;
+
+        // Aligned weights share memory with blobs[0], so both are replaced.
+        convertWeightsFp16(weightsMat, weightsFp16);
+        weightsMat.release();
+        blobs[0] = weightsFp16;
+        return true;
+    }
+
     void forward(std::vector<Mat*> &input, std::vector<Mat> &output, std::vector<Mat> &)
     {
         int axisCan = clamp(axis, input[0]->dims);
@@ -215,8 +337,23 @@ public:
             Mat dstMat = output[i].reshape(1, outerSize);
 
             const int nstripes = getNumThreads();
-            FullConnected fconn(srcMat, weightsMat, biasMat, dstMat, nstripes);
-            parallel_for_(Range(0, nstripes), fconn, nstripes);
+            if (useInt8)
+            {
+                // Padding of quantized rows matches zero padding of weights.
+                Mat srcInt8 = Mat::zeros(outerSize, weightsInt8.cols, CV_8S);
+                for (int j = 0; j < outerSize; j++)
+                    quantizeInt8(srcMat.ptr<float>(j), srcInt8.ptr<schar>(j),
+                                 srcMat.cols, 1.f / inputScale);
+
+                FullConnectedInt8 fconn(srcInt8, weightsInt8, outputScales, biasMat, dstMat, nstripes);
+                parallel_for_(Range(0, nstripes), fconn, nstripes);
+            }
+            else
+            {
+                FullConnected fconn(srcMat, weightsFp16.empty() ? weightsMat : weightsFp16,
+                                    biasMat, dstMat, nstripes);
+                parallel_for_(Range(0, nstripes), fconn, nstripes);
+            }
         }
     }
 
@@ -285,8 +422,21 @@ public:
 
     }
 
+    // Aligned and quantized weights are shared with the copy.
+    virtual Ptr<Layer> clone() const
+    {
+        return Ptr<Layer>(new FullyConnectedLayerImpl(*this));
+    }
+
     bool bias;
     Mat weightsMat, biasMat;
+    // Half precision weights which replace weightsMat, see tryConvertFp16().
+    Mat weightsFp16;
+
+    bool useInt8;
+    float inputScale;
+    Mat weightsInt8;
+    std::vector<float> outputScales;
 };
 
 Ptr<InnerProductLayer> InnerProductLayer::create(const LayerParams& params)
@@ -79,6 +79,20 @@ void fastGEMM1T_avx2( const float* vec, const float* weights,
 #define CV_DNN_TRY_AVX2 0
 #endif
 
+#if CV_NEON
+#define CV_DNN_TRY_NEON 1
+
+void fastConv_neon(const float* weights, size_t wstep, const float* bias,
+                   const float* rowbuf, float* output, const int* outShape,
+                   int blockSize, int vecsize, int vecsize_aligned, bool initOutput);
+void fastGEMM1T_neon( const float* vec, const float* weights,
+                      size_t wstep, const float* bias,
+                      float* dst, int nvecs, int vecsize );
+
+#else
+#define CV_DNN_TRY_NEON 0
+#endif
+
 }
 }
 
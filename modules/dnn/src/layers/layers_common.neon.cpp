@@ -0,0 +1,220 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "precomp.hpp"
+#include "layers_common.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+#if CV_DNN_TRY_NEON
+
+#include <arm_neon.h>
+
+namespace cv {
+namespace dnn {
+
+// s += a*b. Fused multiply-add is always available on AArch64 only.
+static inline float32x4_t fma_f32(float32x4_t s, float32x4_t a, float32x4_t b)
+{
+#if defined __aarch64__
+    return vfmaq_f32(s, a, b);
+#else
+    return vmlaq_f32(s, a, b);
+#endif
+}
+
+// Returns {sum(a), sum(b), sum(c), sum(d)}.
+static inline float32x4_t reduce_sum4(float32x4_t a, float32x4_t b, float32x4_t c, float32x4_t d)
+{
+#if defined __aarch64__
+    return vpaddq_f32(vpaddq_f32(a, b), vpaddq_f32(c, d));
+#else
+    float32x2_t a2 = vpadd_f32(vget_low_f32(a), vget_high_f32(a));
+    float32x2_t b2 = vpadd_f32(vget_low_f32(b), vget_high_f32(b));
+    float32x2_t c2 = vpadd_f32(vget_low_f32(c), vget_high_f32(c));
+    float32x2_t d2 = vpadd_f32(vget_low_f32(d), vget_high_f32(d));
+    return vcombine_f32(vpadd_f32(a2, b2), vpadd_f32(c2, d2));
+#endif
+}
+
+void fastConv_neon( const float* weights, size_t wstep, const float* bias,
+                    const float* rowbuf, float* output, const int* outShape,
+                    int blockSize, int vecsize, int vecsize_aligned, bool initOutput )
+{
+    int outCn = outShape[1];
+    size_t outPlaneSize = outShape[2]*outShape[3];
+
+    // now compute dot product of the weights
+    // and im2row-transformed part of the tensor
+    for( int i = 0; i < outCn; i += 3 )
+    {
+        const float* wptr0 = weights + i*wstep;
+        const float* wptr1 = wptr0 + wstep;
+        const float* wptr2 = wptr1 + wstep;
+        float* outptr0 = output + i*outPlaneSize;
+        float* outptr1 = outptr0 + outPlaneSize;
+        float* outptr2 = outptr1 + outPlaneSize;
+        float bias0 = bias[i], bias1 = bias[i+1], bias2 = bias[i+2];
+
+        if( i+2 >= outCn )
+        {
+            wptr2 = wptr1;
+            outptr2 = outptr1;
+            bias2 = bias1;
+            if( i+1 >= outCn )
+            {
+                wptr2 = wptr1 = wptr0;
+                outptr2 = outptr1 = outptr0;
+                bias2 = bias1 = bias0;
+            }
+        }
+
+        int j = 0;
+        for( ; j <= blockSize - 4; j += 4 )
+        {
+            const float* rptr = rowbuf + j*vecsize_aligned;
+
+            float32x4_t vs00 = vdupq_n_f32(0.f), vs01 = vdupq_n_f32(0.f),
+                        vs02 = vdupq_n_f32(0.f), vs03 = vdupq_n_f32(0.f),
+                        vs10 = vdupq_n_f32(0.f), vs11 = vdupq_n_f32(0.f),
+                        vs12 = vdupq_n_f32(0.f), vs13 = vdupq_n_f32(0.f),
+                        vs20 = vdupq_n_f32(0.f), vs21 = vdupq_n_f32(0.f),
+                        vs22 = vdupq_n_f32(0.f), vs23 = vdupq_n_f32(0.f);
+
+            for( int k = 0; k < vecsize; k += 4, rptr += 4 )
+            {
+                float32x4_t w0 = vld1q_f32(wptr0 + k);
+                float32x4_t w1 = vld1q_f32(wptr1 + k);
+                float32x4_t w2 = vld1q_f32(wptr2 + k);
+                float32x4_t r0 = vld1q_f32(rptr);
+
+                vs00 = fma_f32(vs00, w0, r0);
+                vs10 = fma_f32(vs10, w1, r0);
+                vs20 = fma_f32(vs20, w2, r0);
+
+                r0 = vld1q_f32(rptr + vecsize_aligned);
+                vs01 = fma_f32(vs01, w0, r0);
+                vs11 = fma_f32(vs11, w1, r0);
+                vs21 = fma_f32(vs21, w2, r0);
+
+                r0 = vld1q_f32(rptr + vecsize_aligned*2);
+                vs02 = fma_f32(vs02, w0, r0);
+                vs12 = fma_f32(vs12, w1, r0);
+                vs22 = fma_f32(vs22, w2, r0);
+
+                r0 = vld1q_f32(rptr + vecsize_aligned*3);
+                vs03 = fma_f32(vs03, w0, r0);
+                vs13 = fma_f32(vs13, w1, r0);
+                vs23 = fma_f32(vs23, w2, r0);
+            }
+
+            float32x4_t t0 = reduce_sum4(vs00, vs01, vs02, vs03);
+            float32x4_t t1 = reduce_sum4(vs10, vs11, vs12, vs13);
+            float32x4_t t2 = reduce_sum4(vs20, vs21, vs22, vs23);
+
+            float32x4_t s0, s1, s2;
+
+            if( initOutput )
+            {
+                s0 = vdupq_n_f32(bias0);
+                s1 = vdupq_n_f32(bias1);
+                s2 = vdupq_n_f32(bias2);
+            }
+            else
+            {
+                s0 = vld1q_f32(outptr0 + j);
+                s1 = vld1q_f32(outptr1 + j);
+                s2 = vld1q_f32(outptr2 + j);
+            }
+
+            vst1q_f32(outptr0 + j, vaddq_f32(s0, t0));
+            vst1q_f32(outptr1 + j, vaddq_f32(s1, t1));
+            vst1q_f32(outptr2 + j, vaddq_f32(s2, t2));
+        }
+
+        for( ; j < blockSize; j++ )
+        {
+            const float* rptr = rowbuf + j*vecsize_aligned;
+            float s00, s10, s20;
+
+            if( initOutput )
+            {
+                s00 = bias0;
+                s10 = bias1;
+                s20 = bias2;
+            }
+            else
+            {
+                s00 = outptr0[j];
+                s10 = outptr1[j];
+                s20 = outptr2[j];
+            }
+
+            for( int k = 0; k < vecsize; k++ )
+            {
+                float r0 = rptr[k];
+                s00 += wptr0[k]*r0;
+                s10 += wptr1[k]*r0;
+                s20 += wptr2[k]*r0;
+            }
+
+            outptr0[j] = s00;
+            outptr1[j] = s10;
+            outptr2[j] = s20;
+        }
+    }
+}
+
+// dst = vec * weights^t + bias
+void fastGEMM1T_neon( const float* vec, const float* weights,
+                      size_t wstep, const float* bias,
+                      float* dst, int nvecs, int vecsize )
+{
+    int i = 0;
+
+    for( ; i <= nvecs - 8; i += 8 )
+    {
+        const float* wptr = weights + i*wstep;
+        float32x4_t vs0 = vdupq_n_f32(0.f), vs1 = vdupq_n_f32(0.f),
+                    vs2 = vdupq_n_f32(0.f), vs3 = vdupq_n_f32(0.f),
+                    vs4 = vdupq_n_f32(0.f), vs5 = vdupq_n_f32(0.f),
+                    vs6 = vdupq_n_f32(0.f), vs7 = vdupq_n_f32(0.f);
+
+        for( int k = 0; k < vecsize; k += 4, wptr += 4 )
+        {
+            float32x4_t v = vld1q_f32(vec + k);
+
+            vs0 = fma_f32(vs0, vld1q_f32(wptr), v);
+            vs1 = fma_f32(vs1, vld1q_f32(wptr + wstep), v);
+            vs2 = fma_f32(vs2, vld1q_f32(wptr + wstep*2), v);
+            vs3 = fma_f32(vs3, vld1q_f32(wptr + wstep*3), v);
+            vs4 = fma_f32(vs4, vld1q_f32(wptr + wstep*4), v);
+            vs5 = fma_f32(vs5, vld1q_f32(wptr + wstep*5), v);
+            vs6 = fma_f32(vs6, vld1q_f32(wptr + wstep*6), v);
+            vs7 = fma_f32(vs7, vld1q_f32(wptr + wstep*7), v);
+        }
+
+        float32x4_t s0 = reduce_sum4(vs0, vs1, vs2, vs3);
+        float32x4_t s1 = reduce_sum4(vs4, vs5, vs6, vs7);
+
+        vst1q_f32(dst + i, vaddq_f32(s0, vld1q_f32(bias + i)));
+        vst1q_f32(dst + i + 4, vaddq_f32(s1, vld1q_f32(bias + i + 4)));
+    }
+
+    for( ; i < nvecs; i++ )
+    {
+        const float* wptr = weights + i*wstep;
+        float32x4_t vs0 = vdupq_n_f32(0.f);
+
+        for( int k = 0; k < vecsize; k += 4, wptr += 4 )
+            vs0 = fma_f32(vs0, vld1q_f32(wptr), vld1q_f32(vec + k));
+
+        float32x2_t s0 = vadd_f32(vget_low_f32(vs0), vget_high_f32(vs0));
+        dst[i] = vget_lane_f32(vpadd_f32(s0, s0), 0) + bias[i];
+    }
+}
+
+}
+}
+
+#endif
@@ -42,10 +42,15 @@
 #include "../precomp.hpp"
 #include "layers_common.hpp"
 #include "op_halide.hpp"
+#include "../op_opencl.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/dnn/shape_utils.hpp"
 #include "opencv2/core/hal/hal.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <algorithm>
+#ifdef HAVE_OPENCL
+#include "opencl_kernels_dnn.hpp"
+#endif
 
 namespace cv
 {
@@ -80,7 +85,53 @@ public:
     virtual bool supportBackend(int backendId)
     {
         return backendId == DNN_BACKEND_DEFAULT ||
-               backendId == DNN_BACKEND_HALIDE && haveHalide();
+               backendId == DNN_BACKEND_HALIDE && haveHalide() ||
+               backendId == DNN_BACKEND_OPENCL && haveOpenCL() && type == CHANNEL_NRM;
+    }
+
+    bool forwardOCL(std::vector<UMat*> &inputs, std::vector<UMat> &outputs, std::vector<UMat> &internals)
+    {
+#ifdef HAVE_OPENCL
+        if (type != CHANNEL_NRM)
+            return false;
+
+        const String opts = "-DT=float";
+        ocl::Kernel kfill("LRNFillScale", ocl::dnn::lrn_oclsrc, opts);
+        ocl::Kernel kout("LRNComputeOutput", ocl::dnn::lrn_oclsrc, opts);
+        if (kfill.empty() || kout.empty())
+            return false;
+
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            const UMat &src = *inputs[i];
+            UMat &dst = outputs[i];
+            CV_Assert(src.dims == 4 && src.type() == CV_32F);
+
+            int num = src.size[0], channels = src.size[1];
+            int height = src.size[2], width = src.size[3];
+            int count = (int)src.total();
+            float alphaOverSize = (float)(alpha / (normBySize ? size : 1));
+
+            // Scale buffer is written before output so it can't share memory
+            // with output blob of the in-place computation.
+            scaleBuf.create(1, count, CV_32F);
+
+            kfill.args(num * height * width, ocl::KernelArg::PtrReadOnly(src), oclOffset(src),
+                       num, channels, height, width, size, alphaOverSize, (float)bias,
+                       ocl::KernelArg::PtrWriteOnly(scaleBuf), 0);
+            if (!runKernel1D(kfill, num * height * width))
+                return false;
+
+            kout.args(count, ocl::KernelArg::PtrReadOnly(src), oclOffset(src),
+                      ocl::KernelArg::PtrReadOnly(scaleBuf), 0, (float)-beta,
+                      ocl::KernelArg::PtrWriteOnly(dst), oclOffset(dst));
+            if (!runKernel1D(kout, count))
+                return false;
+        }
+        return true;
+#else
+        return false;
+#endif  // HAVE_OPENCL
     }
 
     void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
@@ -111,6 +162,8 @@ public:
     class ChannelLRN : public ParallelLoopBody
     {
     public:
+        enum { BLOCK_SIZE = 64 };
+
         ChannelLRN(const float* src, float* dst, int channels, int ksize,
                    float alpha1, float bias1, float beta1,
                    size_t planeSize, int nsamples, int nstripes)
@@ -122,6 +175,9 @@ public:
             planeSize_ = planeSize; nsamples_ = nsamples; nstripes_ = nstripes;
         }
 
+        // Pixels are processed by blocks: the running sums of squares over
+        // the window of channels are kept for the whole block, so every
+        // channel row is read sequentially and the sums are vectorized.
         void operator()(const Range& r) const
         {
             int nsamples = nsamples_, nstripes = nstripes_;
@@ -132,13 +188,14 @@ public:
             rstart = std::min(rstart, planeSize_n);
             rend = std::min(rend, planeSize_n);
             float alpha1 = alpha1_, bias1 = bias1_, beta1 = beta1_;
-            int k, channels = channels_, ksize = ksize_;
+            int j, k, channels = channels_, ksize = ksize_;
 
-            AutoBuffer<float> buf_((channels + ksize*2 + 4)*2);
-            float* acc = (float*)buf_;
-            float* buf = acc + channels + ksize + 1;
-            for( k = 0; k <= ksize; k++ )
-                buf[-k-1] = buf[channels + k] = 0.f;
+            AutoBuffer<float> buf_(BLOCK_SIZE*(channels + 2));
+            float* zeros = (float*)buf_;
+            float* sqsum = zeros + BLOCK_SIZE;
+            float* scale = sqsum + BLOCK_SIZE;
+            for( j = 0; j < BLOCK_SIZE; j++ )
+                zeros[j] = 0.f;
 
             for( size_t ofs = rstart; ofs < rend; )
             {
@@ -146,33 +203,59 @@ public:
                 if( sampleIdx >= nsamples )
                     break;
                 size_t ofs0 = ofs - sampleIdx*planeSize;
-                size_t ofs1 = std::min(planeSize - ofs0, rend - ofs) + ofs;
+                int len = (int)std::min(std::min(planeSize - ofs0, rend - ofs), (size_t)BLOCK_SIZE);
                 const float* src = src_ + sampleIdx*planeSize*channels + ofs0;
                 float* dst = dst_ + sampleIdx*planeSize*channels + ofs0;
 
-                for( ; ofs < ofs1; ofs++, src++, dst++ )
+                for( j = 0; j < len; j++ )
+                    sqsum[j] = 0.f;
+                for( k = 0; k < std::min(ksize, channels); k++ )
+                {
+                    const float* x = src + k*planeSize;
+                    for( j = 0; j < len; j++ )
+                        sqsum[j] += x[j]*x[j];
+                }
+
+                for( k = 0; k < channels; k++ )
                 {
-                    for( k = 0; k < channels; k++ )
-                        buf[k] = src[k*planeSize];
-                    float s = 0;
-                    for( k = 0; k < ksize; k++ )
-                        s += buf[k]*buf[k];
-                    for( k = 0; k < channels; k++ )
+                    // the channel entering and the channel leaving the window
+                    const float* x1 = k + ksize < channels ? src + (k + ksize)*planeSize : zeros;
+                    const float* x0 = k - ksize - 1 >= 0 ? src + (k - ksize - 1)*planeSize : zeros;
+                    float* acc = scale + k*len;
+                    j = 0;
+                #if CV_SIMD128
+                    v_float32x4 a4 = v_setall_f32(alpha1), b4 = v_setall_f32(bias1);
+                    v_float32x4 z = v_setzero_f32();
+                    for( ; j <= len - 4; j += 4 )
+                    {
+                        v_float32x4 v1 = v_load(x1 + j), v0 = v_load(x0 + j);
+                        v_float32x4 s = v_max(v_load(sqsum + j) + (v1 + v0)*(v1 - v0), z);
+                        v_store(sqsum + j, s);
+                        v_store(acc + j, s*a4 + b4);
+                    }
+                #endif
+                    for( ; j < len; j++ )
                     {
-                        float x1 = buf[k + ksize];
-                        float x0 = buf[k - ksize - 1];
-                        s = std::max(s + (x1 + x0)*(x1 - x0), 0.f);
-                        acc[k] = (float)(alpha1*s + bias1);
+                        float s = std::max(sqsum[j] + (x1[j] + x0[j])*(x1[j] - x0[j]), 0.f);
+                        sqsum[j] = s;
+                        acc[j] = alpha1*s + bias1;
                     }
+                }
 
-                    hal::log32f(acc, acc, channels);
-                    for( k = 0; k < channels; k++ )
-                        acc[k] *= beta1;
-                    hal::exp32f(acc, acc, channels);
+                hal::log32f(scale, scale, channels*len);
+                for( j = 0; j < channels*len; j++ )
+                    scale[j] *= beta1;
+                hal::exp32f(scale, scale, channels*len);
 
-                    for( k = 0; k < channels; k++ )
-                        dst[k*planeSize] = buf[k]*acc[k];
+                for( k = 0; k < channels; k++ )
+                {
+                    const float* x = src + k*planeSize;
+                    const float* acc = scale + k*len;
+                    float* y = dst + k*planeSize;
+                    for( j = 0; j < len; j++ )
+                        y[j] = x[j]*acc[j];
                 }
+                ofs += len;
             }
         }
 
@@ -198,11 +281,49 @@ public:
         parallel_for_(Range(0, nstripes), clrn, nstripes);
     }
 
-    void sqrBoxFilter_(const Mat &src, Mat &dst)
+    // Every plane is filtered into the output and normalized in place.
+    class SpatialLRN : public ParallelLoopBody
     {
-        Mat srcRawWrapper(src.rows, src.cols, src.type(), src.data, src.step[0]);
-        cv::sqrBoxFilter(srcRawWrapper, dst, dst.depth(), Size(size, size), Point(-1, -1), false, BORDER_CONSTANT);
-    }
+    public:
+        SpatialLRN(const Mat& src, Mat& dst, int ksize, float alpha1, float bias1, float beta1)
+        {
+            src_ = &src; dst_ = &dst;
+            ksize_ = ksize;
+            alpha1_ = alpha1; bias1_ = bias1; beta1_ = beta1;
+        }
+
+        void operator()(const Range& r) const
+        {
+            int height = src_->size[2], width = src_->size[3];
+            int j, len = height*width;
+            float alpha1 = alpha1_, bias1 = bias1_, beta1 = beta1_;
+
+            for( int i = r.start; i < r.end; i++ )
+            {
+                const float* srcptr = src_->ptr<float>() + (size_t)i*len;
+                float* dstptr = dst_->ptr<float>() + (size_t)i*len;
+                Mat src(height, width, CV_32F, (void*)srcptr);
+                Mat dst(height, width, CV_32F, dstptr);
+
+                sqrBoxFilter(src, dst, CV_32F, Size(ksize_, ksize_), Point(-1, -1),
+                             false, BORDER_CONSTANT);
+
+                for( j = 0; j < len; j++ )
+                    dstptr[j] = alpha1*dstptr[j] + bias1;
+                hal::log32f(dstptr, dstptr, len);
+                for( j = 0; j < len; j++ )
+                    dstptr[j] *= beta1;
+                hal::exp32f(dstptr, dstptr, len);
+                for( j = 0; j < len; j++ )
+                    dstptr[j] *= srcptr[j];
+            }
+        }
+
+        const Mat* src_;
+        Mat* dst_;
+        float alpha1_, bias1_, beta1_;
+        int ksize_;
+    };
 
     void spatialNormalization(Mat &srcBlob, Mat &dstBlob)
     {
@@ -210,23 +331,9 @@ public:
         int channels = srcBlob.size[1];
         int sizeNormFactor = normBySize ? size*size : 1;
 
-        Mat srcMat = srcBlob;
-        Mat dstMat = dstBlob;
-
-        for (int n = 0; n < num; n++)
-        {
-            for (int cn = 0; cn < channels; cn++)
-            {
-                Mat src = getPlane(srcMat, n, cn);
-                Mat dst = getPlane(dstMat, n, cn);
-
-                sqrBoxFilter_(src, dst);
-
-                dst.convertTo(dst, dst.type(), alpha/sizeNormFactor, bias);
-                cv::pow(dst, beta, dst);
-                cv::divide(src, dst, dst);
-            }
-        }
+        CV_Assert(srcBlob.isContinuous() && dstBlob.isContinuous());
+        SpatialLRN slrn(srcBlob, dstBlob, size, alpha/sizeNormFactor, bias, -beta);
+        parallel_for_(Range(0, num*channels), slrn, getNumThreads());
     }
 
     virtual Ptr<BackendNode> initHalide(const std::vector<Ptr<BackendWrapper> > &inputs)
@@ -324,6 +431,11 @@ public:
         }
         return flops;
     }
+
+private:
+#ifdef HAVE_OPENCL
+    UMat scaleBuf;
+#endif
 };
 
 Ptr<LRNLayer> LRNLayer::create(const LayerParams& params)
@@ -41,6 +41,7 @@
 
 #include "../precomp.hpp"
 #include "layers_common.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <opencv2/dnn/shape_utils.hpp>
 
 namespace cv
@@ -59,30 +60,93 @@ public:
         eps = params.get<double>("eps", 1e-9);
     }
 
+    // Every row (a sample or a channel of a sample) is normalized by a pass
+    // accumulating the sum and the sum of squares and a pass writing the output.
+    class MVNInvoker : public ParallelLoopBody
+    {
+    public:
+        enum { BLOCK_SIZE = 1024 };
+
+        MVNInvoker(const Mat& src, Mat& dst, size_t rowSize, bool normVariance, double eps)
+            : src_(&src), dst_(&dst), rowSize_(rowSize), normVariance_(normVariance), eps_(eps) {}
+
+        void operator()(const Range& r) const
+        {
+            size_t rowSize = rowSize_;
+            for( int i = r.start; i < r.end; i++ )
+            {
+                const float* srcptr = src_->ptr<float>() + i*rowSize;
+                float* dstptr = dst_->ptr<float>() + i*rowSize;
+
+                // float sums of short blocks are accumulated in double
+                double sum = 0, sqsum = 0;
+                for( size_t ofs = 0; ofs < rowSize; ofs += BLOCK_SIZE )
+                {
+                    const float* x = srcptr + ofs;
+                    int j = 0, len = (int)std::min(rowSize - ofs, (size_t)BLOCK_SIZE);
+                    float s = 0.f, sq = 0.f;
+                #if CV_SIMD128
+                    v_float32x4 s4 = v_setzero_f32(), sq4 = v_setzero_f32();
+                    for( ; j <= len - 4; j += 4 )
+                    {
+                        v_float32x4 v = v_load(x + j);
+                        s4 += v;
+                        sq4 += v*v;
+                    }
+                    s = v_reduce_sum(s4);
+                    sq = v_reduce_sum(sq4);
+                #endif
+                    for( ; j < len; j++ )
+                    {
+                        s += x[j];
+                        sq += x[j]*x[j];
+                    }
+                    sum += s;
+                    sqsum += sq;
+                }
+
+                double mean = sum/rowSize;
+                double alpha = 1;
+                if( normVariance_ )
+                {
+                    double dev = std::sqrt(std::max(sqsum/rowSize - mean*mean, 0.));
+                    alpha = 1/(eps_ + dev);
+                }
+                float a = (float)alpha, b = (float)(-mean*alpha);
+
+                int j = 0, len = (int)rowSize;
+            #if CV_SIMD128
+                v_float32x4 a4 = v_setall_f32(a), b4 = v_setall_f32(b);
+                for( ; j <= len - 4; j += 4 )
+                    v_store(dstptr + j, v_load(srcptr + j)*a4 + b4);
+            #endif
+                for( ; j < len; j++ )
+                    dstptr[j] = srcptr[j]*a + b;
+            }
+        }
+
+        const Mat* src_;
+        Mat* dst_;
+        size_t rowSize_;
+        bool normVariance_;
+        double eps_;
+    };
+
     void forward(std::vector<Mat *> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
     {
         for (size_t inpIdx = 0; inpIdx < inputs.size(); inpIdx++)
         {
             Mat &inpBlob = *inputs[inpIdx];
             Mat &outBlob = outputs[inpIdx];
+            CV_Assert(inpBlob.type() == CV_32F && inpBlob.isContinuous() && outBlob.isContinuous());
 
             int splitDim = (acrossChannels) ? 1 : 2;
             int i, newRows = 1;
             for( i = 0; i < splitDim; i++ )
                 newRows *= inpBlob.size[i];
-            Mat inpMat = inpBlob.reshape(1, newRows);
-            Mat outMat = outBlob.reshape(1, newRows);
 
-            Scalar mean, dev;
-            for ( i = 0; i < newRows; i++)
-            {
-                Mat inpRow = inpMat.row(i);
-                Mat outRow = outMat.row(i);
-
-                cv::meanStdDev(inpRow, mean, (normVariance) ? dev : noArray());
-                double alpha = (normVariance) ? 1/(eps + dev[0]) : 1;
-                inpRow.convertTo(outRow, outRow.type(), alpha, -mean[0] * alpha);
-            }
+            MVNInvoker p(inpBlob, outBlob, inpBlob.total() / newRows, normVariance, eps);
+            parallel_for_(Range(0, newRows), p, getNumThreads());
         }
     }
 
@@ -41,7 +41,7 @@
 
 #include "../precomp.hpp"
 #include "layers_common.hpp"
-#include "op_blas.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include <float.h>
 #include <algorithm>
@@ -122,94 +122,148 @@ public:
         CV_Assert(inputs[0]->dims > 2);
     }
 
-    bool getMemoryShapes(const std::vector<MatShape> &inputs,
-                         const int requiredOutputs,
-                         std::vector<MatShape> &outputs,
-                         std::vector<MatShape> &internals) const
+    // Computes the L2 norms of the samples (across spatial) or of the pixels
+    // over channels and writes the scaled outputs. Pixels are processed by
+    // blocks so the squares are summed over channels in a small buffer.
+    class NormalizeInvoker : public ParallelLoopBody
     {
-        bool inplace = Layer::getMemoryShapes(inputs, requiredOutputs, outputs, internals);
-        size_t channels = inputs[0][1];
-        size_t rows = inputs[0][2];
-        size_t cols = inputs[0][3];
-        size_t channelSize = rows * cols;
+    public:
+        enum { BLOCK_SIZE = 256 };
 
-        internals.assign(1, shape(channels, channelSize));
-        internals.push_back(shape(channels, 1));
-        internals.push_back(shape(1, channelSize));
+        const Mat* src;
+        Mat* dst;
+        const float* scale;
+        bool acrossSpatial;
+        bool channelShared;
+        float eps;
+        int channels;
+        size_t channelSize;
+        int nstripes;
 
-        return inplace;
-    }
-
-    void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
-    {
-        checkInputs(inputs);
-
-        Mat& buffer = internals[0], sumChannelMultiplier = internals[1],
-                sumSpatialMultiplier = internals[2];
-
-        sumChannelMultiplier.setTo(1.0);
-        sumSpatialMultiplier.setTo(1.0);
-
-        const Mat& inp0 = *inputs[0];
-        size_t num = inp0.size[0];
-        size_t channels = inp0.size[1];
-        size_t channelSize = inp0.size[2] * inp0.size[3];
-
-        Mat zeroBuffer(channels, channelSize, CV_32F, Scalar(0));
-        Mat absDiff;
-        Mat scale = blobs[0];
-        for (size_t j = 0; j < inputs.size(); j++)
+        void operator()(const Range& r) const
         {
-            for (size_t n = 0; n < num; ++n)
+            int num = src->size[0];
+            if( acrossSpatial )
             {
-                Mat src = Mat(channels, channelSize, CV_32F, inputs[j]->ptr<float>(n));
-                Mat dst = Mat(channels, channelSize, CV_32F, outputs[j].ptr<float>(n));
-
-                buffer = src.mul(src);
-
-                if (_across_spatial)
+                for( int n = r.start; n < r.end; n++ )
                 {
-                    absdiff(buffer, zeroBuffer, absDiff);
-
+                    const float* srcptr = src->ptr<float>(n);
+                    float* dstptr = dst->ptr<float>(n);
+                    int j = 0, len = (int)(channels*channelSize);
+                    float sqsum = 0.f;
+                #if CV_SIMD128
+                    v_float32x4 sq4 = v_setzero_f32();
+                    for( ; j <= len - 4; j += 4 )
+                    {
+                        v_float32x4 v = v_load(srcptr + j);
+                        sq4 += v*v;
+                    }
+                    sqsum = v_reduce_sum(sq4);
+                #endif
+                    for( ; j < len; j++ )
+                        sqsum += srcptr[j]*srcptr[j];
                     // add eps to avoid overflow
-                    double absSum = sum(absDiff)[0] + _eps;
+                    float norm = 1.f/std::sqrt(sqsum + eps);
 
-                    float norm = sqrt(absSum);
-                    dst = src / norm;
+                    for( int c = 0; c < channels; c++ )
+                    {
+                        float a = norm*(channelShared ? scale[0] : scale[c]);
+                        const float* x = srcptr + c*channelSize;
+                        float* y = dstptr + c*channelSize;
+                        for( j = 0; j < (int)channelSize; j++ )
+                            y[j] = x[j]*a;
+                    }
                 }
-                else
-                {
-                    Mat norm(channelSize, 1, buffer.type()); // 1 x channelSize
-
-                    // (_channels x channelSize)T * _channels x 1 -> channelSize x 1
-                    gemmCPU(buffer, sumChannelMultiplier, 1, norm, 0, GEMM_1_T);
-
-                    // compute norm
-                    pow(norm, 0.5f, norm);
+                return;
+            }
 
-                    // scale the layer
-                    // _channels x 1 * (channelSize x 1)T -> _channels x channelSize
-                    gemmCPU(sumChannelMultiplier, norm, 1, buffer, 0, GEMM_2_T);
+            size_t total = num*channelSize;
+            size_t stripeSize = (total + nstripes - 1)/nstripes;
+            size_t stripeStart = r.start*stripeSize;
+            size_t stripeEnd = std::min(r.end*stripeSize, total);
+            float norm[BLOCK_SIZE];
 
-                    dst = src / buffer;
-                }
+            for( size_t ofs = stripeStart; ofs < stripeEnd; )
+            {
+                int n = (int)(ofs / channelSize);
+                size_t ofs0 = ofs - n*channelSize;
+                int j, len = (int)std::min(std::min(channelSize - ofs0, stripeEnd - ofs),
+                                           (size_t)BLOCK_SIZE);
+                const float* srcptr = src->ptr<float>(n) + ofs0;
+                float* dstptr = dst->ptr<float>(n) + ofs0;
 
-                // scale the output
-                if (_channel_shared)
+                for( j = 0; j < len; j++ )
+                    norm[j] = eps;
+                for( int c = 0; c < channels; c++ )
                 {
-                    // _scale: 1 x 1
-                    dst *= scale.at<float>(0, 0);
+                    const float* x = srcptr + c*channelSize;
+                    j = 0;
+                #if CV_SIMD128
+                    for( ; j <= len - 4; j += 4 )
+                    {
+                        v_float32x4 v = v_load(x + j);
+                        v_store(norm + j, v_load(norm + j) + v*v);
+                    }
+                #endif
+                    for( ; j < len; j++ )
+                        norm[j] += x[j]*x[j];
                 }
-                else
-                {
-                    // _scale: _channels x 1
-                    // _channels x 1 * 1 x channelSize -> _channels x channelSize
-                    gemmCPU(scale, sumSpatialMultiplier, 1, buffer, 0);
+                j = 0;
+            #if CV_SIMD128
+                v_float32x4 one = v_setall_f32(1.f);
+                for( ; j <= len - 4; j += 4 )
+                    v_store(norm + j, one / v_sqrt(v_load(norm + j)));
+            #endif
+                for( ; j < len; j++ )
+                    norm[j] = 1.f/std::sqrt(norm[j]);
 
-                    dst = dst.mul(buffer);
+                for( int c = 0; c < channels; c++ )
+                {
+                    float a = channelShared ? scale[0] : scale[c];
+                    const float* x = srcptr + c*channelSize;
+                    float* y = dstptr + c*channelSize;
+                    j = 0;
+                #if CV_SIMD128
+                    v_float32x4 a4 = v_setall_f32(a);
+                    for( ; j <= len - 4; j += 4 )
+                        v_store(y + j, v_load(x + j)*v_load(norm + j)*a4);
+                #endif
+                    for( ; j < len; j++ )
+                        y[j] = x[j]*norm[j]*a;
                 }
+                ofs += len;
             }
         }
+    };
+
+    void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
+    {
+        checkInputs(inputs);
+
+        const Mat& inp0 = *inputs[0];
+        size_t num = inp0.size[0];
+        size_t channels = inp0.size[1];
+        size_t channelSize = inp0.size[2] * inp0.size[3];
+
+        const Mat& scale = blobs[0];
+        CV_Assert(scale.type() == CV_32F && scale.isContinuous());
+        CV_Assert(scale.total() == (_channel_shared ? 1 : channels));
+        for (size_t j = 0; j < inputs.size(); j++)
+        {
+            CV_Assert(inputs[j]->isContinuous() && outputs[j].isContinuous());
+
+            NormalizeInvoker p;
+            p.src = inputs[j];
+            p.dst = &outputs[j];
+            p.scale = scale.ptr<float>();
+            p.acrossSpatial = _across_spatial;
+            p.channelShared = _channel_shared;
+            p.eps = _eps;
+            p.channels = (int)channels;
+            p.channelSize = channelSize;
+            p.nstripes = _across_spatial ? (int)num : getNumThreads();
+            parallel_for_(Range(0, p.nstripes), p, p.nstripes);
+        }
     }
 
 };
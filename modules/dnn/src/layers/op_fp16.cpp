@@ -0,0 +1,33 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "../precomp.hpp"
+#include "op_fp16.hpp"
+
+namespace cv
+{
+namespace dnn
+{
+
+void convertWeightsFp16(const Mat& weights, Mat& dst)
+{
+    CV_Assert(weights.dims == 2 && weights.type() == CV_32F);
+    // Include padding of rows so vectorized loops read zeros there.
+    const int step = (int)weights.step1();
+    Mat padded(weights.rows, step, CV_32F, (void*)weights.data, weights.step);
+    Mat buf;
+    convertFp16(padded, buf);
+    dst = buf.colRange(0, weights.cols);
+}
+
+void convertFp16ToFp32(const short* src, float* dst, int len)
+{
+    // cv::convertFp16 uses F16C instructions if they are available.
+    Mat srcMat(1, len, CV_16S, (void*)src), dstMat(1, len, CV_32F, dst);
+    convertFp16(srcMat, dstMat);
+    CV_DbgAssert(dstMat.ptr<float>() == dst);
+}
+
+}
+}
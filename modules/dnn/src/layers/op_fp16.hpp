@@ -0,0 +1,23 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_DNN_LAYERS_OP_FP16_HPP__
+#define __OPENCV_DNN_LAYERS_OP_FP16_HPP__
+#include "../precomp.hpp"
+
+namespace cv
+{
+namespace dnn
+{
+
+// Converts rows of CV_32F matrix to half precision values stored in CV_16S
+// matrix. Padding of rows (elements between cols and step) is converted too.
+void convertWeightsFp16(const Mat& weights, Mat& dst);
+
+// Converts <len> half precision values to single precision ones.
+void convertFp16ToFp32(const short* src, float* dst, int len);
+
+}
+}
+#endif
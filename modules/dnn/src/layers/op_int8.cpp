@@ -0,0 +1,72 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "../precomp.hpp"
+#include "op_int8.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+namespace cv
+{
+namespace dnn
+{
+
+void quantizeWeightsInt8(const Mat& weights, Mat& dst, std::vector<float>& scales)
+{
+    CV_Assert(weights.dims == 2 && weights.type() == CV_32F);
+    int rows = weights.rows, cols = weights.cols;
+    int cols_aligned = (int)alignSize(cols, INT8_VEC_ALIGN);
+
+    dst = Mat::zeros(rows, cols_aligned, CV_8S);
+    scales.resize(rows);
+    for (int i = 0; i < rows; i++)
+    {
+        const float* wptr = weights.ptr<float>(i);
+        float maxAbs = 0.f;
+        for (int j = 0; j < cols; j++)
+            maxAbs = std::max(maxAbs, std::abs(wptr[j]));
+
+        scales[i] = maxAbs > 0.f ? maxAbs / 127.f : 1.f;
+        quantizeInt8(wptr, dst.ptr<schar>(i), cols, 1.f / scales[i]);
+    }
+}
+
+void quantizeInt8(const float* src, schar* dst, size_t len, float invScale)
+{
+    size_t i = 0;
+#if CV_SIMD128
+    v_float32x4 vscale = v_setall_f32(invScale);
+    for (; i + 16 <= len; i += 16)
+    {
+        v_int32x4 i0 = v_round(v_load(src + i) * vscale);
+        v_int32x4 i1 = v_round(v_load(src + i + 4) * vscale);
+        v_int32x4 i2 = v_round(v_load(src + i + 8) * vscale);
+        v_int32x4 i3 = v_round(v_load(src + i + 12) * vscale);
+        v_store(dst + i, v_pack(v_pack(i0, i1), v_pack(i2, i3)));
+    }
+#endif
+    for (; i < len; i++)
+        dst[i] = saturate_cast<schar>(src[i] * invScale);
+}
+
+int dotInt8(const schar* a, const schar* b, int len)
+{
+    int i = 0, s = 0;
+#if CV_SIMD128
+    v_int32x4 vs = v_setzero_s32();
+    for (; i <= len - 16; i += 16)
+    {
+        v_int16x8 a0, a1, b0, b1;
+        v_expand(v_load(a + i), a0, a1);
+        v_expand(v_load(b + i), b0, b1);
+        vs += v_dotprod(a0, b0) + v_dotprod(a1, b1);
+    }
+    s = v_reduce_sum(vs);
+#endif
+    for (; i < len; i++)
+        s += a[i] * b[i];
+    return s;
+}
+
+}
+}
@@ -0,0 +1,29 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_DNN_LAYERS_OP_INT8_HPP__
+#define __OPENCV_DNN_LAYERS_OP_INT8_HPP__
+#include "../precomp.hpp"
+
+namespace cv
+{
+namespace dnn
+{
+
+// Rows of quantized weights are padded by zeros to be multiple of this value.
+enum { INT8_VEC_ALIGN = 16 };
+
+// Quantizes every row of CV_32F matrix to 8-bit integers using symmetric
+// per-row scales: weights(i, j) ~= dst(i, j) * scales[i].
+void quantizeWeightsInt8(const Mat& weights, Mat& dst, std::vector<float>& scales);
+
+// dst[i] = saturate_cast<schar>(src[i] * invScale)
+void quantizeInt8(const float* src, schar* dst, size_t len, float invScale);
+
+// Dot product of 8-bit integer vectors with 32-bit integer accumulation.
+int dotInt8(const schar* a, const schar* b, int len);
+
+}
+}
+#endif
@@ -81,8 +81,29 @@ public:
         }
     }
 
+    // Returns true if the permutation doesn't change order of the elements
+    // in memory, i.e. only axes of size 1 are moved. Output is a view of the input then.
+    bool keepsLayout(const MatShape &shapeBefore) const
+    {
+        if (!_needsPermute)
+            return true;
+
+        int lastAxis = -1;
+        for (size_t i = 0; i < _numAxes; i++)
+        {
+            int axis = (int)_order[i];
+            if (shapeBefore[axis] == 1)
+                continue;
+            if (axis < lastAxis)
+                return false;
+            lastAxis = axis;
+        }
+        return true;
+    }
+
     PermuteLayerImpl(const LayerParams &params)
     {
+        _isView = false;
         if (!params.has("order"))
         {
             _needsPermute = false;
@@ -116,7 +137,10 @@ public:
                          std::vector<MatShape> &internals) const
     {
         if(!_needsPermute)
+        {
+            outputs = inputs;
             return true;
+        }
 
         CV_Assert(inputs.size() > 0);
         CV_Assert((int)_numAxes == inputs[0].size());
@@ -136,7 +160,8 @@ public:
             outputs.push_back(shapeAfter);
         }
 
-        return false;
+        // Data is not moved so the layer might work in-place.
+        return keepsLayout(shapeBefore);
     }
 
     void computeStrides(const MatShape &shapeBefore, const MatShape &shapeAfter)
@@ -158,12 +183,13 @@ public:
 
     void finalize(const std::vector<Mat*> &inputs, std::vector<Mat> &outputs)
     {
-        if(!_needsPermute)
+        CV_Assert(inputs.size() > 0);
+        _isView = keepsLayout(shape(*inputs[0]));
+        if(_isView)
         {
             return;
         }
 
-        CV_Assert(inputs.size() > 0);
         const Mat& inp0 = *inputs[0];
         CV_Assert((int)_numAxes == inp0.dims);
 
@@ -173,10 +199,14 @@ public:
     void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
     {
         size_t k, ninputs = inputs.size();
-        if(!_needsPermute)
+        if(_isView)
         {
+            // Output usually shares memory with the input.
             for (k = 0; k < ninputs; k++)
-                outputs[k] = *inputs[k];
+            {
+                if (outputs[k].data != inputs[k]->data)
+                    inputs[k]->reshape(1, shape(outputs[k])).copyTo(outputs[k]);
+            }
         }
         else
         {
@@ -230,6 +260,7 @@ public:
     std::vector<size_t> _oldStride;
     std::vector<size_t> _newStride;
     bool _needsPermute;
+    bool _isView;
 
     size_t _numAxes;
 };
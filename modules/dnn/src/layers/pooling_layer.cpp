@@ -41,7 +41,12 @@
 
 #include "../precomp.hpp"
 #include "layers_common.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "op_halide.hpp"
+#include "../op_opencl.hpp"
+#ifdef HAVE_OPENCL
+#include "opencl_kernels_dnn.hpp"
+#endif
 #include <float.h>
 #include <algorithm>
 using std::max;
@@ -98,7 +103,60 @@ public:
         return backendId == DNN_BACKEND_DEFAULT ||
                backendId == DNN_BACKEND_HALIDE && haveHalide() &&
                (type == PoolingLayer::MAX ||
-                type == PoolingLayer::AVE && !pad.width && !pad.height);
+                type == PoolingLayer::AVE && !pad.width && !pad.height) ||
+               backendId == DNN_BACKEND_OPENCL && haveOpenCL() &&
+               (type == PoolingLayer::MAX || type == PoolingLayer::AVE);
+    }
+
+    bool forwardOCL(std::vector<UMat*> &inputs, std::vector<UMat> &outputs, std::vector<UMat> &)
+    {
+#ifdef HAVE_OPENCL
+        for (size_t ii = 0; ii < inputs.size(); ii++)
+        {
+            const UMat& src = *inputs[ii];
+            UMat& dst = outputs[type == MAX ? 2 * ii : ii];
+            CV_Assert(src.dims == 4 && dst.dims == 4 && src.type() == CV_32F);
+
+            String kname = type == MAX ? "MaxPoolForward" : "AvePoolForward";
+            String opts = type == MAX ? "-DT=float -DMASK" : "-DT=float";
+            ocl::Kernel oclKernel(kname.c_str(), ocl::dnn::pooling_oclsrc, opts);
+            if (oclKernel.empty())
+                return false;
+
+            int nthreads = (int)dst.total();
+            ocl::KernelArg srcArg = ocl::KernelArg::PtrReadOnly(src);
+            ocl::KernelArg dstArg = ocl::KernelArg::PtrWriteOnly(dst);
+            int i = 0;
+            i = oclKernel.set(i, nthreads);
+            i = oclKernel.set(i, srcArg);
+            i = oclKernel.set(i, oclOffset(src));
+            i = oclKernel.set(i, src.size[0]);
+            i = oclKernel.set(i, src.size[1]);
+            i = oclKernel.set(i, src.size[2]);
+            i = oclKernel.set(i, src.size[3]);
+            i = oclKernel.set(i, dst.size[2]);
+            i = oclKernel.set(i, dst.size[3]);
+            i = oclKernel.set(i, kernel.height);
+            i = oclKernel.set(i, kernel.width);
+            i = oclKernel.set(i, stride.height);
+            i = oclKernel.set(i, stride.width);
+            i = oclKernel.set(i, pad.height);
+            i = oclKernel.set(i, pad.width);
+            i = oclKernel.set(i, dstArg);
+            i = oclKernel.set(i, oclOffset(dst));
+            if (type == MAX)
+            {
+                UMat& mask = outputs[2 * ii + 1];
+                i = oclKernel.set(i, ocl::KernelArg::PtrWriteOnly(mask));
+                i = oclKernel.set(i, oclOffset(mask));
+            }
+            if (!runKernel1D(oclKernel, nthreads))
+                return false;
+        }
+        return true;
+#else
+        return false;
+#endif  // HAVE_OPENCL
     }
 
     void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
@@ -130,88 +188,221 @@ public:
             return Ptr<BackendNode>();
     }
 
-    void maxPooling(Mat &src, Mat &dst, Mat &mask)
+    class PoolingInvoker : public ParallelLoopBody
     {
-        Size inp(src.size[3], src.size[2]),
-            out(dst.size[3], dst.size[2]);
+    public:
+        const Mat* src;
+        Mat *dst, *mask;
+        Size kernel, stride, pad;
+        int nstripes;
+        int poolingType;
+
+        PoolingInvoker() : src(0), dst(0), mask(0), nstripes(0), poolingType(MAX) {}
+
+        static void run(const Mat& src, Mat& dst, Mat* mask, Size kernel,
+                        Size stride, Size pad, int poolingType, int nstripes)
+        {
+            CV_Assert(src.isContinuous() && dst.isContinuous() &&
+                      src.type() == CV_32F && src.type() == dst.type() &&
+                      src.dims == 4 && dst.dims == 4 &&
+                      src.size[0] == dst.size[0] && src.size[1] == dst.size[1] &&
+                      (!mask || (mask->type() == src.type() && mask->size == dst.size)));
+
+            PoolingInvoker p;
+
+            p.src = &src;
+            p.dst = &dst;
+            p.mask = mask;
+            p.kernel = kernel;
+            p.stride = stride;
+            p.pad = pad;
+            p.nstripes = nstripes;
+            p.poolingType = poolingType;
+
+            parallel_for_(Range(0, nstripes), p, nstripes);
+        }
 
-        for (int n = 0; n < src.size[0]; ++n)
+        // Every stripe is a range of input planes (i.e. pairs of sample and channel).
+        void operator()(const Range& r) const
         {
-            for (int c = 0; c < src.size[1]; ++c)
+            int nplanes = src->size[0]*src->size[1];
+            int stripeSize = (nplanes + nstripes - 1)/nstripes;
+            int plane0 = r.start*stripeSize, plane1 = std::min(r.end*stripeSize, nplanes);
+            Size inp(src->size[3], src->size[2]), out(dst->size[3], dst->size[2]);
+            size_t inpPlaneSize = inp.area(), outPlaneSize = out.area();
+
+            // Output columns which windows are fully inside of input row.
+            // Lanes of a vector have the same vertical window so it's enough
+            // to process them together.
+            int x0 = std::min((pad.width + stride.width - 1)/stride.width, out.width);
+            int x1 = inp.width + pad.width >= kernel.width ?
+                     std::min((inp.width + pad.width - kernel.width)/stride.width + 1, out.width) : 0;
+            x1 = std::max(x0, x1);
+
+            for (int plane = plane0; plane < plane1; plane++)
             {
-                const float *srcData = src.ptr<float>(n, c);
-                float *dstData = dst.ptr<float>(n, c);
-                float *dstMaskData = mask.ptr<float>(n, c);
+                const float *srcData = src->ptr<float>() + plane*inpPlaneSize;
+                float *dstData = dst->ptr<float>() + plane*outPlaneSize;
+                float *dstMaskData = mask ? mask->ptr<float>() + plane*outPlaneSize : 0;
 
                 for (int ph = 0; ph < out.height; ++ph)
                 {
-                    for (int pw = 0; pw < out.width; ++pw)
+                    int hstart = ph * stride.height - pad.height;
+                    int hend = hstart + kernel.height;
+                    if (poolingType == MAX)
                     {
-                        int hstart = ph * stride.height - pad.height;
-                        int wstart = pw * stride.width - pad.width;
-                        int hend = min(hstart + kernel.height, inp.height);
-                        int wend = min(wstart + kernel.width, inp.width);
+                        hend = min(hend, inp.height);
                         hstart = max(hstart, 0);
-                        wstart = max(wstart, 0);
-                        const int poolIndex = ph * out.width + pw;
-                        float max_val = -FLT_MAX;
-                        int max_index = -1;
-
-                        for (int h = hstart; h < hend; ++h)
-                            for (int w = wstart; w < wend; ++w)
-                            {
-                                const int index = h * inp.width + w;
-                                if (srcData[index] > max_val)
-                                {
-                                    max_val = srcData[index];
-                                    max_index = index;
-                                }
-                            }
-
-                        dstData[poolIndex] = max_val;
-                        dstMaskData[poolIndex] = max_index;
+                        maxPoolingRow(srcData, dstData + ph*out.width,
+                                      dstMaskData + ph*out.width, inp, out.width,
+                                      hstart, hend, x0, x1);
+                    }
+                    else
+                    {
+                        // Padded values are counted by average pooling.
+                        hend = min(hend, inp.height + pad.height);
+                        int poolHeight = hend - hstart;
+                        hend = min(hend, inp.height);
+                        hstart = max(hstart, 0);
+                        avePoolingRow(srcData, dstData + ph*out.width, inp, out.width,
+                                      hstart, hend, poolHeight, x0, x1);
                     }
                 }
             }
         }
-    }
 
-    void avePooling(Mat &src, Mat &dst)
-    {
-        Size inp(src.size[3], src.size[2]),
-            out(dst.size[3], dst.size[2]);
-        for (int n = 0; n < src.size[0]; ++n)
+        void maxPoolingRow(const float* srcData, float* dstData, float* dstMaskData,
+                           Size inp, int outWidth, int hstart, int hend, int x0, int x1) const
         {
-            for (int c = 0; c < src.size[1]; ++c)
+            maxPoolingScalar(srcData, dstData, dstMaskData, inp, hstart, hend, 0, x0);
+            int pw = x0;
+        #if CV_SIMD128
+            const int sw = stride.width;
+            v_float32x4 ofs0(0.f, (float)sw, (float)(sw*2), (float)(sw*3));
+            for (; pw <= x1 - 4; pw += 4)
             {
-                const float *srcData = src.ptr<float>(n, c);
-                float *dstData = dst.ptr<float>(n, c);
+                int wstart = pw * sw - pad.width;
+                v_float32x4 max_val0 = v_setall_f32(-FLT_MAX);
+                v_float32x4 max_idx0 = v_setall_f32(-1.f);
 
-                for (int ph = 0; ph < out.height; ++ph)
+                for (int h = hstart; h < hend; ++h)
                 {
-                    for (int pw = 0; pw < out.width; ++pw)
+                    const float* sptr = srcData + h * inp.width + wstart;
+                    for (int w = 0; w < kernel.width; ++w, ++sptr)
                     {
-                        int hstart = ph * stride.height - pad.height;
-                        int wstart = pw * stride.width - pad.width;
-                        int hend = min(hstart + kernel.height, inp.height + pad.height);
-                        int wend = min(wstart + kernel.width, inp.width + pad.width);
-                        int poolSize = (hend - hstart) * (wend - wstart);
-                        hstart = max(hstart, 0);
-                        wstart = max(wstart, 0);
-                        hend = min(hend, inp.height);
-                        wend = min(wend, inp.width);
+                        v_float32x4 v0 = sw == 1 ? v_load(sptr) :
+                                         v_float32x4(sptr[0], sptr[sw], sptr[sw*2], sptr[sw*3]);
+                        v_float32x4 idx0 = v_setall_f32((float)(h * inp.width + wstart + w)) + ofs0;
+                        max_idx0 = v_select(v0 > max_val0, idx0, max_idx0);
+                        max_val0 = v_max(max_val0, v0);
+                    }
+                }
+                v_store(dstData + pw, max_val0);
+                v_store(dstMaskData + pw, max_idx0);
+            }
+        #endif
+            maxPoolingScalar(srcData, dstData, dstMaskData, inp, hstart, hend, pw, outWidth);
+        }
+
+        void maxPoolingScalar(const float* srcData, float* dstData, float* dstMaskData,
+                              Size inp, int hstart, int hend, int pw0, int pw1) const
+        {
+            for (int pw = pw0; pw < pw1; ++pw)
+            {
+                int wstart = pw * stride.width - pad.width;
+                int wend = min(wstart + kernel.width, inp.width);
+                wstart = max(wstart, 0);
+                float max_val = -FLT_MAX;
+                int max_index = -1;
+
+                for (int h = hstart; h < hend; ++h)
+                    for (int w = wstart; w < wend; ++w)
+                    {
+                        const int index = h * inp.width + w;
+                        if (srcData[index] > max_val)
+                        {
+                            max_val = srcData[index];
+                            max_index = index;
+                        }
+                    }
+
+                dstData[pw] = max_val;
+                dstMaskData[pw] = max_index;
+            }
+        }
 
-                        dstData[ph * out.width + pw] = 0.f;
+        void avePoolingRow(const float* srcData, float* dstData, Size inp, int outWidth,
+                           int hstart, int hend, int poolHeight, int x0, int x1) const
+        {
+            avePoolingScalar(srcData, dstData, inp, hstart, hend, poolHeight, 0, x0);
+            int pw = x0;
+        #if CV_SIMD128
+            const int sw = stride.width;
+            v_float32x4 scale = v_setall_f32(1.f / (poolHeight * kernel.width));
+            for (; pw <= x1 - 4; pw += 4)
+            {
+                int wstart = pw * sw - pad.width;
+                v_float32x4 sum0 = v_setzero_f32();
 
-                        for (int h = hstart; h < hend; ++h)
-                            for (int w = wstart; w < wend; ++w)
-                                dstData[ph * out.width + pw] += srcData[h * inp.width + w];
+                for (int h = hstart; h < hend; ++h)
+                {
+                    const float* sptr = srcData + h * inp.width + wstart;
+                    for (int w = 0; w < kernel.width; ++w, ++sptr)
+                    {
+                        sum0 += sw == 1 ? v_load(sptr) :
+                                v_float32x4(sptr[0], sptr[sw], sptr[sw*2], sptr[sw*3]);
+                    }
+                }
+                v_store(dstData + pw, sum0 * scale);
+            }
+        #endif
+            avePoolingScalar(srcData, dstData, inp, hstart, hend, poolHeight, pw, outWidth);
+        }
 
-                        dstData[ph * out.width + pw] /= poolSize;
+        void avePoolingScalar(const float* srcData, float* dstData, Size inp,
+                              int hstart, int hend, int poolHeight, int pw0, int pw1) const
+        {
+            for (int pw = pw0; pw < pw1; ++pw)
+            {
+                int wstart = pw * stride.width - pad.width;
+                int wend = min(wstart + kernel.width, inp.width + pad.width);
+                int poolSize = poolHeight * (wend - wstart);
+                wstart = max(wstart, 0);
+                wend = min(wend, inp.width);
+
+                float sum = 0.f;
+                for (int h = hstart; h < hend; ++h)
+                {
+                    const float* sptr = srcData + h * inp.width;
+                    int w = wstart;
+                #if CV_SIMD128
+                    // Wide windows, i.e. global pooling.
+                    if (wend - wstart >= 8)
+                    {
+                        v_float32x4 s0 = v_setzero_f32();
+                        for (; w <= wend - 4; w += 4)
+                            s0 += v_load(sptr + w);
+                        sum += v_reduce_sum(s0);
                     }
+                #endif
+                    for (; w < wend; ++w)
+                        sum += sptr[w];
                 }
+                dstData[pw] = sum / poolSize;
             }
         }
+    };
+
+    void maxPooling(Mat &src, Mat &dst, Mat &mask)
+    {
+        int nstripes = std::min(src.size[0]*src.size[1], getNumThreads()*4);
+        PoolingInvoker::run(src, dst, &mask, kernel, stride, pad, MAX, std::max(nstripes, 1));
+    }
+
+    void avePooling(Mat &src, Mat &dst)
+    {
+        int nstripes = std::min(src.size[0]*src.size[1], getNumThreads()*4);
+        PoolingInvoker::run(src, dst, 0, kernel, stride, pad, AVE, std::max(nstripes, 1));
     }
 
     virtual Ptr<BackendNode> initMaxPoolingHalide(const std::vector<Ptr<BackendWrapper> > &inputs)
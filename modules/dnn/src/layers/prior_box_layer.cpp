@@ -224,14 +224,35 @@ public:
         return false;
     }
 
-    void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
+    // Priors depend only on the inputs shapes so they are computed once
+    // per shapes and copied to the output at every forward pass.
+    void finalize(const std::vector<Mat*> &inputs, std::vector<Mat> &outputs)
     {
-        int _layerWidth = inputs[0]->size[3];
-        int _layerHeight = inputs[0]->size[2];
+        CV_Assert(inputs.size() == 2);
+        const int layerHeight = inputs[0]->size[2], layerWidth = inputs[0]->size[3];
+        const int imageHeight = inputs[1]->size[2], imageWidth = inputs[1]->size[3];
+        if (_priors.empty() || layerHeight != _layerHeight || layerWidth != _layerWidth ||
+            imageHeight != _imageHeight || imageWidth != _imageWidth)
+        {
+            _layerHeight = layerHeight;
+            _layerWidth = layerWidth;
+            _imageHeight = imageHeight;
+            _imageWidth = imageWidth;
+            _priors.create(shape(outputs[0]), CV_32F);
+            computePriors(_priors);
+        }
+    }
 
-        int _imageWidth = inputs[1]->size[3];
-        int _imageHeight = inputs[1]->size[2];
+    void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
+    {
+        _priors.copyTo(outputs[0]);
+    }
 
+    // Fills prior bboxes (the first channel) and their variances (the second one)
+    // for the feature map of _layerHeight x _layerWidth and the image of
+    // _imageHeight x _imageWidth.
+    void computePriors(Mat& priors)
+    {
         float stepX, stepY;
         if (_stepX == 0 || _stepY == 0) {
           stepX = static_cast<float>(_imageWidth) / _layerWidth;
@@ -243,7 +264,7 @@ public:
 
         int _outChannelSize = _layerHeight * _layerWidth * _numPriors * 4;
 
-        float* outputPtr = outputs[0].ptr<float>();
+        float* outputPtr = priors.ptr<float>();
 
         // first prior: aspect_ratio = 1, size = min_size
         int idx = 0;
@@ -308,10 +329,10 @@ public:
             }
         }
         // set the variance.
-        outputPtr = outputs[0].ptr<float>(0, 1);
+        outputPtr = priors.ptr<float>(0, 1);
         if(_variance.size() == 1)
         {
-            Mat secondChannel(outputs[0].size[2], outputs[0].size[3], CV_32F, outputPtr);
+            Mat secondChannel(1, _outChannelSize, CV_32F, outputPtr);
             secondChannel.setTo(Scalar(_variance[0]));
         }
         else
@@ -354,6 +375,11 @@ public:
     float _boxWidth;
     float _boxHeight;
 
+    // Shapes the cached priors are computed for.
+    int _layerWidth, _layerHeight;
+    int _imageWidth, _imageHeight;
+    Mat _priors;
+
     float _stepX, _stepY;
 
     std::vector<float> _aspectRatios;
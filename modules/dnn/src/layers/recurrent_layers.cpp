@@ -74,12 +74,53 @@ static void tanh(const Mat &src, Mat &dst)
         CV_Error(Error::StsUnsupportedFormat, "Function supports only floating point types");
 }
 
-static void sigmoid(const Mat &src, Mat &dst)
+static inline float sigmoid(float x)
 {
-    cv::exp(-src, dst);
-    cv::pow(1 + dst, -1, dst);
+    return 1.f / (1.f + std::exp(-x));
 }
 
+// Applies gates nonlinearities and updates LSTM cell state for a single timestep.
+// All the operations are done in a single pass over gates to keep data in cache,
+// samples are processed in parallel.
+class LSTMCellInvoker : public ParallelLoopBody
+{
+public:
+    LSTMCellInvoker(const Mat& gates_, const Mat& bias_, Mat& c_, Mat& h_, Mat* cOut_)
+        : gates(&gates_), bias(&bias_), c(&c_), h(&h_), cOut(cOut_) {}
+
+    void operator()(const Range& range) const
+    {
+        int numOut = c->cols;
+        const float* b = bias->ptr<float>();
+        const float *bI = b, *bF = b + numOut, *bO = b + 2*numOut, *bG = b + 3*numOut;
+
+        for (int s = range.start; s < range.end; s++)
+        {
+            const float* g = gates->ptr<float>(s);
+            const float *gI = g, *gF = g + numOut, *gO = g + 2*numOut, *gG = g + 3*numOut;
+            float* cptr = c->ptr<float>(s);
+            float* hptr = h->ptr<float>(s);
+
+            for (int j = 0; j < numOut; j++)
+            {
+                float i = sigmoid(gI[j] + bI[j]);
+                float f = sigmoid(gF[j] + bF[j]);
+                float o = sigmoid(gO[j] + bO[j]);
+                float v = std::tanh(gG[j] + bG[j]);
+                float ct = f*cptr[j] + i*v;  // c_t = f_t (*) c_{t-1} + i_t (*) g_t
+                cptr[j] = ct;
+                hptr[j] = o*std::tanh(ct);   // h_t = o_t (*) tanh(c_t)
+            }
+
+            if (cOut)
+                memcpy(cOut->ptr<float>(s), cptr, numOut*sizeof(float));
+        }
+    }
+
+    const Mat *gates, *bias;
+    Mat *c, *h, *cOut;
+};
+
 class LSTMLayerImpl : public LSTMLayer
 {
     int numTimeStamps, numSamples;
@@ -91,6 +132,8 @@ class LSTMLayerImpl : public LSTMLayer
     bool useTimestampDim;
     bool produceCellOutput;
 
+    Mat WhT, WxT;  // transposed weights for faster matrix multiplication
+
 public:
 
     LSTMLayerImpl(const LayerParams& params)
@@ -175,10 +218,8 @@ public:
         size_t noutputs = produceCellOutput ? 2 : 1;
         outputs.assign(noutputs, outResShape);
 
-        internals.assign(1, shape(_numSamples, _numOut)); // hInternal
-        internals.push_back(shape(_numSamples, _numOut)); // cInternal
-        internals.push_back(shape(_numSamples, 1)); // dummyOnes
-        internals.push_back(shape(_numSamples, 4*_numOut)); // gates
+        internals.assign(1, shape(_numSamples, _numOut)); // cInternal
+        internals.push_back(shape(_numTimeStamps*_numSamples, 4*_numOut)); // gates of all timestamps
 
         return false;
     }
@@ -215,22 +256,19 @@ public:
         outTsShape.push_back(numSamples);
         outTsShape.insert(outTsShape.end(), outTailShape.begin(), outTailShape.end());
 
+        CV_Assert(inp0.type() == CV_32F && Wh.type() == CV_32F);
+        transpose(Wh, WhT);
+        transpose(Wx, WxT);
+
         allocated = true;
     }
 
     void forward(std::vector<Mat*> &input, std::vector<Mat> &output, std::vector<Mat> &internals)
     {
-        const Mat &Wh = blobs[0];
-        const Mat &Wx = blobs[1];
         const Mat &bias = blobs[2];
 
-        int numOut = Wh.size[1];
-
-        Mat hInternal = internals[0], cInternal = internals[1],
-                dummyOnes = internals[2], gates = internals[3];
-        hInternal.setTo(0.);
+        Mat cInternal = internals[0], gatesTs = internals[1];
         cInternal.setTo(0.);
-        dummyOnes.setTo(1.);
 
         int numSamplesTotal = numTimeStamps*numSamples;
         Mat xTs = input[0]->reshape(1, numSamplesTotal);
@@ -238,37 +276,26 @@ public:
         Mat hOutTs = output[0].reshape(1, numSamplesTotal);
         Mat cOutTs = produceCellOutput ? output[1].reshape(1, numSamplesTotal) : Mat();
 
+        // Input projection doesn't depend on previous timestamps so it's
+        // computed by a single matrix multiplication for all the timestamps.
+        dnn::gemm(xTs, WxT, 1, gatesTs, 0);  // Wx * x_t
+
         for (int ts = 0; ts < numTimeStamps; ts++)
         {
             Range curRowRange(ts*numSamples, (ts + 1)*numSamples);
-            Mat xCurr = xTs.rowRange(curRowRange);
-
-            dnn::gemm(xCurr, Wx, 1, gates, 0, GEMM_2_T);      // Wx * x_t
-            dnn::gemm(hInternal, Wh, 1, gates, 1, GEMM_2_T);  //+Wh * h_{t-1}
-            dnn::gemm(dummyOnes, bias, 1, gates, 1);          //+b
-
-            Mat getesIFO = gates.colRange(0, 3*numOut);
-            Mat gateI = gates.colRange(0*numOut, 1*numOut);
-            Mat gateF = gates.colRange(1*numOut, 2*numOut);
-            Mat gateO = gates.colRange(2*numOut, 3*numOut);
-            Mat gateG = gates.colRange(3*numOut, 4*numOut);
-
-            sigmoid(getesIFO, getesIFO);
-            tanh(gateG, gateG);
-
-            //compute c_t
-            multiply(gateF, cInternal, gateF);  // f_t (*) c_{t-1}
-            multiply(gateI, gateG, gateI);      // i_t (*) g_t
-            add(gateF, gateI, cInternal);       // c_t = f_t (*) c_{t-1} + i_t (*) g_t
-
-            //compute h_t
-            tanh(cInternal, hInternal);
-            multiply(gateO, hInternal, hInternal);
-
-            //save results in output blobs
-            hInternal.copyTo(hOutTs.rowRange(curRowRange));
-            if (produceCellOutput)
-                cInternal.copyTo(cOutTs.rowRange(curRowRange));
+            Mat gates = gatesTs.rowRange(curRowRange);
+            Mat hCurr = hOutTs.rowRange(curRowRange);
+            Mat cCurr = produceCellOutput ? cOutTs.rowRange(curRowRange) : Mat();
+
+            if (ts > 0)
+            {
+                Mat hPrev = hOutTs.rowRange(curRowRange - numSamples);
+                dnn::gemm(hPrev, WhT, 1, gates, 1);  //+Wh * h_{t-1}
+            }
+
+            LSTMCellInvoker invoker(gates, bias, cInternal, hCurr,
+                                    produceCellOutput ? &cCurr : 0);
+            parallel_for_(Range(0, numSamples), invoker);
         }
     }
 };
@@ -302,6 +329,7 @@ class RNNLayerImpl : public RNNLayer
     int dtype;
     Mat Whh, Wxh, bh;
     Mat Who, bo;
+    Mat WhhT, WxhT, WhoT;  // transposed weights for faster matrix multiplication
     bool produceH;
 
 public:
@@ -356,8 +384,8 @@ public:
         if (produceH)
             outputs.push_back(shape(dims, 3));
 
-        internals.assign(2, shape(numSamples_, numH_));
-        internals.push_back(shape(numSamples_, 1));
+        internals.assign(1, shape(numTimestamps_*numSamples_, numH_)); // hidden states of all timestamps
+        internals.push_back(shape(numTimestamps_*numSamples_, 1)); // dummyBiasOnes
 
         return false;
     }
@@ -388,6 +416,10 @@ public:
 
         bh = bh.reshape(1, 1); //is 1 x numH Mat
         bo = bo.reshape(1, 1); //is 1 x numO Mat
+
+        transpose(Wxh, WxhT);
+        transpose(Whh, WhhT);
+        transpose(Who, WhoT);
     }
 
     void reshapeOutput(std::vector<Mat> &output)
@@ -407,31 +439,35 @@ public:
         Mat xTs = input[0]->reshape(1, numSamplesTotal);
         Mat oTs = output[0].reshape(1, numSamplesTotal);
         Mat hTs = produceH ? output[1].reshape(1, numSamplesTotal) : Mat();
-        Mat hCurr = internals[0];
-        Mat hPrev = internals[1];
-        Mat dummyBiasOnes = internals[2];
+        Mat hAll = internals[0];
+        Mat dummyBiasOnes = internals[1];
 
-        hPrev.setTo(0.);
         dummyBiasOnes.setTo(1.);
 
+        // Only recurrent part is computed timestamp by timestamp. Input and output
+        // projections are done by single matrix multiplications for all timestamps.
+        dnn::gemm(xTs, WxhT, 1, hAll, 0);           // W_{xh} * x_{curr}
+        dnn::gemm(dummyBiasOnes, bh, 1, hAll, 1);   //+bh
+
         for (int ts = 0; ts < numTimestamps; ts++)
         {
             Range curRowRange = Range(ts * numSamples, (ts + 1) * numSamples);
-            Mat xCurr = xTs.rowRange(curRowRange);
-
-            dnn::gemm(hPrev, Whh, 1, hCurr, 0, GEMM_2_T); // W_{hh} * h_{prev}
-            dnn::gemm(xCurr, Wxh, 1, hCurr, 1, GEMM_2_T); //+W_{xh} * x_{curr}
-            dnn::gemm(dummyBiasOnes, bh, 1, hCurr, 1);    //+bh
-            tanh(hCurr, hPrev);
+            Mat hCurr = hAll.rowRange(curRowRange);
+
+            if (ts > 0)
+            {
+                Mat hPrev = hAll.rowRange(curRowRange - numSamples);
+                dnn::gemm(hPrev, WhhT, 1, hCurr, 1);  //+W_{hh} * h_{prev}
+            }
+            tanh(hCurr, hCurr);
+        }
 
-            Mat oCurr = oTs.rowRange(curRowRange);
-            dnn::gemm(hPrev, Who, 1, oCurr, 0, GEMM_2_T); // W_{ho} * h_{prev}
-            dnn::gemm(dummyBiasOnes, bo, 1, oCurr, 1);    //+b_o
-            tanh(oCurr, oCurr);
+        dnn::gemm(hAll, WhoT, 1, oTs, 0);           // W_{ho} * h_{prev}
+        dnn::gemm(dummyBiasOnes, bo, 1, oTs, 1);    //+b_o
+        tanh(oTs, oTs);
 
-            if (produceH)
-                hPrev.copyTo(hTs.rowRange(curRowRange));
-        }
+        if (produceH)
+            hAll.copyTo(hTs);
     }
 };
 
@@ -12,6 +12,7 @@ Implementation of Scale layer.
 #include "../precomp.hpp"
 #include "layers_common.hpp"
 #include "op_halide.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <opencv2/dnn/shape_utils.hpp>
 
 namespace cv
@@ -22,6 +23,8 @@ namespace dnn
 class ScaleLayerImpl : public ScaleLayer
 {
 public:
+    Ptr<ActivationLayer> activ;
+
     ScaleLayerImpl(const LayerParams& params)
     {
         setParamsFrom(params);
@@ -43,6 +46,55 @@ public:
                backendId == DNN_BACKEND_HALIDE && haveHalide();
     }
 
+    // Every plane is scaled, shifted and passed to the fused activation
+    // while it's in cache.
+    class ScaleInvoker : public ParallelLoopBody
+    {
+    public:
+        const Mat* src;
+        Mat* dst;
+        const float* weights;
+        const float* bias;
+        const ActivationLayer* activ;
+        int channels;
+        size_t planeSize;
+
+        ScaleInvoker(const Mat& src_, Mat& dst_, const Mat& weights_, const Mat& bias_,
+                     const ActivationLayer* activ_)
+            : src(&src_), dst(&dst_), activ(activ_)
+        {
+            channels = src_.size[1];
+            planeSize = src_.total() / ((size_t)src_.size[0] * channels);
+            weights = weights_.ptr<float>();
+            bias = bias_.empty() ? 0 : bias_.ptr<float>();
+        }
+
+        void operator()(const Range& r) const
+        {
+            for( int plane = r.start; plane < r.end; plane++ )
+            {
+                int c = plane % channels;
+                const float* srcptr = src->ptr<float>() + plane*planeSize;
+                float* dstptr = dst->ptr<float>() + plane*planeSize;
+                float w = weights[c], b = bias ? bias[c] : 0.f;
+                int j = 0, len = (int)planeSize;
+            #if CV_SIMD128
+                v_float32x4 w4 = v_setall_f32(w), b4 = v_setall_f32(b);
+                for( ; j <= len - 8; j += 8 )
+                {
+                    v_store(dstptr + j, v_load(srcptr + j)*w4 + b4);
+                    v_store(dstptr + j + 4, v_load(srcptr + j + 4)*w4 + b4);
+                }
+            #endif
+                for( ; j < len; j++ )
+                    dstptr[j] = srcptr[j]*w + b;
+
+                if( activ )
+                    activ->forwardSlice(dstptr, dstptr, len, planeSize, c, c + 1);
+            }
+        }
+    };
+
     void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
     {
         CV_Assert(blobs.size() == 1 + hasBias);
@@ -57,19 +109,38 @@ public:
                 CV_Assert(inpBlob.size[1] == blobs[1].total());
 
             CV_Assert(inpBlob.type() == CV_32F && outBlob.type() == CV_32F);
+            CV_Assert(inpBlob.isContinuous() && outBlob.isContinuous());
 
-            for( int cn = 0; cn < inpBlob.size[0]; cn++ )
-            {
-                for (int n = 0; n < inpBlob.size[1]; n++)
-                {
-                    float w = blobs[0].at<float>(n);
-                    float b = hasBias ? blobs[1].at<float>(n) : 0;
-                    Mat outBlobPlane = getPlane(outBlob, cn, n);
-                    Mat inpBlobPlane = getPlane(inpBlob, cn, n);
-                    inpBlobPlane.convertTo(outBlobPlane, CV_32F, w, b);
-                }
-            }
+            ScaleInvoker p(inpBlob, outBlob, blobs[0], hasBias ? blobs[1] : Mat(), activ.get());
+            int nplanes = inpBlob.size[0]*inpBlob.size[1];
+            parallel_for_(Range(0, nplanes), p, getNumThreads());
+        }
+    }
+
+    virtual bool tryFuse(Ptr<Layer>& top)
+    {
+        if( activ )
+            return false;
+        activ = top.dynamicCast<ActivationLayer>();
+        return !activ.empty();
+    }
+
+    // Weights and the fused activation are shared with the copy.
+    virtual Ptr<Layer> clone() const
+    {
+        return Ptr<Layer>(new ScaleLayerImpl(*this));
+    }
+
+    void getScaleShift(Mat& scale, Mat& shift) const
+    {
+        // The fused activation can't be moved into another layer.
+        if( activ )
+        {
+            scale = shift = Mat();
+            return;
         }
+        scale = blobs[0];
+        shift = hasBias ? blobs[1] : Mat();
     }
 
     virtual Ptr<BackendNode> tryAttach(const Ptr<BackendNode>& node)
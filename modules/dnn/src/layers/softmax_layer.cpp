@@ -41,9 +41,15 @@
 
 #include "../precomp.hpp"
 #include "layers_common.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "op_halide.hpp"
+#include "../op_opencl.hpp"
 #include <algorithm>
+#include <float.h>
 #include <stdlib.h>
+#ifdef HAVE_OPENCL
+#include "opencl_kernels_dnn.hpp"
+#endif
 using std::max;
 
 namespace cv
@@ -78,7 +84,66 @@ public:
     virtual bool supportBackend(int backendId)
     {
         return backendId == DNN_BACKEND_DEFAULT ||
-               backendId == DNN_BACKEND_HALIDE && haveHalide() && axisRaw == 1;
+               backendId == DNN_BACKEND_HALIDE && haveHalide() && axisRaw == 1 ||
+               backendId == DNN_BACKEND_OPENCL && haveOpenCL();
+    }
+
+    bool forwardOCL(std::vector<UMat*> &inputs, std::vector<UMat> &outputs, std::vector<UMat> &internals)
+    {
+#ifdef HAVE_OPENCL
+        const UMat &src = *inputs[0];
+        UMat &dst = outputs[0];
+        UMat &buf = internals[0];
+        CV_Assert(src.type() == CV_32F && src.total() == dst.total());
+
+        int axis = clamp(axisRaw, src.dims);
+        int outerSize = (int)src.total(0, axis), channels = src.size[axis],
+            innerSize = (int)src.total(axis + 1);
+        int count = (int)src.total();
+
+        const String opts = "-DT=float";
+        ocl::Kernel kmax("kernel_channel_max", ocl::dnn::softmax_oclsrc, opts);
+        ocl::Kernel ksub("kernel_channel_subtract", ocl::dnn::softmax_oclsrc, opts);
+        ocl::Kernel ksum("kernel_channel_sum", ocl::dnn::softmax_oclsrc, opts);
+        ocl::Kernel kdiv("kernel_channel_div", ocl::dnn::softmax_oclsrc, opts);
+        if (kmax.empty() || ksub.empty() || ksum.empty() || kdiv.empty())
+            return false;
+
+        if (src.u != dst.u || src.offset != dst.offset)
+            src.copyTo(dst);
+
+        kmax.args(outerSize, channels, innerSize,
+                  ocl::KernelArg::PtrReadOnly(dst), oclOffset(dst),
+                  ocl::KernelArg::PtrWriteOnly(buf), oclOffset(buf));
+        if (!runKernel1D(kmax, outerSize * innerSize))
+            return false;
+
+        ksub.args(count, outerSize, channels, innerSize,
+                  ocl::KernelArg::PtrReadOnly(buf), oclOffset(buf),
+                  ocl::KernelArg::PtrReadWrite(dst), oclOffset(dst));
+        if (!runKernel1D(ksub, count))
+            return false;
+
+        cv::exp(dst, dst);
+
+        ksum.args(outerSize, channels, innerSize,
+                  ocl::KernelArg::PtrReadOnly(dst), oclOffset(dst),
+                  ocl::KernelArg::PtrWriteOnly(buf), oclOffset(buf));
+        if (!runKernel1D(ksum, outerSize * innerSize))
+            return false;
+
+        kdiv.args(count, outerSize, channels, innerSize,
+                  ocl::KernelArg::PtrReadOnly(buf), oclOffset(buf),
+                  ocl::KernelArg::PtrReadWrite(dst), oclOffset(dst));
+        if (!runKernel1D(kdiv, count))
+            return false;
+
+        if (logSoftMax)
+            cv::log(dst, dst);
+        return true;
+#else
+        return false;
+#endif  // HAVE_OPENCL
     }
 
     void forward(std::vector<Mat*> &inputs, std::vector<Mat> &outputs, std::vector<Mat> &internals)
@@ -93,74 +158,174 @@ public:
         CV_Assert(src.type() == CV_32F);
         CV_Assert(src.isContinuous() && dst.isContinuous());
 
-        const float *srcPtr = src.ptr<float>();
-        float *dstPtr = dst.ptr<float>();
-        float *bufPtr = internals[0].ptr<float>();
+        SoftmaxInvoker::run(src.ptr<float>(), dst.ptr<float>(), internals[0].ptr<float>(),
+                            outerSize, channels, innerSize, logSoftMax);
+    }
+
+    class SoftmaxInvoker : public ParallelLoopBody
+    {
+    public:
+        enum { BLOCK_SIZE = 256 };
 
-        size_t outerStep = src.total(axis);
-        size_t cnStep = src.total(axis + 1);
+        const float *srcPtr;
+        float *dstPtr, *bufPtr;
+        size_t outerSize, channels, innerSize, nblocks;
+        bool logSoftMax;
 
-        //compute max along axis
-        for (size_t outerDim = 0; outerDim < outerSize; outerDim++)
+        static void run(const float* srcPtr, float* dstPtr, float* bufPtr,
+                        size_t outerSize, size_t channels, size_t innerSize, bool logSoftMax)
         {
-            size_t srcOffset = outerDim * outerStep;
-            size_t bufOffset = outerDim * cnStep;
-
-            memcpy(bufPtr + bufOffset, srcPtr + srcOffset, innerSize * sizeof(float));
+            SoftmaxInvoker p;
+            p.srcPtr = srcPtr;
+            p.dstPtr = dstPtr;
+            p.bufPtr = bufPtr;
+            p.outerSize = outerSize;
+            p.channels = channels;
+            p.innerSize = innerSize;
+            p.nblocks = (innerSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            p.logSoftMax = logSoftMax;
+
+            // Every sample is split by blocks along inner dimensions so
+            // both classification and segmentation outputs are parallel.
+            parallel_for_(Range(0, (int)(outerSize * p.nblocks)), p);
+        }
 
-            for (size_t cnDim = 1; cnDim < channels; cnDim++)
+        void operator()(const Range& r) const
+        {
+            for (int idx = r.start; idx < r.end; idx++)
             {
-                for (size_t i = 0; i < innerSize; i++)
-                    bufPtr[bufOffset + i] = std::max(bufPtr[bufOffset + i], srcPtr[srcOffset + cnDim * cnStep + i]);
+                size_t outerDim = idx / nblocks;
+                size_t i0 = (idx % nblocks) * BLOCK_SIZE;
+                size_t i1 = std::min(i0 + BLOCK_SIZE, innerSize);
+                const float* src = srcPtr + outerDim * channels * innerSize;
+                float* dst = dstPtr + outerDim * channels * innerSize;
+                float* buf = bufPtr + outerDim * innerSize;
+
+                if (innerSize == 1)
+                    softmaxContinuous(src, dst, buf);
+                else
+                    softmaxStrided(src + i0, dst + i0, buf + i0, (int)(i1 - i0));
             }
         }
 
-        //subtract max
-        for (size_t outerDim = 0; outerDim < outerSize; outerDim++)
+        // Channels of a sample are placed in a row, e.g. classification scores.
+        void softmaxContinuous(const float* src, float* dst, float* buf) const
         {
-            size_t srcOffset = outerDim * outerStep;
-            size_t bufOffset = outerDim * cnStep;
+            int n = (int)channels, k = 0;
+            float maxVal = -FLT_MAX, sum = 0.f;
+        #if CV_SIMD128
+            v_float32x4 vmax = v_setall_f32(-FLT_MAX);
+            for (; k <= n - 4; k += 4)
+                vmax = v_max(vmax, v_load(src + k));
+            maxVal = v_reduce_max(vmax);
+        #endif
+            for (; k < n; k++)
+                maxVal = std::max(maxVal, src[k]);
+            *buf = maxVal;
+
+            k = 0;
+        #if CV_SIMD128
+            vmax = v_setall_f32(maxVal);
+            for (; k <= n - 4; k += 4)
+                v_store(dst + k, v_load(src + k) - vmax);
+        #endif
+            for (; k < n; k++)
+                dst[k] = src[k] - maxVal;
+
+            hal::exp32f(dst, dst, n);
+
+            k = 0;
+        #if CV_SIMD128
+            v_float32x4 vsum = v_setzero_f32();
+            for (; k <= n - 4; k += 4)
+                vsum += v_load(dst + k);
+            sum = v_reduce_sum(vsum);
+        #endif
+            for (; k < n; k++)
+                sum += dst[k];
+
+            float scale = 1.f / sum;
+            k = 0;
+        #if CV_SIMD128
+            v_float32x4 vscale = v_setall_f32(scale);
+            for (; k <= n - 4; k += 4)
+                v_store(dst + k, v_load(dst + k) * vscale);
+        #endif
+            for (; k < n; k++)
+                dst[k] *= scale;
 
-            for (size_t cnDim = 0; cnDim < channels; cnDim++)
-            {
-                for (size_t i = 0; i < innerSize; i++)
-                    dstPtr[srcOffset + cnDim * cnStep + i] = srcPtr[srcOffset + cnDim * cnStep + i] - bufPtr[bufOffset + i];
-            }
+            if (logSoftMax)
+                hal::log32f(dst, dst, n);
         }
 
-        cv::exp(dst, dst);
-
-        for (size_t outerDim = 0; outerDim < outerSize; outerDim++)
+        // Channels are interleaved with spatial dimensions. Each channel
+        // contributes a row of <len> values that are processed as vectors.
+        void softmaxStrided(const float* src, float* dst, float* buf, int len) const
         {
-            size_t srcOffset = outerDim * outerStep;
-            size_t bufOffset = outerDim * cnStep;
+            size_t cnStep = innerSize;
+            int i;
 
-            //sum exp along axis
-            for (size_t i = 0; i < innerSize; i++)
-                bufPtr[bufOffset + i] = 0.f;
+            //compute max along axis
+            memcpy(buf, src, len * sizeof(float));
+            for (size_t cnDim = 1; cnDim < channels; cnDim++)
+            {
+                const float* sptr = src + cnDim * cnStep;
+                i = 0;
+            #if CV_SIMD128
+                for (; i <= len - 4; i += 4)
+                    v_store(buf + i, v_max(v_load(buf + i), v_load(sptr + i)));
+            #endif
+                for (; i < len; i++)
+                    buf[i] = std::max(buf[i], sptr[i]);
+            }
 
+            //subtract max and compute exponent
             for (size_t cnDim = 0; cnDim < channels; cnDim++)
             {
-                for (size_t i = 0; i < innerSize; i++)
-                    bufPtr[bufOffset + i] += dstPtr[srcOffset + cnDim * cnStep + i];
+                const float* sptr = src + cnDim * cnStep;
+                float* dptr = dst + cnDim * cnStep;
+                i = 0;
+            #if CV_SIMD128
+                for (; i <= len - 4; i += 4)
+                    v_store(dptr + i, v_load(sptr + i) - v_load(buf + i));
+            #endif
+                for (; i < len; i++)
+                    dptr[i] = sptr[i] - buf[i];
+                hal::exp32f(dptr, dptr, len);
             }
 
-            //divide by computed sum
+            //sum exp along axis
+            memset(buf, 0, len * sizeof(float));
             for (size_t cnDim = 0; cnDim < channels; cnDim++)
             {
-                for (size_t i = 0; i < innerSize; i++)
-                    dstPtr[srcOffset + cnDim * cnStep + i] /= bufPtr[bufOffset + i];
+                const float* dptr = dst + cnDim * cnStep;
+                i = 0;
+            #if CV_SIMD128
+                for (; i <= len - 4; i += 4)
+                    v_store(buf + i, v_load(buf + i) + v_load(dptr + i));
+            #endif
+                for (; i < len; i++)
+                    buf[i] += dptr[i];
             }
-            if (logSoftMax)
+
+            //divide by computed sum
+            for (i = 0; i < len; i++)
+                buf[i] = 1.f / buf[i];
+            for (size_t cnDim = 0; cnDim < channels; cnDim++)
             {
-                for (size_t cnDim = 0; cnDim < channels; cnDim++)
-                {
-                    for (size_t i = 0; i < innerSize; i++)
-                        dstPtr[srcOffset + cnDim * cnStep + i] = log(dstPtr[srcOffset + cnDim * cnStep + i]);
-                }
+                float* dptr = dst + cnDim * cnStep;
+                i = 0;
+            #if CV_SIMD128
+                for (; i <= len - 4; i += 4)
+                    v_store(dptr + i, v_load(dptr + i) * v_load(buf + i));
+            #endif
+                for (; i < len; i++)
+                    dptr[i] *= buf[i];
+                if (logSoftMax)
+                    hal::log32f(dptr, dptr, len);
             }
         }
-    }
+    };
 
     virtual Ptr<BackendNode> initHalide(const std::vector<Ptr<BackendWrapper> > &inputs)
     {
@@ -0,0 +1,350 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "mapped_file.hpp"
+#include <map>
+
+#if defined _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cv
+{
+namespace dnn
+{
+
+MappedFile::MappedFile(const String& path) : data_(0), size_(0)
+{
+#if defined _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        CV_Error(Error::StsError, "Can't open \"" + path + "\"");
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        CV_Error(Error::StsError, "Can't get size of \"" + path + "\"");
+    }
+    size_ = (size_t)fileSize.QuadPart;
+    if (size_ != 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (mapping)
+        {
+            data_ = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            // The view keeps the mapping and the file opened.
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    if (size_ != 0 && !data_)
+        CV_Error(Error::StsError, "Can't map \"" + path + "\" into memory");
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        CV_Error(Error::StsError, "Can't open \"" + path + "\"");
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        CV_Error(Error::StsError, "Can't get size of \"" + path + "\"");
+    }
+    size_ = (size_t)st.st_size;
+    if (size_ != 0)
+    {
+        // Private mapping is used so writing to the blobs doesn't crash
+        // but makes private copies of the touched pages.
+        void* ptr = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        data_ = ptr != MAP_FAILED ? (char*)ptr : 0;
+    }
+    close(fd);
+    if (size_ != 0 && !data_)
+        CV_Error(Error::StsError, "Can't map \"" + path + "\" into memory");
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if (!data_)
+        return;
+#if defined _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(data_, size_);
+#endif
+}
+
+namespace
+{
+
+// Deallocates headers of mapped data. Memory itself is owned by MappedFile
+// which is referenced from UMatData::userdata.
+class MappedDataAllocator : public MatAllocator
+{
+public:
+    UMatData* allocate(int, const int*, int, void*, size_t*, int, UMatUsageFlags) const
+    {
+        CV_Error(Error::StsNotImplemented, "Mapped data can't be reallocated");
+        return NULL;
+    }
+
+    bool allocate(UMatData*, int, UMatUsageFlags) const
+    {
+        return false;
+    }
+
+    void deallocate(UMatData* u) const
+    {
+        if (!u)
+            return;
+        CV_Assert(u->urefcount == 0 && u->refcount == 0);
+        delete (Ptr<MappedFile>*)u->userdata;
+        delete u;
+    }
+};
+
+MatAllocator* getMappedDataAllocator()
+{
+    static MatAllocator* allocator = new MappedDataAllocator();
+    return allocator;
+}
+
+}  // namespace
+
+Mat wrapMappedData(const Ptr<MappedFile>& file, const char* data,
+                   const MatShape& shape, int type)
+{
+    CV_Assert(!file.empty() && !shape.empty());
+    Mat m((int)shape.size(), &shape[0], type, (void*)data);
+    size_t size = m.total() * m.elemSize();
+    CV_Assert(file->data() <= data && data + size <= file->data() + file->size());
+
+#if !(defined __i386__ || defined __x86_64__ || defined _M_IX86 || defined _M_X64 || defined __aarch64__)
+    if ((size_t)data % m.elemSize1() != 0)
+        return m.clone();
+#endif
+
+    // Allocator isn't set to the header itself so Mat::create() allocates
+    // new data instead of the mapped one.
+    UMatData* u = new UMatData(getMappedDataAllocator());
+    u->data = u->origdata = (uchar*)data;
+    u->size = size;
+    u->refcount = 1;
+    u->userdata = new Ptr<MappedFile>(file);
+    m.u = u;
+    return m;
+}
+
+Mat reinterpretMat(const Mat& m, const MatShape& shape, int type)
+{
+    CV_Assert(m.isContinuous() && !shape.empty());
+    Mat res((int)shape.size(), &shape[0], type, m.data);
+    CV_Assert(res.total() * res.elemSize() == m.total() * m.elemSize());
+    if (m.u)
+    {
+        CV_XADD(&m.u->refcount, 1);
+        res.u = m.u;
+    }
+    return res;
+}
+
+namespace
+{
+
+enum WireType
+{
+    WIRE_VARINT = 0,
+    WIRE_FIXED64 = 1,
+    WIRE_LENGTH_DELIMITED = 2,
+    WIRE_START_GROUP = 3,
+    WIRE_END_GROUP = 4,
+    WIRE_FIXED32 = 5
+};
+
+uint64 readVarint(const char*& p, const char* end)
+{
+    uint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (p >= end)
+            break;
+        uchar b = (uchar)*p++;
+        value |= (uint64)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return value;
+    }
+    CV_Error(Error::StsParseError, "Broken protobuf message: invalid varint");
+    return 0;
+}
+
+void writeVarint(std::string& dst, uint64 value)
+{
+    while (value >= 0x80)
+    {
+        dst.push_back((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    dst.push_back((char)value);
+}
+
+// Moves <p> to the end of value of the field with the given tag.
+// Returns the beginning of length-delimited payload.
+const char* skipValue(const char*& p, const char* end, uint64 tag)
+{
+    const char* payload = p;
+    switch ((int)(tag & 7))
+    {
+    case WIRE_VARINT:
+        readVarint(p, end);
+        break;
+    case WIRE_FIXED64:
+        p += 8;
+        break;
+    case WIRE_FIXED32:
+        p += 4;
+        break;
+    case WIRE_LENGTH_DELIMITED:
+    {
+        uint64 len = readVarint(p, end);
+        if (len > (uint64)(end - p))
+            CV_Error(Error::StsParseError, "Broken protobuf message: field is out of bounds");
+        payload = p;
+        p += len;
+        break;
+    }
+    case WIRE_START_GROUP:
+        for (;;)
+        {
+            uint64 innerTag = readVarint(p, end);
+            if ((innerTag & 7) == WIRE_END_GROUP && (innerTag >> 3) == (tag >> 3))
+                break;
+            skipValue(p, end, innerTag);
+        }
+        break;
+    default:
+        CV_Error(Error::StsParseError, "Broken protobuf message: unknown wire type");
+    }
+    if (p > end)
+        CV_Error(Error::StsParseError, "Broken protobuf message: field is out of bounds");
+    return payload;
+}
+
+struct ProtobufStripper
+{
+    ProtobufStripper(const char* base_, const std::vector<std::vector<int> >& paths_,
+                     size_t minSize_, std::vector<StrippedField>& stripped_)
+        : base(base_), paths(paths_), minSize(minSize_), stripped(stripped_) {}
+
+    // Copies message [begin, end) using paths with the given indices.
+    // Current depth of paths is a number of enclosing messages.
+    void strip(const char* begin, const char* end, const std::vector<int>& active,
+               std::string& dst)
+    {
+        const size_t depth = indices.size();
+        std::map<int, int> counters;
+        const char* p = begin;
+        while (p < end)
+        {
+            const char* fieldBegin = p;
+            uint64 tag = readVarint(p, end);
+            const char* payload = skipValue(p, end, tag);
+            int fieldNumber = (int)(tag >> 3);
+            if ((tag & 7) != WIRE_LENGTH_DELIMITED)
+            {
+                dst.append(fieldBegin, p);
+                continue;
+            }
+            int index = counters[fieldNumber]++;
+
+            int leaf = -1;
+            std::vector<int> deeper;
+            for (size_t i = 0; i < active.size(); i++)
+            {
+                const std::vector<int>& path = paths[active[i]];
+                if (path[depth] != fieldNumber)
+                    continue;
+                if (path.size() == depth + 1)
+                    leaf = active[i];
+                else
+                    deeper.push_back(active[i]);
+            }
+
+            size_t len = p - payload;
+            if (leaf >= 0 && len >= minSize)
+            {
+                StrippedField field;
+                field.path = leaf;
+                field.offset = payload - base;
+                field.size = len;
+                field.indices = indices;
+                field.messages = messages;
+                stripped.push_back(field);
+            }
+            else if (leaf < 0 && !deeper.empty())
+            {
+                std::string sub;
+                indices.push_back(index);
+                messages.push_back(std::make_pair((size_t)(payload - base), len));
+                strip(payload, p, deeper, sub);
+                indices.pop_back();
+                messages.pop_back();
+
+                writeVarint(dst, tag);
+                writeVarint(dst, sub.size());
+                dst += sub;
+            }
+            else
+                dst.append(fieldBegin, p);
+        }
+    }
+
+    const char* base;
+    const std::vector<std::vector<int> >& paths;
+    size_t minSize;
+    std::vector<StrippedField>& stripped;
+    std::vector<int> indices;
+    std::vector<std::pair<size_t, size_t> > messages;
+};
+
+}  // namespace
+
+void stripProtobuf(const char* data, size_t size,
+                   const std::vector<std::vector<int> >& paths, size_t minSize,
+                   std::string& skeleton, std::vector<StrippedField>& stripped)
+{
+    std::vector<int> active;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        CV_Assert(!paths[i].empty());
+        active.push_back((int)i);
+    }
+
+    skeleton.clear();
+    stripped.clear();
+    ProtobufStripper stripper(data, paths, minSize, stripped);
+    stripper.strip(data, data + size, active, skeleton);
+}
+
+std::string readProtobufString(const char* data, size_t size, int fieldNumber)
+{
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end)
+    {
+        uint64 tag = readVarint(p, end);
+        const char* payload = skipValue(p, end, tag);
+        if ((tag & 7) == WIRE_LENGTH_DELIMITED && (int)(tag >> 3) == fieldNumber)
+            return std::string(payload, p);
+    }
+    return std::string();
+}
+
+}  // namespace dnn
+}  // namespace cv
@@ -0,0 +1,70 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_DNN_MAPPED_FILE_HPP__
+#define __OPENCV_DNN_MAPPED_FILE_HPP__
+
+#include "precomp.hpp"
+#include <string>
+#include <utility>
+
+namespace cv
+{
+namespace dnn
+{
+    // Copy-on-write memory mapping of the whole file. Pages are shared between
+    // processes which map the same file until one of them writes there.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const String& path);
+        ~MappedFile();
+
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        char* data_;
+        size_t size_;
+    };
+
+    // Returns Mat header for data placed inside of mapped file. The header keeps
+    // the mapping alive until the last reference to data is released.
+    // No data copy here (except platforms which don't allow unaligned access).
+    Mat wrapMappedData(const Ptr<MappedFile>& file, const char* data,
+                       const MatShape& shape, int type);
+
+    // Returns header of continuous Mat with another shape and type which
+    // shares the data and the reference counter with the source one.
+    Mat reinterpretMat(const Mat& m, const MatShape& shape, int type);
+
+    // Length-delimited field of serialized protobuf message which was cut out
+    // by stripProtobuf().
+    struct StrippedField
+    {
+        int path;                  // Index of matched fields path.
+        size_t offset, size;       // Location of field's payload in source data.
+        std::vector<int> indices;  // Indices of enclosing messages in their repeated fields.
+        std::vector<std::pair<size_t, size_t> > messages;  // Offsets and sizes of enclosing messages.
+    };
+
+    // Copies serialized protobuf message except length-delimited fields which
+    // are found by one of paths of field numbers and have at least minSize bytes.
+    // For example, path {100, 7, 5} cuts NetParameter.layer.blobs.data out of
+    // Caffe model. Result is parsed by protobuf much faster and doesn't hold
+    // copies of the largest fields which might be read from the source data directly.
+    void stripProtobuf(const char* data, size_t size,
+                       const std::vector<std::vector<int> >& paths, size_t minSize,
+                       std::string& skeleton, std::vector<StrippedField>& stripped);
+
+    // Returns value of string field of serialized protobuf message or empty
+    // string if there is no such field.
+    std::string readProtobufString(const char* data, size_t size, int fieldNumber);
+}  // namespace dnn
+}  // namespace cv
+
+#endif  // __OPENCV_DNN_MAPPED_FILE_HPP__
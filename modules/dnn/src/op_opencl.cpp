@@ -0,0 +1,44 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "op_opencl.hpp"
+
+namespace cv
+{
+namespace dnn
+{
+
+bool haveOpenCL()
+{
+#ifdef HAVE_OPENCL
+    return ocl::useOpenCL();
+#else
+    return false;
+#endif  // HAVE_OPENCL
+}
+
+#ifdef HAVE_OPENCL
+int oclOffset(const UMat& m)
+{
+    CV_Assert(m.offset % m.elemSize() == 0);
+    return (int)(m.offset / m.elemSize());
+}
+
+bool runKernel1D(ocl::Kernel& kernel, size_t total)
+{
+    if (kernel.empty())
+        return false;
+    return kernel.run(1, &total, NULL, false);
+}
+
+UMat oclView2D(const UMat& m, int rows)
+{
+    CV_Assert(m.isContinuous() && rows > 0 && m.total() % rows == 0);
+    int sz[] = {rows, (int)(m.total() / rows)};
+    return m.reshape(1, 2, sz);
+}
+#endif  // HAVE_OPENCL
+
+}  // namespace dnn
+}  // namespace cv
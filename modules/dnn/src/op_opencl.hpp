@@ -0,0 +1,33 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_DNN_OP_OPENCL_HPP__
+#define __OPENCV_DNN_OP_OPENCL_HPP__
+
+#include "precomp.hpp"
+#include <opencv2/core/ocl.hpp>
+
+namespace cv
+{
+namespace dnn
+{
+    // Returns true if computations might be done on OpenCL device.
+    bool haveOpenCL();
+
+#ifdef HAVE_OPENCL
+    // Offset of the first element of device blob from the beginning of its
+    // buffer (in elements). Blobs are views of the memory arena so kernels
+    // receive raw buffers together with offsets.
+    int oclOffset(const UMat& m);
+
+    // Runs kernel over <total> work items.
+    bool runKernel1D(ocl::Kernel& kernel, size_t total);
+
+    // Returns two-dimensional view [rows x total/rows] of continuous blob.
+    UMat oclView2D(const UMat& m, int rows);
+#endif  // HAVE_OPENCL
+}  // namespace dnn
+}  // namespace cv
+
+#endif  // __OPENCV_DNN_OP_OPENCL_HPP__
@@ -1,9 +1,12 @@
-__kernel void ReLUForward(const int count, __global const T* in, __global T* out
+__kernel void ReLUForward(const int count, __global const T* in, const int in_offset,
+                          __global T* out, const int out_offset
 #ifndef RELU_NO_SLOPE
 , T negative_slope
 #endif
 ) {
   int index = get_global_id(0);
+  in += in_offset;
+  out += out_offset;
   if(index < count)
 #ifndef RELU_NO_SLOPE
   out[index] = in[index] > 0 ? in[index] : in[index] * negative_slope;
@@ -12,33 +15,49 @@ __kernel void ReLUForward(const int count, __global const T* in, __global T* out
 #endif
 }
 
-__kernel void TanHForward(const int count, __global T* in, __global T* out) {
+__kernel void TanHForward(const int count, __global const T* in, const int in_offset,
+                          __global T* out, const int out_offset) {
   int index = get_global_id(0);
+  in += in_offset;
+  out += out_offset;
   if(index < count)
   out[index] = tanh(in[index]);
 }
 
-__kernel void SigmoidForward(const int count, __global const T* in, __global T* out) {
+__kernel void SigmoidForward(const int count, __global const T* in, const int in_offset,
+                             __global T* out, const int out_offset) {
   int index = get_global_id(0);
+  in += in_offset;
+  out += out_offset;
   if(index < count)
   out[index] = 1. / (1. + exp(-in[index]));
 }
 
-__kernel void BNLLForward(const int n, __global const T* in, __global T* out) {
+__kernel void BNLLForward(const int n, __global const T* in, const int in_offset,
+                          __global T* out, const int out_offset) {
   int index = get_global_id(0);
+  in += in_offset;
+  out += out_offset;
   if (index < n) {
     out[index] = in[index] > 0 ? in[index] + log(1. + exp(-in[index])) : log(1. + exp(in[index]));
   }
 }
 
-__kernel void AbsValForward(const int n, __global const T* in, __global T* out) {
+__kernel void AbsValForward(const int n, __global const T* in, const int in_offset,
+                            __global T* out, const int out_offset) {
   int index = get_global_id(0);
+  in += in_offset;
+  out += out_offset;
   if (index < n)
     out[index] = fabs(in[index]);
 }
 
-__kernel void PowForward(const int n, __global const T* in, __global T* out, const T power, const T scale, const T shift) {
+__kernel void PowForward(const int n, __global const T* in, const int in_offset,
+                         __global T* out, const int out_offset,
+                         const T power, const T scale, const T shift) {
   int index = get_global_id(0);
+  in += in_offset;
+  out += out_offset;
   if (index < n)
     out[index] = pow(shift + scale * in[index], power);
-}
\ No newline at end of file
+}
@@ -24,14 +24,19 @@
  * POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************************/
 
-__kernel void LRNComputeOutput(const int nthreads, __global T* in, __global T* scale, const T negative_beta, __global T* out) {
+__kernel void LRNComputeOutput(const int nthreads, __global const T* in, const int in_offset,
+                               __global const T* scale, const int scale_offset,
+                               const T negative_beta, __global T* out, const int out_offset) {
   int index = get_global_id(0);
   int tmp = get_global_size(0);
   for(index; index < nthreads; index += tmp)
-  out[index] = in[index] * pow(scale[index], negative_beta);
+  out[out_offset + index] = in[in_offset + index] * pow(scale[scale_offset + index], negative_beta);
 }
 
-__kernel void LRNFillScale(const int nthreads, __global T* in, const int num, const int channels, const int height, const int width, const int size, const T alpha_over_size, const T k, __global T* scale) {
+__kernel void LRNFillScale(const int nthreads, __global const T* in, const int in_offset,
+                           const int num, const int channels, const int height, const int width,
+                           const int size, const T alpha_over_size, const T k,
+                           __global T* scale, const int scale_offset) {
   int index = get_global_id(0);
   int tmp = get_global_size(0);
   for(index; index < nthreads; index += tmp) {
@@ -41,8 +46,8 @@ __kernel void LRNFillScale(const int nthreads, __global T* in, const int num, co
     const int n = index / width / height;
     const int offset = (n * channels * height + h) * width + w;
     const int step = height * width;
-    in = in + offset;
-    scale = scale + offset;
+    __global const T* in_off = in + in_offset + offset;
+    __global T* scale_off = scale + scale_offset + offset;
     int head = 0;
     const int pre_pad = (size - 1) / 2;
     const int post_pad = size - pre_pad - 1;
@@ -50,27 +55,27 @@ __kernel void LRNFillScale(const int nthreads, __global T* in, const int num, co
     // fill the scale at [n, :, h, w]
     // accumulate values
     while (head < post_pad && head < channels) {
-      accum_scale += in[head * step] * in[head * step];
+      accum_scale += in_off[head * step] * in_off[head * step];
       ++head;
     }
     // both add and subtract
     while (head < channels) {
-      accum_scale += in[head * step] * in[head * step];
+      accum_scale += in_off[head * step] * in_off[head * step];
       if (head - size >= 0) {
-        accum_scale -= in[(head - size) * step]
-        * in[(head - size) * step];
+        accum_scale -= in_off[(head - size) * step]
+        * in_off[(head - size) * step];
       }
-      scale[(head - post_pad) * step] = k + accum_scale * alpha_over_size;
+      scale_off[(head - post_pad) * step] = k + accum_scale * alpha_over_size;
       ++head;
     }
     // subtract only
     while (head < channels + post_pad) {
       if (head - size >= 0) {
-        accum_scale -= in[(head - size) * step]
-        * in[(head - size) * step];
+        accum_scale -= in_off[(head - size) * step]
+        * in_off[(head - size) * step];
       }
-      scale[(head - post_pad) * step] = k + accum_scale * alpha_over_size;
+      scale_off[(head - post_pad) * step] = k + accum_scale * alpha_over_size;
       ++head;
     }
   }
-}
\ No newline at end of file
+}
@@ -25,12 +25,13 @@
  **************************************************************************************/
 
 __kernel void MaxPoolForward(const int nthreads,
-    __global T* bottom_data, const int num, const int channels, const int height, const int width,
+    __global const T* bottom_data, const int bottom_offset,
+    const int num, const int channels, const int height, const int width,
     const int pooled_height, const int pooled_width, const int kernel_h, const int kernel_w,
     const int stride_h, const int stride_w, const int pad_h, const int pad_w,
-    __global T* top_data
+    __global T* top_data, const int top_offset
 #ifdef MASK
-    , __global float* mask
+    , __global float* mask, const int mask_offset
 #endif
     )
 {
@@ -49,33 +50,31 @@ __kernel void MaxPoolForward(const int nthreads,
     wstart = max(wstart, 0);
     T maxval = -FLT_MAX;
     int maxidx = -1;
-    bottom_data =
-    bottom_data + (n * channels + c) * height * width;
+    __global const T* src =
+    bottom_data + bottom_offset + (n * channels + c) * height * width;
     for (int h = hstart; h < hend; ++h) {
       for (int w = wstart; w < wend; ++w) {
-        if (bottom_data[h * width + w] > maxval) {
+        if (src[h * width + w] > maxval) {
           maxidx = h * width + w;
-          maxval = bottom_data[maxidx];
+          maxval = src[maxidx];
         }
       }
     }
 
-    top_data[index] = maxval;
+    top_data[top_offset + index] = maxval;
 
 #ifdef MASK
-    mask[index] = maxidx;
+    mask[mask_offset + index] = maxidx;
 #endif
   }
 }
 
 __kernel void AvePoolForward(const int nthreads,
-    __global T* bottom_data, const int num, const int channels, const int height, const int width,
+    __global const T* bottom_data, const int bottom_offset,
+    const int num, const int channels, const int height, const int width,
     const int pooled_height, const int pooled_width, const int kernel_h, const int kernel_w,
     const int stride_h, const int stride_w, const int pad_h, const int pad_w,
-    __global T* top_data
-#ifdef MASK
-    , __global float* mask // NOT USED
-#endif
+    __global T* top_data, const int top_offset
     )
 {
   int index = get_global_id(0);
@@ -84,7 +83,9 @@ __kernel void AvePoolForward(const int nthreads,
     int pw = index % pooled_width;
     int ph = (index / pooled_width) % pooled_height;
     int c = (index / pooled_width / pooled_height) % channels;
-    int n = index / pooled_width / pooled_height / channels; int hstart = ph * stride_h - pad_h; int wstart = pw * stride_w - pad_w;
+    int n = index / pooled_width / pooled_height / channels;
+    int hstart = ph * stride_h - pad_h;
+    int wstart = pw * stride_w - pad_w;
     int hend = min(hstart + kernel_h, height + pad_h);
     int wend = min(wstart + kernel_w, width + pad_w);
     const int pool_size = (hend - hstart) * (wend - wstart);
@@ -93,14 +94,13 @@ __kernel void AvePoolForward(const int nthreads,
     hend = min(hend, height);
     wend = min(wend, width);
     T aveval = 0;
-    bottom_data =
-    bottom_data + (n * channels + c) * height * width;
+    __global const T* src =
+    bottom_data + bottom_offset + (n * channels + c) * height * width;
     for (int h = hstart; h < hend; ++h) {
       for (int w = wstart; w < wend; ++w) {
-        aveval += bottom_data[h * width + w];
+        aveval += src[h * width + w];
       }
     }
-    top_data[index] = aveval / pool_size;
+    top_data[top_offset + index] = aveval / pool_size;
   }
-
 }
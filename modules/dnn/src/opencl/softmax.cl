@@ -25,8 +25,11 @@
  **************************************************************************************/
 
 __kernel void kernel_channel_max(const int num, const int channels,
-    const int spatial_dim, __global const T* data, __global T* out) {
+    const int spatial_dim, __global const T* data, const int data_offset,
+    __global T* out, const int out_offset) {
   int index = get_global_id(0);
+  data += data_offset;
+  out += out_offset;
   if(index < num * spatial_dim) {
     int n = index / spatial_dim;
     int s = index % spatial_dim;
@@ -40,8 +43,11 @@ __kernel void kernel_channel_max(const int num, const int channels,
 
 __kernel void kernel_channel_subtract(const int count,
     const int num, const int channels,
-    const int spatial_dim, __global const T* channel_max, __global T* data) {
+    const int spatial_dim, __global const T* channel_max, const int channel_max_offset,
+    __global T* data, const int data_offset) {
   int index = get_global_id(0);
+  channel_max += channel_max_offset;
+  data += data_offset;
   if(index < count) {
     int n = index / channels / spatial_dim;
     int s = index % spatial_dim;
@@ -50,8 +56,11 @@ __kernel void kernel_channel_subtract(const int count,
 }
 
 __kernel void kernel_channel_sum(const int num, const int channels,
-    const int spatial_dim, __global const T* data, __global T* channel_sum) {
+    const int spatial_dim, __global const T* data, const int data_offset,
+    __global T* channel_sum, const int channel_sum_offset) {
   int index = get_global_id(0);
+  data += data_offset;
+  channel_sum += channel_sum_offset;
   if(index < num * spatial_dim) {
     int n = index / spatial_dim;
     int s = index % spatial_dim;
@@ -65,11 +74,14 @@ __kernel void kernel_channel_sum(const int num, const int channels,
 
 __kernel void kernel_channel_div(const int count,
     const int num, const int channels,
-    const int spatial_dim, __global const T* channel_sum, __global T* data) {
+    const int spatial_dim, __global const T* channel_sum, const int channel_sum_offset,
+    __global T* data, const int data_offset) {
   int index = get_global_id(0);
+  channel_sum += channel_sum_offset;
+  data += data_offset;
   if(index < count) {
     int n = index / channels / spatial_dim;
     int s = index % spatial_dim;
     data[index] /= channel_sum[n * spatial_dim + s];
   }
-}
\ No newline at end of file
+}
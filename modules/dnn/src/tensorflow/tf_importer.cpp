@@ -19,11 +19,14 @@ using namespace cv::dnn;
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <google/protobuf/message.h>
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include "tf_io.hpp"
+#include "../mapped_file.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
 
 using ::google::protobuf::RepeatedField;
 using ::google::protobuf::RepeatedPtrField;
@@ -69,8 +72,15 @@ void blobShapeFromTensor(const tensorflow::TensorProto &tensor, MatShape& shape)
     }
 }
 
+// Returns raw data of tensor without copying.
+Mat tensorContent(const tensorflow::TensorProto &tensor)
+{
+    const std::string& content = tensor.tensor_content();
+    return Mat(1, (int)content.size(), CV_8U, (void*)content.data());
+}
+
 template <typename T>
-void parseTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob)
+void parseTensor(const tensorflow::TensorProto &tensor, const Mat &content, Mat &dstBlob)
 {
     MatShape shape;
     blobShapeFromTensor(tensor, shape);
@@ -83,13 +93,22 @@ void parseTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob)
         swap(shape[1], shape[2]); // NCHW
     }
 
-    dstBlob.create(shape, CV_32F);
+    int size = (int)(content.total() / sizeof(T));
+
+    // Tensor of mapped model (the content is reference counted) is used
+    // without copying if it has the same layout as blob.
+    if (content.u && dims > 0 && dims != 4 && DataType<T>::depth == CV_32F)
+    {
+        CV_Assert(size == (int)total(shape));
+        dstBlob = reinterpretMat(content, shape, CV_32F);
+        return;
+    }
 
-    int size = tensor.tensor_content().size() / sizeof(T);
+    dstBlob.create(shape, CV_32F);
     CV_Assert(size == (int)dstBlob.total());
 
     float *dstData = dstBlob.ptr<float>();
-    const T *data = reinterpret_cast<const T*>(tensor.tensor_content().c_str());
+    const T *data = reinterpret_cast<const T*>(content.data);
 
     if (dims == 4)
     {
@@ -116,14 +135,14 @@ void parseTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob)
     }
 }
 
-void blobFromTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob)
+void blobFromTensor(const tensorflow::TensorProto &tensor, const Mat &content, Mat &dstBlob)
 {
     switch (tensor.dtype()) {
         case tensorflow::DT_FLOAT:
-            parseTensor<float>(tensor, dstBlob);
+            parseTensor<float>(tensor, content, dstBlob);
             break;
         case tensorflow::DT_DOUBLE:
-            parseTensor<double>(tensor, dstBlob);
+            parseTensor<double>(tensor, content, dstBlob);
             break;
         default:
             CV_Error(Error::StsError, "Tensor's data type is not supported");
@@ -273,6 +292,9 @@ void setPadding(LayerParams &layerParams, const tensorflow::NodeDef &layer)
         layerParams.set("pad_mode", getLayerAttr(layer, "padding").s());
 }
 
+// Removes nodes which don't change data: Identity, StopGradient and NoOp.
+// Control dependencies (inputs which start from '^') don't matter for
+// inference so they are removed too.
 void RemoveIdentityOps(tensorflow::GraphDef& net) {
     typedef std::map<String, String>  IdentityOpsMap;
     IdentityOpsMap identity_ops;
@@ -282,12 +304,19 @@ void RemoveIdentityOps(tensorflow::GraphDef& net) {
     int layersCount = net.node_size();
     for (int li = 0; li < layersCount; li++)
     {
-        const tensorflow::NodeDef &layer = net.node(li);
-        String type = layer.op();
+        tensorflow::NodeDef* layer = net.mutable_node(li);
+        for (int input_id = layer->input_size() - 1; input_id >= 0; input_id--) {
+            if (!layer->input(input_id).empty() && layer->input(input_id)[0] == '^')
+                layer->mutable_input()->DeleteSubrange(input_id, 1);
+        }
 
-        if (type == "Identity") {
+        String type = layer->op();
+        if (type == "NoOp") {
+            identity_ops_idx.push_back(li);
+        }
+        else if ((type == "Identity" || type == "StopGradient") && layer->input_size() == 1) {
             identity_ops_idx.push_back(li);
-            identity_ops[layer.name()] = layer.input(0);
+            identity_ops[layer->name()] = layer->input(0);
         }
     }
 
@@ -298,9 +327,12 @@ void RemoveIdentityOps(tensorflow::GraphDef& net) {
             String input_op_name = layer->input(input_id);
             IdentityOpsMap::iterator it = identity_ops.find(input_op_name);
 
-            if (it != identity_ops.end()) {
-                layer->set_input(input_id, it->second);
+            // Chains of identities are skipped entirely.
+            while (it != identity_ops.end()) {
+                input_op_name = it->second;
+                it = identity_ops.find(input_op_name);
             }
+            layer->set_input(input_id, input_op_name);
         }
     }
 
@@ -370,11 +402,14 @@ void ExcludeLayer(tensorflow::GraphDef& net, const int layer_index, const int in
 
 class TFImporter : public Importer {
 public:
-    TFImporter(const char *model);
+    TFImporter(const char *model, bool mapWeights);
     void populateNet(Net dstNet);
     ~TFImporter() {}
 
 private:
+    void readMappedBinary(const char *model);
+    Mat getTensorContent(const tensorflow::TensorProto &tensor) const;
+    void blobFromTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob) const;
     void kernelFromTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob);
 
     void connect(const std::map<String, int>& layers_name_id_map, Net& network, const Pin& outPin,
@@ -383,15 +418,76 @@ private:
                            const int input_layer_id, const int input_blobs_count);
     const tensorflow::TensorProto& getConstBlob(const tensorflow::NodeDef &layer, std::map<String, int> const_layers,
                                                 int input_blob_index = -1, int* actual_inp_blob_idx = 0);
+    Mat tensorValues(const tensorflow::TensorProto &tensor, MatShape& shape) const;
+    void foldConstants();
+    void mergeScaleShift(const tensorflow::NodeDef &layer, const std::map<String, int>& const_layers,
+                         std::map<int, String>& layers_to_ignore, LayerParams& layerParams);
 
 
     tensorflow::GraphDef net;
+
+    // Contents of large tensors which are read directly from mapped model file.
+    std::map<const tensorflow::TensorProto*, Mat> mappedTensors;
 };
 
-TFImporter::TFImporter(const char *model)
+TFImporter::TFImporter(const char *model, bool mapWeights)
 {
     if (model && model[0])
-        ReadTFNetParamsFromBinaryFileOrDie(model, &net);
+    {
+        if (mapWeights)
+            readMappedBinary(model);
+        else
+            ReadTFNetParamsFromBinaryFileOrDie(model, &net);
+    }
+}
+
+// Parses graph without GraphDef.node.attr.value.tensor.tensor_content fields
+// which are larger than kMinMappedTensorSize. Small tensors (shapes, axes)
+// are kept in the graph. Nodes might be removed from the graph later but
+// tensors of the rest ones are not moved so they are identified by address.
+void TFImporter::readMappedBinary(const char *model)
+{
+    const size_t kMinMappedTensorSize = 4096;
+    Ptr<MappedFile> mappedModel = makePtr<MappedFile>(model);
+
+    static const int tensorContentPath[] = {1, 5, 2, 8, 4};
+    std::vector<std::vector<int> > paths(1, std::vector<int>(tensorContentPath, tensorContentPath + 5));
+
+    std::string skeleton;
+    std::vector<StrippedField> stripped;
+    stripProtobuf(mappedModel->data(), mappedModel->size(), paths, kMinMappedTensorSize,
+                  skeleton, stripped);
+
+    ReadTFNetParamsFromBinaryBufferOrDie(skeleton.data(), skeleton.size(), &net);
+
+    for (size_t i = 0; i < stripped.size(); i++)
+    {
+        const StrippedField& field = stripped[i];
+        CV_Assert(field.indices.size() == 4 && field.indices[0] < net.node_size());
+
+        // Key of attribute is stored in the map entry message.
+        const std::pair<size_t, size_t>& entry = field.messages[1];
+        std::string key = readProtobufString(mappedModel->data() + entry.first, entry.second, 1);
+
+        const tensorflow::NodeDef &node = net.node(field.indices[0]);
+        CV_Assert(node.attr().find(key) != node.attr().end());
+        const tensorflow::TensorProto *tensor = &node.attr().at(key).tensor();
+        CV_Assert(tensor->tensor_content().empty());
+
+        mappedTensors[tensor] = wrapMappedData(mappedModel, mappedModel->data() + field.offset,
+                                               shape(1, (int)field.size), CV_8U);
+    }
+}
+
+Mat TFImporter::getTensorContent(const tensorflow::TensorProto &tensor) const
+{
+    std::map<const tensorflow::TensorProto*, Mat>::const_iterator it = mappedTensors.find(&tensor);
+    return it != mappedTensors.end() ? it->second : tensorContent(tensor);
+}
+
+void TFImporter::blobFromTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob) const
+{
+    ::blobFromTensor(tensor, getTensorContent(tensor), dstBlob);
 }
 
 void TFImporter::kernelFromTensor(const tensorflow::TensorProto &tensor, Mat &dstBlob)
@@ -411,11 +507,12 @@ void TFImporter::kernelFromTensor(const tensorflow::TensorProto &tensor, Mat &ds
 
     dstBlob.create(shape, CV_32F);
 
-    int size = tensor.tensor_content().size() / sizeof(float);
+    Mat content = getTensorContent(tensor);
+    int size = (int)(content.total() / sizeof(float));
     CV_Assert(size == (int)dstBlob.total());
 
     float *dstData = dstBlob.ptr<float>();
-    const float *data = reinterpret_cast<const float*>(tensor.tensor_content().c_str());
+    const float *data = reinterpret_cast<const float*>(content.data);
 
     int out_c = shape[0], input_c = shape[1], height = shape[2], width = shape[3];
     int total = out_c*input_c*height*width;
@@ -481,9 +578,195 @@ const tensorflow::TensorProto& TFImporter::getConstBlob(const tensorflow::NodeDe
 }
 
 
+// Returns values of float tensor in its own (not NCHW) layout as a single row.
+// Small tensors might keep values in float_val field, a single value
+// is broadcasted over the tensor's shape then.
+Mat TFImporter::tensorValues(const tensorflow::TensorProto &tensor, MatShape& shape) const
+{
+    CV_Assert(tensor.dtype() == tensorflow::DT_FLOAT);
+    blobShapeFromTensor(tensor, shape);
+    const int size = shape.empty() ? 1 : total(shape);
+
+    Mat values(1, size, CV_32F);
+    Mat content = getTensorContent(tensor);
+    if (!content.empty())
+    {
+        CV_Assert(content.total() == size * sizeof(float));
+        std::memcpy(values.data, content.data, content.total());
+    }
+    else if (tensor.float_val_size() == 1)
+        values.setTo(Scalar(tensor.float_val(0)));
+    else
+    {
+        CV_Assert(tensor.float_val_size() == size);
+        for (int i = 0; i < size; i++)
+            values.at<float>(i) = tensor.float_val(i);
+    }
+    return values;
+}
+
+// Replaces element-wise operations over constants by constants with
+// the computed values so they aren't computed at runtime. Operands must
+// have the same shape or one of them must be a scalar.
+void TFImporter::foldConstants()
+{
+    std::map<String, int> const_layers;
+    for (int li = 0; li < net.node_size(); li++)
+    {
+        tensorflow::NodeDef* layer = net.mutable_node(li);
+        String type = layer->op();
+        if (type == "Const")
+        {
+            if (layer->attr().find("value") != layer->attr().end())
+                const_layers[layer->name()] = li;
+            continue;
+        }
+        if ((type != "Add" && type != "Sub" && type != "Mul" && type != "RealDiv" &&
+             type != "Maximum" && type != "Minimum") || layer->input_size() != 2)
+            continue;
+
+        const tensorflow::TensorProto* tensors[2];
+        bool constInputs = true;
+        for (int i = 0; i < 2 && constInputs; i++)
+        {
+            Pin inp = parsePin(layer->input(i));
+            std::map<String, int>::iterator it = const_layers.find(inp.name);
+            constInputs = it != const_layers.end() && inp.blobIndex == 0;
+            if (constInputs)
+            {
+                tensors[i] = &net.node(it->second).attr().at("value").tensor();
+                constInputs = tensors[i]->dtype() == tensorflow::DT_FLOAT;
+            }
+        }
+        if (!constInputs)
+            continue;
+
+        MatShape shapeA, shapeB;
+        Mat a = tensorValues(*tensors[0], shapeA), b = tensorValues(*tensors[1], shapeB);
+        if (shapeA != shapeB && a.total() != 1 && b.total() != 1)
+            continue;  // Broadcasting over some dimensions isn't supported.
+
+        const tensorflow::TensorProto& resultTensor = a.total() >= b.total() ? *tensors[0] : *tensors[1];
+        if (a.total() < b.total())
+            a = Mat(b.size(), CV_32F, Scalar(a.at<float>(0)));
+        else if (b.total() < a.total())
+            b = Mat(a.size(), CV_32F, Scalar(b.at<float>(0)));
+
+        Mat result;
+        if (type == "Add")
+            add(a, b, result);
+        else if (type == "Sub")
+            subtract(a, b, result);
+        else if (type == "Mul")
+            multiply(a, b, result);
+        else if (type == "RealDiv")
+            divide(a, b, result);
+        else if (type == "Maximum")
+            cv::max(a, b, result);
+        else
+            cv::min(a, b, result);
+
+        tensorflow::TensorProto tensor;
+        tensor.set_dtype(tensorflow::DT_FLOAT);
+        *tensor.mutable_tensor_shape() = resultTensor.tensor_shape();
+        tensor.set_tensor_content(std::string((const char*)result.data, result.total() * sizeof(float)));
+
+        layer->set_op("Const");
+        layer->clear_input();
+        layer->mutable_attr()->clear();
+        (*layer->mutable_attr())["dtype"].set_type(tensorflow::DT_FLOAT);
+        (*layer->mutable_attr())["value"].mutable_tensor()->Swap(&tensor);
+        const_layers[layer->name()] = li;
+    }
+}
+
+// Merges the chain of BiasAdd, Add and Mul by constants which follows
+// the convolution or fully connected layer into its weights. Constants
+// must be scalars or have a value per output channel. Merged nodes are
+// added to <layers_to_ignore>.
+void TFImporter::mergeScaleShift(const tensorflow::NodeDef &layer, const std::map<String, int>& const_layers,
+                                 std::map<int, String>& layers_to_ignore, LayerParams& layerParams)
+{
+    const int numOutputs = layerParams.blobs[0].size[0];
+    for (;;)
+    {
+        // The only consumer of the layer which is not merged yet.
+        StrIntVector next_layers = getNextLayers(net, layer.name());
+        int next_index = -1;
+        for (size_t i = 0; i < next_layers.size(); i++)
+        {
+            if (layers_to_ignore.find(next_layers[i].second) != layers_to_ignore.end())
+                continue;
+            if (next_index != -1 && next_index != next_layers[i].second)
+                return;
+            next_index = next_layers[i].second;
+        }
+        if (next_index == -1)
+            return;
+
+        const tensorflow::NodeDef& next_layer = net.node(next_index);
+        String type = next_layer.op();
+        if ((type != "BiasAdd" && type != "Add" && type != "Mul") || next_layer.input_size() != 2)
+            return;
+
+        int const_index = -1;
+        for (int i = 0; i < 2; i++)
+        {
+            Pin inp = parsePin(next_layer.input(i));
+            if (inp.name != layer.name() && const_layers.find(inp.name) != const_layers.end())
+                const_index = i;
+        }
+        if (const_index == -1 || parsePin(next_layer.input(1 - const_index)).blobIndex != 0)
+            return;
+
+        const tensorflow::TensorProto& tensor =
+            net.node(const_layers.at(parsePin(next_layer.input(const_index)).name)).attr().at("value").tensor();
+        if (tensor.dtype() != tensorflow::DT_FLOAT)
+            return;
+        MatShape valuesShape;
+        Mat values = tensorValues(tensor, valuesShape);
+        if (values.total() == 1)
+            values = Mat(1, numOutputs, CV_32F, Scalar(values.at<float>(0)));
+        else if ((int)values.total() != numOutputs)
+            return;
+
+        // New matrices are created because weights might be mapped from a read-only file.
+        if (!layerParams.get<bool>("bias_term", false))
+        {
+            layerParams.set("bias_term", true);
+            layerParams.blobs.resize(2);
+            layerParams.blobs[1] = Mat::zeros(1, numOutputs, CV_32F);
+        }
+        Mat bias = layerParams.blobs[1].reshape(1, 1);
+        if (type == "Mul")
+        {
+            Mat& weights = layerParams.blobs[0];
+            Mat rows = weights.reshape(1, numOutputs);
+            Mat scaledRows(rows.size(), CV_32F);
+            for (int i = 0; i < numOutputs; i++)
+                rows.row(i).convertTo(scaledRows.row(i), CV_32F, values.at<float>(i));
+            weights = scaledRows.reshape(1, weights.dims, weights.size.p);
+
+            Mat scaledBias;
+            multiply(bias, values, scaledBias);
+            layerParams.blobs[1] = scaledBias;
+        }
+        else
+        {
+            Mat shiftedBias;
+            add(bias, values, shiftedBias);
+            layerParams.blobs[1] = shiftedBias;
+        }
+
+        ExcludeLayer(net, next_index, 1 - const_index, false);
+        layers_to_ignore[next_index] = next_layer.name();
+    }
+}
+
 void TFImporter::populateNet(Net dstNet)
 {
     RemoveIdentityOps(net);
+    foldConstants();
 
     std::map<int, String> layers_to_ignore;
 
@@ -525,19 +808,8 @@ void TFImporter::populateNet(Net dstNet)
             layerParams.set("bias_term", false);
             layerParams.blobs.resize(1);
 
-            StrIntVector next_layers = getNextLayers(net, name, "BiasAdd");
-            if (next_layers.size() == 1) {
-                layerParams.set("bias_term", true);
-                layerParams.blobs.resize(2);
-
-                int weights_layer_index = next_layers[0].second;
-
-                blobFromTensor(getConstBlob(net.node(weights_layer_index), value_id), layerParams.blobs[1]);
-                ExcludeLayer(net, weights_layer_index, 0, false);
-                layers_to_ignore[weights_layer_index] = next_layers[0].first;
-            }
-
             kernelFromTensor(getConstBlob(layer, value_id), layerParams.blobs[0]);
+            mergeScaleShift(layer, value_id, layers_to_ignore, layerParams);
             const int* kshape = layerParams.blobs[0].size.p;
             layerParams.set("kernel_h", kshape[2]);
             layerParams.set("kernel_w", kshape[3]);
@@ -577,17 +849,6 @@ void TFImporter::populateNet(Net dstNet)
             layerParams.set("bias_term", false);
             layerParams.blobs.resize(1);
 
-            StrIntVector next_layers = getNextLayers(net, name, "BiasAdd");
-            if (next_layers.size() == 1) {
-                layerParams.set("bias_term", true);
-                layerParams.blobs.resize(2);
-
-                int weights_layer_index = next_layers[0].second;
-                blobFromTensor(getConstBlob(net.node(weights_layer_index), value_id), layerParams.blobs[1]);
-                ExcludeLayer(net, weights_layer_index, 0, false);
-                layers_to_ignore[weights_layer_index] = next_layers[0].first;
-            }
-
             int kernel_blob_index = -1;
             blobFromTensor(getConstBlob(layer, value_id, -1, &kernel_blob_index), layerParams.blobs[0]);
 
@@ -595,6 +856,7 @@ void TFImporter::populateNet(Net dstNet)
                 Mat data = layerParams.blobs[0].t();
                 layerParams.blobs[0] = data.clone();
             }
+            mergeScaleShift(layer, value_id, layers_to_ignore, layerParams);
 
             layerParams.set("num_output", layerParams.blobs[0].size[0]);
 
@@ -734,14 +996,14 @@ void TFImporter::populateNet(Net dstNet)
 
 } // namespace
 
-Ptr<Importer> cv::dnn::createTensorflowImporter(const String &model)
+Ptr<Importer> cv::dnn::createTensorflowImporter(const String &model, bool mapWeights)
 {
-    return Ptr<Importer>(new TFImporter(model.c_str()));
+    return Ptr<Importer>(new TFImporter(model.c_str(), mapWeights));
 }
 
 #else //HAVE_PROTOBUF
 
-Ptr<Importer> cv::dnn::createTensorflowImporter(const String&)
+Ptr<Importer> cv::dnn::createTensorflowImporter(const String&, bool)
 {
     CV_Error(cv::Error::StsNotImplemented, "libprotobuf required to import data from TensorFlow models");
     return Ptr<Importer>();
@@ -749,9 +1011,9 @@ Ptr<Importer> cv::dnn::createTensorflowImporter(const String&)
 
 #endif //HAVE_PROTOBUF
 
-Net cv::dnn::readNetFromTensorflow(const String &model)
+Net cv::dnn::readNetFromTensorflow(const String &model, bool mapWeights)
 {
-    Ptr<Importer> importer = createTensorflowImporter(model);
+    Ptr<Importer> importer = createTensorflowImporter(model, mapWeights);
     Net net;
     if (importer)
         importer->populateNet(net);
@@ -52,12 +52,26 @@ bool ReadProtoFromBinaryFileTF(const char* filename, Message* proto) {
     return success;
 }
 
+bool ReadProtoFromBinaryBufferTF(const char* data, size_t len, Message* proto) {
+    ArrayInputStream raw_input(data, (int)len);
+    CodedInputStream coded_input(&raw_input);
+    coded_input.SetTotalBytesLimit(kProtoReadBytesLimit, 536870912);
+
+    return proto->ParseFromCodedStream(&coded_input);
+}
+
 void ReadTFNetParamsFromBinaryFileOrDie(const char* param_file,
                                       tensorflow::GraphDef* param) {
   CHECK(ReadProtoFromBinaryFileTF(param_file, param))
       << "Failed to parse GraphDef file: " << param_file;
 }
 
+void ReadTFNetParamsFromBinaryBufferOrDie(const char* data, size_t len,
+                                          tensorflow::GraphDef* param) {
+  CHECK(ReadProtoFromBinaryBufferTF(data, len, param))
+      << "Failed to parse GraphDef buffer";
+}
+
 }
 }
 #endif
@@ -14,9 +14,15 @@ typedef struct THDiskFile__
     char *name;
     int isNativeEncoding;
     int longSize;
+    char *buffer; /* stdio buffer of read-only files */
 
 } THDiskFile;
 
+/* Models are read by a lot of small reads (object headers, scalars), a large
+   buffer makes them served from memory. Bigger reads (storages) go directly
+   to the destination memory. */
+#define TH_DISK_FILE_READ_BUFFER_SIZE (1 << 20)
+
 static int THDiskFile_isOpened(THFile *self)
 {
   THDiskFile *dfself = (THDiskFile*)self;
@@ -324,6 +330,8 @@ static void THDiskFile_free(THFile *self)
   THDiskFile *dfself = (THDiskFile*)(self);
   if(dfself->handle)
     fclose(dfself->handle);
+  if(dfself->buffer)
+    THFree(dfself->buffer);
   THFree(dfself->name);
   THFree(dfself);
 }
@@ -680,6 +688,17 @@ THFile *THDiskFile_new(const char *name, const char *mode, int isQuiet)
   strcpy(self->name, name);
   self->isNativeEncoding = 1;
   self->longSize = 0;
+  self->buffer = NULL;
+
+  if(isReadable && !isWritable)
+  {
+    self->buffer = (char*)THAlloc(TH_DISK_FILE_READ_BUFFER_SIZE);
+    if(setvbuf(handle, self->buffer, _IOFBF, TH_DISK_FILE_READ_BUFFER_SIZE))
+    {
+      THFree(self->buffer);
+      self->buffer = NULL;
+    }
+  }
 
   self->file.vtable = &vtable;
   self->file.isQuiet = isQuiet;
@@ -782,6 +801,7 @@ THFile *THPipeFile_new(const char *name, const char *mode, int isQuiet)
   strcpy(self->name, name);
   self->isNativeEncoding = 1;
   self->longSize = 0;
+  self->buffer = NULL;
 
   self->file.vtable = &vtable;
   self->file.isQuiet = isQuiet;
@@ -398,8 +398,13 @@ struct TorchImporter : public ::cv::dnn::Importer
         Mat srcMat(ndims, (int*)isizes, typeTensor , storages[indexStorage].ptr() + offset*CV_ELEM_SIZE(typeTensor), (size_t*)ssteps);
         int dstType = CV_32F;
 
+        // Float storage read from file is used without copying if the tensor
+        // is its contiguous part. Tensors might share the storage memory.
         Mat blob;
-        srcMat.convertTo(blob, dstType);
+        if (typeTensor == dstType && srcMat.isContinuous())
+            blob = srcMat;
+        else
+            srcMat.convertTo(blob, dstType);
 
         tensors.insert(std::make_pair(indexTensor, blob));
     }
@@ -91,6 +91,17 @@ INSTANTIATE_TEST_CASE_P(Layer_Test_Halide, Convolution, Combine(
 /*has bias*/ Bool()
 ));
 
+INSTANTIATE_TEST_CASE_P(Layer_Test_Halide_Depthwise, Convolution, Combine(
+/*in channels, out channels, group*/
+             Values(Vec3i(8, 8, 8), Vec3i(6, 12, 6)),
+/*in size*/  Values(Size(9, 7)),
+/*kernel*/   Values(Size(3, 3), Size(5, 5)),
+/*stride*/   Values(Size(1, 1), Size(2, 2)),
+/*pad*/      Values(Size(1, 1), Size(2, 2)),
+/*dilation*/ Values(Size(1, 1)),
+/*has bias*/ Bool()
+));
+
 ////////////////////////////////////////////////////////////////////////////////
 // Deconvolution
 ////////////////////////////////////////////////////////////////////////////////
@@ -632,6 +643,65 @@ INSTANTIATE_TEST_CASE_P(Layer_Test_Halide, Eltwise, Combine(
 /*operation*/  Values("prod", "sum", "max"),
 /*num convs*/  Values(1, 2, 3)
 ));
+
+////////////////////////////////////////////////////////////////////////////////
+// Autotuning
+////////////////////////////////////////////////////////////////////////////////
+static Net buildConvReLUNet(const Mat& weights)
+{
+    LayerParams convParam;
+    convParam.set("kernel_size", 3);
+    convParam.set("pad", 1);
+    convParam.set("num_output", 16);
+    convParam.set("bias_term", false);
+    convParam.type = "Convolution";
+    convParam.name = "conv";
+    convParam.blobs.push_back(weights);
+
+    LayerParams reluParam;
+    reluParam.type = "ReLU";
+    reluParam.name = "relu";
+
+    Net net;
+    int convId = net.addLayer(convParam.name, convParam.type, convParam);
+    int reluId = net.addLayer(reluParam.name, reluParam.type, reluParam);
+    net.connect(0, 0, convId, 0);
+    net.connect(convId, 0, reluId, 0);
+    return net;
+}
+
+TEST(Layer_Test_Halide_Autotuning, Accuracy)
+{
+    const String cacheFile = cv::tempfile(".yml");
+    Mat input({1, 8, 20, 24}, CV_32F);
+    randu(input, -1.0f, 1.0f);
+    Mat weights({16, 8, 3, 3}, CV_32F);
+    randu(weights, -1.0f, 1.0f);
+
+    Net net = buildConvReLUNet(weights);
+    net.setBlob("", input);
+    Mat outputDefault = net.forward().clone();
+
+    net.setPreferableBackend(DNN_BACKEND_HALIDE);
+    net.enableHalideAutotuning(true, cacheFile);
+    Mat outputHalide = net.forward().clone();
+    normAssert(outputDefault, outputHalide);
+
+    {
+        FileStorage fs(cacheFile, FileStorage::READ);
+        ASSERT_TRUE(fs.isOpened());
+        ASSERT_EQ(fs["schedules"].size(), 1u);
+    }
+
+    // Schedules are loaded from the cache.
+    net = buildConvReLUNet(weights);
+    net.setBlob("", input);
+    net.setPreferableBackend(DNN_BACKEND_HALIDE);
+    net.enableHalideAutotuning(true, cacheFile);
+    outputHalide = net.forward().clone();
+    normAssert(outputDefault, outputHalide);
+    remove(cacheFile.c_str());
+}
 #endif  // HAVE_HALIDE
 
 }  // namespace cvtest
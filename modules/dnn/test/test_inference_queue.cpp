@@ -0,0 +1,72 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+#include <opencv2/dnn/shape_utils.hpp>
+
+namespace cvtest
+{
+
+#ifdef CV_CXX11
+using namespace cv;
+using namespace cv::dnn;
+
+static Net createReLUNet()
+{
+    LayerParams lp;
+    lp.name = "relu";
+    lp.type = "ReLU";
+
+    Net net;
+    int lid = net.addLayer(lp.name, lp.type, lp);
+    net.connect(0, 0, lid, 0);
+    return net;
+}
+
+TEST(InferenceQueue, SplitsBatchOutputs)
+{
+    const int numRequests = 13;
+    int sz[] = {1, 3, 5, 7};
+
+    std::vector<Mat> inputs(numRequests);
+    std::vector<std::future<Mat> > results(numRequests);
+    {
+        InferenceQueue queue(createReLUNet(), 4, 50.0);
+        for (int i = 0; i < numRequests; ++i)
+        {
+            inputs[i].create(4, sz, CV_32F);
+            randu(inputs[i], -1.0f, 1.0f);
+            results[i] = queue.push(inputs[i]);
+        }
+    }
+
+    for (int i = 0; i < numRequests; ++i)
+    {
+        Mat out = results[i].get();
+        ASSERT_EQ(shape(inputs[i]), shape(out));
+        normAssert(max(inputs[i], 0.0f), out);
+    }
+}
+
+TEST(InferenceQueue, DifferentShapes)
+{
+    int sz1[] = {1, 2, 3, 3};
+    int sz2[] = {1, 2, 4, 4};
+    Mat inp1(4, sz1, CV_32F), inp2(4, sz2, CV_32F);
+    randu(inp1, -1.0f, 1.0f);
+    randu(inp2, -1.0f, 1.0f);
+
+    InferenceQueue queue(createReLUNet(), 8, 10.0);
+    std::future<Mat> res1 = queue.push(inp1);
+    std::future<Mat> res2 = queue.push(inp2);
+
+    normAssert(max(inp1, 0.0f), res1.get());
+    normAssert(max(inp2, 0.0f), res2.get());
+
+    queue.stop();
+    EXPECT_ANY_THROW(queue.push(inp1));
+}
+#endif
+
+}
@@ -42,6 +42,8 @@
 #include "test_precomp.hpp"
 #include <opencv2/core/ocl.hpp>
 #include <iostream>
+#include <fstream>
+#include <iterator>
 #include "npy_blob.hpp"
 #include <opencv2/dnn/shape_utils.hpp>
 #include <opencv2/dnn/all_layers.hpp>
@@ -336,6 +338,51 @@ TEST_F(Layer_LSTM_Test, get_set_test)
     EXPECT_EQ(1, layer->outputNameToIndex("c"));
 }
 
+TEST(Layer_LSTM_Test_Accuracy, MultipleSamples)
+{
+    const int numTs = 4, numSamples = 3, numInp = 5, numOut = 7;
+    Mat Wh(4 * numOut, numOut, CV_32F), Wx(4 * numOut, numInp, CV_32F), b(1, 4 * numOut, CV_32F);
+    randu(Wh, -1., 1.);
+    randu(Wx, -1., 1.);
+    randu(b, -1., 1.);
+
+    Ptr<LSTMLayer> layer = LSTMLayer::create(LayerParams());
+    layer->setWeights(Wh, Wx, b);
+    layer->setProduceCellOutput(true);
+
+    int sz[] = {numTs, numSamples, numInp};
+    Mat inp(3, sz, CV_32F);
+    randu(inp, -1., 1.);
+    std::vector<Mat> inputs(1, inp), outputs;
+    runLayer(layer, inputs, outputs);
+    ASSERT_EQ(2u, outputs.size());
+
+    // Straightforward computation timestamp by timestamp.
+    Mat h = Mat::zeros(numSamples, numOut, CV_32F), c = h.clone();
+    Mat xTs = inp.reshape(1, numTs * numSamples);
+    Mat hOut = outputs[0].reshape(1, numTs * numSamples);
+    Mat cOut = outputs[1].reshape(1, numTs * numSamples);
+    for (int ts = 0; ts < numTs; ++ts)
+    {
+        Range rows(ts * numSamples, (ts + 1) * numSamples);
+        Mat gates = xTs.rowRange(rows) * Wx.t() + h * Wh.t() + repeat(b, numSamples, 1);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            for (int j = 0; j < numOut; ++j)
+            {
+                float gi = 1.f / (1.f + std::exp(-gates.at<float>(i, j)));
+                float gf = 1.f / (1.f + std::exp(-gates.at<float>(i, numOut + j)));
+                float go = 1.f / (1.f + std::exp(-gates.at<float>(i, 2 * numOut + j)));
+                float gg = std::tanh(gates.at<float>(i, 3 * numOut + j));
+                c.at<float>(i, j) = gf * c.at<float>(i, j) + gi * gg;
+                h.at<float>(i, j) = go * std::tanh(c.at<float>(i, j));
+            }
+        }
+        normAssert(h, hOut.rowRange(rows), "h");
+        normAssert(c, cOut.rowRange(rows), "c");
+    }
+}
+
 TEST(Layer_LSTM_Test_Accuracy_with_, CaffeRecurrent)
 {
     Ptr<LSTMLayer> layer = LSTMLayer::create(LayerParams());
@@ -414,4 +461,702 @@ TEST_F(Layer_RNN_Test, get_set_test)
     EXPECT_EQ(shape(outputs[1]), shape(nT, nS, nH));
 }
 
+TEST(Net_Test_MemoryPlanning, Accuracy)
+{
+    // Chain of pooling layers which can't be computed in-place.
+    Net net;
+    std::vector<String> names;
+    int prevId = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        LayerParams lp;
+        lp.set("pool", "ave");
+        lp.set("kernel_size", 3);
+        lp.set("stride", 1);
+        lp.set("pad", 1);
+        lp.name = format("pool_%d", i);
+        lp.type = "Pooling";
+        int id = net.addLayer(lp.name, lp.type, lp);
+        net.connect(prevId, 0, id, 0);
+        prevId = id;
+        names.push_back(lp.name);
+    }
+
+    int sz[] = {2, 3, 8, 8};
+    Mat input(4, sz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    size_t weights, blobs;
+    std::vector<int> layerIds;
+    std::vector<size_t> layersWeights, layersBlobs;
+    net.getMemoryConsumption(shape(input), weights, blobs);
+    net.getMemoryConsumption(shape(input), layerIds, layersWeights, layersBlobs);
+
+    // Input blob and two buffers which are used in turn.
+    const size_t blobSize = input.total() * sizeof(float);
+    EXPECT_EQ(3 * blobSize, blobs);
+    size_t blobsSum = 0;
+    for (size_t i = 0; i < layersBlobs.size(); i++)
+        blobsSum += layersBlobs[i];
+    EXPECT_LT(blobs, blobsSum);
+
+    // Keep all the blobs to get reference output.
+    net.setInput(input);
+    std::vector<Mat> outs;
+    net.forward(outs, names);
+    Mat ref = outs.back().clone();
+
+    net.setInput(input);
+    Mat out = net.forward();
+    normAssert(ref, out);
+}
+
+typedef testing::TestWithParam<testing::tuple<int, Size> > Layer_Test_Convolution_Winograd;
+TEST_P(Layer_Test_Convolution_Winograd, Accuracy)
+{
+    int pad = testing::get<0>(GetParam());
+    Size inpSize = testing::get<1>(GetParam());
+    int inpCn = 17, outCn = 19;
+
+    int wsz[] = {outCn, inpCn, 3, 3};
+    int bsz[] = {outCn, 1, 1, 1};
+    int isz[] = {2, inpCn, inpSize.height, inpSize.width};
+    Mat weights(4, wsz, CV_32F), bias(4, bsz, CV_32F), input(4, isz, CV_32F);
+    randu(weights, -1.0f, 1.0f);
+    randu(bias, -1.0f, 1.0f);
+    randu(input, -1.0f, 1.0f);
+
+    LayerParams lp;
+    lp.set("num_output", outCn);
+    lp.set("kernel_size", 3);
+    lp.set("pad", pad);
+    lp.blobs.push_back(weights);
+    lp.blobs.push_back(bias);
+
+    std::vector<Mat> inpVec(1, input), outWinograd, outRef;
+    lp.set("winograd", true);
+    runLayer(LayerFactory::createLayerInstance("Convolution", lp), inpVec, outWinograd);
+    lp.set("winograd", false);
+    runLayer(LayerFactory::createLayerInstance("Convolution", lp), inpVec, outRef);
+
+    normAssert(outRef[0], outWinograd[0], "", 1e-5, 1e-4);
+}
+
+INSTANTIATE_TEST_CASE_P(/**/, Layer_Test_Convolution_Winograd, testing::Combine(
+    testing::Values(0, 1),
+    testing::Values(Size(8, 8), Size(13, 9), Size(33, 30))
+));
+
+TEST(Net_Test_Int8, Accuracy)
+{
+    RNG& rng = theRNG();
+    int inpCn = 8, outCn = 16, fcOutputs = 10;
+    int wsz[] = {outCn, inpCn, 3, 3};
+    int isz[] = {1, inpCn, 12, 12};
+
+    LayerParams convParams;
+    convParams.name = "conv";
+    convParams.type = "Convolution";
+    convParams.set("num_output", outCn);
+    convParams.set("kernel_size", 3);
+    convParams.set("pad", 1);
+    convParams.blobs.push_back(Mat(4, wsz, CV_32F));
+    convParams.blobs.push_back(Mat(1, outCn, CV_32F));
+    rng.fill(convParams.blobs[0], RNG::UNIFORM, -1, 1);
+    rng.fill(convParams.blobs[1], RNG::UNIFORM, -1, 1);
+
+    LayerParams reluParams;
+    reluParams.name = "relu";
+    reluParams.type = "ReLU";
+
+    LayerParams fcParams;
+    fcParams.name = "fc";
+    fcParams.type = "InnerProduct";
+    fcParams.set("num_output", fcOutputs);
+    fcParams.blobs.push_back(Mat(fcOutputs, outCn * isz[2] * isz[3], CV_32F));
+    fcParams.blobs.push_back(Mat(1, fcOutputs, CV_32F));
+    rng.fill(fcParams.blobs[0], RNG::UNIFORM, -0.1, 0.1);
+    rng.fill(fcParams.blobs[1], RNG::UNIFORM, -1, 1);
+
+    Net net;
+    int convId = net.addLayer(convParams.name, convParams.type, convParams);
+    int reluId = net.addLayer(reluParams.name, reluParams.type, reluParams);
+    int fcId = net.addLayer(fcParams.name, fcParams.type, fcParams);
+    net.connect(0, 0, convId, 0);
+    net.connect(convId, 0, reluId, 0);
+    net.connect(reluId, 0, fcId, 0);
+
+    std::vector<Mat> calibration(4);
+    for (size_t i = 0; i < calibration.size(); i++)
+    {
+        calibration[i].create(4, isz, CV_32F);
+        rng.fill(calibration[i], RNG::UNIFORM, -1, 1);
+    }
+
+    Mat input(4, isz, CV_32F);
+    rng.fill(input, RNG::UNIFORM, -1, 1);
+
+    net.setInput(input);
+    Mat ref = net.forward().clone();
+
+    net.enableInt8(calibration);
+    net.setInput(input);
+    Mat out = net.forward();
+
+    ASSERT_EQ(shape(ref), shape(out));
+    EXPECT_LE(cvtest::norm(ref, out, NORM_INF), 0.05 * cvtest::norm(ref, NORM_INF));
+}
+
+
+static Net buildConvBNScaleReLUNet(bool winograd)
+{
+    RNG rng(0x1234);
+    int inpCn = 16, outCn = 16;
+    int wsz[] = {outCn, inpCn, 3, 3};
+
+    LayerParams convParams;
+    convParams.name = "conv";
+    convParams.type = "Convolution";
+    convParams.set("num_output", outCn);
+    convParams.set("kernel_size", 3);
+    convParams.set("pad", 1);
+    convParams.set("bias_term", false);
+    convParams.set("winograd", winograd);
+    convParams.blobs.push_back(Mat(4, wsz, CV_32F));
+    rng.fill(convParams.blobs[0], RNG::UNIFORM, -1, 1);
+
+    LayerParams bnParams;
+    bnParams.name = "bn";
+    bnParams.type = "BatchNorm";
+    bnParams.blobs.push_back(Mat(1, outCn, CV_32F));
+    bnParams.blobs.push_back(Mat(1, outCn, CV_32F));
+    bnParams.blobs.push_back(Mat(1, 1, CV_32F, Scalar(2)));
+    rng.fill(bnParams.blobs[0], RNG::UNIFORM, -1, 1);
+    rng.fill(bnParams.blobs[1], RNG::UNIFORM, 0.5, 2);
+
+    LayerParams scaleParams;
+    scaleParams.name = "scale";
+    scaleParams.type = "Scale";
+    scaleParams.set("bias_term", true);
+    scaleParams.blobs.push_back(Mat(1, outCn, CV_32F));
+    scaleParams.blobs.push_back(Mat(1, outCn, CV_32F));
+    rng.fill(scaleParams.blobs[0], RNG::UNIFORM, -1, 1);
+    rng.fill(scaleParams.blobs[1], RNG::UNIFORM, -1, 1);
+
+    LayerParams reluParams;
+    reluParams.name = "relu";
+    reluParams.type = "ReLU";
+
+    Net net;
+    int convId = net.addLayer(convParams.name, convParams.type, convParams);
+    int bnId = net.addLayer(bnParams.name, bnParams.type, bnParams);
+    int scaleId = net.addLayer(scaleParams.name, scaleParams.type, scaleParams);
+    int reluId = net.addLayer(reluParams.name, reluParams.type, reluParams);
+    net.connect(0, 0, convId, 0);
+    net.connect(convId, 0, bnId, 0);
+    net.connect(bnId, 0, scaleId, 0);
+    net.connect(scaleId, 0, reluId, 0);
+    return net;
+}
+
+TEST(Net_Test_Fusion, ConvBatchNormScaleReLU)
+{
+    int isz[] = {2, 16, 10, 10};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    for (int winograd = 0; winograd < 2; winograd++)
+    {
+        Net ref = buildConvBNScaleReLUNet(winograd != 0);
+        ref.enableFusion(false);
+        ref.setInput(input);
+        Mat refOut = ref.forward().clone();
+
+        Net net = buildConvBNScaleReLUNet(winograd != 0);
+        net.setInput(input);
+        Mat out = net.forward();
+
+        normAssert(refOut, out, winograd ? "Winograd" : "", 1e-4, 1e-3);
+    }
+}
+
+static Net buildEltwiseScaleReLUNet(const String& operation)
+{
+    RNG rng(0x1234);
+    const int inpCn = 3, outCn = 4;
+
+    Net net;
+    int convIds[2];
+    for (int i = 0; i < 2; i++)
+    {
+        int wsz[] = {outCn, inpCn, 1, 1};
+        LayerParams convParams;
+        convParams.name = format("conv%d", i);
+        convParams.type = "Convolution";
+        convParams.set("num_output", outCn);
+        convParams.set("kernel_size", 1);
+        convParams.set("bias_term", false);
+        convParams.blobs.push_back(Mat(4, wsz, CV_32F));
+        rng.fill(convParams.blobs[0], RNG::UNIFORM, -1, 1);
+        convIds[i] = net.addLayer(convParams.name, convParams.type, convParams);
+        net.connect(0, 0, convIds[i], 0);
+    }
+
+    LayerParams eltwiseParams;
+    eltwiseParams.name = "eltwise";
+    eltwiseParams.type = "Eltwise";
+    eltwiseParams.set("operation", operation);
+
+    LayerParams scaleParams;
+    scaleParams.name = "scale";
+    scaleParams.type = "Scale";
+    scaleParams.set("bias_term", true);
+    scaleParams.blobs.push_back(Mat(1, outCn, CV_32F));
+    scaleParams.blobs.push_back(Mat(1, outCn, CV_32F));
+    rng.fill(scaleParams.blobs[0], RNG::UNIFORM, -1, 1);
+    rng.fill(scaleParams.blobs[1], RNG::UNIFORM, -1, 1);
+
+    LayerParams reluParams;
+    reluParams.name = "relu";
+    reluParams.type = "ReLU";
+    reluParams.set("negative_slope", 0.1f);
+
+    int eltwiseId = net.addLayer(eltwiseParams.name, eltwiseParams.type, eltwiseParams);
+    int scaleId = net.addLayer(scaleParams.name, scaleParams.type, scaleParams);
+    int reluId = net.addLayer(reluParams.name, reluParams.type, reluParams);
+    net.connect(convIds[0], 0, eltwiseId, 0);
+    net.connect(convIds[1], 0, eltwiseId, 1);
+    net.connect(eltwiseId, 0, scaleId, 0);
+    net.connect(scaleId, 0, reluId, 0);
+    return net;
+}
+
+TEST(Net_Test_Fusion, EltwiseScaleReLU)
+{
+    // Odd plane size checks the tails of vectorized loops.
+    int isz[] = {2, 3, 7, 9};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    const char* operations[] = {"sum", "prod", "max"};
+    for (int i = 0; i < 3; i++)
+    {
+        Net ref = buildEltwiseScaleReLUNet(operations[i]);
+        ref.enableFusion(false);
+        ref.setInput(input);
+        Mat refOut = ref.forward().clone();
+
+        Net net = buildEltwiseScaleReLUNet(operations[i]);
+        net.setInput(input);
+        Mat out = net.forward();
+
+        normAssert(refOut, out, operations[i]);
+    }
+}
+
+// Depthwise convolution is compared with the regular one with the same
+// weights placed on the diagonal of dense weights.
+typedef testing::TestWithParam<testing::tuple<int, int, int> > Layer_Test_DepthwiseConvolution;
+TEST_P(Layer_Test_DepthwiseConvolution, Accuracy)
+{
+    int ksize = testing::get<0>(GetParam());
+    int stride = testing::get<1>(GetParam());
+    int pad = testing::get<2>(GetParam());
+    const int channels = 6;
+
+    int wsz[] = {channels, 1, ksize, ksize};
+    int dsz[] = {channels, channels, ksize, ksize};
+    Mat weights(4, wsz, CV_32F), denseWeights(4, dsz, CV_32F, Scalar(0));
+    Mat bias(1, channels, CV_32F);
+    randu(weights, -1.0f, 1.0f);
+    randu(bias, -1.0f, 1.0f);
+    for (int c = 0; c < channels; c++)
+    {
+        Mat src(ksize, ksize, CV_32F, weights.ptr<float>(c));
+        Mat dst(ksize, ksize, CV_32F, denseWeights.ptr<float>(c, c));
+        src.copyTo(dst);
+    }
+
+    LayerParams lp;
+    lp.set("num_output", channels);
+    lp.set("kernel_size", ksize);
+    lp.set("stride", stride);
+    lp.set("pad", pad);
+    lp.set("bias_term", true);
+
+    LayerParams depthwiseParams = lp;
+    depthwiseParams.set("group", channels);
+    depthwiseParams.blobs.push_back(weights);
+    depthwiseParams.blobs.push_back(bias);
+
+    LayerParams denseParams = lp;
+    denseParams.blobs.push_back(denseWeights);
+    denseParams.blobs.push_back(bias);
+
+    int isz[] = {2, channels, 11, 13};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    Ptr<Layer> depthwise = LayerFactory::createLayerInstance("Convolution", depthwiseParams);
+    Ptr<Layer> dense = LayerFactory::createLayerInstance("Convolution", denseParams);
+    std::vector<Mat> inputs(1, input), outputs, refOutputs;
+    runLayer(depthwise, inputs, outputs);
+    runLayer(dense, inputs, refOutputs);
+    normAssert(refOutputs[0], outputs[0], "", 1e-5, 1e-4);
+}
+
+INSTANTIATE_TEST_CASE_P(/**/, Layer_Test_DepthwiseConvolution, testing::Combine(
+/*kernel*/  testing::Values(3, 5),
+/*stride*/  testing::Values(1, 2),
+/*pad*/     testing::Values(0, 1, 2)
+));
+
+TEST(Net_Test_Clone, SharedWeights)
+{
+    int isz[] = {1, 16, 10, 10};
+    Mat input1(4, isz, CV_32F), input2(4, isz, CV_32F);
+    randu(input1, -1.0f, 1.0f);
+    randu(input2, -1.0f, 1.0f);
+
+    Net net = buildConvBNScaleReLUNet(true);
+    net.setInput(input1);
+    Mat ref1 = net.forward().clone();
+    net.setInput(input2);
+    Mat ref2 = net.forward().clone();
+
+    // Clone after the forward pass to share fused weights.
+    Net copy = net.clone();
+    EXPECT_EQ(net.getParam("conv").data, copy.getParam("conv").data);
+
+    copy.setInput(input2);
+    net.setInput(input1);
+    Mat out2 = copy.forward();
+    Mat out1 = net.forward();
+    EXPECT_NE(out1.data, out2.data);
+    normAssert(ref1, out1, "original");
+    normAssert(ref2, out2, "copy");
+}
+
+TEST(Net_Test_PerfProfile, Timings)
+{
+    int isz[] = {2, 16, 10, 10};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    Net net = buildConvBNScaleReLUNet(false);
+    net.setInput(input);
+    net.forward();
+
+    std::vector<double> timings;
+    int64 total = net.getPerfProfile(timings);
+    ASSERT_EQ(net.getLayerNames().size() + 1, timings.size());
+    EXPECT_EQ(0, timings[0]);
+    EXPECT_GT(timings[net.getLayerId("conv")], 0);
+    // Batch normalization is fused into convolution.
+    EXPECT_EQ(0, timings[net.getLayerId("bn")]);
+
+    double sum = 0;
+    for (size_t i = 0; i < timings.size(); i++)
+        sum += timings[i];
+    EXPECT_EQ((double)total, sum);
+
+    String path = cv::tempfile(".json");
+    net.writePerfTrace(path);
+    std::ifstream trace(path.c_str());
+    std::string content((std::istreambuf_iterator<char>(trace)), std::istreambuf_iterator<char>());
+    trace.close();
+    remove(path.c_str());
+    EXPECT_NE(std::string::npos, content.find("\"traceEvents\""));
+    EXPECT_NE(std::string::npos, content.find("\"name\":\"conv\",\"cat\":\"Convolution\""));
+}
+
+static Net buildConvPoolLRNSoftmaxNet()
+{
+    RNG rng(0x4321);
+    int wsz[] = {8, 3, 3, 3};
+
+    LayerParams convParams;
+    convParams.name = "conv";
+    convParams.type = "Convolution";
+    convParams.set("num_output", 8);
+    convParams.set("kernel_size", 3);
+    convParams.set("pad", 1);
+    convParams.set("bias_term", true);
+    convParams.blobs.push_back(Mat(4, wsz, CV_32F));
+    convParams.blobs.push_back(Mat(1, 8, CV_32F));
+    rng.fill(convParams.blobs[0], RNG::UNIFORM, -1, 1);
+    rng.fill(convParams.blobs[1], RNG::UNIFORM, -1, 1);
+
+    LayerParams reluParams;
+    reluParams.name = "relu";
+    reluParams.type = "ReLU";
+
+    LayerParams poolParams;
+    poolParams.name = "pool";
+    poolParams.type = "Pooling";
+    poolParams.set("pool", "max");
+    poolParams.set("kernel_size", 2);
+    poolParams.set("stride", 2);
+
+    LayerParams lrnParams;
+    lrnParams.name = "lrn";
+    lrnParams.type = "LRN";
+    lrnParams.set("local_size", 3);
+    lrnParams.set("alpha", 0.5);
+
+    LayerParams softmaxParams;
+    softmaxParams.name = "softmax";
+    softmaxParams.type = "Softmax";
+
+    Net net;
+    int convId = net.addLayer(convParams.name, convParams.type, convParams);
+    int reluId = net.addLayer(reluParams.name, reluParams.type, reluParams);
+    int poolId = net.addLayer(poolParams.name, poolParams.type, poolParams);
+    int lrnId = net.addLayer(lrnParams.name, lrnParams.type, lrnParams);
+    int softmaxId = net.addLayer(softmaxParams.name, softmaxParams.type, softmaxParams);
+    net.connect(0, 0, convId, 0);
+    net.connect(convId, 0, reluId, 0);
+    net.connect(reluId, 0, poolId, 0);
+    net.connect(poolId, 0, lrnId, 0);
+    net.connect(lrnId, 0, softmaxId, 0);
+    return net;
+}
+
+TEST(Net_Test_OpenCL, ConvPoolLRNSoftmax)
+{
+    if (!cv::ocl::useOpenCL())
+        return;
+
+    int isz[] = {2, 3, 12, 14};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    Net ref = buildConvPoolLRNSoftmaxNet();
+    ref.setInput(input);
+    Mat refPool = ref.forward("pool").clone();
+    Mat refOut = ref.forward().clone();
+
+    Net net = buildConvPoolLRNSoftmaxNet();
+    net.setPreferableBackend(DNN_BACKEND_OPENCL);
+    net.setInput(input);
+    // Intermediate blobs are downloaded on request.
+    normAssert(refPool, net.forward("pool"), "pool", 1e-5, 1e-4);
+
+    std::vector<Mat> outs;
+    net.forward(outs, "softmax");
+    ASSERT_EQ(1u, outs.size());
+    normAssert(refOut, outs[0], "softmax", 1e-5, 1e-4);
+}
+
+TEST(Net_Test_Reshape, CachedPlans)
+{
+    int smallSize[] = {1, 16, 8, 10}, largeSize[] = {2, 16, 12, 14};
+    Mat smallInp(4, smallSize, CV_32F), largeInp(4, largeSize, CV_32F);
+    randu(smallInp, -1.0f, 1.0f);
+    randu(largeInp, -1.0f, 1.0f);
+
+    Net refNet = buildConvBNScaleReLUNet(false);
+    refNet.setInput(smallInp);
+    Mat smallRef = refNet.forward().clone();
+    refNet.setInput(largeInp);
+    Mat largeRef = refNet.forward().clone();
+
+    Net net = buildConvBNScaleReLUNet(false);
+    std::vector<uchar*> smallData, largeData;
+    for (int i = 0; i < 3; i++)
+    {
+        net.setInput(smallInp);
+        Mat smallOut = net.forward();
+        normAssert(smallRef, smallOut, "small");
+        smallData.push_back(smallOut.data);
+
+        net.setInput(largeInp);
+        Mat largeOut = net.forward();
+        normAssert(largeRef, largeOut, "large");
+        largeData.push_back(largeOut.data);
+    }
+    // Memory isn't reallocated after the first switch to the largest input.
+    EXPECT_EQ(smallData[1], smallData[2]);
+    EXPECT_EQ(largeData[0], largeData[1]);
+    EXPECT_EQ(largeData[1], largeData[2]);
+}
+
+// Depthwise convolution, convolution and fully connected layer.
+static Net buildConvFCNet()
+{
+    RNG rng(0x4321);
+    int dwsz[] = {8, 1, 3, 3}, wsz[] = {16, 8, 3, 3}, fcsz[] = {10, 16*6*7};
+    Mat dwWeights(4, dwsz, CV_32F), weights(4, wsz, CV_32F), fcWeights(2, fcsz, CV_32F);
+    Mat bias(1, 16, CV_32F), fcBias(1, 10, CV_32F);
+    rng.fill(dwWeights, RNG::UNIFORM, -1, 1);
+    rng.fill(weights, RNG::UNIFORM, -1, 1);
+    rng.fill(fcWeights, RNG::UNIFORM, -0.1, 0.1);
+    rng.fill(bias, RNG::UNIFORM, -1, 1);
+    rng.fill(fcBias, RNG::UNIFORM, -1, 1);
+
+    LayerParams dwParams;
+    dwParams.name = "dwconv";
+    dwParams.type = "Convolution";
+    dwParams.set("kernel_size", 3);
+    dwParams.set("pad", 1);
+    dwParams.set("group", 8);
+    dwParams.set("num_output", 8);
+    dwParams.set("bias_term", false);
+    dwParams.blobs.push_back(dwWeights);
+
+    LayerParams convParams;
+    convParams.name = "conv";
+    convParams.type = "Convolution";
+    convParams.set("kernel_size", 3);
+    convParams.set("pad", 1);
+    convParams.set("num_output", 16);
+    convParams.blobs.push_back(weights);
+    convParams.blobs.push_back(bias);
+
+    LayerParams fcParams;
+    fcParams.name = "fc";
+    fcParams.type = "InnerProduct";
+    fcParams.set("num_output", 10);
+    fcParams.blobs.push_back(fcWeights);
+    fcParams.blobs.push_back(fcBias);
+
+    Net net;
+    int dwId = net.addLayer(dwParams.name, dwParams.type, dwParams);
+    int convId = net.addLayer(convParams.name, convParams.type, convParams);
+    int fcId = net.addLayer(fcParams.name, fcParams.type, fcParams);
+    net.connect(0, 0, dwId, 0);
+    net.connect(dwId, 0, convId, 0);
+    net.connect(convId, 0, fcId, 0);
+    return net;
+}
+
+TEST(Net_Test_FP16, ConvFC)
+{
+    int isz[] = {2, 8, 6, 7};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    Net net = buildConvFCNet();
+    net.setInput(input);
+    Mat refConv = net.forward("conv").clone();
+    Mat ref = net.forward().clone();
+
+    net.enableFP16();
+    Mat outConv = net.forward("conv").clone();
+    Mat out = net.forward();
+    EXPECT_EQ(CV_16S, net.getParam("conv").type());
+    EXPECT_EQ(CV_16S, net.getParam("fc").type());
+    normAssert(refConv, outConv, "conv", 1e-2, 5e-2);
+    normAssert(ref, out, "fc", 1e-2, 5e-2);
+
+    // Weights are converted once.
+    net.setInput(input.rowRange(0, 1));
+    normAssert(ref.rowRange(0, 1), net.forward(), "single sample", 1e-2, 5e-2);
+}
+
+// Three branches are concatenated: 1x1 convolution with ReLU,
+// 3x3 convolution and max pooling.
+static Net buildBranchesNet()
+{
+    Net net;
+    std::vector<int> branches;
+    for (int ksize = 1; ksize <= 3; ksize += 2)
+    {
+        int wsz[] = {8, 4, ksize, ksize};
+        Mat weights(4, wsz, CV_32F);
+        randu(weights, -1.0f, 1.0f);
+
+        LayerParams lp;
+        lp.name = format("conv%d", ksize);
+        lp.type = "Convolution";
+        lp.set("kernel_size", ksize);
+        lp.set("pad", ksize / 2);
+        lp.set("num_output", 8);
+        lp.set("bias_term", false);
+        lp.blobs.push_back(weights);
+        int convId = net.addLayer(lp.name, lp.type, lp);
+        net.connect(0, 0, convId, 0);
+        branches.push_back(convId);
+    }
+
+    LayerParams reluParams;
+    reluParams.name = "relu";
+    reluParams.type = "ReLU";
+    int reluId = net.addLayer(reluParams.name, reluParams.type, reluParams);
+    net.connect(branches[0], 0, reluId, 0);
+    branches[0] = reluId;
+
+    LayerParams poolParams;
+    poolParams.name = "pool";
+    poolParams.type = "Pooling";
+    poolParams.set("pool", "max");
+    poolParams.set("kernel_size", 3);
+    poolParams.set("stride", 1);
+    poolParams.set("pad", 1);
+    int poolId = net.addLayer(poolParams.name, poolParams.type, poolParams);
+    net.connect(0, 0, poolId, 0);
+    branches.push_back(poolId);
+
+    LayerParams concatParams;
+    concatParams.name = "concat";
+    concatParams.type = "Concat";
+    int concatId = net.addLayer(concatParams.name, concatParams.type, concatParams);
+    for (size_t i = 0; i < branches.size(); i++)
+        net.connect(branches[i], 0, concatId, (int)i);
+    return net;
+}
+
+// Branches write their outputs right into the concatenation buffer if
+// the batch size is 1. Result must be the same as concatenation of the
+// kept branches outputs which are computed in separate buffers.
+TEST(Net_Test_Concat, InPlaceBranches)
+{
+    int isz[] = {1, 4, 15, 17};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    Net net = buildBranchesNet();
+    net.setInput(input);
+
+    std::vector<String> branchNames;
+    branchNames.push_back("relu");
+    branchNames.push_back("conv3");
+    branchNames.push_back("pool");
+    std::vector<Mat> branches;
+    net.forward(branches, branchNames);
+
+    std::vector<Mat> rows(branches.size());
+    for (size_t i = 0; i < branches.size(); i++)
+        rows[i] = branches[i].reshape(1, branches[i].size[1]);
+    Mat ref;
+    vconcat(rows, ref);
+
+    Mat out = net.forward();
+    ASSERT_EQ(ref.total(), out.total());
+    normAssert(ref, out.reshape(1, ref.rows), "concat");
+}
+
+#ifdef CV_CXX11
+TEST(Net_Test_ForwardAsync, Branches)
+{
+    int isz[] = {2, 4, 15, 17};
+    Mat input(4, isz, CV_32F);
+    randu(input, -1.0f, 1.0f);
+
+    Net net = buildBranchesNet();
+    net.setInput(input);
+    Mat ref = net.forward().clone();
+    Mat refConv = net.forward("conv3").clone();
+
+    for (int i = 0; i < 3; i++)
+    {
+        std::future<Mat> out = net.forwardAsync();
+        normAssert(ref, out.get(), "concat");
+    }
+    normAssert(refConv, net.forwardAsync("conv3").get(), "conv3");
+
+    // Sequential forward pass works with memory planned for concurrent one.
+    normAssert(ref, net.forward(), "sequential");
+}
+#endif
 }
@@ -71,4 +71,23 @@ TEST(Test_TensorFlow, inception_accuracy)
     normAssert(ref, out);
 }
 
+TEST(Test_TensorFlow, inception_mapped_weights)
+{
+    const string model = findDataFile("dnn/tensorflow_inception_graph.pb", false);
+    Net net = readNetFromTensorflow(model, true);
+    ASSERT_FALSE(net.empty());
+
+    Mat sample = imread(_tf("grace_hopper_227.png"));
+    ASSERT_TRUE(!sample.empty());
+    resize(sample, sample, Size(224, 224));
+    Mat inputBlob = blobFromImage(sample, 1.);
+
+    net.setInput(inputBlob, "input");
+    Mat out = net.forward("softmax2");
+
+    Mat ref = blobFromNPY(_tf("tf_inception_prob.npy"));
+
+    normAssert(ref, out);
+}
+
 }
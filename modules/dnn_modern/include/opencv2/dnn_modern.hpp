@@ -73,6 +73,16 @@ public:
     @param results output form model.
     */
     CV_WRAP virtual void eval(InputArray image, std::vector<float>& results) = 0;
+
+    /**
+    @brief Evaluates the model on a batch of inputs.
+
+    The images are preprocessed in parallel and passed to the network at once, the network spreads
+    the samples over its worker threads. This is faster than calling eval() for each image.
+    @param images input images.
+    @param results output of the model, one CV_32F row per image.
+    */
+    CV_WRAP virtual void evalBatch(InputArrayOfArrays images, OutputArray results) = 0;
 };
 
 /** @brief Class implementing the CaffeConverter.
@@ -96,6 +106,8 @@ class CV_EXPORTS_W CaffeConverter : public BaseConverter {
                                               const String& mean_file = String());
 
     CV_WRAP virtual void eval(InputArray image, CV_OUT std::vector<float>& results) = 0;
+
+    CV_WRAP virtual void evalBatch(InputArrayOfArrays images, OutputArray results) = 0;
 };
 
 //! @}
@@ -40,10 +40,10 @@
   and on any theory of liability, whether in contract, strict liability,
   or tort (including negligence or otherwise) arising in any way out of
   the use of this software, even if advised of the possibility of such damage.
- */
 
 #include "precomp.hpp"
 #include <opencv2/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 
 #include <tiny_dnn/tiny_dnn.h>
 #include <tiny_dnn/io/caffe/caffe.pb.cc>
@@ -55,6 +55,75 @@ using namespace std;
 namespace cv {
 namespace dnn2 {
 
+#if CV_SIMD128
+// converts 16 pixels of one channel and subtracts the mean
+static inline void normalize16(const v_uint8x16& src, const v_float32x4& mean,
+                               float* dst) {
+    v_uint16x8 lo, hi;
+    v_expand(src, lo, hi);
+    v_uint32x4 a, b, c, d;
+    v_expand(lo, a, b);
+    v_expand(hi, c, d);
+    v_store(dst,      v_cvt_f32(v_reinterpret_as_s32(a)) - mean);
+    v_store(dst + 4,  v_cvt_f32(v_reinterpret_as_s32(b)) - mean);
+    v_store(dst + 8,  v_cvt_f32(v_reinterpret_as_s32(c)) - mean);
+    v_store(dst + 12, v_cvt_f32(v_reinterpret_as_s32(d)) - mean);
+}
+#endif
+
+/*
+ Converts an interleaved image to planar float data and subtracts the mean
+ of each channel. dst holds src.channels() planes of src.total() values.
+ */
+static void normalizeToPlanes(const Mat& src, const Scalar& mean, float* dst) {
+    const int cn = src.channels();
+    const size_t plane = src.total();
+
+    if (src.depth() != CV_8U || (cn != 1 && cn != 3)) {
+        Mat sample_float;
+        src.convertTo(sample_float, CV_MAKETYPE(CV_32F, cn));
+        subtract(sample_float, mean, sample_float);
+
+        vector<Mat> planes;
+        for (int c = 0; c < cn; c++) {
+            planes.emplace_back(src.rows, src.cols, CV_32FC1, dst + plane * c);
+        }
+        split(sample_float, planes);
+        return;
+    }
+
+    const float m[3] = { (float)mean[0], (float)mean[1], (float)mean[2] };
+
+    for (int y = 0; y < src.rows; y++) {
+        const uchar* s = src.ptr<uchar>(y);
+        float* d = dst + (size_t)y * src.cols;
+        int x = 0;
+#if CV_SIMD128
+        const v_float32x4 m0 = v_setall_f32(m[0]);
+        if (cn == 3) {
+            const v_float32x4 m1 = v_setall_f32(m[1]);
+            const v_float32x4 m2 = v_setall_f32(m[2]);
+            for (; x <= src.cols - 16; x += 16) {
+                v_uint8x16 b, g, r;
+                v_load_deinterleave(s + x * 3, b, g, r);
+                normalize16(b, m0, d + x);
+                normalize16(g, m1, d + plane + x);
+                normalize16(r, m2, d + plane * 2 + x);
+            }
+        } else {
+            for (; x <= src.cols - 16; x += 16) {
+                normalize16(v_load(s + x), m0, d + x);
+            }
+        }
+#endif
+        for (; x < src.cols; x++) {
+            for (int c = 0; c < cn; c++) {
+                d[plane * c + x] = s[x * cn + c] - m[c];
+            }
+        }
+    }
+}
+
 /*
  !CaffeConverter Implementation
  */
@@ -66,35 +135,58 @@ class CaffeConverter_Impl : public CaffeConverter {
         net_ = create_net_from_caffe_prototxt(model_file);
         reload_weight_from_caffe_protobinary(trained_file, net_.get());
 
-        const size_t width  = (*net_)[0]->in_data_shape()[0].width_;
-        const size_t height = (*net_)[0]->in_data_shape()[0].height_;
-
-        mean_ = compute_mean(mean_file, width, height);
+        if (!mean_file.empty()) {
+            mean_ = compute_mean(mean_file);
+        }
     }
 
     ~CaffeConverter_Impl() {}
 
     virtual void eval(InputArray image, std::vector<float>& results);
 
+    virtual void evalBatch(InputArrayOfArrays images, OutputArray results);
+
+    // fills the input tensor of one sample, safe to call concurrently
+    void preprocess(const Mat& img, vec_t* input) const;
+
  private:
-    Mat compute_mean(const string& mean_file, const size_t width,
-		         const size_t height);
+    Scalar compute_mean(const string& mean_file);
 
     ColorConversionCodes get_cvt_codes(const int src_channels,
-                                           const int dst_channels);
-
-    void preprocess(const Mat& img, const Mat& mean,
-            const int num_channels, const Size& geometry,
-            vector<Mat>* input_channels);
+                                           const int dst_channels) const;
 
-    Mat mean_;
+    Scalar mean_;
     std::shared_ptr<network<sequential>> net_;
+
+    // input buffers, kept to avoid reallocations between calls
+    vec_t input_;
+    vector<tensor_t> batch_;
+};
+
+/*
+ Preprocesses a range of the images of a batch.
+ */
+class BatchPreprocessor : public ParallelLoopBody {
+ public:
+    BatchPreprocessor(const CaffeConverter_Impl& converter,
+                      const vector<Mat>& images,
+                      vector<tensor_t>& batch)
+        : converter_(converter), images_(images), batch_(batch) {}
+
+    virtual void operator()(const Range& range) const {
+        for (int i = range.start; i < range.end; i++) {
+            converter_.preprocess(images_[i], &batch_[i][0]);
+        }
+    }
+
+ private:
+    const CaffeConverter_Impl& converter_;
+    const vector<Mat>& images_;
+    vector<tensor_t>& batch_;
 };
 
-Mat
-CaffeConverter_Impl::compute_mean(const string& mean_file,
-                                  const size_t width,
-				  const size_t height) {
+Scalar
+CaffeConverter_Impl::compute_mean(const string& mean_file) {
     caffe::BlobProto blob;
     ::detail::read_proto_from_binary(mean_file, &blob);
 
@@ -110,12 +202,12 @@ CaffeConverter_Impl::compute_mean(const string& mean_file,
     Mat meanChannel;
     merge(channels, meanChannel);
 
-    return Mat(Size(width, height), meanChannel.type(), mean(meanChannel));
+    return mean(meanChannel);
 }
 
 ColorConversionCodes
 CaffeConverter_Impl::get_cvt_codes(const int src_channels,
-                                   const int dst_channels) {
+                                   const int dst_channels) const {
     assert(src_channels != dst_channels);
 
     if (dst_channels == 3) {
@@ -127,70 +219,79 @@ CaffeConverter_Impl::get_cvt_codes(const int src_channels,
     }
 }
 
-void CaffeConverter_Impl::preprocess(const Mat& img,
-                                     const Mat& mean,
-                                     const int num_channels,
-                                     const Size& geometry,
-                                     vector<Mat>* input_channels) {
+void CaffeConverter_Impl::preprocess(const Mat& img, vec_t* input) const {
+    const int channels = (int)(*net_)[0]->in_data_shape()[0].depth_;
+    const int width    = (int)(*net_)[0]->in_data_shape()[0].width_;
+    const int height   = (int)(*net_)[0]->in_data_shape()[0].height_;
+
     Mat sample;
 
     // convert color
-    if (img.channels() != num_channels) {
-        cvtColor(img, sample,
-                     get_cvt_codes(img.channels(), num_channels));
+    if (img.channels() != channels) {
+        cvtColor(img, sample, get_cvt_codes(img.channels(), channels));
     } else {
         sample = img;
     }
 
     // resize
     Mat sample_resized;
-    resize(sample, sample_resized, geometry);
-
-    Mat sample_float;
-    sample_resized.convertTo(sample_float,
-                             num_channels == 3 ? CV_32FC3 : CV_32FC1);
-
-    // subtract mean
-    if (mean.size().width > 0) {
-        Mat sample_normalized;
-        subtract(sample_float, mean, sample_normalized);
-        split(sample_normalized, *input_channels);
+    if (sample.size() != Size(width, height)) {
+        resize(sample, sample_resized, Size(width, height));
+    } else {
+        sample_resized = sample;
     }
-    else {
-        split(sample_float, *input_channels);
+
+    // subtract mean and split the channels into the input tensor
+    input->resize((size_t)width * height * channels);
+    if (sizeof(tiny_dnn::float_t) == sizeof(float)) {
+        normalizeToPlanes(sample_resized, mean_,
+                          reinterpret_cast<float*>(&(*input)[0]));
+    } else {
+        vector<float> planes(input->size());
+        normalizeToPlanes(sample_resized, mean_, &planes[0]);
+        std::copy(planes.begin(), planes.end(), input->begin());
     }
 }
 
 void CaffeConverter_Impl::eval(InputArray image,
                                std::vector<float>& results) {
-    const Mat img = image.getMat();
+    preprocess(image.getMat(), &input_);
 
-    const size_t channels = (*net_)[0]->in_data_shape()[0].depth_;
-    const size_t width    = (*net_)[0]->in_data_shape()[0].width_;
-    const size_t height   = (*net_)[0]->in_data_shape()[0].height_;
+    // perform inderence
+    auto result = net_->predict(input_);
 
-    vector<Mat> input_channels;
-    vector<float> inputvec(width*height*channels);
+    // allocate output
+    results.assign(result.begin(), result.end());
+}
 
-    for (size_t i = 0; i < channels; i++) {
-        input_channels.emplace_back(height, width, CV_32FC1,
-                                    &inputvec[width*height*i]);
+void CaffeConverter_Impl::evalBatch(InputArrayOfArrays images,
+                                    OutputArray results) {
+    vector<Mat> imgs;
+    images.getMatVector(imgs);
+
+    if (imgs.empty()) {
+        results.release();
+        return;
     }
 
-    // subtract mean from input
-    preprocess(img, mean_, 3, Size(width, height), &input_channels);
+    batch_.resize(imgs.size());
+    for (size_t i = 0; i < batch_.size(); i++) {
+        batch_[i].resize(1);
+    }
 
-    const vector<tiny_dnn::float_t> vec(inputvec.begin(), inputvec.end());
+    parallel_for_(Range(0, (int)imgs.size()),
+                  BatchPreprocessor(*this, imgs, batch_));
 
-    // perform inderence
-    auto result = net_->predict(vec);
+    // the layers distribute the samples over the tiny-dnn worker threads
+    auto outputs = net_->predict(batch_);
 
-    // allocate output
-    results.clear();
-    results.reserve(result.size());
+    const int cols = (int)outputs[0][0].size();
+    results.create((int)outputs.size(), cols, CV_32F);
+    Mat out = results.getMat();
 
-    for (size_t i = 0; i < result.size(); i++) {
-        results.push_back(result[i]);
+    for (int i = 0; i < out.rows; i++) {
+        const vec_t& result = outputs[i][0];
+        std::copy(result.begin(), result.end(), out.ptr<float>(i));
     }
 }
 
@@ -140,7 +140,7 @@ void DPMCascade::initDPMCascade()
     pcaDtArgmaxY.resize(dtLevelOffset[nlevels]);
 }
 
-vector< vector<double> > DPMCascade::detect(Mat &image)
+vector< vector<double> > DPMCascade::detect(Mat &image, FeaturePyramidCache *cache)
 {
     if (image.channels() == 1)
         cvtColor(image, image, COLOR_GRAY2BGR);
@@ -149,7 +149,7 @@ vector< vector<double> > DPMCascade::detect(Mat &image)
         image.convertTo(image, CV_64FC3);
 
     // compute features
-    computeFeatures(image);
+    computeFeatures(image, cache);
 
     // pre-allocate storage
     initDPMCascade();
@@ -165,7 +165,7 @@ vector< vector<double> > DPMCascade::detect(Mat &image)
     return detections;
 }
 
-void DPMCascade::computeFeatures(const Mat &im)
+void DPMCascade::computeFeatures(const Mat &im, FeaturePyramidCache *cache)
 {
     // initialize feature pyramid
     PyramidParameter params;
@@ -174,10 +174,17 @@ void DPMCascade::computeFeatures(const Mat &im)
     params.interval = model.interval;
     params.binSize = model.sBin;
 
-    feature = Feature(params);
-
-    // compute pyramid
-    feature.computeFeaturePyramid(im, pyramid);
+    // compute pyramid, or reuse the one of a model with the same parameters
+    if (cache)
+    {
+        cache->getPyramid(im, params, pyramid);
+        feature = Feature(params);
+    }
+    else
+    {
+        feature = Feature(params);
+        feature.computeFeaturePyramid(im, pyramid);
+    }
 
     // compute projected pyramid
     feature.projectFeaturePyramid(model.pcaCoeff, pyramid, pcaPyramid);
@@ -220,36 +227,12 @@ void DPMCascade::computeRootPCAScores(vector< vector< Mat > > &rootScores)
     for (int comp = 0; comp < model.numComponents; comp++)
     {
         rootScores[comp].resize(nlevels);
-#ifdef HAVE_TBB // parallel computing
         ParalComputeRootPCAScores paralTask(pcaPyramid, model.rootPCAFilters[comp],
                 model.pcaDim, rootScores[comp]);
         parallel_for_(Range(interval, nlevels), paralTask);
-#else
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-        for (int level = interval; level < nlevels; level++)
-        {
-            Mat feat = pcaPyramid[level];
-            Mat filter = model.rootPCAFilters[comp];
-
-            // compute size of output
-            int height = feat.rows - filter.rows + 1;
-            int width = (feat.cols - filter.cols) / model.pcaDim + 1;
-
-            if (height < 1 || width < 1)
-                CV_Error(CV_StsBadArg,
-                        "Invalid input, filter size should be smaller than feature size.");
-
-            Mat result = Mat::zeros(Size(width, height), CV_64F);
-            convolutionEngine.convolve(feat, filter, model.pcaDim, result);
-            rootScores[comp][level] = result;
-        }
-#endif
     }
 }
 
-#ifdef HAVE_TBB
 ParalComputeRootPCAScores::ParalComputeRootPCAScores(
         const vector< Mat > &pcaPyrad,
         const Mat &f,
@@ -272,14 +255,18 @@ void ParalComputeRootPCAScores::operator() (const Range &range) const
         int height = feat.rows - filter.rows + 1;
         int width = (feat.cols - filter.cols) / pcaDim + 1;
 
+        if (height < 1 || width < 1)
+            CV_Error(CV_StsBadArg,
+                    "Invalid input, filter size should be smaller than feature size.");
+
         Mat result = Mat::zeros(Size(width, height), CV_64F);
-        // convolution engine
+        // convolution engine, the dense score maps are computed in the
+        // frequency domain
         ConvolutionEngine convEngine;
-        convEngine.convolve(feat, filter, pcaDim, result);
+        convEngine.convolveFFT(feat, filter, pcaDim, result);
         scores[level] = result;
     }
 }
-#endif
 
 void DPMCascade::process( vector< vector<double> > &dets)
 {
@@ -106,8 +106,9 @@ class DPMCascade
         // load cascade mode and initialize cascade
         void loadCascadeModel(const std::string &modelPath);
 
-        // compute feature pyramid and projected feature pyramid
-        void computeFeatures(const Mat &im);
+        // compute feature pyramid and projected feature pyramid,
+        // the feature pyramid is taken from the cache if one is given
+        void computeFeatures(const Mat &im, FeaturePyramidCache *cache = 0);
 
         // compute root PCA scores
         void computeRootPCAScores(std::vector< std::vector< Mat > > &rootScores);
@@ -124,14 +125,13 @@ class DPMCascade
         // cascade process
         void process(std::vector< std::vector<double> > &detections);
 
-        // detect object from image
-        std::vector< std::vector<double> > detect(Mat &image);
+        // detect object from image, the cache shares the feature
+        // pyramids of the image between several models
+        std::vector< std::vector<double> > detect(Mat &image, FeaturePyramidCache *cache = 0);
 };
 
-#ifdef HAVE_TBB
 /** @brief This class convolves root PCA feature pyramid
- * and root PCA filters in parallel using Intel Threading
- * Building Blocks (TBB)
+ * and root PCA filters in parallel
  */
 class ParalComputeRootPCAScores : public ParallelLoopBody
 {
@@ -143,15 +143,14 @@ class ParalComputeRootPCAScores : public ParallelLoopBody
         // parallel loop body
         void operator() (const Range &range) const;
 
-        ParalComputeRootPCAScores(const ParalComputeRootPCAScores &pComp);
-
     private:
         const std::vector< Mat > &pcaPyramid;
         const Mat &filter;
         int pcaDim;
         std::vector< Mat > &scores;
+
+        ParalComputeRootPCAScores& operator=(const ParalComputeRootPCAScores&);
 };
-#endif
 } // namespace dpm
 } // namespace cv
 
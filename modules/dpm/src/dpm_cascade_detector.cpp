@@ -151,11 +151,14 @@ void DPMDetectorImpl::detect( Mat &image,
 {
     objectDetections.clear();
 
+    // the models with the same pyramid parameters share the features
+    FeaturePyramidCache featureCache;
+
     for( size_t classID = 0; classID < detectors.size(); classID++ )
     {
         // detect objects
         vector< vector<double> > detections;
-        detections = detectors[classID]->detect(image);
+        detections = detectors[classID]->detect(image, &featureCache);
 
         for (unsigned int i = 0; i < detections.size(); i++)
         {
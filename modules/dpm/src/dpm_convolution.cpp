@@ -87,5 +87,38 @@ void ConvolutionEngine::convolve(const Mat &feat, const Mat &filter,
         } // x
     } // y
 }
+
+void ConvolutionEngine::convolveFFT(const Mat &feat, const Mat &filter,
+        int dimHOG, Mat &result)
+{
+    CV_Assert(feat.type() == CV_64F && filter.type() == CV_64F);
+    CV_Assert(result.rows == feat.rows - filter.rows + 1 &&
+            result.cols == (feat.cols - filter.cols)/dimHOG + 1);
+
+    // the feature channels are interleaved in the columns, so the
+    // correlation of the flat maps taken every dimHOG columns sums the
+    // correlations of all channels. The valid part of the circular
+    // correlation does not wrap around since the DFT is not smaller
+    // than the feature map
+    Size dftSize(getOptimalDFTSize(feat.cols), getOptimalDFTSize(feat.rows));
+    Mat featPadded = Mat::zeros(dftSize, CV_64F);
+    Mat filterPadded = Mat::zeros(dftSize, CV_64F);
+    feat.copyTo(featPadded(Rect(0, 0, feat.cols, feat.rows)));
+    filter.copyTo(filterPadded(Rect(0, 0, filter.cols, filter.rows)));
+
+    Mat featSpectrum, filterSpectrum, spectrum, corr;
+    dft(featPadded, featSpectrum, 0, feat.rows);
+    dft(filterPadded, filterSpectrum, 0, filter.rows);
+    mulSpectrums(featSpectrum, filterSpectrum, spectrum, 0, true);
+    dft(spectrum, corr, DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT, result.rows);
+
+    for (int y = 0; y < result.rows; y++)
+    {
+        const double *pcorr = corr.ptr<double>(y);
+        double *presult = result.ptr<double>(y);
+        for (int x = 0; x < result.cols; x++)
+            presult[x] = pcorr[x*dimHOG];
+    }
+}
 } // namespace cv
 } // namespace dpm
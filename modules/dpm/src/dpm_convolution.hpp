@@ -68,6 +68,11 @@ class ConvolutionEngine
         // sum the filter convolution values into results
         void convolve(const Mat &feat, const Mat &filter,
                 int dimHOG, Mat &result);
+
+        // same as above with the correlation computed in the frequency
+        // domain, for the dense score maps of large filters
+        void convolveFFT(const Mat &feat, const Mat &filter,
+                int dimHOG, Mat &result);
 };
 } // namespace dpm
 } // namespace cv
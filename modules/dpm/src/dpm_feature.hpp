@@ -137,9 +137,26 @@ class Feature
 
 };
 
-#ifdef HAVE_TBB
-/** @brief This class computes feature pyramid in parallel
- * using Intel Threading Building Blocks (TBB)
+/** @brief Feature pyramids of one image, the models with the same pyramid
+ * parameters (interval, bin size and padding) share the same pyramid,
+ * e.g. in multi-class detection
+ */
+class FeaturePyramidCache
+{
+    public:
+        // get the pyramid of the image, it is only computed on the first use
+        // of the parameters. The scales of the levels are set in params
+        void getPyramid(const Mat &imageM, PyramidParameter &params, std::vector< Mat > &pyramid);
+
+        // release the pyramids
+        void clear();
+
+    private:
+        std::vector< PyramidParameter > parameters;
+        std::vector< std::vector< Mat > > pyramids;
+};
+
+/** @brief This class computes the levels of the feature pyramid in parallel
  */
 class ParalComputePyramid : public ParallelLoopBody
 {
@@ -164,8 +181,9 @@ class ParalComputePyramid : public ParallelLoopBody
         std::vector< Mat > &pyramid;
         // pyramid parameters
         PyramidParameter &params;
+
+        ParalComputePyramid& operator=(const ParalComputePyramid&);
 };
-#endif
 
 } // namespace dpm
 } // namespace cv
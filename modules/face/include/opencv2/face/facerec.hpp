@@ -33,6 +33,16 @@ public:
     CV_WRAP virtual cv::Mat getEigenValues() const = 0;
     CV_WRAP virtual cv::Mat getEigenVectors() const = 0;
     CV_WRAP virtual cv::Mat getMean() const = 0;
+
+    /** @brief Sends the results of the prediction of many samples to their collectors.
+    @param src Samples to get a prediction from, a vector of images or a matrix with one sample per row.
+    @param collectors One collector per sample. Each one gets the distances to all the training samples,
+    in their order, so the k nearest ones can be read from StandardCollector::getResults(true).
+
+    The samples are projected into the subspace with a single matrix product, and the distances to the
+    training projections are computed as another one, which is much faster than predicting them one by one.
+    */
+    virtual void predictBatch(InputArrayOfArrays src, const std::vector<Ptr<PredictCollector> >& collectors) const = 0;
 };
 
 /**
@@ -123,6 +133,30 @@ public:
     CV_WRAP virtual void setThreshold(double val) = 0;
     CV_WRAP virtual std::vector<cv::Mat> getHistograms() const = 0;
     CV_WRAP virtual cv::Mat getLabels() const = 0;
+
+    /** @brief Writes the labels and the histograms to a binary store.
+    @param filename The file to write.
+    @param append If set and the file is a store of a model with the same parameters, only the samples
+    that are not in it yet (e.g. added by update after it was written) are appended to it.
+
+    The store is a small header followed by one fixed size record per sample, so it can be extended
+    without rewriting it and mapped in memory at load. The label info is not stored.
+     */
+    CV_WRAP virtual void saveBinary(const String& filename, bool append = false) const = 0;
+
+    /** @brief Replaces the parameters, the labels and the histograms by the ones of a binary store.
+    @param filename The file written by saveBinary.
+     */
+    CV_WRAP virtual void loadBinary(const String& filename) = 0;
+
+    /** @overload
+    @param data The content of a file written by saveBinary, e.g. mapped in memory by the caller.
+    @param size The size of the data in bytes.
+
+    @note The histograms are not copied, the data must stay valid as long as the model uses it.
+    update and train copy them into the model.
+     */
+    virtual void loadBinary(const uchar* data, size_t size) = 0;
 };
 
 /**
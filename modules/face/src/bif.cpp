@@ -91,6 +91,10 @@ const double kGaborWavelens[kNumBandsMax][2] = {
     {11.5, 12.7}, {14.1, 15.4}, {16.8, 18.2}, {19.7, 21.2}
 };
 
+// Kernels of this size and larger are applied in the frequency domain,
+// the same limit as filter2D uses to switch to the DFT.
+const int kSpectralKernelSize = 11;
+
 class BIFImpl : public cv::face::BIF {
 public:
     BIFImpl(int num_bands, int num_rotations) {
@@ -110,12 +114,59 @@ private:
         cv::Mat filter1, filter2;
     };
 
+    class UnitsBody;
+
     void initUnits(int num_bands, int num_rotations);
-    void computeUnit(int unit_idx, const cv::Mat &img, cv::Mat &dst) const;
+    int unitDim(int unit_idx, const cv::Size &img_size) const;
+    void getSpectra(const cv::Size &dft_size,
+                    std::vector<cv::Mat> &spectra) const;
+    void filterUnit(const cv::Mat &img, const cv::Mat &filter,
+                    const cv::Mat &img_spectrum,
+                    const cv::Mat &filter_spectrum, cv::Mat &resp) const;
+    void computeUnit(int unit_idx, const cv::Mat &img,
+                     const cv::Mat &img_spectrum,
+                     const std::vector<cv::Mat> &spectra,
+                     cv::Mat &dst) const;
 
     int num_bands_;
     int num_rotations_;
     std::vector<UnitParams> units_;
+    // Border added to the image before the DFT, the largest kernel radius
+    int padding_;
+
+    // Spectra of the filters (two per unit, empty for the small ones)
+    // for the last DFT size, shared by the calls for same sized images.
+    mutable cv::Mutex spectra_mutex_;
+    mutable cv::Size spectra_size_;
+    mutable std::vector<cv::Mat> spectra_;
+};
+
+// Computes the units in parallel, each one into its own rows of the features.
+class BIFImpl::UnitsBody : public cv::ParallelLoopBody {
+public:
+    UnitsBody(const BIFImpl &_bif, const cv::Mat &_image,
+              const cv::Mat &_image_spectrum,
+              const std::vector<cv::Mat> &_spectra,
+              const std::vector<int> &_offsets, cv::Mat &_features)
+        : bif(_bif), image(_image), image_spectrum(_image_spectrum),
+          spectra(_spectra), offsets(_offsets), features(_features) {}
+
+    void operator()(const cv::Range &range) const {
+        for (int i = range.start; i < range.end; ++i) {
+            cv::Mat dst = features.rowRange(offsets[i], offsets[i+1]);
+            bif.computeUnit(i, image, image_spectrum, spectra, dst);
+        }
+    }
+
+private:
+    const BIFImpl &bif;
+    const cv::Mat &image;
+    const cv::Mat &image_spectrum;
+    const std::vector<cv::Mat> &spectra;
+    const std::vector<int> &offsets;
+    cv::Mat &features;
+
+    UnitsBody& operator=(const UnitsBody&);
 };
 
 void BIFImpl::compute(cv::InputArray _image,
@@ -123,24 +174,36 @@ void BIFImpl::compute(cv::InputArray _image,
     cv::Mat image = _image.getMat();
     CV_Assert(image.type() == CV_32F);
 
-    std::vector<cv::Mat> fea_units(units_.size());
-    int fea_dim = 0;
+    std::vector<int> offsets(units_.size() + 1, 0);
+    for (size_t i = 0; i < units_.size(); ++i)
+        offsets[i+1] = offsets[i] + unitDim(static_cast<int>(i), image.size());
 
-    for (size_t i = 0; i < units_.size(); ++i) {
-        computeUnit(static_cast<int>(i), image, fea_units[i]);
-        fea_dim += fea_units[i].rows;
-    }
-
-    _features.create(fea_dim, 1, CV_32F);
+    _features.create(offsets.back(), 1, CV_32F);
     cv::Mat fea = _features.getMat();
 
-    int offset = 0;
-    for (size_t i = 0; i < fea_units.size(); ++i) {
-        cv::Mat roi = fea.rowRange(offset, offset + fea_units[i].rows);
-        fea_units[i].copyTo(roi);
-        offset += fea_units[i].rows;
+    // The spectrum of the image is computed once for all the large filters.
+    // The image is padded as filter2D does, so the cyclic convolution does
+    // not wrap around inside the image.
+    cv::Mat image_spectrum;
+    std::vector<cv::Mat> spectra;
+    if (kGaborSize[num_bands_-1][1].width >= kSpectralKernelSize) {
+        cv::Size padded_size(image.cols + 2*padding_, image.rows + 2*padding_);
+        cv::Size dft_size(cv::getOptimalDFTSize(padded_size.width),
+                          cv::getOptimalDFTSize(padded_size.height));
+        getSpectra(dft_size, spectra);
+
+        cv::Mat padded(dft_size, CV_32F, cv::Scalar::all(0));
+        cv::Mat roi = padded(cv::Rect(cv::Point(), padded_size));
+        cv::copyMakeBorder(image, roi, padding_, padding_, padding_, padding_,
+                           cv::BORDER_REFLECT_101);
+        cv::dft(padded, image_spectrum);
+    } else {
+        spectra.resize(2 * units_.size());
     }
-    CV_Assert(offset == fea_dim);
+
+    cv::parallel_for_(cv::Range(0, static_cast<int>(units_.size())),
+                      UnitsBody(*this, image, image_spectrum, spectra,
+                                offsets, fea));
 }
 
 void BIFImpl::initUnits(int num_bands, int num_rotations) {
@@ -149,6 +212,7 @@ void BIFImpl::initUnits(int num_bands, int num_rotations) {
 
     num_bands_ = num_bands;
     num_rotations_ = num_rotations;
+    padding_ = kGaborSize[num_bands-1][1].width / 2;
 
     for (int ri = 0; ri < num_rotations; ++ri) {
         double angle = CV_PI / num_rotations * ri;
@@ -175,11 +239,59 @@ void BIFImpl::initUnits(int num_bands, int num_rotations) {
     }
 }
 
+int BIFImpl::unitDim(int unit_idx, const cv::Size &img_size) const {
+    int Hhalf = units_[unit_idx].cell_size.height / 2;
+    int Whalf = units_[unit_idx].cell_size.width / 2;
+    return ((img_size.height + Hhalf - 1) / Hhalf) *
+           ((img_size.width + Whalf - 1) / Whalf);
+}
+
+void BIFImpl::getSpectra(const cv::Size &dft_size,
+                         std::vector<cv::Mat> &spectra) const {
+    cv::AutoLock lock(spectra_mutex_);
+    if (spectra_size_ != dft_size) {
+        std::vector<cv::Mat> cache(2 * units_.size());
+        for (size_t i = 0; i < units_.size(); ++i) {
+            for (int k = 0; k < 2; ++k) {
+                const cv::Mat &filter = k ? units_[i].filter2 : units_[i].filter1;
+                if (filter.cols < kSpectralKernelSize)
+                    continue;
+                cv::Mat padded(dft_size, CV_32F, cv::Scalar::all(0));
+                filter.copyTo(padded(cv::Rect(0, 0, filter.cols, filter.rows)));
+                cv::dft(padded, cache[2*i+k]);
+            }
+        }
+        spectra_.swap(cache);
+        spectra_size_ = dft_size;
+    }
+    spectra = spectra_;
+}
+
+void BIFImpl::filterUnit(const cv::Mat &img, const cv::Mat &filter,
+                         const cv::Mat &img_spectrum,
+                         const cv::Mat &filter_spectrum,
+                         cv::Mat &resp) const {
+    if (filter_spectrum.empty()) {
+        cv::filter2D(img, resp, CV_32F, filter);
+        return;
+    }
+    // filter2D is a correlation, so the filter spectrum is conjugated
+    cv::Mat prod, full;
+    cv::mulSpectrums(img_spectrum, filter_spectrum, prod, 0, true);
+    cv::dft(prod, full, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+    resp = full(cv::Rect(padding_ - filter.cols / 2, padding_ - filter.rows / 2,
+                         img.cols, img.rows));
+}
+
 void BIFImpl::computeUnit(int unit_idx, const cv::Mat &img,
+                          const cv::Mat &img_spectrum,
+                          const std::vector<cv::Mat> &spectra,
                           cv::Mat &dst) const {
     cv::Mat resp1, resp2;
-    cv::filter2D(img, resp1, CV_32F, units_[unit_idx].filter1);
-    cv::filter2D(img, resp2, CV_32F, units_[unit_idx].filter2);
+    filterUnit(img, units_[unit_idx].filter1, img_spectrum,
+               spectra[2*unit_idx], resp1);
+    filterUnit(img, units_[unit_idx].filter2, img_spectrum,
+               spectra[2*unit_idx+1], resp2);
 
     cv::Mat resp, sum, sumsq;
     cv::max(resp1, resp2, resp);
@@ -188,28 +300,27 @@ void BIFImpl::computeUnit(int unit_idx, const cv::Mat &img,
     int Hhalf = units_[unit_idx].cell_size.height / 2;
     int Whalf = units_[unit_idx].cell_size.width / 2;
 
-    int nrows = (resp.rows + Hhalf - 1) / Hhalf;
-    int ncols = (resp.cols + Whalf - 1) / Whalf;
-    dst.create(nrows*ncols, 1, CV_32F);
+    CV_Assert(static_cast<int>(dst.total()) == unitDim(unit_idx, img.size()));
+    float *out = dst.ptr<float>();
 
     for (int pos = 0, yc = 0; yc < resp.rows; yc += Hhalf) {
         int y0 = std::max(0, yc - Hhalf);
         int y1 = std::min(resp.rows, yc + Hhalf);
+        const double *s0 = sum.ptr<double>(y0), *s1 = sum.ptr<double>(y1);
+        const double *q0 = sumsq.ptr<double>(y0), *q1 = sumsq.ptr<double>(y1);
 
         for (int xc = 0; xc < resp.cols; xc += Whalf, ++pos) {
             int x0 = std::max(0, xc - Whalf);
             int x1 = std::min(resp.cols, xc + Whalf);
             int area = (y1-y0) * (x1-x0);
 
-            double mean = sum.at<double>(y1,x1) - sum.at<double>(y1,x0)
-                         - sum.at<double>(y0,x1) + sum.at<double>(y0,x0);
+            double mean = s1[x1] - s1[x0] - s0[x1] + s0[x0];
             mean /= area;
 
-            double sd = sumsq.at<double>(y1,x1) - sumsq.at<double>(y1,x0)
-                        - sumsq.at<double>(y0,x1) + sumsq.at<double>(y0,x0);
+            double sd = q1[x1] - q1[x0] - q0[x1] + q0[x0];
             sd = sqrt(std::max(0.0, sd / area - mean * mean));
 
-            dst.at<float>(pos) = static_cast<float>(sd);
+            out[pos] = static_cast<float>(sd);
         }
     }
 }
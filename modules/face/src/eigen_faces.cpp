@@ -93,10 +93,10 @@ void Eigenfaces::train(InputArrayOfArrays _src, InputArray _local_labels) {
     // store labels for prediction
     _labels = labels.clone();
     // save projections
-    for(int sampleIdx = 0; sampleIdx < data.rows; sampleIdx++) {
-        Mat p = LDA::subspaceProject(_eigenvectors, _mean, data.row(sampleIdx));
-        _projections.push_back(p);
-    }
+    Mat projections = LDA::subspaceProject(_eigenvectors, _mean, data);
+    for(int sampleIdx = 0; sampleIdx < projections.rows; sampleIdx++)
+        _projections.push_back(projections.row(sampleIdx));
+    packProjections();
 }
 
 void Eigenfaces::predict(InputArray _src, Ptr<PredictCollector> collector) const {
@@ -112,14 +112,8 @@ void Eigenfaces::predict(InputArray _src, Ptr<PredictCollector> collector) const
         String error_message = format("Wrong input image size. Reason: Training and Test images must be of equal size! Expected an image with %d elements, but got %d.", _eigenvectors.rows, src.total());
         CV_Error(Error::StsBadArg, error_message);
     }
-    // project into PCA subspace
-    Mat q = LDA::subspaceProject(_eigenvectors, _mean, src.reshape(1, 1));
-    collector->init(_projections.size());
-    for (size_t sampleIdx = 0; sampleIdx < _projections.size(); sampleIdx++) {
-        double dist = norm(_projections[sampleIdx], q, NORM_L2);
-        int label = _labels.at<int>((int)sampleIdx);
-        if (!collector->collect(label, dist))return;
-    }
+    // project into the subspace and find the distances to all the projections
+    predictRows(src.reshape(1, 1), &collector);
 }
 
 Ptr<BasicFaceRecognizer> createEigenFaceRecognizer(int num_components, double threshold)
@@ -0,0 +1,87 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "precomp.hpp"
+#include "face_basic.hpp"
+
+using namespace cv::face;
+
+void BasicFaceRecognizerImpl::packProjections() {
+    if(_projections.empty()) {
+        _gallery.release();
+        _galleryNorms.release();
+        _meanProjection.release();
+        return;
+    }
+    const int length = (int)_projections[0].total();
+    Mat gallery((int)_projections.size(), length, CV_64FC1);
+    for(size_t sampleIdx = 0; sampleIdx < _projections.size(); sampleIdx++) {
+        CV_Assert((int)_projections[sampleIdx].total() == length && _projections[sampleIdx].channels() == 1);
+        Mat row = gallery.row((int)sampleIdx);
+        _projections[sampleIdx].reshape(1, 1).convertTo(row, CV_64FC1);
+    }
+    _gallery = gallery;
+    for(size_t sampleIdx = 0; sampleIdx < _projections.size(); sampleIdx++)
+        _projections[sampleIdx] = _gallery.row((int)sampleIdx);
+    // |g|^2 of every projection, the distances are then |q|^2 + |g|^2 - 2 q.g
+    reduce(_gallery.mul(_gallery), _galleryNorms, 1, REDUCE_SUM, CV_64FC1);
+    // (x - mean) * W is computed as x * W - mean * W
+    gemm(_mean.reshape(1, 1), _eigenvectors, 1.0, Mat(), 0.0, _meanProjection);
+}
+
+void BasicFaceRecognizerImpl::predictRows(const Mat& queries, const Ptr<PredictCollector>* collectors) const {
+    // the queries are projected in blocks to bound the size of the distance matrix
+    const int blockSize = 256;
+    const int N = _gallery.rows;
+    Mat block, projected, dots;
+    for(int start = 0; start < queries.rows; start += blockSize) {
+        const int end = std::min(queries.rows, start + blockSize);
+        queries.rowRange(start, end).convertTo(block, CV_64FC1);
+        gemm(block, _eigenvectors, 1.0, repeat(_meanProjection, end - start, 1), -1.0, projected);
+        gemm(projected, _gallery, -2.0, Mat(), 0.0, dots, GEMM_2_T);
+        const double* galleryNorms = _galleryNorms.ptr<double>();
+        for(int i = 0; i < dots.rows; i++) {
+            const Mat q = projected.row(i);
+            const double queryNorm = q.dot(q);
+            const double* d = dots.ptr<double>(i);
+            const Ptr<PredictCollector>& collector = collectors[start + i];
+            collector->init(N);
+            for(int sampleIdx = 0; sampleIdx < N; sampleIdx++) {
+                double dist = std::sqrt(std::max(queryNorm + galleryNorms[sampleIdx] + d[sampleIdx], 0.0));
+                int label = _labels.at<int>(sampleIdx);
+                if (!collector->collect(label, dist))break;
+            }
+        }
+    }
+}
+
+void BasicFaceRecognizerImpl::predictBatch(InputArrayOfArrays _src, const std::vector<Ptr<PredictCollector> >& collectors) const {
+    if(_gallery.empty()) {
+        String error_message = "This model is not computed yet. Did you call train?";
+        CV_Error(Error::StsError, error_message);
+    }
+    Mat queries;
+    if(_src.kind() == _InputArray::STD_VECTOR_MAT || _src.kind() == _InputArray::STD_VECTOR_VECTOR) {
+        queries = asRowMatrix(_src, CV_64FC1);
+    } else if(!_src.empty()) {
+        // one sample per row
+        Mat src = _src.getMat();
+        if(!src.isContinuous())
+            src = src.clone();
+        queries = src.reshape(1, src.rows);
+    }
+    if(collectors.size() != (size_t)queries.rows) {
+        String error_message = format("Expected one collector per sample! Got %d collectors for %d samples.", (int)collectors.size(), queries.rows);
+        CV_Error(Error::StsBadArg, error_message);
+    }
+    if(queries.empty())
+        return;
+    if(queries.cols != _eigenvectors.rows) {
+        String error_message = format("Wrong input sample size. Reason: Training and Test images must be of equal size! Expected samples with %d elements, but got %d.", _eigenvectors.rows, queries.cols);
+        CV_Error(Error::StsBadArg, error_message);
+    }
+    for(size_t i = 0; i < collectors.size(); i++)
+        CV_Assert(!collectors[i].empty());
+    predictRows(queries, &collectors[0]);
+}
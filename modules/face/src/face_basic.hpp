@@ -123,6 +123,7 @@ public:
         fs["eigenvectors"] >> _eigenvectors;
         // read sequences
         readFileNodeList(fs["projections"], _projections);
+        packProjections();
         fs["labels"] >> _labels;
         const FileNode& fn = fs["labelsInfo"];
         if (fn.type() == FileNode::SEQ)
@@ -161,7 +162,18 @@ public:
     CV_IMPL_PROPERTY_RO(cv::Mat, EigenVectors, _eigenvectors)
     CV_IMPL_PROPERTY_RO(cv::Mat, Mean, _mean)
 
+    // Projects all the samples with one product and computes their distances
+    // to the projections as another one.
+    void predictBatch(InputArrayOfArrays src, const std::vector<Ptr<cv::face::PredictCollector> >& collectors) const;
+
 protected:
+    // Packs _projections into _gallery and caches the terms used by predictRows.
+    void packProjections();
+
+    // Sends the distances of every row of queries to the projections to its collector.
+    void predictRows(const Mat& queries, const Ptr<cv::face::PredictCollector>* collectors) const;
+
+
     int _num_components;
     double _threshold;
     std::vector<Mat> _projections;
@@ -169,6 +181,12 @@ protected:
     Mat _eigenvectors;
     Mat _eigenvalues;
     Mat _mean;
+    // All the projections, one per row, _projections are views of its rows
+    Mat _gallery;
+    // Squared norms of the rows of _gallery
+    Mat _galleryNorms;
+    // _mean projected into the subspace
+    Mat _meanProjection;
 };
 
 #endif // __OPENCV_FACE_BASIC_HPP
@@ -114,10 +114,10 @@ void Fisherfaces::train(InputArrayOfArrays src, InputArray _lbls) {
     // Note: OpenCV stores the eigenvectors by row, so we need to transpose it!
     gemm(pca.eigenvectors, lda.eigenvectors(), 1.0, Mat(), 0.0, _eigenvectors, GEMM_1_T);
     // store the projections of the original data
-    for(int sampleIdx = 0; sampleIdx < data.rows; sampleIdx++) {
-        Mat p = LDA::subspaceProject(_eigenvectors, _mean, data.row(sampleIdx));
-        _projections.push_back(p);
-    }
+    Mat projections = LDA::subspaceProject(_eigenvectors, _mean, data);
+    for(int sampleIdx = 0; sampleIdx < projections.rows; sampleIdx++)
+        _projections.push_back(projections.row(sampleIdx));
+    packProjections();
 }
 
 void Fisherfaces::predict(InputArray _src, Ptr<PredictCollector> collector) const {
@@ -131,15 +131,8 @@ void Fisherfaces::predict(InputArray _src, Ptr<PredictCollector> collector) cons
         String error_message = format("Wrong input image size. Reason: Training and Test images must be of equal size! Expected an image with %d elements, but got %d.", _eigenvectors.rows, src.total());
         CV_Error(Error::StsBadArg, error_message);
     }
-    // project into LDA subspace
-    Mat q = LDA::subspaceProject(_eigenvectors, _mean, src.reshape(1,1));
-    // find 1-nearest neighbor
-    collector->init((int)_projections.size());
-    for (size_t sampleIdx = 0; sampleIdx < _projections.size(); sampleIdx++) {
-        double dist = norm(_projections[sampleIdx], q, NORM_L2);
-        int label = _labels.at<int>((int)sampleIdx);
-        if (!collector->collect(label, dist))return;
-    }
+    // project into the subspace and find the distances to all the projections
+    predictRows(src.reshape(1, 1), &collector);
 }
 
 Ptr<BasicFaceRecognizer> createFisherFaceRecognizer(int num_components, double threshold)
@@ -18,6 +18,7 @@
 #include "precomp.hpp"
 #include "opencv2/face.hpp"
 #include "face_basic.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv { namespace face {
 
@@ -39,6 +40,15 @@ private:
     std::vector<Mat> _histograms;
     Mat _labels;
 
+    // All the histograms, one per row, _histograms are views of its rows
+    Mat _gallery;
+
+    // The buffer of a store read by loadBinary, _gallery points into it
+    Mat _store;
+
+    // Copies the histograms to _gallery and points them to its rows.
+    void packHistograms();
+
     // Computes a LBPH model with images in src and
     // corresponding labels in labels, possibly preserving
     // old model data.
@@ -100,6 +110,13 @@ public:
     // See FaceRecognizer::save.
     void save(FileStorage& fs) const;
 
+    // See LBPHFaceRecognizer::saveBinary.
+    void saveBinary(const String& filename, bool append) const;
+
+    // See LBPHFaceRecognizer::loadBinary.
+    void loadBinary(const String& filename);
+    void loadBinary(const uchar* data, size_t size);
+
     CV_IMPL_PROPERTY(int, GridX, _grid_x)
     CV_IMPL_PROPERTY(int, GridY, _grid_y)
     CV_IMPL_PROPERTY(int, Radius, _radius)
@@ -118,6 +135,7 @@ void LBPH::load(const FileStorage& fs) {
     //read matrices
     readFileNodeList(fs["histograms"], _histograms);
     fs["labels"] >> _labels;
+    packHistograms();
     const FileNode& fn = fs["labelsInfo"];
     if (fn.type() == FileNode::SEQ)
     {
@@ -150,6 +168,107 @@ void LBPH::train(InputArrayOfArrays _in_src, InputArray _in_labels) {
     this->train(_in_src, _in_labels, false);
 }
 
+// The binary stores begin with LBPH_STORE_HEADER_SIZE ints: the signature,
+// the version, radius, neighbors, grid_x, grid_y, the histogram length and a
+// reserved zero. Then every sample is a record of its label and histogram.
+static const int LBPH_STORE_SIGNATURE = 0x4850424c; // "LBPH"
+static const int LBPH_STORE_VERSION = 1;
+enum { LBPH_STORE_HEADER_SIZE = 8 };
+
+void LBPH::saveBinary(const String& filename, bool append) const {
+    if(_histograms.empty()) {
+        String error_message = "This LBPH model is not computed yet. Did you call the train method?";
+        CV_Error(Error::StsBadArg, error_message);
+    }
+    const int header[LBPH_STORE_HEADER_SIZE] = { LBPH_STORE_SIGNATURE, LBPH_STORE_VERSION,
+        _radius, _neighbors, _grid_x, _grid_y, _gallery.cols, 0 };
+    const size_t headerSize = sizeof(header);
+    const size_t recordSize = sizeof(int) + sizeof(float) * _gallery.cols;
+
+    // only the samples that are not in the store yet are appended to it
+    int start = 0;
+    bool ok = true;
+    FILE* f = append ? fopen(filename.c_str(), "r+b") : 0;
+    if(f) {
+        int stored[LBPH_STORE_HEADER_SIZE];
+        ok = fread(stored, sizeof(int), LBPH_STORE_HEADER_SIZE, f) == LBPH_STORE_HEADER_SIZE &&
+             memcmp(stored, header, headerSize) == 0 && fseek(f, 0, SEEK_END) == 0;
+        long fsize = ok ? ftell(f) : -1;
+        ok = ok && fsize >= (long)headerSize && ((size_t)fsize - headerSize) % recordSize == 0 &&
+             ((size_t)fsize - headerSize) / recordSize <= (size_t)_gallery.rows;
+        if(!ok) {
+            fclose(f);
+            CV_Error(Error::StsBadArg, filename + " is not a histogram store of this model");
+        }
+        start = (int)(((size_t)fsize - headerSize) / recordSize);
+    } else {
+        f = fopen(filename.c_str(), "wb");
+        if(!f)
+            CV_Error(Error::StsError, "Can not open " + filename + " for writing");
+        ok = fwrite(header, sizeof(int), LBPH_STORE_HEADER_SIZE, f) == LBPH_STORE_HEADER_SIZE;
+    }
+
+    std::vector<uchar> record(recordSize);
+    for(int sampleIdx = start; sampleIdx < _gallery.rows && ok; sampleIdx++) {
+        int label = _labels.at<int>(sampleIdx);
+        memcpy(&record[0], &label, sizeof(int));
+        memcpy(&record[sizeof(int)], _gallery.ptr<float>(sampleIdx), recordSize - sizeof(int));
+        ok = fwrite(&record[0], 1, recordSize, f) == recordSize;
+    }
+    fclose(f);
+    if(!ok)
+        CV_Error(Error::StsError, "Can not write the histograms to " + filename);
+}
+
+void LBPH::loadBinary(const String& filename) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(!f)
+        CV_Error(Error::StsError, "Can not open " + filename);
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    // the gallery points into the buffer (rows of 1 MB, so big stores fit)
+    Mat buf((int)((std::max(fsize, 1L) + (1 << 20) - 1) >> 20), 1 << 20, CV_8UC1);
+    bool ok = fsize > 0 && fread(buf.ptr(), 1, (size_t)fsize, f) == (size_t)fsize;
+    fclose(f);
+    if(!ok)
+        CV_Error(Error::StsError, "Can not read " + filename);
+
+    loadBinary(buf.ptr(), (size_t)fsize);
+    _store = buf;
+}
+
+void LBPH::loadBinary(const uchar* data, size_t size) {
+    CV_Assert(data && ((size_t)data & 3) == 0);
+    const int* header = (const int*)data;
+    const size_t headerSize = sizeof(int) * LBPH_STORE_HEADER_SIZE;
+    if(size < headerSize || header[0] != LBPH_STORE_SIGNATURE || header[1] != LBPH_STORE_VERSION || header[6] <= 0)
+        CV_Error(Error::StsBadArg, "The data is not a histogram store written by LBPHFaceRecognizer");
+    const int length = header[6];
+    const size_t recordSize = sizeof(int) + sizeof(float) * (size_t)length;
+    if((size - headerSize) % recordSize != 0)
+        CV_Error(Error::StsBadArg, "The histogram store is truncated");
+    const int n = (int)((size - headerSize) / recordSize);
+
+    _radius = header[2];
+    _neighbors = header[3];
+    _grid_x = header[4];
+    _grid_y = header[5];
+    _store.release();
+    _histograms.clear();
+    if(n == 0) {
+        _labels.release();
+        _gallery.release();
+        return;
+    }
+    uchar* records = (uchar*)data + headerSize;
+    _labels = Mat(n, 1, CV_32SC1, records, recordSize).clone();
+    _gallery = Mat(n, length, CV_32FC1, records + sizeof(int), recordSize);
+    for(int sampleIdx = 0; sampleIdx < n; sampleIdx++)
+        _histograms.push_back(_gallery.row(sampleIdx));
+}
+
 void LBPH::update(InputArrayOfArrays _in_src, InputArray _in_labels) {
     // got no data, just return
     if(_in_src.total() == 0)
@@ -231,12 +350,68 @@ inline void elbp_(InputArray _src, OutputArray _dst, int radius, int neighbors)
     }
 }
 
+// Fixed-point version of elbp_ for 8-bit images: the interpolation weights are
+// scaled by 2^16 and rounded so they sum to 2^16, so a neighbour equal to the
+// center (the epsilon test of elbp_) compares exactly.
+static void elbp8u(InputArray _src, OutputArray _dst, int radius, int neighbors)
+{
+    const int shift = 16, one = 1 << shift;
+    Mat src = _src.getMat();
+    _dst.create(src.rows-2*radius, src.cols-2*radius, CV_32SC1);
+    Mat dst = _dst.getMat();
+    dst.setTo(0);
+    const int width = dst.cols;
+    for(int n=0; n<neighbors; n++) {
+        // sample points
+        float x = static_cast<float>(radius * cos(2.0*CV_PI*n/static_cast<float>(neighbors)));
+        float y = static_cast<float>(-radius * sin(2.0*CV_PI*n/static_cast<float>(neighbors)));
+        int fx = static_cast<int>(floor(x));
+        int fy = static_cast<int>(floor(y));
+        int cx = static_cast<int>(ceil(x));
+        int cy = static_cast<int>(ceil(y));
+        float ty = y - fy;
+        float tx = x - fx;
+        // fixed-point interpolation weights
+        int w2 = cvRound(tx * (1 - ty) * one);
+        int w3 = cvRound((1 - tx) * ty * one);
+        int w4 = cvRound(tx * ty * one);
+        int w1 = one - w2 - w3 - w4;
+        const int bit = 1 << n;
+        for(int i=radius; i < src.rows-radius;i++) {
+            const uchar* c = src.ptr<uchar>(i) + radius;
+            const uchar* p1 = src.ptr<uchar>(i+fy) + radius + fx;
+            const uchar* p2 = src.ptr<uchar>(i+fy) + radius + cx;
+            const uchar* p3 = src.ptr<uchar>(i+cy) + radius + fx;
+            const uchar* p4 = src.ptr<uchar>(i+cy) + radius + cx;
+            int* d = dst.ptr<int>(i-radius);
+            int j = 0;
+#if CV_SIMD128
+            v_int32x4 vw1 = v_setall_s32(w1), vw2 = v_setall_s32(w2), vw3 = v_setall_s32(w3), vw4 = v_setall_s32(w4);
+            v_int32x4 vbit = v_setall_s32(bit);
+            for(; j <= width - 4; j += 4) {
+                v_int32x4 t = v_reinterpret_as_s32(v_load_expand_q(p1 + j)) * vw1 +
+                              v_reinterpret_as_s32(v_load_expand_q(p2 + j)) * vw2 +
+                              v_reinterpret_as_s32(v_load_expand_q(p3 + j)) * vw3 +
+                              v_reinterpret_as_s32(v_load_expand_q(p4 + j)) * vw4;
+                v_int32x4 center = v_reinterpret_as_s32(v_load_expand_q(c + j)) << shift;
+                v_store(d + j, v_load(d + j) | ((t >= center) & vbit));
+            }
+#endif
+            for(; j < width; j++) {
+                int t = w1*p1[j] + w2*p2[j] + w3*p3[j] + w4*p4[j];
+                if(t >= (c[j] << shift))
+                    d[j] |= bit;
+            }
+        }
+    }
+}
+
 static void elbp(InputArray src, OutputArray dst, int radius, int neighbors)
 {
     int type = src.type();
     switch (type) {
     case CV_8SC1:   elbp_<char>(src,dst, radius, neighbors); break;
-    case CV_8UC1:   elbp_<unsigned char>(src, dst, radius, neighbors); break;
+    case CV_8UC1:   elbp8u(src, dst, radius, neighbors); break;
     case CV_16SC1:  elbp_<short>(src,dst, radius, neighbors); break;
     case CV_16UC1:  elbp_<unsigned short>(src,dst, radius, neighbors); break;
     case CV_32SC1:  elbp_<int>(src,dst, radius, neighbors); break;
@@ -381,8 +556,78 @@ void LBPH::train(InputArrayOfArrays _in_src, InputArray _in_labels, bool preserv
         // add to templates
         _histograms.push_back(p);
     }
+    packHistograms();
+}
+
+void LBPH::packHistograms() {
+    if(_histograms.empty()) {
+        _gallery.release();
+        _store.release();
+        return;
+    }
+    const int length = (int)_histograms[0].total();
+    Mat gallery((int)_histograms.size(), length, CV_32FC1);
+    for(size_t sampleIdx = 0; sampleIdx < _histograms.size(); sampleIdx++) {
+        CV_Assert((int)_histograms[sampleIdx].total() == length && _histograms[sampleIdx].channels() == 1);
+        Mat row = gallery.row((int)sampleIdx);
+        _histograms[sampleIdx].reshape(1, 1).convertTo(row, CV_32FC1);
+    }
+    _gallery = gallery;
+    for(size_t sampleIdx = 0; sampleIdx < _histograms.size(); sampleIdx++)
+        _histograms[sampleIdx] = _gallery.row((int)sampleIdx);
+    // nothing points into a loaded store anymore
+    _store.release();
 }
 
+// Same as compareHist(h1, h2, HISTCMP_CHISQR_ALT), the terms are summed in
+// float over blocks of bins and the blocks in double.
+static double chiSquareAlt(const float* h1, const float* h2, int length)
+{
+    double result = 0;
+    int i = 0;
+#if CV_SIMD128
+    const v_float32x4 veps = v_setall_f32((float)DBL_EPSILON), vzero = v_setzero_f32();
+    while(i <= length - 4) {
+        const int blockEnd = std::min(length - 3, i + 256);
+        v_float32x4 vsum = vzero;
+        for(; i < blockEnd; i += 4) {
+            v_float32x4 a = v_load(h1 + i), b = v_load(h2 + i);
+            v_float32x4 d = a - b, sum = a + b;
+            vsum += v_select(sum > veps, d * d / sum, vzero);
+        }
+        result += v_reduce_sum(vsum);
+    }
+#endif
+    for(; i < length; i++) {
+        double d = h1[i] - h2[i], sum = h1[i] + h2[i];
+        if(std::abs(sum) > DBL_EPSILON)
+            result += d * d / sum;
+    }
+    return result * 2;
+}
+
+// Computes the distances of a query histogram to the rows of the gallery.
+class LBPHPredictBody : public ParallelLoopBody
+{
+public:
+    LBPHPredictBody(const Mat& _gallery, const Mat& _query, std::vector<double>& _dists) :
+        gallery(_gallery), query(_query), dists(_dists)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        for(int sampleIdx = range.start; sampleIdx < range.end; sampleIdx++)
+            dists[sampleIdx] = chiSquareAlt(gallery.ptr<float>(sampleIdx), query.ptr<float>(), gallery.cols);
+    }
+
+private:
+    const Mat& gallery;
+    const Mat& query;
+    std::vector<double>& dists;
+
+    LBPHPredictBody& operator=(const LBPHPredictBody&);
+};
+
 void LBPH::predict(InputArray _src, Ptr<PredictCollector> collector) const {
     if(_histograms.empty()) {
         // throw error if no data (or simply return -1?)
@@ -398,12 +643,17 @@ void LBPH::predict(InputArray _src, Ptr<PredictCollector> collector) const {
             _grid_x, /* grid size x */
             _grid_y, /* grid size y */
             true /* normed histograms */);
+    CV_Assert(query.isContinuous() && (int)query.total() == _gallery.cols);
+    // the distances to the gallery are computed in parallel, then given to the
+    // collector in the gallery order, as the collectors are not thread safe
+    std::vector<double> dists(_gallery.rows);
+    parallel_for_(Range(0, _gallery.rows), LBPHPredictBody(_gallery, query, dists),
+                  std::max(1., _gallery.rows / 256.));
     // find 1-nearest neighbor
     collector->init((int)_histograms.size());
     for (size_t sampleIdx = 0; sampleIdx < _histograms.size(); sampleIdx++) {
-        double dist = compareHist(_histograms[sampleIdx], query, HISTCMP_CHISQR_ALT);
         int label = _labels.at<int>((int)sampleIdx);
-        if (!collector->collect(label, dist))return;
+        if (!collector->collect(label, dists[sampleIdx]))return;
     }
 }
 
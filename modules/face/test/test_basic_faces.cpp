@@ -0,0 +1,60 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+static void checkPredictBatch(const cv::Ptr<cv::face::BasicFaceRecognizer>& model) {
+    std::vector<cv::Mat> images;
+    std::vector<int> labels;
+    for (int i = 0; i < 15; i++) {
+        cv::Mat image(24, 20, CV_8UC1);
+        cv::theRNG().fill(image, cv::RNG::UNIFORM, 0, 256);
+        images.push_back(image);
+        labels.push_back(i / 5);
+    }
+    model->train(images, labels);
+    std::vector<cv::Mat> projections = model->getProjections();
+    ASSERT_EQ(images.size(), projections.size());
+
+    std::vector<cv::Ptr<cv::face::PredictCollector> > collectors;
+    std::vector<cv::Ptr<cv::face::StandardCollector> > standard;
+    for (size_t k = 0; k < images.size(); k++) {
+        standard.push_back(cv::face::StandardCollector::create());
+        collectors.push_back(standard.back());
+    }
+    model->predictBatch(images, collectors);
+
+    for (size_t k = 0; k < images.size(); k++) {
+        cv::Mat q = cv::LDA::subspaceProject(model->getEigenVectors(), model->getMean(), images[k].reshape(1, 1));
+        std::vector<std::pair<int, double> > results = standard[k]->getResults();
+        ASSERT_EQ(images.size(), results.size());
+        for (size_t i = 0; i < results.size(); i++) {
+            double expected = cv::norm(projections[i], q, cv::NORM_L2);
+            EXPECT_EQ(labels[i], results[i].first);
+            EXPECT_NEAR(expected, results[i].second, 1e-3 * (1 + expected));
+        }
+
+        cv::Ptr<cv::face::StandardCollector> single = cv::face::StandardCollector::create();
+        model->predict(images[k], single);
+        EXPECT_EQ(standard[k]->getMinLabel(), single->getMinLabel());
+        EXPECT_NEAR(standard[k]->getMinDist(), single->getMinDist(), 1e-6);
+    }
+
+    // a matrix with a sample per row, and one collector per sample is required
+    cv::Mat rows((int)images.size(), (int)images[0].total(), CV_8UC1);
+    for (int k = 0; k < rows.rows; k++)
+        images[k].reshape(1, 1).copyTo(rows.row(k));
+    model->predictBatch(rows, collectors);
+    EXPECT_EQ(labels[3], standard[3]->getMinLabel());
+    collectors.pop_back();
+    EXPECT_ANY_THROW(model->predictBatch(images, collectors));
+}
+
+TEST(CV_Face_Eigenfaces, predictBatch) {
+    checkPredictBatch(cv::face::createEigenFaceRecognizer());
+}
+
+TEST(CV_Face_Fisherfaces, predictBatch) {
+    checkPredictBatch(cv::face::createFisherFaceRecognizer());
+}
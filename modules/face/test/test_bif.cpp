@@ -65,3 +65,45 @@ TEST(CV_Face_BIF, can_compute) {
     EXPECT_NO_THROW(bif->compute(image, fea));
     EXPECT_EQ(cv::Size(1, 13188), fea.size());
 }
+
+TEST(CV_Face_BIF, spectral_filtering_matches_filter2D) {
+    cv::Mat image(60, 52, CV_32F);
+    cv::theRNG().fill(image, cv::RNG::UNIFORM, -1, 1);
+
+    cv::Ptr<cv::face::BIF> bif = cv::face::createBIF(4, 1);
+    cv::Mat fea;
+    bif->compute(image, fea);
+
+    // the last unit: band 3 of the paper, 17x17 and 19x19 Gabor kernels
+    const int ksizes[2] = {17, 19};
+    const double sigmas[2] = {7.3, 8.2}, wavelens[2] = {9.1, 10.3};
+    cv::Mat resp[2];
+    for (int i = 0; i < 2; ++i) {
+        cv::Mat kernel = cv::getGaborKernel(cv::Size(ksizes[i], ksizes[i]),
+                                            sigmas[i], 0, wavelens[i], 0.3, 0, CV_32F);
+        kernel /= 2 * sigmas[i] * sigmas[i] / 0.3;
+        cv::filter2D(image, resp[i], CV_32F, kernel);
+    }
+    cv::Mat maxResp;
+    cv::max(resp[0], resp[1], maxResp);
+
+    const int half = 6;
+    const int ncells = ((image.rows + half - 1) / half) * ((image.cols + half - 1) / half);
+    ASSERT_LT(ncells, fea.rows);
+    for (int pos = 0, yc = 0; yc < image.rows; yc += half) {
+        for (int xc = 0; xc < image.cols; xc += half, ++pos) {
+            cv::Rect cell(cv::Point(std::max(0, xc - half), std::max(0, yc - half)),
+                          cv::Point(std::min(image.cols, xc + half), std::min(image.rows, yc + half)));
+            cv::Scalar mean, sd;
+            cv::meanStdDev(maxResp(cell), mean, sd);
+            EXPECT_NEAR(sd[0], fea.at<float>(fea.rows - ncells + pos), 1e-4);
+        }
+    }
+
+    // another size does not reuse the cached filter spectra
+    cv::Mat small = image(cv::Rect(0, 0, 40, 36)).clone(), fea2;
+    bif->compute(small, fea2);
+    cv::Mat fea3;
+    bif->compute(image, fea3);
+    EXPECT_EQ(0, cv::norm(fea, fea3, cv::NORM_INF));
+}
@@ -0,0 +1,114 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+TEST(CV_Face_LBPH, predict_matches_compareHist) {
+    std::vector<cv::Mat> images;
+    std::vector<int> labels;
+    for (int i = 0; i < 12; i++) {
+        cv::Mat image(50, 43, CV_8UC1);
+        cv::theRNG().fill(image, cv::RNG::UNIFORM, 0, 256);
+        cv::GaussianBlur(image, image, cv::Size(5, 5), 1.5);
+        images.push_back(image);
+        labels.push_back(i / 3);
+    }
+
+    cv::Ptr<cv::face::LBPHFaceRecognizer> model = cv::face::createLBPHFaceRecognizer();
+    model->train(images, labels);
+    std::vector<cv::Mat> histograms = model->getHistograms();
+    ASSERT_EQ(images.size(), histograms.size());
+
+    for (size_t k = 0; k < images.size(); k++) {
+        cv::Ptr<cv::face::StandardCollector> collector = cv::face::StandardCollector::create();
+        model->predict(images[k], collector);
+        EXPECT_EQ(labels[k], collector->getMinLabel());
+        EXPECT_NEAR(0., collector->getMinDist(), 1e-6);
+
+        std::vector<std::pair<int, double> > results = collector->getResults();
+        ASSERT_EQ(images.size(), results.size());
+        for (size_t i = 0; i < results.size(); i++) {
+            double expected = cv::compareHist(histograms[i], histograms[k], cv::HISTCMP_CHISQR_ALT);
+            EXPECT_EQ(labels[i], results[i].first);
+            EXPECT_NEAR(expected, results[i].second, 1e-4 * (1 + expected));
+        }
+    }
+
+    // the packed gallery keeps growing with updates
+    model->update(std::vector<cv::Mat>(1, images[0]), std::vector<int>(1, 7));
+    ASSERT_EQ(images.size() + 1, model->getHistograms().size());
+    int label = -1;
+    double dist = -1;
+    model->predict(images[0], label, dist);
+    EXPECT_TRUE(label == labels[0] || label == 7);
+    EXPECT_NEAR(0., dist, 1e-6);
+}
+
+TEST(CV_Face_LBPH, binaryStore) {
+    std::vector<cv::Mat> images;
+    std::vector<int> labels;
+    for (int i = 0; i < 9; i++) {
+        cv::Mat image(40, 36, CV_8UC1);
+        cv::theRNG().fill(image, cv::RNG::UNIFORM, 0, 256);
+        images.push_back(image);
+        labels.push_back(i / 3);
+    }
+    std::vector<cv::Mat> first(images.begin(), images.begin() + 6), second(images.begin() + 6, images.end());
+    std::vector<int> firstLabels(labels.begin(), labels.begin() + 6), secondLabels(labels.begin() + 6, labels.end());
+
+    cv::Ptr<cv::face::LBPHFaceRecognizer> model = cv::face::createLBPHFaceRecognizer(1, 8, 4, 4);
+    model->train(first, firstLabels);
+    std::string filename = cvtest::tempfile(".lbph");
+    model->saveBinary(filename);
+    model->update(second, secondLabels);
+    model->saveBinary(filename, true);
+
+    cv::Ptr<cv::face::LBPHFaceRecognizer> loaded = cv::face::createLBPHFaceRecognizer(2, 4, 8, 8);
+    loaded->loadBinary(filename);
+    EXPECT_EQ(1, loaded->getRadius());
+    EXPECT_EQ(8, loaded->getNeighbors());
+    EXPECT_EQ(4, loaded->getGridX());
+    EXPECT_EQ(4, loaded->getGridY());
+
+    std::vector<cv::Mat> expected = model->getHistograms(), actual = loaded->getHistograms();
+    ASSERT_EQ(images.size(), actual.size());
+    for (size_t i = 0; i < actual.size(); i++) {
+        EXPECT_EQ(0, cv::norm(expected[i], actual[i], cv::NORM_INF));
+        EXPECT_EQ(labels[i], loaded->getLabels().at<int>((int)i));
+    }
+    for (size_t k = 0; k < images.size(); k++) {
+        int label = -1;
+        double dist = -1;
+        loaded->predict(images[k], label, dist);
+        EXPECT_EQ(labels[k], label);
+        EXPECT_NEAR(0., dist, 1e-6);
+    }
+
+    // the content of the file works without copying, but not truncated
+    std::vector<int> words;
+    {
+        FILE* f = fopen(filename.c_str(), "rb");
+        ASSERT_TRUE(f != 0);
+        int buf[1024];
+        size_t n;
+        while ((n = fread(buf, sizeof(int), 1024, f)) > 0)
+            words.insert(words.end(), buf, buf + n);
+        fclose(f);
+    }
+    ::remove(filename.c_str());
+    ASSERT_FALSE(words.empty());
+    const uchar* data = (const uchar*)&words[0];
+    cv::Ptr<cv::face::LBPHFaceRecognizer> mapped = cv::face::createLBPHFaceRecognizer();
+    mapped->loadBinary(data, words.size() * sizeof(int));
+    ASSERT_EQ(images.size(), mapped->getHistograms().size());
+    EXPECT_EQ(labels[4], mapped->predict(images[4]));
+    EXPECT_ANY_THROW(mapped->loadBinary(data, words.size() * sizeof(int) - 4));
+
+    // appending to a store of another model fails
+    model->saveBinary(filename);
+    cv::Ptr<cv::face::LBPHFaceRecognizer> other = cv::face::createLBPHFaceRecognizer(1, 8, 5, 5);
+    other->train(first, firstLabels);
+    EXPECT_ANY_THROW(other->saveBinary(filename, true));
+    ::remove(filename.c_str());
+}
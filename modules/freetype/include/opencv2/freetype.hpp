@@ -115,6 +115,38 @@ The function putText renders the specified text string in the image. Symbols tha
         int thickness, int line_type, bool bottomLeftOrigin
     ) = 0;
 
+/** @brief Draws several text strings with the same font size, color and line type.
+
+The function putTexts is equivalent to calling putText() for every string, but it sets the font size
+and prepares the text shaping once for all of them.
+
+@param img Image.
+@param texts Text strings to be drawn.
+@param orgs Bottom-left/Top-left corners of the text strings in the image, one for every string.
+@param fontHeight Drawing font size by pixel unit.
+@param color Text color.
+@param thickness Thickness of the lines used to draw a text when negative, the glyph is filled. Otherwise, the glyph is drawn with this thickness.
+@param line_type Line type. See the line for details.
+@param bottomLeftOrigin When true, the image data origin is at the bottom-left corner. Otherwise, it is at the top-left corner.
+*/
+
+    CV_WRAP virtual void putTexts(
+        InputOutputArray img, const std::vector<String>& texts,
+        const std::vector<Point>& orgs,
+        int fontHeight, Scalar color,
+        int thickness, int line_type, bool bottomLeftOrigin
+    ) = 0;
+
+/** @brief Set the number of rasterized glyphs kept for reuse.
+
+Filled glyphs (negative thickness) are rasterized once for every font size and line type, and kept
+until the least recently used ones exceed the cache size or another font is loaded. The default size is 1024.
+
+@param size maximal number of cached glyphs, 0 disables the cache.
+*/
+
+    CV_WRAP virtual void setGlyphCacheSize( int size ) = 0;
+
 /** @brief Calculates the width and height of a text string.
 
 The function getTextSize calculates and returns the approximate size of a box that contains the specified text.
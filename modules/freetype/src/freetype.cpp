@@ -56,6 +56,11 @@
 #include <hb.h>
 #include <hb-ft.h>
 
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <list>
+#include <map>
+
 namespace cv {
 namespace freetype {
 
@@ -73,10 +78,17 @@ public:
         int fontHeight, Scalar color,
         int thickness, int line_type, bool bottomLeftOrigin
     );
+    void putTexts(
+        InputOutputArray img, const std::vector<String>& texts,
+        const std::vector<Point>& orgs,
+        int fontHeight, Scalar color,
+        int thickness, int line_type, bool bottomLeftOrigin
+    );
     Size getTextSize(
         const String& text, int fontHeight, int thickness,
         CV_OUT int* baseLine
     );
+    void setGlyphCacheSize( int size );
 
 private:
     FT_Library       mLibrary;
@@ -87,18 +99,48 @@ private:
     int              mCtoL;
     hb_font_t        *mHb_font;
 
-    void putTextBitmapMono(
-        InputOutputArray img, const String& text, Point org,
-        int fontHeight, Scalar color,
-        int thickness, int line_type, bool bottomLeftOrigin
-    );
-    void putTextBitmapBlend(
-        InputOutputArray img, const String& text, Point org,
-        int fontHeight, Scalar color,
-        int thickness, int line_type, bool bottomLeftOrigin
+    // Rasterized glyphs of the loaded font, the least recently used one is dropped first.
+    struct GlyphKey
+    {
+        unsigned int index;
+        int          height;
+        bool         blend;
+
+        bool operator<( const GlyphKey& other ) const
+        {
+            if( index  != other.index  ) return index  < other.index;
+            if( height != other.height ) return height < other.height;
+            return blend < other.blend;
+        }
+    };
+    struct GlyphBitmap
+    {
+        Mat   alpha;   // CV_8UC1 for mono bitmaps, CV_8UC3 for gray ones
+        Point bearing;
+        Point advance;
+    };
+    typedef std::list < std::pair < GlyphKey, GlyphBitmap > > GlyphList;
+    typedef std::map < GlyphKey, GlyphList::iterator > GlyphIndex;
+
+    GlyphList        mGlyphs;
+    GlyphIndex       mGlyphIndex;
+    size_t           mGlyphCacheSize;
+    GlyphBitmap      mUncachedGlyph;
+
+    std::vector<uchar> mColorRow;
+    Vec3b              mColorRowValue;
+
+    void clearGlyphCache();
+    bool checkText( InputOutputArray img, int fontHeight, int &line_type );
+    hb_glyph_info_t* shapeText( hb_buffer_t *hb_buffer, const String& text, unsigned int &textLen );
+    const GlyphBitmap& getGlyphBitmap( unsigned int index, int fontHeight, bool blend );
+
+    void putTextBitmap(
+        InputOutputArray img, hb_buffer_t *hb_buffer, const String& text, Point org,
+        int fontHeight, Scalar color, bool blend, bool bottomLeftOrigin
     );
     void putTextOutline(
-        InputOutputArray img, const String& text, Point org,
+        InputOutputArray img, hb_buffer_t *hb_buffer, const String& text, Point org,
         int fontHeight, Scalar color,
         int thickness, int line_type, bool bottomLeftOrigin
     );
@@ -153,6 +195,7 @@ FreeType2Impl::FreeType2Impl()
     mFn.conic_to = FreeType2Impl::coFn;
 
     mIsFaceAvailable = false;
+    mGlyphCacheSize  = 1024;
 }
 
 FreeType2Impl::~FreeType2Impl()
@@ -171,6 +214,7 @@ void FreeType2Impl::loadFontData(String fontFileName, int idx)
         hb_font_destroy (mHb_font);
         CV_Assert(!FT_Done_Face(mFace));
     }
+    clearGlyphCache();
     CV_Assert(!FT_New_Face( mLibrary, fontFileName.c_str(), idx, &(mFace) ) );
     mHb_font = hb_ft_font_create (mFace, NULL);
     CV_Assert( mHb_font != NULL );
@@ -182,10 +226,24 @@ void FreeType2Impl::setSplitNumber(int num ){
     mCtoL        = num;
 }
 
-void FreeType2Impl::putText(
-    InputOutputArray _img, const String& _text, Point _org,
-    int _fontHeight, Scalar _color,
-    int _thickness, int _line_type, bool _bottomLeftOrigin
+void FreeType2Impl::setGlyphCacheSize(int size)
+{
+    CV_Assert( size >= 0 );
+    mGlyphCacheSize = (size_t)size;
+    while( mGlyphs.size() > mGlyphCacheSize ){
+        mGlyphIndex.erase( mGlyphs.back().first );
+        mGlyphs.pop_back();
+    }
+}
+
+void FreeType2Impl::clearGlyphCache()
+{
+    mGlyphs.clear();
+    mGlyphIndex.clear();
+}
+
+bool FreeType2Impl::checkText(
+    InputOutputArray _img, int _fontHeight, int &_line_type
 )
 {
     CV_Assert( mIsFaceAvailable == true );
@@ -199,13 +257,9 @@ void FreeType2Impl::putText(
                ( _line_type == 8 ) );
     CV_Assert( _fontHeight >= 0 );
 
-    if ( _text.empty() )
-    {
-         return;
-    }
     if ( _fontHeight == 0 )
     {
-         return;
+         return false;
     }
 
     if( _line_type == CV_AA && _img.depth() != CV_8U ){
@@ -213,225 +267,287 @@ void FreeType2Impl::putText(
     }
 
     CV_Assert(!FT_Set_Pixel_Sizes( mFace, _fontHeight, _fontHeight ));
+    return true;
+}
+
+void FreeType2Impl::putText(
+    InputOutputArray _img, const String& _text, Point _org,
+    int _fontHeight, Scalar _color,
+    int _thickness, int _line_type, bool _bottomLeftOrigin
+)
+{
+    if ( _text.empty() )
+    {
+         return;
+    }
+    if ( !checkText( _img, _fontHeight, _line_type ) )
+    {
+         return;
+    }
+
+    hb_buffer_t *hb_buffer = hb_buffer_create ();
+    CV_Assert( hb_buffer != NULL );
 
     if( _thickness < 0 ) // CV_FILLED
     {
-        if ( _line_type == CV_AA ) {
-            putTextBitmapBlend( _img, _text, _org, _fontHeight, _color,
-                _thickness, _line_type, _bottomLeftOrigin );
-        }else{
-            putTextBitmapMono( _img, _text, _org, _fontHeight, _color,
-                _thickness, _line_type, _bottomLeftOrigin );
-        }
+        putTextBitmap( _img, hb_buffer, _text, _org, _fontHeight, _color,
+            _line_type == CV_AA, _bottomLeftOrigin );
     }else{
-            putTextOutline( _img, _text, _org, _fontHeight, _color,
-                _thickness, _line_type, _bottomLeftOrigin );
+        putTextOutline( _img, hb_buffer, _text, _org, _fontHeight, _color,
+            _thickness, _line_type, _bottomLeftOrigin );
     }
+    hb_buffer_destroy (hb_buffer);
 }
 
-void FreeType2Impl::putTextOutline(
-   InputOutputArray _img, const String& _text, Point _org,
-   int _fontHeight, Scalar _color,
-   int _thickness, int _line_type, bool _bottomLeftOrigin )
+void FreeType2Impl::putTexts(
+    InputOutputArray _img, const std::vector<String>& _texts,
+    const std::vector<Point>& _orgs,
+    int _fontHeight, Scalar _color,
+    int _thickness, int _line_type, bool _bottomLeftOrigin
+)
 {
+    CV_Assert( _texts.size() == _orgs.size() );
+    if ( _texts.empty() )
+    {
+         return;
+    }
+    if ( !checkText( _img, _fontHeight, _line_type ) )
+    {
+         return;
+    }
+
+    // The size is set and the shaping buffer is created once for all the strings.
     hb_buffer_t *hb_buffer = hb_buffer_create ();
     CV_Assert( hb_buffer != NULL );
 
-    unsigned int textLen;
-    hb_buffer_guess_segment_properties (hb_buffer);
+    for( size_t i = 0 ; i < _texts.size() ; i ++ ){
+        if ( _texts[i].empty() )
+        {
+            continue;
+        }
+        if( _thickness < 0 ) // CV_FILLED
+        {
+            putTextBitmap( _img, hb_buffer, _texts[i], _orgs[i], _fontHeight, _color,
+                _line_type == CV_AA, _bottomLeftOrigin );
+        }else{
+            putTextOutline( _img, hb_buffer, _texts[i], _orgs[i], _fontHeight, _color,
+                _thickness, _line_type, _bottomLeftOrigin );
+        }
+    }
+    hb_buffer_destroy (hb_buffer);
+}
+
+hb_glyph_info_t* FreeType2Impl::shapeText(
+    hb_buffer_t *hb_buffer, const String& _text, unsigned int &textLen )
+{
+    hb_buffer_clear_contents (hb_buffer);
     hb_buffer_add_utf8 (hb_buffer, _text.c_str(), -1, 0, -1);
+    hb_buffer_guess_segment_properties (hb_buffer);
+
+    hb_shape (mHb_font, hb_buffer, NULL, 0);
 
     hb_glyph_info_t *info =
         hb_buffer_get_glyph_infos(hb_buffer,&textLen );
-    CV_Assert( info != NULL );
-
-    hb_shape (mHb_font, hb_buffer, NULL, 0);
+    CV_Assert( info != NULL || textLen == 0 );
+    return info;
+}
 
-    if( _bottomLeftOrigin == true ){
-        _org.y -= _fontHeight;
+const FreeType2Impl::GlyphBitmap& FreeType2Impl::getGlyphBitmap(
+    unsigned int _index, int _fontHeight, bool _blend )
+{
+    GlyphKey key;
+    key.index  = _index;
+    key.height = _fontHeight;
+    key.blend  = _blend;
+
+    GlyphIndex::iterator it = mGlyphIndex.find( key );
+    if( it != mGlyphIndex.end() ){
+        // Move to the front, the least recently used glyph is at the back.
+        mGlyphs.splice( mGlyphs.begin(), mGlyphs, it->second );
+        return it->second->second;
     }
 
-    PathUserData *userData = new PathUserData( _img );
-    userData->mColor     = _color;
-    userData->mCtoL      = mCtoL;
-    userData->mThickness = _thickness;
-    userData->mLine_type = _line_type;
+    CV_Assert( !FT_Load_Glyph(mFace, _index, 0 ) );
+    CV_Assert( !FT_Render_Glyph( mFace->glyph, _blend ? FT_RENDER_MODE_NORMAL : FT_RENDER_MODE_MONO ) );
+    FT_Bitmap    *bmp = &(mFace->glyph->bitmap);
 
-    for( unsigned int i = 0 ; i < textLen ; i ++ ){
-        CV_Assert(!FT_Load_Glyph(mFace, info[i].codepoint, 0 ));
+    GlyphBitmap glyph;
+    glyph.bearing = Point( mFace->glyph->metrics.horiBearingX >> 6,
+                           mFace->glyph->metrics.horiBearingY >> 6 );
+    glyph.advance = Point( mFace->glyph->advance.x >> 6,
+                           mFace->glyph->advance.y >> 6 );
 
-        FT_GlyphSlot slot  = mFace->glyph;
-        FT_Outline outline = slot->outline;
-
-        // Flip
-        FT_Matrix mtx = { 1 << 16 , 0 , 0 , -(1 << 16) };
-        FT_Outline_Transform(&outline, &mtx);
-
-        // Move
-        FT_Outline_Translate(&outline,
-                             cOutlineOffset,
-                             cOutlineOffset );
-        // Move
-        FT_Outline_Translate(&outline,
-                             (FT_Pos)(_org.x << 6),
-                             (FT_Pos)( (_org.y + _fontHeight) << 6) );
-
-        // Draw
-        CV_Assert( !FT_Outline_Decompose(&outline, &mFn, (void*)userData) );
+    // Coverage of every pixel: 0 or 255 for the mono bitmap,
+    // and repeated for 3 channels of the gray one to blend the rows at once.
+    if( _blend ){
+        glyph.alpha.create( (int)bmp->rows, (int)bmp->width, CV_8UC3 );
+        for (int row = 0; row < (int)bmp->rows; row ++) {
+            const uchar* src = bmp->buffer + row * bmp->pitch;
+            uchar* a = glyph.alpha.ptr<uchar>(row);
+            for (int col = 0; col < (int)bmp->width; col ++) {
+                a[col * 3] = a[col * 3 + 1] = a[col * 3 + 2] = src[col];
+            }
+        }
+    }else{
+        glyph.alpha.create( (int)bmp->rows, (int)bmp->width, CV_8UC1 );
+        for (int row = 0; row < (int)bmp->rows; row ++) {
+            const uchar* src = bmp->buffer + row * bmp->pitch;
+            uchar* a = glyph.alpha.ptr<uchar>(row);
+            for (int col = 0; col < (int)bmp->width; col ++) {
+                a[col] = ( ( src[col >> 3] >> ( 7 - ( col & 7 ) ) ) & 0x01 ) ? 255 : 0;
+            }
+        }
+    }
 
-        // Draw (Last Path)
-        mvFn( NULL, (void*)userData );
+    if( mGlyphCacheSize == 0 ){
+        mUncachedGlyph = glyph;
+        return mUncachedGlyph;
+    }
 
-        _org.x += ( mFace->glyph->advance.x ) >> 6;
-        _org.y += ( mFace->glyph->advance.y ) >> 6;
-   }
-   delete userData;
-   hb_buffer_destroy (hb_buffer);
+    if( mGlyphs.size() >= mGlyphCacheSize ){
+        mGlyphIndex.erase( mGlyphs.back().first );
+        mGlyphs.pop_back();
+    }
+    mGlyphs.push_front( std::make_pair( key, glyph ) );
+    mGlyphIndex[key] = mGlyphs.begin();
+    return mGlyphs.front().second;
 }
 
-void FreeType2Impl::putTextBitmapMono(
-   InputOutputArray _img, const String& _text, Point _org,
-   int _fontHeight, Scalar _color,
-   int _thickness, int _line_type, bool _bottomLeftOrigin )
+// dst = (color * alpha + dst * (255 - alpha)) / 255, rounded
+static void blendRow( uchar* dst, const uchar* alpha, const uchar* color, int len )
 {
-    CV_Assert( _thickness < 0 );
-    CV_Assert( _line_type == 4 || _line_type == 8);
+    int k = 0;
+#if CV_SIMD128
+    const v_uint16x8 v255 = v_setall_u16( 255 ), vHalf = v_setall_u16( 128 );
+    for( ; k <= len - 16 ; k += 16 ){
+        v_uint16x8 a0, a1, d0, d1, c0, c1;
+        v_expand( v_load( alpha + k ), a0, a1 );
+        v_expand( v_load( dst   + k ), d0, d1 );
+        v_expand( v_load( color + k ), c0, c1 );
+        v_uint16x8 t0 = c0 * a0 + d0 * ( v255 - a0 ) + vHalf;
+        v_uint16x8 t1 = c1 * a1 + d1 * ( v255 - a1 ) + vHalf;
+        t0 = ( t0 + ( t0 >> 8 ) ) >> 8;
+        t1 = ( t1 + ( t1 >> 8 ) ) >> 8;
+        v_store( dst + k, v_pack( t0, t1 ) );
+    }
+#endif
+    for( ; k < len ; k ++ ){
+        int t = color[k] * alpha[k] + dst[k] * ( 255 - alpha[k] ) + 128;
+        dst[k] = (uchar)( ( t + ( t >> 8 ) ) >> 8 );
+    }
+}
 
+void FreeType2Impl::putTextBitmap(
+   InputOutputArray _img, hb_buffer_t *hb_buffer, const String& _text, Point _org,
+   int _fontHeight, Scalar _color, bool _blend, bool _bottomLeftOrigin )
+{
     Mat dst = _img.getMat();
-    hb_buffer_t *hb_buffer = hb_buffer_create ();
-    CV_Assert( hb_buffer != NULL );
 
     unsigned int textLen;
-    hb_buffer_guess_segment_properties (hb_buffer);
-    hb_buffer_add_utf8 (hb_buffer, _text.c_str(), -1, 0, -1);
-    hb_glyph_info_t *info =
-        hb_buffer_get_glyph_infos(hb_buffer,&textLen );
-    CV_Assert( info != NULL );
-
-    hb_shape (mHb_font, hb_buffer, NULL, 0);
+    hb_glyph_info_t *info = shapeText( hb_buffer, _text, textLen );
 
     _org.y += _fontHeight;
     if( _bottomLeftOrigin == true ){
         _org.y -= _fontHeight;
     }
 
+    const Vec3b color( saturate_cast<uchar>(_color[0]),
+                       saturate_cast<uchar>(_color[1]),
+                       saturate_cast<uchar>(_color[2]) );
+
     for( unsigned int i = 0 ; i < textLen ; i ++ ){
-        CV_Assert( !FT_Load_Glyph(mFace, info[i].codepoint, 0 ) );
-        CV_Assert( !FT_Render_Glyph( mFace->glyph, FT_RENDER_MODE_MONO ) );
-        FT_Bitmap    *bmp = &(mFace->glyph->bitmap);
+        const GlyphBitmap& glyph = getGlyphBitmap( info[i].codepoint, _fontHeight, _blend );
 
         Point gPos = _org;
-        gPos.y -= ( mFace->glyph->metrics.horiBearingY >> 6) ;
-        gPos.x += ( mFace->glyph->metrics.horiBearingX >> 6) ;
-
-        for (int row = 0; row < (int)bmp->rows; row ++) {
-            if( gPos.y + row < 0 ) {
-                continue;
-            }
-            if( gPos.y + row >= dst.rows ) {
-                break;
-            }
-
-            for (int col = 0; col < bmp->pitch; col ++) {
-                int cl = bmp->buffer[ row * bmp->pitch + col ];
-                if ( cl == 0 ) {
-                    continue;
-                }
-                for(int bit = 7; bit >= 0; bit -- ){
-                    if( gPos.x + col * 8 + (7 - bit) < 0 )
-                    {
-                        continue;
-                    }
-                    if( gPos.x + col * 8 + (7 - bit) >= dst.cols )
-                    {
-                        break;
+        gPos.y -= glyph.bearing.y;
+        gPos.x += glyph.bearing.x;
+
+        // The part of the glyph inside the image
+        const int rowStart = std::max( 0, -gPos.y ), rowEnd = std::min( glyph.alpha.rows, dst.rows - gPos.y );
+        const int colStart = std::max( 0, -gPos.x ), colEnd = std::min( glyph.alpha.cols, dst.cols - gPos.x );
+
+        if( rowStart < rowEnd && colStart < colEnd ){
+            if( _blend ){
+                const int len = ( colEnd - colStart ) * 3;
+                // The color repeated along the row, it's kept while the color is the same.
+                if( (int)mColorRow.size() < len || mColorRowValue != color ){
+                    mColorRow.resize( std::max( (size_t)len, mColorRow.size() ) );
+                    for( size_t k = 0 ; k < mColorRow.size() ; k ++ ){
+                        mColorRow[k] = color[k % 3];
                     }
+                    mColorRowValue = color;
+                }
 
-                    if ( ( (cl >> bit) & 0x01 ) == 1 ) {
-                        cv::Vec3b* ptr = dst.ptr<cv::Vec3b>( gPos.y + row,  gPos.x + col * 8 + (7 - bit) );
-                        (*ptr)[0] = _color[0];
-                        (*ptr)[1] = _color[1];
-                        (*ptr)[2] = _color[2];
+                for (int row = rowStart; row < rowEnd; row ++) {
+                    blendRow( dst.ptr<uchar>( gPos.y + row, gPos.x + colStart ),
+                              glyph.alpha.ptr<uchar>( row, colStart ),
+                              &mColorRow[0], len );
+                }
+            }else{
+                for (int row = rowStart; row < rowEnd; row ++) {
+                    const uchar* a = glyph.alpha.ptr<uchar>( row );
+                    cv::Vec3b* ptr = dst.ptr<cv::Vec3b>( gPos.y + row, gPos.x );
+                    for (int col = colStart; col < colEnd; col ++) {
+                        if ( a[col] != 0 ) {
+                            ptr[col] = color;
+                        }
                     }
                 }
             }
         }
 
-        _org.x += ( mFace->glyph->advance.x ) >> 6;
-        _org.y += ( mFace->glyph->advance.y ) >> 6;
+        _org.x += glyph.advance.x;
+        _org.y += glyph.advance.y;
     }
-    hb_buffer_destroy (hb_buffer);
 }
 
-void FreeType2Impl::putTextBitmapBlend(
-   InputOutputArray _img, const String& _text, Point _org,
+void FreeType2Impl::putTextOutline(
+   InputOutputArray _img, hb_buffer_t *hb_buffer, const String& _text, Point _org,
    int _fontHeight, Scalar _color,
    int _thickness, int _line_type, bool _bottomLeftOrigin )
 {
-    CV_Assert( _thickness < 0 );
-    CV_Assert( _line_type == 16 );
-
-    Mat dst = _img.getMat();
-    hb_buffer_t *hb_buffer = hb_buffer_create ();
-    CV_Assert( hb_buffer != NULL );
-
     unsigned int textLen;
-    hb_buffer_guess_segment_properties (hb_buffer);
-    hb_buffer_add_utf8 (hb_buffer, _text.c_str(), -1, 0, -1);
-    hb_glyph_info_t *info =
-        hb_buffer_get_glyph_infos(hb_buffer,&textLen );
-    CV_Assert( info != NULL );
+    hb_glyph_info_t *info = shapeText( hb_buffer, _text, textLen );
 
-    hb_shape (mHb_font, hb_buffer, NULL, 0);
-
-    _org.y += _fontHeight;
     if( _bottomLeftOrigin == true ){
         _org.y -= _fontHeight;
     }
 
+    PathUserData *userData = new PathUserData( _img );
+    userData->mColor     = _color;
+    userData->mCtoL      = mCtoL;
+    userData->mThickness = _thickness;
+    userData->mLine_type = _line_type;
+
     for( unsigned int i = 0 ; i < textLen ; i ++ ){
-        CV_Assert( !FT_Load_Glyph(mFace, info[i].codepoint, 0 ) );
-        CV_Assert( !FT_Render_Glyph( mFace->glyph, FT_RENDER_MODE_NORMAL ) );
-        FT_Bitmap    *bmp = &(mFace->glyph->bitmap);
+        CV_Assert(!FT_Load_Glyph(mFace, info[i].codepoint, 0 ));
 
-        Point gPos = _org;
-        gPos.y -= ( mFace->glyph->metrics.horiBearingY >> 6) ;
-        gPos.x += ( mFace->glyph->metrics.horiBearingX >> 6) ;
+        FT_GlyphSlot slot  = mFace->glyph;
+        FT_Outline outline = slot->outline;
 
-        for (int row = 0; row < (int)bmp->rows; row ++) {
-            if( gPos.y + row < 0 ) {
-                continue;
-            }
-            if( gPos.y + row >= dst.rows ) {
-                break;
-            }
+        // Flip
+        FT_Matrix mtx = { 1 << 16 , 0 , 0 , -(1 << 16) };
+        FT_Outline_Transform(&outline, &mtx);
 
-            for (int col = 0; col < bmp->pitch; col ++) {
-                int cl = bmp->buffer[ row * bmp->pitch + col ];
-                if ( cl == 0 ) {
-                    continue;
-                }
-                if( gPos.x + col < 0 )
-                {
-                    continue;
-                }
-                if( gPos.x + col >= dst.cols )
-                {
-                    break;
-                }
+        // Move
+        FT_Outline_Translate(&outline,
+                             cOutlineOffset,
+                             cOutlineOffset );
+        // Move
+        FT_Outline_Translate(&outline,
+                             (FT_Pos)(_org.x << 6),
+                             (FT_Pos)( (_org.y + _fontHeight) << 6) );
 
-                cv::Vec3b* ptr = dst.ptr<cv::Vec3b>( gPos.y + row , gPos.x + col);
-                double blendAlpha = (double ) cl / 255.0;
+        // Draw
+        CV_Assert( !FT_Outline_Decompose(&outline, &mFn, (void*)userData) );
+
+        // Draw (Last Path)
+        mvFn( NULL, (void*)userData );
 
-                (*ptr)[0] = (double) _color[0] * blendAlpha + (*ptr)[0] * (1.0 - blendAlpha );
-                (*ptr)[1] = (double) _color[1] * blendAlpha + (*ptr)[1] * (1.0 - blendAlpha );
-                (*ptr)[2] = (double) _color[2] * blendAlpha + (*ptr)[2] * (1.0 - blendAlpha );
-            }
-        }
         _org.x += ( mFace->glyph->advance.x ) >> 6;
         _org.y += ( mFace->glyph->advance.y ) >> 6;
-    }
-    hb_buffer_destroy (hb_buffer);
+   }
+   delete userData;
 }
 
 Size FreeType2Impl::getTextSize(
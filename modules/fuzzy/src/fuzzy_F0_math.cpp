@@ -40,6 +40,7 @@
 //M*/
 
 #include "precomp.hpp"
+#include "fuzzy_engine.hpp"
 
 using namespace cv;
 
@@ -299,250 +300,174 @@ void ft::FT02D_FL_process_float(InputArray matrix, const int radius, OutputArray
     merge(oComp, output);
 }
 
-void ft::FT02D_components(InputArray matrix, InputArray kernel, OutputArray components, InputArray mask)
+/* F^0 components of the channel c of the matrix, zero where the kernel does not meet the mask. */
+static void channelComponents(const Mat& matrix, const Mat& kernel, const Mat& mask, int c,
+                              std::vector<ft::detail::KernelTerm>& terms, Mat& components, Mat& denominator)
 {
-    CV_Assert(matrix.channels() == kernel.channels());
-
-    Mat inputMask;
-
-    if (mask.getMat().empty())
-    {
-        inputMask = Mat::ones(matrix.size(), CV_8U);
-    }
-    else
-    {
-        CV_Assert(mask.channels() == 1);
+    Mat matrixChannel, kernelChannel;
+    extractChannel(matrix, matrixChannel, c);
+    extractChannel(kernel, kernelChannel, c);
+    matrixChannel.convertTo(matrixChannel, CV_32F);
 
-        inputMask = mask.getMat();
-    }
+    int radiusX = (kernel.cols - 1) / 2;
+    int radiusY = (kernel.rows - 1) / 2;
 
-    int radiusX = (kernel.cols() - 1) / 2;
-    int radiusY = (kernel.rows() - 1) / 2;
-    int An = matrix.cols() / radiusX + 1;
-    int Bn = matrix.rows() / radiusY + 1;
+    ft::detail::splitKernel(kernelChannel, terms);
 
-    Mat matrixPadded;
-    Mat maskPadded;
+    std::vector<Mat> moments;
+    ft::detail::componentMoments(matrixChannel, mask, radiusX, radiusY, terms, 0, moments);
 
-    copyMakeBorder(matrix, matrixPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
-    copyMakeBorder(inputMask, maskPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
-
-    components.create(Bn, An, CV_MAKETYPE(CV_32F, matrix.channels()));
-
-    Mat componentsMat = components.getMat();
-
-    for (int i = 0; i < An; i++)
+    components.create(moments[0].size(), CV_32F);
+    for (int o = 0; o < components.rows; o++)
     {
-        for (int o = 0; o < Bn; o++)
-        {
-            int centerX = (i * radiusX) + radiusX;
-            int centerY = (o * radiusY) + radiusY;
-            Rect area(centerX - radiusX, centerY - radiusY, kernel.cols(), kernel.rows());
+        const float* numerator = moments[0].ptr<float>(o);
+        const float* sumWeights = moments[1].ptr<float>(o);
+        float* component = components.ptr<float>(o);
 
-            Mat roiImage(matrixPadded, area);
-            Mat roiMask(maskPadded, area);
-            Mat kernelMasked;
+        for (int i = 0; i < components.cols; i++)
+            component[i] = ft::detail::safeDivide(numerator[i], sumWeights[i]);
+    }
+    denominator = moments[1];
+}
 
-            kernel.copyTo(kernelMasked, roiMask);
+void ft::FT02D_components(InputArray matrix, InputArray kernel, OutputArray components, InputArray mask)
+{
+    CV_Assert(matrix.channels() == kernel.channels());
+    CV_Assert(mask.empty() || mask.channels() == 1);
 
-            Mat numerator;
-            multiply(roiImage, kernelMasked, numerator, 1, CV_32F);
+    Mat matrixMat = matrix.getMat(), kernelMat = kernel.getMat(), maskMat = mask.getMat();
 
-            Scalar value;
-            divide(sum(numerator), sum(kernelMasked), value, 1, CV_32F);
+    std::vector<Mat> channels(matrixMat.channels());
+    std::vector<ft::detail::KernelTerm> terms;
+    Mat denominator;
 
-            componentsMat.row(o).col(i).setTo(value);
-        }
+    for (int c = 0; c < matrixMat.channels(); c++)
+    {
+        channelComponents(matrixMat, kernelMat, maskMat, c, terms, channels[c], denominator);
     }
+
+    merge(channels, components);
 }
 
 void ft::FT02D_inverseFT(InputArray components, InputArray kernel, OutputArray output, int width, int height)
 {
     CV_Assert(components.channels() == 1 && kernel.channels() == 1);
 
-    Mat componentsMat = components.getMat();
+    Mat componentsMat;
+    components.getMat().convertTo(componentsMat, CV_32F);
 
     int radiusX = (kernel.cols() - 1) / 2;
     int radiusY = (kernel.rows() - 1) / 2;
-    int outputWidthPadded = radiusX + width + kernel.cols();
-    int outputHeightPadded = radiusY + height + kernel.rows();
-
-    output.create(height, width, CV_32F);
-
-    Mat outputZeroes(outputHeightPadded, outputWidthPadded, CV_32F, Scalar(0));
-
-    for (int i = 0; i < componentsMat.cols; i++)
-    {
-        for (int o = 0; o < componentsMat.rows; o++)
-        {
-            int centerX = (i * radiusX) + radiusX;
-            int centerY = (o * radiusY) + radiusY;
-            Rect area(centerX - radiusX, centerY - radiusY, kernel.cols(), kernel.rows());
 
-            float component = componentsMat.at<float>(o, i);
+    std::vector<ft::detail::KernelTerm> terms;
+    ft::detail::splitKernel(kernel.getMat(), terms);
 
-            Mat inverse;
-            multiply(kernel, component, inverse, 1, CV_32F);
-
-            Mat roiOutput(outputZeroes, area);
-            add(roiOutput, inverse, roiOutput);
-        }
-    }
+    output.create(height, width, CV_32F);
 
-    outputZeroes(Rect(radiusX, radiusY, width, height)).copyTo(output);
+    Mat outputMat = output.getMat();
+    ft::detail::inverseComponents(componentsMat, Mat(), Mat(), radiusX, radiusY, terms, outputMat);
 }
 
 void ft::FT02D_process(InputArray matrix, InputArray kernel, OutputArray output, InputArray mask)
 {
     CV_Assert(matrix.channels() == kernel.channels());
+    CV_Assert(mask.empty() || mask.channels() == 1);
 
-    Mat inputMask;
-
-    if (mask.getMat().empty())
-    {
-        inputMask = Mat::ones(matrix.size(), CV_8U);
-    }
-    else
-    {
-        CV_Assert(mask.channels() == 1);
-
-        inputMask = mask.getMat();
-    }
-
-    int radiusX = (kernel.cols() - 1) / 2;
-    int radiusY = (kernel.rows() - 1) / 2;
-    int An = matrix.cols() / radiusX + 1;
-    int Bn = matrix.rows() / radiusY + 1;
-    int outputWidthPadded = radiusX + matrix.cols() + kernel.cols();
-    int outputHeightPadded = radiusY + matrix.rows() + kernel.rows();
-
-    Mat matrixPadded;
-    Mat maskPadded;
+    Mat matrixMat = matrix.getMat(), kernelMat = kernel.getMat(), maskMat = mask.getMat();
 
-    output.create(matrix.size(), CV_MAKETYPE(CV_32F, matrix.channels()));
+    int radiusX = (kernelMat.cols - 1) / 2;
+    int radiusY = (kernelMat.rows - 1) / 2;
 
-    Mat outputZeroes(outputHeightPadded, outputWidthPadded, output.type(), Scalar(0));
+    std::vector<Mat> channels(matrixMat.channels());
+    std::vector<ft::detail::KernelTerm> terms;
+    Mat components, denominator;
 
-    copyMakeBorder(matrix, matrixPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
-    copyMakeBorder(inputMask, maskPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
-
-    for (int i = 0; i < An; i++)
+    for (int c = 0; c < matrixMat.channels(); c++)
     {
-        for (int o = 0; o < Bn; o++)
-        {
-            int centerX = (i * radiusX) + radiusX;
-            int centerY = (o * radiusY) + radiusY;
-            Rect area(centerX - radiusX, centerY - radiusY, kernel.cols(), kernel.rows());
-
-            Mat roiMatrix(matrixPadded, area);
-            Mat roiMask(maskPadded, area);
-            Mat kernelMasked;
-
-            kernel.copyTo(kernelMasked, roiMask);
-
-            Mat numerator;
-            multiply(roiMatrix, kernelMasked, numerator, 1, CV_32F);
+        channelComponents(matrixMat, kernelMat, maskMat, c, terms, components, denominator);
 
-            Scalar component;
-            divide(sum(numerator), sum(kernelMasked), component, 1, CV_32F);
-
-            Mat inverse;
-            multiply(kernel, component, inverse, 1, CV_32F);
-
-            Mat roiOutput(outputZeroes, area);
-            add(roiOutput, inverse, roiOutput);
-        }
+        channels[c].create(matrixMat.size(), CV_32F);
+        ft::detail::inverseComponents(components, Mat(), Mat(), radiusX, radiusY, terms, channels[c]);
     }
 
-    outputZeroes(Rect(radiusX, radiusY, matrix.cols(), matrix.rows())).copyTo(output);
+    merge(channels, output);
 }
 
 int ft::FT02D_iteration(InputArray matrix, InputArray kernel, OutputArray output, InputArray mask, OutputArray maskOutput, bool firstStop)
 {
     CV_Assert(matrix.channels() == kernel.channels() && mask.channels() == 1);
 
-    int radiusX = (kernel.cols() - 1) / 2;
-    int radiusY = (kernel.rows() - 1) / 2;
-    int An = matrix.cols() / radiusX + 1;
-    int Bn = matrix.rows() / radiusY + 1;
-    int outputWidthPadded = radiusX + matrix.cols() + kernel.cols();
-    int outputHeightPadded = radiusY + matrix.rows() + kernel.rows();
+    Mat matrixMat = matrix.getMat(), kernelMat = kernel.getMat(), maskMat = mask.getMat();
+
+    int radiusX = (kernelMat.cols - 1) / 2;
+    int radiusY = (kernelMat.rows - 1) / 2;
     int undefinedComponents = 0;
 
-    output.create(matrix.size(), CV_MAKETYPE(CV_32F, matrix.channels()));
+    output.create(matrixMat.size(), CV_MAKETYPE(CV_32F, matrixMat.channels()));
     output.setTo(0);
 
     if (maskOutput.needed())
     {
-        maskOutput.create(mask.rows(), mask.cols(), CV_8UC1);
+        maskOutput.create(maskMat.rows, maskMat.cols, CV_8UC1);
         maskOutput.setTo(1);
     }
 
-    Mat matrixOutputMat = Mat::zeros(outputHeightPadded, outputWidthPadded, CV_MAKETYPE(CV_32F, matrix.channels()));
-    Mat maskOutputMat = Mat::ones(outputHeightPadded, outputWidthPadded, CV_8UC1);
-
-    Mat matrixPadded;
-    Mat maskPadded;
+    std::vector<Mat> components(matrixMat.channels());
+    std::vector<std::vector<ft::detail::KernelTerm> > terms(matrixMat.channels());
+    Mat denominator, undefined;
 
-    copyMakeBorder(matrix, matrixPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
-    copyMakeBorder(mask, maskPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
-
-    for (int i = 0; i < An; i++)
+    for (int c = 0; c < matrixMat.channels(); c++)
     {
-        for (int o = 0; o < Bn; o++)
-        {
-            int centerX = (i * radiusX) + radiusX;
-            int centerY = (o * radiusY) + radiusY;
-            Rect area(centerX - radiusX, centerY - radiusY, kernel.cols(), kernel.rows());
+        Mat channelDenominator;
+        channelComponents(matrixMat, kernelMat, maskMat, c, terms[c], components[c], channelDenominator);
 
-            Mat roiMatrix(matrixPadded, area);
-            Mat roiMask(maskPadded, area);
-            Mat kernelMasked;
+        if (c == 0)
+            denominator = channelDenominator;
+    }
 
-            kernel.copyTo(kernelMasked, roiMask);
+    // the components whose kernel does not meet the mask in the first channel
+    compare(denominator, 0, undefined, CMP_EQ);
+    undefinedComponents = countNonZero(undefined);
 
-            Mat numerator;
-            multiply(roiMatrix, kernelMasked, numerator, 1, CV_32F);
+    if (undefinedComponents > 0)
+    {
+        if (firstStop)
+        {
+            return -1;
+        }
 
-            Scalar denominator = sum(kernelMasked);
+        Mat maskOutputMat;
+        if (maskOutput.needed())
+            maskOutputMat = maskOutput.getMat();
 
-            if (denominator[0] == 0)
+        Rect image(0, 0, matrixMat.cols, matrixMat.rows);
+        for (int o = 0; o < undefined.rows; o++)
+        {
+            for (int i = 0; i < undefined.cols; i++)
             {
-                if (firstStop)
-                {
-                    matrixOutputMat = matrixPadded(Rect(radiusX, radiusY, matrix.cols(), matrix.rows()));
-                    maskOutputMat = maskPadded(Rect(radiusX, radiusY, matrix.cols(), matrix.rows()));
-
-                    return -1;
-                }
-                else
-                {
-                    undefinedComponents++;
+                if (!undefined.at<uchar>(o, i))
+                    continue;
 
-                    Mat roiMaskOutput(maskOutputMat, Rect(centerX - radiusX + 1, centerY - radiusY + 1, kernel.cols() - 2, kernel.rows() - 2));
-                    roiMaskOutput.setTo(0);
+                for (int c = 0; c < matrixMat.channels(); c++)
+                    components[c].at<float>(o, i) = 0;
 
-                    continue;
+                if (!maskOutputMat.empty())
+                {
+                    Rect area(i * radiusX - radiusX + 1, o * radiusY - radiusY + 1, kernelMat.cols - 2, kernelMat.rows - 2);
+                    maskOutputMat(area & image).setTo(0);
                 }
             }
-
-            Scalar component;
-            divide(sum(numerator), denominator, component, 1, CV_32F);
-
-            Mat inverse;
-            multiply(kernel, component, inverse, 1, CV_32F);
-
-            Mat roiMatrixOutput(matrixOutputMat, area);
-            add(roiMatrixOutput, inverse, roiMatrixOutput);
         }
     }
 
-    matrixOutputMat(Rect(radiusX, radiusY, matrix.cols(), matrix.rows())).copyTo(output);
-
-    if (maskOutput.needed())
+    std::vector<Mat> channels(matrixMat.channels());
+    for (int c = 0; c < matrixMat.channels(); c++)
     {
-        maskOutputMat(Rect(radiusX, radiusY, matrix.cols(), matrix.rows())).copyTo(maskOutput);
+        channels[c].create(matrixMat.size(), CV_32F);
+        ft::detail::inverseComponents(components[c], Mat(), Mat(), radiusX, radiusY, terms[c], channels[c]);
     }
 
+    merge(channels, output);
+
     return undefinedComponents;
 }
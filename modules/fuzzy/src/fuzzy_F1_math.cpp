@@ -40,6 +40,8 @@
 //M*/
 
 #include "precomp.hpp"
+#include "fuzzy_engine.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 using namespace cv;
 
@@ -50,92 +52,114 @@ void ft::FT12D_components(InputArray matrix, InputArray kernel, OutputArray comp
     FT12D_polynomial(matrix, kernel, c00, c10, c01, components);
 }
 
-void ft::FT12D_polynomial(InputArray matrix, InputArray kernel, OutputArray c00, OutputArray c10, OutputArray c01, OutputArray components, InputArray mask)
+/* F^1 coefficients of a single channel matrix from the moments of its components. */
+static void polynomialCoefficients(const Mat& matrix, const Mat& kernel, const Mat& mask,
+                                   std::vector<ft::detail::KernelTerm>& terms, Mat& c00, Mat& c10, Mat& c01)
 {
-    CV_Assert(matrix.channels() == 1 && kernel.channels() == 1);
+    Mat matrixFloat;
+    matrix.convertTo(matrixFloat, CV_32F);
+
+    int radiusX = (kernel.cols - 1) / 2;
+    int radiusY = (kernel.rows - 1) / 2;
+
+    ft::detail::splitKernel(kernel, terms);
 
-    Mat inputMask;
+    std::vector<Mat> moments;
+    ft::detail::componentMoments(matrixFloat, mask, radiusX, radiusY, terms, 1, moments);
 
-    if (mask.getMat().empty())
+    c00.create(moments[0].size(), CV_32F);
+    c10.create(moments[0].size(), CV_32F);
+    c01.create(moments[0].size(), CV_32F);
+
+    for (int o = 0; o < c00.rows; o++)
     {
-        inputMask = Mat::ones(matrix.size(), CV_8U);
+        for (int i = 0; i < c00.cols; i++)
+        {
+            c00.at<float>(o, i) = ft::detail::safeDivide(moments[0].at<float>(o, i), moments[1].at<float>(o, i));
+            c10.at<float>(o, i) = ft::detail::safeDivide(moments[2].at<float>(o, i), moments[3].at<float>(o, i));
+            c01.at<float>(o, i) = ft::detail::safeDivide(moments[4].at<float>(o, i), moments[5].at<float>(o, i));
+        }
     }
-    else
-    {
-        CV_Assert(mask.channels() == 1);
+}
 
-        inputMask = mask.getMat();
+/* Every component block is c00 + c10 x + c01 y, x and y are zero out of the mask. */
+class PolynomialBlocksInvoker : public ParallelLoopBody
+{
+public:
+    PolynomialBlocksInvoker(const Mat& _c00, const Mat& _c10, const Mat& _c01, const Mat& _mask,
+                            int _radiusX, int _radiusY, Size _kernelSize, Mat& _components) :
+        c00(_c00), c10(_c10), c01(_c01), mask(_mask), radiusX(_radiusX), radiusY(_radiusY), kernelSize(_kernelSize),
+        components(_components)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        for (int o = range.start; o < range.end; o++)
+        {
+            for (int ty = 0; ty < kernelSize.height; ty++)
+            {
+                const int y = o * radiusY - radiusY + ty;
+                const bool rowInside = y >= 0 && y < mask.rows;
+                const uchar* maskRow = rowInside && !mask.empty() ? mask.ptr<uchar>(y) : 0;
+                float* block = components.ptr<float>(o * kernelSize.height + ty);
+
+                for (int i = 0; i < c00.cols; i++)
+                {
+                    const float a00 = c00.at<float>(o, i), a10 = c10.at<float>(o, i), a01 = c01.at<float>(o, i);
+                    const int x0 = i * radiusX - radiusX;
+
+                    for (int tx = 0; tx < kernelSize.width; tx++)
+                    {
+                        const int x = x0 + tx;
+                        const bool inside = rowInside && x >= 0 && x < mask.cols && (!maskRow || maskRow[x]);
+                        const float dx = inside ? (float)(tx - radiusX) : 0.f;
+                        const float dy = inside ? (float)(ty - radiusY) : 0.f;
+
+                        block[i * kernelSize.width + tx] = (a01 * dy + a10 * dx) + a00;
+                    }
+                }
+            }
+        }
     }
 
-    int radiusX = (kernel.cols() - 1) / 2;
-    int radiusY = (kernel.rows() - 1) / 2;
-    int An = matrix.cols() / radiusX + 1;
-    int Bn = matrix.rows() / radiusY + 1;
+private:
+    const Mat& c00;
+    const Mat& c10;
+    const Mat& c01;
+    const Mat& mask;
+    int radiusX, radiusY;
+    Size kernelSize;
+    Mat& components;
 
-    Mat matrixPadded, maskPadded;
-    copyMakeBorder(matrix, matrixPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_ISOLATED, Scalar(0));
-    copyMakeBorder(inputMask, maskPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_ISOLATED, Scalar(0));
+    PolynomialBlocksInvoker& operator=(const PolynomialBlocksInvoker&);
+};
 
-    c00.create(Bn, An, CV_32F);
-    c10.create(Bn, An, CV_32F);
-    c01.create(Bn, An, CV_32F);
-    components.create(Bn * kernel.rows(), An * kernel.cols(), CV_32F);
+void ft::FT12D_polynomial(InputArray matrix, InputArray kernel, OutputArray c00, OutputArray c10, OutputArray c01, OutputArray components, InputArray mask)
+{
+    CV_Assert(matrix.channels() == 1 && kernel.channels() == 1);
+    CV_Assert(mask.empty() || mask.channels() == 1);
 
-    Mat c00Mat = c00.getMat();
-    Mat c10Mat = c10.getMat();
-    Mat c01Mat = c01.getMat();
+    Mat matrixMat = matrix.getMat(), kernelMat = kernel.getMat(), maskMat = mask.getMat();
+
+    int radiusX = (kernelMat.cols - 1) / 2;
+    int radiusY = (kernelMat.rows - 1) / 2;
+
+    std::vector<ft::detail::KernelTerm> terms;
+    Mat c00Mat, c10Mat, c01Mat;
+    polynomialCoefficients(matrixMat, kernelMat, maskMat, terms, c00Mat, c10Mat, c01Mat);
+
+    // the blocks are masked out of the image as well
+    Mat validMask = maskMat.empty() ? Mat(matrixMat.size(), CV_8UC1, Scalar(1)) : maskMat;
+
+    components.create(c00Mat.rows * kernelMat.rows, c00Mat.cols * kernelMat.cols, CV_32F);
     Mat componentsMat = components.getMat();
 
-    Mat vecX, vecY;
-    FT12D_createPolynomMatrixVertical(radiusX, vecX, 1);
-    FT12D_createPolynomMatrixHorizontal(radiusY, vecY, 1);
+    parallel_for_(Range(0, c00Mat.rows), PolynomialBlocksInvoker(c00Mat, c10Mat, c01Mat, validMask, radiusX, radiusY,
+                                                                  kernelMat.size(), componentsMat));
 
-    for (int i = 0; i < An; i++)
-    {
-        for (int o = 0; o < Bn; o++)
-        {
-            int centerX = (i * radiusX) + radiusX;
-            int centerY = (o * radiusY) + radiusY;
-            Rect area(centerX - radiusX, centerY - radiusY, kernel.cols(), kernel.rows());
-
-            Mat roiImage(matrixPadded, area);
-            Mat roiMask(maskPadded, area);
-
-            Mat kernelMasked;
-            kernel.copyTo(kernelMasked, roiMask);
-
-            Mat numerator00, numerator10, numerator01;
-            multiply(roiImage, kernelMasked, numerator00, 1, CV_32F);
-            multiply(numerator00, vecX, numerator10, 1, CV_32F);
-            multiply(numerator00, vecY, numerator01, 1, CV_32F);
-
-            Mat denominator00, denominator10, denominator01;
-            denominator00 = kernelMasked;
-            multiply(vecX.mul(vecX), kernelMasked, denominator10, 1, CV_32F);
-            multiply(vecY.mul(vecY), kernelMasked, denominator01, 1, CV_32F);
-
-            Scalar c00sum, c10sum, c01sum;
-            divide(sum(numerator00), sum(denominator00), c00sum, 1, CV_32F);
-            divide(sum(numerator10), sum(denominator10), c10sum, 1, CV_32F);
-            divide(sum(numerator01), sum(denominator01), c01sum, 1, CV_32F);
-
-            c00Mat.row(o).col(i) = c00sum;
-            c10Mat.row(o).col(i) = c10sum;
-            c01Mat.row(o).col(i) = c01sum;
-
-            Mat vecXMasked, vecYMasked;
-            vecX.copyTo(vecXMasked, roiMask);
-            vecY.copyTo(vecYMasked, roiMask);
-
-            Mat updatedC10, updatedC01;
-            multiply(c10sum, vecXMasked, updatedC10, 1, CV_32F);
-            multiply(c01sum, vecYMasked, updatedC01, 1, CV_32F);
-
-            Mat component(componentsMat, Rect(i * kernelMasked.cols, o * kernelMasked.rows, kernelMasked.cols, kernelMasked.rows));
-            add(updatedC01, updatedC10, component);
-            add(component, c00sum, component);
-        }
-    }
+    c00Mat.copyTo(c00);
+    c10Mat.copyTo(c10);
+    c01Mat.copyTo(c01);
 }
 
 void ft::FT12D_createPolynomMatrixVertical(int radius, OutputArray matrix, const int chn)
@@ -180,126 +204,104 @@ void ft::FT12D_createPolynomMatrixHorizontal(int radius, OutputArray matrix, con
     merge(channels, matrix);
 }
 
-void ft::FT12D_inverseFT(InputArray components, InputArray kernel, OutputArray output, int width, int height)
+/* The components are arbitrary blocks, every output row sums the block rows of the components covering it. */
+class BlocksInverseInvoker : public ParallelLoopBody
 {
-    CV_Assert(components.channels() == 1 && kernel.channels() == 1);
+public:
+    BlocksInverseInvoker(const Mat& _components, const Mat& _kernel, Mat& _output) :
+        components(_components), kernel(_kernel), output(_output)
+    {}
 
-    Mat componentsMat = components.getMat();
+    void operator()(const Range& range) const
+    {
+        const int radiusX = (kernel.cols - 1) / 2;
+        const int radiusY = (kernel.rows - 1) / 2;
+        const int An = components.cols / kernel.cols;
+        const int Bn = components.rows / kernel.rows;
 
-    int radiusX = (kernel.cols() - 1) / 2;
-    int radiusY = (kernel.rows() - 1) / 2;
-    int outputWidthPadded = radiusX + width + kernel.cols();
-    int outputHeightPadded = radiusY + height + kernel.rows();
+        for (int y = range.start; y < range.end; y++)
+        {
+            float* out = output.ptr<float>(y);
+            std::fill(out, out + output.cols, 0.f);
+
+            const int oStart = std::max(0, y / radiusY - 2);
+            const int oEnd = std::min(Bn, y / radiusY + 2);
+
+            for (int o = oStart; o < oEnd; o++)
+            {
+                const int ty = y - (o * radiusY - radiusY);
+                if (ty < 0 || ty >= kernel.rows)
+                    continue;
+
+                const float* kernelRow = kernel.ptr<float>(ty);
+                const float* blockRow = components.ptr<float>(o * kernel.rows + ty);
+
+                for (int i = 0; i < An; i++)
+                {
+                    const int x0 = i * radiusX - radiusX;
+                    const int tStart = std::max(0, -x0), tEnd = std::min(kernel.cols, output.cols - x0);
+                    const float* block = blockRow + i * kernel.cols;
+                    float* dst = out + x0;
+                    int t = tStart;
+#if CV_SIMD128
+                    for (; t <= tEnd - 4; t += 4)
+                        v_store(dst + t, v_load(dst + t) + v_load(kernelRow + t) * v_load(block + t));
+#endif
+                    for (; t < tEnd; t++)
+                        dst[t] += kernelRow[t] * block[t];
+                }
+            }
+        }
+    }
 
-    output.create(height, width, CV_32F);
+private:
+    const Mat& components;
+    const Mat& kernel;
+    Mat& output;
 
-    Mat outputZeroes(outputHeightPadded, outputWidthPadded, CV_32F, Scalar(0));
+    BlocksInverseInvoker& operator=(const BlocksInverseInvoker&);
+};
 
-    for (int i = 0; i < componentsMat.cols / kernel.cols(); i++)
-    {
-        for (int o = 0; o < componentsMat.rows / kernel.rows(); o++)
-        {
-            int centerX = (i * radiusX) + radiusX;
-            int centerY = (o * radiusY) + radiusY;
-            Rect area(centerX - radiusX, centerY - radiusY, kernel.cols(), kernel.rows());
+void ft::FT12D_inverseFT(InputArray components, InputArray kernel, OutputArray output, int width, int height)
+{
+    CV_Assert(components.channels() == 1 && kernel.channels() == 1);
 
-            Mat component(componentsMat, Rect(i * kernel.cols(), o * kernel.rows(), kernel.cols(), kernel.rows()));
+    Mat componentsMat, kernelMat;
+    components.getMat().convertTo(componentsMat, CV_32F);
+    kernel.getMat().convertTo(kernelMat, CV_32F);
 
-            Mat inverse;
-            multiply(kernel, component, inverse, 1, CV_32F);
+    CV_Assert(kernelMat.cols > 1 && kernelMat.rows > 1);
 
-            Mat roiOutput(outputZeroes, area);
-            add(roiOutput, inverse, roiOutput);
-        }
-    }
+    output.create(height, width, CV_32F);
 
-    outputZeroes(Rect(radiusX, radiusY, width, height)).copyTo(output);
+    Mat outputMat = output.getMat();
+    parallel_for_(Range(0, height), BlocksInverseInvoker(componentsMat, kernelMat, outputMat));
 }
 
 void ft::FT12D_process(InputArray matrix, InputArray kernel, OutputArray output, InputArray mask)
 {
     CV_Assert(matrix.channels() == kernel.channels());
+    CV_Assert(mask.empty() || mask.channels() == 1);
 
-    Mat inputMask;
-
-    if (mask.getMat().empty())
-    {
-        inputMask = Mat::ones(matrix.size(), CV_8U);
-    }
-    else
-    {
-        CV_Assert(mask.channels() == 1);
-
-        inputMask = mask.getMat();
-    }
-
-    Mat matrixPadded;
-    Mat maskPadded;
-
-    int radiusX = (kernel.cols() - 1) / 2;
-    int radiusY = (kernel.rows() - 1) / 2;
-    int An = matrix.cols() / radiusX + 1;
-    int Bn = matrix.rows() / radiusY + 1;
-    int outputWidthPadded = radiusX + matrix.cols() + kernel.cols();
-    int outputHeightPadded = radiusY + matrix.rows() + kernel.rows();
-
-    output.create(matrix.size(), CV_MAKETYPE(CV_32F, matrix.channels()));
-
-    Mat outputZeroes(outputHeightPadded, outputWidthPadded, output.type(), Scalar(0));
+    Mat matrixMat = matrix.getMat(), kernelMat = kernel.getMat(), maskMat = mask.getMat();
 
-    copyMakeBorder(matrix, matrixPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
-    copyMakeBorder(inputMask, maskPadded, radiusY, kernel.rows(), radiusX, kernel.cols(), BORDER_CONSTANT, Scalar(0));
+    int radiusX = (kernelMat.cols - 1) / 2;
+    int radiusY = (kernelMat.rows - 1) / 2;
 
-    Mat vecX;
-    Mat vecY;
+    std::vector<Mat> channels(matrixMat.channels());
+    std::vector<ft::detail::KernelTerm> terms;
 
-    ft::FT12D_createPolynomMatrixVertical(radiusX, vecX, matrix.channels());
-    ft::FT12D_createPolynomMatrixHorizontal(radiusY, vecY, matrix.channels());
-
-    for (int i = 0; i < An; i++)
+    for (int c = 0; c < matrixMat.channels(); c++)
     {
-        for (int o = 0; o < Bn; o++)
-        {
-            int centerX = (i * radiusX) + radiusX;
-            int centerY = (o * radiusY) + radiusY;
-            Rect area(centerX - radiusX, centerY - radiusY, kernel.cols(), kernel.rows());
-
-            Mat roiImage(matrixPadded, area);
-            Mat roiMask(maskPadded, area);
-            Mat kernelMasked;
-
-            kernel.copyTo(kernelMasked, roiMask);
+        Mat matrixChannel, kernelChannel, c00, c10, c01;
+        extractChannel(matrixMat, matrixChannel, c);
+        extractChannel(kernelMat, kernelChannel, c);
 
-            Mat numerator00, numerator10, numerator01;
-            multiply(roiImage, kernelMasked, numerator00, 1, CV_32F);
-            multiply(numerator00, vecX, numerator10, 1, CV_32F);
-            multiply(numerator00, vecY, numerator01, 1, CV_32F);
+        polynomialCoefficients(matrixChannel, kernelChannel, maskMat, terms, c00, c10, c01);
 
-            Mat denominator00, denominator10, denominator01;
-            denominator00 = kernelMasked;
-            multiply(vecX.mul(vecX), kernelMasked, denominator10, 1, CV_32F);
-            multiply(vecY.mul(vecY), kernelMasked, denominator01, 1, CV_32F);
-
-            Scalar c00, c10, c01;
-            divide(sum(numerator00), sum(denominator00), c00, 1, CV_32F);
-            divide(sum(numerator10), sum(denominator10), c10, 1, CV_32F);
-            divide(sum(numerator01), sum(denominator01), c01, 1, CV_32F);
-
-            Mat component, updatedC10, updatedC01;
-
-            multiply(c10, vecX, updatedC10, 1, CV_32F);
-            multiply(c01, vecY, updatedC01, 1, CV_32F);
-
-            add(updatedC01, updatedC10, component);
-            add(component, c00, component);
-
-            Mat inverse;
-            multiply(kernel, component, inverse, 1, CV_32F);
-
-            Mat roiOutput(outputZeroes, area);
-            add(roiOutput, inverse, roiOutput);
-        }
+        channels[c].create(matrixMat.size(), CV_32F);
+        ft::detail::inverseComponents(c00, c10, c01, radiusX, radiusY, terms, channels[c]);
     }
 
-    outputZeroes(Rect(radiusX, radiusY, matrix.cols(), matrix.rows())).copyTo(output);
+    merge(channels, output);
 }
@@ -0,0 +1,330 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "precomp.hpp"
+#include "fuzzy_engine.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+namespace cv
+{
+namespace ft
+{
+namespace detail
+{
+
+static void addScaled(float* dst, const float* src, float weight, int length)
+{
+    int x = 0;
+#if CV_SIMD128
+    v_float32x4 w = v_setall_f32(weight);
+    for (; x <= length - 4; x += 4)
+        v_store(dst + x, v_load(dst + x) + v_load(src + x) * w);
+#endif
+    for (; x < length; x++)
+        dst[x] += src[x] * weight;
+}
+
+void splitKernel(const Mat& kernel, std::vector<KernelTerm>& terms)
+{
+    CV_Assert(kernel.channels() == 1);
+
+    Mat K;
+    kernel.convertTo(K, CV_32F);
+    terms.clear();
+
+    double maxVal;
+    Point maxLoc;
+    minMaxLoc(abs(K), 0, &maxVal, 0, &maxLoc);
+    if (maxVal == 0)
+        return;
+
+    // the row and the column of the biggest element, the kernel is separable if their product gives it back
+    KernelTerm separable;
+    separable.ky.resize(K.rows);
+    separable.kx.resize(K.cols);
+    const float pivot = K.at<float>(maxLoc.y, maxLoc.x);
+    for (int x = 0; x < K.cols; x++)
+        separable.kx[x] = K.at<float>(maxLoc.y, x);
+    for (int y = 0; y < K.rows; y++)
+        separable.ky[y] = K.at<float>(y, maxLoc.x) / pivot;
+
+    double error = 0;
+    for (int y = 0; y < K.rows; y++)
+        for (int x = 0; x < K.cols; x++)
+            error = std::max(error, (double)std::abs(K.at<float>(y, x) - separable.ky[y] * separable.kx[x]));
+
+    if (error <= maxVal * FLT_EPSILON)
+    {
+        terms.push_back(separable);
+        return;
+    }
+
+    for (int y = 0; y < K.rows; y++)
+    {
+        if (countNonZero(K.row(y)) == 0)
+            continue;
+
+        KernelTerm term;
+        term.ky.assign(K.rows, 0.f);
+        term.ky[y] = 1.f;
+        term.kx.assign(K.ptr<float>(y), K.ptr<float>(y) + K.cols);
+        terms.push_back(term);
+    }
+}
+
+/* Every component row sums its window rows into full width buffers (the vertical part of the kernel)
+ * and then the buffers are summed at the component columns (the horizontal part).
+ */
+class ComponentMomentsInvoker : public ParallelLoopBody
+{
+public:
+    ComponentMomentsInvoker(const Mat& _values, const Mat& _weights, int _radiusX, int _radiusY,
+                            const std::vector<KernelTerm>& _terms, int _degree, std::vector<Mat>& _moments) :
+        values(_values), weights(_weights), radiusX(_radiusX), radiusY(_radiusY), terms(_terms), degree(_degree),
+        moments(_moments)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const int width = values.cols, height = values.rows;
+        const int An = moments[0].cols;
+        const int nBuffers = degree == 0 ? 2 : 4;
+
+        // Vf0 = sum(ky m f), Vm0 = sum(ky m), Vf1 = sum(ky y m f), Vm2 = sum(ky y^2 m)
+        AutoBuffer<float> _buffers(nBuffers * width);
+        float* Vf0 = _buffers;
+        float* Vm0 = Vf0 + width;
+        float* Vf1 = Vm0 + width;
+        float* Vm2 = Vf1 + width;
+
+        for (int o = range.start; o < range.end; o++)
+        {
+            for (size_t k = 0; k < moments.size(); k++)
+                moments[k].row(o).setTo(0);
+
+            for (size_t k = 0; k < terms.size(); k++)
+            {
+                const std::vector<float>& ky = terms[k].ky;
+                const std::vector<float>& kx = terms[k].kx;
+                const int kh = (int)ky.size(), kw = (int)kx.size();
+
+                std::fill(Vf0, Vf0 + nBuffers * width, 0.f);
+
+                for (int t = 0; t < kh; t++)
+                {
+                    const int y = o * radiusY - radiusY + t;
+                    if (y < 0 || y >= height || ky[t] == 0)
+                        continue;
+
+                    const float dy = (float)(t - radiusY);
+                    addScaled(Vf0, values.ptr<float>(y), ky[t], width);
+                    addScaled(Vm0, weights.ptr<float>(y), ky[t], width);
+                    if (degree > 0)
+                    {
+                        addScaled(Vf1, values.ptr<float>(y), ky[t] * dy, width);
+                        addScaled(Vm2, weights.ptr<float>(y), ky[t] * dy * dy, width);
+                    }
+                }
+
+                for (int i = 0; i < An; i++)
+                {
+                    const int x0 = i * radiusX - radiusX;
+                    const int tStart = std::max(0, -x0), tEnd = std::min(kw, width - x0);
+                    float f00 = 0, m00 = 0, f10 = 0, m20 = 0, f01 = 0, m02 = 0;
+
+                    for (int t = tStart; t < tEnd; t++)
+                    {
+                        const float w = kx[t];
+                        f00 += w * Vf0[x0 + t];
+                        m00 += w * Vm0[x0 + t];
+                    }
+                    moments[0].at<float>(o, i) += f00;
+                    moments[1].at<float>(o, i) += m00;
+
+                    if (degree > 0)
+                    {
+                        for (int t = tStart; t < tEnd; t++)
+                        {
+                            const float w = kx[t], dx = (float)(t - radiusX);
+                            f10 += w * dx * Vf0[x0 + t];
+                            m20 += w * dx * dx * Vm0[x0 + t];
+                            f01 += w * Vf1[x0 + t];
+                            m02 += w * Vm2[x0 + t];
+                        }
+                        moments[2].at<float>(o, i) += f10;
+                        moments[3].at<float>(o, i) += m20;
+                        moments[4].at<float>(o, i) += f01;
+                        moments[5].at<float>(o, i) += m02;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const Mat& values;
+    const Mat& weights;
+    int radiusX, radiusY;
+    const std::vector<KernelTerm>& terms;
+    int degree;
+    std::vector<Mat>& moments;
+
+    ComponentMomentsInvoker& operator=(const ComponentMomentsInvoker&);
+};
+
+void componentMoments(const Mat& matrix, const Mat& mask, int radiusX, int radiusY,
+                      const std::vector<KernelTerm>& terms, int degree, std::vector<Mat>& moments)
+{
+    CV_Assert(matrix.type() == CV_32FC1 && (degree == 0 || degree == 1));
+    CV_Assert(radiusX > 0 && radiusY > 0);
+
+    const int An = matrix.cols / radiusX + 1;
+    const int Bn = matrix.rows / radiusY + 1;
+
+    // m is the indicator of the mask, the values are m * f
+    Mat weights, values;
+    if (mask.empty())
+    {
+        weights = Mat::ones(matrix.size(), CV_32F);
+        values = matrix;
+    }
+    else
+    {
+        CV_Assert(mask.size() == matrix.size() && mask.channels() == 1);
+        Mat indicator;
+        compare(mask, 0, indicator, CMP_NE);
+        indicator.convertTo(weights, CV_32F, 1.0 / 255);
+        multiply(matrix, weights, values);
+    }
+
+    moments.resize(degree == 0 ? 2 : 6);
+    for (size_t k = 0; k < moments.size(); k++)
+        moments[k].create(Bn, An, CV_32F);
+
+    parallel_for_(Range(0, Bn), ComponentMomentsInvoker(values, weights, radiusX, radiusY, terms, degree, moments));
+}
+
+/* Horizontal part of the inverse: A = sum(kx (c00 + c10 x)) and B = sum(kx c01) along every component row. */
+class InverseRowsInvoker : public ParallelLoopBody
+{
+public:
+    InverseRowsInvoker(const Mat& _c00, const Mat& _c10, const Mat& _c01, int _radiusX,
+                       const std::vector<float>& _kx, Mat& _A, Mat& _B) :
+        c00(_c00), c10(_c10), c01(_c01), radiusX(_radiusX), kx(_kx), A(_A), B(_B)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const int width = A.cols, kw = (int)kx.size();
+
+        for (int o = range.start; o < range.end; o++)
+        {
+            float* a = A.ptr<float>(o);
+            std::fill(a, a + width, 0.f);
+            float* b = B.empty() ? 0 : B.ptr<float>(o);
+            if (b)
+                std::fill(b, b + width, 0.f);
+
+            for (int i = 0; i < c00.cols; i++)
+            {
+                const int x0 = i * radiusX - radiusX;
+                const int tStart = std::max(0, -x0), tEnd = std::min(kw, width - x0);
+                const float c = c00.at<float>(o, i);
+                const float cx = c10.empty() ? 0.f : c10.at<float>(o, i);
+
+                for (int t = tStart; t < tEnd; t++)
+                    a[x0 + t] += kx[t] * (cx * (t - radiusX) + c);
+
+                if (b)
+                {
+                    const float cy = c01.at<float>(o, i);
+                    for (int t = tStart; t < tEnd; t++)
+                        b[x0 + t] += kx[t] * cy;
+                }
+            }
+        }
+    }
+
+private:
+    const Mat& c00;
+    const Mat& c10;
+    const Mat& c01;
+    int radiusX;
+    const std::vector<float>& kx;
+    Mat& A;
+    Mat& B;
+
+    InverseRowsInvoker& operator=(const InverseRowsInvoker&);
+};
+
+/* Vertical part of the inverse: every output row sums the rows of the components covering it. */
+class InverseColumnsInvoker : public ParallelLoopBody
+{
+public:
+    InverseColumnsInvoker(const std::vector<Mat>& _A, const std::vector<Mat>& _B, int _radiusY,
+                          const std::vector<KernelTerm>& _terms, Mat& _output) :
+        A(_A), B(_B), radiusY(_radiusY), terms(_terms), output(_output)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        for (int y = range.start; y < range.end; y++)
+        {
+            float* out = output.ptr<float>(y);
+            std::fill(out, out + output.cols, 0.f);
+
+            for (size_t k = 0; k < terms.size(); k++)
+            {
+                const std::vector<float>& ky = terms[k].ky;
+                const int kh = (int)ky.size();
+                const int oStart = std::max(0, y / radiusY - 2);
+                const int oEnd = std::min(A[k].rows, y / radiusY + 2);
+
+                for (int o = oStart; o < oEnd; o++)
+                {
+                    const int t = y - (o * radiusY - radiusY);
+                    if (t < 0 || t >= kh || ky[t] == 0)
+                        continue;
+
+                    addScaled(out, A[k].ptr<float>(o), ky[t], output.cols);
+                    if (!B[k].empty())
+                        addScaled(out, B[k].ptr<float>(o), ky[t] * (t - radiusY), output.cols);
+                }
+            }
+        }
+    }
+
+private:
+    const std::vector<Mat>& A;
+    const std::vector<Mat>& B;
+    int radiusY;
+    const std::vector<KernelTerm>& terms;
+    Mat& output;
+
+    InverseColumnsInvoker& operator=(const InverseColumnsInvoker&);
+};
+
+void inverseComponents(const Mat& c00, const Mat& c10, const Mat& c01, int radiusX, int radiusY,
+                       const std::vector<KernelTerm>& terms, Mat& output)
+{
+    CV_Assert(c00.type() == CV_32FC1 && output.type() == CV_32FC1);
+    CV_Assert(c10.empty() || c10.size() == c00.size());
+    CV_Assert(c01.empty() || c01.size() == c00.size());
+    CV_Assert(radiusX > 0 && radiusY > 0);
+
+    std::vector<Mat> A(terms.size()), B(terms.size());
+    for (size_t k = 0; k < terms.size(); k++)
+    {
+        A[k].create(c00.rows, output.cols, CV_32F);
+        if (!c01.empty())
+            B[k].create(c00.rows, output.cols, CV_32F);
+        parallel_for_(Range(0, c00.rows), InverseRowsInvoker(c00, c10, c01, radiusX, terms[k].kx, A[k], B[k]));
+    }
+
+    parallel_for_(Range(0, output.rows), InverseColumnsInvoker(A, B, radiusY, terms, output));
+}
+
+}
+}
+}
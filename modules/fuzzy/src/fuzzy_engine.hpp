@@ -0,0 +1,49 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_FUZZY_ENGINE_HPP__
+#define __OPENCV_FUZZY_ENGINE_HPP__
+
+#include "precomp.hpp"
+
+namespace cv
+{
+namespace ft
+{
+namespace detail
+{
+    /* The kernel is a sum of the outer products ky * kx of the terms. Kernels created by
+     * ft::createKernel are separable and have a single term, other kernels are split by rows.
+     */
+    struct KernelTerm
+    {
+        std::vector<float> ky, kx;
+    };
+
+    void splitKernel(const Mat& kernel, std::vector<KernelTerm>& terms);
+
+    /* Weighted sums over the components of the (An x Bn) grid with the step of the radius,
+     * x and y are the coordinates relative to the component center:
+     * degree 0: sum(K m f), sum(K m)
+     * degree 1: sum(K m f), sum(K m), sum(K m f x), sum(K m x^2), sum(K m f y), sum(K m y^2)
+     * matrix is CV_32FC1, mask is CV_8UC1 or empty.
+     */
+    void componentMoments(const Mat& matrix, const Mat& mask, int radiusX, int radiusY,
+                          const std::vector<KernelTerm>& terms, int degree, std::vector<Mat>& moments);
+
+    /* output (CV_32FC1, allocated by the caller) = sum of K * (c00 + c10 x + c01 y) over the components,
+     * c10 and c01 may be empty.
+     */
+    void inverseComponents(const Mat& c00, const Mat& c10, const Mat& c01, int radiusX, int radiusY,
+                           const std::vector<KernelTerm>& terms, Mat& output);
+
+    inline float safeDivide(float numerator, float denominator)
+    {
+        return denominator == 0 ? 0.f : (float)((double)numerator / denominator);
+    }
+}
+}
+}
+
+#endif
@@ -231,4 +231,56 @@ TEST(fuzzy_f0, FL_process_float)
     double n1 = cvtest::norm(exp6, res6, NORM_INF);
 
     EXPECT_LE(n1, 1);
-}
\ No newline at end of file
+}
+TEST(fuzzy_f0, nonSeparableKernelMasked)
+{
+    Mat I(37, 53, CV_32F);
+    randu(I, 0, 255);
+    Mat mask(I.size(), CV_8U);
+    randu(mask, 0, 2);
+
+    // not separable, so the kernel rows are processed one by one
+    Mat kernel = (Mat_<float>(5, 5) <<
+        0, 1, 2, 1, 0,
+        1, 2, 3, 2, 1,
+        2, 3, 5, 3, 2,
+        1, 2, 3, 2, 1,
+        0, 1, 1, 1, 0);
+    const int radius = 2;
+
+    Mat O;
+    ft::FT02D_process(I, kernel, O, mask);
+
+    // direct definition of the transform
+    Mat expected(I.size(), CV_32F, Scalar(0));
+    for (int o = 0; o <= I.rows / radius; o++)
+    {
+        for (int i = 0; i <= I.cols / radius; i++)
+        {
+            double numerator = 0, denominator = 0;
+            for (int ty = 0; ty < kernel.rows; ty++)
+            {
+                for (int tx = 0; tx < kernel.cols; tx++)
+                {
+                    int y = (o - 1) * radius + ty, x = (i - 1) * radius + tx;
+                    if (y < 0 || x < 0 || y >= I.rows || x >= I.cols || !mask.at<uchar>(y, x))
+                        continue;
+                    numerator += kernel.at<float>(ty, tx) * I.at<float>(y, x);
+                    denominator += kernel.at<float>(ty, tx);
+                }
+            }
+            float component = denominator == 0 ? 0.f : (float)(numerator / denominator);
+            for (int ty = 0; ty < kernel.rows; ty++)
+            {
+                for (int tx = 0; tx < kernel.cols; tx++)
+                {
+                    int y = (o - 1) * radius + ty, x = (i - 1) * radius + tx;
+                    if (y >= 0 && x >= 0 && y < I.rows && x < I.cols)
+                        expected.at<float>(y, x) += kernel.at<float>(ty, tx) * component;
+                }
+            }
+        }
+    }
+
+    EXPECT_LE(cvtest::norm(expected, O, NORM_INF), 1e-2);
+}
@@ -48,6 +48,64 @@ using namespace std;
 //! @{
 
 
+/** @brief Sequential reader of a dataset block by block along its first dimension.
+
+Created by HDF5::dsreader(). The reader keeps the dataset open and decompresses every chunk only once,
+so large chunked and compressed datasets can be streamed into the same caller buffer.
+ */
+class CV_EXPORTS_W HDF5DatasetReader
+{
+public:
+
+    virtual ~HDF5DatasetReader() {}
+
+    /** @brief Read the next block of the dataset.
+    @param Array output Mat, it is reused when it already has the size and type of the block.
+
+    Returns **false** and leaves Array untouched once the whole dataset was read. The last block can be
+    smaller than the others.
+     */
+    CV_WRAP virtual bool read( OutputArray Array ) = 0;
+
+    /** @brief Move the reader to the given offset along the first dimension.
+     */
+    CV_WRAP virtual void seek( int offset ) = 0;
+
+    /** @brief Returns the amount of entries along the first dimension read by each block.
+     */
+    CV_WRAP virtual int blockSize() const = 0;
+};
+
+/** @brief Buffered writer appending to the end of an **unlimited** dataset.
+
+Created by HDF5::dsappender() for Mat datasets or HDF5::kpappender() for KeyPoint datasets. The appended
+data is collected in memory and written with one dataset extension per block, the blocks are aligned
+to the dataset chunks.
+
+@note Remaining data is written by flush() or when the appender is released, which must happen before
+the hdf5 object is closed.
+ */
+class CV_EXPORTS_W HDF5Appender
+{
+public:
+
+    virtual ~HDF5Appender() {}
+
+    /** @brief Append entries along the first dimension of a Mat dataset.
+    @param Array data to append, the other dimensions and the type must match the dataset.
+     */
+    CV_WRAP virtual void dsappend( InputArray Array ) = 0;
+
+    /** @brief Append keypoints to a KeyPoint dataset.
+    @param keypoints keypoints to append.
+     */
+    CV_WRAP virtual void kpappend( const vector<KeyPoint>& keypoints ) = 0;
+
+    /** @brief Write the buffered data into the dataset.
+     */
+    CV_WRAP virtual void flush() = 0;
+};
+
 /** @brief Hierarchical Data Format version 5 interface.
 
 Notice that module is compiled only when hdf5 is correctly installed.
@@ -476,6 +534,45 @@ public:
     CV_WRAP virtual void dsread( OutputArray Array, String dslabel,
                  const int* dims_offset, const int* dims_counts ) const = 0;
 
+    /** @brief Create a block reader over a dataset.
+    @param dslabel specify the source hdf5 dataset label.
+    @param block_size amount of entries along the first dimension read by each block, by default a block
+           is one chunk for chunked datasets and about 4MB otherwise.
+
+    For chunked datasets the block size is rounded up to a multiple of the chunk size along the first
+    dimension, so that every read covers whole chunks. The chunk cache of the dataset is sized to hold a
+    block, so every chunk is read and decompressed only once even for other block sizes.
+
+    @note If the dataset does not exist an exception will be thrown. Use hlexists() to check dataset presence.
+
+    - Example below reads a dataset block by block:
+    @code{.cpp}
+      // open hdf5 file
+      cv::Ptr<cv::hdf::HDF5> h5io = cv::hdf::open( "mytest.h5" );
+      cv::Ptr<cv::hdf::HDF5DatasetReader> reader = h5io->dsreader( "hilbert" );
+      // the storage of the block is reused
+      cv::Mat block;
+      while ( reader->read( block ) )
+        process( block );
+      // release
+      h5io->close();
+    @endcode
+     */
+    CV_WRAP virtual Ptr<HDF5DatasetReader> dsreader( String dslabel, int block_size = 0 ) const = 0;
+
+    /** @brief Map a dataset into memory without reading it.
+    @param dslabel specify the source hdf5 dataset label.
+
+    Returns a read-only Mat pointing directly into the file pages of the dataset, so large datasets are
+    opened instantly and the processes mapping the same file share them through the page cache.
+    The mapping is released with the last Mat referencing it, closing the file does not invalidate it.
+
+    @note Only uncompressed datasets with contiguous layout, as created by dscreate() without chunking
+    and compression, stored in native byte order can be mapped. Otherwise, and on platforms without
+    mmap(), the dataset is read with dsread(). Writing into a mapped Mat is not allowed.
+     */
+    CV_WRAP virtual Mat dsmap( String dslabel ) const = 0;
+
     /** @brief Fetch keypoint dataset size
     @param kplabel specify the hdf5 dataset label to be measured.
     @param dims_flag will fetch dataset dimensions on H5_GETDIMS, and dataset maximum dimensions on H5_GETMAXDIMS.
@@ -655,6 +752,38 @@ public:
     virtual void kpread( vector<KeyPoint>& keypoints, String kplabel,
              const int offset = H5_NONE, const int counts = H5_NONE ) const = 0;
 
+    /** @brief Create a buffered appender to a Mat dataset.
+    @param dslabel specify the target hdf5 dataset label, created with H5_UNLIMITED first dimension.
+    @param block_size amount of entries along the first dimension written at once, by default a chunk
+           of the dataset, otherwise rounded up to whole chunks.
+
+    The appender starts at the current end of the dataset. It replaces a sequence of dsinsert() calls
+    over growing offsets, each of them extending and writing the dataset.
+
+    - Example below logs the descriptors of a video into an unlimited dataset:
+    @code{.cpp}
+      cv::Ptr<cv::hdf::HDF5> h5io = cv::hdf::open( "mytest.h5" );
+      int chunks[2] = { 1024, 32 };
+      h5io->dscreate( cv::hdf::HDF5::H5_UNLIMITED, 32, CV_8U, "descriptors", cv::hdf::HDF5::H5_NONE, chunks );
+      cv::Ptr<cv::hdf::HDF5Appender> appender = h5io->dsappender( "descriptors" );
+      for ( size_t i = 0; i < frames.size(); i++ )
+        appender->dsappend( descriptors[i] );
+      // write the last block before closing
+      appender.release();
+      h5io->close();
+    @endcode
+     */
+    CV_WRAP virtual Ptr<HDF5Appender> dsappender( String dslabel, int block_size = 0 ) const = 0;
+
+    /** @brief Create a buffered appender to a KeyPoint dataset.
+    @param kplabel specify the target hdf5 dataset label, created with H5_UNLIMITED size.
+    @param block_size amount of keypoints written at once, by default a chunk of the dataset,
+           otherwise rounded up to whole chunks.
+
+    The appender starts at the current end of the dataset, see dsappender().
+     */
+    CV_WRAP virtual Ptr<HDF5Appender> kpappender( String kplabel, int block_size = 0 ) const = 0;
+
 };
 
   /** @brief Open or create hdf5 file
@@ -36,6 +36,12 @@
 
 #include <hdf5.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 namespace cv
@@ -151,6 +157,12 @@ public:
     virtual void dsread( OutputArray Array, String dslabel,
              const int* dims_offset, const int* dims_counts ) const;
 
+    // block reader over dataset
+    virtual Ptr<HDF5DatasetReader> dsreader( String dslabel, int block_size = 0 ) const;
+
+    // map dataset into memory
+    virtual Mat dsmap( String dslabel ) const;
+
     /*
      *  std::vector<cv::KeyPoint>
      */
@@ -174,6 +186,12 @@ public:
     virtual void kpread( vector<KeyPoint>& keypoints, String kplabel,
              const int offset = H5_NONE, const int counts = H5_NONE ) const;
 
+    // buffered append to Mat dataset
+    virtual Ptr<HDF5Appender> dsappender( String dslabel, int block_size = 0 ) const;
+
+    // buffered append to KeyPoint dataset
+    virtual Ptr<HDF5Appender> kpappender( String kplabel, int block_size = 0 ) const;
+
 private:
 
     // store filename
@@ -671,6 +689,289 @@ void HDF5Impl::dsread( OutputArray Array, String dslabel,
     H5Dclose( dsdata );
 }
 
+/*
+ * block reader
+ */
+
+class HDF5DatasetReaderImpl : public HDF5DatasetReader
+{
+public:
+
+    HDF5DatasetReaderImpl( hid_t h5_file_id, String dslabel, int type, int block_size );
+
+    virtual ~HDF5DatasetReaderImpl();
+
+    virtual bool read( OutputArray Array );
+
+    virtual void seek( int offset );
+
+    virtual int blockSize() const { return m_block_size; }
+
+private:
+
+    // OpenCV type of the entries
+    int m_type;
+
+    hid_t m_dsdata, m_dstype, m_fspace;
+
+    // dataset dims
+    vector<hsize_t> m_dims;
+
+    int m_block_size;
+
+    // next entry to read along first dimension
+    hsize_t m_offset;
+};
+
+HDF5DatasetReaderImpl::HDF5DatasetReaderImpl( hid_t h5_file_id, String dslabel,
+                                              int type, int block_size )
+                  : m_type( type )
+{
+    CV_Assert( block_size >= 0 );
+
+    // fetch layout before the dataset is opened with its access properties
+    hid_t dsdata = H5Dopen( h5_file_id, dslabel.c_str(), H5P_DEFAULT );
+
+    hid_t fspace = H5Dget_space( dsdata );
+    int n_dims = H5Sget_simple_extent_ndims( fspace );
+    CV_Assert( n_dims > 0 );
+    m_dims.resize( n_dims );
+    H5Sget_simple_extent_dims( fspace, &m_dims[0], NULL );
+    H5Sclose( fspace );
+
+    vector<hsize_t> chunks( n_dims, 0 );
+    hid_t cparms = H5Dget_create_plist( dsdata );
+    bool chunked = H5Pget_layout( cparms ) == H5D_CHUNKED &&
+                   H5Pget_chunk( cparms, n_dims, &chunks[0] ) == n_dims;
+    H5Pclose( cparms );
+
+    // entry size
+    hid_t dstype = H5Dget_type( dsdata );
+    size_t entry_size = H5Tget_size( dstype );
+    H5Tclose( dstype );
+    H5Dclose( dsdata );
+
+    size_t row_size = entry_size;
+    for ( int d = 1; d < n_dims; d++ )
+      row_size *= (size_t) m_dims[d];
+
+    // block size, chunk aligned when chunked
+    if ( chunked )
+    {
+      const int chunk_rows = (int) chunks[0];
+      if ( block_size == 0 )
+        block_size = chunk_rows;
+      m_block_size = ( ( block_size + chunk_rows - 1 ) / chunk_rows ) * chunk_rows;
+    }
+    else if ( block_size == 0 )
+      m_block_size = (int) std::max( (size_t)1, ( (size_t)4 << 20 ) / std::max( row_size, (size_t)1 ) );
+    else
+      m_block_size = block_size;
+
+    // access properties, the chunk cache holds the chunks of a whole block
+    hid_t dsapl = H5Pcreate( H5P_DATASET_ACCESS );
+    if ( chunked )
+    {
+      size_t chunk_size = entry_size, nchunks = 1;
+      for ( int d = 0; d < n_dims; d++ )
+      {
+        chunk_size *= (size_t) chunks[d];
+        if ( d > 0 )
+          nchunks *= (size_t) ( ( m_dims[d] + chunks[d] - 1 ) / chunks[d] );
+      }
+      nchunks *= (size_t) ( m_block_size / chunks[0] ) + 1;
+      // slots are advised to be a hundred times the cached chunks
+      H5Pset_chunk_cache( dsapl, std::max( (size_t)521, nchunks * 100 + 1 ),
+                          nchunks * chunk_size, 1.0 );
+    }
+
+    // open the HDF5 dataset
+    m_dsdata = H5Dopen( h5_file_id, dslabel.c_str(), dsapl );
+    H5Pclose( dsapl );
+
+    // file data type, as for dsread()
+    m_dstype = H5Dget_type( m_dsdata );
+
+    m_fspace = H5Dget_space( m_dsdata );
+    m_offset = 0;
+}
+
+HDF5DatasetReaderImpl::~HDF5DatasetReaderImpl()
+{
+    H5Sclose( m_fspace );
+    H5Tclose( m_dstype );
+    H5Dclose( m_dsdata );
+}
+
+void HDF5DatasetReaderImpl::seek( int offset )
+{
+    CV_Assert( offset >= 0 && (hsize_t) offset <= m_dims[0] );
+    m_offset = (hsize_t) offset;
+}
+
+bool HDF5DatasetReaderImpl::read( OutputArray Array )
+{
+    // only Mat support
+    CV_Assert( Array.isMat() );
+
+    if ( m_offset >= m_dims[0] )
+      return false;
+
+    const int n_dims = (int) m_dims.size();
+    vector<hsize_t> counts( m_dims ), foffset( n_dims, 0 );
+    counts[0] = std::min( (hsize_t) m_block_size, m_dims[0] - m_offset );
+    foffset[0] = m_offset;
+
+    // reuses the caller storage of the previous blocks
+    vector<int> mxdims( n_dims );
+    for ( int d = 0; d < n_dims; d++ )
+      mxdims[d] = (int) counts[d];
+    Array.create( n_dims, &mxdims[0], m_type );
+    Mat matrix = Array.getMat();
+    CV_Assert( matrix.isContinuous() );
+
+    // whole memory window
+    hid_t dspace = H5Screate_simple( n_dims, &counts[0], NULL );
+
+    // file read window
+    H5Sselect_hyperslab( m_fspace, H5S_SELECT_SET,
+                         &foffset[0], NULL, &counts[0], NULL );
+
+    // read from DS
+    H5Dread( m_dsdata, m_dstype, dspace, m_fspace, H5P_DEFAULT, matrix.data );
+
+    H5Sclose( dspace );
+
+    m_offset += counts[0];
+    return true;
+}
+
+Ptr<HDF5DatasetReader> HDF5Impl::dsreader( String dslabel, int block_size ) const
+{
+    if ( hlexists( dslabel ) == false )
+      CV_Error( Error::StsInternal, "Requested dataset does not exist." );
+
+    return makePtr<HDF5DatasetReaderImpl>( m_h5_file_id, dslabel, dsgettype( dslabel ), block_size );
+}
+
+/*
+ * memory mapping
+ */
+
+#ifndef _WIN32
+
+// owner of the file mappings behind the Mat returned by dsmap()
+class HDF5MapAllocator : public MatAllocator
+{
+public:
+
+    UMatData* allocate( int, const int*, int, void*, size_t*, int, UMatUsageFlags ) const
+    {
+      CV_Error( Error::StsNotImplemented, "Mapped datasets are read-only." );
+      return NULL;
+    }
+
+    bool allocate( UMatData*, int, UMatUsageFlags ) const
+    {
+      return false;
+    }
+
+    void deallocate( UMatData* u ) const
+    {
+      if ( !u )
+        return;
+
+      CV_Assert( u->urefcount == 0 && u->refcount == 0 );
+      munmap( u->origdata, u->size );
+      delete u;
+    }
+};
+
+static MatAllocator* getHDF5MapAllocator()
+{
+    static MatAllocator* allocator = new HDF5MapAllocator();
+    return allocator;
+}
+
+#endif
+
+Mat HDF5Impl::dsmap( String dslabel ) const
+{
+    if ( hlexists( dslabel ) == false )
+      CV_Error( Error::StsInternal, "Requested dataset does not exist." );
+
+    int type = dsgettype( dslabel );
+    vector<int> sizes = dsgetsize( dslabel );
+
+#ifndef _WIN32
+    // open the HDF5 dataset
+    hid_t dsdata = H5Dopen( m_h5_file_id, dslabel.c_str(), H5P_DEFAULT );
+
+    // only contiguous layout is stored in one piece
+    hid_t cparms = H5Dget_create_plist( dsdata );
+    bool mappable = H5Pget_layout( cparms ) == H5D_CONTIGUOUS &&
+                    H5Pget_nfilters( cparms ) == 0;
+    H5Pclose( cparms );
+
+    // the file data must be in native order
+    hid_t dstype = H5Dget_type( dsdata );
+    hid_t dsbase = H5Tget_class( dstype ) == H5T_ARRAY ?
+                   H5Tget_super( dstype ) : H5Tcopy( dstype );
+    hid_t h5type = H5Tget_native_type( dsbase, H5T_DIR_ASCEND );
+    mappable = mappable && H5Tequal( dsbase, h5type ) > 0;
+    H5Tclose( h5type );
+    H5Tclose( dsbase );
+
+    size_t total = H5Tget_size( dstype );
+    for ( size_t d = 0; d < sizes.size(); d++ )
+      total *= (size_t) sizes[d];
+    H5Tclose( dstype );
+
+    // storage must be allocated
+    haddr_t offset = H5Dget_offset( dsdata );
+    mappable = mappable && offset != HADDR_UNDEF && !sizes.empty() && total > 0 &&
+               H5Dget_storage_size( dsdata ) == (hsize_t) total;
+    H5Dclose( dsdata );
+
+    if ( mappable )
+    {
+      // pending writes must reach the file
+      H5Fflush( m_h5_file_id, H5F_SCOPE_LOCAL );
+
+      int fd = ::open( m_hdf5_filename.c_str(), O_RDONLY );
+      if ( fd >= 0 )
+      {
+        // mappings start on page boundaries
+        const size_t page = (size_t) sysconf( _SC_PAGESIZE );
+        const size_t delta = (size_t) offset % page;
+        const size_t length = total + delta;
+        void* base = mmap( NULL, length, PROT_READ, MAP_SHARED, fd, (off_t) ( offset - delta ) );
+        ::close( fd );
+
+        if ( base != MAP_FAILED )
+        {
+          MatAllocator* allocator = getHDF5MapAllocator();
+          UMatData* u = new UMatData( allocator );
+          u->origdata = (uchar*) base;
+          u->data = u->origdata + delta;
+          u->size = length;
+          u->refcount = 1;
+
+          Mat matrix( (int) sizes.size(), &sizes[0], type, u->data );
+          matrix.allocator = allocator;
+          matrix.u = u;
+          return matrix;
+        }
+      }
+    }
+#endif
+
+    // plain read
+    Mat matrix;
+    dsread( matrix, dslabel );
+    return matrix;
+}
+
 // overload
 void HDF5Impl::dswrite( InputArray Array, String dslabel ) const
 {
@@ -1193,6 +1494,175 @@ void HDF5Impl::kpread( vector<KeyPoint>& keypoints, String kplabel,
     H5Dclose( dsdata );
 }
 
+/*
+ * buffered appender
+ */
+
+class HDF5AppenderImpl : public HDF5Appender
+{
+public:
+
+    HDF5AppenderImpl( const HDF5Impl* h5io, String label, bool keypoints, int block_size );
+
+    virtual ~HDF5AppenderImpl() { flush(); }
+
+    virtual void dsappend( InputArray Array );
+
+    virtual void kpappend( const vector<KeyPoint>& keypoints );
+
+    virtual void flush();
+
+private:
+
+    // entries to buffer before the next chunk aligned write
+    int blockCapacity() const
+    {
+      return m_block_size - (int) ( m_offset % m_block_size );
+    }
+
+    const HDF5Impl* m_h5io;
+
+    String m_label;
+
+    bool m_keypoints;
+
+    int m_block_size;
+
+    // dataset end, where the buffer is written
+    int m_offset;
+
+    // buffered entries
+    int m_count;
+
+    // Mat dataset buffer, block_size entries
+    Mat m_buffer;
+    vector<int> m_sizes;
+    size_t m_entry_bytes;
+
+    // KeyPoint dataset buffer
+    vector<KeyPoint> m_kpbuffer;
+};
+
+HDF5AppenderImpl::HDF5AppenderImpl( const HDF5Impl* h5io, String label,
+                                    bool keypoints, int block_size )
+                  : m_h5io( h5io ), m_label( label ), m_keypoints( keypoints ),
+                    m_offset( 0 ), m_count( 0 ), m_entry_bytes( 0 )
+{
+    CV_Assert( block_size >= 0 );
+
+    if ( m_h5io->hlexists( m_label ) == false )
+      CV_Error( Error::StsInternal, "Dataset does not exist." );
+
+    m_sizes = m_h5io->dsgetsize( m_label );
+    vector<int> maxsizes = m_h5io->dsgetsize( m_label, HDF5::H5_GETMAXDIMS );
+    vector<int> chunks = m_h5io->dsgetsize( m_label, HDF5::H5_GETCHUNKDIMS );
+    CV_Assert( !m_sizes.empty() && maxsizes[0] == HDF5::H5_UNLIMITED && !chunks.empty() );
+    CV_Assert( !m_keypoints || m_sizes.size() == 1 );
+
+    // whole chunks along the first dimension
+    if ( block_size == 0 )
+      block_size = chunks[0];
+    m_block_size = ( ( block_size + chunks[0] - 1 ) / chunks[0] ) * chunks[0];
+
+    m_offset = m_sizes[0];
+
+    if ( m_keypoints )
+      m_kpbuffer.reserve( m_block_size );
+    else
+    {
+      vector<int> bsizes( m_sizes );
+      bsizes[0] = m_block_size;
+      m_buffer.create( (int) bsizes.size(), &bsizes[0], m_h5io->dsgettype( m_label ) );
+      m_entry_bytes = m_buffer.total() / m_block_size * m_buffer.elemSize();
+    }
+}
+
+void HDF5AppenderImpl::dsappend( InputArray Array )
+{
+    // only Mat support
+    CV_Assert( Array.isMat() );
+
+    if ( m_keypoints )
+      CV_Error( Error::StsInternal, "KeyPoint dataset, use kpappend()." );
+
+    Mat matrix = Array.getMat();
+    if ( matrix.empty() )
+      return;
+
+    // memory array should be compact
+    CV_Assert( matrix.isContinuous() );
+
+    // entries must match the dataset ones
+    CV_Assert( matrix.type() == m_buffer.type() && matrix.dims == m_buffer.dims );
+    for ( int d = 1; d < matrix.dims; d++ )
+      CV_Assert( matrix.size[d] == m_buffer.size[d] );
+
+    const uchar* src = matrix.ptr();
+    int remaining = matrix.size[0];
+    while ( remaining > 0 )
+    {
+      int count = std::min( remaining, blockCapacity() - m_count );
+      memcpy( m_buffer.ptr() + m_count * m_entry_bytes, src, count * m_entry_bytes );
+      src += count * m_entry_bytes;
+      remaining -= count;
+      m_count += count;
+
+      if ( m_count == blockCapacity() )
+        flush();
+    }
+}
+
+void HDF5AppenderImpl::kpappend( const vector<KeyPoint>& keypoints )
+{
+    if ( !m_keypoints )
+      CV_Error( Error::StsInternal, "Mat dataset, use dsappend()." );
+
+    size_t done = 0;
+    while ( done < keypoints.size() )
+    {
+      size_t count = std::min( keypoints.size() - done, (size_t) ( blockCapacity() - m_count ) );
+      m_kpbuffer.insert( m_kpbuffer.end(), keypoints.begin() + done, keypoints.begin() + done + count );
+      done += count;
+      m_count += (int) count;
+
+      if ( m_count == blockCapacity() )
+        flush();
+    }
+}
+
+void HDF5AppenderImpl::flush()
+{
+    if ( m_count == 0 )
+      return;
+
+    if ( m_keypoints )
+    {
+      m_h5io->kpinsert( m_kpbuffer, m_label, m_offset );
+      m_kpbuffer.clear();
+    }
+    else
+    {
+      vector<Range> ranges( m_buffer.dims, Range::all() );
+      ranges[0] = Range( 0, m_count );
+      vector<int> offsets( m_buffer.dims, 0 );
+      offsets[0] = m_offset;
+      m_h5io->dsinsert( m_buffer( &ranges[0] ), m_label, &offsets[0] );
+    }
+
+    m_offset += m_count;
+    m_count = 0;
+}
+
+Ptr<HDF5Appender> HDF5Impl::dsappender( String dslabel, int block_size ) const
+{
+    return makePtr<HDF5AppenderImpl>( this, dslabel, false, block_size );
+}
+
+Ptr<HDF5Appender> HDF5Impl::kpappender( String kplabel, int block_size ) const
+{
+    return makePtr<HDF5AppenderImpl>( this, kplabel, true, block_size );
+}
+
 CV_EXPORTS Ptr<HDF5> open( String HDF5Filename )
 {
     return makePtr<HDF5Impl>( HDF5Filename );
@@ -522,6 +522,12 @@ class CV_EXPORTS BinaryDescriptor : public Algorithm
    private:
     void InitEDLine_();
 
+    /*Compute gImgWO_, gImg_ and dirImg_ from dxImg_ and dyImg_ in a single pass*/
+    void computeGradients_();
+
+    /*Mark the anchors of row h of gImg_ with 1 in the anchors row, the others with 0*/
+    void markAnchors_( unsigned int h, uchar* anchors ) const;
+
     /*For an input edge chain, find the best fit line, the default chain length is minLineLen_
      *xCors:  In, pointer to the X coordinates of pixel chain;
      *yCors:  In, pointer to the Y coordinates of pixel chain;
@@ -842,6 +848,13 @@ unsigned char binaryConversion( float* f1, float* f2 );
 /* compute LBD descriptors using EDLine extractor */
 int computeLBD( ScaleLines &keyLines, bool useDetectionData = false );
 
+/* compute the LBD descriptor of a single line, bandSums is a buffer for the statistics of the bands */
+void computeLineLBD( OctaveSingleLine& line, bool useDetectionData, float* bandSums ) const;
+
+/* parallel bodies of computeLBD and of the lines detection in OctaveKeyLines */
+class ComputeLBDBody;
+class EDLineOctavesBody;
+
 /* gathers lines in groups using EDLine extractor.
  Each group contains the same line, detected in different octaves */
 int OctaveKeyLines( cv::Mat& image, ScaleLines &keyLines );
@@ -1067,6 +1080,28 @@ are inserted into dataset. The locally stored copy of just inserted descriptors
  */
 void train();
 
+/** @brief Save the dataset, with its hashtables, to a binary file.
+
+@param filename name of the file
+
+@note The file can be loaded later by *loadIndex* without rebuilding the hashtables.
+ */
+void saveIndex( const String& filename ) const;
+
+/** @brief Replace the dataset and internal data with an index saved by *saveIndex*.
+
+@param filename name of the file
+ */
+void loadIndex( const String& filename );
+
+/** @overload
+@param data content of a file saved by *saveIndex*, e.g. mapped in memory by the caller
+@param size size of the data in bytes
+
+@note The data is not copied, it must stay valid as long as the matcher uses it.
+ */
+void loadIndex( const uchar* data, size_t size );
+
 /** @brief Create a BinaryDescriptorMatcher object and return a smart pointer to it.
  */
 static Ptr<BinaryDescriptorMatcher> createBinaryDescriptorMatcher();
@@ -1087,44 +1122,14 @@ BinaryDescriptorMatcher();
 }
 
 private:
-class BucketGroup
-{
-
-public:
-/** constructor */
-BucketGroup(bool needAllocateGroup = true);
-
-/** destructor */
-~BucketGroup();
-
-/** insert data into the bucket */
-void insert( int subindex, UINT32 data );
-
-/** perform a query to the bucket */
-UINT32* query( int subindex, int *size );
-
-/** utility functions */
-void insert_value( std::vector<uint32_t>& vec, int index, UINT32 data );
-void push_value( std::vector<uint32_t>& vec, UINT32 Data );
-
-/** data fields */
-UINT32 empty;
-std::vector<uint32_t> group;
-
-
-};
-
 class SparseHashtable
 {
 
 private:
 
-/** Maximum bits per key before folding the table */
+/** Maximum bits per key of the flat table */
 static const int MAX_B;
 
-/** Bins (each bin is an Array object for duplicates of the same key) */
-std::vector<BucketGroup> table;
-
 public:
 
 /** constructor */
@@ -1136,11 +1141,11 @@ SparseHashtable();
 /** initializer */
 int init( int _b );
 
-/** insert data */
-void insert( UINT64 index, UINT32 data );
+/** build the table from the substrings of b bits starting at bitOffset in every code */
+void build( const cv::Mat& codes, int bitOffset );
 
 /** query data */
-UINT32* query( UINT64 index, int* size );
+const UINT32* query( UINT64 index, int* size ) const;
 
 /** Bits per index */
 int b;
@@ -1148,6 +1153,11 @@ int b;
 /**  Number of bins */
 UINT64 size;
 
+/** Flat buckets: the indices of the codes sorted by bin (ids), and where the bins
+ begin in it (offsets, size + 1 entries) */
+cv::Mat offsets;
+cv::Mat ids;
+
 };
 
 /** class defining a sequence of bits */
@@ -1247,12 +1257,16 @@ UINT64 N;
 /** Table of original full-length codes */
 cv::Mat codes;
 
-/** Counter for eliminating duplicate results (it is not thread safe) */
+/** Counter for eliminating duplicate results (it is not thread safe,
+ batchquery gives every block of queries its own one) */
 Ptr<bitarray> counter;
 
 /** Array of m hashtables */
 std::vector<SparseHashtable> H;
 
+/** Buffer the codes and the hashtables point into, when the index has been loaded from a file */
+cv::Mat storage;
+
 /** Volume of a b-bit Hamming ball with radius s (for s = 0 to d) */
 std::vector<UINT32> xornum;
 
@@ -1279,8 +1293,14 @@ void batchquery( UINT32 * results, UINT32 *numres/*, qstat *stats*/, const cv::M
 
 private:
 
-/** execute a single query */
-void query( UINT32 * results, UINT32* numres/*, qstat *stats*/, UINT8 *q, UINT64 * chunks, UINT32 * res );
+/** execute a single query, with the duplicates counter and the bit positions buffer of the caller */
+void query( UINT32 * results, UINT32* numres/*, qstat *stats*/, UINT8 *q, UINT64 * chunks, UINT32 * res, bitarray& _counter, int* _power );
+
+/** parallel body of batchquery */
+class QueryBody;
+
+/** parallel body of populate */
+class PopulateBody;
 };
 
 /** retrieve Hamming distances */
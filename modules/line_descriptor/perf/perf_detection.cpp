@@ -136,3 +136,53 @@ PERF_TEST_P(file_str, detect_lsd, testing::Values(IMAGES))
   SANITY_CHECK_NOTHING();
 
 }
+
+PERF_TEST_P(file_str, detect_lsd_octaves, testing::Values(IMAGES))
+{
+  std::string filename = getDataPath( GetParam() );
+
+  Mat frame = imread( filename, 1 );
+
+  if( frame.empty() )
+    FAIL()<< "Unable to load source image " << filename;
+
+  std::vector<KeyLine> keylines;
+  Ptr<LSDDetector> lsd = LSDDetector::createLSDDetector();
+
+  TEST_CYCLE()
+  {
+    keylines.clear();
+    lsd->detect( frame, keylines, 2, 4 );
+  }
+
+  SANITY_CHECK_NOTHING();
+
+}
+
+PERF_TEST(LSDDetector, detect_lsd_images)
+{
+  std::vector<Mat> frames;
+  const char* filenames[] = { IMAGES };
+  for ( size_t i = 0; i < sizeof( filenames ) / sizeof( filenames[0] ); i++ )
+  {
+    Mat frame = imread( getDataPath( filenames[i] ), 1 );
+    if( frame.empty() )
+      FAIL()<< "Unable to load source image " << filenames[i];
+
+    /* a batch of a few images, as for a set of views */
+    frames.push_back( frame );
+    frames.push_back( frame.clone() );
+  }
+
+  std::vector<std::vector<KeyLine> > keylines;
+  Ptr<LSDDetector> lsd = LSDDetector::createLSDDetector();
+
+  TEST_CYCLE()
+  {
+    keylines.clear();
+    lsd->detect( frames, keylines, 2, 2 );
+  }
+
+  SANITY_CHECK_NOTHING();
+
+}
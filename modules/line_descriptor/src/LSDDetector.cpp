@@ -51,26 +51,79 @@ Ptr<LSDDetector> LSDDetector::createLSDDetector()
   return Ptr<LSDDetector>( new LSDDetector() );
 }
 
-/* compute Gaussian pyramid of input image */
-void LSDDetector::computeGaussianPyramid( const Mat& image, int numOctaves, int scale )
+/* fill a Gaussian pyramid of numOctaves images */
+static void buildGaussianPyramid( const Mat& image, int numOctaves, int scale, std::vector<Mat>& pyramid )
 {
-  /* clear class fields */
-  gaussianPyrs.clear();
+  pyramid.resize( numOctaves );
 
   /* insert input image into pyramid */
-  cv::Mat currentMat = image.clone();
+  pyramid[0] = image.clone();
   //cv::GaussianBlur( currentMat, currentMat, cv::Size( 5, 5 ), 1 );
-  gaussianPyrs.push_back( currentMat );
 
   /* fill Gaussian pyramid */
   for ( int pyrCounter = 1; pyrCounter < numOctaves; pyrCounter++ )
   {
-    /* compute and store next image in pyramid and its size */
-    pyrDown( currentMat, currentMat, Size( currentMat.cols / scale, currentMat.rows / scale ) );
-    gaussianPyrs.push_back( currentMat );
+    /* compute and store next image in pyramid */
+    const Mat& previous = pyramid[pyrCounter - 1];
+    pyrDown( previous, pyramid[pyrCounter], Size( previous.cols / scale, previous.rows / scale ) );
   }
 }
 
+/* compute Gaussian pyramid of input image */
+void LSDDetector::computeGaussianPyramid( const Mat& image, int numOctaves, int scale )
+{
+  buildGaussianPyramid( image, numOctaves, scale, gaussianPyrs );
+}
+
+/* Runs LSD on the octaves in parallel, with an extractor for each of them */
+class LSDOctavesBody : public ParallelLoopBody
+{
+ public:
+  LSDOctavesBody( const std::vector<Mat>& _pyramid, std::vector<std::vector<Vec4f> >& _lines ) :
+      pyramid( _pyramid ), lines( _lines )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    cv::Ptr<cv::LineSegmentDetector> ls = cv::createLineSegmentDetector( cv::LSD_REFINE_ADV );
+    for ( int i = range.start; i < range.end; i++ )
+      ls->detect( pyramid[i], lines[i] );
+  }
+
+ private:
+  const std::vector<Mat>& pyramid;
+  std::vector<std::vector<Vec4f> >& lines;
+
+  LSDOctavesBody& operator=( const LSDOctavesBody& );
+};
+
+/* Detects the lines of several images in parallel, the masks are checked by the single image detection */
+class LSDImagesBody : public ParallelLoopBody
+{
+ public:
+  LSDImagesBody( LSDDetector& _lsd, const std::vector<Mat>& _images, std::vector<std::vector<KeyLine> >& _keylines, int _scale,
+                 int _numOctaves, const std::vector<Mat>& _masks ) :
+      lsd( _lsd ), images( _images ), keylines( _keylines ), scale( _scale ), numOctaves( _numOctaves ), masks( _masks )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    for ( int i = range.start; i < range.end; i++ )
+      lsd.detect( images[i], keylines[i], scale, numOctaves, masks.empty() ? Mat() : masks[i] );
+  }
+
+ private:
+  LSDDetector& lsd;
+  const std::vector<Mat>& images;
+  std::vector<std::vector<KeyLine> >& keylines;
+  int scale, numOctaves;
+  const std::vector<Mat>& masks;
+
+  LSDImagesBody& operator=( const LSDImagesBody& );
+};
+
 /* check lines' extremes */
 inline void checkLineExtremes( cv::Vec4f& extremes, cv::Size imageSize )
 {
@@ -114,15 +167,13 @@ void LSDDetector::detect( const Mat& image, CV_OUT std::vector<KeyLine>& keyline
 void LSDDetector::detect( const std::vector<Mat>& images, std::vector<std::vector<KeyLine> >& keylines, int scale, int numOctaves,
                           const std::vector<Mat>& masks ) const
 {
-  /* detect lines from each image */
-  for ( size_t counter = 0; counter < images.size(); counter++ )
-  {
-    if( masks[counter].data != NULL && ( masks[counter].size() != images[counter].size() || masks[counter].type() != CV_8UC1 ) )
-      CV_Error( Error::StsBadArg, "Masks error while detecting lines: please check their dimensions and that data types are CV_8UC1" );
+  if( !masks.empty() && masks.size() != images.size() )
+    CV_Error( Error::StsBadArg, "Masks error while detecting lines: there should be a mask for each image" );
 
-    else
-      detectImpl( images[counter], keylines[counter], numOctaves, scale, masks[counter] );
-  }
+  /* detect lines from each image, the single image detection does not modify the detector */
+  keylines.resize( images.size() );
+  LSDDetector *lsd = const_cast<LSDDetector*>( this );
+  parallel_for_( Range( 0, (int) images.size() ), LSDImagesBody( *lsd, images, keylines, scale, numOctaves, masks ) );
 }
 
 /* implementation of line detection */
@@ -138,38 +189,31 @@ void LSDDetector::detectImpl( const Mat& imageSrc, std::vector<KeyLine>& keyline
   if( image.depth() != 0 )
     CV_Error( Error::BadDepth, "Error, depth image!= 0" );
 
-  /* create a pointer to self */
-  LSDDetector *lsd = const_cast<LSDDetector*>( this );
-
-  /* compute Gaussian pyramids */
-  lsd->computeGaussianPyramid( image, numOctaves, scale );
-
-  /* create an LSD extractor */
-  cv::Ptr<cv::LineSegmentDetector> ls = cv::createLineSegmentDetector( cv::LSD_REFINE_ADV );
-
-  /* prepare a vector to host extracted segments */
-  std::vector<std::vector<cv::Vec4f> > lines_lsd;
+  /* compute Gaussian pyramids, locally since the images may be processed in parallel */
+  std::vector<Mat> pyramid;
+  buildGaussianPyramid( image, numOctaves, scale, pyramid );
 
   /* extract lines */
-  for ( int i = 0; i < numOctaves; i++ )
-  {
-    std::vector<Vec4f> octave_lines;
-    ls->detect( gaussianPyrs[i], octave_lines );
-    lines_lsd.push_back( octave_lines );
-  }
+  std::vector<std::vector<cv::Vec4f> > lines_lsd( numOctaves );
+  parallel_for_( Range( 0, numOctaves ), LSDOctavesBody( pyramid, lines_lsd ) );
+
+  /* create keylines, in storage preallocated after the ones already in the vector */
+  size_t first = keylines.size(), total = 0;
+  for ( int octaveIdx = 0; octaveIdx < numOctaves; octaveIdx++ )
+    total += lines_lsd[octaveIdx].size();
+  keylines.resize( first + total );
 
-  /* create keylines */
   int class_counter = -1;
   for ( int octaveIdx = 0; octaveIdx < (int) lines_lsd.size(); octaveIdx++ )
   {
     float octaveScale = pow( (float)scale, octaveIdx );
     for ( int k = 0; k < (int) lines_lsd[octaveIdx].size(); k++ )
     {
-      KeyLine kl;
+      KeyLine& kl = keylines[first + class_counter + 1];
       cv::Vec4f extremes = lines_lsd[octaveIdx][k];
 
       /* check data validity */
-      checkLineExtremes( extremes, gaussianPyrs[octaveIdx].size() );
+      checkLineExtremes( extremes, pyramid[octaveIdx].size() );
 
       /* fill KeyLine's fields */
       kl.startPointX = extremes[0] * octaveScale;
@@ -183,32 +227,29 @@ void LSDDetector::detectImpl( const Mat& imageSrc, std::vector<KeyLine>& keyline
       kl.lineLength = (float) sqrt( pow( extremes[0] - extremes[2], 2 ) + pow( extremes[1] - extremes[3], 2 ) );
 
       /* compute number of pixels covered by line */
-      LineIterator li( gaussianPyrs[octaveIdx], Point2f( extremes[0], extremes[1] ), Point2f( extremes[2], extremes[3] ) );
+      LineIterator li( pyramid[octaveIdx], Point2f( extremes[0], extremes[1] ), Point2f( extremes[2], extremes[3] ) );
       kl.numOfPixels = li.count;
 
       kl.angle = atan2( ( kl.endPointY - kl.startPointY ), ( kl.endPointX - kl.startPointX ) );
       kl.class_id = ++class_counter;
       kl.octave = octaveIdx;
       kl.size = ( kl.endPointX - kl.startPointX ) * ( kl.endPointY - kl.startPointY );
-      kl.response = kl.lineLength / max( gaussianPyrs[octaveIdx].cols, gaussianPyrs[octaveIdx].rows );
+      kl.response = kl.lineLength / max( pyramid[octaveIdx].cols, pyramid[octaveIdx].rows );
       kl.pt = Point2f( ( kl.endPointX + kl.startPointX ) / 2, ( kl.endPointY + kl.startPointY ) / 2 );
-
-      keylines.push_back( kl );
     }
   }
 
-  /* delete undesired KeyLines, according to input mask */
+  /* delete undesired KeyLines, according to input mask, keeping the order of the others */
   if( !mask.empty() )
   {
-    for ( size_t keyCounter = 0; keyCounter < keylines.size(); keyCounter++ )
+    size_t kept = first;
+    for ( size_t keyCounter = first; keyCounter < keylines.size(); keyCounter++ )
     {
-      KeyLine kl = keylines[keyCounter];
-      if( mask.at<uchar>( (int) kl.startPointY, (int) kl.startPointX ) == 0 && mask.at<uchar>( (int) kl.endPointY, (int) kl.endPointX ) == 0 )
-      {
-        keylines.erase( keylines.begin() + keyCounter );
-        keyCounter--;
-      }
+      const KeyLine& kl = keylines[keyCounter];
+      if( mask.at<uchar>( (int) kl.startPointY, (int) kl.startPointX ) != 0 || mask.at<uchar>( (int) kl.endPointY, (int) kl.endPointX ) != 0 )
+        keylines[kept++] = kl;
     }
+    keylines.resize( kept );
   }
 
 }
@@ -40,6 +40,7 @@
  //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #ifdef _MSC_VER
     #if (_MSC_VER <= 1700)
@@ -369,6 +370,32 @@ void BinaryDescriptor::computeGaussianPyramid( const Mat& image, const int numOc
   }
 }
 
+/* Computes the derivatives of the octaves in parallel */
+class SobelOctavesBody : public ParallelLoopBody
+{
+ public:
+  SobelOctavesBody( const std::vector<cv::Mat>& _octaveImages, std::vector<cv::Mat>& _dxImgs, std::vector<cv::Mat>& _dyImgs ) :
+      octaveImages( _octaveImages ), dxImgs( _dxImgs ), dyImgs( _dyImgs )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    for ( int sobelCnt = range.start; sobelCnt < range.end; sobelCnt++ )
+    {
+      cv::Sobel( octaveImages[sobelCnt], dxImgs[sobelCnt], CV_16SC1, 1, 0, 3 );
+      cv::Sobel( octaveImages[sobelCnt], dyImgs[sobelCnt], CV_16SC1, 0, 1, 3 );
+    }
+  }
+
+ private:
+  const std::vector<cv::Mat>& octaveImages;
+  std::vector<cv::Mat>& dxImgs;
+  std::vector<cv::Mat>& dyImgs;
+
+  SobelOctavesBody& operator=( const SobelOctavesBody& );
+};
+
 /* compute Sobel's derivatives */
 void BinaryDescriptor::computeSobel( const cv::Mat& image, const int numOctaves )
 {
@@ -387,14 +414,7 @@ void BinaryDescriptor::computeSobel( const cv::Mat& image, const int numOctaves
   dyImg_vector.resize( octaveImages.size() );
 
   /* compute derivatives */
-  for ( size_t sobelCnt = 0; sobelCnt < octaveImages.size(); sobelCnt++ )
-  {
-    dxImg_vector[sobelCnt].create( images_sizes[sobelCnt].height, images_sizes[sobelCnt].width, CV_16SC1 );
-    dyImg_vector[sobelCnt].create( images_sizes[sobelCnt].height, images_sizes[sobelCnt].width, CV_16SC1 );
-
-    cv::Sobel( octaveImages[sobelCnt], dxImg_vector[sobelCnt], CV_16SC1, 1, 0, 3 );
-    cv::Sobel( octaveImages[sobelCnt], dyImg_vector[sobelCnt], CV_16SC1, 0, 1, 3 );
-  }
+  parallel_for_( Range( 0, (int) octaveImages.size() ), SobelOctavesBody( octaveImages, dxImg_vector, dyImg_vector ) );
 }
 
 /* utility function for conversion of an LBD descriptor to its binary representation */
@@ -677,7 +697,7 @@ void BinaryDescriptor::computeImpl( const Mat& imageSrc, std::vector<KeyLine>& k
         float* pointerToRow = descriptors.ptr<float>( originalIndex );
 
         /* get LBD data */
-        std::vector<float> desVec = sl[k][lineC].descriptor;
+        const std::vector<float>& desVec = sl[k][lineC].descriptor;
 
         for ( int count = 0; count < (int) desVec.size(); count++ )
         {
@@ -691,6 +711,29 @@ void BinaryDescriptor::computeImpl( const Mat& imageSrc, std::vector<KeyLine>& k
 
 }
 
+/* Extracts the lines of the octaves in parallel, every octave has its own EDLineDetector */
+class BinaryDescriptor::EDLineOctavesBody : public ParallelLoopBody
+{
+ public:
+  EDLineOctavesBody( BinaryDescriptor& _bd, std::vector<cv::Mat>& _blurs, std::vector<int>& _status ) :
+      bd( _bd ), blurs( _blurs ), status( _status )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    for ( int octaveCount = range.start; octaveCount < range.end; octaveCount++ )
+      status[octaveCount] = bd.edLineVec_[octaveCount]->EDline( blurs[octaveCount] );
+  }
+
+ private:
+  BinaryDescriptor& bd;
+  std::vector<cv::Mat>& blurs;
+  std::vector<int>& status;
+
+  EDLineOctavesBody& operator=( const EDLineOctavesBody& );
+};
+
 int BinaryDescriptor::OctaveKeyLines( cv::Mat& image, ScaleLines &keyLines )
 {
 
@@ -702,28 +745,19 @@ int BinaryDescriptor::OctaveKeyLines( cv::Mat& image, ScaleLines &keyLines )
   float curSigma2 = 1.0;  //[sqrt(2)]^0=1;
   double factor = sqrt( 2.0 );  //the down sample factor between connective two octave images
 
+  /* matrices storing results from blurring processes */
+  std::vector<cv::Mat> blurs( params.numOfOctave_ );
+
   /* loop over number of octaves */
   for ( int octaveCount = 0; octaveCount < params.numOfOctave_; octaveCount++ )
   {
-    /* matrix storing results from blurring processes */
-    cv::Mat blur;
-
     /* apply Gaussian blur */
     float increaseSigma = sqrt( curSigma2 - preSigma2 );
-    cv::GaussianBlur( image, blur, cv::Size( params.ksize_, params.ksize_ ), increaseSigma );
-    images_sizes[octaveCount] = blur.size();
-
-    /* for current octave, extract lines */
-    if( ( edLineVec_[octaveCount]->EDline( blur ) ) != 1 )
-    {
-      return -1;
-    }
-
-    /* update number of total extracted lines */
-    numOfFinalLine += edLineVec_[octaveCount]->lines_.numOfLines;
+    cv::GaussianBlur( image, blurs[octaveCount], cv::Size( params.ksize_, params.ksize_ ), increaseSigma );
+    images_sizes[octaveCount] = blurs[octaveCount].size();
 
     /* resize image for next level of pyramid */
-    cv::resize( blur, image, cv::Size(), ( 1.f / factor ), ( 1.f / factor ) );
+    cv::resize( blurs[octaveCount], image, cv::Size(), ( 1.f / factor ), ( 1.f / factor ) );
 
     /* update sigma values */
     preSigma2 = curSigma2;
@@ -731,6 +765,19 @@ int BinaryDescriptor::OctaveKeyLines( cv::Mat& image, ScaleLines &keyLines )
 
   } /* end of loop over number of octaves */
 
+  /* extract lines of all octaves, the pyramid is built before, since it is sequential */
+  std::vector<int> status( params.numOfOctave_, 0 );
+  parallel_for_( Range( 0, params.numOfOctave_ ), EDLineOctavesBody( *this, blurs, status ) );
+
+  for ( int octaveCount = 0; octaveCount < params.numOfOctave_; octaveCount++ )
+  {
+    if( status[octaveCount] != 1 )
+      return -1;
+
+    /* update number of total extracted lines */
+    numOfFinalLine += edLineVec_[octaveCount]->lines_.numOfLines;
+  }
+
   /* prepare a vector to store octave information associated to extracted lines */
   std::vector < OctaveLine > octaveLines( numOfFinalLine );
 
@@ -1028,12 +1075,46 @@ int BinaryDescriptor::OctaveKeyLines( cv::Mat& image, ScaleLines &keyLines )
   return 1;
 }
 
+/* Computes the descriptors of the groups of lines in parallel,
+ every thread with its own buffer of band statistics */
+class BinaryDescriptor::ComputeLBDBody : public ParallelLoopBody
+{
+ public:
+  ComputeLBDBody( const BinaryDescriptor& _bd, ScaleLines& _keyLines, bool _useDetectionData ) :
+      bd( _bd ), keyLines( _keyLines ), useDetectionData( _useDetectionData )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    float bandSums[8 * NUM_OF_BANDS];
+    for ( int i = range.start; i < range.end; i++ )
+    {
+      for ( size_t j = 0; j < keyLines[i].size(); j++ )
+        bd.computeLineLBD( keyLines[i][j], useDetectionData, bandSums );
+    }
+  }
+
+ private:
+  const BinaryDescriptor& bd;
+  ScaleLines& keyLines;
+  bool useDetectionData;
+
+  ComputeLBDBody& operator=( const ComputeLBDBody& );
+};
+
 int BinaryDescriptor::computeLBD( ScaleLines &keyLines, bool useDetectionData )
+{
+  parallel_for_( Range( 0, (int) keyLines.size() ), ComputeLBDBody( *this, keyLines, useDetectionData ) );
+  return 1;
+}
+
+/* compute the LBD descriptor of a line, bandSums is a buffer of 8 * NUM_OF_BANDS floats */
+void BinaryDescriptor::computeLineLBD( OctaveSingleLine& line, bool useDetectionData, float* bandSums ) const
 {
   //the default length of the band is the line length.
-  short numOfFinalLine = (short) keyLines.size();
-  float *dL = new float[2];  //line direction cos(dir), sin(dir)
-  float *dO = new float[2];  //the clockwise orthogonal vector of line direction.
+  float dL[2];  //line direction cos(dir), sin(dir)
+  float dO[2];  //the clockwise orthogonal vector of line direction.
   short heightOfLSP = (short) ( params.widthOfBand_ * NUM_OF_BANDS );  //the height of line support region;
   short descriptor_size = NUM_OF_BANDS * 8;  //each band, we compute the m( pgdL, ngdL,  pgdO, ngdO) and std( pgdL, ngdL,  pgdO, ngdO);
   float pgdLRowSum;  //the summation of {g_dL |g_dL>0 } for each row of the region;
@@ -1045,16 +1126,15 @@ int BinaryDescriptor::computeLBD( ScaleLines &keyLines, bool useDetectionData )
   float pgdO2RowSum;  //the summation of {g_dO^2 |g_dO>0 } for each row of the region;
   float ngdO2RowSum;  //the summation of {g_dO^2 |g_dO<0 } for each row of the region;
 
-  float *pgdLBandSum = new float[NUM_OF_BANDS];  //the summation of {g_dL |g_dL>0 } for each band of the region;
-  float *ngdLBandSum = new float[NUM_OF_BANDS];  //the summation of {g_dL |g_dL<0 } for each band of the region;
-  float *pgdL2BandSum = new float[NUM_OF_BANDS];  //the summation of {g_dL^2 |g_dL>0 } for each band of the region;
-  float *ngdL2BandSum = new float[NUM_OF_BANDS];  //the summation of {g_dL^2 |g_dL<0 } for each band of the region;
-  float *pgdOBandSum = new float[NUM_OF_BANDS];  //the summation of {g_dO |g_dO>0 } for each band of the region;
-  float *ngdOBandSum = new float[NUM_OF_BANDS];  //the summation of {g_dO |g_dO<0 } for each band of the region;
-  float *pgdO2BandSum = new float[NUM_OF_BANDS];  //the summation of {g_dO^2 |g_dO>0 } for each band of the region;
-  float *ngdO2BandSum = new float[NUM_OF_BANDS];  //the summation of {g_dO^2 |g_dO<0 } for each band of the region;
+  float *pgdLBandSum = bandSums;  //the summation of {g_dL |g_dL>0 } for each band of the region;
+  float *ngdLBandSum = bandSums + NUM_OF_BANDS;  //the summation of {g_dL |g_dL<0 } for each band of the region;
+  float *pgdL2BandSum = bandSums + 2 * NUM_OF_BANDS;  //the summation of {g_dL^2 |g_dL>0 } for each band of the region;
+  float *ngdL2BandSum = bandSums + 3 * NUM_OF_BANDS;  //the summation of {g_dL^2 |g_dL<0 } for each band of the region;
+  float *pgdOBandSum = bandSums + 4 * NUM_OF_BANDS;  //the summation of {g_dO |g_dO>0 } for each band of the region;
+  float *ngdOBandSum = bandSums + 5 * NUM_OF_BANDS;  //the summation of {g_dO |g_dO<0 } for each band of the region;
+  float *pgdO2BandSum = bandSums + 6 * NUM_OF_BANDS;  //the summation of {g_dO^2 |g_dO>0 } for each band of the region;
+  float *ngdO2BandSum = bandSums + 7 * NUM_OF_BANDS;  //the summation of {g_dO^2 |g_dO<0 } for each band of the region;
 
-  short numOfBitsBand = NUM_OF_BANDS * sizeof(float);
   short lengthOfLSP;  //the length of line support region, varies with lines
   short halfHeight = ( heightOfLSP - 1 ) / 2;
   short halfWidth;
@@ -1067,313 +1147,266 @@ int BinaryDescriptor::computeLBD( ScaleLines &keyLines, bool useDetectionData )
   float gDL;  //store the gradient projection of pixels in support region along dL vector
   float gDO;  //store the gradient projection of pixels in support region along dO vector
   short imageWidth, imageHeight, realWidth;
-  short *pdxImg, *pdyImg;
+  const short *pdxImg, *pdyImg;
   float *desVec;
 
-  short sameLineSize;
   short octaveCount;
-  OctaveSingleLine *pSingleLine;
-  /* loop over list of LineVec */
-  for ( short lineIDInScaleVec = 0; lineIDInScaleVec < numOfFinalLine; lineIDInScaleVec++ )
+  OctaveSingleLine *pSingleLine = &line;
+  octaveCount = (short) pSingleLine->octaveCount;
+
+  if( useDetectionData )
   {
-    sameLineSize = (short) ( keyLines[lineIDInScaleVec].size() );
-    /* loop over current LineVec's lines */
-    for ( short lineIDInSameLine = 0; lineIDInSameLine < sameLineSize; lineIDInSameLine++ )
-    {
-      /* get a line in current LineVec and its original ID in its octave */
-      pSingleLine = & ( keyLines[lineIDInScaleVec][lineIDInSameLine] );
-      octaveCount = (short) pSingleLine->octaveCount;
+    /* retrieve associated dxImg and dyImg */
+    pdxImg = edLineVec_[octaveCount]->dxImg_.ptr<const short>();
+    pdyImg = edLineVec_[octaveCount]->dyImg_.ptr<const short>();
+
+    /* get image size to work on from real one */
+    realWidth = (short) edLineVec_[octaveCount]->imageWidth;
+    imageWidth = realWidth - 1;
+    imageHeight = (short) ( edLineVec_[octaveCount]->imageHeight - 1 );
+  }
 
-      if( useDetectionData )
-      {
-        /* retrieve associated dxImg and dyImg */
-        pdxImg = edLineVec_[octaveCount]->dxImg_.ptr<short>();
-        pdyImg = edLineVec_[octaveCount]->dyImg_.ptr<short>();
-
-        /* get image size to work on from real one */
-        realWidth = (short) edLineVec_[octaveCount]->imageWidth;
-        imageWidth = realWidth - 1;
-        imageHeight = (short) ( edLineVec_[octaveCount]->imageHeight - 1 );
-      }
+  else
+  {
+    /* retrieve associated dxImg and dyImg */
+    pdxImg = dxImg_vector[octaveCount].ptr<const short>();
+    pdyImg = dyImg_vector[octaveCount].ptr<const short>();
+
+    /* get image size to work on from real one */
+    realWidth = (short) images_sizes[octaveCount].width;
+    imageWidth = realWidth - 1;
+    imageHeight = (short) ( images_sizes[octaveCount].height - 1 );
+  }
 
-      else
-      {
-        /* retrieve associated dxImg and dyImg */
-        pdxImg = dxImg_vector[octaveCount].ptr<short>();
-        pdyImg = dyImg_vector[octaveCount].ptr<short>();
-
-        /* get image size to work on from real one */
-        realWidth = (short) images_sizes[octaveCount].width;
-        imageWidth = realWidth - 1;
-        imageHeight = (short) ( images_sizes[octaveCount].height - 1 );
-      }
+  /* initialize memory areas */
+  memset( bandSums, 0, 8 * NUM_OF_BANDS * sizeof(float) );
 
-      /* initialize memory areas */
-      memset( pgdLBandSum, 0, numOfBitsBand );
-      memset( ngdLBandSum, 0, numOfBitsBand );
-      memset( pgdL2BandSum, 0, numOfBitsBand );
-      memset( ngdL2BandSum, 0, numOfBitsBand );
-      memset( pgdOBandSum, 0, numOfBitsBand );
-      memset( ngdOBandSum, 0, numOfBitsBand );
-      memset( pgdO2BandSum, 0, numOfBitsBand );
-      memset( ngdO2BandSum, 0, numOfBitsBand );
-
-      /* get length of line and its half */
-      lengthOfLSP = (short) keyLines[lineIDInScaleVec][lineIDInSameLine].numOfPixels;
-      halfWidth = ( lengthOfLSP - 1 ) / 2;
-
-      /* get middlepoint of line */
-      lineMiddlePointX = (float) ( 0.5 * ( pSingleLine->sPointInOctaveX + pSingleLine->ePointInOctaveX ) );
-      lineMiddlePointY = (float) ( 0.5 * ( pSingleLine->sPointInOctaveY + pSingleLine->ePointInOctaveY ) );
-
-      /*1.rotate the local coordinate system to the line direction (direction is the angle
-       between positive line direction and positive X axis)
-       *2.compute the gradient projection of pixels in line support region*/
-
-      /* get the vector representing original image reference system after rotation to aligh with
-       line's direction */
-      dL[0] = cos( pSingleLine->direction );
-      dL[1] = sin( pSingleLine->direction );
-
-      /* set the clockwise orthogonal vector of line direction */
-      dO[0] = -dL[1];
-      dO[1] = dL[0];
-
-      /* get rotated reference frame */
-      sCorX0 = -dL[0] * halfWidth + dL[1] * halfHeight + lineMiddlePointX;  //hID =0; wID = 0;
-      sCorY0 = -dL[1] * halfWidth - dL[0] * halfHeight + lineMiddlePointY;
-
-      /* BIAS::Matrix<float> gDLMat(heightOfLSP,lengthOfLSP) */
-      for ( short hID = 0; hID < heightOfLSP; hID++ )
-      {
-        /*initialization */
-        sCorX = sCorX0;
-        sCorY = sCorY0;
+  /* get length of line and its half */
+  lengthOfLSP = (short) pSingleLine->numOfPixels;
+  halfWidth = ( lengthOfLSP - 1 ) / 2;
 
-        pgdLRowSum = 0;
-        ngdLRowSum = 0;
-        pgdORowSum = 0;
-        ngdORowSum = 0;
+  /* get middlepoint of line */
+  lineMiddlePointX = (float) ( 0.5 * ( pSingleLine->sPointInOctaveX + pSingleLine->ePointInOctaveX ) );
+  lineMiddlePointY = (float) ( 0.5 * ( pSingleLine->sPointInOctaveY + pSingleLine->ePointInOctaveY ) );
 
-        for ( short wID = 0; wID < lengthOfLSP; wID++ )
-        {
-          tempCor = (short) round( sCorX );
-          xCor = ( tempCor < 0 ) ? 0 : ( tempCor > imageWidth ) ? imageWidth : tempCor;
-          tempCor = (short) round( sCorY );
-          yCor = ( tempCor < 0 ) ? 0 : ( tempCor > imageHeight ) ? imageHeight : tempCor;
-
-          /* To achieve rotation invariance, each simple gradient is rotated aligned with
-           * the line direction and clockwise orthogonal direction.*/
-          dx = pdxImg[yCor * realWidth + xCor];
-          dy = pdyImg[yCor * realWidth + xCor];
-          gDL = dx * dL[0] + dy * dL[1];
-          gDO = dx * dO[0] + dy * dO[1];
-          if( gDL > 0 )
-          {
-            pgdLRowSum += gDL;
-          }
-          else
-          {
-            ngdLRowSum -= gDL;
-          }
-          if( gDO > 0 )
-          {
-            pgdORowSum += gDO;
-          }
-          else
-          {
-            ngdORowSum -= gDO;
-          }
-          sCorX += dL[0];
-          sCorY += dL[1];
-          /* gDLMat[hID][wID] = gDL; */
-        }
-        sCorX0 -= dL[1];
-        sCorY0 += dL[0];
-        coefInGaussion = (float) gaussCoefG_[hID];
-        pgdLRowSum = coefInGaussion * pgdLRowSum;
-        ngdLRowSum = coefInGaussion * ngdLRowSum;
-        pgdL2RowSum = pgdLRowSum * pgdLRowSum;
-        ngdL2RowSum = ngdLRowSum * ngdLRowSum;
-        pgdORowSum = coefInGaussion * pgdORowSum;
-        ngdORowSum = coefInGaussion * ngdORowSum;
-        pgdO2RowSum = pgdORowSum * pgdORowSum;
-        ngdO2RowSum = ngdORowSum * ngdORowSum;
-
-        /* compute {g_dL |g_dL>0 }, {g_dL |g_dL<0 },
-         {g_dO |g_dO>0 }, {g_dO |g_dO<0 } of each band in the line support region
-         first, current row belong to current band */
-        bandID = (short) ( hID / params.widthOfBand_ );
-        coefInGaussion = (float) ( gaussCoefL_[hID % params.widthOfBand_ + params.widthOfBand_] );
-        pgdLBandSum[bandID] += coefInGaussion * pgdLRowSum;
-        ngdLBandSum[bandID] += coefInGaussion * ngdLRowSum;
-        pgdL2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdL2RowSum;
-        ngdL2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdL2RowSum;
-        pgdOBandSum[bandID] += coefInGaussion * pgdORowSum;
-        ngdOBandSum[bandID] += coefInGaussion * ngdORowSum;
-        pgdO2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdO2RowSum;
-        ngdO2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdO2RowSum;
-
-        /* In order to reduce boundary effect along the line gradient direction,
-         * a row's gradient will contribute not only to its current band, but also
-         * to its nearest upper and down band with gaussCoefL_.*/
-        bandID--;
-        if( bandID >= 0 )
-        {/* the band above the current band */
-          coefInGaussion = (float) ( gaussCoefL_[hID % params.widthOfBand_ + 2 * params.widthOfBand_] );
-          pgdLBandSum[bandID] += coefInGaussion * pgdLRowSum;
-          ngdLBandSum[bandID] += coefInGaussion * ngdLRowSum;
-          pgdL2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdL2RowSum;
-          ngdL2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdL2RowSum;
-          pgdOBandSum[bandID] += coefInGaussion * pgdORowSum;
-          ngdOBandSum[bandID] += coefInGaussion * ngdORowSum;
-          pgdO2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdO2RowSum;
-          ngdO2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdO2RowSum;
-        }
-        bandID = bandID + 2;
-        if( bandID < NUM_OF_BANDS )
-        {/*the band below the current band */
-          coefInGaussion = (float) ( gaussCoefL_[hID % params.widthOfBand_] );
-          pgdLBandSum[bandID] += coefInGaussion * pgdLRowSum;
-          ngdLBandSum[bandID] += coefInGaussion * ngdLRowSum;
-          pgdL2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdL2RowSum;
-          ngdL2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdL2RowSum;
-          pgdOBandSum[bandID] += coefInGaussion * pgdORowSum;
-          ngdOBandSum[bandID] += coefInGaussion * ngdORowSum;
-          pgdO2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdO2RowSum;
-          ngdO2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdO2RowSum;
-        }
-      }
-      /* gDLMat.Save("gDLMat.txt");
-       return 0; */
+  /*1.rotate the local coordinate system to the line direction (direction is the angle
+   between positive line direction and positive X axis)
+   *2.compute the gradient projection of pixels in line support region*/
 
-      /* construct line descriptor */
-      pSingleLine->descriptor.resize( descriptor_size );
-      desVec = &pSingleLine->descriptor.front();
+  /* get the vector representing original image reference system after rotation to aligh with
+   line's direction */
+  dL[0] = cos( pSingleLine->direction );
+  dL[1] = sin( pSingleLine->direction );
 
-      short desID;
+  /* set the clockwise orthogonal vector of line direction */
+  dO[0] = -dL[1];
+  dO[1] = dL[0];
 
-      /*Note that the first and last bands only have (lengthOfLSP * widthOfBand_ * 2.0) pixels
-       * which are counted. */
-      float invN2 = (float) ( 1.0 / ( params.widthOfBand_ * 2.0 ) );
-      float invN3 = (float) ( 1.0 / ( params.widthOfBand_ * 3.0 ) );
-      float invN, temp;
-      for ( bandID = 0; bandID < NUM_OF_BANDS; bandID++ )
-      {
-        if( bandID == 0 || bandID == NUM_OF_BANDS - 1 )
-        {
-          invN = invN2;
-        }
-        else
-        {
-          invN = invN3;
-        }
-        desID = bandID * 8;
-        temp = pgdLBandSum[bandID] * invN;
-        desVec[desID] = temp;/* mean value of pgdL; */
-        desVec[desID + 4] = sqrt( pgdL2BandSum[bandID] * invN - temp * temp );  //std value of pgdL;
-        temp = ngdLBandSum[bandID] * invN;
-        desVec[desID + 1] = temp;  //mean value of ngdL;
-        desVec[desID + 5] = sqrt( ngdL2BandSum[bandID] * invN - temp * temp );  //std value of ngdL;
-
-        temp = pgdOBandSum[bandID] * invN;
-        desVec[desID + 2] = temp;  //mean value of pgdO;
-        desVec[desID + 6] = sqrt( pgdO2BandSum[bandID] * invN - temp * temp );  //std value of pgdO;
-        temp = ngdOBandSum[bandID] * invN;
-        desVec[desID + 3] = temp;  //mean value of ngdO;
-        desVec[desID + 7] = sqrt( ngdO2BandSum[bandID] * invN - temp * temp );  //std value of ngdO;
-      }
+  /* get rotated reference frame */
+  sCorX0 = -dL[0] * halfWidth + dL[1] * halfHeight + lineMiddlePointX;  //hID =0; wID = 0;
+  sCorY0 = -dL[1] * halfWidth - dL[0] * halfHeight + lineMiddlePointY;
 
-      // normalize;
-      float tempM, tempS;
-      tempM = 0;
-      tempS = 0;
-      desVec = &pSingleLine->descriptor.front();
+  /* BIAS::Matrix<float> gDLMat(heightOfLSP,lengthOfLSP) */
+  for ( short hID = 0; hID < heightOfLSP; hID++ )
+  {
+    /*initialization */
+    sCorX = sCorX0;
+    sCorY = sCorY0;
 
-      int base = 0;
-      for ( short i = 0; i < (short) ( NUM_OF_BANDS * 8 ); ++base, i = (short) ( base * 8 ) )
-      {
-        tempM += * ( desVec + i ) * * ( desVec + i );  //desVec[8*i+0] * desVec[8*i+0];
-        tempM += * ( desVec + i + 1 ) * * ( desVec + i + 1 );  //desVec[8*i+1] * desVec[8*i+1];
-        tempM += * ( desVec + i + 2 ) * * ( desVec + i + 2 );  //desVec[8*i+2] * desVec[8*i+2];
-        tempM += * ( desVec + i + 3 ) * * ( desVec + i + 3 );  //desVec[8*i+3] * desVec[8*i+3];
-        tempS += * ( desVec + i + 4 ) * * ( desVec + i + 4 );  //desVec[8*i+4] * desVec[8*i+4];
-        tempS += * ( desVec + i + 5 ) * * ( desVec + i + 5 );  //desVec[8*i+5] * desVec[8*i+5];
-        tempS += * ( desVec + i + 6 ) * * ( desVec + i + 6 );  //desVec[8*i+6] * desVec[8*i+6];
-        tempS += * ( desVec + i + 7 ) * * ( desVec + i + 7 );  //desVec[8*i+7] * desVec[8*i+7];
-      }
+    pgdLRowSum = 0;
+    ngdLRowSum = 0;
+    pgdORowSum = 0;
+    ngdORowSum = 0;
 
-      tempM = 1 / sqrt( tempM );
-      tempS = 1 / sqrt( tempS );
-      desVec = &pSingleLine->descriptor.front();
-      base = 0;
-      for ( short i = 0; i < (short) ( NUM_OF_BANDS * 8 ); ++base, i = (short) ( base * 8 ) )
+    for ( short wID = 0; wID < lengthOfLSP; wID++ )
+    {
+      tempCor = (short) round( sCorX );
+      xCor = ( tempCor < 0 ) ? 0 : ( tempCor > imageWidth ) ? imageWidth : tempCor;
+      tempCor = (short) round( sCorY );
+      yCor = ( tempCor < 0 ) ? 0 : ( tempCor > imageHeight ) ? imageHeight : tempCor;
+
+      /* To achieve rotation invariance, each simple gradient is rotated aligned with
+       * the line direction and clockwise orthogonal direction.*/
+      dx = pdxImg[yCor * realWidth + xCor];
+      dy = pdyImg[yCor * realWidth + xCor];
+      gDL = dx * dL[0] + dy * dL[1];
+      gDO = dx * dO[0] + dy * dO[1];
+      if( gDL > 0 )
       {
-        * ( desVec + i ) = * ( desVec + i ) * tempM;  //desVec[8*i] =  desVec[8*i] * tempM;
-        * ( desVec + 1 + i ) = * ( desVec + 1 + i ) * tempM;  //desVec[8*i+1] =  desVec[8*i+1] * tempM;
-        * ( desVec + 2 + i ) = * ( desVec + 2 + i ) * tempM;  //desVec[8*i+2] =  desVec[8*i+2] * tempM;
-        * ( desVec + 3 + i ) = * ( desVec + 3 + i ) * tempM;  //desVec[8*i+3] =  desVec[8*i+3] * tempM;
-        * ( desVec + 4 + i ) = * ( desVec + 4 + i ) * tempS;  //desVec[8*i+4] =  desVec[8*i+4] * tempS;
-        * ( desVec + 5 + i ) = * ( desVec + 5 + i ) * tempS;  //desVec[8*i+5] =  desVec[8*i+5] * tempS;
-        * ( desVec + 6 + i ) = * ( desVec + 6 + i ) * tempS;  //desVec[8*i+6] =  desVec[8*i+6] * tempS;
-        * ( desVec + 7 + i ) = * ( desVec + 7 + i ) * tempS;  //desVec[8*i+7] =  desVec[8*i+7] * tempS;
+        pgdLRowSum += gDL;
       }
-
-      /* In order to reduce the influence of non-linear illumination,
-       * a threshold is used to limit the value of element in the unit feature
-       * vector no larger than this threshold. In Z.Wang's work, a value of 0.4 is found
-       * empirically to be a proper threshold.*/
-      desVec = &pSingleLine->descriptor.front();
-      for ( short i = 0; i < descriptor_size; i++ )
+      else
       {
-        if( desVec[i] > 0.4 )
-        {
-          desVec[i] = (float) 0.4;
-        }
+        ngdLRowSum -= gDL;
       }
-
-      //re-normalize desVec;
-      temp = 0;
-      for ( short i = 0; i < descriptor_size; i++ )
+      if( gDO > 0 )
       {
-        temp += desVec[i] * desVec[i];
+        pgdORowSum += gDO;
       }
-
-      temp = 1 / sqrt( temp );
-      for ( short i = 0; i < descriptor_size; i++ )
+      else
       {
-        desVec[i] = desVec[i] * temp;
+        ngdORowSum -= gDO;
       }
-    }/* end for(short lineIDInSameLine = 0; lineIDInSameLine<sameLineSize;
-     lineIDInSameLine++) */
+      sCorX += dL[0];
+      sCorY += dL[1];
+      /* gDLMat[hID][wID] = gDL; */
+    }
+    sCorX0 -= dL[1];
+    sCorY0 += dL[0];
+    coefInGaussion = (float) gaussCoefG_[hID];
+    pgdLRowSum = coefInGaussion * pgdLRowSum;
+    ngdLRowSum = coefInGaussion * ngdLRowSum;
+    pgdL2RowSum = pgdLRowSum * pgdLRowSum;
+    ngdL2RowSum = ngdLRowSum * ngdLRowSum;
+    pgdORowSum = coefInGaussion * pgdORowSum;
+    ngdORowSum = coefInGaussion * ngdORowSum;
+    pgdO2RowSum = pgdORowSum * pgdORowSum;
+    ngdO2RowSum = ngdORowSum * ngdORowSum;
+
+    /* compute {g_dL |g_dL>0 }, {g_dL |g_dL<0 },
+     {g_dO |g_dO>0 }, {g_dO |g_dO<0 } of each band in the line support region
+     first, current row belong to current band */
+    bandID = (short) ( hID / params.widthOfBand_ );
+    coefInGaussion = (float) ( gaussCoefL_[hID % params.widthOfBand_ + params.widthOfBand_] );
+    pgdLBandSum[bandID] += coefInGaussion * pgdLRowSum;
+    ngdLBandSum[bandID] += coefInGaussion * ngdLRowSum;
+    pgdL2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdL2RowSum;
+    ngdL2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdL2RowSum;
+    pgdOBandSum[bandID] += coefInGaussion * pgdORowSum;
+    ngdOBandSum[bandID] += coefInGaussion * ngdORowSum;
+    pgdO2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdO2RowSum;
+    ngdO2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdO2RowSum;
+
+    /* In order to reduce boundary effect along the line gradient direction,
+     * a row's gradient will contribute not only to its current band, but also
+     * to its nearest upper and down band with gaussCoefL_.*/
+    bandID--;
+    if( bandID >= 0 )
+    {/* the band above the current band */
+      coefInGaussion = (float) ( gaussCoefL_[hID % params.widthOfBand_ + 2 * params.widthOfBand_] );
+      pgdLBandSum[bandID] += coefInGaussion * pgdLRowSum;
+      ngdLBandSum[bandID] += coefInGaussion * ngdLRowSum;
+      pgdL2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdL2RowSum;
+      ngdL2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdL2RowSum;
+      pgdOBandSum[bandID] += coefInGaussion * pgdORowSum;
+      ngdOBandSum[bandID] += coefInGaussion * ngdORowSum;
+      pgdO2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdO2RowSum;
+      ngdO2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdO2RowSum;
+    }
+    bandID = bandID + 2;
+    if( bandID < NUM_OF_BANDS )
+    {/*the band below the current band */
+      coefInGaussion = (float) ( gaussCoefL_[hID % params.widthOfBand_] );
+      pgdLBandSum[bandID] += coefInGaussion * pgdLRowSum;
+      ngdLBandSum[bandID] += coefInGaussion * ngdLRowSum;
+      pgdL2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdL2RowSum;
+      ngdL2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdL2RowSum;
+      pgdOBandSum[bandID] += coefInGaussion * pgdORowSum;
+      ngdOBandSum[bandID] += coefInGaussion * ngdORowSum;
+      pgdO2BandSum[bandID] += coefInGaussion * coefInGaussion * pgdO2RowSum;
+      ngdO2BandSum[bandID] += coefInGaussion * coefInGaussion * ngdO2RowSum;
+    }
+  }
+  /* gDLMat.Save("gDLMat.txt");
+   return 0; */
 
-    cv::Mat appoggio = cv::Mat( 1, 32, CV_32FC1 );
-    float* pointerToRow = appoggio.ptr<float>( 0 );
-    for ( int g = 0; g < 32; g++ )
-    {
-      /* get LBD data */
-      float* des_Vec = &keyLines[lineIDInScaleVec][0].descriptor.front();
-      *pointerToRow = des_Vec[g];
-      pointerToRow++;
+  /* construct line descriptor */
+  pSingleLine->descriptor.resize( descriptor_size );
+  desVec = &pSingleLine->descriptor.front();
+
+  short desID;
 
+  /*Note that the first and last bands only have (lengthOfLSP * widthOfBand_ * 2.0) pixels
+   * which are counted. */
+  float invN2 = (float) ( 1.0 / ( params.widthOfBand_ * 2.0 ) );
+  float invN3 = (float) ( 1.0 / ( params.widthOfBand_ * 3.0 ) );
+  float invN, temp;
+  for ( bandID = 0; bandID < NUM_OF_BANDS; bandID++ )
+  {
+    if( bandID == 0 || bandID == NUM_OF_BANDS - 1 )
+    {
+      invN = invN2;
+    }
+    else
+    {
+      invN = invN3;
     }
+    desID = bandID * 8;
+    temp = pgdLBandSum[bandID] * invN;
+    desVec[desID] = temp;/* mean value of pgdL; */
+    desVec[desID + 4] = sqrt( pgdL2BandSum[bandID] * invN - temp * temp );  //std value of pgdL;
+    temp = ngdLBandSum[bandID] * invN;
+    desVec[desID + 1] = temp;  //mean value of ngdL;
+    desVec[desID + 5] = sqrt( ngdL2BandSum[bandID] * invN - temp * temp );  //std value of ngdL;
+
+    temp = pgdOBandSum[bandID] * invN;
+    desVec[desID + 2] = temp;  //mean value of pgdO;
+    desVec[desID + 6] = sqrt( pgdO2BandSum[bandID] * invN - temp * temp );  //std value of pgdO;
+    temp = ngdOBandSum[bandID] * invN;
+    desVec[desID + 3] = temp;  //mean value of ngdO;
+    desVec[desID + 7] = sqrt( ngdO2BandSum[bandID] * invN - temp * temp );  //std value of ngdO;
+  }
 
-  }/* end for(short lineIDInScaleVec = 0;
-   lineIDInScaleVec<numOfFinalLine; lineIDInScaleVec++) */
+  // normalize;
+  float tempM, tempS;
+  tempM = 0;
+  tempS = 0;
+  desVec = &pSingleLine->descriptor.front();
+
+  int base = 0;
+  for ( short i = 0; i < (short) ( NUM_OF_BANDS * 8 ); ++base, i = (short) ( base * 8 ) )
+  {
+    tempM += * ( desVec + i ) * * ( desVec + i );  //desVec[8*i+0] * desVec[8*i+0];
+    tempM += * ( desVec + i + 1 ) * * ( desVec + i + 1 );  //desVec[8*i+1] * desVec[8*i+1];
+    tempM += * ( desVec + i + 2 ) * * ( desVec + i + 2 );  //desVec[8*i+2] * desVec[8*i+2];
+    tempM += * ( desVec + i + 3 ) * * ( desVec + i + 3 );  //desVec[8*i+3] * desVec[8*i+3];
+    tempS += * ( desVec + i + 4 ) * * ( desVec + i + 4 );  //desVec[8*i+4] * desVec[8*i+4];
+    tempS += * ( desVec + i + 5 ) * * ( desVec + i + 5 );  //desVec[8*i+5] * desVec[8*i+5];
+    tempS += * ( desVec + i + 6 ) * * ( desVec + i + 6 );  //desVec[8*i+6] * desVec[8*i+6];
+    tempS += * ( desVec + i + 7 ) * * ( desVec + i + 7 );  //desVec[8*i+7] * desVec[8*i+7];
+  }
 
-  delete[] dL;
-  delete[] dO;
-  delete[] pgdLBandSum;
-  delete[] ngdLBandSum;
-  delete[] pgdL2BandSum;
-  delete[] ngdL2BandSum;
-  delete[] pgdOBandSum;
-  delete[] ngdOBandSum;
-  delete[] pgdO2BandSum;
-  delete[] ngdO2BandSum;
+  tempM = 1 / sqrt( tempM );
+  tempS = 1 / sqrt( tempS );
+  desVec = &pSingleLine->descriptor.front();
+  base = 0;
+  for ( short i = 0; i < (short) ( NUM_OF_BANDS * 8 ); ++base, i = (short) ( base * 8 ) )
+  {
+    * ( desVec + i ) = * ( desVec + i ) * tempM;  //desVec[8*i] =  desVec[8*i] * tempM;
+    * ( desVec + 1 + i ) = * ( desVec + 1 + i ) * tempM;  //desVec[8*i+1] =  desVec[8*i+1] * tempM;
+    * ( desVec + 2 + i ) = * ( desVec + 2 + i ) * tempM;  //desVec[8*i+2] =  desVec[8*i+2] * tempM;
+    * ( desVec + 3 + i ) = * ( desVec + 3 + i ) * tempM;  //desVec[8*i+3] =  desVec[8*i+3] * tempM;
+    * ( desVec + 4 + i ) = * ( desVec + 4 + i ) * tempS;  //desVec[8*i+4] =  desVec[8*i+4] * tempS;
+    * ( desVec + 5 + i ) = * ( desVec + 5 + i ) * tempS;  //desVec[8*i+5] =  desVec[8*i+5] * tempS;
+    * ( desVec + 6 + i ) = * ( desVec + 6 + i ) * tempS;  //desVec[8*i+6] =  desVec[8*i+6] * tempS;
+    * ( desVec + 7 + i ) = * ( desVec + 7 + i ) * tempS;  //desVec[8*i+7] =  desVec[8*i+7] * tempS;
+  }
 
-  return 1;
+  /* In order to reduce the influence of non-linear illumination,
+   * a threshold is used to limit the value of element in the unit feature
+   * vector no larger than this threshold. In Z.Wang's work, a value of 0.4 is found
+   * empirically to be a proper threshold.*/
+  desVec = &pSingleLine->descriptor.front();
+  for ( short i = 0; i < descriptor_size; i++ )
+  {
+    if( desVec[i] > 0.4 )
+    {
+      desVec[i] = (float) 0.4;
+    }
+  }
+
+  //re-normalize desVec;
+  temp = 0;
+  for ( short i = 0; i < descriptor_size; i++ )
+  {
+    temp += desVec[i] * desVec[i];
+  }
 
+  temp = 1 / sqrt( temp );
+  for ( short i = 0; i < descriptor_size; i++ )
+  {
+    desVec[i] = desVec[i] * temp;
+  }
 }
 
 BinaryDescriptor::EDLineDetector::EDLineDetector()
@@ -1444,6 +1477,96 @@ BinaryDescriptor::EDLineDetector::~EDLineDetector()
   }
 }
 
+/* rounds v / 4 to the nearest integer, ties to even as the conversion of gImg_ / 4 did (v >= 0) */
+static inline short gradientQuarter( int v )
+{
+  int q = v >> 2;
+  return (short) ( q + ( ( v & 3 ) + ( q & 1 ) > 2 ) );
+}
+
+/* computes gImgWO_ = (|dx| + |dy|) / 4, gImg_ as gImgWO_ where |dx| + |dy| is above the
+ gradient threshold and 0 elsewhere, and dirImg_ (Horizontal where |dx| < |dy|) in a single pass */
+void BinaryDescriptor::EDLineDetector::computeGradients_()
+{
+  const int threshold = gradienThreshold_ + 1;
+  for ( int y = 0; y < dxImg_.rows; y++ )
+  {
+    const short* pdx = dxImg_.ptr<short>( y );
+    const short* pdy = dyImg_.ptr<short>( y );
+    short* pg = gImg_.ptr<short>( y );
+    short* pgWO = gImgWO_.ptr<short>( y );
+    uchar* pdir = dirImg_.ptr( y );
+    int x = 0;
+#if CV_SIMD128
+    v_int16x8 vzero = v_setzero_s16(), vone = v_setall_s16( 1 ), vthree = v_setall_s16( 3 ), vtwo = v_setall_s16( 2 );
+    v_int16x8 vthreshold = v_setall_s16( (short) threshold );
+    for ( ; x <= dxImg_.cols - 16; x += 16 )
+    {
+      v_int16x8 dir[2];
+      for ( int k = 0; k < 2; k++ )
+      {
+        v_int16x8 dx = v_load( pdx + x + 8 * k ), dy = v_load( pdy + x + 8 * k );
+        v_int16x8 adx = v_max( dx, vzero - dx ), ady = v_max( dy, vzero - dy );
+        v_int16x8 sum = adx + ady;
+        v_int16x8 q = sum >> 2;
+        v_int16x8 quarter = q - ( ( ( sum & vthree ) + ( q & vone ) ) > vtwo );
+        v_store( pgWO + x + 8 * k, quarter );
+        v_store( pg + x + 8 * k, v_select( sum > vthreshold, quarter, vzero ) );
+        dir[k] = adx < ady;
+      }
+      v_store( pdir + x, v_reinterpret_as_u8( v_pack( dir[0], dir[1] ) ) );
+    }
+#endif
+    for ( ; x < dxImg_.cols; x++ )
+    {
+      int adx = std::abs( (int) pdx[x] ), ady = std::abs( (int) pdy[x] );
+      int sum = adx + ady;
+      pgWO[x] = gradientQuarter( sum );
+      pg[x] = sum > threshold ? pgWO[x] : (short) 0;
+      pdir[x] = adx < ady ? Horizontal : Vertical;
+    }
+  }
+}
+
+/* marks with 1 the anchors of row h (1 <= h < imageHeight - 1): horizontal pixels whose gradient
+ exceeds the ones above and below by anchorThreshold_, vertical ones the left and right ones */
+void BinaryDescriptor::EDLineDetector::markAnchors_( unsigned int h, uchar* anchors ) const
+{
+  const short *pg = gImg_.ptr<short>( h ), *pgUp = gImg_.ptr<short>( h - 1 ), *pgDown = gImg_.ptr<short>( h + 1 );
+  const uchar *pdir = dirImg_.ptr( h );
+  const int width = (int) imageWidth;
+  anchors[0] = anchors[width - 1] = 0;
+  int w = 1;
+#if CV_SIMD128
+  v_int16x8 vthreshold = v_setall_s16( (short) anchorThreshold_ ), vhorizontal = v_setall_s16( Horizontal );
+  v_int8x16 vone = v_setall_s8( 1 );
+  for ( ; w <= width - 17; w += 16 )
+  {
+    v_int16x8 anchor[2];
+    for ( int k = 0; k < 2; k++ )
+    {
+      const int i = w + 8 * k;
+      v_int16x8 g = v_load( pg + i );
+      v_int16x8 horizontal = v_reinterpret_as_s16( v_load_expand( pdir + i ) ) == vhorizontal;
+      v_int16x8 upDown = ( g >= v_load( pgUp + i ) + vthreshold ) & ( g >= v_load( pgDown + i ) + vthreshold );
+      v_int16x8 leftRight = ( g >= v_load( pg + i - 1 ) + vthreshold ) & ( g >= v_load( pg + i + 1 ) + vthreshold );
+      anchor[k] = v_select( horizontal, upDown, leftRight );
+    }
+    v_store( (schar*) anchors + w, v_pack( anchor[0], anchor[1] ) & vone );
+  }
+#endif
+  for ( ; w < width - 1; w++ )
+  {
+    int g = pg[w];
+    if( pdir[w] == Horizontal )
+      //if the direction of pixel is horizontal, then compare with up and down
+      anchors[w] = g >= pgUp[w] + anchorThreshold_ && g >= pgDown[w] + anchorThreshold_;
+    else
+      //it is vertical edge, should be compared with left and right
+      anchors[w] = g >= pg[w - 1] + anchorThreshold_ && g >= pg[w + 1] + anchorThreshold_;
+  }
+}
+
 int BinaryDescriptor::EDLineDetector::EdgeDrawing( cv::Mat &image, EdgeChains &edgeChains )
 {
   imageWidth = image.cols;
@@ -1486,49 +1609,33 @@ int BinaryDescriptor::EDLineDetector::EdgeDrawing( cv::Mat &image, EdgeChains &e
   cv::Sobel( image, dyImg_, CV_16SC1, 0, 1, 3 );
 
   //compute gradient and direction images
-  cv::Mat dxABS_m = cv::abs( dxImg_ );
-  cv::Mat dyABS_m = cv::abs( dyImg_ );
-  cv::Mat sumDxDy;
-  cv::add( dyABS_m, dxABS_m, sumDxDy );
-
-  cv::threshold( sumDxDy, gImg_, gradienThreshold_ + 1, 255, cv::THRESH_TOZERO );
-  gImg_ = gImg_ / 4;
-  gImgWO_ = sumDxDy / 4;
-  cv::compare( dxABS_m, dyABS_m, dirImg_, cv::CMP_LT );
+  computeGradients_();
 
-  short *pgImg = gImg_.ptr<short>();
+  const short *pgImg = gImg_.ptr<short>();
   unsigned char *pdirImg = dirImg_.ptr();
 
-  //extract the anchors in the gradient image, store into a vector
+  //extract the anchors in the gradient image, store into a vector; the anchor test is done
+  //for whole rows in edgeImage_, which is cleared before linking, then the anchors are
+  //gathered in the original column-wise order
   memset( pAnchorX_, 0, edgePixelArraySize * sizeof(unsigned int) );  //initialization
   memset( pAnchorY_, 0, edgePixelArraySize * sizeof(unsigned int) );
   unsigned int anchorsSize = 0;
   int indexInArray;
   unsigned char gValue1, gValue2, gValue3;
+  for ( unsigned int h = 1; h < imageHeight - 1; h = h + scanIntervals_ )
+    markAnchors_( h, edgeImage_.ptr( h ) );
   for ( unsigned int w = 1; w < imageWidth - 1; w = w + scanIntervals_ )
   {
     for ( unsigned int h = 1; h < imageHeight - 1; h = h + scanIntervals_ )
     {
-      indexInArray = h * imageWidth + w;
-      //gValue1 = pdirImg[indexInArray];
-      if( pdirImg[indexInArray] == Horizontal )
-      {  //if the direction of pixel is horizontal, then compare with up and down
-         //gValue2 = pgImg[indexInArray];
-        if( pgImg[indexInArray] >= pgImg[indexInArray - imageWidth] + anchorThreshold_
-            && pgImg[indexInArray] >= pgImg[indexInArray + imageWidth] + anchorThreshold_ )
-        {       // (w,h) is accepted as an anchor
-          pAnchorX_[anchorsSize] = w;
-          pAnchorY_[anchorsSize++] = h;
-        }
-      }
-      else
-      {       // if(pdirImg[indexInArray]==Vertical){//it is vertical edge, should be compared with left and right
-        //gValue2 = pgImg[indexInArray];
-        if( pgImg[indexInArray] >= pgImg[indexInArray - 1] + anchorThreshold_ && pgImg[indexInArray] >= pgImg[indexInArray + 1] + anchorThreshold_ )
-        {       // (w,h) is accepted as an anchor
+      if( edgeImage_.at<uchar>( h, w ) )
+      {       // (w,h) is accepted as an anchor
+        if( anchorsSize < edgePixelArraySize )
+        {
           pAnchorX_[anchorsSize] = w;
-          pAnchorY_[anchorsSize++] = h;
+          pAnchorY_[anchorsSize] = h;
         }
+        anchorsSize++;
       }
     }
   }
@@ -41,9 +41,12 @@
 
 #include "precomp.hpp"
 
-#define MAX_B 37
-double ARRAY_RESIZE_FACTOR = 1.1;    // minimum is 1.0
-double ARRAY_RESIZE_ADD_FACTOR = 4;  // minimum is 1
+/* the flat tables have 2^b + 1 offsets */
+#define MAX_B 24
+
+/* header of the files written by saveIndex */
+#define MIH_INDEX_SIGNATURE 0x4948494D  // "MIHI"
+#define MIH_INDEX_VERSION 1
 
 //using namespace cv;
 namespace cv
@@ -85,10 +88,13 @@ void BinaryDescriptorMatcher::train()
   if( !dataset )
     dataset = Ptr<Mihasher>(new Mihasher( 256, 32 ));
 
+  /* without new descriptors the current (possibly loaded) dataset is kept */
   if( descriptorsMat.rows > 0 )
+  {
     dataset->populate( descriptorsMat, descriptorsMat.rows, descriptorsMat.cols );
+    descrInDS = descriptorsMat.rows;
+  }
 
-  descrInDS = descriptorsMat.rows;
   descriptorsMat.release();
 }
 
@@ -103,6 +109,128 @@ void BinaryDescriptorMatcher::clear()
   descrInDS = 0;
 }
 
+/* all the words of the index file are 32-bit, the codes are padded to a multiple of 4 bytes */
+static size_t mihIndexCodesSize( size_t N, int B_over_8 )
+{
+  return ( N * B_over_8 + 3 ) & ~(size_t) 3;
+}
+
+/* save dataset and hashtables */
+void BinaryDescriptorMatcher::saveIndex( const String& filename ) const
+{
+  CV_Assert( dataset && !dataset->codes.empty() );
+  const Mihasher& mh = *dataset;
+
+  FILE* f = fopen( filename.c_str(), "wb" );
+  if( !f )
+    CV_Error( Error::StsError, "Can not open " + filename + " for writing" );
+
+  std::vector<UINT32> header;
+  header.push_back( MIH_INDEX_SIGNATURE );
+  header.push_back( MIH_INDEX_VERSION );
+  header.push_back( (UINT32) mh.B );
+  header.push_back( (UINT32) mh.m );
+  header.push_back( (UINT32) mh.N );
+  header.push_back( (UINT32) indexesMap.size() );
+  for ( std::map<int, int>::const_iterator it = indexesMap.begin(); it != indexesMap.end(); ++it )
+  {
+    header.push_back( (UINT32) it->first );
+    header.push_back( (UINT32) it->second );
+  }
+
+  bool ok = fwrite( &header[0], sizeof(UINT32), header.size(), f ) == header.size();
+
+  std::vector<uchar> codes( mihIndexCodesSize( (size_t) mh.N, mh.B_over_8 ), 0 );
+  for ( int i = 0; i < (int) mh.N; i++ )
+    memcpy( &codes[(size_t) i * mh.B_over_8], mh.codes.ptr( i ), mh.B_over_8 );
+  ok = ok && fwrite( &codes[0], 1, codes.size(), f ) == codes.size();
+
+  for ( int k = 0; k < mh.m && ok; k++ )
+  {
+    const SparseHashtable& H = mh.H[k];
+    ok = fwrite( H.offsets.ptr(), sizeof(UINT32), (size_t) H.size + 1, f ) == (size_t) H.size + 1
+        && fwrite( H.ids.ptr(), sizeof(UINT32), (size_t) mh.N, f ) == (size_t) mh.N;
+  }
+
+  fclose( f );
+  if( !ok )
+    CV_Error( Error::StsError, "Can not write the index to " + filename );
+}
+
+/* load dataset and hashtables from a file */
+void BinaryDescriptorMatcher::loadIndex( const String& filename )
+{
+  FILE* f = fopen( filename.c_str(), "rb" );
+  if( !f )
+    CV_Error( Error::StsError, "Can not open " + filename );
+
+  fseek( f, 0, SEEK_END );
+  long fsize = ftell( f );
+  fseek( f, 0, SEEK_SET );
+
+  /* the buffer is kept by the dataset, which points into it (rows of 1 MB, so big indexes fit) */
+  Mat buf( (int) ( ( std::max( fsize, 1L ) + ( 1 << 20 ) - 1 ) >> 20 ), 1 << 20, CV_8UC1 );
+  bool ok = fsize > 0 && fread( buf.ptr(), 1, (size_t) fsize, f ) == (size_t) fsize;
+  fclose( f );
+  if( !ok )
+    CV_Error( Error::StsError, "Can not read " + filename );
+
+  loadIndex( buf.ptr(), (size_t) fsize );
+  dataset->storage = buf;
+}
+
+/* load dataset and hashtables from memory, without copying them */
+void BinaryDescriptorMatcher::loadIndex( const uchar* data, size_t size )
+{
+  CV_Assert( data && ( (size_t) data & 3 ) == 0 );
+
+  const UINT32* words = (const UINT32*) data;
+  size_t nwords = size / sizeof(UINT32);
+  if( nwords < 6 || words[0] != MIH_INDEX_SIGNATURE || words[1] != MIH_INDEX_VERSION )
+    CV_Error( Error::StsBadArg, "The data is not an index saved by BinaryDescriptorMatcher" );
+
+  /* the matcher manages 256-bits long entries in 32 substrings */
+  if( words[2] != 256 || words[3] != 32 )
+    CV_Error( Error::StsBadArg, "The index has not been built with 256-bits long entries" );
+
+  Ptr<Mihasher> mh = makePtr<Mihasher>( (int) words[2], (int) words[3] );
+  UINT32 N = words[4], nimages = words[5];
+  size_t pos = 6;
+
+  /* check the whole size before pointing into the data */
+  size_t needed = pos + 2 * (size_t) nimages + mihIndexCodesSize( N, mh->B_over_8 ) / sizeof(UINT32);
+  for ( int k = 0; k < mh->m; k++ )
+    needed += (size_t) mh->H[k].size + 1 + N;
+  if( N == 0 || nwords < needed )
+    CV_Error( Error::StsBadArg, "The index data is truncated or corrupted" );
+
+  std::map<int, int> images;
+  for ( UINT32 i = 0; i < nimages; i++, pos += 2 )
+    images.insert( std::pair<int, int>( (int) words[pos], (int) words[pos + 1] ) );
+
+  mh->N = N;
+  mh->codes = Mat( (int) N, mh->B_over_8, CV_8UC1, (void*) ( words + pos ) );
+  pos += mihIndexCodesSize( N, mh->B_over_8 ) / sizeof(UINT32);
+
+  for ( int k = 0; k < mh->m; k++ )
+  {
+    SparseHashtable& H = mh->H[k];
+    H.offsets = Mat( 1, (int) H.size + 1, CV_32SC1, (void*) ( words + pos ) );
+    pos += (size_t) H.size + 1;
+    H.ids = Mat( 1, (int) N, CV_32SC1, (void*) ( words + pos ) );
+    pos += N;
+
+    if( H.offsets.at<UINT32>( 0 ) != 0 || H.offsets.at<UINT32>( (int) H.size ) != N )
+      CV_Error( Error::StsBadArg, "The index data is truncated or corrupted" );
+  }
+
+  clear();
+  dataset = mh;
+  indexesMap = images;
+  numImages = (int) nimages;
+  descrInDS = nextAddedIndex = (int) N;
+}
+
 /* retrieve Hamming distances */
 void BinaryDescriptorMatcher::checkKDistances( UINT32 * numres, int k, std::vector<int> & k_distances, int row, int string_length ) const
 {
@@ -592,45 +720,54 @@ void BinaryDescriptorMatcher::radiusMatch( const Mat& queryDescriptors, std::vec
 
 }
 
-/* execute a batch query */
-void BinaryDescriptorMatcher::Mihasher::batchquery( UINT32 * results, UINT32 *numres, const cv::Mat & queries, UINT32 numq, int dim1queries )
+/* Runs the queries of a batch in blocks, each block with its own duplicates counter
+ and buffers, as the hashtables and the codes are only read while querying */
+class BinaryDescriptorMatcher::Mihasher::QueryBody : public ParallelLoopBody
 {
-  /* create and initialize a bitarray */
-  counter = makePtr<bitarray>();
-  counter->init( N );
-
-  UINT32 *res = new UINT32[K * ( D + 1 )];
-  UINT64 *chunks = new UINT64[m];
-  UINT32 * presults = results;
-  UINT32 *pnumres = numres;
-
-  /* make a copy of input queries */
-  cv::Mat queries_clone = queries.clone();
-
-  /* set a pointer to first query (row) */
-  UINT8 *pq = queries_clone.ptr();
+ public:
+  QueryBody( Mihasher& _mh, UINT32* _results, UINT32* _numres, const Mat& _queries, int _dim1queries ) :
+      mh( _mh ), results( _results ), numres( _numres ), queries( _queries ), dim1queries( _dim1queries )
+  {
+  }
 
-  /* loop over number of descriptors */
-  for ( size_t i = 0; i < numq; i++ )
+  void operator()( const Range& range ) const
   {
-    /* for every descriptor, query database */
-    query( presults, pnumres, pq, chunks, res );
+    bitarray dups( mh.N );
+    std::vector<UINT32> res( mh.K * ( mh.D + 1 ) );
+    std::vector<UINT64> chunks( mh.m );
+    int power[100];
 
-    /* move pointer to write next K indeces */
-    presults += K;
-    pnumres += B + 1;
+    for ( int i = range.start; i < range.end; i++ )
+    {
+      UINT8* pq = (UINT8*) queries.ptr() + (size_t) i * dim1queries;
+      mh.query( results + (size_t) i * mh.K, numres + (size_t) i * ( mh.B + 1 ), pq, &chunks[0], &res[0], dups, power );
+    }
+  }
 
-    /* move forward pointer to current row in descriptors matrix */
-    pq += dim1queries;
+ private:
+  Mihasher& mh;
+  UINT32* results;
+  UINT32* numres;
+  const Mat& queries;
+  int dim1queries;
 
-  }
+  QueryBody& operator=( const QueryBody& );
+};
 
-  delete[] res;
-  delete[] chunks;
+/* execute a batch query */
+void BinaryDescriptorMatcher::Mihasher::batchquery( UINT32 * results, UINT32 *numres, const cv::Mat & queries, UINT32 numq, int dim1queries )
+{
+  /* blocks of queries are large enough to amortize the counter of N bits */
+  const int blockSize = 64;
+  int nblocks = ( (int) numq + blockSize - 1 ) / blockSize;
+  Mat queries_cont = queries.isContinuous() ? queries : queries.clone();
+
+  parallel_for_( Range( 0, (int) numq ), QueryBody( *this, results, numres, queries_cont, dim1queries ), nblocks );
 }
 
 /* execute a single query */
-void BinaryDescriptorMatcher::Mihasher::query( UINT32* results, UINT32* numres, UINT8 * Query, UINT64 *chunks, UINT32 *res )
+void BinaryDescriptorMatcher::Mihasher::query( UINT32* results, UINT32* numres, UINT8 * Query, UINT64 *chunks, UINT32 *res, bitarray& _counter,
+                                               int* _power )
 {
   /* if K == 0 that means we want everything to be processed.
    So maxres = N in that case. Otherwise K limits the results processed */
@@ -647,12 +784,12 @@ void BinaryDescriptorMatcher::Mihasher::query( UINT32* results, UINT32* numres,
   UINT32 nl = 0;
 
   UINT32 nd = 0;
-  UINT32 *arr;
+  const UINT32 *arr;
   int size = 0;
   UINT32 index;
   int hammd;
 
-  counter->erase();
+  _counter.erase();
   memset( numres, 0, ( B + 1 ) * sizeof ( *numres ) );
 
   split( chunks, Query, m, mplus, b );
@@ -678,10 +815,10 @@ void BinaryDescriptorMatcher::Mihasher::query( UINT32* results, UINT32* numres,
       /* the bit-string with s number of 1s */
       UINT64 bitstr = 0;
       for ( int i = 0; i < s; i++ )
-        /* power[i] stores the location of the i'th 1 */
-        power[i] = i;
+        /* _power[i] stores the location of the i'th 1 */
+        _power[i] = i;
       /* used for stopping criterion (location of (s+1)th 1) */
-      power[s] = curb + 1;
+      _power[s] = curb + 1;
 
       /* bit determines the 1 that should be moving to the left */
       int bit = s - 1;
@@ -695,8 +832,8 @@ void BinaryDescriptorMatcher::Mihasher::query( UINT32* results, UINT32* numres,
       {
         if( bit != -1 )
         {
-          bitstr ^= ( power[bit] == bit ) ? (UINT64) 1 << power[bit] : (UINT64) 3 << ( power[bit] - 1 );
-          power[bit]++;
+          bitstr ^= ( _power[bit] == bit ) ? (UINT64) 1 << _power[bit] : (UINT64) 3 << ( _power[bit] - 1 );
+          _power[bit]++;
           bit--;
         }
 
@@ -710,9 +847,9 @@ void BinaryDescriptorMatcher::Mihasher::query( UINT32* results, UINT32* numres,
             for ( int c = 0; c < size; c++ )
             {
               index = arr[c];
-              if( !counter->get( index ) )
+              if( !_counter.get( index ) )
               { /* if it is not a duplicate */
-                counter->set( index );
+                _counter.set( index );
                 hammd = cv::line_descriptor::match( codes.ptr() + (UINT64) index * ( B_over_8 ), Query, B_over_8 );
 
                 nc++;
@@ -725,10 +862,10 @@ void BinaryDescriptorMatcher::Mihasher::query( UINT32* results, UINT32* numres,
           }
 
           /* end of processing */
-          while ( ++bit < s && power[bit] == power[bit + 1] - 1 )
+          while ( ++bit < s && _power[bit] == _power[bit + 1] - 1 )
           {
-            bitstr ^= (UINT64) 1 << ( power[bit] - 1 );
-            power[bit] = bit;
+            bitstr ^= (UINT64) 1 << ( _power[bit] - 1 );
+            _power[bit] = bit;
           }
           if( bit == s )
             break;
@@ -792,26 +929,41 @@ BinaryDescriptorMatcher::Mihasher::~Mihasher()
 {
 }
 
-/* populate tables */
-void BinaryDescriptorMatcher::Mihasher::populate( cv::Mat & _codes, UINT32 N_val, int dim1codes )
+/* Builds the hashtables independently, every one from its own substring of the codes */
+class BinaryDescriptorMatcher::Mihasher::PopulateBody : public ParallelLoopBody
 {
-  N = N_val;
-  codes = _codes;
-  UINT64 * chunks = new UINT64[m];
+ public:
+  PopulateBody( Mihasher& _mh ) :
+      mh( _mh )
+  {
+  }
 
-  UINT8 * pcodes = codes.ptr();
-  for ( UINT64 i = 0; i < N; i++, pcodes += dim1codes )
+  void operator()( const Range& range ) const
   {
-    split( chunks, pcodes, m, mplus, b );
+    for ( int k = range.start; k < range.end; k++ )
+    {
+      /* the first mplus substrings have b bits, the others (b-1) */
+      int offset = k < mh.mplus ? k * mh.b : mh.mplus * mh.b + ( k - mh.mplus ) * ( mh.b - 1 );
+      mh.H[k].build( mh.codes, offset );
+    }
+  }
 
-    for ( int k = 0; k < m; k++ )
-      H[k].insert( chunks[k], (UINT32) i );
+ private:
+  Mihasher& mh;
 
-    if( i % (int) ceil( N / 1000.0 ) == 0 )
-      fflush (stdout);
-  }
+  PopulateBody& operator=( const PopulateBody& );
+};
 
-  delete[] chunks;
+/* populate tables */
+void BinaryDescriptorMatcher::Mihasher::populate( cv::Mat & _codes, UINT32 N_val, int dim1codes )
+{
+  CV_Assert( _codes.type() == CV_8UC1 && _codes.rows >= (int) N_val && dim1codes == B_over_8 );
+
+  N = N_val;
+  codes = _codes.rowRange( 0, (int) N );
+  storage.release();
+
+  parallel_for_( Range( 0, m ), PopulateBody( *this ) );
 }
 
 /* constructor */
@@ -826,11 +978,12 @@ int BinaryDescriptorMatcher::SparseHashtable::init( int _b )
 {
   b = _b;
 
-  if( b < 5 || b > MAX_B || b > (int) ( sizeof(UINT64) * 8 ) )
+  if( b < 1 || b > MAX_B )
     return 1;
 
-  size = UINT64_1 << ( b - 5 );  // size = 2 ^ b
-  table = std::vector<BucketGroup>((size_t)size, BucketGroup(false));
+  size = UINT64_1 << b;  // size = 2 ^ b
+  offsets = Mat::zeros( 1, (int) size + 1, CV_32SC1 );
+  ids.release();
 
   return 0;
 
@@ -841,126 +994,32 @@ BinaryDescriptorMatcher::SparseHashtable::~SparseHashtable()
 {
 }
 
-/* insert data */
-void BinaryDescriptorMatcher::SparseHashtable::insert( UINT64 index, UINT32 data )
+/* build a table with a counting sort of the codes by their substring */
+void BinaryDescriptorMatcher::SparseHashtable::build( const cv::Mat& codes, int bitOffset )
 {
-  table[(size_t)(index >> 5)].insert( (int) ( index & 31 ), data );
-}
+  CV_Assert( size > 0 );
 
-/* query data */
-UINT32* BinaryDescriptorMatcher::SparseHashtable::query( UINT64 index, int *Size )
-{
-  return table[(size_t)(index >> 5)].query( (int) ( index & 31 ), Size );
-}
+  offsets = Mat::zeros( 1, (int) size + 1, CV_32SC1 );
+  UINT32* poffsets = offsets.ptr<UINT32>();
+  for ( int i = 0; i < codes.rows; i++ )
+    poffsets[substring( codes.ptr( i ), bitOffset, b ) + 1]++;
 
-/* constructor */
-BinaryDescriptorMatcher::BucketGroup::BucketGroup(bool needAllocateGroup)
-{
-  empty = 0;
-  if (needAllocateGroup)
-    group = std::vector < uint32_t > ( 2, 0 );
-  else
-    group = std::vector < uint32_t > ( 0, 0 );
-}
+  for ( UINT64 i = 0; i < size; i++ )
+    poffsets[i + 1] += poffsets[i];
 
-/* destructor */
-BinaryDescriptorMatcher::BucketGroup::~BucketGroup()
-{
+  ids.create( 1, std::max( codes.rows, 1 ), CV_32SC1 );
+  UINT32* pids = ids.ptr<UINT32>();
+  std::vector<UINT32> fill( poffsets, poffsets + size );
+  for ( int i = 0; i < codes.rows; i++ )
+    pids[fill[(size_t) substring( codes.ptr( i ), bitOffset, b )]++] = (UINT32) i;
 }
 
-void BinaryDescriptorMatcher::BucketGroup::insert_value( std::vector<uint32_t>& vec, int index, UINT32 data )
-{
-  if( vec.size() > 1 )
-  {
-    if( vec[0] == vec[1] )
-    {
-      vec[1] = (UINT32) ceil( vec[0] * 1.1 );
-      for ( int i = 0; i < (int) ( 2 + vec[1] - vec.size() ); i++ )
-        vec.push_back( 0 );
-
-    }
-
-    vec.insert( vec.begin() + 2 + index, data );
-    vec[2 + index] = data;
-    vec[0]++;
-  }
-
-  else
-  {
-    vec = std::vector < uint32_t > ( 3, 0 );
-    vec[0] = 1;
-    vec[1] = 1;
-    vec[2] = data;
-  }
-}
-
-void BinaryDescriptorMatcher::BucketGroup::push_value( std::vector<uint32_t>& vec, UINT32 Data )
-{
-  if( vec.size() > 0 )
-  {
-    if( vec[0] == vec[1] )
-    {
-      vec[1] = (UINT32) std::max( ceil( vec[1] * ARRAY_RESIZE_FACTOR ), vec[1] + ARRAY_RESIZE_ADD_FACTOR );
-      for ( int i = 0; i < (int) ( 2 + vec[1] - vec.size() ); i++ )
-        vec.push_back( 0 );
-    }
-
-    vec[2 + vec[0]] = Data;
-    vec[0]++;
-
-  }
-
-  else
-  {
-    vec = std::vector < uint32_t > ( 2 + (uint32_t) ARRAY_RESIZE_ADD_FACTOR, 0 );
-    vec[0] = 1;
-    vec[1] = 1;
-    vec[2] = Data;
-  }
-}
-
-/* insert data into the bucket */
-void BinaryDescriptorMatcher::BucketGroup::insert( int subindex, UINT32 data )
-{
-  if( group.size() == 0 )
-  {
-    push_value( group, 0 );
-  }
-
-  UINT32 lowerbits = ( (UINT32) 1 << subindex ) - 1;
-  int end = popcnt( empty & lowerbits );
-
-  if( ! ( empty & ( (UINT32) 1 << subindex ) ) )
-  {
-    insert_value( group, end, group[end + 2] );
-    empty |= (UINT32) 1 << subindex;
-  }
-
-  int totones = popcnt( empty );
-  insert_value( group, totones + 1 + group[2 + end + 1], data );
-
-  for ( int i = end + 1; i < totones + 1; i++ )
-    group[2 + i]++;
-}
-
-/* perform a query to the bucket */
-UINT32* BinaryDescriptorMatcher::BucketGroup::query( int subindex, int *size )
+/* query data */
+const UINT32* BinaryDescriptorMatcher::SparseHashtable::query( UINT64 index, int *Size ) const
 {
-  if( empty & ( (UINT32) 1 << subindex ) )
-  {
-    UINT32 lowerbits = ( (UINT32) 1 << subindex ) - 1;
-    int end = popcnt( empty & lowerbits );
-    int totones = popcnt( empty );
-
-    *size = group[2 + end + 1] - group[2 + end];
-    return & ( * ( group.begin() + 2 + totones + 1 + (int) group[2 + end] ) );
-  }
-
-  else
-  {
-    *size = 0;
-    return NULL;
-  }
+  const UINT32* poffsets = offsets.ptr<UINT32>();
+  *Size = (int) ( poffsets[index + 1] - poffsets[index] );
+  return *Size > 0 ? ids.ptr<UINT32>() + poffsets[index] : NULL;
 }
 
 }
@@ -44,6 +44,7 @@
 #define __OPENCV_BITOPTS_HPP
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/hal.hpp"
 
 #ifdef _MSC_VER
 # include <intrin.h>
@@ -79,20 +80,24 @@ namespace cv
 {
 namespace line_descriptor
 {
-/*matching function */
-inline int match( UINT8*P, UINT8*Q, int codelb )
+/* matching function: Hamming distance between two codes of codelb bytes.
+ cv::hal::normHamming selects the popcount implementation (SSE/AVX/NEON)
+ available at runtime, so the MIH candidate checks share the fastest path */
+inline int match( const UINT8*P, const UINT8*Q, int codelb )
 {
-    int i, output = 0;
-    for( i = 0; i <= codelb - 16; i += 16 )
-    {
-        output += popcnt( *(UINT32*) (P+i) ^ *(UINT32*) (Q+i) ) +
-                  popcnt( *(UINT32*) (P+i+4) ^ *(UINT32*) (Q+i+4) ) +
-                  popcnt( *(UINT32*) (P+i+8) ^ *(UINT32*) (Q+i+8) ) +
-                  popcnt( *(UINT32*) (P+i+12) ^ *(UINT32*) (Q+i+12) );
-    }
-    for( ; i < codelb; i++ )
-        output += lookup[P[i] ^ Q[i]];
-    return output;
+    return cv::hal::normHamming( P, Q, codelb );
+}
+
+/* extracts the substring of b bits (b <= 64) starting at bit offset,
+ with the same bits ordering of split */
+inline UINT64 substring( const UINT8 *code, int offset, int b )
+{
+  UINT64 temp = 0x0;
+  int shift = -( offset & 7 );
+  for ( int nbyte = offset >> 3; shift < b; nbyte++, shift += 8 )
+    temp |= shift >= 0 ? (UINT64) code[nbyte] << shift : (UINT64) code[nbyte] >> -shift;
+
+  return b == 64 ? temp : temp & ( ( UINT64_1 << b ) - UINT64_1 );
 }
 
 /* splitting function (b <= 64) */
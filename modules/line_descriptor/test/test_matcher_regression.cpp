@@ -577,3 +577,44 @@ TEST( BinaryDescriptor_Matcher, regression)
   CV_BinaryDescriptorMatcherTest test( 0.01f );
   test.safe_run();
 }
+
+TEST( BinaryDescriptor_Matcher, saveLoadIndex )
+{
+  Mat train( 500, 32, CV_8UC1 ), query;
+  theRNG().fill( train, RNG::UNIFORM, Scalar( 0 ), Scalar( 256 ) );
+  query = train.rowRange( 0, 100 ).clone();
+  for ( int i = 0; i < query.rows; i++ )
+    query.at<uchar>( i, i % 32 ) ^= 0x11;
+
+  Ptr<BinaryDescriptorMatcher> matcher = BinaryDescriptorMatcher::createBinaryDescriptorMatcher();
+  std::vector<Mat> descriptors;
+  descriptors.push_back( train.rowRange( 0, 200 ) );
+  descriptors.push_back( train.rowRange( 200, 500 ) );
+  matcher->add( descriptors );
+  matcher->train();
+
+  std::vector<DMatch> expected, actual;
+  matcher->match( query, expected );
+  ASSERT_EQ( (size_t) query.rows, expected.size() );
+
+  std::string filename = cvtest::tempfile( ".mih" );
+  matcher->saveIndex( filename );
+
+  Ptr<BinaryDescriptorMatcher> loaded = BinaryDescriptorMatcher::createBinaryDescriptorMatcher();
+  loaded->loadIndex( filename );
+  ::remove( filename.c_str() );
+  loaded->match( query, actual );
+
+  ASSERT_EQ( expected.size(), actual.size() );
+  for ( size_t i = 0; i < expected.size(); i++ )
+  {
+    EXPECT_EQ( (int) i, expected[i].trainIdx );
+    EXPECT_EQ( expected[i].trainIdx, actual[i].trainIdx );
+    EXPECT_EQ( expected[i].imgIdx, actual[i].imgIdx );
+    EXPECT_EQ( expected[i].distance, actual[i].distance );
+  }
+
+  /* data that is not an index is rejected */
+  std::vector<uint32_t> header( 6, 0 );
+  EXPECT_ANY_THROW( loaded->loadIndex( (const uchar*) &header[0], header.size() * sizeof(uint32_t) ) );
+}
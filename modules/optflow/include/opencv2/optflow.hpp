@@ -346,6 +346,22 @@ public:
     CV_WRAP virtual bool getUseSpatialPropagation() const = 0;
     /** @copybrief getUseSpatialPropagation @see getUseSpatialPropagation */
     CV_WRAP virtual void setUseSpatialPropagation(bool val) = 0;
+
+    /** @brief Whether to reuse the state of the previous call for video streams. If the first frame of
+        a call is the second frame of the previous one, the pyramid of the previous second frame is reused
+        and the previous flow is used as the initial flow when no initial flow is passed. It is turned off by
+        default.
+    @see setUseTemporalWarmStart */
+    CV_WRAP virtual bool getUseTemporalWarmStart() const = 0;
+    /** @copybrief getUseTemporalWarmStart @see getUseTemporalWarmStart */
+    CV_WRAP virtual void setUseTemporalWarmStart(bool val) = 0;
+
+    /** @brief Regions of the first frame where the flow is computed. The flow is computed in
+        the whole frame if the list is empty (default), otherwise the flow outside of the regions is zero.
+    @see setROIs */
+    CV_WRAP virtual std::vector<Rect> getROIs() const = 0;
+    /** @copybrief getROIs @see getROIs */
+    CV_WRAP virtual void setROIs(const std::vector<Rect>& val) = 0;
 };
 
 /** @brief Creates an instance of DISOpticalFlow
@@ -101,8 +101,15 @@ protected:
   const float occlusionsThreshold;
   const float dampingFactor;
   const float claheClip;
+  const int irlsIterations;
   bool useOpenCL;
 
+  Size cachedSize;          // resolution the cached data below belongs to
+  Mat basisX, basisY;       // 1D DCT basis sampled at every column and row of the image
+  Mat priorATA1, priorATA2; // normal equations of the prior constraints
+  Mat priorATb1, priorATb2;
+  Mat prevW1, prevW2;       // basis coefficients of the previous frame
+
 public:
   /** @brief Creates an instance of PCAFlow algorithm.
    * @param _prior Learned prior or no prior (default). @see cv::optflow::PCAPrior
@@ -112,21 +119,27 @@ public:
    * @param _occlusionsThreshold Occlusion threshold.
    * @param _dampingFactor Regularization term for solving least-squares. It is not related to the prior regularization.
    * @param _claheClip Clip parameter for CLAHE.
+   * @param _irlsIterations Number of iteratively reweighted least squares iterations with the Huber loss, solved on
+   * the normal equations of the basis. They make the solution robust to wrong matches. The weights are warm-started
+   * from the solution of the previous frame of the same size. Zero (default) keeps the plain damped least squares.
    */
   OpticalFlowPCAFlow( Ptr<const PCAPrior> _prior = Ptr<const PCAPrior>(), const Size _basisSize = Size( 18, 14 ),
                       float _sparseRate = 0.024, float _retainedCornersFraction = 0.2,
-                      float _occlusionsThreshold = 0.0003, float _dampingFactor = 0.00002, float _claheClip = 14 );
+                      float _occlusionsThreshold = 0.0003, float _dampingFactor = 0.00002, float _claheClip = 14,
+                      int _irlsIterations = 0 );
 
   void calc( InputArray I0, InputArray I1, InputOutputArray flow );
   void collectGarbage();
 
 private:
-  void findSparseFeatures( UMat &from, UMat &to, std::vector<Point2f> &features,
+  void findSparseFeatures( UMat &from, InputArray fromPyr, InputArray toPyr, std::vector<Point2f> &features,
                            std::vector<Point2f> &predictedFeatures ) const;
 
-  void removeOcclusions( UMat &from, UMat &to, std::vector<Point2f> &features,
+  void removeOcclusions( UMat &from, InputArray fromPyr, InputArray toPyr, std::vector<Point2f> &features,
                          std::vector<Point2f> &predictedFeatures ) const;
 
+  void prepareCache( const Size size );
+
   void getSystem( OutputArray AOut, OutputArray b1Out, OutputArray b2Out, const std::vector<Point2f> &features,
                   const std::vector<Point2f> &predictedFeatures, const Size size );
 
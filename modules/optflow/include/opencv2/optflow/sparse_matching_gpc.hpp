@@ -205,12 +205,58 @@ private:
 
     bool operator==( const Trail &trail ) const { return memcmp( leaf, trail.leaf, sizeof( leaf ) ) == 0; }
 
-    bool operator<( const Trail &trail ) const
+    size_t hash() const
     {
-      for ( int i = 0; i < T - 1; ++i )
-        if ( leaf[i] != trail.leaf[i] )
-          return leaf[i] < trail.leaf[i];
-      return leaf[T - 1] < trail.leaf[T - 1];
+      unsigned h = 2166136261u; // FNV-1a
+      for ( int i = 0; i < T; ++i )
+        h = ( h ^ leaf[i] ) * 16777619u;
+      return h;
+    }
+  };
+
+  /** Open addressing hash table of the trails, used to find the patches whose leaves combination is unique. */
+  class TrailIndex
+  {
+  private:
+    const std::vector< Trail > &trails;
+    std::vector< int > first; //!< Index of the first trail that fell into the slot, -1 for empty slots.
+    std::vector< int > count; //!< Number of trails equal to the first one.
+    size_t mask;
+
+    TrailIndex &operator=( const TrailIndex & );
+
+    size_t findSlot( const Trail &trail ) const
+    {
+      size_t slot = trail.hash() & mask;
+      while ( first[slot] >= 0 && !( trails[first[slot]] == trail ) )
+        slot = ( slot + 1 ) & mask;
+      return slot;
+    }
+
+  public:
+    TrailIndex( const std::vector< Trail > &_trails ) : trails( _trails )
+    {
+      size_t capacity = 1;
+      while ( capacity < 2 * trails.size() )
+        capacity <<= 1;
+      mask = capacity - 1;
+      first.assign( capacity, -1 );
+      count.assign( capacity, 0 );
+
+      for ( size_t i = 0; i < trails.size(); ++i )
+      {
+        const size_t slot = findSlot( trails[i] );
+        if ( first[slot] < 0 )
+          first[slot] = (int)i;
+        ++count[slot];
+      }
+    }
+
+    /** Returns the index of the only trail equal to the given one, or -1 if there are none or several of them. */
+    int findUnique( const Trail &trail ) const
+    {
+      const size_t slot = findSlot( trail );
+      return count[slot] == 1 ? first[slot] : -1;
     }
   };
 
@@ -229,8 +275,9 @@ private:
 
     void operator()( const Range &range ) const
     {
-      for ( int t = range.start; t < range.end; ++t )
-        for ( size_t i = 0; i < descr->size(); ++i )
+      // All the trees are traversed for a block of patches, so the descriptors are loaded once from memory.
+      for ( int i = range.start; i < range.end; ++i )
+        for ( int t = 0; t < T; ++t )
           trails->at( i ).leaf[t] = forest->tree[t].findLeafForPatch( descr->at( i ) );
     }
   };
@@ -335,33 +382,29 @@ void GPCForest< T >::findCorrespondences( InputArray imgFrom, InputArray imgTo,
 
   std::vector< GPCPatchDescriptor > descr;
   GPCDetails::getAllDescriptorsForImage( fromCh, descr, params, tree[0].getDescriptorType() );
-  std::vector< Trail > trailsFrom( descr.size() ), trailsTo( descr.size() );
+  std::vector< Trail > trailsFrom( descr.size() );
 
   for ( size_t i = 0; i < descr.size(); ++i )
     GPCDetails::getCoordinatesFromIndex( i, from.size(), trailsFrom[i].coord.x, trailsFrom[i].coord.y );
-  parallel_for_( Range( 0, T ), ParallelTrailsFilling( this, &descr, &trailsFrom ) );
+  parallel_for_( Range( 0, (int)descr.size() ), ParallelTrailsFilling( this, &descr, &trailsFrom ) );
 
   descr.clear();
   GPCDetails::getAllDescriptorsForImage( toCh, descr, params, tree[0].getDescriptorType() );
+  std::vector< Trail > trailsTo( descr.size() );
 
   for ( size_t i = 0; i < descr.size(); ++i )
     GPCDetails::getCoordinatesFromIndex( i, to.size(), trailsTo[i].coord.x, trailsTo[i].coord.y );
-  parallel_for_( Range( 0, T ), ParallelTrailsFilling( this, &descr, &trailsTo ) );
-
-  std::sort( trailsFrom.begin(), trailsFrom.end() );
-  std::sort( trailsTo.begin(), trailsTo.end() );
+  parallel_for_( Range( 0, (int)descr.size() ), ParallelTrailsFilling( this, &descr, &trailsTo ) );
 
+  // A correspondence is established for the patches whose trails are unique in both images
+  const TrailIndex indexFrom( trailsFrom ), indexTo( trailsTo );
   for ( size_t i = 0; i < trailsFrom.size(); ++i )
   {
-    bool uniq = true;
-    while ( i + 1 < trailsFrom.size() && trailsFrom[i] == trailsFrom[i + 1] )
-      ++i, uniq = false;
-    if ( uniq )
-    {
-      typename std::vector< Trail >::const_iterator lb = std::lower_bound( trailsTo.begin(), trailsTo.end(), trailsFrom[i] );
-      if ( lb != trailsTo.end() && *lb == trailsFrom[i] && ( ( lb + 1 ) == trailsTo.end() || !( *lb == *( lb + 1 ) ) ) )
-        corr.push_back( std::make_pair( trailsFrom[i].coord, lb->coord ) );
-    }
+    if ( indexFrom.findUnique( trailsFrom[i] ) < 0 )
+      continue;
+    const int j = indexTo.findUnique( trailsFrom[i] );
+    if ( j >= 0 )
+      corr.push_back( std::make_pair( trailsFrom[i].coord, trailsTo[j].coord ) );
   }
 
   GPCDetails::dropOutliers( corr );
@@ -67,3 +67,27 @@ PERF_TEST_P(DenseOpticalFlow_DeepFlow, perf, Values(szVGA, sz720p))
 
     SANITY_CHECK_NOTHING();
 }
+
+PERF_TEST_P(DenseOpticalFlow_DeepFlow, perf_reuse, Values(szVGA, sz720p))
+{
+    DFParams params = GetParam();
+    Size sz = get<0>(params);
+
+    Mat frame1(sz, CV_8U);
+    Mat frame2(sz, CV_8U);
+    Mat flow;
+
+    randu(frame1, 0, 255);
+    randu(frame2, 0, 255);
+
+    cv::setNumThreads(cv::getNumberOfCPUs());
+    // the buffers allocated by the first call are reused by the measured ones
+    Ptr<DenseOpticalFlow> algo = createOptFlow_DeepFlow();
+    algo->calc(frame1, frame2, flow);
+    TEST_CYCLE_N(1)
+    {
+        algo->calc(frame1, frame2, flow);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
@@ -80,6 +80,39 @@ PERF_TEST_P(DenseOpticalFlow_DIS, perf,
     SANITY_CHECK_NOTHING();
 }
 
+PERF_TEST_P(DenseOpticalFlow_DIS, perf_stream_rois,
+            Combine(Values("PRESET_ULTRAFAST", "PRESET_FAST"), Values(szVGA, sz720p)))
+{
+    DISParams params = GetParam();
+    int preset = get<0>(params) == "PRESET_ULTRAFAST" ? DISOpticalFlow::PRESET_ULTRAFAST : DISOpticalFlow::PRESET_FAST;
+    Size sz = get<1>(params);
+
+    Mat frame1(sz, CV_8U);
+    Mat frame2(sz, CV_8U);
+    Mat flow;
+
+    MakeArtificialExample(frame1, frame2);
+
+    // a quarter of the frame is processed, the frames alternate to keep the warm start:
+    std::vector<Rect> rois(1, Rect(sz.width / 4, sz.height / 4, sz.width / 2, sz.height / 2));
+    Ptr<DISOpticalFlow> algo = createOptFlow_DIS(preset);
+    algo->setUseTemporalWarmStart(true);
+    algo->setROIs(rois);
+    algo->calc(frame1, frame2, flow);
+
+    cv::setNumThreads(cv::getNumberOfCPUs());
+    int frame_idx = 0;
+    TEST_CYCLE_N(10)
+    {
+        if (frame_idx++ % 2 == 0)
+            algo->calc(frame2, frame1, flow);
+        else
+            algo->calc(frame1, frame2, flow);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
 void MakeArtificialExample(Mat &dst_frame1, Mat &dst_frame2)
 {
     int src_scale = 2;
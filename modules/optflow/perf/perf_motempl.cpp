@@ -0,0 +1,59 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+
+using std::tr1::tuple;
+using std::tr1::get;
+using namespace perf;
+using namespace testing;
+using namespace cv;
+using namespace cv::motempl;
+
+typedef tuple<Size> Motempl_Params;
+typedef TestBaseWithParam<Motempl_Params> MotionTemplates;
+
+// A mostly static scene with a few small objects moving across it
+static void drawSilhouette(Mat& silh, int frame)
+{
+    silh = Scalar::all(0);
+    const int objects = 3;
+    for (int i = 0; i < objects; i++)
+    {
+        const Size objSize(silh.cols / 20, silh.rows / 8);
+        const int y = (i + 1) * silh.rows / (objects + 1);
+        const int x = (frame * (i + 2) * 3) % (silh.cols - objSize.width);
+        rectangle(silh, Rect(x, y, objSize.width, objSize.height), Scalar::all(255), FILLED);
+    }
+}
+
+PERF_TEST_P(MotionTemplates, surveillance, Values(szVGA, sz720p))
+{
+    const Size sz = get<0>(GetParam());
+    const double duration = 1.0, fps = 30.0;
+    const int historyFrames = 30;
+
+    Mat silh(sz, CV_8UC1), mhi(sz, CV_32FC1, Scalar::all(0)), mask, orient, segmask;
+    std::vector<Rect> rects;
+
+    int frame = 0;
+    for (; frame < historyFrames; frame++)
+    {
+        drawSilhouette(silh, frame);
+        updateMotionHistory(silh, mhi, frame / fps, duration);
+    }
+    drawSilhouette(silh, frame);
+    const double timestamp = frame / fps;
+
+    TEST_CYCLE()
+    {
+        Mat mhiCopy = mhi.clone();
+        rects.clear();
+        updateMotionHistory(silh, mhiCopy, timestamp, duration);
+        calcMotionGradient(mhiCopy, mask, orient, 0.5 / fps, 0.05, 3);
+        segmentMotion(mhiCopy, segmask, rects, timestamp, 0.5 / fps);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
@@ -46,7 +46,8 @@ using namespace cv::optflow;
 typedef tuple<Size, int, int> VarRefParams;
 typedef TestBaseWithParam<VarRefParams> DenseOpticalFlow_VariationalRefinement;
 
-PERF_TEST_P(DenseOpticalFlow_VariationalRefinement, perf, Combine(Values(szQVGA, szVGA), Values(5, 10), Values(5, 10)))
+PERF_TEST_P(DenseOpticalFlow_VariationalRefinement, perf,
+            Combine(Values(szQVGA, szVGA, sz720p), Values(5, 10), Values(5, 10)))
 {
     VarRefParams params = GetParam();
     Size sz = get<0>(params);
@@ -70,8 +70,13 @@ protected:
     int interpolationType;
 
 private:
-    std::vector<Mat> buildPyramid( const Mat& src );
+    void buildPyramid( const Mat& src, std::vector<Mat>& pyramid );
 
+    // Buffers are kept between the calls, so processing a video of a fixed size does not reallocate them
+    Mat I0, I1;
+    std::vector<Mat> pyramid_I0, pyramid_I1;
+    Mat W;
+    Ptr<VariationalRefinement> var;
 };
 
 OpticalFlowDeepFlow::OpticalFlowDeepFlow()
@@ -92,25 +97,30 @@ OpticalFlowDeepFlow::OpticalFlowDeepFlow()
     maxLayers = 200;
 }
 
-std::vector<Mat> OpticalFlowDeepFlow::buildPyramid( const Mat& src )
+void OpticalFlowDeepFlow::buildPyramid( const Mat& src, std::vector<Mat>& pyramid )
 {
-    std::vector<Mat> pyramid;
-    pyramid.push_back(src);
-    Mat prev = pyramid[0];
-    for( int i = 0; i < this->maxLayers; ++i)
+    int levelCount = 1;
+    for( Size sz = src.size(); levelCount <= this->maxLayers; ++levelCount )
     {
-        Mat next; //TODO: filtering at each level?
+        sz = Size((int) (sz.width * downscaleFactor + 0.5f),
+                  (int) (sz.height * downscaleFactor + 0.5f));
+        if( sz.height <= minSize || sz.width <= minSize)
+            break;
+    }
+
+    // the levels of the previous call are reused as destinations of the resizes
+    pyramid.resize(levelCount);
+    pyramid[0] = src;
+    for( int i = 1; i < levelCount; ++i)
+    {
+        //TODO: filtering at each level?
+        const Mat& prev = pyramid[i - 1];
         Size nextSize((int) (prev.cols * downscaleFactor + 0.5f),
                         (int) (prev.rows * downscaleFactor + 0.5f));
-        if( nextSize.height <= minSize || nextSize.width <= minSize)
-            break;
-        resize(prev, next,
+        resize(prev, pyramid[i],
                 nextSize, 0, 0,
                 interpolationType);
-        pyramid.push_back(next);
-        prev = next;
     }
-    return pyramid;
 }
 
 void OpticalFlowDeepFlow::calc( InputArray _I0, InputArray _I1, InputOutputArray _flow )
@@ -123,13 +133,10 @@ void OpticalFlowDeepFlow::calc( InputArray _I0, InputArray _I1, InputOutputArray
     CV_Assert(I0temp.channels() == 1);
     // TODO: currently only grayscale - data term could be computed in color version as well...
 
-    Mat I0, I1;
-
     I0temp.convertTo(I0, CV_32F);
     I1temp.convertTo(I1, CV_32F);
 
-    _flow.create(I0.size(), CV_32FC2);
-    Mat W = _flow.getMat(); // if any data present - will be discarded
+    _flow.create(I0.size(), CV_32FC2); // if any data present - will be discarded
 
     // pre-smooth images
     int kernelLen = ((int)floor(3 * sigma) * 2) + 1;
@@ -137,38 +144,50 @@ void OpticalFlowDeepFlow::calc( InputArray _I0, InputArray _I1, InputOutputArray
     GaussianBlur(I0, I0, kernelSize, sigma);
     GaussianBlur(I1, I1, kernelSize, sigma);
     // build down-sized pyramids
-    std::vector<Mat> pyramid_I0 = buildPyramid(I0);
-    std::vector<Mat> pyramid_I1 = buildPyramid(I1);
+    buildPyramid(I0, pyramid_I0);
+    buildPyramid(I1, pyramid_I1);
     int levelCount = (int) pyramid_I0.size();
 
     // initialize the first version of flow estimate to zeros
     Size smallestSize = pyramid_I0[levelCount - 1].size();
-    W = Mat::zeros(smallestSize, CV_32FC2);
-
+    W.create(smallestSize, CV_32FC2);
+    W.setTo(Scalar::all(0));
+
+    // a single refinement instance serves all the levels, its solver is parallel over the image rows
+    if ( var.empty() )
+        var = createVariationalFlowRefinement();
+    var->setAlpha(4 * alpha);
+    var->setDelta(delta / 3);
+    var->setGamma(gamma / 3);
+    var->setFixedPointIterations(fixedPointIterations);
+    var->setSorIterations(sorIterations);
+    var->setOmega(omega);
+
+    Mat temp;
     for ( int level = levelCount - 1; level >= 0; --level )
     { //iterate through  all levels, beginning with the most coarse
-        Ptr<VariationalRefinement> var = createVariationalFlowRefinement();
-
-        var->setAlpha(4 * alpha);
-        var->setDelta(delta / 3);
-        var->setGamma(gamma / 3);
-        var->setFixedPointIterations(fixedPointIterations);
-        var->setSorIterations(sorIterations);
-        var->setOmega(omega);
-
         var->calc(pyramid_I0[level], pyramid_I1[level], W);
         if ( level > 0 ) //not the last level
         {
-            Mat temp;
             Size newSize = pyramid_I0[level - 1].size();
             resize(W, temp, newSize, 0, 0, interpolationType); //resize calculated flow
-            W = temp * (1.0f / downscaleFactor); //scale values
+            std::swap(W, temp);
+            W *= 1.0f / downscaleFactor; //scale values
         }
     }
     W.copyTo(_flow);
 }
 
-void OpticalFlowDeepFlow::collectGarbage() {}
+void OpticalFlowDeepFlow::collectGarbage()
+{
+    I0.release();
+    I1.release();
+    pyramid_I0.clear();
+    pyramid_I1.clear();
+    W.release();
+    if ( !var.empty() )
+        var->collectGarbage();
+}
 
 Ptr<DenseOpticalFlow> createOptFlow_DeepFlow() { return makePtr<OpticalFlowDeepFlow>(); }
 
@@ -71,6 +71,8 @@ class DISOpticalFlowImpl : public DISOpticalFlow
     float variational_refinement_delta;
     bool use_mean_normalization;
     bool use_spatial_propagation;
+    bool use_temporal_warm_start;
+    vector<Rect> rois;
 
   protected: //!< some auxiliary variables
     int border_size;
@@ -99,6 +101,10 @@ class DISOpticalFlowImpl : public DISOpticalFlow
     void setUseMeanNormalization(bool val) { use_mean_normalization = val; }
     bool getUseSpatialPropagation() const { return use_spatial_propagation; }
     void setUseSpatialPropagation(bool val) { use_spatial_propagation = val; }
+    bool getUseTemporalWarmStart() const { return use_temporal_warm_start; }
+    void setUseTemporalWarmStart(bool val) { use_temporal_warm_start = val; }
+    vector<Rect> getROIs() const { return rois; }
+    void setROIs(const vector<Rect> &val) { rois = val; }
 
   protected:                      //!< internal buffers
     vector<Mat_<uchar> > I0s;     //!< Gaussian pyramid for the current frame
@@ -137,8 +143,20 @@ class DISOpticalFlowImpl : public DISOpticalFlow
 
     vector<Ptr<VariationalRefinement> > variational_refinement_processors;
 
+    /* State kept between the calls for the temporal warm start: */
+    Mat_<uchar> prev_I1;        //!< second frame of the previous call
+    Mat_<Vec2f> prev_flow;      //!< flow computed by the previous call
+    int prev_finest_scale;      //!< finest scale of the previous call, -1 if there is no reusable state
+
+    /* Buffers of the ROI-only mode for the current scale: */
+    vector<Rect> scale_rois;    //!< ROIs on the current scale, extended by the patch size
+    Mat_<uchar> roi_mask;       //!< non-zero for the pixels inside of scale_rois
+    Mat_<uchar> roi_patch_mask; //!< non-zero for the patches that overlap scale_rois
+
   private: //!< private methods and parallel sections
-    void prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_flow);
+    void prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_flow, bool reuse_I0);
+    void prepareROIs(int scale);
+    void refineROIs(int scale);
     void precomputeStructureTensor(Mat &dst_I0xx, Mat &dst_I0yy, Mat &dst_I0xy, Mat &dst_I0x, Mat &dst_I0y, Mat &I0x,
                                    Mat &I0y);
 
@@ -181,6 +199,7 @@ class DISOpticalFlowImpl : public DISOpticalFlow
 
     vector<UMat> u_initial_Ux; //!< x component of the initial flow field, if one was passed as an input
     vector<UMat> u_initial_Uy; //!< y component of the initial flow field, if one was passed as an input
+    vector<UMat> u_flow_uv;    //!< components of the initial flow field at the original resolution
 
     UMat u_U; //!< a buffer for the merged flow
 
@@ -227,6 +246,8 @@ DISOpticalFlowImpl::DISOpticalFlowImpl()
     border_size = 16;
     use_mean_normalization = true;
     use_spatial_propagation = true;
+    use_temporal_warm_start = false;
+    prev_finest_scale = -1;
 
     /* Use separate variational refinement instances for different scales to avoid repeated memory allocation: */
     int max_possible_scales = 10;
@@ -234,7 +255,8 @@ DISOpticalFlowImpl::DISOpticalFlowImpl()
         variational_refinement_processors.push_back(createVariationalFlowRefinement());
 }
 
-void DISOpticalFlowImpl::prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_flow)
+/* If reuse_I0 is set, the first frame is the second frame of the previous call and its pyramid is taken from I1s */
+void DISOpticalFlowImpl::prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_flow, bool reuse_I0)
 {
     I0s.resize(coarsest_scale + 1);
     I1s.resize(coarsest_scale + 1);
@@ -251,6 +273,11 @@ void DISOpticalFlowImpl::prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_fl
         initial_Ux.resize(coarsest_scale + 1);
         initial_Uy.resize(coarsest_scale + 1);
     }
+    else
+    {
+        initial_Ux.clear();
+        initial_Uy.clear();
+    }
 
     int fraction = 1;
     int cur_rows = 0, cur_cols = 0;
@@ -262,8 +289,13 @@ void DISOpticalFlowImpl::prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_fl
         {
             cur_rows = I0.rows / fraction;
             cur_cols = I0.cols / fraction;
-            I0s[i].create(cur_rows, cur_cols);
-            resize(I0, I0s[i], I0s[i].size(), 0.0, 0.0, INTER_AREA);
+            if (reuse_I0)
+                std::swap(I0s[i], I1s[i]);
+            else
+            {
+                I0s[i].create(cur_rows, cur_cols);
+                resize(I0, I0s[i], I0s[i].size(), 0.0, 0.0, INTER_AREA);
+            }
             I1s[i].create(cur_rows, cur_cols);
             resize(I1, I1s[i], I1s[i].size(), 0.0, 0.0, INTER_AREA);
 
@@ -288,8 +320,13 @@ void DISOpticalFlowImpl::prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_fl
         {
             cur_rows = I0s[i - 1].rows / 2;
             cur_cols = I0s[i - 1].cols / 2;
-            I0s[i].create(cur_rows, cur_cols);
-            resize(I0s[i - 1], I0s[i], I0s[i].size(), 0.0, 0.0, INTER_AREA);
+            if (reuse_I0)
+                std::swap(I0s[i], I1s[i]);
+            else
+            {
+                I0s[i].create(cur_rows, cur_cols);
+                resize(I0s[i - 1], I0s[i], I0s[i].size(), 0.0, 0.0, INTER_AREA);
+            }
             I1s[i].create(cur_rows, cur_cols);
             resize(I1s[i - 1], I1s[i], I1s[i].size(), 0.0, 0.0, INTER_AREA);
         }
@@ -322,6 +359,59 @@ void DISOpticalFlowImpl::prepareBuffers(Mat &I0, Mat &I1, Mat &flow, bool use_fl
     }
 }
 
+/* This function computes the ROIs on the current scale and the masks of the pixels and of the patches processed in the
+ * ROI-only mode. The ROIs are extended by the patch size to make the flow near their borders similar to the full frame
+ * mode.
+ */
+void DISOpticalFlowImpl::prepareROIs(int scale)
+{
+    Rect frame(0, 0, w, h);
+    int pstr = patch_stride;
+    int psz = patch_size;
+    int round = (1 << scale) - 1;
+
+    scale_rois.clear();
+    roi_mask.create(h, w);
+    roi_mask.setTo(0);
+    roi_patch_mask.create(hs, ws);
+    roi_patch_mask.setTo(0);
+    for (size_t k = 0; k < rois.size(); k++)
+    {
+        int x0 = (rois[k].x >> scale) - psz;
+        int y0 = (rois[k].y >> scale) - psz;
+        int x1 = ((rois[k].x + rois[k].width + round) >> scale) + psz;
+        int y1 = ((rois[k].y + rois[k].height + round) >> scale) + psz;
+        Rect r = Rect(x0, y0, x1 - x0, y1 - y0) & frame;
+        if (r.area() <= 0)
+            continue;
+        scale_rois.push_back(r);
+        roi_mask(r).setTo(1);
+
+        /* Patch (is, js) covers the pixels [is * pstr, is * pstr + psz) x [js * pstr, js * pstr + psz) */
+        int start_is = r.y < psz ? 0 : (r.y - psz) / pstr + 1;
+        int start_js = r.x < psz ? 0 : (r.x - psz) / pstr + 1;
+        int end_is = min((r.y + r.height - 1) / pstr + 1, hs);
+        int end_js = min((r.x + r.width - 1) / pstr + 1, ws);
+        if (start_is < end_is && start_js < end_js)
+            roi_patch_mask(Range(start_is, end_is), Range(start_js, end_js)).setTo(1);
+    }
+}
+
+/* Variational refinement in the ROI-only mode, each ROI is refined separately */
+void DISOpticalFlowImpl::refineROIs(int scale)
+{
+    for (size_t k = 0; k < scale_rois.size(); k++)
+    {
+        const Rect &r = scale_rois[k];
+        Mat_<float> roi_Ux = Ux[scale](r).clone();
+        Mat_<float> roi_Uy = Uy[scale](r).clone();
+        variational_refinement_processors[scale]->calcUV(I0s[scale](r).clone(), I1s[scale](r).clone(), roi_Ux,
+                                                         roi_Uy);
+        roi_Ux.copyTo(Ux[scale](r));
+        roi_Uy.copyTo(Uy[scale](r));
+    }
+}
+
 /* This function computes the structure tensor elements (local sums of I0x^2, I0x*I0y and I0y^2).
  * A simple box filter is not used instead because we need to compute these sums on a sparse grid
  * and store them densely in the output buffers.
@@ -774,6 +864,9 @@ void DISOpticalFlowImpl::PatchInverseSearch_ParBody::operator()(const Range &ran
     float *x_ptr = dis->I0x_buf.ptr<float>();
     float *y_ptr = dis->I0y_buf.ptr<float>();
 
+    /* Patches outside of the ROIs in the ROI-only mode: */
+    uchar *roi_patch_ptr = dis->rois.empty() ? NULL : dis->roi_patch_mask.ptr<uchar>();
+
     bool use_temporal_candidates = false;
     float *initial_Ux_ptr = NULL, *initial_Uy_ptr = NULL;
     if (!dis->initial_Ux.empty())
@@ -840,6 +933,15 @@ void DISOpticalFlowImpl::PatchInverseSearch_ParBody::operator()(const Range &ran
             j = start_j;
             for (int js = start_js; dir * js < dir * end_js; js += dir)
             {
+                if (roi_patch_ptr && !roi_patch_ptr[is * dis->ws + js])
+                {
+                    /* Patches outside of the ROIs are not searched and have zero flow */
+                    Sx_ptr[is * dis->ws + js] = 0.0f;
+                    Sy_ptr[is * dis->ws + js] = 0.0f;
+                    j += dir * dis->patch_stride;
+                    continue;
+                }
+
                 if (iter == 0)
                 {
                     /* Using result form the previous pyramid level as the very first approximation: */
@@ -980,6 +1082,9 @@ void DISOpticalFlowImpl::Densification_ParBody::operator()(const Range &range) c
     uchar *I0_ptr = I0->ptr<uchar>();
     uchar *I1_ptr = I1->ptr<uchar>();
 
+    /* Pixels outside of the ROIs in the ROI-only mode: */
+    uchar *roi_ptr = dis->rois.empty() ? NULL : dis->roi_mask.ptr<uchar>();
+
     int psz = dis->patch_size;
     int pstr = dis->patch_stride;
     int i_l, i_u;
@@ -1018,6 +1123,12 @@ void DISOpticalFlowImpl::Densification_ParBody::operator()(const Range &range) c
         for (int j = 0; j < dis->w; j++)
         {
             UPDATE_SPARSE_J_COORDINATES;
+            if (roi_ptr && !roi_ptr[i * dis->w + j])
+            {
+                Ux_ptr[i * dis->w + j] = 0.0f;
+                Uy_ptr[i * dis->w + j] = 0.0f;
+                continue;
+            }
             float coef, sum_coef = 0.0f;
             float sum_Ux = 0.0f;
             float sum_Uy = 0.0f;
@@ -1190,13 +1301,17 @@ void DISOpticalFlowImpl::ocl_prepareBuffers(UMat &I0, UMat &I1, UMat &flow, bool
     u_Ux.resize(coarsest_scale + 1);
     u_Uy.resize(coarsest_scale + 1);
 
-    vector<UMat> flow_uv(2);
     if (use_flow)
     {
-        split(flow, flow_uv);
+        split(flow, u_flow_uv);
         u_initial_Ux.resize(coarsest_scale + 1);
         u_initial_Uy.resize(coarsest_scale + 1);
     }
+    else
+    {
+        u_initial_Ux.clear();
+        u_initial_Uy.clear();
+    }
 
     int fraction = 1;
     int cur_rows = 0, cur_cols = 0;
@@ -1257,9 +1372,9 @@ void DISOpticalFlowImpl::ocl_prepareBuffers(UMat &I0, UMat &I1, UMat &flow, bool
 
             if (use_flow)
             {
-                resize(flow_uv[0], u_initial_Ux[i], Size(cur_cols, cur_rows));
+                resize(u_flow_uv[0], u_initial_Ux[i], Size(cur_cols, cur_rows));
                 divide(u_initial_Ux[i], static_cast<float>(fraction), u_initial_Ux[i]);
-                resize(flow_uv[1], u_initial_Uy[i], Size(cur_cols, cur_rows));
+                resize(u_flow_uv[1], u_initial_Uy[i], Size(cur_cols, cur_rows));
                 divide(u_initial_Uy[i], static_cast<float>(fraction), u_initial_Uy[i]);
             }
         }
@@ -1339,9 +1454,9 @@ bool DISOpticalFlowImpl::ocl_calc(InputArray I0, InputArray I1, InputOutputArray
         if (!ocl_Densification(u_Ux[i], u_Uy[i], u_Sx, u_Sy, u_I0s[i], u_I1s[i]))
             return false;
 
+        /* The refinement of UMat flow runs on the device as well, so the whole pyramid stays device-resident */
         if (variational_refinement_iter > 0)
-            variational_refinement_processors[i]->calcUV(u_I0s[i], u_I1s[i],
-                                                         u_Ux[i].getMat(ACCESS_WRITE), u_Uy[i].getMat(ACCESS_WRITE));
+            variational_refinement_processors[i]->calcUV(u_I0s[i], u_I1s[i], u_Ux[i], u_Uy[i]);
 
         if (i > finest_scale)
         {
@@ -1371,7 +1486,8 @@ void DISOpticalFlowImpl::calc(InputArray I0, InputArray I1, InputOutputArray flo
     CV_Assert(I1.isContinuous());
 
     CV_OCL_RUN(ocl::Device::getDefault().isIntel() && flow.isUMat() &&
-               (patch_size == 8) && (use_spatial_propagation == true),
+               (patch_size == 8) && (use_spatial_propagation == true) &&
+               !use_temporal_warm_start && rois.empty(),
                ocl_calc(I0, I1, flow));
 
     Mat I0Mat = I0.getMat();
@@ -1385,7 +1501,21 @@ void DISOpticalFlowImpl::calc(InputArray I0, InputArray I1, InputOutputArray flo
     coarsest_scale = (int)(log((2 * I0Mat.cols) / (4.0 * patch_size)) / log(2.0) + 0.5) - 1;
     int num_stripes = getNumThreads();
 
-    prepareBuffers(I0Mat, I1Mat, flowMat, use_input_flow);
+    /* The state of the previous call is reused only if its second frame is the current first frame and the pyramid
+     * has the same layout
+     */
+    bool reuse_I0 = use_temporal_warm_start && prev_finest_scale == finest_scale &&
+                    (int)I1s.size() == coarsest_scale + 1 && prev_I1.size() == I0Mat.size() &&
+                    memcmp(prev_I1.ptr(), I0Mat.ptr(), I0Mat.total()) == 0;
+    Mat initial_flow = flowMat;
+    if (reuse_I0 && !use_input_flow)
+    {
+        /* Warm start from the flow of the previous frames */
+        initial_flow = prev_flow;
+        use_input_flow = true;
+    }
+
+    prepareBuffers(I0Mat, I1Mat, initial_flow, use_input_flow, reuse_I0);
     Ux[coarsest_scale].setTo(0.0f);
     Uy[coarsest_scale].setTo(0.0f);
 
@@ -1396,6 +1526,8 @@ void DISOpticalFlowImpl::calc(InputArray I0, InputArray I1, InputOutputArray flo
         ws = 1 + (w - patch_size) / patch_stride;
         hs = 1 + (h - patch_size) / patch_stride;
 
+        if (!rois.empty())
+            prepareROIs(i);
         precomputeStructureTensor(I0xx_buf, I0yy_buf, I0xy_buf, I0x_buf, I0y_buf, I0xs[i], I0ys[i]);
         if (use_spatial_propagation)
         {
@@ -1415,7 +1547,12 @@ void DISOpticalFlowImpl::calc(InputArray I0, InputArray I1, InputOutputArray flo
         parallel_for_(Range(0, num_stripes),
                       Densification_ParBody(*this, num_stripes, I0s[i].rows, Ux[i], Uy[i], Sx, Sy, I0s[i], I1s[i]));
         if (variational_refinement_iter > 0)
-            variational_refinement_processors[i]->calcUV(I0s[i], I1s[i], Ux[i], Uy[i]);
+        {
+            if (rois.empty())
+                variational_refinement_processors[i]->calcUV(I0s[i], I1s[i], Ux[i], Uy[i]);
+            else
+                refineROIs(i);
+        }
 
         if (i > finest_scale)
         {
@@ -1429,6 +1566,29 @@ void DISOpticalFlowImpl::calc(InputArray I0, InputArray I1, InputOutputArray flo
     merge(uxy, 2, U);
     resize(U, flowMat, flowMat.size());
     flowMat *= 1 << finest_scale;
+
+    if (!rois.empty())
+    {
+        /* Remove the flow of the ROI margins */
+        Mat roi_flow(flowMat.size(), CV_32FC2, Scalar::all(0));
+        Rect frame(0, 0, flowMat.cols, flowMat.rows);
+        for (size_t k = 0; k < rois.size(); k++)
+        {
+            Rect r = rois[k] & frame;
+            if (r.area() > 0)
+                flowMat(r).copyTo(roi_flow(r));
+        }
+        roi_flow.copyTo(flowMat);
+    }
+
+    if (use_temporal_warm_start)
+    {
+        I1Mat.copyTo(prev_I1);
+        flowMat.copyTo(prev_flow);
+        prev_finest_scale = finest_scale;
+    }
+    else
+        prev_finest_scale = -1;
 }
 
 void DISOpticalFlowImpl::collectGarbage()
@@ -1449,6 +1609,12 @@ void DISOpticalFlowImpl::collectGarbage()
     I0xx_buf_aux.release();
     I0yy_buf_aux.release();
     I0xy_buf_aux.release();
+    prev_I1.release();
+    prev_flow.release();
+    prev_finest_scale = -1;
+    scale_rois.clear();
+    roi_mask.release();
+    roi_patch_mask.release();
 
 #ifdef HAVE_OPENCL
     u_I0s.clear();
@@ -1459,6 +1625,9 @@ void DISOpticalFlowImpl::collectGarbage()
     u_Ux.clear();
     u_Uy.clear();
     u_U.release();
+    u_flow_uv.clear();
+    u_initial_Ux.clear();
+    u_initial_Uy.clear();
     u_Sx.release();
     u_Sy.release();
     u_I0xx_buf.release();
@@ -42,6 +42,7 @@
 #include "precomp.hpp"
 #include "opencv2/core/utility.hpp"
 #include "opencv2/core/hal/hal.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "opencv2/core/private.hpp"
 #include "opencl_kernels_optflow.hpp"
 
@@ -105,39 +106,29 @@ void updateMotionHistory( InputArray _silhouette, InputOutputArray _mhi,
         return;
 #endif
 
-#if CV_SSE2
-    volatile bool useSIMD = checkHardwareSupport(CV_CPU_SSE2);
-#endif
-
     for(int y = 0; y < size.height; y++ )
     {
         const uchar* silhData = silh.ptr<uchar>(y);
         float* mhiData = mhi.ptr<float>(y);
         int x = 0;
 
-#if CV_SSE2
-        if( useSIMD )
+#if CV_SIMD128
+        v_float32x4 ts4 = v_setall_f32(ts), db4 = v_setall_f32(delbound);
+        v_uint32x4 z = v_setzero_u32();
+        for( ; x <= size.width - 16; x += 16 )
         {
-            __m128 ts4 = _mm_set1_ps(ts), db4 = _mm_set1_ps(delbound);
-            for( ; x <= size.width - 8; x += 8 )
-            {
-                __m128i z = _mm_setzero_si128();
-                __m128i s = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(silhData + x)), z);
-                __m128 s0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(s, z)), s1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(s, z));
-                __m128 v0 = _mm_loadu_ps(mhiData + x), v1 = _mm_loadu_ps(mhiData + x + 4);
-                __m128 fz = _mm_setzero_ps();
-
-                v0 = _mm_and_ps(v0, _mm_cmpge_ps(v0, db4));
-                v1 = _mm_and_ps(v1, _mm_cmpge_ps(v1, db4));
-
-                __m128 m0 = _mm_and_ps(_mm_xor_ps(v0, ts4), _mm_cmpneq_ps(s0, fz));
-                __m128 m1 = _mm_and_ps(_mm_xor_ps(v1, ts4), _mm_cmpneq_ps(s1, fz));
-
-                v0 = _mm_xor_ps(v0, m0);
-                v1 = _mm_xor_ps(v1, m1);
+            v_uint16x8 s0, s1;
+            v_uint32x4 s[4];
+            v_expand(v_load(silhData + x), s0, s1);
+            v_expand(s0, s[0], s[1]);
+            v_expand(s1, s[2], s[3]);
 
-                _mm_storeu_ps(mhiData + x, v0);
-                _mm_storeu_ps(mhiData + x + 4, v1);
+            for( int k = 0; k < 4; k++ )
+            {
+                v_float32x4 v = v_load(mhiData + x + 4*k);
+                v = v & (v >= db4);
+                v = v_select(v_reinterpret_as_f32(s[k] != z), ts4, v);
+                v_store(mhiData + x + 4*k, v);
             }
         }
 #endif
@@ -152,6 +143,30 @@ void updateMotionHistory( InputArray _silhouette, InputOutputArray _mhi,
 }
 
 
+/* Bounding rectangle of the nonzero pixels of a float image, empty if there are none */
+static Rect nonZeroBoundingRect( const Mat& img )
+{
+    int top = -1, bottom = -1, left = img.cols, right = -1;
+    for( int y = 0; y < img.rows; y++ )
+    {
+        const float* row = img.ptr<float>(y);
+        int x0 = 0, x1 = img.cols - 1;
+        while( x0 < img.cols && row[x0] == 0 )
+            x0++;
+        if( x0 == img.cols )
+            continue;
+        while( row[x1] == 0 )
+            x1--;
+
+        if( top < 0 )
+            top = y;
+        bottom = y;
+        left = std::min(left, x0);
+        right = std::max(right, x1);
+    }
+    return top < 0 ? Rect() : Rect(left, top, right - left + 1, bottom - top + 1);
+}
+
 void calcMotionGradient( InputArray _mhi, OutputArray _mask,
                              OutputArray _orientation,
                              double delta1, double delta2,
@@ -192,66 +207,81 @@ void calcMotionGradient( InputArray _mhi, OutputArray _mask,
     float min_delta = (float)delta1;
     float max_delta = (float)delta2;
 
-    Mat dX_min, dY_max;
+    // Both the gradient and the min/max filters only see a neighborhood of the aperture radius.
+    // Pixels farther than that from any nonzero MHI value (no motion in the history) always
+    // get zero mask and orientation, so the filters are only run on the rest of the image.
+    Rect roi = nonZeroBoundingRect(mhi);
+    mask = Scalar::all(0);
+    orient = Scalar::all(0);
+    if( roi.empty() )
+        return;
 
-    // calc Dx and Dy
-    Sobel( mhi, dX_min, CV_32F, 1, 0, aperture_size, 1, 0, BORDER_REPLICATE );
-    Sobel( mhi, dY_max, CV_32F, 0, 1, aperture_size, 1, 0, BORDER_REPLICATE );
+    const int radius = aperture_size/2;
+    roi.x -= radius;
+    roi.y -= radius;
+    roi.width += 2*radius;
+    roi.height += 2*radius;
+    roi &= Rect(0, 0, size.width, size.height);
 
-    int x, y;
+    // filtering a submatrix takes the pixels outside of it into account,
+    // so the results inside of the ROI are the same as for the whole image
+    Mat mhi_roi = mhi(roi), mask_roi = mask(roi), orient_roi = orient(roi);
+    Mat dX, dY, mhi_min, mhi_max;
 
-    if( mhi.isContinuous() && orient.isContinuous() && mask.isContinuous() )
-    {
-        size.width *= size.height;
-        size.height = 1;
-    }
+    // calc Dx and Dy
+    Sobel( mhi_roi, dX, CV_32F, 1, 0, aperture_size, 1, 0, BORDER_REPLICATE );
+    Sobel( mhi_roi, dY, CV_32F, 0, 1, aperture_size, 1, 0, BORDER_REPLICATE );
 
-    // calc gradient
-    for( y = 0; y < size.height; y++ )
+    erode( mhi_roi, mhi_min, noArray(), Point(-1,-1), (aperture_size-1)/2, BORDER_REPLICATE );
+    dilate( mhi_roi, mhi_max, noArray(), Point(-1,-1), (aperture_size-1)/2, BORDER_REPLICATE );
+
+    for( int y = 0; y < roi.height; y++ )
     {
-        const float* dX_min_row = dX_min.ptr<float>(y);
-        const float* dY_max_row = dY_max.ptr<float>(y);
-        float* orient_row = orient.ptr<float>(y);
-        uchar* mask_row = mask.ptr<uchar>(y);
+        const float* dX_row = dX.ptr<float>(y);
+        const float* dY_row = dY.ptr<float>(y);
+        const float* min_row = mhi_min.ptr<float>(y);
+        const float* max_row = mhi_max.ptr<float>(y);
+        float* orient_row = orient_roi.ptr<float>(y);
+        uchar* mask_row = mask_roi.ptr<uchar>(y);
+        int x = 0;
 
-        cv::hal::fastAtan2(dY_max_row, dX_min_row, orient_row, size.width, true);
+        cv::hal::fastAtan2(dY_row, dX_row, orient_row, roi.width, true);
 
-        // make orientation zero where the gradient is very small
-        for( x = 0; x < size.width; x++ )
+        // make orientation zero where the gradient is very small and
+        // mask off pixels which have little motion difference in their neighborhood
+#if CV_SIMD128
+        v_float32x4 eps4 = v_setall_f32(gradient_epsilon);
+        v_float32x4 min4 = v_setall_f32(min_delta), max4 = v_setall_f32(max_delta);
+        v_uint8x16 one16 = v_setall_u8(1);
+        for( ; x <= roi.width - 16; x += 16 )
         {
-            float dY = dY_max_row[x];
-            float dX = dX_min_row[x];
-
-            if( std::abs(dX) < gradient_epsilon && std::abs(dY) < gradient_epsilon )
+            v_uint32x4 valid[4];
+            for( int k = 0; k < 4; k++ )
             {
-                mask_row[x] = (uchar)0;
-                orient_row[x] = 0.f;
+                v_float32x4 dx = v_load(dX_row + x + 4*k), dy = v_load(dY_row + x + 4*k);
+                v_float32x4 d0 = v_load(max_row + x + 4*k) - v_load(min_row + x + 4*k);
+                v_float32x4 m = ((v_abs(dx) >= eps4) | (v_abs(dy) >= eps4)) & (d0 >= min4) & (d0 <= max4);
+                v_store(orient_row + x + 4*k, v_load(orient_row + x + 4*k) & m);
+                valid[k] = v_reinterpret_as_u32(m);
             }
-            else
-                mask_row[x] = (uchar)1;
+            v_uint8x16 m8 = v_pack(v_pack(valid[0], valid[1]), v_pack(valid[2], valid[3]));
+            v_store(mask_row + x, m8 & one16);
         }
-    }
-
-    erode( mhi, dX_min, noArray(), Point(-1,-1), (aperture_size-1)/2, BORDER_REPLICATE );
-    dilate( mhi, dY_max, noArray(), Point(-1,-1), (aperture_size-1)/2, BORDER_REPLICATE );
-
-    // mask off pixels which have little motion difference in their neighborhood
-    for( y = 0; y < size.height; y++ )
-    {
-        const float* dX_min_row = dX_min.ptr<float>(y);
-        const float* dY_max_row = dY_max.ptr<float>(y);
-        float* orient_row = orient.ptr<float>(y);
-        uchar* mask_row = mask.ptr<uchar>(y);
-
-        for( x = 0; x < size.width; x++ )
+#endif
+        for( ; x < roi.width; x++ )
         {
-            float d0 = dY_max_row[x] - dX_min_row[x];
+            float dY0 = dY_row[x];
+            float dX0 = dX_row[x];
+            float d0 = max_row[x] - min_row[x];
 
-            if( mask_row[x] == 0 || d0 < min_delta || max_delta < d0 )
+            if( (std::abs(dX0) < gradient_epsilon && std::abs(dY0) < gradient_epsilon) ||
+                d0 < min_delta || max_delta < d0 )
             {
                 mask_row[x] = (uchar)0;
                 orient_row[x] = 0.f;
             }
+            else
+                mask_row[x] = (uchar)1;
         }
     }
 }
@@ -366,17 +396,7 @@ void segmentMotion(InputArray _mhi, OutputArray _segmask,
     int x, y;
 
     // protect zero mhi pixels from floodfill.
-    for( y = 0; y < mhi.rows; y++ )
-    {
-        const float* mhiptr = mhi.ptr<float>(y);
-        uchar* maskptr = mask.ptr<uchar>(y+1) + 1;
-
-        for( x = 0; x < mhi.cols; x++ )
-        {
-            if( mhiptr[x] == 0 )
-                maskptr[x] = 1;
-        }
-    }
+    mask(Rect(1, 1, mhi.cols, mhi.rows)).setTo(Scalar::all(1), mhi == 0);
 
     float ts = (float)timestamp;
     float comp_idx = 1.f;
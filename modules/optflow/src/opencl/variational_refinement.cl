@@ -0,0 +1,183 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+/* The buffers are dense w x h float images. Neighbors outside of the image do not contribute to the smoothness term,
+ * which is equivalent to the repeated borders of the red-black buffers in the CPU implementation.
+ */
+
+__kernel void vr_warp_maps(__global const float *flow_u, __global const float *flow_v, int w, int h,
+                           __global float *map_x, __global float *map_y)
+{
+    int j = get_global_id(0);
+    int i = get_global_id(1);
+
+    if (i >= h || j >= w) return;
+
+    int index = i * w + j;
+    map_x[index] = j + flow_u[index];
+    map_y[index] = i + flow_v[index];
+}
+
+/* Weights of the smoothness term for the flow W + dW of the current fixed point iteration */
+__kernel void vr_smoothness_weights(__global const float *W_u, __global const float *W_v,
+                                    __global const float *dW_u, __global const float *dW_v,
+                                    int w, int h, float alpha2, float epsilon_squared,
+                                    __global float *weights)
+{
+    int j = get_global_id(0);
+    int i = get_global_id(1);
+
+    if (i >= h || j >= w) return;
+
+    int index = i * w + j;
+    float u = W_u[index] + dW_u[index];
+    float v = W_v[index] + dW_v[index];
+    float ux = 0.0f, vx = 0.0f, uy = 0.0f, vy = 0.0f;
+    if (j < w - 1)
+    {
+        ux = W_u[index + 1] + dW_u[index + 1] - u;
+        vx = W_v[index + 1] + dW_v[index + 1] - v;
+    }
+    if (i < h - 1)
+    {
+        uy = W_u[index + w] + dW_u[index + w] - u;
+        vy = W_v[index + w] + dW_v[index + w] - v;
+    }
+    weights[index] = alpha2 / sqrt(ux * ux + vx * vx + uy * uy + vy * vy + epsilon_squared);
+}
+
+/* Coefficients of the main linear system: color and gradient constancy terms and the smoothness term */
+__kernel void vr_linear_system(__global const float *Ix, __global const float *Iy, __global const float *Iz,
+                               __global const float *Ixx, __global const float *Ixy, __global const float *Iyy,
+                               __global const float *Ixz, __global const float *Iyz,
+                               __global const float *W_u, __global const float *W_v,
+                               __global const float *dW_u, __global const float *dW_v,
+                               __global const float *weights,
+                               int w, int h, float zeta_squared, float epsilon_squared, float gamma2, float delta2,
+                               __global float *A11, __global float *A12, __global float *A22,
+                               __global float *b1, __global float *b2)
+{
+    int j = get_global_id(0);
+    int i = get_global_id(1);
+
+    if (i >= h || j >= w) return;
+
+    int index = i * w + j;
+    float ix = Ix[index], iy = Iy[index], iz = Iz[index];
+    float ixx = Ixx[index], ixy = Ixy[index], iyy = Iyy[index];
+    float ixz = Ixz[index], iyz = Iyz[index];
+    float du = dW_u[index], dv = dW_v[index];
+
+    /* Color constancy */
+    float derivNorm = ix * ix + iy * iy + zeta_squared;
+    float Ik1z = iz + ix * du + iy * dv;
+    float weight = (delta2 / sqrt(Ik1z * Ik1z / derivNorm + epsilon_squared)) / derivNorm;
+    float a11 = weight * (ix * ix) + zeta_squared;
+    float a12 = weight * (ix * iy);
+    float a22 = weight * (iy * iy) + zeta_squared;
+    float rhs1 = -weight * (iz * ix);
+    float rhs2 = -weight * (iz * iy);
+
+    /* Gradient constancy */
+    derivNorm = ixx * ixx + ixy * ixy + zeta_squared;
+    float derivNorm2 = iyy * iyy + ixy * ixy + zeta_squared;
+    float Ik1zx = ixz + ixx * du + ixy * dv;
+    float Ik1zy = iyz + ixy * du + iyy * dv;
+    weight = gamma2 / sqrt(Ik1zx * Ik1zx / derivNorm + Ik1zy * Ik1zy / derivNorm2 + epsilon_squared);
+    a11 += weight * (ixx * ixx / derivNorm + ixy * ixy / derivNorm2);
+    a12 += weight * (ixx * ixy / derivNorm + ixy * iyy / derivNorm2);
+    a22 += weight * (ixy * ixy / derivNorm + iyy * iyy / derivNorm2);
+    rhs1 -= weight * (ixx * ixz / derivNorm + ixy * iyz / derivNorm2);
+    rhs2 -= weight * (ixy * ixz / derivNorm + iyy * iyz / derivNorm2);
+
+    /* Smoothness, gathered from the four neighbors */
+    float u = W_u[index], v = W_v[index];
+    float wt;
+    if (j < w - 1)
+    {
+        wt = weights[index];
+        a11 += wt;
+        a22 += wt;
+        rhs1 += wt * (W_u[index + 1] - u);
+        rhs2 += wt * (W_v[index + 1] - v);
+    }
+    if (j > 0)
+    {
+        wt = weights[index - 1];
+        a11 += wt;
+        a22 += wt;
+        rhs1 -= wt * (u - W_u[index - 1]);
+        rhs2 -= wt * (v - W_v[index - 1]);
+    }
+    if (i < h - 1)
+    {
+        wt = weights[index];
+        a11 += wt;
+        a22 += wt;
+        rhs1 += wt * (W_u[index + w] - u);
+        rhs2 += wt * (W_v[index + w] - v);
+    }
+    if (i > 0)
+    {
+        wt = weights[index - w];
+        a11 += wt;
+        a22 += wt;
+        rhs1 -= wt * (u - W_u[index - w]);
+        rhs2 -= wt * (v - W_v[index - w]);
+    }
+
+    A11[index] = a11;
+    A12[index] = a12;
+    A22[index] = a22;
+    b1[index] = rhs1;
+    b2[index] = rhs2;
+}
+
+/* One half-iteration of Red-Black SOR: the work-item x processes the x-th element of the color in row i */
+__kernel void vr_red_black_sor(__global const float *A11, __global const float *A12, __global const float *A22,
+                               __global const float *b1, __global const float *b2, __global const float *weights,
+                               int w, int h, float omega, int color,
+                               __global float *dW_u, __global float *dW_v)
+{
+    int i = get_global_id(1);
+    int j = 2 * get_global_id(0) + ((i + color) & 1);
+
+    if (i >= h || j >= w) return;
+
+    int index = i * w + j;
+    float sigmaU = 0.0f, sigmaV = 0.0f;
+    float wt;
+    if (j < w - 1)
+    {
+        wt = weights[index];
+        sigmaU += wt * dW_u[index + 1];
+        sigmaV += wt * dW_v[index + 1];
+    }
+    if (j > 0)
+    {
+        wt = weights[index - 1];
+        sigmaU += wt * dW_u[index - 1];
+        sigmaV += wt * dW_v[index - 1];
+    }
+    if (i < h - 1)
+    {
+        wt = weights[index];
+        sigmaU += wt * dW_u[index + w];
+        sigmaV += wt * dW_v[index + w];
+    }
+    if (i > 0)
+    {
+        wt = weights[index - w];
+        sigmaU += wt * dW_u[index - w];
+        sigmaV += wt * dW_v[index - w];
+    }
+
+    float a12 = A12[index];
+    float du = dW_u[index];
+    float dv = dW_v[index];
+    du += omega * ((sigmaU + b1[index] - dv * a12) / A11[index] - du);
+    dv += omega * ((sigmaV + b2[index] - du * a12) / A22[index] - dv);
+    dW_u[index] = du;
+    dW_v[index] = dv;
+}
@@ -191,12 +191,98 @@ void solveLSQR( const Mat &A, const Mat &b, OutputArray xOut, const double damp
   }
 }
 
-inline void _cpu_fillDCTSampledPoints( float *row, const Point2f &p, const Size &basisSize, const Size &size )
+/* Iteratively reweighted least squares with the Huber loss on the residuals of the features.
+ * The first featuresCount rows of the system are the features, the rest are the prior constraints that are not
+ * reweighted. The system is solved through its normal equations, which are only basisSize.area() x basisSize.area(),
+ * and the part of the prior constraints is computed once and kept in priorATA, priorATb.
+ *
+ * Input:
+ *   x -- initial solution
+ * Output:
+ *   x -- robust solution
+ */
+void solveIRLS( const Mat &A, const Mat &b, const int featuresCount, Mat &priorATA, Mat &priorATb, const double damp,
+                const int iterations, Mat &x )
 {
+  const double huberDelta = 1.0; // in pixels of flow
+  CV_Assert( A.type() == CV_32F && b.type() == CV_32F && x.type() == CV_32F );
+
+  if ( featuresCount < A.rows && priorATA.empty() )
+  {
+    Mat L, c;
+    A.rowRange( featuresCount, A.rows ).convertTo( L, CV_64F );
+    b.rowRange( featuresCount, b.rows ).convertTo( c, CV_64F );
+    mulTransposed( L, priorATA, true );
+    priorATb = L.t() * c;
+  }
+
+  Mat Af, bf, xd;
+  A.rowRange( 0, featuresCount ).convertTo( Af, CV_64F );
+  b.rowRange( 0, featuresCount ).convertTo( bf, CV_64F );
+  x.convertTo( xd, CV_64F );
+
+  Mat Aw( Af.size(), CV_64F ), bw( bf.size(), CV_64F ), ATA, ATb;
+  for ( int itn = 0; itn < iterations; ++itn )
+  {
+    const Mat r = Af * xd - bf;
+    for ( int i = 0; i < featuresCount; ++i )
+    {
+      // Rows are scaled by the square roots of the weights
+      const double absR = std::abs( r.at<double>( i ) );
+      const double rowWeight = absR <= huberDelta ? 1.0 : std::sqrt( huberDelta / absR );
+      const double *src = Af.ptr<double>( i );
+      double *dst = Aw.ptr<double>( i );
+      for ( int j = 0; j < Af.cols; ++j )
+        dst[j] = src[j] * rowWeight;
+      bw.at<double>( i ) = bf.at<double>( i ) * rowWeight;
+    }
+
+    mulTransposed( Aw, ATA, true );
+    ATb = Aw.t() * bw;
+    if ( !priorATA.empty() )
+    {
+      ATA += priorATA;
+      ATb += priorATb;
+    }
+    Mat ATAdiag = ATA.diag();
+    ATAdiag += Scalar::all( damp * damp );
+    solve( ATA, ATb, xd, DECOMP_CHOLESKY );
+  }
+  xd.convertTo( x, CV_32F );
+}
+
+inline void fillDCTBasis( float *basis, float x, int basisLength, int size )
+{
+  for ( int n = 0; n < basisLength; ++n )
+    basis[n] = cosf( ( n * CV_PI / size ) * ( x + 0.5 ) );
+}
+
+/* The DCT basis is separable, so a row of the system is the outer product of the 1D bases sampled at the point
+ * coordinates. For the pixel centers these are taken from the per-resolution tables.
+ */
+inline void _cpu_fillDCTSampledPoints( float *row, const Point2f &p, const Size &basisSize, const Size &size,
+                                       const Mat &basisX, const Mat &basisY )
+{
+  AutoBuffer<float> _buf( basisSize.width + basisSize.height );
+  float *buf = _buf;
+  const float *bx, *by;
+  const int x = cvRound( p.x ), y = cvRound( p.y );
+  if ( x == p.x && y == p.y && x >= 0 && x < size.width && y >= 0 && y < size.height )
+  {
+    bx = basisX.ptr<float>( x );
+    by = basisY.ptr<float>( y );
+  }
+  else
+  {
+    fillDCTBasis( buf, p.x, basisSize.width, size.width );
+    fillDCTBasis( buf + basisSize.width, p.y, basisSize.height, size.height );
+    bx = buf;
+    by = buf + basisSize.width;
+  }
+
   for ( int n1 = 0; n1 < basisSize.width; ++n1 )
     for ( int n2 = 0; n2 < basisSize.height; ++n2 )
-      row[n1 * basisSize.height + n2] =
-        cosf( ( n1 * CV_PI / size.width ) * ( p.x + 0.5 ) ) * cosf( ( n2 * CV_PI / size.height ) * ( p.y + 0.5 ) );
+      row[n1 * basisSize.height + n2] = bx[n1] * by[n2];
 }
 
 ocl::ProgramSource _ocl_fillDCTSampledPointsSource(
@@ -253,7 +339,8 @@ void reduceToFlow( const Mat &w1, const Mat &w2, Mat &flow, const Size &basisSiz
 }
 }
 
-void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, UMat &to, std::vector<Point2f> &features,
+void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, InputArray fromPyr, InputArray toPyr,
+                                             std::vector<Point2f> &features,
                                              std::vector<Point2f> &predictedFeatures ) const
 {
   Size size = from.size();
@@ -271,7 +358,7 @@ void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, UMat &to, std::vector<P
   }
   std::vector<uchar> predictedStatus;
   std::vector<float> predictedError;
-  calcOpticalFlowPyrLK( from, to, features, predictedFeatures, predictedStatus, predictedError );
+  calcOpticalFlowPyrLK( fromPyr, toPyr, features, predictedFeatures, predictedStatus, predictedError );
 
   size_t j = 0;
   for ( size_t i = 0; i < features.size(); ++i )
@@ -287,13 +374,14 @@ void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, UMat &to, std::vector<P
   predictedFeatures.resize( j );
 }
 
-void OpticalFlowPCAFlow::removeOcclusions( UMat &from, UMat &to, std::vector<Point2f> &features,
+void OpticalFlowPCAFlow::removeOcclusions( UMat &from, InputArray fromPyr, InputArray toPyr,
+                                           std::vector<Point2f> &features,
                                            std::vector<Point2f> &predictedFeatures ) const
 {
   std::vector<uchar> predictedStatus;
   std::vector<float> predictedError;
   std::vector<Point2f> backwardFeatures;
-  calcOpticalFlowPyrLK( to, from, predictedFeatures, backwardFeatures, predictedStatus, predictedError );
+  calcOpticalFlowPyrLK( toPyr, fromPyr, predictedFeatures, backwardFeatures, predictedStatus, predictedError );
 
   size_t j = 0;
   const float threshold = occlusionsThreshold * sqrt( static_cast<float>(from.size().area()) );
@@ -350,7 +438,7 @@ void OpticalFlowPCAFlow::getSystem( OutputArray AOut, OutputArray b1Out, OutputA
 
     for ( size_t i = 0; i < features.size(); ++i )
     {
-      _cpu_fillDCTSampledPoints( A.ptr<float>( i ), features[i], basisSize, size );
+      _cpu_fillDCTSampledPoints( A.ptr<float>( i ), features[i], basisSize, size, basisX, basisY );
       const Point2f flow = predictedFeatures[i] - features[i];
       b1.at<float>( i ) = flow.x;
       b2.at<float>( i ) = flow.y;
@@ -398,7 +486,7 @@ void OpticalFlowPCAFlow::getSystem( OutputArray A1Out, OutputArray A2Out, Output
 
     for ( size_t i = 0; i < features.size(); ++i )
     {
-      _cpu_fillDCTSampledPoints( A1.ptr<float>( i ), features[i], basisSize, size );
+      _cpu_fillDCTSampledPoints( A1.ptr<float>( i ), features[i], basisSize, size, basisX, basisY );
       const Point2f flow = predictedFeatures[i] - features[i];
       b1.at<float>( i ) = flow.x;
       b2.at<float>( i ) = flow.y;
@@ -415,6 +503,24 @@ void OpticalFlowPCAFlow::getSystem( OutputArray A1Out, OutputArray A2Out, Output
                           b1.ptr<float>( features.size(), 0 ), b2.ptr<float>( features.size(), 0 ) );
 }
 
+void OpticalFlowPCAFlow::prepareCache( const Size size )
+{
+  if ( size == cachedSize )
+    return;
+
+  cachedSize = size;
+  basisX.create( size.width, basisSize.width, CV_32F );
+  basisY.create( size.height, basisSize.height, CV_32F );
+  for ( int x = 0; x < size.width; ++x )
+    fillDCTBasis( basisX.ptr<float>( x ), x, basisSize.width, size.width );
+  for ( int y = 0; y < size.height; ++y )
+    fillDCTBasis( basisY.ptr<float>( y ), y, basisSize.height, size.height );
+
+  // The solution of a frame of another size is not a meaningful initialization
+  prevW1.release();
+  prevW2.release();
+}
+
 void OpticalFlowPCAFlow::calc( InputArray I0, InputArray I1, InputOutputArray flowOut )
 {
   const Size size = I0.size();
@@ -449,27 +555,74 @@ void OpticalFlowPCAFlow::calc( InputArray I0, InputArray I1, InputOutputArray fl
   applyCLAHE( from, claheClip );
   applyCLAHE( to, claheClip );
 
+  prepareCache( size );
+
+  // The pyramids are shared by the forward and the backward tracking
+  const Size winSize( 21, 21 );
+  const int maxLevel = 3;
+  std::vector<Mat> fromPyr, toPyr;
+  if ( !useOpenCL )
+  {
+    buildOpticalFlowPyramid( from.getMat( ACCESS_READ ), fromPyr, winSize, maxLevel );
+    buildOpticalFlowPyramid( to.getMat( ACCESS_READ ), toPyr, winSize, maxLevel );
+  }
+  const _InputArray fromLK = useOpenCL ? _InputArray( from ) : _InputArray( fromPyr );
+  const _InputArray toLK = useOpenCL ? _InputArray( to ) : _InputArray( toPyr );
+
   std::vector<Point2f> features, predictedFeatures;
-  findSparseFeatures( from, to, features, predictedFeatures );
-  removeOcclusions( from, to, features, predictedFeatures );
+  findSparseFeatures( from, fromLK, toLK, features, predictedFeatures );
+  removeOcclusions( from, fromLK, toLK, features, predictedFeatures );
 
   flowOut.create( size, CV_32FC2 );
   Mat flow = flowOut.getMat();
 
+  const double damp = dampingFactor * size.area();
+  const int featuresCount = features.size();
   Mat w1, w2;
   if ( prior.get() )
   {
     Mat A1, A2, b1, b2;
     getSystem( A1, A2, b1, b2, features, predictedFeatures, size );
-    solveLSQR( A1, b1, w1, dampingFactor * size.area() );
-    solveLSQR( A2, b2, w2, dampingFactor * size.area() );
+    if ( prevW1.empty() )
+    {
+      solveLSQR( A1, b1, w1, damp );
+      solveLSQR( A2, b2, w2, damp );
+    }
+    else
+    {
+      w1 = prevW1;
+      w2 = prevW2;
+    }
+    if ( irlsIterations > 0 )
+    {
+      solveIRLS( A1, b1, featuresCount, priorATA1, priorATb1, damp, irlsIterations, w1 );
+      solveIRLS( A2, b2, featuresCount, priorATA2, priorATb2, damp, irlsIterations, w2 );
+    }
   }
   else
   {
     Mat A, b1, b2;
     getSystem( A, b1, b2, features, predictedFeatures, size );
-    solveLSQR( A, b1, w1, dampingFactor * size.area() );
-    solveLSQR( A, b2, w2, dampingFactor * size.area() );
+    if ( prevW1.empty() )
+    {
+      solveLSQR( A, b1, w1, damp );
+      solveLSQR( A, b2, w2, damp );
+    }
+    else
+    {
+      w1 = prevW1;
+      w2 = prevW2;
+    }
+    if ( irlsIterations > 0 )
+    {
+      solveIRLS( A, b1, featuresCount, priorATA1, priorATb1, damp, irlsIterations, w1 );
+      solveIRLS( A, b2, featuresCount, priorATA2, priorATb2, damp, irlsIterations, w2 );
+    }
+  }
+  if ( irlsIterations > 0 )
+  {
+    prevW1 = w1;
+    prevW2 = w2;
   }
   Mat flowSmall( ( size / 8 ) * 2, CV_32FC2 );
   reduceToFlow( w1, w2, flowSmall, basisSize );
@@ -479,17 +632,25 @@ void OpticalFlowPCAFlow::calc( InputArray I0, InputArray I1, InputOutputArray fl
 
 OpticalFlowPCAFlow::OpticalFlowPCAFlow( Ptr<const PCAPrior> _prior, const Size _basisSize, float _sparseRate,
                                         float _retainedCornersFraction, float _occlusionsThreshold,
-                                        float _dampingFactor, float _claheClip )
+                                        float _dampingFactor, float _claheClip, int _irlsIterations )
     : prior( _prior ), basisSize( _basisSize ), sparseRate( _sparseRate ),
       retainedCornersFraction( _retainedCornersFraction ), occlusionsThreshold( _occlusionsThreshold ),
-      dampingFactor( _dampingFactor ), claheClip( _claheClip ), useOpenCL( false )
+      dampingFactor( _dampingFactor ), claheClip( _claheClip ), irlsIterations( _irlsIterations ), useOpenCL( false )
 {
   CV_Assert( sparseRate > 0 && sparseRate <= 0.1 );
   CV_Assert( retainedCornersFraction >= 0 && retainedCornersFraction <= 1.0 );
   CV_Assert( occlusionsThreshold > 0 );
+  CV_Assert( irlsIterations >= 0 );
 }
 
-void OpticalFlowPCAFlow::collectGarbage() {}
+void OpticalFlowPCAFlow::collectGarbage()
+{
+  cachedSize = Size();
+  basisX.release();
+  basisY.release();
+  prevW1.release();
+  prevW2.release();
+}
 
 Ptr<DenseOpticalFlow> createOptFlow_PCAFlow() { return makePtr<OpticalFlowPCAFlow>(); }
 
@@ -81,24 +81,38 @@ inline static T min(T t1, T t2, T t3) {
   return (t1 <= t2 && t1 <= t3) ? t1 : min(t2, t3);
 }
 
+class RemoveOcclusions : public ParallelLoopBody {
+    const Mat &flow, &flow_inv;
+    float occ_thr;
+    Mat &confidence;
+
+public:
+    RemoveOcclusions(const Mat &flow_, const Mat &flow_inv_, float occ_thr_, Mat &confidence_)
+            :
+            flow(flow_),
+            flow_inv(flow_inv_),
+            occ_thr(occ_thr_),
+            confidence(confidence_) {}
+
+    void operator()(const Range &range) const {
+      for (int r = range.start; r < range.end; ++r) {
+        for (int c = 0; c < flow.cols; ++c) {
+          if (dist(flow.at<Vec2f>(r, c), -flow_inv.at<Vec2f>(r, c)) > occ_thr) {
+            confidence.at<float>(r, c) = 0;
+          } else {
+            confidence.at<float>(r, c) = 1;
+          }
+        }
+      }
+    }
+};
+
 static void removeOcclusions(const Mat& flow,
                              const Mat& flow_inv,
                              float occ_thr,
                              Mat& confidence) {
-  const int rows = flow.rows;
-  const int cols = flow.cols;
-  if (!confidence.data) {
-    confidence = Mat::zeros(rows, cols, CV_32F);
-  }
-  for (int r = 0; r < rows; ++r) {
-    for (int c = 0; c < cols; ++c) {
-      if (dist(flow.at<Vec2f>(r, c), -flow_inv.at<Vec2f>(r, c)) > occ_thr) {
-        confidence.at<float>(r, c) = 0;
-      } else {
-        confidence.at<float>(r, c) = 1;
-      }
-    }
-  }
+  confidence.create(flow.rows, flow.cols, CV_32F);
+  parallel_for_(Range(0, flow.rows), RemoveOcclusions(flow, flow_inv, occ_thr, confidence));
 }
 
 static void wd(Mat& d, int top_shift, int bottom_shift, int left_shift, int right_shift, double sigma) {
@@ -222,16 +236,29 @@ static void crossBilateralFilter(InputArray joint_,
   parallel_for_(range, CrossBilateralFilter<Vec3b, Vec2f>(jointTemp, confidenceTemp, srcTemp, src, radius, flag, spaceWeights, expLut));
 }
 
-static void calcConfidence(const Mat& prev,
-                           const Mat& next,
-                           const Mat& flow,
-                           Mat& confidence,
-                           int max_flow) {
+class CalcConfidence : public ParallelLoopBody {
+    const Mat &prev, &next;
+    const Mat &flow;
+    Mat &confidence;
+    int max_flow;
+
+public:
+    CalcConfidence(const Mat &prev_, const Mat &next_, const Mat &flow_, Mat &confidence_, int max_flow_)
+            :
+            prev(prev_),
+            next(next_),
+            flow(flow_),
+            confidence(confidence_),
+            max_flow(max_flow_) {}
+
+    void operator()(const Range &range) const;
+};
+
+void CalcConfidence::operator()(const Range &range) const {
   const int rows = prev.rows;
   const int cols = prev.cols;
-  confidence = Mat::zeros(rows, cols, CV_32F);
 
-  for (int r0 = 0; r0 < rows; ++r0) {
+  for (int r0 = range.start; r0 < range.end; ++r0) {
     for (int c0 = 0; c0 < cols; ++c0) {
       Vec2f flow_at_point = flow.at<Vec2f>(r0, c0);
       int u0 = cvRound(flow_at_point[0]);
@@ -271,6 +298,15 @@ static void calcConfidence(const Mat& prev,
   }
 }
 
+static void calcConfidence(const Mat& prev,
+                           const Mat& next,
+                           const Mat& flow,
+                           Mat& confidence,
+                           int max_flow) {
+  confidence.create(prev.rows, prev.cols, CV_32F);
+  parallel_for_(Range(0, prev.rows), CalcConfidence(prev, next, flow, confidence, max_flow));
+}
+
 template<typename SrcVec, typename DstVec>
 class CalcOpticalFlowSingleScaleSF : public ParallelLoopBody {
     Mat &prev, &next;
@@ -420,26 +456,43 @@ static Mat upscaleOpticalFlow(int new_rows,
   return new_flow;
 }
 
-static Mat calcIrregularityMat(const Mat& flow, int radius) {
-  const int rows = flow.rows;
-  const int cols = flow.cols;
-  Mat irregularity = Mat::zeros(rows, cols, CV_32F);
-  for (int r = 0; r < rows; ++r) {
-    const int start_row = std::max(0, r - radius);
-    const int end_row = std::min(rows - 1, r + radius);
-    for (int c = 0; c < cols; ++c) {
-      const int start_col = std::max(0, c - radius);
-      const int end_col = std::min(cols - 1, c + radius);
-      for (int dr = start_row; dr <= end_row; ++dr) {
-        for (int dc = start_col; dc <= end_col; ++dc) {
-          const float diff = dist(flow.at<Vec2f>(r, c), flow.at<Vec2f>(dr, dc));
-          if (diff > irregularity.at<float>(r, c)) {
-            irregularity.at<float>(r, c) = diff;
+class CalcIrregularity : public ParallelLoopBody {
+    const Mat &flow;
+    Mat &irregularity;
+    int radius;
+
+public:
+    CalcIrregularity(const Mat &flow_, Mat &irregularity_, int radius_)
+            :
+            flow(flow_),
+            irregularity(irregularity_),
+            radius(radius_) {}
+
+    void operator()(const Range &range) const {
+      const int rows = flow.rows;
+      const int cols = flow.cols;
+      for (int r = range.start; r < range.end; ++r) {
+        const int start_row = std::max(0, r - radius);
+        const int end_row = std::min(rows - 1, r + radius);
+        for (int c = 0; c < cols; ++c) {
+          const int start_col = std::max(0, c - radius);
+          const int end_col = std::min(cols - 1, c + radius);
+          for (int dr = start_row; dr <= end_row; ++dr) {
+            for (int dc = start_col; dc <= end_col; ++dc) {
+              const float diff = dist(flow.at<Vec2f>(r, c), flow.at<Vec2f>(dr, dc));
+              if (diff > irregularity.at<float>(r, c)) {
+                irregularity.at<float>(r, c) = diff;
+              }
+            }
           }
         }
       }
     }
-  }
+};
+
+static Mat calcIrregularityMat(const Mat& flow, int radius) {
+  Mat irregularity = Mat::zeros(flow.rows, flow.cols, CV_32F);
+  parallel_for_(Range(0, flow.rows), CalcIrregularity(flow, irregularity, radius));
   return irregularity;
 }
 
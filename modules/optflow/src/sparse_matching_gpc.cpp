@@ -233,26 +233,54 @@ void getWHTPatchDescriptor( GPCPatchDescriptor &patchDescr, const Mat *imgCh, in
   patchDescr.feature /= patchRadius;
 }
 
+/* The 2D DCT basis functions are separable, so every coefficient of the descriptor is a sum over the patch rows of
+ * the 1D DCT coefficients of these rows. The 1D coefficients of all the row segments are computed once for the whole
+ * image and shared by the overlapping patches.
+ */
 class ParallelDCTFiller : public ParallelLoopBody
 {
 private:
   const Size sz;
-  const Mat *imgCh;
+  const Mat *rowCoefs;  //!< 1D DCT coefficients of the row segments starting at each pixel, one plane per frequency
+  const Mat *imgChInt;  //!< integral images of the color channels
+  const Mat *basis;     //!< 1D DCT basis, one row per frequency
   std::vector< GPCPatchDescriptor > *descr;
 
   ParallelDCTFiller &operator=( const ParallelDCTFiller & );
 
 public:
-  ParallelDCTFiller( const Size &_sz, const Mat *_imgCh, std::vector< GPCPatchDescriptor > *_descr )
-      : sz( _sz ), imgCh( _imgCh ), descr( _descr ){};
+  ParallelDCTFiller( const Size &_sz, const Mat *_rowCoefs, const Mat *_imgChInt, const Mat *_basis,
+                     std::vector< GPCPatchDescriptor > *_descr )
+      : sz( _sz ), rowCoefs( _rowCoefs ), imgChInt( _imgChInt ), basis( _basis ), descr( _descr ){};
 
   void operator()( const Range &range ) const
   {
+    const int k = 2 * patchRadius;
     for ( int i = range.start; i < range.end; ++i )
     {
       int x, y;
       GPCDetails::getCoordinatesFromIndex( i, sz, x, y );
-      getDCTPatchDescriptor( descr->at( i ), imgCh, y, x );
+      x -= patchRadius;
+      y -= patchRadius;
+
+      double *feature = descr->at( i ).feature.val;
+      for ( int u = 0; u < 4; ++u )
+      {
+        double column[2 * PATCH_RADIUS];
+        for ( int l = 0; l < k; ++l )
+          column[l] = rowCoefs[u].at< double >( y + l, x );
+        for ( int v = 0; v < 4; ++v )
+        {
+          const double *b = basis->ptr< double >( v );
+          double sum = 0;
+          for ( int l = 0; l < k; ++l )
+            sum += b[l] * column[l];
+          feature[v * 4 + u] = sum;
+        }
+      }
+
+      feature[16] = sumInt( imgChInt[0], y, x, k, k ) / k;
+      feature[17] = sumInt( imgChInt[1], y, x, k, k ) / k;
     }
   }
 };
@@ -292,8 +320,23 @@ void getAllDCTDescriptorsForImage( const Mat *imgCh, std::vector< GPCPatchDescri
   (void)mp; // Fix unused parameter warning in case OpenCL is not available
   CV_OCL_RUN( mp.useOpenCL, ocl_getAllDCTDescriptorsForImage( imgCh, descr ) )
 
+  /* Orthonormal DCT-II basis, the same as used by cv::dct */
+  const int k = 2 * patchRadius;
+  Mat basis( 4, k, CV_64F );
+  for ( int u = 0; u < 4; ++u )
+    for ( int t = 0; t < k; ++t )
+      basis.at< double >( u, t ) = std::sqrt( ( u == 0 ? 1.0 : 2.0 ) / k ) * std::cos( CV_PI * ( 2 * t + 1 ) * u / ( 2.0 * k ) );
+
+  Mat rowCoefs[4];
+  for ( int u = 0; u < 4; ++u )
+    filter2D( imgCh[0], rowCoefs[u], CV_64F, basis.row( u ), Point( 0, 0 ), 0, BORDER_REPLICATE );
+
+  Mat imgChInt[2];
+  integral( imgCh[1], imgChInt[0], CV_64F );
+  integral( imgCh[2], imgChInt[1], CV_64F );
+
   descr.resize( ( sz.height - 2 * patchRadius ) * ( sz.width - 2 * patchRadius ) );
-  parallel_for_( Range( 0, descr.size() ), ParallelDCTFiller( sz, imgCh, &descr ) );
+  parallel_for_( Range( 0, descr.size() ), ParallelDCTFiller( sz, rowCoefs, imgChInt, &basis, &descr ) );
 }
 
 class ParallelWHTFiller : public ParallelLoopBody
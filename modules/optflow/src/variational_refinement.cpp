@@ -42,6 +42,7 @@
 
 #include "opencv2/core/hal/intrin.hpp"
 #include "precomp.hpp"
+#include "opencl_kernels_optflow.hpp"
 using namespace std;
 
 namespace cv
@@ -110,6 +111,21 @@ class VariationalRefinementImpl : public VariationalRefinement
     RedBlackBuffer dW_u, dW_v;       //!< optical flow increment
     RedBlackBuffer W_u_rb, W_v_rb;   //!< red-black-buffer version of the input flow
 
+#ifdef HAVE_OPENCL
+    /* OpenCL buffers use the dense layout, the colors are selected by the SOR kernel itself */
+    UMat u_Ix, u_Iy, u_Iz, u_Ixx, u_Ixy, u_Iyy, u_Ixz, u_Iyz; //!< image derivative buffers
+    UMat u_A11, u_A12, u_A22, u_b1, u_b2;                     //!< main linear system coefficients
+    UMat u_weights;                                           //!< smoothness term weights
+    UMat u_mapX, u_mapY;                                      //!< auxiliary buffers for remapping
+    UMat u_I1flt, u_warpedI, u_averagedI;                     //!< auxiliary buffers for the derivatives
+    UMat u_dW_u, u_dW_v;                                      //!< optical flow increment
+    vector<UMat> u_flow_uv;                                   //!< flow components in calc()
+
+    bool ocl_prepareBuffers(UMat &I0, UMat &I1, UMat &W_u, UMat &W_v);
+    bool ocl_calcUV(InputArray I0, InputArray I1, InputOutputArray flow_u, InputOutputArray flow_v);
+    bool ocl_calc(InputArray I0, InputArray I1, InputOutputArray flow);
+#endif
+
   private: //!< private methods and parallel sections
     void splitCheckerboard(RedBlackBuffer &dst, Mat &src);
     void mergeCheckerboard(Mat &dst, RedBlackBuffer &src);
@@ -190,17 +206,25 @@ class VariationalRefinementImpl : public VariationalRefinement
         void operator()(const Range &range) const;
     };
 
+    /* All the SOR iterations of a fixed point iteration are computed by two parallel sections over row tiles. Each
+     * pass of a row depends only on the previous pass of the adjacent rows, so the first section computes a shrinking
+     * trapezoid of rows for every pass inside each tile, and the second one fills the growing gaps between the tiles.
+     * The result is exactly the same as with the separate red and black passes over the whole image, but the rows of
+     * a tile stay in cache for all the passes.
+     */
     struct RedBlackSOR_ParBody : public ParallelLoopBody
     {
         VariationalRefinementImpl *var;
-        int nstripes, stripe_sz;
         int h;
         RedBlackBuffer *dW_u, *dW_v;
-        bool red_pass;
+        int num_passes; //!< number of red and black passes, starting with red
+        int tile_sz, num_tiles;
+        bool fill_gaps; //!< whether to compute the growing gaps at the tile borders instead of the tiles
 
-        RedBlackSOR_ParBody(VariationalRefinementImpl &_var, int _nstripes, int _h, RedBlackBuffer &_dW_u,
-                            RedBlackBuffer &_dW_v, bool _red_pass);
+        RedBlackSOR_ParBody(VariationalRefinementImpl &_var, int _h, RedBlackBuffer &_dW_u, RedBlackBuffer &_dW_v,
+                            int _num_passes, bool _fill_gaps);
         void operator()(const Range &range) const;
+        void processRow(int i, bool red_pass) const;
     };
 };
 
@@ -947,22 +971,49 @@ void VariationalRefinementImpl::ComputeSmoothnessTermVertPass_ParBody::operator(
     }
 }
 
-VariationalRefinementImpl::RedBlackSOR_ParBody::RedBlackSOR_ParBody(VariationalRefinementImpl &_var, int _nstripes,
-                                                                    int _h, RedBlackBuffer &_dW_u,
-                                                                    RedBlackBuffer &_dW_v, bool _red_pass)
-    : var(&_var), nstripes(_nstripes), h(_h), dW_u(&_dW_u), dW_v(&_dW_v), red_pass(_red_pass)
+VariationalRefinementImpl::RedBlackSOR_ParBody::RedBlackSOR_ParBody(VariationalRefinementImpl &_var, int _h,
+                                                                    RedBlackBuffer &_dW_u, RedBlackBuffer &_dW_v,
+                                                                    int _num_passes, bool _fill_gaps)
+    : var(&_var), h(_h), dW_u(&_dW_u), dW_v(&_dW_v), num_passes(_num_passes), fill_gaps(_fill_gaps)
 {
-    stripe_sz = (int)ceil(h / (double)nstripes);
+    /* Tiles must be high enough for the trapezoids not to vanish, the last tile takes the remaining rows */
+    const int sor_tile_rows = 32;
+    tile_sz = max(sor_tile_rows, 2 * num_passes);
+    num_tiles = max(h / tile_sz, 1);
 }
 
 /* This function implements the Red-Black SOR (successive-over relaxation) method for solving the main
- * linear system in the current fixed-point iteration.
+ * linear system in the current fixed-point iteration. Tile k covers the rows [k * tile_sz, (k + 1) * tile_sz), pass p
+ * of the tile omits p rows at its inner borders, these rows are computed by the gap at the border.
  */
 void VariationalRefinementImpl::RedBlackSOR_ParBody::operator()(const Range &range) const
 {
-    int start = min(range.start * stripe_sz, h);
-    int end = min(range.end * stripe_sz, h);
+    for (int k = range.start; k < range.end; k++)
+    {
+        int tile_start = k * tile_sz;
+        int tile_end = (k == num_tiles - 1) ? h : tile_start + tile_sz;
+        for (int p = 0; p < num_passes; p++)
+        {
+            int start, end;
+            if (fill_gaps)
+            {
+                /* the gap at the top border of tile k */
+                start = tile_start - p;
+                end = tile_start + p;
+            }
+            else
+            {
+                start = (k == 0) ? 0 : tile_start + p;
+                end = (k == num_tiles - 1) ? h : tile_end - p;
+            }
+            for (int i = start; i < end; i++)
+                processRow(i, p % 2 == 0);
+        }
+    }
+}
 
+void VariationalRefinementImpl::RedBlackSOR_ParBody::processRow(int i, bool red_pass) const
+{
     float *pa11, *pa12, *pa22, *pb1, *pb2, *pW, *pdu, *pdv;
     float *pW_next, *pdu_next, *pdv_next;
     float *pW_prev_row, *pdu_prev_row, *pdv_prev_row;
@@ -970,8 +1021,6 @@ void VariationalRefinementImpl::RedBlackSOR_ParBody::operator()(const Range &ran
 
     float sigmaU, sigmaV;
     int j, len;
-    for (int i = start; i < end; i++)
-    {
 #define INIT_ROW_POINTERS(cur_color, next_color, next_offs_even, next_offs_odd)                                        \
     pW = var->weights.cur_color.ptr<float>(i + 1) + 1;                                                                 \
     pa11 = var->A11.cur_color.ptr<float>(i + 1) + 1;                                                                   \
@@ -1003,75 +1052,190 @@ void VariationalRefinementImpl::RedBlackSOR_ParBody::operator()(const Range &ran
         pdv_next = dW_v->next_color.ptr<float>(i + 1) + next_offs_odd;                                                 \
         len = var->A11.cur_color##_odd_len;                                                                            \
     }
-        if (red_pass)
-        {
-            INIT_ROW_POINTERS(red, black, 1, 2);
-        }
-        else
-        {
-            INIT_ROW_POINTERS(black, red, 2, 1);
-        }
+    if (red_pass)
+    {
+        INIT_ROW_POINTERS(red, black, 1, 2);
+    }
+    else
+    {
+        INIT_ROW_POINTERS(black, red, 2, 1);
+    }
 #undef INIT_ROW_POINTERS
 
-        j = 0;
+    j = 0;
 #ifdef CV_SIMD128
-        v_float32x4 pW_prev_vec = v_setall_f32(pW_next[-1]);
-        v_float32x4 pdu_prev_vec = v_setall_f32(pdu_next[-1]);
-        v_float32x4 pdv_prev_vec = v_setall_f32(pdv_next[-1]);
-        v_float32x4 omega_vec = v_setall_f32(var->omega);
-        v_float32x4 pW_vec, pW_next_vec, pW_prev_row_vec;
-        v_float32x4 pdu_next_vec, pdu_prev_row_vec, pdu_next_row_vec;
-        v_float32x4 pdv_next_vec, pdv_prev_row_vec, pdv_next_row_vec;
-        v_float32x4 pW_shifted_vec, pdu_shifted_vec, pdv_shifted_vec;
-        v_float32x4 pa12_vec, sigmaU_vec, sigmaV_vec, pdu_vec, pdv_vec;
-        for (; j < len - 3; j += 4)
-        {
-            pW_vec = v_load(pW + j);
-            pW_next_vec = v_load(pW_next + j);
-            pW_prev_row_vec = v_load(pW_prev_row + j);
-            pdu_next_vec = v_load(pdu_next + j);
-            pdu_prev_row_vec = v_load(pdu_prev_row + j);
-            pdu_next_row_vec = v_load(pdu_next_row + j);
-            pdv_next_vec = v_load(pdv_next + j);
-            pdv_prev_row_vec = v_load(pdv_prev_row + j);
-            pdv_next_row_vec = v_load(pdv_next_row + j);
-            pa12_vec = v_load(pa12 + j);
-            pW_shifted_vec = v_reinterpret_as_f32(
-              v_extract<3>(v_reinterpret_as_s32(pW_prev_vec), v_reinterpret_as_s32(pW_next_vec)));
-            pdu_shifted_vec = v_reinterpret_as_f32(
-              v_extract<3>(v_reinterpret_as_s32(pdu_prev_vec), v_reinterpret_as_s32(pdu_next_vec)));
-            pdv_shifted_vec = v_reinterpret_as_f32(
-              v_extract<3>(v_reinterpret_as_s32(pdv_prev_vec), v_reinterpret_as_s32(pdv_next_vec)));
-
-            sigmaU_vec = pW_shifted_vec * pdu_shifted_vec + pW_vec * pdu_next_vec + pW_prev_row_vec * pdu_prev_row_vec +
-                         pW_vec * pdu_next_row_vec;
-            sigmaV_vec = pW_shifted_vec * pdv_shifted_vec + pW_vec * pdv_next_vec + pW_prev_row_vec * pdv_prev_row_vec +
-                         pW_vec * pdv_next_row_vec;
-
-            pdu_vec = v_load(pdu + j);
-            pdv_vec = v_load(pdv + j);
-            pdu_vec += omega_vec * ((sigmaU_vec + v_load(pb1 + j) - pdv_vec * pa12_vec) / v_load(pa11 + j) - pdu_vec);
-            pdv_vec += omega_vec * ((sigmaV_vec + v_load(pb2 + j) - pdu_vec * pa12_vec) / v_load(pa22 + j) - pdv_vec);
-            v_store(pdu + j, pdu_vec);
-            v_store(pdv + j, pdv_vec);
-
-            pW_prev_vec = pW_next_vec;
-            pdu_prev_vec = pdu_next_vec;
-            pdv_prev_vec = pdv_next_vec;
-        }
+    v_float32x4 pW_prev_vec = v_setall_f32(pW_next[-1]);
+    v_float32x4 pdu_prev_vec = v_setall_f32(pdu_next[-1]);
+    v_float32x4 pdv_prev_vec = v_setall_f32(pdv_next[-1]);
+    v_float32x4 omega_vec = v_setall_f32(var->omega);
+    v_float32x4 pW_vec, pW_next_vec, pW_prev_row_vec;
+    v_float32x4 pdu_next_vec, pdu_prev_row_vec, pdu_next_row_vec;
+    v_float32x4 pdv_next_vec, pdv_prev_row_vec, pdv_next_row_vec;
+    v_float32x4 pW_shifted_vec, pdu_shifted_vec, pdv_shifted_vec;
+    v_float32x4 pa12_vec, sigmaU_vec, sigmaV_vec, pdu_vec, pdv_vec;
+    for (; j < len - 3; j += 4)
+    {
+        pW_vec = v_load(pW + j);
+        pW_next_vec = v_load(pW_next + j);
+        pW_prev_row_vec = v_load(pW_prev_row + j);
+        pdu_next_vec = v_load(pdu_next + j);
+        pdu_prev_row_vec = v_load(pdu_prev_row + j);
+        pdu_next_row_vec = v_load(pdu_next_row + j);
+        pdv_next_vec = v_load(pdv_next + j);
+        pdv_prev_row_vec = v_load(pdv_prev_row + j);
+        pdv_next_row_vec = v_load(pdv_next_row + j);
+        pa12_vec = v_load(pa12 + j);
+        pW_shifted_vec = v_reinterpret_as_f32(
+          v_extract<3>(v_reinterpret_as_s32(pW_prev_vec), v_reinterpret_as_s32(pW_next_vec)));
+        pdu_shifted_vec = v_reinterpret_as_f32(
+          v_extract<3>(v_reinterpret_as_s32(pdu_prev_vec), v_reinterpret_as_s32(pdu_next_vec)));
+        pdv_shifted_vec = v_reinterpret_as_f32(
+          v_extract<3>(v_reinterpret_as_s32(pdv_prev_vec), v_reinterpret_as_s32(pdv_next_vec)));
+
+        sigmaU_vec = pW_shifted_vec * pdu_shifted_vec + pW_vec * pdu_next_vec + pW_prev_row_vec * pdu_prev_row_vec +
+                     pW_vec * pdu_next_row_vec;
+        sigmaV_vec = pW_shifted_vec * pdv_shifted_vec + pW_vec * pdv_next_vec + pW_prev_row_vec * pdv_prev_row_vec +
+                     pW_vec * pdv_next_row_vec;
+
+        pdu_vec = v_load(pdu + j);
+        pdv_vec = v_load(pdv + j);
+        pdu_vec += omega_vec * ((sigmaU_vec + v_load(pb1 + j) - pdv_vec * pa12_vec) / v_load(pa11 + j) - pdu_vec);
+        pdv_vec += omega_vec * ((sigmaV_vec + v_load(pb2 + j) - pdu_vec * pa12_vec) / v_load(pa22 + j) - pdv_vec);
+        v_store(pdu + j, pdu_vec);
+        v_store(pdv + j, pdv_vec);
+
+        pW_prev_vec = pW_next_vec;
+        pdu_prev_vec = pdu_next_vec;
+        pdv_prev_vec = pdv_next_vec;
+    }
 #endif
-        for (; j < len; j++)
+    for (; j < len; j++)
+    {
+        sigmaU = pW_next[j - 1] * pdu_next[j - 1] + pW[j] * pdu_next[j] + pW_prev_row[j] * pdu_prev_row[j] +
+                 pW[j] * pdu_next_row[j];
+        sigmaV = pW_next[j - 1] * pdv_next[j - 1] + pW[j] * pdv_next[j] + pW_prev_row[j] * pdv_prev_row[j] +
+                 pW[j] * pdv_next_row[j];
+        pdu[j] += var->omega * ((sigmaU + pb1[j] - pdv[j] * pa12[j]) / pa11[j] - pdu[j]);
+        pdv[j] += var->omega * ((sigmaV + pb2[j] - pdu[j] * pa12[j]) / pa22[j] - pdv[j]);
+    }
+}
+
+#ifdef HAVE_OPENCL
+bool VariationalRefinementImpl::ocl_prepareBuffers(UMat &I0, UMat &I1, UMat &W_u, UMat &W_v)
+{
+    Size s = I0.size();
+    u_A11.create(s, CV_32FC1);
+    u_A12.create(s, CV_32FC1);
+    u_A22.create(s, CV_32FC1);
+    u_b1.create(s, CV_32FC1);
+    u_b2.create(s, CV_32FC1);
+    u_weights.create(s, CV_32FC1);
+    u_dW_u.create(s, CV_32FC1);
+    u_dW_v.create(s, CV_32FC1);
+    u_mapX.create(s, CV_32FC1);
+    u_mapY.create(s, CV_32FC1);
+
+    size_t globalSize[] = {(size_t)s.width, (size_t)s.height};
+    ocl::Kernel maps_kernel("vr_warp_maps", ocl::optflow::variational_refinement_oclsrc);
+    maps_kernel.args(ocl::KernelArg::PtrReadOnly(W_u), ocl::KernelArg::PtrReadOnly(W_v), s.width, s.height,
+                     ocl::KernelArg::PtrWriteOnly(u_mapX), ocl::KernelArg::PtrWriteOnly(u_mapY));
+    if (!maps_kernel.run(2, globalSize, NULL, false))
+        return false;
+
+    /* Same derivatives as in prepareBuffers, computed by the OpenCL versions of the functions */
+    I1.convertTo(u_I1flt, CV_32F);
+    remap(u_I1flt, u_warpedI, u_mapX, u_mapY, INTER_LINEAR, BORDER_REPLICATE);
+    addWeighted(I0, 0.5, u_warpedI, 0.5, 0.0, u_averagedI, CV_32F);
+    subtract(u_warpedI, I0, u_Iz, noArray(), CV_32F);
+
+    Sobel(u_averagedI, u_Ix, -1, 1, 0, 1, 1, 0.00, BORDER_REPLICATE);
+    Sobel(u_averagedI, u_Iy, -1, 0, 1, 1, 1, 0.00, BORDER_REPLICATE);
+    Sobel(u_Iz, u_Ixz, -1, 1, 0, 1, 1, 0.00, BORDER_REPLICATE);
+    Sobel(u_Iz, u_Iyz, -1, 0, 1, 1, 1, 0.00, BORDER_REPLICATE);
+    Sobel(u_Ix, u_Ixx, -1, 1, 0, 1, 1, 0.00, BORDER_REPLICATE);
+    Sobel(u_Ix, u_Ixy, -1, 0, 1, 1, 1, 0.00, BORDER_REPLICATE);
+    Sobel(u_Iy, u_Iyy, -1, 0, 1, 1, 1, 0.00, BORDER_REPLICATE);
+    return true;
+}
+
+bool VariationalRefinementImpl::ocl_calcUV(InputArray I0, InputArray I1, InputOutputArray flow_u,
+                                           InputOutputArray flow_v)
+{
+    UMat I0Mat = I0.getUMat();
+    UMat I1Mat = I1.getUMat();
+    UMat &W_u = flow_u.getUMatRef();
+    UMat &W_v = flow_v.getUMatRef();
+    if (!W_u.isContinuous() || !W_v.isContinuous() || !ocl_prepareBuffers(I0Mat, I1Mat, W_u, W_v))
+        return false;
+
+    int w = I0Mat.cols, h = I0Mat.rows;
+    float zeta_squared = zeta * zeta;
+    float epsilon_squared = epsilon * epsilon;
+    u_dW_u.setTo(0.0f);
+    u_dW_v.setTo(0.0f);
+
+    /* The kernel arguments are set once, all the iterations are submitted without waiting for the device */
+    ocl::Kernel weights_kernel("vr_smoothness_weights", ocl::optflow::variational_refinement_oclsrc);
+    weights_kernel.args(ocl::KernelArg::PtrReadOnly(W_u), ocl::KernelArg::PtrReadOnly(W_v),
+                        ocl::KernelArg::PtrReadOnly(u_dW_u), ocl::KernelArg::PtrReadOnly(u_dW_v), w, h,
+                        alpha / 2, epsilon_squared, ocl::KernelArg::PtrWriteOnly(u_weights));
+
+    ocl::Kernel system_kernel("vr_linear_system", ocl::optflow::variational_refinement_oclsrc);
+    system_kernel.args(ocl::KernelArg::PtrReadOnly(u_Ix), ocl::KernelArg::PtrReadOnly(u_Iy),
+                       ocl::KernelArg::PtrReadOnly(u_Iz), ocl::KernelArg::PtrReadOnly(u_Ixx),
+                       ocl::KernelArg::PtrReadOnly(u_Ixy), ocl::KernelArg::PtrReadOnly(u_Iyy),
+                       ocl::KernelArg::PtrReadOnly(u_Ixz), ocl::KernelArg::PtrReadOnly(u_Iyz),
+                       ocl::KernelArg::PtrReadOnly(W_u), ocl::KernelArg::PtrReadOnly(W_v),
+                       ocl::KernelArg::PtrReadOnly(u_dW_u), ocl::KernelArg::PtrReadOnly(u_dW_v),
+                       ocl::KernelArg::PtrReadOnly(u_weights), w, h, zeta_squared, epsilon_squared, gamma / 2,
+                       delta / 2, ocl::KernelArg::PtrWriteOnly(u_A11), ocl::KernelArg::PtrWriteOnly(u_A12),
+                       ocl::KernelArg::PtrWriteOnly(u_A22), ocl::KernelArg::PtrWriteOnly(u_b1),
+                       ocl::KernelArg::PtrWriteOnly(u_b2));
+
+    ocl::Kernel sor_kernels[2];
+    for (int color = 0; color < 2; color++)
+    {
+        sor_kernels[color].create("vr_red_black_sor", ocl::optflow::variational_refinement_oclsrc, "");
+        sor_kernels[color].args(ocl::KernelArg::PtrReadOnly(u_A11), ocl::KernelArg::PtrReadOnly(u_A12),
+                                ocl::KernelArg::PtrReadOnly(u_A22), ocl::KernelArg::PtrReadOnly(u_b1),
+                                ocl::KernelArg::PtrReadOnly(u_b2), ocl::KernelArg::PtrReadOnly(u_weights), w, h,
+                                omega, color, ocl::KernelArg::PtrReadWrite(u_dW_u),
+                                ocl::KernelArg::PtrReadWrite(u_dW_v));
+        if (sor_kernels[color].empty())
+            return false;
+    }
+    if (weights_kernel.empty() || system_kernel.empty())
+        return false;
+
+    size_t globalSize[] = {(size_t)w, (size_t)h};
+    size_t globalSizeSOR[] = {(size_t)(w + 1) / 2, (size_t)h};
+    for (int i = 0; i < fixedPointIterations; i++)
+    {
+        if (!weights_kernel.run(2, globalSize, NULL, false) || !system_kernel.run(2, globalSize, NULL, false))
+            return false;
+        for (int j = 0; j < sorIterations; j++)
         {
-            sigmaU = pW_next[j - 1] * pdu_next[j - 1] + pW[j] * pdu_next[j] + pW_prev_row[j] * pdu_prev_row[j] +
-                     pW[j] * pdu_next_row[j];
-            sigmaV = pW_next[j - 1] * pdv_next[j - 1] + pW[j] * pdv_next[j] + pW_prev_row[j] * pdv_prev_row[j] +
-                     pW[j] * pdv_next_row[j];
-            pdu[j] += var->omega * ((sigmaU + pb1[j] - pdv[j] * pa12[j]) / pa11[j] - pdu[j]);
-            pdv[j] += var->omega * ((sigmaV + pb2[j] - pdu[j] * pa12[j]) / pa22[j] - pdv[j]);
+            if (!sor_kernels[0].run(2, globalSizeSOR, NULL, false) ||
+                !sor_kernels[1].run(2, globalSizeSOR, NULL, false))
+                return false;
         }
     }
+    add(W_u, u_dW_u, W_u);
+    add(W_v, u_dW_v, W_v);
+    return true;
 }
 
+bool VariationalRefinementImpl::ocl_calc(InputArray I0, InputArray I1, InputOutputArray flow)
+{
+    UMat &flowMat = flow.getUMatRef();
+    split(flowMat, u_flow_uv);
+    if (!ocl_calcUV(I0, I1, u_flow_uv[0], u_flow_uv[1]))
+        return false;
+    merge(u_flow_uv, flowMat);
+    return true;
+}
+#endif
+
 void VariationalRefinementImpl::calc(InputArray I0, InputArray I1, InputOutputArray flow)
 {
     CV_Assert(!I0.empty() && I0.channels() == 1);
@@ -1081,8 +1245,10 @@ void VariationalRefinementImpl::calc(InputArray I0, InputArray I1, InputOutputAr
     CV_Assert(!flow.empty() && flow.depth() == CV_32F && flow.channels() == 2);
     CV_Assert(I0.sameSize(flow));
 
+    CV_OCL_RUN(flow.isUMat(), ocl_calc(I0, I1, flow));
+
     Mat uv[2];
-    Mat &flowMat = flow.getMatRef();
+    Mat flowMat = flow.getMat();
     split(flowMat, uv);
     calcUV(I0, I1, uv[0], uv[1]);
     merge(uv, 2, flowMat);
@@ -1099,11 +1265,14 @@ void VariationalRefinementImpl::calcUV(InputArray I0, InputArray I1, InputOutput
     CV_Assert(I0.sameSize(flow_u));
     CV_Assert(flow_u.sameSize(flow_v));
 
+    CV_OCL_RUN(flow_u.isUMat() && flow_v.isUMat(), ocl_calcUV(I0, I1, flow_u, flow_v));
+
     int num_stripes = getNumThreads();
     Mat I0Mat = I0.getMat();
     Mat I1Mat = I1.getMat();
-    Mat &W_u = flow_u.getMatRef();
-    Mat &W_v = flow_v.getMatRef();
+    /* The flow is modified in place, so the headers also work for UMat flow if the OpenCL path is not taken */
+    Mat W_u = flow_u.getMat();
+    Mat W_v = flow_v.getMat();
     prepareBuffers(I0Mat, I1Mat, W_u, W_v);
 
     splitCheckerboard(W_u_rb, W_u);
@@ -1132,11 +1301,11 @@ void VariationalRefinementImpl::calcUV(InputArray I0, InputArray I1, InputOutput
         parallel_for_(Range(0, num_stripes),
                       ComputeSmoothnessTermVertPass_ParBody(*this, num_stripes, I0Mat.rows, W_u_rb, W_v_rb, false));
 
-        for (int j = 0; j < sorIterations; j++)
-        {
-            parallel_for_(Range(0, num_stripes), RedBlackSOR_ParBody(*this, num_stripes, I0Mat.rows, dW_u, dW_v, true));
-            parallel_for_(Range(0, num_stripes), RedBlackSOR_ParBody(*this, num_stripes, I0Mat.rows, dW_u, dW_v, false));
-        }
+        RedBlackSOR_ParBody sor_tiles(*this, I0Mat.rows, dW_u, dW_v, 2 * sorIterations, false);
+        parallel_for_(Range(0, sor_tiles.num_tiles), sor_tiles);
+        if (sor_tiles.num_tiles > 1)
+            parallel_for_(Range(1, sor_tiles.num_tiles),
+                          RedBlackSOR_ParBody(*this, I0Mat.rows, dW_u, dW_v, 2 * sorIterations, true));
 
         tempW_u.red = W_u_rb.red + dW_u.red;
         tempW_u.black = W_u_rb.black + dW_u.black;
@@ -1184,6 +1353,31 @@ void VariationalRefinementImpl::collectGarbage()
     dW_v.release();
     W_u_rb.release();
     W_v_rb.release();
+
+#ifdef HAVE_OPENCL
+    u_Ix.release();
+    u_Iy.release();
+    u_Iz.release();
+    u_Ixx.release();
+    u_Ixy.release();
+    u_Iyy.release();
+    u_Ixz.release();
+    u_Iyz.release();
+    u_A11.release();
+    u_A12.release();
+    u_A22.release();
+    u_b1.release();
+    u_b2.release();
+    u_weights.release();
+    u_mapX.release();
+    u_mapY.release();
+    u_I1flt.release();
+    u_warpedI.release();
+    u_averagedI.release();
+    u_dW_u.release();
+    u_dW_v.release();
+    u_flow_uv.clear();
+#endif
 }
 
 Ptr<VariationalRefinement> createVariationalFlowRefinement() { return makePtr<VariationalRefinementImpl>(); }
@@ -0,0 +1,45 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "../test_precomp.hpp"
+#include "opencv2/ts/ocl_test.hpp"
+
+#ifdef HAVE_OPENCL
+
+using namespace cv;
+using namespace optflow;
+
+namespace cvtest {
+namespace ocl {
+
+OCL_TEST(DenseOpticalFlow_VariationalRefinement, Mat)
+{
+    Mat frame1, frame2;
+
+    frame1 = imread(TS::ptr()->get_data_path() + "optflow/RubberWhale1.png", IMREAD_GRAYSCALE);
+    frame2 = imread(TS::ptr()->get_data_path() + "optflow/RubberWhale2.png", IMREAD_GRAYSCALE);
+
+    CV_Assert(!frame1.empty() && !frame2.empty());
+
+    for (int i = 0; i < test_loop_times; i++)
+    {
+        Mat flow(frame1.size(), CV_32FC2, Scalar::all(0));
+        UMat ocl_flow;
+        flow.copyTo(ocl_flow);
+
+        Ptr<VariationalRefinement> var_ref = createVariationalFlowRefinement();
+        var_ref->setFixedPointIterations(5);
+        var_ref->setSorIterations(5);
+        OCL_OFF(var_ref->calc(frame1, frame2, flow));
+        OCL_ON(var_ref->calc(frame1, frame2, ocl_flow));
+        ASSERT_EQ(flow.rows, ocl_flow.rows);
+        ASSERT_EQ(flow.cols, ocl_flow.cols);
+
+        EXPECT_MAT_SIMILAR(flow, ocl_flow, 6e-3);
+    }
+}
+
+} } // namespace cvtest::ocl
+
+#endif // HAVE_OPENCL
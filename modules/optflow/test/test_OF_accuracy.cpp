@@ -199,6 +199,52 @@ TEST(DenseOpticalFlow_DIS, ReferenceAccuracy)
     }
 }
 
+TEST(DenseOpticalFlow_DIS, ROIs)
+{
+    Mat frame1, frame2, GT;
+    ASSERT_TRUE(readRubberWhale(frame1, frame2, GT));
+    cvtColor(frame1, frame1, COLOR_BGR2GRAY);
+    cvtColor(frame2, frame2, COLOR_BGR2GRAY);
+
+    Rect roi(frame1.cols / 4, frame1.rows / 4, frame1.cols / 2, frame1.rows / 2);
+    vector<Rect> rois(1, roi);
+    Ptr<DISOpticalFlow> algo = createOptFlow_DIS(DISOpticalFlow::PRESET_FAST);
+    algo->setROIs(rois);
+
+    Mat flow;
+    algo->calc(frame1, frame2, flow);
+    ASSERT_EQ(GT.rows, flow.rows);
+    ASSERT_EQ(GT.cols, flow.cols);
+    EXPECT_LE(calcRMSE(GT(roi), flow(roi)), 0.74f);
+
+    Mat outside = flow.clone();
+    outside(roi).setTo(Scalar::all(0));
+    EXPECT_EQ(0, countNonZero(outside.reshape(1)));
+}
+
+TEST(DenseOpticalFlow_DIS, TemporalWarmStart)
+{
+    Mat frame1, frame2, GT;
+    ASSERT_TRUE(readRubberWhale(frame1, frame2, GT));
+    cvtColor(frame1, frame1, COLOR_BGR2GRAY);
+    cvtColor(frame2, frame2, COLOR_BGR2GRAY);
+
+    Ptr<DISOpticalFlow> algo = createOptFlow_DIS(DISOpticalFlow::PRESET_FAST);
+    algo->setUseTemporalWarmStart(true);
+
+    // the first call has no state to reuse:
+    Mat flow;
+    algo->calc(frame1, frame2, flow);
+    EXPECT_LE(calcRMSE(GT, flow), 0.74f);
+
+    // the second call reuses the pyramid of frame2:
+    Mat warm_flow, ref_flow;
+    algo->calc(frame2, frame1, warm_flow);
+    createOptFlow_DIS(DISOpticalFlow::PRESET_FAST)->calc(frame2, frame1, ref_flow);
+    ASSERT_EQ(ref_flow.size(), warm_flow.size());
+    EXPECT_LE(calcRMSE(ref_flow, warm_flow), 1.0f);
+}
+
 TEST(DenseOpticalFlow_VariationalRefinement, ReferenceAccuracy)
 {
     Mat frame1, frame2, GT;
@@ -236,6 +282,24 @@ TEST(DenseOpticalFlow_PCAFlow, ReferenceAccuracy)
     EXPECT_LE(calcRMSE(GT, flow), target_RMSE);
 }
 
+TEST(DenseOpticalFlow_PCAFlow, IRLS)
+{
+    Mat frame1, frame2, GT;
+    ASSERT_TRUE(readRubberWhale(frame1, frame2, GT));
+    const float target_RMSE = 0.55f;
+
+    Ptr<DenseOpticalFlow> algo = makePtr<OpticalFlowPCAFlow>(Ptr<const PCAPrior>(), Size(18, 14), 0.024f, 0.2f,
+                                                             0.0003f, 0.00002f, 14.0f, 3);
+    for (int i = 0; i < 2; i++) // the second frame is warm-started from the first one
+    {
+        Mat flow;
+        algo->calc(frame1, frame2, flow);
+        ASSERT_EQ(GT.rows, flow.rows);
+        ASSERT_EQ(GT.cols, flow.cols);
+        EXPECT_LE(calcRMSE(GT, flow), target_RMSE);
+    }
+}
+
 TEST(DenseOpticalFlow_GlobalPatchColliderDCT, ReferenceAccuracy)
 {
     Mat frame1, frame2, GT;
@@ -260,6 +324,37 @@ TEST(DenseOpticalFlow_GlobalPatchColliderDCT, ReferenceAccuracy)
     ASSERT_LE(calcAvgEPE(corr, GT), 0.5f);
 }
 
+TEST(DenseOpticalFlow_GlobalPatchColliderDCT, DescriptorsForImage)
+{
+    const int radius = 10;
+    Mat imgCh[3];
+    RNG rng(12345);
+    for (int c = 0; c < 3; c++)
+    {
+        imgCh[c].create(48, 64, CV_32F);
+        rng.fill(imgCh[c], RNG::UNIFORM, 0.f, 255.f);
+    }
+
+    vector<GPCPatchDescriptor> descr;
+    GPCDetails::getAllDescriptorsForImage(imgCh, descr, GPCMatchingParams(false), GPC_DESCRIPTOR_DCT);
+    ASSERT_EQ((size_t)(imgCh[0].rows - 2 * radius) * (imgCh[0].cols - 2 * radius), descr.size());
+
+    for (size_t i = 0; i < descr.size(); i += 7)
+    {
+        int x, y;
+        GPCDetails::getCoordinatesFromIndex(i, imgCh[0].size(), x, y);
+        const Rect roi(x - radius, y - radius, 2 * radius, 2 * radius);
+
+        Mat freqDomain;
+        dct(imgCh[0](roi), freqDomain);
+        for (int a = 0; a < 4; a++)
+            for (int b = 0; b < 4; b++)
+                EXPECT_NEAR(freqDomain.at<float>(a, b), descr[i].feature[4 * a + b], 5e-2);
+        EXPECT_NEAR(sum(imgCh[1](roi))[0] / (2 * radius), descr[i].feature[16], 1e-2);
+        EXPECT_NEAR(sum(imgCh[2](roi))[0] / (2 * radius), descr[i].feature[17], 1e-2);
+    }
+}
+
 TEST(DenseOpticalFlow_GlobalPatchColliderWHT, ReferenceAccuracy)
 {
     Mat frame1, frame2, GT;
@@ -41,6 +41,7 @@
 
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv {
 namespace phase_unwrapping {
@@ -60,116 +61,38 @@ public:
     void getInverseReliabilityMap( OutputArray reliabilityMap );
 
 private:
-    // Class describing a pixel
-    class Pixel
-    {
-    private:
-        // Value from the wrapped phase map
-        float phaseValue;
-        // Id of a pixel. Computed from its position in the Mat
-        int idx;
-        // Pixel is valid if it's not in a shadow region
-        bool valid;
-        // "Quality" parameter. See reference paper
-        float inverseReliability;
-        // Number of 2pi  that needs to be added to the pixel to unwrap the phase map
-        int increment;
-        // Number of pixels that are in the same group as the current pixel
-        int nbrOfPixelsInGroup;
-        // Group id. At first, group id is the same value as idx
-        int groupId;
-        // Pixel is alone in its group
-        bool singlePixelGroup;
-    public:
-        Pixel();
-        Pixel( float pV, int id, bool v, float iR, int inc );
-        float getPhaseValue();
-        int getIndex();
-        bool getValidity();
-        float getInverseReliability();
-        int getIncrement();
-        int getNbrOfPixelsInGroup();
-        int getGroupId();
-        bool getSinglePixelGroup();
-        void setIncrement( int inc );
-        // When a pixel which is not in a single group is added to a new group, we need to keep the previous increment and add "inc" to it.
-        void changeIncrement( int inc );
-        void setNbrOfPixelsInGroup( int nbr );
-        void setGroupId( int gId );
-        void setSinglePixelGroup( bool s );
-    };
-    // Class describing an Edge as presented in the reference paper
-    class Edge
-    {
-    private:
-        // Id of the first pixel that forms the edge
-        int pixOneId;
-        // Id of the second pixel that forms the edge
-        int pixTwoId;
-        // Number of 2pi that needs to be added to the second pixel to remove discontinuities
-        int increment;
-    public:
-        Edge();
-        Edge( int p1, int p2, int inc );
-        int getPixOneId();
-        int getPixTwoId();
-        int getIncrement();
-    };
-    // Class describing a bin from the histogram
-    class HistogramBin
-    {
-    private:
-        float start;
-        float end;
-        std::vector<Edge> edges;
-    public:
-        HistogramBin();
-        HistogramBin( float s, float e );
-        void addEdge( Edge e );
-        std::vector<Edge> getEdges();
-    };
-    // Class describing the histogram. Bins before "thresh" are smaller than the one after "thresh" value
-    class Histogram
-    {
-    private:
-        std::vector<HistogramBin> bins;
-        float thresh;
-        float smallWidth;
-        float largeWidth;
-        int nbrOfSmallBins;
-        int nbrOfLargeBins;
-        int nbrOfBins;
-    public:
-        Histogram();
-        void createBins( float t, int nbrOfBinsBeforeThresh, int nbrOfBinsAfterThresh );
-        void addBin( HistogramBin b );
-        void addEdgeInBin( Edge e, int binIndex);
-        float getThresh();
-        float getSmallWidth();
-        float getLargeWidth();
-        int getNbrOfBins();
-        std::vector<Edge> getEdgesFromBin( int binIndex );
-    };
     // Params for phase unwrapping
     Params params;
-    // Pixels from the wrapped phase map
-    std::vector<Pixel> pixels;
-    // Histogram used to unwrap
-    Histogram histogram;
+    // Values from the wrapped phase map
+    Mat phaseMap;
+    // Pixels are valid if they are not in a shadow region
+    Mat validityMap;
+    // "Quality" parameter of the pixels. See reference paper
+    Mat inverseReliabilityMap;
+    /* Edges as presented in the reference paper, sorted in the histogram: the edges of bin i are
+     * the ones in [binStart[i], binStart[i+1]). The edge increment is the number of 2pi that needs
+     * to be added to the second pixel to remove discontinuities.
+     */
+    std::vector<int> edgePixOneId;
+    std::vector<int> edgePixTwoId;
+    std::vector<schar> edgeIncrement;
+    std::vector<int> binStart;
+    /* Groups of pixels as a union-find forest. The number of 2pi that needs to be added to a pixel is
+     * the sum of the increments along its path to the root of its group. Sizes are only kept for roots.
+     */
+    std::vector<int> groupParent;
+    std::vector<int> groupIncrement;
+    std::vector<int> groupSize;
     // Compute pixel reliability.
     void computePixelsReliability( InputArray wrappedPhaseMap, InputArray shadowMask = noArray() );
     // Compute edges reliability and sort them in the histogram
     void computeEdgesReliabilityAndCreateHistogram();
-    // Methods that is used in the previous one
-    void createAndSortEdge( int idx1, int idx2 );
     // Unwrap the phase map thanks to the histogram
     void unwrapHistogram();
     // add right number of 2*pi to the pixels
     void addIncrement( OutputArray unwrappedPhaseMap );
-    // Gamma function from the paper
-    float wrap( float a, float b );
-    // Similar to the previous one but returns the number of 2pi that needs to be added
-    int findInc( float a, float b );
+    // Root of the group of a pixel, inc is set to the number of 2pi to add to the pixel
+    int findGroup( int idx, int &inc );
 };
 // Default parameters
 HistogramPhaseUnwrapping::Params::Params(){
@@ -185,201 +108,269 @@ HistogramPhaseUnwrapping_Impl::HistogramPhaseUnwrapping_Impl(
 
 }
 
-HistogramPhaseUnwrapping_Impl::Pixel::Pixel()
-{
-
-}
-// Constructor
-HistogramPhaseUnwrapping_Impl::Pixel::Pixel( float pV, int id, bool v, float iR, int inc )
-{
-    phaseValue = pV;
-    idx = id;
-    valid = v;
-    inverseReliability = iR;
-    increment = inc;
-    nbrOfPixelsInGroup = 1;
-    groupId = id;
-    singlePixelGroup = true;
-}
-
-float HistogramPhaseUnwrapping_Impl::Pixel::getPhaseValue()
-{
-    return phaseValue;
-}
-
-int HistogramPhaseUnwrapping_Impl::Pixel::getIndex()
-{
-    return idx;
-}
-
-bool HistogramPhaseUnwrapping_Impl::Pixel::getValidity()
-{
-    return valid;
-}
-
-float HistogramPhaseUnwrapping_Impl::Pixel::getInverseReliability()
-{
-    return inverseReliability;
-}
-
-int HistogramPhaseUnwrapping_Impl::Pixel::getIncrement()
-{
-    return increment;
-}
-
-int HistogramPhaseUnwrapping_Impl::Pixel::getNbrOfPixelsInGroup()
-{
-    return nbrOfPixelsInGroup;
-}
-
-int HistogramPhaseUnwrapping_Impl::Pixel::getGroupId()
-{
-    return groupId;
-}
-
-bool HistogramPhaseUnwrapping_Impl::Pixel::getSinglePixelGroup()
-{
-    return singlePixelGroup;
-}
-
-void HistogramPhaseUnwrapping_Impl::Pixel::setIncrement( int inc )
-{
-    increment = inc;
-}
-/* When a pixel of a non-single group is added to an other non-single group, we need to add a new
-increment to the one that was there previously and that was already removing some wraps.
-*/
-void HistogramPhaseUnwrapping_Impl::Pixel::changeIncrement( int inc )
-{
-    increment += inc;
-}
-
-void HistogramPhaseUnwrapping_Impl::Pixel::setNbrOfPixelsInGroup( int nbr )
-{
-    nbrOfPixelsInGroup = nbr;
-}
-void HistogramPhaseUnwrapping_Impl::Pixel::setGroupId( int gId )
-{
-    groupId = gId;
-}
-
-void HistogramPhaseUnwrapping_Impl::Pixel::setSinglePixelGroup( bool s )
+// Gamma function from the paper
+static inline float wrap( float a, float b )
 {
-    singlePixelGroup = s;
+    float result;
+    float difference = a - b;
+    float pi = static_cast<float>(CV_PI);
+    if( difference > pi )
+        result = ( difference - 2 * pi );
+    else if( difference < -pi )
+        result = ( difference + 2 * pi );
+    else
+        result = difference;
+    return result;
 }
 
-HistogramPhaseUnwrapping_Impl::Edge::Edge()
+#if CV_SIMD128
+static inline v_float32x4 wrap( const v_float32x4 &a, const v_float32x4 &b )
 {
-
-}
-// Constructor
-HistogramPhaseUnwrapping_Impl::Edge::Edge( int p1, int p2, int inc )
-{
-    pixOneId = p1;
-    pixTwoId = p2;
-    increment = inc;
+    const float pi = static_cast<float>(CV_PI);
+    v_float32x4 difference = a - b;
+    return v_select(difference > v_setall_f32(pi), difference - v_setall_f32(2 * pi),
+                    v_select(difference < v_setall_f32(-pi), difference + v_setall_f32(2 * pi),
+                             difference));
 }
+#endif
 
-int HistogramPhaseUnwrapping_Impl::Edge::getPixOneId()
+// Similar to the previous one but returns the number of 2pi that needs to be added
+static inline int findInc( float a, float b )
 {
-    return pixOneId;
+    float difference;
+    int wrapValue;
+    difference = b - a;
+    float pi = static_cast<float>(CV_PI);
+    if( difference > pi )
+        wrapValue = -1;
+    else if( difference < -pi )
+        wrapValue = 1;
+    else
+        wrapValue = 0;
+    return wrapValue;
 }
 
-int HistogramPhaseUnwrapping_Impl::Edge::getPixTwoId()
+/* Inverse reliabilities of the rows in range. Pixels on the image or shadow borders and non valid
+ * pixels get the maximum value.
+ */
+class PixelsReliabilityInvoker : public ParallelLoopBody
 {
-    return pixTwoId;
-}
+public:
+    PixelsReliabilityInvoker( const Mat &_phase, const Mat &_mask, Mat &_inverseReliability ) :
+        phase(_phase), mask(_mask), inverseReliability(_inverseReliability)
+    {}
 
-int HistogramPhaseUnwrapping_Impl::Edge::getIncrement()
-{
-    return increment;
-}
+    void operator()( const Range &range ) const
+    {
+        const int rows = phase.rows, cols = phase.cols;
+        const float maxInverseReliability = static_cast<float>(16 * CV_PI * CV_PI);
+        // neighbourhood columns that are fully valid
+        std::vector<uchar> validColumn(cols);
 
-HistogramPhaseUnwrapping_Impl::HistogramBin::HistogramBin()
-{
+        for( int i = range.start; i < range.end; ++i )
+        {
+            float *r = inverseReliability.ptr<float>(i);
+            if( i == 0 || i == rows - 1 || cols < 3 )
+            {
+                for( int j = 0; j < cols; ++j )
+                    r[j] = maxInverseReliability;
+                continue;
+            }
+            // um, lm, ... are the upper middle, lower middle... neighbours of the paper
+            const float *pu = phase.ptr<float>(i - 1), *pm = phase.ptr<float>(i), *pl = phase.ptr<float>(i + 1);
+            const uchar *mu = mask.ptr<uchar>(i - 1), *mm = mask.ptr<uchar>(i), *ml = mask.ptr<uchar>(i + 1);
+
+            r[0] = r[cols - 1] = maxInverseReliability;
+            int j = 1;
+#if CV_SIMD128
+            for( ; j <= cols - 5; j += 4 )
+            {
+                v_float32x4 c = v_load(pm + j);
+                v_float32x4 H = wrap(v_load(pm + j - 1), c) - wrap(c, v_load(pm + j + 1));
+                v_float32x4 V = wrap(v_load(pu + j), c) - wrap(c, v_load(pl + j));
+                v_float32x4 D1 = wrap(v_load(pu + j - 1), c) - wrap(c, v_load(pl + j + 1));
+                v_float32x4 D2 = wrap(v_load(pu + j + 1), c) - wrap(c, v_load(pl + j - 1));
+                v_store(r + j, H * H + V * V + D1 * D1 + D2 * D2);
+            }
+#endif
+            for( ; j < cols - 1; ++j )
+            {
+                float c = pm[j];
+                float H = wrap(pm[j - 1], c) - wrap(c, pm[j + 1]);
+                float V = wrap(pu[j], c) - wrap(c, pl[j]);
+                float D1 = wrap(pu[j - 1], c) - wrap(c, pl[j + 1]);
+                float D2 = wrap(pu[j + 1], c) - wrap(c, pl[j - 1]);
+                r[j] = H * H + V * V + D1 * D1 + D2 * D2;
+            }
 
-}
+            /* if one of the neighbouring pixels is not valid, pixel (i,j) is considered as being on
+             * the border.
+             */
+            for( j = 0; j < cols; ++j )
+                validColumn[j] = mu[j] == 255 && mm[j] == 255 && ml[j] == 255;
+            for( j = 1; j < cols - 1; ++j )
+            {
+                if( !(validColumn[j - 1] && validColumn[j] && validColumn[j + 1]) )
+                    r[j] = maxInverseReliability;
+            }
+        }
+    }
 
-HistogramPhaseUnwrapping_Impl::HistogramBin::HistogramBin( float s, float e )
-{
-    start = s;
-    end = e;
-}
+private:
+    const Mat &phase;
+    const Mat &mask;
+    Mat &inverseReliability;
 
-void HistogramPhaseUnwrapping_Impl::HistogramBin::addEdge( Edge e )
-{
-    edges.push_back(e);
-}
-std::vector<HistogramPhaseUnwrapping_Impl::Edge> HistogramPhaseUnwrapping_Impl::HistogramBin::getEdges()
-{
-    return edges;
-}
-HistogramPhaseUnwrapping_Impl::Histogram::Histogram()
-{
+    PixelsReliabilityInvoker& operator=(const PixelsReliabilityInvoker&);
+};
 
-}
-/*
- * create histogram bins. Bins size is not uniform, as in the reference paper
- *
+/* Histogram bins of the edges that link the pixels to their right and lower neighbours. Bins size is
+ * not uniform, as in the reference paper: bins before "thresh" are smaller than the ones after it.
  */
-void HistogramPhaseUnwrapping_Impl::Histogram::createBins( float t, int nbrOfBinsBeforeThresh,
-                                                           int nbrOfBinsAfterThresh )
+class EdgesBinningInvoker : public ParallelLoopBody
 {
-    thresh = t;
-
-    nbrOfSmallBins = nbrOfBinsBeforeThresh;
-    nbrOfLargeBins = nbrOfBinsAfterThresh;
-    nbrOfBins = nbrOfBinsBeforeThresh + nbrOfBinsAfterThresh;
-
-    smallWidth = thresh / nbrOfSmallBins;
-    largeWidth = static_cast<float>(32 * CV_PI * CV_PI - thresh) / static_cast<float>(nbrOfLargeBins);
+public:
+    EdgesBinningInvoker( const Mat &_validity, const Mat &_inverseReliability,
+                         const HistogramPhaseUnwrapping::Params &params,
+                         int _stripeSize, Mat &_edgeBins, std::vector<int> &_binCounts ) :
+        validity(_validity), inverseReliability(_inverseReliability),
+        thresh(params.histThresh), nbrOfSmallBins(params.nbrOfSmallBins),
+        nbrOfBins(params.nbrOfSmallBins + params.nbrOfLargeBins), stripeSize(_stripeSize),
+        edgeBins(_edgeBins), binCounts(_binCounts)
+    {
+        smallWidth = thresh / nbrOfSmallBins;
+        largeWidth = static_cast<float>(32 * CV_PI * CV_PI - thresh) / static_cast<float>(params.nbrOfLargeBins);
+    }
 
-    for( int i = 0; i < nbrOfSmallBins; ++i )
+    void operator()( const Range &range ) const
     {
-        addBin(HistogramBin(i * smallWidth, ( i + 1 ) * smallWidth));
+        const int rows = validity.rows, cols = validity.cols;
+        for( int stripe = range.start; stripe < range.end; ++stripe )
+        {
+            int *counts = &binCounts[stripe * nbrOfBins];
+            const int end = std::min(rows, (stripe + 1) * stripeSize);
+            for( int i = stripe * stripeSize; i < end; ++i )
+            {
+                const uchar *v = validity.ptr<uchar>(i);
+                const uchar *vDown = validity.ptr<uchar>(std::min(i + 1, rows - 1));
+                const float *r = inverseReliability.ptr<float>(i);
+                const float *rDown = inverseReliability.ptr<float>(std::min(i + 1, rows - 1));
+                short *bins = edgeBins.ptr<short>(i);
+                for( int j = 0; j < cols; ++j )
+                {
+                    // first edge to the right neighbour, second one to the lower neighbour
+                    bins[2 * j] = bins[2 * j + 1] = -1;
+                    if( !v[j] )
+                        continue;
+                    if( j != cols - 1 && v[j + 1] )
+                    {
+                        int bin = findBin(r[j] + r[j + 1]);
+                        bins[2 * j] = (short)bin;
+                        counts[bin]++;
+                    }
+                    if( i != rows - 1 && vDown[j] )
+                    {
+                        int bin = findBin(r[j] + rDown[j]);
+                        bins[2 * j + 1] = (short)bin;
+                        counts[bin]++;
+                    }
+                }
+            }
+        }
     }
-    for( int i = 0; i < nbrOfLargeBins; ++i )
+
+private:
+    int findBin( float edgeReliability ) const
     {
-        addBin(HistogramBin(thresh + i * largeWidth, thresh + ( i + 1 ) * largeWidth));
+        int binIndex;
+        if( edgeReliability < thresh )
+        {
+            binIndex = static_cast<int> (ceil(edgeReliability / smallWidth) - 1);
+            if( binIndex == -1 )
+            {
+                binIndex = 0;
+            }
+        }
+        else
+        {
+            binIndex = nbrOfSmallBins +
+                       static_cast<int> (ceil((edgeReliability - thresh) / largeWidth) - 1);
+        }
+        return std::min(binIndex, nbrOfBins - 1);
     }
-}
-// Add a bin b to the histogram
-void HistogramPhaseUnwrapping_Impl::Histogram::addBin( HistogramBin b )
-{
-    bins.push_back(b);
-}
-// Add edge E in bin binIndex
-void HistogramPhaseUnwrapping_Impl::Histogram::addEdgeInBin( Edge e, int binIndex )
-{
-    bins[binIndex].addEdge(e);
-}
-float HistogramPhaseUnwrapping_Impl::Histogram::getThresh()
-{
-    return thresh;
-}
 
-float HistogramPhaseUnwrapping_Impl::Histogram::getSmallWidth()
-{
-    return smallWidth;
-}
+    const Mat &validity;
+    const Mat &inverseReliability;
+    float thresh, smallWidth, largeWidth;
+    int nbrOfSmallBins, nbrOfBins;
+    int stripeSize;
+    Mat &edgeBins;
+    std::vector<int> &binCounts;
 
-float HistogramPhaseUnwrapping_Impl::Histogram::getLargeWidth()
-{
-    return largeWidth;
-}
+    EdgesBinningInvoker& operator=(const EdgesBinningInvoker&);
+};
 
-int HistogramPhaseUnwrapping_Impl::Histogram::getNbrOfBins()
+/* Scatters the edges into their bins. Each stripe writes from its own offsets, so that the edges of
+ * a bin are ordered as the pixels they start from, right edge first.
+ */
+class EdgesSortingInvoker : public ParallelLoopBody
 {
-    return nbrOfBins;
-}
+public:
+    EdgesSortingInvoker( const Mat &_phase, const Mat &_edgeBins, int _stripeSize, int _nbrOfBins,
+                         const std::vector<int> &_binOffsets, std::vector<int> &_pixOneId,
+                         std::vector<int> &_pixTwoId, std::vector<schar> &_increment ) :
+        phase(_phase), edgeBins(_edgeBins), stripeSize(_stripeSize), nbrOfBins(_nbrOfBins),
+        binOffsets(_binOffsets), pixOneId(_pixOneId), pixTwoId(_pixTwoId), increment(_increment)
+    {}
+
+    void operator()( const Range &range ) const
+    {
+        const int rows = phase.rows, cols = phase.cols;
+        std::vector<int> offsets(nbrOfBins);
+        for( int stripe = range.start; stripe < range.end; ++stripe )
+        {
+            std::copy(binOffsets.begin() + stripe * nbrOfBins,
+                      binOffsets.begin() + (stripe + 1) * nbrOfBins, offsets.begin());
+            const int end = std::min(rows, (stripe + 1) * stripeSize);
+            for( int i = stripe * stripeSize; i < end; ++i )
+            {
+                const float *p = phase.ptr<float>(i);
+                const float *pDown = phase.ptr<float>(std::min(i + 1, rows - 1));
+                const short *bins = edgeBins.ptr<short>(i);
+                for( int j = 0; j < cols; ++j )
+                {
+                    const int idx = i * cols + j;
+                    if( bins[2 * j] >= 0 )
+                    {
+                        int pos = offsets[bins[2 * j]]++;
+                        pixOneId[pos] = idx;
+                        pixTwoId[pos] = idx + 1;
+                        increment[pos] = (schar)findInc(p[j + 1], p[j]);
+                    }
+                    if( bins[2 * j + 1] >= 0 )
+                    {
+                        int pos = offsets[bins[2 * j + 1]]++;
+                        pixOneId[pos] = idx;
+                        pixTwoId[pos] = idx + cols;
+                        increment[pos] = (schar)findInc(pDown[j], p[j]);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const Mat &phase;
+    const Mat &edgeBins;
+    int stripeSize, nbrOfBins;
+    const std::vector<int> &binOffsets;
+    std::vector<int> &pixOneId;
+    std::vector<int> &pixTwoId;
+    std::vector<schar> &increment;
+
+    EdgesSortingInvoker& operator=(const EdgesSortingInvoker&);
+};
 
-std::vector<HistogramPhaseUnwrapping_Impl::Edge> HistogramPhaseUnwrapping_Impl::
-                                                 Histogram::getEdgesFromBin( int binIndex )
-{
-    std::vector<HistogramPhaseUnwrapping_Impl::Edge> temp;
-    temp = bins[binIndex].getEdges();
-    return temp;
-}
 /* Method in which reliabilities are computed and edges are sorted in the histogram.
 Increments are computed for each pixels.
  */
@@ -391,6 +382,7 @@ void HistogramPhaseUnwrapping_Impl::unwrapPhaseMap( InputArray wrappedPhaseMap,
     Mat mask;
     int rows = params.height;
     int cols = params.width;
+    CV_Assert( wPhaseMap.type() == CV_32FC1 && wPhaseMap.rows == rows && wPhaseMap.cols == cols );
     if( shadowMask.empty() )
     {
         mask.create(rows, cols, CV_8UC1);
@@ -419,290 +411,137 @@ void HistogramPhaseUnwrapping_Impl::computePixelsReliability( InputArray wrapped
 
     Mat &wPhaseMap = *(Mat*) wrappedPhaseMap.getObj();
     Mat &mask = *(Mat*) shadowMask.getObj();
+    CV_Assert( mask.type() == CV_8UC1 && mask.rows == rows && mask.cols == cols );
 
-    int idx; //idx is used to store pixel position (idx = i*cols + j)
-    bool valid;//tells if a pixel is in the valid mask region
+    wPhaseMap.copyTo(phaseMap);
+    validityMap = mask != 0;
+    inverseReliabilityMap.create(rows, cols, CV_32FC1);
 
-    // H, V, D1, D2 are from the paper
-    float H, V, D1, D2, D;
-    /* used to store neighbours coordinates
-     * ul = upper left, um = upper middle, ur = upper right
-     * ml = middle left, mr = middle right
-     * ll = lower left, lm = lower middle, lr = lower right
-     */
-    Point ul, um, ur, ml, mr, ll, lm, lr;
-
-    for( int i = 0; i < rows; ++i )
-    {
-        for( int j = 0; j < cols; ++j )
-        {
-            if( mask.at<uchar>( i, j ) != 0 ) //if pixel is in a valid region
-            {
-                if( i == 0 || i == rows - 1 || j == 0 || j == cols - 1 )
-                {
-                    idx = i * cols + j;
-                    valid = true;
-                    Pixel p(wPhaseMap.at<float>(i, j), idx, valid,
-                            static_cast<float>(16 * CV_PI * CV_PI), 0);
-                    pixels.push_back(p);
-                }
-                else
-                {
-                    ul = Point(j-1, i-1);
-                    um = Point(j, i-1);
-                    ur = Point(j+1, i-1);
-                    ml = Point(j-1, i);
-                    mr = Point(j+1, i);
-                    ll = Point(j-1, i+1);
-                    lm = Point(j, i+1);
-                    lr = Point(j+1, i+1);
-
-                    Mat neighbourhood = mask( Rect( j-1, i-1, 3, 3 ) );
-                    Scalar meanValue = mean(neighbourhood);
-
-                    /* if mean value is different from 255, it means that one of the neighbouring
-                     * pixel is not valid -> pixel (i,j) is considered as being on the border.
-                     */
-                    if( meanValue[0] != 255 )
-                    {
-                        idx = i * cols + j;
-                        valid = true;
-                        Pixel p(wPhaseMap.at<float>(i, j), idx, valid,
-                                static_cast<float>(16 * CV_PI * CV_PI), 0);
-                        pixels.push_back(p);
-                    }
-                    else
-                    {
-                        H = wrap(wPhaseMap.at<float>(ml.y, ml.x), wPhaseMap.at<float>(i, j))
-                            - wrap(wPhaseMap.at<float>(i, j), wPhaseMap.at<float>(mr.y, mr.x));
-                        V = wrap(wPhaseMap.at<float>(um.y, um.x), wPhaseMap.at<float>(i, j))
-                            - wrap(wPhaseMap.at<float>(i, j), wPhaseMap.at<float>(lm.y, lm.x));
-                        D1 = wrap(wPhaseMap.at<float>(ul.y, ul.x), wPhaseMap.at<float>(i, j))
-                            - wrap(wPhaseMap.at<float>(i, j), wPhaseMap.at<float>(lr.y, lr.x));
-                        D2 = wrap(wPhaseMap.at<float>(ur.y, ur.x), wPhaseMap.at<float>(i, j))
-                            - wrap(wPhaseMap.at<float>(i, j), wPhaseMap.at<float>(ll.y, ll.x));
-                        D = H * H + V * V + D1 * D1 + D2 * D2;
-
-                        idx = i * cols + j;
-                        valid = true;
-                        Pixel p(wPhaseMap.at<float>(i, j), idx, valid, D, 0);
-                        pixels.push_back(p);
-                    }
-                }
-            }
-            else // pixel is not in a valid region. It's inverse reliability is set to the maximum
-            {
-                idx = i * cols + j;
-                valid = false;
-                Pixel p(wPhaseMap.at<float>(i, j), idx, valid,
-                        static_cast<float>(16 * CV_PI * CV_PI), 0);
-                pixels.push_back(p);
-            }
-        }
-    }
+    parallel_for_(Range(0, rows), PixelsReliabilityInvoker(phaseMap, mask, inverseReliabilityMap));
 }
-/* Edges are created from the vector of pixels. We loop on the vector and create the edges
- * that link the current pixel to his right neighbour (first edge) and the one that is under it (second edge)
+/* Edges link each valid pixel to its valid right and lower neighbours. The histogram bins of the
+ * edges are found in parallel stripes of rows, then the edges are counting sorted into the bins.
  */
 void HistogramPhaseUnwrapping_Impl::computeEdgesReliabilityAndCreateHistogram()
 {
-    int row;
-    int col;
-    histogram.createBins(params.histThresh, params.nbrOfSmallBins, params.nbrOfLargeBins);
-    int nbrOfPixels = static_cast<int>(pixels.size());
-    /* Edges are built by considering a pixel and it's right-neighbour and lower-neighbour.
-     We discard non-valid pixels here.
-     */
-    for( int i = 0; i < nbrOfPixels; ++i )
+    int rows = params.height;
+    int cols = params.width;
+    const int nbrOfBins = params.nbrOfSmallBins + params.nbrOfLargeBins;
+    CV_Assert( params.nbrOfSmallBins > 0 && params.nbrOfLargeBins > 0 && nbrOfBins <= SHRT_MAX );
+
+    const int stripeSize = std::max(1, rows / 64);
+    const int nbrOfStripes = (rows + stripeSize - 1) / stripeSize;
+
+    Mat edgeBins(rows, cols, CV_16SC2);
+    std::vector<int> binCounts(nbrOfStripes * nbrOfBins, 0);
+    parallel_for_(Range(0, nbrOfStripes),
+                  EdgesBinningInvoker(validityMap, inverseReliabilityMap, params, stripeSize,
+                                      edgeBins, binCounts));
+
+    // the edges of a stripe follow the ones of the previous stripes in each bin
+    binStart.assign(nbrOfBins + 1, 0);
+    std::vector<int> binOffsets(nbrOfStripes * nbrOfBins);
+    int nbrOfEdges = 0;
+    for( int bin = 0; bin < nbrOfBins; ++bin )
     {
-        if( pixels[i].getValidity() )
+        binStart[bin] = nbrOfEdges;
+        for( int stripe = 0; stripe < nbrOfStripes; ++stripe )
         {
-            row = pixels[i].getIndex() / params.width;
-            col = pixels[i].getIndex() % params.width;
-
-            if( row != params.height - 1 && col != params.width -1 )
-            {
-                int idxRight, idxDown;
-                idxRight = row * params.width + col + 1; // Pixel to the right
-                idxDown = ( row + 1 ) * params.width + col; // Pixel under pixel i.
-                createAndSortEdge(i, idxRight);
-                createAndSortEdge(i, idxDown);
-            }
-            else if( row != params.height - 1 && col == params.width - 1 )
-            {
-                int idxDown = ( row + 1 ) * params.width + col;
-                createAndSortEdge(i, idxDown);
-            }
-            else if( row == params.height - 1 && col != params.width - 1 )
-            {
-                int idxRight = row * params.width + col + 1;
-                createAndSortEdge(i, idxRight);
-            }
+            binOffsets[stripe * nbrOfBins + bin] = nbrOfEdges;
+            nbrOfEdges += binCounts[stripe * nbrOfBins + bin];
         }
     }
+    binStart[nbrOfBins] = nbrOfEdges;
+
+    edgePixOneId.resize(nbrOfEdges);
+    edgePixTwoId.resize(nbrOfEdges);
+    edgeIncrement.resize(nbrOfEdges);
+    parallel_for_(Range(0, nbrOfStripes),
+                  EdgesSortingInvoker(phaseMap, edgeBins, stripeSize, nbrOfBins, binOffsets,
+                                      edgePixOneId, edgePixTwoId, edgeIncrement));
 }
-/*used along the previous method to sort edges in the histogram*/
-void HistogramPhaseUnwrapping_Impl::createAndSortEdge( int idx1, int idx2 )
+
+int HistogramPhaseUnwrapping_Impl::findGroup( int idx, int &inc )
 {
-    if( pixels[idx2].getValidity() )
+    int root = idx;
+    int pathIncrement = 0;
+    while( groupParent[root] != root )
     {
-        float edgeReliability = pixels[idx1].getInverseReliability() +
-                                pixels[idx2].getInverseReliability();
-        int inc = findInc(pixels[idx2].getPhaseValue(), pixels[idx1].getPhaseValue());
-        Edge e(idx1, idx2, inc);
+        pathIncrement += groupIncrement[root];
+        root = groupParent[root];
+    }
+    inc = pathIncrement + groupIncrement[root];
 
-        if( edgeReliability < histogram.getThresh() )
-        {
-            int binIndex = static_cast<int> (ceil(edgeReliability / histogram.getSmallWidth()) - 1);
-            if( binIndex == -1 )
-            {
-                binIndex = 0;
-            }
-            histogram.addEdgeInBin(e, binIndex);
-        }
-        else
-        {
-            int binIndex = params.nbrOfSmallBins +
-                           static_cast<int> (ceil((edgeReliability - histogram.getThresh()) /
-                                 histogram.getLargeWidth()) - 1);
-            histogram.addEdgeInBin(e, binIndex);
-        }
+    // path compression, the pixels are linked to the root with their whole increment
+    int pixel = idx;
+    while( pixel != root && groupParent[pixel] != root )
+    {
+        int next = groupParent[pixel];
+        int pixelIncrement = groupIncrement[pixel];
+        groupParent[pixel] = root;
+        groupIncrement[pixel] = pathIncrement;
+        pathIncrement -= pixelIncrement;
+        pixel = next;
     }
+    return root;
 }
 
+/* Edges are processed from the most reliable bin to the least reliable one. When two groups are
+ * merged, the smallest one is added to the biggest one, and the least reliable pixel of the edge
+ * decides for groups of the same size.
+ */
 void HistogramPhaseUnwrapping_Impl::unwrapHistogram()
 {
-    int nbrOfPixels = static_cast<int>(pixels.size());
-    int nbrOfBins = histogram.getNbrOfBins();
-    /* This vector is used to keep track of the number of pixels in each group and avoid useless group.
-       For example, if lastPixelAddedToGroup[10] is equal to 5, it means that pixel "5" was the last one
-       to be added to group 10. So, pixel "5" is the only one that has the correct value for parameter
-       "numberOfPixelsInGroup" in order to avoid a loop on all the pixels to update this number*/
-    std::vector<int> lastPixelAddedToGroup(nbrOfPixels, 0);
-    for( int i = 0; i < nbrOfBins; ++i )
-    {
-        std::vector<Edge> currentEdges = histogram.getEdgesFromBin(i);
-        int nbrOfEdgesInBin = static_cast<int>(currentEdges.size());
-
-        for( int j = 0; j < nbrOfEdgesInBin; ++j )
-        {
-
-            int pOneId = currentEdges[j].getPixOneId();
-            int pTwoId = currentEdges[j].getPixTwoId();
-            // Both pixels are in a single group.
-            if( pixels[pOneId].getSinglePixelGroup() && pixels[pTwoId].getSinglePixelGroup() )
-            {
-                float invRel1 = pixels[pOneId].getInverseReliability();
-                float invRel2 = pixels[pTwoId].getInverseReliability();
-                // Quality of pixel 2 is better than that of pixel 1 -> pixel 1 is added to group 2
-                if( invRel1 > invRel2 )
-                {
-                    int newGroupId = pixels[pTwoId].getGroupId();
-                    int newInc = pixels[pTwoId].getIncrement() + currentEdges[j].getIncrement();
-                    pixels[pOneId].setGroupId(newGroupId);
-                    pixels[pOneId].setIncrement(newInc);
-                    lastPixelAddedToGroup[newGroupId] = pOneId; // Pixel 1 is the last one to be added to group 2
-                }
-                else
-                {
-                    int newGroupId = pixels[pOneId].getGroupId();
-                    int newInc = pixels[pOneId].getIncrement() - currentEdges[j].getIncrement();
-                    pixels[pTwoId].setGroupId(newGroupId);
-                    pixels[pTwoId].setIncrement(newInc);
-                    lastPixelAddedToGroup[newGroupId] = pTwoId;
-                }
-                pixels[pOneId].setNbrOfPixelsInGroup(2);
-                pixels[pTwoId].setNbrOfPixelsInGroup(2);
-                pixels[pOneId].setSinglePixelGroup(false);
-                pixels[pTwoId].setSinglePixelGroup(false);
-            }
-            //p1 is in a single group, p2 is not -> p1 added to p2
-            else if( pixels[pOneId].getSinglePixelGroup() && !pixels[pTwoId].getSinglePixelGroup() )
-            {
-                int newGroupId = pixels[pTwoId].getGroupId();
-                int lastPix = lastPixelAddedToGroup[newGroupId];
-                int newNbrOfPixelsInGroup = pixels[lastPix].getNbrOfPixelsInGroup() + 1;
-                int newInc = pixels[pTwoId].getIncrement() + currentEdges[j].getIncrement();
-
-                pixels[pOneId].setGroupId(newGroupId);
-                pixels[pOneId].setNbrOfPixelsInGroup(newNbrOfPixelsInGroup);
-                pixels[pTwoId].setNbrOfPixelsInGroup(newNbrOfPixelsInGroup);
-                pixels[pOneId].setIncrement(newInc);
-                pixels[pOneId].setSinglePixelGroup(false);
-
-                lastPixelAddedToGroup[newGroupId] = pOneId;
-            }
-            //p2 is in a single group, p1 is not -> p2 added to p1
-            else if( !pixels[pOneId].getSinglePixelGroup() && pixels[pTwoId].getSinglePixelGroup() )
-            {
-                int newGroupId = pixels[pOneId].getGroupId();
-                int lastPix = lastPixelAddedToGroup[newGroupId];
-                int newNbrOfPixelsInGroup = pixels[lastPix].getNbrOfPixelsInGroup() + 1;
-                int newInc = pixels[pOneId].getIncrement() - currentEdges[j].getIncrement();
-
-                pixels[pTwoId].setGroupId(newGroupId);
-                pixels[pTwoId].setNbrOfPixelsInGroup(newNbrOfPixelsInGroup);
-                pixels[pOneId].setNbrOfPixelsInGroup(newNbrOfPixelsInGroup);
-                pixels[pTwoId].setIncrement(newInc);
-                pixels[pTwoId].setSinglePixelGroup(false);
-
-                lastPixelAddedToGroup[newGroupId] = pTwoId;
-            }
-            //p1 and p2 are in two different groups
-            else if( pixels[pOneId].getGroupId() != pixels[pTwoId].getGroupId() )
-            {
-                int pOneGroupId = pixels[pOneId].getGroupId();
-                int pTwoGroupId = pixels[pTwoId].getGroupId();
+    const int nbrOfPixels = params.width * params.height;
+    const int nbrOfEdges = binStart.back();
+    const float *inverseReliability = inverseReliabilityMap.ptr<float>();
 
-                float invRel1 = pixels[pOneId].getInverseReliability();
-                float invRel2 = pixels[pTwoId].getInverseReliability();
-
-                int lastAddedToGroupOne = lastPixelAddedToGroup[pOneGroupId];
-                int lastAddedToGroupTwo = lastPixelAddedToGroup[pTwoGroupId];
-
-                int nbrOfPixelsInGroupOne = pixels[lastAddedToGroupOne].getNbrOfPixelsInGroup();
-                int nbrOfPixelsInGroupTwo = pixels[lastAddedToGroupTwo].getNbrOfPixelsInGroup();
-
-                int totalNbrOfPixels = nbrOfPixelsInGroupOne + nbrOfPixelsInGroupTwo;
+    groupParent.resize(nbrOfPixels);
+    for( int i = 0; i < nbrOfPixels; ++i )
+        groupParent[i] = i;
+    groupIncrement.assign(nbrOfPixels, 0);
+    groupSize.assign(nbrOfPixels, 1);
 
-                if( nbrOfPixelsInGroupOne < nbrOfPixelsInGroupTwo ||
-                   (nbrOfPixelsInGroupOne == nbrOfPixelsInGroupTwo && invRel1 >= invRel2) ) //group p1 added to group p2
-                {
-                    pixels[pTwoId].setNbrOfPixelsInGroup(totalNbrOfPixels);
-                    pixels[pOneId].setNbrOfPixelsInGroup(totalNbrOfPixels);
-                    int inc = pixels[pTwoId].getIncrement() + currentEdges[j].getIncrement() -
-                                 pixels[pOneId].getIncrement();
-                    lastPixelAddedToGroup[pTwoGroupId] = pOneId;
+    for( int j = 0; j < nbrOfEdges; ++j )
+    {
+        int pOneId = edgePixOneId[j];
+        int pTwoId = edgePixTwoId[j];
+        int pOneInc, pTwoInc;
+        int pOneGroupId = findGroup(pOneId, pOneInc);
+        int pTwoGroupId = findGroup(pTwoId, pTwoInc);
+        if( pOneGroupId == pTwoGroupId )
+            continue;
+
+        int nbrOfPixelsInGroupOne = groupSize[pOneGroupId];
+        int nbrOfPixelsInGroupTwo = groupSize[pTwoGroupId];
+        float invRel1 = inverseReliability[pOneId];
+        float invRel2 = inverseReliability[pTwoId];
+
+        bool groupOneToGroupTwo;
+        // Both pixels are in a single group: the least reliable one is added to the other group
+        if( nbrOfPixelsInGroupOne == 1 && nbrOfPixelsInGroupTwo == 1 )
+            groupOneToGroupTwo = invRel1 > invRel2;
+        // A single pixel is added to the other group
+        else if( nbrOfPixelsInGroupOne == 1 || nbrOfPixelsInGroupTwo == 1 )
+            groupOneToGroupTwo = nbrOfPixelsInGroupOne == 1;
+        else
+            groupOneToGroupTwo = nbrOfPixelsInGroupOne < nbrOfPixelsInGroupTwo ||
+                                 (nbrOfPixelsInGroupOne == nbrOfPixelsInGroupTwo && invRel1 >= invRel2);
 
-                    for( int k = 0; k < nbrOfPixels; ++k )
-                    {
-                        if( pixels[k].getGroupId() == pOneGroupId )
-                        {
-                            pixels[k].setGroupId(pTwoGroupId);
-                            pixels[k].changeIncrement(inc);
-                        }
-                    }
-                }
-                else if( nbrOfPixelsInGroupOne > nbrOfPixelsInGroupTwo ||
-                        (nbrOfPixelsInGroupOne == nbrOfPixelsInGroupTwo && invRel2 > invRel1) ) //group p2 added to group p1
-                {
-                    int oldGroupId = pTwoGroupId;
-                    pixels[pOneId].setNbrOfPixelsInGroup(totalNbrOfPixels);
-                    pixels[pTwoId].setNbrOfPixelsInGroup(totalNbrOfPixels);
-                    int inc = pixels[pOneId].getIncrement() - currentEdges[j].getIncrement() -
-                              pixels[pTwoId].getIncrement();
-                    lastPixelAddedToGroup[pOneGroupId] = pTwoId;
-
-                    for( int k = 0; k < nbrOfPixels; ++k )
-                    {
-                        if( pixels[k].getGroupId() == oldGroupId )
-                        {
-                            pixels[k].setGroupId(pOneGroupId);
-                            pixels[k].changeIncrement(inc);
-                        }
-                    }
-                }
-            }
+        // the increment added to the whole group is stored in its root, relatively to the new root
+        if( groupOneToGroupTwo )
+        {
+            int inc = pTwoInc + edgeIncrement[j] - pOneInc;
+            groupParent[pOneGroupId] = pTwoGroupId;
+            groupIncrement[pOneGroupId] += inc - groupIncrement[pTwoGroupId];
+            groupSize[pTwoGroupId] += nbrOfPixelsInGroupOne;
+        }
+        else
+        {
+            int inc = pOneInc - edgeIncrement[j] - pTwoInc;
+            groupParent[pTwoGroupId] = pOneGroupId;
+            groupIncrement[pTwoGroupId] += inc - groupIncrement[pOneGroupId];
+            groupSize[pOneGroupId] += nbrOfPixelsInGroupTwo;
         }
     }
 }
@@ -713,64 +552,28 @@ void HistogramPhaseUnwrapping_Impl::addIncrement( OutputArray unwrappedPhaseMap
     int cols = params.width;
     if( uPhaseMap.empty() )
         uPhaseMap.create(rows, cols, CV_32FC1);
-    int nbrOfPixels = static_cast<int>(pixels.size());
-    for( int i = 0; i < nbrOfPixels; ++i )
+    for( int i = 0; i < rows; ++i )
     {
-        int row = pixels[i].getIndex() / params.width;
-        int col = pixels[i].getIndex() % params.width;
-
-        if( pixels[i].getValidity() )
+        const float *p = phaseMap.ptr<float>(i);
+        const uchar *v = validityMap.ptr<uchar>(i);
+        float *u = uPhaseMap.ptr<float>(i);
+        for( int j = 0; j < cols; ++j )
         {
-            uPhaseMap.at<float>(row, col) = pixels[i].getPhaseValue() +
-                                            static_cast<float>(2 * CV_PI * pixels[i].getIncrement());
+            if( v[j] )
+            {
+                int inc;
+                findGroup(i * cols + j, inc);
+                u[j] = p[j] + static_cast<float>(2 * CV_PI * inc);
+            }
         }
     }
 }
-float HistogramPhaseUnwrapping_Impl::wrap( float a, float b )
-{
-    float result;
-    float difference = a - b;
-    float pi = static_cast<float>(CV_PI);
-    if( difference > pi )
-        result = ( difference - 2 * pi );
-    else if( difference < -pi )
-        result = ( difference + 2 * pi );
-    else
-        result = difference;
-    return result;
-}
-
-int HistogramPhaseUnwrapping_Impl::findInc( float a, float b )
-{
-    float difference;
-    int wrapValue;
-    difference = b - a;
-    float pi = static_cast<float>(CV_PI);
-    if( difference > pi )
-        wrapValue = -1;
-    else if( difference < -pi )
-        wrapValue = 1;
-    else
-        wrapValue = 0;
-    return wrapValue;
-}
 
 //create a Mat that shows pixel inverse reliabilities
-void HistogramPhaseUnwrapping_Impl::getInverseReliabilityMap( OutputArray inverseReliabilityMap )
+void HistogramPhaseUnwrapping_Impl::getInverseReliabilityMap( OutputArray inverseReliabilityMap_ )
 {
-    int rows = params.height;
-    int cols = params.width;
-    Mat &reliabilityMap_ = *(Mat*) inverseReliabilityMap.getObj();
-    if( reliabilityMap_.empty() )
-        reliabilityMap_.create(rows, cols, CV_32FC1);
-    for( int i = 0; i < rows; ++i )
-    {
-        for( int j = 0; j < cols; ++j )
-        {
-            int idx = i * cols + j;
-            reliabilityMap_.at<float>(i, j) = pixels[idx].getInverseReliability();
-        }
-    }
+    Mat &reliabilityMap_ = *(Mat*) inverseReliabilityMap_.getObj();
+    inverseReliabilityMap.copyTo(reliabilityMap_);
 }
 
 Ptr<HistogramPhaseUnwrapping> HistogramPhaseUnwrapping::create( const HistogramPhaseUnwrapping::Params
@@ -780,4 +583,4 @@ Ptr<HistogramPhaseUnwrapping> HistogramPhaseUnwrapping::create( const HistogramP
 }
 
 }
-}
\ No newline at end of file
+}
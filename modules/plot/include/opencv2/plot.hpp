@@ -84,6 +84,41 @@ namespace cv
             CV_WRAP virtual void setPlotGridColor(Scalar _plotGridColor) = 0;
             CV_WRAP virtual void setPlotTextColor(Scalar _plotTextColor) = 0;
             CV_WRAP virtual void setPlotSize(int _plotSizeWidth, int _plotSizeHeight) = 0;
+            /**
+             * @brief Appends points to the plotted data
+             *
+             * @param dataY \f$1xN\f$ or \f$Nx1\f$ matrix of type CV_64F containing \f$Y\f$ values of the new points.
+             * Their \f$X\f$ values continue from the last \f$X\f$ value with a step of 1.
+             *
+             * Limits that were not set explicitly follow the data. When they are unchanged, or when they
+             * slide over data with increasing \f$X\f$ without changing their width, the next render() only
+             * draws the new points, scrolling the previous ones to the left in the second case. Scrolled
+             * points may be off by one pixel compared to a full redraw.
+             */
+            CV_WRAP virtual void appendData(InputArray dataY) = 0;
+            /**
+             * @brief Appends points to the plotted data
+             *
+             * @param dataX \f$1xN\f$ or \f$Nx1\f$ matrix of type CV_64F containing \f$X\f$ values of the new points.
+             * @param dataY \f$1xN\f$ or \f$Nx1\f$ matrix of type CV_64F containing \f$Y\f$ values of the new points.
+             */
+            CV_WRAP virtual void appendData(InputArray dataX, InputArray dataY) = 0;
+            /**
+             * @brief Limits the number of plotted points
+             *
+             * @param maxSamples when more points are plotted, the oldest ones are dropped. 0 means no limit.
+             */
+            CV_WRAP virtual void setMaxSamples(int maxSamples) = 0;
+            /**
+             * @brief Renders the plot
+             *
+             * The background, the axes and the plotted data are kept between calls and only redrawn when
+             * they change. When \f$X\f$ values are increasing, points falling in the same pixel column are
+             * drawn as a single vertical line between the lowest and the highest of them, so the cost of
+             * drawing large data is bounded by the plot width.
+             *
+             * @param _plotResult output image of type CV_8UC3. Its buffer is reused if it has the plot size.
+             */
             CV_WRAP virtual void render(OutputArray _plotResult) = 0;
         };
 
@@ -80,15 +80,14 @@ namespace cv
                     _plotData = _plotData.t();
                 }
 
-                plotDataY=_plotData;
-                plotDataX = plotDataY*0;
-                for (int i=0; i<plotDataY.rows; i++)
+                Mat _plotDataX(_plotData.rows, 1, CV_64F);
+                for (int i=0; i<_plotData.rows; i++)
                 {
-                    plotDataX.at<double>(i,0) = i;
+                    _plotDataX.at<double>(i,0) = i;
                 }
 
                 //calling the main constructor
-                plotHelper(plotDataX, plotDataY);
+                plotHelper(_plotDataX, _plotData);
 
             }
 
@@ -128,29 +127,36 @@ namespace cv
             {
                 plotMinX = _plotMinX;
                 plotMinX_plusZero = _plotMinX;
+                autoLimitsX = false;
             }
             void setMaxX(double _plotMaxX)
             {
                 plotMaxX = _plotMaxX;
                 plotMaxX_plusZero = _plotMaxX;
+                autoLimitsX = false;
             }
             void setMinY(double _plotMinY)
             {
                 plotMinY = _plotMinY;
                 plotMinY_plusZero = _plotMinY;
+                autoLimitsY = false;
             }
             void setMaxY(double _plotMaxY)
             {
                 plotMaxY = _plotMaxY;
                 plotMaxY_plusZero = _plotMaxY;
+                autoLimitsY = false;
             }
             void setPlotLineWidth(int _plotLineWidth)
             {
                 plotLineWidth = _plotLineWidth;
+                axisDirty = true;
+                traceDirty = true;
             }
             void setNeedPlotLine(bool _needPlotLine)
             {
                 needPlotLine = _needPlotLine;
+                traceDirty = true;
             }
             void setPlotLineColor(Scalar _plotLineColor)
             {
@@ -159,18 +165,22 @@ namespace cv
             void setPlotBackgroundColor(Scalar _plotBackgroundColor)
             {
                 plotBackgroundColor=_plotBackgroundColor;
+                axisDirty = true;
             }
             void setPlotAxisColor(Scalar _plotAxisColor)
             {
                 plotAxisColor=_plotAxisColor;
+                axisDirty = true;
             }
             void setPlotGridColor(Scalar _plotGridColor)
             {
                 plotGridColor=_plotGridColor;
+                axisDirty = true;
             }
             void setPlotTextColor(Scalar _plotTextColor)
             {
                 plotTextColor=_plotTextColor;
+                axisDirty = true;
             }
             void setPlotSize(int _plotSizeWidth, int _plotSizeHeight)
             {
@@ -185,68 +195,90 @@ namespace cv
                     plotSizeHeight = 300;
             }
 
-            //render the plotResult to a Mat
-            void render(OutputArray _plotResult)
+            void appendData(InputArray _dataY)
             {
-                //create the plot result
-                _plotResult.create(plotSizeHeight, plotSizeWidth, CV_8UC3);
-                plotResult = _plotResult.getMat();
-                plotResult.setTo(plotBackgroundColor);
+                Mat dataY_ = _dataY.getMat();
+                CV_Assert(dataY_.empty() || (dataY_.type() == CV_64F && (dataY_.rows == 1 || dataY_.cols == 1)));
 
-                int NumVecElements = plotDataX.rows;
+                double startX = numSamples() > 0 ? dataX.back() + 1 : 0;
+                Mat dataX_((int)dataY_.total(), 1, CV_64F);
+                for (int i=0; i<dataX_.rows; i++)
+                {
+                    dataX_.at<double>(i,0) = startX + i;
+                }
 
-                Mat InterpXdata = linearInterpolation(plotMinX, plotMaxX, 0, plotSizeWidth, plotDataX);
-                Mat InterpYdata = linearInterpolation(plotMinY, plotMaxY, 0, plotSizeHeight, plotDataY);
+                appendHelper(dataX_, dataY_);
+            }
 
-                //Find the zeros in image coordinates
-                Mat InterpXdataFindZero = linearInterpolation(plotMinX_plusZero, plotMaxX_plusZero, 0, plotSizeWidth, plotDataX_plusZero);
-                Mat InterpYdataFindZero = linearInterpolation(plotMinY_plusZero, plotMaxY_plusZero, 0, plotSizeHeight, plotDataY_plusZero);
+            void appendData(InputArray _dataX, InputArray _dataY)
+            {
+                Mat dataX_ = _dataX.getMat();
+                Mat dataY_ = _dataY.getMat();
+                CV_Assert(dataX_.total() == dataY_.total());
+                CV_Assert(dataX_.empty() || (dataX_.type() == CV_64F && (dataX_.rows == 1 || dataX_.cols == 1)));
+                CV_Assert(dataY_.empty() || (dataY_.type() == CV_64F && (dataY_.rows == 1 || dataY_.cols == 1)));
+
+                appendHelper(dataX_, dataY_);
+            }
+
+            void setMaxSamples(int _maxSamples)
+            {
+                CV_Assert(_maxSamples >= 0);
+                maxSamples = _maxSamples;
 
-                int ImageXzero = (int)InterpXdataFindZero.at<double>(NumVecElements,0);
-                int ImageYzero = (int)InterpYdataFindZero.at<double>(NumVecElements,0);
+                if(dropOldSamples())
+                    updateLimits(0);
+            }
 
-                double CurrentX = plotDataX.at<double>(NumVecElements-1,0);
-                double CurrentY = plotDataY.at<double>(NumVecElements-1,0);
+            //render the plotResult to a Mat
+            void render(OutputArray _plotResult)
+            {
+                int NumVecElements = numSamples();
 
-                drawAxis(ImageXzero,ImageYzero, CurrentX, CurrentY, plotAxisColor, plotGridColor);
+                //Find the zeros in image coordinates
+                int ImageXzero = toPixel(0, plotMinX_plusZero, plotMaxX_plusZero, plotSizeWidth);
+                int ImageYzero = toPixel(0, plotMinY_plusZero, plotMaxY_plusZero, plotSizeHeight);
 
-                if(needPlotLine)
+                //the background, the axes and the grid are only redrawn when their layout changes
+                if(axisDirty || plotAxisLayer.cols != plotSizeWidth || plotAxisLayer.rows != plotSizeHeight ||
+                   ImageXzero != axisXzero || ImageYzero != axisYzero)
                 {
-                    //Draw the plot by connecting lines between the points
-                    Point p1;
-                    p1.x = (int)InterpXdata.at<double>(0,0);
-                    p1.y = (int)InterpYdata.at<double>(0,0);
+                    plotAxisLayer.create(plotSizeHeight, plotSizeWidth, CV_8UC3);
+                    plotAxisLayer.setTo(plotBackgroundColor);
+                    plotResult = plotAxisLayer;
+                    drawAxis(ImageXzero, ImageYzero, plotAxisColor, plotGridColor);
+
+                    axisXzero = ImageXzero;
+                    axisYzero = ImageYzero;
+                    axisDirty = false;
+                }
 
-                    for (int r=1; r<InterpXdata.rows; r++)
-                    {
-                        Point p2;
-                        p2.x = (int)InterpXdata.at<double>(r,0);
-                        p2.y = (int)InterpYdata.at<double>(r,0);
+                updateTrace();
 
-                        line(plotResult, p1, p2, plotLineColor, plotLineWidth, 8, 0);
+                //create the plot result
+                _plotResult.create(plotSizeHeight, plotSizeWidth, CV_8UC3);
+                plotResult = _plotResult.getMat();
+                plotAxisLayer.copyTo(plotResult);
 
-                        p1 = p2;
-                    }
-                }
-                else
-                {
-                    for (int r=0; r<InterpXdata.rows; r++)
-                    {
-                        Point p;
-                        p.x = (int)InterpXdata.at<double>(r,0);
-                        p.y = (int)InterpYdata.at<double>(r,0);
+                double CurrentX = dataX[dataOffset + NumVecElements - 1];
+                double CurrentY = dataY[dataOffset + NumVecElements - 1];
+                drawValuesAsText("X = %g",CurrentX, 0, 0, 40, 20);
+                drawValuesAsText("Y = %g",CurrentY, 0, 20, 40, 20);
 
-                        circle(plotResult, p, 1, plotLineColor, plotLineWidth, 8, 0);
-                    }
-                }
+                plotResult.setTo(plotLineColor, plotTrace);
             }
 
             protected:
 
-            Mat plotDataX;
-            Mat plotDataY;
-            Mat plotDataX_plusZero;
-            Mat plotDataY_plusZero;
+            //plotted points, the first dataOffset entries are dropped samples waiting to be erased
+            std::vector<double> dataX;
+            std::vector<double> dataY;
+            size_t dataOffset;
+            size_t numDropped;
+            int maxSamples;
+            bool sortedX;
+            bool autoLimitsX;
+            bool autoLimitsY;
             const char * plotName;
 
             //dimensions and limits of the plot
@@ -269,60 +301,50 @@ namespace cv
             Scalar plotGridColor;
             Scalar plotTextColor;
 
-            //the final plot result
+            //the image being drawn on
             Mat plotResult;
 
+            //background, axes and grid kept between renders
+            Mat plotAxisLayer;
+            int axisXzero;
+            int axisYzero;
+            bool axisDirty;
+
+            //mask of the plotted data kept between renders, and the limits it was drawn with
+            Mat plotTrace;
+            Mat plotTraceBuffer;
+            double traceMinX;
+            double traceMaxX;
+            double traceMinY;
+            double traceMaxY;
+            double traceOriginX;
+            size_t drawnUpTo;
+            size_t traceDropped;
+            Point lastPoint;
+            bool traceDirty;
+
             //flag which enables/disables connection of plotted points by lines
             bool needPlotLine;
 
             void plotHelper(Mat _plotDataX, Mat _plotDataY)
             {
-                plotDataX=_plotDataX;
-                plotDataY=_plotDataY;
-
-                int NumVecElements = plotDataX.rows;
+                _plotDataX.copyTo(dataX);
+                _plotDataY.copyTo(dataY);
+                dataOffset = 0;
+                numDropped = 0;
+                maxSamples = 0;
 
-                plotDataX_plusZero = Mat::zeros(NumVecElements+1,1,CV_64F);
-                plotDataY_plusZero = Mat::zeros(NumVecElements+1,1,CV_64F);
+                sortedX = true;
+                for(size_t i=1; i<dataX.size() && sortedX; i++)
+                    sortedX = dataX[i-1] <= dataX[i];
 
-                for(int i=0; i<NumVecElements; i++){
-                    plotDataX_plusZero.at<double>(i,0) = plotDataX.at<double>(i,0);
-                    plotDataY_plusZero.at<double>(i,0) = plotDataY.at<double>(i,0);
-                }
-
-                double MinX;
-                double MaxX;
-                double MinY;
-                double MaxY;
-                double MinX_plusZero;
-                double MaxX_plusZero;
-                double MinY_plusZero;
-                double MaxY_plusZero;
+                //setting the min and max values for each axis
+                autoLimitsX = true;
+                autoLimitsY = true;
+                updateLimits(0);
 
                 needPlotLine = true;
 
-                //Obtain the minimum and maximum values of Xdata
-                minMaxLoc(plotDataX,&MinX,&MaxX);
-
-                //Obtain the minimum and maximum values of Ydata
-                minMaxLoc(plotDataY,&MinY,&MaxY);
-
-                //Obtain the minimum and maximum values of Xdata plus zero
-                minMaxLoc(plotDataX_plusZero,&MinX_plusZero,&MaxX_plusZero);
-
-                //Obtain the minimum and maximum values of Ydata plus zero
-                minMaxLoc(plotDataY_plusZero,&MinY_plusZero,&MaxY_plusZero);
-
-                //setting the min and max values for each axis
-                plotMinX = MinX;
-                plotMaxX = MaxX;
-                plotMinY = MinY;
-                plotMaxY = MaxY;
-                plotMinX_plusZero = MinX_plusZero;
-                plotMaxX_plusZero = MaxX_plusZero;
-                plotMinY_plusZero = MinY_plusZero;
-                plotMaxY_plusZero = MaxY_plusZero;
-
                 //setting the default size of a plot figure
                 setPlotSize(600, 400);
 
@@ -335,16 +357,259 @@ namespace cv
                 setPlotBackgroundColor(Scalar(0, 0, 0));
                 setPlotLineColor(Scalar(0, 255, 255));
                 setPlotTextColor(Scalar(255, 255, 255));
+
+                axisXzero = axisYzero = -1;
+                drawnUpTo = 0;
+                traceDropped = 0;
+            }
+
+            int numSamples() const
+            {
+                return (int)(dataY.size() - dataOffset);
             }
 
-            void drawAxis(int ImageXzero, int ImageYzero, double CurrentX, double CurrentY, Scalar axisColor, Scalar gridColor)
+            void appendHelper(const Mat& _dataX, const Mat& _dataY)
+            {
+                Mat newX = _dataX.isContinuous() ? _dataX : _dataX.clone();
+                Mat newY = _dataY.isContinuous() ? _dataY : _dataY.clone();
+                int count = (int)newY.total();
+                if(count == 0)
+                    return;
+
+                size_t first = dataX.size() - dataOffset;
+                const double* px = newX.ptr<double>();
+                const double* py = newY.ptr<double>();
+                for(int i=0; i<count; i++)
+                {
+                    if(sortedX && !dataX.empty() && dataX.back() > px[i])
+                        sortedX = false;
+                    dataX.push_back(px[i]);
+                    dataY.push_back(py[i]);
+                }
+
+                updateLimits(dropOldSamples() ? 0 : first);
+            }
+
+            //drops the oldest samples beyond maxSamples, returns true if any was dropped
+            bool dropOldSamples()
+            {
+                if(maxSamples <= 0 || numSamples() <= maxSamples)
+                    return false;
+
+                size_t count = numSamples() - maxSamples;
+                dataOffset += count;
+                numDropped += count;
+
+                //erase the dropped samples once they take half of the storage
+                if(dataOffset * 2 > dataX.size())
+                {
+                    dataX.erase(dataX.begin(), dataX.begin() + dataOffset);
+                    dataY.erase(dataY.begin(), dataY.begin() + dataOffset);
+                    dataOffset = 0;
+                }
+                return true;
+            }
+
+            //recomputes the automatic limits, only looking at samples from the first one if it is not 0
+            void updateLimits(size_t first)
+            {
+                int NumVecElements = numSamples();
+                if(NumVecElements == 0)
+                    return;
+
+                if(autoLimitsX)
+                {
+                    double MinX, MaxX;
+                    if(sortedX)
+                    {
+                        MinX = dataX[dataOffset];
+                        MaxX = dataX.back();
+                    }
+                    else
+                    {
+                        minMaxLoc(Mat(1, NumVecElements - (int)first, CV_64F, &dataX[dataOffset + first]), &MinX, &MaxX);
+                        if(first > 0)
+                        {
+                            MinX = std::min(MinX, plotMinX);
+                            MaxX = std::max(MaxX, plotMaxX);
+                        }
+                    }
+                    plotMinX = MinX;
+                    plotMaxX = MaxX;
+                    plotMinX_plusZero = std::min(MinX, 0.0);
+                    plotMaxX_plusZero = std::max(MaxX, 0.0);
+                }
+
+                if(autoLimitsY)
+                {
+                    double MinY, MaxY;
+                    minMaxLoc(Mat(1, NumVecElements - (int)first, CV_64F, &dataY[dataOffset + first]), &MinY, &MaxY);
+                    if(first > 0)
+                    {
+                        MinY = std::min(MinY, plotMinY);
+                        MaxY = std::max(MaxY, plotMaxY);
+                    }
+                    plotMinY = MinY;
+                    plotMaxY = MaxY;
+                    plotMinY_plusZero = std::min(MinY, 0.0);
+                    plotMaxY_plusZero = std::max(MaxY, 0.0);
+                }
+            }
+
+            //brings the data mask up to date, drawing only the samples appended since the last render when possible
+            void updateTrace()
+            {
+                int NumVecElements = numSamples();
+                bool full = traceDirty || plotTrace.cols != plotSizeWidth || plotTrace.rows != plotSizeHeight ||
+                            plotMinY != traceMinY || plotMaxY != traceMaxY || drawnUpTo <= numDropped;
+                int shift = 0;
+
+                if(!full && (plotMinX != traceMinX || plotMaxX != traceMaxX))
+                {
+                    //a window sliding over sorted data is scrolled by a whole number of pixels
+                    double span = plotMaxX - plotMinX;
+                    double traceSpan = traceMaxX - traceMinX;
+                    if(sortedX && plotMinX > traceMinX && std::abs(span - traceSpan) <= std::abs(span) * 1e-9)
+                    {
+                        shift = cvRound((plotMinX - traceOriginX) * plotSizeWidth / span);
+                        full = shift >= plotSizeWidth;
+                    }
+                    else
+                        full = true;
+                }
+
+                //without scrolling, the dropped samples can only be removed by redrawing
+                if(shift == 0 && numDropped != traceDropped)
+                    full = true;
+
+                size_t first = 0;
+                if(full)
+                {
+                    plotTrace.create(plotSizeHeight, plotSizeWidth, CV_8U);
+                    plotTrace.setTo(Scalar::all(0));
+                    traceOriginX = plotMinX;
+                }
+                else
+                {
+                    if(shift > 0)
+                    {
+                        Rect kept(0, 0, plotSizeWidth - shift, plotSizeHeight);
+                        plotTraceBuffer.create(plotSizeHeight, plotSizeWidth, CV_8U);
+                        plotTrace(kept + Point(shift, 0)).copyTo(plotTraceBuffer(kept));
+                        plotTraceBuffer(Rect(kept.width, 0, shift, plotSizeHeight)).setTo(Scalar::all(0));
+                        std::swap(plotTrace, plotTraceBuffer);
+
+                        traceOriginX += shift * (plotMaxX - plotMinX) / plotSizeWidth;
+                        lastPoint.x -= shift;
+                    }
+                    first = drawnUpTo - numDropped;
+                }
+
+                drawSamples(first, NumVecElements, !full);
+
+                traceMinX = plotMinX;
+                traceMaxX = plotMaxX;
+                traceMinY = plotMinY;
+                traceMaxY = plotMaxY;
+                drawnUpTo = numDropped + NumVecElements;
+                traceDropped = numDropped;
+                traceDirty = false;
+            }
+
+            Point samplePoint(size_t i, double minX, double maxX) const
+            {
+                return Point(toPixel(dataX[dataOffset + i], minX, maxX, plotSizeWidth),
+                             toPixel(dataY[dataOffset + i], plotMinY, plotMaxY, plotSizeHeight));
+            }
+
+            //draws the samples [first, last) into the data mask, continuing from lastPoint if hasPrev is set
+            void drawSamples(size_t first, size_t last, bool hasPrev)
+            {
+                const Scalar on = Scalar::all(255);
+                double minX = traceOriginX;
+                double maxX = plotMaxX + (traceOriginX - plotMinX);
+                Point prev = lastPoint;
+                size_t r = first;
+
+                if(!needPlotLine)
+                {
+                    //points falling on the same pixel as the previous one are skipped
+                    for (; r<last; r++)
+                    {
+                        Point p = samplePoint(r, minX, maxX);
+                        if(!hasPrev || p != prev)
+                            circle(plotTrace, p, 1, on, plotLineWidth, 8, 0);
+                        prev = p;
+                        hasPrev = true;
+                    }
+                    lastPoint = prev;
+                    return;
+                }
+
+                if(!hasPrev)
+                {
+                    if(r >= last)
+                        return;
+                    prev = samplePoint(r++, minX, maxX);
+                }
+
+                if(!sortedX)
+                {
+                    //Draw the plot by connecting lines between the points
+                    bool drawn = hasPrev;
+                    for (; r<last; r++)
+                    {
+                        Point p = samplePoint(r, minX, maxX);
+                        if(!drawn || p != prev)
+                            line(plotTrace, prev, p, on, plotLineWidth, 8, 0);
+                        prev = p;
+                        drawn = true;
+                    }
+                    lastPoint = prev;
+                    return;
+                }
+
+                //With sorted X all the segments within a pixel column cover the span between the lowest and
+                //the highest point of the column, so a column is drawn as one vertical line plus the segment
+                //coming from the previous column
+                bool drawn = hasPrev;
+                int columnMinY = prev.y;
+                int columnMaxY = prev.y;
+                for (; r<last; r++)
+                {
+                    Point p = samplePoint(r, minX, maxX);
+                    if(p.x == prev.x)
+                    {
+                        columnMinY = std::min(columnMinY, p.y);
+                        columnMaxY = std::max(columnMaxY, p.y);
+                        if(!drawn)
+                        {
+                            line(plotTrace, prev, p, on, plotLineWidth, 8, 0);
+                            drawn = true;
+                        }
+                    }
+                    else
+                    {
+                        if(columnMinY != columnMaxY)
+                            line(plotTrace, Point(prev.x, columnMinY), Point(prev.x, columnMaxY), on, plotLineWidth, 8, 0);
+                        line(plotTrace, prev, p, on, plotLineWidth, 8, 0);
+                        columnMinY = columnMaxY = p.y;
+                        drawn = true;
+                    }
+                    prev = p;
+                }
+                if(columnMinY != columnMaxY)
+                    line(plotTrace, Point(prev.x, columnMinY), Point(prev.x, columnMaxY), on, plotLineWidth, 8, 0);
+
+                lastPoint = prev;
+            }
+
+            void drawAxis(int ImageXzero, int ImageYzero, Scalar axisColor, Scalar gridColor)
             {
                 drawValuesAsText(0, ImageXzero, ImageYzero, 10, 20);
                 drawValuesAsText(0, ImageXzero, ImageYzero, -20, 20);
                 drawValuesAsText(0, ImageXzero, ImageYzero, 10, -10);
                 drawValuesAsText(0, ImageXzero, ImageYzero, -20, -10);
-                drawValuesAsText("X = %g",CurrentX, 0, 0, 40, 20);
-                drawValuesAsText("Y = %g",CurrentY, 0, 20, 40, 20);
 
                 //Horizontal X axis and equispaced horizontal lines
                 int LineSpace = 50;
@@ -378,21 +643,11 @@ namespace cv
                 }
             }
 
-            Mat linearInterpolation(double Xa, double Xb, double Ya, double Yb, Mat Xdata){
-
-                Mat Ydata = Xdata*0;
+            static int toPixel(double X, double Xa, double Xb, int size){
 
-                for (int i=0; i<Xdata.rows; i++){
-
-                    double X = Xdata.at<double>(i,0);
-                    Ydata.at<double>(i,0) = int(Ya + (Yb-Ya)*(X-Xa)/(Xb-Xa));
-
-                    if(Ydata.at<double>(i,0)<0)
-                        Ydata.at<double>(i,0)=0;
-
-                }
+                int Y = int(size*(X-Xa)/(Xb-Xa));
 
-                return Ydata;
+                return Y < 0 ? 0 : Y;
             }
 
             void drawValuesAsText(double Value, int Xloc, int Yloc, int XMargin, int YMargin){
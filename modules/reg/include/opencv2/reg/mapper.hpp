@@ -91,6 +91,31 @@ protected:
      */
     void grid(const Mat& img, Mat& grid_r, Mat& grid_c) const;
 
+    /*
+     * Fills the n Jacobian rows J[k][0..cols*cn) of an image row from its gradient
+     * \param[in] Ix Gradient x-coordinate of the row
+     * \param[in] Iy Gradient y-coordinate of the row
+     * \param[in] row Row index (y-coordinate)
+     * \param[in] cols Number of columns
+     * \param[in] cn Number of channels
+     * \param[out] J Jacobian rows
+     */
+    typedef void (*JacobianRowFunc)(const float* Ix, const float* Iy, int row, int cols, int cn, double** J);
+
+    /*
+     * Accumulates the least squares system A = sum(J*J^T), b = -sum(J*It) over all the pixels and channels,
+     * the image is processed in parallel stripes
+     * \param[in] Ix Gradient x-coordinate
+     * \param[in] Iy Gradient y-coordinate
+     * \param[in] It Difference of images
+     * \param[in] jacobian Function filling the Jacobian rows
+     * \param[in] n Number of parameters
+     * \param[out] A n x n CV_64F matrix
+     * \param[out] b n x 1 CV_64F vector
+     */
+    void normalEquations(const cv::Mat& Ix, const cv::Mat& Iy, const cv::Mat& It,
+                         JacobianRowFunc jacobian, int n, cv::Mat& A, cv::Mat& b) const;
+
     /*
      * Per-element square of a matrix
      * \param[in] mat1 Input matrix
@@ -65,12 +65,22 @@ public:
 
     CV_WRAP cv::Ptr<Map> getMap() const;
 
+    /*
+     * Forgets the map of the previous frame used when warmStart_ is set
+     */
+    CV_WRAP void reset();
+
     CV_PROP_RW int numLev_;           /*!< Number of levels of the pyramid */
     CV_PROP_RW int numIterPerScale_;  /*!< Number of iterations at a given scale of the pyramid */
+    CV_PROP_RW bool warmStart_;       /*!< Video mode: without init, start from the map of the previous call */
 
 private:
     MapperPyramid& operator=(const MapperPyramid&);
     const Mapper& baseMapper_;  /*!< Mapper used in inner level */
+
+    mutable std::vector<cv::Mat> pyrIm1_, pyrIm2_;  /*!< Pyramid levels, reused between calls */
+    mutable cv::Mat warped_;                       /*!< img2 moved to the initial reference */
+    mutable cv::Ptr<Map> lastMap_;                 /*!< Result of the previous call, for warmStart_ */
 };
 
 /*!
@@ -37,7 +37,9 @@
 
 #include "precomp.hpp"
 #include <opencv2/imgproc.hpp>
+#include <opencv2/core/utility.hpp>
 #include "opencv2/reg/mapper.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv {
 namespace reg {
@@ -54,8 +56,114 @@ void Mapper::gradient(const Mat& img1, const Mat& img2, Mat& Ix, Mat& Iy, Mat& I
     Mat ykern = (Mat_<double>(3, 1) << -1., 0., 1.)/2.;
     filter2D(img2, Iy, -1, ykern, Point(-1,-1), 0., BORDER_REPLICATE);
 
-    It = Mat::zeros(sz1, img1.type());
-    It = img2 - img1;
+    It.create(sz1, img1.type());
+    subtract(img2, img1, It);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline double dotRow(const double* a, const double* b, int len)
+{
+    int i = 0;
+    double s = 0.;
+#if CV_SIMD128_64F
+    v_float64x2 acc0 = v_setzero_f64(), acc1 = v_setzero_f64();
+    for(; i <= len - 4; i += 4) {
+        acc0 += v_load(a + i)*v_load(b + i);
+        acc1 += v_load(a + i + 2)*v_load(b + i + 2);
+    }
+    double CV_DECL_ALIGNED(16) buf[2];
+    v_store_aligned(buf, acc0 + acc1);
+    s = buf[0] + buf[1];
+#endif
+    for(; i < len; ++i)
+        s += a[i]*b[i];
+    return s;
+}
+
+// Every stripe of rows accumulates its own system, they are added in order afterwards
+class NormalEquationsInvoker : public ParallelLoopBody
+{
+public:
+    NormalEquationsInvoker(const Mat& _Ix, const Mat& _Iy, const Mat& _It, Mapper::JacobianRowFunc _jacobian,
+                           int _n, int _stripeSize, Mat& _stripeSums)
+        : Ix(_Ix), Iy(_Iy), It(_It), jacobian(_jacobian), n(_n), stripeSize(_stripeSize), stripeSums(_stripeSums)
+    {
+    }
+
+    void operator()(const Range& range) const
+    {
+        const int len = Ix.cols*Ix.channels();
+        AutoBuffer<double> _buf((n + 1)*len);
+        AutoBuffer<double*> _J(n);
+        double** J = _J;
+        for(int k = 0; k < n; ++k)
+            J[k] = (double*)_buf + k*len;
+        double* e = (double*)_buf + n*len;
+
+        for(int s_i = range.start; s_i < range.end; ++s_i) {
+            double* sums = stripeSums.ptr<double>(s_i);
+            std::fill(sums, sums + stripeSums.cols, 0.);
+
+            int rowEnd = std::min(Ix.rows, (s_i + 1)*stripeSize);
+            for(int r_i = s_i*stripeSize; r_i < rowEnd; ++r_i) {
+                const float* diff = It.ptr<float>(r_i);
+                for(int c_i = 0; c_i < len; ++c_i)
+                    e[c_i] = diff[c_i];
+                jacobian(Ix.ptr<float>(r_i), Iy.ptr<float>(r_i), r_i, Ix.cols, Ix.channels(), J);
+
+                // upper triangle of A row by row, then b
+                int idx = 0;
+                for(int k = 0; k < n; ++k)
+                    for(int l = k; l < n; ++l)
+                        sums[idx++] += dotRow(J[k], J[l], len);
+                for(int k = 0; k < n; ++k)
+                    sums[idx++] -= dotRow(J[k], e, len);
+            }
+        }
+    }
+
+private:
+    NormalEquationsInvoker& operator=(const NormalEquationsInvoker&);
+
+    const Mat& Ix;
+    const Mat& Iy;
+    const Mat& It;
+    Mapper::JacobianRowFunc jacobian;
+    int n, stripeSize;
+    Mat& stripeSums;
+};
+
+void Mapper::normalEquations(const Mat& Ix, const Mat& Iy, const Mat& It,
+                             JacobianRowFunc jacobian, int n, Mat& A, Mat& b) const
+{
+    CV_Assert(Ix.size() == Iy.size() && Ix.size() == It.size());
+    CV_Assert(Ix.type() == Iy.type() && Ix.type() == It.type());
+
+    Mat Ixf = Ix, Iyf = Iy, Itf = It;
+    if(Ix.depth() != CV_32F) {
+        Ix.convertTo(Ixf, CV_32F);
+        Iy.convertTo(Iyf, CV_32F);
+        It.convertTo(Itf, CV_32F);
+    }
+
+    const int stripeSize = 16;
+    const int nStripes = (Ix.rows + stripeSize - 1)/stripeSize;
+    Mat stripeSums(nStripes, n*(n + 1)/2 + n, CV_64F);
+    parallel_for_(Range(0, nStripes), NormalEquationsInvoker(Ixf, Iyf, Itf, jacobian, n, stripeSize, stripeSums));
+
+    Mat sums;
+    reduce(stripeSums, sums, 0, REDUCE_SUM, CV_64F);
+    const double* s = sums.ptr<double>();
+
+    A.create(n, n, CV_64F);
+    b.create(n, 1, CV_64F);
+    int idx = 0;
+    for(int k = 0; k < n; ++k)
+        for(int l = k; l < n; ++l, ++idx)
+            A.at<double>(k, l) = A.at<double>(l, k) = s[idx];
+    for(int k = 0; k < n; ++k, ++idx)
+        b.at<double>(k) = s[idx];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
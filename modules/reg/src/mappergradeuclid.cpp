@@ -55,6 +55,19 @@ MapperGradEuclid::~MapperGradEuclid()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Derivatives of the warped image with respect to the parameters
+static void euclidJacobian(const float* Ix, const float* Iy, int row, int cols, int cn, double** J)
+{
+    for(int c_i = 0, i = 0; c_i < cols; ++c_i) {
+        for(int ch = 0; ch < cn; ++ch, ++i) {
+            J[0][i] = Ix[i];
+            J[1][i] = Iy[i];
+            J[2][i] = (double)c_i*Iy[i] - (double)row*Ix[i];
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 cv::Ptr<Map> MapperGradEuclid::calculate(
     InputArray _img1, InputArray image2, cv::Ptr<Map> init) const
@@ -74,38 +87,16 @@ cv::Ptr<Map> MapperGradEuclid::calculate(
         img2 = image2.getMat();
     }
 
-    // Matrices with reference frame coordinates
-    Mat grid_r, grid_c;
-    grid(img1, grid_r, grid_c);
-
     // Get gradient in all channels
     gradient(img1, img2, gradx, grady, imgDiff);
 
-    // Calculate parameters using least squares
-    Matx<double, 3, 3> A;
-    Vec<double, 3> b;
-    // For each value in A, all the matrix elements are added and then the channels are also added,
-    // so we have two calls to "sum". The result can be found in the first element of the final
-    // Scalar object.
-    Mat xIy_yIx = grid_c.mul(grady);
-    xIy_yIx -= grid_r.mul(gradx);
-
-    A(0, 0) = sum(sum(gradx.mul(gradx)))[0];
-    A(0, 1) = sum(sum(gradx.mul(grady)))[0];
-    A(0, 2) = sum(sum(gradx.mul(xIy_yIx)))[0];
-    A(1, 1) = sum(sum(grady.mul(grady)))[0];
-    A(1, 2) = sum(sum(grady.mul(xIy_yIx)))[0];
-    A(2, 2) = sum(sum(xIy_yIx.mul(xIy_yIx)))[0];
-    A(1, 0) = A(0, 1);
-    A(2, 0) = A(0, 2);
-    A(2, 1) = A(1, 2);
-
-    b(0) = -sum(sum(imgDiff.mul(gradx)))[0];
-    b(1) = -sum(sum(imgDiff.mul(grady)))[0];
-    b(2) = -sum(sum(imgDiff.mul(xIy_yIx)))[0];
+    // Calculate parameters using least squares, the sums run over all the pixels and channels
+    Mat A, b;
+    normalEquations(gradx, grady, imgDiff, euclidJacobian, 3, A, b);
 
     // Calculate parameters. We use Cholesky decomposition, as A is symmetric.
-    Vec<double, 3> k = A.inv(DECOMP_CHOLESKY)*b;
+    Vec<double, 3> k;
+    solve(A, b, k, DECOMP_CHOLESKY);
 
     double cosT = cos(k(2));
     double sinT = sin(k(2));
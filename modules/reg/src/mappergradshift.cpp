@@ -55,6 +55,16 @@ MapperGradShift::~MapperGradShift()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Derivatives of the warped image with respect to the parameters
+static void shiftJacobian(const float* Ix, const float* Iy, int, int cols, int cn, double** J)
+{
+    for(int i = 0; i < cols*cn; ++i) {
+        J[0][i] = Ix[i];
+        J[1][i] = Iy[i];
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 cv::Ptr<Map> MapperGradShift::calculate(
     InputArray _img1, InputArray image2, cv::Ptr<Map> init) const
@@ -75,23 +85,13 @@ cv::Ptr<Map> MapperGradShift::calculate(
     // Get gradient in all channels
     gradient(img1, img2, gradx, grady, imgDiff);
 
-    // Calculate parameters using least squares
-    Matx<double, 2, 2> A;
-    Vec<double, 2> b;
-    // For each value in A, all the matrix elements are added and then the channels are also added,
-    // so we have two calls to "sum". The result can be found in the first element of the final
-    // Scalar object.
-
-    A(0, 0) = sum(sum(gradx.mul(gradx)))[0];
-    A(0, 1) = sum(sum(gradx.mul(grady)))[0];
-    A(1, 1) = sum(sum(grady.mul(grady)))[0];
-    A(1, 0) = A(0, 1);
-
-    b(0) = -sum(sum(imgDiff.mul(gradx)))[0];
-    b(1) = -sum(sum(imgDiff.mul(grady)))[0];
+    // Calculate parameters using least squares, the sums run over all the pixels and channels
+    Mat A, b;
+    normalEquations(gradx, grady, imgDiff, shiftJacobian, 2, A, b);
 
     // Calculate shift. We use Cholesky decomposition, as A is symmetric.
-    Vec<double, 2> shift = A.inv(DECOMP_CHOLESKY)*b;
+    Vec<double, 2> shift;
+    solve(A, b, shift, DECOMP_CHOLESKY);
 
     if(init.empty()) {
         return Ptr<Map>(new MapShift(shift));
@@ -55,6 +55,20 @@ MapperGradSimilar::~MapperGradSimilar()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Derivatives of the warped image with respect to the parameters
+static void similarJacobian(const float* Ix, const float* Iy, int row, int cols, int cn, double** J)
+{
+    for(int c_i = 0, i = 0; c_i < cols; ++c_i) {
+        for(int ch = 0; ch < cn; ++ch, ++i) {
+            J[0][i] = (double)c_i*Ix[i] + (double)row*Iy[i];
+            J[1][i] = (double)row*Ix[i] - (double)c_i*Iy[i];
+            J[2][i] = Ix[i];
+            J[3][i] = Iy[i];
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 cv::Ptr<Map> MapperGradSimilar::calculate(
     InputArray _img1, InputArray image2, cv::Ptr<Map> init) const
@@ -77,53 +91,13 @@ cv::Ptr<Map> MapperGradSimilar::calculate(
     // Get gradient in all channels
     gradient(img1, img2, gradx, grady, imgDiff);
 
-    // Matrices with reference frame coordinates
-    Mat grid_r, grid_c;
-    grid(img1, grid_r, grid_c);
-
-    // Calculate parameters using least squares
-    Matx<double, 4, 4> A;
-    Vec<double, 4> b;
-    // For each value in A, all the matrix elements are added and then the channels are also added,
-    // so we have two calls to "sum". The result can be found in the first element of the final
-    // Scalar object.
-    Mat xIx_p_yIy = grid_c.mul(gradx);
-    xIx_p_yIy += grid_r.mul(grady);
-    Mat yIx_m_xIy = grid_r.mul(gradx);
-    yIx_m_xIy -= grid_c.mul(grady);
-
-    A(0, 0) = sum(sum(sqr(xIx_p_yIy)))[0];
-    A(0, 1) = sum(sum(xIx_p_yIy.mul(yIx_m_xIy)))[0];
-    A(0, 2) = sum(sum(gradx.mul(xIx_p_yIy)))[0];
-    A(0, 3) = sum(sum(grady.mul(xIx_p_yIy)))[0];
-
-    A(1, 1) = sum(sum(sqr(yIx_m_xIy)))[0];
-    A(1, 2) = sum(sum(gradx.mul(yIx_m_xIy)))[0];
-    A(1, 3) = sum(sum(grady.mul(yIx_m_xIy)))[0];
-
-    A(2, 2) = sum(sum(sqr(gradx)))[0];
-    A(2, 3) = sum(sum(gradx.mul(grady)))[0];
-
-    A(3, 3) = sum(sum(sqr(grady)))[0];
-
-    // Lower half values (A is symmetric)
-    A(1, 0) = A(0, 1);
-    A(2, 0) = A(0, 2);
-    A(3, 0) = A(0, 3);
-
-    A(2, 1) = A(1, 2);
-    A(3, 1) = A(1, 3);
-
-    A(3, 2) = A(2, 3);
-
-    // Calculation of b
-    b(0) = -sum(sum(imgDiff.mul(xIx_p_yIy)))[0];
-    b(1) = -sum(sum(imgDiff.mul(yIx_m_xIy)))[0];
-    b(2) = -sum(sum(imgDiff.mul(gradx)))[0];
-    b(3) = -sum(sum(imgDiff.mul(grady)))[0];
+    // Calculate parameters using least squares, the sums run over all the pixels and channels
+    Mat A, b;
+    normalEquations(gradx, grady, imgDiff, similarJacobian, 4, A, b);
 
     // Calculate affine transformation. We use Cholesky decomposition, as A is symmetric.
-    Vec<double, 4> k = A.inv(DECOMP_CHOLESKY)*b;
+    Vec<double, 4> k;
+    solve(A, b, k, DECOMP_CHOLESKY);
 
     Matx<double, 2, 2> linTr(k(0) + 1., k(1), -k(1), k(0) + 1.);
     Vec<double, 2> shift(k(2), k(3));
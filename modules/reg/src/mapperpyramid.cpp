@@ -49,7 +49,7 @@ namespace reg {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 MapperPyramid::MapperPyramid(Ptr<Mapper> baseMapper)
-    : numLev_(3), numIterPerScale_(3), baseMapper_(*baseMapper)
+    : numLev_(3), numIterPerScale_(3), warmStart_(false), baseMapper_(*baseMapper)
 {
 }
 
@@ -59,9 +59,16 @@ Ptr<Map> MapperPyramid::calculate(InputArray _img1, InputArray image2, Ptr<Map>
     Mat img1 = _img1.getMat();
     Mat img2;
 
+    if(init.empty() && warmStart_ && !lastMap_.empty()) {
+        // Video mode: the previous map is the initial estimation, copied as compose modifies it
+        init = baseMapper_.getMap();
+        init->compose(lastMap_);
+    }
+
     if(!init.empty()) {
         // We have initial values for the registration: we move img2 to that initial reference
-        init->inverseWarp(image2, img2);
+        init->inverseWarp(image2, warped_);
+        img2 = warped_;
     } else {
         init = baseMapper_.getMap();
         img2 = image2.getMat();
@@ -69,19 +76,20 @@ Ptr<Map> MapperPyramid::calculate(InputArray _img1, InputArray image2, Ptr<Map>
 
     cv::Ptr<Map> ident = baseMapper_.getMap();
 
-    // Precalculate pyramid images
-    vector<Mat> pyrIm1(numLev_), pyrIm2(numLev_);
-    pyrIm1[0] = img1;
-    pyrIm2[0] = img2;
+    // Precalculate pyramid images, the buffers of the previous call are reused when the sizes match
+    pyrIm1_.resize(numLev_);
+    pyrIm2_.resize(numLev_);
+    pyrIm1_[0] = img1;
+    pyrIm2_[0] = img2;
     for(int im_i = 1; im_i < numLev_; ++im_i) {
-        pyrDown(pyrIm1[im_i - 1], pyrIm1[im_i]);
-        pyrDown(pyrIm2[im_i - 1], pyrIm2[im_i]);
+        pyrDown(pyrIm1_[im_i - 1], pyrIm1_[im_i]);
+        pyrDown(pyrIm2_[im_i - 1], pyrIm2_[im_i]);
     }
 
     Mat currRef, currImg;
     for(int lv_i = 0; lv_i < numLev_; ++lv_i) {
-        currRef = pyrIm1[numLev_ - 1 - lv_i];
-        currImg = pyrIm2[numLev_ - 1 - lv_i];
+        currRef = pyrIm1_[numLev_ - 1 - lv_i];
+        currImg = pyrIm2_[numLev_ - 1 - lv_i];
         // Scale the transformation as we are incresing the resolution in each iteration
         if(lv_i != 0) {
             ident->scale(2.);
@@ -92,9 +100,24 @@ Ptr<Map> MapperPyramid::calculate(InputArray _img1, InputArray image2, Ptr<Map>
     }
 
     init->compose(ident);
+
+    // The input images are not kept referenced by the buffers
+    pyrIm1_[0].release();
+    pyrIm2_[0].release();
+
+    if(warmStart_) {
+        lastMap_ = baseMapper_.getMap();
+        lastMap_->compose(init);
+    }
     return init;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void MapperPyramid::reset()
+{
+    lastMap_.release();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 cv::Ptr<Map> MapperPyramid::getMap() const
 {
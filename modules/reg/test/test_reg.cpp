@@ -72,6 +72,7 @@ public:
     void testSimilarity();
     void testAffine();
     void testProjective();
+    void testShiftVideo();
 private:
     Mat img1;
 };
@@ -247,6 +248,28 @@ void RegTest::testProjective()
     EXPECT_GE(projNorm, sqrt(3.) - 0.01);
 }
 
+void RegTest::testShiftVideo()
+{
+    // The frames drift slowly, every registration starts from the previous result
+    Ptr<Mapper> mapper = makePtr<MapperGradShift>();
+    MapperPyramid mappPyr(mapper);
+    mappPyr.warmStart_ = true;
+
+    for(int frame_i = 0; frame_i < 3; ++frame_i) {
+        Mat img2;
+        Vec<double, 2> shift(5. + frame_i, 5. - 0.5*frame_i);
+        MapShift mapTest(shift);
+        mapTest.warp(img1, img2);
+
+        Ptr<Map> mapPtr = mappPyr.calculate(img1, img2);
+        Ptr<MapShift> mapShift = MapTypeCaster::toShift(mapPtr);
+
+        Ptr<Map> mapInv(mapShift->inverseMap());
+        mapTest.compose(mapInv);
+        EXPECT_LE(norm(mapTest.getShift()), 0.1);
+    }
+}
+
 void RegTest::loadImage(int dstDataType)
 {
     const string imageName = cvtest::TS::ptr()->get_data_path() + "reg/home.png";
@@ -298,3 +321,9 @@ TEST_F(RegTest, projective_dt64fc1)
     loadImage(CV_64FC1);
     testProjective();
 }
+
+TEST_F(RegTest, shift_video)
+{
+    loadImage();
+    testShiftVideo();
+}
@@ -508,6 +508,13 @@ namespace rgbd
     void
     releasePyramids();
 
+    /** Replaces the frame data and releases the pyramids computed for the previous data.
+     * Unlike release(), the memory of the cloud and Sobel pyramids is kept and reused
+     * when they are computed again, so a frame object can be recycled along a sequence without reallocations.
+     */
+    void
+    reset(const Mat& image, const Mat& depth, const Mat& mask=Mat(), const Mat& normals=Mat(), int ID=-1);
+
     std::vector<Mat> pyramidImage;
     std::vector<Mat> pyramidDepth;
     std::vector<Mat> pyramidMask;
@@ -520,6 +527,11 @@ namespace rgbd
 
     std::vector<Mat> pyramidNormals;
     std::vector<Mat> pyramidNormalsMask;
+
+    /** Buffers kept by reset() for the pyramids of the same names */
+    std::vector<Mat> pyramidCloudPool;
+    std::vector<Mat> pyramid_dI_dxPool;
+    std::vector<Mat> pyramid_dI_dyPool;
   };
 
   /** Base class for computation of odometry.
@@ -593,6 +605,24 @@ namespace rgbd
     bool
     compute(Ptr<OdometryFrame>& srcFrame, Ptr<OdometryFrame>& dstFrame, Mat& Rt, const Mat& initRt = Mat()) const;
 
+    /** Sequential version: computes the transformation from the frame passed to the previous call to the given one.
+     * The cache of the frame is prepared for both roles, so it is reused when the frame becomes the source
+     * of the next call, and the frame objects are recycled (see OdometryFrame::reset) to avoid reallocations.
+     * The method returns false for the first frame of a sequence, Rt is set to identity in that case.
+     * Call clear() to start a new sequence.
+     * @param image Image data of the frame (CV_8UC1)
+     * @param depth Depth data of the frame (CV_32FC1, in meters)
+     * @param mask Mask that sets which pixels have to be used from the frame (CV_8UC1)
+     * @param Rt Resulting transformation from the previous frame to the given one
+     * @param initRt Initial transformation from the previous frame to the given one (optional)
+     */
+    bool
+    compute(const Mat& image, const Mat& depth, const Mat& mask, Mat& Rt, const Mat& initRt = Mat());
+
+    /** Forgets the previous frame of the sequential compute() */
+    virtual void
+    clear();
+
     /** Prepare a cache for the frame. The function checks the precomputed/passed data (throws the error if this data
      * does not satisfy) and computes all remaining cache data needed for the frame. Returned size is a resolution
      * of the prepared frame.
@@ -619,6 +649,9 @@ namespace rgbd
     virtual bool
     computeImpl(const Ptr<OdometryFrame>& srcFrame, const Ptr<OdometryFrame>& dstFrame, Mat& Rt,
                 const Mat& initRt) const = 0;
+
+    Ptr<OdometryFrame> prevFrame;  // source frame of the next sequential compute()
+    Ptr<OdometryFrame> spareFrame; // recycled for the next frame of the sequence
   };
 
   /** Odometry based on the paper "Real-Time Visual Odometry from Dense RGB-D Images",
@@ -1041,6 +1074,7 @@ namespace rgbd
 } /* namespace cv */
 
 #include "opencv2/rgbd/linemod.hpp"
+#include "opencv2/rgbd/tsdf.hpp"
 
 #endif /* __cplusplus */
 #endif
@@ -415,6 +415,28 @@ public:
                    const String& format = "templates_%s.yml.gz");
   CV_WRAP void writeClasses(const String& format = "templates_%s.yml.gz") const;
 
+  /**
+   * \brief Write the templates of a class to a compact binary archive.
+   *
+   * The archive stores the template sizes and the packed features (16-bit coordinates,
+   * 8-bit labels) in native byte order, so it is loaded without any parsing step.
+   */
+  void writeClassBinary(const String& class_id, const String& filename) const;
+
+  /**
+   * \brief Load a class from a binary archive written by writeClassBinary().
+   *
+   * \return The id of the loaded class.
+   */
+  String readClassBinary(const String& filename, const String& class_id_override = "");
+
+  /**
+   * \brief Load a class from a binary archive already in memory, e.g. a memory-mapped file.
+   *
+   * The buffer is not referenced after the call.
+   */
+  String readClassBinary(const uchar* data, size_t size, const String& class_id_override = "");
+
 protected:
   std::vector< Ptr<Modality> > modalities;
   int pyramid_levels;
@@ -0,0 +1,105 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_RGBD_TSDF_HPP__
+#define __OPENCV_RGBD_TSDF_HPP__
+
+#include "opencv2/core.hpp"
+
+namespace cv
+{
+namespace rgbd
+{
+//! @addtogroup rgbd
+//! @{
+
+  struct OdometryFrame;
+
+  /** Truncated signed distance function volume that fuses depth frames over time,
+   * as in "KinectFusion: Real-Time Dense Surface Mapping and Tracking", R. A. Newcombe et al., ISMAR, 2011.
+   *
+   * The volume is a regular grid of voxels, each storing the averaged signed distance to the nearest surface
+   * (truncated to [-1, 1] in units of the truncation distance) and the weight of the average.
+   * Poses are 4x4 CV_64FC1 rigid body motions, cameraPose maps the camera coordinates to the world ones.
+   *
+   * Frame-to-model tracking with ICPOdometry: compute the transformation from the new depth frame
+   * to the model frame fetched at the previous camera pose, then the new camera pose is
+   * previousPose * Rt, and the new frame is integrated at that pose.
+   */
+  class CV_EXPORTS TSDFVolume
+  {
+  public:
+    /** Constructor
+     * @param resolution Number of voxels along each axis of the volume
+     * @param voxelSize Size of a voxel in meters
+     * @param truncDist Truncation distance of the signed distance function in meters,
+     * it should be several times bigger than voxelSize
+     * @param maxWeight Maximal weight of the averaged distances, smaller values adapt faster to scene changes
+     * @param volumePose Pose of the volume corner in the world coordinates, identity if empty
+     */
+    TSDFVolume(const Vec3i& resolution, float voxelSize, float truncDist, int maxWeight = 64,
+               const Mat& volumePose = Mat());
+
+    /** Clears the fused data */
+    void
+    reset();
+
+    /** Fuses a depth frame into the volume.
+     * @param depth Depth of the frame (CV_32FC1 in meters, zero or NaN for missing values)
+     * @param cameraMatrix Camera matrix of the frame
+     * @param cameraPose Pose of the camera in the world coordinates
+     */
+    void
+    integrate(const Mat& depth, const Mat& cameraMatrix, const Mat& cameraPose);
+
+    /** Renders the fused surface by ray casting.
+     * @param cameraMatrix Camera matrix of the virtual camera
+     * @param cameraPose Pose of the virtual camera in the world coordinates
+     * @param frameSize Resolution of the rendered frame
+     * @param points Surface points in the camera coordinates (CV_32FC3), NaN where no surface is seen
+     * @param normals Surface normals in the camera coordinates (CV_32FC3), NaN where no surface is seen
+     */
+    void
+    raycast(const Mat& cameraMatrix, const Mat& cameraPose, Size frameSize,
+            OutputArray points, OutputArray normals) const;
+
+    /** Renders the fused surface as an odometry frame with the depth and the normals set,
+     * so it can be used as the destination frame of ICPOdometry.
+     */
+    Ptr<OdometryFrame>
+    fetchFrame(const Mat& cameraMatrix, const Mat& cameraPose, Size frameSize) const;
+
+    Vec3i
+    getResolution() const
+    {
+      return resolution;
+    }
+    float
+    getVoxelSize() const
+    {
+      return voxelSize;
+    }
+    float
+    getTruncDist() const
+    {
+      return truncDist;
+    }
+
+  private:
+    Vec3i resolution;
+    float voxelSize;
+    float truncDist;
+    int maxWeight;
+    Mat volumePose;
+
+    /** resolution[0] * resolution[1] rows of resolution[2] voxels, each (tsdf, weight) */
+    Mat volume;
+  };
+
+//! @}
+
+} /* namespace rgbd */
+} /* namespace cv */
+
+#endif
@@ -73,6 +73,89 @@ namespace rgbd
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+  /** Bilateral smoothing of the NIL cleaner over rows.
+   *
+   * Every pair of neighboring pixels (p, q), q being the right or one of the three bottom neighbors of p
+   * (p excluding the first and last columns and the last row), contributes to both pixels when their depths
+   * are close enough, with the noise model of the pixel receiving the contribution. Each pixel gathers
+   * the contributions of its pairs so that the rows are independent.
+   */
+  template<typename DepthDepth, typename ContainerDepth>
+  class NILBody: public ParallelLoopBody
+  {
+  public:
+    NILBody(const Mat_<DepthDepth> &depth_in, Mat_<ContainerDepth> &depth_out, ContainerDepth scale)
+        :
+          depth_in_(depth_in),
+          depth_out_(depth_out),
+          scale_(scale)
+    {
+    }
+
+    void
+    operator()(const Range& range) const
+    {
+      const ContainerDepth theta_mean = (float)(30. * CV_PI / 180);
+      const ContainerDepth sigma_L = (float)(0.8 + 0.035 * theta_mean / (CV_PI / 2 - theta_mean));
+      const ContainerDepth difference_threshold = 10;
+      // The lateral part of the weight only depends on the squared pixel distance, 0, 1 or 2
+      ContainerDepth lateral_weight[3];
+      for (int i = 0; i < 3; ++i)
+        lateral_weight[i] = std::exp(-ContainerDepth(i) / 2 / sigma_L / sigma_L);
+
+      // The pairs (p, p + offset) with p a source pixel
+      static const int offsets[5][2] = { {0, 0}, {0, 1}, {1, -1}, {1, 0}, {1, 1} };
+      const int rows = depth_in_.rows, cols = depth_in_.cols;
+
+      for (int y = range.start; y < range.end; ++y)
+      {
+        for (int x = 0; x < cols; ++x)
+        {
+          const DepthDepth d = depth_in_(y, x);
+          const ContainerDepth d_scaled = ContainerDepth(d * scale_ - 0.4);
+          const ContainerDepth sigma_z = (float)(0.0012 + 0.0019 * d_scaled * d_scaled);
+          const ContainerDepth inv_sigma_z_2 = 1 / (2 * sigma_z * sigma_z);
+
+          ContainerDepth w_sum = 0, Dw_sum = 0;
+          for (int k = 0; k < 5; ++k)
+          {
+            const int j = offsets[k][0], i = offsets[k][1];
+            // (y, x) is the first pixel of the pair, then (for the non trivial pairs) the second one
+            for (int side = 0; side < ((k == 0) ? 1 : 2); ++side)
+            {
+              const int sy = (side == 0) ? y : y - j, sx = (side == 0) ? x : x - i;
+              if (sy < 0 || sy > rows - 2 || sx < 1 || sx > cols - 2)
+                continue;
+              const int ny = (side == 0) ? y + j : sy, nx = (side == 0) ? x + i : sx;
+              const DepthDepth dn = depth_in_(ny, nx);
+
+              ContainerDepth delta_z;
+              if (d > dn)
+                delta_z = (float)(d - dn);
+              else
+                delta_z = (float)(dn - d);
+              if (!(delta_z < difference_threshold))
+                continue;
+
+              delta_z *= scale_;
+              ContainerDepth w = lateral_weight[j * j + i * i] * std::exp(-delta_z * delta_z * inv_sigma_z_2);
+              w_sum += w;
+              Dw_sum += dn * w;
+            }
+          }
+          depth_out_(y, x) = (w_sum != 0) ? Dw_sum / w_sum : 0;
+        }
+      }
+    }
+
+  private:
+    const Mat_<DepthDepth> &depth_in_;
+    Mat_<ContainerDepth> &depth_out_;
+    ContainerDepth scale_;
+
+    NILBody& operator=(const NILBody&);
+  };
+
   /** Given a depth image, compute the normals as detailed in the LINEMOD paper
    * ``Gradient Response Maps for Real-Time Detection of Texture-Less Objects``
    * by S. Hinterstoisser, C. Cagniart, S. Ilic, P. Sturm, N. Navab, P. Fua, and V. Lepetit
@@ -138,57 +221,9 @@ namespace rgbd
     void
     computeImpl(const Mat_<DepthDepth> &depth_in, Mat & depth_out, ContainerDepth scale) const
     {
-      const ContainerDepth theta_mean = (float)(30. * CV_PI / 180);
-      int rows = depth_in.rows;
-      int cols = depth_in.cols;
-
-      // Precompute some data
-      const ContainerDepth sigma_L = (float)(0.8 + 0.035 * theta_mean / (CV_PI / 2 - theta_mean));
-      Mat_<ContainerDepth> sigma_z(rows, cols);
-      for (int y = 0; y < rows; ++y)
-        for (int x = 0; x < cols; ++x)
-          sigma_z(y, x) = (float)(0.0012 + 0.0019 * (depth_in(y, x) * scale - 0.4) * (depth_in(y, x) * scale - 0.4));
-
-      ContainerDepth difference_threshold = 10;
-      Mat_<ContainerDepth> Dw_sum = Mat_<ContainerDepth>::zeros(rows, cols), w_sum =
-          Mat_<ContainerDepth>::zeros(rows, cols);
-      for (int y = 0; y < rows - 1; ++y)
-      {
-        // Every pixel has had the contribution of previous pixels (in a row-major way)
-        for (int x = 1; x < cols - 1; ++x)
-        {
-          for (int j = 0; j <= 1; ++j)
-            for (int i = -1; i <= 1; ++i)
-            {
-              if ((j == 0) && (i == -1))
-                continue;
-              ContainerDepth delta_u = sqrt(
-                  ContainerDepth(j) * ContainerDepth(j) + ContainerDepth(i) * ContainerDepth(i));
-              ContainerDepth delta_z;
-              if (depth_in(y, x) > depth_in(y + j, x + i))
-                delta_z = (float)(depth_in(y, x) - depth_in(y + j, x + i));
-              else
-                delta_z = (float)(depth_in(y + j, x + i) - depth_in(y, x));
-              if (delta_z < difference_threshold)
-              {
-                delta_z *= scale;
-                ContainerDepth w = exp(
-                    -delta_u * delta_u / 2 / sigma_L / sigma_L - delta_z * delta_z / 2 / sigma_z(y, x) / sigma_z(y, x));
-                w_sum(y, x) += w;
-                Dw_sum(y, x) += depth_in(y + j, x + i) * w;
-                if ((j != 0) || (i != 0))
-                {
-                  w = exp(
-                      -delta_u * delta_u / 2 / sigma_L / sigma_L - delta_z * delta_z / 2 / sigma_z(y + j, x + i)
-                                                                   / sigma_z(y + j, x + i));
-                  w_sum(y + j, x + i) += w;
-                  Dw_sum(y + j, x + i) += depth_in(y, x) * w;
-                }
-              }
-            }
-        }
-      }
-      Mat(Dw_sum / w_sum).copyTo(depth_out);
+      depth_out.create(depth_in.size(), DataType<ContainerDepth>::type);
+      Mat_<ContainerDepth> depth_out_T = depth_out;
+      parallel_for_(Range(0, depth_in.rows), NILBody<DepthDepth, ContainerDepth>(depth_in, depth_out_T, scale));
     }
   };
 
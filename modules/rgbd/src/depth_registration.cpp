@@ -121,6 +121,196 @@ namespace rgbd
  ///////////////////////////////////////////////////////////////////////////////////
 
 
+    /** Transforms the input depth pixels into the external camera and projects them.
+     * Each input pixel gets its location in the output image, (-1, -1) when it has no depth or
+     * falls outside the image, and its depth converted back to the input units.
+     */
+    template<typename DepthDepth>
+    class RegistrationProjectionBody : public ParallelLoopBody
+    {
+    public:
+        RegistrationProjectionBody(const Mat_<DepthDepth> &unregisteredDepth, const Matx44f &initialProjection,
+                                   bool hasDistortion, const Matx33f &registeredCameraMatrix,
+                                   const Mat_<float> &registeredDistCoeffs, const Size outputImagePlaneSize,
+                                   float inputDepthToMetersScale, Mat_<Point2i> &projectedPixels,
+                                   Mat_<DepthDepth> &cloudDepths)
+            : unregisteredDepth_(unregisteredDepth), initialProjection_(initialProjection),
+              hasDistortion_(hasDistortion), registeredCameraMatrix_(registeredCameraMatrix),
+              registeredDistCoeffs_(registeredDistCoeffs), outputImagePlaneSize_(outputImagePlaneSize),
+              inputDepthToMetersScale_(inputDepthToMetersScale), projectedPixels_(projectedPixels),
+              cloudDepths_(cloudDepths)
+        {
+        }
+
+        void
+        operator()(const Range &range) const
+        {
+            const int cols = unregisteredDepth_.cols;
+            const float metersToInputUnitsScale = 1/inputDepthToMetersScale_;
+            const Rect registeredDepthBounds(Point(), outputImagePlaneSize_);
+            const Matx44f &P = initialProjection_;
+
+            Mat_<Point3f> transformedCloud(1, cols);
+            std::vector<Point2f> transformedAndProjectedPoints(cols);
+
+            for(int j = range.start; j < range.end; ++j)
+            {
+                const DepthDepth *unregisteredDepthPtr = unregisteredDepth_[j];
+                Point3f *point = transformedCloud[0];
+
+                // Apply the initial projection to the input depth
+                for(int i = 0; i < cols; ++i)
+                {
+                    float rescaled_depth = float(unregisteredDepthPtr[i]) * inputDepthToMetersScale_;
+
+                    // If the DepthDepth is of type unsigned short, zero is a sentinel value to indicate
+                    // no depth. CV_32F and CV_64F should already have NaN for no depth values.
+                    if (rescaled_depth == 0)
+                    {
+                        rescaled_depth = std::numeric_limits<float>::quiet_NaN();
+                    }
+
+                    const float x = i * rescaled_depth, y = j * rescaled_depth, z = rescaled_depth;
+                    float w = P(3, 0) * x + P(3, 1) * y + P(3, 2) * z + P(3, 3);
+                    w = (std::abs(w) > FLT_EPSILON) ? 1.f / w : 0.f;
+                    point[i].x = (P(0, 0) * x + P(0, 1) * y + P(0, 2) * z + P(0, 3)) * w;
+                    point[i].y = (P(1, 0) * x + P(1, 1) * y + P(1, 2) * z + P(1, 3)) * w;
+                    point[i].z = (P(2, 0) * x + P(2, 1) * y + P(2, 2) * z + P(2, 3)) * w;
+                }
+
+                if (hasDistortion_)
+                {
+                    // Project an entire row of points with distortion.
+                    projectPoints(transformedCloud, Vec3f(0,0,0), Vec3f(0,0,0), registeredCameraMatrix_,
+                                  registeredDistCoeffs_, transformedAndProjectedPoints);
+                }
+                else
+                {
+                    // With no distortion, we just have to dehomogenize the point since all major transforms
+                    // already happened with initialProjection.
+                    for(int i = 0; i < cols; ++i)
+                    {
+                        transformedAndProjectedPoints[i].x = point[i].x / point[i].z;
+                        transformedAndProjectedPoints[i].y = point[i].y / point[i].z;
+                    }
+                }
+
+                Point2i *projectedPixel = projectedPixels_[j];
+                DepthDepth *cloudDepth = cloudDepths_[j];
+                for(int i = 0; i < cols; ++i)
+                {
+                    projectedPixel[i] = Point2i(-1, -1);
+
+                    // Skip this one if there isn't a valid depth
+                    const Point2f projectedPixelFloatLocation = transformedAndProjectedPoints[i];
+                    if (cvIsNaN(projectedPixelFloatLocation.x))
+                        continue;
+
+                    //Get integer pixel location
+                    const Point2i projectedPixelLocation = projectedPixelFloatLocation;
+
+                    // Ensure that the projected point is actually contained in our output image
+                    if (!registeredDepthBounds.contains(projectedPixelLocation))
+                        continue;
+
+                    projectedPixel[i] = projectedPixelLocation;
+                    // Go back to our original scale, since that's what our output will be
+                    // The templated function is to ensure that integer values are rounded to the nearest integer
+                    cloudDepth[i] = floatToInputDepth<DepthDepth>(point[i].z*metersToInputUnitsScale);
+                }
+            }
+        }
+
+    private:
+        const Mat_<DepthDepth> &unregisteredDepth_;
+        Matx44f initialProjection_;
+        bool hasDistortion_;
+        Matx33f registeredCameraMatrix_;
+        const Mat_<float> &registeredDistCoeffs_;
+        Size outputImagePlaneSize_;
+        float inputDepthToMetersScale_;
+        Mat_<Point2i> &projectedPixels_;
+        Mat_<DepthDepth> &cloudDepths_;
+
+        RegistrationProjectionBody& operator=(const RegistrationProjectionBody&);
+    };
+
+ ///////////////////////////////////////////////////////////////////////////////////
+
+    /** Fills a band of output rows with the closest projected depths.
+     * The points are bucketed by output row, and a point projected in row y can be dilated into row y - 1,
+     * so the band also looks at the points of the row right after it. The result is the minimum of the depths
+     * written to every pixel, hence independent of the order and of the bands.
+     */
+    template<typename DepthDepth>
+    class RegistrationZBufferBody : public ParallelLoopBody
+    {
+    public:
+        RegistrationZBufferBody(const Mat_<Point2i> &projectedPixels, const Mat_<DepthDepth> &cloudDepths,
+                                const std::vector<int> &rowStarts, const std::vector<int> &bucketedPoints,
+                                bool depthDilation, Mat_<DepthDepth> &registeredDepth)
+            : projectedPixels_(projectedPixels), cloudDepths_(cloudDepths), rowStarts_(rowStarts),
+              bucketedPoints_(bucketedPoints), depthDilation_(depthDilation), registeredDepth_(registeredDepth)
+        {
+        }
+
+        void
+        operator()(const Range &range) const
+        {
+            const Point2i *pixels = projectedPixels_[0];
+            const DepthDepth *depths = cloudDepths_[0];
+            const int lastRow = std::min(range.end + (depthDilation_ ? 1 : 0), registeredDepth_.rows);
+
+            for(int k = rowStarts_[range.start]; k < rowStarts_[lastRow]; ++k)
+            {
+                const int index = bucketedPoints_[k];
+                const Point2i &projectedPixelLocation = pixels[index];
+                const DepthDepth cloudDepth = depths[index];
+
+                if (projectedPixelLocation.y < range.end)
+                    updateDepth(projectedPixelLocation.x, projectedPixelLocation.y, cloudDepth);
+
+                // If desired, dilate this point to avoid holes in the final image
+                if (depthDilation_)
+                {
+                    // Choosing to dilate in a 2x2 region, where the original projected location is in the bottom right of this
+                    // region. This is what's done on PrimeSense devices, but a more accurate scheme could be used.
+                    if (projectedPixelLocation.y < range.end && projectedPixelLocation.x > 0)
+                        updateDepth(projectedPixelLocation.x - 1, projectedPixelLocation.y, cloudDepth);
+                    if (projectedPixelLocation.y > range.start)
+                    {
+                        updateDepth(projectedPixelLocation.x, projectedPixelLocation.y - 1, cloudDepth);
+                        if (projectedPixelLocation.x > 0)
+                            updateDepth(projectedPixelLocation.x - 1, projectedPixelLocation.y - 1, cloudDepth);
+                    }
+                }
+            }
+        }
+
+    private:
+        void
+        updateDepth(int x, int y, const DepthDepth &cloudDepth) const
+        {
+            DepthDepth& outputDepth = registeredDepth_(y, x);
+
+            // Occlusion check
+            if ( isEqualToNoDepthSentinelValue<DepthDepth>(outputDepth) || (outputDepth > cloudDepth) )
+                outputDepth = cloudDepth;
+        }
+
+        const Mat_<Point2i> &projectedPixels_;
+        const Mat_<DepthDepth> &cloudDepths_;
+        const std::vector<int> &rowStarts_;
+        const std::vector<int> &bucketedPoints_;
+        bool depthDilation_;
+        Mat_<DepthDepth> &registeredDepth_;
+
+        RegistrationZBufferBody& operator=(const RegistrationZBufferBody&);
+    };
+
+ ///////////////////////////////////////////////////////////////////////////////////
+
+
     /** Computes a registered depth image from an unregistered image.
      *
      * @param unregisteredDepth the input depth data
@@ -182,134 +372,43 @@ namespace rgbd
             initialProjection = initialProjection * rbtRgb2Depth * K.inv();
         }
 
-        // Apply the initial projection to the input depth
-        Mat_<Point3f> transformedCloud;
+        // Project the input depth into the external camera, row by row
+        Mat_<Point2i> projectedPixels(unregisteredDepth.size());
+        Mat_<DepthDepth> cloudDepths(unregisteredDepth.size());
+        parallel_for_(Range(0, unregisteredDepth.rows),
+                      RegistrationProjectionBody<DepthDepth>(unregisteredDepth, initialProjection, hasDistortion,
+                                                             registeredCameraMatrix, registeredDistCoeffs,
+                                                             outputImagePlaneSize, inputDepthToMetersScale,
+                                                             projectedPixels, cloudDepths));
+
+        // Bucket the projected points by output row so that the output can be filled by bands of rows
+        std::vector<int> rowStarts(outputImagePlaneSize.height + 1, 0);
+        for(int j = 0; j < projectedPixels.rows; ++j)
         {
-            Mat_<Point3f> point_tmp(outputImagePlaneSize);
-
-            for(int j = 0; j < point_tmp.rows; ++j)
-            {
-                const DepthDepth *unregisteredDepthPtr = unregisteredDepth[j];
-
-                Point3f *point = point_tmp[j];
-                for(int i = 0; i < point_tmp.cols; ++i, ++unregisteredDepthPtr, ++point)
-                {
-                    float rescaled_depth = float(*unregisteredDepthPtr) * inputDepthToMetersScale;
-
-                    // If the DepthDepth is of type unsigned short, zero is a sentinel value to indicate
-                    // no depth. CV_32F and CV_64F should already have NaN for no depth values.
-                    if (rescaled_depth == 0)
-                    {
-                        rescaled_depth = std::numeric_limits<float>::quiet_NaN();
-                    }
-
-                    point->x = i * rescaled_depth;
-                    point->y = j * rescaled_depth;
-                    point->z = rescaled_depth;
-                }
-            }
-
-            perspectiveTransform(point_tmp, transformedCloud, initialProjection);
+            const Point2i *pixel = projectedPixels[j];
+            for(int i = 0; i < projectedPixels.cols; ++i)
+                if (pixel[i].y >= 0)
+                    ++rowStarts[pixel[i].y + 1];
         }
+        for(int y = 0; y < outputImagePlaneSize.height; ++y)
+            rowStarts[y + 1] += rowStarts[y];
 
-        std::vector<Point2f> transformedAndProjectedPoints(transformedCloud.cols);
-        const float metersToInputUnitsScale = 1/inputDepthToMetersScale;
-        const Rect registeredDepthBounds(Point(), outputImagePlaneSize);
-
-        for( int y = 0; y < transformedCloud.rows; y++ )
+        std::vector<int> bucketedPoints(rowStarts.back());
         {
-            if (hasDistortion)
+            std::vector<int> rowFill(rowStarts.begin(), rowStarts.end() - 1);
+            for(int j = 0; j < projectedPixels.rows; ++j)
             {
-
-                // Project an entire row of points with distortion.
-                // Doing this for the entire image at once would require more memory.
-                projectPoints(transformedCloud.row(y),
-                              Vec3f(0,0,0),
-                              Vec3f(0,0,0),
-                              registeredCameraMatrix,
-                              registeredDistCoeffs,
-                              transformedAndProjectedPoints);
-
+                const Point2i *pixel = projectedPixels[j];
+                for(int i = 0; i < projectedPixels.cols; ++i)
+                    if (pixel[i].y >= 0)
+                        bucketedPoints[rowFill[pixel[i].y]++] = j * projectedPixels.cols + i;
             }
-            else
-            {
-
-                // With no distortion, we just have to dehomogenize the point since all major transforms
-                // already happened with initialProjection.
-                Point2f *point2d = &transformedAndProjectedPoints[0];
-                const Point2f *point2d_end = point2d + transformedAndProjectedPoints.size();
-                const Point3f *point3d = transformedCloud[y];
-                for( ; point2d < point2d_end; ++point2d, ++point3d )
-                {
-                    point2d->x = point3d->x / point3d->z;
-                    point2d->y = point3d->y / point3d->z;
-                }
-
-            }
-
-            const Point2f *outputProjectedPoint = &transformedAndProjectedPoints[0];
-            const Point3f *p = transformedCloud[y], *p_end = p + transformedCloud.cols;
-
-
-            for( ; p < p_end; ++outputProjectedPoint, ++p )
-            {
-
-
-
-                // Skip this one if there isn't a valid depth
-                const Point2f projectedPixelFloatLocation = *outputProjectedPoint;
-                if (cvIsNaN(projectedPixelFloatLocation.x))
-                    continue;
-
-                //Get integer pixel location
-                const Point2i projectedPixelLocation = projectedPixelFloatLocation;
-
-                // Ensure that the projected point is actually contained in our output image
-                if (!registeredDepthBounds.contains(projectedPixelLocation))
-                    continue;
-
-                // Go back to our original scale, since that's what our output will be
-                // The templated function is to ensure that integer values are rounded to the nearest integer
-                const DepthDepth cloudDepth = floatToInputDepth<DepthDepth>(p->z*metersToInputUnitsScale);
-
-                DepthDepth& outputDepth = registeredDepth.at<DepthDepth>(projectedPixelLocation.y, projectedPixelLocation.x);
-
-
-                // Occlusion check
-                if ( isEqualToNoDepthSentinelValue<DepthDepth>(outputDepth) || (outputDepth > cloudDepth) )
-                    outputDepth = cloudDepth;
-
-
-                // If desired, dilate this point to avoid holes in the final image
-                if (depthDilation)
-                {
-
-                    // Choosing to dilate in a 2x2 region, where the original projected location is in the bottom right of this
-                    // region. This is what's done on PrimeSense devices, but a more accurate scheme could be used.
-                    const Point2i dilatedProjectedLocations[3] = {Point2i(projectedPixelLocation.x - 1, projectedPixelLocation.y    ),
-                                                                  Point2i(projectedPixelLocation.x    , projectedPixelLocation.y - 1),
-                                                                  Point2i(projectedPixelLocation.x - 1, projectedPixelLocation.y - 1)};
-
-                    for (int i = 0; i < 3; i++) {
-
-                        const Point2i& dilatedCoordinates = dilatedProjectedLocations[i];
-
-                        if (!registeredDepthBounds.contains(dilatedCoordinates))
-                            continue;
-
-                        DepthDepth& outputDilatedDepth = registeredDepth.at<DepthDepth>(dilatedCoordinates.y, dilatedCoordinates.x);
-
-                        // Occlusion check
-                        if ( isEqualToNoDepthSentinelValue(outputDilatedDepth) || (outputDilatedDepth > cloudDepth) )
-                            outputDilatedDepth = cloudDepth;
-
-                    }
-
-                } // depthDilation
-
-            } // iterate cols
-        } // iterate rows
+        }
 
+        Mat_<DepthDepth> registeredDepth_T = registeredDepth;
+        parallel_for_(Range(0, outputImagePlaneSize.height),
+                      RegistrationZBufferBody<DepthDepth>(projectedPixels, cloudDepths, rowStarts, bucketedPoints,
+                                                          depthDilation, registeredDepth_T));
     }
 
 
@@ -33,7 +33,8 @@
  *
  */
 
-#include <opencv2/rgbd.hpp>
+#include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include "depth_to_3d.h"
 #include "utils.h"
@@ -125,6 +126,76 @@ namespace rgbd
     points3d = points3d.reshape(3, 1);
   }
 
+  /** Vectorized part of a row of depthTo3dNoMask, returns the number of processed pixels
+   */
+  template<typename T>
+  inline int
+  depthTo3dRowSIMD(const T*, const T*, T, T*, int)
+  {
+    return 0;
+  }
+
+#if CV_SIMD128
+  template<>
+  inline int
+  depthTo3dRowSIMD<float>(const float* x_cache, const float* depth, float y_cache, float* points, int cols)
+  {
+    const v_float32x4 vy = v_setall_f32(y_cache);
+    int x = 0;
+    for (; x <= cols - 4; x += 4)
+    {
+      v_float32x4 z = v_load(depth + x);
+      v_store_interleave(points + 3 * x, v_load(x_cache + x) * z, vy * z, z);
+    }
+    return x;
+  }
+#endif
+
+  /** Back-projects the rows of a depth image, the x and y factors being cached per column and per row
+   */
+  template<typename T>
+  class DepthTo3dNoMaskBody: public ParallelLoopBody
+  {
+  public:
+    DepthTo3dNoMaskBody(const cv::Mat_<T>& z_mat, const cv::Mat_<T>& x_cache, const cv::Mat_<T>& y_cache,
+                        cv::Mat& points3d)
+        :
+          z_mat_(z_mat),
+          x_cache_(x_cache),
+          y_cache_(y_cache),
+          points3d_(points3d)
+    {
+    }
+
+    void
+    operator()(const Range& range) const
+    {
+      const T* x_cache = x_cache_[0];
+      for (int y = range.start; y < range.end; ++y)
+      {
+        const T y_factor = y_cache_(y, 0);
+        const T* depth = z_mat_[y];
+        cv::Vec<T, 3>* point = points3d_.ptr<cv::Vec<T, 3> >(y);
+        int x = depthTo3dRowSIMD<T>(x_cache, depth, y_factor, point->val, z_mat_.cols);
+        for (; x < z_mat_.cols; ++x)
+        {
+          T z = depth[x];
+          point[x][0] = x_cache[x] * z;
+          point[x][1] = y_factor * z;
+          point[x][2] = z;
+        }
+      }
+    }
+
+  private:
+    const cv::Mat_<T>& z_mat_;
+    const cv::Mat_<T>& x_cache_;
+    const cv::Mat_<T>& y_cache_;
+    cv::Mat& points3d_;
+
+    DepthTo3dNoMaskBody& operator=(const DepthTo3dNoMaskBody&);
+  };
+
   /**
    * @param K
    * @param depth the depth image
@@ -154,20 +225,7 @@ namespace rgbd
     for (int y = 0; y < in_depth.rows; ++y, ++y_cache_ptr)
       *y_cache_ptr = (y - oy) * inv_fy;
 
-    y_cache_ptr = y_cache[0];
-    for (int y = 0; y < in_depth.rows; ++y, ++y_cache_ptr)
-    {
-      cv::Vec<T, 3>* point = points3d.ptr<cv::Vec<T, 3> >(y);
-      const T* x_cache_ptr_end = x_cache[0] + in_depth.cols;
-      const T* depth = z_mat[y];
-      for (x_cache_ptr = x_cache[0]; x_cache_ptr != x_cache_ptr_end; ++x_cache_ptr, ++point, ++depth)
-      {
-        T z = *depth;
-        (*point)[0] = (*x_cache_ptr) * z;
-        (*point)[1] = (*y_cache_ptr) * z;
-        (*point)[2] = z;
-      }
-    }
+    parallel_for_(Range(0, in_depth.rows), DepthTo3dNoMaskBody<T>(z_mat, x_cache, y_cache, points3d));
   }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -197,7 +255,7 @@ namespace rgbd
 
     if (depth.depth() == CV_16U)
       convertDepthToFloat<ushort>(depth, 1.0f / 1000.0f, points_float, z_mat);
-    else if (depth.depth() == CV_16U)
+    else if (depth.depth() == CV_16S)
       convertDepthToFloat<short>(depth, 1.0f / 1000.0f, points_float, z_mat);
     else
     {
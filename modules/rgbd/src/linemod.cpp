@@ -41,6 +41,7 @@
 //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -248,159 +249,157 @@ void colormap(const Mat& quantized, Mat& dst)
 *                             Color gradient modality                                    *
 \****************************************************************************************/
 
-// Forward declaration
-void hysteresisGradient(Mat& magnitude, Mat& angle,
-                        Mat& ap_tmp, float threshold);
+// tan(11.25), tan(33.75), tan(56.25) and tan(78.75) degrees, the borders of the orientation buckets
+static const float ORIENTATION_TAN[4] = { 0.19891237f, 0.66817864f, 1.49660576f, 5.02733949f };
 
 /**
- * \brief Compute quantized orientation image from color image.
- *
- * Implements section 2.2 "Computing the Gradient Orientations."
+ * \brief Quantize a gradient orientation into 8 labels.
  *
- * \param[in]  src       The source 8-bit, 3-channel image.
- * \param[out] magnitude Destination floating-point array of squared magnitudes.
- * \param[out] angle     Destination 8-bit array of orientations. Each bit
- *                       represents one bin of the orientation space.
- * \param      threshold Magnitude threshold. Keep only gradients whose norms are
- *                       larger than this.
+ * The 360 degree range is split into 16 buckets, [0, 11.25) and [348.75, 360) both giving label 0,
+ * which are then folded modulo 180 degrees. The bucket is found by comparing |dy| with |dx| times
+ * the tangents of the bucket borders, so no angle needs to be computed.
  */
-static void quantizedOrientations(const Mat& src, Mat& magnitude,
-                           Mat& angle, float threshold)
+static inline int quantizeOrientation(int dx, int dy)
 {
-  magnitude.create(src.size(), CV_32F);
-
-  // Allocate temporary buffers
-  Size size = src.size();
-  Mat sobel_3dx; // per-channel horizontal derivative
-  Mat sobel_3dy; // per-channel vertical derivative
-  Mat sobel_dx(size, CV_32F);      // maximum horizontal derivative
-  Mat sobel_dy(size, CV_32F);      // maximum vertical derivative
-  Mat sobel_ag;  // final gradient orientation (unquantized)
-  Mat smoothed;
-
-  // Compute horizontal and vertical image derivatives on all color channels separately
-  static const int KERNEL_SIZE = 7;
-  // For some reason cvSmooth/cv::GaussianBlur, cvSobel/cv::Sobel have different defaults for border handling...
-  GaussianBlur(src, smoothed, Size(KERNEL_SIZE, KERNEL_SIZE), 0, 0, BORDER_REPLICATE);
-  Sobel(smoothed, sobel_3dx, CV_16S, 1, 0, 3, 1.0, 0.0, BORDER_REPLICATE);
-  Sobel(smoothed, sobel_3dy, CV_16S, 0, 1, 3, 1.0, 0.0, BORDER_REPLICATE);
+  float ax = (float)std::abs(dx), ay = (float)std::abs(dy);
+  int bucket = (ay > ax * ORIENTATION_TAN[0]) + (ay > ax * ORIENTATION_TAN[1]) +
+               (ay > ax * ORIENTATION_TAN[2]) + (ay > ax * ORIENTATION_TAN[3]);
+  return (dx ^ dy) < 0 ? (8 - bucket) & 7 : bucket;
+}
 
-  short * ptrx  = (short *)sobel_3dx.data;
-  short * ptry  = (short *)sobel_3dy.data;
-  float * ptr0x = (float *)sobel_dx.data;
-  float * ptr0y = (float *)sobel_dy.data;
-  float * ptrmg = (float *)magnitude.data;
+#if CV_SIMD128
+static inline v_int32x4 v_quantizeOrientation(const v_int32x4& dx, const v_int32x4& dy)
+{
+  const v_int32x4 zero = v_setzero_s32();
+  v_float32x4 ax = v_cvt_f32(v_max(dx, zero - dx));
+  v_float32x4 ay = v_cvt_f32(v_max(dy, zero - dy));
+  // comparison masks are -1 where true
+  v_int32x4 bucket = zero - (v_reinterpret_as_s32(ay > ax * v_setall_f32(ORIENTATION_TAN[0])) +
+                             v_reinterpret_as_s32(ay > ax * v_setall_f32(ORIENTATION_TAN[1])) +
+                             v_reinterpret_as_s32(ay > ax * v_setall_f32(ORIENTATION_TAN[2])) +
+                             v_reinterpret_as_s32(ay > ax * v_setall_f32(ORIENTATION_TAN[3])));
+  v_int32x4 flipped = (v_setall_s32(8) - bucket) & v_setall_s32(7);
+  return v_select((dx ^ dy) < zero, flipped, bucket);
+}
 
-  const int length1 = static_cast<const int>(sobel_3dx.step1());
-  const int length2 = static_cast<const int>(sobel_3dy.step1());
-  const int length3 = static_cast<const int>(sobel_dx.step1());
-  const int length4 = static_cast<const int>(sobel_dy.step1());
-  const int length5 = static_cast<const int>(magnitude.step1());
-  const int length0 = sobel_3dy.cols * 3;
+static inline void v_selectStrongest(const v_int32x4* mag, const v_int32x4* dx, const v_int32x4* dy,
+                                     v_int32x4& best_mag, v_int32x4& best_dx, v_int32x4& best_dy)
+{
+  v_int32x4 sel0 = (mag[0] >= mag[1]) & (mag[0] >= mag[2]);
+  v_int32x4 sel1 = (mag[1] >= mag[0]) & (mag[1] >= mag[2]);
+  best_mag = v_select(sel0, mag[0], v_select(sel1, mag[1], mag[2]));
+  best_dx = v_select(sel0, dx[0], v_select(sel1, dx[1], dx[2]));
+  best_dy = v_select(sel0, dy[0], v_select(sel1, dy[1], dy[2]));
+}
+#endif
 
-  for (int r = 0; r < sobel_3dy.rows; ++r)
+/**
+ * \brief Keep the gradient of the color channel whose magnitude is largest and quantize its
+ * orientation, for one row of 3-channel derivatives.
+ *
+ * \param[in]  dx        Horizontal derivatives of the three channels, interleaved.
+ * \param[in]  dy        Vertical derivatives of the three channels, interleaved.
+ * \param      width     Number of pixels.
+ * \param[out] magnitude Squared magnitudes of the kept gradients.
+ * \param[out] quantized Orientation labels in [0, 8) of the kept gradients.
+ */
+static void quantizeGradientRow(const short* dx, const short* dy, int width,
+                                float* magnitude, uchar* quantized)
+{
+  int c = 0;
+#if CV_SIMD128
+  for ( ; c <= width - 8; c += 8)
   {
-    int ind = 0;
+    v_uint16x8 ux[3], uy[3];
+    v_load_deinterleave((const ushort*)dx + 3 * c, ux[0], ux[1], ux[2]);
+    v_load_deinterleave((const ushort*)dy + 3 * c, uy[0], uy[1], uy[2]);
 
-    for (int i = 0; i < length0; i += 3)
+    v_int32x4 mag_lo[3], mag_hi[3], dx_lo[3], dx_hi[3], dy_lo[3], dy_hi[3];
+    for (int k = 0; k < 3; ++k)
     {
-      // Use the gradient orientation of the channel whose magnitude is largest
-      int mag1 = ptrx[i+0] * ptrx[i + 0] + ptry[i + 0] * ptry[i + 0];
-      int mag2 = ptrx[i+1] * ptrx[i + 1] + ptry[i + 1] * ptry[i + 1];
-      int mag3 = ptrx[i+2] * ptrx[i + 2] + ptry[i + 2] * ptry[i + 2];
-
-      if (mag1 >= mag2 && mag1 >= mag3)
-      {
-        ptr0x[ind] = ptrx[i];
-        ptr0y[ind] = ptry[i];
-        ptrmg[ind] = (float)mag1;
-      }
-      else if (mag2 >= mag1 && mag2 >= mag3)
-      {
-        ptr0x[ind] = ptrx[i + 1];
-        ptr0y[ind] = ptry[i + 1];
-        ptrmg[ind] = (float)mag2;
-      }
-      else
-      {
-        ptr0x[ind] = ptrx[i + 2];
-        ptr0y[ind] = ptry[i + 2];
-        ptrmg[ind] = (float)mag3;
-      }
-      ++ind;
+      v_int16x8 x = v_reinterpret_as_s16(ux[k]), y = v_reinterpret_as_s16(uy[k]);
+      v_int16x8 xy_lo, xy_hi;
+      v_zip(x, y, xy_lo, xy_hi);
+      mag_lo[k] = v_dotprod(xy_lo, xy_lo);
+      mag_hi[k] = v_dotprod(xy_hi, xy_hi);
+      v_expand(x, dx_lo[k], dx_hi[k]);
+      v_expand(y, dy_lo[k], dy_hi[k]);
     }
-    ptrx += length1;
-    ptry += length2;
-    ptr0x += length3;
-    ptr0y += length4;
-    ptrmg += length5;
-  }
 
-  // Calculate the final gradient orientations
-  phase(sobel_dx, sobel_dy, sobel_ag, true);
-  hysteresisGradient(magnitude, angle, sobel_ag, threshold * threshold);
+    v_int32x4 m_lo, m_hi, x_lo, x_hi, y_lo, y_hi;
+    v_selectStrongest(mag_lo, dx_lo, dy_lo, m_lo, x_lo, y_lo);
+    v_selectStrongest(mag_hi, dx_hi, dy_hi, m_hi, x_hi, y_hi);
+    v_store(magnitude + c, v_cvt_f32(m_lo));
+    v_store(magnitude + c + 4, v_cvt_f32(m_hi));
+    v_pack_u_store(quantized + c, v_pack(v_quantizeOrientation(x_lo, y_lo),
+                                         v_quantizeOrientation(x_hi, y_hi)));
+  }
+#endif
+  for ( ; c < width; ++c)
+  {
+    const short* x = dx + 3 * c;
+    const short* y = dy + 3 * c;
+    int mag1 = x[0] * x[0] + y[0] * y[0];
+    int mag2 = x[1] * x[1] + y[1] * y[1];
+    int mag3 = x[2] * x[2] + y[2] * y[2];
+
+    int k = 2;
+    if (mag1 >= mag2 && mag1 >= mag3)
+      k = 0;
+    else if (mag2 >= mag1 && mag2 >= mag3)
+      k = 1;
+    magnitude[c] = (float)(x[k] * x[k] + y[k] * y[k]);
+    quantized[c] = (uchar)quantizeOrientation(x[k], y[k]);
+  }
 }
 
-void hysteresisGradient(Mat& magnitude, Mat& quantized_angle,
-                        Mat& angle, float threshold)
+/**
+ * \brief Filter the raw quantized orientations. Only accept pixels where the magnitude is above
+ * some threshold, and there is local agreement on the quantization.
+ *
+ * \param[in]  magnitude            Squared gradient magnitudes.
+ * \param[out] quantized_angle      Destination 8-bit array of orientations, one bit per label.
+ * \param[in]  quantized_unfiltered Orientation labels in [0, 8). Its border is zeroed.
+ * \param      threshold            Squared magnitude threshold.
+ */
+static void hysteresisGradient(const Mat& magnitude, Mat& quantized_angle,
+                               Mat& quantized_unfiltered, float threshold)
 {
-  // Quantize 360 degree range of orientations into 16 buckets
-  // Note that [0, 11.25), [348.75, 360) both get mapped in the end to label 0,
-  // for stability of horizontal and vertical features.
-  Mat_<unsigned char> quantized_unfiltered;
-  angle.convertTo(quantized_unfiltered, CV_8U, 16.0 / 360.0);
-
   // Zero out top and bottom rows
   /// @todo is this necessary, or even correct?
-  memset(quantized_unfiltered.ptr(), 0, quantized_unfiltered.cols);
-  memset(quantized_unfiltered.ptr(quantized_unfiltered.rows - 1), 0, quantized_unfiltered.cols);
+  int rows = quantized_unfiltered.rows, cols = quantized_unfiltered.cols;
+  memset(quantized_unfiltered.ptr(), 0, cols);
+  memset(quantized_unfiltered.ptr(rows - 1), 0, cols);
   // Zero out first and last columns
-  for (int r = 0; r < quantized_unfiltered.rows; ++r)
+  for (int r = 0; r < rows; ++r)
   {
-    quantized_unfiltered(r, 0) = 0;
-    quantized_unfiltered(r, quantized_unfiltered.cols - 1) = 0;
+    quantized_unfiltered.at<uchar>(r, 0) = 0;
+    quantized_unfiltered.at<uchar>(r, cols - 1) = 0;
   }
 
-  // Mask 16 buckets into 8 quantized orientations
-  for (int r = 1; r < angle.rows - 1; ++r)
+  const size_t step = quantized_unfiltered.step1();
+  quantized_angle = Mat::zeros(quantized_unfiltered.size(), CV_8U);
+  for (int r = 1; r < rows - 1; ++r)
   {
-    uchar* quant_r = quantized_unfiltered.ptr<uchar>(r);
-    for (int c = 1; c < angle.cols - 1; ++c)
-    {
-      quant_r[c] &= 7;
-    }
-  }
+    const float* mag_r = magnitude.ptr<float>(r);
+    uchar* angle_r = quantized_angle.ptr<uchar>(r);
 
-  // Filter the raw quantized image. Only accept pixels where the magnitude is above some
-  // threshold, and there is local agreement on the quantization.
-  quantized_angle = Mat::zeros(angle.size(), CV_8U);
-  for (int r = 1; r < angle.rows - 1; ++r)
-  {
-    float* mag_r = magnitude.ptr<float>(r);
-
-    for (int c = 1; c < angle.cols - 1; ++c)
+    for (int c = 1; c < cols - 1; ++c)
     {
       if (mag_r[c] > threshold)
       {
-  // Compute histogram of quantized bins in 3x3 patch around pixel
+        // Compute histogram of quantized bins in 3x3 patch around pixel
         int histogram[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 
-        uchar* patch3x3_row = &quantized_unfiltered(r-1, c-1);
-        histogram[patch3x3_row[0]]++;
-        histogram[patch3x3_row[1]]++;
-        histogram[patch3x3_row[2]]++;
-
-  patch3x3_row += quantized_unfiltered.step1();
-        histogram[patch3x3_row[0]]++;
-        histogram[patch3x3_row[1]]++;
-        histogram[patch3x3_row[2]]++;
-
-  patch3x3_row += quantized_unfiltered.step1();
-        histogram[patch3x3_row[0]]++;
-        histogram[patch3x3_row[1]]++;
-        histogram[patch3x3_row[2]]++;
+        const uchar* patch3x3_row = quantized_unfiltered.ptr<uchar>(r - 1) + c - 1;
+        for (int i = 0; i < 3; ++i, patch3x3_row += step)
+        {
+          histogram[patch3x3_row[0]]++;
+          histogram[patch3x3_row[1]]++;
+          histogram[patch3x3_row[2]]++;
+        }
 
-  // Find bin with the most votes from the patch
+        // Find bin with the most votes from the patch
         int max_votes = 0;
         int index = -1;
         for (int i = 0; i < 8; ++i)
@@ -412,15 +411,54 @@ void hysteresisGradient(Mat& magnitude, Mat& quantized_angle,
           }
         }
 
-  // Only accept the quantization if majority of pixels in the patch agree
-  static const int NEIGHBOR_THRESHOLD = 5;
+        // Only accept the quantization if majority of pixels in the patch agree
+        static const int NEIGHBOR_THRESHOLD = 5;
         if (max_votes >= NEIGHBOR_THRESHOLD)
-          quantized_angle.at<uchar>(r, c) = uchar(1 << index);
+          angle_r[c] = uchar(1 << index);
       }
     }
   }
 }
 
+/**
+ * \brief Compute quantized orientation image from color image.
+ *
+ * Implements section 2.2 "Computing the Gradient Orientations."
+ *
+ * \param[in]  src       The source 8-bit, 3-channel image.
+ * \param[out] magnitude Destination floating-point array of squared magnitudes.
+ * \param[out] angle     Destination 8-bit array of orientations. Each bit
+ *                       represents one bin of the orientation space.
+ * \param      threshold Magnitude threshold. Keep only gradients whose norms are
+ *                       larger than this.
+ */
+static void quantizedOrientations(const Mat& src, Mat& magnitude,
+                           Mat& angle, float threshold)
+{
+  magnitude.create(src.size(), CV_32F);
+
+  // Compute horizontal and vertical image derivatives on all color channels separately
+  static const int KERNEL_SIZE = 7;
+  Mat smoothed;
+  Mat sobel_3dx; // per-channel horizontal derivative
+  Mat sobel_3dy; // per-channel vertical derivative
+  // For some reason cvSmooth/cv::GaussianBlur, cvSobel/cv::Sobel have different defaults for border handling...
+  GaussianBlur(src, smoothed, Size(KERNEL_SIZE, KERNEL_SIZE), 0, 0, BORDER_REPLICATE);
+  Sobel(smoothed, sobel_3dx, CV_16S, 1, 0, 3, 1.0, 0.0, BORDER_REPLICATE);
+  Sobel(smoothed, sobel_3dy, CV_16S, 0, 1, 3, 1.0, 0.0, BORDER_REPLICATE);
+
+  // Use the gradient of the channel whose magnitude is largest and quantize its orientation
+  // in the same pass
+  Mat quantized_unfiltered(src.size(), CV_8U);
+  for (int r = 0; r < src.rows; ++r)
+  {
+    quantizeGradientRow(sobel_3dx.ptr<short>(r), sobel_3dy.ptr<short>(r), src.cols,
+                        magnitude.ptr<float>(r), quantized_unfiltered.ptr<uchar>(r));
+  }
+
+  hysteresisGradient(magnitude, angle, quantized_unfiltered, threshold * threshold);
+}
+
 class ColorGradientPyramid : public QuantizedPyramid
 {
 public:
@@ -601,19 +639,95 @@ void ColorGradient::write(FileStorage& fs) const
 // Contains GRANULARITY and NORMAL_LUT
 #include "normal_lut.i"
 
-static void accumBilateral(long delta, long i, long j, long * A, long * b, int threshold)
+/// Half size of the neighbourhood used to estimate the normals (used to be 7)
+static const int NORMAL_RADIUS = 5;
+/// @todo Magic number 1150 is focal length? This is something like
+/// f in SXGA mode, but in VGA is more like 530.
+static const float NORMAL_FOCAL = 1150.f;
+
+/**
+ * \brief Look up the quantized direction of an unnormalized normal.
+ */
+static inline uchar normalLabel(float nx, float ny, float nz)
+{
+  float l_sqrt = std::sqrt(nx * nx + ny * ny + nz * nz);
+  if (!(l_sqrt > 0))
+    return 0; // Discard shadows from depth sensor
+
+  const float l_offsetx = GRANULARITY / 2;
+  const float l_offsety = GRANULARITY / 2;
+  float l_norminv = 1.0f / l_sqrt;
+  int l_val1 = std::min(static_cast<int>(nx * l_norminv * l_offsetx + l_offsetx), GRANULARITY - 1);
+  int l_val2 = std::min(static_cast<int>(ny * l_norminv * l_offsety + l_offsety), GRANULARITY - 1);
+  int l_val3 = std::min(static_cast<int>(nz * l_norminv * GRANULARITY + GRANULARITY), GRANULARITY - 1);
+  return NORMAL_LUT[l_val3][l_val2][l_val1];
+}
+
+/**
+ * \brief Estimate the normal at one pixel by a least squares fit of a plane to the 8 neighbours
+ * at distance NORMAL_RADIUS, ignoring those whose depth difference is above difference_threshold.
+ *
+ * The neighbours lie at (i, j) with i, j in {-r, 0, r}, so the normal equations only depend on
+ * the number of accepted neighbours and on sums of their signed depth differences.
+ */
+static inline uchar quantizeNormal(const ushort* p, const int* offsets, int difference_threshold)
 {
-  long f = std::abs(delta) < threshold ? 1 : 0;
+  int d = p[0];
+  int delta[8];
+  int valid[8];
+  for (int k = 0; k < 8; ++k)
+  {
+    delta[k] = p[offsets[k]] - d;
+    valid[k] = std::abs(delta[k]) < difference_threshold;
+    delta[k] *= valid[k];
+  }
+
+  int ci = valid[0] + valid[2] + valid[3] + valid[4] + valid[5] + valid[7];
+  int cj = valid[0] + valid[1] + valid[2] + valid[5] + valid[6] + valid[7];
+  int s = valid[0] - valid[2] - valid[5] + valid[7];
+  int sx = delta[2] + delta[4] + delta[7] - delta[0] - delta[3] - delta[5];
+  int sy = delta[5] + delta[6] + delta[7] - delta[0] - delta[1] - delta[2];
 
-  const long fi = f * i;
-  const long fj = f * j;
+  float det = (float)(ci * cj - s * s);
+  float ddx = (float)cj * sx - (float)s * sy;
+  float ddy = (float)ci * sy - (float)s * sx;
+  return normalLabel(NORMAL_FOCAL * ddx, NORMAL_FOCAL * ddy, -NORMAL_RADIUS * det * d);
+}
+
+#if CV_SIMD128
+/**
+ * \brief Vectorized quantizeNormal() for 4 pixels, storing the unnormalized normals.
+ */
+static inline void v_estimateNormals(const v_int32x4& d, const v_int32x4* neighbours,
+                                     int difference_threshold, float* nx, float* ny, float* nz)
+{
+  const v_int32x4 zero = v_setzero_s32();
+  const v_int32x4 threshold = v_setall_s32(difference_threshold);
+  v_int32x4 delta[8], valid[8];
+  for (int k = 0; k < 8; ++k)
+  {
+    delta[k] = neighbours[k] - d;
+    // masks are -1 for accepted neighbours
+    valid[k] = v_max(delta[k], zero - delta[k]) < threshold;
+    delta[k] &= valid[k];
+  }
 
-  A[0] += fi * i;
-  A[1] += fi * j;
-  A[3] += fj * j;
-  b[0]  += fi * delta;
-  b[1]  += fj * delta;
+  v_int32x4 ci = zero - (valid[0] + valid[2] + valid[3] + valid[4] + valid[5] + valid[7]);
+  v_int32x4 cj = zero - (valid[0] + valid[1] + valid[2] + valid[5] + valid[6] + valid[7]);
+  v_int32x4 s = valid[2] + valid[5] - valid[0] - valid[7];
+  v_int32x4 sx = delta[2] + delta[4] + delta[7] - delta[0] - delta[3] - delta[5];
+  v_int32x4 sy = delta[5] + delta[6] + delta[7] - delta[0] - delta[1] - delta[2];
+
+  // all products are small integers, exact in single precision
+  v_float32x4 fci = v_cvt_f32(ci), fcj = v_cvt_f32(cj), fs = v_cvt_f32(s);
+  v_float32x4 fsx = v_cvt_f32(sx), fsy = v_cvt_f32(sy);
+  v_float32x4 det = fci * fcj - fs * fs;
+  v_float32x4 focal = v_setall_f32(NORMAL_FOCAL);
+  v_store(nx, (fcj * fsx - fs * fsy) * focal);
+  v_store(ny, (fci * fsy - fs * fsx) * focal);
+  v_store(nz, det * v_cvt_f32(d) * v_setall_f32(-(float)NORMAL_RADIUS));
 }
+#endif
 
 /**
  * \brief Compute quantized normal image from depth image.
@@ -634,88 +748,58 @@ static void quantizedNormals(const Mat& src, Mat& dst, int distance_threshold,
 {
   dst = Mat::zeros(src.size(), CV_8U);
 
-  const unsigned short * lp_depth   = src.ptr<ushort>();
-  unsigned char  * lp_normals = dst.ptr<uchar>();
-
   const int l_W = src.cols;
   const int l_H = src.rows;
+  const int l_S = static_cast<int>(src.step1());
 
-  const int l_r = 5; // used to be 7
-  const int l_offset0 = -l_r - l_r * l_W;
-  const int l_offset1 =    0 - l_r * l_W;
-  const int l_offset2 = +l_r - l_r * l_W;
-  const int l_offset3 = -l_r;
-  const int l_offset4 = +l_r;
-  const int l_offset5 = -l_r + l_r * l_W;
-  const int l_offset6 =    0 + l_r * l_W;
-  const int l_offset7 = +l_r + l_r * l_W;
-
-  const int l_offsetx = GRANULARITY / 2;
-  const int l_offsety = GRANULARITY / 2;
+  const int l_r = NORMAL_RADIUS;
+  const int offsets[8] = { -l_r - l_r * l_S,    0 - l_r * l_S, +l_r - l_r * l_S,
+                           -l_r,                               +l_r,
+                           -l_r + l_r * l_S,    0 + l_r * l_S, +l_r + l_r * l_S };
 
   for (int l_y = l_r; l_y < l_H - l_r - 1; ++l_y)
   {
-    const unsigned short * lp_line = lp_depth + (l_y * l_W + l_r);
-    unsigned char * lp_norm = lp_normals + (l_y * l_W + l_r);
-
-    for (int l_x = l_r; l_x < l_W - l_r - 1; ++l_x)
+    const ushort * lp_line = src.ptr<ushort>(l_y);
+    uchar * lp_norm = dst.ptr<uchar>(l_y);
+    int l_x = l_r;
+
+#if CV_SIMD128
+    CV_DECL_ALIGNED(16) float nx[8], ny[8], nz[8];
+    const v_uint16x8 far_depth = v_setall_u16(saturate_cast<ushort>(distance_threshold));
+    for ( ; l_x <= l_W - l_r - 1 - 8; l_x += 8)
     {
-      long l_d = lp_line[0];
-
-      if (l_d < distance_threshold)
+      const ushort* p = lp_line + l_x;
+      v_uint16x8 center = v_load(p);
+      // skip blocks that are entirely out of depth
+      if (distance_threshold <= 65535 && v_check_all(center >= far_depth))
+        continue;
+
+      v_uint32x4 d_lo, d_hi, n_lo[8], n_hi[8];
+      v_expand(center, d_lo, d_hi);
+      for (int k = 0; k < 8; ++k)
+        v_expand(v_load(p + offsets[k]), n_lo[k], n_hi[k]);
+
+      v_int32x4 neighbours[8];
+      for (int k = 0; k < 8; ++k)
+        neighbours[k] = v_reinterpret_as_s32(n_lo[k]);
+      v_estimateNormals(v_reinterpret_as_s32(d_lo), neighbours, difference_threshold, nx, ny, nz);
+      for (int k = 0; k < 8; ++k)
+        neighbours[k] = v_reinterpret_as_s32(n_hi[k]);
+      v_estimateNormals(v_reinterpret_as_s32(d_hi), neighbours, difference_threshold,
+                        nx + 4, ny + 4, nz + 4);
+
+      for (int i = 0; i < 8; ++i)
       {
-        // accum
-        long l_A[4]; l_A[0] = l_A[1] = l_A[2] = l_A[3] = 0;
-        long l_b[2]; l_b[0] = l_b[1] = 0;
-        accumBilateral(lp_line[l_offset0] - l_d, -l_r, -l_r, l_A, l_b, difference_threshold);
-        accumBilateral(lp_line[l_offset1] - l_d,    0, -l_r, l_A, l_b, difference_threshold);
-        accumBilateral(lp_line[l_offset2] - l_d, +l_r, -l_r, l_A, l_b, difference_threshold);
-        accumBilateral(lp_line[l_offset3] - l_d, -l_r,    0, l_A, l_b, difference_threshold);
-        accumBilateral(lp_line[l_offset4] - l_d, +l_r,    0, l_A, l_b, difference_threshold);
-        accumBilateral(lp_line[l_offset5] - l_d, -l_r, +l_r, l_A, l_b, difference_threshold);
-        accumBilateral(lp_line[l_offset6] - l_d,    0, +l_r, l_A, l_b, difference_threshold);
-        accumBilateral(lp_line[l_offset7] - l_d, +l_r, +l_r, l_A, l_b, difference_threshold);
-
-        // solve
-        long l_det =  l_A[0] * l_A[3] - l_A[1] * l_A[1];
-        long l_ddx =  l_A[3] * l_b[0] - l_A[1] * l_b[1];
-        long l_ddy = -l_A[1] * l_b[0] + l_A[0] * l_b[1];
-
-        /// @todo Magic number 1150 is focal length? This is something like
-        /// f in SXGA mode, but in VGA is more like 530.
-        float l_nx = static_cast<float>(1150 * l_ddx);
-        float l_ny = static_cast<float>(1150 * l_ddy);
-        float l_nz = static_cast<float>(-l_det * l_d);
-
-        float l_sqrt = sqrtf(l_nx * l_nx + l_ny * l_ny + l_nz * l_nz);
-
-        if (l_sqrt > 0)
-        {
-          float l_norminv = 1.0f / (l_sqrt);
-
-          l_nx *= l_norminv;
-          l_ny *= l_norminv;
-          l_nz *= l_norminv;
-
-          //*lp_norm = fabs(l_nz)*255;
-
-          int l_val1 = static_cast<int>(l_nx * l_offsetx + l_offsetx);
-          int l_val2 = static_cast<int>(l_ny * l_offsety + l_offsety);
-          int l_val3 = static_cast<int>(l_nz * GRANULARITY + GRANULARITY);
-
-          *lp_norm = NORMAL_LUT[l_val3][l_val2][l_val1];
-        }
-        else
-        {
-          *lp_norm = 0; // Discard shadows from depth sensor
-        }
-      }
-      else
-      {
-        *lp_norm = 0; //out of depth
+        if (p[i] < distance_threshold)
+          lp_norm[l_x + i] = normalLabel(nx[i], ny[i], nz[i]);
       }
-      ++lp_line;
-      ++lp_norm;
+    }
+#endif
+    for ( ; l_x < l_W - l_r - 1; ++l_x)
+    {
+      // pixels out of depth keep 0
+      if (lp_line[l_x] < distance_threshold)
+        lp_norm[l_x] = quantizeNormal(lp_line + l_x, offsets, difference_threshold);
     }
   }
   medianBlur(dst, dst, 5);
@@ -920,51 +1004,13 @@ static void orUnaligned8u(const uchar * src, const int src_stride,
                    uchar * dst, const int dst_stride,
                    const int width, const int height)
 {
-#if CV_SSE2
-  volatile bool haveSSE2 = checkHardwareSupport(CPU_SSE2);
-#if CV_SSE3
-  volatile bool haveSSE3 = checkHardwareSupport(CPU_SSE3);
-#endif
-  bool src_aligned = reinterpret_cast<unsigned long long>(src) % 16 == 0;
-#endif
-
   for (int r = 0; r < height; ++r)
   {
     int c = 0;
 
-#if CV_SSE2
-    // Use aligned loads if possible
-    if (haveSSE2 && src_aligned)
-    {
-      for ( ; c < width - 15; c += 16)
-      {
-        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src + c);
-        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst + c);
-        *dst_ptr = _mm_or_si128(*dst_ptr, *src_ptr);
-      }
-    }
-#if CV_SSE3
-    // Use LDDQU for fast unaligned load
-    else if (haveSSE3)
-    {
-      for ( ; c < width - 15; c += 16)
-      {
-        __m128i val = _mm_lddqu_si128(reinterpret_cast<const __m128i*>(src + c));
-        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst + c);
-        *dst_ptr = _mm_or_si128(*dst_ptr, val);
-      }
-    }
-#endif
-    // Fall back to MOVDQU
-    else if (haveSSE2)
-    {
-      for ( ; c < width - 15; c += 16)
-      {
-        __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c));
-        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst + c);
-        *dst_ptr = _mm_or_si128(*dst_ptr, val);
-      }
-    }
+#if CV_SIMD128
+    for ( ; c < width - 15; c += 16)
+      v_store(dst + c, v_load(dst + c) | v_load(src + c));
 #endif
     for ( ; c < width; ++c)
       dst[c] |= src[c];
@@ -989,15 +1035,20 @@ static void spread(const Mat& src, Mat& dst, int T)
   // Allocate and zero-initialize spread (OR'ed) image
   dst = Mat::zeros(src.size(), CV_8U);
 
-  // Fill in spread gradient image (section 2.3)
-  for (int r = 0; r < T; ++r)
+  // Fill in spread gradient image (section 2.3). The spreading is separable: each source row is
+  // OR'ed over T columns, and the result is OR'ed into the T destination rows it reaches. Rows
+  // are processed in order, so the rows being updated stay in cache.
+  const int width = src.cols;
+  AutoBuffer<uchar> _row(width);
+  uchar* row = _row;
+  for (int r = 0; r < src.rows; ++r)
   {
-    int height = src.rows - r;
-    for (int c = 0; c < T; ++c)
-    {
-      orUnaligned8u(&src.at<unsigned char>(r, c), static_cast<const int>(src.step1()), dst.ptr(),
-                    static_cast<const int>(dst.step1()), src.cols - c, height);
-    }
+    const uchar* src_r = src.ptr(r);
+    memcpy(row, src_r, width);
+    for (int c = 1; c < T; ++c)
+      orUnaligned8u(src_r + c, 0, row, 0, width - c, 1);
+    for (int k = std::max(r - T + 1, 0); k <= r; ++k)
+      orUnaligned8u(row, 0, dst.ptr(k), 0, width, 1);
   }
 }
 
@@ -1014,70 +1065,66 @@ CV_DECL_ALIGNED(16) static const unsigned char SIMILARITY_LUT[256] = {0, 4, 3, 4
  */
 static void computeResponseMaps(const Mat& src, std::vector<Mat>& response_maps)
 {
-  CV_Assert((src.rows * src.cols) % 16 == 0);
+  CV_Assert((src.rows * src.cols) % 16 == 0 && src.isContinuous());
 
   // Allocate response maps
   response_maps.resize(8);
   for (int i = 0; i < 8; ++i)
     response_maps[i].create(src.size(), CV_8U);
 
-  Mat lsb4(src.size(), CV_8U);
-  Mat msb4(src.size(), CV_8U);
-
-  for (int r = 0; r < src.rows; ++r)
-  {
-    const uchar* src_r = src.ptr(r);
-    uchar* lsb4_r = lsb4.ptr(r);
-    uchar* msb4_r = msb4.ptr(r);
-
-    for (int c = 0; c < src.cols; ++c)
-    {
-      // Least significant 4 bits of spread image pixel
-      lsb4_r[c] = src_r[c] & 15;
-      // Most significant 4 bits, right-shifted to be in [0, 16)
-      msb4_r[c] = (src_r[c] & 240) >> 4;
-    }
-  }
+  // The spread image is read once, all 8 response maps are filled in the same pass
+  const int length = src.rows * src.cols;
 
 #if CV_SSSE3
   volatile bool haveSSSE3 = checkHardwareSupport(CV_CPU_SSSE3);
   if (haveSSSE3)
   {
     const __m128i* lut = reinterpret_cast<const __m128i*>(SIMILARITY_LUT);
+    const __m128i* src_data = src.ptr<__m128i>();
+    const __m128i low_mask = _mm_set1_epi8(15);
+    __m128i* map_data[8];
     for (int ori = 0; ori < 8; ++ori)
+      map_data[ori] = response_maps[ori].ptr<__m128i>();
+
+    for (int i = 0; i < length / 16; ++i)
     {
-      __m128i* map_data = response_maps[ori].ptr<__m128i>();
-      __m128i* lsb4_data = lsb4.ptr<__m128i>();
-      __m128i* msb4_data = msb4.ptr<__m128i>();
+      __m128i val = _mm_loadu_si128(src_data + i);
+      // Least significant 4 bits of spread image pixel
+      __m128i lsb4 = _mm_and_si128(val, low_mask);
+      // Most significant 4 bits, right-shifted to be in [0, 16)
+      __m128i msb4 = _mm_and_si128(_mm_srli_epi16(val, 4), low_mask);
 
       // Precompute the 2D response map S_i (section 2.4)
-      for (int i = 0; i < (src.rows * src.cols) / 16; ++i)
+      for (int ori = 0; ori < 8; ++ori)
       {
         // Using SSE shuffle for table lookup on 4 orientations at a time
         // The most/least significant 4 bits are used as the LUT index
-        __m128i res1 = _mm_shuffle_epi8(lut[2*ori + 0], lsb4_data[i]);
-        __m128i res2 = _mm_shuffle_epi8(lut[2*ori + 1], msb4_data[i]);
+        __m128i res1 = _mm_shuffle_epi8(lut[2*ori + 0], lsb4);
+        __m128i res2 = _mm_shuffle_epi8(lut[2*ori + 1], msb4);
 
         // Combine the results into a single similarity score
-        map_data[i] = _mm_max_epu8(res1, res2);
+        _mm_store_si128(map_data[ori] + i, _mm_max_epu8(res1, res2));
       }
     }
   }
   else
 #endif
   {
-    // For each of the 8 quantized orientations...
+    const uchar* src_data = src.ptr<uchar>();
+    uchar* map_data[8];
     for (int ori = 0; ori < 8; ++ori)
-    {
-      uchar* map_data = response_maps[ori].ptr<uchar>();
-      uchar* lsb4_data = lsb4.ptr<uchar>();
-      uchar* msb4_data = msb4.ptr<uchar>();
-      const uchar* lut_low = SIMILARITY_LUT + 32*ori;
-      const uchar* lut_hi = lut_low + 16;
+      map_data[ori] = response_maps[ori].ptr<uchar>();
 
-      for (int i = 0; i < src.rows * src.cols; ++i)
+    for (int i = 0; i < length; ++i)
+    {
+      int lsb4 = src_data[i] & 15;
+      int msb4 = src_data[i] >> 4;
+      // For each of the 8 quantized orientations...
+      for (int ori = 0; ori < 8; ++ori)
       {
-        map_data[i] = std::max(lut_low[ lsb4_data[i] ], lut_hi[ msb4_data[i] ]);
+        const uchar* lut_low = SIMILARITY_LUT + 32*ori;
+        const uchar* lut_hi = lut_low + 16;
+        map_data[ori][i] = std::max(lut_low[lsb4], lut_hi[msb4]);
       }
     }
   }
@@ -1193,16 +1240,11 @@ static void similarity(const std::vector<Mat>& linear_memories, const Template&
 
   /// @todo In old code, dst is buffer of size m_U. Could make it something like
   /// (span_x)x(span_y) instead?
-  dst = Mat::zeros(H, W, CV_8U);
+  // dst is usually reused from the previous template
+  dst.create(H, W, CV_8U);
+  dst.setTo(Scalar::all(0));
   uchar* dst_ptr = dst.ptr<uchar>();
 
-#if CV_SSE2
-  volatile bool haveSSE2 = checkHardwareSupport(CV_CPU_SSE2);
-#if CV_SSE3
-  volatile bool haveSSE3 = checkHardwareSupport(CV_CPU_SSE3);
-#endif
-#endif
-
   // Compute the similarity measure for this template by accumulating the contribution of
   // each feature
   for (int i = 0; i < (int)templ.features.size(); ++i)
@@ -1216,33 +1258,13 @@ static void similarity(const std::vector<Mat>& linear_memories, const Template&
       continue;
     const uchar* lm_ptr = accessLinearMemory(linear_memories, f, T, W);
 
-    // Now we do an aligned/unaligned add of dst_ptr and lm_ptr with template_positions elements
+    // Now we do an unaligned add of dst_ptr and lm_ptr with template_positions elements
     int j = 0;
-    // Process responses 16 at a time if vectorization possible
-#if CV_SSE2
-#if CV_SSE3
-    if (haveSSE3)
-    {
-      // LDDQU may be more efficient than MOVDQU for unaligned load of next 16 responses
-      for ( ; j < template_positions - 15; j += 16)
-      {
-        __m128i responses = _mm_lddqu_si128(reinterpret_cast<const __m128i*>(lm_ptr + j));
-        __m128i* dst_ptr_sse = reinterpret_cast<__m128i*>(dst_ptr + j);
-        *dst_ptr_sse = _mm_add_epi8(*dst_ptr_sse, responses);
-      }
-    }
-    else
-#endif
-    if (haveSSE2)
-    {
-      // Fall back to MOVDQU
-      for ( ; j < template_positions - 15; j += 16)
-      {
-        __m128i responses = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lm_ptr + j));
-        __m128i* dst_ptr_sse = reinterpret_cast<__m128i*>(dst_ptr + j);
-        *dst_ptr_sse = _mm_add_epi8(*dst_ptr_sse, responses);
-      }
-    }
+    // Process responses 16 at a time if vectorization possible.
+    // The saturating add does not change anything as the sum of at most 63 responses fits in 8 bits
+#if CV_SIMD128
+    for ( ; j < template_positions - 15; j += 16)
+      v_store(dst_ptr + j, v_load(dst_ptr + j) + v_load(lm_ptr + j));
 #endif
     for ( ; j < template_positions; ++j)
       dst_ptr[j] = uchar(dst_ptr[j] + lm_ptr[j]);
@@ -1268,7 +1290,9 @@ static void similarityLocal(const std::vector<Mat>& linear_memories, const Templ
 
   // Compute the similarity map in a 16x16 patch around center
   int W = size.width / T;
-  dst = Mat::zeros(16, 16, CV_8U);
+  dst.create(16, 16, CV_8U);
+  dst.setTo(Scalar::all(0));
+  uchar* dst_data = dst.ptr<uchar>();
 
   // Offset each feature point by the requested center. Further adjust to (-8,-8) from the
   // center to get the top-left corner of the 16x16 patch.
@@ -1276,14 +1300,6 @@ static void similarityLocal(const std::vector<Mat>& linear_memories, const Templ
   int offset_x = (center.x / T - 8) * T;
   int offset_y = (center.y / T - 8) * T;
 
-#if CV_SSE2
-  volatile bool haveSSE2 = checkHardwareSupport(CV_CPU_SSE2);
-#if CV_SSE3
-  volatile bool haveSSE3 = checkHardwareSupport(CV_CPU_SSE3);
-#endif
-  __m128i* dst_ptr_sse = dst.ptr<__m128i>();
-#endif
-
   for (int i = 0; i < (int)templ.features.size(); ++i)
   {
     Feature f = templ.features[i];
@@ -1296,57 +1312,36 @@ static void similarityLocal(const std::vector<Mat>& linear_memories, const Templ
     const uchar* lm_ptr = accessLinearMemory(linear_memories, f, T, W);
 
     // Process whole row at a time if vectorization possible
-#if CV_SSE2
-#if CV_SSE3
-    if (haveSSE3)
+    uchar* dst_ptr = dst_data;
+    for (int row = 0; row < 16; ++row)
     {
-      // LDDQU may be more efficient than MOVDQU for unaligned load of 16 responses from current row
-      for (int row = 0; row < 16; ++row)
-      {
-        __m128i aligned = _mm_lddqu_si128(reinterpret_cast<const __m128i*>(lm_ptr));
-        dst_ptr_sse[row] = _mm_add_epi8(dst_ptr_sse[row], aligned);
-        lm_ptr += W; // Step to next row
-      }
-    }
-    else
+#if CV_SIMD128
+      v_store(dst_ptr, v_load(dst_ptr) + v_load(lm_ptr));
+#else
+      for (int col = 0; col < 16; ++col)
+        dst_ptr[col] = uchar(dst_ptr[col] + lm_ptr[col]);
 #endif
-    if (haveSSE2)
-    {
-      // Fall back to MOVDQU
-      for (int row = 0; row < 16; ++row)
-      {
-        __m128i aligned = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lm_ptr));
-        dst_ptr_sse[row] = _mm_add_epi8(dst_ptr_sse[row], aligned);
-        lm_ptr += W; // Step to next row
-      }
-    }
-    else
-#endif
-    {
-      uchar* dst_ptr = dst.ptr<uchar>();
-      for (int row = 0; row < 16; ++row)
-      {
-        for (int col = 0; col < 16; ++col)
-          dst_ptr[col] = uchar(dst_ptr[col] + lm_ptr[col]);
-        dst_ptr += 16;
-        lm_ptr += W;
-      }
+      dst_ptr += 16;
+      lm_ptr += W; // Step to next row
     }
   }
 }
 
 static void addUnaligned8u16u(const uchar * src1, const uchar * src2, ushort * res, int length)
 {
-  const uchar * end = src1 + length;
-
-  while (src1 != end)
+  int i = 0;
+#if CV_SIMD128
+  for ( ; i <= length - 16; i += 16)
   {
-    *res = *src1 + *src2;
-
-    ++src1;
-    ++src2;
-    ++res;
+    v_uint16x8 a0, a1, b0, b1;
+    v_expand(v_load(src1 + i), a0, a1);
+    v_expand(v_load(src2 + i), b0, b1);
+    v_store(res + i, a0 + b0);
+    v_store(res + i + 8, a1 + b1);
   }
+#endif
+  for ( ; i < length; ++i)
+    res[i] = (ushort)(src1[i] + src2[i]);
 }
 
 /**
@@ -1377,6 +1372,234 @@ static void addSimilarities(const std::vector<Mat>& similarities, Mat& dst)
 *                               High-level Detector API                                  *
 \****************************************************************************************/
 
+// Used to filter out weak matches
+struct MatchPredicate
+{
+  MatchPredicate(float _threshold) : threshold(_threshold) {}
+  bool operator() (const Match& m) { return m.similarity < threshold; }
+  float threshold;
+};
+
+/**
+ * \brief Scratch data of a thread matching templates, reused from a template to the next.
+ */
+struct TemplateMatchBuffers
+{
+  std::vector<Mat> similarities;
+  std::vector<Mat> local_similarities;
+  Mat total_similarity;
+  Mat total_similarity_local;
+};
+
+/**
+ * \brief Match one template pyramid against the linear memories, coarse to fine.
+ *
+ * \param[out] candidates The matches of the template above the threshold.
+ */
+static void matchTemplate(const std::vector< std::vector< std::vector<Mat> > >& lm_pyramid,
+                          const std::vector<Size>& sizes, const std::vector<int>& T_at_level,
+                          int num_modalities, float threshold, const String& class_id,
+                          const std::vector<Template>& tp, int template_id,
+                          TemplateMatchBuffers& buffers, std::vector<Match>& candidates)
+{
+  const int pyramid_levels = (int)T_at_level.size();
+  std::vector<Mat>& similarities = buffers.similarities;
+  similarities.resize(num_modalities);
+  std::vector<Mat>& local_similarities = buffers.local_similarities;
+  local_similarities.resize(num_modalities);
+  Mat& total_similarity = buffers.total_similarity;
+  Mat& total_similarity_local = buffers.total_similarity_local;
+
+  // First match over the whole image at the lowest pyramid level
+  /// @todo Factor this out into separate function
+  const std::vector< std::vector<Mat> >& lowest_lm = lm_pyramid.back();
+
+  // Compute similarity maps for each modality at lowest pyramid level
+  int lowest_start = static_cast<int>(tp.size() - num_modalities);
+  int lowest_T = T_at_level.back();
+  int num_features = 0;
+  for (int i = 0; i < num_modalities; ++i)
+  {
+    const Template& templ = tp[lowest_start + i];
+    num_features += static_cast<int>(templ.features.size());
+    similarity(lowest_lm[i], templ, similarities[i], sizes.back(), lowest_T);
+  }
+
+  // Combine into overall similarity
+  /// @todo Support weighting the modalities
+  addSimilarities(similarities, total_similarity);
+
+  // Convert user-friendly percentage to raw similarity threshold. The percentage
+  // threshold scales from half the max response (what you would expect from applying
+  // the template to a completely random image) to the max response.
+  // NOTE: This assumes max per-feature response is 4, so we scale between [2*nf, 4*nf].
+  int raw_threshold = static_cast<int>(2*num_features + (threshold / 100.f) * (2*num_features) + 0.5f);
+
+  // Find initial matches
+  candidates.clear();
+  for (int r = 0; r < total_similarity.rows; ++r)
+  {
+    ushort* row = total_similarity.ptr<ushort>(r);
+    for (int c = 0; c < total_similarity.cols; ++c)
+    {
+      int raw_score = row[c];
+      if (raw_score > raw_threshold)
+      {
+        int offset = lowest_T / 2 + (lowest_T % 2 - 1);
+        int x = c * lowest_T + offset;
+        int y = r * lowest_T + offset;
+        float score =(raw_score * 100.f) / (4 * num_features) + 0.5f;
+        candidates.push_back(Match(x, y, score, class_id, template_id));
+      }
+    }
+  }
+
+  // Locally refine each match by marching up the pyramid
+  for (int l = pyramid_levels - 2; l >= 0; --l)
+  {
+    const std::vector< std::vector<Mat> >& lms = lm_pyramid[l];
+    int T = T_at_level[l];
+    int start = static_cast<int>(l * num_modalities);
+    Size size = sizes[l];
+    int border = 8 * T;
+    int offset = T / 2 + (T % 2 - 1);
+    int max_x = size.width - tp[start].width - border;
+    int max_y = size.height - tp[start].height - border;
+
+    for (int m = 0; m < (int)candidates.size(); ++m)
+    {
+      Match& match2 = candidates[m];
+      int x = match2.x * 2 + 1; /// @todo Support other pyramid distance
+      int y = match2.y * 2 + 1;
+
+      // Require 8 (reduced) row/cols to the up/left
+      x = std::max(x, border);
+      y = std::max(y, border);
+
+      // Require 8 (reduced) row/cols to the down/left, plus the template size
+      x = std::min(x, max_x);
+      y = std::min(y, max_y);
+
+      // Compute local similarity maps for each modality
+      int numFeatures = 0;
+      for (int i = 0; i < num_modalities; ++i)
+      {
+        const Template& templ = tp[start + i];
+        numFeatures += static_cast<int>(templ.features.size());
+        similarityLocal(lms[i], templ, local_similarities[i], size, T, Point(x, y));
+      }
+      addSimilarities(local_similarities, total_similarity_local);
+
+      // Find best local adjustment
+      int best_score = 0;
+      int best_r = -1, best_c = -1;
+      for (int r = 0; r < total_similarity_local.rows; ++r)
+      {
+        ushort* row = total_similarity_local.ptr<ushort>(r);
+        for (int c = 0; c < total_similarity_local.cols; ++c)
+        {
+          int score = row[c];
+          if (score > best_score)
+          {
+            best_score = score;
+            best_r = r;
+            best_c = c;
+          }
+        }
+      }
+      // Update current match
+      match2.x = (x / T - 8 + best_c) * T + offset;
+      match2.y = (y / T - 8 + best_r) * T + offset;
+      match2.similarity = (best_score * 100.f) / (4 * numFeatures);
+    }
+
+    // Filter out any matches that drop below the similarity threshold
+    std::vector<Match>::iterator new_end = std::remove_if(candidates.begin(), candidates.end(),
+                                                          MatchPredicate(threshold));
+    candidates.erase(new_end, candidates.end());
+  }
+}
+
+/**
+ * \brief Match a list of templates in parallel, every stripe handling a batch of consecutive
+ * templates with the same scratch buffers.
+ */
+class MatchTemplatesInvoker : public ParallelLoopBody
+{
+public:
+  struct Task
+  {
+    const String* class_id;
+    const std::vector<Template>* tp;
+    int template_id;
+  };
+
+  MatchTemplatesInvoker(const std::vector<Task>& _tasks,
+                        const std::vector< std::vector< std::vector<Mat> > >& _lm_pyramid,
+                        const std::vector<Size>& _sizes, const std::vector<int>& _T_at_level,
+                        int _num_modalities, float _threshold,
+                        std::vector< std::vector<Match> >& _results)
+    : tasks(_tasks), lm_pyramid(_lm_pyramid), sizes(_sizes), T_at_level(_T_at_level),
+      num_modalities(_num_modalities), threshold(_threshold), results(_results)
+  {
+  }
+
+  void operator()(const Range& range) const
+  {
+    TemplateMatchBuffers buffers;
+    for (int i = range.start; i < range.end; ++i)
+    {
+      const Task& task = tasks[i];
+      matchTemplate(lm_pyramid, sizes, T_at_level, num_modalities, threshold, *task.class_id,
+                    *task.tp, task.template_id, buffers, results[i]);
+    }
+  }
+
+  /** Number of templates matched in a row by a stripe */
+  static const int BATCH_SIZE = 32;
+
+  /** Run the tasks and append their matches to matches, in the order of the tasks */
+  static void run(const std::vector<Task>& tasks,
+                  const std::vector< std::vector< std::vector<Mat> > >& lm_pyramid,
+                  const std::vector<Size>& sizes, const std::vector<int>& T_at_level,
+                  int num_modalities, float threshold, std::vector<Match>& matches)
+  {
+    if (tasks.empty())
+      return;
+    std::vector< std::vector<Match> > results(tasks.size());
+    int num_tasks = (int)tasks.size();
+    parallel_for_(Range(0, num_tasks),
+                  MatchTemplatesInvoker(tasks, lm_pyramid, sizes, T_at_level, num_modalities, threshold, results),
+                  (num_tasks + BATCH_SIZE - 1) / BATCH_SIZE);
+    for (size_t i = 0; i < results.size(); ++i)
+      matches.insert(matches.end(), results[i].begin(), results[i].end());
+  }
+
+private:
+  const std::vector<Task>& tasks;
+  const std::vector< std::vector< std::vector<Mat> > >& lm_pyramid;
+  const std::vector<Size>& sizes;
+  const std::vector<int>& T_at_level;
+  int num_modalities;
+  float threshold;
+  std::vector< std::vector<Match> >& results;
+
+  MatchTemplatesInvoker& operator=(const MatchTemplatesInvoker&);
+};
+
+static void addMatchTasks(const String& class_id, const std::vector< std::vector<Template> >& template_pyramids,
+                          std::vector<MatchTemplatesInvoker::Task>& tasks)
+{
+  for (size_t template_id = 0; template_id < template_pyramids.size(); ++template_id)
+  {
+    MatchTemplatesInvoker::Task task;
+    task.class_id = &class_id;
+    task.tp = &template_pyramids[template_id];
+    task.template_id = static_cast<int>(template_id);
+    tasks.push_back(task);
+  }
+}
+
 Detector::Detector()
 {
 }
@@ -1446,12 +1669,14 @@ void Detector::match(const std::vector<Mat>& sources, float threshold, std::vect
     sizes.push_back(quantized.size());
   }
 
+  // Gather the templates of all the classes so that they are matched in parallel together
+  std::vector<MatchTemplatesInvoker::Task> tasks;
   if (class_ids.empty())
   {
     // Match all templates
     TemplatesMap::const_iterator it = class_templates.begin(), itend = class_templates.end();
     for ( ; it != itend; ++it)
-      matchClass(lm_pyramid, sizes, threshold, matches, it->first, it->second);
+      addMatchTasks(it->first, it->second, tasks);
   }
   else
   {
@@ -1460,9 +1685,11 @@ void Detector::match(const std::vector<Mat>& sources, float threshold, std::vect
     {
       TemplatesMap::const_iterator it = class_templates.find(class_ids[i]);
       if (it != class_templates.end())
-        matchClass(lm_pyramid, sizes, threshold, matches, it->first, it->second);
+        addMatchTasks(it->first, it->second, tasks);
     }
   }
+  MatchTemplatesInvoker::run(tasks, lm_pyramid, sizes, T_at_level, static_cast<int>(modalities.size()),
+                             threshold, matches);
 
   // Sort matches by similarity, and prune any duplicates introduced by pyramid refinement
   std::sort(matches.begin(), matches.end());
@@ -1470,140 +1697,16 @@ void Detector::match(const std::vector<Mat>& sources, float threshold, std::vect
   matches.erase(new_end, matches.end());
 }
 
-// Used to filter out weak matches
-struct MatchPredicate
-{
-  MatchPredicate(float _threshold) : threshold(_threshold) {}
-  bool operator() (const Match& m) { return m.similarity < threshold; }
-  float threshold;
-};
-
 void Detector::matchClass(const LinearMemoryPyramid& lm_pyramid,
                           const std::vector<Size>& sizes,
                           float threshold, std::vector<Match>& matches,
                           const String& class_id,
                           const std::vector<TemplatePyramid>& template_pyramids) const
 {
-  // For each template...
-  for (size_t template_id = 0; template_id < template_pyramids.size(); ++template_id)
-  {
-    const TemplatePyramid& tp = template_pyramids[template_id];
-
-    // First match over the whole image at the lowest pyramid level
-    /// @todo Factor this out into separate function
-    const std::vector<LinearMemories>& lowest_lm = lm_pyramid.back();
-
-    // Compute similarity maps for each modality at lowest pyramid level
-    std::vector<Mat> similarities(modalities.size());
-    int lowest_start = static_cast<int>(tp.size() - modalities.size());
-    int lowest_T = T_at_level.back();
-    int num_features = 0;
-    for (int i = 0; i < (int)modalities.size(); ++i)
-    {
-      const Template& templ = tp[lowest_start + i];
-      num_features += static_cast<int>(templ.features.size());
-      similarity(lowest_lm[i], templ, similarities[i], sizes.back(), lowest_T);
-    }
-
-    // Combine into overall similarity
-    /// @todo Support weighting the modalities
-    Mat total_similarity;
-    addSimilarities(similarities, total_similarity);
-
-    // Convert user-friendly percentage to raw similarity threshold. The percentage
-    // threshold scales from half the max response (what you would expect from applying
-    // the template to a completely random image) to the max response.
-    // NOTE: This assumes max per-feature response is 4, so we scale between [2*nf, 4*nf].
-    int raw_threshold = static_cast<int>(2*num_features + (threshold / 100.f) * (2*num_features) + 0.5f);
-
-    // Find initial matches
-    std::vector<Match> candidates;
-    for (int r = 0; r < total_similarity.rows; ++r)
-    {
-      ushort* row = total_similarity.ptr<ushort>(r);
-      for (int c = 0; c < total_similarity.cols; ++c)
-      {
-        int raw_score = row[c];
-        if (raw_score > raw_threshold)
-        {
-          int offset = lowest_T / 2 + (lowest_T % 2 - 1);
-          int x = c * lowest_T + offset;
-          int y = r * lowest_T + offset;
-          float score =(raw_score * 100.f) / (4 * num_features) + 0.5f;
-          candidates.push_back(Match(x, y, score, class_id, static_cast<int>(template_id)));
-        }
-      }
-    }
-
-    // Locally refine each match by marching up the pyramid
-    for (int l = pyramid_levels - 2; l >= 0; --l)
-    {
-      const std::vector<LinearMemories>& lms = lm_pyramid[l];
-      int T = T_at_level[l];
-      int start = static_cast<int>(l * modalities.size());
-      Size size = sizes[l];
-      int border = 8 * T;
-      int offset = T / 2 + (T % 2 - 1);
-      int max_x = size.width - tp[start].width - border;
-      int max_y = size.height - tp[start].height - border;
-
-      std::vector<Mat> similarities2(modalities.size());
-      Mat total_similarity2;
-      for (int m = 0; m < (int)candidates.size(); ++m)
-      {
-        Match& match2 = candidates[m];
-        int x = match2.x * 2 + 1; /// @todo Support other pyramid distance
-        int y = match2.y * 2 + 1;
-
-        // Require 8 (reduced) row/cols to the up/left
-        x = std::max(x, border);
-        y = std::max(y, border);
-
-        // Require 8 (reduced) row/cols to the down/left, plus the template size
-        x = std::min(x, max_x);
-        y = std::min(y, max_y);
-
-        // Compute local similarity maps for each modality
-        int numFeatures = 0;
-        for (int i = 0; i < (int)modalities.size(); ++i)
-        {
-          const Template& templ = tp[start + i];
-          numFeatures += static_cast<int>(templ.features.size());
-          similarityLocal(lms[i], templ, similarities2[i], size, T, Point(x, y));
-        }
-        addSimilarities(similarities2, total_similarity2);
-
-        // Find best local adjustment
-        int best_score = 0;
-        int best_r = -1, best_c = -1;
-        for (int r = 0; r < total_similarity2.rows; ++r)
-        {
-          ushort* row = total_similarity2.ptr<ushort>(r);
-          for (int c = 0; c < total_similarity2.cols; ++c)
-          {
-            int score = row[c];
-            if (score > best_score)
-            {
-              best_score = score;
-              best_r = r;
-              best_c = c;
-            }
-          }
-        }
-        // Update current match
-        match2.x = (x / T - 8 + best_c) * T + offset;
-        match2.y = (y / T - 8 + best_r) * T + offset;
-        match2.similarity = (best_score * 100.f) / (4 * numFeatures);
-      }
-
-      // Filter out any matches that drop below the similarity threshold
-      std::vector<Match>::iterator new_end = std::remove_if(candidates.begin(), candidates.end(),
-                                                            MatchPredicate(threshold));
-      candidates.erase(new_end, candidates.end());
-    }
-
-    matches.insert(matches.end(), candidates.begin(), candidates.end());
-  }
+  std::vector<MatchTemplatesInvoker::Task> tasks;
+  addMatchTasks(class_id, template_pyramids, tasks);
+  MatchTemplatesInvoker::run(tasks, lm_pyramid, sizes, T_at_level, static_cast<int>(modalities.size()),
+                             threshold, matches);
 }
 
 int Detector::addTemplate(const std::vector<Mat>& sources, const String& class_id,
@@ -1822,6 +1925,219 @@ void Detector::writeClasses(const String& format) const
   }
 }
 
+/****************************************************************************************\
+*                               Binary template archives                                 *
+\****************************************************************************************/
+
+/*
+ * Layout, native byte order:
+ *   "LMTB", version, modality count, modality names, pyramid levels, class id,
+ *   number of template pyramids, templates per pyramid, total number of features,
+ *   (width, height, pyramid level, feature count) of every template,
+ *   the x coordinates (int16), the y coordinates (int16) and the labels (uint8) of all the features.
+ * Strings are stored as their length followed by their characters.
+ */
+static const char LINEMOD_BINARY_MAGIC[4] = {'L', 'M', 'T', 'B'};
+static const int LINEMOD_BINARY_VERSION = 1;
+
+static void appendBinary(std::vector<uchar>& buf, const void* data, size_t size)
+{
+  const uchar* bytes = static_cast<const uchar*>(data);
+  buf.insert(buf.end(), bytes, bytes + size);
+}
+
+static void appendBinary(std::vector<uchar>& buf, int value)
+{
+  appendBinary(buf, &value, sizeof(value));
+}
+
+static void appendBinary(std::vector<uchar>& buf, const String& str)
+{
+  appendBinary(buf, static_cast<int>(str.size()));
+  appendBinary(buf, str.c_str(), str.size());
+}
+
+/** Bounds-checked sequential access to an archive in memory */
+class BinaryArchiveReader
+{
+public:
+  BinaryArchiveReader(const uchar* _data, size_t _size) : data(_data), size(_size), pos(0) {}
+
+  const uchar* block(size_t n)
+  {
+    if (n > size - pos)
+      CV_Error(Error::StsParseError, "Truncated LINEMOD binary archive");
+    const uchar* ptr = data + pos;
+    pos += n;
+    return ptr;
+  }
+
+  int readInt()
+  {
+    int value;
+    memcpy(&value, block(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  String readString()
+  {
+    int length = readInt();
+    CV_Assert(length >= 0);
+    return String(reinterpret_cast<const char*>(block(length)), length);
+  }
+
+private:
+  const uchar* data;
+  size_t size;
+  size_t pos;
+};
+
+void Detector::writeClassBinary(const String& class_id, const String& filename) const
+{
+  TemplatesMap::const_iterator it = class_templates.find(class_id);
+  CV_Assert(it != class_templates.end());
+  const std::vector<TemplatePyramid>& tps = it->second;
+
+  int templates_per_pyramid = tps.empty() ? 0 : static_cast<int>(tps[0].size());
+  int total_features = 0;
+  for (size_t i = 0; i < tps.size(); ++i)
+  {
+    CV_Assert(static_cast<int>(tps[i].size()) == templates_per_pyramid);
+    for (size_t j = 0; j < tps[i].size(); ++j)
+      total_features += static_cast<int>(tps[i][j].features.size());
+  }
+
+  std::vector<uchar> buf;
+  appendBinary(buf, LINEMOD_BINARY_MAGIC, sizeof(LINEMOD_BINARY_MAGIC));
+  appendBinary(buf, LINEMOD_BINARY_VERSION);
+  appendBinary(buf, static_cast<int>(modalities.size()));
+  for (size_t i = 0; i < modalities.size(); ++i)
+    appendBinary(buf, modalities[i]->name());
+  appendBinary(buf, pyramid_levels);
+  appendBinary(buf, it->first);
+  appendBinary(buf, static_cast<int>(tps.size()));
+  appendBinary(buf, templates_per_pyramid);
+  appendBinary(buf, total_features);
+
+  for (size_t i = 0; i < tps.size(); ++i)
+    for (size_t j = 0; j < tps[i].size(); ++j)
+    {
+      const Template& templ = tps[i][j];
+      appendBinary(buf, templ.width);
+      appendBinary(buf, templ.height);
+      appendBinary(buf, templ.pyramid_level);
+      appendBinary(buf, static_cast<int>(templ.features.size()));
+    }
+
+  std::vector<short> xs, ys;
+  std::vector<uchar> labels;
+  xs.reserve(total_features);
+  ys.reserve(total_features);
+  labels.reserve(total_features);
+  for (size_t i = 0; i < tps.size(); ++i)
+    for (size_t j = 0; j < tps[i].size(); ++j)
+      for (size_t k = 0; k < tps[i][j].features.size(); ++k)
+      {
+        const Feature& f = tps[i][j].features[k];
+        CV_Assert(f.x == (short)f.x && f.y == (short)f.y && f.label == (uchar)f.label);
+        xs.push_back((short)f.x);
+        ys.push_back((short)f.y);
+        labels.push_back((uchar)f.label);
+      }
+  if (total_features > 0)
+  {
+    appendBinary(buf, &xs[0], xs.size() * sizeof(short));
+    appendBinary(buf, &ys[0], ys.size() * sizeof(short));
+    appendBinary(buf, &labels[0], labels.size());
+  }
+
+  FILE* f = fopen(filename.c_str(), "wb");
+  if (!f)
+    CV_Error(Error::StsError, "Can not open " + filename + " for writing");
+  size_t written = fwrite(&buf[0], 1, buf.size(), f);
+  fclose(f);
+  if (written != buf.size())
+    CV_Error(Error::StsError, "Can not write " + filename);
+}
+
+String Detector::readClassBinary(const String& filename, const String& class_id_override)
+{
+  FILE* f = fopen(filename.c_str(), "rb");
+  if (!f)
+    CV_Error(Error::StsError, "Can not open " + filename);
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  std::vector<uchar> buf(size > 0 ? size : 0);
+  size_t read = buf.empty() ? 0 : fread(&buf[0], 1, buf.size(), f);
+  fclose(f);
+  if (read != buf.size() || buf.empty())
+    CV_Error(Error::StsError, "Can not read " + filename);
+
+  return readClassBinary(&buf[0], buf.size(), class_id_override);
+}
+
+String Detector::readClassBinary(const uchar* data, size_t size, const String& class_id_override)
+{
+  CV_Assert(data != 0);
+  BinaryArchiveReader reader(data, size);
+  if (memcmp(reader.block(sizeof(LINEMOD_BINARY_MAGIC)), LINEMOD_BINARY_MAGIC, sizeof(LINEMOD_BINARY_MAGIC)) != 0)
+    CV_Error(Error::StsParseError, "Not a LINEMOD binary archive");
+  if (reader.readInt() != LINEMOD_BINARY_VERSION)
+    CV_Error(Error::StsParseError, "Unsupported LINEMOD binary archive version or byte order");
+
+  // Verify compatible with Detector settings
+  CV_Assert(reader.readInt() == static_cast<int>(modalities.size()));
+  for (size_t i = 0; i < modalities.size(); ++i)
+    CV_Assert(modalities[i]->name() == reader.readString());
+  CV_Assert(reader.readInt() == pyramid_levels);
+
+  // Detector should not already have this class
+  String class_id = reader.readString();
+  if (!class_id_override.empty())
+    class_id = class_id_override;
+  CV_Assert(class_templates.find(class_id) == class_templates.end());
+
+  int num_pyramids = reader.readInt();
+  int templates_per_pyramid = reader.readInt();
+  int total_features = reader.readInt();
+  CV_Assert(num_pyramids >= 0 && templates_per_pyramid >= 0 && total_features >= 0);
+
+  size_t num_templates = (size_t)num_pyramids * templates_per_pyramid;
+  const uchar* headers = reader.block(num_templates * 4 * sizeof(int));
+  const uchar* xs = reader.block(total_features * sizeof(short));
+  const uchar* ys = reader.block(total_features * sizeof(short));
+  const uchar* labels = reader.block(total_features);
+
+  TemplatesMap::value_type v(class_id, std::vector<TemplatePyramid>(num_pyramids, TemplatePyramid(templates_per_pyramid)));
+  std::vector<TemplatePyramid>& tps = v.second;
+  int feature_index = 0;
+  for (int i = 0; i < num_pyramids; ++i)
+    for (int j = 0; j < templates_per_pyramid; ++j, headers += 4 * sizeof(int))
+    {
+      int header[4];
+      memcpy(header, headers, sizeof(header));
+      Template& templ = tps[i][j];
+      templ.width = header[0];
+      templ.height = header[1];
+      templ.pyramid_level = header[2];
+      CV_Assert(header[3] >= 0 && header[3] <= total_features - feature_index);
+
+      templ.features.resize(header[3]);
+      for (int k = 0; k < header[3]; ++k, ++feature_index)
+      {
+        short x, y;
+        memcpy(&x, xs + feature_index * sizeof(short), sizeof(short));
+        memcpy(&y, ys + feature_index * sizeof(short), sizeof(short));
+        templ.features[k] = Feature(x, y, labels[feature_index]);
+      }
+    }
+  CV_Assert(feature_index == total_features);
+
+  class_templates.insert(v);
+  return class_id;
+}
+
 static const int T_DEFAULTS[] = {5, 8};
 
 Ptr<Detector> getDefaultLINE()
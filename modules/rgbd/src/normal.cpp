@@ -34,6 +34,7 @@
  */
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -205,6 +206,168 @@ namespace rgbd
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+  /** Vectorized part of a row of B = V / r, returns the number of processed pixels
+   */
+  template<typename T>
+  inline int
+  falsRadiusRowSIMD(const T*, const T*, T*, int)
+  {
+    return 0;
+  }
+
+  /** Vectorized part of a row of normals = M_inv * B, returns the number of processed pixels
+   */
+  template<typename T>
+  inline int
+  falsNormalsRowSIMD(const T* const *, const T*, const T*, T*, int)
+  {
+    return 0;
+  }
+
+#if CV_SIMD128
+  template<>
+  inline int
+  falsRadiusRowSIMD<float>(const float* V, const float* r, float* B, int cols)
+  {
+    int x = 0;
+    for (; x <= cols - 4; x += 4)
+    {
+      v_float32x4 v0, v1, v2;
+      v_load_deinterleave(V + 3 * x, v0, v1, v2);
+      v_float32x4 vr = v_load(r + x);
+      v_float32x4 valid = vr == vr;
+      v_store_interleave(B + 3 * x, (v0 / vr) & valid, (v1 / vr) & valid, (v2 / vr) & valid);
+    }
+    return x;
+  }
+
+  template<>
+  inline int
+  falsNormalsRowSIMD<float>(const float* const * M_inv, const float* B, const float* r, float* normals, int cols)
+  {
+    const v_float32x4 vone = v_setall_f32(1.f), vzero = v_setall_f32(0.f), vsign = v_setall_f32(-0.f);
+    int x = 0;
+    for (; x <= cols - 4; x += 4)
+    {
+      v_float32x4 b0, b1, b2;
+      v_load_deinterleave(B + 3 * x, b0, b1, b2);
+      v_float32x4 n0 = v_load(M_inv[0] + x) * b0 + v_load(M_inv[1] + x) * b1 + v_load(M_inv[2] + x) * b2;
+      v_float32x4 n1 = v_load(M_inv[3] + x) * b0 + v_load(M_inv[4] + x) * b1 + v_load(M_inv[5] + x) * b2;
+      v_float32x4 n2 = v_load(M_inv[6] + x) * b0 + v_load(M_inv[7] + x) * b1 + v_load(M_inv[8] + x) * b2;
+
+      // normalize and make the normals point towards the camera, as signNormal does
+      v_float32x4 scale = vone / v_sqrt(n0 * n0 + n1 * n1 + n2 * n2);
+      scale = scale ^ ((n2 > vzero) & vsign);
+
+      v_float32x4 vr = v_load(r + x);
+      v_float32x4 invalid = vr != vr;
+      v_store_interleave(normals + 3 * x, (n0 * scale) | invalid, (n1 * scale) | invalid, (n2 * scale) | invalid);
+    }
+    return x;
+  }
+#endif
+
+  /** Computes B = V / r over rows, B is zero where r is not valid
+   */
+  template<typename T>
+  class FALSRadiusBody: public ParallelLoopBody
+  {
+  public:
+    typedef Vec<T, 3> Vec3T;
+
+    FALSRadiusBody(const Mat_<Vec3T> &V, const Mat &r, Mat_<Vec3T> &B)
+        :
+          V_(V),
+          r_(r),
+          B_(B)
+    {
+    }
+
+    void
+    operator()(const Range& range) const
+    {
+      for (int y = range.start; y < range.end; ++y)
+      {
+        const Vec3T *row_V = V_[y];
+        const T *row_r = r_.ptr<T>(y);
+        Vec3T *row_B = B_[y];
+        int x = falsRadiusRowSIMD<T>(row_V->val, row_r, row_B->val, r_.cols);
+        for (; x < r_.cols; ++x)
+        {
+          if (cvIsNaN(row_r[x]))
+            row_B[x] = Vec3T();
+          else
+            row_B[x] = row_V[x] / row_r[x];
+        }
+      }
+    }
+
+  private:
+    const Mat_<Vec3T> &V_;
+    const Mat &r_;
+    Mat_<Vec3T> &B_;
+
+    FALSRadiusBody& operator=(const FALSRadiusBody&);
+  };
+
+  /** Computes the normals M_inv * B over rows, M_inv being stored as 9 planes
+   */
+  template<typename T>
+  class FALSNormalsBody: public ParallelLoopBody
+  {
+  public:
+    typedef Vec<T, 3> Vec3T;
+
+    FALSNormalsBody(const std::vector<Mat> &M_inv, const Mat_<Vec3T> &B, const Mat &r, Mat &normals)
+        :
+          M_inv_(M_inv),
+          B_(B),
+          r_(r),
+          normals_(normals)
+    {
+    }
+
+    void
+    operator()(const Range& range) const
+    {
+      const T* M_inv[9];
+      for (int y = range.start; y < range.end; ++y)
+      {
+        for (int k = 0; k < 9; ++k)
+          M_inv[k] = M_inv_[k].ptr<T>(y);
+        const Vec3T *row_B = B_[y];
+        const T *row_r = r_.ptr<T>(y);
+        Vec3T *normal = normals_.ptr<Vec3T>(y);
+        int x = falsNormalsRowSIMD<T>(M_inv, row_B->val, row_r, normal->val, r_.cols);
+        for (; x < r_.cols; ++x)
+        {
+          if (cvIsNaN(row_r[x]))
+          {
+            normal[x][0] = row_r[x];
+            normal[x][1] = row_r[x];
+            normal[x][2] = row_r[x];
+          }
+          else
+          {
+            const Vec3T &Br = row_B[x];
+            Vec3T MBr(M_inv[0][x] * Br[0] + M_inv[1][x] * Br[1] + M_inv[2][x] * Br[2],
+                      M_inv[3][x] * Br[0] + M_inv[4][x] * Br[1] + M_inv[5][x] * Br[2],
+                      M_inv[6][x] * Br[0] + M_inv[7][x] * Br[1] + M_inv[8][x] * Br[2]);
+            signNormal(MBr, normal[x]);
+          }
+        }
+      }
+    }
+
+  private:
+    const std::vector<Mat> &M_inv_;
+    const Mat_<Vec3T> &B_;
+    const Mat &r_;
+    Mat &normals_;
+
+    FALSNormalsBody& operator=(const FALSNormalsBody&);
+  };
+
   /** Given a set of 3d points in a depth image, compute the normals at each point
    * using the FALS method described in
    * ``Fast and Accurate Computation of Surface Normals from Range Images``
@@ -258,14 +421,16 @@ namespace rgbd
 
       // Compute M's inverse
       Mat33T M_inv;
-      M_inv_.create(rows_, cols_);
-      Vec9T * M_inv_ptr = M_inv_[0];
+      Mat_<Vec9T> M_inv_all(rows_, cols_);
+      Vec9T * M_inv_ptr = M_inv_all[0];
       for (M_ptr = &M(0); M_ptr != M_ptr_end; ++M_inv_ptr, ++M_ptr)
       {
         // We have a semi-definite matrix
         invert(Mat33T(M_ptr->val), M_inv, DECOMP_CHOLESKY);
         *M_inv_ptr = Vec9T(M_inv.val);
       }
+      // Keep one plane per coefficient, for the vectorized products
+      split(M_inv_all, M_inv_);
     }
 
     /** Compute the normals
@@ -277,47 +442,19 @@ namespace rgbd
     {
       // Compute B
       Mat_<Vec3T> B(rows_, cols_);
-
-      const T* row_r = r.ptr < T > (0), *row_r_end = row_r + rows_ * cols_;
-      const Vec3T *row_V = V_[0];
-      Vec3T *row_B = B[0];
-      for (; row_r != row_r_end; ++row_r, ++row_B, ++row_V)
-      {
-        if (cvIsNaN(*row_r))
-          *row_B = Vec3T();
-        else
-          *row_B = (*row_V) / (*row_r);
-      }
+      parallel_for_(Range(0, rows_), FALSRadiusBody<T>(V_, r, B));
 
       // Apply a box filter to B
       boxFilter(B, B, B.depth(), Size(window_size_, window_size_), Point(-1, -1), false);
 
       // compute the Minv*B products
-      row_r = r.ptr < T > (0);
-      const Vec3T * B_vec = B[0];
-      const Mat33T * M_inv = reinterpret_cast<const Mat33T *>(M_inv_.ptr(0));
-      Vec3T *normal = normals.ptr<Vec3T>(0);
-      for (; row_r != row_r_end; ++row_r, ++B_vec, ++normal, ++M_inv)
-        if (cvIsNaN(*row_r))
-        {
-          (*normal)[0] = *row_r;
-          (*normal)[1] = *row_r;
-          (*normal)[2] = *row_r;
-        }
-        else
-        {
-            Mat33T Mr = *M_inv;
-            Vec3T Br = *B_vec;
-            Vec3T MBr(Mr(0, 0) * Br[0] + Mr(0, 1)*Br[1] + Mr(0, 2)*Br[2],
-                      Mr(1, 0) * Br[0] + Mr(1, 1)*Br[1] + Mr(1, 2)*Br[2],
-                      Mr(2, 0) * Br[0] + Mr(2, 1)*Br[1] + Mr(2, 2)*Br[2]);
-           signNormal(MBr, *normal);
-        }
+      parallel_for_(Range(0, rows_), FALSNormalsBody<T>(M_inv_, B, r, normals));
     }
 
   private:
     Mat_<Vec3T> V_;
-    Mat_<Vec9T> M_inv_;
+    /** The 9 coefficients of the per pixel inverse of M, one plane each */
+    std::vector<Mat> M_inv_;
   };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -339,73 +476,99 @@ multiply_by_K_inv(const Matx<T, 3, 3> & K_inv, U a, U b, U c, Vec<T, 3> &res)
   res[2] = (T)c;
 }
 
-  /** Given a depth image, compute the normals as detailed in the LINEMOD paper
-   * ``Gradient Response Maps for Real-Time Detection of Texture-Less Objects``
-   * by S. Hinterstoisser, C. Cagniart, S. Ilic, P. Sturm, N. Navab, P. Fua, and V. Lepetit
+  /** Vectorized part of a row of LINEMOD normals from x to x_end, returns the first pixel not processed
    */
-  template<typename T>
-  class LINEMOD: public RgbdNormalsImpl
+  template<typename T, typename DepthDepth>
+  inline int
+  linemodNormalsRowSIMD(const DepthDepth*, int, int x, int, int, const Matx<T, 3, 3> &, Vec<T, 3>*)
+  {
+    return x;
+  }
+
+#if CV_SIMD128
+  /** Same computation as LinemodNormalsBody for 4 pixels at a time of a float depth image
+   */
+  template<>
+  inline int
+  linemodNormalsRowSIMD<float, float>(const float* p_line, int step, int x, int x_end, int y,
+                                      const Matx<float, 3, 3> &K_inv, Vec3f* normal)
+  {
+    const int r = 5;
+    const v_float32x4 vzero = v_setall_f32(0.f), vone = v_setall_f32(1.f), vsign = v_setall_f32(-0.f);
+    const v_float32x4 difference_threshold = v_setall_f32(50.f);
+    const v_float32x4 k00 = v_setall_f32(K_inv(0, 0)), k01 = v_setall_f32(K_inv(0, 1)), k02 = v_setall_f32(K_inv(0, 2));
+    const v_float32x4 k11 = v_setall_f32(K_inv(1, 1)), k12 = v_setall_f32(K_inv(1, 2));
+    const v_float32x4 vy = v_setall_f32((float)y), vx_offsets(0.f, 1.f, 2.f, 3.f);
+
+    for (; x <= x_end - 4; x += 4)
+    {
+      const float *p = p_line + x;
+      v_float32x4 d = v_load(p);
+
+      // accum
+      v_float32x4 A0 = vzero, A1 = vzero, A3 = vzero, b0 = vzero, b1 = vzero;
+      for (int j = -r; j <= r; j += r)
+        for (int i = -r; i <= r; i += r)
+        {
+          v_float32x4 delta = v_load(p + j * step + i) - d;
+          // written as a negation so that NaN neighbors are accumulated like in the scalar code
+          v_float32x4 keep = ~(v_abs(delta) > difference_threshold);
+          A0 += keep & v_setall_f32((float)(i * i));
+          A1 += keep & v_setall_f32((float)(i * j));
+          A3 += keep & v_setall_f32((float)(j * j));
+          b0 += keep & (v_setall_f32((float)i) * delta);
+          b1 += keep & (v_setall_f32((float)j) * delta);
+        }
+
+      // solve for the optimal gradient, non normalized by det
+      v_float32x4 det = A0 * A3 - A1 * A1;
+      v_float32x4 dx = A3 * b0 - A1 * b1;
+      v_float32x4 dy = A0 * b1 - A1 * b0;
+
+      v_float32x4 vx = v_setall_f32((float)x) + vx_offsets;
+      v_float32x4 d_det = d * det;
+      v_float32x4 a = d_det + (vx + vone) * dx, b = vy * dx;
+      v_float32x4 X1_0 = k00 * a + k01 * b + k02 * dx, X1_1 = k11 * b + k12 * dx;
+      a = vx * dy;
+      b = d_det + (vy + vone) * dy;
+      v_float32x4 X2_0 = k00 * a + k01 * b + k02 * dy, X2_1 = k11 * b + k12 * dy;
+
+      v_float32x4 n0 = X1_1 * dy - dx * X2_1;
+      v_float32x4 n1 = dx * X2_0 - X1_0 * dy;
+      v_float32x4 n2 = X1_0 * X2_1 - X1_1 * X2_0;
+
+      v_float32x4 scale = vone / v_sqrt(n0 * n0 + n1 * n1 + n2 * n2);
+      scale = scale ^ ((n2 > vzero) & vsign);
+      v_store_interleave(normal[x].val, n0 * scale, n1 * scale, n2 * scale);
+    }
+    return x;
+  }
+#endif
+
+  /** Computes the LINEMOD normals over rows
+   */
+  template<typename T, typename DepthDepth, typename ContainerDepth>
+  class LinemodNormalsBody: public ParallelLoopBody
   {
   public:
     typedef Vec<T, 3> Vec3T;
     typedef Matx<T, 3, 3> Mat33T;
 
-    LINEMOD(int rows, int cols, int window_size, int depth, const Mat &K,
-            RgbdNormals::RGBD_NORMALS_METHOD method)
+    LinemodNormalsBody(const Mat_<DepthDepth> &depth, const Mat33T &K_inv, Mat &normals)
         :
-          RgbdNormalsImpl(rows, cols, window_size, depth, K, method)
-    {
-    }
-
-    /** Compute cached data
-     */
-    virtual void
-    cache()
+          depth_(depth),
+          K_inv_(K_inv),
+          normals_(normals)
     {
     }
 
-    /** Compute the normals
-     * @param r
-     * @param normals the output normals
-     */
     void
-    compute(const Mat& depth_in, Mat & normals) const
-    {
-      switch (depth_in.depth())
-      {
-        case CV_16U:
-        {
-          const Mat_<unsigned short> &depth(depth_in);
-          computeImpl<unsigned short, long>(depth, normals);
-          break;
-        }
-        case CV_32F:
-        {
-          const Mat_<float> &depth(depth_in);
-          computeImpl<float, float>(depth, normals);
-          break;
-        }
-        case CV_64F:
-        {
-          const Mat_<double> &depth(depth_in);
-          computeImpl<double, double>(depth, normals);
-          break;
-        }
-      }
-    }
-
-  private:
-    /** Compute the normals
-     * @param r
-     * @return
-     */
-    template<typename DepthDepth, typename ContainerDepth>
-    Mat
-    computeImpl(const Mat_<DepthDepth> &depth, Mat & normals) const
+    operator()(const Range& range) const
     {
       const int r = 5; // used to be 7
       const int sample_step = r;
       const int square_size = ((2 * r / sample_step) + 1);
+      const int step = (int)depth_.step1();
       long offsets[square_size * square_size];
       long offsets_x[square_size * square_size];
       long offsets_y[square_size * square_size];
@@ -420,30 +583,21 @@ multiply_by_K_inv(const Matx<T, 3, 3> & K_inv, U a, U b, U c, Vec<T, 3> &res)
           offsets_x_x[index] = i*i;
           offsets_x_y[index] = i*j;
           offsets_y_y[index] = j*j;
-          offsets[index] = j * cols_ + i;
+          offsets[index] = j * step + i;
         }
 
-      // Define K_inv by hand, just for higher accuracy
-      Mat33T K_inv = Matx<T, 3, 3>::eye(), K;
-      K_.copyTo(K);
-      K_inv(0, 0) = 1.0f / K(0, 0);
-      K_inv(0, 1) = -K(0, 1) / (K(0, 0) * K(1, 1));
-      K_inv(0, 2) = (K(0, 1) * K(1, 2) - K(0, 2) * K(1, 1)) / (K(0, 0) * K(1, 1));
-      K_inv(1, 1) = 1 / K(1, 1);
-      K_inv(1, 2) = -K(1, 2) / K(1, 1);
-
       Vec3T X1_minus_X, X2_minus_X;
 
       ContainerDepth difference_threshold = 50;
-      normals.setTo(std::numeric_limits<DepthDepth>::quiet_NaN());
-      for (int y = r; y < rows_ - r - 1; ++y)
+      const int x_end = depth_.cols - r - 1;
+      for (int y = range.start; y < range.end; ++y)
       {
-        const DepthDepth * p_line = reinterpret_cast<const DepthDepth*>(depth.ptr(y, r));
-        Vec3T *normal = normals.ptr<Vec3T>(y, r);
+        const DepthDepth * p_line = depth_[y];
+        Vec3T *normal = normals_.ptr<Vec3T>(y);
 
-        for (int x = r; x < cols_ - r - 1; ++x)
+        for (int x = linemodNormalsRowSIMD<T, DepthDepth>(p_line, step, r, x_end, y, K_inv_, normal); x < x_end; ++x)
         {
-          DepthDepth d = p_line[0];
+          DepthDepth d = p_line[x];
 
           // accum
           long A[4];
@@ -452,7 +606,7 @@ multiply_by_K_inv(const Matx<T, 3, 3> & K_inv, U a, U b, U c, Vec<T, 3> &res)
           b[0] = b[1] = 0;
           for (unsigned int i = 0; i < square_size * square_size; ++i) {
             // We need to cast to ContainerDepth in case we have unsigned DepthDepth
-            ContainerDepth delta = ContainerDepth(p_line[offsets[i]]) - ContainerDepth(d);
+            ContainerDepth delta = ContainerDepth(p_line[x + offsets[i]]) - ContainerDepth(d);
             if (std::abs(delta) > difference_threshold)
                continue;
 
@@ -476,18 +630,105 @@ multiply_by_K_inv(const Matx<T, 3, 3> & K_inv, U a, U b, U c, Vec<T, 3> &res)
           //Vec3T X1 = K_inv * Vec3T(x + 1, y, 1) * (depth(y, x) + dx);
           //Vec3T X2 = K_inv * Vec3T(x, y + 1, 1) * (depth(y, x) + dy);
           //Vec3T nor = (X1 - X).cross(X2 - X);
-          multiply_by_K_inv(K_inv, d * det + (x + 1) * dx, y * dx, dx, X1_minus_X);
-          multiply_by_K_inv(K_inv, x * dy, d * det + (y + 1) * dy, dy, X2_minus_X);
+          multiply_by_K_inv(K_inv_, d * det + (x + 1) * dx, y * dx, dx, X1_minus_X);
+          multiply_by_K_inv(K_inv_, x * dy, d * det + (y + 1) * dy, dy, X2_minus_X);
           Vec3T nor = X1_minus_X.cross(X2_minus_X);
-          signNormal(nor, *normal);
+          signNormal(nor, normal[x]);
+        }
+      }
+    }
+
+  private:
+    const Mat_<DepthDepth> &depth_;
+    Mat33T K_inv_;
+    Mat &normals_;
+
+    LinemodNormalsBody& operator=(const LinemodNormalsBody&);
+  };
+
+  /** Given a depth image, compute the normals as detailed in the LINEMOD paper
+   * ``Gradient Response Maps for Real-Time Detection of Texture-Less Objects``
+   * by S. Hinterstoisser, C. Cagniart, S. Ilic, P. Sturm, N. Navab, P. Fua, and V. Lepetit
+   */
+  template<typename T>
+  class LINEMOD: public RgbdNormalsImpl
+  {
+  public:
+    typedef Vec<T, 3> Vec3T;
+    typedef Matx<T, 3, 3> Mat33T;
 
-          ++p_line;
-          ++normal;
+    LINEMOD(int rows, int cols, int window_size, int depth, const Mat &K,
+            RgbdNormals::RGBD_NORMALS_METHOD method)
+        :
+          RgbdNormalsImpl(rows, cols, window_size, depth, K, method)
+    {
+    }
+
+    /** Compute cached data
+     */
+    virtual void
+    cache()
+    {
+      // Define K_inv by hand, just for higher accuracy
+      Mat33T K;
+      K_.copyTo(K);
+      K_inv_ = Mat33T::eye();
+      K_inv_(0, 0) = 1.0f / K(0, 0);
+      K_inv_(0, 1) = -K(0, 1) / (K(0, 0) * K(1, 1));
+      K_inv_(0, 2) = (K(0, 1) * K(1, 2) - K(0, 2) * K(1, 1)) / (K(0, 0) * K(1, 1));
+      K_inv_(1, 1) = 1 / K(1, 1);
+      K_inv_(1, 2) = -K(1, 2) / K(1, 1);
+    }
+
+    /** Compute the normals
+     * @param r
+     * @param normals the output normals
+     */
+    void
+    compute(const Mat& depth_in, Mat & normals) const
+    {
+      switch (depth_in.depth())
+      {
+        case CV_16U:
+        {
+          const Mat_<unsigned short> &depth(depth_in);
+          computeImpl<unsigned short, long>(depth, normals);
+          break;
+        }
+        case CV_32F:
+        {
+          const Mat_<float> &depth(depth_in);
+          computeImpl<float, float>(depth, normals);
+          break;
+        }
+        case CV_64F:
+        {
+          const Mat_<double> &depth(depth_in);
+          computeImpl<double, double>(depth, normals);
+          break;
         }
       }
+    }
+
+  private:
+    /** Compute the normals
+     * @param r
+     * @return
+     */
+    template<typename DepthDepth, typename ContainerDepth>
+    Mat
+    computeImpl(const Mat_<DepthDepth> &depth, Mat & normals) const
+    {
+      const int r = 5;
+      normals.setTo(std::numeric_limits<DepthDepth>::quiet_NaN());
+      if (rows_ > 2 * r + 1)
+        parallel_for_(Range(r, rows_ - r - 1),
+                      LinemodNormalsBody<T, DepthDepth, ContainerDepth>(depth, K_inv_, normals));
 
       return normals;
     }
+
+    Mat33T K_inv_;
   };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -859,7 +1100,7 @@ multiply_by_K_inv(const Matx<T, 3, 3> & K_inv, U a, U b, U c, Vec<T, 3> &res)
         if (points3d_ori.channels() == 3)
         {
           std::vector<Mat> channels;
-          split(points3d, channels);
+          split(points3d_ori, channels);
           depth = channels[2];
         }
         else
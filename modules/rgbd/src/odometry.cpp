@@ -216,7 +216,8 @@ void preparePyramidMask(const Mat& mask, const std::vector<Mat>& pyramidDepth, f
 }
 
 static
-void preparePyramidCloud(const std::vector<Mat>& pyramidDepth, const Mat& cameraMatrix, std::vector<Mat>& pyramidCloud)
+void preparePyramidCloud(const std::vector<Mat>& pyramidDepth, const Mat& cameraMatrix, std::vector<Mat>& pyramidCloud,
+                         const std::vector<Mat>& pool)
 {
     if(!pyramidCloud.empty())
     {
@@ -237,7 +238,7 @@ void preparePyramidCloud(const std::vector<Mat>& pyramidDepth, const Mat& camera
         pyramidCloud.resize(pyramidDepth.size());
         for(size_t i = 0; i < pyramidDepth.size(); i++)
         {
-            Mat cloud;
+            Mat cloud = i < pool.size() ? pool[i] : Mat();
             depthTo3d(pyramidDepth[i], pyramidCameraMatrix[i], cloud);
             pyramidCloud[i] = cloud;
         }
@@ -245,7 +246,8 @@ void preparePyramidCloud(const std::vector<Mat>& pyramidDepth, const Mat& camera
 }
 
 static
-void preparePyramidSobel(const std::vector<Mat>& pyramidImage, int dx, int dy, std::vector<Mat>& pyramidSobel)
+void preparePyramidSobel(const std::vector<Mat>& pyramidImage, int dx, int dy, std::vector<Mat>& pyramidSobel,
+                         const std::vector<Mat>& pool)
 {
     if(!pyramidSobel.empty())
     {
@@ -263,6 +265,8 @@ void preparePyramidSobel(const std::vector<Mat>& pyramidImage, int dx, int dy, s
         pyramidSobel.resize(pyramidImage.size());
         for(size_t i = 0; i < pyramidImage.size(); i++)
         {
+            if(i < pool.size())
+                pyramidSobel[i] = pool[i];
             Sobel(pyramidImage[i], pyramidSobel[i], CV_16S, dx, dy, sobelSize);
         }
     }
@@ -451,6 +455,75 @@ void computeProjectiveMatrix(const Mat& ksi, Mat& Rt)
 #endif
 }
 
+/* Projects the selected pixels of the second frame to the first one.
+ * Every row is independent, so the rows are processed in parallel.
+ * The result is the pixel each point falls into (-1 if none) and its depth in the first frame.
+ */
+class ProjectPointsBody : public ParallelLoopBody
+{
+public:
+    ProjectPointsBody(const Mat& _depth1, const Mat& _selectMask1, const double* _Kt_ptr,
+                      const float* _KRK_inv0_u1, const float* _KRK_inv1_v1_plus_KRK_inv2,
+                      const float* _KRK_inv3_u1, const float* _KRK_inv4_v1_plus_KRK_inv5,
+                      const float* _KRK_inv6_u1, const float* _KRK_inv7_v1_plus_KRK_inv8,
+                      Mat& _projected, Mat& _transformedDepth) :
+        depth1(_depth1), selectMask1(_selectMask1), Kt_ptr(_Kt_ptr),
+        KRK_inv0_u1(_KRK_inv0_u1), KRK_inv1_v1_plus_KRK_inv2(_KRK_inv1_v1_plus_KRK_inv2),
+        KRK_inv3_u1(_KRK_inv3_u1), KRK_inv4_v1_plus_KRK_inv5(_KRK_inv4_v1_plus_KRK_inv5),
+        KRK_inv6_u1(_KRK_inv6_u1), KRK_inv7_v1_plus_KRK_inv8(_KRK_inv7_v1_plus_KRK_inv8),
+        projected(_projected), transformedDepth(_transformedDepth)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const Rect r(0, 0, depth1.cols, depth1.rows);
+        for(int v1 = range.start; v1 < range.end; v1++)
+        {
+            const float *depth1_row = depth1.ptr<float>(v1);
+            const uchar *mask1_row = selectMask1.ptr<uchar>(v1);
+            Vec2s *projected_row = projected.ptr<Vec2s>(v1);
+            float *transformed_row = transformedDepth.ptr<float>(v1);
+            for(int u1 = 0; u1 < depth1.cols; u1++)
+            {
+                projected_row[u1] = Vec2s(-1, -1);
+                float d1 = depth1_row[u1];
+                if(mask1_row[u1])
+                {
+                    CV_DbgAssert(!cvIsNaN(d1));
+                    float transformed_d1 = static_cast<float>(d1 * (KRK_inv6_u1[u1] + KRK_inv7_v1_plus_KRK_inv8[v1]) +
+                                                              Kt_ptr[2]);
+                    if(transformed_d1 > 0)
+                    {
+                        float transformed_d1_inv = 1.f / transformed_d1;
+                        int u0 = cvRound(transformed_d1_inv * (d1 * (KRK_inv0_u1[u1] + KRK_inv1_v1_plus_KRK_inv2[v1]) +
+                                                               Kt_ptr[0]));
+                        int v0 = cvRound(transformed_d1_inv * (d1 * (KRK_inv3_u1[u1] + KRK_inv4_v1_plus_KRK_inv5[v1]) +
+                                                               Kt_ptr[1]));
+
+                        if(r.contains(Point(u0,v0)))
+                        {
+                            projected_row[u1] = Vec2s((short)u0, (short)v0);
+                            transformed_row[u1] = transformed_d1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const Mat& depth1;
+    const Mat& selectMask1;
+    const double* Kt_ptr;
+    const float *KRK_inv0_u1, *KRK_inv1_v1_plus_KRK_inv2;
+    const float *KRK_inv3_u1, *KRK_inv4_v1_plus_KRK_inv5;
+    const float *KRK_inv6_u1, *KRK_inv7_v1_plus_KRK_inv8;
+    Mat& projected;
+    Mat& transformedDepth;
+
+    ProjectPointsBody& operator=(const ProjectPointsBody&);
+};
+
 static
 void computeCorresps(const Mat& K, const Mat& K_inv, const Mat& Rt,
                      const Mat& depth0, const Mat& validMask0,
@@ -463,7 +536,6 @@ void computeCorresps(const Mat& K, const Mat& K_inv, const Mat& Rt,
 
     Mat corresps(depth1.size(), CV_16SC2, Scalar::all(-1));
 
-    Rect r(0, 0, depth1.cols, depth1.rows);
     Mat Kt = Rt(Rect(3,0,1,3)).clone();
     Kt = K * Kt;
     const double * Kt_ptr = Kt.ptr<const double>();
@@ -495,51 +567,47 @@ void computeCorresps(const Mat& K, const Mat& K_inv, const Mat& Rt,
         }
     }
 
+    Mat projected(depth1.size(), CV_16SC2), transformedDepth(depth1.size(), CV_32FC1);
+    parallel_for_(Range(0, depth1.rows),
+                  ProjectPointsBody(depth1, selectMask1, Kt_ptr,
+                                    KRK_inv0_u1, KRK_inv1_v1_plus_KRK_inv2,
+                                    KRK_inv3_u1, KRK_inv4_v1_plus_KRK_inv5,
+                                    KRK_inv6_u1, KRK_inv7_v1_plus_KRK_inv8,
+                                    projected, transformedDepth));
+
+    // Several points may fall into the same pixel, the nearest one is kept.
+    // This pass is done in the order of the points, so the result does not depend on the threads.
     int correspCount = 0;
     for(int v1 = 0; v1 < depth1.rows; v1++)
     {
-        const float *depth1_row = depth1.ptr<float>(v1);
-        const uchar *mask1_row = selectMask1.ptr<uchar>(v1);
+        const Vec2s *projected_row = projected.ptr<Vec2s>(v1);
+        const float *transformed_row = transformedDepth.ptr<float>(v1);
         for(int u1 = 0; u1 < depth1.cols; u1++)
         {
-            float d1 = depth1_row[u1];
-            if(mask1_row[u1])
+            const Vec2s& p = projected_row[u1];
+            if(p[0] == -1)
+                continue;
+
+            int u0 = p[0], v0 = p[1];
+            float transformed_d1 = transformed_row[u1];
+            float d0 = depth0.at<float>(v0,u0);
+            if(validMask0.at<uchar>(v0, u0) && std::abs(transformed_d1 - d0) <= maxDepthDiff)
             {
-                CV_DbgAssert(!cvIsNaN(d1));
-                float transformed_d1 = static_cast<float>(d1 * (KRK_inv6_u1[u1] + KRK_inv7_v1_plus_KRK_inv8[v1]) +
-                                                          Kt_ptr[2]);
-                if(transformed_d1 > 0)
+                CV_DbgAssert(!cvIsNaN(d0));
+                Vec2s& c = corresps.at<Vec2s>(v0,u0);
+                if(c[0] != -1)
                 {
-                    float transformed_d1_inv = 1.f / transformed_d1;
-                    int u0 = cvRound(transformed_d1_inv * (d1 * (KRK_inv0_u1[u1] + KRK_inv1_v1_plus_KRK_inv2[v1]) +
-                                                           Kt_ptr[0]));
-                    int v0 = cvRound(transformed_d1_inv * (d1 * (KRK_inv3_u1[u1] + KRK_inv4_v1_plus_KRK_inv5[v1]) +
-                                                           Kt_ptr[1]));
+                    int exist_u1 = c[0], exist_v1 = c[1];
 
-                    if(r.contains(Point(u0,v0)))
-                    {
-                        float d0 = depth0.at<float>(v0,u0);
-                        if(validMask0.at<uchar>(v0, u0) && std::abs(transformed_d1 - d0) <= maxDepthDiff)
-                        {
-                            CV_DbgAssert(!cvIsNaN(d0));
-                            Vec2s& c = corresps.at<Vec2s>(v0,u0);
-                            if(c[0] != -1)
-                            {
-                                int exist_u1 = c[0], exist_v1 = c[1];
-
-                                float exist_d1 = (float)(depth1.at<float>(exist_v1,exist_u1) *
-                                    (KRK_inv6_u1[exist_u1] + KRK_inv7_v1_plus_KRK_inv8[exist_v1]) + Kt_ptr[2]);
-
-                                if(transformed_d1 > exist_d1)
-                                    continue;
-                            }
-                            else
-                                correspCount++;
-
-                            c = Vec2s((short)u1, (short)v1);
-                        }
-                    }
+                    float exist_d1 = transformedDepth.at<float>(exist_v1,exist_u1);
+
+                    if(transformed_d1 > exist_d1)
+                        continue;
                 }
+                else
+                    correspCount++;
+
+                c = Vec2s((short)u1, (short)v1);
             }
         }
     }
@@ -631,16 +699,121 @@ void calcICPEquationCoeffsTranslation(double* C, const Point3f& /*p0*/, const Ve
 typedef
 void (*CalcICPEquationCoeffsPtr)(double*, const Point3f&, const Vec3f&);
 
+/* The normal equations are summed over blocks of correspondences in parallel.
+ * The partial sums of the blocks are then added up in the block order,
+ * so the result does not depend on the number of threads.
+ */
+const int lsmBlockSize = 4096;
+
+static inline
+void accumulateLsm(const double* A_ptr, double diff, int transformDim, double* AtA_ptr, double* AtB_ptr)
+{
+    for(int y = 0; y < transformDim; y++)
+    {
+        double* AtA_row = AtA_ptr + y * transformDim;
+        for(int x = y; x < transformDim; x++)
+            AtA_row[x] += A_ptr[y] * A_ptr[x];
+
+        AtB_ptr[y] += A_ptr[y] * diff;
+    }
+}
+
 static
-void calcRgbdLsmMatrices(const Mat& image0, const Mat& cloud0, const Mat& Rt,
-               const Mat& image1, const Mat& dI_dx1, const Mat& dI_dy1,
-               const Mat& corresps, double fx, double fy, double sobelScaleIn,
-               Mat& AtA, Mat& AtB, CalcRgbdEquationCoeffsPtr func, int transformDim)
+void sumLsmBlocks(const std::vector<double>& partial, int transformDim, Mat& AtA, Mat& AtB)
 {
+    const int blockStride = transformDim * transformDim + transformDim;
+    const int blockCount = (int)partial.size() / blockStride;
+
     AtA = Mat(transformDim, transformDim, CV_64FC1, Scalar(0));
     AtB = Mat(transformDim, 1, CV_64FC1, Scalar(0));
+    double* AtA_ptr = AtA.ptr<double>();
     double* AtB_ptr = AtB.ptr<double>();
+    for(int block = 0; block < blockCount; block++)
+    {
+        const double* blockAtA = &partial[block * blockStride];
+        const double* blockAtB = blockAtA + transformDim * transformDim;
+        for(int y = 0; y < transformDim; y++)
+        {
+            for(int x = y; x < transformDim; x++)
+                AtA_ptr[y * transformDim + x] += blockAtA[y * transformDim + x];
+            AtB_ptr[y] += blockAtB[y];
+        }
+    }
+
+    for(int y = 0; y < transformDim; y++)
+        for(int x = y+1; x < transformDim; x++)
+            AtA.at<double>(x,y) = AtA.at<double>(y,x);
+}
+
+class RgbdLsmBody : public ParallelLoopBody
+{
+public:
+    RgbdLsmBody(const Mat& _cloud0, const double* _Rt_ptr, const Mat& _dI_dx1, const Mat& _dI_dy1,
+                const Mat& _corresps, const float* _diffs_ptr, double _sigma, double _fx, double _fy,
+                double _sobelScale, CalcRgbdEquationCoeffsPtr _func, int _transformDim, std::vector<double>& _partial) :
+        cloud0(_cloud0), Rt_ptr(_Rt_ptr), dI_dx1(_dI_dx1), dI_dy1(_dI_dy1), corresps(_corresps),
+        diffs_ptr(_diffs_ptr), sigma(_sigma), fx(_fx), fy(_fy), sobelScale(_sobelScale), func(_func),
+        transformDim(_transformDim), partial(_partial)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const Vec4i* corresps_ptr = corresps.ptr<Vec4i>();
+        const int blockStride = transformDim * transformDim + transformDim;
+        double A_ptr[6];
+        for(int block = range.start; block < range.end; block++)
+        {
+            double* AtA_ptr = &partial[block * blockStride];
+            double* AtB_ptr = AtA_ptr + transformDim * transformDim;
+            const int blockEnd = std::min(corresps.rows, (block + 1) * lsmBlockSize);
+            for(int correspIndex = block * lsmBlockSize; correspIndex < blockEnd; correspIndex++)
+            {
+                const Vec4i& c = corresps_ptr[correspIndex];
+                int u0 = c[0], v0 = c[1];
+                int u1 = c[2], v1 = c[3];
+
+                double w = sigma + std::abs(diffs_ptr[correspIndex]);
+                w = w > DBL_EPSILON ? 1./w : 1.;
 
+                double w_sobelScale = w * sobelScale;
+
+                const Point3f& p0 = cloud0.at<Point3f>(v0,u0);
+                Point3f tp0;
+                tp0.x = (float)(p0.x * Rt_ptr[0] + p0.y * Rt_ptr[1] + p0.z * Rt_ptr[2] + Rt_ptr[3]);
+                tp0.y = (float)(p0.x * Rt_ptr[4] + p0.y * Rt_ptr[5] + p0.z * Rt_ptr[6] + Rt_ptr[7]);
+                tp0.z = (float)(p0.x * Rt_ptr[8] + p0.y * Rt_ptr[9] + p0.z * Rt_ptr[10] + Rt_ptr[11]);
+
+                func(A_ptr,
+                     w_sobelScale * dI_dx1.at<short int>(v1,u1),
+                     w_sobelScale * dI_dy1.at<short int>(v1,u1),
+                     tp0, fx, fy);
+
+                accumulateLsm(A_ptr, w * diffs_ptr[correspIndex], transformDim, AtA_ptr, AtB_ptr);
+            }
+        }
+    }
+
+private:
+    const Mat& cloud0;
+    const double* Rt_ptr;
+    const Mat& dI_dx1;
+    const Mat& dI_dy1;
+    const Mat& corresps;
+    const float* diffs_ptr;
+    double sigma, fx, fy, sobelScale;
+    CalcRgbdEquationCoeffsPtr func;
+    int transformDim;
+    std::vector<double>& partial;
+
+    RgbdLsmBody& operator=(const RgbdLsmBody&);
+};
+
+static
+void calcRgbdLsmMatrices(const Mat& image0, const Mat& cloud0, const Mat& Rt,
+               const Mat& image1, const Mat& dI_dx1, const Mat& dI_dy1,
+               const Mat& corresps, double fx, double fy, double sobelScaleIn,
+               Mat& AtA, Mat& AtB, CalcRgbdEquationCoeffsPtr func, int transformDim)
+{
     const int correspsCount = corresps.rows;
 
     CV_Assert(Rt.type() == CV_64FC1);
@@ -664,45 +837,60 @@ void calcRgbdLsmMatrices(const Mat& image0, const Mat& cloud0, const Mat& Rt,
     }
     sigma = std::sqrt(sigma/correspsCount);
 
-    std::vector<double> A_buf(transformDim);
-    double* A_ptr = &A_buf[0];
+    const int blockCount = (correspsCount + lsmBlockSize - 1) / lsmBlockSize;
+    std::vector<double> partial(blockCount * (transformDim * transformDim + transformDim), 0.);
+    parallel_for_(Range(0, blockCount),
+                  RgbdLsmBody(cloud0, Rt_ptr, dI_dx1, dI_dy1, corresps, diffs_ptr, sigma, fx, fy, sobelScaleIn,
+                              func, transformDim, partial));
+    sumLsmBlocks(partial, transformDim, AtA, AtB);
+}
 
-    for(int correspIndex = 0; correspIndex < corresps.rows; correspIndex++)
+class ICPLsmBody : public ParallelLoopBody
+{
+public:
+    ICPLsmBody(const Mat& _normals1, const Mat& _corresps, const Point3f* _tps0_ptr, const float* _diffs_ptr,
+               double _sigma, CalcICPEquationCoeffsPtr _func, int _transformDim, std::vector<double>& _partial) :
+        normals1(_normals1), corresps(_corresps), tps0_ptr(_tps0_ptr), diffs_ptr(_diffs_ptr), sigma(_sigma),
+        func(_func), transformDim(_transformDim), partial(_partial)
+    {}
+
+    void operator()(const Range& range) const
     {
-         const Vec4i& c = corresps_ptr[correspIndex];
-         int u0 = c[0], v0 = c[1];
-         int u1 = c[2], v1 = c[3];
-
-         double w = sigma + std::abs(diffs_ptr[correspIndex]);
-         w = w > DBL_EPSILON ? 1./w : 1.;
-
-         double w_sobelScale = w * sobelScaleIn;
+        const Vec4i* corresps_ptr = corresps.ptr<Vec4i>();
+        const int blockStride = transformDim * transformDim + transformDim;
+        double A_ptr[6];
+        for(int block = range.start; block < range.end; block++)
+        {
+            double* AtA_ptr = &partial[block * blockStride];
+            double* AtB_ptr = AtA_ptr + transformDim * transformDim;
+            const int blockEnd = std::min(corresps.rows, (block + 1) * lsmBlockSize);
+            for(int correspIndex = block * lsmBlockSize; correspIndex < blockEnd; correspIndex++)
+            {
+                const Vec4i& c = corresps_ptr[correspIndex];
+                int u1 = c[2], v1 = c[3];
 
-         const Point3f& p0 = cloud0.at<Point3f>(v0,u0);
-         Point3f tp0;
-         tp0.x = (float)(p0.x * Rt_ptr[0] + p0.y * Rt_ptr[1] + p0.z * Rt_ptr[2] + Rt_ptr[3]);
-         tp0.y = (float)(p0.x * Rt_ptr[4] + p0.y * Rt_ptr[5] + p0.z * Rt_ptr[6] + Rt_ptr[7]);
-         tp0.z = (float)(p0.x * Rt_ptr[8] + p0.y * Rt_ptr[9] + p0.z * Rt_ptr[10] + Rt_ptr[11]);
+                double w = sigma + std::abs(diffs_ptr[correspIndex]);
+                w = w > DBL_EPSILON ? 1./w : 1.;
 
-         func(A_ptr,
-              w_sobelScale * dI_dx1.at<short int>(v1,u1),
-              w_sobelScale * dI_dy1.at<short int>(v1,u1),
-              tp0, fx, fy);
+                func(A_ptr, tps0_ptr[correspIndex], normals1.at<Vec3f>(v1, u1) * w);
 
-        for(int y = 0; y < transformDim; y++)
-        {
-            double* AtA_ptr = AtA.ptr<double>(y);
-            for(int x = y; x < transformDim; x++)
-                AtA_ptr[x] += A_ptr[y] * A_ptr[x];
-
-            AtB_ptr[y] += A_ptr[y] * w * diffs_ptr[correspIndex];
+                accumulateLsm(A_ptr, w * diffs_ptr[correspIndex], transformDim, AtA_ptr, AtB_ptr);
+            }
         }
     }
 
-    for(int y = 0; y < transformDim; y++)
-        for(int x = y+1; x < transformDim; x++)
-            AtA.at<double>(x,y) = AtA.at<double>(y,x);
-}
+private:
+    const Mat& normals1;
+    const Mat& corresps;
+    const Point3f* tps0_ptr;
+    const float* diffs_ptr;
+    double sigma;
+    CalcICPEquationCoeffsPtr func;
+    int transformDim;
+    std::vector<double>& partial;
+
+    ICPLsmBody& operator=(const ICPLsmBody&);
+};
 
 static
 void calcICPLsmMatrices(const Mat& cloud0, const Mat& Rt,
@@ -710,10 +898,6 @@ void calcICPLsmMatrices(const Mat& cloud0, const Mat& Rt,
                         const Mat& corresps,
                         Mat& AtA, Mat& AtB, CalcICPEquationCoeffsPtr func, int transformDim)
 {
-    AtA = Mat(transformDim, transformDim, CV_64FC1, Scalar(0));
-    AtB = Mat(transformDim, 1, CV_64FC1, Scalar(0));
-    double* AtB_ptr = AtB.ptr<double>();
-
     const int correspsCount = corresps.rows;
 
     CV_Assert(Rt.type() == CV_64FC1);
@@ -750,31 +934,11 @@ void calcICPLsmMatrices(const Mat& cloud0, const Mat& Rt,
 
     sigma = std::sqrt(sigma/correspsCount);
 
-    std::vector<double> A_buf(transformDim);
-    double* A_ptr = &A_buf[0];
-    for(int correspIndex = 0; correspIndex < corresps.rows; correspIndex++)
-    {
-        const Vec4i& c = corresps_ptr[correspIndex];
-        int u1 = c[2], v1 = c[3];
-
-        double w = sigma + std::abs(diffs_ptr[correspIndex]);
-        w = w > DBL_EPSILON ? 1./w : 1.;
-
-        func(A_ptr, tps0_ptr[correspIndex], normals1.at<Vec3f>(v1, u1) * w);
-
-        for(int y = 0; y < transformDim; y++)
-        {
-            double* AtA_ptr = AtA.ptr<double>(y);
-            for(int x = y; x < transformDim; x++)
-                AtA_ptr[x] += A_ptr[y] * A_ptr[x];
-
-            AtB_ptr[y] += A_ptr[y] * w * diffs_ptr[correspIndex];
-        }
-    }
-
-    for(int y = 0; y < transformDim; y++)
-        for(int x = y+1; x < transformDim; x++)
-            AtA.at<double>(x,y) = AtA.at<double>(y,x);
+    const int blockCount = (correspsCount + lsmBlockSize - 1) / lsmBlockSize;
+    std::vector<double> partial(blockCount * (transformDim * transformDim + transformDim), 0.);
+    parallel_for_(Range(0, blockCount),
+                  ICPLsmBody(normals1, corresps, tps0_ptr, diffs_ptr, sigma, func, transformDim, partial));
+    sumLsmBlocks(partial, transformDim, AtA, AtB);
 }
 
 static
@@ -1021,6 +1185,27 @@ void OdometryFrame::release()
 {
     RgbdFrame::release();
     releasePyramids();
+
+    pyramidCloudPool.clear();
+    pyramid_dI_dxPool.clear();
+    pyramid_dI_dyPool.clear();
+}
+
+void OdometryFrame::reset(const Mat& image_in, const Mat& depth_in, const Mat& mask_in, const Mat& normals_in, int ID_in)
+{
+    if(!pyramidCloud.empty())
+        pyramidCloudPool.swap(pyramidCloud);
+    if(!pyramid_dI_dx.empty())
+        pyramid_dI_dxPool.swap(pyramid_dI_dx);
+    if(!pyramid_dI_dy.empty())
+        pyramid_dI_dyPool.swap(pyramid_dI_dy);
+    releasePyramids();
+
+    ID = ID_in;
+    image = image_in;
+    depth = depth_in;
+    mask = mask_in;
+    normals = normals_in;
 }
 
 void OdometryFrame::releasePyramids()
@@ -1062,6 +1247,46 @@ bool Odometry::compute(Ptr<OdometryFrame>& srcFrame, Ptr<OdometryFrame>& dstFram
     return computeImpl(srcFrame, dstFrame, Rt, initRt);
 }
 
+bool Odometry::compute(const Mat& image, const Mat& depth, const Mat& mask, Mat& Rt, const Mat& initRt)
+{
+    checkParams();
+
+    Ptr<OdometryFrame> frame = spareFrame.empty() ? makePtr<OdometryFrame>() : spareFrame;
+    spareFrame.release();
+
+    // the data is copied into the buffers of the recycled frame, so the caller may reuse its own ones
+    Mat frameImage = frame->image, frameDepth = frame->depth, frameMask = frame->mask;
+    image.copyTo(frameImage);
+    depth.copyTo(frameDepth);
+    mask.copyTo(frameMask);
+    frame->reset(frameImage, frameDepth, frameMask);
+
+    // the frame is the destination now and the source of the next call
+    Size size = prepareFrameCache(frame, OdometryFrame::CACHE_ALL);
+
+    bool isOk = false;
+    if(prevFrame.empty())
+        Rt = Mat::eye(4, 4, CV_64FC1);
+    else
+    {
+        Size prevSize = prepareFrameCache(prevFrame, OdometryFrame::CACHE_SRC);
+        if(prevSize != size)
+            CV_Error(Error::StsBadSize, "The frames of a sequence have to have the same size (resolution).");
+
+        isOk = computeImpl(prevFrame, frame, Rt, initRt);
+    }
+
+    spareFrame = prevFrame;
+    prevFrame = frame;
+    return isOk;
+}
+
+void Odometry::clear()
+{
+    prevFrame.release();
+    spareFrame.release();
+}
+
 Size Odometry::prepareFrameCache(Ptr<OdometryFrame> &frame, int /*cacheType*/) const
 {
     if(frame == 0)
@@ -1157,12 +1382,12 @@ Size RgbdOdometry::prepareFrameCache(Ptr<OdometryFrame>& frame, int cacheType) c
                        frame->pyramidNormals, frame->pyramidMask);
 
     if(cacheType & OdometryFrame::CACHE_SRC)
-        preparePyramidCloud(frame->pyramidDepth, cameraMatrix, frame->pyramidCloud);
+        preparePyramidCloud(frame->pyramidDepth, cameraMatrix, frame->pyramidCloud, frame->pyramidCloudPool);
 
     if(cacheType & OdometryFrame::CACHE_DST)
     {
-        preparePyramidSobel(frame->pyramidImage, 1, 0, frame->pyramid_dI_dx);
-        preparePyramidSobel(frame->pyramidImage, 0, 1, frame->pyramid_dI_dy);
+        preparePyramidSobel(frame->pyramidImage, 1, 0, frame->pyramid_dI_dx, frame->pyramid_dI_dxPool);
+        preparePyramidSobel(frame->pyramidImage, 0, 1, frame->pyramid_dI_dy, frame->pyramid_dI_dyPool);
         preparePyramidTexturedMask(frame->pyramid_dI_dx, frame->pyramid_dI_dy, minGradientMagnitudes,
                                    frame->pyramidMask, maxPointsPart, frame->pyramidTexturedMask);
     }
@@ -1230,7 +1455,7 @@ Size ICPOdometry::prepareFrameCache(Ptr<OdometryFrame>& frame, int cacheType) co
 
     preparePyramidDepth(frame->depth, frame->pyramidDepth, iterCounts.total());
 
-    preparePyramidCloud(frame->pyramidDepth, cameraMatrix, frame->pyramidCloud);
+    preparePyramidCloud(frame->pyramidDepth, cameraMatrix, frame->pyramidCloud, frame->pyramidCloudPool);
 
     if(cacheType & OdometryFrame::CACHE_DST)
     {
@@ -1344,7 +1569,7 @@ Size RgbdICPOdometry::prepareFrameCache(Ptr<OdometryFrame>& frame, int cacheType
 
     preparePyramidDepth(frame->depth, frame->pyramidDepth, iterCounts.total());
 
-    preparePyramidCloud(frame->pyramidDepth, cameraMatrix, frame->pyramidCloud);
+    preparePyramidCloud(frame->pyramidDepth, cameraMatrix, frame->pyramidCloud, frame->pyramidCloudPool);
 
     if(cacheType & OdometryFrame::CACHE_DST)
     {
@@ -1375,8 +1600,8 @@ Size RgbdICPOdometry::prepareFrameCache(Ptr<OdometryFrame>& frame, int cacheType
         preparePyramidMask(frame->mask, frame->pyramidDepth, (float)minDepth, (float)maxDepth,
                            frame->pyramidNormals, frame->pyramidMask);
 
-        preparePyramidSobel(frame->pyramidImage, 1, 0, frame->pyramid_dI_dx);
-        preparePyramidSobel(frame->pyramidImage, 0, 1, frame->pyramid_dI_dy);
+        preparePyramidSobel(frame->pyramidImage, 1, 0, frame->pyramid_dI_dx, frame->pyramid_dI_dxPool);
+        preparePyramidSobel(frame->pyramidImage, 0, 1, frame->pyramid_dI_dy, frame->pyramid_dI_dyPool);
         preparePyramidTexturedMask(frame->pyramid_dI_dx, frame->pyramid_dI_dy,
                                    minGradientMagnitudes, frame->pyramidMask,
                                    maxPointsPart, frame->pyramidTexturedMask);
@@ -45,6 +45,9 @@
 
 #include "precomp.hpp"
 
+#include <algorithm>
+#include <functional>
+
 namespace cv
 {
 namespace rgbd
@@ -57,9 +60,9 @@ public:
       :
         index_(index),
         n_(n_in),
-        m_sum_(Vec3f(0, 0, 0)),
+        m_sum_(Vec3d(0, 0, 0)),
         m_(m),
-        Q_(Matx33f::zeros()),
+        Q_(Vec6d::all(0)),
         mse_(0),
         K_(0)
   {
@@ -105,9 +108,12 @@ public:
   {
     if (empty())
       return;
-    m_ = m_sum_ / K_;
+    Vec3d m = m_sum_ / K_;
+    m_ = m;
     // Compute C
-    Matx33f C = Q_ - m_sum_ * m_.t();
+    Matx33f C((float)(Q_[0] - m_sum_[0] * m[0]), (float)(Q_[1] - m_sum_[0] * m[1]), (float)(Q_[2] - m_sum_[0] * m[2]),
+              (float)(Q_[1] - m_sum_[1] * m[0]), (float)(Q_[3] - m_sum_[1] * m[1]), (float)(Q_[4] - m_sum_[1] * m[2]),
+              (float)(Q_[2] - m_sum_[2] * m[0]), (float)(Q_[4] - m_sum_[2] * m[1]), (float)(Q_[5] - m_sum_[2] * m[2]));
 
     // Compute n
     SVD svd(C);
@@ -120,10 +126,11 @@ public:
   /** Update the different sum of point and sum of point*point.t()
    */
   void
-  UpdateStatistics(const Vec3f & point, const Matx33f & Q_local)
+  UpdateStatistics(const Vec3f & point)
   {
-    m_sum_ += point;
-    Q_ += Q_local;
+    const double x = point[0], y = point[1], z = point[2];
+    m_sum_ += Vec3d(x, y, z);
+    Q_ += Vec6d(x * x, x * y, x * z, y * y, y * z, z * z);
     ++K_;
   }
 
@@ -152,13 +159,11 @@ private:
     d_ = -m_.dot(n_);
   }
   /** The sum of the points */
-  Vec3f m_sum_;
+  Vec3d m_sum_;
   /** The mean of the points */
   Vec3f m_;
-  /** The sum of pi * pi^\top */
-  Matx33f Q_;
-  /** The different matrices we need to update */
-  Matx33f C_;
+  /** The upper triangle of the sum of pi * pi^\top (xx, xy, xz, yy, yz, zz) */
+  Vec6d Q_;
   float mse_;
   /** the number of points that form the plane */
   int K_;
@@ -222,61 +227,48 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-/** The PlaneGrid contains statistic about the individual tiles
+/** Fits a plane to every tile of the grid, the tiles being processed in parallel
  */
-class PlaneGrid
+class PlaneGridBody: public ParallelLoopBody
 {
 public:
-  PlaneGrid(const Mat_<Vec3f> & points3d, int block_size)
+  PlaneGridBody(const Mat_<Vec3f> & points3d, int block_size, Mat_<Vec3f> & m, Mat_<Vec3f> & n, Mat_<float> & mse)
       :
-        block_size_(block_size)
+        points3d_(points3d),
+        block_size_(block_size),
+        m_(m),
+        n_(n),
+        mse_(mse)
   {
-    // Figure out some dimensions
-    int mini_rows = points3d.rows / block_size;
-    if (points3d.rows % block_size != 0)
-      ++mini_rows;
-
-    int mini_cols = points3d.cols / block_size;
-    if (points3d.cols % block_size != 0)
-      ++mini_cols;
+  }
 
-    // Compute all the interesting quantities
-    m_.create(mini_rows, mini_cols);
-    n_.create(mini_rows, mini_cols);
-    Q_.create(points3d.rows, points3d.cols);
-    mse_.create(mini_rows, mini_cols);
-    for (int y = 0; y < mini_rows; ++y)
-      for (int x = 0; x < mini_cols; ++x)
+  void
+  operator()(const Range& range) const
+  {
+    for (int y = range.start; y < range.end; ++y)
+      for (int x = 0; x < mse_.cols; ++x)
       {
-        // Update the tiles
-        Matx33f Q = Matx33f::zeros();
-        Vec3f m = Vec3f(0, 0, 0);
+        // Accumulate the moments of the tile
+        double sx = 0, sy = 0, sz = 0, sxx = 0, sxy = 0, sxz = 0, syy = 0, syz = 0, szz = 0;
         int K = 0;
-        for (int j = y * block_size; j < std::min((y + 1) * block_size, points3d.rows); ++j)
+        int x_end = (x == mse_.cols - 1) ? points3d_.cols : (x + 1) * block_size_;
+        for (int j = y * block_size_; j < std::min((y + 1) * block_size_, points3d_.rows); ++j)
         {
-          const Vec3f * vec = points3d.ptr < Vec3f > (j, x * block_size), *vec_end;
-          float * pointpointt = reinterpret_cast<float*>(Q_.ptr < Vec<float, 9> > (j, x * block_size));
-          if (x == mini_cols - 1)
-            vec_end = points3d.ptr < Vec3f > (j, points3d.cols - 1) + 1;
-          else
-            vec_end = vec + block_size;
-          for (; vec != vec_end; ++vec, pointpointt += 9)
+          const Vec3f * vec = points3d_.ptr < Vec3f > (j, x * block_size_), *vec_end = points3d_.ptr < Vec3f > (j) + x_end;
+          for (; vec != vec_end; ++vec)
           {
             if (cvIsNaN(vec->val[0]))
               continue;
-            // Fill point*point.t()
-            *pointpointt = vec->val[0] * vec->val[0];
-            *(pointpointt + 1) = vec->val[0] * vec->val[1];
-            *(pointpointt + 2) = vec->val[0] * vec->val[2];
-            *(pointpointt + 3) = *(pointpointt + 1);
-            *(pointpointt + 4) = vec->val[1] * vec->val[1];
-            *(pointpointt + 5) = vec->val[1] * vec->val[2];
-            *(pointpointt + 6) = *(pointpointt + 2);
-            *(pointpointt + 7) = *(pointpointt + 5);
-            *(pointpointt + 8) = vec->val[2] * vec->val[2];
-
-            Q += *reinterpret_cast<Matx33f*>(pointpointt);
-            m += (*vec);
+            const double px = vec->val[0], py = vec->val[1], pz = vec->val[2];
+            sx += px;
+            sy += py;
+            sz += pz;
+            sxx += px * px;
+            sxy += px * py;
+            sxz += px * pz;
+            syy += py * py;
+            syz += py * pz;
+            szz += pz * pz;
             ++K;
           }
         }
@@ -286,11 +278,13 @@ public:
           continue;
         }
 
-        m /= K;
-        m_(y, x) = m;
+        const double mx = sx / K, my = sy / K, mz = sz / K;
+        m_(y, x) = Vec3f((float)mx, (float)my, (float)mz);
 
         // Compute C
-        Matx33f C = Q - K * m * m.t();
+        Matx33f C((float)(sxx - sx * mx), (float)(sxy - sx * my), (float)(sxz - sx * mz),
+                  (float)(sxy - sy * mx), (float)(syy - sy * my), (float)(syz - sy * mz),
+                  (float)(sxz - sz * mx), (float)(syz - sz * my), (float)(szz - sz * mz));
 
         // Compute n
         SVD svd(C);
@@ -299,11 +293,45 @@ public:
       }
   }
 
+private:
+  const Mat_<Vec3f> & points3d_;
+  int block_size_;
+  Mat_<Vec3f> & m_;
+  Mat_<Vec3f> & n_;
+  Mat_<float> & mse_;
+
+  PlaneGridBody & operator = (const PlaneGridBody &);
+};
+
+/** The PlaneGrid contains statistic about the individual tiles
+ */
+class PlaneGrid
+{
+public:
+  PlaneGrid(const Mat_<Vec3f> & points3d, int block_size)
+      :
+        block_size_(block_size)
+  {
+    // Figure out some dimensions
+    int mini_rows = points3d.rows / block_size;
+    if (points3d.rows % block_size != 0)
+      ++mini_rows;
+
+    int mini_cols = points3d.cols / block_size;
+    if (points3d.cols % block_size != 0)
+      ++mini_cols;
+
+    // Compute all the interesting quantities
+    m_.create(mini_rows, mini_cols);
+    n_.create(mini_rows, mini_cols);
+    mse_.create(mini_rows, mini_cols);
+    parallel_for_(Range(0, mini_rows), PlaneGridBody(points3d, block_size, m_, n_, mse_));
+  }
+
   /** The size of the block */
   int block_size_;
   Mat_<Vec3f> m_;
   Mat_<Vec3f> n_;
-  Mat_<Vec<float, 9> > Q_;
   Mat_<float> mse_;
 };
 
@@ -328,42 +356,52 @@ public:
       return mse_ < tile2.mse_;
     }
 
+    /** Used to keep the tile with the smallest MSE on top of a std heap */
+    bool
+    operator>(const PlaneTile &tile2) const
+    {
+      return mse_ > tile2.mse_;
+    }
+
     int x_;
     int y_;
     float mse_;
   };
 
   TileQueue(const PlaneGrid &plane_grid)
+      :
+        front_(0)
   {
     done_tiles_ = Mat_<unsigned char>::zeros(plane_grid.mse_.rows, plane_grid.mse_.cols);
     tiles_.clear();
+    tiles_.reserve(plane_grid.mse_.total());
     for (int y = 0; y < plane_grid.mse_.rows; ++y)
       for (int x = 0; x < plane_grid.mse_.cols; ++x)
         if (plane_grid.mse_(y, x) != std::numeric_limits<float>::max())
           // Update the tiles
           tiles_.push_back(PlaneTile(x, y, plane_grid.mse_(y, x)));
     // Sort tiles by MSE
-    tiles_.sort();
+    std::stable_sort(tiles_.begin(), tiles_.end());
   }
 
   bool
   empty()
   {
-    while (!tiles_.empty())
+    while (front_ < tiles_.size())
     {
-      const PlaneTile & tile = tiles_.front();
+      const PlaneTile & tile = tiles_[front_];
       if (done_tiles_(tile.y_, tile.x_))
-        tiles_.pop_front();
+        ++front_;
       else
         break;
     }
-    return tiles_.empty();
+    return front_ == tiles_.size();
   }
 
   const PlaneTile &
   front() const
   {
-    return tiles_.front();
+    return tiles_[front_];
   }
 
   void
@@ -372,8 +410,10 @@ public:
     done_tiles_(y, x) = 1;
   }
 private:
-  /** The list of tiles ordered from most planar to least */
-  std::list<PlaneTile> tiles_;
+  /** The tiles ordered from most planar to least */
+  std::vector<PlaneTile> tiles_;
+  /** The first tile that can still be studied */
+  size_t front_;
   /** contains 1 when the tiles has been studied, 0 otherwise */
   Mat_<unsigned char> done_tiles_;
 };
@@ -394,13 +434,18 @@ public:
   {
   }
 
+  /** Grows the plane with the most planar tile of the neighboring_tiles heap.
+   * plane_mask is 1 for the tiles already studied for that plane, 2 for the ones in the heap
+   */
   void
   Find(const PlaneGrid &plane_grid, Ptr<PlaneBase> & plane, TileQueue & tile_queue,
-       std::set<TileQueue::PlaneTile> & neighboring_tiles, Mat_<unsigned char> & overall_mask,
+       std::vector<TileQueue::PlaneTile> & neighboring_tiles, Mat_<unsigned char> & overall_mask,
        Mat_<unsigned char> & plane_mask)
   {
     // Do not use reference as we pop the from later on
-    TileQueue::PlaneTile tile = *(neighboring_tiles.begin());
+    std::pop_heap(neighboring_tiles.begin(), neighboring_tiles.end(), std::greater<TileQueue::PlaneTile>());
+    TileQueue::PlaneTile tile = neighboring_tiles.back();
+    neighboring_tiles.pop_back();
 
     // Figure the part of the image to look at
     Range range_x, range_y;
@@ -421,14 +466,12 @@ public:
     {
       uchar* data = overall_mask.ptr(yy, range_x.start), *data_end = data + range_x.size();
       const Vec3f* point = points3d_.ptr < Vec3f > (yy, range_x.start);
-      const Matx33f* Q_local = reinterpret_cast<const Matx33f *>(plane_grid.Q_.ptr < Vec<float, 9>
-          > (yy, range_x.start));
 
       // Depending on whether you have a normal, check it
       if (!normals_.empty())
       {
         const Vec3f* normal = normals_.ptr < Vec3f > (yy, range_x.start);
-        for (; data != data_end; ++data, ++point, ++normal, ++Q_local)
+        for (; data != data_end; ++data, ++point, ++normal)
         {
           // Don't do anything if the point already belongs to another plane
           if (cvIsNaN(point->val[0]) || ((*data) != 255))
@@ -441,7 +484,7 @@ public:
             if (std::abs(plane->n().dot(*normal)) > 0.3)
             {
               // The point now belongs to the plane
-              plane->UpdateStatistics(*point, *Q_local);
+              plane->UpdateStatistics(*point);
               *data = plane_index_;
               ++n_valid_points;
             }
@@ -450,7 +493,7 @@ public:
       }
       else
       {
-        for (; data != data_end; ++data, ++point, ++Q_local)
+        for (; data != data_end; ++data, ++point)
         {
           // Don't do anything if the point already belongs to another plane
           if (cvIsNaN(point->val[0]) || ((*data) != 255))
@@ -460,7 +503,7 @@ public:
           if (plane->distance(*point) < err_)
           {
             // The point now belongs to the plane
-            plane->UpdateStatistics(*point, *Q_local);
+            plane->UpdateStatistics(*point);
             *data = plane_index_;
             ++n_valid_points;
           }
@@ -474,7 +517,6 @@ public:
     if (n_valid_points > (range_x.size() * range_y.size()) / 2)
       tile_queue.remove(tile.y_, tile.x_);
     plane_mask(tile.y_, tile.x_) = 1;
-    neighboring_tiles.erase(neighboring_tiles.begin());
 
     // Add potential neighbors of the tile
     std::vector<std::pair<int, int> > pairs;
@@ -513,8 +555,12 @@ public:
 
     for (unsigned char i = 0; i < pairs.size(); ++i)
       if (!plane_mask(pairs[i].second, pairs[i].first))
-        neighboring_tiles.insert(
+      {
+        plane_mask(pairs[i].second, pairs[i].first) = 2;
+        neighboring_tiles.push_back(
             TileQueue::PlaneTile(pairs[i].first, pairs[i].second, plane_grid.mse_(pairs[i].second, pairs[i].first)));
+        std::push_heap(neighboring_tiles.begin(), neighboring_tiles.end(), std::greater<TileQueue::PlaneTile>());
+      }
   }
 
 private:
@@ -565,6 +611,11 @@ private:
     std::vector<Vec4f> plane_coefficients;
     float mse_min = (float)(threshold_ * threshold_);
 
+    // Buffers reused by all the planes
+    Mat_<unsigned char> plane_mask(plane_grid.mse_.size());
+    std::vector<TileQueue::PlaneTile> neighboring_tiles;
+    neighboring_tiles.reserve(plane_grid.mse_.total());
+
     while (!plane_queue.empty())
     {
       // Get the first tile if it's good enough
@@ -584,10 +635,10 @@ private:
         plane = Ptr<PlaneBase>(new PlaneABC(plane_grid.m_(y, x), n, (int)index_plane,
 			(float)sensor_error_a_, (float)sensor_error_b_, (float)sensor_error_c_));
 
-      Mat_<unsigned char> plane_mask = Mat_<unsigned char>::zeros(points3d.rows / block_size_,
-                                                                          points3d.cols / block_size_);
-      std::set<TileQueue::PlaneTile> neighboring_tiles;
-      neighboring_tiles.insert(front_tile);
+      plane_mask.setTo(0);
+      plane_mask(front_tile.y_, front_tile.x_) = 2;
+      neighboring_tiles.clear();
+      neighboring_tiles.push_back(front_tile);
       plane_queue.remove(front_tile.y_, front_tile.x_);
 
       // Process all the neighboring tiles
@@ -0,0 +1,309 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "precomp.hpp"
+
+namespace cv
+{
+namespace rgbd
+{
+
+static inline
+void splitTransform(const Mat& Rt, Matx33f& R, Vec3f& t)
+{
+    CV_Assert(Rt.size() == Size(4,4) && Rt.type() == CV_64FC1);
+    for(int i = 0; i < 3; i++)
+    {
+        for(int j = 0; j < 3; j++)
+            R(i,j) = (float)Rt.at<double>(i,j);
+        t[i] = (float)Rt.at<double>(i,3);
+    }
+}
+
+/* Every voxel is projected to the depth frame and updated with the signed distance along the camera axis.
+ * The voxel columns along z are walked incrementally, and the columns are processed in parallel.
+ */
+class TSDFIntegrateBody : public ParallelLoopBody
+{
+public:
+    TSDFIntegrateBody(Mat& _volume, const Vec3i& _resolution, float _voxelSize, float _truncDist, int _maxWeight,
+                      const Mat& _depth, const Matx33f& _K, const Matx33f& _R, const Vec3f& _t) :
+        volume(_volume), resolution(_resolution), voxelSize(_voxelSize), truncDist(_truncDist), maxWeight(_maxWeight),
+        depth(_depth), K(_K), R(_R), t(_t)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const float fx = K(0,0), fy = K(1,1), cx = K(0,2), cy = K(1,2);
+        const Vec3f dz = Vec3f(R(0,2), R(1,2), R(2,2)) * voxelSize;
+        const float invTruncDist = 1.f / truncDist;
+
+        for(int row = range.start; row < range.end; row++)
+        {
+            const int x = row / resolution[1], y = row % resolution[1];
+            Vec2f* voxels = volume.ptr<Vec2f>(row);
+            Vec3f c = R * (Vec3f(x + 0.5f, y + 0.5f, 0.5f) * voxelSize) + t;
+            for(int z = 0; z < resolution[2]; z++, c += dz)
+            {
+                if(c[2] <= 0)
+                    continue;
+
+                const float invZ = 1.f / c[2];
+                const int u = cvRound(fx * c[0] * invZ + cx);
+                const int v = cvRound(fy * c[1] * invZ + cy);
+                if(u < 0 || v < 0 || u >= depth.cols || v >= depth.rows)
+                    continue;
+
+                const float d = depth.at<float>(v,u);
+                if(!(d > 0)) // missing or NaN
+                    continue;
+
+                const float sdf = d - c[2];
+                if(sdf < -truncDist)
+                    continue;
+
+                const float tsdf = std::min(1.f, sdf * invTruncDist);
+                Vec2f& voxel = voxels[z];
+                const float weight = voxel[1];
+                voxel[0] = (voxel[0] * weight + tsdf) / (weight + 1.f);
+                voxel[1] = std::min(weight + 1.f, (float)maxWeight);
+            }
+        }
+    }
+
+private:
+    Mat& volume;
+    Vec3i resolution;
+    float voxelSize, truncDist;
+    int maxWeight;
+    const Mat& depth;
+    Matx33f K, R;
+    Vec3f t;
+
+    TSDFIntegrateBody& operator=(const TSDFIntegrateBody&);
+};
+
+/* Marches the rays of the pixels through the volume until the signed distance changes its sign.
+ * Far from the surface the distance itself is a safe step, near it the step is one voxel.
+ */
+class TSDFRaycastBody : public ParallelLoopBody
+{
+public:
+    TSDFRaycastBody(const Mat& _volume, const Vec3i& _resolution, float _voxelSize, float _truncDist,
+                    const Matx33f& _Kinv, const Matx33f& _camToVolR, const Vec3f& _camToVolT,
+                    Mat& _points, Mat& _normals) :
+        volume(_volume), resolution(_resolution), voxelSize(_voxelSize), truncDist(_truncDist), Kinv(_Kinv),
+        camToVolR(_camToVolR), camToVolT(_camToVolT), points(_points), normals(_normals)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const float qnan = std::numeric_limits<float>::quiet_NaN();
+        const Matx33f volToCamR = camToVolR.t();
+        const Vec3f volSize = Vec3f((float)resolution[0], (float)resolution[1], (float)resolution[2]) * voxelSize;
+        const Vec3f& origin = camToVolT;
+
+        for(int v = range.start; v < range.end; v++)
+        {
+            Vec3f* points_row = points.ptr<Vec3f>(v);
+            Vec3f* normals_row = normals.ptr<Vec3f>(v);
+            for(int u = 0; u < points.cols; u++)
+            {
+                points_row[u] = normals_row[u] = Vec3f(qnan, qnan, qnan);
+
+                Vec3f dir = camToVolR * (Kinv * Vec3f((float)u, (float)v, 1.f));
+                dir *= 1.f / (float)norm(dir);
+
+                // intersection of the ray with the volume box
+                float tnear = 0, tfar = std::numeric_limits<float>::max();
+                for(int i = 0; i < 3; i++)
+                {
+                    if(std::abs(dir[i]) < FLT_EPSILON)
+                    {
+                        if(origin[i] < 0 || origin[i] > volSize[i])
+                            tfar = -1;
+                        continue;
+                    }
+                    float t0 = -origin[i] / dir[i], t1 = (volSize[i] - origin[i]) / dir[i];
+                    if(t0 > t1)
+                        std::swap(t0, t1);
+                    tnear = std::max(tnear, t0);
+                    tfar = std::min(tfar, t1);
+                }
+                if(tnear >= tfar)
+                    continue;
+
+                float t = tnear, prevT = 0, prevF = 0;
+                bool prevValid = false;
+                while(t < tfar)
+                {
+                    float f;
+                    if(!interpolate(origin + dir * t, f))
+                    {
+                        prevValid = false;
+                        t += voxelSize;
+                        continue;
+                    }
+                    if(prevValid && prevF > 0 && f <= 0)
+                    {
+                        const float tHit = prevT + (t - prevT) * prevF / (prevF - f);
+                        const Vec3f p = origin + dir * tHit;
+                        Vec3f n;
+                        if(gradient(p, n))
+                        {
+                            points_row[u] = volToCamR * (p - camToVolT);
+                            normals_row[u] = volToCamR * n;
+                        }
+                        break;
+                    }
+                    if(f < 0) // behind the surface
+                        break;
+
+                    prevValid = true;
+                    prevF = f;
+                    prevT = t;
+                    t += std::max(f * truncDist, voxelSize);
+                }
+            }
+        }
+    }
+
+private:
+    const Vec2f& voxel(int x, int y, int z) const
+    {
+        return volume.ptr<Vec2f>(x * resolution[1] + y)[z];
+    }
+
+    /* Trilinear interpolation of the distance, fails if it involves not observed voxels */
+    bool interpolate(const Vec3f& p, float& f) const
+    {
+        const Vec3f g = p * (1.f / voxelSize) - Vec3f(0.5f, 0.5f, 0.5f);
+        const int x = cvFloor(g[0]), y = cvFloor(g[1]), z = cvFloor(g[2]);
+        if(x < 0 || y < 0 || z < 0 || x + 1 >= resolution[0] || y + 1 >= resolution[1] || z + 1 >= resolution[2])
+            return false;
+
+        const float tx = g[0] - x, ty = g[1] - y, tz = g[2] - z;
+        float vals[8];
+        for(int i = 0; i < 8; i++)
+        {
+            const Vec2f& vx = voxel(x + (i >> 2), y + ((i >> 1) & 1), z + (i & 1));
+            if(vx[1] <= 0)
+                return false;
+            vals[i] = vx[0];
+        }
+
+        const float c00 = vals[0] + (vals[1] - vals[0]) * tz, c01 = vals[2] + (vals[3] - vals[2]) * tz;
+        const float c10 = vals[4] + (vals[5] - vals[4]) * tz, c11 = vals[6] + (vals[7] - vals[6]) * tz;
+        const float c0 = c00 + (c01 - c00) * ty, c1 = c10 + (c11 - c10) * ty;
+        f = c0 + (c1 - c0) * tx;
+        return true;
+    }
+
+    bool gradient(const Vec3f& p, Vec3f& n) const
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            Vec3f d(0, 0, 0);
+            d[i] = voxelSize;
+            float f0, f1;
+            if(!interpolate(p - d, f0) || !interpolate(p + d, f1))
+                return false;
+            n[i] = f1 - f0;
+        }
+        const double length = norm(n);
+        if(length < FLT_EPSILON)
+            return false;
+        n *= (float)(1. / length);
+        return true;
+    }
+
+    const Mat& volume;
+    Vec3i resolution;
+    float voxelSize, truncDist;
+    Matx33f Kinv, camToVolR;
+    Vec3f camToVolT;
+    Mat& points;
+    Mat& normals;
+
+    TSDFRaycastBody& operator=(const TSDFRaycastBody&);
+};
+
+TSDFVolume::TSDFVolume(const Vec3i& _resolution, float _voxelSize, float _truncDist, int _maxWeight,
+                       const Mat& _volumePose) :
+    resolution(_resolution), voxelSize(_voxelSize), truncDist(_truncDist), maxWeight(_maxWeight)
+{
+    CV_Assert(resolution[0] > 1 && resolution[1] > 1 && resolution[2] > 1);
+    CV_Assert(voxelSize > 0 && truncDist > 0 && maxWeight > 0);
+
+    if(_volumePose.empty())
+        volumePose = Mat::eye(4, 4, CV_64FC1);
+    else
+    {
+        CV_Assert(_volumePose.size() == Size(4,4));
+        _volumePose.convertTo(volumePose, CV_64FC1);
+    }
+
+    volume.create(resolution[0] * resolution[1], resolution[2], CV_32FC2);
+    reset();
+}
+
+void TSDFVolume::reset()
+{
+    volume.setTo(Scalar::all(0));
+}
+
+void TSDFVolume::integrate(const Mat& depth, const Mat& cameraMatrix, const Mat& cameraPose)
+{
+    CV_Assert(depth.type() == CV_32FC1);
+    CV_Assert(cameraMatrix.size() == Size(3,3));
+
+    Matx33d K;
+    cameraMatrix.convertTo(K, CV_64FC1);
+    Mat posed;
+    cameraPose.convertTo(posed, CV_64FC1);
+
+    Matx33f R;
+    Vec3f t;
+    splitTransform(posed.inv(DECOMP_SVD) * volumePose, R, t);
+
+    parallel_for_(Range(0, volume.rows),
+                  TSDFIntegrateBody(volume, resolution, voxelSize, truncDist, maxWeight, depth, K, R, t));
+}
+
+void TSDFVolume::raycast(const Mat& cameraMatrix, const Mat& cameraPose, Size frameSize,
+                         OutputArray _points, OutputArray _normals) const
+{
+    CV_Assert(cameraMatrix.size() == Size(3,3));
+    CV_Assert(frameSize.area() > 0);
+
+    Matx33d K;
+    cameraMatrix.convertTo(K, CV_64FC1);
+    Mat posed;
+    cameraPose.convertTo(posed, CV_64FC1);
+
+    Matx33f R;
+    Vec3f t;
+    splitTransform(volumePose.inv(DECOMP_SVD) * posed, R, t);
+
+    _points.create(frameSize, CV_32FC3);
+    _normals.create(frameSize, CV_32FC3);
+    Mat points = _points.getMat(), normals = _normals.getMat();
+
+    parallel_for_(Range(0, frameSize.height),
+                  TSDFRaycastBody(volume, resolution, voxelSize, truncDist, Matx33f(K.inv()), R, t, points, normals));
+}
+
+Ptr<OdometryFrame> TSDFVolume::fetchFrame(const Mat& cameraMatrix, const Mat& cameraPose, Size frameSize) const
+{
+    Mat points, normals;
+    raycast(cameraMatrix, cameraPose, frameSize, points, normals);
+
+    Mat xyz[3];
+    split(points, xyz);
+
+    return makePtr<OdometryFrame>(Mat(), xyz[2], Mat(), normals);
+}
+
+} /* namespace rgbd */
+} /* namespace cv */
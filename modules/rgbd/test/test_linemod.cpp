@@ -0,0 +1,140 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+namespace cv
+{
+namespace linemod
+{
+
+static Mat linemodScene(Point offset)
+{
+  Mat image(480, 640, CV_8UC3, Scalar::all(0));
+  rectangle(image, Rect(offset.x, offset.y, 120, 90), Scalar(40, 200, 90), FILLED);
+  circle(image, offset + Point(60, 45), 30, Scalar(220, 60, 30), FILLED);
+  line(image, offset + Point(10, 80), offset + Point(110, 10), Scalar(255, 255, 255), 3);
+  return image;
+}
+
+TEST(Rgbd_Linemod, binaryArchive)
+{
+  Ptr<Detector> detector = getDefaultLINE();
+
+  Point offset(200, 150);
+  Mat mask(480, 640, CV_8UC1, Scalar::all(0));
+  mask(Rect(offset.x - 5, offset.y - 5, 130, 100)).setTo(255);
+  std::vector<Mat> sources(1, linemodScene(offset));
+  ASSERT_EQ(0, detector->addTemplate(sources, "shapes", mask));
+  sources[0] = linemodScene(offset + Point(7, 3));
+  ASSERT_EQ(1, detector->addTemplate(sources, "shapes", mask));
+
+  std::string filename = cvtest::tempfile(".lmb");
+  detector->writeClassBinary("shapes", filename);
+
+  Ptr<Detector> loaded = getDefaultLINE();
+  EXPECT_EQ(String("shapes"), loaded->readClassBinary(filename));
+
+  // The class can be loaded from memory under another name, but not twice
+  std::vector<uchar> archive;
+  {
+    FILE* f = fopen(filename.c_str(), "rb");
+    ASSERT_TRUE(f != 0);
+    uchar buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+      archive.insert(archive.end(), buf, buf + n);
+    fclose(f);
+  }
+  ::remove(filename.c_str());
+  ASSERT_FALSE(archive.empty());
+  EXPECT_EQ(String("renamed"), loaded->readClassBinary(&archive[0], archive.size(), "renamed"));
+  EXPECT_EQ(detector->numTemplates("shapes"), loaded->numTemplates("renamed"));
+  EXPECT_ANY_THROW(loaded->readClassBinary(&archive[0], archive.size()));
+  EXPECT_ANY_THROW(loaded->readClassBinary(&archive[0], archive.size() / 2, "truncated"));
+
+  ASSERT_EQ(detector->numTemplates("shapes"), loaded->numTemplates("shapes"));
+  for (int id = 0; id < detector->numTemplates("shapes"); ++id)
+  {
+    const std::vector<Template>& expected = detector->getTemplates("shapes", id);
+    const std::vector<Template>& actual = loaded->getTemplates("shapes", id);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+      EXPECT_EQ(expected[i].width, actual[i].width);
+      EXPECT_EQ(expected[i].height, actual[i].height);
+      EXPECT_EQ(expected[i].pyramid_level, actual[i].pyramid_level);
+      ASSERT_EQ(expected[i].features.size(), actual[i].features.size());
+      for (size_t k = 0; k < expected[i].features.size(); ++k)
+      {
+        EXPECT_EQ(expected[i].features[k].x, actual[i].features[k].x);
+        EXPECT_EQ(expected[i].features[k].y, actual[i].features[k].y);
+        EXPECT_EQ(expected[i].features[k].label, actual[i].features[k].label);
+      }
+    }
+  }
+
+  // Both detectors find the same matches
+  sources[0] = linemodScene(Point(320, 240));
+  std::vector<Match> expected_matches, actual_matches;
+  std::vector<String> class_ids(1, "shapes");
+  detector->match(sources, 80.f, expected_matches);
+  loaded->match(sources, 80.f, actual_matches, class_ids);
+  ASSERT_FALSE(expected_matches.empty());
+  ASSERT_EQ(expected_matches.size(), actual_matches.size());
+  for (size_t i = 0; i < expected_matches.size(); ++i)
+    EXPECT_TRUE(expected_matches[i] == actual_matches[i]);
+}
+
+TEST(Rgbd_Linemod, quantizedOrientations)
+{
+  Mat image(120, 160, CV_8UC3, Scalar::all(0));
+  rectangle(image, Rect(30, 20, 100, 80), Scalar(40, 200, 90), FILLED);
+
+  Ptr<QuantizedPyramid> pyramid = makePtr<ColorGradient>()->process(image);
+  Mat quantized;
+  pyramid->quantize(quantized);
+  ASSERT_EQ(CV_8U, quantized.type());
+
+  // Vertical edges have horizontal gradients (label 0), horizontal edges vertical ones (label 4)
+  int vertical = 0, horizontal = 0;
+  for (int i = -5; i <= 5; ++i)
+  {
+    uchar left = quantized.at<uchar>(60, 30 + i), right = quantized.at<uchar>(60, 130 + i);
+    uchar top = quantized.at<uchar>(20 + i, 80), bottom = quantized.at<uchar>(100 + i, 80);
+    EXPECT_TRUE(left == 0 || left == 1) << (int)left;
+    EXPECT_TRUE(right == 0 || right == 1) << (int)right;
+    EXPECT_TRUE(top == 0 || top == 16) << (int)top;
+    EXPECT_TRUE(bottom == 0 || bottom == 16) << (int)bottom;
+    vertical += (left != 0) + (right != 0);
+    horizontal += (top != 0) + (bottom != 0);
+  }
+  EXPECT_GT(vertical, 0);
+  EXPECT_GT(horizontal, 0);
+  // Flat regions have no orientation
+  EXPECT_EQ(0, countNonZero(quantized(Rect(50, 40, 60, 40))));
+}
+
+TEST(Rgbd_Linemod, quantizedNormals)
+{
+  Mat depth(120, 160, CV_16U);
+  for (int y = 0; y < depth.rows; ++y)
+    for (int x = 0; x < depth.cols; ++x)
+      depth.at<ushort>(y, x) = (ushort)(x < 80 ? 1000 : 1000 + 2 * y);
+
+  Ptr<QuantizedPyramid> pyramid = makePtr<DepthNormal>()->process(depth);
+  Mat quantized;
+  pyramid->quantize(quantized);
+  ASSERT_EQ(CV_8U, quantized.type());
+
+  // A plane facing the camera and a plane tilted along y
+  Mat facing = quantized(Rect(10, 10, 60, 100)), tilted = quantized(Rect(90, 10, 60, 100));
+  EXPECT_EQ(facing.total(), (size_t)countNonZero(facing == 1));
+  EXPECT_EQ(tilted.total(), (size_t)countNonZero(tilted == 4));
+}
+
+} // namespace linemod
+} // namespace cv
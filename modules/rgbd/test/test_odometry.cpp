@@ -328,6 +328,38 @@ void CV_OdometryTest::run(int)
         ts->printf(cvtest::TS::LOG, "\nIncorrect count of accurate poses [2nd case]: %f / %f", static_cast<double>(better_5times_count), maxError5 * static_cast<double>(iterCount));
         ts->set_failed_test_info(cvtest::TS::FAIL_BAD_ACCURACY);
     }
+
+    // 3. The sequential version has to give the same transformations as the pairwise one.
+    {
+        std::vector<Mat> images(1, image), depths(1, depth);
+        for(int i = 0; i < 2; i++)
+        {
+            Mat rvec, tvec, warpedImage, warpedDepth;
+            generateRandomTransformation(rvec, tvec);
+            warpFrame(images.back(), depths.back(), rvec, tvec, K, warpedImage, warpedDepth);
+            dilateFrame(warpedImage, warpedDepth);
+            images.push_back(warpedImage);
+            depths.push_back(warpedDepth);
+        }
+
+        odometry->clear();
+        Mat seqRt, pairRt;
+        if(odometry->compute(images[0], depths[0], Mat(), seqRt) || norm(seqRt, Mat::eye(4,4,CV_64FC1)) > DBL_EPSILON)
+        {
+            ts->printf(cvtest::TS::LOG, "\nThe first frame of a sequence has to give identity and false");
+            ts->set_failed_test_info(cvtest::TS::FAIL_INVALID_OUTPUT);
+        }
+        for(size_t i = 1; i < images.size(); i++)
+        {
+            bool isSeqComputed = odometry->compute(images[i], depths[i], Mat(), seqRt);
+            bool isPairComputed = odometry->compute(images[i-1], depths[i-1], Mat(), images[i], depths[i], Mat(), pairRt);
+            if(isSeqComputed != isPairComputed || (isPairComputed && norm(seqRt, pairRt) > 1e-10))
+            {
+                ts->printf(cvtest::TS::LOG, "\nSequential and pairwise odometry differ on frame %d", (int)i);
+                ts->set_failed_test_info(cvtest::TS::FAIL_BAD_ACCURACY);
+            }
+        }
+    }
 }
 
 /****************************************************************************************\
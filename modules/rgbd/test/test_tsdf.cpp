@@ -0,0 +1,113 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/highgui.hpp>
+
+namespace cv
+{
+namespace rgbd
+{
+
+static Mat tsdfCameraMatrix(float fx, float cx, float cy)
+{
+    Mat K = Mat::eye(3, 3, CV_32FC1);
+    K.at<float>(0,0) = K.at<float>(1,1) = fx;
+    K.at<float>(0,2) = cx;
+    K.at<float>(1,2) = cy;
+    return K;
+}
+
+static Mat translationPose(double x, double y, double z)
+{
+    Mat pose = Mat::eye(4, 4, CV_64FC1);
+    pose.at<double>(0,3) = x;
+    pose.at<double>(1,3) = y;
+    pose.at<double>(2,3) = z;
+    return pose;
+}
+
+TEST(Rgbd_TSDFVolume, raycastPlane)
+{
+    // the plane z = 1 + 0.2 x seen by a camera at the origin
+    const Size sz(160, 120);
+    const float fx = 150.f, cx = 79.5f, cy = 59.5f;
+    const Mat K = tsdfCameraMatrix(fx, cx, cy);
+    Mat depth(sz, CV_32FC1);
+    for(int v = 0; v < sz.height; v++)
+        for(int u = 0; u < sz.width; u++)
+            depth.at<float>(v,u) = 1.f / (1.f - 0.2f * (u - cx) / fx);
+
+    const float voxelSize = 0.01f;
+    TSDFVolume volume(Vec3i(128, 128, 128), voxelSize, 4 * voxelSize, 64, translationPose(-0.6, -0.45, 0.5));
+    const Mat pose = Mat::eye(4, 4, CV_64FC1);
+    for(int i = 0; i < 3; i++)
+        volume.integrate(depth, K, pose);
+
+    Mat points, normals;
+    volume.raycast(K, pose, sz, points, normals);
+    ASSERT_EQ(sz, points.size());
+    ASSERT_EQ(CV_32FC3, points.type());
+    ASSERT_EQ(CV_32FC3, normals.type());
+
+    const Vec3f expectedNormal = normalize(Vec3f(0.2f, 0.f, -1.f));
+    int valid = 0, total = 0;
+    for(int v = 20; v < sz.height - 20; v++)
+    {
+        for(int u = 20; u < sz.width - 20; u++, total++)
+        {
+            const Vec3f p = points.at<Vec3f>(v,u), n = normals.at<Vec3f>(v,u);
+            if(cvIsNaN(p[2]))
+                continue;
+            valid++;
+            EXPECT_NEAR(depth.at<float>(v,u), p[2], voxelSize);
+            EXPECT_GT(std::abs(n.dot(expectedNormal)), 0.95f);
+        }
+    }
+    EXPECT_GT(valid, total * 0.95);
+
+    // nothing is rendered after the reset
+    volume.reset();
+    volume.raycast(K, pose, sz, points, normals);
+    Mat xyz[3];
+    split(points, xyz);
+    EXPECT_EQ(0, countNonZero(xyz[2] == xyz[2]));
+}
+
+TEST(Rgbd_TSDFVolume, frameToModelICP)
+{
+    std::string depthFilename = cvtest::TS::ptr()->get_data_path() + "rgbd/depth.png";
+    Mat depth = imread(depthFilename, -1);
+    ASSERT_FALSE(depth.empty()) << "Depth " << depthFilename << " can not be read";
+    ASSERT_EQ(CV_16UC1, depth.type());
+    depth.convertTo(depth, CV_32FC1, 1.f/5000.f);
+    depth.setTo(std::numeric_limits<float>::quiet_NaN(), depth < FLT_EPSILON);
+
+    const Mat K = tsdfCameraMatrix(525.f, 319.5f, 239.5f);
+    const Mat pose = Mat::eye(4, 4, CV_64FC1);
+
+    TSDFVolume volume(Vec3i(128, 128, 128), 0.03f, 0.1f, 64, translationPose(-1.92, -1.92, 0.2));
+    volume.integrate(depth, K, pose);
+
+    Ptr<OdometryFrame> model = volume.fetchFrame(K, pose, depth.size());
+    ASSERT_FALSE(model.empty());
+    ASSERT_EQ(depth.size(), model->depth.size());
+    ASSERT_EQ(depth.size(), model->normals.size());
+    EXPECT_GT(countNonZero(model->depth == model->depth), depth.total() / 4);
+
+    ICPOdometry odometry(K);
+    Ptr<OdometryFrame> frame = makePtr<OdometryFrame>(Mat(), depth);
+    Mat Rt;
+    ASSERT_TRUE(odometry.compute(frame, model, Rt));
+
+    Mat rvec;
+    Rodrigues(Rt(Rect(0,0,3,3)), rvec);
+    EXPECT_LT(norm(rvec), 1. / 180. * CV_PI);
+    EXPECT_LT(norm(Rt(Rect(3,0,1,3))), 0.01);
+}
+
+} // namespace rgbd
+} // namespace cv
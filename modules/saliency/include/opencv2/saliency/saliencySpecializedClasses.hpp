@@ -145,9 +145,7 @@ protected:
 private:
   void calcIntensityChannel(Mat src, Mat dst);
   void copyImage(Mat src, Mat dst);
-  void getIntensityScaled(Mat integralImage, Mat gray, Mat saliencyOn, Mat saliencyOff, int neighborhood);
-  float getMean(Mat srcArg, Point2i PixArg, int neighbourhood, int centerVal);
-  void mixScales(Mat *saliencyOn, Mat intensityOn, Mat *saliencyOff, Mat intensityOff, const int numScales);
+  void mixScales(Mat mixedValuesOn, Mat intensityOn, Mat mixedValuesOff, Mat intensityOff);
   void mixOnOff(Mat intensityOn, Mat intensityOff, Mat intensity);
   void getIntensity(Mat srcArg, Mat dstArg,  Mat dstOnArg,  Mat dstOffArg, bool generateOnOff);
 };
@@ -235,9 +233,11 @@ private:
   bool templateReplacement( const Mat& finalBFMask, const Mat& image );
 
   // changing structure
-  std::vector<Ptr<Mat> > backgroundModel;// The vector represents the background template T0---TK of reference paper.
-  // Matrices are two-channel matrix. In the first layer there are the B (background value)
-  // for each pixel. In the second layer, there are the C (efficacy) value for each pixel
+  // The vectors represent the background template T0---TK of reference paper, each template is stored as two
+  // CV_32F planes: backgroundValues holds the B (background value) and backgroundEfficacy the C (efficacy) value
+  // of each pixel, so that the pixels of a template are contiguous.
+  std::vector<Mat> backgroundValues;
+  std::vector<Mat> backgroundEfficacy;
   Mat potentialBackground;// Two channel Matrix. For each pixel, in the first level there are the Ba value (potential background value)
                           // and in the secon level there are the Ca value, the counter for each potential value.
   Mat epslonPixelsValue;  // epslon threshold
@@ -250,7 +250,7 @@ private:
   int K;// Number of background model template
   int N;// NxN is the size of the block for downsampling in the lowlowResolutionDetection
   float alpha;// Learning rate
-  int L0, L1;// Upper-bound values for C0 and C1 (efficacy of the first two template (matrices) of backgroundModel
+  int L0, L1;// Upper-bound values for C0 and C1 (efficacy of the first two templates of the background model
   int thetaL;// T0, T1 swap threshold
   int thetaA;// Potential background value threshold
   int gamma;// Parameter that controls the time that the newly updated long-term background value will remain in the
@@ -270,6 +270,8 @@ private:
  */
 class CV_EXPORTS_W ObjectnessBING : public Objectness
 {
+  friend class BINGScaleInvoker;
+
 public:
 
   ObjectnessBING();
@@ -458,6 +460,8 @@ private:
     return n > 0 && _svmReW1f.size() == Size( 2, n ) && _svmFilter.size() == Size( _W, _W );
   }
   void predictBBoxSI( Mat &mag3u, ValStructVec<float, Vec4i> &valBoxes, std::vector<int> &sz, int NUM_WIN_PSZ = 100, bool fast = true );
+  // Boxes of the window size _svmSzIdxs[ir], sizes are processed in parallel by predictBBoxSI
+  void predictBBoxSIScale( Mat &img3u, int ir, ValStructVec<float, Vec4i> &valBoxes, int NUM_WIN_PSZ, bool fast );
   void predictBBoxSII( ValStructVec<float, Vec4i> &valBoxes, const std::vector<int> &sz );
 
   // Calculate the image gradient: center option as in VLFeat
@@ -52,8 +52,9 @@ struct TIGbits
   TIGbits() : bc0(0), bc1(0) {}
   inline void accumulate(int64_t tig, int64_t tigMask0, int64_t tigMask1, uchar shift)
   {
-    bc0 += ((POPCNT64(tigMask0 & tig) << 1) - POPCNT64(tig)) << shift;
-    bc1 += ((POPCNT64(tigMask1 & tig) << 1) - POPCNT64(tig)) << shift;
+    const int64_t bc = POPCNT64(tig);
+    bc0 += ((POPCNT64(tigMask0 & tig) << 1) - bc) << shift;
+    bc1 += ((POPCNT64(tigMask1 & tig) << 1) - bc) << shift;
   }
   int64_t bc0;
   int64_t bc1;
@@ -107,47 +108,39 @@ void ObjectnessBING::FilterTIG::reconstruct( Mat &w1f )
 
 // For a W by H gradient magnitude map, find a W-7 by H-7 CV_32F matching score map
 // Please refer to my paper for definition of the variables used in this function
+// The binary TIGs of the upper row are updated in place and the row bytes are carried along x,
+// so only one row of TIGs is kept and the scores are evaluated for the complete windows only.
 Mat ObjectnessBING::FilterTIG::matchTemplate( const Mat &mag1u )
 {
   const int H = mag1u.rows, W = mag1u.cols;
-  const Size sz( W + 1, H + 1 );  // Expand original size to avoid dealing with boundary conditions
-  Mat_<int64_t> Tig1 = Mat_<int64_t>::zeros( sz ), Tig2 = Mat_<int64_t>::zeros( sz );
-  Mat_<int64_t> Tig4 = Mat_<int64_t>::zeros( sz ), Tig8 = Mat_<int64_t>::zeros( sz );
-  Mat_<BYTE> Row1 = Mat_<BYTE>::zeros( sz ), Row2 = Mat_<BYTE>::zeros( sz );
-  Mat_<BYTE> Row4 = Mat_<BYTE>::zeros( sz ), Row8 = Mat_<BYTE>::zeros( sz );
-  Mat_<float> scores( sz );
-  for ( int y = 1; y <= H; y++ )
+  CV_Assert( mag1u.type() == CV_8U && W >= 8 && H >= 8 );
+  AutoBuffer<int64_t> _tigs( 4 * W );
+  int64_t* T1 = _tigs;  // Binary TIG of the upper row, then of the current one
+  int64_t* T2 = T1 + W;
+  int64_t* T4 = T2 + W;
+  int64_t* T8 = T4 + W;
+  memset( T1, 0, 4 * W * sizeof( int64_t ) );
+  Mat matchCost1f( H - 7, W - 7, CV_32F );
+  for ( int y = 0; y < H; y++ )
   {
-    const BYTE* G = mag1u.ptr<BYTE>( y - 1 );
-    int64_t* T1 = Tig1.ptr<int64_t>( y );  // Binary TIG of current row
-    int64_t* T2 = Tig2.ptr<int64_t>( y );
-    int64_t* T4 = Tig4.ptr<int64_t>( y );
-    int64_t* T8 = Tig8.ptr<int64_t>( y );
-    int64_t* Tu1 = Tig1.ptr<int64_t>( y - 1 );  // Binary TIG of upper row
-    int64_t* Tu2 = Tig2.ptr<int64_t>( y - 1 );
-    int64_t* Tu4 = Tig4.ptr<int64_t>( y - 1 );
-    int64_t* Tu8 = Tig8.ptr<int64_t>( y - 1 );
-    BYTE* R1 = Row1.ptr<BYTE>( y );
-    BYTE* R2 = Row2.ptr<BYTE>( y );
-    BYTE* R4 = Row4.ptr<BYTE>( y );
-    BYTE* R8 = Row8.ptr<BYTE>( y );
-    float *s = scores.ptr<float>( y );
-    for ( int x = 1; x <= W; x++ )
+    const BYTE* G = mag1u.ptr<BYTE>( y );
+    float* s = y >= 7 ? matchCost1f.ptr<float>( y - 7 ) : 0;
+    BYTE R1 = 0, R2 = 0, R4 = 0, R8 = 0;
+    for ( int x = 0; x < W; x++ )
     {
-      BYTE g = G[x - 1];
-      R1[x] = ( R1[x - 1] << 1 ) | ( ( g >> 4 ) & 1 );
-      R2[x] = ( R2[x - 1] << 1 ) | ( ( g >> 5 ) & 1 );
-      R4[x] = ( R4[x - 1] << 1 ) | ( ( g >> 6 ) & 1 );
-      R8[x] = ( R8[x - 1] << 1 ) | ( ( g >> 7 ) & 1 );
-      T1[x] = ( Tu1[x] << 8 ) | R1[x];
-      T2[x] = ( Tu2[x] << 8 ) | R2[x];
-      T4[x] = ( Tu4[x] << 8 ) | R4[x];
-      T8[x] = ( Tu8[x] << 8 ) | R8[x];
-      s[x] = dot( T1[x], T2[x], T4[x], T8[x] );
+      BYTE g = G[x];
+      R1 = (BYTE) ( ( R1 << 1 ) | ( ( g >> 4 ) & 1 ) );
+      R2 = (BYTE) ( ( R2 << 1 ) | ( ( g >> 5 ) & 1 ) );
+      R4 = (BYTE) ( ( R4 << 1 ) | ( ( g >> 6 ) & 1 ) );
+      R8 = (BYTE) ( ( R8 << 1 ) | ( ( g >> 7 ) & 1 ) );
+      T1[x] = ( T1[x] << 8 ) | R1;
+      T2[x] = ( T2[x] << 8 ) | R2;
+      T4[x] = ( T4[x] << 8 ) | R4;
+      T8[x] = ( T8[x] << 8 ) | R8;
+      if( s && x >= 7 )
+        s[x - 7] = dot( T1[x], T2[x], T4[x], T8[x] );
     }
   }
-  Mat matchCost1f;
-  scores( Rect( 8, 8, W - 7, H - 7 ) ).copyTo( matchCost1f );
   return matchCost1f;
 }
 
@@ -44,6 +44,7 @@
 #include "BING/kyheader.hpp"
 #include "CmTimer.hpp"
 #include "CmFile.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -124,47 +125,87 @@ int ObjectnessBING::loadTrainedModel( std::string modelName )  // Return -1, 0,
   return 1;
 }
 
+/* Every window size is an independent pass over its own resized image, the passes run in parallel
+ * and their boxes are merged in the order of the serial loop.
+ */
+class BINGScaleInvoker : public ParallelLoopBody
+{
+public:
+  BINGScaleInvoker( ObjectnessBING& _bing, Mat& _img3u, std::vector<ObjectnessBING::ValStructVec<float, Vec4i> >& _scaleBoxes,
+                    int _NUM_WIN_PSZ, bool _fast ) :
+      bing( _bing ), img3u( _img3u ), scaleBoxes( _scaleBoxes ), NUM_WIN_PSZ( _NUM_WIN_PSZ ), fast( _fast )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    for ( int ir = range.start; ir < range.end; ir++ )
+      bing.predictBBoxSIScale( img3u, ir, scaleBoxes[ir], NUM_WIN_PSZ, fast );
+  }
+
+private:
+  ObjectnessBING& bing;
+  Mat& img3u;
+  std::vector<ObjectnessBING::ValStructVec<float, Vec4i> >& scaleBoxes;
+  int NUM_WIN_PSZ;
+  bool fast;
+
+  BINGScaleInvoker& operator=( const BINGScaleInvoker& );
+};
+
 void ObjectnessBING::predictBBoxSI( Mat &img3u, ValStructVec<float, Vec4i> &valBoxes, std::vector<int> &sz, int NUM_WIN_PSZ, bool fast )
 {
   const int numSz = (int) _svmSzIdxs.size();
-  const int imgW = img3u.cols, imgH = img3u.rows;
+  std::vector<ValStructVec<float, Vec4i> > scaleBoxes( numSz );
+  parallel_for_( Range( 0, numSz ), BINGScaleInvoker( *this, img3u, scaleBoxes, NUM_WIN_PSZ, fast ) );
+
   valBoxes.reserve( 10000 );
   sz.clear();
   sz.reserve( 10000 );
   for ( int ir = numSz - 1; ir >= 0; ir-- )
   {
-    int r = _svmSzIdxs[ir];
-    int height = cvRound( pow( _base, r / _numT + _minT ) ), width = cvRound( pow( _base, r % _numT + _minT ) );
-    if( height > imgH * _base || width > imgW * _base )
-      continue;
-
-    height = min( height, imgH ), width = min( width, imgW );
-    Mat im3u, matchCost1f, mag1u;
-    resize( img3u, im3u, Size( cvRound( _W * imgW * 1.0 / width ), cvRound( _W * imgH * 1.0 / height ) ) );
-    gradientMag( im3u, mag1u );
-
-    matchCost1f = _tigF.matchTemplate( mag1u );
-
-    ValStructVec<float, Point> matchCost;
-    nonMaxSup( matchCost1f, matchCost, _NSS, NUM_WIN_PSZ, fast );
-
-    // Find true locations and match values
-    double ratioX = width / _W, ratioY = height / _W;
-    int iMax = min( matchCost.size(), NUM_WIN_PSZ );
-    for ( int i = 0; i < iMax; i++ )
+    const ValStructVec<float, Vec4i> &boxes = scaleBoxes[ir];
+    for ( int i = 0; i < boxes.size(); i++ )
     {
-      float mVal = matchCost( i );
-      Point pnt = matchCost[i];
-      Vec4i box( cvRound( pnt.x * ratioX ), cvRound( pnt.y * ratioY ) );
-      box[2] = cvRound( min( box[0] + width, imgW ) );
-      box[3] = cvRound( min( box[1] + height, imgH ) );
-      box[0]++;
-      box[1]++;
-      valBoxes.pushBack( mVal, box );
+      valBoxes.pushBack( boxes( i ), boxes[i] );
       sz.push_back( ir );
     }
   }
+}
 
+void ObjectnessBING::predictBBoxSIScale( Mat &img3u, int ir, ValStructVec<float, Vec4i> &valBoxes, int NUM_WIN_PSZ, bool fast )
+{
+  const int imgW = img3u.cols, imgH = img3u.rows;
+  int r = _svmSzIdxs[ir];
+  int height = cvRound( pow( _base, r / _numT + _minT ) ), width = cvRound( pow( _base, r % _numT + _minT ) );
+  if( height > imgH * _base || width > imgW * _base )
+    return;
+
+  height = min( height, imgH ), width = min( width, imgW );
+  Mat im3u, matchCost1f, mag1u;
+  resize( img3u, im3u, Size( cvRound( _W * imgW * 1.0 / width ), cvRound( _W * imgH * 1.0 / height ) ) );
+  gradientMag( im3u, mag1u );
+
+  matchCost1f = _tigF.matchTemplate( mag1u );
+
+  ValStructVec<float, Point> matchCost;
+  nonMaxSup( matchCost1f, matchCost, _NSS, NUM_WIN_PSZ, fast );
+
+  // Find true locations and match values
+  double ratioX = width / _W, ratioY = height / _W;
+  int iMax = min( matchCost.size(), NUM_WIN_PSZ );
+  valBoxes.reserve( iMax );
+  for ( int i = 0; i < iMax; i++ )
+  {
+    float mVal = matchCost( i );
+    Point pnt = matchCost[i];
+    Vec4i box( cvRound( pnt.x * ratioX ), cvRound( pnt.y * ratioY ) );
+    box[2] = cvRound( min( box[0] + width, imgW ) );
+    box[3] = cvRound( min( box[1] + height, imgH ) );
+    box[0]++;
+    box[1]++;
+    valBoxes.pushBack( mVal, box );
+  }
 }
 
 void ObjectnessBING::predictBBoxSII( ValStructVec<float, Vec4i> &valBoxes, const std::vector<int> &sz )
@@ -261,104 +302,143 @@ void ObjectnessBING::gradientMag( Mat &imgBGR3u, Mat &mag1u )
   }
 }
 
-void ObjectnessBING::gradientRGB( Mat &bgr3u, Mat &mag1u )
+/* The magnitude of the gradient is min(|dx| + |dy|, 255) with central differences, the first and last
+ * rows and columns use one sided differences. It is computed row by row and the inner pixels of the
+ * inner rows are vectorized, the results are identical to the scalar code.
+ */
+struct GradientMaxBGR
 {
-  const int H = bgr3u.rows, W = bgr3u.cols;
-  Mat Ix( H, W, CV_32S ), Iy( H, W, CV_32S );
-
-  // Left/right most column Ix
-  for ( int y = 0; y < H; y++ )
+  enum { cn = 3 };
+  static inline int inner( const uchar* u, const uchar* v )
   {
-    Ix.at<int>( y, 0 ) = bgrMaxDist( bgr3u.at<Vec3b>( y, 1 ), bgr3u.at<Vec3b>( y, 0 ) ) * 2;
-    Ix.at<int>( y, W - 1 ) = bgrMaxDist( bgr3u.at<Vec3b>( y, W - 1 ), bgr3u.at<Vec3b>( y, W - 2 ) ) * 2;
+    int b = abs( u[0] - v[0] ), g = abs( u[1] - v[1] ), r = abs( u[2] - v[2] );
+    return max( max( b, g ), r );
   }
-
-  // Top/bottom most column Iy
-  for ( int x = 0; x < W; x++ )
+  static inline int border( const uchar* u, const uchar* v )
+  {
+    return inner( u, v ) * 2;
+  }
+#if CV_SIMD128
+  static inline v_uint8x16 inner16( const uchar* l, const uchar* r, const uchar* t, const uchar* b )
   {
-    Iy.at<int>( 0, x ) = bgrMaxDist( bgr3u.at<Vec3b>( 1, x ), bgr3u.at<Vec3b>( 0, x ) ) * 2;
-    Iy.at<int>( H - 1, x ) = bgrMaxDist( bgr3u.at<Vec3b>( H - 1, x ), bgr3u.at<Vec3b>( H - 2, x ) ) * 2;
+    v_uint8x16 u0, u1, u2, v0, v1, v2;
+    v_load_deinterleave( l, u0, u1, u2 );
+    v_load_deinterleave( r, v0, v1, v2 );
+    v_uint8x16 dx = v_max( v_max( v_absdiff( u0, v0 ), v_absdiff( u1, v1 ) ), v_absdiff( u2, v2 ) );
+    v_load_deinterleave( t, u0, u1, u2 );
+    v_load_deinterleave( b, v0, v1, v2 );
+    v_uint8x16 dy = v_max( v_max( v_absdiff( u0, v0 ), v_absdiff( u1, v1 ) ), v_absdiff( u2, v2 ) );
+    return dx + dy;  // saturated
   }
+#endif
+};
 
-  // Find the gradient for inner regions
-  for ( int y = 0; y < H; y++ )
+struct GradientGray
+{
+  enum { cn = 1 };
+  static inline int inner( const uchar* u, const uchar* v )
   {
-    const Vec3b *dataP = bgr3u.ptr<Vec3b>( y );
-    for ( int x = 2; x < W; x++ )
-      Ix.at<int>( y, x - 1 ) = bgrMaxDist( dataP[x - 2], dataP[x] );  //  bgr3u.at<Vec3b>(y, x+1), bgr3u.at<Vec3b>(y, x-1));
+    return abs( u[0] - v[0] );
   }
-  for ( int y = 1; y < H - 1; y++ )
+  static inline int border( const uchar* u, const uchar* v )
   {
-    const Vec3b *tP = bgr3u.ptr<Vec3b>( y - 1 );
-    const Vec3b *bP = bgr3u.ptr<Vec3b>( y + 1 );
-    for ( int x = 0; x < W; x++ )
-      Iy.at<int>( y, x ) = bgrMaxDist( tP[x], bP[x] );
+    return inner( u, v ) * 2;
   }
-  gradientXY( Ix, Iy, mag1u );
-}
+#if CV_SIMD128
+  static inline v_uint8x16 inner16( const uchar* l, const uchar* r, const uchar* t, const uchar* b )
+  {
+    return v_absdiff( v_load( l ), v_load( r ) ) + v_absdiff( v_load( t ), v_load( b ) );  // saturated
+  }
+#endif
+};
 
-void ObjectnessBING::gradientGray( Mat &bgr3u, Mat &mag1u )
+struct GradientHSV
 {
-  Mat g1u;
-  cvtColor( bgr3u, g1u, COLOR_BGR2GRAY );
-  const int H = g1u.rows, W = g1u.cols;
-  Mat Ix( H, W, CV_32S ), Iy( H, W, CV_32S );
-
-  // Left/right most column Ix
-  for ( int y = 0; y < H; y++ )
+  enum { cn = 3 };
+  static inline int inner( const uchar* u, const uchar* v )
   {
-    Ix.at<int>( y, 0 ) = abs( g1u.at<BYTE>( y, 1 ) - g1u.at<BYTE>( y, 0 ) ) * 2;
-    Ix.at<int>( y, W - 1 ) = abs( g1u.at<BYTE>( y, W - 1 ) - g1u.at<BYTE>( y, W - 2 ) ) * 2;
+    return border( u, v ) / 2;
   }
-
-  // Top/bottom most column Iy
-  for ( int x = 0; x < W; x++ )
+  static inline int border( const uchar* u, const uchar* v )
   {
-    Iy.at<int>( 0, x ) = abs( g1u.at<BYTE>( 1, x ) - g1u.at<BYTE>( 0, x ) ) * 2;
-    Iy.at<int>( H - 1, x ) = abs( g1u.at<BYTE>( H - 1, x ) - g1u.at<BYTE>( H - 2, x ) ) * 2;
+    return abs( u[0] - v[0] ) + abs( u[1] - v[1] ) + abs( u[2] - v[2] );
   }
+#if CV_SIMD128
+  static inline void dist16( const uchar* u, const uchar* v, v_uint16x8& lo, v_uint16x8& hi )
+  {
+    v_uint8x16 u0, u1, u2, v0, v1, v2;
+    v_load_deinterleave( u, u0, u1, u2 );
+    v_load_deinterleave( v, v0, v1, v2 );
+    v_uint16x8 l0, h0, l1, h1, l2, h2;
+    v_expand( v_absdiff( u0, v0 ), l0, h0 );
+    v_expand( v_absdiff( u1, v1 ), l1, h1 );
+    v_expand( v_absdiff( u2, v2 ), l2, h2 );
+    lo = ( l0 + l1 + l2 ) >> 1;
+    hi = ( h0 + h1 + h2 ) >> 1;
+  }
+  static inline v_uint8x16 inner16( const uchar* l, const uchar* r, const uchar* t, const uchar* b )
+  {
+    v_uint16x8 xlo, xhi, ylo, yhi;
+    dist16( l, r, xlo, xhi );
+    dist16( t, b, ylo, yhi );
+    return v_pack( xlo + ylo, xhi + yhi );  // saturated
+  }
+#endif
+};
 
-  // Find the gradient for inner regions
+template<typename Grad>
+static void gradientMagnitude( const Mat &img, Mat &mag1u )
+{
+  const int H = img.rows, W = img.cols, cn = Grad::cn;
+  CV_Assert( img.type() == CV_8UC(cn) && H >= 2 && W >= 2 );
+  mag1u.create( H, W, CV_8U );
   for ( int y = 0; y < H; y++ )
-    for ( int x = 1; x < W - 1; x++ )
-      Ix.at<int>( y, x ) = abs( g1u.at<BYTE>( y, x + 1 ) - g1u.at<BYTE>( y, x - 1 ) );
-  for ( int y = 1; y < H - 1; y++ )
-    for ( int x = 0; x < W; x++ )
-      Iy.at<int>( y, x ) = abs( g1u.at<BYTE>( y + 1, x ) - g1u.at<BYTE>( y - 1, x ) );
+  {
+    const uchar* p = img.ptr<uchar>( y );
+    const bool innerRow = y > 0 && y < H - 1;
+    // rows of the vertical difference
+    const uchar* t = img.ptr<uchar>( y == 0 ? 1 : ( innerRow ? y - 1 : H - 1 ) );
+    const uchar* b = img.ptr<uchar>( y == 0 ? 0 : ( innerRow ? y + 1 : H - 2 ) );
+    uchar* m = mag1u.ptr<uchar>( y );
+
+    int dy = innerRow ? Grad::inner( t, b ) : Grad::border( t, b );
+    m[0] = (uchar) min( Grad::border( p + cn, p ) + dy, 255 );
+    int x = 1;
+#if CV_SIMD128
+    if( innerRow )
+    {
+      for ( ; x <= W - 17; x += 16 )
+        v_store( m + x, Grad::inner16( p + ( x - 1 ) * cn, p + ( x + 1 ) * cn, t + x * cn, b + x * cn ) );
+    }
+#endif
+    for ( ; x < W - 1; x++ )
+    {
+      dy = innerRow ? Grad::inner( t + x * cn, b + x * cn ) : Grad::border( t + x * cn, b + x * cn );
+      m[x] = (uchar) min( Grad::inner( p + ( x - 1 ) * cn, p + ( x + 1 ) * cn ) + dy, 255 );
+    }
+    x = W - 1;
+    dy = innerRow ? Grad::inner( t + x * cn, b + x * cn ) : Grad::border( t + x * cn, b + x * cn );
+    m[x] = (uchar) min( Grad::border( p + x * cn, p + ( x - 1 ) * cn ) + dy, 255 );
+  }
+}
 
-  gradientXY( Ix, Iy, mag1u );
+void ObjectnessBING::gradientRGB( Mat &bgr3u, Mat &mag1u )
+{
+  gradientMagnitude<GradientMaxBGR>( bgr3u, mag1u );
+}
+
+void ObjectnessBING::gradientGray( Mat &bgr3u, Mat &mag1u )
+{
+  Mat g1u;
+  cvtColor( bgr3u, g1u, COLOR_BGR2GRAY );
+  gradientMagnitude<GradientGray>( g1u, mag1u );
 }
 
 void ObjectnessBING::gradientHSV( Mat &bgr3u, Mat &mag1u )
 {
   Mat hsv3u;
   cvtColor( bgr3u, hsv3u, COLOR_BGR2HSV );
-  const int H = hsv3u.rows, W = hsv3u.cols;
-  Mat Ix( H, W, CV_32S ), Iy( H, W, CV_32S );
-
-  // Left/right most column Ix
-  for ( int y = 0; y < H; y++ )
-  {
-    Ix.at<int>( y, 0 ) = vecDist3b( hsv3u.at<Vec3b>( y, 1 ), hsv3u.at<Vec3b>( y, 0 ) );
-    Ix.at<int>( y, W - 1 ) = vecDist3b( hsv3u.at<Vec3b>( y, W - 1 ), hsv3u.at<Vec3b>( y, W - 2 ) );
-  }
-
-  // Top/bottom most column Iy
-  for ( int x = 0; x < W; x++ )
-  {
-    Iy.at<int>( 0, x ) = vecDist3b( hsv3u.at<Vec3b>( 1, x ), hsv3u.at<Vec3b>( 0, x ) );
-    Iy.at<int>( H - 1, x ) = vecDist3b( hsv3u.at<Vec3b>( H - 1, x ), hsv3u.at<Vec3b>( H - 2, x ) );
-  }
-
-  // Find the gradient for inner regions
-  for ( int y = 0; y < H; y++ )
-    for ( int x = 1; x < W - 1; x++ )
-      Ix.at<int>( y, x ) = vecDist3b( hsv3u.at<Vec3b>( y, x + 1 ), hsv3u.at<Vec3b>( y, x - 1 ) ) / 2;
-  for ( int y = 1; y < H - 1; y++ )
-    for ( int x = 0; x < W; x++ )
-      Iy.at<int>( y, x ) = vecDist3b( hsv3u.at<Vec3b>( y + 1, x ), hsv3u.at<Vec3b>( y - 1, x ) ) / 2;
-
-  gradientXY( Ix, Iy, mag1u );
+  gradientMagnitude<GradientHSV>( hsv3u, mag1u );
 }
 
 void ObjectnessBING::gradientXY( Mat &x1i, Mat &y1i, Mat &mag1u )
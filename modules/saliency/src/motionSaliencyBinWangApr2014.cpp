@@ -41,6 +41,7 @@
 
 #include <limits>
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 //TODO delete highgui include
 //#include <opencv2/highgui.hpp>
 
@@ -52,6 +53,221 @@ namespace cv
 namespace saliency
 {
 
+/* Matches every pixel against the templates of the background model and updates them, the rows are
+ * independent and processed in parallel, four pixels at a time with SIMD.
+ */
+class FullResolutionDetectionInvoker : public ParallelLoopBody
+{
+public:
+  FullResolutionDetectionInvoker( const Mat& _image, const Mat& _epslon, std::vector<Mat>& _values, std::vector<Mat>& _efficacy,
+                                  Mat& _mask, float _alpha, int _L0, int _L1 ) :
+      image( _image ), epslon( _epslon ), values( _values ), efficacy( _efficacy ), mask( _mask ), alpha( _alpha ), L0( _L0 ), L1( _L1 )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    const int nT = (int) values.size(), cols = image.cols;
+    AutoBuffer<float*> _rows( 2 * nT );
+    float** B = _rows;
+    float** C = B + nT;
+
+    for ( int i = range.start; i < range.end; i++ )
+    {
+      const uchar* pImage = image.ptr<uchar>( i );
+      const float* pEpslon = epslon.ptr<float>( i );
+      float* pMask = mask.ptr<float>( i );
+      for ( int z = 0; z < nT; z++ )
+      {
+        B[z] = values[z].ptr<float>( i );
+        C[z] = efficacy[z].ptr<float>( i );
+      }
+
+      int j = 0;
+#if CV_SIMD128
+      const v_float32x4 zero = v_setzero_f32(), one = v_setall_f32( 1.f );
+      const v_float32x4 va = v_setall_f32( alpha ), v1a = v_setall_f32( 1 - alpha );
+      const v_float32x4 vL0 = v_setall_f32( (float) L0 ), vL1 = v_setall_f32( (float) L1 );
+      for ( ; j <= cols - 4; j += 4 )
+      {
+        const v_float32x4 p = v_cvt_f32( v_reinterpret_as_s32( v_load_expand_q( pImage + j ) ) );
+        const v_float32x4 eps = v_load( pEpslon + j );
+
+        v_int32x4 counter = v_setzero_s32();
+        for ( int z = 0; z < nT; z++ )
+          counter += v_trunc( v_load( C[z] + j ) );
+        // if at least the first template is activated / initialized
+        const v_float32x4 initialized = v_reinterpret_as_f32( ~( counter == v_setzero_s32() ) );
+
+        v_float32x4 backgFlag = zero;
+        for ( int z = 0; z < nT; z++ )
+        {
+          v_float32x4 b = v_load( B[z] + j ), c = v_load( C[z] + j );
+          const v_float32x4 active = initialized & ( c > zero );
+          const v_float32x4 match = active & ( v_abs( p - b ) < eps ) & ~backgFlag;
+          v_float32x4 increment = match;
+          if( z == 0 )
+            increment = increment & ( c < vL0 );
+          else if( z == 1 )
+            increment = increment & ( c < vL1 );
+          c = c + ( increment & one ) - ( ( active & ~match ) & one );
+          b = v_select( match, v1a * b + va * p, b );
+          backgFlag = backgFlag | match;
+          v_store( B[z] + j, b );
+          v_store( C[z] + j, c );
+        }
+        v_store( pMask + j, v_select( backgFlag, zero, one ) );
+      }
+#endif
+      for ( ; j < cols; j++ )
+      {
+        const float currentPixelValue = pImage[j];
+        const float currentEpslonValue = pEpslon[j];
+
+        int counter = 0;
+        for ( int z = 0; z < nT; z++ )
+          counter += (int) C[z][j];
+
+        // Initially, all pixels are considered as foreground and then we evaluate with the background model
+        pMask[j] = 1;
+        if( counter == 0 )  // if the model of the current pixel is not yet initialized, we mark the pixels as foreground
+          continue;
+
+        bool backgFlag = false;
+        for ( int z = 0; z < nT; z++ )
+        {
+          float& currentB = B[z][j];
+          float& currentC = C[z][j];
+          if( currentC > 0 )  //The current template is active
+          {
+            // If there is a match with a current background template
+            if( abs( currentPixelValue - currentB ) < currentEpslonValue && !backgFlag )
+            {
+              // The correspondence pixel in the  BF mask is set as background ( 0 value)
+              pMask[j] = 0;
+              if( ( currentC < L0 && z == 0 ) || ( currentC < L1 && z == 1 ) || ( z > 1 ) )
+                currentC += 1;  // increment the efficacy of this template
+
+              currentB = ( ( 1 - alpha ) * currentB ) + ( alpha * currentPixelValue );  // Update the template value
+              backgFlag = true;
+            }
+            else
+            {
+              currentC -= 1;  // decrement the efficacy of this template
+            }
+          }
+        }
+      }
+    }
+  }
+
+private:
+  const Mat& image;
+  const Mat& epslon;
+  std::vector<Mat>& values;
+  std::vector<Mat>& efficacy;
+  Mat& mask;
+  float alpha;
+  int L0, L1;
+
+  FullResolutionDetectionInvoker& operator=( const FullResolutionDetectionInvoker& );
+};
+
+/* Sorts the templates T1...TK of every pixel by decreasing efficacy and swaps T0 and T1 when T1 became
+ * the long-term background. The sort is an odd-even transposition sort that only swaps strictly
+ * misordered neighbours, so it is stable like the previous per pixel std::sort of the few templates,
+ * and it runs on four pixels at a time.
+ */
+class TemplateOrderingInvoker : public ParallelLoopBody
+{
+public:
+  TemplateOrderingInvoker( std::vector<Mat>& _values, std::vector<Mat>& _efficacy, int _thetaL, int _gamma ) :
+      values( _values ), efficacy( _efficacy ), thetaL( _thetaL ), gamma( _gamma )
+  {
+  }
+
+  void operator()( const Range& range ) const
+  {
+    const int nT = (int) values.size(), cols = values[0].cols;
+    const float thL = (float) thetaL, newC0 = (float) gamma * thetaL;
+    AutoBuffer<float*> _rows( 2 * nT );
+    float** B = _rows;
+    float** C = B + nT;
+
+    for ( int i = range.start; i < range.end; i++ )
+    {
+      for ( int z = 0; z < nT; z++ )
+      {
+        B[z] = values[z].ptr<float>( i );
+        C[z] = efficacy[z].ptr<float>( i );
+      }
+
+      int j = 0;
+#if CV_SIMD128
+      const v_float32x4 vthL = v_setall_f32( thL ), vnewC0 = v_setall_f32( newC0 );
+      for ( ; j <= cols - 4; j += 4 )
+      {
+        for ( int pass = 1; pass < nT; pass++ )
+        {
+          for ( int z = 1 + ( pass + 1 ) % 2; z + 1 < nT; z += 2 )
+          {
+            v_float32x4 b0 = v_load( B[z] + j ), b1 = v_load( B[z + 1] + j );
+            v_float32x4 c0 = v_load( C[z] + j ), c1 = v_load( C[z + 1] + j );
+            const v_float32x4 swap = c0 < c1;
+            v_store( B[z] + j, v_select( swap, b1, b0 ) );
+            v_store( B[z + 1] + j, v_select( swap, b0, b1 ) );
+            v_store( C[z] + j, v_select( swap, c1, c0 ) );
+            v_store( C[z + 1] + j, v_select( swap, c0, c1 ) );
+          }
+        }
+
+        // SORT Template T0 and T1
+        v_float32x4 b0 = v_load( B[0] + j ), b1 = v_load( B[1] + j );
+        v_float32x4 c0 = v_load( C[0] + j ), c1 = v_load( C[1] + j );
+        const v_float32x4 swap = ( c1 > vthL ) & ( c0 < vthL );
+        v_store( B[0] + j, v_select( swap, b1, b0 ) );
+        v_store( B[1] + j, v_select( swap, b0, b1 ) );
+        v_store( C[0] + j, v_select( swap, vnewC0, c0 ) );
+        v_store( C[1] + j, v_select( swap, c0, c1 ) );
+      }
+#endif
+      for ( ; j < cols; j++ )
+      {
+        //SORT template from T1 to Tk
+        for ( int pass = 1; pass < nT; pass++ )
+        {
+          for ( int z = 1 + ( pass + 1 ) % 2; z + 1 < nT; z += 2 )
+          {
+            if( C[z][j] < C[z + 1][j] )
+            {
+              std::swap( B[z][j], B[z + 1][j] );
+              std::swap( C[z][j], C[z + 1][j] );
+            }
+          }
+        }
+
+        // SORT Template T0 and T1
+        if( C[1][j] > thL && C[0][j] < thL )
+        {
+          // swap B value of T0 with B value of T1 (for current model)
+          std::swap( B[0][j], B[1][j] );
+
+          // set new C0 value for current model)
+          C[1][j] = C[0][j];
+          C[0][j] = newC0;
+        }
+      }
+    }
+  }
+
+private:
+  std::vector<Mat>& values;
+  std::vector<Mat>& efficacy;
+  int thetaL, gamma;
+
+  TemplateOrderingInvoker& operator=( const TemplateOrderingInvoker& );
+};
+
 void MotionSaliencyBinWangApr2014::setImagesize( int W, int H )
 {
   imageWidth = W;
@@ -84,15 +300,13 @@ bool MotionSaliencyBinWangApr2014::init()
 
   potentialBackground = Mat( imgSize.height, imgSize.width, CV_32FC2, Scalar( std::numeric_limits<float>::quiet_NaN(), 0 ) );
 
-  backgroundModel.resize( K + 1 );
+  backgroundValues.resize( K + 1 );
+  backgroundEfficacy.resize( K + 1 );
 
   for ( int i = 0; i < K + 1; i++ )
   {
-    Mat* tmpm = new Mat;
-    tmpm->create( imgSize.height, imgSize.width, CV_32FC2 );
-    tmpm->setTo( Scalar( std::numeric_limits<float>::quiet_NaN(), 0 ) );
-    Ptr<Mat> tmp = Ptr<Mat>( tmpm );
-    backgroundModel[i] = tmp;
+    backgroundValues[i] = Mat( imgSize.height, imgSize.width, CV_32F, Scalar( std::numeric_limits<float>::quiet_NaN() ) );
+    backgroundEfficacy[i] = Mat( imgSize.height, imgSize.width, CV_32F, Scalar( 0 ) );
   }
 
   return true;
@@ -105,98 +319,24 @@ MotionSaliencyBinWangApr2014::~MotionSaliencyBinWangApr2014()
 }
 
 // classification (and adaptation) functions
-bool MotionSaliencyBinWangApr2014::fullResolutionDetection( const Mat& image2, Mat& highResBFMask )
+bool MotionSaliencyBinWangApr2014::fullResolutionDetection( const Mat& image, Mat& highResBFMask )
 {
-  Mat image = image2.clone();
-
-  float currentPixelValue;
-  float currentEpslonValue;
-  bool backgFlag = false;
+  CV_Assert( image.type() == CV_8UC1 && image.size() == epslonPixelsValue.size() );
 
-  // Initially, all pixels are considered as foreground and then we evaluate with the background model
   highResBFMask.create( image.rows, image.cols, CV_32F );
-  highResBFMask.setTo( 1 );
-
-  uchar* pImage;
-  float* pEpslon;
-  float* pMask;
-
-  // Scan all pixels of image
-  for ( int i = 0; i < image.rows; i++ )
-  {
-
-    pImage = image.ptr<uchar>( i );
-    pEpslon = epslonPixelsValue.ptr<float>( i );
-    pMask = highResBFMask.ptr<float>( i );
-    for ( int j = 0; j < image.cols; j++ )
-    {
-
-      backgFlag = false;
-      currentPixelValue = pImage[j];
-      currentEpslonValue = pEpslon[j];
-
-      int counter = 0;
-      for ( size_t z = 0; z < backgroundModel.size(); z++ )
-      {
 
-        counter += (int) backgroundModel[z]->ptr<Vec2f>( i )[j][1];
-      }
-
-      if( counter != 0 )  //if at least the first template is activated / initialized
-      {
-
-        // scan background model vector
-        for ( size_t z = 0; z < backgroundModel.size(); z++ )
-        {
-          float* currentB;
-          float* currentC;
-          currentB = & ( backgroundModel[z]->ptr<Vec2f>( i )[j][0] );
-          currentC = & ( backgroundModel[z]->ptr<Vec2f>( i )[j][1] );
-
-          //continue;
-          if( ( *currentC ) > 0 )  //The current template is active
-          {
-            // If there is a match with a current background template
-            if( abs( currentPixelValue - ( *currentB ) ) < currentEpslonValue && !backgFlag )
-            {
-              // The correspondence pixel in the  BF mask is set as background ( 0 value)
-              pMask[j] = 0;
-              if( ( *currentC < L0 && z == 0 ) || ( *currentC < L1 && z == 1 ) || ( z > 1 ) )
-              {
-                *currentC += 1;  // increment the efficacy of this template
-              }
-
-              *currentB = ( ( 1 - alpha ) * ( *currentB ) ) + ( alpha * currentPixelValue );  // Update the template value
-              backgFlag = true;
-            }
-            else
-            {
-              *currentC -= 1;  // decrement the efficacy of this template
-            }
-
-          }
-
-        }  // end "for" cicle of template vector
-
-      }
-      else
-      {
-        pMask[j] = 1;  //if the model of the current pixel is not yet initialized, we mark the pixels as foreground
-      }
-
-    }
-  }  // end "for" cicle of all image's pixels
+  parallel_for_( Range( 0, image.rows ),
+                 FullResolutionDetectionInvoker( image, epslonPixelsValue, backgroundValues, backgroundEfficacy, highResBFMask, alpha, L0, L1 ) );
 
   return true;
 }
 
 bool MotionSaliencyBinWangApr2014::lowResolutionDetection( const Mat& image, Mat& lowResBFMask )
 {
-  std::vector<Mat> mv;
-  split( *backgroundModel[0], mv );
+  const Mat& C0 = backgroundEfficacy[0];
 
   //if at least the first template is activated / initialized for all pixels
-  if( countNonZero( mv[1] ) > ( mv[1].cols * mv[1].rows ) / 2 )
+  if( countNonZero( C0 ) > ( C0.cols * C0.rows ) / 2 )
   {
     float currentPixelValue;
     float currentEpslonValue;
@@ -207,8 +347,6 @@ bool MotionSaliencyBinWangApr2014::lowResolutionDetection( const Mat& image, Mat
 
     Rect roi( Point( 0, 0 ), Size( N, N ) );
     Scalar imageROImean;
-    Scalar backGModelROImean;
-    Mat currentModel;
 
     // Initially, all pixels are considered as foreground and then we evaluate with the background model
     lowResBFMask.create( image.rows, image.cols, CV_32F );
@@ -234,11 +372,9 @@ bool MotionSaliencyBinWangApr2014::lowResolutionDetection( const Mat& image, Mat
         // scan background model vector
         for ( int z = 0; z < N_DS; z++ )
         {
-          // Select the current template 2 channel matrix, select ROI and compute the mean for each channel separately
-          Mat roiTemplate = ( * ( backgroundModel[z] ) )( roi );
-          Scalar templateMean = mean( roiTemplate );
-          currentB = (float) templateMean[0];
-          currentC = (float) templateMean[1];
+          // Select ROI of the current template and compute the mean of the values and of the efficacies
+          currentB = (float) mean( backgroundValues[z]( roi ) ).val[0];
+          currentC = (float) mean( backgroundEfficacy[z]( roi ) ).val[0];
 
           if( ( currentC ) > 0 )  //The current template is active
           {
@@ -282,72 +418,17 @@ bool MotionSaliencyBinWangApr2014::lowResolutionDetection( const Mat& image, Mat
 
 }
 
-bool inline pairCompare( std::pair<float, float> t, std::pair<float, float> t_plusOne )
-{
-
-  return ( t.second > t_plusOne.second );
-
-}
-
 // Background model maintenance functions
 bool MotionSaliencyBinWangApr2014::templateOrdering()
 {
-  std::vector<std::pair<float, float> > pixelTemplates( backgroundModel.size() );
-
-  Vec2f* bgModel_0P;
-  Vec2f* bgModel_1P;
-
-// Scan all pixels of image
-  for ( int i = 0; i < backgroundModel[0]->rows; i++ )
-  {
-    bgModel_0P = backgroundModel[0]->ptr<Vec2f>( i );
-    bgModel_1P = backgroundModel[1]->ptr<Vec2f>( i );
-    for ( int j = 0; j < backgroundModel[0]->cols; j++ )
-    {
-      // scan background model vector from T1 to Tk
-      for ( size_t z = 1; z < backgroundModel.size(); z++ )
-      {
-        Vec2f bgModel_zP = backgroundModel[z]->ptr<Vec2f>( i )[j];
-        // Fill vector of pairs
-        pixelTemplates[z - 1].first = bgModel_zP[0];  // Current B (background value)
-        pixelTemplates[z - 1].second = bgModel_zP[1];  // Current C (efficacy value)
-      }
-
-      //SORT template from T1 to Tk
-      std::sort( pixelTemplates.begin(), pixelTemplates.end(), pairCompare );
-
-      //REFILL CURRENT MODEL ( T1...Tk)
-      for ( size_t zz = 1; zz < backgroundModel.size(); zz++ )
-      {
-        backgroundModel[zz]->ptr<Vec2f>( i )[j][0] = pixelTemplates[zz - 1].first;  // Replace previous B with new ordered B value
-        backgroundModel[zz]->ptr<Vec2f>( i )[j][1] = pixelTemplates[zz - 1].second;  // Replace previous C with new ordered C value
-      }
-
-      // SORT Template T0 and T1
-      if( bgModel_1P[j][1] > thetaL && bgModel_0P[j][1] < thetaL )
-      {
-
-        // swap B value of T0 with B value of T1 (for current model)
-        swap( bgModel_0P[j][0], bgModel_1P[j][0] );
-
-        // set new C0 value for current model)
-        swap( bgModel_0P[j][1], bgModel_1P[j][1] );
-        bgModel_0P[j][1] = (float) gamma * thetaL;
-
-      }
-
-    }
-  }
+  parallel_for_( Range( 0, backgroundValues[0].rows ), TemplateOrderingInvoker( backgroundValues, backgroundEfficacy, thetaL, gamma ) );
 
   return true;
 }
 bool MotionSaliencyBinWangApr2014::templateReplacement( const Mat& finalBFMask, const Mat& image )
 {
-  std::vector<Mat> temp;
-  split( *backgroundModel[0], temp );
-
-//if at least the first template is activated / initialized for all pixels
-  if( countNonZero( temp[1] ) <= ( temp[1].cols * temp[1].rows ) / 2 )
+  //if at least the first template is activated / initialized for all pixels
+  if( countNonZero( backgroundEfficacy[0] ) <= ( finalBFMask.cols * finalBFMask.rows ) / 2 )
   {
     thetaA = 50;
     thetaL = 150;
@@ -361,14 +442,12 @@ bool MotionSaliencyBinWangApr2014::templateReplacement( const Mat& finalBFMask,
     neighborhoodCheck = true;
   }
 
-  int roiSize = 3;  // FIXED ROI SIZE, not change until you first appropriately adjust the following controls in the EVALUATION section!
-  int countNonZeroElements = 0;
-  std::vector<Mat> mv;
-  Mat replicateCurrentBAMat( roiSize, roiSize, CV_32F );
-  Mat backgroundModelROI( roiSize, roiSize, CV_32F );
-  Mat diffResult( roiSize, roiSize, CV_32F );
+  const int nT = (int) backgroundValues.size();
+  Mat& lastValues = backgroundValues[nT - 1];
+  Mat& lastEfficacy = backgroundEfficacy[nT - 1];
 
 // Scan all pixels of finalBFMask and all pixels of others models (the dimension are the same)
+// The pixels are scanned in order since a replaced template is seen by the neighborhood of the next pixels
   const float* finalBFMaskP;
   Vec2f* pbgP;
   const uchar* imageP;
@@ -406,92 +485,43 @@ bool MotionSaliencyBinWangApr2014::templateReplacement( const Mat& finalBFMask,
         /////////////////// EVALUATION of potentialBackground values ///////////////////
         if( pbgP[j][1] > thetaA )
         {
+          bool replace = true;
           if( neighborhoodCheck )
           {
-            // replicate currentBA value
-            replicateCurrentBAMat.setTo( pbgP[j][0] );
-
-            for ( size_t z = 0; z < backgroundModel.size(); z++ )
+            // 3x3 neighborhood of current pixel, clipped to the image
+            const int y0 = std::max( i - 1, 0 ), y1 = std::min( i + 1, finalBFMask.rows - 1 );
+            const int x0 = std::max( j - 1, 0 ), x1 = std::min( j + 1, finalBFMask.cols - 1 );
+            const float currentBA = pbgP[j][0];
+
+            /* Check if the value of current pixel BA in potentialBackground model is already contained in at least one of its neighbors'
+             * background model. As with the thresholded difference used before, a NaN (not initialized) value is a match.
+             */
+            replace = false;
+            for ( int z = 0; z < nT && !replace; z++ )
             {
-              // Neighborhood of current pixel in the current background model template.
-              // The ROI is centered in the pixel coordinates
-
-              if( i > 0 && j > 0 && i < ( backgroundModel[z]->rows - 1 ) && j < ( backgroundModel[z]->cols - 1 ) )
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), roiSize, roiSize ) );
-              }
-              else if( i == 0 && j == 0 )  // upper leftt
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j, i, (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( j == 0 && i > 0 && i < ( backgroundModel[z]->rows - 1 ) )  // middle left
+              for ( int y = y0; y <= y1 && !replace; y++ )
               {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j, i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), roiSize ) );
+                const float* neighborsB = backgroundValues[z].ptr<float>( y );
+                for ( int x = x0; x <= x1; x++ )
+                {
+                  if( !( abs( currentBA - neighborsB[x] ) > epslonP[j] ) )
+                  {
+                    replace = true;
+                    break;
+                  }
+                }
               }
-              else if( i == ( backgroundModel[z]->rows - 1 ) && j == 0 )  //down left
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j, i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( i == 0 && j > 0 && j < ( backgroundModel[z]->cols - 1 ) )  // upper - middle
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( ( j - (int) floor((float) roiSize / 2 ) ), i, roiSize, (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( i == ( backgroundModel[z]->rows - 1 ) && j > 0 && j < ( backgroundModel[z]->cols - 1 ) )  //down middle
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0](
-                    Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), roiSize, (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( i == 0 && j == ( backgroundModel[z]->cols - 1 ) )  // upper right
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j - (int) floor((float) roiSize / 2 ), i, (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( j == ( backgroundModel[z]->cols - 1 ) && i > 0 && i < ( backgroundModel[z]->rows - 1 ) )  // middle - right
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0](
-                    Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), roiSize ) );
-              }
-              else if( i == ( backgroundModel[z]->rows - 1 ) && j == ( backgroundModel[z]->cols - 1 ) )  // down right
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0](
-                    Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-
-              /* Check if the value of current pixel BA in potentialBackground model is already contained in at least one of its neighbors'
-               * background model
-               */
-              resize( replicateCurrentBAMat, replicateCurrentBAMat, Size( backgroundModelROI.cols, backgroundModelROI.rows ), 0, 0, INTER_LINEAR );
-              resize( diffResult, diffResult, Size( backgroundModelROI.cols, backgroundModelROI.rows ), 0, 0, INTER_LINEAR );
-
-              absdiff( replicateCurrentBAMat, backgroundModelROI, diffResult );
-              threshold( diffResult, diffResult, epslonP[j], 255, THRESH_BINARY_INV );
-              countNonZeroElements = countNonZero( diffResult );
-
-              if( countNonZeroElements > 0 )
-              {
-                /////////////////// REPLACEMENT of backgroundModel template ///////////////////
-                //replace TA with current TK
-                backgroundModel[backgroundModel.size() - 1]->at<Vec2f>( i, j ) = potentialBackground.at<Vec2f>( i, j );
-                potentialBackground.at<Vec2f>( i, j )[0] = std::numeric_limits<float>::quiet_NaN();
-                potentialBackground.at<Vec2f>( i, j )[1] = 0;
-
-                break;
-              }
-            }  // end for backgroundModel size
+            }
           }
-          else
+
+          if( replace )
           {
-            backgroundModel[backgroundModel.size() - 1]->at<Vec2f>( i, j ) = potentialBackground.at<Vec2f>( i, j );
-            potentialBackground.at<Vec2f>( i, j )[0] = std::numeric_limits<float>::quiet_NaN();
-            potentialBackground.at<Vec2f>( i, j )[1] = 0;
+            /////////////////// REPLACEMENT of backgroundModel template ///////////////////
+            //replace TA with current TK
+            lastValues.at<float>( i, j ) = pbgP[j][0];
+            lastEfficacy.at<float>( i, j ) = pbgP[j][1];
+            pbgP[j][0] = std::numeric_limits<float>::quiet_NaN();
+            pbgP[j][1] = 0;
           }
         }  // close if of EVALUATION
       }  // end of  if( finalBFMask.at<uchar>( i, j ) == 1 )  // i.e. the corresponding frame pixel has been market as foreground
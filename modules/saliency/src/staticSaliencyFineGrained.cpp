@@ -40,6 +40,7 @@
  //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -81,6 +82,99 @@ void StaticSaliencyFineGrained::copyImage(Mat srcArg, Mat dstArg)
     srcArg.copyTo(dstArg);
 }
 
+/* Center-surround differences of all the scales in one pass over the rows, the on and off values
+ * of the scales are summed directly into mixedOn and mixedOff (CV_16U). The windows are clipped to the
+ * image as in the scalar lookup, the columns where no scale is clipped are vectorized.
+ */
+class FineGrainedScalesInvoker : public ParallelLoopBody
+{
+public:
+    FineGrainedScalesInvoker(const Mat& _integralImage, const Mat& _gray, const int* _neighborhoods, int _numScales,
+                             Mat& _mixedOn, Mat& _mixedOff) :
+        integralImage(_integralImage), gray(_gray), neighborhoods(_neighborhoods), numScales(_numScales),
+        mixedOn(_mixedOn), mixedOff(_mixedOff)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const int W = gray.cols, H = gray.rows;
+        AutoBuffer<int> _sums(2 * W);
+        int* sumOn = _sums;
+        int* sumOff = sumOn + W;
+
+        for(int y = range.start; y < range.end; y++)
+        {
+            const uchar* g = gray.ptr<uchar>(y);
+            memset(sumOn, 0, 2 * W * sizeof(int));
+
+            for(int i = 0; i < numScales; i++)
+            {
+                const int n = neighborhoods[i];
+                const int y1 = clip(y - n + 1, H), y2 = clip(y + n + 1, H);
+                const float* I1 = integralImage.ptr<float>(y1);
+                const float* I2 = integralImage.ptr<float>(y2);
+                // columns whose window is not clipped
+                const int xBegin = std::min(n - 1, W), xEnd = std::max(W - n, xBegin);
+
+                int x = 0;
+                for(; x < xBegin; x++)
+                    centerSurround(I1, I2, clip(x - n + 1, W), clip(x + n + 1, W), y2 - y1, g[x], sumOn[x], sumOff[x]);
+#if CV_SIMD128
+                const v_float32x4 zero = v_setzero_f32();
+                const v_float32x4 area = v_setall_f32((float)(2 * n * (y2 - y1) - 1));
+                for(; x <= xEnd - 4; x += 4)
+                {
+                    const v_float32x4 center = v_cvt_f32(v_reinterpret_as_s32(v_load_expand_q(g + x)));
+                    v_float32x4 value = v_load(I2 + x + n + 1) + v_load(I1 + x - n + 1) - v_load(I2 + x - n + 1) - v_load(I1 + x + n + 1);
+                    value = (value - center) / area;
+                    v_store(sumOn + x, v_load(sumOn + x) + v_trunc(v_max(center - value, zero)));
+                    v_store(sumOff + x, v_load(sumOff + x) + v_trunc(v_max(value - center, zero)));
+                }
+#endif
+                for(; x < W; x++)
+                    centerSurround(I1, I2, clip(x - n + 1, W), clip(x + n + 1, W), y2 - y1, g[x], sumOn[x], sumOff[x]);
+            }
+
+            ushort* on = mixedOn.ptr<ushort>(y);
+            ushort* off = mixedOff.ptr<ushort>(y);
+            for(int x = 0; x < W; x++)
+            {
+                on[x] = (ushort)sumOn[x];
+                off[x] = (ushort)sumOff[x];
+            }
+        }
+    }
+
+private:
+    // coordinates in the integral image, which has one more row and column than the image
+    static inline int clip(int v, int size)
+    {
+        return std::min(std::max(v, 0), size);
+    }
+
+    // we use the integral image to compute fast features
+    static inline void centerSurround(const float* I1, const float* I2, int x1, int x2, int dy, int centerVal, int& on, int& off)
+    {
+        float value = (float)(I2[x2] + I1[x1] - I2[x1] - I1[x2]);
+        value = (value - centerVal) / ((x2 - x1) * dy - 1);
+        const float meanOn = centerVal - value;
+        const float meanOff = value - centerVal;
+        if(meanOn > 0)
+            on += (uchar)meanOn;
+        if(meanOff > 0)
+            off += (uchar)meanOff;
+    }
+
+    const Mat& integralImage;
+    const Mat& gray;
+    const int* neighborhoods;
+    int numScales;
+    Mat& mixedOn;
+    Mat& mixedOff;
+
+    FineGrainedScalesInvoker& operator=(const FineGrainedScalesInvoker&);
+};
+
 void StaticSaliencyFineGrained::calcIntensityChannel(Mat srcArg, Mat dstArg)
 {
     if(dstArg.channels() > 1)
@@ -89,23 +183,15 @@ void StaticSaliencyFineGrained::calcIntensityChannel(Mat srcArg, Mat dstArg)
         return;
     }
     const int numScales = 6;
-    Mat intensityScaledOn[numScales];
-    Mat intensityScaledOff[numScales];
     Mat gray = Mat::zeros(Size(srcArg.cols, srcArg.rows), CV_8UC1);
     Mat integralImage(Size(srcArg.cols + 1, srcArg.rows + 1), CV_32FC1);
     Mat intensity(Size(srcArg.cols, srcArg.rows), CV_8UC1);
     Mat intensityOn(Size(srcArg.cols, srcArg.rows), CV_8UC1);
     Mat intensityOff(Size(srcArg.cols, srcArg.rows), CV_8UC1);
+    Mat mixedValuesOn(Size(srcArg.cols, srcArg.rows), CV_16UC1);
+    Mat mixedValuesOff(Size(srcArg.cols, srcArg.rows), CV_16UC1);
 
-    int i;
-    int neighborhood;
-    int neighborhoods[] = {3*4, 3*4*2, 3*4*2*2, 7*4, 7*4*2, 7*4*2*2};
-
-    for(i=0; i<numScales; i++)
-    {
-        intensityScaledOn[i] = Mat(Size(srcArg.cols, srcArg.rows), CV_8UC1);
-        intensityScaledOff[i] = Mat(Size(srcArg.cols, srcArg.rows), CV_8UC1);
-    }
+    const int neighborhoods[] = {3*4, 3*4*2, 3*4*2*2, 7*4, 7*4*2, 7*4*2*2};
 
     // Prepare the input image: put it into a grayscale image.
     if(srcArg.channels()==3)
@@ -125,183 +211,68 @@ void StaticSaliencyFineGrained::calcIntensityChannel(Mat srcArg, Mat dstArg)
     // Calculate integral image, only once.
     integral(gray, integralImage, CV_32F);
 
+    parallel_for_(Range(0, gray.rows),
+                  FineGrainedScalesInvoker(integralImage, gray, neighborhoods, numScales, mixedValuesOn, mixedValuesOff));
 
-    for(i=0; i< numScales; i++)
-    {
-        neighborhood = neighborhoods[i] ;
-        getIntensityScaled(integralImage, gray, intensityScaledOn[i], intensityScaledOff[i], neighborhood);
-    }
-
-    mixScales(intensityScaledOn, intensityOn, intensityScaledOff, intensityOff, numScales);
+    mixScales(mixedValuesOn, intensityOn, mixedValuesOff, intensityOff);
 
     mixOnOff(intensityOn, intensityOff, intensity);
 
     intensity.copyTo(dstArg);
 }
 
-void StaticSaliencyFineGrained::getIntensityScaled(Mat integralImage, Mat gray, Mat intensityScaledOn, Mat intensityScaledOff, int neighborhood)
+// The normalizations only depend on the value of the pixel, they are tabulated
+static void normalizeSums(const Mat& mixedValues, Mat& intensity)
 {
-    float value, meanOn, meanOff;
-    Point2i point;
-    int x,y;
-    intensityScaledOn.setTo(Scalar::all(0));
-    intensityScaledOff.setTo(Scalar::all(0));
-
-
-    for(y = 0; y < gray.rows; y++)
+    double maxVal = 0;
+    minMaxLoc(mixedValues, 0, &maxVal);
+    const int maxValSum = (int)maxVal;
+    std::vector<uchar> table(maxValSum + 1, (uchar)0);
+    if(maxValSum > 0)
+        for(int v = 0; v <= maxValSum; v++)
+            table[v] = (uchar)(255.*((float)(v / (float)maxValSum)));
+
+    for(int y = 0; y < mixedValues.rows; y++)
     {
-        for(x = 0; x < gray.cols; x++)
-        {
-            point.x = x;
-            point.y = y;
-            value = getMean(integralImage, point, neighborhood, gray.at<uchar>(y, x));
-
-            meanOn = gray.at<uchar>(y, x) - value;
-            meanOff = value - gray.at<uchar>(y, x);
-
-            if(meanOn > 0)
-                intensityScaledOn.at<uchar>(y, x) = (uchar)meanOn;
-            else
-                intensityScaledOn.at<uchar>(y, x) = 0;
-
-            if(meanOff > 0)
-                intensityScaledOff.at<uchar>(y, x) = (uchar)meanOff;
-            else
-                intensityScaledOff.at<uchar>(y, x) = 0;
-        }
+        const ushort* m = mixedValues.ptr<ushort>(y);
+        uchar* d = intensity.ptr<uchar>(y);
+        for(int x = 0; x < mixedValues.cols; x++)
+            d[x] = table[m[x]];
     }
 }
 
-float StaticSaliencyFineGrained::getMean(Mat srcArg, Point2i PixArg, int neighbourhood, int centerVal)
+void StaticSaliencyFineGrained::mixScales(Mat mixedValuesOn, Mat intensityOn, Mat mixedValuesOff, Mat intensityOff)
 {
-    Point2i P1, P2;
-    float value;
-
-    P1.x = PixArg.x - neighbourhood + 1;
-    P1.y = PixArg.y - neighbourhood + 1;
-    P2.x = PixArg.x + neighbourhood + 1;
-    P2.y = PixArg.y + neighbourhood + 1;
-
-    if(P1.x < 0)
-        P1.x = 0;
-    else if(P1.x > srcArg.cols - 1)
-        P1.x = srcArg.cols - 1;
-    if(P2.x < 0)
-        P2.x = 0;
-    else if(P2.x > srcArg.cols - 1)
-        P2.x = srcArg.cols - 1;
-    if(P1.y < 0)
-        P1.y = 0;
-    else if(P1.y > srcArg.rows - 1)
-        P1.y = srcArg.rows - 1;
-    if(P2.y < 0)
-        P2.y = 0;
-    else if(P2.y > srcArg.rows - 1)
-        P2.y = srcArg.rows - 1;
-
-    // we use the integral image to compute fast features
-    value = (float) (
-            (srcArg.at<float>(P2.y, P2.x)) +
-            (srcArg.at<float>(P1.y, P1.x)) -
-            (srcArg.at<float>(P2.y, P1.x)) -
-            (srcArg.at<float>(P1.y, P2.x))
-    );
-    value = (value - centerVal)/  (( (P2.x - P1.x) * (P2.y - P1.y))-1)  ;
-    return value;
-}
-
-void StaticSaliencyFineGrained::mixScales(Mat *intensityScaledOn, Mat intensityOn, Mat *intensityScaledOff, Mat intensityOff, const int numScales)
-{
-    int i=0, x, y;
-    int width = intensityScaledOn[0].cols;
-    int height = intensityScaledOn[0].rows;
-    short int maxValOn = 0, currValOn=0;
-    short int maxValOff = 0, currValOff=0;
-    int maxValSumOff = 0, maxValSumOn=0;
-    Mat mixedValuesOn(Size(width, height), CV_16UC1);
-    Mat mixedValuesOff(Size(width, height), CV_16UC1);
-
-    mixedValuesOn.setTo(Scalar::all(0));
-    mixedValuesOff.setTo(Scalar::all(0));
-
-    for(i=0;i<numScales;i++)
-    {
-        for(y=0;y<height;y++)
-            for(x=0;x<width;x++)
-            {
-                      currValOn = intensityScaledOn[i].at<uchar>(y, x);
-                      if(currValOn > maxValOn)
-                          maxValOn = currValOn;
-
-                      currValOff = intensityScaledOff[i].at<uchar>(y, x);
-                      if(currValOff > maxValOff)
-                          maxValOff = currValOff;
-
-                      mixedValuesOn.at<unsigned short>(y, x) += currValOn;
-                      mixedValuesOff.at<unsigned short>(y, x) += currValOff;
-            }
-    }
-
-    for(y=0;y<height;y++)
-        for(x=0;x<width;x++)
-        {
-            currValOn = mixedValuesOn.at<unsigned short>(y, x);
-            currValOff = mixedValuesOff.at<unsigned short>(y, x);
-                  if(currValOff > maxValSumOff)
-                      maxValSumOff = currValOff;
-                  if(currValOn > maxValSumOn)
-                      maxValSumOn = currValOn;
-        }
-
-
-    for(y=0;y<height;y++)
-        for(x=0;x<width;x++)
-        {
-            intensityOn.at<uchar>(y, x) = (uchar)(255.*((float)(mixedValuesOn.at<unsigned short>(y, x) / (float)maxValSumOn)));
-            intensityOff.at<uchar>(y, x) = (uchar)(255.*((float)(mixedValuesOff.at<unsigned short>(y, x) / (float)maxValSumOff)));
-        }
-
+    normalizeSums(mixedValuesOn, intensityOn);
+    normalizeSums(mixedValuesOff, intensityOff);
 }
 
 void StaticSaliencyFineGrained::mixOnOff(Mat intensityOn, Mat intensityOff, Mat intensityArg)
 {
-    int x,y;
     int width = intensityOn.cols;
     int height= intensityOn.rows;
-    int maxVal=0;
 
-    int currValOn, currValOff, maxValSumOff, maxValSumOn;
-
-    Mat intensity(Size(width, height), CV_8UC1);
+    double maxValSumOn = 0, maxValSumOff = 0;
+    minMaxLoc(intensityOn, 0, &maxValSumOn);
+    minMaxLoc(intensityOff, 0, &maxValSumOff);
+    const int maxVal = (int)std::max(maxValSumOn, maxValSumOff);
 
+    const int maxSum = (int)(maxValSumOn + maxValSumOff);
+    std::vector<uchar> table(maxSum + 1, (uchar)0);
+    if(maxVal > 0)
+        for(int v = 0; v <= maxSum; v++)
+            table[v] = (uchar) (255. * (float) v / (float)maxVal);
 
-    maxValSumOff = 0;
-    maxValSumOn = 0;
-
-    for(y=0;y<height;y++)
-    for(x=0;x<width;x++)
+    Mat intensity(Size(width, height), CV_8UC1);
+    for(int y = 0; y < height; y++)
     {
-        currValOn = intensityOn.at<uchar>(y, x);
-        currValOff = intensityOff.at<uchar>(y, x);
-              if(currValOff > maxValSumOff)
-                  maxValSumOff = currValOff;
-              if(currValOn > maxValSumOn)
-                  maxValSumOn = currValOn;
+        const uchar* on = intensityOn.ptr<uchar>(y);
+        const uchar* off = intensityOff.ptr<uchar>(y);
+        uchar* d = intensity.ptr<uchar>(y);
+        for(int x = 0; x < width; x++)
+            d[x] = table[on[x] + off[x]];
     }
 
-    if(maxValSumOn > maxValSumOff)
-        maxVal = maxValSumOn;
-    else
-        maxVal = maxValSumOff;
-
-
-
-    for(y=0;y<height;y++)
-        for(x=0;x<width;x++)
-        {
-            intensity.at<uchar>(y, x) = (uchar) (255. * (float) (intensityOn.at<uchar>(y, x) + intensityOff.at<uchar>(y, x)) / (float)maxVal);
-        }
-
     intensity.copyTo(intensityArg);
 }
 
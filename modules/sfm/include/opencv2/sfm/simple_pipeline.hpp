@@ -235,6 +235,20 @@ public:
   virtual void run(const std::vector<String> &images, InputOutputArray K, OutputArray Rs,
                    OutputArray Ts, OutputArray points3d) = 0;
 
+  /** @brief Extends the current reconstruction with new frames.
+    @param points2d Input vector of vectors of 2d points of the new images only (the inner vector is per image),
+      the tracks are indexed as in the previous calls and the new tracks take new indices.
+
+    The new cameras are resected from the already reconstructed points, the new tracks are triangulated
+    and the bundle adjustment is only run on the new cameras and the points they see, constrained by
+    the last few reconstructed frames. The reconstruction is solved from scratch while it is not valid yet.
+
+    @note
+      - The intrinsics are not refined for the appended frames.
+  */
+  CV_WRAP
+  virtual void appendFrames(InputArrayOfArrays points2d) = 0;
+
   /** @brief Returns the computed reprojection error.
   */
   CV_WRAP
@@ -59,6 +59,20 @@ void
 triangulatePoints(InputArrayOfArrays points2d, InputArrayOfArrays projection_matrices,
                   OutputArray points3d);
 
+/** @brief Computes the reprojection errors of 3d points.
+  @param points3d Input array of 3d points. Is 3 x N.
+  @param points2d Input vector of vectors of 2d points (the inner vector is per image). Has to be 2 X N.
+  @param projection_matrices Input vector with 3x4 projections matrices of each image.
+  @param errors Output array with the euclidean distances between the 2d points and the projections
+  of the 3d points, in pixels. Is nviews x N.
+
+  The points are processed in parallel, so it can be used to filter the outliers of large reconstructions.
+*/
+CV_EXPORTS_W
+void
+computeReprojectionErrors(InputArray points3d, InputArrayOfArrays points2d,
+                          InputArrayOfArrays projection_matrices, OutputArray errors);
+
 //! @} sfm
 
 } /* namespace sfm */
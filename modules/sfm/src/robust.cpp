@@ -44,7 +44,10 @@
 #include <opencv2/sfm/numeric.hpp>
 
 // libmv headers
-#include "libmv/multiview/robust_fundamental.h"
+#include "libmv/multiview/fundamental_kernel.h"
+#include "libmv/multiview/robust_estimation.h"
+
+#include "opencv2/core/hal/intrin.hpp"
 
 using namespace std;
 
@@ -53,6 +56,236 @@ namespace cv
 namespace sfm
 {
 
+/* Correspondences in a structure of arrays layout, so that the Sampson
+ * errors of a hypothesis are evaluated for several points at once
+ */
+struct SampsonCorrespondences
+{
+  SampsonCorrespondences( const libmv::Mat &x1, const libmv::Mat &x2 )
+  {
+    const int n = static_cast<int>(x1.cols());
+    u1.resize(n); v1.resize(n); u2.resize(n); v2.resize(n);
+    for( int i = 0; i < n; ++i )
+    {
+      u1[i] = (float)x1(0,i); v1[i] = (float)x1(1,i);
+      u2[i] = (float)x2(0,i); v2[i] = (float)x2(1,i);
+    }
+  }
+
+  std::vector<float> u1, v1, u2, v2;
+};
+
+/* Truncated Sampson cost of F over the correspondences [start, end),
+ * the same cost as libmv::MLEScorer
+ */
+static double
+sampsonCost( const SampsonCorrespondences &pts, const float* f, float threshold,
+             int start, int end, int &num_inliers )
+{
+  double cost = 0;
+  int i = start;
+#if CV_SIMD128
+  {
+    const v_float32x4 f00 = v_setall_f32(f[0]), f01 = v_setall_f32(f[1]), f02 = v_setall_f32(f[2]),
+                      f10 = v_setall_f32(f[3]), f11 = v_setall_f32(f[4]), f12 = v_setall_f32(f[5]),
+                      f20 = v_setall_f32(f[6]), f21 = v_setall_f32(f[7]), f22 = v_setall_f32(f[8]);
+    const v_float32x4 thr = v_setall_f32(threshold), one = v_setall_f32(1.f);
+    v_float32x4 vcost = v_setzero_f32(), vcount = v_setzero_f32();
+    for( ; i <= end - 4; i += 4 )
+    {
+      const v_float32x4 u1 = v_load(&pts.u1[i]), v1 = v_load(&pts.v1[i]);
+      const v_float32x4 u2 = v_load(&pts.u2[i]), v2 = v_load(&pts.v2[i]);
+      const v_float32x4 fx0 = f00 * u1 + f01 * v1 + f02;
+      const v_float32x4 fx1 = f10 * u1 + f11 * v1 + f12;
+      const v_float32x4 fx2 = f20 * u1 + f21 * v1 + f22;
+      const v_float32x4 fty0 = f00 * u2 + f10 * v2 + f20;
+      const v_float32x4 fty1 = f01 * u2 + f11 * v2 + f21;
+      const v_float32x4 yfx = u2 * fx0 + v2 * fx1 + fx2;
+      const v_float32x4 error = yfx * yfx / (fx0 * fx0 + fx1 * fx1 + fty0 * fty0 + fty1 * fty1);
+      const v_float32x4 inlier = error < thr;
+      vcost += v_select(inlier, error, thr);
+      vcount += v_select(inlier, one, v_setzero_f32());
+    }
+    cost += v_reduce_sum(vcost);
+    num_inliers += cvRound(v_reduce_sum(vcount));
+  }
+#endif
+  for( ; i < end; ++i )
+  {
+    const float u1 = pts.u1[i], v1 = pts.v1[i], u2 = pts.u2[i], v2 = pts.v2[i];
+    const float fx0 = f[0] * u1 + f[1] * v1 + f[2];
+    const float fx1 = f[3] * u1 + f[4] * v1 + f[5];
+    const float fx2 = f[6] * u1 + f[7] * v1 + f[8];
+    const float fty0 = f[0] * u2 + f[3] * v2 + f[6];
+    const float fty1 = f[1] * u2 + f[4] * v2 + f[7];
+    const float yfx = u2 * fx0 + v2 * fx1 + fx2;
+    const float error = yfx * yfx / (fx0 * fx0 + fx1 * fx1 + fty0 * fty0 + fty1 * fty1);
+    if( error < threshold )
+    {
+      cost += error;
+      ++num_inliers;
+    }
+    else
+      cost += threshold;
+  }
+  return cost;
+}
+
+struct FundamentalHypothesis
+{
+  FundamentalHypothesis() : cost(HUGE_VAL), num_inliers(0) {}
+
+  double cost;
+  int num_inliers;
+  libmv::Mat3 F;
+};
+
+/* Fits and scores a batch of minimal samples in parallel. The scoring of a
+ * model stops as soon as its cost exceeds the best one of the previous batches,
+ * since the truncated cost only grows with the number of correspondences.
+ */
+template<typename Kernel>
+class FundamentalHypothesesInvoker : public ParallelLoopBody
+{
+public:
+  FundamentalHypothesesInvoker( const Kernel &_kernel, const SampsonCorrespondences &_pts,
+                                const std::vector<libmv::vector<int> > &_samples, float _threshold,
+                                double _best_cost, std::vector<FundamentalHypothesis> &_hypotheses ) :
+    kernel(_kernel), pts(_pts), samples(_samples), threshold(_threshold),
+    best_cost(_best_cost), hypotheses(_hypotheses) {}
+
+  void operator()( const Range &range ) const
+  {
+    enum { BLOCK_SIZE = 256 };
+    const int n = static_cast<int>(pts.u1.size());
+
+    for( int s = range.start; s < range.end; ++s )
+    {
+      libmv::vector<libmv::Mat3> models;
+      kernel.Fit(samples[s], &models);
+
+      FundamentalHypothesis &best = hypotheses[s];
+      for( int m = 0; m < models.size(); ++m )
+      {
+        // The Sampson error does not depend on the scale of F
+        const double scale = models[m].norm();
+        if( !(scale > 0) )
+          continue;
+        float f[9];
+        for( int k = 0; k < 9; ++k )
+          f[k] = (float)(models[m](k / 3, k % 3) / scale);
+
+        const double bound = std::min(best_cost, best.cost);
+        double cost = 0;
+        int num_inliers = 0;
+        for( int start = 0; start < n && cost <= bound; start += BLOCK_SIZE )
+          cost += sampsonCost(pts, f, threshold, start, std::min(n, start + BLOCK_SIZE), num_inliers);
+
+        if( cost < best.cost )
+        {
+          best.cost = cost;
+          best.num_inliers = num_inliers;
+          best.F = models[m];
+        }
+      }
+    }
+  }
+
+private:
+  const Kernel &kernel;
+  const SampsonCorrespondences &pts;
+  const std::vector<libmv::vector<int> > &samples;
+  float threshold;
+  double best_cost;
+  std::vector<FundamentalHypothesis> &hypotheses;
+
+  FundamentalHypothesesInvoker& operator=(const FundamentalHypothesesInvoker&);
+};
+
+/* RANSAC with the truncated Sampson cost of libmv::Estimate, where the
+ * hypotheses are evaluated in parallel batches and the best one is
+ * scored again in double precision
+ */
+template<typename Kernel>
+static double
+fundamentalRobust( const libmv::Mat &x1,
+                   const libmv::Mat &x2,
+                   const double max_error,
+                   libmv::Mat3 &F,
+                   std::vector<int> &inliers,
+                   const double outliers_probability )
+{
+  CV_Assert( outliers_probability > 0.0 && outliers_probability < 1.0 );
+
+  enum { HYPOTHESES_BATCH = 16 };
+  const int min_samples = Kernel::MINIMUM_SAMPLES;
+  const int total_samples = static_cast<int>(x1.cols());
+
+  // The threshold is on the sum of the squared errors in the two images.
+  // Actually, Sampson's approximation of this error.
+  const double threshold = 2 * max_error * max_error;
+
+  F.setZero();
+  inliers.clear();
+  if( total_samples < min_samples )
+    return HUGE_VAL;
+
+  Kernel kernel(x1, x2);
+  const SampsonCorrespondences pts(x1, x2);
+
+  size_t max_iterations = 100;
+  const size_t really_max_iterations = 1000;
+
+  double best_cost = HUGE_VAL;
+  std::vector<libmv::vector<int> > samples;
+  std::vector<FundamentalHypothesis> hypotheses;
+  for( size_t iteration = 0; iteration < std::min(max_iterations, really_max_iterations); )
+  {
+    const size_t batch = std::min((size_t)HYPOTHESES_BATCH,
+                                  std::min(max_iterations, really_max_iterations) - iteration);
+    samples.resize(batch);
+    for( size_t i = 0; i < batch; ++i )
+      libmv::UniformSample(min_samples, total_samples, &samples[i]);
+
+    hypotheses.assign(batch, FundamentalHypothesis());
+    parallel_for_(Range(0, (int)batch),
+                  FundamentalHypothesesInvoker<Kernel>(kernel, pts, samples, (float)threshold,
+                                                       best_cost, hypotheses));
+
+    for( size_t i = 0; i < batch; ++i )
+    {
+      if( hypotheses[i].cost < best_cost )
+      {
+        best_cost = hypotheses[i].cost;
+        F = hypotheses[i].F;
+        const double best_inlier_ratio = hypotheses[i].num_inliers / double(total_samples);
+        if( best_inlier_ratio > 0 )
+          max_iterations = libmv::IterationsRequired(min_samples,
+                                                     outliers_probability,
+                                                     best_inlier_ratio);
+      }
+    }
+    iteration += batch;
+  }
+
+  if( best_cost == HUGE_VAL )
+    return HUGE_VAL;
+
+  double cost = 0.0;
+  for( int j = 0; j < total_samples; ++j )
+  {
+    const double error = kernel.Error(j, F);
+    if( error < threshold )
+    {
+      cost += error;
+      inliers.push_back(j);
+    }
+    else
+      cost += threshold;
+  }
+  return std::sqrt(cost / 2.0);
+}
+
 // TODO: unify algorithms
 template<typename T>
 double
@@ -65,25 +298,17 @@ fundamentalFromCorrespondences8PointRobust( const Mat_<T> &_x1,
 {
   libmv::Mat x1, x2;
   libmv::Mat3 F;
-  libmv::vector<int> inliers;
 
   cv2eigen( _x1, x1 );
   cv2eigen( _x2, x2 );
 
-  T solution_error =
-    libmv::FundamentalFromCorrespondences8PointRobust( x1, x2, max_error, &F, &inliers, outliers_probability );
+  double solution_error =
+    fundamentalRobust<libmv::fundamental::kernel::NormalizedEightPointKernel>(
+      x1, x2, max_error, F, _inliers, outliers_probability );
 
   eigen2cv( F, _F );
 
-  // transform from libmv::vector to std::vector
-  int n = inliers.size();
-  _inliers.resize(n);
-  for( int i=0; i < n; ++i )
-  {
-    _inliers[i] = inliers.at(i);
-  }
-
-  return static_cast<double>(solution_error);
+  return solution_error;
 }
 
 
@@ -134,25 +359,17 @@ fundamentalFromCorrespondences7PointRobust( const Mat_<T> &_x1,
 {
   libmv::Mat x1, x2;
   libmv::Mat3 F;
-  libmv::vector<int> inliers;
 
   cv2eigen( _x1, x1 );
   cv2eigen( _x2, x2 );
 
-  T solution_error =
-    libmv::FundamentalFromCorrespondences7PointRobust( x1, x2, max_error, &F, &inliers, outliers_probability );
+  double solution_error =
+    fundamentalRobust<libmv::fundamental::kernel::NormalizedSevenPointKernel>(
+      x1, x2, max_error, F, _inliers, outliers_probability );
 
   eigen2cv( F, _F );
 
-  // transform from libmv::vector to std::vector
-  int n = inliers.size();
-  _inliers.resize(n);
-  for( int i=0; i < n; ++i )
-  {
-    _inliers[i] = inliers.at(i);
-  }
-
-  return static_cast<double>(solution_error);
+  return solution_error;
 }
 
 double
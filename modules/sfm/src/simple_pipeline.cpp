@@ -49,11 +49,12 @@ namespace cv
 namespace sfm
 {
 
-/* Parses a given array of 2d points into the libmv tracks structure
+/* Parses a given array of 2d points into the libmv tracks structure,
+ * the first array is inserted as the image first_frame
  */
 
 void
-parser_2D_tracks( const std::vector<Mat> &points2d, libmv::Tracks &tracks )
+parser_2D_tracks( const std::vector<Mat> &points2d, libmv::Tracks &tracks, int first_frame = 0 )
 {
   const int nframes = static_cast<int>(points2d.size());
   for (int frame = 0; frame < nframes; ++frame) {
@@ -61,7 +62,7 @@ parser_2D_tracks( const std::vector<Mat> &points2d, libmv::Tracks &tracks )
     for (int track = 0; track < ntracks; ++track) {
       const Vec2d track_pt = points2d[frame].col(track);
       if ( track_pt[0] > 0 && track_pt[1] > 0 )
-        tracks.Insert(frame, track, track_pt[0], track_pt[1]);
+        tracks.Insert(first_frame + frame, track, track_pt[0], track_pt[1]);
     }
   }
 }
@@ -151,8 +152,10 @@ class SFMLibmvReconstructionImpl : public T
 public:
   SFMLibmvReconstructionImpl(const libmv_CameraIntrinsicsOptions &camera_instrinsic_options,
                              const libmv_ReconstructionOptions &reconstruction_options) :
+    libmv_reconstruction_(),
     libmv_reconstruction_options_(reconstruction_options),
-    libmv_camera_intrinsics_options_(camera_instrinsic_options) {}
+    libmv_camera_intrinsics_options_(camera_instrinsic_options),
+    num_frames_(0) {}
 
   /* Run the pipeline given 2d points
    */
@@ -164,24 +167,99 @@ public:
     CV_Assert( _points2d.total() >= 2 );
 
     // Parse 2d points to Tracks
-    Tracks tracks;
-    parser_2D_tracks(points2d, tracks);
+    tracks_ = Tracks();
+    parser_2D_tracks(points2d, tracks_);
+    num_frames_ = static_cast<int>(points2d.size());
 
-    // Set libmv logs level
-    libmv_initLogging("");
+    solveTracks();
+  }
 
-    if (libmv_reconstruction_options_.verbosity_level >= 0)
+  /* Extend the current reconstruction with new frames given their 2d points
+   */
+
+  virtual void appendFrames(InputArrayOfArrays _points2d)
+  {
+    std::vector<Mat> points2d;
+    _points2d.getMatVector(points2d);
+    CV_Assert( !points2d.empty() );
+
+    const int first_frame = num_frames_;
+    Tracks new_tracks;
+    parser_2D_tracks(points2d, new_tracks, first_frame);
+    num_frames_ += static_cast<int>(points2d.size());
+
+    const libmv::vector<Marker> new_markers = new_tracks.AllMarkers();
+    for (int i = 0; i < new_markers.size(); ++i)
+      tracks_.Insert(new_markers[i].image, new_markers[i].track,
+                     new_markers[i].x, new_markers[i].y);
+
+    // Nothing to extend yet, solve everything seen so far
+    if (!libmv_reconstruction_.is_valid)
     {
-      libmv_startDebugLogging();
-      libmv_setLoggingVerbosity(
-        libmv_reconstruction_options_.verbosity_level);
+      if (num_frames_ >= 2)
+        solveTracks();
+      return;
     }
 
-    // Perform reconstruction
-    libmv_reconstruction_ =
-      *libmv_solveReconstruction(tracks,
-                                 &libmv_camera_intrinsics_options_,
-                                 &libmv_reconstruction_options_);
+    EuclideanReconstruction &reconstruction = libmv_reconstruction_.reconstruction;
+    const CameraIntrinsics &intrinsics = *libmv_reconstruction_.intrinsics;
+
+    Tracks new_normalized_tracks;
+    libmv_getNormalizedTracks(new_tracks, intrinsics, &new_normalized_tracks);
+    const libmv::vector<Marker> new_normalized_markers = new_normalized_tracks.AllMarkers();
+    for (int i = 0; i < new_normalized_markers.size(); ++i)
+      normalized_tracks_.Insert(new_normalized_markers[i].image, new_normalized_markers[i].track,
+                                new_normalized_markers[i].x, new_normalized_markers[i].y);
+
+    // Resect the new cameras from the points already reconstructed and
+    // triangulate the tracks they are the second view of
+    std::set<int> local_tracks;
+    for (int image = first_frame; image < num_frames_; ++image)
+    {
+      const libmv::vector<Marker> markers = normalized_tracks_.MarkersInImage(image);
+      libmv::vector<Marker> reconstructed_markers;
+      for (int i = 0; i < markers.size(); ++i)
+        if (reconstruction.PointForTrack(markers[i].track))
+          reconstructed_markers.push_back(markers[i]);
+
+      if (reconstructed_markers.size() < 5 ||
+          !EuclideanResect(reconstructed_markers, &reconstruction, true))
+        continue;
+
+      for (int i = 0; i < markers.size(); ++i)
+      {
+        const int track = markers[i].track;
+        local_tracks.insert(track);
+        if (reconstruction.PointForTrack(track))
+          continue;
+
+        const libmv::vector<Marker> track_markers = normalized_tracks_.MarkersForTrack(track);
+        libmv::vector<Marker> viewed_markers;
+        for (int j = 0; j < track_markers.size(); ++j)
+          if (reconstruction.CameraForImage(track_markers[j].image))
+            viewed_markers.push_back(track_markers[j]);
+
+        if (viewed_markers.size() >= 2)
+          EuclideanIntersect(viewed_markers, &reconstruction);
+      }
+    }
+
+    // Local bundle adjustment: the new cameras and the points they see,
+    // constrained by the observations of the recent frames only
+    const int first_local_frame = std::max(0, first_frame - LOCAL_BUNDLE_FRAMES);
+    Tracks local_bundle_tracks;
+    for (std::set<int>::const_iterator it = local_tracks.begin(); it != local_tracks.end(); ++it)
+    {
+      const libmv::vector<Marker> track_markers = normalized_tracks_.MarkersForTrack(*it);
+      for (int j = 0; j < track_markers.size(); ++j)
+        if (track_markers[j].image >= first_local_frame)
+          local_bundle_tracks.Insert(track_markers[j].image, track_markers[j].track,
+                                     track_markers[j].x, track_markers[j].y);
+    }
+    if (!local_tracks.empty())
+      EuclideanBundle(local_bundle_tracks, &reconstruction);
+
+    finishReconstruction(tracks_, intrinsics, &libmv_reconstruction_);
   }
 
   virtual void run(InputArrayOfArrays points2d, InputOutputArray K, OutputArray Rs,
@@ -216,6 +294,13 @@ public:
       *libmv_solveReconstructionImpl(images,
                                      &libmv_camera_intrinsics_options_,
                                      &libmv_reconstruction_options_);
+
+    // Keep the matched tracks so that new frames can be appended
+    tracks_ = libmv_reconstruction_.tracks;
+    num_frames_ = static_cast<int>(images.size());
+    normalized_tracks_ = Tracks();
+    if (libmv_reconstruction_.is_valid)
+      libmv_getNormalizedTracks(tracks_, *libmv_reconstruction_.intrinsics, &normalized_tracks_);
   }
 
 
@@ -286,6 +371,39 @@ public:
 
 private:
 
+  /* Number of already reconstructed frames that constrain the bundle
+   * adjustment of the appended ones
+   */
+  enum { LOCAL_BUNDLE_FRAMES = 5 };
+
+  /* Solve the reconstruction of all the stored tracks from scratch
+   */
+
+  void
+  solveTracks()
+  {
+    // Set libmv logs level
+    libmv_initLogging("");
+
+    if (libmv_reconstruction_options_.verbosity_level >= 0)
+    {
+      libmv_startDebugLogging();
+      libmv_setLoggingVerbosity(
+        libmv_reconstruction_options_.verbosity_level);
+    }
+
+    // Perform reconstruction
+    libmv_reconstruction_ =
+      *libmv_solveReconstruction(tracks_,
+                                 &libmv_camera_intrinsics_options_,
+                                 &libmv_reconstruction_options_);
+
+    // The tracks normalized with the refined intrinsics are reused by appendFrames()
+    normalized_tracks_ = Tracks();
+    if (libmv_reconstruction_.is_valid)
+      libmv_getNormalizedTracks(tracks_, *libmv_reconstruction_.intrinsics, &normalized_tracks_);
+  }
+
   void
   extractLibmvReconstructionData(InputOutputArray K,
                                  OutputArray Rs,
@@ -300,6 +418,10 @@ private:
   libmv_Reconstruction libmv_reconstruction_;
   libmv_ReconstructionOptions libmv_reconstruction_options_;
   libmv_CameraIntrinsicsOptions libmv_camera_intrinsics_options_;
+
+  /* All the tracks given so far, both raw and normalized */
+  Tracks tracks_, normalized_tracks_;
+  int num_frames_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
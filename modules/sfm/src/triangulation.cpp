@@ -85,34 +85,123 @@ triangulateDLT( const Vec2d &xl, const Vec2d &xr,
 }
 
 
-/** @brief Triangulates the 3d position of 2d correspondences between n images, using the DLT
- * @param x Input vectors of 2d points (the inner vector is per image). Has to be 2xN
- * @param Ps Input vector with 3x4 projections matrices of each image.
- * @param X Output vector with computed 3d point.
+/** @brief Converts the points and the projection matrices of the views to double.
+ */
+static void
+getViews(InputArrayOfArrays _points2d, InputArrayOfArrays _projection_matrices,
+         std::vector<Mat_<double> > &points2d, std::vector<Matx34d> &projection_matrices,
+         size_t &n_points)
+{
+    size_t nviews = _points2d.total();
+    CV_Assert(nviews == _projection_matrices.total());
+
+    points2d.resize(nviews);
+    projection_matrices.resize(nviews);
+
+    std::vector<Mat> points2d_tmp;
+    _points2d.getMatVector(points2d_tmp);
+    n_points = points2d_tmp[0].cols;
+
+    std::vector<Mat> projection_matrices_tmp;
+    _projection_matrices.getMatVector(projection_matrices_tmp);
+
+    // Make sure the dimensions are right
+    for(size_t i=0; i<nviews; ++i) {
+        CV_Assert(points2d_tmp[i].rows == 2 && points2d_tmp[i].cols == n_points);
+        if (points2d_tmp[i].type() == CV_64F)
+            points2d[i] = points2d_tmp[i];
+        else
+            points2d_tmp[i].convertTo(points2d[i], CV_64F);
+
+        CV_Assert(projection_matrices_tmp[i].rows == 3 && projection_matrices_tmp[i].cols == 4);
+        if (projection_matrices_tmp[i].type() == CV_64F)
+          projection_matrices[i] = projection_matrices_tmp[i];
+        else
+          projection_matrices_tmp[i].convertTo(projection_matrices[i], CV_64F);
+    }
+}
+
+
+/** @brief Triangulates a range of points seen in two views.
+ */
+class TriangulateDLTInvoker : public ParallelLoopBody
+{
+public:
+    TriangulateDLTInvoker(const Mat_<double> &_xl, const Mat_<double> &_xr,
+                          const Matx34d &_Pl, const Matx34d &_Pr, Mat &_points3d)
+        : xl(_xl), xr(_xr), Pl(_Pl), Pr(_Pr), points3d(_points3d)
+    {
+    }
+
+    void operator()(const Range &range) const
+    {
+        for( int i = range.start; i < range.end; ++i )
+        {
+            Vec3d point3d;
+            triangulateDLT( Vec2d(xl(0,i), xl(1,i)), Vec2d(xr(0,i), xr(1,i)), Pl, Pr, point3d );
+            for(char j=0; j<3; ++j)
+                points3d.at<double>(j, i) = point3d[j];
+        }
+    }
+
+private:
+    const Mat_<double> &xl, &xr;
+    const Matx34d &Pl, &Pr;
+    Mat &points3d;
+
+    TriangulateDLTInvoker& operator=(const TriangulateDLTInvoker&);
+};
+
+
+/** @brief Triangulates a range of points seen in more than two views, using the DLT.
+ * The design matrix is allocated once per range, only its point dependent entries are updated.
 
  * Reference: it is the standard DLT; for derivation see appendix of Keir's thesis
  */
-void
-triangulateNViews(const Mat_<double> &x, const std::vector<Matx34d> &Ps, Vec3d &X)
+class TriangulateNViewsInvoker : public ParallelLoopBody
 {
-    CV_Assert(x.rows == 2);
-    unsigned nviews = x.cols;
-    CV_Assert(nviews == Ps.size());
-
-    cv::Mat_<double> design = cv::Mat_<double>::zeros(3*nviews, 4 + nviews);
-    for (unsigned i=0; i < nviews; ++i) {
-        for(char jj=0; jj<3; ++jj)
-            for(char ii=0; ii<4; ++ii)
-                design(3*i+jj, ii) = -Ps[i](jj, ii);
-        design(3*i + 0, 4 + i) = x(0, i);
-        design(3*i + 1, 4 + i) = x(1, i);
-        design(3*i + 2, 4 + i) = 1.0;
+public:
+    TriangulateNViewsInvoker(const std::vector<Mat_<double> > &_points2d,
+                             const std::vector<Matx34d> &_Ps, Mat &_points3d)
+        : points2d(_points2d), Ps(_Ps), points3d(_points3d)
+    {
     }
 
-    Mat X_and_alphas;
-    cv::SVD::solveZ(design, X_and_alphas);
-    homogeneousToEuclidean(X_and_alphas.rowRange(0, 4), X);
-}
+    void operator()(const Range &range) const
+    {
+        const int nviews = (int)Ps.size();
+
+        cv::Mat_<double> design = cv::Mat_<double>::zeros(3*nviews, 4 + nviews);
+        for (int k = 0; k < nviews; ++k) {
+            for(char jj=0; jj<3; ++jj)
+                for(char ii=0; ii<4; ++ii)
+                    design(3*k+jj, ii) = -Ps[k](jj, ii);
+            design(3*k + 2, 4 + k) = 1.0;
+        }
+
+        Mat X_and_alphas;
+        for( int i = range.start; i < range.end; ++i )
+        {
+            for (int k = 0; k < nviews; ++k) {
+                design(3*k + 0, 4 + k) = points2d[k](0, i);
+                design(3*k + 1, 4 + k) = points2d[k](1, i);
+            }
+
+            cv::SVD::solveZ(design, X_and_alphas);
+            Vec3d point3d;
+            homogeneousToEuclidean(X_and_alphas.rowRange(0, 4), point3d);
+            for(char j=0; j<3; ++j)
+                points3d.at<double>(j, i) = point3d[j];
+        }
+    }
+
+private:
+    const std::vector<Mat_<double> > &points2d;
+    const std::vector<Matx34d> &Ps;
+    Mat &points3d;
+
+    TriangulateNViewsInvoker& operator=(const TriangulateNViewsInvoker&);
+};
 
 
 void
@@ -125,31 +214,9 @@ triangulatePoints(InputArrayOfArrays _points2d, InputArrayOfArrays _projection_m
 
     // inputs
     size_t n_points;
-    std::vector<Mat_<double> > points2d(nviews);
-    std::vector<Matx34d> projection_matrices(nviews);
-    {
-        std::vector<Mat> points2d_tmp;
-        _points2d.getMatVector(points2d_tmp);
-        n_points = points2d_tmp[0].cols;
-
-        std::vector<Mat> projection_matrices_tmp;
-        _projection_matrices.getMatVector(projection_matrices_tmp);
-
-        // Make sure the dimensions are right
-        for(size_t i=0; i<nviews; ++i) {
-            CV_Assert(points2d_tmp[i].rows == 2 && points2d_tmp[i].cols == n_points);
-            if (points2d_tmp[i].type() == CV_64F)
-                points2d[i] = points2d_tmp[i];
-            else
-                points2d_tmp[i].convertTo(points2d[i], CV_64F);
-
-            CV_Assert(projection_matrices_tmp[i].rows == 3 && projection_matrices_tmp[i].cols == 4);
-            if (projection_matrices_tmp[i].type() == CV_64F)
-              projection_matrices[i] = projection_matrices_tmp[i];
-            else
-              projection_matrices_tmp[i].convertTo(projection_matrices[i], CV_64F);
-        }
-    }
+    std::vector<Mat_<double> > points2d;
+    std::vector<Matx34d> projection_matrices;
+    getViews(_points2d, _projection_matrices, points2d, projection_matrices, n_points);
 
     // output
     _points3d.create(3, n_points, CV_64F);
@@ -164,32 +231,75 @@ triangulatePoints(InputArrayOfArrays _points2d, InputArrayOfArrays _projection_m
         const Matx34d & Pr = projection_matrices[1];    // right matrix projection
 
         // triangulate
-        for( unsigned i = 0; i < n_points; ++i )
-        {
-            Vec3d point3d;
-            triangulateDLT( Vec2d(xl(0,i), xl(1,i)), Vec2d(xr(0,i), xr(1,i)), Pl, Pr, point3d );
-            for(char j=0; j<3; ++j)
-                points3d.at<double>(j, i) = point3d[j];
-        }
+        parallel_for_(Range(0, (int)n_points), TriangulateDLTInvoker(xl, xr, Pl, Pr, points3d));
     }
     else if( nviews > 2 )
     {
         // triangulate
-        for( unsigned i=0; i < n_points; ++i )
+        parallel_for_(Range(0, (int)n_points), TriangulateNViewsInvoker(points2d, projection_matrices, points3d));
+    }
+}
+
+
+/** @brief Computes the reprojection errors of a range of points in all the views.
+ */
+class ReprojectionErrorsInvoker : public ParallelLoopBody
+{
+public:
+    ReprojectionErrorsInvoker(const Mat_<double> &_points3d, const std::vector<Mat_<double> > &_points2d,
+                              const std::vector<Matx34d> &_Ps, Mat_<double> &_errors)
+        : points3d(_points3d), points2d(_points2d), Ps(_Ps), errors(_errors)
+    {
+    }
+
+    void operator()(const Range &range) const
+    {
+        const double *X = points3d[0], *Y = points3d[1], *Z = points3d[2];
+        for (size_t k = 0; k < Ps.size(); ++k)
         {
-            // build x matrix (one point per view)
-            Mat_<double> x( 2, nviews );
-            for( unsigned k=0; k < nviews; ++k )
+            const Matx34d &P = Ps[k];
+            const double *u = points2d[k][0], *v = points2d[k][1];
+            double *e = errors[(int)k];
+            for (int i = range.start; i < range.end; ++i)
             {
-                points2d.at(k).col(i).copyTo( x.col(k) );
+                double x = P(0,0)*X[i] + P(0,1)*Y[i] + P(0,2)*Z[i] + P(0,3);
+                double y = P(1,0)*X[i] + P(1,1)*Y[i] + P(1,2)*Z[i] + P(1,3);
+                double w = P(2,0)*X[i] + P(2,1)*Y[i] + P(2,2)*Z[i] + P(2,3);
+                double dx = x / w - u[i], dy = y / w - v[i];
+                e[i] = std::sqrt(dx*dx + dy*dy);
             }
-
-            Vec3d point3d;
-            triangulateNViews( x, projection_matrices, point3d );
-            for(char j=0; j<3; ++j)
-                points3d.at<double>(j, i) = point3d[j];
         }
     }
+
+private:
+    const Mat_<double> &points3d;
+    const std::vector<Mat_<double> > &points2d;
+    const std::vector<Matx34d> &Ps;
+    Mat_<double> &errors;
+
+    ReprojectionErrorsInvoker& operator=(const ReprojectionErrorsInvoker&);
+};
+
+
+void
+computeReprojectionErrors(InputArray _points3d, InputArrayOfArrays _points2d,
+                          InputArrayOfArrays _projection_matrices, OutputArray _errors)
+{
+    size_t nviews = _points2d.total();
+    CV_Assert(nviews >= 1);
+
+    size_t n_points;
+    std::vector<Mat_<double> > points2d;
+    std::vector<Matx34d> projection_matrices;
+    getViews(_points2d, _projection_matrices, points2d, projection_matrices, n_points);
+
+    Mat_<double> points3d;
+    _points3d.getMat().convertTo(points3d, CV_64F);
+    CV_Assert(points3d.rows == 3 && points3d.cols == (int)n_points);
+
+    _errors.create((int)nviews, (int)n_points, CV_64F);
+    Mat_<double> errors = _errors.getMat();
+    parallel_for_(Range(0, (int)n_points), ReprojectionErrorsInvoker(points3d, points2d, projection_matrices, errors));
 }
 
 } /* namespace sfm */
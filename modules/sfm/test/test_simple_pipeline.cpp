@@ -86,4 +86,41 @@ TEST(Sfm_simple_pipeline, backyard)
                               // UPDATE:  1.38894
 }
 
+TEST(Sfm_simple_pipeline, backyard_append_frames)
+{
+    string trackFilename =
+      string(TS::ptr()->get_data_path()) + SFM_DIR + "/" + TRACK_FILENAME;
+
+    std::vector<Mat> points2d;
+    parser_2D_tracks( trackFilename, points2d );
+    ASSERT_GT( points2d.size(), 31u );
+
+    double focal_length = 860.986572265625;
+    double principal_x = 400, principal_y = 225, k1 = -0.158, k2 = 0.131, k3 = 0;
+    int refine_intrinsics = SFM_REFINE_FOCAL_LENGTH | SFM_REFINE_PRINCIPAL_POINT | SFM_REFINE_RADIAL_DISTORTION_K1 | SFM_REFINE_RADIAL_DISTORTION_K2;
+
+    libmv_CameraIntrinsicsOptions camera_instrinsic_options =
+      libmv_CameraIntrinsicsOptions(SFM_DISTORTION_MODEL_POLYNOMIAL,
+                                    focal_length, principal_x, principal_y,
+                                    k1, k2, k3);
+    libmv_ReconstructionOptions reconstruction_options(1, 30, refine_intrinsics, 0, -1);
+
+    Ptr<SFMLibmvEuclideanReconstruction> euclidean_reconstruction =
+        SFMLibmvEuclideanReconstruction::create(camera_instrinsic_options, reconstruction_options);
+
+    // Reconstruct the first frames, then append the others a few at a time
+    const size_t nfirst = std::max<size_t>(31, points2d.size() * 3 / 4);
+    euclidean_reconstruction->run(std::vector<Mat>(points2d.begin(), points2d.begin() + nfirst));
+    for (size_t i = nfirst; i < points2d.size(); i += 3)
+    {
+        const size_t end = std::min(points2d.size(), i + 3);
+        euclidean_reconstruction->appendFrames(std::vector<Mat>(points2d.begin() + i, points2d.begin() + end));
+    }
+
+    std::vector<Mat> Rs, Ts;
+    euclidean_reconstruction->getCameras(Rs, Ts);
+    EXPECT_GT( Rs.size(), nfirst );
+    EXPECT_LE( euclidean_reconstruction->getError(), 2.0 );
+}
+
 #endif /* CERES_FOUND */
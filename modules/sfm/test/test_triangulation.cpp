@@ -94,3 +94,40 @@ TEST(Sfm_triangulate, NViewTriangulate_FiveViews)
 
     checkTriangulation(nviews, npoints, is_projective, 1e-7, 1e-9);
 }
+
+TEST(Sfm_triangulate, ReprojectionErrors)
+{
+    int nviews = 3;
+    int npoints = 20;
+
+    std::vector<Mat_<double> > points2d;
+    std::vector<cv::Matx33d> Rs;
+    std::vector<cv::Vec3d> ts;
+    std::vector<cv::Matx34d> Ps;
+    Matx33d K;
+    Mat_<double> points3d;
+    generateScene(nviews, npoints, true, K, Rs, ts, Ps, points3d, points2d);
+
+    std::vector<Mat_<double> > Ps_d(Ps.size());
+    for(size_t i=0; i<Ps.size(); ++i)
+        Ps_d[i] = cv::Mat_<double>(Ps[i]);
+
+    // Move one observation by a known offset
+    points2d[1](0, 7) += 3.0;
+    points2d[1](1, 7) -= 4.0;
+
+    cv::Mat errors;
+    computeReprojectionErrors(points3d, points2d, Ps_d, errors);
+    ASSERT_EQ(nviews, errors.rows);
+    ASSERT_EQ(npoints, errors.cols);
+    ASSERT_EQ(CV_64F, errors.type());
+
+    for (int k = 0; k < nviews; ++k)
+    {
+        for (int i = 0; i < npoints; ++i)
+        {
+            double expected = (k == 1 && i == 7) ? 5.0 : 0.0;
+            EXPECT_NEAR(expected, errors.at<double>(k, i), 1e-6);
+        }
+    }
+}
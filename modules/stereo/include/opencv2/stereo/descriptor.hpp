@@ -49,6 +49,8 @@
 #define _OPENCV_DESCRIPTOR_HPP_
 #ifdef __cplusplus
 
+#include "opencv2/core/hal/intrin.hpp"
+
 namespace cv
 {
     namespace stereo
@@ -59,6 +61,24 @@ namespace cv
             CV_CS_CENSUS, CV_MODIFIED_CS_CENSUS, CV_MODIFIED_CENSUS_TRANSFORM,
             CV_MEAN_VARIATION, CV_STAR_KERNEL
         };
+#if CV_SIMD128
+        //!the vectorized kernels compute the descriptors of 8 consecutive pixels at once,
+        //!c[0] and c[1] hold the descriptors of the first and of the last 4 pixels
+        //!appends the comparison results given as 32 bit masks to the descriptors, as c = (c + bit) << 1
+        inline void appendCensusBits(const v_uint32x4& mask0, const v_uint32x4& mask1, v_uint32x4 c[2])
+        {
+            v_uint32x4 one = v_setall_u32(1);
+            c[0] = (c[0] + (mask0 & one)) << 1;
+            c[1] = (c[1] + (mask1 & one)) << 1;
+        }
+        //!same as above but with the masks of 16 bit comparisons
+        inline void appendCensusBits(const v_uint16x8& mask, v_uint32x4 c[2])
+        {
+            v_uint32x4 mask0, mask1;
+            v_expand(mask, mask0, mask1);
+            appendCensusBits(mask0, mask1, c);
+        }
+#endif
         //!Mean Variation is a robust kernel that compares a pixel
         //!not just with the center but also with the mean of the window
         template<int num_images>
@@ -94,6 +114,23 @@ namespace cv
                     c[i] = c[i] << 1;
                 }
             }
+#if CV_SIMD128
+            void operator()(int rrWidth,int w2, int rWidth, int jj, int j, v_uint32x4 c[num_images][2]) const
+            {
+                (void)w2;
+                for (int i = 0; i < stop; i++)
+                {
+                    v_uint16x8 center = v_load_expand(image[i] + rWidth + j);
+                    appendCensusBits(v_load_expand(image[i] + rrWidth + jj) > center, c[i]);
+                    v_uint32x4 center0, center1;
+                    v_expand(center, center0, center1);
+                    v_int32x4 mean0 = v_load(integralImage[i] + rrWidth + jj);
+                    v_int32x4 mean1 = v_load(integralImage[i] + rrWidth + jj + 4);
+                    appendCensusBits(v_reinterpret_as_u32(mean0 > v_reinterpret_as_s32(center0)),
+                                     v_reinterpret_as_u32(mean1 > v_reinterpret_as_s32(center1)), c[i]);
+                }
+            }
+#endif
         };
         //!Compares pixels from a patch giving high weights to pixels in which
         //!the intensity is higher. The other pixels receive a lower weight
@@ -135,6 +172,24 @@ namespace cv
                     }
                 }
             }
+#if CV_SIMD128
+            //!the second condition of the scalar version implies the first one, so a pixel gives either 11 or 00
+            void operator()(int rrWidth,int w2, int rWidth, int jj, int j, v_uint32x4 c[num_images][2]) const
+            {
+                (void)w2;
+                v_uint32x4 three = v_setall_u32(3);
+                v_int16x8 threshold = v_setall_s16((short)t);
+                for(int i = 0; i < imageStop; i++)
+                {
+                    v_int16x8 center = v_reinterpret_as_s16(v_load_expand(image[i] + rWidth + j));
+                    v_int16x8 pixels = v_reinterpret_as_s16(v_load_expand(image[i] + rrWidth + jj));
+                    v_uint32x4 mask0, mask1;
+                    v_expand(v_reinterpret_as_u16(pixels > center - threshold), mask0, mask1);
+                    c[i][0] = (c[i][0] << 2) + (mask0 & three);
+                    c[i][1] = (c[i][1] << 2) + (mask1 & three);
+                }
+            }
+#endif
         };
         //!A madified cs census that compares a pixel with the imediat neightbour starting
         //!from the center
@@ -165,6 +220,15 @@ namespace cv
                     c[i] = c[i] * 2;
                 }
             }
+#if CV_SIMD128
+            void operator()(int rrWidth,int w2, int rWidth, int jj, int j, v_uint32x4 c[num_images][2]) const
+            {
+                (void)j;
+                (void)rWidth;
+                for(int i = 0; i < imageStop; i++)
+                    appendCensusBits(v_load_expand(image[i] + rrWidth + jj) > v_load_expand(image[i] + w2 + jj + n2), c[i]);
+            }
+#endif
         };
         //!A kernel in which a pixel is compared with the center of the window
         template<int num_images>
@@ -192,6 +256,14 @@ namespace cv
                     c[i] <<= 1;
                 }
             }
+#if CV_SIMD128
+            void operator()(int rrWidth,int w2, int rWidth, int jj, int j, v_uint32x4 c[num_images][2]) const
+            {
+                (void)w2;
+                for(int i = 0; i < imageStop; i++)
+                    appendCensusBits(v_load_expand(image[i] + rrWidth + jj) > v_load_expand(image[i] + rWidth + j), c[i]);
+            }
+#endif
         };
         //template clas which efficiently combines the descriptors
         template <int step_start, int step_end, int step_inc,int nr_img, typename Kernel>
@@ -219,10 +291,39 @@ namespace cv
                 for (int i = r.start; i <= r.end ; i++)
                 {
                     int rWidth = i * stride_;
-                    for (int j = n2 + 2; j <= width - n2 - 2; j++)
+                    int j = n2 + 2;
+#if CV_SIMD128
+                    for (; j + 7 <= width - n2 - 2; j += 8)
+                    {
+                        v_uint32x4 c[nr_img][2];
+                        for(int l = 0; l < nr_img; l++)
+                            c[l][0] = c[l][1] = v_setzero_u32();
+                        for(int step = step_start; step <= step_end; step += step_inc)
+                        {
+                            for (int ii = - n2; ii <= + n2_stop; ii += step)
+                            {
+                                int rrWidth = (ii + i) * stride_;
+                                int rrWidthC = (ii + i + n2) * stride_;
+                                for (int jj = j - n2; jj <= j + n2; jj += step)
+                                {
+                                    if (ii != i || jj != j)
+                                    {
+                                        kernel_(rrWidth,rrWidthC, rWidth, jj, j,c);
+                                    }
+                                }
+                            }
+                        }
+                        for(int l = 0; l < nr_img; l++)
+                        {
+                            v_store(dst[l] + rWidth + j, v_reinterpret_as_s32(c[l][0]));
+                            v_store(dst[l] + rWidth + j + 4, v_reinterpret_as_s32(c[l][1]));
+                        }
+                    }
+#endif
+                    for (; j <= width - n2 - 2; j++)
                     {
                         int c[nr_img];
-                        memset(c,0,nr_img);
+                        memset(c,0,sizeof(c));
                         for(int step = step_start; step <= step_end; step += step_inc)
                         {
                             for (int ii = - n2; ii <= + n2_stop; ii += step)
@@ -294,7 +395,44 @@ namespace cv
                 for (int i = r.start; i <= r.end ; i++)
                 {
                     int rWidth = i * stride_;
-                    for (int j = n2; j <= width - n2; j++)
+                    int j = n2;
+#if CV_SIMD128
+                    for (; j + 7 <= width - n2; j += 8)
+                    {
+                        for(int d = 0 ; d < im_num; d++)
+                        {
+                            v_uint16x8 center = v_load_expand(image[d] + rWidth + j);
+                            v_uint32x4 c[2] = { v_setzero_u32(), v_setzero_u32() };
+                            for(int step = 4; step > 0; step--)
+                            {
+                                for (int ii = i - step; ii <= i + step; ii += step)
+                                {
+                                    int rrWidth = ii * stride_;
+                                    for (int jj = j - step; jj <= j + step; jj += step)
+                                        appendCensusBits(v_load_expand(image[d] + rrWidth + jj) > center, c);
+                                }
+                            }
+                            for (int ii = -1; ii <= +1; ii++)
+                            {
+                                int rrWidth = (ii + i) * stride_;
+                                if (ii + i == i)
+                                    continue;
+                                if (i == 0)
+                                {
+                                    for (int j2 = -1; j2 <= 1; j2 += 2)
+                                        appendCensusBits(v_load_expand(image[d] + rrWidth + j + j2) > center, c);
+                                }
+                                else
+                                {
+                                    appendCensusBits(v_load_expand(image[d] + rrWidth + j) > center, c);
+                                }
+                            }
+                            v_store(dst[d] + rWidth + j, v_reinterpret_as_s32(c[0]));
+                            v_store(dst[d] + rWidth + j + 4, v_reinterpret_as_s32(c[1]));
+                        }
+                    }
+#endif
+                    for (; j <= width - n2; j++)
                     {
                         for(int d = 0 ; d < im_num; d++)
                         {
@@ -386,7 +524,33 @@ namespace cv
                 for (int i = r.start; i <= r.end ; i++)
                 {
                     int distV = i*stride_;
-                    for (int j = n2; j <= width - n2; j++)
+                    int j = n2;
+#if CV_SIMD128
+                    for (; j + 7 <= width - n2; j += 8)
+                    {
+                        for(int d = 0; d < im_num; d++)
+                        {
+                            v_uint32x4 c[2] = { v_setzero_u32(), v_setzero_u32() };
+                            for (int ii = -n2; ii <= 0; ii++)
+                            {
+                                int rrWidth = (ii + i) * stride_;
+                                for (int jj = -n2; jj <= +n2; jj++)
+                                {
+                                    appendCensusBits(v_load_expand(image[d] + rrWidth + jj + j) >
+                                                     v_load_expand(image[d] + (ii * (-1) + i) * width - jj + j), c);
+                                    if(ii == 0 && jj < 0)
+                                    {
+                                        appendCensusBits(v_load_expand(image[d] + i * width + jj + j) >
+                                                         v_load_expand(image[d] + i * width - jj + j), c);
+                                    }
+                                }
+                            }
+                            v_store(dst[d] + distV + j, v_reinterpret_as_s32(c[0]));
+                            v_store(dst[d] + distV + j + 4, v_reinterpret_as_s32(c[1]));
+                        }
+                    }
+#endif
+                    for (; j <= width - n2; j++)
                     {
                         for(int d = 0; d < im_num; d++)
                         {
@@ -141,3 +141,51 @@ PERF_TEST_P( descript_params, center_symetric_census,
     }
     SANITY_CHECK(out1);
 }
+PERF_TEST_P( descript_params, census_dense_descriptor,
+            testing::Combine(
+            testing::Values( TYPICAL_MAT_SIZES ),
+            testing::Values( CV_8UC1,CV_8U ),
+            testing::Values( CV_32SC4,CV_32S )
+            )
+            )
+{
+    Size sz = std::tr1::get<0>(GetParam());
+    int matType = std::tr1::get<1>(GetParam());
+    int sdepth = std::tr1::get<2>(GetParam());
+
+    Mat left(sz, matType);
+    Mat out1(sz, sdepth);
+
+    declare.in(left, WARMUP_RNG)
+        .out(out1)
+        .time(0.01);
+    TEST_CYCLE()
+    {
+        censusTransform(left,5,out1,CV_DENSE_CENSUS);
+    }
+    SANITY_CHECK_NOTHING();
+}
+PERF_TEST_P( descript_params, modified_center_symetric_census,
+            testing::Combine(
+            testing::Values( TYPICAL_MAT_SIZES ),
+            testing::Values( CV_8UC1,CV_8U ),
+            testing::Values( CV_32SC4,CV_32S )
+            )
+            )
+{
+    Size sz = std::tr1::get<0>(GetParam());
+    int matType = std::tr1::get<1>(GetParam());
+    int sdepth = std::tr1::get<2>(GetParam());
+
+    Mat left(sz, matType);
+    Mat out1(sz, sdepth);
+
+    declare.in(left, WARMUP_RNG)
+        .out(out1)
+        .time(0.01);
+    TEST_CYCLE()
+    {
+        symetricCensusTransform(left,7,out1,CV_MODIFIED_CS_CENSUS);
+    }
+    SANITY_CHECK_NOTHING();
+}
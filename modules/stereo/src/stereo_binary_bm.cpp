@@ -264,6 +264,113 @@ namespace cv
             StereoBinaryBMParams* state;
         };
 
+        static inline short hammingWeight(unsigned v)
+        {
+            v = v - ((v >> 1) & 0x55555555);
+            v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+            v = (v + (v >> 4)) & 0x0F0F0F0F;
+            return (short)((v + (v >> 8) + (v >> 16) + (v >> 24)) & 0x3F);
+        }
+
+        /* Box sums of the Hamming distances between the census transforms, in the layout expected by
+         * Matching::dispartyMapFormation. The cost of the pixel (y, x) is the sum over the window centered
+         * at (y + 1, x), the same as the one of hammingDistanceBlockMatching + costGathering + blockAgregation.
+         * The window slides down the rows by updating column sums with the entering and the leaving row,
+         * and along a row by updating the sum with the entering and the leaving column. The Hamming
+         * distances are recomputed for the rows as they are needed, so no cost volume is kept besides the
+         * output one.
+         */
+        class HammingBoxCostInvoker : public ParallelLoopBody
+        {
+        public:
+            HammingBoxCostInvoker(const Mat& _censusLeft, const Mat& _censusRight, int _maxDisp, int _win,
+                                  int _rowStart, int _rowEnd, int _nstripes, Mat& _cost) :
+                censusLeft(_censusLeft), censusRight(_censusRight), maxDisp(_maxDisp), win(_win),
+                rowStart(_rowStart), rowEnd(_rowEnd), nstripes(_nstripes), cost(_cost)
+            {}
+
+            void operator()(const Range& range) const
+            {
+                const int width = censusLeft.cols, nd = maxDisp + 1;
+                const int rows = rowEnd - rowStart;
+                const int y0 = rowStart + range.start * rows / nstripes;
+                const int y1 = rowStart + range.end * rows / nstripes;
+                if (y0 >= y1)
+                    return;
+
+                AutoBuffer<int> _colSum((size_t)width * nd);
+                AutoBuffer<short> _hamRows((size_t)width * nd * 2);
+                int* colSum = _colSum;
+                short* entering = _hamRows;
+                short* leaving = entering + (size_t)width * nd;
+                short* c = (short*)cost.data;
+
+                memset(colSum, 0, (size_t)width * nd * sizeof(colSum[0]));
+                for (int i = y0 + 1 - win; i <= y0 + 1 + win; i++)
+                {
+                    hammingRow(i, entering);
+                    for (int k = 0; k < width * nd; k++)
+                        colSum[k] += entering[k];
+                }
+
+                for (int y = y0; y < y1; y++)
+                {
+                    if (y > y0)
+                    {
+                        hammingRow(y + 1 + win, entering);
+                        hammingRow(y - win, leaving);
+                        for (int k = 0; k < width * nd; k++)
+                            colSum[k] += entering[k] - leaving[k];
+                    }
+                    short* dst = c + (size_t)y * width * nd;
+                    for (int d = 0; d < nd; d++)
+                    {
+                        int sum = 0;
+                        for (int x = 0; x < 2 * win; x++)
+                            sum += colSum[x * nd + d];
+                        for (int x = win; x <= width - win - 2; x++)
+                        {
+                            sum += colSum[(x + win) * nd + d];
+                            dst[x * nd + d] = (short)sum;
+                            sum -= colSum[(x - win) * nd + d];
+                        }
+                    }
+                }
+            }
+
+        private:
+            //! the distances of hammingDistanceBlockMatching with its default kernel size, zero at the borders
+            void hammingRow(int y, short* ham) const
+            {
+                const int border = 4;
+                const int width = censusLeft.cols, height = censusLeft.rows, nd = maxDisp + 1;
+                memset(ham, 0, (size_t)width * nd * sizeof(ham[0]));
+                if (y < border || y > height - border || height - border <= border)
+                    return;
+                const unsigned* left = (const unsigned*)censusLeft.data + (size_t)y * width;
+                const unsigned* right = (const unsigned*)censusRight.data + (size_t)y * width;
+                for (int x = border; x < width - border; x++)
+                {
+                    short* h = ham + x * nd;
+                    const unsigned l = left[x];
+                    int d = 0;
+                    for (; d <= std::min(x, maxDisp); d++)
+                        h[d] = hammingWeight(l ^ right[x - d]);
+                    const short h0 = hammingWeight(l ^ right[0]);
+                    for (; d < nd; d++)
+                        h[d] = h0;
+                }
+            }
+
+            const Mat& censusLeft;
+            const Mat& censusRight;
+            int maxDisp, win;
+            int rowStart, rowEnd, nstripes;
+            Mat& cost;
+
+            HammingBoxCostInvoker& operator=(const HammingBoxCostInvoker&);
+        };
+
         class StereoBinaryBMImpl : public StereoBinaryBM, public Matching
         {
         public:
@@ -332,9 +439,6 @@ namespace cv
                     censusImage[0].create(left0.rows,left0.cols,CV_32SC4);
                     censusImage[1].create(left0.rows,left0.cols,CV_32SC4);
 
-                    partialSumsLR.create(left0.rows + 1,(left0.cols + 1) * (params.numDisparities + 1),CV_16S);
-                    agregatedHammingLRCost.create(left0.rows + 1,(left0.cols + 1) * (params.numDisparities + 1),CV_16S);
-                    hammingDistance.create(left0.rows, left0.cols * (params.numDisparities + 1),CV_16S);
 
                     preFilteredImg0.create(left0.size(), CV_8U);
                     preFilteredImg1.create(left0.size(), CV_8U);
@@ -400,9 +504,18 @@ namespace cv
                 {
                     starCensusTransform(left,right,params.kernelSize,censusImage[0],censusImage[1]);
                 }
-                hammingDistanceBlockMatching(censusImage[0], censusImage[1], hammingDistance);
-                costGathering(hammingDistance, partialSumsLR);
-                blockAgregation(partialSumsLR, params.agregationWindowSize, agregatedHammingLRCost);
+                // the aggregated costs are in the linear layout of dispartyMapFormation
+                setMaxDisparity(params.numDisparities);
+                agregatedHammingLRCost.create(left0.rows + 1,(left0.cols + 1) * (params.numDisparities + 1),CV_16S);
+                memset(agregatedHammingLRCost.data, 0, sizeof(short) * width * height * (params.numDisparities + 1));
+                int win = params.agregationWindowSize / 2;
+                if (win + 1 < height - win - 1)
+                {
+                    int nstripes = std::max(1, std::min(getNumThreads(), height - 2 * win - 1));
+                    parallel_for_(Range(0, nstripes),
+                                  HammingBoxCostInvoker(censusImage[0], censusImage[1], params.numDisparities, win,
+                                                        win, height - win - 1, nstripes, agregatedHammingLRCost));
+                }
                 dispartyMapFormation(agregatedHammingLRCost, disp0, 3);
                 Median1x9Filter<uint8_t>(disp0, aux);
                 Median9x1Filter<uint8_t>(aux,disp0);
@@ -507,8 +620,6 @@ namespace cv
             Mat parSumsIntensityImage[2];
             Mat Integral[2];
             Mat censusImage[2];
-            Mat hammingDistance;
-            Mat partialSumsLR;
             Mat agregatedHammingLRCost;
             Mat aux;
             static const char* name_;
@@ -49,6 +49,7 @@ SGBM (Semi-global block matching)
 */
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <limits.h>
 
 namespace cv
@@ -110,6 +111,93 @@ namespace cv
             int subpixelInterpolationMethod;
         };
 
+        static inline int censusCost(unsigned v)
+        {
+            v = v - ((v >> 1) & 0x55555555);
+            v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+            v = (v + (v >> 4)) & 0x0F0F0F0F;
+            return (int)((v + (v >> 8) + (v >> 16) + (v >> 24)) & 0x3F);
+        }
+
+#if CV_SIMD128
+        static inline v_uint32x4 censusCost(const v_uint32x4& x)
+        {
+            v_uint32x4 v = x - ((x >> 1) & v_setall_u32(0x55555555));
+            v = (v & v_setall_u32(0x33333333)) + ((v >> 2) & v_setall_u32(0x33333333));
+            v = (v + (v >> 4)) & v_setall_u32(0x0F0F0F0F);
+            v = v + (v >> 8);
+            return (v + (v >> 16)) & v_setall_u32(0x3F);
+        }
+#endif
+
+        /*
+        Hamming distances between the census transforms of the rows of the left and right images:
+        cost[(y - rowStart)*width1*D + x*D + d] = |censusLeft(y, x) ^ censusRight(y, max(x - d, 0))|.
+        The distances are zero at the borders, as the ones of Matching::hammingDistanceBlockMatching
+        with its default kernel size.
+        */
+        class CensusCostInvoker : public ParallelLoopBody
+        {
+        public:
+            CensusCostInvoker(const Mat& _censusLeft, const Mat& _censusRight, CostType* _cost,
+                              int _rowStart, int _width1, int _D) :
+                censusLeft(_censusLeft), censusRight(_censusRight), cost(_cost),
+                rowStart(_rowStart), width1(_width1), D(_D)
+            {}
+
+            void operator()(const Range& range) const
+            {
+                const int border = 4;
+                const int width = censusLeft.cols, height = censusLeft.rows;
+                // the right row mirrored and extended by its first value, so that the census
+                // of max(x - d, 0) for the consecutive disparities are consecutive in memory
+                AutoBuffer<unsigned> _rightRow(width + D);
+                unsigned* rightRow = _rightRow;
+
+                for( int y = range.start; y < range.end; y++ )
+                {
+                    CostType* costRow = cost + (size_t)(y - rowStart)*width1*D;
+                    memset(costRow, 0, width1*D*sizeof(CostType));
+                    if( y < border || y > height - border || height - border <= border )
+                        continue;
+
+                    const unsigned* left = (const unsigned*)censusLeft.data + (size_t)y*width;
+                    const unsigned* right = (const unsigned*)censusRight.data + (size_t)y*width;
+                    for( int x = 0; x < width; x++ )
+                        rightRow[x] = right[width - 1 - x];
+                    for( int x = width; x < width + D; x++ )
+                        rightRow[x] = right[0];
+
+                    for( int x = border; x < std::min(width - border, width1); x++ )
+                    {
+                        const unsigned l = left[x];
+                        const unsigned* r = rightRow + width - 1 - x;
+                        CostType* c = costRow + x*D;
+                        int d = 0;
+#if CV_SIMD128
+                        v_uint32x4 lv = v_setall_u32(l);
+                        for( ; d <= D - 8; d += 8 )
+                        {
+                            v_uint32x4 c0 = censusCost(lv ^ v_load(r + d));
+                            v_uint32x4 c1 = censusCost(lv ^ v_load(r + d + 4));
+                            v_store(c + d, v_reinterpret_as_s16(v_pack(c0, c1)));
+                        }
+#endif
+                        for( ; d < D; d++ )
+                            c[d] = (CostType)censusCost(l ^ r[d]);
+                    }
+                }
+            }
+
+        private:
+            const Mat& censusLeft;
+            const Mat& censusRight;
+            CostType* cost;
+            int rowStart, width1, D;
+
+            CensusCostInvoker& operator=(const CensusCostInvoker&);
+        };
+
         /*
         computes disparity for "roi" in img1 w.r.t. img2 and write it to disp1buf.
         that is, disp1buf(x, y)=d means that img1(x+roi.x, y+roi.y) ~ img2(x+roi.x-d, y+roi.y).
@@ -129,24 +217,8 @@ namespace cv
         */
         static void computeDisparityBinarySGBM( const Mat& img1, const Mat& img2,
             Mat& disp1, const StereoBinarySGBMParams& params,
-            Mat& buffer,const Mat& hamDist)
+            Mat& buffer, const Mat& censusLeft, const Mat& censusRight)
         {
-#if CV_SSE2
-            static const uchar LSBTab[] =
-            {
-                0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
-                5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
-                6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
-                5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
-                7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
-                5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
-                6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
-                5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
-            };
-
-            volatile bool useSIMD = checkHardwareSupport(CV_CPU_SSE2);
-#endif
-
             const int ALIGN = 16;
             const int DISP_SHIFT = StereoMatcher::DISP_SHIFT;
             const int DISP_SCALE = (1 << DISP_SHIFT);
@@ -171,6 +243,7 @@ namespace cv
                 return;
             }
             CV_Assert( D % 16 == 0 );
+            CV_Assert( censusLeft.size() == img2.size() && censusRight.size() == img2.size() );
             // NR - the number of directions. the loop on x below that computes Lr assumes that NR == 8.
             // if you change NR, please, modify the loop as well.
             int D2 = D+16, NRD2 = NR2*D2;
@@ -179,9 +252,10 @@ namespace cv
             // the previous row, i.e. 2 rows in total
             const int NLR = 2;
             const int LrBorder = NLR - 1;
-            int ww = img2.cols;
-            short *ham;
-            ham = (short *)hamDist.data;
+            // the census costs of the rows are computed in parallel, by blocks of rows
+            // at the time they are needed, instead of keeping the whole cost volume
+            const int costBlockRows = 16;
+            int costBlockStart = 0, costBlockEnd = 0;
             // for each possible stereo match (img1(x,y) <=> img2(x-d,y))
             // we keep pixel difference cost (C) and the summary cost over NR directions (S).
             // we also keep all the partial costs for the previous line L_r(x,d) and also min_k L_r(x, k)
@@ -193,7 +267,8 @@ namespace cv
                 costBufSize*(hsumBufNRows + 1)*sizeof(CostType) + // hsumBuf, pixdiff
                 CSBufSize*2*sizeof(CostType) + // C, S
                 width*16*img1.channels()*sizeof(PixType) + // temp buffer for computing per-pixel cost
-                width*(sizeof(CostType) + sizeof(DispType)) + 1024; // disp2cost + disp2
+                width*(sizeof(CostType) + sizeof(DispType)) + // disp2cost + disp2
+                costBufSize*costBlockRows*sizeof(CostType) + 1024; // census costs of a block of rows
             if( buffer.empty() || !buffer.isContinuous() ||
                 buffer.cols*buffer.rows*buffer.elemSize() < totalBufSize )
                 buffer.create(1, (int)totalBufSize, CV_8U);
@@ -205,6 +280,7 @@ namespace cv
             CostType* disp2cost = pixDiff + costBufSize + (LrSize + minLrSize)*NLR;
             DispType* disp2ptr = (DispType*)(disp2cost + width);
             //            PixType* tempBuf = (PixType*)(disp2ptr + width);
+            CostType* costBlock = (CostType*)alignPtr(disp2ptr + width, ALIGN);
             // add P2 to every C(x,y). it saves a few operations in the inner loops
             for( k = 0; k < width1*D; k++ )
                 Cbuf[k] = (CostType)P2;
@@ -248,19 +324,20 @@ namespace cv
                             CostType* hsumAdd = hsumBuf + (std::min(k, height-1) % hsumBufNRows)*costBufSize;
                             if( k < height )
                             {
-                                for(int ii = 0; ii <= ww; ii++)
+                                if( k >= costBlockEnd )
                                 {
-                                    for(int dd = 0; dd <= params.numDisparities; dd++)
-                                    {
-                                        pixDiff[ii * (params.numDisparities)+ dd] = (CostType)(ham[(k * (ww) + ii) * (params.numDisparities +1) + dd]);
-                                    }
+                                    costBlockStart = k;
+                                    costBlockEnd = std::min(k + costBlockRows, height);
+                                    parallel_for_(Range(costBlockStart, costBlockEnd),
+                                                  CensusCostInvoker(censusLeft, censusRight, costBlock, costBlockStart, width1, D));
                                 }
+                                const CostType* pixCost = costBlock + (k - costBlockStart)*costBufSize;
                                 memset(hsumAdd, 0, D*sizeof(CostType));
                                 for( x = 0; x <= SW2*D; x += D )
                                 {
                                     int scale = x == 0 ? SW2 + 1 : 1;
                                     for( d = 0; d < D; d++ )
-                                        hsumAdd[d] = (CostType)(hsumAdd[d] + pixDiff[x + d]*scale);
+                                        hsumAdd[d] = (CostType)(hsumAdd[d] + pixCost[x + d]*scale);
                                 }
 
                                 if( y > 0 )
@@ -270,43 +347,34 @@ namespace cv
 
                                     for( x = D; x < width1*D; x += D )
                                     {
-                                        const CostType* pixAdd = pixDiff + std::min(x + SW2*D, (width1-1)*D);
-                                        const CostType* pixSub = pixDiff + std::max(x - (SW2+1)*D, 0);
+                                        const CostType* pixAdd = pixCost + std::min(x + SW2*D, (width1-1)*D);
+                                        const CostType* pixSub = pixCost + std::max(x - (SW2+1)*D, 0);
 
-#if CV_SSE2
-                                        if( useSIMD )
+#if CV_SIMD128
+                                        for( d = 0; d < D; d += 8 )
                                         {
-                                            for( d = 0; d < D; d += 8 )
-                                            {
-                                                __m128i hv = _mm_load_si128((const __m128i*)(hsumAdd + x - D + d));
-                                                __m128i Cx = _mm_load_si128((__m128i*)(Cprev + x + d));
-                                                hv = _mm_adds_epi16(_mm_subs_epi16(hv,
-                                                    _mm_load_si128((const __m128i*)(pixSub + d))),
-                                                    _mm_load_si128((const __m128i*)(pixAdd + d)));
-                                                Cx = _mm_adds_epi16(_mm_subs_epi16(Cx,
-                                                    _mm_load_si128((const __m128i*)(hsumSub + x + d))),
-                                                    hv);
-                                                _mm_store_si128((__m128i*)(hsumAdd + x + d), hv);
-                                                _mm_store_si128((__m128i*)(C + x + d), Cx);
-                                            }
+                                            v_int16x8 hv = v_load(hsumAdd + x - D + d);
+                                            v_int16x8 Cx = v_load(Cprev + x + d);
+                                            hv = (hv - v_load(pixSub + d)) + v_load(pixAdd + d);
+                                            Cx = (Cx - v_load(hsumSub + x + d)) + hv;
+                                            v_store(hsumAdd + x + d, hv);
+                                            v_store(C + x + d, Cx);
                                         }
-                                        else
-#endif
+#else
+                                        for( d = 0; d < D; d++ )
                                         {
-                                            for( d = 0; d < D; d++ )
-                                            {
-                                                int hv = hsumAdd[x + d] = (CostType)(hsumAdd[x - D + d] + pixAdd[d] - pixSub[d]);
-                                                C[x + d] = (CostType)(Cprev[x + d] + hv - hsumSub[x + d]);
-                                            }
+                                            int hv = hsumAdd[x + d] = (CostType)(hsumAdd[x - D + d] + pixAdd[d] - pixSub[d]);
+                                            C[x + d] = (CostType)(Cprev[x + d] + hv - hsumSub[x + d]);
                                         }
+#endif
                                     }
                                 }
                                 else
                                 {
                                     for( x = D; x < width1*D; x += D )
                                     {
-                                        const CostType* pixAdd = pixDiff + std::min(x + SW2*D, (width1-1)*D);
-                                        const CostType* pixSub = pixDiff + std::max(x - (SW2+1)*D, 0);
+                                        const CostType* pixAdd = pixCost + std::min(x + SW2*D, (width1-1)*D);
+                                        const CostType* pixSub = pixCost + std::max(x - (SW2+1)*D, 0);
                                         for( d = 0; d < D; d++ )
                                             hsumAdd[x + d] = (CostType)(hsumAdd[x - D + d] + pixAdd[d] - pixSub[d]);
                                     }
@@ -360,59 +428,63 @@ namespace cv
                         CostType* Lr_p = Lr[0] + xd;
                         const CostType* Cp = C + x*D;
                         CostType* Sp = S + x*D;
-#if CV_SSE2
-                        if( useSIMD )
+#if CV_SIMD128
                         {
-                            __m128i _P1 = _mm_set1_epi16((short)P1);
-                            __m128i _delta0 = _mm_set1_epi16((short)delta0);
-                            __m128i _delta1 = _mm_set1_epi16((short)delta1);
-                            __m128i _delta2 = _mm_set1_epi16((short)delta2);
-                            __m128i _delta3 = _mm_set1_epi16((short)delta3);
-                            __m128i _minL0 = _mm_set1_epi16((short)MAX_COST);
+                            v_int16x8 _P1 = v_setall_s16((short)P1);
+                            v_int16x8 _delta0 = v_setall_s16((short)delta0);
+                            v_int16x8 _delta1 = v_setall_s16((short)delta1);
+                            v_int16x8 _delta2 = v_setall_s16((short)delta2);
+                            v_int16x8 _delta3 = v_setall_s16((short)delta3);
+                            v_int16x8 _minL0 = v_setall_s16((short)MAX_COST);
                             for( d = 0; d < D; d += 8 )
                             {
-                                __m128i Cpd = _mm_load_si128((const __m128i*)(Cp + d));
-                                __m128i L0, L1, L2, L3;
-                                L0 = _mm_load_si128((const __m128i*)(Lr_p0 + d));
-                                L1 = _mm_load_si128((const __m128i*)(Lr_p1 + d));
-                                L2 = _mm_load_si128((const __m128i*)(Lr_p2 + d));
-                                L3 = _mm_load_si128((const __m128i*)(Lr_p3 + d));
-                                L0 = _mm_min_epi16(L0, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p0 + d - 1)), _P1));
-                                L0 = _mm_min_epi16(L0, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p0 + d + 1)), _P1));
-                                L1 = _mm_min_epi16(L1, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p1 + d - 1)), _P1));
-                                L1 = _mm_min_epi16(L1, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p1 + d + 1)), _P1));
-                                L2 = _mm_min_epi16(L2, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p2 + d - 1)), _P1));
-                                L2 = _mm_min_epi16(L2, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p2 + d + 1)), _P1));
-                                L3 = _mm_min_epi16(L3, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p3 + d - 1)), _P1));
-                                L3 = _mm_min_epi16(L3, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p3 + d + 1)), _P1));
-                                L0 = _mm_min_epi16(L0, _delta0);
-                                L0 = _mm_adds_epi16(_mm_subs_epi16(L0, _delta0), Cpd);
-                                L1 = _mm_min_epi16(L1, _delta1);
-                                L1 = _mm_adds_epi16(_mm_subs_epi16(L1, _delta1), Cpd);
-                                L2 = _mm_min_epi16(L2, _delta2);
-                                L2 = _mm_adds_epi16(_mm_subs_epi16(L2, _delta2), Cpd);
-                                L3 = _mm_min_epi16(L3, _delta3);
-                                L3 = _mm_adds_epi16(_mm_subs_epi16(L3, _delta3), Cpd);
-                                _mm_store_si128( (__m128i*)(Lr_p + d), L0);
-                                _mm_store_si128( (__m128i*)(Lr_p + d + D2), L1);
-                                _mm_store_si128( (__m128i*)(Lr_p + d + D2*2), L2);
-                                _mm_store_si128( (__m128i*)(Lr_p + d + D2*3), L3);
-                                __m128i t0 = _mm_min_epi16(_mm_unpacklo_epi16(L0, L2), _mm_unpackhi_epi16(L0, L2));
-                                __m128i t1 = _mm_min_epi16(_mm_unpacklo_epi16(L1, L3), _mm_unpackhi_epi16(L1, L3));
-                                t0 = _mm_min_epi16(_mm_unpacklo_epi16(t0, t1), _mm_unpackhi_epi16(t0, t1));
-                                _minL0 = _mm_min_epi16(_minL0, t0);
-                                __m128i Sval = _mm_load_si128((const __m128i*)(Sp + d));
-                                L0 = _mm_adds_epi16(L0, L1);
-                                L2 = _mm_adds_epi16(L2, L3);
-                                Sval = _mm_adds_epi16(Sval, L0);
-                                Sval = _mm_adds_epi16(Sval, L2);
-                                _mm_store_si128((__m128i*)(Sp + d), Sval);
+                                v_int16x8 Cpd = v_load(Cp + d);
+                                v_int16x8 L0, L1, L2, L3;
+                                L0 = v_load(Lr_p0 + d);
+                                L1 = v_load(Lr_p1 + d);
+                                L2 = v_load(Lr_p2 + d);
+                                L3 = v_load(Lr_p3 + d);
+                                L0 = v_min(L0, v_load(Lr_p0 + d - 1) + _P1);
+                                L0 = v_min(L0, v_load(Lr_p0 + d + 1) + _P1);
+                                L1 = v_min(L1, v_load(Lr_p1 + d - 1) + _P1);
+                                L1 = v_min(L1, v_load(Lr_p1 + d + 1) + _P1);
+                                L2 = v_min(L2, v_load(Lr_p2 + d - 1) + _P1);
+                                L2 = v_min(L2, v_load(Lr_p2 + d + 1) + _P1);
+                                L3 = v_min(L3, v_load(Lr_p3 + d - 1) + _P1);
+                                L3 = v_min(L3, v_load(Lr_p3 + d + 1) + _P1);
+                                L0 = v_min(L0, _delta0);
+                                L0 = (L0 - _delta0) + Cpd;
+                                L1 = v_min(L1, _delta1);
+                                L1 = (L1 - _delta1) + Cpd;
+                                L2 = v_min(L2, _delta2);
+                                L2 = (L2 - _delta2) + Cpd;
+                                L3 = v_min(L3, _delta3);
+                                L3 = (L3 - _delta3) + Cpd;
+                                v_store(Lr_p + d, L0);
+                                v_store(Lr_p + d + D2, L1);
+                                v_store(Lr_p + d + D2*2, L2);
+                                v_store(Lr_p + d + D2*3, L3);
+                                // lanes i and i + 4 of the result hold the partial minimums of the path i
+                                v_int16x8 t0, t1, t2, t3;
+                                v_zip(L0, L2, t0, t1);
+                                t0 = v_min(t0, t1);
+                                v_zip(L1, L3, t2, t3);
+                                t2 = v_min(t2, t3);
+                                v_zip(t0, t2, t1, t3);
+                                _minL0 = v_min(_minL0, v_min(t1, t3));
+                                v_int16x8 Sval = v_load(Sp + d);
+                                L0 = L0 + L1;
+                                L2 = L2 + L3;
+                                Sval = Sval + L0;
+                                Sval = Sval + L2;
+                                v_store(Sp + d, Sval);
                             }
-                            _minL0 = _mm_min_epi16(_minL0, _mm_srli_si128(_minL0, 8));
-                            _mm_storel_epi64((__m128i*)&minLr[0][xm], _minL0);
+                            short CV_DECL_ALIGNED(16) minLBuf[8];
+                            v_store_aligned(minLBuf, _minL0);
+                            for( int i = 0; i < 4; i++ )
+                                minLr[0][xm + i] = std::min(minLBuf[i], minLBuf[i + 4]);
                         }
-                        else
-#endif
+#else
                         {
                             int minL0 = MAX_COST, minL1 = MAX_COST, minL2 = MAX_COST, minL3 = MAX_COST;
 
@@ -444,6 +516,7 @@ namespace cv
                             minLr[0][xm+2] = (CostType)minL2;
                             minLr[0][xm+3] = (CostType)minL3;
                         }
+#endif
                     }
 
                     if( pass == npasses )
@@ -469,48 +542,51 @@ namespace cv
                                 Lr_p0[-1] = Lr_p0[D] = MAX_COST;
                                 CostType* Lr_p = Lr[0] + xd;
                                 const CostType* Cp = C + x*D;
-#if CV_SSE2
-                                if( useSIMD )
+#if CV_SIMD128
                                 {
-                                    __m128i _P1 = _mm_set1_epi16((short)P1);
-                                    __m128i _delta0 = _mm_set1_epi16((short)delta0);
-                                    __m128i _minL0 = _mm_set1_epi16((short)minL0);
-                                    __m128i _minS = _mm_set1_epi16(MAX_COST), _bestDisp = _mm_set1_epi16(-1);
-                                    __m128i _d8 = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _8 = _mm_set1_epi16(8);
+                                    v_int16x8 _P1 = v_setall_s16((short)P1);
+                                    v_int16x8 _delta0 = v_setall_s16((short)delta0);
+                                    v_int16x8 _minL0 = v_setall_s16((short)minL0);
+                                    v_int16x8 _minS = v_setall_s16(MAX_COST), _bestDisp = v_setall_s16(-1);
+                                    v_int16x8 _d8(0, 1, 2, 3, 4, 5, 6, 7), _8 = v_setall_s16(8);
                                     for( d = 0; d < D; d += 8 )
                                     {
-                                        __m128i Cpd = _mm_load_si128((const __m128i*)(Cp + d)), L0;
-                                        L0 = _mm_load_si128((const __m128i*)(Lr_p0 + d));
-                                        L0 = _mm_min_epi16(L0, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p0 + d - 1)), _P1));
-                                        L0 = _mm_min_epi16(L0, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lr_p0 + d + 1)), _P1));
-                                        L0 = _mm_min_epi16(L0, _delta0);
-                                        L0 = _mm_adds_epi16(_mm_subs_epi16(L0, _delta0), Cpd);
-                                        _mm_store_si128((__m128i*)(Lr_p + d), L0);
-                                        _minL0 = _mm_min_epi16(_minL0, L0);
-                                        L0 = _mm_adds_epi16(L0, *(__m128i*)(Sp + d));
-                                        _mm_store_si128((__m128i*)(Sp + d), L0);
-                                        __m128i mask = _mm_cmpgt_epi16(_minS, L0);
-                                        _minS = _mm_min_epi16(_minS, L0);
-                                        _bestDisp = _mm_xor_si128(_bestDisp, _mm_and_si128(_mm_xor_si128(_bestDisp,_d8), mask));
-                                        _d8 = _mm_adds_epi16(_d8, _8);
+                                        v_int16x8 Cpd = v_load(Cp + d), L0;
+                                        L0 = v_load(Lr_p0 + d);
+                                        L0 = v_min(L0, v_load(Lr_p0 + d - 1) + _P1);
+                                        L0 = v_min(L0, v_load(Lr_p0 + d + 1) + _P1);
+                                        L0 = v_min(L0, _delta0);
+                                        L0 = (L0 - _delta0) + Cpd;
+                                        v_store(Lr_p + d, L0);
+                                        _minL0 = v_min(_minL0, L0);
+                                        L0 = L0 + v_load(Sp + d);
+                                        v_store(Sp + d, L0);
+                                        v_int16x8 mask = _minS > L0;
+                                        _minS = v_min(_minS, L0);
+                                        _bestDisp = v_select(mask, _d8, _bestDisp);
+                                        _d8 = _d8 + _8;
+                                    }
+                                    short CV_DECL_ALIGNED(16) minLBuf[8], minSBuf[8], bestDispBuf[8];
+                                    v_store_aligned(minLBuf, _minL0);
+                                    v_store_aligned(minSBuf, _minS);
+                                    v_store_aligned(bestDispBuf, _bestDisp);
+                                    for( int i = 0; i < 8; i++ )
+                                    {
+                                        minL0 = std::min(minL0, (int)minLBuf[i]);
+                                        minS = std::min(minS, (int)minSBuf[i]);
+                                    }
+                                    minLr[0][xm] = (CostType)minL0;
+                                    // the first lane with the minimal cost has the smallest disparity among them
+                                    for( int i = 0; i < 8; i++ )
+                                    {
+                                        if( minSBuf[i] == minS )
+                                        {
+                                            bestDisp = bestDispBuf[i];
+                                            break;
+                                        }
                                     }
-                                    short CV_DECL_ALIGNED(16) bestDispBuf[8];
-                                    _mm_store_si128((__m128i*)bestDispBuf, _bestDisp);
-                                    _minL0 = _mm_min_epi16(_minL0, _mm_srli_si128(_minL0, 8));
-                                    _minL0 = _mm_min_epi16(_minL0, _mm_srli_si128(_minL0, 4));
-                                    _minL0 = _mm_min_epi16(_minL0, _mm_srli_si128(_minL0, 2));
-                                    __m128i qS = _mm_min_epi16(_minS, _mm_srli_si128(_minS, 8));
-                                    qS = _mm_min_epi16(qS, _mm_srli_si128(qS, 4));
-                                    qS = _mm_min_epi16(qS, _mm_srli_si128(qS, 2));
-                                    minLr[0][xm] = (CostType)_mm_cvtsi128_si32(_minL0);
-                                    minS = (CostType)_mm_cvtsi128_si32(qS);
-                                    qS = _mm_shuffle_epi32(_mm_unpacklo_epi16(qS, qS), 0);
-                                    qS = _mm_cmpeq_epi16(_minS, qS);
-                                    int idx = _mm_movemask_epi8(_mm_packs_epi16(qS, qS)) & 255;
-                                    bestDisp = bestDispBuf[LSBTab[idx]];
                                 }
-                                else
-#endif
+#else
                                 {
                                     for( d = 0; d < D; d++ )
                                     {
@@ -526,6 +602,7 @@ namespace cv
                                     }
                                     minLr[0][xm] = (CostType)minL0;
                                 }
+#endif
                             }
                             else
                             {
@@ -645,8 +722,6 @@ namespace cv
                 censusImageLeft.create(left.rows,left.cols,CV_32SC4);
                 censusImageRight.create(left.rows,left.cols,CV_32SC4);
 
-                hamDist.create(left.rows, left.cols * (params.numDisparities + 1),CV_16S);
-
                 if(params.kernelType == CV_SPARSE_CENSUS)
                 {
                     censusTransform(left,right,params.kernelSize,censusImageLeft,censusImageRight,CV_SPARSE_CENSUS);
@@ -684,9 +759,7 @@ namespace cv
                     starCensusTransform(left,right,params.kernelSize,censusImageLeft,censusImageRight);
                 }
 
-                hammingDistanceBlockMatching(censusImageLeft, censusImageRight, hamDist);
-
-                computeDisparityBinarySGBM( left, right, disp, params, buffer,hamDist);
+                computeDisparityBinarySGBM( left, right, disp, params, buffer, censusImageLeft, censusImageRight);
 
                 if(params.regionRemoval == CV_SPECKLE_REMOVAL_AVG_ALGORITHM)
                 {
@@ -800,7 +873,6 @@ namespace cv
             Mat censusImageRight;
             Mat partialSumsLR;
             Mat agregatedHammingLRCost;
-            Mat hamDist;
             Mat parSumsIntensityImage[2];
             Mat Integral[2];
         };
@@ -40,6 +40,7 @@
  //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv {
 namespace structured_light {
@@ -98,9 +99,9 @@ class CV_EXPORTS_W GrayCodePattern_Impl : public GrayCodePattern
   // Computes the required number of pattern images, allocating the pattern vector
   void computeNumberOfPatternImages();
 
-  // Computes the shadows occlusion where we cannot reconstruct the model
-  void computeShadowMasks( InputArrayOfArrays blackImages, InputArrayOfArrays whiteImages,
-                           OutputArrayOfArrays shadowMasks ) const;
+  // Decodes the projector pixels (CV_32SC2, -1 where not decoded) seen by a camera, masking the shadows
+  void decodeProjPixels( const std::vector<Mat>& patternImages, const Mat& blackImage, const Mat& whiteImage,
+                         Mat& projPixels ) const;
 
   // Converts a gray code sequence (~ binary number) to a decimal number
   int grayToDec( const std::vector<uchar>& gray ) const;
@@ -216,46 +217,39 @@ bool GrayCodePattern_Impl::decode( InputArrayOfArrays patternImages, OutputArray
 
   if( flags == DECODE_3D_UNDERWORLD )
   {
-    // Computing shadows mask
-    std::vector<Mat> shadowMasks;
-    computeShadowMasks( blackImages, whitheImages, shadowMasks );
+    std::vector<Mat>& blackImages_ = *( std::vector<Mat>* ) blackImages.getObj();
+    std::vector<Mat>& whiteImages_ = *( std::vector<Mat>* ) whitheImages.getObj();
+    CV_Assert( blackImages_.size() == acquired_pattern.size() && whiteImages_.size() == acquired_pattern.size() );
 
     int cam_width = acquired_pattern[0][0].cols;
     int cam_height = acquired_pattern[0][0].rows;
 
-    Point projPixel;
-
     // Storage for the pixels of the two cams that correspond to the same pixel of the projector
     std::vector<std::vector<std::vector<Point> > > camsPixels;
     camsPixels.resize( acquired_pattern.size() );
 
-    // TODO: parallelize for (k and j)
+    Mat projPixels;
     for( size_t k = 0; k < acquired_pattern.size(); k++ )
     {
+      //for each (x,y) pixel of the camera computes the corresponding projector pixel, shadowed pixels are skipped
+      decodeProjPixels( acquired_pattern[k], blackImages_[k], whiteImages_[k], projPixels );
+
       camsPixels[k].resize( params.height * params.width );
-      for( int i = 0; i < cam_width; i++ )
+      for( int j = 0; j < cam_height; j++ )
       {
-        for( int j = 0; j < cam_height; j++ )
+        const Vec2i* projPixels_row = projPixels.ptr<Vec2i>( j );
+        for( int i = 0; i < cam_width; i++ )
         {
-          //if the pixel is not shadowed, reconstruct
-          if( shadowMasks[k].at<uchar>( j, i ) )
+          if( projPixels_row[i][0] < 0 )
           {
-            //for a (x,y) pixel of the camera returns the corresponding projector pixel by calculating the decimal number
-            bool error = getProjPixel( acquired_pattern[k], i, j, projPixel );
-
-            if( error )
-            {
-              continue;
-            }
-
-            camsPixels[k][projPixel.x * params.height + projPixel.y].push_back( Point( i, j ) );
+            continue;
           }
+
+          camsPixels[k][projPixels_row[i][0] * params.height + projPixels_row[i][1]].push_back( Point( i, j ) );
         }
       }
     }
 
-    std::vector<Point> cam1Pixs, cam2Pixs;
-
     Mat& disparityMap_ = *( Mat* ) disparityMap.getObj();
     disparityMap_ = Mat( cam_height, cam_width, CV_64F, double( 0 ) );
 
@@ -266,8 +260,8 @@ bool GrayCodePattern_Impl::decode( InputArrayOfArrays patternImages, OutputArray
     {
       for( int j = 0; j < params.height; j++ )
       {
-        cam1Pixs = camsPixels[0][i * params.height + j];
-        cam2Pixs = camsPixels[1][i * params.height + j];
+        const std::vector<Point>& cam1Pixs = camsPixels[0][i * params.height + j];
+        const std::vector<Point>& cam2Pixs = camsPixels[1][i * params.height + j];
 
         if( cam1Pixs.size() == 0 || cam2Pixs.size() == 0 )
           continue;
@@ -324,41 +318,138 @@ size_t GrayCodePattern_Impl::getNumberOfPatternImages() const
   return numOfPatternImages;
 }
 
-// Computes the shadows occlusion where we cannot reconstruct the model
-void GrayCodePattern_Impl::computeShadowMasks( InputArrayOfArrays blackImages, InputArrayOfArrays whiteImages,
-                                               OutputArrayOfArrays shadowMasks ) const
+/* Decodes the rows of a camera, one bit plane at a time: for every pair of pattern images the gray bit of the
+ * whole row is computed, converted to binary by a running XOR and shifted into the projector coordinate.
+ * Pixels are valid if they are not shadowed and every pattern differs enough from its inverse.
+ */
+class GrayCodeDecodeInvoker : public ParallelLoopBody
 {
-  std::vector<Mat>& whiteImages_ = *( std::vector<Mat>* ) whiteImages.getObj();
-  std::vector<Mat>& blackImages_ = *( std::vector<Mat>* ) blackImages.getObj();
-  std::vector<Mat>& shadowMasks_ = *( std::vector<Mat>* ) shadowMasks.getObj();
+ public:
+  GrayCodeDecodeInvoker( const std::vector<Mat>& _patternImages, const Mat& _blackImage, const Mat& _whiteImage,
+                         int _numOfColImgs, int _numOfRowImgs, int _blackThreshold, int _whiteThreshold,
+                         Size _projSize, Mat& _projPixels ) :
+      patternImages( _patternImages ), blackImage( _blackImage ), whiteImage( _whiteImage ),
+      numOfColImgs( _numOfColImgs ), numOfRowImgs( _numOfRowImgs ), blackThreshold( _blackThreshold ),
+      whiteThreshold( _whiteThreshold ), projSize( _projSize ), projPixels( _projPixels )
+  {}
+
+  void operator()( const Range& range ) const
+  {
+    const int cols = projPixels.cols;
+    std::vector<uchar> valid( cols ), bits( cols );
+    std::vector<ushort> xDec( cols ), yDec( cols );
 
-  shadowMasks_.resize( whiteImages_.size() );
+    for( int y = range.start; y < range.end; y++ )
+    {
+      Vec2i* projPixels_row = projPixels.ptr<Vec2i>( y );
+
+      // a difference can not be bigger than the threshold, neither smaller than it
+      if( blackThreshold >= 255 || whiteThreshold > 255 )
+      {
+        for( int x = 0; x < cols; x++ )
+          projPixels_row[x] = Vec2i( -1, -1 );
+        continue;
+      }
+
+      computeShadowMask( y, &valid[0] );
+      decodeBits( y, 0, numOfColImgs, &valid[0], &bits[0], &xDec[0] );
+      decodeBits( y, 2 * numOfColImgs, numOfRowImgs, &valid[0], &bits[0], &yDec[0] );
 
-  int cam_width = whiteImages_[0].cols;
-  int cam_height = whiteImages_[0].rows;
+      for( int x = 0; x < cols; x++ )
+      {
+        if( valid[x] && xDec[x] < projSize.width && yDec[x] < projSize.height )
+          projPixels_row[x] = Vec2i( xDec[x], yDec[x] );
+        else
+          projPixels_row[x] = Vec2i( -1, -1 );
+      }
+    }
+  }
 
-  // TODO: parallelize for
-  for( int k = 0; k < (int) shadowMasks_.size(); k++ )
+ private:
+  // valid is set where the white and black images differ by more than blackThreshold
+  void computeShadowMask( int y, uchar* valid ) const
   {
-    shadowMasks_[k] = Mat( cam_height, cam_width, CV_8U );
-    for( int i = 0; i < cam_width; i++ )
+    const uchar* white = whiteImage.ptr<uchar>( y );
+    const uchar* black = blackImage.ptr<uchar>( y );
+    const int cols = projPixels.cols;
+    int x = 0;
+#if CV_SIMD128
+    const v_uint8x16 thresh = v_setall_u8( (uchar) blackThreshold );
+    for( ; x <= cols - 16; x += 16 )
+      v_store( valid + x, v_absdiff( v_load( white + x ), v_load( black + x ) ) > thresh );
+#endif
+    for( ; x < cols; x++ )
+      valid[x] = abs( white[x] - black[x] ) > blackThreshold ? (uchar) 255 : (uchar) 0;
+  }
+
+  // decodes count pairs of pattern images starting from first, invalidating the pixels without enough contrast
+  void decodeBits( int y, int first, int count, uchar* valid, uchar* bits, ushort* dec ) const
+  {
+    const int cols = projPixels.cols;
+    memset( bits, 0, cols * sizeof( bits[0] ) );
+    memset( dec, 0, cols * sizeof( dec[0] ) );
+
+    for( int k = 0; k < count; k++ )
     {
-      for( int j = 0; j < cam_height; j++ )
+      const uchar* pattern = patternImages[first + 2 * k].ptr<uchar>( y );
+      const uchar* inverse = patternImages[first + 2 * k + 1].ptr<uchar>( y );
+      int x = 0;
+#if CV_SIMD128
+      const v_uint8x16 thresh = v_setall_u8( (uchar) whiteThreshold ), one = v_setall_u8( 1 );
+      for( ; x <= cols - 16; x += 16 )
       {
-        double white = whiteImages_[k].at<uchar>( Point( i, j ) );
-        double black = blackImages_[k].at<uchar>( Point( i, j ) );
-
-        if( abs(white - black) > blackThreshold )
-        {
-          shadowMasks_[k].at<uchar>( Point( i, j ) ) = ( uchar ) 1;
-        }
-        else
-        {
-          shadowMasks_[k].at<uchar>( Point( i, j ) ) = ( uchar ) 0;
-        }
+        v_uint8x16 a = v_load( pattern + x ), b = v_load( inverse + x );
+        v_uint8x16 bin = v_load( bits + x ) ^ ( a > b );
+        v_store( bits + x, bin );
+        v_store( valid + x, v_load( valid + x ) & ( v_absdiff( a, b ) >= thresh ) );
+
+        v_uint16x8 lo, hi;
+        v_expand( bin & one, lo, hi );
+        v_store( dec + x, ( v_load( dec + x ) << 1 ) | lo );
+        v_store( dec + x + 8, ( v_load( dec + x + 8 ) << 1 ) | hi );
+      }
+#endif
+      for( ; x < cols; x++ )
+      {
+        bits[x] ^= pattern[x] > inverse[x] ? (uchar) 255 : (uchar) 0;
+        if( abs( pattern[x] - inverse[x] ) < whiteThreshold )
+          valid[x] = 0;
+        dec[x] = (ushort) ( ( dec[x] << 1 ) | ( bits[x] & 1 ) );
       }
     }
   }
+
+  const std::vector<Mat>& patternImages;
+  const Mat& blackImage;
+  const Mat& whiteImage;
+  int numOfColImgs, numOfRowImgs;
+  int blackThreshold, whiteThreshold;
+  Size projSize;
+  Mat& projPixels;
+
+  GrayCodeDecodeInvoker& operator=( const GrayCodeDecodeInvoker& );
+};
+
+// Decodes the projector pixels seen by a camera, the shadow mask is computed in the same pass
+void GrayCodePattern_Impl::decodeProjPixels( const std::vector<Mat>& patternImages, const Mat& blackImage,
+                                             const Mat& whiteImage, Mat& projPixels ) const
+{
+  CV_Assert( patternImages.size() == numOfPatternImages );
+  // the projector coordinates are accumulated in 16 bits
+  CV_Assert( numOfColImgs <= 16 && numOfRowImgs <= 16 );
+
+  const Size camSize = patternImages[0].size();
+  for( size_t i = 0; i < patternImages.size(); i++ )
+    CV_Assert( patternImages[i].type() == CV_8UC1 && patternImages[i].size() == camSize );
+  CV_Assert( blackImage.type() == CV_8UC1 && blackImage.size() == camSize );
+  CV_Assert( whiteImage.type() == CV_8UC1 && whiteImage.size() == camSize );
+
+  projPixels.create( camSize, CV_32SC2 );
+  parallel_for_( Range( 0, camSize.height ),
+                 GrayCodeDecodeInvoker( patternImages, blackImage, whiteImage, (int) numOfColImgs, (int) numOfRowImgs,
+                                        (int) std::min( blackThreshold, (size_t) 255 ),
+                                        (int) std::min( whiteThreshold, (size_t) 256 ),
+                                        Size( params.width, params.height ), projPixels ) );
 }
 
 // Generates the images needed for shadowMasks computation
@@ -41,6 +41,7 @@
 
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv {
 namespace structured_light {
@@ -119,6 +120,10 @@ private:
 
     Params params;
     phase_unwrapping::HistogramPhaseUnwrapping::Params unwrappingParams;
+    // Unwrapper kept between calls with the same camera size
+    Ptr<phase_unwrapping::HistogramPhaseUnwrapping> phaseUnwrapping;
+    // Padded real pattern given to the DFT, kept between calls with the same pattern size
+    Mat dftInput;
     // Class describing markers that are added to the patterns
     class Marker{
     private:
@@ -129,6 +134,132 @@ private:
         void drawMarker( OutputArray pattern );
     };
 };
+/* atan2 with a polynomial approximation of atan on [0, 1] (Abramowitz and Stegun 4.4.49), the error is below
+ * 1e-5 rad. atan2(0, 0) is 0, so masked pixels are given a zero numerator and denominator.
+ */
+static inline float fastAtan2Rad( float y, float x )
+{
+    const float ax = std::abs(x), ay = std::abs(y);
+    const float a = std::min(ax, ay) / (std::max(ax, ay) + FLT_MIN);
+    const float s = a * a;
+    float r = ((((0.0208351f * s - 0.0851330f) * s + 0.1801410f) * s - 0.3302995f) * s + 0.9998660f) * a;
+    if( ay > ax )
+        r = static_cast<float>(CV_PI / 2) - r;
+    if( x < 0 )
+        r = static_cast<float>(CV_PI) - r;
+    if( y < 0 )
+        r = -r;
+    return r;
+}
+
+static void fastAtan2Row( const float *y, const float *x, float *dst, int len )
+{
+    int j = 0;
+#if CV_SIMD128
+    const v_float32x4 zero = v_setzero_f32(), eps = v_setall_f32(FLT_MIN);
+    const v_float32x4 halfPi = v_setall_f32(static_cast<float>(CV_PI / 2)), pi = v_setall_f32(static_cast<float>(CV_PI));
+    const v_float32x4 c9 = v_setall_f32(0.0208351f), c7 = v_setall_f32(-0.0851330f), c5 = v_setall_f32(0.1801410f),
+                      c3 = v_setall_f32(-0.3302995f), c1 = v_setall_f32(0.9998660f);
+    for( ; j <= len - 4; j += 4 )
+    {
+        v_float32x4 vy = v_load(y + j), vx = v_load(x + j);
+        v_float32x4 ax = v_max(vx, zero - vx), ay = v_max(vy, zero - vy);
+        v_float32x4 a = v_min(ax, ay) / (v_max(ax, ay) + eps);
+        v_float32x4 s = a * a;
+        v_float32x4 r = ((((c9 * s + c7) * s + c5) * s + c3) * s + c1) * a;
+        r = v_select(ay > ax, halfPi - r, r);
+        r = v_select(vx < zero, pi - r, r);
+        r = v_select(vy < zero, zero - r, r);
+        v_store(dst + j, r);
+    }
+#endif
+    for( ; j < len; ++j )
+        dst[j] = fastAtan2Rad(y[j], x[j]);
+}
+
+/* Wrapped phase of the rows in range, computed as atan2(num, den) of terms depending on the method:
+ * FTP uses the complex filtered pattern, PSP the three filtered patterns and FAPS the patterns differences
+ * and the FTP phase shifts. Shadowed pixels get a phase of 0.
+ */
+class WrappedPhaseInvoker : public ParallelLoopBody
+{
+public:
+    WrappedPhaseInvoker( int _methodId, const std::vector<Mat> &_inputs, float _shiftValue, const Mat &_shadowMask,
+                         Mat &_wrappedPhaseMap ) :
+        methodId(_methodId), inputs(_inputs), shiftValue(_shiftValue), shadowMask(_shadowMask),
+        wrappedPhaseMap(_wrappedPhaseMap)
+    {}
+
+    void operator()( const Range &range ) const
+    {
+        const int cols = wrappedPhaseMap.cols;
+        std::vector<float> numBuf(cols), denBuf(cols);
+        float *num = &numBuf[0], *den = &denBuf[0];
+        const float numCoeff = 1 - std::cos(shiftValue), denCoeff = std::sin(shiftValue);
+
+        for( int i = range.start; i < range.end; ++i )
+        {
+            const uchar *mask = shadowMask.ptr<uchar>(i);
+            if( methodId == FTP )
+            {
+                const Vec2f *c = inputs[0].ptr<Vec2f>(i);
+                for( int j = 0; j < cols; ++j )
+                {
+                    num[j] = mask[j] ? c[j][0] : 0.f;
+                    den[j] = mask[j] ? c[j][1] : 0.f;
+                }
+            }
+            else if( methodId == PSP )
+            {
+                for( int j = 0; j < cols; ++j )
+                {
+                    float i1 = 0, i2 = 0, i3 = 0;
+                    if( mask[j] )
+                    {
+                        i1 = value(0, i, j);
+                        i2 = value(1, i, j);
+                        i3 = value(2, i, j);
+                    }
+                    num[j] = numCoeff * (i3 - i2);
+                    den[j] = denCoeff * (2 * i1 - i2 - i3);
+                }
+            }
+            else
+            {
+                const float *a = inputs[0].ptr<float>(i), *b = inputs[1].ptr<float>(i);
+                const float *theta1 = inputs[2].ptr<float>(i), *theta2 = inputs[3].ptr<float>(i);
+                for( int j = 0; j < cols; ++j )
+                {
+                    if( mask[j] )
+                    {
+                        num[j] = (1 - std::cos(theta2[j])) * a[j] + (1 - std::cos(theta1[j])) * b[j];
+                        den[j] = std::sin(theta1[j]) * b[j] - std::sin(theta2[j]) * a[j];
+                    }
+                    else
+                        num[j] = den[j] = 0.f;
+                }
+            }
+            fastAtan2Row(num, den, wrappedPhaseMap.ptr<float>(i), cols);
+        }
+    }
+
+private:
+    float value( int k, int i, int j ) const
+    {
+        if( inputs[k].type() == CV_8UC1 )
+            return inputs[k].at<uchar>(i, j);
+        return inputs[k].at<float>(i, j);
+    }
+
+    int methodId;
+    const std::vector<Mat> &inputs;
+    float shiftValue;
+    const Mat &shadowMask;
+    Mat &wrappedPhaseMap;
+
+    WrappedPhaseInvoker& operator=(const WrappedPhaseInvoker&);
+};
+
 // Default parameters value
 SinusoidalPattern::Params::Params()
 {
@@ -395,28 +526,28 @@ void SinusoidalPatternProfilometry_Impl::unwrapPhaseMap( InputArray wrappedPhase
                                                          cv::Size camSize,
                                                          InputArray shadowMask )
 {
-    int rows = params.height;
-    int cols = params.width;
-    unwrappingParams.width = camSize.width;
-    unwrappingParams.height = camSize.height;
-
     Mat &wPhaseMap = *(Mat*) wrappedPhaseMap.getObj();
     Mat &uPhaseMap = *(Mat*) unwrappedPhaseMap.getObj();
     Mat mask;
 
     if( shadowMask.empty() )
     {
-        mask.create(rows, cols, CV_8UC1);
+        mask.create(camSize.height, camSize.width, CV_8UC1);
         mask = Scalar::all(255);
     }
     else
     {
-        Mat &temp = *(Mat*) shadowMask.getObj();
-        temp.copyTo(mask);
+        // the unwrapper copies what it needs, the mask is given as is
+        mask = *(Mat*) shadowMask.getObj();
     }
 
-    Ptr<phase_unwrapping::HistogramPhaseUnwrapping> phaseUnwrapping =
-            phase_unwrapping::HistogramPhaseUnwrapping::create(unwrappingParams);
+    if( phaseUnwrapping.empty() || unwrappingParams.width != camSize.width ||
+        unwrappingParams.height != camSize.height )
+    {
+        unwrappingParams.width = camSize.width;
+        unwrappingParams.height = camSize.height;
+        phaseUnwrapping = phase_unwrapping::HistogramPhaseUnwrapping::create(unwrappingParams);
+    }
 
     phaseUnwrapping->unwrapPhaseMap(wPhaseMap, uPhaseMap, mask);
 }
@@ -435,14 +566,16 @@ void SinusoidalPatternProfilometry_Impl::computeDft( InputArray patternImage,
 {
     Mat &pattern_ = *(Mat*) patternImage.getObj();
     Mat &FourierTransform_ = *(Mat*) FourierTransform.getObj();
-    Mat padded;
     int m = getOptimalDFTSize(pattern_.rows);
     int n = getOptimalDFTSize(pattern_.cols);
-    copyMakeBorder(pattern_, padded, 0, m - pattern_.rows, 0, n - pattern_.cols, BORDER_CONSTANT,
-                   Scalar::all(0));
-    Mat planes[] = {Mat_<float>(padded), Mat::zeros(padded.size(), CV_32F)};
-    merge(planes, 2, FourierTransform_);
-    dft(FourierTransform_, FourierTransform_);
+    // The padded input is reused for patterns of the same size. The real DFT gives the same full complex
+    // spectrum as the complex DFT of the pattern with a zero imaginary part.
+    dftInput.create(m, n, CV_32FC1);
+    if( m != pattern_.rows || n != pattern_.cols )
+        dftInput = Scalar::all(0);
+    Mat roi = dftInput(Rect(0, 0, pattern_.cols, pattern_.rows));
+    pattern_.convertTo(roi, CV_32F);
+    dft(dftInput, FourierTransform_, DFT_COMPLEX_OUTPUT, pattern_.rows);
 }
 
 void SinusoidalPatternProfilometry_Impl::computeInverseDft( InputArray FourierTransform,
@@ -481,32 +614,15 @@ void SinusoidalPatternProfilometry_Impl::computeFtPhaseMap( InputArray inverseFo
     Mat &inverseFourierTransform_ = *(Mat*) inverseFourierTransform.getObj();
     Mat &wrappedPhaseMap_ = *(Mat*) wrappedPhaseMap.getObj();
     Mat &shadowMask_ = *(Mat*) shadowMask.getObj();
-    Mat planes[2];
 
     int rows = inverseFourierTransform_.rows;
     int cols = inverseFourierTransform_.cols;
 
-    if( wrappedPhaseMap_.empty () )
-        wrappedPhaseMap_.create(rows, cols, CV_32FC1);
-
-    split(inverseFourierTransform_, planes);
+    wrappedPhaseMap_.create(rows, cols, CV_32FC1);
 
-    for( int i = 0; i < rows; ++i )
-    {
-        for( int j = 0; j < cols; ++j )
-        {
-            if( shadowMask_.at<uchar>(i, j) != 0 )
-            {
-                float im = planes[1].at<float>(i, j);
-                float re = planes[0].at<float>(i, j);
-                wrappedPhaseMap_.at<float>(i, j) = atan2(re, im);
-            }
-            else
-            {
-                wrappedPhaseMap_.at<float>(i, j) = 0;
-            }
-        }
-    }
+    std::vector<Mat> inputs(1, inverseFourierTransform_);
+    parallel_for_(Range(0, rows), WrappedPhaseInvoker(FTP, inputs, params.shiftValue, shadowMask_,
+                                                      wrappedPhaseMap_));
 }
 void SinusoidalPatternProfilometry_Impl::swapQuadrants( InputOutputArray image,
                                                        int centerX, int centerY )
@@ -539,27 +655,29 @@ void SinusoidalPatternProfilometry_Impl::frequencyFiltering( InputOutputArray Fo
     int type = FourierTransform_.type();
     if( keepInsideRegion )
     {
-        Mat maskedTransform(rows, cols, type);
-        maskedTransform = Scalar::all(0);
-        Mat roi1 = FourierTransform_(
-                Rect(centerY1 - halfRegionHeight, centerX1 - halfRegionWidth,
-                    2 * halfRegionHeight, 2 * halfRegionWidth));
-        Mat dstRoi1 = maskedTransform(
-                Rect(centerY1 - halfRegionHeight, centerX1 - halfRegionWidth,
-                    2 * halfRegionHeight, 2 * halfRegionWidth));
-        roi1.copyTo(dstRoi1);
-
+        // The band-pass filter is applied in place: everything outside the region(s) is set to 0
+        CV_Assert( type == CV_32FC2 );
+        Rect region1(centerY1 - halfRegionHeight, centerX1 - halfRegionWidth,
+                     2 * halfRegionHeight, 2 * halfRegionWidth);
+        Rect region2;
         if( centerY2 != -1 || centerX2 != -1 )
+            region2 = Rect(centerY2 - halfRegionHeight, centerX2 - halfRegionWidth,
+                           2 * halfRegionHeight, 2 * halfRegionWidth);
+        region1 &= Rect(0, 0, cols, rows);
+        region2 &= Rect(0, 0, cols, rows);
+
+        for( int i = 0; i < rows; ++i )
         {
-            Mat roi2 = FourierTransform_(
-                    Rect(centerY2 - halfRegionHeight, centerX2 - halfRegionWidth,
-                        2 * halfRegionHeight, 2 * halfRegionWidth));
-            Mat dstRoi2 = maskedTransform(
-                    Rect(centerY2 - halfRegionHeight, centerX2 - halfRegionWidth,
-                        2 * halfRegionHeight, 2 * halfRegionWidth));
-            roi2.copyTo(dstRoi2);
+            Vec2f *row = FourierTransform_.ptr<Vec2f>(i);
+            bool inside1 = i >= region1.y && i < region1.y + region1.height;
+            bool inside2 = i >= region2.y && i < region2.y + region2.height;
+            for( int j = 0; j < cols; ++j )
+            {
+                if( !(inside1 && j >= region1.x && j < region1.x + region1.width) &&
+                    !(inside2 && j >= region2.x && j < region2.x + region2.width) )
+                    row[j] = Vec2f(0, 0);
+            }
         }
-        FourierTransform_ = maskedTransform;
     }
     else
     {
@@ -636,42 +754,12 @@ void SinusoidalPatternProfilometry_Impl::computePsPhaseMap( InputArrayOfArrays p
 
     int rows = pattern_[0].rows;
     int cols = pattern_[0].cols;
+    CV_Assert( pattern_.size() >= 3 && (pattern_[0].type() == CV_8UC1 || pattern_[0].type() == CV_32FC1) );
 
-    float i1 = 0;
-    float i2 = 0;
-    float i3 = 0;
-
-    if( wrappedPhaseMap_.empty() )
-        wrappedPhaseMap_.create(rows, cols, CV_32FC1);
+    wrappedPhaseMap_.create(rows, cols, CV_32FC1);
 
-    for( int i = 0; i < rows; ++i )
-    {
-        for( int j = 0; j < cols; ++j )
-        {
-            if( shadowMask_.at<uchar>(i, j) != 0 )
-            {
-                if( pattern_[0].type() == CV_8UC1 )
-                {
-                    i1 = pattern_[0].at<uchar>(i, j);
-                    i2 = pattern_[1].at<uchar>(i, j);
-                    i3 = pattern_[2].at<uchar>(i, j);
-                }
-                else if( pattern_[0].type() == CV_32FC1 )
-                {
-                    i1 = pattern_[0].at<float>(i, j);
-                    i2 = pattern_[1].at<float>(i, j);
-                    i3 = pattern_[2].at<float>(i, j);
-                }
-                float num = (1- cos(params.shiftValue)) * (i3 - i2);
-                float den = sin(params.shiftValue) * (2 * i1 - i2 - i3);
-                wrappedPhaseMap_.at<float>(i,j) = atan2(num, den);
-            }
-            else
-            {
-                wrappedPhaseMap_.at<float>(i,j) = 0;
-            }
-        }
-    }
+    parallel_for_(Range(0, rows), WrappedPhaseInvoker(PSP, pattern_, params.shiftValue, shadowMask_,
+                                                      wrappedPhaseMap_));
 }
 
 void SinusoidalPatternProfilometry_Impl::computeFapsPhaseMap( InputArray a,
@@ -691,29 +779,15 @@ void SinusoidalPatternProfilometry_Impl::computeFapsPhaseMap( InputArray a,
     int rows = a_.rows;
     int cols = a_.cols;
 
-    if( wrappedPhaseMap_.empty() )
-        wrappedPhaseMap_.create(rows, cols, CV_32FC1);
+    wrappedPhaseMap_.create(rows, cols, CV_32FC1);
 
-    for( int i = 0; i < rows; ++i )
-    {
-        for( int j = 0; j < cols; ++j )
-        {
-            if( shadowMask_.at<uchar>(i, j ) != 0 )
-            {
-                float num = (1 - cos(theta2_.at<float>(i, j))) * a_.at<float>(i, j) +
-                            (1 - cos(theta1_.at<float>(i, j))) * b_.at<float>(i, j);
-
-                float den = sin(theta1_.at<float>(i, j)) * b_.at<float>(i, j) -
-                            sin(theta2_.at<float>(i, j)) * a_.at<float>(i, j);
-
-                wrappedPhaseMap_.at<float>(i, j) = atan2(num, den);
-            }
-            else
-            {
-                wrappedPhaseMap_.at<float>(i, j) = 0;
-            }
-        }
-    }
+    std::vector<Mat> inputs(4);
+    inputs[0] = a_;
+    inputs[1] = b_;
+    inputs[2] = theta1_;
+    inputs[3] = theta2_;
+    parallel_for_(Range(0, rows), WrappedPhaseInvoker(FAPS, inputs, params.shiftValue, shadowMask_,
+                                                      wrappedPhaseMap_));
 }
 
 //compute shadow mask from three patterns. Valid pixels are lit at least by one pattern
@@ -722,26 +796,21 @@ void SinusoidalPatternProfilometry_Impl::computeShadowMask( InputArrayOfArrays p
 {
     std::vector<Mat> &patternImages_ = *(std::vector<Mat>*) patternImages.getObj();
     Mat &shadowMask_ = *(Mat*) shadowMask.getObj();
-    Mat mean;
     int rows = patternImages_[0].rows;
     int cols = patternImages_[0].cols;
-    float i1, i2, i3;
 
-    mean.create(rows, cols, CV_32FC1);
+    shadowMask_.create(rows, cols, CV_8UC1);
 
+    // the rounded mean of the three patterns is above 10 if their sum is at least 32
     for( int i = 0; i < rows; ++i )
     {
+        const uchar *p1 = patternImages_[0].ptr<uchar>(i);
+        const uchar *p2 = patternImages_[1].ptr<uchar>(i);
+        const uchar *p3 = patternImages_[2].ptr<uchar>(i);
+        uchar *mask = shadowMask_.ptr<uchar>(i);
         for( int j = 0; j < cols; ++j )
-        {
-            i1 = (float) patternImages_[0].at<uchar>(i, j);
-            i2 = (float) patternImages_[1].at<uchar>(i, j);
-            i3 = (float) patternImages_[2].at<uchar>(i, j);
-            mean.at<float>(i, j) = (i1 + i2 + i3) / 3;
-        }
+            mask[j] = p1[j] + p2[j] + p3[j] >= 32 ? (uchar) 255 : (uchar) 0;
     }
-    mean.convertTo(mean, CV_8UC1);
-    threshold(mean, shadowMask_, 10, 255, 0);
-
 }
 // Compute the data modulation term according to the formula given in the reference paper
 void SinusoidalPatternProfilometry_Impl::computeDataModulationTerm( InputArrayOfArrays patternImages,
@@ -98,3 +98,41 @@ TEST( GrayCodePattern, getProjPixel )
   CV_GetProjPixelTest test;
   test.safe_run();
 }
+
+TEST( GrayCodePattern, decodeShiftedCameras )
+{
+  structured_light::GrayCodePattern::Params params;
+  params.width = 100;
+  params.height = 40;
+  Ptr<structured_light::GrayCodePattern> graycode = structured_light::GrayCodePattern::create( params );
+
+  vector<Mat> pattern;
+  graycode->generate( pattern );
+
+  // the second camera sees the projector shifted by a few columns, its first columns are not lit
+  const int shift = 3;
+  vector<vector<Mat> > captured( 2 );
+  captured[0] = pattern;
+  for( size_t i = 0; i < pattern.size(); i++ )
+  {
+    Mat shifted( pattern[i].size(), CV_8U, Scalar( 0 ) );
+    pattern[i].colRange( 0, params.width - shift ).copyTo( shifted.colRange( shift, params.width ) );
+    captured[1].push_back( shifted );
+  }
+
+  vector<Mat> blackImages( 2 ), whiteImages( 2 );
+  graycode->getImagesForShadowMasks( blackImages[0], whiteImages[0] );
+  graycode->getImagesForShadowMasks( blackImages[1], whiteImages[1] );
+  whiteImages[1].colRange( 0, shift ).setTo( 0 );
+
+  Mat disparityMap;
+  ASSERT_TRUE( graycode->decode( captured, disparityMap, blackImages, whiteImages ) );
+  ASSERT_EQ( CV_64F, disparityMap.type() );
+  for( int y = 0; y < params.height; y++ )
+  {
+    for( int x = 0; x < params.width; x++ )
+    {
+      EXPECT_EQ( x < params.width - shift ? shift : 0, disparityMap.at<double>( y, x ) ) << x << " " << y;
+    }
+  }
+}
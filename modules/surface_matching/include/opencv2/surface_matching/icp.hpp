@@ -148,6 +148,7 @@ public:
      *  \return On successful termination, the function returns 0.
      *
      *  \details It is assumed that the model is registered on the scene. Scene remains static, while the model transforms. The output poses transform the models onto the scene. Because of the point to plane minimization, the scene is expected to have the normals available. Expected to have the normals (Nx6).
+     *  The scene is sampled and indexed once for all the poses, which are then refined in parallel.
      */
   int registerModelToScene(const Mat& srcPC, const Mat& dstPC, std::vector<Pose3DPtr>& poses);
 
@@ -74,7 +74,8 @@ namespace ppf_match_3d
 //! @{
 
 /**
-  * @brief Struct, holding a node in the hashtable
+  * @brief Struct, holding a node in the hashtable: the key of the point pair feature,
+  * the index of the reference point and the index of the point pair feature
   */
 typedef struct THash
 {
@@ -140,7 +141,14 @@ public:
     */
   void match(const Mat& scene, std::vector<Pose3DPtr> &results, const double relativeSceneSampleStep=1.0/5.0, const double relativeSceneDistance=0.03);
 
+  /**
+    *  \brief Loads a model trained and saved by write, the instance is then ready for calling "match".
+    */
   void read(const FileNode& fn);
+
+  /**
+    *  \brief Saves the parameters and the trained model, including the hashtable of the point pair features.
+    */
   void write(FileStorage& fs) const;
 
 protected:
@@ -149,8 +157,12 @@ protected:
   double sampling_step_relative, angle_step_relative, distance_step_relative;
   Mat sampled_pc, ppf;
   int num_ref_points;
-  hashtable_int* hash_table;
-  THash* hash_nodes;
+
+  // Flat hashtable of the model point pair features, in a CSR layout: the nodes falling
+  // in bucket b are hash_nodes[hash_bucket_offsets[b] .. hash_bucket_offsets[b+1]), sorted by key.
+  // The number of buckets is a power of two.
+  std::vector<int> hash_bucket_offsets;
+  std::vector<THash> hash_nodes;
 
   double position_threshold, rotation_threshold;
   bool use_weighted_avg;
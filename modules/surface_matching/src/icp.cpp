@@ -276,110 +276,156 @@ static void getTransformMat(Mat X, double Pose[16])
   Pose[15]=1;
 }
 
-/* Fast way to look up the duplicates
-duplicates is pre-allocated
-make sure that the max element in array will not exceed maxElement
-*/
-static hashtable_int* getHashtable(int* data, size_t length, int numMaxElement)
+// compute the sum of the distances to a point
+static double computeDistToPoint(Mat srcPC, const double point[3])
 {
-  hashtable_int* hashtable = hashtableCreate(static_cast<size_t>(numMaxElement*2), 0);
-  for (size_t i = 0; i < length; i++)
+  int height = srcPC.rows;
+  double dist = 0;
+
+  for (int i=0; i<height; i++)
   {
-    const KeyType key = (KeyType)data[i];
-    hashtableInsertHashed(hashtable, key+1, reinterpret_cast<void*>(i+1));
+    const float *row = srcPC.ptr<float>(i);
+    const float d[3] = {row[0]-(float)point[0], row[1]-(float)point[1], row[2]-(float)point[2]};
+    dist += sqrt(d[0]*d[0]+d[1]*d[1]+d[2]*d[2]);
   }
 
-  return hashtable;
+  return dist;
 }
 
+/* The scene sampled and indexed for every level of the pyramid. The sampling only depends on the
+number of model points, so the index can be shared by the registrations of the hypotheses of a model.
+The scene is indexed in its own coordinates: the normalization of a registration is a similarity,
+which does not change the nearest neighbors.
+*/
+class ICPSceneIndex
+{
+public:
+  ICPSceneIndex(const Mat& dstPC, int numModelPoints, int numLevels) : pc(dstPC)
+  {
+    computeMeanCols(pc, mean);
+
+    sampled.resize(numLevels);
+    flann.resize(numLevels, 0);
+    for (int level = 0; level < numLevels; level++)
+    {
+      const int sampleStep = getSampleStep(numModelPoints, level);
+      sampled[level] = samplePCUniform(pc, sampleStep);
+      flann[level] = indexPCFlann(sampled[level]);
+    }
+  }
+
+  ~ICPSceneIndex()
+  {
+    for (size_t level = 0; level < flann.size(); level++)
+      destroyFlann(flann[level]);
+  }
+
+  static int getSampleStep(int numModelPoints, int level)
+  {
+    const double impact = 2;
+    double div = pow((double)impact, (double)level);
+    const int numSamples = cvRound((double)(numModelPoints/(div)));
+    return cvRound((double)numModelPoints/(double)numSamples);
+  }
+
+  Mat pc;
+  double mean[3];
+  std::vector<Mat> sampled;
+  std::vector<void*> flann;
+
+private:
+  ICPSceneIndex(const ICPSceneIndex&);
+  ICPSceneIndex& operator=(const ICPSceneIndex&);
+};
+
 // source point clouds are assumed to contain their normals
-int ICP::registerModelToScene(const Mat& srcPC, const Mat& dstPC, double& residual, Matx44d& pose)
+static void registerModelToSceneIndex(const Mat& srcPC, const ICPSceneIndex& scene, const float tolerance,
+                                      const int maxIterations, const float rejectionScale, const int numLevels,
+                                      double& residual, Matx44d& pose)
 {
   int n = srcPC.rows;
 
-  const bool useRobustReject = m_rejectionScale>0;
+  const bool useRobustReject = rejectionScale>0;
 
   Mat srcTemp = srcPC.clone();
-  Mat dstTemp = dstPC.clone();
-  double meanSrc[3], meanDst[3];
+  double meanSrc[3];
   computeMeanCols(srcTemp, meanSrc);
-  computeMeanCols(dstTemp, meanDst);
+  const double* meanDst = scene.mean;
   double meanAvg[3]={0.5*(meanSrc[0]+meanDst[0]), 0.5*(meanSrc[1]+meanDst[1]), 0.5*(meanSrc[2]+meanDst[2])};
   subtractColumns(srcTemp, meanAvg);
-  subtractColumns(dstTemp, meanAvg);
 
   double distSrc = computeDistToOrigin(srcTemp);
-  double distDst = computeDistToOrigin(dstTemp);
+  double distDst = computeDistToPoint(scene.pc, meanAvg);
 
   double scale = (double)n / ((distSrc + distDst)*0.5);
 
   srcTemp(cv::Range(0, srcTemp.rows), cv::Range(0,3)) *= scale;
-  dstTemp(cv::Range(0, dstTemp.rows), cv::Range(0,3)) *= scale;
 
   Mat srcPC0 = srcTemp;
-  Mat dstPC0 = dstTemp;
 
   // initialize pose
   matrixIdentity(4, pose.val);
 
-  Mat M = Mat::eye(4,4,CV_64F);
-
   double tempResidual = 0;
 
+  // The buffers are allocated once for all the levels, the finest level having the most points
+  Mat queriesBuf(n, 3, CV_32F), indicesBuf(n, 1, CV_32S), distancesBuf(n, 1, CV_32F);
+  Mat srcMatchBuf(n, srcPC.cols, CV_64F), dstMatchBuf(n, srcPC.cols, CV_64F);
+  std::vector<int> newI(n), newJ(n), indicesModel(n), indicesScene(n), closestModel;
 
   // walk the pyramid
-  for (int level = m_numLevels-1; level >=0; level--)
+  for (int level = numLevels-1; level >=0; level--)
   {
-    const double impact = 2;
-    double div = pow((double)impact, (double)level);
-    //double div2 = div*div;
-    const int numSamples = cvRound((double)(n/(div)));
-    const double TolP = m_tolerance*(double)(level+1)*(level+1);
-    const int MaxIterationsPyr = cvRound((double)m_maxIterations/(level+1));
+    const double TolP = tolerance*(double)(level+1)*(level+1);
+    const int MaxIterationsPyr = cvRound((double)maxIterations/(level+1));
 
     // Obtain the sampled point clouds for this level: Also rotates the normals
     Mat srcPCT = transformPCPose(srcPC0, pose.val);
 
-    const int sampleStep = cvRound((double)n/(double)numSamples);
+    const int sampleStep = ICPSceneIndex::getSampleStep(n, level);
 
     srcPCT = samplePCUniform(srcPCT, sampleStep);
     /*
     Tolga Birdal thinks that downsampling the scene points might decrease the accuracy.
     Hamdi Sahloul, however, noticed that accuracy increased (pose residual decreased slightly).
     */
-    Mat dstPCS = samplePCUniform(dstPC0, sampleStep);
-    void* flann = indexPCFlann(dstPCS);
+    const Mat& dstPCS = scene.sampled[level];
+    void* flann = scene.flann[level];
 
     double fval_old=9999999999;
     double fval_perc=0;
     double fval_min=9999999999;
-    Mat Src_Moved = srcPCT.clone();
 
     int i=0;
 
-    size_t numElSrc = (size_t)Src_Moved.rows;
-    int sizesResult[2] = {(int)numElSrc, 1};
-    float* distances = new float[numElSrc];
-    int* indices = new int[numElSrc];
-
-    Mat Indices(2, sizesResult, CV_32S, indices, 0);
-    Mat Distances(2, sizesResult, CV_32F, distances, 0);
-
-    // use robust weighting for outlier treatment
-    int* indicesModel = new int[numElSrc];
-    int* indicesScene = new int[numElSrc];
-
-    int* newI = new int[numElSrc];
-    int* newJ = new int[numElSrc];
+    const int numElSrc = srcPCT.rows;
+    Mat Queries = queriesBuf.rowRange(0, numElSrc);
+    Mat Indices = indicesBuf.rowRange(0, numElSrc);
+    Mat Distances = distancesBuf.rowRange(0, numElSrc);
+    const int* indices = Indices.ptr<int>();
+    float* distances = Distances.ptr<float>();
 
     double PoseX[16]={0};
     matrixIdentity(4, PoseX);
 
     while ( (!(fval_perc<(1+TolP) && fval_perc>(1-TolP))) && i<MaxIterationsPyr)
     {
-      uint di=0, selInd = 0;
+      int di=0, selInd = 0, numCorr = numElSrc;
+
+      // Move the model points and bring them to the scene coordinates to query the index.
+      // The squared distances are in the scene units, the comparisons below do not depend on the scale.
+      for (di=0; di<numElSrc; di++)
+      {
+        const float *srcPt = srcPCT.ptr<float>(di);
+        float *query = Queries.ptr<float>(di);
+        for (int ci=0; ci<3; ci++)
+        {
+          const double moved = PoseX[ci*4]*srcPt[0] + PoseX[ci*4+1]*srcPt[1] + PoseX[ci*4+2]*srcPt[2] + PoseX[ci*4+3];
+          query[ci] = (float)(moved/scale + meanAvg[ci]);
+        }
+      }
 
-      queryPCFlann(flann, Src_Moved, Indices, Distances);
+      queryPCFlann(flann, Queries, Indices, Distances);
 
       for (di=0; di<numElSrc; di++)
       {
@@ -390,68 +436,47 @@ int ICP::registerModelToScene(const Mat& srcPC, const Mat& dstPC, double& residu
       if (useRobustReject)
       {
         int numInliers = 0;
-        float threshold = getRejectionThreshold(distances, Distances.rows, m_rejectionScale);
-        Mat acceptInd = Distances<threshold;
+        float threshold = getRejectionThreshold(distances, numElSrc, rejectionScale);
 
-        uchar *accPtr = (uchar*)acceptInd.data;
-        for (int l=0; l<acceptInd.rows; l++)
+        for (int l=0; l<numElSrc; l++)
         {
-          if (accPtr[l])
+          if (distances[l] < threshold)
           {
             newI[numInliers] = l;
             newJ[numInliers] = indices[l];
             numInliers++;
           }
         }
-        numElSrc=numInliers;
+        numCorr=numInliers;
       }
 
       // Step 2: Picky ICP
       // Among the resulting corresponding pairs, if more than one scene point p_i
       // is assigned to the same model point m_j, then select p_i that corresponds
       // to the minimum distance
-
-      hashtable_int* duplicateTable = getHashtable(newJ, numElSrc, dstPCS.rows);
-
-      for (di=0; di<duplicateTable->size; di++)
+      closestModel.assign(dstPCS.rows, -1);
+      for (di=0; di<numCorr; di++)
       {
-        hashnode_i *node = duplicateTable->nodes[di];
+        int& closest = closestModel[newJ[di]];
+        if (closest < 0 || distances[newI[di]] <= distances[newI[closest]])
+          closest = di;
+      }
 
-        if (node)
+      for (int dup=0; dup<dstPCS.rows; dup++)
+      {
+        if (closestModel[dup] >= 0)
         {
-          // select the first node
-          size_t idx = reinterpret_cast<size_t>(node->data)-1, dn=0;
-          int dup = (int)node->key-1;
-          size_t minIdxD = idx;
-          float minDist = distances[idx];
-
-          while ( node )
-          {
-            idx = reinterpret_cast<size_t>(node->data)-1;
-
-            if (distances[idx] < minDist)
-            {
-              minDist = distances[idx];
-              minIdxD = idx;
-            }
-
-            node = node->next;
-            dn++;
-          }
-
-          indicesModel[ selInd ] = newI[ minIdxD ];
+          indicesModel[ selInd ] = newI[ closestModel[dup] ];
           indicesScene[ selInd ] = dup ;
           selInd++;
         }
       }
 
-      hashtableDestroy(duplicateTable);
-
       if (selInd >= 6)
       {
 
-        Mat Src_Match = Mat(selInd, srcPCT.cols, CV_64F);
-        Mat Dst_Match = Mat(selInd, srcPCT.cols, CV_64F);
+        Mat Src_Match = srcMatchBuf.rowRange(0, selInd);
+        Mat Dst_Match = dstMatchBuf.rowRange(0, selInd);
 
         for (di=0; di<selInd; di++)
         {
@@ -464,19 +489,21 @@ int ICP::registerModelToScene(const Mat& srcPC, const Mat& dstPC, double& residu
           int ci=0;
 
           for (ci=0; ci<srcPCT.cols; ci++)
-          {
             srcMatchPt[ci] = (double)srcPt[ci];
+
+          // the scene point in the normalized coordinates
+          for (ci=0; ci<3; ci++)
+            dstMatchPt[ci] = ((double)dstPt[ci] - meanAvg[ci])*scale;
+          for ( ; ci<srcPCT.cols; ci++)
             dstMatchPt[ci] = (double)dstPt[ci];
-          }
         }
 
         Mat X;
         minimizePointToPlaneMetric(Src_Match, Dst_Match, X);
 
         getTransformMat(X, PoseX);
-        Src_Moved = transformPCPose(srcPCT, PoseX);
 
-        double fval = cv::norm(Src_Match, Dst_Match)/(double)(Src_Moved.rows);
+        double fval = cv::norm(Src_Match, Dst_Match)/(double)(srcPCT.rows);
 
         // Calculate change in error between iterations
         fval_perc=fval/fval_old;
@@ -503,15 +530,7 @@ int ICP::registerModelToScene(const Mat& srcPC, const Mat& dstPC, double& residu
 
     residual = tempResidual;
 
-    delete[] newI;
-    delete[] newJ;
-    delete[] indicesModel;
-    delete[] indicesScene;
-    delete[] distances;
-    delete[] indices;
-
     tempResidual = fval_min;
-    destroyFlann(flann);
   }
 
   // Pose(1:3, 4) = Pose(1:3, 4)./scale;
@@ -528,23 +547,59 @@ int ICP::registerModelToScene(const Mat& srcPC, const Mat& dstPC, double& residu
   pose.val[11] -= Cpose[2];
 
   residual = tempResidual;
+}
+
+// Refines the hypotheses against the same scene index
+class ICPRegisterPosesBody : public ParallelLoopBody
+{
+public:
+  ICPRegisterPosesBody(const Mat& srcPC, const ICPSceneIndex& scene, float tolerance, int maxIterations,
+                       float rejectionScale, int numLevels, std::vector<Pose3DPtr>& poses)
+    : srcPC_(srcPC), scene_(scene), tolerance_(tolerance), maxIterations_(maxIterations),
+      rejectionScale_(rejectionScale), numLevels_(numLevels), poses_(poses)
+  {
+  }
 
+  void operator()(const Range& range) const
+  {
+    for (int i = range.start; i < range.end; i++)
+    {
+      Matx44d poseICP = Matx44d::eye();
+      Mat srcTemp = transformPCPose(srcPC_, poses_[i]->pose);
+      registerModelToSceneIndex(srcTemp, scene_, tolerance_, maxIterations_, rejectionScale_, numLevels_,
+                                poses_[i]->residual, poseICP);
+      poses_[i]->appendPose(poseICP.val);
+    }
+  }
+
+private:
+  const Mat& srcPC_;
+  const ICPSceneIndex& scene_;
+  float tolerance_;
+  int maxIterations_;
+  float rejectionScale_;
+  int numLevels_;
+  std::vector<Pose3DPtr>& poses_;
+
+  ICPRegisterPosesBody& operator=(const ICPRegisterPosesBody&);
+};
+
+// source point clouds are assumed to contain their normals
+int ICP::registerModelToScene(const Mat& srcPC, const Mat& dstPC, double& residual, Matx44d& pose)
+{
+  ICPSceneIndex scene(dstPC, srcPC.rows, m_numLevels);
+  registerModelToSceneIndex(srcPC, scene, m_tolerance, m_maxIterations, m_rejectionScale, m_numLevels,
+                            residual, pose);
   return 0;
 }
 
 // source point clouds are assumed to contain their normals
 int ICP::registerModelToScene(const Mat& srcPC, const Mat& dstPC, std::vector<Pose3DPtr>& poses)
 {
-  #if defined _OPENMP
-  #pragma omp parallel for
-  #endif
-  for (int i=0; i<(int)poses.size(); i++)
-  {
-    Matx44d poseICP = Matx44d::eye();
-    Mat srcTemp = transformPCPose(srcPC, poses[i]->pose);
-    registerModelToScene(srcTemp, dstPC, poses[i]->residual, poseICP);
-    poses[i]->appendPose(poseICP.val);
-  }
+  // the scene is sampled and indexed once for all the hypotheses
+  ICPSceneIndex scene(dstPC, srcPC.rows, m_numLevels);
+  parallel_for_(Range(0, (int)poses.size()),
+                ICPRegisterPosesBody(srcPC, scene, m_tolerance, m_maxIterations, m_rejectionScale, m_numLevels, poses));
   return 0;
 }
 
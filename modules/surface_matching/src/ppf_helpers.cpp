@@ -270,63 +270,95 @@ void queryPCFlann(void* flannIndex, Mat& pc, Mat& indices, Mat& distances)
 void queryPCFlann(void* flannIndex, Mat& pc, Mat& indices, Mat& distances, const int numNeighbors)
 {
   Mat obj_32f;
-  pc.colRange(0, 3).copyTo(obj_32f);
+  if (pc.cols == 3 && pc.type() == CV_32F && pc.isContinuous())
+    obj_32f = pc;
+  else
+    pc.colRange(0, 3).copyTo(obj_32f);
   ((FlannIndex*)flannIndex)->knnSearch(obj_32f, indices, distances, numNeighbors, cvflann::SearchParams(32));
 }
 
-// uses a volume instead of an octree
-// TODO: Right now normals are required.
-// This is much faster than sample_pc_octree
-Mat samplePCByQuantization(Mat pc, float xrange[2], float yrange[2], float zrange[2], float sampleStep, int weightByCenter)
+// Quantizes the points into cell indices, keyed with the point index so that sorting the keys
+// groups the points by cell while keeping them in their original order
+class QuantizePCBody : public ParallelLoopBody
 {
-  std::vector< std::vector<int> > map;
-
-  int numSamplesDim = (int)(1.0/sampleStep);
+public:
+  QuantizePCBody(const Mat& pc, const float xrange[2], const float yrange[2], const float zrange[2],
+                 int numSamplesDim, std::vector<uint64>& keys)
+    : pc_(pc), numSamplesDim_(numSamplesDim), keys_(keys)
+  {
+    for (int k=0; k<2; k++)
+    {
+      xrange_[k] = xrange[k];
+      yrange_[k] = yrange[k];
+      zrange_[k] = zrange[k];
+    }
+  }
 
-  float xr = xrange[1] - xrange[0];
-  float yr = yrange[1] - yrange[0];
-  float zr = zrange[1] - zrange[0];
+  void operator()(const Range& range) const
+  {
+    const int numSamplesDim = numSamplesDim_;
+    const float xr = xrange_[1] - xrange_[0];
+    const float yr = yrange_[1] - yrange_[0];
+    const float zr = zrange_[1] - zrange_[0];
 
-  int numPoints = 0;
+    for (int i = range.start; i < range.end; i++)
+    {
+      const float* point = pc_.ptr<float>(i);
 
-  map.resize((numSamplesDim+1)*(numSamplesDim+1)*(numSamplesDim+1));
+      // quantize a point
+      const int xCell =(int) ((float)numSamplesDim*(point[0]-xrange_[0])/xr);
+      const int yCell =(int) ((float)numSamplesDim*(point[1]-yrange_[0])/yr);
+      const int zCell =(int) ((float)numSamplesDim*(point[2]-zrange_[0])/zr);
+      const int index = xCell*numSamplesDim*numSamplesDim+yCell*numSamplesDim+zCell;
 
-  // OpenMP might seem like a good idea, but it didn't speed this up for me
-  //#pragma omp parallel for
-  for (int i=0; i<pc.rows; i++)
-  {
-    const float* point = pc.ptr<float>(i);
-
-    // quantize a point
-    const int xCell =(int) ((float)numSamplesDim*(point[0]-xrange[0])/xr);
-    const int yCell =(int) ((float)numSamplesDim*(point[1]-yrange[0])/yr);
-    const int zCell =(int) ((float)numSamplesDim*(point[2]-zrange[0])/zr);
-    const int index = xCell*numSamplesDim*numSamplesDim+yCell*numSamplesDim+zCell;
-
-    /*#pragma omp critical
-        {*/
-    map[index].push_back(i);
-    //  }
+      keys_[i] = ((uint64)(unsigned int)index << 32) | (uint64)(unsigned int)i;
+    }
   }
 
-  for (unsigned int i=0; i<map.size(); i++)
+private:
+  const Mat& pc_;
+  float xrange_[2], yrange_[2], zrange_[2];
+  int numSamplesDim_;
+  std::vector<uint64>& keys_;
+
+  QuantizePCBody& operator=(const QuantizePCBody&);
+};
+
+// Averages the points of every occupied cell into one sample
+class AverageCellsBody : public ParallelLoopBody
+{
+public:
+  AverageCellsBody(const Mat& pc, const float xrange[2], const float yrange[2], const float zrange[2],
+                   int numSamplesDim, int weightByCenter, const std::vector<uint64>& keys,
+                   const std::vector<int>& cellStarts, Mat& pcSampled)
+    : pc_(pc), numSamplesDim_(numSamplesDim), weightByCenter_(weightByCenter), keys_(keys),
+      cellStarts_(cellStarts), pcSampled_(pcSampled)
   {
-    numPoints += (map[i].size()>0);
+    for (int k=0; k<2; k++)
+    {
+      xrange_[k] = xrange[k];
+      yrange_[k] = yrange[k];
+      zrange_[k] = zrange[k];
+    }
   }
 
-  Mat pcSampled = Mat(numPoints, pc.cols, CV_32F);
-  int c = 0;
-
-  for (unsigned int i=0; i<map.size(); i++)
+  void operator()(const Range& range) const
   {
-    double px=0, py=0, pz=0;
-    double nx=0, ny=0, nz=0;
+    const int numSamplesDim = numSamplesDim_;
+    const float xr = xrange_[1] - xrange_[0];
+    const float yr = yrange_[1] - yrange_[0];
+    const float zr = zrange_[1] - zrange_[0];
 
-    std::vector<int> curCell = map[i];
-    int cn = (int)curCell.size();
-    if (cn>0)
+    for (int c = range.start; c < range.end; c++)
     {
-      if (weightByCenter)
+      double px=0, py=0, pz=0;
+      double nx=0, ny=0, nz=0;
+
+      const int cellBegin = cellStarts_[c], cellEnd = cellStarts_[c+1];
+      const int cn = cellEnd - cellBegin;
+      const int i = (int)(keys_[cellBegin] >> 32);
+
+      if (weightByCenter_)
       {
         int xCell, yCell, zCell;
         double xc, yc, zc;
@@ -335,14 +367,14 @@ Mat samplePCByQuantization(Mat pc, float xrange[2], float yrange[2], float zrang
         yCell = ((i-zCell)/numSamplesDim) % numSamplesDim;
         xCell = ((i-zCell-yCell*numSamplesDim)/(numSamplesDim*numSamplesDim));
 
-        xc = ((double)xCell+0.5) * (double)xr/numSamplesDim + (double)xrange[0];
-        yc = ((double)yCell+0.5) * (double)yr/numSamplesDim + (double)yrange[0];
-        zc = ((double)zCell+0.5) * (double)zr/numSamplesDim + (double)zrange[0];
+        xc = ((double)xCell+0.5) * (double)xr/numSamplesDim + (double)xrange_[0];
+        yc = ((double)yCell+0.5) * (double)yr/numSamplesDim + (double)yrange_[0];
+        zc = ((double)zCell+0.5) * (double)zr/numSamplesDim + (double)zrange_[0];
 
-        for (int j=0; j<cn; j++)
+        for (int j=cellBegin; j<cellEnd; j++)
         {
-          const int ptInd = curCell[j];
-          float* point = pc.ptr<float>(ptInd);
+          const int ptInd = (int)(keys_[j] & 0xffffffff);
+          const float* point = pc_.ptr<float>(ptInd);
           const double dx = point[0]-xc;
           const double dy = point[1]-yc;
           const double dz = point[2]-zc;
@@ -377,10 +409,10 @@ Mat samplePCByQuantization(Mat pc, float xrange[2], float yrange[2], float zrang
       }
       else
       {
-        for (int j=0; j<cn; j++)
+        for (int j=cellBegin; j<cellEnd; j++)
         {
-          const int ptInd = curCell[j];
-          float* point = pc.ptr<float>(ptInd);
+          const int ptInd = (int)(keys_[j] & 0xffffffff);
+          const float* point = pc_.ptr<float>(ptInd);
 
           px += (double)point[0];
           py += (double)point[1];
@@ -399,7 +431,7 @@ Mat samplePCByQuantization(Mat pc, float xrange[2], float yrange[2], float zrang
 
       }
 
-      float *pcData = pcSampled.ptr<float>(c);
+      float *pcData = pcSampled_.ptr<float>(c);
       pcData[0]=(float)px;
       pcData[1]=(float)py;
       pcData[2]=(float)pz;
@@ -413,14 +445,46 @@ Mat samplePCByQuantization(Mat pc, float xrange[2], float yrange[2], float zrang
         pcData[4]=(float)(ny/norm);
         pcData[5]=(float)(nz/norm);
       }
-      //#pragma omp atomic
-      c++;
-
-      curCell.clear();
     }
   }
 
-  map.clear();
+private:
+  const Mat& pc_;
+  float xrange_[2], yrange_[2], zrange_[2];
+  int numSamplesDim_;
+  int weightByCenter_;
+  const std::vector<uint64>& keys_;
+  const std::vector<int>& cellStarts_;
+  Mat& pcSampled_;
+
+  AverageCellsBody& operator=(const AverageCellsBody&);
+};
+
+// uses a volume instead of an octree
+// TODO: Right now normals are required.
+// This is much faster than sample_pc_octree
+Mat samplePCByQuantization(Mat pc, float xrange[2], float yrange[2], float zrange[2], float sampleStep, int weightByCenter)
+{
+  int numSamplesDim = (int)(1.0/sampleStep);
+
+  // Only the occupied cells are stored: the points are sorted by cell, cells and points in their original order
+  std::vector<uint64> keys(pc.rows);
+  parallel_for_(Range(0, pc.rows), QuantizePCBody(pc, xrange, yrange, zrange, numSamplesDim, keys));
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<int> cellStarts;
+  for (int i=0; i<pc.rows; i++)
+  {
+    if (i == 0 || (keys[i] >> 32) != (keys[i-1] >> 32))
+      cellStarts.push_back(i);
+  }
+  const int numPoints = (int)cellStarts.size();
+  cellStarts.push_back(pc.rows);
+
+  Mat pcSampled = Mat(numPoints, pc.cols, CV_32F);
+  parallel_for_(Range(0, numPoints), AverageCellsBody(pc, xrange, yrange, zrange, numSamplesDim, weightByCenter,
+                                                      keys, cellStarts, pcSampled));
+
   return pcSampled;
 }
 
@@ -720,95 +784,172 @@ void meanCovLocalPCInd(const float* pc, const int* Indices, const int ws, const
 
 }
 
-CV_EXPORTS int computeNormalsPC3d(const Mat& PC, Mat& PCNormals, const int NumNeighbors, const bool FlipViewpoint, const Vec3d& viewpoint)
+// Eigenvector of the smallest eigenvalue of a symmetric 3x3 matrix, using the closed form
+// of the eigenvalues and the cross products of the rows of (C - lambda I)
+static void smallestEigenVector33(const double C[3][3], double nr[3])
 {
-  int i;
+  const double p1 = C[0][1]*C[0][1] + C[0][2]*C[0][2] + C[1][2]*C[1][2];
+  const double q = (C[0][0] + C[1][1] + C[2][2]) / 3.0;
+  const double p2 = (C[0][0]-q)*(C[0][0]-q) + (C[1][1]-q)*(C[1][1]-q) + (C[2][2]-q)*(C[2][2]-q) + 2.0*p1;
+  const double p = sqrt(p2 / 6.0);
 
-  if (PC.cols!=3 && PC.cols!=6) // 3d data is expected
+  if (p > EPS)
   {
-    //return -1;
-    CV_Error(cv::Error::BadImageSize, "PC should have 3 or 6 elements in its columns");
+    double B[3][3];
+    for (int r=0; r<3; r++)
+      for (int c=0; c<3; c++)
+        B[r][c] = (C[r][c] - (r == c ? q : 0.0)) / p;
+
+    const double detB = B[0][0]*(B[1][1]*B[2][2]-B[1][2]*B[2][1])
+                      - B[0][1]*(B[1][0]*B[2][2]-B[1][2]*B[2][0])
+                      + B[0][2]*(B[1][0]*B[2][1]-B[1][1]*B[2][0]);
+    const double halfDet = std::min(1.0, std::max(-1.0, detB / 2.0));
+    const double phi = acos(halfDet) / 3.0;
+    const double lambda = q + 2.0*p*cos(phi + 2.0*M_PI/3.0);
+
+    // the eigenvector is orthogonal to the rows of C - lambda I, take the most stable cross product
+    const double r0[3] = {C[0][0]-lambda, C[0][1], C[0][2]};
+    const double r1[3] = {C[1][0], C[1][1]-lambda, C[1][2]};
+    const double r2[3] = {C[2][0], C[2][1], C[2][2]-lambda};
+    double candidates[3][3], bestNorm = 0;
+    TCross(r0, r1, candidates[0]);
+    TCross(r0, r2, candidates[1]);
+    TCross(r1, r2, candidates[2]);
+    int best = 0;
+    for (int k=0; k<3; k++)
+    {
+      const double norm = TNorm3(candidates[k]);
+      if (norm > bestNorm)
+      {
+        bestNorm = norm;
+        best = k;
+      }
+    }
+
+    if (bestNorm > EPS*p*p)
+    {
+      nr[0] = candidates[best][0] / bestNorm;
+      nr[1] = candidates[best][1] / bestNorm;
+      nr[2] = candidates[best][2] / bestNorm;
+      return;
+    }
   }
 
-  int sizes[2] = {PC.rows, 3};
-  int sizesResult[2] = {PC.rows, NumNeighbors};
-  float* dataset = new float[PC.rows*3];
-  float* distances = new float[PC.rows*NumNeighbors];
-  int* indices = new int[PC.rows*NumNeighbors];
+  // repeated eigenvalues: fall back to the iterative solver
+  Matx33d cov(C[0][0], C[0][1], C[0][2], C[1][0], C[1][1], C[1][2], C[2][0], C[2][1], C[2][2]);
+  Mat eigVect, eigVal;
+  eigen(cov, eigVal, eigVect);
+  //the eigenvector for the lowest eigenvalue is in the last row
+  const double* eigData = eigVect.ptr<double>(eigVect.rows - 1);
+  nr[0] = eigData[0];
+  nr[1] = eigData[1];
+  nr[2] = eigData[2];
+}
 
-  for (i=0; i<PC.rows; i++)
+// Nearest neighbor queries of blocks of points
+class KnnSearchBody : public ParallelLoopBody
+{
+public:
+  KnnSearchBody(void* flannIndex, const Mat& points, Mat& indices, Mat& distances, int numNeighbors)
+    : flannIndex_(flannIndex), points_(points), indices_(indices), distances_(distances), numNeighbors_(numNeighbors)
   {
-    const float* src = PC.ptr<float>(i);
-    float* dst = (float*)(&dataset[i*3]);
-
-    dst[0] = src[0];
-    dst[1] = src[1];
-    dst[2] = src[2];
   }
 
-  Mat PCInput(2, sizes, CV_32F, dataset, 0);
-
-  void* flannIndex = indexPCFlann(PCInput);
+  void operator()(const Range& range) const
+  {
+    Mat points = points_.rowRange(range.start, range.end);
+    Mat indices = indices_.rowRange(range.start, range.end);
+    Mat distances = distances_.rowRange(range.start, range.end);
+    queryPCFlann(flannIndex_, points, indices, distances, numNeighbors_);
+  }
 
-  Mat Indices(2, sizesResult, CV_32S, indices, 0);
-  Mat Distances(2, sizesResult, CV_32F, distances, 0);
+private:
+  void* flannIndex_;
+  const Mat& points_;
+  Mat& indices_;
+  Mat& distances_;
+  int numNeighbors_;
 
-  queryPCFlann(flannIndex, PCInput, Indices, Distances, NumNeighbors);
-  destroyFlann(flannIndex);
-  flannIndex = 0;
+  KnnSearchBody& operator=(const KnnSearchBody&);
+};
 
-  PCNormals = Mat(PC.rows, 6, CV_32F);
+// Fits the local planes of the points to their neighbors
+class NormalsPCBody : public ParallelLoopBody
+{
+public:
+  NormalsPCBody(const Mat& points, const Mat& indices, bool flipViewpoint, const Vec3d& viewpoint, Mat& PCNormals)
+    : points_(points), indices_(indices), flipViewpoint_(flipViewpoint), viewpoint_(viewpoint), PCNormals_(PCNormals)
+  {
+  }
 
-  for (i=0; i<PC.rows; i++)
+  void operator()(const Range& range) const
   {
-    double C[3][3], mu[4];
-    const float* pci = &dataset[i*3];
-    float* pcr = PCNormals.ptr<float>(i);
-    double nr[3];
-
-    int* indLocal = &indices[i*NumNeighbors];
-
-    // compute covariance matrix
-    meanCovLocalPCInd(dataset, indLocal, 3, NumNeighbors, C, mu);
-
-    // eigenvectors of covariance matrix
-    Mat cov(3, 3, CV_64F), eigVect, eigVal;
-    double* covData = (double*)cov.data;
-    covData[0] = C[0][0];
-    covData[1] = C[0][1];
-    covData[2] = C[0][2];
-    covData[3] = C[1][0];
-    covData[4] = C[1][1];
-    covData[5] = C[1][2];
-    covData[6] = C[2][0];
-    covData[7] = C[2][1];
-    covData[8] = C[2][2];
-    eigen(cov, eigVal, eigVect);
-    Mat lowestEigVec;
-    //the eigenvector for the lowest eigenvalue is in the last row
-    eigVect.row(eigVect.rows - 1).copyTo(lowestEigVec);
-    double* eigData = (double*)lowestEigVec.data;
-    nr[0] = eigData[0];
-    nr[1] = eigData[1];
-    nr[2] = eigData[2];
-
-    pcr[0] = pci[0];
-    pcr[1] = pci[1];
-    pcr[2] = pci[2];
-
-    if (FlipViewpoint)
+    const float* dataset = points_.ptr<float>();
+    const int numNeighbors = indices_.cols;
+
+    for (int i = range.start; i < range.end; i++)
     {
-      flipNormalViewpoint(pci, viewpoint[0], viewpoint[1], viewpoint[2], &nr[0], &nr[1], &nr[2]);
+      double C[3][3], mu[4];
+      const float* pci = &dataset[i*3];
+      float* pcr = PCNormals_.ptr<float>(i);
+      double nr[3];
+
+      const int* indLocal = indices_.ptr<int>(i);
+
+      // compute covariance matrix
+      meanCovLocalPCInd(dataset, indLocal, 3, numNeighbors, C, mu);
+
+      // eigenvector of the lowest eigenvalue of the covariance matrix
+      smallestEigenVector33(C, nr);
+
+      pcr[0] = pci[0];
+      pcr[1] = pci[1];
+      pcr[2] = pci[2];
+
+      if (flipViewpoint_)
+      {
+        flipNormalViewpoint(pci, viewpoint_[0], viewpoint_[1], viewpoint_[2], &nr[0], &nr[1], &nr[2]);
+      }
+
+      pcr[3] = (float)nr[0];
+      pcr[4] = (float)nr[1];
+      pcr[5] = (float)nr[2];
     }
+  }
+
+private:
+  const Mat& points_;
+  const Mat& indices_;
+  bool flipViewpoint_;
+  Vec3d viewpoint_;
+  Mat& PCNormals_;
 
-    pcr[3] = (float)nr[0];
-    pcr[4] = (float)nr[1];
-    pcr[5] = (float)nr[2];
+  NormalsPCBody& operator=(const NormalsPCBody&);
+};
+
+CV_EXPORTS int computeNormalsPC3d(const Mat& PC, Mat& PCNormals, const int NumNeighbors, const bool FlipViewpoint, const Vec3d& viewpoint)
+{
+  if (PC.cols!=3 && PC.cols!=6) // 3d data is expected
+  {
+    //return -1;
+    CV_Error(cv::Error::BadImageSize, "PC should have 3 or 6 elements in its columns");
   }
 
-  delete[] indices;
-  delete[] distances;
-  delete[] dataset;
+  Mat PCInput;
+  PC.colRange(0, 3).copyTo(PCInput);
+
+  void* flannIndex = indexPCFlann(PCInput);
+
+  // all the points are queried at once, in parallel blocks
+  Mat Indices(PC.rows, NumNeighbors, CV_32S);
+  Mat Distances(PC.rows, NumNeighbors, CV_32F);
+  parallel_for_(Range(0, PC.rows), KnnSearchBody(flannIndex, PCInput, Indices, Distances, NumNeighbors),
+                PC.rows / 1024.0);
+  destroyFlann(flannIndex);
+  flannIndex = 0;
+
+  PCNormals.create(PC.rows, 6, CV_32F);
+  parallel_for_(Range(0, PC.rows), NormalsPCBody(PCInput, Indices, FlipViewpoint, viewpoint, PCNormals));
 
   return 1;
 }
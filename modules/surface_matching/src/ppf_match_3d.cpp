@@ -119,6 +119,385 @@ static double computeAlpha(const double p1[4], const double n1[4], const double
   return (-alpha);
 }
 
+// compute per point PPF as in paper
+static void computePPF(const double p1[4], const double n1[4],
+                       const double p2[4], const double n2[4],
+                       double f[4])
+{
+  /*
+  Vectors will be defined as of length 4 instead of 3, because of:
+  - Further SIMD vectorization
+  - Cache alignment
+  */
+
+  double d[4] = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2], 0};
+
+  double norm = TNorm3(d);
+  f[3] = norm;
+
+  if (norm)
+  {
+    d[0] /= f[3];
+    d[1] /= f[3];
+    d[2] /= f[3];
+  }
+  else
+  {
+    // TODO: Handle this
+    f[0] = 0;
+    f[1] = 0;
+    f[2] = 0;
+    return ;
+  }
+
+  f[0] = TAngle3Normalized(n1, d);
+  f[1] = TAngle3Normalized(n2, d);
+  f[2] = TAngle3Normalized(n1, n2);
+}
+
+// Computes the point pair features of the model, one reference point per row,
+// along with the hash key of every pair
+class PPFTrainBody : public ParallelLoopBody
+{
+public:
+  PPFTrainBody(const Mat& sampled, double angleStep, double distanceStep, Mat& ppf, std::vector<KeyType>& keys)
+    : sampled_(sampled), angle_step_(angleStep), distance_step_(distanceStep), ppf_(ppf), keys_(keys)
+  {
+  }
+
+  void operator()(const Range& range) const
+  {
+    const int numRefPoints = sampled_.rows;
+    for (int i = range.start; i < range.end; i++)
+    {
+      const float* f1 = sampled_.ptr<float>(i);
+      const double p1[4] = {f1[0], f1[1], f1[2], 0};
+      const double n1[4] = {f1[3], f1[4], f1[5], 0};
+
+      for (int j = 0; j < numRefPoints; j++)
+      {
+        // cannnot compute the ppf with myself
+        if (i == j)
+          continue;
+
+        const float* f2 = sampled_.ptr<float>(j);
+        const double p2[4] = {f2[0], f2[1], f2[2], 0};
+        const double n2[4] = {f2[3], f2[4], f2[5], 0};
+
+        double f[4]={0};
+        computePPF(p1, n1, p2, n2, f);
+        const int ppfInd = i*numRefPoints+j;
+        keys_[ppfInd] = hashPPF(f, angle_step_, distance_step_);
+
+        float* ppfRow = ppf_.ptr<float>(ppfInd);
+        ppfRow[0] = (float)f[0];
+        ppfRow[1] = (float)f[1];
+        ppfRow[2] = (float)f[2];
+        ppfRow[3] = (float)f[3];
+        ppfRow[4] = (float)computeAlpha(p1, n1, p2);
+      }
+    }
+  }
+
+private:
+  const Mat& sampled_;
+  double angle_step_, distance_step_;
+  Mat& ppf_;
+  std::vector<KeyType>& keys_;
+
+  PPFTrainBody& operator=(const PPFTrainBody&);
+};
+
+static bool hashNodeCompare(const THash& a, const THash& b)
+{
+  if ((KeyType)a.id != (KeyType)b.id)
+    return (KeyType)a.id < (KeyType)b.id;
+  return a.ppfInd < b.ppfInd;
+}
+
+// Sorts the nodes of every bucket by key
+class PPFSortBucketsBody : public ParallelLoopBody
+{
+public:
+  PPFSortBucketsBody(const std::vector<int>& offsets, std::vector<THash>& nodes)
+    : offsets_(offsets), nodes_(nodes)
+  {
+  }
+
+  void operator()(const Range& range) const
+  {
+    for (int b = range.start; b < range.end; b++)
+      if (offsets_[b+1] - offsets_[b] > 1)
+        std::sort(nodes_.begin() + offsets_[b], nodes_.begin() + offsets_[b+1], hashNodeCompare);
+  }
+
+private:
+  const std::vector<int>& offsets_;
+  std::vector<THash>& nodes_;
+
+  PPFSortBucketsBody& operator=(const PPFSortBucketsBody&);
+};
+
+// Votes for the model reference point and the rotation angle of the scene reference points,
+// with one accumulator for each range of reference points
+class PPFMatchBody : public ParallelLoopBody
+{
+public:
+  PPFMatchBody(const Mat& sampled, int sceneSamplingStep, const Mat& sampledModel, const Mat& ppf,
+               const std::vector<int>& hashBucketOffsets, const std::vector<THash>& hashNodes,
+               double angleStep, float distanceStep, int numAngles, std::vector<Pose3DPtr>& poseList)
+    : sampled_(sampled), scene_sampling_step_(sceneSamplingStep), sampled_model_(sampledModel), ppf_(ppf),
+      hash_bucket_offsets_(hashBucketOffsets), hash_nodes_(hashNodes), angle_step_(angleStep),
+      distance_step_(distanceStep), num_angles_(numAngles), pose_list_(poseList)
+  {
+  }
+
+  void operator()(const Range& range) const
+  {
+    const int numAngles = num_angles_;
+    const unsigned int n = (unsigned int)sampled_model_.rows;
+    const THash* hashNodes = hash_nodes_.empty() ? 0 : &hash_nodes_[0];
+    const KeyType bucketMask = (KeyType)(hash_bucket_offsets_.size() - 2);
+    std::vector<unsigned int> accumulatorBuffer(numAngles*n, 0);
+    unsigned int* accumulator = &accumulatorBuffer[0];
+
+    for (int poseInd = range.start; poseInd < range.end; poseInd++)
+    {
+      const int i = poseInd * scene_sampling_step_;
+      unsigned int refIndMax = 0, alphaIndMax = 0;
+      unsigned int maxVotes = 0;
+
+      const float* f1 = sampled_.ptr<float>(i);
+      const double p1[4] = {f1[0], f1[1], f1[2], 0};
+      const double n1[4] = {f1[3], f1[4], f1[5], 0};
+      double *row2, *row3, tsg[3]={0}, Rsg[9]={0}, RInv[9]={0};
+
+      computeTransformRT(p1, n1, Rsg, tsg);
+      row2=&Rsg[3];
+      row3=&Rsg[6];
+
+      // Tolga Birdal's notice:
+      // As a later update, we might want to look into a local neighborhood only
+      // To do this, simply search the local neighborhood by radius look up
+      // and collect the neighbors to compute the relative pose
+
+      for (int j = 0; j < sampled_.rows; j ++)
+      {
+        if (i!=j)
+        {
+          const float* f2 = sampled_.ptr<float>(j);
+          const double p2[4] = {f2[0], f2[1], f2[2], 0};
+          const double n2[4] = {f2[3], f2[4], f2[5], 0};
+          double p2t[4], alpha_scene;
+
+          double f[4]={0};
+          computePPF(p1, n1, p2, n2, f);
+          KeyType hashValue = hashPPF(f, angle_step_, distance_step_);
+
+          // we don't need to call this here, as we already estimate the tsg from scene reference point
+          // double alpha = computeAlpha(p1, n1, p2);
+          p2t[1] = tsg[1] + row2[0] * p2[0] + row2[1] * p2[1] + row2[2] * p2[2];
+          p2t[2] = tsg[2] + row3[0] * p2[0] + row3[1] * p2[1] + row3[2] * p2[2];
+
+          alpha_scene=atan2(-p2t[2], p2t[1]);
+
+          if ( alpha_scene != alpha_scene)
+          {
+            continue;
+          }
+
+          if (sin(alpha_scene)*p2t[2]<0.0)
+            alpha_scene=-alpha_scene;
+
+          alpha_scene=-alpha_scene;
+
+          const int bucket = (int)(hashValue & bucketMask);
+          const THash* node = hashNodes + hash_bucket_offsets_[bucket];
+          const THash* nodeEnd = hashNodes + hash_bucket_offsets_[bucket+1];
+
+          // the nodes of the bucket are sorted by key
+          while (node < nodeEnd && (KeyType)node->id < hashValue)
+            node++;
+
+          for ( ; node < nodeEnd && (KeyType)node->id == hashValue; node++)
+          {
+            int corrI = (int)node->i;
+            int ppfInd = (int)node->ppfInd;
+            const float* ppfCorrScene = ppf_.ptr<float>(ppfInd);
+            double alpha_model = (double)ppfCorrScene[PPF_LENGTH-1];
+            double alpha = alpha_model - alpha_scene;
+
+            /*  Tolga Birdal's note: Map alpha to the indices:
+                    atan2 generates results in (-pi pi]
+                    That's why alpha should be in range [-2pi 2pi]
+                    So the quantization would be :
+                    numAngles * (alpha+2pi)/(4pi)
+                    */
+
+            //printf("%f\n", alpha);
+            int alpha_index = (int)(numAngles*(alpha + 2*M_PI) / (4*M_PI));
+
+            unsigned int accIndex = corrI * numAngles + alpha_index;
+
+            accumulator[accIndex]++;
+          }
+        }
+      }
+
+      // Maximize the accumulator, and clear it for the next reference point
+      for (unsigned int k = 0; k < n; k++)
+      {
+        for (int j = 0; j < numAngles; j++)
+        {
+          const unsigned int accInd = k*numAngles + j;
+          const unsigned int accVal = accumulator[ accInd ];
+          if (accVal > maxVotes)
+          {
+            maxVotes = accVal;
+            refIndMax = k;
+            alphaIndMax = j;
+          }
+
+          accumulator[accInd ] = 0;
+        }
+      }
+
+      // invert Tsg : Luckily rotation is orthogonal: Inverse = Transpose.
+      // We are not required to invert.
+      double tInv[3], tmg[3], Rmg[9];
+      matrixTranspose33(Rsg, RInv);
+      matrixProduct331(RInv, tsg, tInv);
+
+      double TsgInv[16] = { RInv[0], RInv[1], RInv[2], -tInv[0],
+                            RInv[3], RInv[4], RInv[5], -tInv[1],
+                            RInv[6], RInv[7], RInv[8], -tInv[2],
+                            0, 0, 0, 1
+                          };
+
+      // TODO : Compute pose
+      const float* fMax = sampled_model_.ptr<float>(refIndMax);
+      const double pMax[4] = {fMax[0], fMax[1], fMax[2], 1};
+      const double nMax[4] = {fMax[3], fMax[4], fMax[5], 1};
+
+      computeTransformRT(pMax, nMax, Rmg, tmg);
+
+      double Tmg[16] = { Rmg[0], Rmg[1], Rmg[2], tmg[0],
+                         Rmg[3], Rmg[4], Rmg[5], tmg[1],
+                         Rmg[6], Rmg[7], Rmg[8], tmg[2],
+                         0, 0, 0, 1
+                       };
+
+      // convert alpha_index to alpha
+      int alpha_index = alphaIndMax;
+      double alpha = (alpha_index*(4*M_PI))/numAngles-2*M_PI;
+
+      // Equation 2:
+      double Talpha[16]={0};
+      getUnitXRotation_44(alpha, Talpha);
+
+      double Temp[16]={0};
+      double rawPose[16]={0};
+      matrixProduct44(Talpha, Tmg, Temp);
+      matrixProduct44(TsgInv, Temp, rawPose);
+
+      Pose3DPtr pose(new Pose3D(alpha, refIndMax, maxVotes));
+      pose->updatePose(rawPose);
+      pose_list_[poseInd] = pose;
+    }
+  }
+
+private:
+  const Mat& sampled_;
+  int scene_sampling_step_;
+  const Mat& sampled_model_;
+  const Mat& ppf_;
+  const std::vector<int>& hash_bucket_offsets_;
+  const std::vector<THash>& hash_nodes_;
+  double angle_step_;
+  float distance_step_;
+  int num_angles_;
+  std::vector<Pose3DPtr>& pose_list_;
+
+  PPFMatchBody& operator=(const PPFMatchBody&);
+};
+
+// Key of a cell of the pose clustering grid
+static uint64 poseGridKey(const int cell[4])
+{
+  uint64 key = 0;
+  for (int k=0; k<4; k++)
+    key = key * CV_BIG_UINT(0x100000001b3) ^ (uint64)(unsigned int)cell[k];
+  return key;
+}
+
+// Averages the poses of the clusters, weighting them by their number of votes if requested
+class PoseClusterAverageBody : public ParallelLoopBody
+{
+public:
+  PoseClusterAverageBody(const std::vector<PoseCluster3DPtr>& poseClusters, bool useWeightedAverage,
+                         std::vector<Pose3DPtr>& finalPoses)
+    : pose_clusters_(poseClusters), use_weighted_avg_(useWeightedAverage), final_poses_(finalPoses)
+  {
+  }
+
+  void operator()(const Range& range) const
+  {
+    for (int i = range.start; i < range.end; i++)
+    {
+      // We could only average the quaternions. So I will make use of them here
+      double qAvg[4]={0}, tAvg[3]={0};
+
+      // Perform the final averaging
+      PoseCluster3DPtr curCluster = pose_clusters_[i];
+      std::vector<Pose3DPtr> curPoses = curCluster->poseList;
+      const int curSize = (int)curPoses.size();
+      int numTotalVotes = 0;
+
+      for (int j=0; j<curSize; j++)
+        numTotalVotes += curPoses[j]->numVotes;
+
+      double wSum=0;
+
+      for (int j=0; j<curSize; j++)
+      {
+        // uses weighting by the number of votes
+        const double w = use_weighted_avg_ ? (double)curPoses[j]->numVotes / (double)numTotalVotes : 1.0;
+
+        qAvg[0]+= w*curPoses[j]->q[0];
+        qAvg[1]+= w*curPoses[j]->q[1];
+        qAvg[2]+= w*curPoses[j]->q[2];
+        qAvg[3]+= w*curPoses[j]->q[3];
+
+        tAvg[0]+= w*curPoses[j]->t[0];
+        tAvg[1]+= w*curPoses[j]->t[1];
+        tAvg[2]+= w*curPoses[j]->t[2];
+        wSum+=w;
+      }
+
+      tAvg[0]/=wSum;
+      tAvg[1]/=wSum;
+      tAvg[2]/=wSum;
+
+      qAvg[0]/=wSum;
+      qAvg[1]/=wSum;
+      qAvg[2]/=wSum;
+      qAvg[3]/=wSum;
+
+      curPoses[0]->updatePoseQuat(qAvg, tAvg);
+      curPoses[0]->numVotes=curCluster->numVotes;
+
+      final_poses_[i]=curPoses[0]->clone();
+    }
+  }
+
+private:
+  const std::vector<PoseCluster3DPtr>& pose_clusters_;
+  bool use_weighted_avg_;
+  std::vector<Pose3DPtr>& final_poses_;
+
+  PoseClusterAverageBody& operator=(const PoseClusterAverageBody&);
+};
+
 PPF3DDetector::PPF3DDetector()
 {
   sampling_step_relative = 0.05;
@@ -129,9 +508,6 @@ PPF3DDetector::PPF3DDetector()
   angle_step = angle_step_radians;
   trained = false;
 
-  hash_table = NULL;
-  hash_nodes = NULL;
-
   setSearchParams();
 }
 
@@ -145,9 +521,6 @@ PPF3DDetector::PPF3DDetector(const double RelativeSamplingStep, const double Rel
   angle_step = angle_step_radians;
   trained = false;
 
-  hash_table = NULL;
-  hash_nodes = NULL;
-
   setSearchParams();
 }
 
@@ -166,55 +539,17 @@ void PPF3DDetector::setSearchParams(const double positionThreshold, const double
   use_weighted_avg = useWeightedClustering;
 }
 
-// compute per point PPF as in paper
 void PPF3DDetector::computePPFFeatures(const double p1[4], const double n1[4],
                                        const double p2[4], const double n2[4],
                                        double f[4])
 {
-  /*
-  Vectors will be defined as of length 4 instead of 3, because of:
-  - Further SIMD vectorization
-  - Cache alignment
-  */
-
-  double d[4] = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2], 0};
-
-  double norm = TNorm3(d);
-  f[3] = norm;
-
-  if (norm)
-  {
-    d[0] /= f[3];
-    d[1] /= f[3];
-    d[2] /= f[3];
-  }
-  else
-  {
-    // TODO: Handle this
-    f[0] = 0;
-    f[1] = 0;
-    f[2] = 0;
-    return ;
-  }
-
-  f[0] = TAngle3Normalized(n1, d);
-  f[1] = TAngle3Normalized(n2, d);
-  f[2] = TAngle3Normalized(n1, n2);
+  computePPF(p1, n1, p2, n2, f);
 }
 
 void PPF3DDetector::clearTrainingModels()
 {
-  if (this->hash_nodes)
-  {
-    free(this->hash_nodes);
-    this->hash_nodes=0;
-  }
-
-  if (this->hash_table)
-  {
-    hashtableDestroy(this->hash_table);
-    this->hash_table=0;
-  }
+  hash_bucket_offsets.clear();
+  hash_nodes.clear();
 }
 
 PPF3DDetector::~PPF3DDetector()
@@ -241,9 +576,7 @@ void PPF3DDetector::trainModel(const Mat &PC)
 
   Mat sampled = samplePCByQuantization(PC, xRange, yRange, zRange, (float)sampling_step_relative,0);
 
-  int size = sampled.rows*sampled.rows;
-
-  hashtable_int* hashTable = hashtableCreate(size, NULL);
+  clearTrainingModels();
 
   int numPPF = sampled.rows*sampled.rows;
   ppf = Mat(numPPF, PPF_LENGTH, CV_32FC1);
@@ -251,62 +584,114 @@ void PPF3DDetector::trainModel(const Mat &PC)
   // TODO: Maybe I could sample 1/5th of them here. Check the performance later.
   int numRefPoints = sampled.rows;
 
-  // pre-allocate the hash nodes
-  hash_nodes = (THash*)calloc(numRefPoints*numRefPoints, sizeof(THash));
-
-  // TODO : This can easily be parallelized. But we have to lock hashtable_insert.
-  // I realized that performance drops when this loop is parallelized (unordered
-  // inserts into the hashtable
-  // But it is still there to be investigated. For now, I leave this unparallelized
-  // since this is just a training part.
-  for (int i=0; i<numRefPoints; i++)
+  std::vector<KeyType> keys(numPPF);
+  parallel_for_(Range(0, numRefPoints), PPFTrainBody(sampled, angle_step_radians, distanceStep, ppf, keys));
+
+  // Bucket the point pairs by key with a counting sort, about four pairs for a bucket
+  const int numBuckets = (int)next_power_of_two((unsigned int)std::max(numPPF / 4, 16));
+  const KeyType bucketMask = (KeyType)(numBuckets - 1);
+  hash_bucket_offsets.assign(numBuckets + 1, 0);
+  for (int i = 0; i < numRefPoints; i++)
+    for (int j = 0; j < numRefPoints; j++)
+      if (i != j)
+        hash_bucket_offsets[(keys[i*numRefPoints+j] & bucketMask) + 1]++;
+  for (int b = 0; b < numBuckets; b++)
+    hash_bucket_offsets[b+1] += hash_bucket_offsets[b];
+
+  hash_nodes.resize(hash_bucket_offsets[numBuckets]);
   {
-    float* f1 = sampled.ptr<float>(i);
-    const double p1[4] = {f1[0], f1[1], f1[2], 0};
-    const double n1[4] = {f1[3], f1[4], f1[5], 0};
-
-    //printf("///////////////////// NEW REFERENCE ////////////////////////\n");
-    for (int j=0; j<numRefPoints; j++)
+    std::vector<int> bucketFill(hash_bucket_offsets.begin(), hash_bucket_offsets.end() - 1);
+    for (int i = 0; i < numRefPoints; i++)
     {
-      // cannnot compute the ppf with myself
-      if (i!=j)
+      for (int j = 0; j < numRefPoints; j++)
       {
-        float* f2 = sampled.ptr<float>(j);
-        const double p2[4] = {f2[0], f2[1], f2[2], 0};
-        const double n2[4] = {f2[3], f2[4], f2[5], 0};
-
-        double f[4]={0};
-        computePPFFeatures(p1, n1, p2, n2, f);
-        KeyType hashValue = hashPPF(f, angle_step_radians, distanceStep);
-        double alpha = computeAlpha(p1, n1, p2);
-        unsigned int ppfInd = i*numRefPoints+j;
-
-        THash* hashNode = &hash_nodes[i*numRefPoints+j];
-        hashNode->id = hashValue;
-        hashNode->i = i;
-        hashNode->ppfInd = ppfInd;
-
-        hashtableInsertHashed(hashTable, hashValue, (void*)hashNode);
-
-        float* ppfRow = ppf.ptr<float>(ppfInd);
-        ppfRow[0] = (float)f[0];
-        ppfRow[1] = (float)f[1];
-        ppfRow[2] = (float)f[2];
-        ppfRow[3] = (float)f[3];
-        ppfRow[4] = (float)alpha;
+        if (i == j)
+          continue;
+        const int ppfInd = i*numRefPoints+j;
+        THash& hashNode = hash_nodes[bucketFill[keys[ppfInd] & bucketMask]++];
+        hashNode.id = (int)keys[ppfInd];
+        hashNode.i = i;
+        hashNode.ppfInd = ppfInd;
       }
     }
   }
+  parallel_for_(Range(0, numBuckets), PPFSortBucketsBody(hash_bucket_offsets, hash_nodes));
 
   angle_step = angle_step_radians;
   distance_step = distanceStep;
-  hash_table = hashTable;
   num_ref_points = numRefPoints;
   sampled_pc = sampled;
   trained = true;
 }
 
 
+void PPF3DDetector::write(FileStorage& fs) const
+{
+  CV_Assert(sizeof(THash) == 3*sizeof(int));
+
+  fs << "sampling_step_relative" << sampling_step_relative;
+  fs << "distance_step_relative" << distance_step_relative;
+  fs << "angle_step_relative" << angle_step_relative;
+  fs << "angle_step_radians" << angle_step_radians;
+  fs << "angle_step" << angle_step;
+  fs << "distance_step" << distance_step;
+  fs << "position_threshold" << position_threshold;
+  fs << "rotation_threshold" << rotation_threshold;
+  fs << "use_weighted_avg" << (int)use_weighted_avg;
+  fs << "trained" << (int)trained;
+
+  if (!trained)
+    return;
+
+  fs << "num_ref_points" << num_ref_points;
+  fs << "sampled_pc" << sampled_pc;
+  fs << "ppf" << ppf;
+  fs << "hash_bucket_offsets" << Mat(hash_bucket_offsets);
+  // the nodes are stored as rows of (key, reference point index, point pair feature index)
+  fs << "hash_nodes" << (hash_nodes.empty() ? Mat() :
+                         Mat((int)hash_nodes.size(), 3, CV_32SC1, (void*)&hash_nodes[0]));
+}
+
+void PPF3DDetector::read(const FileNode& fn)
+{
+  CV_Assert(sizeof(THash) == 3*sizeof(int));
+
+  clearTrainingModels();
+
+  fn["sampling_step_relative"] >> sampling_step_relative;
+  fn["distance_step_relative"] >> distance_step_relative;
+  fn["angle_step_relative"] >> angle_step_relative;
+  fn["angle_step_radians"] >> angle_step_radians;
+  fn["angle_step"] >> angle_step;
+  fn["distance_step"] >> distance_step;
+  fn["position_threshold"] >> position_threshold;
+  fn["rotation_threshold"] >> rotation_threshold;
+  use_weighted_avg = (int)fn["use_weighted_avg"] != 0;
+  trained = (int)fn["trained"] != 0;
+
+  if (!trained)
+    return;
+
+  Mat offsets, nodes;
+  fn["num_ref_points"] >> num_ref_points;
+  fn["sampled_pc"] >> sampled_pc;
+  fn["ppf"] >> ppf;
+  fn["hash_bucket_offsets"] >> offsets;
+  fn["hash_nodes"] >> nodes;
+
+  const int numBuckets = (int)offsets.total() - 1;
+  CV_Assert(offsets.type() == CV_32SC1 && numBuckets > 0 && (numBuckets & (numBuckets - 1)) == 0);
+  CV_Assert(sampled_pc.rows == num_ref_points && ppf.rows == num_ref_points*num_ref_points);
+  hash_bucket_offsets.assign(offsets.ptr<int>(), offsets.ptr<int>() + offsets.total());
+  CV_Assert(hash_bucket_offsets[numBuckets] == nodes.rows);
+  if (nodes.rows > 0)
+  {
+    CV_Assert(nodes.type() == CV_32SC1 && nodes.cols == 3 && nodes.isContinuous());
+    const THash* nodesPtr = nodes.ptr<THash>();
+    hash_nodes.assign(nodesPtr, nodesPtr + nodes.rows);
+  }
+}
+
 
 ///////////////////////// MATCHING ////////////////////////////////////////
 
@@ -329,131 +714,69 @@ void PPF3DDetector::clusterPoses(std::vector<Pose3DPtr>& poseList, int numPoses,
   finalPoses.clear();
 
   // sort the poses for stability
-  std::sort(poseList.begin(), poseList.end(), pose3DPtrCompare);
+  std::stable_sort(poseList.begin(), poseList.end(), pose3DPtrCompare);
+
+  // The cluster centers are indexed by a grid over the translation and the angle with the cells of
+  // the size of the thresholds, so that only the clusters of the neighboring cells have to be compared.
+  // A pose still joins the first created cluster it matches.
+  const bool useGrid = position_threshold > 0 && rotation_threshold > 0;
+  std::map<uint64, std::vector<int> > clusterGrid;
 
   for (int i=0; i<numPoses; i++)
   {
     Pose3DPtr pose = poseList[i];
-    bool assigned = false;
+    int assigned = -1;
+    int cell[4] = {0};
 
-    // search all clusters
-    for (size_t j=0; j<poseClusters.size() && !assigned; j++)
+    if (useGrid)
     {
-      const Pose3DPtr poseCenter = poseClusters[j]->poseList[0];
-      if (matchPose(*pose, *poseCenter))
+      for (int k=0; k<3; k++)
+        cell[k] = cvFloor(pose->t[k] / position_threshold);
+      cell[3] = cvFloor(pose->angle / rotation_threshold);
+
+      for (int c=0; c<81; c++)
       {
-        poseClusters[j]->addPose(pose);
-        assigned = true;
+        int neighbor[4];
+        for (int k=0, code=c; k<4; k++, code/=3)
+          neighbor[k] = cell[k] + code%3 - 1;
+
+        std::map<uint64, std::vector<int> >::const_iterator it = clusterGrid.find(poseGridKey(neighbor));
+        if (it == clusterGrid.end())
+          continue;
+
+        // the clusters of a cell are in the order of creation
+        const std::vector<int>& cellClusters = it->second;
+        for (size_t j=0; j<cellClusters.size() && (assigned < 0 || cellClusters[j] < assigned); j++)
+        {
+          if (matchPose(*pose, *poseClusters[cellClusters[j]]->poseList[0]))
+          {
+            assigned = cellClusters[j];
+            break;
+          }
+        }
       }
     }
 
-    if (!assigned)
+    if (assigned >= 0)
     {
+      poseClusters[assigned]->addPose(pose);
+    }
+    else
+    {
+      if (useGrid)
+        clusterGrid[poseGridKey(cell)].push_back((int)poseClusters.size());
       poseClusters.push_back(PoseCluster3DPtr(new PoseCluster3D(pose)));
     }
   }
 
   // sort the clusters so that we could output multiple hypothesis
-  std::sort(poseClusters.begin(), poseClusters.end(), sortPoseClusters);
+  std::stable_sort(poseClusters.begin(), poseClusters.end(), sortPoseClusters);
 
   finalPoses.resize(poseClusters.size());
 
   // TODO: Use MinMatchScore
 
-  if (use_weighted_avg)
-  {
-#if defined _OPENMP
-#pragma omp parallel for
-#endif
-    // uses weighting by the number of votes
-    for (int i=0; i<static_cast<int>(poseClusters.size()); i++)
-    {
-      // We could only average the quaternions. So I will make use of them here
-      double qAvg[4]={0}, tAvg[3]={0};
-
-      // Perform the final averaging
-      PoseCluster3DPtr curCluster = poseClusters[i];
-      std::vector<Pose3DPtr> curPoses = curCluster->poseList;
-      int curSize = (int)curPoses.size();
-      int numTotalVotes = 0;
-
-      for (int j=0; j<curSize; j++)
-        numTotalVotes += curPoses[j]->numVotes;
-
-      double wSum=0;
-
-      for (int j=0; j<curSize; j++)
-      {
-        const double w = (double)curPoses[j]->numVotes / (double)numTotalVotes;
-
-        qAvg[0]+= w*curPoses[j]->q[0];
-        qAvg[1]+= w*curPoses[j]->q[1];
-        qAvg[2]+= w*curPoses[j]->q[2];
-        qAvg[3]+= w*curPoses[j]->q[3];
-
-        tAvg[0]+= w*curPoses[j]->t[0];
-        tAvg[1]+= w*curPoses[j]->t[1];
-        tAvg[2]+= w*curPoses[j]->t[2];
-        wSum+=w;
-      }
-
-      tAvg[0]/=wSum;
-      tAvg[1]/=wSum;
-      tAvg[2]/=wSum;
-
-      qAvg[0]/=wSum;
-      qAvg[1]/=wSum;
-      qAvg[2]/=wSum;
-      qAvg[3]/=wSum;
-
-      curPoses[0]->updatePoseQuat(qAvg, tAvg);
-      curPoses[0]->numVotes=curCluster->numVotes;
-
-      finalPoses[i]=curPoses[0]->clone();
-    }
-  }
-  else
-  {
-#if defined _OPENMP
-#pragma omp parallel for
-#endif
-    for (int i=0; i<static_cast<int>(poseClusters.size()); i++)
-    {
-      // We could only average the quaternions. So I will make use of them here
-      double qAvg[4]={0}, tAvg[3]={0};
-
-      // Perform the final averaging
-      PoseCluster3DPtr curCluster = poseClusters[i];
-      std::vector<Pose3DPtr> curPoses = curCluster->poseList;
-      const int curSize = (int)curPoses.size();
-
-      for (int j=0; j<curSize; j++)
-      {
-        qAvg[0]+= curPoses[j]->q[0];
-        qAvg[1]+= curPoses[j]->q[1];
-        qAvg[2]+= curPoses[j]->q[2];
-        qAvg[3]+= curPoses[j]->q[3];
-
-        tAvg[0]+= curPoses[j]->t[0];
-        tAvg[1]+= curPoses[j]->t[1];
-        tAvg[2]+= curPoses[j]->t[2];
-      }
-
-      tAvg[0]/=(double)curSize;
-      tAvg[1]/=(double)curSize;
-      tAvg[2]/=(double)curSize;
-
-      qAvg[0]/=(double)curSize;
-      qAvg[1]/=(double)curSize;
-      qAvg[2]/=(double)curSize;
-      qAvg[3]/=(double)curSize;
-
-      curPoses[0]->updatePoseQuat(qAvg, tAvg);
-      curPoses[0]->numVotes=curCluster->numVotes;
-
-      finalPoses[i]=curPoses[0]->clone();
-    }
-  }
+  parallel_for_(Range(0, (int)poseClusters.size()), PoseClusterAverageBody(poseClusters, use_weighted_avg, finalPoses));
 
   poseClusters.clear();
 }
@@ -472,9 +795,6 @@ void PPF3DDetector::match(const Mat& pc, std::vector<Pose3DPtr>& results, const
 
   //int numNeighbors = 10;
   int numAngles = (int) (floor (2 * M_PI / angle_step));
-  float distanceStep = (float)distance_step;
-  unsigned int n = num_ref_points;
-  std::vector<Pose3DPtr> poseList;
   int sceneSamplingStep = scene_sample_step;
 
   // compute bbox
@@ -489,168 +809,12 @@ void PPF3DDetector::match(const Mat& pc, std::vector<Pose3DPtr>& results, const
   float distanceSampleStep = diameter * RelativeSceneDistance;*/
   Mat sampled = samplePCByQuantization(pc, xRange, yRange, zRange, (float)relativeSceneDistance, 0);
 
-  // allocate the accumulator : Moved this to the inside of the loop
-  /*#if !defined (_OPENMP)
-     unsigned int* accumulator = (unsigned int*)calloc(numAngles*n, sizeof(unsigned int));
-  #endif*/
-
-  poseList.reserve((sampled.rows/sceneSamplingStep)+4);
-
-#if defined _OPENMP
-#pragma omp parallel for
-#endif
-  for (int i = 0; i < sampled.rows; i += sceneSamplingStep)
-  {
-    unsigned int refIndMax = 0, alphaIndMax = 0;
-    unsigned int maxVotes = 0;
-
-    float* f1 = sampled.ptr<float>(i);
-    const double p1[4] = {f1[0], f1[1], f1[2], 0};
-    const double n1[4] = {f1[3], f1[4], f1[5], 0};
-    double *row2, *row3, tsg[3]={0}, Rsg[9]={0}, RInv[9]={0};
-
-    unsigned int* accumulator = (unsigned int*)calloc(numAngles*n, sizeof(unsigned int));
-    computeTransformRT(p1, n1, Rsg, tsg);
-    row2=&Rsg[3];
-    row3=&Rsg[6];
-
-    // Tolga Birdal's notice:
-    // As a later update, we might want to look into a local neighborhood only
-    // To do this, simply search the local neighborhood by radius look up
-    // and collect the neighbors to compute the relative pose
-
-    for (int j = 0; j < sampled.rows; j ++)
-    {
-      if (i!=j)
-      {
-        float* f2 = sampled.ptr<float>(j);
-        const double p2[4] = {f2[0], f2[1], f2[2], 0};
-        const double n2[4] = {f2[3], f2[4], f2[5], 0};
-        double p2t[4], alpha_scene;
-
-        double f[4]={0};
-        computePPFFeatures(p1, n1, p2, n2, f);
-        KeyType hashValue = hashPPF(f, angle_step, distanceStep);
-
-        // we don't need to call this here, as we already estimate the tsg from scene reference point
-        // double alpha = computeAlpha(p1, n1, p2);
-        p2t[1] = tsg[1] + row2[0] * p2[0] + row2[1] * p2[1] + row2[2] * p2[2];
-        p2t[2] = tsg[2] + row3[0] * p2[0] + row3[1] * p2[1] + row3[2] * p2[2];
-
-        alpha_scene=atan2(-p2t[2], p2t[1]);
-
-        if ( alpha_scene != alpha_scene)
-        {
-          continue;
-        }
-
-        if (sin(alpha_scene)*p2t[2]<0.0)
-          alpha_scene=-alpha_scene;
-
-        alpha_scene=-alpha_scene;
-
-        hashnode_i* node = hashtableGetBucketHashed(hash_table, (hashValue));
-
-        while (node)
-        {
-          THash* tData = (THash*) node->data;
-          int corrI = (int)tData->i;
-          int ppfInd = (int)tData->ppfInd;
-          float* ppfCorrScene = ppf.ptr<float>(ppfInd);
-          double alpha_model = (double)ppfCorrScene[PPF_LENGTH-1];
-          double alpha = alpha_model - alpha_scene;
-
-          /*  Tolga Birdal's note: Map alpha to the indices:
-                  atan2 generates results in (-pi pi]
-                  That's why alpha should be in range [-2pi 2pi]
-                  So the quantization would be :
-                  numAngles * (alpha+2pi)/(4pi)
-                  */
-
-          //printf("%f\n", alpha);
-          int alpha_index = (int)(numAngles*(alpha + 2*M_PI) / (4*M_PI));
-
-          unsigned int accIndex = corrI * numAngles + alpha_index;
-
-          accumulator[accIndex]++;
-          node = node->next;
-        }
-      }
-    }
-
-    // Maximize the accumulator
-    for (unsigned int k = 0; k < n; k++)
-    {
-      for (int j = 0; j < numAngles; j++)
-      {
-        const unsigned int accInd = k*numAngles + j;
-        const unsigned int accVal = accumulator[ accInd ];
-        if (accVal > maxVotes)
-        {
-          maxVotes = accVal;
-          refIndMax = k;
-          alphaIndMax = j;
-        }
-
-#if !defined (_OPENMP)
-        accumulator[accInd ] = 0;
-#endif
-      }
-    }
-
-    // invert Tsg : Luckily rotation is orthogonal: Inverse = Transpose.
-    // We are not required to invert.
-    double tInv[3], tmg[3], Rmg[9];
-    matrixTranspose33(Rsg, RInv);
-    matrixProduct331(RInv, tsg, tInv);
-
-    double TsgInv[16] = { RInv[0], RInv[1], RInv[2], -tInv[0],
-                          RInv[3], RInv[4], RInv[5], -tInv[1],
-                          RInv[6], RInv[7], RInv[8], -tInv[2],
-                          0, 0, 0, 1
-                        };
-
-    // TODO : Compute pose
-    const float* fMax = sampled_pc.ptr<float>(refIndMax);
-    const double pMax[4] = {fMax[0], fMax[1], fMax[2], 1};
-    const double nMax[4] = {fMax[3], fMax[4], fMax[5], 1};
-
-    computeTransformRT(pMax, nMax, Rmg, tmg);
-    row2=&Rsg[3];
-    row3=&Rsg[6];
-
-    double Tmg[16] = { Rmg[0], Rmg[1], Rmg[2], tmg[0],
-                       Rmg[3], Rmg[4], Rmg[5], tmg[1],
-                       Rmg[6], Rmg[7], Rmg[8], tmg[2],
-                       0, 0, 0, 1
-                     };
-
-    // convert alpha_index to alpha
-    int alpha_index = alphaIndMax;
-    double alpha = (alpha_index*(4*M_PI))/numAngles-2*M_PI;
-
-    // Equation 2:
-    double Talpha[16]={0};
-    getUnitXRotation_44(alpha, Talpha);
-
-    double Temp[16]={0};
-    double rawPose[16]={0};
-    matrixProduct44(Talpha, Tmg, Temp);
-    matrixProduct44(TsgInv, Temp, rawPose);
-
-    Pose3DPtr pose(new Pose3D(alpha, refIndMax, maxVotes));
-    pose->updatePose(rawPose);
-    #if defined (_OPENMP)
-    #pragma omp critical
-    #endif
-    {
-      poseList.push_back(pose);
-    }
-
-#if defined (_OPENMP)
-    free(accumulator);
-#endif
-  }
+  // one pose for each scene reference point, at a fixed position so that the result does not
+  // depend on the scheduling of the threads
+  std::vector<Pose3DPtr> poseList((sampled.rows + sceneSamplingStep - 1) / sceneSamplingStep);
+  parallel_for_(Range(0, (int)poseList.size()),
+                PPFMatchBody(sampled, sceneSamplingStep, sampled_pc, ppf, hash_bucket_offsets, hash_nodes,
+                             angle_step, (float)distance_step, numAngles, poseList));
 
   // TODO : Make the parameters relative if not arguments.
   //double MinMatchScore = 0.5;
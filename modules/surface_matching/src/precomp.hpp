@@ -55,6 +55,7 @@ the use of this software, even if advised of the possibility of such damage.
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <map>
 
 #if defined (_OPENMP)
 #include<omp.h>
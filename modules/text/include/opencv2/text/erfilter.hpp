@@ -82,7 +82,7 @@ public:
     Rect rect;
     double raw_moments[2];     //!< order 1 raw moments to derive the centroid
     double central_moments[3]; //!< order 2 central moments to construct the covariance matrix
-    Ptr<std::deque<int> > crossings;//!< horizontal crossings
+    Ptr<std::deque<int> > crossings;//!< horizontal crossings (not filled by ERFilter, see med_crossings)
     float med_crossings;       //!< median of the crossings at three different height levels
 
     //! 2nd stage features
@@ -133,6 +133,13 @@ public:
         @param  stat :   The region to be classified
          */
         virtual double eval(const ERStat& stat) = 0; //const = 0; //TODO why cannot use const = 0 here?
+
+        /** @brief Classifies a set of regions at once, the default implementation calls eval for each one.
+
+        @param  stats :   The regions to be classified
+        @param  probabilities :   Output probability measure of each region
+         */
+        virtual void evalBatch(const std::vector<ERStat>& stats, std::vector<double>& probabilities);
     };
 
     /** @brief The key method of ERFilter algorithm.
@@ -371,6 +378,20 @@ CV_EXPORTS void MSERsToERStats(InputArray image, std::vector<std::vector<Point>
 // Utility funtion for scripting
 CV_EXPORTS_W void detectRegions(InputArray image, const Ptr<ERFilter>& er_filter1, const Ptr<ERFilter>& er_filter2, CV_OUT std::vector< std::vector<Point> >& regions);
 
+/** @brief Extracts the Extremal Regions of several channels in parallel.
+
+@param channels Single channel images CV_8UC1 (e.g. computed with computeNMChannels)
+@param er_filter1 Extremal Region Filter for the 1st stage classifier of N&M algorithm [Neumann12]
+@param er_filter2 Extremal Region Filter for the 2nd stage classifier of N&M algorithm [Neumann12], can be empty
+@param regions Output, the selected Extremal Regions of each channel, as the output of ERFilter::run
+
+The filters created with createERFilterNM1 and createERFilterNM2 are copied for every channel so the
+channels are processed concurrently, their callbacks must then be safe to call from several threads.
+Other filters are run sequentially on the channels.
+ */
+CV_EXPORTS void detectRegions(InputArrayOfArrays channels, const Ptr<ERFilter>& er_filter1, const Ptr<ERFilter>& er_filter2,
+                              CV_OUT std::vector< std::vector<ERStat> >& regions);
+
 
 /** @brief Extracts text regions from image.
 
@@ -145,6 +145,27 @@ public:
 
     CV_WRAP virtual void setWhiteList(const String& char_whitelist) = 0;
 
+    /** @brief Recognize text in several regions of the same image.
+
+    The image is given to tesseract-ocr once and every region is recognized in place, without copying it.
+
+    @param image Input image CV_8UC1 or CV_8UC3
+    @param rois The regions of the image to be recognized.
+    @param output_texts Output text of each region.
+    @param component_rects If provided the method will output for each region the list of Rects for the
+    individual text elements found, in image coordinates.
+    @param component_texts If provided the method will output for each region the list of text strings of
+    the individual text elements found.
+    @param component_confidences If provided the method will output for each region the list of confidence
+    values of the individual text elements found.
+    @param component_level OCR_LEVEL_WORD (by default), or OCR_LEVEL_TEXT_LINE.
+     */
+    virtual void runRegions(Mat& image, const std::vector<Rect>& rois, std::vector<std::string>& output_texts,
+                            std::vector< std::vector<Rect> >* component_rects=NULL,
+                            std::vector< std::vector<std::string> >* component_texts=NULL,
+                            std::vector< std::vector<float> >* component_confidences=NULL,
+                            int component_level=0);
+
 
     /** @brief Creates an instance of the OCRTesseract class. Initializes Tesseract.
 
@@ -164,6 +185,46 @@ public:
                                     const char* char_whitelist=NULL, int oem=OEM_DEFAULT, int psmode=PSM_AUTO);
 };
 
+/** @brief OCRTesseractPool keeps a set of initialized OCRTesseract engines to be used concurrently.
+
+An OCRTesseract instance is expensive to create and can be used by only one thread at a time. The pool
+hands out its engines to the callers, and creates a new one when all of them are in use. The engines
+go back to the pool when the last copy of the returned pointer is released, so they must not outlive
+the pool.
+ */
+class CV_EXPORTS OCRTesseractPool
+{
+public:
+    virtual ~OCRTesseractPool() {}
+
+    /** @brief Returns an engine that is not used by any other caller. */
+    virtual Ptr<OCRTesseract> acquire() = 0;
+
+    /** @brief Number of engines of the pool, in use or not. */
+    virtual int size() const = 0;
+
+    /** @brief Recognize text in several regions of the same image, distributed among the engines of the pool.
+
+    The parameters are the same as in OCRTesseract::runRegions.
+     */
+    virtual void runRegions(Mat& image, const std::vector<Rect>& rois, std::vector<std::string>& output_texts,
+                            std::vector< std::vector<Rect> >* component_rects=NULL,
+                            std::vector< std::vector<std::string> >* component_texts=NULL,
+                            std::vector< std::vector<float> >* component_confidences=NULL,
+                            int component_level=0) = 0;
+
+    /** @brief Sets the list of characters used for recognition of all the engines, none of them must be in use. */
+    virtual void setWhiteList(const String& char_whitelist) = 0;
+
+    /** @brief Creates a pool of engines initialized as in OCRTesseract::create.
+
+    @param num_engines Number of engines created up front, usually the number of threads doing recognition.
+    The other parameters are the same as in OCRTesseract::create.
+     */
+    static Ptr<OCRTesseractPool> create(int num_engines, const char* datapath=NULL, const char* language=NULL,
+                                        const char* char_whitelist=NULL, int oem=OEM_DEFAULT, int psmode=PSM_AUTO);
+};
+
 
 /* OCR HMM Decoder */
 
@@ -212,6 +273,15 @@ public:
         corresponding to each classes in out_class.
          */
         virtual void eval( InputArray image, std::vector<int>& out_class, std::vector<double>& out_confidence);
+
+        /** @brief Classifies all the letters of a word at once, the default implementation calls eval for each one
+
+        @param images Input images CV_8UC1 or CV_8UC3, each one with a single letter.
+        @param out_classes For each image the list of class labels, as returned by eval.
+        @param out_confidences For each image the probabilities of its classes, as returned by eval.
+         */
+        virtual void evalBatch( InputArrayOfArrays images, std::vector< std::vector<int> >& out_classes,
+                                std::vector< std::vector<double> >& out_confidences );
     };
 
 public:
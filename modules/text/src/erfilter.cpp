@@ -67,27 +67,6 @@ using namespace cv::ml;
 using namespace std;
 using namespace cv::ml;
 
-// Deletes a tree of ERStat regions starting at root. Used only
-// internally to this implementation.
-static void deleteERStatTree(ERStat* root) {
-    queue<ERStat*> to_delete;
-    to_delete.push(root);
-    while (!to_delete.empty()) {
-        ERStat* n = to_delete.front();
-        to_delete.pop();
-        ERStat* c = n->child;
-        if (c != NULL) {
-            to_delete.push(c);
-            ERStat* sibling = c->next;
-            while (sibling != NULL) {
-                to_delete.push(sibling);
-                sibling = sibling->next;
-            }
-        }
-        delete n;
-    }
-}
-
 ERStat::ERStat(int init_level, int init_pixel, int init_x, int init_y) : pixel(init_pixel),
                level(init_level), area(0), perimeter(0), euler(0), probability(1.0),
                parent(0), child(0), next(0), prev(0), local_maxima(0),
@@ -99,11 +78,99 @@ ERStat::ERStat(int init_level, int init_pixel, int init_x, int init_y) : pixel(i
     central_moments[0] = 0.0;
     central_moments[1] = 0.0;
     central_moments[2] = 0.0;
-    crossings = makePtr<deque<int> >();
-    crossings->push_back(0);
 }
 
 
+// Storage of the ERStat nodes of the component tree, allocated by blocks that are kept
+// from one image to the next. All the nodes are released at once by reset().
+class ERStatPool
+{
+public:
+    ERStatPool() : used(0) {}
+    ~ERStatPool()
+    {
+        for (size_t i = 0; i < blocks.size(); i++)
+            delete[] blocks[i];
+    }
+
+    ERStat* create(int level = 256, int pixel = 0, int x = 0, int y = 0)
+    {
+        if (used == blocks.size() * BLOCK_SIZE)
+            blocks.push_back(new ERStat[BLOCK_SIZE]);
+        ERStat* stat = &blocks[used / BLOCK_SIZE][used % BLOCK_SIZE];
+        *stat = ERStat(level, pixel, x, y);
+        used++;
+        return stat;
+    }
+
+    void reset() { used = 0; }
+
+private:
+    enum { BLOCK_SIZE = 4096 };
+    vector<ERStat*> blocks;
+    size_t used;
+
+    ERStatPool(const ERStatPool&);
+    ERStatPool& operator=(const ERStatPool&);
+};
+
+// Horizontal crossings of the rows of a region being extracted, growing at both ends.
+// The buffers are reused for the regions of the component stack.
+class ERCrossings
+{
+public:
+    ERCrossings() : first(0), last(0) {}
+
+    void reset()
+    {
+        first = last = (int)data.size() / 2;
+        push_back(0);
+    }
+
+    int size() const { return last - first; }
+    int& at(int i) { return data[first + i]; }
+
+    void push_front(int value)
+    {
+        if (first == 0)
+            grow();
+        data[--first] = value;
+    }
+
+    void push_back(int value)
+    {
+        if (last == (int)data.size())
+            grow();
+        data[last++] = value;
+    }
+
+    void swap(ERCrossings& other)
+    {
+        data.swap(other.data);
+        std::swap(first, other.first);
+        std::swap(last, other.last);
+    }
+
+private:
+    // doubles the capacity and centers the content
+    void grow()
+    {
+        const int count = last - first;
+        const int capacity = std::max(16, 2 * (int)data.size());
+        vector<int> grown(capacity);
+        const int new_first = (capacity - count) / 2;
+        if (count > 0)
+            std::copy(data.begin() + first, data.begin() + last, grown.begin() + new_first);
+        data.swap(grown);
+        first = new_first;
+        last = new_first + count;
+    }
+
+    vector<int> data;
+    int first, last;
+};
+
+
 // derivative classes
 
 
@@ -124,6 +191,9 @@ public:
     // input/output - for the second one.
     void run( InputArray image, vector<ERStat>& regions );
 
+    // a new filter with the same parameters and classifier, to be run concurrently with this one
+    Ptr<ERFilterNM> clone() const;
+
 protected:
     int thresholdDelta;
     float maxArea;
@@ -153,17 +223,27 @@ private:
     // image mask used for feature calculations
     Mat region_mask;
 
+    // nodes of the component tree
+    ERStatPool er_pool;
+    // horizontal crossings of the regions of the component stack, and of the last region popped from it
+    vector<ERCrossings> crossings_stack;
+    ERCrossings child_crossings;
+
     // extract the component tree and store all the ER regions
     void er_tree_extract( InputArray image );
+    // push a new component in the component stack
+    void er_push( vector<ERStat*>& er_stack, ERStat *er );
     // accumulate a pixel into an ER
-    void er_add_pixel( ERStat *parent, int x, int y, int non_boundary_neighbours,
+    void er_add_pixel( ERStat *parent, ERCrossings& parent_crossings, int x, int y, int non_boundary_neighbours,
                        int non_boundary_neighbours_horiz,
                        int d_C1, int d_C2, int d_C3 );
     // merge an ER with its nested parent
-    void er_merge( ERStat *parent, ERStat *child );
+    void er_merge( ERStat *parent, ERCrossings& parent_crossings, ERStat *child, ERCrossings& child_crossings );
     // copy extracted regions into the output vector
     ERStat* er_save( ERStat *er, ERStat *parent, ERStat *prev );
-    // recursively walk the tree and filter (remove) regions using the callback classifier
+    // calculate the 2nd stage features and the probabilities of all the regions of the tree
+    void er_tree_features( InputArray image, ERStat *root );
+    // recursively walk the tree and filter (remove) regions using the computed probabilities
     ERStat* er_tree_filter( InputArray image, ERStat *stat, ERStat *parent, ERStat *prev );
     // recursively walk the tree selecting only regions with local maxima probability
     ERStat* er_tree_nonmax_suppression( ERStat *er, ERStat *parent, ERStat *prev );
@@ -181,6 +261,8 @@ public:
 
     // The classifier must return probability measure for the region.
     double eval(const ERStat& stat);
+    // The probability measures of a set of regions, classified at once.
+    void evalBatch(const vector<ERStat>& stats, vector<double>& probabilities);
 
 private:
     Ptr<Boost> boost;
@@ -197,6 +279,8 @@ public:
 
     // The classifier must return probability measure for the region.
     double eval(const ERStat& stat);
+    // The probability measures of a set of regions, classified at once.
+    void evalBatch(const vector<ERStat>& stats, vector<double>& probabilities);
 
 private:
     Ptr<Boost> boost;
@@ -219,6 +303,19 @@ ERFilterNM::ERFilterNM()
     num_rejected_regions = 0;
 }
 
+Ptr<ERFilterNM> ERFilterNM::clone() const
+{
+    Ptr<ERFilterNM> filter = makePtr<ERFilterNM>();
+    filter->classifier = classifier;
+    filter->thresholdDelta = thresholdDelta;
+    filter->minArea = minArea;
+    filter->maxArea = maxArea;
+    filter->minProbability = minProbability;
+    filter->nonMaxSuppression = nonMaxSuppression;
+    filter->minProbabilityDiff = minProbabilityDiff;
+    return filter;
+}
+
 // the key method. Takes image on input, vector of ERStat is output for the first stage,
 // input/output for the second one.
 void ERFilterNM::run( InputArray image, vector<ERStat>& _regions )
@@ -251,6 +348,7 @@ void ERFilterNM::run( InputArray image, vector<ERStat>& _regions )
         vector<ERStat> aux_regions;
         regions->swap(aux_regions);
         regions->reserve(aux_regions.size());
+        er_tree_features( image, &aux_regions.front() );
         er_tree_filter( image, &aux_regions.front(), NULL, NULL );
         aux_regions.clear();
     }
@@ -299,7 +397,8 @@ void ERFilterNM::er_tree_extract( InputArray image )
     vector<int> boundary_edges[256];
 
     // add a dummy-component before start
-    er_stack.push_back(new ERStat);
+    er_pool.reset();
+    er_push(er_stack, er_pool.create());
 
     // we'll look initially for all pixels with grey-level lower than a grey-level higher than any allowed in the image
     int threshold_level = (255/thresholdDelta)+1;
@@ -319,7 +418,7 @@ void ERFilterNM::er_tree_extract( InputArray image )
 
         // push a component with current level in the component stack
         if (push_new_component)
-            er_stack.push_back(new ERStat(current_level, current_pixel, x, y));
+            er_push(er_stack, er_pool.create(current_level, current_pixel, x, y));
         push_new_component = false;
 
         // explore the (remaining) edges to the neighbors to the current pixel
@@ -505,7 +604,8 @@ void ERFilterNM::er_tree_extract( InputArray image )
         int d_C2 = C_after[1]-C_before[1];
         int d_C3 = C_after[2]-C_before[2];
 
-        er_add_pixel(er_stack.back(), x, y, non_boundary_neighbours, non_boundary_neighbours_horiz, d_C1, d_C2, d_C3);
+        er_add_pixel(er_stack.back(), crossings_stack[er_stack.size()-1], x, y,
+                     non_boundary_neighbours, non_boundary_neighbours_horiz, d_C1, d_C2, d_C3);
         accumulated_pixel_mask[current_pixel] = true;
 
         // if we have processed all the possible threshold levels (the hea is empty) we are done!
@@ -516,17 +616,9 @@ void ERFilterNM::er_tree_extract( InputArray image )
             regions->reserve(num_accepted_regions+1);
             er_save(er_stack.back(), NULL, NULL);
 
-            // clean memory
-            for (size_t r=0; r<er_stack.size(); r++)
-            {
-                ERStat *stat = er_stack.at(r);
-                if (stat->crossings)
-                {
-                    stat->crossings.release();
-                }
-                deleteERStatTree(stat);
-            }
+            // clean memory, the nodes are kept for the next image
             er_stack.clear();
+            er_pool.reset();
 
             return;
         }
@@ -554,15 +646,16 @@ void ERFilterNM::er_tree_extract( InputArray image )
             {
                 ERStat* er = er_stack.back();
                 er_stack.erase(er_stack.end()-1);
+                child_crossings.swap(crossings_stack[er_stack.size()]);
 
                 if (new_level < er_stack.back()->level)
                 {
-                    er_stack.push_back(new ERStat(new_level, current_pixel, current_pixel%width, current_pixel/width));
-                    er_merge(er_stack.back(), er);
+                    er_push(er_stack, er_pool.create(new_level, current_pixel, current_pixel%width, current_pixel/width));
+                    er_merge(er_stack.back(), crossings_stack[er_stack.size()-1], er, child_crossings);
                     break;
                 }
 
-                er_merge(er_stack.back(), er);
+                er_merge(er_stack.back(), crossings_stack[er_stack.size()-1], er, child_crossings);
             }
 
         }
@@ -570,23 +663,32 @@ void ERFilterNM::er_tree_extract( InputArray image )
     }
 }
 
+// push a new component in the component stack, with its crossings initialized
+void ERFilterNM::er_push( vector<ERStat*>& er_stack, ERStat *er )
+{
+    er_stack.push_back(er);
+    if (crossings_stack.size() < er_stack.size())
+        crossings_stack.resize(er_stack.size());
+    crossings_stack[er_stack.size()-1].reset();
+}
+
 // accumulate a pixel into an ER
-void ERFilterNM::er_add_pixel(ERStat *parent, int x, int y, int non_border_neighbours,
+void ERFilterNM::er_add_pixel(ERStat *parent, ERCrossings& parent_crossings, int x, int y, int non_border_neighbours,
                                                             int non_border_neighbours_horiz,
                                                             int d_C1, int d_C2, int d_C3)
 {
     parent->area++;
     parent->perimeter += 4 - 2*non_border_neighbours;
 
-    if (parent->crossings->size()>0)
+    if (parent_crossings.size()>0)
     {
-        if (y<parent->rect.y) parent->crossings->push_front(2);
-        else if (y>parent->rect.br().y-1) parent->crossings->push_back(2);
+        if (y<parent->rect.y) parent_crossings.push_front(2);
+        else if (y>parent->rect.br().y-1) parent_crossings.push_back(2);
         else {
-            parent->crossings->at(y - parent->rect.y) += 2-2*non_border_neighbours_horiz;
+            parent_crossings.at(y - parent->rect.y) += 2-2*non_border_neighbours_horiz;
         }
     } else {
-        parent->crossings->push_back(2);
+        parent_crossings.push_back(2);
     }
 
     parent->euler += (d_C1 - d_C2 + 2*d_C3) / 4;
@@ -609,7 +711,7 @@ void ERFilterNM::er_add_pixel(ERStat *parent, int x, int y, int non_border_neigh
 }
 
 // merge an ER with its nested parent
-void ERFilterNM::er_merge(ERStat *parent, ERStat *child)
+void ERFilterNM::er_merge(ERStat *parent, ERCrossings& parent_crossings, ERStat *child, ERCrossings& child_crossings)
 {
 
     parent->area += child->area;
@@ -619,19 +721,19 @@ void ERFilterNM::er_merge(ERStat *parent, ERStat *child)
 
     for (int i=parent->rect.y; i<=min(parent->rect.br().y-1,child->rect.br().y-1); i++)
         if (i-child->rect.y >= 0)
-            parent->crossings->at(i-parent->rect.y) += child->crossings->at(i-child->rect.y);
+            parent_crossings.at(i-parent->rect.y) += child_crossings.at(i-child->rect.y);
 
     for (int i=parent->rect.y-1; i>=child->rect.y; i--)
-        if (i-child->rect.y < (int)child->crossings->size())
-            parent->crossings->push_front(child->crossings->at(i-child->rect.y));
+        if (i-child->rect.y < child_crossings.size())
+            parent_crossings.push_front(child_crossings.at(i-child->rect.y));
         else
-            parent->crossings->push_front(0);
+            parent_crossings.push_front(0);
 
     for (int i=parent->rect.br().y; i<child->rect.y; i++)
-        parent->crossings->push_back(0);
+        parent_crossings.push_back(0);
 
     for (int i=max(parent->rect.br().y,child->rect.y); i<=child->rect.br().y-1; i++)
-        parent->crossings->push_back(child->crossings->at(i-child->rect.y));
+        parent_crossings.push_back(child_crossings.at(i-child->rect.y));
 
     parent->euler += child->euler;
 
@@ -651,15 +753,12 @@ void ERFilterNM::er_merge(ERStat *parent, ERStat *child)
     parent->central_moments[1] += child->central_moments[1];
     parent->central_moments[2] += child->central_moments[2];
 
-    vector<int> m_crossings;
-    m_crossings.push_back(child->crossings->at((int)(child->rect.height)/6));
-    m_crossings.push_back(child->crossings->at((int)3*(child->rect.height)/6));
-    m_crossings.push_back(child->crossings->at((int)5*(child->rect.height)/6));
-    sort(m_crossings.begin(), m_crossings.end());
-    child->med_crossings = (float)m_crossings.at(1);
-
-    // free unnecessary mem
-    child->crossings.release();
+    int m_crossings[3];
+    m_crossings[0] = child_crossings.at((int)(child->rect.height)/6);
+    m_crossings[1] = child_crossings.at((int)3*(child->rect.height)/6);
+    m_crossings[2] = child_crossings.at((int)5*(child->rect.height)/6);
+    sort(m_crossings, m_crossings + 3);
+    child->med_crossings = (float)m_crossings[1];
 
     // recover the original grey-level
     child->level = child->level*thresholdDelta;
@@ -702,13 +801,6 @@ void ERFilterNM::er_merge(ERStat *parent, ERStat *child)
             parent->child   = child->child;
             child->child->parent = parent;
         }
-
-        // free mem
-        if(child->crossings)
-        {
-            child->crossings.release();
-        }
-        delete(child);
     }
 
 }
@@ -778,15 +870,12 @@ ERStat* ERFilterNM::er_save( ERStat *er, ERStat *parent, ERStat *prev )
 }
 
 // recursively walk the tree and filter (remove) regions using the callback classifier
-ERStat* ERFilterNM::er_tree_filter ( InputArray image, ERStat * stat, ERStat *parent, ERStat *prev )
+// calculate the 2nd stage features of a region, mask_buf is a scratch buffer
+static void er_stage2_features( const Mat& src, ERStat *stat, Mat& mask_buf )
 {
-    // assert correct image type
-    CV_Assert( image.type() == CV_8UC1 );
-
-    Mat src = image.getMat();
-
+    mask_buf.create(1, (stat->rect.width+2)*(stat->rect.height+2), CV_8UC1);
     //Fill the region and calculate 2nd stage features
-    Mat region = region_mask(Rect(stat->rect.tl(), stat->rect.br() + Point(2,2)));
+    Mat region(stat->rect.height+2, stat->rect.width+2, CV_8UC1, mask_buf.ptr());
     region = Scalar(0);
     int newMaskVal = 255;
     int flags = 4 + (newMaskVal << 8) + FLOODFILL_FIXED_RANGE + FLOODFILL_MASK_ONLY;
@@ -855,14 +944,72 @@ ERStat* ERFilterNM::er_tree_filter ( InputArray image, ERStat * stat, ERStat *pa
     stat->hole_area_ratio = (float)holes_area / stat->area;
     stat->convex_hull_ratio = (float)hull_area / (float)contourArea(contours[0]);
     stat->num_inflexion_points = (float)num_inflexion_points;
+}
 
+// calculate the 2nd stage features of a set of regions
+class ERStage2FeaturesBody : public ParallelLoopBody
+{
+public:
+    ERStage2FeaturesBody(const Mat& _src, vector<ERStat*>& _stats) : src(_src), stats(_stats) {}
 
-    // calculate P(child|character) and filter if possible
-    if ( (classifier != NULL) && (stat->parent != NULL) )
+    void operator()( const Range& r ) const
     {
-        stat->probability = classifier->eval(*stat);
+        Mat mask_buf;
+        for (int i = r.start; i < r.end; i++)
+            er_stage2_features(src, stats[i], mask_buf);
     }
 
+private:
+    const Mat& src;
+    vector<ERStat*>& stats;
+
+    ERStage2FeaturesBody& operator=(const ERStage2FeaturesBody&);
+};
+
+// calculate the 2nd stage features of all the regions of the tree in parallel,
+// then P(child|character) of all of them at once
+void ERFilterNM::er_tree_features( InputArray image, ERStat *root )
+{
+    // assert correct image type
+    CV_Assert( image.type() == CV_8UC1 );
+
+    Mat src = image.getMat();
+
+    vector<ERStat*> stats;
+    vector<ERStat*> to_visit(1, root);
+    while (!to_visit.empty())
+    {
+        ERStat *stat = to_visit.back();
+        to_visit.pop_back();
+        stats.push_back(stat);
+        for (ERStat * child = stat->child; child; child = child->next)
+            to_visit.push_back(child);
+    }
+
+    parallel_for_(Range(0, (int)stats.size()), ERStage2FeaturesBody(src, stats));
+
+    if (classifier == NULL)
+        return;
+
+    vector<ERStat> samples;
+    samples.reserve(stats.size());
+    for (size_t i = 0; i < stats.size(); i++)
+        if (stats[i]->parent != NULL)
+            samples.push_back(*stats[i]);
+
+    vector<double> probabilities;
+    classifier->evalBatch(samples, probabilities);
+    CV_Assert( probabilities.size() == samples.size() );
+
+    for (size_t i = 0, k = 0; i < stats.size(); i++)
+        if (stats[i]->parent != NULL)
+            stats[i]->probability = probabilities[k++];
+}
+
+ERStat* ERFilterNM::er_tree_filter ( InputArray image, ERStat * stat, ERStat *parent, ERStat *prev )
+{
+    // the 2nd stage features and P(child|character) have been computed by er_tree_features
+
     if ( ( ((classifier != NULL)?(stat->probability >= minProbability):true) &&
           ((stat->area >= minArea*region_mask.rows*region_mask.cols) &&
            (stat->area <= maxArea*region_mask.rows*region_mask.cols)) ) ||
@@ -1024,18 +1171,66 @@ ERClassifierNM1::ERClassifierNM1(const string& filename)
         CV_Error(Error::StsBadArg, "Default classifier file not found!");
 }
 
+// the 1st stage features of a region
+static inline void er_features_NM1(const ERStat& stat, float* sample)
+{
+    sample[0] = (float)(stat.rect.width)/(stat.rect.height); // aspect ratio
+    sample[1] = sqrt((float)(stat.area))/stat.perimeter; // compactness
+    sample[2] = (float)(1-stat.euler); //number of holes
+    sample[3] = stat.med_crossings;
+}
+
+// the 2nd stage features of a region
+static inline void er_features_NM2(const ERStat& stat, float* sample)
+{
+    er_features_NM1(stat, sample);
+    sample[4] = stat.hole_area_ratio;
+    sample[5] = stat.convex_hull_ratio;
+    sample[6] = stat.num_inflexion_points;
+}
+
+// Logistic Correction returns a probability value (in the range(0,1))
+static inline double er_votes_probability(float votes)
+{
+    return (double)1-(double)1/(1+exp(-2*votes));
+}
+
+// classify all the regions with a single prediction call
+static void er_eval_batch(const Ptr<Boost>& boost, void (*features)(const ERStat&, float*), int num_features,
+                          const vector<ERStat>& stats, vector<double>& probabilities)
+{
+    probabilities.resize(stats.size());
+    if (stats.empty())
+        return;
+
+    Mat samples((int)stats.size(), num_features, CV_32FC1);
+    for (int i = 0; i < samples.rows; i++)
+        features(stats[i], samples.ptr<float>(i));
+
+    Mat votes;
+    boost->predict( samples, votes, DTrees::PREDICT_SUM | StatModel::RAW_OUTPUT);
+    CV_Assert( votes.type() == CV_32FC1 && votes.total() == stats.size() );
+
+    const float* pvotes = votes.ptr<float>();
+    for (size_t i = 0; i < stats.size(); i++)
+        probabilities[i] = er_votes_probability(pvotes[i]);
+}
+
 double ERClassifierNM1::eval(const ERStat& stat)
 {
     //Classify
-    Mat sample = (Mat_<float>(1,4) <<  (float)(stat.rect.width)/(stat.rect.height), // aspect ratio
-                     sqrt((float)(stat.area))/stat.perimeter, // compactness
-                     (float)(1-stat.euler), //number of holes
-                     stat.med_crossings);
+    float features[4];
+    er_features_NM1(stat, features);
+    Mat sample(1, 4, CV_32FC1, features);
 
     float votes = boost->predict( sample, noArray(), DTrees::PREDICT_SUM | StatModel::RAW_OUTPUT);
 
-    // Logistic Correction returns a probability value (in the range(0,1))
-    return (double)1-(double)1/(1+exp(-2*votes));
+    return er_votes_probability(votes);
+}
+
+void ERClassifierNM1::evalBatch(const vector<ERStat>& stats, vector<double>& probabilities)
+{
+    er_eval_batch(boost, er_features_NM1, 4, stats, probabilities);
 }
 
 
@@ -1058,16 +1253,26 @@ ERClassifierNM2::ERClassifierNM2(const string& filename)
 double ERClassifierNM2::eval(const ERStat& stat)
 {
     //Classify
-    Mat sample = (Mat_<float>(1,7) << (float)(stat.rect.width)/(stat.rect.height), // aspect ratio
-                     sqrt((float)(stat.area))/stat.perimeter, // compactness
-                     (float)(1-stat.euler), //number of holes
-                     stat.med_crossings, stat.hole_area_ratio,
-                     stat.convex_hull_ratio, stat.num_inflexion_points);
+    float features[7];
+    er_features_NM2(stat, features);
+    Mat sample(1, 7, CV_32FC1, features);
 
     float votes = boost->predict( sample, noArray(), DTrees::PREDICT_SUM | StatModel::RAW_OUTPUT);
 
-    // Logistic Correction returns a probability value (in the range(0,1))
-    return (double)1-(double)1/(1+exp(-2*votes));
+    return er_votes_probability(votes);
+}
+
+void ERClassifierNM2::evalBatch(const vector<ERStat>& stats, vector<double>& probabilities)
+{
+    er_eval_batch(boost, er_features_NM2, 7, stats, probabilities);
+}
+
+// the default batched classification evaluates the regions one by one
+void ERFilter::Callback::evalBatch(const vector<ERStat>& stats, vector<double>& probabilities)
+{
+    probabilities.resize(stats.size());
+    for (size_t i = 0; i < stats.size(); i++)
+        probabilities[i] = eval(stats[i]);
 }
 
 
@@ -1392,16 +1597,33 @@ static double log_gamma_windschitl(double x)
 */
 #define log_gamma(x) ((x)>15.0?log_gamma_windschitl(x):log_gamma_lanczos(x))
 
-// Size of the table to store already computed inverse values.
-#define TABSIZE 100000
+/*
+     Logarithms of the factorials and inverses of the integers up to a maximal n,
+     computed once for all the NFA evaluations of a clustering.
+*/
+struct NFATable
+{
+    vector<double> log_factorial; /* log_factorial[i] = log_gamma(i+1) */
+    vector<double> inv;           /* inv[i] = 1/i */
+
+    NFATable(int n) : log_factorial(n+1), inv(n+1)
+    {
+        inv[0] = 0.0;
+        for (int i = 0; i <= n; i++)
+        {
+            log_factorial[i] = log_gamma( (double) i + 1.0 );
+            if (i > 0)
+                inv[i] = 1.0 / (double) i;
+        }
+    }
+};
 
 /*
      Computes -log10(NFA).
      NFA stands for Number of False Alarms:
 */
-static double NFA(int n, int k, double p, double logNT)
+static double NFA(int n, int k, double p, double logNT, const NFATable& table)
 {
-    static double inv[TABSIZE];   /* table to keep computed inverse values */
     double tolerance = 0.1;       /* an error of 10% in the result is accepted */
     double log1term,term,bin_term,mult_term,bin_tail,err,p_term;
     int i;
@@ -1412,7 +1634,7 @@ static double NFA(int n, int k, double p, double logNT)
         p = 1 - std::numeric_limits<double>::epsilon();
 
     /* check parameters */
-    if( n<0 || k<0 || k>n || p<=0.0 || p>=1.0 )
+    if( n<0 || k<0 || k>n || p<=0.0 || p>=1.0 || n>=(int)table.inv.size() )
     {
         CV_Error(Error::StsBadArg, "erGrouping wrong n, k or p values in NFA call!");
     }
@@ -1425,8 +1647,7 @@ static double NFA(int n, int k, double p, double logNT)
     p_term = p / (1.0-p);
 
     /* compute the first term of the series */
-    log1term = log_gamma( (double) n + 1.0 ) - log_gamma( (double) k + 1.0 )
-               - log_gamma( (double) (n-k) + 1.0 )
+    log1term = table.log_factorial[n] - table.log_factorial[k] - table.log_factorial[n-k]
                + (double) k * log(p) + (double) (n-k) * log(1.0-p);
     term = exp(log1term);
 
@@ -1443,9 +1664,7 @@ static double NFA(int n, int k, double p, double logNT)
     bin_tail = term;
     for(i=k+1;i<=n;i++)
     {
-        bin_term = (double) (n-i+1) * ( i<TABSIZE ?
-                    ( inv[i]!=0.0 ? inv[i] : ( inv[i] = 1.0 / (double) i ) ) :
-                    1.0 / (double) i );
+        bin_term = (double) (n-i+1) * table.inv[i];
 
         mult_term = bin_term * p_term;
         term *= mult_term;
@@ -1476,6 +1695,9 @@ public:
     // copies p to the internal point set
     void check_in (vector<float> *p);
 
+    // copies the point set of another box to the internal point set
+    void check_in (const Minibox& box);
+
     // returns the volume of the box
     long double volume();
 };
@@ -1500,6 +1722,23 @@ void Minibox::check_in (vector<float> *p)
     }
 }
 
+void Minibox::check_in (const Minibox& box)
+{
+    if (!box.initialized)
+        return;
+    if (!initialized)
+    {
+        edge_begin = box.edge_begin;
+        edge_end = box.edge_end;
+        initialized = true;
+    }
+    else for (int i=0; i<(int)edge_begin.size(); i++)
+    {
+        edge_begin.at(i) = min(box.edge_begin.at(i),edge_begin.at(i));
+        edge_end.at(i) = max(box.edge_end.at(i),edge_end.at(i));
+    }
+}
+
 long double Minibox::volume ()
 {
     long double volume_ = 1;
@@ -1854,6 +2093,53 @@ static void NN_chain_core(const int_fast32_t N, double * const D, t_members * co
    Clustering methods for vector data
 */
 
+/*
+     Updates the distances of a block of chunks of the active nodes to the tree with the
+     last node added to it, and finds the closest active node of each chunk.
+*/
+template <typename t_dissimilarity>
+class MSTUpdateBody : public ParallelLoopBody
+{
+public:
+    MSTUpdateBody(const t_dissimilarity& _dist, const int_fast32_t* _active, double* _d, int_fast32_t _num_active,
+                  int_fast32_t _node, int_fast32_t _chunk, double* _chunk_min, int_fast32_t* _chunk_pos) :
+        dist(_dist), active(_active), d(_d), num_active(_num_active), node(_node), chunk(_chunk),
+        chunk_min(_chunk_min), chunk_pos(_chunk_pos) {}
+
+    void operator()(const Range& r) const
+    {
+        for (int c = r.start; c < r.end; c++)
+        {
+            int_fast32_t begin = c*chunk, end = std::min(begin+chunk, num_active);
+            double min = d[begin];
+            int_fast32_t pos = -1;
+            for (int_fast32_t i = begin; i < end; i++)
+            {
+                double tmp = dist(active[i], node);
+                if (d[i] > tmp)
+                    d[i] = tmp;
+                if (pos < 0 || d[i] < min || min != min) // eliminate NaNs if possible
+                {
+                    min = d[i];
+                    pos = i;
+                }
+            }
+            chunk_min[c] = min;
+            chunk_pos[c] = pos;
+        }
+    }
+
+private:
+    const t_dissimilarity& dist;
+    const int_fast32_t* active;
+    double* d;
+    int_fast32_t num_active, node, chunk;
+    double* chunk_min;
+    int_fast32_t* chunk_pos;
+
+    MSTUpdateBody& operator=(const MSTUpdateBody&);
+};
+
 template <typename t_dissimilarity>
 static void MST_linkage_core_vector(const int_fast32_t N,
                                     t_dissimilarity & dist,
@@ -1864,62 +2150,50 @@ static void MST_linkage_core_vector(const int_fast32_t N,
      N: integer, number of data points
      dist: function pointer to the metric
      Z2: output data structure
-*/
-    int_fast32_t i;
-    int_fast32_t idx2;
-    doubly_linked_list active_nodes(N);
-    auto_array_ptr<double> d(N);
 
-    int_fast32_t prev_node;
-    double min;
-
-    // first iteration
-    idx2 = 1;
-    min = d[1] = dist(0,1);
-    for (i=2; min!=min && i<N; i++) // eliminate NaNs if possible
-    {
-        min = d[i] = dist(0,i);
-        idx2 = i;
-    }
+     The active nodes and their distances to the tree are kept in contiguous arrays
+     (in increasing order, so ties are broken as before), and the distances of large
+     sets of active nodes are updated in parallel.
+*/
+    const int_fast32_t chunk = 4096;
 
-    for ( ; i<N; i++)
-    {
-        d[i] = dist(0,i);
-        if (d[i] < min)
-        {
-            min = d[i];
-            idx2 = i;
-        }
-    }
+    vector<int_fast32_t> active(N-1);
+    vector<double> d(N-1, std::numeric_limits<double>::infinity());
+    for (int_fast32_t i=1; i<N; i++)
+        active[i-1] = i;
 
-    Z2.append(0, idx2, min);
+    const int_fast32_t max_chunks = (N-1+chunk-1)/chunk;
+    vector<double> chunk_min(max_chunks);
+    vector<int_fast32_t> chunk_pos(max_chunks);
 
-    for (int_fast32_t j=1; j<N-1; j++)
+    int_fast32_t node = 0;
+    for (int_fast32_t j=0; j<N-1; j++)
     {
-        prev_node = idx2;
-        active_nodes.remove(prev_node);
-
-        idx2 = active_nodes.succ[0];
-        min = d[idx2];
-
-        for (i=idx2; min!=min && i<N; i=active_nodes.succ[i]) // eliminate NaNs if possible
-        {
-            min = d[i] = dist(i, prev_node);
-            idx2 = i;
-        }
+        const int_fast32_t num_active = (int_fast32_t)active.size();
+        const int_fast32_t num_chunks = (num_active+chunk-1)/chunk;
+        MSTUpdateBody<t_dissimilarity> body(dist, &active[0], &d[0], num_active, node, chunk,
+                                            &chunk_min[0], &chunk_pos[0]);
+        if (num_chunks > 1)
+            parallel_for_(Range(0, (int)num_chunks), body);
+        else
+            body(Range(0, 1));
 
-        for ( ; i<N; i=active_nodes.succ[i])
+        double min = chunk_min[0];
+        int_fast32_t pos = chunk_pos[0];
+        for (int_fast32_t c=1; c<num_chunks; c++)
         {
-            double tmp = dist(i, prev_node);
-            if (d[i] > tmp)
-                d[i] = tmp;
-            if (d[i] < min)
+            if (chunk_min[c] < min || min != min)
             {
-                min = d[i];
-                idx2 = i;
+                min = chunk_min[c];
+                pos = chunk_pos[c];
             }
         }
-        Z2.append(prev_node, idx2, min);
+
+        int_fast32_t next = active[pos];
+        Z2.append(node, next, min);
+        active.erase(active.begin()+pos);
+        d.erase(d.begin()+pos);
+        node = next;
     }
 }
 
@@ -2199,7 +2473,6 @@ struct HCluster{
     float dist_ext;         // distamce where this merge will merge with another
     long double volume;     // volume of the bounding sphere (or bounding box)
     long double volume_ext; // volume of the sphere(or box) + envolvent empty space
-    vector<vector<float> > points; // nD points in this cluster
     bool max_meaningful;    // is this merge max meaningul ?
     vector<int> max_in_branch; // otherwise which merges are the max_meaningful in this branch
     int min_nfa_in_branch;  // min nfa detected within the chilhood
@@ -2234,11 +2507,12 @@ private:
                           vector<HCluster> *merge_info, vector< vector<int> > *meaningful_clusters);
 
     /// Calculate the Number of False Alarms
-    int nfa(float sigma, int k, int N);
+    int nfa(float sigma, int k, int N, const NFATable& table);
 
     /// Calculate the probability of a group being a text group
     double probability(vector<int> &elements);
 
+    friend class HClusterScoresBody;
 };
 
 MaxMeaningfulClustering::MaxMeaningfulClustering(unsigned char _method, unsigned char _metric, vector<ERFeatures> &_regions,
@@ -2279,68 +2553,82 @@ void MaxMeaningfulClustering::operator()(double *data, unsigned int num, int dim
     merge_info.clear();
 }
 
+// calculate the nfa and the probability of a set of merges
+class HClusterScoresBody : public ParallelLoopBody
+{
+public:
+    HClusterScoresBody(MaxMeaningfulClustering& _clustering, vector<HCluster>& _merge_info, int _N,
+                       const NFATable& _nfa_table) :
+        clustering(_clustering), merge_info(_merge_info), N(_N), nfa_table(_nfa_table) {}
+
+    void operator()(const Range& r) const
+    {
+        for (int i = r.start; i < r.end; i++)
+        {
+            HCluster &cluster = merge_info[i];
+            cluster.nfa = clustering.nfa((float)cluster.volume, cluster.num_elem, N, nfa_table);
+            // clusters with too many elements are not text groups and have no gathered elements
+            if (cluster.num_elem > MAX_GROUP_ELEMENTS)
+                cluster.probability = 0.;
+            else
+                cluster.probability = clustering.probability(cluster.elements);
+        }
+    }
+
+private:
+    MaxMeaningfulClustering& clustering;
+    vector<HCluster>& merge_info;
+    int N;
+    const NFATable& nfa_table;
+
+    HClusterScoresBody& operator=(const HClusterScoresBody&);
+};
+
 void MaxMeaningfulClustering::build_merge_info(double *Z, double *X, int N, int dim,
                                                bool use_full_merge_rule,
                                                vector<HCluster> *merge_info,
                                                vector< vector<int> > *meaningful_clusters)
 {
 
-    // walk the whole dendogram
-    for (int i=0; i<(N-1)*4; i=i+4)
+    // walk the whole dendogram, the box of a merge is the union of the boxes of its nodes
+    // and only the elements of the clusters small enough to be text groups are gathered
+    merge_info->resize(N-1);
+    vector<Minibox> boxes(N-1);
+    for (int i=0; i<N-1; i++)
     {
-        HCluster cluster;
-        cluster.num_elem = (int)Z[i+3]; //number of elements
+        HCluster &cluster = merge_info->at(i);
+        cluster.num_elem = (int)Z[4*i+3]; //number of elements
 
-        int node1  = (int)Z[i];
-        int node2  = (int)Z[i+1];
-        float dist = (float)Z[i+2];
+        int node1  = (int)Z[4*i];
+        int node2  = (int)Z[4*i+1];
+        float dist = (float)Z[4*i+2];
 
-        if (node1<N)
-        {
-            vector<float> point;
-            for (int n=0; n<dim; n++)
-                point.push_back((float)X[node1*dim+n]);
-            cluster.points.push_back(point);
-            cluster.elements.push_back((int)node1);
-        }
-        else
+        const int nodes[2] = { node1, node2 };
+        for (int j=0; j<2; j++)
         {
-            for (int ii=0; ii<(int)merge_info->at(node1-N).points.size(); ii++)
+            if (nodes[j]<N)
             {
-                cluster.points.push_back(merge_info->at(node1-N).points[ii]);
-                cluster.elements.push_back(merge_info->at(node1-N).elements[ii]);
+                vector<float> point;
+                for (int n=0; n<dim; n++)
+                    point.push_back((float)X[nodes[j]*dim+n]);
+                boxes[i].check_in(&point);
+                if (cluster.num_elem <= MAX_GROUP_ELEMENTS)
+                    cluster.elements.push_back(nodes[j]);
             }
-            //update the extended volume of node1 using the dist where this cluster merge with another
-            merge_info->at(node1-N).dist_ext = dist;
-        }
-        if (node2<N)
-        {
-            vector<float> point;
-            for (int n=0; n<dim; n++)
-                point.push_back((float)X[node2*dim+n]);
-            cluster.points.push_back(point);
-            cluster.elements.push_back((int)node2);
-        }
-        else
-        {
-            for (int ii=0; ii<(int)merge_info->at(node2-N).points.size(); ii++)
+            else
             {
-                cluster.points.push_back(merge_info->at(node2-N).points[ii]);
-                cluster.elements.push_back(merge_info->at(node2-N).elements[ii]);
+                boxes[i].check_in(boxes[nodes[j]-N]);
+                if (cluster.num_elem <= MAX_GROUP_ELEMENTS)
+                    cluster.elements.insert(cluster.elements.end(),
+                                            merge_info->at(nodes[j]-N).elements.begin(),
+                                            merge_info->at(nodes[j]-N).elements.end());
+                //update the extended volume of the node using the dist where this cluster merge with another
+                merge_info->at(nodes[j]-N).dist_ext = dist;
             }
-
-            //update the extended volume of node2 using the dist where this cluster merge with another
-            merge_info->at(node2-N).dist_ext = dist;
-        }
-
-        Minibox mb;
-        for (int ii=0; ii<(int)cluster.points.size(); ii++)
-        {
-            mb.check_in(&cluster.points.at(ii));
         }
 
         cluster.dist   = dist;
-        cluster.volume = mb.volume();
+        cluster.volume = boxes[i].volume();
         if (cluster.volume >= 1)
             cluster.volume = 0.999999;
         if (cluster.volume == 0)
@@ -2359,18 +2647,14 @@ void MaxMeaningfulClustering::build_merge_info(double *Z, double *X, int N, int
 
         cluster.node1 = node1;
         cluster.node2 = node2;
-
-        merge_info->push_back(cluster);
-
     }
 
+    // the nfa and the probability of every merge are independent of the other merges
+    NFATable nfa_table(N);
+    parallel_for_(Range(0, (int)merge_info->size()), HClusterScoresBody(*this, *merge_info, N, nfa_table));
+
     for (int i=0; i<(int)merge_info->size(); i++)
     {
-
-        merge_info->at(i).nfa = nfa((float)merge_info->at(i).volume,
-                                    merge_info->at(i).num_elem, N);
-
-        merge_info->at(i).probability = probability(merge_info->at(i).elements);
         int node1 = merge_info->at(i).node1;
         int node2 = merge_info->at(i).node2;
 
@@ -2467,8 +2751,25 @@ void MaxMeaningfulClustering::build_merge_info(double *Z, double *X, int N, int
         if (merge_info->at(i).max_meaningful)
         {
             vector<int> cluster;
-            for (int k=0; k<(int)merge_info->at(i).elements.size();k++)
-                cluster.push_back(merge_info->at(i).elements.at(k));
+            if ((int)merge_info->at(i).elements.size() == merge_info->at(i).num_elem)
+                cluster = merge_info->at(i).elements;
+            else
+            {
+                // walk the dendogram below the merge, first node first
+                vector<int> to_visit(1, i+N);
+                while (!to_visit.empty())
+                {
+                    int node = to_visit.back();
+                    to_visit.pop_back();
+                    if (node < N)
+                    {
+                        cluster.push_back(node);
+                        continue;
+                    }
+                    to_visit.push_back(merge_info->at(node-N).node2);
+                    to_visit.push_back(merge_info->at(node-N).node1);
+                }
+            }
             meaningful_clusters->push_back(cluster);
         }
     }
@@ -2476,10 +2777,10 @@ void MaxMeaningfulClustering::build_merge_info(double *Z, double *X, int N, int
 }
 
 
-int MaxMeaningfulClustering::nfa(float sigma, int k, int N)
+int MaxMeaningfulClustering::nfa(float sigma, int k, int N, const NFATable& table)
 {
     // use an approximation for the nfa calculations (faster)
-    return -1*(int)NFA( N, k, (double) sigma, 0);
+    return -1*(int)NFA( N, k, (double) sigma, 0, table);
 }
 
 
@@ -4220,6 +4521,85 @@ void detectRegions(InputArray image, const Ptr<ERFilter>& er_filter1, const Ptr<
 }
 
 
+// run the cascade of filters on each channel, every channel has its own filter instances
+class ERDetectChannelsBody : public ParallelLoopBody
+{
+public:
+    ERDetectChannelsBody(const vector<Mat>& _channels, const vector< Ptr<ERFilter> >& _filters1,
+                         const vector< Ptr<ERFilter> >& _filters2, vector< vector<ERStat> >& _regions) :
+        channels(_channels), filters1(_filters1), filters2(_filters2), regions(_regions) {}
+
+    void operator()( const Range& r ) const
+    {
+        for (int c = r.start; c < r.end; c++)
+        {
+            regions[c].clear();
+            filters1[c]->run(channels[c], regions[c]);
+            if (!filters2[c].empty())
+                filters2[c]->run(channels[c], regions[c]);
+        }
+    }
+
+private:
+    const vector<Mat>& channels;
+    const vector< Ptr<ERFilter> >& filters1;
+    const vector< Ptr<ERFilter> >& filters2;
+    vector< vector<ERStat> >& regions;
+
+    ERDetectChannelsBody& operator=(const ERDetectChannelsBody&);
+};
+
+// an instance of the filter that can be run concurrently with the given one, empty if it is not possible
+static Ptr<ERFilter> er_filter_instance(const Ptr<ERFilter>& er_filter)
+{
+    if (er_filter.empty())
+        return Ptr<ERFilter>();
+    const ERFilterNM* nm_filter = dynamic_cast<const ERFilterNM*>(er_filter.get());
+    if (nm_filter == NULL)
+        return Ptr<ERFilter>();
+    return nm_filter->clone();
+}
+
+void detectRegions(InputArrayOfArrays _channels, const Ptr<ERFilter>& er_filter1, const Ptr<ERFilter>& er_filter2,
+                   CV_OUT vector< vector<ERStat> >& regions)
+{
+    // at least one ERFilter must be passed
+    CV_Assert( !er_filter1.empty() );
+
+    vector<Mat> channels;
+    _channels.getMatVector(channels);
+    for (size_t c = 0; c < channels.size(); c++)
+        CV_Assert( channels[c].type() == CV_8UC1 );
+
+    // the regions point to each other, so the output vectors must not be moved once filled
+    regions.clear();
+    regions.resize(channels.size());
+    if (channels.empty())
+        return;
+
+    // the first channel uses the given filters, the other ones run on copies of them
+    vector< Ptr<ERFilter> > filters1(channels.size(), er_filter1), filters2(channels.size(), er_filter2);
+    bool concurrent = true;
+    for (size_t c = 1; c < channels.size() && concurrent; c++)
+    {
+        filters1[c] = er_filter_instance(er_filter1);
+        filters2[c] = er_filter_instance(er_filter2);
+        concurrent = !filters1[c].empty() && (er_filter2.empty() || !filters2[c].empty());
+    }
+
+    if (concurrent)
+    {
+        parallel_for_(Range(0, (int)channels.size()), ERDetectChannelsBody(channels, filters1, filters2, regions));
+    }
+    else
+    {
+        // user defined filters can not be copied, the channels are processed sequentially
+        filters1.assign(channels.size(), er_filter1);
+        filters2.assign(channels.size(), er_filter2);
+        ERDetectChannelsBody(channels, filters1, filters2, regions)(Range(0, (int)channels.size()));
+    }
+}
+
 void detectRegions(InputArray image, const Ptr<ERFilter>& er_filter1, const Ptr<ERFilter>& er_filter2,
                                            CV_OUT std::vector<Rect> &groups_rects,
                                            int method,
@@ -4242,14 +4622,9 @@ void detectRegions(InputArray image, const Ptr<ERFilter>& er_filter1, const Ptr<
     channels.push_back(grey);
     channels.push_back(255-grey);
 
-    vector<vector<ERStat> > regions(channels.size());
-
-    // Apply the default cascade classifier to each independent channel (could be done in parallel)
-    for (int c=0; c<(int)channels.size(); c++)
-    {
-        er_filter1->run(channels[c], regions[c]);
-        er_filter2->run(channels[c], regions[c]);
-    }
+    // Apply the default cascade classifier to each independent channel in parallel
+    vector<vector<ERStat> > regions;
+    detectRegions(channels, er_filter1, er_filter2, regions);
    // Detect character groups
     vector< vector<Vec2i> > nm_region_groups;
     erGrouping(image, channels, regions, nm_region_groups, groups_rects, method, filename, minProbability);
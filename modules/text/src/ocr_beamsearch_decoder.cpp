@@ -148,8 +148,8 @@ struct beamSearch_node {
     //      of their "root" path.
 };
 
-bool beam_sort_function ( beamSearch_node a, beamSearch_node b );
-bool beam_sort_function ( beamSearch_node a, beamSearch_node b )
+bool beam_sort_function ( const beamSearch_node& a, const beamSearch_node& b );
+bool beam_sort_function ( const beamSearch_node& a, const beamSearch_node& b )
 {
     return (a.score > b.score);
 }
@@ -293,7 +293,10 @@ public:
         }
 
         // initialize the beam with all possible character's pairs
+        beam.clear();
+        beam.reserve(beam_size+1);
         int generated_chids = 0;
+        vector< vector<int> > childs;
         for (size_t i=0; i<recognition_probabilities.size()-1; i++)
         {
           for (size_t j=i+1; j<recognition_probabilities.size(); j++)
@@ -303,10 +306,10 @@ public:
             node.segmentation.push_back((int)i);
             node.segmentation.push_back((int)j);
             node.score = score_segmentation(node.segmentation, out_sequence);
-            vector< vector<int> > childs = generate_childs( node.segmentation );
+            generate_childs( node.segmentation, childs );
             node.expanded = true;
 
-            beam.push_back( node );
+            insert_node( node );
 
             if (!childs.empty())
               update_beam( childs );
@@ -322,11 +325,11 @@ public:
 
             for (size_t i=0; i<beam.size(); i++)
             {
-                vector< vector<int> > childs;
+                childs.clear();
                 if (!beam[i].expanded)
                 {
-                  childs = generate_childs( beam[i].segmentation );
                   beam[i].expanded = true;
+                  generate_childs( beam[i].segmentation, childs );
                 }
                 if (!childs.empty())
                     update_beam( childs );
@@ -353,46 +356,52 @@ private:
     vector< vector<double> > recognition_probabilities;
     vector<int> oversegmentation;
 
-    vector< vector<int> > generate_childs( vector<int> &segmentation )
-    {
+    // Viterbi buffers reused by all the scored segmentations
+    vector<double> viterbi_prev, viterbi_cur;
+    vector<int> viterbi_back;
 
-        vector< vector<int> > childs;
+    void generate_childs( const vector<int> &segmentation, vector< vector<int> > &childs )
+    {
+        // the segmentation points are increasing, so all the points after the last one are new
+        childs.clear();
         for (size_t i=segmentation[segmentation.size()-1]+1; i<oversegmentation.size(); i++)
         {
-            int seg_point = (int)i;
-            if (find(segmentation.begin(), segmentation.end(), seg_point) == segmentation.end())
-            {
-                vector<int> child = segmentation;
-                child.push_back(seg_point);
-                childs.push_back(child);
-            }
+            childs.push_back(segmentation);
+            childs.back().push_back((int)i);
         }
-        return childs;
+    }
+
+    // insert a node keeping the beam sorted by decreasing score and bounded to beam_size nodes
+    void insert_node ( beamSearch_node &node )
+    {
+        vector< beamSearch_node >::iterator it = upper_bound(beam.begin(), beam.end(), node, beam_sort_function);
+        if (it - beam.begin() >= beam_size)
+            return;
+        it = beam.insert(it, beamSearch_node());
+        it->score = node.score;
+        it->expanded = node.expanded;
+        it->segmentation.swap(node.segmentation);
+        if ((int)beam.size() > beam_size)
+            beam.pop_back();
     }
 
     void update_beam ( vector< vector<int> > &childs )
     {
         string out_sequence;
-        double min_score = -DBL_MAX; //min score value to be part of the beam
-        if ((int)beam.size() >= beam_size)
-            min_score = beam[beam_size-1].score; //last element has the lowest score
-
         for (size_t i=0; i<childs.size(); i++)
         {
+            double min_score = -DBL_MAX; //min score value to be part of the beam
+            if ((int)beam.size() >= beam_size)
+                min_score = beam[beam_size-1].score; //last element has the lowest score
+
             double score = score_segmentation(childs[i], out_sequence);
             if (score > min_score)
             {
                 beamSearch_node node;
                 node.score = score;
-                node.segmentation = childs[i];
+                node.segmentation.swap(childs[i]);
                 node.expanded = false;
-                beam.push_back(node);
-                sort(beam.begin(),beam.end(),beam_sort_function);
-                if ((int)beam.size() > beam_size)
-                {
-                    beam.erase(beam.begin()+beam_size,beam.end());
-                    min_score = beam[beam.size()-1].score;
-                }
+                insert_node(node);
             }
         }
     }
@@ -407,75 +416,70 @@ private:
         //       in other cases we do it because the overlapping between two chars is too large
         // TODO  Add more heuristics (e.g. penalize large inter-character variance)
 
-        Mat interdist ((int)segmentation.size()-1, 1, CV_32F, 1);
         for (size_t i=0; i<segmentation.size()-1; i++)
         {
-          interdist.at<float>((int)i,0) = (float)oversegmentation[segmentation[(int)i+1]]*step_size
-                                          - (float)oversegmentation[segmentation[(int)i]]*step_size;
-          if ((float)interdist.at<float>((int)i,0)/win_size > 2.25) // TODO explain how did you set this thrs
+          float interdist = (float)oversegmentation[segmentation[(int)i+1]]*step_size
+                            - (float)oversegmentation[segmentation[(int)i]]*step_size;
+          if (interdist/win_size > 2.25) // TODO explain how did you set this thrs
           {
              return -DBL_MAX;
           }
-          if ((float)interdist.at<float>((int)i,0)/win_size < 0.15) // TODO explain how did you set this thrs
+          if (interdist/win_size < 0.15) // TODO explain how did you set this thrs
           {
              return -DBL_MAX;
           }
         }
-        Scalar m, std;
-        meanStdDev(interdist, m, std);
-        //double interdist_std = std[0];
 
         //TODO Extracting start probs from lexicon (if we have it) may boost accuracy!
-        vector<double> start_p(vocabulary.size());
-        for (int i=0; i<(int)vocabulary.size(); i++)
-            start_p[i] = log(1.0/vocabulary.size());
-
+        const int num_chars = (int)vocabulary.size();
+        const int num_steps = (int)segmentation.size();
+        double start_p = log(1.0/num_chars);
 
-        Mat V = Mat::ones((int)segmentation.size(),(int)vocabulary.size(),CV_64FC1);
-        V = V * -DBL_MAX;
-        vector<string> path(vocabulary.size());
+        // only the last two rows of the Viterbi table are kept, the paths are rebuilt from the back pointers
+        viterbi_prev.resize(num_chars);
+        viterbi_cur.resize(num_chars);
+        viterbi_back.resize(num_steps*num_chars);
 
         // Initialize base cases (t == 0)
-        for (int i=0; i<(int)vocabulary.size(); i++)
+        for (int i=0; i<num_chars; i++)
         {
-            V.at<double>(0,i) = start_p[i] + recognition_probabilities[segmentation[0]][i];
-            path[i] = vocabulary.at(i);
+            viterbi_prev[i] = start_p + recognition_probabilities[segmentation[0]][i];
         }
 
 
         // Run Viterbi for t > 0
-        for (int t=1; t<(int)segmentation.size(); t++)
+        for (int t=1; t<num_steps; t++)
         {
+            const vector<double>& emission = recognition_probabilities[segmentation[t]];
+            int* back = &viterbi_back[t*num_chars];
 
-            vector<string> newpath(vocabulary.size());
-
-            for (int i=0; i<(int)vocabulary.size(); i++)
+            for (int i=0; i<num_chars; i++)
+            {
+                viterbi_cur[i] = -DBL_MAX;
+                back[i] = 0;
+            }
+            for (int j=0; j<num_chars; j++)
             {
-                double max_prob = -DBL_MAX;
-                int best_idx = 0;
-                for (int j=0; j<(int)vocabulary.size(); j++)
+                const double* transition = transition_p.ptr<double>(j);
+                for (int i=0; i<num_chars; i++)
                 {
-                    double prob = V.at<double>(t-1,j) + transition_p.at<double>(j,i) + recognition_probabilities[segmentation[t]][i];
-                    if ( prob > max_prob)
+                    double prob = viterbi_prev[j] + transition[i] + emission[i];
+                    if ( prob > viterbi_cur[i])
                     {
-                        max_prob = prob;
-                        best_idx = j;
+                        viterbi_cur[i] = prob;
+                        back[i] = j;
                     }
                 }
-
-                V.at<double>(t,i) = max_prob;
-                newpath[i] = path[best_idx] + vocabulary.at(i);
             }
 
-            // Don't need to remember the old paths
-            path.swap(newpath);
+            viterbi_prev.swap(viterbi_cur);
         }
 
         double max_prob = -DBL_MAX;
         int best_idx = 0;
-        for (int i=0; i<(int)vocabulary.size(); i++)
+        for (int i=0; i<num_chars; i++)
         {
-            double prob = V.at<double>((int)segmentation.size()-1,i);
+            double prob = viterbi_prev[i];
             if ( prob > max_prob)
             {
                 max_prob = prob;
@@ -483,7 +487,13 @@ private:
             }
         }
 
-        outstring = path[best_idx];
+        outstring.resize(num_steps);
+        for (int t=num_steps-1; t>=0; t--)
+        {
+            outstring[t] = vocabulary[best_idx];
+            if (t > 0)
+                best_idx = viterbi_back[t*num_chars+best_idx];
+        }
         return (max_prob / (segmentation.size()-1));
     }
 
@@ -533,6 +543,9 @@ public:
     int getStepSize() {return step_size;}
     void setStepSize(int _step_size) {step_size = _step_size;}
 
+    // compute the class probabilities of the window of the word image at x
+    void evalWindow(const Mat& src, int x, vector<double>& recognition_p);
+
 protected:
     void normalizeAndZCA(Mat& patches);
     double eval_feature(Mat& feature, double* prob_estimates);
@@ -573,6 +586,14 @@ OCRBeamSearchClassifierCNN::OCRBeamSearchClassifierCNN (const string& filename)
     else
         CV_Error(Error::StsBadArg, "Default classifier data file not found!");
 
+    // check all matrix dimensions match correctly and no one is empty
+    CV_Assert( (M.cols > 0) && (M.rows > 0) );
+    CV_Assert( (P.cols > 0) && (P.rows > 0) );
+    CV_Assert( (kernels.cols > 0) && (kernels.rows > 0) );
+    CV_Assert( (weights.cols > 0) && (weights.rows > 0) );
+    CV_Assert( (feature_min.cols > 0) && (feature_min.rows > 0) );
+    CV_Assert( (feature_max.cols > 0) && (feature_max.rows > 0) );
+
     nr_feature = weights.rows;
     nr_class   = weights.cols;
     patch_size  = cvRound(sqrt((float)kernels.cols));
@@ -584,6 +605,37 @@ OCRBeamSearchClassifierCNN::OCRBeamSearchClassifierCNN (const string& filename)
     alpha       = 0.5; // used in non-linear activation function z = max(0, |D*a| - alpha)
 }
 
+// the 9 pools overlapping each of the 25 quads of the window (quad ids start at 1), as a bitmask
+static const int cnn_quad_pools[26] = { 0x000,
+    0x001, 0x003, 0x002, 0x006, 0x004,
+    0x009, 0x01B, 0x012, 0x036, 0x024,
+    0x008, 0x018, 0x010, 0x030, 0x020,
+    0x048, 0x0D8, 0x090, 0x1B0, 0x120,
+    0x040, 0x0C0, 0x080, 0x180, 0x100 };
+
+// classify the sliding windows of a word, the whitening parameters are loaded so the classifier is only read
+class OCRBeamSearchCNNWindowsBody : public ParallelLoopBody
+{
+public:
+    OCRBeamSearchCNNWindowsBody(OCRBeamSearchClassifierCNN& _classifier, const Mat& _src, int _step_size,
+                                vector< vector<double> >& _recognition_probabilities) :
+        classifier(_classifier), src(_src), step_size(_step_size), recognition_probabilities(_recognition_probabilities) {}
+
+    void operator()( const Range& r ) const
+    {
+        for (int i = r.start; i < r.end; i++)
+            classifier.evalWindow(src, i*step_size, recognition_probabilities[i]);
+    }
+
+private:
+    OCRBeamSearchClassifierCNN& classifier;
+    const Mat& src;
+    int step_size;
+    vector< vector<double> >& recognition_probabilities;
+
+    OCRBeamSearchCNNWindowsBody& operator=(const OCRBeamSearchCNNWindowsBody&);
+};
+
 void OCRBeamSearchClassifierCNN::eval( InputArray _src, vector< vector<double> >& recognition_probabilities, vector<int>& oversegmentation)
 {
 
@@ -605,113 +657,93 @@ void OCRBeamSearchClassifierCNN::eval( InputArray _src, vector< vector<double> >
 
     resize(src,src,Size(window_size*src.cols/src.rows,window_size));
 
-    int seg_points = 0;
+    // all the sliding windows of the word are classified in parallel
+    int sz = src.cols - window_size;
+    int num_windows = (sz >= 0) ? sz/step_size + 1 : 0;
+    recognition_probabilities.resize(num_windows);
+    parallel_for_(Range(0, num_windows), OCRBeamSearchCNNWindowsBody(*this, src, step_size, recognition_probabilities));
 
-    Mat quad;
-    Mat tmp;
-    Mat img;
+    for (int seg_points = 0; seg_points < num_windows; seg_points++)
+        oversegmentation.push_back(seg_points);
+}
+
+void OCRBeamSearchClassifierCNN::evalWindow(const Mat& src, int x_c, vector<double>& recognition_p)
+{
+    Mat img = src(Rect(Point(x_c,0),Size(window_size,window_size)));
 
-    int sz = src.cols - window_size;
     int sz_window_quad = window_size - quad_size;
     int sz_half_quad = (int)(quad_size/2-1);
     int sz_quad_patch = quad_size - patch_size;
-    // begin sliding window loop foreach detection window
-    for (int x_c = 0; x_c <= sz; x_c += step_size)
-    {
-
-        img = src(Rect(Point(x_c,0),Size(window_size,window_size)));
-
-        int patch_count = 0;
-        vector< vector<double> > data_pool(9);
-
+    int quads_per_side = sz_window_quad/sz_half_quad + 1;
+    int patches_per_side = sz_quad_patch + 1;
 
-        int quad_id = 1;
+    // gather all the patches of the window, one per row, to normalize and whiten them at once
+    Mat patches(quads_per_side*quads_per_side*patches_per_side*patches_per_side, patch_size*patch_size, CV_64FC1);
+    vector<int> patch_quad(patches.rows);
 
-        for (int q_x = 0; q_x <= sz_window_quad; q_x += sz_half_quad)
+    int patch_count = 0;
+    int quad_id = 1;
+    for (int q_x = 0; q_x <= sz_window_quad; q_x += sz_half_quad)
+    {
+        for (int q_y = 0; q_y <= sz_window_quad; q_y += sz_half_quad)
         {
-            for (int q_y = 0; q_y <= sz_window_quad; q_y += sz_half_quad)
-            {
-                Rect quad_rect = Rect(q_x,q_y,quad_size,quad_size);
-                quad = img(quad_rect);
-
-                //start sliding window (8x8) in each tile and store the patch as row in data_pool
-                for (int w_x = 0; w_x <= sz_quad_patch; w_x++)
-                {
-                    for (int w_y = 0; w_y <= sz_quad_patch; w_y++)
-                    {
-                        quad(Rect(w_x,w_y,patch_size,patch_size)).convertTo(tmp, CV_64F);
-                        tmp = tmp.reshape(0,1);
-                        normalizeAndZCA(tmp);
-                        vector<double> patch;
-                        tmp.copyTo(patch);
-                        if ((quad_id == 1)||(quad_id == 2)||(quad_id == 6)||(quad_id == 7))
-                            data_pool[0].insert(data_pool[0].end(),patch.begin(),patch.end());
-                        if ((quad_id == 2)||(quad_id == 7)||(quad_id == 3)||(quad_id == 8)||(quad_id == 4)||(quad_id == 9))
-                            data_pool[1].insert(data_pool[1].end(),patch.begin(),patch.end());
-                        if ((quad_id == 4)||(quad_id == 9)||(quad_id == 5)||(quad_id == 10))
-                            data_pool[2].insert(data_pool[2].end(),patch.begin(),patch.end());
-                        if ((quad_id == 6)||(quad_id == 11)||(quad_id == 16)||(quad_id == 7)||(quad_id == 12)||(quad_id == 17))
-                            data_pool[3].insert(data_pool[3].end(),patch.begin(),patch.end());
-                        if ((quad_id == 7)||(quad_id == 12)||(quad_id == 17)||(quad_id == 8)||(quad_id == 13)||(quad_id == 18)||(quad_id == 9)||(quad_id == 14)||(quad_id == 19))
-                            data_pool[4].insert(data_pool[4].end(),patch.begin(),patch.end());
-                        if ((quad_id == 9)||(quad_id == 14)||(quad_id == 19)||(quad_id == 10)||(quad_id == 15)||(quad_id == 20))
-                            data_pool[5].insert(data_pool[5].end(),patch.begin(),patch.end());
-                        if ((quad_id == 16)||(quad_id == 21)||(quad_id == 17)||(quad_id == 22))
-                            data_pool[6].insert(data_pool[6].end(),patch.begin(),patch.end());
-                        if ((quad_id == 17)||(quad_id == 22)||(quad_id == 18)||(quad_id == 23)||(quad_id == 19)||(quad_id == 24))
-                            data_pool[7].insert(data_pool[7].end(),patch.begin(),patch.end());
-                        if ((quad_id == 19)||(quad_id == 24)||(quad_id == 20)||(quad_id == 25))
-                            data_pool[8].insert(data_pool[8].end(),patch.begin(),patch.end());
-                        patch_count++;
-                    }
-                }
-
-                quad_id++;
-            }
-        }
-
+            Mat quad = img(Rect(q_x,q_y,quad_size,quad_size));
 
-        //do dot product of each normalized and whitened patch
-        //each pool is averaged and this yields a representation of 9xD
-        Mat feature = Mat::zeros(9,kernels.rows,CV_64FC1);
-        for (int i=0; i<9; i++)
-        {
-            Mat pool = Mat(data_pool[i]);
-            pool = pool.reshape(0,(int)data_pool[i].size()/kernels.cols);
-            for (int p=0; p<pool.rows; p++)
+            //start sliding window (8x8) in each tile and store the patch as row in patches
+            for (int w_x = 0; w_x <= sz_quad_patch; w_x++)
             {
-                for (int f=0; f<kernels.rows; f++)
+                for (int w_y = 0; w_y <= sz_quad_patch; w_y++)
                 {
-                    feature.row(i).at<double>(0,f) = feature.row(i).at<double>(0,f) + max(0.0,std::abs(pool.row(p).dot(kernels.row(f)))-alpha);
+                    Mat patch(patch_size, patch_size, CV_64FC1, patches.ptr<double>(patch_count));
+                    quad(Rect(w_x,w_y,patch_size,patch_size)).convertTo(patch, CV_64F);
+                    patch_quad[patch_count] = quad_id;
+                    patch_count++;
                 }
             }
-        }
-        feature = feature.reshape(0,1);
-
 
-        // data must be normalized within the range obtained during training
-        double lower = -1.0;
-        double upper =  1.0;
-        for (int k=0; k<feature.cols; k++)
+            quad_id++;
+        }
+    }
+    normalizeAndZCA(patches);
+
+    //do dot product of each normalized and whitened patch
+    //each pool is averaged and this yields a representation of 9xD
+    Mat responses;
+    gemm(patches, kernels, 1, noArray(), 0, responses, GEMM_2_T);
+    Mat feature = Mat::zeros(9,kernels.rows,CV_64FC1);
+    for (int p=0; p<responses.rows; p++)
+    {
+        int pools = (patch_quad[p] < 26) ? cnn_quad_pools[patch_quad[p]] : 0;
+        if (pools == 0)
+            continue;
+        const double* response = responses.ptr<double>(p);
+        for (int i=0; i<9; i++)
         {
-            feature.at<double>(0,k) = lower + (upper-lower) *
-                    (feature.at<double>(0,k)-feature_min.at<double>(0,k))/
-                    (feature_max.at<double>(0,k)-feature_min.at<double>(0,k));
+            if (!(pools & (1 << i)))
+                continue;
+            double* pool = feature.ptr<double>(i);
+            for (int f=0; f<kernels.rows; f++)
+                pool[f] += max(0.0,std::abs(response[f])-alpha);
         }
-
-        double *p = new double[nr_class];
-        double predict_label = eval_feature(feature,p);
-
-        if ( (predict_label < 0) || (predict_label > nr_class) )
-            CV_Error(Error::StsOutOfRange, "OCRBeamSearchClassifierCNN::eval Error: unexpected prediction in eval_feature()");
+    }
+    feature = feature.reshape(0,1);
 
 
-        vector<double> recognition_p(p, p+nr_class);
-        recognition_probabilities.push_back(recognition_p);
-        oversegmentation.push_back(seg_points);
-        seg_points++;
+    // data must be normalized within the range obtained during training
+    double lower = -1.0;
+    double upper =  1.0;
+    for (int k=0; k<feature.cols; k++)
+    {
+        feature.at<double>(0,k) = lower + (upper-lower) *
+                (feature.at<double>(0,k)-feature_min.at<double>(0,k))/
+                (feature_max.at<double>(0,k)-feature_min.at<double>(0,k));
     }
 
+    recognition_p.resize(nr_class);
+    double predict_label = eval_feature(feature,&recognition_p[0]);
+
+    if ( (predict_label < 0) || (predict_label > nr_class) )
+        CV_Error(Error::StsOutOfRange, "OCRBeamSearchClassifierCNN::eval Error: unexpected prediction in eval_feature()");
 }
 
 // normalize for contrast and apply ZCA whitening to a set of image patches
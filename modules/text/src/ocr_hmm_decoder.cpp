@@ -137,6 +137,17 @@ void OCRHMMDecoder::ClassifierCallback::eval( InputArray image, vector<int>& out
     out_confidence.clear();
 }
 
+void OCRHMMDecoder::ClassifierCallback::evalBatch( InputArrayOfArrays _images, vector< vector<int> >& out_classes,
+                                                   vector< vector<double> >& out_confidences )
+{
+    vector<Mat> images;
+    _images.getMatVector(images);
+    out_classes.resize(images.size());
+    out_confidences.resize(images.size());
+    for (size_t i=0; i<images.size(); i++)
+        eval(images[i], out_classes[i], out_confidences[i]);
+}
+
 
 bool sort_rect_horiz (Rect a,Rect b);
 bool sort_rect_horiz (Rect a,Rect b) { return (a.x<b.x); }
@@ -306,20 +317,17 @@ public:
 
             sort(contours_rect.begin(), contours_rect.end(), sort_rect_horiz);
 
-            // Do character recognition foreach contour
+            // Do character recognition of all the contours at once
+            vector<Mat> char_masks(contours.size());
             for (int i=0; i<(int)contours.size(); i++)
+                words_mask[w](contours_rect.at(i)).copyTo(char_masks[i]);
+
+            classifier->evalBatch(char_masks, observations, confidences);
+            for (int i=0; i<(int)observations.size(); i++)
             {
-                Mat tmp_mask;
-                words_mask[w](contours_rect.at(i)).copyTo(tmp_mask);
-
-                vector<int> out_class;
-                vector<double> out_conf;
-                classifier->eval(tmp_mask,out_class,out_conf);
-                if (!out_class.empty())
-                    obs.push_back(out_class[0]);
-                observations.push_back(out_class);
-                confidences.push_back(out_conf);
-                //cout << " out class = " << vocabulary[out_class[0]] << endl;
+                if (!observations[i].empty())
+                    obs.push_back(observations[i][0]);
+                //cout << " out class = " << vocabulary[observations[i][0]] << endl;
             }
 
 
@@ -554,11 +562,10 @@ public:
 
             sort(contours_rect.begin(), contours_rect.end(), sort_rect_horiz);
 
-            // Do character recognition foreach contour
+            // Do character recognition of all the contours at once
+            vector<Mat> char_images(contours.size());
             for (int i=0; i<(int)contours.size(); i++)
             {
-                vector<int> out_class;
-                vector<double> out_conf;
                 //take the center of the char rect and translate it to the real origin
                 Point char_center = Point(contours_rect.at(i).x+contours_rect.at(i).width/2,
                                           contours_rect.at(i).y+contours_rect.at(i).height/2);
@@ -568,15 +575,15 @@ public:
                 win_size += (int)(win_size*0.6); // add some pixels in the border TODO: is this a parameter for the user space?
                 Rect char_rect = Rect(char_center.x-win_size/2,char_center.y-win_size/2,win_size,win_size);
                 char_rect &= Rect(0,0,image.cols,image.rows);
-                Mat tmp_image;
-                image(char_rect).copyTo(tmp_image);
-
-                classifier->eval(tmp_image,out_class,out_conf);
-                if (!out_class.empty())
-                    obs.push_back(out_class[0]);
-                //cout << " out class = " << vocabulary[out_class[0]] << "(" << out_conf[0] << ")" << endl;
-                observations.push_back(out_class);
-                confidences.push_back(out_conf);
+                image(char_rect).copyTo(char_images[i]);
+            }
+
+            classifier->evalBatch(char_images, observations, confidences);
+            for (int i=0; i<(int)observations.size(); i++)
+            {
+                if (!observations[i].empty())
+                    obs.push_back(observations[i][0]);
+                //cout << " out class = " << vocabulary[observations[i][0]] << "(" << confidences[i][0] << ")" << endl;
             }
 
 
@@ -703,8 +710,44 @@ public:
     ~OCRHMMClassifierKNN() {}
 
     void eval( InputArray mask, vector<int>& out_class, vector<double>& out_confidence );
+    void evalBatch( InputArrayOfArrays masks, vector< vector<int> >& out_classes,
+                    vector< vector<double> >& out_confidences );
+
+    // compute the features of a mask, false if it has no contours
+    bool computeFeatures( const Mat& mask, float* sample ) const;
+
 private:
+    // turn the k nearest neighbours of a sample into a ranked list of classes
+    void rankClasses( const Mat& predictions, const Mat& responses, const Mat& dists, int row,
+                      vector<int>& out_class, vector<double>& out_confidence ) const;
+
     Ptr<KNearest> knn;
+    vector<vector<int> > equivalency_mat; // classes that look alike
+    static const int num_features = 200;
+    static const int num_neighbours = 11;
+};
+
+// compute the KNN features of a set of masks
+class OCRHMMKNNFeaturesBody : public ParallelLoopBody
+{
+public:
+    OCRHMMKNNFeaturesBody(const OCRHMMClassifierKNN& _classifier, const vector<Mat>& _masks,
+                          Mat& _samples, vector<uchar>& _valid) :
+        classifier(_classifier), masks(_masks), samples(_samples), valid(_valid) {}
+
+    void operator()( const Range& r ) const
+    {
+        for (int i = r.start; i < r.end; i++)
+            valid[i] = classifier.computeFeatures(masks[i], samples.ptr<float>(i));
+    }
+
+private:
+    const OCRHMMClassifierKNN& classifier;
+    const vector<Mat>& masks;
+    Mat& samples;
+    vector<uchar>& valid;
+
+    OCRHMMKNNFeaturesBody& operator=(const OCRHMMKNNFeaturesBody&);
 };
 
 OCRHMMClassifierKNN::OCRHMMClassifierKNN (const string& filename)
@@ -721,6 +764,38 @@ OCRHMMClassifierKNN::OCRHMMClassifierKNN (const string& filename)
     }
     else
         CV_Error(Error::StsBadArg, "Default classifier data file not found!");
+
+    equivalency_mat.resize(62);
+    equivalency_mat[2].push_back(28);  // c -> C
+    equivalency_mat[28].push_back(2);  // C -> c
+    equivalency_mat[8].push_back(34);  // i -> I
+    equivalency_mat[8].push_back(11);  // i -> l
+    equivalency_mat[11].push_back(8);  // l -> i
+    equivalency_mat[11].push_back(34); // l -> I
+    equivalency_mat[34].push_back(8);  // I -> i
+    equivalency_mat[34].push_back(11); // I -> l
+    equivalency_mat[9].push_back(35);  // j -> J
+    equivalency_mat[35].push_back(9);  // J -> j
+    equivalency_mat[14].push_back(40); // o -> O
+    equivalency_mat[14].push_back(52); // o -> 0
+    equivalency_mat[40].push_back(14); // O -> o
+    equivalency_mat[40].push_back(52); // O -> 0
+    equivalency_mat[52].push_back(14); // 0 -> o
+    equivalency_mat[52].push_back(40); // 0 -> O
+    equivalency_mat[15].push_back(41); // p -> P
+    equivalency_mat[41].push_back(15); // P -> p
+    equivalency_mat[18].push_back(44); // s -> S
+    equivalency_mat[44].push_back(18); // S -> s
+    equivalency_mat[20].push_back(46); // u -> U
+    equivalency_mat[46].push_back(20); // U -> u
+    equivalency_mat[21].push_back(47); // v -> V
+    equivalency_mat[47].push_back(21); // V -> v
+    equivalency_mat[22].push_back(48); // w -> W
+    equivalency_mat[48].push_back(22); // W -> w
+    equivalency_mat[23].push_back(49); // x -> X
+    equivalency_mat[49].push_back(23); // X -> x
+    equivalency_mat[25].push_back(51); // z -> Z
+    equivalency_mat[51].push_back(25); // Z -> z
 }
 
 void OCRHMMClassifierKNN::eval( InputArray _mask, vector<int>& out_class, vector<double>& out_confidence )
@@ -730,11 +805,58 @@ void OCRHMMClassifierKNN::eval( InputArray _mask, vector<int>& out_class, vector
     out_class.clear();
     out_confidence.clear();
 
+    Mat sample = Mat(1,num_features,CV_32FC1);
+    if (!computeFeatures(_mask.getMat(), sample.ptr<float>()))
+        return;
+
+    Mat responses,dists,predictions;
+    knn->findNearest( sample, num_neighbours, predictions, responses, dists);
+
+    rankClasses(predictions, responses, dists, 0, out_class, out_confidence);
+}
+
+// the features of all the masks are computed in parallel and searched with a single call
+void OCRHMMClassifierKNN::evalBatch( InputArrayOfArrays _masks, vector< vector<int> >& out_classes,
+                                     vector< vector<double> >& out_confidences )
+{
+    vector<Mat> masks;
+    _masks.getMatVector(masks);
+    out_classes.assign(masks.size(), vector<int>());
+    out_confidences.assign(masks.size(), vector<double>());
+    if (masks.empty())
+        return;
+    for (size_t i=0; i<masks.size(); i++)
+        CV_Assert( masks[i].type() == CV_8UC1 );
+
+    Mat samples((int)masks.size(), num_features, CV_32FC1);
+    vector<uchar> valid(masks.size());
+    parallel_for_(Range(0, (int)masks.size()), OCRHMMKNNFeaturesBody(*this, masks, samples, valid));
+
+    // only the masks with contours are classified
+    vector<int> valid_idx;
+    for (size_t i=0; i<masks.size(); i++)
+        if (valid[i])
+            valid_idx.push_back((int)i);
+    if (valid_idx.empty())
+        return;
+
+    Mat valid_samples((int)valid_idx.size(), num_features, CV_32FC1);
+    for (size_t i=0; i<valid_idx.size(); i++)
+        samples.row(valid_idx[i]).copyTo(valid_samples.row((int)i));
+
+    Mat responses,dists,predictions;
+    knn->findNearest( valid_samples, num_neighbours, predictions, responses, dists);
+
+    for (size_t i=0; i<valid_idx.size(); i++)
+        rankClasses(predictions, responses, dists, (int)i, out_classes[valid_idx[i]], out_confidences[valid_idx[i]]);
+}
+
+bool OCRHMMClassifierKNN::computeFeatures( const Mat& _img, float* sample_data ) const
+{
     int image_height = 35;
     int image_width = 35;
-    int num_features = 200;
 
-    Mat img = _mask.getMat();
+    Mat img = _img;
     Mat tmp;
     img.copyTo(tmp);
 
@@ -744,7 +866,7 @@ void OCRHMMClassifierKNN::eval( InputArray _mask, vector<int>& out_class, vector
     findContours( tmp, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE, Point(0, 0) );
 
     if (contours.empty())
-        return;
+        return false;
 
     int idx = 0;
     if (contours.size() > 1)
@@ -841,7 +963,7 @@ void OCRHMMClassifierKNN::eval( InputArray _mask, vector<int>& out_class, vector
     }
 
     //Generate features for each bitmap
-    Mat sample = Mat(1,num_features,CV_32FC1);
+    Mat sample = Mat(1,num_features,CV_32FC1,sample_data);
     Mat patch;
     for (int i=0; i<(int)maps.size(); i++)
     {
@@ -858,45 +980,17 @@ void OCRHMMClassifierKNN::eval( InputArray _mask, vector<int>& out_class, vector
         }
     }
 
-    Mat responses,dists,predictions;
-    knn->findNearest( sample, 11, predictions, responses, dists);
+    return true;
+}
+
+void OCRHMMClassifierKNN::rankClasses( const Mat& predictions, const Mat& _responses, const Mat& _dists, int row,
+                                       vector<int>& out_class, vector<double>& out_confidence ) const
+{
+    Mat responses = _responses.row(row), dists = _dists.row(row);
 
     Scalar dist_sum = sum(dists);
     Mat class_predictions = Mat::zeros(1,62,CV_64FC1);
 
-    vector<vector<int> > equivalency_mat(62);
-    equivalency_mat[2].push_back(28);  // c -> C
-    equivalency_mat[28].push_back(2);  // C -> c
-    equivalency_mat[8].push_back(34);  // i -> I
-    equivalency_mat[8].push_back(11);  // i -> l
-    equivalency_mat[11].push_back(8);  // l -> i
-    equivalency_mat[11].push_back(34); // l -> I
-    equivalency_mat[34].push_back(8);  // I -> i
-    equivalency_mat[34].push_back(11); // I -> l
-    equivalency_mat[9].push_back(35);  // j -> J
-    equivalency_mat[35].push_back(9);  // J -> j
-    equivalency_mat[14].push_back(40); // o -> O
-    equivalency_mat[14].push_back(52); // o -> 0
-    equivalency_mat[40].push_back(14); // O -> o
-    equivalency_mat[40].push_back(52); // O -> 0
-    equivalency_mat[52].push_back(14); // 0 -> o
-    equivalency_mat[52].push_back(40); // 0 -> O
-    equivalency_mat[15].push_back(41); // p -> P
-    equivalency_mat[41].push_back(15); // P -> p
-    equivalency_mat[18].push_back(44); // s -> S
-    equivalency_mat[44].push_back(18); // S -> s
-    equivalency_mat[20].push_back(46); // u -> U
-    equivalency_mat[46].push_back(20); // U -> u
-    equivalency_mat[21].push_back(47); // v -> V
-    equivalency_mat[47].push_back(21); // V -> v
-    equivalency_mat[22].push_back(48); // w -> W
-    equivalency_mat[48].push_back(22); // W -> w
-    equivalency_mat[23].push_back(49); // x -> X
-    equivalency_mat[49].push_back(23); // X -> x
-    equivalency_mat[25].push_back(51); // z -> Z
-    equivalency_mat[51].push_back(25); // Z -> z
-
-
     for (int j=0; j<responses.cols; j++)
     {
         if (responses.at<float>(0,j)<0)
@@ -911,8 +1005,8 @@ void OCRHMMClassifierKNN::eval( InputArray _mask, vector<int>& out_class, vector
 
     class_predictions = class_predictions/dist_sum[0];
 
-    out_class.push_back((int)predictions.at<float>(0,0));
-    out_confidence.push_back(class_predictions.at<double>(0,(int)predictions.at<float>(0,0)));
+    out_class.push_back((int)predictions.at<float>(row,0));
+    out_confidence.push_back(class_predictions.at<double>(0,(int)predictions.at<float>(row,0)));
 
     for (int i=0; i<class_predictions.cols; i++)
     {
@@ -957,10 +1051,14 @@ public:
     ~OCRHMMClassifierCNN() {}
 
     void eval( InputArray image, vector<int>& out_class, vector<double>& out_confidence );
+    void evalBatch( InputArrayOfArrays images, vector< vector<int> >& out_classes,
+                    vector< vector<double> >& out_confidences );
 
 protected:
     void normalizeAndZCA(Mat& patches);
     double eval_feature(Mat& feature, vector<double>& prob_estimates);
+    // compute the pooled and scaled CNN feature of a single letter image
+    void computeFeature(const Mat& image, Mat& feature);
 
 private:
     int nr_class;		 // number of classes
@@ -1016,16 +1114,17 @@ OCRHMMClassifierCNN::OCRHMMClassifierCNN (const string& filename)
     alpha       = 0.5;
 }
 
-void OCRHMMClassifierCNN::eval( InputArray _src, vector<int>& out_class, vector<double>& out_confidence )
-{
-
-    CV_Assert(( _src.getMat().type() == CV_8UC3 ) || ( _src.getMat().type() == CV_8UC1 ));
-
-    out_class.clear();
-    out_confidence.clear();
-
+// the 9 pools overlapping each of the 25 quads of the window (quad ids start at 1), as a bitmask
+static const int cnn_quad_pools[26] = { 0x000,
+    0x001, 0x003, 0x002, 0x006, 0x004,
+    0x009, 0x01B, 0x012, 0x036, 0x024,
+    0x008, 0x018, 0x010, 0x030, 0x020,
+    0x048, 0x0D8, 0x090, 0x1B0, 0x120,
+    0x040, 0x0C0, 0x080, 0x180, 0x100 };
 
-    Mat img = _src.getMat();
+void OCRHMMClassifierCNN::computeFeature(const Mat& _img, Mat& feature)
+{
+    Mat img = _img;
     if(img.type() == CV_8UC3)
     {
         cvtColor(img,img,COLOR_RGB2GRAY);
@@ -1034,52 +1133,32 @@ void OCRHMMClassifierCNN::eval( InputArray _src, vector<int>& out_class, vector<
     // shall we resize the input image or make a copy ?
     resize(img,img,Size(window_size,window_size));
 
-    Mat quad;
-    Mat tmp;
-
-    int patch_count = 0;
-    vector< vector<double> > data_pool(9);
-
-
-    int quad_id = 1;
     int sz_window_quad = window_size - quad_size;
     int sz_half_quad = (int)(quad_size/2-1);
     int sz_quad_patch = quad_size - patch_size;
+    int quads_per_side = sz_window_quad/sz_half_quad + 1;
+    int patches_per_side = sz_quad_patch + 1;
+
+    // gather all the patches of the window, one per row, to normalize and whiten them at once
+    Mat patches(quads_per_side*quads_per_side*patches_per_side*patches_per_side, patch_size*patch_size, CV_64FC1);
+    vector<int> patch_quad(patches.rows);
+
+    int patch_count = 0;
+    int quad_id = 1;
     for (int q_x=0; q_x <= sz_window_quad; q_x += sz_half_quad)
     {
         for (int q_y=0; q_y <= sz_window_quad; q_y += sz_half_quad)
         {
-            Rect quad_rect = Rect(q_x,q_y,quad_size,quad_size);
-            quad = img(quad_rect);
+            Mat quad = img(Rect(q_x,q_y,quad_size,quad_size));
 
-            //start sliding window (8x8) in each tile and store the patch as row in data_pool
+            //start sliding window (8x8) in each tile and store the patch as row in patches
             for (int w_x = 0; w_x <= sz_quad_patch; w_x++)
             {
                 for (int w_y = 0; w_y <= sz_quad_patch; w_y++)
                 {
-                    quad(Rect(w_x,w_y,patch_size,patch_size)).convertTo(tmp, CV_64F);
-                    tmp = tmp.reshape(0,1);
-                    normalizeAndZCA(tmp);
-                    vector<double> patch;
-                    tmp.copyTo(patch);
-                    if ((quad_id == 1)||(quad_id == 2)||(quad_id == 6)||(quad_id == 7))
-                        data_pool[0].insert(data_pool[0].end(),patch.begin(),patch.end());
-                    if ((quad_id == 2)||(quad_id == 7)||(quad_id == 3)||(quad_id == 8)||(quad_id == 4)||(quad_id == 9))
-                        data_pool[1].insert(data_pool[1].end(),patch.begin(),patch.end());
-                    if ((quad_id == 4)||(quad_id == 9)||(quad_id == 5)||(quad_id == 10))
-                        data_pool[2].insert(data_pool[2].end(),patch.begin(),patch.end());
-                    if ((quad_id == 6)||(quad_id == 11)||(quad_id == 16)||(quad_id == 7)||(quad_id == 12)||(quad_id == 17))
-                        data_pool[3].insert(data_pool[3].end(),patch.begin(),patch.end());
-                    if ((quad_id == 7)||(quad_id == 12)||(quad_id == 17)||(quad_id == 8)||(quad_id == 13)||(quad_id == 18)||(quad_id == 9)||(quad_id == 14)||(quad_id == 19))
-                        data_pool[4].insert(data_pool[4].end(),patch.begin(),patch.end());
-                    if ((quad_id == 9)||(quad_id == 14)||(quad_id == 19)||(quad_id == 10)||(quad_id == 15)||(quad_id == 20))
-                        data_pool[5].insert(data_pool[5].end(),patch.begin(),patch.end());
-                    if ((quad_id == 16)||(quad_id == 21)||(quad_id == 17)||(quad_id == 22))
-                        data_pool[6].insert(data_pool[6].end(),patch.begin(),patch.end());
-                    if ((quad_id == 17)||(quad_id == 22)||(quad_id == 18)||(quad_id == 23)||(quad_id == 19)||(quad_id == 24))
-                        data_pool[7].insert(data_pool[7].end(),patch.begin(),patch.end());
-                    if ((quad_id == 19)||(quad_id == 24)||(quad_id == 20)||(quad_id == 25))
-                        data_pool[8].insert(data_pool[8].end(),patch.begin(),patch.end());
+                    Mat patch(patch_size, patch_size, CV_64FC1, patches.ptr<double>(patch_count));
+                    quad(Rect(w_x,w_y,patch_size,patch_size)).convertTo(patch, CV_64F);
+                    patch_quad[patch_count] = quad_id;
                     patch_count++;
                 }
             }
@@ -1087,25 +1166,30 @@ void OCRHMMClassifierCNN::eval( InputArray _src, vector<int>& out_class, vector<
             quad_id++;
         }
     }
+    normalizeAndZCA(patches);
 
     //do dot product of each normalized and whitened patch
     //each pool is averaged and this yields a representation of 9xD
-    Mat feature = Mat::zeros(9,kernels.rows,CV_64FC1);
-    for (int i=0; i<9; i++)
+    Mat responses;
+    gemm(patches, kernels, 1, noArray(), 0, responses, GEMM_2_T);
+    feature = Mat::zeros(9,kernels.rows,CV_64FC1);
+    for (int p=0; p<responses.rows; p++)
     {
-        Mat pool = Mat(data_pool[i]);
-        pool = pool.reshape(0,(int)data_pool[i].size()/kernels.cols);
-        for (int p=0; p<pool.rows; p++)
+        int pools = (patch_quad[p] < 26) ? cnn_quad_pools[patch_quad[p]] : 0;
+        if (pools == 0)
+            continue;
+        const double* response = responses.ptr<double>(p);
+        for (int i=0; i<9; i++)
         {
+            if (!(pools & (1 << i)))
+                continue;
+            double* pool = feature.ptr<double>(i);
             for (int f=0; f<kernels.rows; f++)
-            {
-                feature.row(i).at<double>(0,f) = feature.row(i).at<double>(0,f) + max(0.0,std::abs(pool.row(p).dot(kernels.row(f)))-alpha);
-            }
+                pool[f] += max(0.0,std::abs(response[f])-alpha);
         }
     }
     feature = feature.reshape(0,1);
 
-
     // data must be normalized within the range obtained during training
     double lower = -1.0;
     double upper =  1.0;
@@ -1115,6 +1199,18 @@ void OCRHMMClassifierCNN::eval( InputArray _src, vector<int>& out_class, vector<
                 (feature.at<double>(0,k)-feature_min.at<double>(0,k))/
                 (feature_max.at<double>(0,k)-feature_min.at<double>(0,k));
     }
+}
+
+void OCRHMMClassifierCNN::eval( InputArray _src, vector<int>& out_class, vector<double>& out_confidence )
+{
+
+    CV_Assert(( _src.getMat().type() == CV_8UC3 ) || ( _src.getMat().type() == CV_8UC1 ));
+
+    out_class.clear();
+    out_confidence.clear();
+
+    Mat feature;
+    computeFeature(_src.getMat(), feature);
 
     vector<double> p(nr_class, 0);
     double predict_label = eval_feature(feature,p);
@@ -1136,6 +1232,42 @@ void OCRHMMClassifierCNN::eval( InputArray _src, vector<int>& out_class, vector<
 
 }
 
+// classify a set of letter images, the whitening parameters are loaded so the classifier is only read
+class OCRHMMCNNEvalBody : public ParallelLoopBody
+{
+public:
+    OCRHMMCNNEvalBody(OCRHMMClassifierCNN& _classifier, const vector<Mat>& _images,
+                      vector< vector<int> >& _out_classes, vector< vector<double> >& _out_confidences) :
+        classifier(_classifier), images(_images), out_classes(_out_classes), out_confidences(_out_confidences) {}
+
+    void operator()( const Range& r ) const
+    {
+        for (int i = r.start; i < r.end; i++)
+            classifier.eval(images[i], out_classes[i], out_confidences[i]);
+    }
+
+private:
+    OCRHMMClassifierCNN& classifier;
+    const vector<Mat>& images;
+    vector< vector<int> >& out_classes;
+    vector< vector<double> >& out_confidences;
+
+    OCRHMMCNNEvalBody& operator=(const OCRHMMCNNEvalBody&);
+};
+
+void OCRHMMClassifierCNN::evalBatch( InputArrayOfArrays _images, vector< vector<int> >& out_classes,
+                                     vector< vector<double> >& out_confidences )
+{
+    vector<Mat> images;
+    _images.getMatVector(images);
+    for (size_t i=0; i<images.size(); i++)
+        CV_Assert(( images[i].type() == CV_8UC3 ) || ( images[i].type() == CV_8UC1 ));
+    out_classes.resize(images.size());
+    out_confidences.resize(images.size());
+
+    parallel_for_(Range(0, (int)images.size()), OCRHMMCNNEvalBody(*this, images, out_classes, out_confidences));
+}
+
 // normalize for contrast and apply ZCA whitening to a set of image patches
 void OCRHMMClassifierCNN::normalizeAndZCA(Mat& patches)
 {
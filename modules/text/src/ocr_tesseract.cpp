@@ -126,6 +126,35 @@ CV_WRAP String OCRTesseract::run(InputArray image, InputArray mask, int min_conf
     return String(output2);
 }
 
+// the default implementation recognizes each region separately
+void OCRTesseract::runRegions(Mat& image, const vector<Rect>& rois, vector<string>& output_texts,
+                              vector< vector<Rect> >* component_rects,
+                              vector< vector<string> >* component_texts,
+                              vector< vector<float> >* component_confidences,
+                              int component_level)
+{
+    CV_Assert( (image.type() == CV_8UC1) || (image.type() == CV_8UC3) );
+    output_texts.assign(rois.size(), string());
+    if (component_rects != NULL)
+        component_rects->assign(rois.size(), vector<Rect>());
+    if (component_texts != NULL)
+        component_texts->assign(rois.size(), vector<string>());
+    if (component_confidences != NULL)
+        component_confidences->assign(rois.size(), vector<float>());
+
+    for (size_t i = 0; i < rois.size(); i++)
+    {
+        CV_Assert( (rois[i] & Rect(0, 0, image.cols, image.rows)) == rois[i] );
+        Mat roi = image(rois[i]);
+        run(roi, output_texts[i], component_rects ? &(*component_rects)[i] : NULL,
+            component_texts ? &(*component_texts)[i] : NULL,
+            component_confidences ? &(*component_confidences)[i] : NULL, component_level);
+        if (component_rects != NULL)
+            for (size_t j = 0; j < (*component_rects)[i].size(); j++)
+                (*component_rects)[i][j] += rois[i].tl();
+    }
+}
+
 
 class OCRTesseractImpl : public OCRTesseract
 {
@@ -196,6 +225,70 @@ public:
             component_confidences->clear();
 
         tess.SetImage((uchar*)image.data, image.size().width, image.size().height, image.channels(), image.step1());
+        recognize(output, component_rects, component_texts, component_confidences, component_level);
+        tess.Clear();
+
+#else
+
+        cout << "OCRTesseract(" << component_level << image.type() <<"): Tesseract not found." << endl;
+        output.clear();
+        if(component_rects)
+            component_rects->clear();
+        if(component_texts)
+            component_texts->clear();
+        if(component_confidences)
+            component_confidences->clear();
+#endif
+    }
+
+    // the image is set once, and each region is a rectangle of it
+    void runRegions(Mat& image, const vector<Rect>& rois, vector<string>& output_texts,
+                    vector< vector<Rect> >* component_rects=NULL,
+                    vector< vector<string> >* component_texts=NULL,
+                    vector< vector<float> >* component_confidences=NULL,
+                    int component_level=0)
+    {
+        CV_Assert( (image.type() == CV_8UC1) || (image.type() == CV_8UC3) );
+
+        output_texts.assign(rois.size(), string());
+        if (component_rects != NULL)
+            component_rects->assign(rois.size(), vector<Rect>());
+        if (component_texts != NULL)
+            component_texts->assign(rois.size(), vector<string>());
+        if (component_confidences != NULL)
+            component_confidences->assign(rois.size(), vector<float>());
+
+        for (size_t i = 0; i < rois.size(); i++)
+            CV_Assert( (rois[i] & Rect(0, 0, image.cols, image.rows)) == rois[i] );
+
+#ifdef HAVE_TESSERACT
+
+        if (rois.empty())
+            return;
+
+        tess.SetImage((uchar*)image.data, image.size().width, image.size().height, image.channels(), image.step1());
+        for (size_t i = 0; i < rois.size(); i++)
+        {
+            // setting the rectangle clears the results of the previous one
+            tess.SetRectangle(rois[i].x, rois[i].y, rois[i].width, rois[i].height);
+            recognize(output_texts[i], component_rects ? &(*component_rects)[i] : NULL,
+                      component_texts ? &(*component_texts)[i] : NULL,
+                      component_confidences ? &(*component_confidences)[i] : NULL, component_level);
+        }
+        tess.Clear();
+
+#else
+
+        cout << "OCRTesseract(" << component_level << image.type() <<"): Tesseract not found." << endl;
+#endif
+    }
+
+#ifdef HAVE_TESSERACT
+private:
+    // recognize the current image (or rectangle of it) and collect the results
+    void recognize(string& output, vector<Rect>* component_rects, vector<string>* component_texts,
+                   vector<float>* component_confidences, int component_level)
+    {
         tess.Recognize(0);
         char *outText;
         outText = tess.GetUTF8Text();
@@ -230,21 +323,10 @@ public:
             }
             delete ri;
         }
+    }
 
-        tess.Clear();
-
-#else
-
-        cout << "OCRTesseract(" << component_level << image.type() <<"): Tesseract not found." << endl;
-        output.clear();
-        if(component_rects)
-            component_rects->clear();
-        if(component_texts)
-            component_texts->clear();
-        if(component_confidences)
-            component_confidences->clear();
+public:
 #endif
-    }
 
     void run(Mat& image, Mat& mask, string& output, vector<Rect>* component_rects=NULL,
              vector<string>* component_texts=NULL, vector<float>* component_confidences=NULL,
@@ -273,5 +355,207 @@ Ptr<OCRTesseract> OCRTesseract::create(const char* datapath, const char* languag
 }
 
 
+class OCRTesseractPoolImpl;
+
+// gives an engine back to its pool when the last pointer to it is released
+struct OCRTesseractPoolRelease
+{
+    OCRTesseractPoolImpl* pool;
+    OCRTesseractPoolRelease(OCRTesseractPoolImpl* _pool) : pool(_pool) {}
+    void operator()(OCRTesseract* engine) const;
+};
+
+class OCRTesseractPoolImpl : public OCRTesseractPool
+{
+public:
+    OCRTesseractPoolImpl(int num_engines, const char* _datapath, const char* _language,
+                         const char* _char_whitelist, int _oem, int _psmode) :
+        has_datapath(_datapath != NULL), has_language(_language != NULL), has_char_whitelist(_char_whitelist != NULL),
+        oem(_oem), psmode(_psmode)
+    {
+        CV_Assert( num_engines > 0 );
+        if (has_datapath)
+            datapath = _datapath;
+        if (has_language)
+            language = _language;
+        if (has_char_whitelist)
+            char_whitelist = _char_whitelist;
+
+        for (int i = 0; i < num_engines; i++)
+            engines.push_back(createEngine());
+        for (int i = num_engines-1; i >= 0; i--)
+            free_engines.push_back(engines[i].get());
+    }
+
+    Ptr<OCRTesseract> acquire()
+    {
+        OCRTesseract* engine = NULL;
+        {
+            AutoLock lock(mutex);
+            if (!free_engines.empty())
+            {
+                engine = free_engines.back();
+                free_engines.pop_back();
+            }
+        }
+
+        // all the engines are in use, the new one is initialized out of the lock
+        if (engine == NULL)
+        {
+            Ptr<OCRTesseract> new_engine = createEngine();
+            AutoLock lock(mutex);
+            engines.push_back(new_engine);
+            engine = new_engine.get();
+        }
+
+        return Ptr<OCRTesseract>(engine, OCRTesseractPoolRelease(this));
+    }
+
+    void release(OCRTesseract* engine)
+    {
+        AutoLock lock(mutex);
+        free_engines.push_back(engine);
+    }
+
+    int size() const
+    {
+        AutoLock lock(mutex);
+        return (int)engines.size();
+    }
+
+    void runRegions(Mat& image, const vector<Rect>& rois, vector<string>& output_texts,
+                    vector< vector<Rect> >* component_rects,
+                    vector< vector<string> >* component_texts,
+                    vector< vector<float> >* component_confidences,
+                    int component_level);
+
+    void setWhiteList(const String& _char_whitelist)
+    {
+        AutoLock lock(mutex);
+        CV_Assert( free_engines.size() == engines.size() );
+        has_char_whitelist = true;
+        char_whitelist = _char_whitelist;
+        for (size_t i = 0; i < engines.size(); i++)
+            engines[i]->setWhiteList(char_whitelist);
+    }
+
+private:
+    Ptr<OCRTesseract> createEngine()
+    {
+        return OCRTesseract::create(has_datapath ? datapath.c_str() : NULL, has_language ? language.c_str() : NULL,
+                                    has_char_whitelist ? char_whitelist.c_str() : NULL, oem, psmode);
+    }
+
+    // initialization parameters of the engines, NULL pointers are kept apart
+    String datapath, language, char_whitelist;
+    bool has_datapath, has_language, has_char_whitelist;
+    int oem, psmode;
+
+    mutable Mutex mutex;
+    vector< Ptr<OCRTesseract> > engines;
+    vector<OCRTesseract*> free_engines;
+};
+
+void OCRTesseractPoolRelease::operator()(OCRTesseract* engine) const
+{
+    pool->release(engine);
+}
+
+// each engine recognizes a slice of the regions, taken every num_engines regions
+class OCRTesseractRegionsBody : public ParallelLoopBody
+{
+public:
+    OCRTesseractRegionsBody(const vector< Ptr<OCRTesseract> >& _engines, Mat& _image, const vector<Rect>& _rois,
+                            vector<string>& _output_texts, vector< vector<Rect> >* _component_rects,
+                            vector< vector<string> >* _component_texts,
+                            vector< vector<float> >* _component_confidences, int _component_level) :
+        engines(_engines), image(_image), rois(_rois), output_texts(_output_texts),
+        component_rects(_component_rects), component_texts(_component_texts),
+        component_confidences(_component_confidences), component_level(_component_level) {}
+
+    void operator()( const Range& r ) const
+    {
+        const size_t num_engines = engines.size();
+        for (int e = r.start; e < r.end; e++)
+        {
+            vector<Rect> slice_rois;
+            for (size_t i = e; i < rois.size(); i += num_engines)
+                slice_rois.push_back(rois[i]);
+
+            vector<string> texts;
+            vector< vector<Rect> > rects;
+            vector< vector<string> > comp_texts;
+            vector< vector<float> > confidences;
+            engines[e]->runRegions(image, slice_rois, texts, component_rects ? &rects : NULL,
+                                   component_texts ? &comp_texts : NULL,
+                                   component_confidences ? &confidences : NULL, component_level);
+
+            for (size_t k = 0, i = e; i < rois.size(); k++, i += num_engines)
+            {
+                output_texts[i].swap(texts[k]);
+                if (component_rects != NULL)
+                    (*component_rects)[i].swap(rects[k]);
+                if (component_texts != NULL)
+                    (*component_texts)[i].swap(comp_texts[k]);
+                if (component_confidences != NULL)
+                    (*component_confidences)[i].swap(confidences[k]);
+            }
+        }
+    }
+
+private:
+    const vector< Ptr<OCRTesseract> >& engines;
+    Mat& image;
+    const vector<Rect>& rois;
+    vector<string>& output_texts;
+    vector< vector<Rect> >* component_rects;
+    vector< vector<string> >* component_texts;
+    vector< vector<float> >* component_confidences;
+    int component_level;
+
+    OCRTesseractRegionsBody& operator=(const OCRTesseractRegionsBody&);
+};
+
+void OCRTesseractPoolImpl::runRegions(Mat& image, const vector<Rect>& rois, vector<string>& output_texts,
+                                      vector< vector<Rect> >* component_rects,
+                                      vector< vector<string> >* component_texts,
+                                      vector< vector<float> >* component_confidences,
+                                      int component_level)
+{
+    CV_Assert( (image.type() == CV_8UC1) || (image.type() == CV_8UC3) );
+
+    output_texts.assign(rois.size(), string());
+    if (component_rects != NULL)
+        component_rects->assign(rois.size(), vector<Rect>());
+    if (component_texts != NULL)
+        component_texts->assign(rois.size(), vector<string>());
+    if (component_confidences != NULL)
+        component_confidences->assign(rois.size(), vector<float>());
+    if (rois.empty())
+        return;
+
+    // use all the free engines, and at least one
+    vector< Ptr<OCRTesseract> > batch_engines(1, acquire());
+    {
+        AutoLock lock(mutex);
+        while (!free_engines.empty() && batch_engines.size() < rois.size())
+        {
+            batch_engines.push_back(Ptr<OCRTesseract>(free_engines.back(), OCRTesseractPoolRelease(this)));
+            free_engines.pop_back();
+        }
+    }
+
+    parallel_for_(Range(0, (int)batch_engines.size()),
+                  OCRTesseractRegionsBody(batch_engines, image, rois, output_texts, component_rects,
+                                          component_texts, component_confidences, component_level));
+}
+
+Ptr<OCRTesseractPool> OCRTesseractPool::create(int num_engines, const char* datapath, const char* language,
+                                               const char* char_whitelist, int oem, int psmode)
+{
+    return makePtr<OCRTesseractPoolImpl>(num_engines, datapath, language, char_whitelist, oem, psmode);
+}
+
+
 }
 }
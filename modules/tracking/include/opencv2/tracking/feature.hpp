@@ -223,6 +223,10 @@ class CvHaarEvaluator : public CvFeatureEvaluator
 
     FeatureHaar( Size patchSize );
     bool eval( const Mat& image, Rect ROI, float* result ) const;
+    /** Offsets of the corners of the feature areas (in elements, in the order used by eval()) in the
+     integral image of the given size and row step, and the weights of the areas. The feature value is
+     the sum of ((p[ofs[4*k]] + p[ofs[4*k+1]]) - p[ofs[4*k+2]] - p[ofs[4*k+3]]) * weights[k]. */
+    void getAreaOffsets( Size imageSize, size_t step, std::vector<int>& offsets, std::vector<float>& weights ) const;
     int getNumAreas();
     const std::vector<float>& getWeights() const;
     const std::vector<Rect>& getAreas() const;
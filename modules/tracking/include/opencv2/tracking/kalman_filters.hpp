@@ -222,6 +222,63 @@ CV_EXPORTS Ptr<UnscentedKalmanFilter> createUnscentedKalmanFilter( const Unscent
 */
 CV_EXPORTS Ptr<UnscentedKalmanFilter> createAugmentedUnscentedKalmanFilter( const AugmentedUnscentedKalmanFilterParams &params );
 
+/** @brief The interface for a set of Unscented (or Augmented Unscented) Kalman filters with the same parameters
+* which are updated together, e.g. one filter per target in multi-object tracking.
+* Vectors of all filters are stored as columns of matrices: the i-th column of the states matrix is the state of the i-th filter.
+* The filters are updated in parallel, so the functions of the system model must be thread-safe.
+*/
+class CV_EXPORTS UnscentedKalmanFilterBatch
+{
+public:
+
+    virtual ~UnscentedKalmanFilterBatch(){}
+
+    /**
+    * @return the number of filters.
+    */
+    virtual int getNumFilters() const = 0;
+
+    /** The function performs prediction step of all filters
+    * @param controls - the current control vectors, CP x N, or empty.
+    */
+    virtual void predict( InputArray controls = noArray() ) = 0;
+
+    /** The function performs correction step of the filters
+    * @param measurements - the current measurement vectors, MP x N,
+    * @param mask - optional CV_8UC1 vector of N elements, filters with zero mask values are not corrected (e.g. targets without detections).
+    */
+    virtual void correct( InputArray measurements, InputArray mask = noArray() ) = 0;
+
+    /**
+    * @return the current estimates of the states, DP x N.
+    */
+    virtual Mat getStates() const = 0;
+
+    /**
+    * @param index - index of the filter,
+    * @return the error cross-covariance matrix of the filter.
+    */
+    virtual Mat getErrorCov( int index ) const = 0;
+
+    /** The function restarts one filter, e.g. for a new target
+    * @param index - index of the filter,
+    * @param state - the new state, DP x 1,
+    * @param errorCov - the new error cross-covariance matrix, DP x DP, default is errorCovInit of the parameters.
+    */
+    virtual void reset( int index, InputArray state, InputArray errorCov = noArray() ) = 0;
+};
+
+/** @brief Factory method of the batch of Unscented Kalman filters
+* @param params - an object of the UnscentedKalmanFilterParams class containing UKF parameters,
+* @param numFilters - number of filters N, each of them is initialized by params.
+*/
+CV_EXPORTS Ptr<UnscentedKalmanFilterBatch> createUnscentedKalmanFilterBatch( const UnscentedKalmanFilterParams &params, int numFilters );
+/** @brief Factory method of the batch of Augmented Unscented Kalman filters
+* @param params - an object of the AugmentedUnscentedKalmanFilterParams class containing AUKF parameters,
+* @param numFilters - number of filters N, each of them is initialized by params.
+*/
+CV_EXPORTS Ptr<UnscentedKalmanFilterBatch> createAugmentedUnscentedKalmanFilterBatch( const AugmentedUnscentedKalmanFilterParams &params, int numFilters );
+
 } // tracking
 } // cv
 
@@ -104,6 +104,9 @@ class ClfOnlineStump
   bool classify( const Mat& x, int i );
   float classifyF( const Mat& x, int i );
   std::vector<float> classifySetF( const Mat& x );
+  /** Log odds ratios of all the samples. Data is transposed, i.e. one row per feature,
+   so the values of the stump feature are contiguous. */
+  void classifyTransposed( const Mat& xT, float* res ) const;
 
  private:
   bool _trained;
@@ -821,7 +821,7 @@ class CV_EXPORTS TrackerSamplerCSC : public TrackerSamplerAlgorithm
   int mode;
   RNG rng;
 
-  std::vector<Mat> sampleImage( const Mat& img, int x, int y, int w, int h, float inrad, float outrad = 0, int maxnum = 1000000 );
+  void sampleImage( const Mat& img, std::vector<Mat>& samples, int x, int y, int w, int h, float inrad, float outrad = 0, int maxnum = 1000000 );
 };
 
 /** @brief TrackerSampler based on CS (current state), used by algorithm TrackerBoosting
@@ -865,7 +865,7 @@ class CV_EXPORTS TrackerSamplerCS : public TrackerSamplerAlgorithm
  private:
   Rect getTrackingROI( float searchFactor );
   Rect RectMultiply( const Rect & rect, float f );
-  std::vector<Mat> patchesRegularScan( const Mat& image, Rect trackingROI, Size patchSize );
+  void patchesRegularScan( const Mat& image, Rect trackingROI, Size patchSize, std::vector<Mat>& sample );
   void setCheckedROI( Rect imageROI );
 
   Params params;
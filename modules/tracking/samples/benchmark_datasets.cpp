@@ -0,0 +1,294 @@
+//
+//  !!! this sample requires the opencv_datasets module !!!
+//
+//  Runs trackers over all the sequences of VOT or ALOV datasets and reports
+//  throughput, per-frame latency percentiles, memory and overlap accuracy.
+//
+
+#include "opencv2/opencv_modules.hpp"
+#ifdef HAVE_OPENCV_DATASETS
+
+#include "opencv2/datasets/track_vot.hpp"
+#include "opencv2/datasets/track_alov.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/tracking.hpp"
+#include "samples_utility.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined __linux__
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace cv;
+using namespace cv::datasets;
+
+// Resident set size of the process in megabytes, or -1 if unknown.
+static double getResidentMemoryMB()
+{
+#if defined __linux__
+    ifstream statm("/proc/self/statm");
+    long size = 0, resident = -1;
+    if (statm >> size >> resident)
+        return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+    return -1.0;
+}
+
+template <typename T>
+static Rect2d polygonBoundingBox(const vector<T> &points)
+{
+    if (points.empty())
+        return Rect2d();
+    double x0 = points[0].x, y0 = points[0].y, x1 = x0, y1 = y0;
+    for (size_t i = 1; i < points.size(); i++)
+    {
+        x0 = std::min(x0, (double)points[i].x); x1 = std::max(x1, (double)points[i].x);
+        y0 = std::min(y0, (double)points[i].y); y1 = std::max(y1, (double)points[i].y);
+    }
+    return Rect2d(x0, y0, x1 - x0, y1 - y0);
+}
+
+// Common interface of the dataset loaders: sequential frames with ground truth boxes.
+// Frames without annotation have empty boxes.
+struct SequenceSource
+{
+    virtual ~SequenceSource() {}
+    virtual int getNumSequences() = 0;
+    virtual bool init(int id) = 0;
+    virtual bool next(Mat &frame, Rect2d &gt) = 0;
+};
+
+struct VotSource : public SequenceSource
+{
+    VotSource(const string &path) : dataset(TRACK_vot::create()) { dataset->load(path); }
+    int getNumSequences() { return dataset->getDatasetsNum(); }
+    bool init(int id) { return dataset->initDataset(id); }
+    bool next(Mat &frame, Rect2d &gt)
+    {
+        if (!dataset->getNextFrame(frame))
+            return false;
+        gt = polygonBoundingBox(dataset->getGT());
+        return true;
+    }
+    Ptr<TRACK_vot> dataset;
+};
+
+struct AlovSource : public SequenceSource
+{
+    AlovSource(const string &path) : dataset(TRACK_alov::create()) { dataset->load(path); }
+    int getNumSequences() { return dataset->getDatasetsNum(); }
+    bool init(int id) { return dataset->initDataset(id); }
+    bool next(Mat &frame, Rect2d &gt)
+    {
+        if (!dataset->getNextFrame(frame))
+            return false;
+        gt = polygonBoundingBox(dataset->getNextGT());
+        return true;
+    }
+    Ptr<TRACK_alov> dataset;
+};
+
+static inline bool isGoodBox(const Rect2d &box) { return box.width > 0. && box.height > 0.; }
+
+struct SequenceStat
+{
+    SequenceStat() : sequence(0), numFrames(0), numAnnotated(0), numSuccess(0), sumOverlap(0),
+                     initTime(0), memoryMB(0) {}
+
+    int sequence;
+    int numFrames;          // frames passed to Tracker::update()
+    int numAnnotated;       // frames with ground truth
+    int numSuccess;         // annotated frames where overlap with ground truth > 0.5
+    double sumOverlap;      // sum of overlaps on annotated frames
+    double initTime;        // seconds
+    double memoryMB;        // growth of resident memory while tracking
+    vector<double> latency; // seconds per frame
+};
+
+static double percentile(vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    size_t k = std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+static SequenceStat runSequence(const string &algo, SequenceSource &source, int id, int maxFrames)
+{
+    SequenceStat stat;
+    stat.sequence = id;
+    if (!source.init(id))
+        return stat;
+
+    Mat frame;
+    Rect2d gt;
+    // the tracker is initialized on the first annotated frame
+    while (source.next(frame, gt))
+    {
+        if (isGoodBox(gt))
+            break;
+    }
+    if (frame.empty() || !isGoodBox(gt))
+        return stat;
+
+    const double memBefore = getResidentMemoryMB();
+    Ptr<Tracker> tracker = createTrackerByName(algo);
+    int64 t = getTickCount();
+    bool ok = tracker->init(frame, gt);
+    stat.initTime = (getTickCount() - t) / getTickFrequency();
+    if (!ok)
+        return stat;
+
+    double memPeak = memBefore;
+    while ((maxFrames <= 0 || stat.numFrames < maxFrames) && source.next(frame, gt))
+    {
+        Rect2d box;
+        t = getTickCount();
+        bool found = tracker->update(frame, box);
+        stat.latency.push_back((getTickCount() - t) / getTickFrequency());
+        stat.numFrames++;
+
+        if (isGoodBox(gt))
+        {
+            double overlap = 0;
+            if (found && isGoodBox(box))
+                overlap = (gt & box).area() / (gt | box).area();
+            stat.numAnnotated++;
+            stat.sumOverlap += overlap;
+            stat.numSuccess += overlap > 0.5 ? 1 : 0;
+        }
+        memPeak = std::max(memPeak, getResidentMemoryMB());
+    }
+    stat.memoryMB = memBefore >= 0 ? memPeak - memBefore : -1;
+    return stat;
+}
+
+static void printSummary(const string &algo, const vector<SequenceStat> &stats)
+{
+    vector<double> latency;
+    int numFrames = 0, numAnnotated = 0, numSuccess = 0;
+    double sumOverlap = 0, totalTime = 0, initTime = 0, memoryMB = 0;
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        latency.insert(latency.end(), stats[i].latency.begin(), stats[i].latency.end());
+        numFrames += stats[i].numFrames;
+        numAnnotated += stats[i].numAnnotated;
+        numSuccess += stats[i].numSuccess;
+        sumOverlap += stats[i].sumOverlap;
+        initTime += stats[i].initTime;
+        memoryMB = std::max(memoryMB, stats[i].memoryMB);
+    }
+    for (size_t i = 0; i < latency.size(); i++)
+        totalTime += latency[i];
+
+    cout << "==========" << endl << algo << endl;
+    cout << setw(24) << "Sequences" << setw(16) << stats.size() << endl;
+    cout << setw(24) << "Frames" << setw(16) << numFrames << endl;
+    cout << setw(24) << "FPS" << setw(16) << (totalTime > 0 ? numFrames / totalTime : 0) << endl;
+    cout << setw(24) << "Latency p50" << setw(16) << percentile(latency, 0.5) * 1000 << " ms" << endl;
+    cout << setw(24) << "Latency p90" << setw(16) << percentile(latency, 0.9) * 1000 << " ms" << endl;
+    cout << setw(24) << "Latency p99" << setw(16) << percentile(latency, 0.99) * 1000 << " ms" << endl;
+    cout << setw(24) << "Init time (mean)" << setw(16) << (stats.empty() ? 0 : initTime / stats.size() * 1000) << " ms" << endl;
+    cout << setw(24) << "Memory growth (max)" << setw(16) << memoryMB << " MB" << endl;
+    cout << setw(24) << "Mean overlap" << setw(16) << (numAnnotated ? sumOverlap / numAnnotated : 0) << endl;
+    cout << setw(24) << "Success (overlap>0.5)" << setw(16) << (numAnnotated ? 100.0 * numSuccess / numAnnotated : 0) << " %" << endl;
+}
+
+static void writeCSV(ofstream &csv, const string &algo, const vector<SequenceStat> &stats)
+{
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        const SequenceStat &s = stats[i];
+        double total = 0;
+        for (size_t j = 0; j < s.latency.size(); j++)
+            total += s.latency[j];
+        csv << algo << "," << s.sequence << "," << s.numFrames << ","
+            << (total > 0 ? s.numFrames / total : 0) << ","
+            << percentile(s.latency, 0.5) * 1000 << "," << percentile(s.latency, 0.9) * 1000 << ","
+            << percentile(s.latency, 0.99) * 1000 << "," << s.initTime * 1000 << "," << s.memoryMB << ","
+            << (s.numAnnotated ? s.sumOverlap / s.numAnnotated : 0) << ","
+            << (s.numAnnotated ? (double)s.numSuccess / s.numAnnotated : 0) << endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const string keys =
+        "{help h||show help}"
+        "{dataset|vot|dataset type: vot or alov}"
+        "{num|0|maximum number of frames per sequence (0 for all)}"
+        "{sequences|0|number of sequences to process (0 for all)}"
+        "{csv||file to write per-sequence results}"
+        "{@path||dataset path}"
+        "{@algos|KCF,MEDIAN_FLOW,MIL,BOOSTING,TLD|comma-separated algorithm names}";
+    CommandLineParser p(argc, argv, keys);
+    p.about("Benchmark of the trackers on VOT and ALOV datasets");
+    if (p.has("help"))
+    {
+        p.printMessage();
+        return 0;
+    }
+    string datasetType = p.get<string>("dataset");
+    int maxFrames = p.get<int>("num");
+    int maxSequences = p.get<int>("sequences");
+    string csvFile = p.get<string>("csv");
+    string path = p.get<string>("@path");
+    string algList = p.get<string>("@algos");
+    if (!p.check() || path.empty())
+    {
+        p.printErrors();
+        p.printMessage();
+        return 0;
+    }
+
+    Ptr<SequenceSource> source;
+    if (datasetType == "vot")
+        source = makePtr<VotSource>(path);
+    else if (datasetType == "alov")
+        source = makePtr<AlovSource>(path);
+    else
+        CV_Error(Error::StsBadArg, "Unknown dataset type: " + datasetType);
+
+    int numSequences = source->getNumSequences();
+    if (maxSequences > 0)
+        numSequences = std::min(numSequences, maxSequences);
+    cout << "Sequences: " << numSequences << endl;
+
+    ofstream csv;
+    if (!csvFile.empty())
+    {
+        csv.open(csvFile.c_str());
+        csv << "tracker,sequence,frames,fps,p50_ms,p90_ms,p99_ms,init_ms,memory_mb,mean_overlap,success" << endl;
+    }
+
+    istringstream input(algList);
+    string algo;
+    while (getline(input, algo, ','))
+    {
+        vector<SequenceStat> stats;
+        for (int id = 1; id <= numSequences; id++)
+        {
+            stats.push_back(runSequence(algo, *source, id, maxFrames));
+            cout << algo << " - sequence " << id << ": " << stats.back().numFrames << " frames" << endl;
+        }
+        printSummary(algo, stats);
+        if (csv.is_open())
+            writeCSV(csv, algo, stats);
+    }
+
+    return 0;
+}
+
+#else // ! HAVE_OPENCV_DATASETS
+#include <opencv2/core.hpp>
+int main() {
+    CV_Error(cv::Error::StsNotImplemented , "this sample needs to be built with opencv_datasets !");
+    return -1;
+}
+#endif // HAVE_OPENCV_DATASETS
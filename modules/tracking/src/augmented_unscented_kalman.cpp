@@ -41,6 +41,7 @@
 
 #include "precomp.hpp"
 #include "opencv2/tracking/kalman_filters.hpp"
+#include "unscented_kalman_batch.hpp"
 
 namespace cv
 {
@@ -126,7 +127,7 @@ class AugmentedUnscentedKalmanFilterImpl: public UnscentedKalmanFilter
     Mat measurementSPFuncValsCenter;            // set of measurement function values at sigma points minus estimate of measurement ( hc_i, i = 1..2*DP+1 ), MP x 2*DP+1
 
     Mat Wm;                                     // vector of weights for estimate mean, 2*DP+1 x 1
-    Mat Wc;                                     // matrix of weights for estimate covariance, 2*DP+1 x 2*DP+1
+    Mat Wc;                                     // vector of weights for estimate covariance (diagonal of the weight matrix), 2*DAug+1 x 1
 
     Mat gain;                                   // Kalman gain matrix (K), DP x MP
     Mat xyCov;                                  // estimate of the covariance between x* and y* (Sxy), DP x MP
@@ -135,7 +136,14 @@ class AugmentedUnscentedKalmanFilterImpl: public UnscentedKalmanFilter
     Mat r;                                      // zero vector of process noise for getting transitionSPFuncVals,
     Mat q;                                      // zero vector of measurement noise for getting measurementSPFuncVals
 
-    Mat getSigmaPoints(const Mat& mean, const Mat& covMatrix, double coef);
+// Buffers which are allocated once and reused by predict() and correct()
+    Mat covMatrixL;                             // Cholesky factor of errorCovAug, DAug x DAug
+    Mat transitionSPWeightedCenter;             // fc_i multiplied by Wc[i], DP x 2*DAug+1
+    Mat measurementSPWeightedCenter;            // hc_i multiplied by Wc[i], MP x 2*DAug+1
+    Mat yyCovInv;                               // Syy^(-1), MP x MP
+    Mat innovation;                             // y - y*, MP x 1
+    Mat stateCorrection;                        // K*(y - y*), DP x 1
+    Mat errorCovCorrection;                     // K*Sxy.t, DP x DP
 
 public:
 
@@ -151,6 +159,12 @@ public:
 
     Mat getState() const;
 
+//  Versions of predict() and correct() which don't copy the state, they are used by the filters batch
+    void predictInPlace(const Mat& control);
+    void correctInPlace(const Mat& measurement);
+    void reset(const Mat& newState, const Mat& newErrorCov);
+    const Mat& stateRef() const { return state; }
+    const Mat& errorCovRef() const { return errorCov; }
 };
 
 AugmentedUnscentedKalmanFilterImpl::AugmentedUnscentedKalmanFilterImpl(const AugmentedUnscentedKalmanFilterParams& params)
@@ -193,7 +207,18 @@ AugmentedUnscentedKalmanFilterImpl::AugmentedUnscentedKalmanFilterImpl(const Aug
 
     measurementEstimate = Mat::zeros( MP, 1, dataType);
 
-    gain = Mat::zeros( DAug, DAug, dataType );
+    gain = Mat::zeros( DP, MP, dataType );
+    xyCov = Mat::zeros( DP, MP, dataType );
+    yyCov = Mat::zeros( MP, MP, dataType );
+
+    sigmaPoints = Mat::zeros( DAug, 2*DAug+1, dataType );
+    covMatrixL = Mat::zeros( DAug, DAug, dataType );
+    transitionSPWeightedCenter = Mat::zeros( DP, 2*DAug+1, dataType );
+    measurementSPWeightedCenter = Mat::zeros( MP, 2*DAug+1, dataType );
+    yyCovInv = Mat::zeros( MP, MP, dataType );
+    innovation = Mat::zeros( MP, 1, dataType );
+    stateCorrection = Mat::zeros( DP, 1, dataType );
+    errorCovCorrection = Mat::zeros( DP, DP, dataType );
 
     transitionSPFuncVals = Mat::zeros( DP, 2*DAug+1, dataType );
     measurementSPFuncVals = Mat::zeros( MP, 2*DAug+1, dataType );
@@ -207,7 +232,7 @@ AugmentedUnscentedKalmanFilterImpl::AugmentedUnscentedKalmanFilterImpl(const Aug
     double tmp2Lambda = 0.5/tmpLambda;
 
     Wm = tmp2Lambda * Mat::ones( 2*DAug+1, 1, dataType );
-    Wc = tmp2Lambda * Mat::eye( 2*DAug+1, 2*DAug+1, dataType );
+    Wc = tmp2Lambda * Mat::ones( 2*DAug+1, 1, dataType );
 
     if ( dataType == CV_64F )
     {
@@ -253,45 +278,25 @@ AugmentedUnscentedKalmanFilterImpl::~AugmentedUnscentedKalmanFilterImpl()
     r.release();
     q.release();
 
+    covMatrixL.release();
+    transitionSPWeightedCenter.release();
+    measurementSPWeightedCenter.release();
+    yyCovInv.release();
+    innovation.release();
+    stateCorrection.release();
+    errorCovCorrection.release();
 }
 
-Mat AugmentedUnscentedKalmanFilterImpl::getSigmaPoints(const Mat &mean, const Mat &covMatrix, double coef)
+Mat AugmentedUnscentedKalmanFilterImpl::predict(InputArray _control)
 {
-// x_0 = mean
-// x_i = mean + coef * cholesky( covMatrix ), i = 1..n
-// x_(i+n) = mean - coef * cholesky( covMatrix ), i = 1..n
-
-    int n = mean.rows;
-    Mat points = repeat(mean, 1, 2*n+1);
-
-    Mat covMatrixL = covMatrix.clone();
-
-// covMatrixL = cholesky( covMatrix )
-    if ( dataType == CV_64F )
-        choleskyDecomposition<double>(
-                    covMatrix.ptr<double>(), covMatrix.step, covMatrix.rows,
-                    covMatrixL.ptr<double>(), covMatrixL.step );
-    else if ( dataType == CV_32F )
-        choleskyDecomposition<float>(
-                    covMatrix.ptr<float>(), covMatrix.step, covMatrix.rows,
-                    covMatrixL.ptr<float>(), covMatrixL.step );
-
-    covMatrixL = coef * covMatrixL;
-
-    Mat p_plus = points( Rect( 1, 0, n, n ) );
-    Mat p_minus = points( Rect( n+1, 0, n, n ) );
-
-    add(p_plus, covMatrixL, p_plus);
-    subtract(p_minus, covMatrixL, p_minus);
-
-    return points;
+    predictInPlace( _control.getMat() );
+    return state.clone();
 }
 
-Mat AugmentedUnscentedKalmanFilterImpl::predict(InputArray _control)
+void AugmentedUnscentedKalmanFilterImpl::predictInPlace(const Mat& control)
 {
-    Mat control = _control.getMat();
 // get sigma points from xa* and Pa
-    sigmaPoints = getSigmaPoints( stateAug, errorCovAug, sqrt( tmpLambda ) );
+    computeSigmaPoints( stateAug, errorCovAug, sqrt( tmpLambda ), covMatrixL, sigmaPoints );
 
 // compute f-function values at sigma points
 // f_i = f(x_i[0:DP-1], control, x_i[DP:2*DP-1]), i = 0..2*DAug
@@ -306,29 +311,32 @@ Mat AugmentedUnscentedKalmanFilterImpl::predict(InputArray _control)
 
 // compute the estimate of state as mean f-function value at sigma point
 // x* = SUM_{i=0}^{2*DAug}( Wm[i]*f_i )
-    state = transitionSPFuncVals * Wm;
+    gemm( transitionSPFuncVals, Wm, 1.0, noArray(), 0.0, state );
 
 // compute f-function values at sigma points minus estimate of state
 // fc_i = f_i - x*, i = 0..2*DAug
-    subtract(transitionSPFuncVals, repeat( state, 1, 2*DAug+1 ), transitionSPFuncValsCenter);
+    centerColumns( transitionSPFuncVals, state, transitionSPFuncValsCenter );
 
 // compute the estimate of the state cross-covariance matrix
 // P = SUM_{i=0}^{2*DAug}( Wc[i]*fc_i*fc_i.t )
-    errorCov = transitionSPFuncValsCenter * Wc * transitionSPFuncValsCenter.t();
+    scaleColumns( transitionSPFuncValsCenter, Wc, transitionSPWeightedCenter );
+    gemm( transitionSPWeightedCenter, transitionSPFuncValsCenter, 1.0, noArray(), 0.0, errorCov, GEMM_2_T );
+}
 
+Mat AugmentedUnscentedKalmanFilterImpl::correct(InputArray _measurement)
+{
+    correctInPlace( _measurement.getMat() );
     return state.clone();
 }
 
-Mat AugmentedUnscentedKalmanFilterImpl::correct(InputArray _measurement)
+void AugmentedUnscentedKalmanFilterImpl::correctInPlace(const Mat& measurement)
 {
-    Mat measurement = _measurement.getMat();
 // get sigma points from xa* and Pa
-    sigmaPoints = getSigmaPoints( stateAug, errorCovAug, sqrt( tmpLambda ) );
+    computeSigmaPoints( stateAug, errorCovAug, sqrt( tmpLambda ), covMatrixL, sigmaPoints );
 
 // compute h-function values at sigma points
 // h_i = h(x_i[0:DP-1], x_i[2*DP:DAug-1]), i = 0..2*DAug
     Mat x, hx;
-    measurementEstimate.setTo(0);
     for ( int i = 0; i<2*DAug+1; i++)
     {
         x = transitionSPFuncVals( Rect( i, 0, 1, DP) );
@@ -339,33 +347,42 @@ Mat AugmentedUnscentedKalmanFilterImpl::correct(InputArray _measurement)
 
 // compute the estimate of measurement as mean h-function value at sigma point
 // y* = SUM_{i=0}^{2*DAug}( Wm[i]*h_i )
-    measurementEstimate = measurementSPFuncVals * Wm;
+    gemm( measurementSPFuncVals, Wm, 1.0, noArray(), 0.0, measurementEstimate );
 
 // compute h-function values at sigma points minus estimate of state
 // hc_i = h_i - y*, i = 0..2*DAug
-    subtract(measurementSPFuncVals, repeat( measurementEstimate, 1, 2*DAug+1 ), measurementSPFuncValsCenter);
+    centerColumns( measurementSPFuncVals, measurementEstimate, measurementSPFuncValsCenter );
 
 // compute the estimate of the y* cross-covariance matrix
 // Syy = SUM_{i=0}^{2*DAug}( Wc[i]*hc_i*hc_i.t )
-    yyCov = measurementSPFuncValsCenter * Wc * measurementSPFuncValsCenter.t();
+    scaleColumns( measurementSPFuncValsCenter, Wc, measurementSPWeightedCenter );
+    gemm( measurementSPWeightedCenter, measurementSPFuncValsCenter, 1.0, noArray(), 0.0, yyCov, GEMM_2_T );
 
 // compute the estimate of the covariance between x* and y*
 // Sxy = SUM_{i=0}^{2*DAug}( Wc[i]*fc_i*hc_i.t )
-    xyCov = transitionSPFuncValsCenter * Wc * measurementSPFuncValsCenter.t();
+    gemm( transitionSPFuncValsCenter, measurementSPWeightedCenter, 1.0, noArray(), 0.0, xyCov, GEMM_2_T );
 
 // compute the Kalman gain matrix
 // K = Sxy * Syy^(-1)
-    gain = xyCov * yyCov.inv(DECOMP_SVD);
+    invert( yyCov, yyCovInv, DECOMP_SVD );
+    gemm( xyCov, yyCovInv, 1.0, noArray(), 0.0, gain );
 
 // compute the corrected estimate of state
 // x* = x* + K*(y - y*), y - current measurement
-    state = state + gain * ( measurement - measurementEstimate );
+    subtract( measurement, measurementEstimate, innovation );
+    gemm( gain, innovation, 1.0, noArray(), 0.0, stateCorrection );
+    add( state, stateCorrection, state );
 
 // compute the corrected estimate of the state cross-covariance matrix
 // P = P - K*Sxy.t
-    errorCov = errorCov - gain * xyCov.t();
+    gemm( gain, xyCov, 1.0, noArray(), 0.0, errorCovCorrection, GEMM_2_T );
+    subtract( errorCov, errorCovCorrection, errorCov );
+}
 
-    return state.clone();
+void AugmentedUnscentedKalmanFilterImpl::reset(const Mat& newState, const Mat& newErrorCov)
+{
+    newState.copyTo( state );
+    newErrorCov.copyTo( errorCov );
 }
 
 Mat AugmentedUnscentedKalmanFilterImpl::getProcessNoiseCov() const
@@ -394,5 +411,12 @@ Ptr<UnscentedKalmanFilter> createAugmentedUnscentedKalmanFilter(const AugmentedU
     return kfu;
 }
 
+Ptr<UnscentedKalmanFilterBatch> createAugmentedUnscentedKalmanFilterBatch(const AugmentedUnscentedKalmanFilterParams &params, int numFilters)
+{
+    Ptr<UnscentedKalmanFilterBatch> batch(
+        new UnscentedKalmanFilterBatchImpl<AugmentedUnscentedKalmanFilterImpl, AugmentedUnscentedKalmanFilterParams>(params, numFilters) );
+    return batch;
+}
+
 } // tracking
 } // cv
@@ -723,6 +723,29 @@ bool CvHaarEvaluator::FeatureHaar::eval( const Mat& image, Rect /*ROI*/, float*
   return true;
 }
 
+void CvHaarEvaluator::FeatureHaar::getAreaOffsets( Size imageSize, size_t step, std::vector<int>& offsets, std::vector<float>& weights ) const
+{
+  offsets.resize( 4 * m_numAreas );
+  weights.resize( m_numAreas );
+  for ( int curArea = 0; curArea < m_numAreas; curArea++ )
+  {
+    // the same clipping as in getSum()
+    int x = m_areas[curArea].x, y = m_areas[curArea].y;
+    int width = m_areas[curArea].width, height = m_areas[curArea].height;
+    if( x + width >= imageSize.width - 1 )
+      width = ( imageSize.width - 1 ) - x;
+    if( y + height >= imageSize.height - 1 )
+      height = ( imageSize.height - 1 ) - y;
+
+    int* ofs = &offsets[4 * curArea];
+    ofs[0] = (int) ( ( y + height ) * step + x + width );
+    ofs[1] = (int) ( y * step + x );
+    ofs[2] = (int) ( y * step + x + width );
+    ofs[3] = (int) ( ( y + height ) * step + x );
+    weights[curArea] = m_scaleWeights[curArea];
+  }
+}
+
 float CvHaarEvaluator::FeatureHaar::getSum( const Mat& image, Rect imageROI ) const
 {
 // left upper Origin
@@ -130,21 +130,37 @@ bool TrackerGOTURNImpl::initImpl(const Mat& image, const Rect2d& boundingBox)
     return true;
 }
 
-bool TrackerGOTURNImpl::updateImpl(const Mat& image, Rect2d& boundingBox)
+static const int INPUT_SIZE = 227;
+static const float padTargetPatch = 2.0;
+
+// Crop of the image padded by (padX, padY) pixels with BORDER_REPLICATE.
+// Only the crop is padded instead of the whole frame.
+static Mat paddedCrop(const Mat& img, const Rect& roiInPadded, int padX, int padY)
+{
+    Rect roi(roiInPadded.x - padX, roiInPadded.y - padY, roiInPadded.width, roiInPadded.height);
+    Rect inner = roi & Rect(0, 0, img.cols, img.rows);
+    Mat patch;
+    if (inner.area() > 0)
+    {
+        copyMakeBorder(img(inner), patch, inner.y - roi.y, roi.br().y - inner.br().y,
+                       inner.x - roi.x, roi.br().x - inner.br().x, BORDER_REPLICATE | BORDER_ISOLATED);
+    }
+    else
+    {
+        Mat imgPadded;
+        copyMakeBorder(img, imgPadded, padY, padY, padX, padX, BORDER_REPLICATE);
+        patch = imgPadded(roiInPadded).clone();
+    }
+    return patch;
+}
+
+void TrackerGOTURNImpl::preparePatches(const Mat& curFrame, Mat& targetPatch, Mat& searchPatch, Rect2f& targetPatchRect)
 {
-    int INPUT_SIZE = 227;
     //Using prevFrame & prevBB from model and curFrame GOTURN calculating curBB
-    Mat curFrame = image.clone();
     Mat prevFrame = ((TrackerGOTURNModel*)static_cast<TrackerModel*>(model))->getImage();
     Rect2d prevBB = ((TrackerGOTURNModel*)static_cast<TrackerModel*>(model))->getBoundingBox();
-    Rect2d curBB;
-
-    float padTargetPatch = 2.0;
-    Rect2f searchPatchRect, targetPatchRect;
-    Point2f currCenter, prevCenter;
-    Mat prevFramePadded, curFramePadded;
-    Mat searchPatch, targetPatch;
 
+    Point2f prevCenter;
     prevCenter.x = (float)(prevBB.x + prevBB.width / 2);
     prevCenter.y = (float)(prevBB.y + prevBB.height / 2);
 
@@ -153,11 +169,9 @@ bool TrackerGOTURNImpl::updateImpl(const Mat& image, Rect2d& boundingBox)
     targetPatchRect.x = (float)(prevCenter.x - prevBB.width*padTargetPatch / 2.0 + targetPatchRect.width);
     targetPatchRect.y = (float)(prevCenter.y - prevBB.height*padTargetPatch / 2.0 + targetPatchRect.height);
 
-    copyMakeBorder(prevFrame, prevFramePadded, (int)targetPatchRect.height, (int)targetPatchRect.height, (int)targetPatchRect.width, (int)targetPatchRect.width, BORDER_REPLICATE);
-    targetPatch = prevFramePadded(targetPatchRect).clone();
-
-    copyMakeBorder(curFrame, curFramePadded, (int)targetPatchRect.height, (int)targetPatchRect.height, (int)targetPatchRect.width, (int)targetPatchRect.width, BORDER_REPLICATE);
-    searchPatch = curFramePadded(targetPatchRect).clone();
+    const int padX = (int)targetPatchRect.width, padY = (int)targetPatchRect.height;
+    targetPatch = paddedCrop(prevFrame, targetPatchRect, padX, padY);
+    searchPatch = paddedCrop(curFrame, targetPatchRect, padX, padY);
 
     //Preprocess
     //Resize
@@ -167,6 +181,27 @@ bool TrackerGOTURNImpl::updateImpl(const Mat& image, Rect2d& boundingBox)
     //Mean Subtract
     targetPatch = targetPatch - 128;
     searchPatch = searchPatch - 128;
+}
+
+Rect2d TrackerGOTURNImpl::applyResult(const Mat& curFrame, const float* res, const Rect2f& targetPatchRect)
+{
+    Rect2d curBB;
+    curBB.x = targetPatchRect.x + (res[0] * targetPatchRect.width / INPUT_SIZE) - targetPatchRect.width;
+    curBB.y = targetPatchRect.y + (res[1] * targetPatchRect.height / INPUT_SIZE) - targetPatchRect.height;
+    curBB.width = (res[2] - res[0]) * targetPatchRect.width / INPUT_SIZE;
+    curBB.height = (res[3] - res[1]) * targetPatchRect.height / INPUT_SIZE;
+
+    //Set new model image and BB from current frame
+    ((TrackerGOTURNModel*)static_cast<TrackerModel*>(model))->setImage(curFrame);
+    ((TrackerGOTURNModel*)static_cast<TrackerModel*>(model))->setBoudingBox(curBB);
+    return curBB;
+}
+
+bool TrackerGOTURNImpl::updateImpl(const Mat& image, Rect2d& boundingBox)
+{
+    Rect2f targetPatchRect;
+    Mat searchPatch, targetPatch;
+    preparePatches(image, targetPatch, searchPatch, targetPatchRect);
 
     //Convert to Float type
     Mat targetBlob = dnn::blobFromImage(targetPatch);
@@ -177,19 +212,36 @@ bool TrackerGOTURNImpl::updateImpl(const Mat& image, Rect2d& boundingBox)
 
     Mat resMat = net.forward("scale").reshape(1, 1);
 
-    curBB.x = targetPatchRect.x + (resMat.at<float>(0) * targetPatchRect.width / INPUT_SIZE) - targetPatchRect.width;
-    curBB.y = targetPatchRect.y + (resMat.at<float>(1) * targetPatchRect.height / INPUT_SIZE) - targetPatchRect.height;
-    curBB.width = (resMat.at<float>(2) - resMat.at<float>(0)) * targetPatchRect.width / INPUT_SIZE;
-    curBB.height = (resMat.at<float>(3) - resMat.at<float>(1)) * targetPatchRect.height / INPUT_SIZE;
-
     //Predicted BB
-    boundingBox = curBB;
+    boundingBox = applyResult(image, resMat.ptr<float>(), targetPatchRect);
+    return true;
+}
 
-    //Set new model image and BB from current frame
-    ((TrackerGOTURNModel*)static_cast<TrackerModel*>(model))->setImage(curFrame);
-    ((TrackerGOTURNModel*)static_cast<TrackerModel*>(model))->setBoudingBox(curBB);
+void TrackerGOTURNImpl::updateBatch(const std::vector<TrackerGOTURNImpl*>& trackers, const Mat& image,
+                                    std::vector<Rect2d>& boundingBoxes)
+{
+    const int batchSize = (int)trackers.size();
+    CV_Assert(batchSize > 0 && !image.empty());
 
-    return true;
+    std::vector<Mat> targetPatches(batchSize), searchPatches(batchSize);
+    std::vector<Rect2f> targetPatchRects(batchSize);
+    for (int i = 0; i < batchSize; i++)
+    {
+        CV_Assert(trackers[i]->isInit);
+        trackers[i]->preparePatches(image, targetPatches[i], searchPatches[i], targetPatchRects[i]);
+    }
+
+    //All the trackers load the same model, so any of the networks fits
+    dnn::Net& net = trackers[0]->net;
+    net.setInput(dnn::blobFromImages(targetPatches), ".data1");
+    net.setInput(dnn::blobFromImages(searchPatches), ".data2");
+
+    Mat resMat = net.forward("scale").reshape(1, batchSize);
+    CV_Assert(resMat.cols == 4);
+
+    boundingBoxes.resize(batchSize);
+    for (int i = 0; i < batchSize; i++)
+        boundingBoxes[i] = trackers[i]->applyResult(image, resMat.ptr<float>(i), targetPatchRects[i]);
 }
 
 }
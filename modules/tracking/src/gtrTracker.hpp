@@ -68,10 +68,23 @@ public:
     void write(FileStorage& fs) const;
     bool initImpl(const Mat& image, const Rect2d& boundingBox);
     bool updateImpl(const Mat& image, Rect2d& boundingBox);
+    bool isInitialized() const { return isInit; }
+
+    // Updates several initialized trackers by the single forward pass of the network
+    // of the first one. Crops of all the targets are stacked into one batch.
+    static void updateBatch(const std::vector<TrackerGOTURNImpl*>& trackers, const Mat& image,
+                            std::vector<Rect2d>& boundingBoxes);
 
     TrackerGOTURN::Params params;
 
     dnn::Net net;
+
+private:
+    // Target and search crops from the previous and the current frames
+    // resized to the network input and mean subtracted.
+    void preparePatches(const Mat& curFrame, Mat& targetPatch, Mat& searchPatch, Rect2f& targetPatchRect);
+    // Maps the regressed box from the search patch back to the frame and updates the model.
+    Rect2d applyResult(const Mat& curFrame, const float* res, const Rect2f& targetPatchRect);
 };
 
 }
@@ -40,6 +40,8 @@
  //M*/
 
 #include "precomp.hpp"
+#include "trackingFrameContext.hpp"
+#include "gtrTracker.hpp"
 
 namespace cv {
 
@@ -77,14 +79,81 @@ namespace cv {
     return stat;
   };
 
+  // updates trackers in parallel, every tracker is used by single thread
+  class MultiTrackerUpdateInvoker : public ParallelLoopBody
+  {
+  public:
+    MultiTrackerUpdateInvoker(std::vector< Ptr<Tracker> >& trackers_, std::vector<Rect2d>& objects_,
+                              const std::vector<int>& indices_,
+                              tracking::TrackingFrameContext& context_, std::vector<uchar>& status_)
+      : trackers(&trackers_), objects(&objects_), indices(&indices_), context(&context_), status(&status_) {}
+
+    void operator()(const Range& range) const
+    {
+      for(int k=range.start;k<range.end;k++){
+        int i = (*indices)[k];
+        Tracker* tracker = (*trackers)[i];
+        tracking::TrackingFrameContextUser* user = dynamic_cast<tracking::TrackingFrameContextUser*>(tracker);
+        if(user)
+          (*status)[i] = user->updateShared(*context, (*objects)[i]);
+        else
+          (*status)[i] = tracker->update(context->getFrame(), (*objects)[i]);
+      }
+    }
+
+  private:
+    std::vector< Ptr<Tracker> >* trackers;
+    std::vector<Rect2d>* objects;
+    const std::vector<int>* indices;
+    tracking::TrackingFrameContext* context;
+    std::vector<uchar>* status;
+  };
+
   // update position of the tracked objects, the result is stored in internal storage
   bool MultiTracker::update(InputArray image)
   {
-    bool status = true;
+    // the frame is converted once and the data derived from it
+    // is shared by the trackers
+    tracking::TrackingFrameContext context(image.getMat());
+    std::vector<uchar> status(trackerList.size(), 0);
+    std::vector<int> indices;
+
+#ifdef HAVE_OPENCV_DNN
+    // GOTURN targets are processed by a single forward pass of the network
+    std::vector<gtr::TrackerGOTURNImpl*> goturnTrackers;
+    std::vector<int> goturnIndices;
+    for(int i=0;i<(int)trackerList.size();i++){
+      gtr::TrackerGOTURNImpl* goturn = dynamic_cast<gtr::TrackerGOTURNImpl*>(trackerList[i].get());
+      if(goturn && goturn->isInitialized() && !context.getFrame().empty()){
+        goturnTrackers.push_back(goturn);
+        goturnIndices.push_back(i);
+      }
+      else
+        indices.push_back(i);
+    }
+    if(goturnTrackers.size() == 1)
+      indices.push_back(goturnIndices[0]);
+    else if(!goturnTrackers.empty()){
+      std::vector<Rect2d> boxes;
+      gtr::TrackerGOTURNImpl::updateBatch(goturnTrackers, context.getFrame(), boxes);
+      for(size_t j=0;j<goturnIndices.size();j++){
+        objects[goturnIndices[j]] = boxes[j];
+        status[goturnIndices[j]] = 1;
+      }
+    }
+#else
+    for(int i=0;i<(int)trackerList.size();i++)
+      indices.push_back(i);
+#endif
+
+    MultiTrackerUpdateInvoker invoker(trackerList, objects, indices, context, status);
+    parallel_for_(Range(0, (int)indices.size()), invoker);
+
+    bool result = true;
     for(unsigned i=0;i< trackerList.size(); i++){
-      status &= trackerList[i]->update(image, objects[i]);
+      result &= status[i] != 0;
     }
-    return status;
+    return result;
   };
 
   // update position of the tracked objects, the result is copied to external variable
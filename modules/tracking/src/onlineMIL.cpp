@@ -41,6 +41,7 @@
 
 #include "precomp.hpp"
 #include "opencv2/tracking/onlineMIL.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #define  sign(s)  ((s > 0 ) ? 1 : ((s<0) ? -1 : 0))
 
@@ -135,61 +136,105 @@ void ClfMilBoost::init( const ClfMilBoost::Params &parameters )
   _counter = 0;
 }
 
-void ClfMilBoost::update( const Mat& posx, const Mat& negx )
+// trains all the weak classifiers and computes their predictions for the training samples
+class MilStumpsUpdateInvoker : public ParallelLoopBody
 {
-  int numneg = negx.rows;
-  int numpos = posx.rows;
-
-  // compute ftrs
-  //if( !posx.ftrsComputed() )
-  //  Ftr::compute( posx, _ftrs );
-  //if( !negx.ftrsComputed() )
-  //  Ftr::compute( negx, _ftrs );
+ public:
+  MilStumpsUpdateInvoker( std::vector<ClfOnlineStump*>& weakclf, const Mat& posx, const Mat& negx, const Mat& posxT, const Mat& negxT,
+                          Mat& pospred, Mat& negpred ) :
+      weakclf_( weakclf ), posx_( posx ), negx_( negx ), posxT_( posxT ), negxT_( negxT ), pospred_( pospred ), negpred_( negpred )
+  {
+  }
 
-  // initialize H
-  static std::vector<float> Hpos, Hneg;
-  Hpos.clear();
-  Hneg.clear();
-  Hpos.resize( posx.rows, 0.0f ), Hneg.resize( negx.rows, 0.0f );
+  void operator()( const Range& r ) const
+  {
+    for ( int m = r.start; m < r.end; m++ )
+    {
+      weakclf_[m]->update( posx_, negx_ );
+      weakclf_[m]->classifyTransposed( posxT_, pospred_.ptr<float>( m ) );
+      weakclf_[m]->classifyTransposed( negxT_, negpred_.ptr<float>( m ) );
+    }
+  }
 
-  _selectors.clear();
-  std::vector<float> posw( posx.rows ), negw( negx.rows );
-  std::vector<std::vector<float> > pospred( _weakclf.size() ), negpred( _weakclf.size() );
+ private:
+  std::vector<ClfOnlineStump*>& weakclf_;
+  const Mat &posx_, &negx_, &posxT_, &negxT_;
+  Mat &pospred_, &negpred_;
+};
 
-  // train all weak classifiers without weights
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-  for ( int m = 0; m < _myParams._numFeat; m++ )
+// bag likelihood of the positive samples and likelihood of the negative ones
+// for every weak classifier added to the current strong classifier
+class MilLikelihoodInvoker : public ParallelLoopBody
+{
+ public:
+  MilLikelihoodInvoker( const std::vector<float>& Hpos, const std::vector<float>& Hneg, const Mat& pospred, const Mat& negpred,
+                        std::vector<float>& likl ) :
+      Hpos_( Hpos ), Hneg_( Hneg ), pospred_( pospred ), negpred_( negpred ), likl_( likl )
   {
-    _weakclf[m]->update( posx, negx );
-    pospred[m] = _weakclf[m]->classifySetF( posx );
-    negpred[m] = _weakclf[m]->classifySetF( negx );
   }
 
-  // pick the best features
-  for ( int s = 0; s < _myParams._numSel; s++ )
+  void operator()( const Range& r ) const
   {
-
-    // compute errors/likl for all weak clfs
-    std::vector<float> poslikl( _weakclf.size(), 1.0f ), neglikl( _weakclf.size() ), likl( _weakclf.size() );
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for ( int w = 0; w < (int) _weakclf.size(); w++ )
+    const int numpos = (int) Hpos_.size(), numneg = (int) Hneg_.size();
+    AutoBuffer<float> _buf( std::max( numpos, numneg ) + 1 );
+    float* buf = _buf;
+    for ( int w = r.start; w < r.end; w++ )
     {
+      // 1 - sigmoid(x) == 1 - 1 / (1 + exp(-x))
+      const float* pp = pospred_.ptr<float>( w );
+      for ( int j = 0; j < numpos; j++ )
+        buf[j] = -( Hpos_[j] + pp[j] );
+      hal::exp32f( buf, buf, numpos );
       float lll = 1.0f;
       for ( int j = 0; j < numpos; j++ )
-        lll *= ( 1 - sigmoid( Hpos[j] + pospred[w][j] ) );
-      poslikl[w] = (float) -log( 1 - lll + 1e-5 );
+        lll *= ( 1 - 1.0f / ( 1.0f + buf[j] ) );
+      float poslikl = (float) -log( 1 - lll + 1e-5 );
 
+      const float* np = negpred_.ptr<float>( w );
+      for ( int j = 0; j < numneg; j++ )
+        buf[j] = -( Hneg_[j] + np[j] );
+      hal::exp32f( buf, buf, numneg );
+      for ( int j = 0; j < numneg; j++ )
+        buf[j] = 1e-5f + 1 - 1.0f / ( 1.0f + buf[j] );
+      hal::log32f( buf, buf, numneg );
       lll = 0.0f;
       for ( int j = 0; j < numneg; j++ )
-        lll += (float) -log( 1e-5f + 1 - sigmoid( Hneg[j] + negpred[w][j] ) );
-      neglikl[w] = lll;
+        lll -= buf[j];
 
-      likl[w] = poslikl[w] / numpos + neglikl[w] / numneg;
+      likl_[w] = poslikl / numpos + lll / numneg;
     }
+  }
+
+ private:
+  const std::vector<float> &Hpos_, &Hneg_;
+  const Mat &pospred_, &negpred_;
+  std::vector<float>& likl_;
+};
+
+void ClfMilBoost::update( const Mat& posx, const Mat& negx )
+{
+  int numneg = negx.rows;
+  int numpos = posx.rows;
+  int numWeak = (int) _weakclf.size();
+
+  // initialize H
+  std::vector<float> Hpos( numpos, 0.0f ), Hneg( numneg, 0.0f );
+
+  _selectors.clear();
+
+  // samples are transposed, so the values of every feature are contiguous
+  Mat posxT = posx.t(), negxT = negx.t();
+  Mat pospred( numWeak, numpos, CV_32F ), negpred( numWeak, numneg, CV_32F );
+
+  // train all weak classifiers without weights
+  parallel_for_( Range( 0, numWeak ), MilStumpsUpdateInvoker( _weakclf, posx, negx, posxT, negxT, pospred, negpred ) );
+
+  // pick the best features
+  std::vector<float> likl( numWeak );
+  for ( int s = 0; s < _myParams._numSel; s++ )
+  {
+    // compute errors/likl for all weak clfs
+    parallel_for_( Range( 0, numWeak ), MilLikelihoodInvoker( Hpos, Hneg, pospred, negpred, likl ) );
 
     // pick best weak clf
     std::vector<int> order;
@@ -204,52 +249,38 @@ void ClfMilBoost::update( const Mat& posx, const Mat& negx )
       }
 
     // update H = H + h_m
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for ( int k = 0; k < posx.rows; k++ )
-      Hpos[k] += pospred[_selectors[s]][k];
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for ( int k = 0; k < negx.rows; k++ )
-      Hneg[k] += negpred[_selectors[s]][k];
-
+    const float* pp = pospred.ptr<float>( _selectors[s] );
+    for ( int k = 0; k < numpos; k++ )
+      Hpos[k] += pp[k];
+    const float* np = negpred.ptr<float>( _selectors[s] );
+    for ( int k = 0; k < numneg; k++ )
+      Hneg[k] += np[k];
   }
 
-  //if( _myParams->_storeFtrHistory )
-  //for ( uint j = 0; j < _selectors.size(); j++ )
-  // _ftrHist( _selectors[j], _counter ) = 1.0f / ( j + 1 );
-
   _counter++;
-  /* */
   return;
 }
 
 std::vector<float> ClfMilBoost::classify( const Mat& x, bool logR )
 {
   int numsamples = x.rows;
-  std::vector<float> res( numsamples );
-  std::vector<float> tr;
+  std::vector<float> res( numsamples, 0.0f );
+  if( numsamples == 0 )
+    return res;
 
+  Mat xT = x.t();
+  AutoBuffer<float> _tr( numsamples );
+  float* tr = _tr;
   for ( uint w = 0; w < _selectors.size(); w++ )
   {
-    tr = _weakclf[_selectors[w]]->classifySetF( x );
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
+    _weakclf[_selectors[w]]->classifyTransposed( xT, tr );
     for ( int j = 0; j < numsamples; j++ )
-    {
       res[j] += tr[j];
-    }
   }
 
   // return probabilities or log odds ratio
   if( !logR )
   {
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
     for ( int j = 0; j < (int) res.size(); j++ )
     {
       res[j] = sigmoid( res[j] );
@@ -364,6 +395,33 @@ float ClfOnlineStump::classifyF( const Mat& x, int i )
   return float( log_p1 - log_p0 );
 }
 
+void ClfOnlineStump::classifyTransposed( const Mat& xT, float* res ) const
+{
+  CV_Assert( xT.type() == CV_32FC1 && _ind < xT.rows );
+  const float* xx = xT.ptr<float>( _ind );
+  const int n = xT.cols;
+  int k = 0;
+#if CV_SIMD128
+  v_float32x4 mu0 = v_setall_f32( _mu0 ), mu1 = v_setall_f32( _mu1 );
+  v_float32x4 e0 = v_setall_f32( _e0 ), e1 = v_setall_f32( _e1 );
+  v_float32x4 log_n0 = v_setall_f32( _log_n0 ), log_n1 = v_setall_f32( _log_n1 );
+  for ( ; k <= n - 4; k += 4 )
+  {
+    v_float32x4 x = v_load( xx + k );
+    v_float32x4 d0 = x - mu0, d1 = x - mu1;
+    v_float32x4 log_p0 = d0 * d0 * e0 + log_n0;
+    v_float32x4 log_p1 = d1 * d1 * e1 + log_n1;
+    v_store( res + k, log_p1 - log_p0 );
+  }
+#endif
+  for ( ; k < n; k++ )
+  {
+    float log_p0 = ( xx[k] - _mu0 ) * ( xx[k] - _mu0 ) * _e0 + _log_n0;
+    float log_p1 = ( xx[k] - _mu1 ) * ( xx[k] - _mu1 ) * _e1 + _log_n1;
+    res[k] = log_p1 - log_p0;
+  }
+}
+
 inline std::vector<float> ClfOnlineStump::classifySetF( const Mat& x )
 {
   std::vector<float> res( x.rows );
@@ -67,22 +67,42 @@ namespace cv
 		// Calculate Relative similarity of the patch (NN-Model)
 		double TLDDetector::Sr(const Mat_<uchar>& patch) const
 		{
-			double splus = 0.0, sminus = 0.0;
-			Mat_<uchar> modelSample(STANDARD_PATCH_SIZE, STANDARD_PATCH_SIZE);
+			double sr;
+			SrSc(patch, &sr, 0);
+			return sr;
+		}
+
+		// Calculate Relative and Conservative similarities of the patch in one pass over the packed examples.
+		// The terms of NCC depending on a single patch are computed once for the patch and when the examples
+		// are stored.
+		void TLDDetector::SrSc(const Mat_<uchar>& patch, double* sr, double* sc) const
+		{
+			const int N = STANDARD_PATCH_SIZE * STANDARD_PATCH_SIZE;
+			CV_Assert(patch.isContinuous() && (int)patch.total() == N);
+			int sum;
+			double dev;
+			NCCStats(patch.data, N, sum, dev);
+
+			double splus = 0.0, splusc = 0.0, sminus = 0.0;
+			int med = sc && *posNum > 0 ? getMedian((*timeStampsPositive)) : 0;
 			for (int i = 0; i < *posNum; i++)
 			{
-				modelSample.data = &(posExp->data[i * 225]);
-				splus = std::max(splus, 0.5 * (NCC(modelSample, patch) + 1.0));
+				const Vec2d& stats = posStats->at<Vec2d>(i);
+				double s = 0.5 * (NCC(posExp->ptr(i), (int)stats[0], stats[1], patch.data, sum, dev, N) + 1.0);
+				splus = std::max(splus, s);
+				if (sc && (int)(*timeStampsPositive)[i] <= med)
+					splusc = std::max(splusc, s);
 			}
 			for (int i = 0; i < *negNum; i++)
 			{
-				modelSample.data = &(negExp->data[i * 225]);
-				sminus = std::max(sminus, 0.5 * (NCC(modelSample, patch) + 1.0));
+				const Vec2d& stats = negStats->at<Vec2d>(i);
+				sminus = std::max(sminus, 0.5 * (NCC(negExp->ptr(i), (int)stats[0], stats[1], patch.data, sum, dev, N) + 1.0));
 			}
 
-			if (splus + sminus == 0.0)
-				return 0.0;
-			return splus / (sminus + splus);
+			if (sr)
+				*sr = splus + sminus == 0.0 ? 0.0 : splus / (sminus + splus);
+			if (sc)
+				*sc = splusc + sminus == 0.0 ? 0.0 : splusc / (sminus + splusc);
 		}
 
 #ifdef HAVE_OPENCL
@@ -193,27 +213,9 @@ namespace cv
 		// Calculate Conservative similarity of the patch (NN-Model)
 		double TLDDetector::Sc(const Mat_<uchar>& patch) const
 		{
-			double splus = 0.0, sminus = 0.0;
-			Mat_<uchar> modelSample(STANDARD_PATCH_SIZE, STANDARD_PATCH_SIZE);
-			int med = getMedian((*timeStampsPositive));
-			for (int i = 0; i < *posNum; i++)
-			{
-				if ((int)(*timeStampsPositive)[i] <= med)
-				{
-					modelSample.data = &(posExp->data[i * 225]);
-					splus = std::max(splus, 0.5 * (NCC(modelSample, patch) + 1.0));
-				}
-			}
-			for (int i = 0; i < *negNum; i++)
-			{
-				modelSample.data = &(negExp->data[i * 225]);
-				sminus = std::max(sminus, 0.5 * (NCC(modelSample, patch) + 1.0));
-			}
-
-			if (splus + sminus == 0.0)
-				return 0.0;
-
-			return splus / (sminus + splus);
+			double sc;
+			SrSc(patch, 0, &sc);
+			return sc;
 		}
 
 #ifdef HAVE_OPENCL
@@ -298,6 +300,120 @@ namespace cv
 			}
 		}
 
+		// Windows of the scan grid of one scale are checked by the variance filter
+		// row by row, so the rows of the integral images are fetched only once.
+		// Returns the mask of passed windows, one row of the mask per row of windows.
+		template <typename T>
+		static void varianceFilter(const Mat& intImgP, const Mat& intImgP2, Size initSize, int dx, int dy,
+			double threshold, Mat_<uchar>& passed)
+		{
+			const int width = initSize.width, height = initSize.height;
+			const double area = (double)width * height;
+			for (int j = 0; j < passed.rows; j++)
+			{
+				const int y = dy * j;
+				const T* p0 = intImgP.ptr<T>(y);
+				const T* p1 = intImgP.ptr<T>(y + height);
+				const double* q0 = intImgP2.ptr<double>(y);
+				const double* q1 = intImgP2.ptr<double>(y + height);
+				uchar* dst = passed.ptr(j);
+				for (int i = 0, x = 0; i < passed.cols; i++, x += dx)
+				{
+					const double p = (double)((p1[x + width] - p0[x + width]) - (p1[x] - p0[x])) / area;
+					const double p2 = (q0[x] + q1[x + width] - q0[x + width] - q1[x]) / area;
+					dst[i] = (p2 - p * p) > threshold;
+				}
+			}
+		}
+
+		// Variance filter and ensemble classifier for all the windows of one scale.
+		// Windows are returned in the same order as the scan grid is traversed by the other detectors.
+		void TLDDetector::detectScale(const Mat& resized, const Mat& blurred, Size initSize,
+			std::vector<Point>& varWindows, std::vector<Point>& ensWindows) const
+		{
+			const int dx = initSize.width / 10, dy = initSize.height / 10;
+			const int imax = cvFloor((0.0 + resized.cols - initSize.width) / dx);
+			const int jmax = cvFloor((0.0 + resized.rows - initSize.height) / dy);
+			varWindows.clear();
+			ensWindows.clear();
+			if (imax <= 0 || jmax <= 0)
+				return;
+
+			// Sums of 8-bit images fit into 32-bit integers unless the image is huge
+			const bool intSum = resized.total() < (size_t)(INT_MAX / 255);
+			Mat intImgP, intImgP2;
+			integral(resized, intImgP, intImgP2, intSum ? CV_32S : CV_64F, CV_64F);
+
+			Mat_<uchar> passed(jmax, imax);
+			const double threshold = VARIANCE_THRESHOLD * *originalVariancePtr;
+			if (intSum)
+				varianceFilter<int>(intImgP, intImgP2, initSize, dx, dy, threshold, passed);
+			else
+				varianceFilter<double>(intImgP, intImgP2, initSize, dx, dy, threshold, passed);
+
+			for (int i = 0; i < imax; i++)
+				for (int j = 0; j < jmax; j++)
+					if (passed(j, i))
+						varWindows.push_back(Point(dx * i, dy * j));
+			if (varWindows.empty())
+				return;
+
+			//Ensemble classification of all the windows at once
+			const int rowstep = (int)blurred.step[0];
+			std::vector<int> windowOffsets(varWindows.size());
+			for (size_t w = 0; w < varWindows.size(); w++)
+				windowOffsets[w] = varWindows[w].y * rowstep + varWindows[w].x;
+
+			std::vector<double> prob(varWindows.size(), 0.0);
+			for (int k = 0; k < (int)classifiers.size(); k++)
+				classifiers[k].addPosteriorProbabilities(blurred.data, rowstep, windowOffsets, prob);
+
+			for (size_t w = 0; w < varWindows.size(); w++)
+			{
+				if (prob[w] / classifiers.size() > ENSEMBLE_THRESHOLD)
+					ensWindows.push_back(varWindows[w]);
+			}
+		}
+
+		class DetectScalesParallelLoopBody: public cv::ParallelLoopBody
+		{
+		public:
+			DetectScalesParallelLoopBody (TLDDetector * detector, const Mat& img, const std::vector<Size>& scaleSizes, Size initSize,
+				std::vector<std::vector<Point> >& varWindows, std::vector<std::vector<Point> >& ensWindows):
+				detectorF (detector),
+				imgF (img),
+				scaleSizesF (scaleSizes),
+				initSizeF (initSize),
+				varWindowsF (varWindows),
+				ensWindowsF (ensWindows)
+			{
+			}
+
+			virtual void operator () (const cv::Range & r) const
+			{
+				for (int ind = r.start; ind < r.end; ++ind)
+				{
+					if (ind > 0)
+					{
+						resize(imgF, detectorF->resized_imgs[ind], scaleSizesF[ind], 0, 0, DOWNSCALE_MODE);
+						GaussianBlur(detectorF->resized_imgs[ind], detectorF->blurred_imgs[ind], GaussBlurKernelSize, 0.0f);
+					}
+					detectorF->detectScale(detectorF->resized_imgs[ind], detectorF->blurred_imgs[ind], initSizeF,
+						varWindowsF[ind], ensWindowsF[ind]);
+				}
+			}
+
+			TLDDetector * detectorF;
+			const Mat& imgF;
+			const std::vector<Size>& scaleSizesF;
+			const Size initSizeF;
+			std::vector<std::vector<Point> >& varWindowsF;
+			std::vector<std::vector<Point> >& ensWindowsF;
+		private:
+			DetectScalesParallelLoopBody (const DetectScalesParallelLoopBody&);
+			DetectScalesParallelLoopBody& operator= (const DetectScalesParallelLoopBody&);
+		};
+
 		//Detection - returns most probable new target location (Max Sc)
 
 		class CalcScSrParallelLoopBody: public cv::ParallelLoopBody
@@ -317,8 +433,7 @@ namespace cv
 						Rect2d(detectorF->ensBuffer[ind], initSizeF),
 						detectorF->standardPatches[ind]);
 
-					detectorF->scValues[ind] = detectorF->Sc (detectorF->standardPatches[ind]);
-					detectorF->srValues[ind] = detectorF->Sr (detectorF->standardPatches[ind]);
+					detectorF->SrSc (detectorF->standardPatches[ind], &detectorF->srValues[ind], &detectorF->scValues[ind]);
 				}
 			}
 
@@ -332,59 +447,43 @@ namespace cv
 		bool TLDDetector::detect(const Mat& img, const Mat& imgBlurred, Rect2d& res, std::vector<LabeledPatch>& patches, Size initSize)
 		{
 			patches.clear();
-			Mat tmp;
-			int dx = initSize.width / 10, dy = initSize.height / 10;
-			Size2d size = img.size();
-			double scale = 1.0;
 			int npos = 0, nneg = 0;
 			double maxSc = -5.0;
 			Rect2d maxScRect;
-			int scaleID;
 
-			resized_imgs.clear ();
-			blurred_imgs.clear ();
 			varBuffer.clear ();
 			ensBuffer.clear ();
 			varScaleIDs.clear ();
 			ensScaleIDs.clear ();
 
 			//Detection part
-			//Generate windows and filter by variance
-			scaleID = 0;
-			resized_imgs.push_back(img);
-			blurred_imgs.push_back(imgBlurred);
-			do
+			//Sizes of the pyramid levels which are large enough for the initial box
+			std::vector<Size> scaleSizes(1, img.size());
+			for (Size2d size = img.size();;)
 			{
-				Mat_<double> intImgP, intImgP2;
-				computeIntegralImages(resized_imgs[scaleID], intImgP, intImgP2);
-				for (int i = 0, imax = cvFloor((0.0 + resized_imgs[scaleID].cols - initSize.width) / dx); i < imax; i++)
-				{
-					for (int j = 0, jmax = cvFloor((0.0 + resized_imgs[scaleID].rows - initSize.height) / dy); j < jmax; j++)
-					{
-						if (!patchVariance(intImgP, intImgP2, originalVariancePtr, Point(dx * i, dy * j), initSize))
-							continue;
-						varBuffer.push_back(Point(dx * i, dy * j));
-						varScaleIDs.push_back(scaleID);
-					}
-				}
-				scaleID++;
 				size.width /= SCALE_STEP;
 				size.height /= SCALE_STEP;
-				scale *= SCALE_STEP;
-				resize(img, tmp, size, 0, 0, DOWNSCALE_MODE);
-				resized_imgs.push_back(tmp);
-				GaussianBlur(resized_imgs[scaleID], tmp, GaussBlurKernelSize, 0.0f);
-				blurred_imgs.push_back(tmp);
-			} while (size.width >= initSize.width && size.height >= initSize.height);
+				if (size.width < initSize.width || size.height < initSize.height)
+					break;
+				scaleSizes.push_back(Size(size));
+			}
+			const int nscales = (int)scaleSizes.size();
 
-			//Encsemble classification
-			for (int i = 0; i < (int)varBuffer.size(); i++)
+			resized_imgs.assign(nscales, Mat());
+			blurred_imgs.assign(nscales, Mat());
+			resized_imgs[0] = img;
+			blurred_imgs[0] = imgBlurred;
+
+			//Generate windows, filter them by variance and by the ensemble classifier at all scales in parallel
+			std::vector<std::vector<Point> > varWindows(nscales), ensWindows(nscales);
+			cv::parallel_for_ (cv::Range (0, nscales), DetectScalesParallelLoopBody (this, img, scaleSizes, initSize, varWindows, ensWindows));
+
+			for (int scaleID = 0; scaleID < nscales; scaleID++)
 			{
-				prepareClassifiers(static_cast<int> (blurred_imgs[varScaleIDs[i]].step[0]));
-				if (ensembleClassifierNum(&blurred_imgs[varScaleIDs[i]].at<uchar>(varBuffer[i].y, varBuffer[i].x)) <= ENSEMBLE_THRESHOLD)
-					continue;
-				ensBuffer.push_back(varBuffer[i]);
-				ensScaleIDs.push_back(varScaleIDs[i]);
+				varBuffer.insert(varBuffer.end(), varWindows[scaleID].begin(), varWindows[scaleID].end());
+				varScaleIDs.insert(varScaleIDs.end(), varWindows[scaleID].size(), scaleID);
+				ensBuffer.insert(ensBuffer.end(), ensWindows[scaleID].begin(), ensWindows[scaleID].end());
+				ensScaleIDs.insert(ensScaleIDs.end(), ensWindows[scaleID].size(), scaleID);
 			}
 
 			//Batch preparation
@@ -136,6 +136,34 @@ namespace cv
 				return posNum / (posNum + negNum);
 		}
 
+		// Add posterior probabilities of many windows of the same image to prob.
+		// Offsets of measurements are computed locally, so the classifier state
+		// isn't changed and the method might be called for several images at once.
+		void TLDEnsembleClassifier::addPosteriorProbabilities(const uchar* data, int rowstep, const std::vector<int>& windowOffsets, std::vector<double>& prob) const
+		{
+			CV_Assert(prob.size() == windowOffsets.size());
+			const int nmeas = (int)measurements.size();
+			AutoBuffer<int> buf(2 * nmeas);
+			int *ofsA = buf, *ofsB = ofsA + nmeas;
+			for (int i = 0; i < nmeas; i++)
+			{
+				ofsA[i] = rowstep * measurements[i].val[2] + measurements[i].val[0];
+				ofsB[i] = rowstep * measurements[i].val[3] + measurements[i].val[1];
+			}
+
+			for (size_t w = 0; w < windowOffsets.size(); w++)
+			{
+				const uchar* ptr = data + windowOffsets[w];
+				int position = 0;
+				for (int i = 0; i < nmeas; i++)
+					position = (position << 1) + (ptr[ofsA[i]] < ptr[ofsB[i]] ? 1 : 0);
+
+				const Point2i& pn = posAndNeg[position];
+				if (pn.x != 0 || pn.y != 0)
+					prob[w] += (double)pn.x / ((double)pn.x + (double)pn.y);
+			}
+		}
+
 		// Calculate the 13-bit fern index
 		int TLDEnsembleClassifier::codeFast(const uchar* data) const
 		{
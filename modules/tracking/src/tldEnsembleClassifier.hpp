@@ -53,6 +53,7 @@ namespace cv
 			void integrate(const Mat_<uchar>& patch, bool isPositive);
 			double posteriorProbability(const uchar* data, int rowstep) const;
 			double posteriorProbabilityFast(const uchar* data) const;
+			void addPosteriorProbabilities(const uchar* data, int rowstep, const std::vector<int>& windowOffsets, std::vector<double>& prob) const;
 			void prepareClassifier(int rowstep);
 
 			TLDEnsembleClassifier(const std::vector<Vec4b>& meas, int beg, int end);
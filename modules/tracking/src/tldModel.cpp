@@ -60,15 +60,17 @@ namespace cv
 			//Propagate data to Detector
 			posNum = 0;
 			negNum = 0;
-			posExp = Mat(Size(225, 500), CV_8UC1);
-			negExp = Mat(Size(225, 500), CV_8UC1);
+			posExp = Mat(Size(225, MAX_EXAMPLES_IN_MODEL), CV_8UC1);
+			negExp = Mat(Size(225, MAX_EXAMPLES_IN_MODEL), CV_8UC1);
+			posStats = Mat(MAX_EXAMPLES_IN_MODEL, 1, CV_64FC2);
+			negStats = Mat(MAX_EXAMPLES_IN_MODEL, 1, CV_64FC2);
 			detector->posNum = &posNum;
 			detector->negNum = &negNum;
 			detector->posExp = &posExp;
 			detector->negExp = &negExp;
+			detector->posStats = &posStats;
+			detector->negStats = &negStats;
 
-			detector->positiveExamples = &positiveExamples;
-			detector->negativeExamples = &negativeExamples;
 			detector->timeStampsPositive = &timeStampsPositive;
 			detector->timeStampsNegative = &timeStampsNegative;
 			detector->originalVariancePtr = &originalVariance_;
@@ -85,8 +87,6 @@ namespace cv
 			TLDEnsembleClassifier::makeClassifiers(minSize, MEASURES_PER_CLASSIFIER, GRIDSIZE, detector->classifiers);
 
 			//Generate initial positive samples and put them to the model
-			positiveExamples.reserve(200);
-
 			for (int i = 0; i < (int)closest.size(); i++)
 			{
 				for (int j = 0; j < 20; j++)
@@ -124,11 +124,9 @@ namespace cv
 
 			//Generate initial negative samples and put them to the model
 			TLDDetector::generateScanGrid(image.rows, image.cols, minSize, scanGrid, true);
-			negativeExamples.clear();
-			negativeExamples.reserve(NEG_EXAMPLES_IN_INIT_MODEL);
 			std::vector<int> indices;
 			indices.reserve(NEG_EXAMPLES_IN_INIT_MODEL);
-			while ((int)negativeExamples.size() < NEG_EXAMPLES_IN_INIT_MODEL)
+			while (negNum < NEG_EXAMPLES_IN_INIT_MODEL)
 			{
 				int i = rng.uniform((int)0, (int)scanGrid.size());
 				if (std::find(indices.begin(), indices.end(), i) == indices.end() && overlap(boundingBox, scanGrid[i]) < NEXPERT_THRESHOLD)
@@ -303,61 +301,42 @@ namespace cv
 		}
 #endif // HAVE_OPENCL
 
-		//Push the patch to the model
+		//Push the patch to the model. When the model is full a random example is replaced.
 		void TrackerTLDModel::pushIntoModel(const Mat_<uchar>& example, bool positive)
 		{
-			std::vector<Mat_<uchar> >* proxyV;
-			int* proxyN;
-			std::vector<int>* proxyT;
-			if (positive)
-			{
-				if (posNum < 500)
-				{
-					uchar *patchPtr = example.data;
-					uchar *modelPtr = posExp.data;
-					for (int i = 0; i < STANDARD_PATCH_SIZE*STANDARD_PATCH_SIZE; i++)
-						modelPtr[posNum*STANDARD_PATCH_SIZE*STANDARD_PATCH_SIZE + i] = patchPtr[i];
-					posNum++;
-				}
-
-				proxyV = &positiveExamples;
-				proxyN = &timeStampPositiveNext;
-				proxyT = &timeStampsPositive;
-			}
-			else
-			{
-				if (negNum < 500)
-				{
-					uchar *patchPtr = example.data;
-					uchar *modelPtr = negExp.data;
-					for (int i = 0; i < STANDARD_PATCH_SIZE*STANDARD_PATCH_SIZE; i++)
-						modelPtr[negNum*STANDARD_PATCH_SIZE*STANDARD_PATCH_SIZE + i] = patchPtr[i];
-					negNum++;
-				}
-
-				proxyV = &negativeExamples;
-				proxyN = &timeStampNegativeNext;
-				proxyT = &timeStampsNegative;
-			}
-			if ((int)proxyV->size() < MAX_EXAMPLES_IN_MODEL)
+			Mat& proxyE = positive ? posExp : negExp;
+			Mat& proxyS = positive ? posStats : negStats;
+			int& proxyNum = positive ? posNum : negNum;
+			int& proxyN = positive ? timeStampPositiveNext : timeStampNegativeNext;
+			std::vector<int>& proxyT = positive ? timeStampsPositive : timeStampsNegative;
+			CV_Assert(example.rows == STANDARD_PATCH_SIZE && example.cols == STANDARD_PATCH_SIZE);
+
+			int index;
+			if (proxyNum < MAX_EXAMPLES_IN_MODEL)
 			{
-				proxyV->push_back(example);
-				proxyT->push_back(*proxyN);
+				index = proxyNum++;
+				proxyT.push_back(proxyN);
 			}
 			else
 			{
-				int index = rng.uniform((int)0, (int)proxyV->size());
-				(*proxyV)[index] = example;
-				(*proxyT)[index] = (*proxyN);
+				index = rng.uniform((int)0, proxyNum);
+				proxyT[index] = proxyN;
 			}
-			(*proxyN)++;
+			proxyN++;
+
+			Mat_<uchar> packed(STANDARD_PATCH_SIZE, STANDARD_PATCH_SIZE, proxyE.ptr(index));
+			example.copyTo(packed);
+			int sum;
+			double dev;
+			NCCStats(packed.data, STANDARD_PATCH_SIZE*STANDARD_PATCH_SIZE, sum, dev);
+			proxyS.at<Vec2d>(index) = Vec2d(sum, dev);
 		}
 
 		void TrackerTLDModel::printme(FILE* port)
 		{
 			dfprintf((port, "TrackerTLDModel:\n"));
-			dfprintf((port, "\tpositiveExamples.size() = %d\n", (int)positiveExamples.size()));
-			dfprintf((port, "\tnegativeExamples.size() = %d\n", (int)negativeExamples.size()));
+			dfprintf((port, "\tpositive examples = %d\n", posNum));
+			dfprintf((port, "\tnegative examples = %d\n", negNum));
 		}
 	}
 }
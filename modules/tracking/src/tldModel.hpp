@@ -65,8 +65,10 @@ namespace cv
 			void printme(FILE* port = stdout);
 			Ptr<TLDDetector> detector;
 
-			std::vector<Mat_<uchar> > positiveExamples, negativeExamples;
+			// Examples are packed one per row, with the terms of NCC computed by NCCStats() in posStats and
+			// negStats. At most MAX_EXAMPLES_IN_MODEL of each are kept.
 			Mat posExp, negExp;
+			Mat posStats, negStats;
 			int posNum, negNum;
 			std::vector<int> timeStampsPositive, timeStampsNegative;
 			int timeStampPositiveNext, timeStampNegativeNext;
@@ -118,14 +118,26 @@ bool TrackerTLDImpl::initImpl(const Mat& image, const Rect2d& boundingBox)
 
 bool TrackerTLDImpl::updateImpl(const Mat& image, Rect2d& boundingBox)
 {
+    tracking::TrackingFrameContext context(image);
+    return updateShared(context, boundingBox);
+}
+
+// The same as update() but the grayscale and blurred frames are shared with the
+// MedianFlow proxy and with other trackers
+bool TrackerTLDImpl::updateShared(tracking::TrackingFrameContext& context, Rect2d& boundingBox)
+{
+    const Mat& image = context.getFrame();
+    if( !isInit || image.empty() )
+        return false;
+
     Mat image_gray, image_blurred, imageForDetector;
-    cvtColor( image, image_gray, COLOR_BGR2GRAY );
+    image_gray = context.getGray();
     double scale = data->getScale();
     if( scale > 1.0 )
-        resize(image_gray, imageForDetector, Size(cvRound(image.cols*scale), cvRound(image.rows*scale)), 0, 0, DOWNSCALE_MODE);
+        imageForDetector = context.getResizedGray(Size(cvRound(image.cols*scale), cvRound(image.rows*scale)));
     else
         imageForDetector = image_gray;
-    GaussianBlur(imageForDetector, image_blurred, GaussBlurKernelSize, 0.0);
+    image_blurred = context.getBlurredGray(imageForDetector.size());
     TrackerTLDModel* tldModel = ((TrackerTLDModel*)static_cast<TrackerModel*>(model));
     data->frameNum++;
     Mat_<uchar> standardPatch(STANDARD_PATCH_SIZE, STANDARD_PATCH_SIZE);
@@ -148,7 +160,7 @@ bool TrackerTLDImpl::updateImpl(const Mat& image, Rect2d& boundingBox)
 #endif
 				DETECT_FLG = tldModel->detector->detect(imageForDetector, image_blurred, tmpCandid, detectorResults, tldModel->getMinSize());
 		}
-        if( ( (i == 0) && !data->failedLastTime && trackerProxy->update(image, tmpCandid) ) || ( DETECT_FLG))
+        if( ( (i == 0) && !data->failedLastTime && trackerProxy->update(context, tmpCandid) ) || ( DETECT_FLG))
         {
             candidates.push_back(tmpCandid);
             if( i == 0 )
@@ -46,6 +46,7 @@
 #include "opencv2/video/tracking.hpp"
 #include "opencv2/imgproc.hpp"
 #include "tldModel.hpp"
+#include "trackingFrameContext.hpp"
 #include<algorithm>
 #include<limits.h>
 
@@ -59,6 +60,7 @@ class TrackerProxy
 public:
 	virtual bool init(const Mat& image, const Rect2d& boundingBox) = 0;
 	virtual bool update(const Mat& image, Rect2d& boundingBox) = 0;
+	virtual bool update(tracking::TrackingFrameContext& context, Rect2d& boundingBox) = 0;
 	virtual ~TrackerProxy(){}
 };
 
@@ -105,6 +107,13 @@ public:
 	{
 		return trackerPtr->update(image, boundingBox);
 	}
+	bool update(tracking::TrackingFrameContext& context, Rect2d& boundingBox)
+	{
+		tracking::TrackingFrameContextUser* user = dynamic_cast<tracking::TrackingFrameContextUser*>(trackerPtr.get());
+		if (user)
+			return user->updateShared(context, boundingBox);
+		return trackerPtr->update(context.getFrame(), boundingBox);
+	}
 private:
 	Ptr<T> trackerPtr;
 	Tparams params_;
@@ -115,12 +124,13 @@ private:
 #define BLUR_AS_VADIM
 #undef CLOSED_LOOP
 
-class TrackerTLDImpl : public TrackerTLD
+class TrackerTLDImpl : public TrackerTLD, public tracking::TrackingFrameContextUser
 {
 public:
 	TrackerTLDImpl(const TrackerTLD::Params &parameters = TrackerTLD::Params());
 	void read(const FileNode& fn);
 	void write(FileStorage& fs) const;
+	bool updateShared(tracking::TrackingFrameContext& context, Rect2d& boundingBox);
 
     Ptr<TrackerModel> getModel()
     {
@@ -40,6 +40,7 @@
  //M*/
 
 #include "tldUtils.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 
 namespace cv
@@ -187,6 +188,39 @@ double NCC(const Mat_<uchar>& patch1, const Mat_<uchar>& patch2)
     return ares;
 }
 
+void NCCStats(const uchar* patch, int N, int& sum, double& dev)
+{
+    int s = 0, n = 0;
+    for( int i = 0; i < N; i++ )
+    {
+        s += patch[i];
+        n += patch[i] * patch[i];
+    }
+    sum = s;
+    dev = sqrt(std::max(0.0, n - 1.0 * s * s / N));
+}
+
+double NCC(const uchar* patch1, int sum1, double dev1, const uchar* patch2, int sum2, double dev2, int N)
+{
+    int i = 0, prod = 0;
+#if CV_SIMD128
+    v_int32x4 vprod = v_setzero_s32();
+    for( ; i <= N - 16; i += 16 )
+    {
+        v_uint16x8 a0, a1, b0, b1;
+        v_expand(v_load(patch1 + i), a0, a1);
+        v_expand(v_load(patch2 + i), b0, b1);
+        vprod += v_dotprod(v_reinterpret_as_s16(a0), v_reinterpret_as_s16(b0));
+        vprod += v_dotprod(v_reinterpret_as_s16(a1), v_reinterpret_as_s16(b1));
+    }
+    prod = v_reduce_sum(vprod);
+#endif
+    for( ; i < N; i++ )
+        prod += patch1[i] * patch2[i];
+    // the same expression as in NCC() above
+    return (dev2 == 0) ? dev1 / abs(dev1) : (prod - sum1 * sum2 / N) / dev1 / dev2;
+}
+
 int getMedian(const std::vector<int>& values, int size)
 {
     if( size == -1 )
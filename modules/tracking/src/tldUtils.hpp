@@ -49,6 +49,11 @@ namespace cv
 		/** Computes normalized corellation coefficient between the two patches (they should be
 		* of the same size).*/
 		double NCC(const Mat_<uchar>& patch1, const Mat_<uchar>& patch2);
+		/** Computes the terms of NCC() depending on a single patch of N pixels: the sum of the pixels and the
+		* square root of the sum of squared deviations.*/
+		void NCCStats(const uchar* patch, int N, int& sum, double& dev);
+		/** The same as NCC() for continuous patches of N pixels with the terms computed by NCCStats().*/
+		double NCC(const uchar* patch1, int sum1, double dev1, const uchar* patch2, int sum2, double dev2, int N);
 		void getClosestN(std::vector<Rect2d>& scanGrid, Rect2d bBox, int n, std::vector<Rect2d>& res);
 		double scaleAndBlur(const Mat& originalImg, int scale, Mat& scaledImg, Mat& blurredImg, Size GaussBlurKernelSize, double scaleStep);
 		int getMedian(const std::vector<int>& values, int size = -1);
@@ -195,76 +195,102 @@ bool TrackerFeatureHAAR::swapFeature( int source, int target )
   return true;
 }
 
-bool TrackerFeatureHAAR::extractSelected( const std::vector<int> selFeatures, const std::vector<Mat>& images, Mat& response )
+/*
+ * Evaluates Haar features on samples which are regions of the same 32-bit float
+ * integral image. Corner offsets of the features are computed once per call, so
+ * the responses are computed by plain pointer arithmetic, one row per feature.
+ */
+class HaarFeaturesInvoker : public cv::ParallelLoopBody
 {
-  if( images.empty() )
+ public:
+  HaarFeaturesInvoker( const std::vector<CvHaarEvaluator::FeatureHaar>& features, const std::vector<int>& featureIdx,
+                       const std::vector<Mat>& images, Mat& response ) :
+      featureIdx_( featureIdx ),
+      response_( response )
   {
-    return false;
+    const Size imageSize = images[0].size();
+    const size_t step = images[0].step1();
+    samples_.resize( images.size() );
+    for ( size_t i = 0; i < images.size(); i++ )
+      samples_[i] = images[i].ptr<float>();
+
+    areaBegin_.resize( featureIdx.size() + 1, 0 );
+    std::vector<int> offsets;
+    std::vector<float> weights;
+    for ( size_t j = 0; j < featureIdx.size(); j++ )
+    {
+      features[featureIdx[j]].getAreaOffsets( imageSize, step, offsets, weights );
+      offsets_.insert( offsets_.end(), offsets.begin(), offsets.end() );
+      weights_.insert( weights_.end(), weights.begin(), weights.end() );
+      areaBegin_[j + 1] = (int) weights_.size();
+    }
   }
 
-  int numFeatures = featureEvaluator->getNumFeatures();
-  int numSelFeatures = (int)selFeatures.size();
-
-  //response = Mat_<float>( Size( images.size(), numFeatures ) );
-  response.create( Size( (int)images.size(), numFeatures ), CV_32F );
-  response.setTo( 0 );
+  // all the samples must have the same size and row step
+  static bool isApplicable( const std::vector<Mat>& images )
+  {
+    for ( size_t i = 0; i < images.size(); i++ )
+    {
+      if( images[i].type() != CV_32FC1 || images[i].size() != images[0].size() || images[i].step != images[0].step )
+        return false;
+    }
+    return true;
+  }
 
-  //double t = getTickCount();
-  //for each sample compute #n_feature -> put each feature (n Rect) in response
-  for ( size_t i = 0; i < images.size(); i++ )
+  virtual void operator()( const cv::Range &r ) const
   {
-    int c = images[i].cols;
-    int r = images[i].rows;
-    for ( int j = 0; j < numSelFeatures; j++ )
+    const int numSamples = (int) samples_.size();
+    for ( int j = r.start; j < r.end; j++ )
     {
-      float res = 0;
-      //const feat
-      CvHaarEvaluator::FeatureHaar& feature = featureEvaluator->getFeatures( selFeatures[j] );
-      feature.eval( images[i], Rect( 0, 0, c, r ), &res );
-      //( Mat_<float>( response ) )( j, i ) = res;
-      response.at<float>( selFeatures[j], (int)i ) = res;
+      float* dst = response_.ptr<float>( featureIdx_[j] );
+      const int* ofs = &offsets_[4 * areaBegin_[j]];
+      const float* w = &weights_[areaBegin_[j]];
+      const int numAreas = areaBegin_[j + 1] - areaBegin_[j];
+      for ( int i = 0; i < numSamples; i++ )
+      {
+        const float* p = samples_[i];
+        float res = 0.0f;
+        for ( int k = 0; k < numAreas; k++ )
+          res += ( p[ofs[4 * k]] + p[ofs[4 * k + 1]] - p[ofs[4 * k + 2]] - p[ofs[4 * k + 3]] ) * w[k];
+        dst[i] = res;
+      }
     }
   }
-  //t = ( (double) getTickCount() - t ) / getTickFrequency();
-  //std::cout << "StrongClassifierDirectSelection time " << t << std::endl;
 
-  return true;
-}
+ private:
+  const std::vector<int>& featureIdx_;
+  Mat response_;
+  std::vector<const float*> samples_;
+  std::vector<int> offsets_;
+  std::vector<float> weights_;
+  std::vector<int> areaBegin_;
+};
 
-class Parallel_compute : public cv::ParallelLoopBody
+// responses of the given features, rows of the response which correspond to other features are not touched
+static void computeHaarFeatures( CvHaarEvaluator& featureEvaluator, const std::vector<int>& featureIdx,
+                                 const std::vector<Mat>& images, Mat& response )
 {
- private:
-  Ptr<CvHaarEvaluator> featureEvaluator;
-  std::vector<Mat> images;
-  Mat response;
-  //std::vector<CvHaarEvaluator::FeatureHaar> features;
- public:
-  Parallel_compute( Ptr<CvHaarEvaluator>& fe, const std::vector<Mat>& img, Mat& resp ) :
-      featureEvaluator( fe ),
-      images( img ),
-      response( resp )
+  if( HaarFeaturesInvoker::isApplicable( images ) )
   {
-
-    //features = featureEvaluator->getFeatures();
+    HaarFeaturesInvoker invoker( featureEvaluator.getFeatures(), featureIdx, images, response );
+    parallel_for_( Range( 0, (int) featureIdx.size() ), invoker );
+    return;
   }
 
-  virtual void operator()( const cv::Range &r ) const
+  for ( size_t i = 0; i < images.size(); i++ )
   {
-    for ( register int jf = r.start; jf != r.end; ++jf )
+    int c = images[i].cols;
+    int r = images[i].rows;
+    for ( size_t j = 0; j < featureIdx.size(); j++ )
     {
-      int cols = images[jf].cols;
-      int rows = images[jf].rows;
-      for ( int j = 0; j < featureEvaluator->getNumFeatures(); j++ )
-      {
-        float res = 0;
-        featureEvaluator->getFeatures()[j].eval( images[jf], Rect( 0, 0, cols, rows ), &res );
-        ( Mat_<float>( response ) )( j, jf ) = res;
-      }
+      float res = 0;
+      featureEvaluator.getFeatures( featureIdx[j] ).eval( images[i], Rect( 0, 0, c, r ), &res );
+      response.at<float>( featureIdx[j], (int) i ) = res;
     }
   }
-};
+}
 
-bool TrackerFeatureHAAR::computeImpl( const std::vector<Mat>& images, Mat& response )
+bool TrackerFeatureHAAR::extractSelected( const std::vector<int> selFeatures, const std::vector<Mat>& images, Mat& response )
 {
   if( images.empty() )
   {
@@ -273,23 +299,31 @@ bool TrackerFeatureHAAR::computeImpl( const std::vector<Mat>& images, Mat& respo
 
   int numFeatures = featureEvaluator->getNumFeatures();
 
-  response = Mat_<float>( Size( (int)images.size(), numFeatures ) );
+  response.create( Size( (int)images.size(), numFeatures ), CV_32F );
+  response.setTo( 0 );
 
-  std::vector<CvHaarEvaluator::FeatureHaar> f = featureEvaluator->getFeatures();
   //for each sample compute #n_feature -> put each feature (n Rect) in response
-  parallel_for_( Range( 0, (int)images.size() ), Parallel_compute( featureEvaluator, images, response ) );
+  computeHaarFeatures( *featureEvaluator, selFeatures, images, response );
+
+  return true;
+}
 
-  /*for ( size_t i = 0; i < images.size(); i++ )
+bool TrackerFeatureHAAR::computeImpl( const std::vector<Mat>& images, Mat& response )
+{
+  if( images.empty() )
   {
-    int c = images[i].cols;
-    int r = images[i].rows;
-    for ( int j = 0; j < numFeatures; j++ )
-    {
-      float res = 0;
-      featureEvaluator->getFeatures( j ).eval( images[i], Rect( 0, 0, c, r ), &res );
-      ( Mat_<float>( response ) )( j, i ) = res;
-    }
-  }*/
+    return false;
+  }
+
+  int numFeatures = featureEvaluator->getNumFeatures();
+
+  response.create( Size( (int)images.size(), numFeatures ), CV_32F );
+
+  std::vector<int> allFeatures( numFeatures );
+  for ( int j = 0; j < numFeatures; j++ )
+    allFeatures[j] = j;
+  //for each sample compute #n_feature -> put each feature (n Rect) in response
+  computeHaarFeatures( *featureEvaluator, allFeatures, images, response );
 
   return true;
 }
@@ -40,6 +40,7 @@
  //M*/
 
 #include "precomp.hpp"
+#include "trackingFrameContext.hpp"
 #include <complex>
 
 /*---------------------------
@@ -68,7 +69,7 @@ namespace cv{
   /*
  * Prototype
  */
-  class TrackerKCFImpl : public TrackerKCF {
+  class TrackerKCFImpl : public TrackerKCF, public tracking::TrackingFrameContextUser {
   public:
     TrackerKCFImpl( const TrackerKCF::Params &parameters = TrackerKCF::Params() );
     void read( const FileNode& /*fn*/ );
@@ -81,6 +82,8 @@ namespace cv{
     */
     bool initImpl( const Mat& /*image*/, const Rect2d& boundingBox );
     bool updateImpl( const Mat& image, Rect2d& boundingBox );
+    bool updateShared( tracking::TrackingFrameContext& context, Rect2d& boundingBox );
+    bool track( const Mat& img, Rect2d& boundingBox );
 
     TrackerKCF::Params params;
 
@@ -91,28 +94,27 @@ namespace cv{
     void inline fft2(const Mat src, std::vector<Mat> & dest, std::vector<Mat> & layers_data) const;
     void inline fft2(const Mat src, Mat & dest) const;
     void inline ifft2(const Mat src, Mat & dest) const;
-    void inline pixelWiseMult(const std::vector<Mat> src1, const std::vector<Mat>  src2, std::vector<Mat>  & dest, const int flags, const bool conjB=false) const;
-    void inline sumChannels(std::vector<Mat> src, Mat & dest) const;
+    void inline pixelWiseMult(const std::vector<Mat> & src1, const std::vector<Mat> & src2, std::vector<Mat>  & dest, const int flags, const bool conjB=false) const;
+    void inline sumChannels(const std::vector<Mat> & src, Mat & dest) const;
+    void inline divSpectrums(const Mat & num, const Mat & den, Mat & dest) const;
     void inline updateProjectionMatrix(const Mat src, Mat & old_cov,Mat &  proj_matrix,double pca_rate, int compressed_sz,
                                        std::vector<Mat> & layers_pca,std::vector<Scalar> & average, Mat pca_data, Mat new_cov, Mat w, Mat u, Mat v) const;
     void inline compress(const Mat proj_matrix, const Mat src, Mat & dest, Mat & data, Mat & compressed) const;
-    bool getSubWindow(const Mat img, const Rect roi, Mat& feat, Mat& patch, TrackerKCF::MODE desc = GRAY) const;
+    bool getSubWindow(const Mat img, const Rect roi, Mat& feat, Mat& patch, TrackerKCF::MODE desc = GRAY,
+                      const Mat& proj_matrix = Mat()) const;
     bool getSubWindow(const Mat img, const Rect roi, Mat& feat, void (*f)(const Mat, const Rect, Mat& )) const;
-    void extractCN(Mat patch_data, Mat & cnFeatures) const;
+    void extractCN(const Mat& patch_data, Mat & cnFeatures, const Mat& proj_matrix) const;
     void denseGaussKernel(const double sigma, const Mat , const Mat y_data, Mat & k_data,
-                          std::vector<Mat> & layers_data,std::vector<Mat> & xf_data,std::vector<Mat> & yf_data, std::vector<Mat> xyf_v, Mat xy, Mat xyf ) const;
+                          std::vector<Mat> & layers_data,std::vector<Mat> & xf_data,std::vector<Mat> & yf_data, std::vector<Mat> & xyf_v, Mat & xy, Mat & xyf ) const;
     void calcResponse(const Mat alphaf_data, const Mat kf_data, Mat & response_data, Mat & spec_data) const;
     void calcResponse(const Mat alphaf_data, const Mat alphaf_den_data, const Mat kf_data, Mat & response_data, Mat & spec_data, Mat & spec2_data) const;
 
-    void shiftRows(Mat& mat) const;
-    void shiftRows(Mat& mat, int n) const;
-    void shiftCols(Mat& mat, int n) const;
+    void circShift(const Mat& src, Mat& dst, int dy, int dx) const;
 
   private:
     double output_sigma;
     Rect2d roi;
     Mat hann; 	//hann window filter
-    Mat hann_cn; //10 dimensional hann-window filter for CN features,
 
     Mat y,yf; 	// training response and its FFT
     Mat x; 	// observation and its FFT
@@ -217,10 +219,6 @@ namespace cv{
     // initialize the hann window filter
     createHanningWindow(hann, roi.size(), CV_64F);
 
-    // hann window filter for CN feature
-    Mat _layer[] = {hann, hann, hann, hann, hann, hann, hann, hann, hann, hann};
-    merge(_layer, 10, hann_cn);
-
     // create gaussian response
     y=Mat::zeros((int)roi.height,(int)roi.width,CV_64F);
     for(unsigned i=0;i<roi.height;i++){
@@ -271,15 +269,32 @@ namespace cv{
    * Main part of the KCF algorithm
    */
   bool TrackerKCFImpl::updateImpl( const Mat& image, Rect2d& boundingBox ){
-    double minVal, maxVal;	// min-max response
-    Point minLoc,maxLoc;	// min-max location
-
-    Mat img=image.clone();
     // check the channels of the input image, grayscale is preferred
-    CV_Assert(img.channels() == 1 || img.channels() == 3);
+    CV_Assert(image.channels() == 1 || image.channels() == 3);
 
     // resize the image whenever needed
-    if(resizeImage)resize(img,img,Size(img.cols/2,img.rows/2));
+    // the source image is not modified so it is not copied
+    Mat img=image;
+    if(resizeImage)resize(image,img,Size(image.cols/2,image.rows/2));
+
+    return track(img, boundingBox);
+  }
+
+  /*
+   * The same as update() but the downscaled frame is shared with other trackers
+   */
+  bool TrackerKCFImpl::updateShared( tracking::TrackingFrameContext& context, Rect2d& boundingBox ){
+    const Mat& image = context.getFrame();
+    if( !isInit || image.empty() )
+      return false;
+    CV_Assert(image.channels() == 1 || image.channels() == 3);
+
+    return track(resizeImage ? context.getHalfSize() : image, boundingBox);
+  }
+
+  bool TrackerKCFImpl::track( const Mat& img, Rect2d& boundingBox ){
+    double minVal, maxVal;	// min-max response
+    Point minLoc,maxLoc;	// min-max location
 
     // detection part
     if(frame>0){
@@ -295,19 +310,24 @@ namespace cv{
       }
       if(features_npca.size()>0)merge(features_npca,X[1]);
 
+      // CN features alone are compressed while they are extracted
+      const bool compressCN = descriptors_pca.size()==1 && descriptors_pca[0]==CN;
+
       // get compressed descriptors
       for(unsigned i=0;i<descriptors_pca.size()-extractor_pca.size();i++){
-        if(!getSubWindow(img,roi, features_pca[i], img_Patch, descriptors_pca[i]))return false;
+        if(!getSubWindow(img,roi, features_pca[i], img_Patch, descriptors_pca[i],
+                         compressCN ? proj_mtx : Mat()))return false;
       }
       //get compressed custom descriptors
       for(unsigned i=0,j=(unsigned)(descriptors_pca.size()-extractor_pca.size());i<extractor_pca.size();i++,j++){
         if(!getSubWindow(img,roi, features_pca[j], extractor_pca[i]))return false;
       }
-      if(features_pca.size()>0)merge(features_pca,X[0]);
+      if(compressCN)X[0]=features_pca[0];
+      else if(features_pca.size()>0)merge(features_pca,X[0]);
 
       //compress the features and the KRSL model
       if(params.desc_pca !=0){
-        compress(proj_mtx,X[0],X[0],data_temp,compress_data);
+        if(!compressCN)compress(proj_mtx,X[0],X[0],data_temp,compress_data);
         compress(proj_mtx,Z[0],Zc[0],data_temp,compress_data);
       }
 
@@ -381,8 +401,9 @@ namespace cv{
       Z[0] = X[0].clone();
       Z[1] = X[1].clone();
     }else{
-      Z[0]=(1.0-params.interp_factor)*Z[0]+params.interp_factor*X[0];
-      Z[1]=(1.0-params.interp_factor)*Z[1]+params.interp_factor*X[1];
+      // update in place to avoid allocations
+      if(!X[0].empty())addWeighted(Z[0],1.0-params.interp_factor,X[0],params.interp_factor,0.0,Z[0]);
+      if(!X[1].empty())addWeighted(Z[1],1.0-params.interp_factor,X[1],params.interp_factor,0.0,Z[1]);
     }
 
     if(params.desc_pca !=0 || use_custom_extractor_pca){
@@ -419,23 +440,13 @@ namespace cv{
 
     // compute the fourier transform of the kernel and add a small value
     fft2(k,kf);
-    kf_lambda=kf+params.lambda;
+    add(kf,Scalar(params.lambda),kf_lambda); // only real part is changed
 
-    double den;
     if(params.split_coeff){
       mulSpectrums(yf,kf,new_alphaf,0);
       mulSpectrums(kf,kf_lambda,new_alphaf_den,0);
     }else{
-      for(int i=0;i<yf.rows;i++){
-        for(int j=0;j<yf.cols;j++){
-          den = 1.0/(kf_lambda.at<Vec2d>(i,j)[0]*kf_lambda.at<Vec2d>(i,j)[0]+kf_lambda.at<Vec2d>(i,j)[1]*kf_lambda.at<Vec2d>(i,j)[1]);
-
-          new_alphaf.at<Vec2d>(i,j)[0]=
-          (yf.at<Vec2d>(i,j)[0]*kf_lambda.at<Vec2d>(i,j)[0]+yf.at<Vec2d>(i,j)[1]*kf_lambda.at<Vec2d>(i,j)[1])*den;
-          new_alphaf.at<Vec2d>(i,j)[1]=
-          (yf.at<Vec2d>(i,j)[1]*kf_lambda.at<Vec2d>(i,j)[0]-yf.at<Vec2d>(i,j)[0]*kf_lambda.at<Vec2d>(i,j)[1])*den;
-        }
-      }
+      divSpectrums(yf,kf_lambda,new_alphaf);
     }
 
     // update the RLS model
@@ -443,8 +454,8 @@ namespace cv{
       alphaf=new_alphaf.clone();
       if(params.split_coeff)alphaf_den=new_alphaf_den.clone();
     }else{
-      alphaf=(1.0-params.interp_factor)*alphaf+params.interp_factor*new_alphaf;
-      if(params.split_coeff)alphaf_den=(1.0-params.interp_factor)*alphaf_den+params.interp_factor*new_alphaf_den;
+      addWeighted(alphaf,1.0-params.interp_factor,new_alphaf,params.interp_factor,0.0,alphaf);
+      if(params.split_coeff)addWeighted(alphaf_den,1.0-params.interp_factor,new_alphaf_den,params.interp_factor,0.0,alphaf_den);
     }
 
     frame++;
@@ -519,7 +530,7 @@ namespace cv{
   /*
    * Point-wise multiplication of two Multichannel Mat data
    */
-  void inline TrackerKCFImpl::pixelWiseMult(const std::vector<Mat> src1, const std::vector<Mat>  src2, std::vector<Mat>  & dest, const int flags, const bool conjB) const {
+  void inline TrackerKCFImpl::pixelWiseMult(const std::vector<Mat> & src1, const std::vector<Mat> & src2, std::vector<Mat>  & dest, const int flags, const bool conjB) const {
     for(unsigned i=0;i<src1.size();i++){
       mulSpectrums(src1[i], src2[i], dest[i],flags,conjB);
     }
@@ -528,10 +539,31 @@ namespace cv{
   /*
    * Combines all channels in a multi-channels Mat data into a single channel
    */
-  void inline TrackerKCFImpl::sumChannels(std::vector<Mat> src, Mat & dest) const {
-    dest=src[0].clone();
+  void inline TrackerKCFImpl::sumChannels(const std::vector<Mat> & src, Mat & dest) const {
+    src[0].copyTo(dest);
     for(unsigned i=1;i<src.size();i++){
-      dest+=src[i];
+      add(dest,src[i],dest);
+    }
+  }
+
+  /*
+   * Point-wise division of two complex Mat data
+   * z=(a+bi)/(c+di)=[(ac+bd)+i(bc-ad)]/(c^2+d^2)
+   */
+  void inline TrackerKCFImpl::divSpectrums(const Mat & num, const Mat & den, Mat & dest) const {
+    CV_Assert(num.type() == CV_64FC2 && den.type() == CV_64FC2 && num.size() == den.size());
+    dest.create(num.size(), num.type());
+    for(int i=0;i<num.rows;i++){
+      const Vec2d* a=num.ptr<Vec2d>(i);
+      const Vec2d* b=den.ptr<Vec2d>(i);
+      Vec2d* d=dest.ptr<Vec2d>(i);
+      for(int j=0;j<num.cols;j++){
+        double scale=1.0/(b[j][0]*b[j][0]+b[j][1]*b[j][1]);
+        double re=(a[j][0]*b[j][0]+a[j][1]*b[j][1])*scale;
+        double im=(a[j][1]*b[j][0]-a[j][0]*b[j][1])*scale;
+        d[j][0]=re;
+        d[j][1]=im;
+      }
     }
   }
 
@@ -575,14 +607,18 @@ namespace cv{
    */
   void inline TrackerKCFImpl::compress(const Mat proj_matrix, const Mat src, Mat & dest, Mat & data, Mat & compressed) const {
     data=src.reshape(1,src.rows*src.cols);
-    compressed=data*proj_matrix;
-    dest=compressed.reshape(proj_matrix.cols,src.rows).clone();
+    // the product is written straight into the destination, which must not share memory with the source
+    if(dest.data==src.data)dest.release();
+    dest.create(src.rows,src.cols,CV_MAKETYPE(src.depth(),proj_matrix.cols));
+    compressed=dest.reshape(1,src.rows*src.cols);
+    gemm(data,proj_matrix,1.0,noArray(),0.0,compressed);
   }
 
   /*
    * obtain the patch and apply hann window filter to it
    */
-  bool TrackerKCFImpl::getSubWindow(const Mat img, const Rect _roi, Mat& feat, Mat& patch, TrackerKCF::MODE desc) const {
+  bool TrackerKCFImpl::getSubWindow(const Mat img, const Rect _roi, Mat& feat, Mat& patch, TrackerKCF::MODE desc,
+                                    const Mat& proj_matrix) const {
 
     Rect region=_roi;
 
@@ -614,8 +650,7 @@ namespace cv{
     switch(desc){
       case CN:
         CV_Assert(img.channels() == 3);
-        extractCN(patch,feat);
-        feat=feat.mul(hann_cn); // hann window filter
+        extractCN(patch,feat,proj_matrix); // hann window filter is applied at once
         break;
       default: // GRAY
         if(img.channels()>1)
@@ -664,121 +699,115 @@ namespace cv{
     return true;
   }
 
-  /* Convert BGR to ColorNames
+  /* Convert BGR to ColorNames weighted by the hann window. If the projection
+   * matrix is given the features are compressed in the same pass.
    */
-  void TrackerKCFImpl::extractCN(Mat patch_data, Mat & cnFeatures) const {
-    Vec3b & pixel = patch_data.at<Vec3b>(0,0);
-    unsigned index;
-
-    if(cnFeatures.type() != CV_64FC(10))
-      cnFeatures = Mat::zeros(patch_data.rows,patch_data.cols,CV_64FC(10));
+  void TrackerKCFImpl::extractCN(const Mat& patch_data, Mat & cnFeatures, const Mat& proj_matrix) const {
+    CV_Assert(patch_data.type() == CV_8UC3 && patch_data.size() == hann.size());
+    CV_Assert(proj_matrix.empty() || (proj_matrix.rows == 10 && proj_matrix.type() == CV_64F));
+    const int cn = proj_matrix.empty() ? 10 : proj_matrix.cols;
+
+    cnFeatures.create(patch_data.rows, patch_data.cols, CV_64FC(cn));
+
+    // transposed projection, one row per output channel
+    double proj[10*10];
+    for(int k=0;k<cn && !proj_matrix.empty();k++){
+      for(int l=0;l<10;l++)
+        proj[k*10+l]=proj_matrix.at<double>(l,k);
+    }
 
     for(int i=0;i<patch_data.rows;i++){
-      for(int j=0;j<patch_data.cols;j++){
-        pixel=patch_data.at<Vec3b>(i,j);
-        index=(unsigned)(floor((float)pixel[2]/8)+32*floor((float)pixel[1]/8)+32*32*floor((float)pixel[0]/8));
-
-        //copy the values
-        for(int _k=0;_k<10;_k++){
-          cnFeatures.at<Vec<double,10> >(i,j)[_k]=ColorNames[index][_k];
+      const uchar* pixel = patch_data.ptr<uchar>(i);
+      const double* w = hann.ptr<double>(i);
+      double* dst = cnFeatures.ptr<double>(i);
+
+      for(int j=0;j<patch_data.cols;j++,pixel+=3,dst+=cn){
+        // 32 levels per color, the red one varies fastest
+        const float* names = ColorNames[(pixel[2]>>3)+((pixel[1]>>3)<<5)+((pixel[0]>>3)<<10)];
+
+        if(proj_matrix.empty()){
+          for(int _k=0;_k<10;_k++)
+            dst[_k]=w[j]*names[_k];
+        }else{
+          for(int _k=0;_k<cn;_k++){
+            const double* p = proj+_k*10;
+            double s=0;
+            for(int l=0;l<10;l++)
+              s+=names[l]*p[l];
+            dst[_k]=w[j]*s;
+          }
         }
       }
     }
-
   }
 
   /*
    *  dense gauss kernel function
    */
   void TrackerKCFImpl::denseGaussKernel(const double sigma, const Mat x_data, const Mat y_data, Mat & k_data,
-                                        std::vector<Mat> & layers_data,std::vector<Mat> & xf_data,std::vector<Mat> & yf_data, std::vector<Mat> xyf_v, Mat xy, Mat xyf ) const {
+                                        std::vector<Mat> & layers_data,std::vector<Mat> & xf_data,std::vector<Mat> & yf_data, std::vector<Mat> & xyf_v, Mat & xy, Mat & xyf ) const {
     double normX, normY;
 
     fft2(x_data,xf_data,layers_data);
-    fft2(y_data,yf_data,layers_data);
-
     normX=norm(x_data);
     normX*=normX;
-    normY=norm(y_data);
-    normY*=normY;
 
-    pixelWiseMult(xf_data,yf_data,xyf_v,0,true);
+    // autocorrelation is computed for training, there is no need to transform the same data twice
+    const bool same = x_data.data == y_data.data;
+    if(!same){
+      fft2(y_data,yf_data,layers_data);
+      normY=norm(y_data);
+      normY*=normY;
+    }else{
+      normY=normX;
+    }
+
+    pixelWiseMult(xf_data,same?xf_data:yf_data,xyf_v,0,true);
     sumChannels(xyf_v,xyf);
-    ifft2(xyf,xyf);
+    ifft2(xyf,xy);
 
+    //(xx + yy - 2 * xy) / numel(x)
+    double numel=x_data.rows*x_data.cols*x_data.channels();
     if(params.wrap_kernel){
-      shiftRows(xyf, x_data.rows/2);
-      shiftCols(xyf, x_data.cols/2);
+      circShift(xy, k_data, x_data.rows/2, x_data.cols/2);
+      k_data.convertTo(k_data, CV_64F, -2.0/numel, (normX+normY)/numel);
+    }else{
+      xy.convertTo(k_data, CV_64F, -2.0/numel, (normX+normY)/numel);
     }
 
-    //(xx + yy - 2 * xy) / numel(x)
-    xy=(normX+normY-2*xyf)/(x_data.rows*x_data.cols*x_data.channels());
-
     // TODO: check wether we really need thresholding or not
-    //threshold(xy,xy,0.0,0.0,THRESH_TOZERO);//max(0, (xx + yy - 2 * xy) / numel(x))
-    for(int i=0;i<xy.rows;i++){
-      for(int j=0;j<xy.cols;j++){
-        if(xy.at<double>(i,j)<0.0)xy.at<double>(i,j)=0.0;
-      }
-    }
+    //max(0, (xx + yy - 2 * xy) / numel(x))
+    max(k_data, 0.0, k_data);
 
     double sig=-1.0/(sigma*sigma);
-    xy=sig*xy;
-    exp(xy,k_data);
+    k_data.convertTo(k_data, CV_64F, sig);
+    exp(k_data,k_data);
 
   }
 
   /* CIRCULAR SHIFT Function
-   * http://stackoverflow.com/questions/10420454/shift-like-matlab-function-rows-or-columns-of-a-matrix-in-opencv
+   * dst(i,j)=src((i-dy) mod rows, (j-dx) mod cols), done by copying four blocks at most
    */
-  // circular shift one row from up to down
-  void TrackerKCFImpl::shiftRows(Mat& mat) const {
-
-      Mat temp;
-      Mat m;
-      int _k = (mat.rows-1);
-      mat.row(_k).copyTo(temp);
-      for(; _k > 0 ; _k-- ) {
-        m = mat.row(_k);
-        mat.row(_k-1).copyTo(m);
-      }
-      m = mat.row(0);
-      temp.copyTo(m);
-
-  }
-
-  // circular shift n rows from up to down if n > 0, -n rows from down to up if n < 0
-  void TrackerKCFImpl::shiftRows(Mat& mat, int n) const {
-      if( n < 0 ) {
-        n = -n;
-        flip(mat,mat,0);
-        for(int _k=0; _k < n;_k++) {
-          shiftRows(mat);
-        }
-        flip(mat,mat,0);
-      }else{
-        for(int _k=0; _k < n;_k++) {
-          shiftRows(mat);
+  void TrackerKCFImpl::circShift(const Mat& src, Mat& dst, int dy, int dx) const {
+      CV_Assert(src.data != dst.data);
+      dst.create(src.size(), src.type());
+      int rows = src.rows, cols = src.cols;
+      dy = ((dy % rows) + rows) % rows;
+      dx = ((dx % cols) + cols) % cols;
+
+      // source blocks [0, size - shift) and [size - shift, size) are swapped
+      int ys[2][3] = { {0, dy, rows - dy}, {rows - dy, 0, dy} }; // src y, dst y, height
+      int xs[2][3] = { {0, dx, cols - dx}, {cols - dx, 0, dx} }; // src x, dst x, width
+      for(int a = 0; a < 2; a++ ) {
+        for(int b = 0; b < 2; b++ ) {
+          if(ys[a][2] == 0 || xs[b][2] == 0)
+            continue;
+          Mat dstRoi = dst(Rect(xs[b][1], ys[a][1], xs[b][2], ys[a][2]));
+          src(Rect(xs[b][0], ys[a][0], xs[b][2], ys[a][2])).copyTo(dstRoi);
         }
       }
   }
 
-  //circular shift n columns from left to right if n > 0, -n columns from right to left if n < 0
-  void TrackerKCFImpl::shiftCols(Mat& mat, int n) const {
-      if(n < 0){
-        n = -n;
-        flip(mat,mat,1);
-        transpose(mat,mat);
-        shiftRows(mat,n);
-        transpose(mat,mat);
-        flip(mat,mat,1);
-      }else{
-        transpose(mat,mat);
-        shiftRows(mat,n);
-        transpose(mat,mat);
-      }
-  }
-
   /*
    * calculate the detection response
    */
@@ -794,19 +823,7 @@ namespace cv{
   void TrackerKCFImpl::calcResponse(const Mat alphaf_data, const Mat _alphaf_den, const Mat kf_data, Mat & response_data, Mat & spec_data, Mat & spec2_data) const {
 
     mulSpectrums(alphaf_data,kf_data,spec_data,0,false);
-
-    //z=(a+bi)/(c+di)=[(ac+bd)+i(bc-ad)]/(c^2+d^2)
-    double den;
-    for(int i=0;i<kf_data.rows;i++){
-      for(int j=0;j<kf_data.cols;j++){
-        den=1.0/(_alphaf_den.at<Vec2d>(i,j)[0]*_alphaf_den.at<Vec2d>(i,j)[0]+_alphaf_den.at<Vec2d>(i,j)[1]*_alphaf_den.at<Vec2d>(i,j)[1]);
-        spec2_data.at<Vec2d>(i,j)[0]=
-          (spec_data.at<Vec2d>(i,j)[0]*_alphaf_den.at<Vec2d>(i,j)[0]+spec_data.at<Vec2d>(i,j)[1]*_alphaf_den.at<Vec2d>(i,j)[1])*den;
-        spec2_data.at<Vec2d>(i,j)[1]=
-          (spec_data.at<Vec2d>(i,j)[1]*_alphaf_den.at<Vec2d>(i,j)[0]-spec_data.at<Vec2d>(i,j)[0]*_alphaf_den.at<Vec2d>(i,j)[1])*den;
-      }
-    }
-
+    divSpectrums(spec_data,_alphaf_den,spec2_data);
     ifft2(spec2_data,response_data);
   }
 
@@ -41,21 +41,24 @@
 
 #include "precomp.hpp"
 #include "trackerMILModel.hpp"
+#include "trackingFrameContext.hpp"
 
 namespace cv
 {
 
-class TrackerMILImpl : public TrackerMIL
+class TrackerMILImpl : public TrackerMIL, public tracking::TrackingFrameContextUser
 {
  public:
   TrackerMILImpl( const TrackerMIL::Params &parameters = TrackerMIL::Params() );
   void read( const FileNode& fn );
   void write( FileStorage& fs ) const;
+  bool updateShared( tracking::TrackingFrameContext& context, Rect2d& boundingBox );
 
  protected:
 
   bool initImpl( const Mat& image, const Rect2d& boundingBox );
   bool updateImpl( const Mat& image, Rect2d& boundingBox );
+  bool track( const Mat& intImage, Rect2d& boundingBox );
   void compute_integral( const Mat & img, Mat & ii_img );
 
   TrackerMIL::Params params;
@@ -202,7 +205,21 @@ bool TrackerMILImpl::updateImpl( const Mat& image, Rect2d& boundingBox )
 {
   Mat intImage;
   compute_integral( image, intImage );
+  return track( intImage, boundingBox );
+}
+
+/*
+ * The same as update() but the integral image is shared with other trackers
+ */
+bool TrackerMILImpl::updateShared( tracking::TrackingFrameContext& context, Rect2d& boundingBox )
+{
+  if( !isInit || context.getFrame().empty() )
+    return false;
+  return track( context.getIntegral(), boundingBox );
+}
 
+bool TrackerMILImpl::track( const Mat& intImage, Rect2d& boundingBox )
+{
   //get the last location [AAM] X(k-1)
   Ptr<TrackerTargetState> lastLocation = model->getLastTargetState();
   Rect lastBoundingBox( (int)lastLocation->getTargetPosition().x, (int)lastLocation->getTargetPosition().y, lastLocation->getTargetWidth(),
@@ -42,6 +42,7 @@
 #include "precomp.hpp"
 #include "opencv2/video/tracking.hpp"
 #include "opencv2/imgproc.hpp"
+#include "trackingFrameContext.hpp"
 #include <algorithm>
 #include <limits.h>
 
@@ -71,15 +72,18 @@ using namespace cv;
  * optimize (allocation<-->reallocation)
  */
 
-class TrackerMedianFlowImpl : public TrackerMedianFlow{
+class TrackerMedianFlowImpl : public TrackerMedianFlow, public tracking::TrackingFrameContextUser{
 public:
     TrackerMedianFlowImpl(TrackerMedianFlow::Params paramsIn = TrackerMedianFlow::Params()) {params=paramsIn;isInit=false;}
     void read( const FileNode& fn );
     void write( FileStorage& fs ) const;
+    bool updateShared( tracking::TrackingFrameContext& context, Rect2d& boundingBox );
 private:
     bool initImpl( const Mat& image, const Rect2d& boundingBox );
     bool updateImpl( const Mat& image, Rect2d& boundingBox );
-    bool medianFlowImpl(Mat oldImage,Mat newImage,Rect2d& oldBox);
+    bool medianFlowImpl(const Mat& oldImage_gray,const std::vector<Mat>& oldImagePyr,
+                        const Mat& newImage_gray,const std::vector<Mat>& newImagePyr,Rect2d& oldBox);
+    void setPrevFrame(const Mat& frame,const Mat& gray,const std::vector<Mat>& pyr);
     Rect2d vote(const std::vector<Point2f>& oldPoints,const std::vector<Point2f>& newPoints,const Rect2d& oldRect,Point2f& mD);
     float dist(Point2f p1,Point2f p2);
     std::string type2str(int type);
@@ -90,6 +94,9 @@ private:
                    const std::vector<Point2f>& oldPoints,const std::vector<Point2f>& newPoints,std::vector<bool>& status);
 
     TrackerMedianFlow::Params params;
+    // grayscale image and pyramid of the last frame, so they are not recomputed on the next update
+    Mat prevGray;
+    std::vector<Mat> prevPyr;
 };
 
 template<typename T>
@@ -148,22 +155,47 @@ bool TrackerMedianFlowImpl::initImpl( const Mat& image, const Rect2d& boundingBo
     model=Ptr<TrackerMedianFlowModel>(new TrackerMedianFlowModel(params));
     ((TrackerMedianFlowModel*)static_cast<TrackerModel*>(model))->setImage(image);
     ((TrackerMedianFlowModel*)static_cast<TrackerModel*>(model))->setBoudingBox(boundingBox);
+    tracking::TrackingFrameContext context(image);
+    setPrevFrame(image, context.getGray(), context.getPyramid(params.winSize, params.maxLevel));
     return true;
 }
 
 bool TrackerMedianFlowImpl::updateImpl( const Mat& image, Rect2d& boundingBox ){
-    Mat oldImage=((TrackerMedianFlowModel*)static_cast<TrackerModel*>(model))->getImage();
+    tracking::TrackingFrameContext context(image);
+    return updateShared(context, boundingBox);
+}
+
+/*
+ * The same as update() but the grayscale frame and its pyramid are shared with other trackers
+ */
+bool TrackerMedianFlowImpl::updateShared( tracking::TrackingFrameContext& context, Rect2d& boundingBox ){
+    const Mat& image = context.getFrame();
+    if( !isInit || image.empty() )
+        return false;
+
+    Mat newImage_gray = context.getGray();
+    std::vector<Mat> newImagePyr = context.getPyramid(params.winSize, params.maxLevel);
 
     Rect2d oldBox=((TrackerMedianFlowModel*)static_cast<TrackerModel*>(model))->getBoundingBox();
-    if(!medianFlowImpl(oldImage,image,oldBox)){
+    if(!medianFlowImpl(prevGray,prevPyr,newImage_gray,newImagePyr,oldBox)){
         return false;
     }
     boundingBox=oldBox;
     ((TrackerMedianFlowModel*)static_cast<TrackerModel*>(model))->setImage(image);
     ((TrackerMedianFlowModel*)static_cast<TrackerModel*>(model))->setBoudingBox(oldBox);
+    setPrevFrame(image, newImage_gray, newImagePyr);
     return true;
 }
 
+void TrackerMedianFlowImpl::setPrevFrame(const Mat& frame,const Mat& gray,const std::vector<Mat>& pyr){
+    // the caller may reuse the frame buffer, so the data which refers to it is copied
+    prevGray = gray.datastart == frame.datastart ? gray.clone() : gray;
+    if(!pyr.empty() && pyr[0].datastart == frame.datastart)
+        buildOpticalFlowPyramid(prevGray, prevPyr, params.winSize, params.maxLevel, false);
+    else
+        prevPyr = pyr;
+}
+
 template<typename T>
 size_t filterPointsInVectors(std::vector<T>& status, std::vector<Point2f>& vec1, std::vector<Point2f>& vec2, T goodValue)
 {
@@ -197,20 +229,10 @@ size_t filterPointsInVectors(std::vector<T>& status, std::vector<Point2f>& vec1,
     return first_bad_idx;
 }
 
-bool TrackerMedianFlowImpl::medianFlowImpl(Mat oldImage,Mat newImage,Rect2d& oldBox){
+bool TrackerMedianFlowImpl::medianFlowImpl(const Mat& oldImage_gray,const std::vector<Mat>& oldImagePyr,
+                                           const Mat& newImage_gray,const std::vector<Mat>& newImagePyr,Rect2d& oldBox){
     std::vector<Point2f> pointsToTrackOld,pointsToTrackNew;
 
-    Mat oldImage_gray,newImage_gray;
-    if (oldImage.channels() != 1)
-        cvtColor( oldImage, oldImage_gray, COLOR_BGR2GRAY );
-    else
-        oldImage.copyTo(oldImage_gray);
-
-    if (newImage.channels() != 1)
-        cvtColor( newImage, newImage_gray, COLOR_BGR2GRAY );
-    else
-        newImage.copyTo(newImage_gray);
-
     //"open ended" grid
     for(int i=0;i<params.pointsInGrid;i++){
         for(int j=0;j<params.pointsInGrid;j++){
@@ -223,12 +245,6 @@ bool TrackerMedianFlowImpl::medianFlowImpl(Mat oldImage,Mat newImage,Rect2d& old
     std::vector<uchar> status(pointsToTrackOld.size());
     std::vector<float> errors(pointsToTrackOld.size());
 
-    std::vector<Mat> oldImagePyr;
-    buildOpticalFlowPyramid(oldImage_gray, oldImagePyr, params.winSize, params.maxLevel, false);
-
-    std::vector<Mat> newImagePyr;
-    buildOpticalFlowPyramid(newImage_gray, newImagePyr, params.winSize, params.maxLevel, false);
-
     calcOpticalFlowPyrLK(oldImagePyr,newImagePyr,pointsToTrackOld,pointsToTrackNew,status,errors,
                          params.winSize, params.maxLevel, params.termCriteria, 0);
 
@@ -69,17 +69,15 @@ void TrackerSampler::sampling( const Mat& image, Rect boundingBox )
 
   clearSamples();
 
+  // the first sampler writes into samples directly, keeping their capacity
   for ( size_t i = 0; i < samplers.size(); i++ )
   {
     std::vector<Mat> current_samples;
-    samplers[i].second->sampling( image, boundingBox, current_samples );
+    samplers[i].second->sampling( image, boundingBox, i == 0 ? samples : current_samples );
 
     //push in samples all current_samples
-    for ( size_t j = 0; j < current_samples.size(); j++ )
-    {
-      std::vector<Mat>::iterator it = samples.end();
-      samples.insert( it, current_samples.at( j ) );
-    }
+    if( i > 0 )
+      samples.insert( samples.end(), current_samples.begin(), current_samples.end() );
   }
 
   if( !blockAddTrackerSampler )
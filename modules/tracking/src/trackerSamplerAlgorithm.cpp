@@ -134,33 +134,33 @@ bool TrackerSamplerCSC::samplingImpl( const Mat& image, Rect boundingBox, std::v
   {
     case MODE_INIT_POS:
       inrad = params.initInRad;
-      sample = sampleImage( image, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad );
+      sampleImage( image, sample, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad );
       break;
     case MODE_INIT_NEG:
       inrad = 2.0f * params.searchWinSize;
       outrad = 1.5f * params.initInRad;
       maxnum = params.initMaxNegNum;
-      sample = sampleImage( image, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad, outrad, maxnum );
+      sampleImage( image, sample, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad, outrad, maxnum );
       break;
     case MODE_TRACK_POS:
       inrad = params.trackInPosRad;
       outrad = 0;
       maxnum = params.trackMaxPosNum;
-      sample = sampleImage( image, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad, outrad, maxnum );
+      sampleImage( image, sample, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad, outrad, maxnum );
       break;
     case MODE_TRACK_NEG:
       inrad = 1.5f * params.searchWinSize;
       outrad = params.trackInPosRad + 5;
       maxnum = params.trackMaxNegNum;
-      sample = sampleImage( image, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad, outrad, maxnum );
+      sampleImage( image, sample, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad, outrad, maxnum );
       break;
     case MODE_DETECT:
       inrad = params.searchWinSize;
-      sample = sampleImage( image, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad );
+      sampleImage( image, sample, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad );
       break;
     default:
       inrad = params.initInRad;
-      sample = sampleImage( image, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad );
+      sampleImage( image, sample, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height, inrad );
       break;
   }
   return false;
@@ -171,7 +171,8 @@ void TrackerSamplerCSC::setMode( int samplingMode )
   mode = samplingMode;
 }
 
-std::vector<Mat> TrackerSamplerCSC::sampleImage( const Mat& img, int x, int y, int w, int h, float inrad, float outrad, int maxnum )
+void TrackerSamplerCSC::sampleImage( const Mat& img, std::vector<Mat>& samples, int x, int y, int w, int h, float inrad, float outrad,
+                                     int maxnum )
 {
   int rowsz = img.rows - h - 1;
   int colsz = img.cols - w - 1;
@@ -186,27 +187,25 @@ std::vector<Mat> TrackerSamplerCSC::sampleImage( const Mat& img, int x, int y, i
 
   //fprintf(stderr,"inrad=%f minrow=%d maxrow=%d mincol=%d maxcol=%d\n",inrad,minrow,maxrow,mincol,maxcol);
 
-  std::vector<Mat> samples;
-  samples.resize( ( maxrow - minrow + 1 ) * ( maxcol - mincol + 1 ) );
-  int i = 0;
+  samples.clear();
+  if( (int) maxrow < (int) minrow || (int) maxcol < (int) mincol )
+    return;
 
-  float prob = ( (float) ( maxnum ) ) / samples.size();
+  // the samples are headers of the shared image, only the accepted positions get one
+  size_t numPositions = (size_t) ( maxrow - minrow + 1 ) * ( maxcol - mincol + 1 );
+  samples.reserve( min( numPositions, (size_t) maxnum ) );
+
+  float prob = ( (float) ( maxnum ) ) / numPositions;
 
   for ( int r = minrow; r <= int( maxrow ); r++ )
     for ( int c = mincol; c <= int( maxcol ); c++ )
     {
       dist = ( y - r ) * ( y - r ) + ( x - c ) * ( x - c );
-      if( float( rng.uniform( 0.f, 1.f ) ) < prob && dist < inradsq && dist >= outradsq )
-      {
-        samples[i] = img( Rect( c, r, w, h ) );
-        i++;
-      }
+      // the random numbers are drawn for all the positions as before
+      if( float( rng.uniform( 0.f, 1.f ) ) < prob && dist < inradsq && dist >= outradsq && (int) samples.size() < maxnum )
+        samples.push_back( img( Rect( c, r, w, h ) ) );
     }
-
-  samples.resize( min( i, maxnum ) );
-  return samples;
 }
-;
 
 /**
  * TrackerSamplerCS
@@ -244,7 +243,7 @@ bool TrackerSamplerCS::samplingImpl( const Mat& image, Rect boundingBox, std::ve
   Size trackedPatchSize( trackedPatch.width, trackedPatch.height );
   Rect trackingROI = getTrackingROI( params.searchFactor );
 
-  sample = patchesRegularScan( image, trackingROI, trackedPatchSize );
+  patchesRegularScan( image, trackingROI, trackedPatchSize, sample );
 
   return true;
 }
@@ -296,9 +295,8 @@ void TrackerSamplerCS::setCheckedROI( Rect imageROI )
   ROI.width = ( dCol > 0 ) ? validROI.width + validROI.x - ROI.x : imageROI.width + imageROI.x - ROI.x;
 }
 
-std::vector<Mat> TrackerSamplerCS::patchesRegularScan( const Mat& image, Rect trackingROI, Size patchSize )
+void TrackerSamplerCS::patchesRegularScan( const Mat& image, Rect trackingROI, Size patchSize, std::vector<Mat>& sample )
 {
-  std::vector<Mat> sample;
   if( ( validROI == trackingROI ) )
     ROI = trackingROI;
   else
@@ -311,7 +309,7 @@ std::vector<Mat> TrackerSamplerCS::patchesRegularScan( const Mat& image, Rect tr
     Mat singleSample = image( trackedPatch );
     for ( int i = 0; i < num; i++ )
       sample[i] = singleSample;
-    return sample;
+    return;
   }
 
   int stepCol = (int) floor( ( 1.0f - params.overlap ) * (float) patchSize.width + 0.5f );
@@ -353,7 +351,7 @@ std::vector<Mat> TrackerSamplerCS::patchesRegularScan( const Mat& image, Rect tr
     sample[1] = image( m_rectUpperRight );
     sample[2] = image( m_rectLowerLeft );
     sample[3] = image( m_rectLowerRight );
-    return sample;
+    return;
   }
 
   int numPatchesX;
@@ -378,7 +376,6 @@ std::vector<Mat> TrackerSamplerCS::patchesRegularScan( const Mat& image, Rect tr
 
   CV_Assert( curPatch == num );
 
-  return sample;
 }
 
 TrackerSamplerPF::Params::Params(){
@@ -0,0 +1,133 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_TRACKING_FRAME_CONTEXT_HPP__
+#define __OPENCV_TRACKING_FRAME_CONTEXT_HPP__
+
+#include "precomp.hpp"
+#include "opencv2/video/tracking.hpp"
+#include <map>
+#include <utility>
+
+namespace cv
+{
+namespace tracking
+{
+
+/* Per-frame data shared between trackers which are updated on the same frame,
+ e.g. by MultiTracker or by TLD and its MedianFlow proxy.
+ Everything except of the frame itself is computed on demand by the first tracker
+ which needs it, so trackers may request the data from different threads.
+ The returned matrices are shared and must not be modified.
+*/
+class TrackingFrameContext
+{
+public:
+    explicit TrackingFrameContext(const Mat& frame_) : frame(frame_) {}
+
+    const Mat& getFrame() const { return frame; }
+
+    // Grayscale frame. The frame itself is returned if it has a single channel.
+    Mat getGray()
+    {
+        AutoLock lock(mutex);
+        return grayLocked();
+    }
+
+    // Frame downscaled twice, as requested by KCF for large targets.
+    Mat getHalfSize()
+    {
+        AutoLock lock(mutex);
+        if (halfSize.empty())
+            resize(frame, halfSize, Size(frame.cols/2, frame.rows/2));
+        return halfSize;
+    }
+
+    // Grayscale frame of the given size (bilinear interpolation).
+    Mat getResizedGray(Size size)
+    {
+        AutoLock lock(mutex);
+        return resizedGrayLocked(size);
+    }
+
+    // Grayscale frame of the given size smoothed by 3x3 Gaussian kernel.
+    Mat getBlurredGray(Size size)
+    {
+        AutoLock lock(mutex);
+        Mat& blurred = blurredGray[key(size)];
+        if (blurred.empty())
+            GaussianBlur(resizedGrayLocked(size), blurred, Size(3, 3), 0.0);
+        return blurred;
+    }
+
+    // Pyramid of the grayscale frame built by buildOpticalFlowPyramid() without derivatives.
+    std::vector<Mat> getPyramid(Size winSize, int maxLevel)
+    {
+        AutoLock lock(mutex);
+        std::vector<Mat>& pyr = pyramids[std::make_pair(key(winSize), maxLevel)];
+        if (pyr.empty())
+            buildOpticalFlowPyramid(grayLocked(), pyr, winSize, maxLevel, false);
+        return pyr;
+    }
+
+    // 32-bit float integral image of the first channel of the frame, as used by MIL.
+    Mat getIntegral()
+    {
+        AutoLock lock(mutex);
+        if (integralImage.empty())
+        {
+            Mat firstChannel = frame;
+            if (frame.channels() != 1)
+                extractChannel(frame, firstChannel, 0);
+            integral(firstChannel, integralImage, CV_32F);
+        }
+        return integralImage;
+    }
+
+private:
+    typedef std::pair<int, int> SizeKey;
+    static SizeKey key(Size size) { return std::make_pair(size.width, size.height); }
+
+    Mat grayLocked()
+    {
+        if (gray.empty())
+        {
+            if (frame.channels() != 1)
+                cvtColor(frame, gray, COLOR_BGR2GRAY);
+            else
+                gray = frame;
+        }
+        return gray;
+    }
+
+    Mat resizedGrayLocked(Size size)
+    {
+        if (size == frame.size())
+            return grayLocked();
+        Mat& resized = resizedGray[key(size)];
+        if (resized.empty())
+            resize(grayLocked(), resized, size, 0, 0, INTER_LINEAR);
+        return resized;
+    }
+
+    Mat frame, gray, halfSize, integralImage;
+    std::map<SizeKey, Mat> resizedGray, blurredGray;
+    std::map<std::pair<SizeKey, int>, std::vector<Mat> > pyramids;
+    Mutex mutex;
+};
+
+/* Interface of trackers which can use the shared per-frame data.
+ The method is called instead of Tracker::update().
+*/
+class TrackingFrameContextUser
+{
+public:
+    virtual ~TrackingFrameContextUser() {}
+    virtual bool updateShared(TrackingFrameContext& context, Rect2d& boundingBox) = 0;
+};
+
+} // tracking
+} // cv
+
+#endif
@@ -0,0 +1,223 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_TRACKING_UNSCENTED_KALMAN_BATCH_HPP__
+#define __OPENCV_TRACKING_UNSCENTED_KALMAN_BATCH_HPP__
+
+#include "precomp.hpp"
+#include "opencv2/tracking/kalman_filters.hpp"
+#include <vector>
+
+namespace cv
+{
+namespace tracking
+{
+
+template<typename _Tp> static void
+    computeSigmaPoints_( const Mat& mean, double coef, const Mat& covMatrixL, Mat& points )
+{
+    int n = mean.rows;
+    for ( int i = 0; i < n; i++ )
+    {
+        const _Tp m = mean.at<_Tp>(i, 0);
+        const _Tp* l = covMatrixL.ptr<_Tp>(i);
+        _Tp* p = points.ptr<_Tp>(i);
+        p[0] = m;
+        for ( int j = 0; j < n; j++ )
+        {
+            _Tp v = saturate_cast<_Tp>( coef*l[j] );
+            p[1 + j] = m + v;
+            p[1 + n + j] = m - v;
+        }
+    }
+}
+
+/* Sigma points of the distribution with the given mean (n x 1) and cross-covariance matrix (n x n):
+ x_0 = mean
+ x_i = mean + coef * cholesky( covMatrix ), i = 1..n
+ x_(i+n) = mean - coef * cholesky( covMatrix ), i = 1..n
+ covMatrixL and points (n x 2*n+1) are the buffers which are allocated only once.
+*/
+inline void computeSigmaPoints( const Mat& mean, const Mat& covMatrix, double coef, Mat& covMatrixL, Mat& points )
+{
+    int n = mean.rows;
+    int type = mean.type();
+    CV_Assert( covMatrix.rows == n && covMatrix.cols == n && covMatrix.type() == type );
+    covMatrixL.create( n, n, type );
+    points.create( n, 2*n+1, type );
+
+// covMatrixL = cholesky( covMatrix )
+    covMatrix.copyTo( covMatrixL );
+    if ( type == CV_64F )
+    {
+        choleskyDecomposition<double>(
+                    covMatrix.ptr<double>(), covMatrix.step, n,
+                    covMatrixL.ptr<double>(), covMatrixL.step );
+        computeSigmaPoints_<double>( mean, coef, covMatrixL, points );
+    }
+    else
+    {
+        choleskyDecomposition<float>(
+                    covMatrix.ptr<float>(), covMatrix.step, n,
+                    covMatrixL.ptr<float>(), covMatrixL.step );
+        computeSigmaPoints_<float>( mean, coef, covMatrixL, points );
+    }
+}
+
+template<typename _Tp> static void
+    centerColumns_( const Mat& src, const Mat& mean, Mat& dst )
+{
+    for ( int i = 0; i < src.rows; i++ )
+    {
+        const _Tp m = mean.at<_Tp>(i, 0);
+        const _Tp* s = src.ptr<_Tp>(i);
+        _Tp* d = dst.ptr<_Tp>(i);
+        for ( int j = 0; j < src.cols; j++ )
+            d[j] = s[j] - m;
+    }
+}
+
+// dst_i = src_i - mean, i = 0..src.cols-1; it replaces subtract( src, repeat( mean, 1, src.cols ), dst )
+inline void centerColumns( const Mat& src, const Mat& mean, Mat& dst )
+{
+    dst.create( src.size(), src.type() );
+    if ( src.depth() == CV_64F )
+        centerColumns_<double>( src, mean, dst );
+    else
+        centerColumns_<float>( src, mean, dst );
+}
+
+template<typename _Tp> static void
+    scaleColumns_( const Mat& src, const Mat& weights, Mat& dst )
+{
+    const _Tp* w = weights.ptr<_Tp>();
+    for ( int i = 0; i < src.rows; i++ )
+    {
+        const _Tp* s = src.ptr<_Tp>(i);
+        _Tp* d = dst.ptr<_Tp>(i);
+        for ( int j = 0; j < src.cols; j++ )
+            d[j] = s[j]*w[j];
+    }
+}
+
+// dst_i = weights[i] * src_i, i = 0..src.cols-1; it is the product of src and the diagonal matrix of weights
+inline void scaleColumns( const Mat& src, const Mat& weights, Mat& dst )
+{
+    CV_Assert( weights.isContinuous() && (int)weights.total() == src.cols );
+    dst.create( src.size(), src.type() );
+    if ( src.depth() == CV_64F )
+        scaleColumns_<double>( src, weights, dst );
+    else
+        scaleColumns_<float>( src, weights, dst );
+}
+
+/* Set of filters of the same type which are updated together.
+ Filter is the implementation class which provides
+    Filter( const Params& params ),
+    void predictInPlace( const Mat& control ),
+    void correctInPlace( const Mat& measurement ),
+    void reset( const Mat& state, const Mat& errorCov ),
+    const Mat& stateRef() const, const Mat& errorCovRef() const.
+ States of the filters are kept as columns of one matrix.
+*/
+template<typename Filter, typename Params>
+class UnscentedKalmanFilterBatchImpl: public UnscentedKalmanFilterBatch
+{
+public:
+    UnscentedKalmanFilterBatchImpl( const Params& params, int numFilters ) : initParams( params )
+    {
+        CV_Assert( numFilters > 0 );
+        initParams.errorCovInit = params.errorCovInit.clone();
+        filters.resize( numFilters );
+        for ( int i = 0; i < numFilters; i++ )
+            filters[i] = makePtr<Filter>( params );
+        states.create( params.DP, numFilters, params.dataType );
+        for ( int i = 0; i < numFilters; i++ )
+            storeState( i );
+    }
+
+    int getNumFilters() const { return (int)filters.size(); }
+
+    void predict( InputArray _controls )
+    {
+        Mat controls = _controls.getMat();
+        CV_Assert( controls.empty() || controls.cols == getNumFilters() );
+        parallel_for_( Range( 0, getNumFilters() ), Invoker( *this, controls, Mat(), false ) );
+    }
+
+    void correct( InputArray _measurements, InputArray _mask )
+    {
+        Mat measurements = _measurements.getMat(), mask = _mask.getMat();
+        CV_Assert( measurements.rows == initParams.MP && measurements.cols == getNumFilters() );
+        CV_Assert( mask.empty() || ( mask.type() == CV_8UC1 && mask.isContinuous() && (int)mask.total() == getNumFilters() ) );
+        parallel_for_( Range( 0, getNumFilters() ), Invoker( *this, measurements, mask, true ) );
+    }
+
+    Mat getStates() const
+    {
+        return states.clone();
+    }
+
+    Mat getErrorCov( int index ) const
+    {
+        CV_Assert( 0 <= index && index < getNumFilters() );
+        return filters[index]->errorCovRef().clone();
+    }
+
+    void reset( int index, InputArray _state, InputArray _errorCov )
+    {
+        CV_Assert( 0 <= index && index < getNumFilters() );
+        Mat state = _state.getMat(), errorCov = _errorCov.getMat();
+        CV_Assert( state.rows == initParams.DP && state.cols == 1 && state.type() == initParams.dataType );
+        if ( errorCov.empty() )
+            errorCov = initParams.errorCovInit;
+        CV_Assert( errorCov.rows == initParams.DP && errorCov.cols == initParams.DP && errorCov.type() == initParams.dataType );
+        filters[index]->reset( state, errorCov );
+        storeState( index );
+    }
+
+private:
+    class Invoker: public ParallelLoopBody
+    {
+    public:
+        Invoker( UnscentedKalmanFilterBatchImpl& batch_, const Mat& vectors_, const Mat& mask_, bool correction_ )
+            : batch( batch_ ), vectors( vectors_ ), mask( mask_ ), correction( correction_ ) {}
+
+        void operator()( const Range& range ) const
+        {
+            for ( int i = range.start; i < range.end; i++ )
+            {
+                if ( !mask.empty() && !mask.ptr<uchar>()[i] )
+                    continue;
+                Mat v = vectors.empty() ? Mat() : vectors.col( i );
+                if ( correction )
+                    batch.filters[i]->correctInPlace( v );
+                else
+                    batch.filters[i]->predictInPlace( v );
+                batch.storeState( i );
+            }
+        }
+
+    private:
+        UnscentedKalmanFilterBatchImpl& batch;
+        Mat vectors;
+        Mat mask;
+        bool correction;
+    };
+
+    void storeState( int index )
+    {
+        Mat dst = states.col( index );
+        filters[index]->stateRef().copyTo( dst );
+    }
+
+    Params initParams;
+    std::vector<Ptr<Filter> > filters;
+    Mat states;                                 // states of the filters, DP x N
+};
+
+} // tracking
+} // cv
+
+#endif
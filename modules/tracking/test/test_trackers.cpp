@@ -538,4 +538,141 @@ TEST_P(DistanceAndOverlap, DISABLED_GOTURN)
 
 INSTANTIATE_TEST_CASE_P( Tracking, DistanceAndOverlap, TESTSET_NAMES);
 
+/***************************************************************************************/
+//MultiTracker
+
+// textured squares moving over noisy background
+static void generateMovingTargets(int frameIdx, const vector<Mat>& textures, Mat& frame)
+{
+  RNG rng(frameIdx);
+  frame.create(240, 320, CV_8UC3);
+  rng.fill(frame, RNG::UNIFORM, 0, 64);
+  for (size_t i = 0; i < textures.size(); i++)
+  {
+    Point pos(20 + (int)i * 60 + frameIdx * 2, 40 + (int)(i % 2) * 100 + frameIdx);
+    textures[i].copyTo(frame(Rect(pos, textures[i].size())));
+  }
+}
+
+TEST(MultiTracker, ParallelUpdateKCF)
+{
+  const int numTargets = 4, numFrames = 10;
+  RNG rng(0);
+  vector<Mat> textures(numTargets);
+  for (int i = 0; i < numTargets; i++)
+  {
+    textures[i].create(40, 40, CV_8UC3);
+    rng.fill(textures[i], RNG::UNIFORM, 0, 256);
+  }
+
+  Mat frame;
+  generateMovingTargets(0, textures, frame);
+
+  MultiTracker multiTracker;
+  vector<Ptr<Tracker> > trackers;
+  for (int i = 0; i < numTargets; i++)
+  {
+    Rect2d roi(20 + i * 60, 40 + (i % 2) * 100, 40, 40);
+    ASSERT_TRUE(multiTracker.add(TrackerKCF::create(), frame, roi));
+    trackers.push_back(TrackerKCF::create());
+    ASSERT_TRUE(trackers.back()->init(frame, roi));
+  }
+
+  for (int f = 1; f < numFrames; f++)
+  {
+    generateMovingTargets(f, textures, frame);
+    vector<Rect2d> objects;
+    ASSERT_TRUE(multiTracker.update(frame, objects));
+    ASSERT_EQ((size_t)numTargets, objects.size());
+    for (int i = 0; i < numTargets; i++)
+    {
+      Rect2d bb;
+      ASSERT_TRUE(trackers[i]->update(frame, bb));
+      EXPECT_EQ(bb, objects[i]) << "frame " << f << ", target " << i;
+    }
+  }
+}
+
+TEST(MultiTracker, SharedContextMixedTrackers)
+{
+  const int numTargets = 4, numFrames = 10;
+  RNG rng(0);
+  vector<Mat> textures(numTargets);
+  for (int i = 0; i < numTargets; i++)
+  {
+    textures[i].create(40, 40, CV_8UC3);
+    rng.fill(textures[i], RNG::UNIFORM, 0, 256);
+  }
+
+  Mat frame;
+  generateMovingTargets(0, textures, frame);
+
+  // MedianFlow trackers share the grayscale frame and its pyramid
+  MultiTracker multiTracker;
+  vector<Ptr<Tracker> > trackers;
+  for (int i = 0; i < numTargets; i++)
+  {
+    Rect2d roi(20 + i * 60, 40 + (i % 2) * 100, 40, 40);
+    if (i % 2 == 0)
+    {
+      ASSERT_TRUE(multiTracker.add(TrackerMedianFlow::create(), frame, roi));
+      trackers.push_back(TrackerMedianFlow::create());
+    }
+    else
+    {
+      ASSERT_TRUE(multiTracker.add(TrackerKCF::create(), frame, roi));
+      trackers.push_back(TrackerKCF::create());
+    }
+    ASSERT_TRUE(trackers.back()->init(frame, roi));
+  }
+
+  for (int f = 1; f < numFrames; f++)
+  {
+    generateMovingTargets(f, textures, frame);
+    vector<Rect2d> objects;
+    ASSERT_TRUE(multiTracker.update(frame, objects));
+    ASSERT_EQ((size_t)numTargets, objects.size());
+    for (int i = 0; i < numTargets; i++)
+    {
+      Rect2d bb;
+      ASSERT_TRUE(trackers[i]->update(frame, bb));
+      EXPECT_EQ(bb, objects[i]) << "frame " << f << ", target " << i;
+    }
+  }
+}
+
+/***************************************************************************************/
+//TrackerFeatureHAAR
+
+TEST(TrackerFeatureHAAR, ComputeMatchesFeatureEval)
+{
+  TrackerFeatureHAAR::Params params;
+  params.numFeatures = 50;
+  params.rectSize = Size(20, 30);
+  TrackerFeatureHAAR haar(params);
+
+  Mat img(80, 100, CV_8UC1), intImage;
+  randu(img, 0, 256);
+  integral(img, intImage, CV_32F);
+
+  vector<Mat> samples;
+  for (int y = 0; y + params.rectSize.height < intImage.rows; y += 7)
+    for (int x = 0; x + params.rectSize.width < intImage.cols; x += 9)
+      samples.push_back(intImage(Rect(Point(x, y), params.rectSize)));
+
+  Mat response;
+  haar.compute(samples, response);
+  ASSERT_EQ(Size((int)samples.size(), params.numFeatures), response.size());
+
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    for (int j = 0; j < params.numFeatures; j++)
+    {
+      float expected = 0;
+      haar.getFeatureAt(j).eval(samples[i], Rect(Point(), params.rectSize), &expected);
+      ASSERT_EQ(expected, response.at<float>(j, (int)i)) << "sample " << i << ", feature " << j;
+    }
+  }
+}
+
 /* End of file. */
@@ -432,3 +432,77 @@ TEST(UKF, DISABLED_ungm_mean_squared_error)
 
     ASSERT_GE( mse_treshold, average_error );
 }
+
+TEST(UKF, batch_matches_single_filters)
+{
+    const int numFilters = 4;
+    const int nIterations = 200;
+
+    int MP = 2;
+    int DP = 5;
+    int CP = 0;
+    int type = CV_64F;
+
+    Ptr<BallisticModel> model( new BallisticModel() );
+    UnscentedKalmanFilterParams params( DP, MP, CP, 1e-6, 1e-4, model );
+    params.errorCovInit = 1e-6 * Mat::eye( DP, DP, type );
+    params.errorCovInit.at<double>(4, 4) = 1.0;
+    params.alpha = 1;
+    params.k = -2.0;
+
+    Ptr<UnscentedKalmanFilterBatch> batch = createUnscentedKalmanFilterBatch( params, numFilters );
+    ASSERT_EQ( numFilters, batch->getNumFilters() );
+
+    RNG rng( 117 );
+    std::vector<Mat> states( numFilters );
+    std::vector<Ptr<UnscentedKalmanFilter> > filters( numFilters );
+    for (int j = 0; j < numFilters; j++)
+    {
+        states[j] = Mat( DP, 1, type );
+        states[j].at<double>(0, 0) = 6500.4 + j;
+        states[j].at<double>(1, 0) = 349.14 - j;
+        states[j].at<double>(2, 0) = -1.8093;
+        states[j].at<double>(3, 0) = -6.7967;
+        states[j].at<double>(4, 0) = 0.6932;
+
+        params.stateInit = states[j].clone();
+        params.stateInit.at<double>(4, 0) = 0.0;
+        filters[j] = createUnscentedKalmanFilter( params );
+        batch->reset( j, params.stateInit );
+    }
+
+    Mat u = Mat::zeros( DP, 1, type );
+    Mat r( MP, 1, type );
+    Mat measurements( MP, numFilters, type );
+    Mat mask( 1, numFilters, CV_8U );
+    for (int i = 0; i < nIterations; i++)
+    {
+        for (int j = 0; j < numFilters; j++)
+        {
+            rng.fill( r, RNG::NORMAL, Scalar::all(0), Scalar::all(1e-3) );
+            Mat z = measurements.col(j);
+            model->stateConversionFunction( states[j], u, Mat::zeros( DP, 1, type ), states[j] );
+            model->measurementFunction( states[j], r, z );
+            // each filter skips its own correction steps
+            mask.at<uchar>(0, j) = (uchar)( (i + j) % 3 != 0 );
+        }
+
+        batch->predict();
+        batch->correct( measurements, mask );
+        for (int j = 0; j < numFilters; j++)
+        {
+            filters[j]->predict();
+            if ( mask.at<uchar>(0, j) )
+                filters[j]->correct( measurements.col(j) );
+        }
+    }
+
+    Mat batchStates = batch->getStates();
+    ASSERT_EQ( DP, batchStates.rows );
+    ASSERT_EQ( numFilters, batchStates.cols );
+    for (int j = 0; j < numFilters; j++)
+    {
+        EXPECT_LE( norm( filters[j]->getState(), batchStates.col(j), NORM_INF ), 1e-9 );
+        EXPECT_LE( norm( filters[j]->getErrorCov(), batch->getErrorCov(j), NORM_INF ), 1e-9 );
+    }
+}
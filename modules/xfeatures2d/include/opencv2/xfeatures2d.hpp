@@ -258,6 +258,30 @@ public:
      */
     virtual bool GetUnnormalizedDescriptor( double y, double x, int orientation, float* descriptor , double *H ) const = 0;
 
+    /** @brief Computes and caches the smoothed gradient layers of an image.
+
+    The layers are kept until another image is prepared, so descriptors of different keypoint sets
+    or regions of the same image can be extracted with computePrepared() or GetDescriptor() without
+    smoothing the image again. The compute() calls reuse the cached layers as well when they are
+    given the same image.
+     * @param image image to extract descriptors
+     * @param half_precision store the layers as half precision values, which halves their memory at
+     * minor quality loss
+     */
+    virtual void prepareImage( InputArray image, bool half_precision = false ) = 0;
+
+    /** @brief Computes descriptors of keypoints on the image given to prepareImage().
+     * @param keypoints of interest within image
+     * @param descriptors resulted descriptors array
+     */
+    virtual void computePrepared( const std::vector<KeyPoint>& keypoints, OutputArray descriptors ) = 0;
+
+    /** @overload
+     * @param roi region of interest within image
+     * @param descriptors resulted descriptors array for roi image pixels
+     */
+    virtual void computePrepared( Rect roi, OutputArray descriptors ) = 0;
+
 };
 
 /** @brief Class implementing the MSD (*Maximal Self-Dissimilarity*) keypoint detector, described in @cite Tombari14.
@@ -832,6 +856,24 @@ public:
         const std::vector<Mat>& imageSignatures,
         std::vector<float>& distances) const = 0;
 
+    /**
+    * @brief Finds the k image signatures nearest to the reference signature
+    *       according to Signature Quadratic Form Distance.
+    * @param sourceSignature The signature to measure distance of other signatures from.
+    * @param imageSignatures Vector of signatures to search in.
+    * @param k Number of the nearest signatures to find.
+    * @param indices Output vector of indices into imageSignatures, sorted by increasing distance.
+    * @param distances Output vector of the corresponding distances.
+    * @note Use this instead of computeQuadraticFormDistances for large collections,
+    *       the distances of the other signatures are not stored.
+    */
+    CV_WRAP virtual void computeNearestSignatures(
+        const Mat& sourceSignature,
+        const std::vector<Mat>& imageSignatures,
+        int k,
+        CV_OUT std::vector<int>& indices,
+        CV_OUT std::vector<float>& distances) const = 0;
+
 };
 
 /**
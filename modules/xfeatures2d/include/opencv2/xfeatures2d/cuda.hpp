@@ -74,7 +74,8 @@ The descriptors matrix is \f$\texttt{nFeatures} \times \texttt{descriptorSize}\f
 CV_32FC1 type.
 
 The class SURF_CUDA uses some buffers and provides access to it. All buffers can be safely released
-between function calls.
+between function calls. The device buffers are reused by the next calls, so the processing of a
+video sequence with the frames of the same size does not allocate memory after the first frame.
 
 @sa SURF
 
@@ -140,6 +141,18 @@ public:
     void operator()(const GpuMat& img, const GpuMat& mask, std::vector<KeyPoint>& keypoints, std::vector<float>& descriptors,
         bool useProvidedKeypoints = false);
 
+    //! asynchronous versions of the detector and the descriptor extractor.
+    //! All the kernels are enqueued to the given stream, the host only waits for the keypoints counter.
+    //! Calls from different streams are serialized, because the SURF kernels use global textures and constants.
+    void operator()(const GpuMat& img, const GpuMat& mask, GpuMat& keypoints, Stream& stream);
+    void operator()(const GpuMat& img, const GpuMat& mask, GpuMat& keypoints, GpuMat& descriptors,
+        bool useProvidedKeypoints, Stream& stream);
+
+    //! uploads the frame to img through a pair of page-locked buffers, so the copy of the next frame
+    //! can be done while the previous one is processed.
+    //! img must not be used by a previous frame still running in another stream.
+    void uploadImage(const Mat& frame, GpuMat& img, Stream& stream);
+
     void releaseMemory();
 
     // SURF parameters
@@ -157,6 +170,15 @@ public:
     GpuMat det, trace;
 
     GpuMat maxPosBuffer;
+
+    //! device and page-locked host keypoints counters, kept between calls
+    GpuMat counters;
+    HostMem countersHost;
+
+    //! double-buffered page-locked memory used by uploadImage
+    HostMem uploadBuffers[2];
+    Event uploadEvents[2];
+    int uploadIndex;
 };
 
 //! @}
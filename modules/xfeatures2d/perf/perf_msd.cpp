@@ -31,3 +31,22 @@ PERF_TEST_P(msd, detect, testing::Values(MSD_IMAGES))
     sort(points.begin(), points.end(), comparators::KeypointGreater());
     SANITY_CHECK_KEYPOINTS(points, 1e-3);
 }
+
+PERF_TEST_P(msd, detect_wide_search_area, testing::Values(MSD_IMAGES))
+{
+    string filename = getDataPath(GetParam());
+    Mat frame = imread(filename, IMREAD_GRAYSCALE);
+
+    if (frame.empty())
+        FAIL() << "Unable to load source image " << filename;
+
+    Mat mask;
+    declare.in(frame);
+    // the self-dissimilarity cost grows with the number of offsets in the search area
+    Ptr<MSDDetector> detector = MSDDetector::create(3, 9);
+    vector<KeyPoint> points;
+
+    TEST_CYCLE() detector->detect(frame, points, mask);
+
+    SANITY_CHECK_NOTHING();
+}
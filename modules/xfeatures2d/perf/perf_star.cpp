@@ -0,0 +1,50 @@
+#include "perf_precomp.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace cv::xfeatures2d;
+using namespace perf;
+using std::tr1::make_tuple;
+using std::tr1::get;
+
+typedef perf::TestBaseWithParam<std::string> star;
+
+#define STAR_IMAGES \
+    "cv/detectors_descriptors_evaluation/images_datasets/leuven/img1.png",\
+    "stitching/a3.png"
+
+PERF_TEST_P(star, detect, testing::Values(STAR_IMAGES))
+{
+    string filename = getDataPath(GetParam());
+    Mat frame = imread(filename, IMREAD_GRAYSCALE);
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << filename;
+
+    Mat mask;
+    declare.in(frame).time(90);
+
+    Ptr<StarDetector> detector = StarDetector::create();
+    vector<KeyPoint> points;
+    TEST_CYCLE() detector->detect(frame, points, mask);
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(star, detect_large, testing::Values(STAR_IMAGES))
+{
+    string filename = getDataPath(GetParam());
+    Mat image = imread(filename, IMREAD_GRAYSCALE);
+    ASSERT_FALSE(image.empty()) << "Unable to load source image " << filename;
+
+    // above 2^23 pixels, the size at which the 32-bit integral images wrap around
+    Mat frame;
+    resize(image, frame, Size(4096, 3072));
+
+    Mat mask;
+    declare.in(frame).time(180);
+
+    Ptr<StarDetector> detector = StarDetector::create();
+    vector<KeyPoint> points;
+    TEST_CYCLE() detector->detect(frame, points, mask);
+
+    SANITY_CHECK_NOTHING();
+}
@@ -15,6 +15,17 @@ namespace {
 using namespace cv;
 using namespace cv::xfeatures2d;
 
+/*
+ * Buffers of the affine adaptation iterations, they are allocated once per thread
+ * and reused for all its keypoints
+ */
+struct AffineAdaptationBuffers
+{
+    Mat warpedImgRoi, warpedImg;
+    Mat Lxm2smooth, Lxmysmooth, Lym2smooth;
+    Mat L, Lap, Lx, Ly, Lxm2, Lxmy, Lym2, dx2, dxy, dy2;
+};
+
 /*
 * Functions to perform affine adaptation of circular keypoint
 */
@@ -22,9 +33,9 @@ void calcAffineCovariantRegions(const Mat& image, const std::vector<KeyPoint>& k
 void calcAffineCovariantDescriptors( const Ptr<DescriptorExtractor>& dextractor, const Mat& img, std::vector<Elliptic_KeyPoint>& affRegions, Mat& descriptors );
 
 void calcSecondMomentMatrix(const Mat & dx2, const Mat & dxy, const Mat & dy2, Point p, Matx22f& M);
-bool calcAffineAdaptation(const Mat & image, Elliptic_KeyPoint& keypoint);
-float selIntegrationScale(const Mat & image, float si, Point c);
-float selDifferentiationScale(const Mat & image, Mat & Lxm2smooth, Mat & Lxmysmooth, Mat & Lym2smooth, float si, Point c);
+bool calcAffineAdaptation(const Mat & image, Elliptic_KeyPoint& keypoint, AffineAdaptationBuffers& buf);
+float selIntegrationScale(const Mat & image, float si, Point c, AffineAdaptationBuffers& buf);
+float selDifferentiationScale(const Mat & image, float si, Point c, AffineAdaptationBuffers& buf);
 float calcSecondMomentSqrt(const Mat & dx2, const Mat & dxy, const Mat & dy2, Point p, Matx22f& Mk);
 float normMaxEval(Matx22f & U, Mat& uVal, Mat& uVect);
 
@@ -44,7 +55,7 @@ void calcSecondMomentMatrix(const Mat & dx2, const Mat & dxy, const Mat & dy2, P
 /*
  * Performs affine adaptation
  */
-bool calcAffineAdaptation(const Mat & fimage, Elliptic_KeyPoint & keypoint)
+bool calcAffineAdaptation(const Mat & fimage, Elliptic_KeyPoint & keypoint, AffineAdaptationBuffers& buf)
 {
     Matx23f transf; /*Transformation matrix*/
     Matx21f   size; /*Image size after transformation*/
@@ -53,7 +64,11 @@ bool calcAffineAdaptation(const Mat & fimage, Elliptic_KeyPoint & keypoint)
 
     Matx22f U(1.f, 0.f, 0.f, 1.f); /*Normalization matrix*/
 
-    Mat warpedImg, Lxm2smooth, Lym2smooth, Lxmysmooth, img_roi;
+    Mat& warpedImg = buf.warpedImg;
+    const Mat& Lxm2smooth = buf.Lxm2smooth;
+    const Mat& Lym2smooth = buf.Lym2smooth;
+    const Mat& Lxmysmooth = buf.Lxmysmooth;
+    Mat img_roi;
     Matx22f Mk;
     float Qinv = 1, q, si = keypoint.si;
     bool divergence = false, convergence = false;
@@ -79,7 +94,6 @@ bool calcAffineAdaptation(const Mat & fimage, Elliptic_KeyPoint & keypoint)
     float ax1, ax2;
     float phi = 0;
     ax1 = ax2 = keypoint.size / 2;
-    Mat drawImg;
 
     //Affine adaptation
     while (i <= 10 && !divergence && !convergence)
@@ -141,7 +155,7 @@ bool calcAffineAdaptation(const Mat & fimage, Elliptic_KeyPoint & keypoint)
         {
             //Size of normalized window must be 2*radius
             //Transformation
-            Mat warpedImgRoi;
+            Mat& warpedImgRoi = buf.warpedImgRoi;
             warpAffine(img_roi, warpedImgRoi, transf, Size(int(maxx), int(maxy)),INTER_AREA, BORDER_REPLICATE);
 
             //Point in U-Normalized coordinates
@@ -163,13 +177,12 @@ bool calcAffineAdaptation(const Mat & fimage, Elliptic_KeyPoint & keypoint)
                 cx = cx - roix;
                 cy = cy - roiy;
             } else
-                warpedImgRoi.copyTo(warpedImg);
+                warpedImg = warpedImgRoi;
 
             //Integration Scale selection
-            si = selIntegrationScale(warpedImg, si, Point(cx, cy));
+            si = selIntegrationScale(warpedImg, si, Point(cx, cy), buf);
             //Differentation scale selection
-            selDifferentiationScale(warpedImg, Lxm2smooth, Lxmysmooth, Lym2smooth, si,
-                    Point(cx, cy));
+            selDifferentiationScale(warpedImg, si, Point(cx, cy), buf);
 
             //Spatial Localization
             cxPr = cx; //Previous iteration point in normalized window
@@ -262,9 +275,10 @@ bool calcAffineAdaptation(const Mat & fimage, Elliptic_KeyPoint & keypoint)
 /*
  * Selects the integration scale that maximize LoG in point c
  */
-float selIntegrationScale(const Mat & image, float si, Point c)
+float selIntegrationScale(const Mat & image, float si, Point c, AffineAdaptationBuffers& buf)
 {
-    Mat Lap, L;
+    Mat& Lap = buf.Lap;
+    Mat& L = buf.L;
     int cx = c.x;
     int cy = c.y;
     float maxLap = 0;
@@ -370,14 +384,18 @@ float normMaxEval(Matx22f & U, Mat & uVal, Mat & uVec)
 /*
  * Selects diffrentiation scale
  */
-float selDifferentiationScale(const Mat & img, Mat & Lxm2smooth, Mat & Lxmysmooth,
-        Mat & Lym2smooth, float si, Point c)
+float selDifferentiationScale(const Mat & img, float si, Point c, AffineAdaptationBuffers& buf)
 {
     float s = 0.5f;
     float sdk = s * si;
     float sigma_prev = 0, sigma;
 
-    Mat L, dx2, dxy, dy2;
+    Mat& L = buf.L;
+    Mat& dx2 = buf.dx2;
+    Mat& dxy = buf.dxy;
+    Mat& dy2 = buf.dy2;
+    Mat& Lx = buf.Lx;
+    Mat& Ly = buf.Ly;
 
     double qMax = 0;
 
@@ -402,7 +420,6 @@ float selDifferentiationScale(const Mat & img, Mat & Lxm2smooth, Mat & Lxmysmoot
         sigma_prev = sd;
 
         //X and Y derivatives
-        Mat Lx, Ly;
         Sobel(L, Lx, L.depth(), 1, 0, 1);
         Lx = Lx * sd;
         Sobel(L, Ly, L.depth(), 0, 1, 1);
@@ -412,14 +429,14 @@ float selDifferentiationScale(const Mat & img, Mat & Lxm2smooth, Mat & Lxmysmoot
         gsize = int(ceil(si * 3)) * 2 + 1;
         ksize = Size(gsize, gsize);
 
-        Mat Lxm2 = Lx.mul(Lx);
-        GaussianBlur(Lxm2, dx2, ksize, si);
+        multiply(Lx, Lx, buf.Lxm2);
+        GaussianBlur(buf.Lxm2, dx2, ksize, si);
 
-        Mat Lym2 = Ly.mul(Ly);
-        GaussianBlur(Lym2, dy2, ksize, si);
+        multiply(Ly, Ly, buf.Lym2);
+        GaussianBlur(buf.Lym2, dy2, ksize, si);
 
-        Mat Lxmy = Lx.mul(Ly);
-        GaussianBlur(Lxmy, dxy, ksize, si);
+        multiply(Lx, Ly, buf.Lxmy);
+        GaussianBlur(buf.Lxmy, dxy, ksize, si);
 
         calcSecondMomentMatrix(dx2, dxy, dy2, Point(c.x, c.y), M);
 
@@ -434,9 +451,9 @@ float selDifferentiationScale(const Mat & img, Mat & Lxm2smooth, Mat & Lxmysmoot
         {
             qMax = q;
             sdk = sd;
-            dx2.copyTo(Lxm2smooth);
-            dxy.copyTo(Lxmysmooth);
-            dy2.copyTo(Lym2smooth);
+            dx2.copyTo(buf.Lxm2smooth);
+            dxy.copyTo(buf.Lxmysmooth);
+            dy2.copyTo(buf.Lym2smooth);
 
         }
         s += 0.05f;
@@ -445,17 +462,48 @@ float selDifferentiationScale(const Mat & img, Mat & Lxm2smooth, Mat & Lxmysmoot
     return sdk;
 }
 
+/*
+ * Performs affine adaptation of the keypoints in parallel
+ */
+class AffineAdaptationInvoker : public ParallelLoopBody
+{
+public:
+    AffineAdaptationInvoker(const Mat& _image, const std::vector<KeyPoint>& _keypoints,
+            std::vector<Elliptic_KeyPoint>& _regions, std::vector<uchar>& _converged) :
+        image(_image), keypoints(_keypoints), regions(_regions), converged(_converged) {}
+
+    void operator()(const Range& range) const
+    {
+        AffineAdaptationBuffers buf;
+        for (int i = range.start; i < range.end; ++i)
+        {
+            const KeyPoint& kp = keypoints[i];
+            regions[i] = Elliptic_KeyPoint(kp.pt, 0, Size_<float> (kp.size / 2, kp.size / 2), kp.size,
+                    kp.size / 6);
+            converged[i] = calcAffineAdaptation(image, regions[i], buf);
+        }
+    }
+
+private:
+    const Mat& image;
+    const std::vector<KeyPoint>& keypoints;
+    std::vector<Elliptic_KeyPoint>& regions;
+    std::vector<uchar>& converged;
+};
+
 void calcAffineCovariantRegions(const Mat & image, const std::vector<KeyPoint> & keypoints,
         std::vector<Elliptic_KeyPoint> & affRegions)
 {
+    std::vector<Elliptic_KeyPoint> regions(keypoints.size());
+    std::vector<uchar> converged(keypoints.size());
+    parallel_for_(Range(0, (int)keypoints.size()),
+            AffineAdaptationInvoker(image, keypoints, regions, converged));
+
+    //Keep the order of the sequential adaptation
     for (size_t i = 0; i < keypoints.size(); ++i)
     {
-        KeyPoint kp = keypoints[i];
-        Elliptic_KeyPoint ex(kp.pt, 0, Size_<float> (kp.size / 2, kp.size / 2), kp.size,
-                kp.size / 6);
-
-        if (calcAffineAdaptation(image, ex))
-            affRegions.push_back(ex);
+        if (converged[i])
+            affRegions.push_back(regions[i]);
     }
     //Erase similar keypoint
     float maxDiff = 4;
@@ -51,7 +51,6 @@
 
  */
 
-#include <bitset>
 #include "precomp.hpp"
 
 
@@ -65,6 +64,15 @@ namespace cv
 namespace xfeatures2d
 {
 
+// weak learner with the box corners
+// as offsets into the integral maps
+struct BoostWeakLearner
+{
+    int orient_ofs;
+    int idx1, idx2, idx3, idx4;
+    float thresh;
+};
+
 /*
  !BoostDesc implementation
  */
@@ -160,6 +168,9 @@ protected:
     Mat m_wl_y_min, m_wl_y_max;
     Mat m_wl_alpha, m_wl_beta;
 
+    // weak learners bank, same layout as m_wl_* arrays
+    vector<BoostWeakLearner> m_wl_bank;
+
 private:
 
     /*
@@ -200,8 +211,13 @@ static void computeGradientMaps( const Mat& im,
     Sobel( im, derivx, derivx.depth(), 1, 0 );
     Sobel( im, derivy, derivy.depth(), 0, 1 );
 
+    // maps are reused between patches
+    gradMap.resize( orientQuant );
     for ( int i = 0; i < orientQuant; i++ )
-      gradMap.push_back( Mat::zeros( im.size(), CV_8UC1 ) );
+    {
+      gradMap[i].create( im.size(), CV_8UC1 );
+      gradMap[i].setTo( Scalar::all(0) );
+    }
 
     int index, index2;
     double binCenter, weight;
@@ -273,67 +289,56 @@ static void computeGradientMaps( const Mat& im,
     }
 }
 
+// integral images of the gradient maps followed by the integral image of
+// their sum, stored contiguously as (orientQuant+1) maps of (rows+1)x(cols+1)
 static void computeIntegrals( const vector<Mat>& gradMap,
                               const int orientQuant,
-                              vector<Mat>& integralMap )
+                              int* integralMaps )
 {
     // init integral images
     int rows = gradMap[0].rows;
     int cols = gradMap[0].cols;
-
-    for ( int i = 0; i < orientQuant+1; i++ )
-      integralMap.push_back( Mat::zeros( rows+1, cols+1, CV_8UC1 ) );
+    int area = (rows+1)*(cols+1);
 
     // generate corresponding integral images
     for( int i = 0; i < orientQuant; i++ )
-      integral( gradMap[i], integralMap[i] );
+    {
+      Mat integralMap( rows+1, cols+1, CV_32S, integralMaps + i*area );
+      integral( gradMap[i], integralMap, CV_32S );
+    }
 
     // copy the values from the first quantization bin
-    integralMap[0].copyTo( integralMap[orientQuant] );
+    int* ptrSum = integralMaps + orientQuant*area;
+    memcpy( ptrSum, integralMaps, area*sizeof(int) );
 
-    int* ptrSum, *ptr;
     for ( int k = 1; k < orientQuant; k++ )
     {
-      ptr    = (int*) integralMap[k].ptr<int>();
-      ptrSum = (int*) integralMap[orientQuant].ptr<int>();
-      for (int i=0; i<(rows+1)*(cols+1); ++i)
-      {
-        *ptrSum += *ptr;
-        ++ptrSum;
-        ++ptr;
-      }
+      const int* ptr = integralMaps + k*area;
+      for (int i=0; i<area; ++i)
+        ptrSum[i] += ptr[i];
     }
 }
 
-static float computeWLResponse( const int x_min,  const int x_max,
-                                const int y_min,  const int y_max,
-                                const int orient, const float thresh,
-                                const int orientQuant,
-                                const vector<Mat>& integralMap )
+static inline float computeWLResponse( const BoostWeakLearner& wl,
+                                       const int* integralMaps,
+                                       const int total_ofs )
 {
-    const int width = integralMap[0].cols;
-
-    const int idx1 = (y_min    ) * width + x_min;
-    const int idx2 = (y_min    ) * width + x_max + 1;
-    const int idx3 = (y_max + 1) * width + x_min;
-    const int idx4 = (y_max + 1) * width + x_max + 1;
-
-    const int* ptr = integralMap[orient].ptr<int>();
+    const int* ptr = integralMaps + wl.orient_ofs;
 
     int A, B ,C, D;
-    A = ptr[idx1]; B = ptr[idx2];
-    C = ptr[idx3]; D = ptr[idx4];
+    A = ptr[wl.idx1]; B = ptr[wl.idx2];
+    C = ptr[wl.idx3]; D = ptr[wl.idx4];
 
     const float current = float(D + A - B - C);
 
-    ptr = integralMap[orientQuant].ptr<int>();
+    ptr = integralMaps + total_ofs;
 
-    A = ptr[idx1]; B = ptr[idx2];
-    C = ptr[idx3]; D = ptr[idx4];
+    A = ptr[wl.idx1]; B = ptr[wl.idx2];
+    C = ptr[wl.idx3]; D = ptr[wl.idx4];
 
     const float total = float(D + A - B - C);
 
-    return total ? ( (current / total) - thresh ) : 0.f;
+    return total ? ( (current / total) - wl.thresh ) : 0.f;
 }
 
 static void rectifyPatch( const Mat& image, const KeyPoint& kp,
@@ -371,6 +376,13 @@ static void rectifyPatch( const Mat& image, const KeyPoint& kp,
 // -------------------------------------------------
 /* BoostDesc interface implementation */
 
+// number of keypoints evaluated together
+static const int BOOSTDESC_BATCH_SIZE = 32;
+
+// The invoker runs over batches of keypoints. The integral maps of all
+// patches in a batch are stored in one contiguous matrix (one row per
+// keypoint), then the weak learners bank is applied to the whole batch
+// learner by learner. LBGM projection is a single GEMM per batch.
 struct ComputeBoostDescInvoker : ParallelLoopBody
 {
     ComputeBoostDescInvoker( const Mat& _image, Mat* _descriptors,
@@ -378,31 +390,19 @@ struct ComputeBoostDescInvoker : ParallelLoopBody
                         const int _desc_type, const int _grad_atype,
                         const int _orient_q, const int _patch_size,
                         const int _nWLs, const int _Dims,
-                        const Mat& _wl_x_min, const Mat& _wl_x_max,
-                        const Mat& _wl_y_min, const Mat& _wl_y_max,
-                        const Mat& _wl_thresh, const Mat& _wl_orient,
-                        const Mat& _wl_alpha, const Mat& _wl_beta,
+                        const vector<BoostWeakLearner>& _wl_bank,
+                        const Mat& _wl_beta,
                         const bool _use_scale_orientation,
                         const float _scale_factor )
+      : image( _image ), descriptors( _descriptors ), keypoints( _keypoints ),
+        wl_bank( _wl_bank ), wl_beta( _wl_beta )
     {
       nWLs = _nWLs;
       Dims = _Dims;
-      image = _image;
       orient_q = _orient_q;
       desc_type = _desc_type;
-      keypoints = _keypoints;
       grad_atype = _grad_atype;
       patch_size = _patch_size;
-      descriptors = _descriptors;
-
-      wl_beta = _wl_beta;
-      wl_alpha = _wl_alpha;
-      wl_x_min = _wl_x_min;
-      wl_x_max = _wl_x_max;
-      wl_y_min = _wl_y_min;
-      wl_y_max = _wl_y_max;
-      wl_thresh = _wl_thresh;
-      wl_orient = _wl_orient;
 
       scale_factor = _scale_factor;
       use_scale_orientation  = _use_scale_orientation;
@@ -411,26 +411,36 @@ struct ComputeBoostDescInvoker : ParallelLoopBody
     void operator ()( const cv::Range& range ) const
     {
       // maps
-      vector<Mat> gradMap, integralMap;
+      vector<Mat> gradMap;
+      Mat patch;
+
+      const int area = ( patch_size + 1 ) * ( patch_size + 1 );
+      const int total_ofs = orient_q * area;
 
       // small binary map
       uchar binLookUp[8];
       for ( unsigned int i = 0; i < 8; i++ )
         binLookUp[i] = (uchar) 1 << i;
 
-      for ( int i = range.start; i < range.end; i++ )
-      {
+      Mat integrals( BOOSTDESC_BATCH_SIZE, ( orient_q + 1 ) * area, CV_32S );
+      Mat responses;
+      AutoBuffer<float> resp( BOOSTDESC_BATCH_SIZE );
 
-        Mat patch;
-        // rectify the patch around a given keypoint
-        rectifyPatch( image, keypoints[i], patch_size,
-                      patch, use_scale_orientation, scale_factor );
+      for ( int batch = range.start; batch < range.end; batch++ )
+      {
+        const int k0 = batch * BOOSTDESC_BATCH_SIZE;
+        const int nkp = std::min( BOOSTDESC_BATCH_SIZE, (int) keypoints.size() - k0 );
 
-        // compute gradient maps (and integral gradient maps)
-        computeGradientMaps( patch, grad_atype, orient_q, gradMap );
-        computeIntegrals( gradMap, orient_q, integralMap );
+        for ( int b = 0; b < nkp; b++ )
+        {
+          // rectify the patch around a given keypoint
+          rectifyPatch( image, keypoints[k0 + b], patch_size,
+                        patch, use_scale_orientation, scale_factor );
 
-        float WLR;
+          // compute gradient maps (and integral gradient maps)
+          computeGradientMaps( patch, grad_atype, orient_q, gradMap );
+          computeIntegrals( gradMap, orient_q, integrals.ptr<int>(b) );
+        }
 
         /*
          * BGM
@@ -440,14 +450,14 @@ struct ComputeBoostDescInvoker : ParallelLoopBody
              ( desc_type == BGM_BILINEAR )
            )
         {
-          uchar* desc = descriptors->ptr<uchar>(i);
           for ( int j = 0; j < nWLs; j++ )
           {
-            WLR = computeWLResponse( wl_x_min.at<int>(0,j), wl_x_max.at<int>(0,j),
-                                     wl_y_min.at<int>(0,j), wl_y_max.at<int>(0,j),
-                                     wl_orient.at<int>(0,j), wl_thresh.at<float>(0,j),
-                                     orient_q, integralMap );
-            desc[j/8] |=  ( WLR >= 0 ) ? binLookUp[ j % 8 ] : 0;
+            const BoostWeakLearner& wl = wl_bank[j];
+            for ( int b = 0; b < nkp; b++ )
+            {
+              float WLR = computeWLResponse( wl, integrals.ptr<int>(b), total_ofs );
+              descriptors->ptr<uchar>(k0 + b)[j/8] |= ( WLR >= 0 ) ? binLookUp[ j % 8 ] : 0;
+            }
           }
         } // end BGM
 
@@ -456,25 +466,20 @@ struct ComputeBoostDescInvoker : ParallelLoopBody
          */
         if ( desc_type == LBGM )
         {
-          std::bitset<512> wlResponses;
-
+          // signs of the weak learners responses
+          responses.create( nkp, nWLs, CV_32F );
           for ( int j = 0; j < nWLs; j++ )
           {
-            WLR = computeWLResponse( wl_x_min.at<int>(0,j), wl_x_max.at<int>(0,j),
-                                     wl_y_min.at<int>(0,j), wl_y_max.at<int>(0,j),
-                                     wl_orient.at<int>(0,j), wl_thresh.at<float>(0,j),
-                                     orient_q, integralMap );
-            wlResponses[j] = ( WLR >= 0 ) ? 1 : 0;
-        }
-
-          float* desc = descriptors->ptr<float>(i);
-          for ( int d = 0; d < Dims; d++ )
-          {
-            for ( int wl = 0; wl < nWLs; wl++ )
+            const BoostWeakLearner& wl = wl_bank[j];
+            for ( int b = 0; b < nkp; b++ )
             {
-              desc[d] += ( wlResponses[wl] ) ? wl_beta.at<float>(wl,d) : -wl_beta.at<float>(wl,d);
+              float WLR = computeWLResponse( wl, integrals.ptr<int>(b), total_ofs );
+              responses.at<float>(b, j) = ( WLR >= 0 ) ? 1.f : -1.f;
             }
           }
+          // project all keypoints of the batch
+          Mat desc = descriptors->rowRange( k0, k0 + nkp );
+          gemm( responses, wl_beta, 1, noArray(), 0, desc );
         } // end LBGM
 
         /*
@@ -485,28 +490,25 @@ struct ComputeBoostDescInvoker : ParallelLoopBody
              ( desc_type == BINBOOST_256 )
            )
         {
-          float resp;
           for ( int d = 0; d < Dims; d++ )
           {
-            resp = 0;
-            uchar* desc = descriptors->ptr<uchar>(i);
+            const float* beta = wl_beta.ptr<float>(d);
+            const BoostWeakLearner* wls = &wl_bank[d * nWLs];
+            for ( int b = 0; b < nkp; b++ )
+              resp[b] = 0;
             for ( int wl = 0; wl < nWLs; wl++ )
             {
-              WLR = computeWLResponse( wl_x_min.at<int>(d,wl), wl_x_max.at<int>(d,wl),
-                                       wl_y_min.at<int>(d,wl), wl_y_max.at<int>(d,wl),
-                                       wl_orient.at<int>(d,wl), wl_thresh.at<float>(d,wl),
-                                       orient_q, integralMap );
-              resp += ( WLR >= 0 ) ? wl_beta.at<float>(d,wl) : -wl_beta.at<float>(d,wl);
+              for ( int b = 0; b < nkp; b++ )
+              {
+                float WLR = computeWLResponse( wls[wl], integrals.ptr<int>(b), total_ofs );
+                resp[b] += ( WLR >= 0 ) ? beta[wl] : -beta[wl];
+              }
             }
-            desc[d/8] |= ( resp >= 0 ) ? binLookUp[d%8] : 0;
+            for ( int b = 0; b < nkp; b++ )
+              descriptors->ptr<uchar>(k0 + b)[d/8] |= ( resp[b] >= 0 ) ? binLookUp[d%8] : 0;
           }
         } // end BINBOOST
 
-        // clean-up
-        patch.release();
-        gradMap.clear();
-        integralMap.clear();
-
       } // end for loop
     } // end operator
 
@@ -516,14 +518,13 @@ struct ComputeBoostDescInvoker : ParallelLoopBody
     int desc_type;
     int patch_size;
     int grad_atype;
-    int patch_szie;
 
-    Mat image;
+    const Mat& image;
     Mat *descriptors;
-    vector<KeyPoint> keypoints;
+    const vector<KeyPoint>& keypoints;
 
-    Mat wl_x_min, wl_x_max, wl_y_min, wl_y_max;
-    Mat wl_thresh, wl_orient, wl_alpha, wl_beta;
+    const vector<BoostWeakLearner>& wl_bank;
+    const Mat& wl_beta;
 
     float scale_factor;
     bool use_scale_orientation;
@@ -561,12 +562,12 @@ void BoostDesc_Impl::compute( InputArray _image, vector<KeyPoint>& keypoints, Ou
     // descriptor storage
     Mat descriptors = _descriptors.getMat();
 
-    parallel_for_( Range( 0, (int) keypoints.size() ),
+    int nbatches = ( (int) keypoints.size() + BOOSTDESC_BATCH_SIZE - 1 ) / BOOSTDESC_BATCH_SIZE;
+    parallel_for_( Range( 0, nbatches ),
         ComputeBoostDescInvoker( m_image, &descriptors, keypoints,
                             m_desc_type, m_grad_atype, m_orient_q,
                             m_patch_size, m_nWLs, m_Dims,
-                            m_wl_x_min, m_wl_x_max, m_wl_y_min, m_wl_y_max,
-                            m_wl_thresh, m_wl_orient, m_wl_alpha, m_wl_beta,
+                            m_wl_bank, m_wl_beta,
                             m_use_scale_orientation, m_scale_factor )
     );
 }
@@ -624,6 +625,20 @@ void BoostDesc_Impl::ini_params( const int orientQuant, const int patchSize,
     m_wl_y_min  = Mat( dim0, dim1, CV_32S, const_cast<int *>(y_min ) );
     m_wl_y_max  = Mat( dim0, dim1, CV_32S, const_cast<int *>(y_max ) );
 
+    // box corners of the weak learners within the integral maps
+    const int width = patchSize + 1;
+    m_wl_bank.resize( dim0 * dim1 );
+    for ( int i = 0; i < dim0 * dim1; i++ )
+    {
+      BoostWeakLearner& wl = m_wl_bank[i];
+      wl.orient_ofs = orient[i] * width * width;
+      wl.idx1 = (y_min[i]    ) * width + x_min[i];
+      wl.idx2 = (y_min[i]    ) * width + x_max[i] + 1;
+      wl.idx3 = (y_max[i] + 1) * width + x_min[i];
+      wl.idx4 = (y_max[i] + 1) * width + x_max[i] + 1;
+      wl.thresh = m_wl_thresh.at<float>(i);
+    }
+
     // no beta
     if ( beta == NULL ) return;
 
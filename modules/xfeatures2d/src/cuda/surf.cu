@@ -56,26 +56,26 @@ namespace cv { namespace cuda { namespace device
 {
     namespace surf
     {
-        void loadGlobalConstants(int maxCandidates, int maxFeatures, int img_rows, int img_cols, int nOctaveLayers, float hessianThreshold);
-        void loadOctaveConstants(int octave, int layer_rows, int layer_cols);
+        void loadGlobalConstants(int maxCandidates, int maxFeatures, int img_rows, int img_cols, int nOctaveLayers, float hessianThreshold, cudaStream_t stream);
+        void loadOctaveConstants(int octave, int layer_rows, int layer_cols, cudaStream_t stream);
 
         void bindImgTex(PtrStepSzb img);
         size_t bindSumTex(PtrStepSz<unsigned int> sum);
         size_t bindMaskSumTex(PtrStepSz<unsigned int> maskSum);
 
         void icvCalcLayerDetAndTrace_gpu(const PtrStepf& det, const PtrStepf& trace, int img_rows, int img_cols,
-            int octave, int nOctaveLayer);
+            int octave, int nOctaveLayer, cudaStream_t stream);
 
         void icvFindMaximaInLayer_gpu(const PtrStepf& det, const PtrStepf& trace, int4* maxPosBuffer, unsigned int* maxCounter,
-            int img_rows, int img_cols, int octave, bool use_mask, int nLayers);
+            int img_rows, int img_cols, int octave, bool use_mask, int nLayers, cudaStream_t stream);
 
         void icvInterpolateKeypoint_gpu(const PtrStepf& det, const int4* maxPosBuffer, unsigned int maxCounter,
             float* featureX, float* featureY, int* featureLaplacian, int* featureOctave, float* featureSize, float* featureHessian,
-            unsigned int* featureCounter);
+            unsigned int* featureCounter, cudaStream_t stream);
 
-        void icvCalcOrientation_gpu(const float* featureX, const float* featureY, const float* featureSize, float* featureDir, int nFeatures);
+        void icvCalcOrientation_gpu(const float* featureX, const float* featureY, const float* featureSize, float* featureDir, int nFeatures, cudaStream_t stream);
 
-        void compute_descriptors_gpu(PtrStepSz<float4> descriptors, const float* featureX, const float* featureY, const float* featureSize, const float* featureDir, int nFeatures);
+        void compute_descriptors_gpu(PtrStepSz<float4> descriptors, const float* featureX, const float* featureY, const float* featureSize, const float* featureDir, int nFeatures, cudaStream_t stream);
     }
 }}}
 
@@ -104,21 +104,21 @@ namespace cv { namespace cuda { namespace device
         __constant__ int c_layer_rows;
         __constant__ int c_layer_cols;
 
-        void loadGlobalConstants(int maxCandidates, int maxFeatures, int img_rows, int img_cols, int nOctaveLayers, float hessianThreshold)
+        void loadGlobalConstants(int maxCandidates, int maxFeatures, int img_rows, int img_cols, int nOctaveLayers, float hessianThreshold, cudaStream_t stream)
         {
-            cudaSafeCall( cudaMemcpyToSymbol(c_max_candidates, &maxCandidates, sizeof(maxCandidates)) );
-            cudaSafeCall( cudaMemcpyToSymbol(c_max_features, &maxFeatures, sizeof(maxFeatures)) );
-            cudaSafeCall( cudaMemcpyToSymbol(c_img_rows, &img_rows, sizeof(img_rows)) );
-            cudaSafeCall( cudaMemcpyToSymbol(c_img_cols, &img_cols, sizeof(img_cols)) );
-            cudaSafeCall( cudaMemcpyToSymbol(c_nOctaveLayers, &nOctaveLayers, sizeof(nOctaveLayers)) );
-            cudaSafeCall( cudaMemcpyToSymbol(c_hessianThreshold, &hessianThreshold, sizeof(hessianThreshold)) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_max_candidates, &maxCandidates, sizeof(maxCandidates), 0, cudaMemcpyHostToDevice, stream) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_max_features, &maxFeatures, sizeof(maxFeatures), 0, cudaMemcpyHostToDevice, stream) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_img_rows, &img_rows, sizeof(img_rows), 0, cudaMemcpyHostToDevice, stream) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_img_cols, &img_cols, sizeof(img_cols), 0, cudaMemcpyHostToDevice, stream) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_nOctaveLayers, &nOctaveLayers, sizeof(nOctaveLayers), 0, cudaMemcpyHostToDevice, stream) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_hessianThreshold, &hessianThreshold, sizeof(hessianThreshold), 0, cudaMemcpyHostToDevice, stream) );
         }
 
-        void loadOctaveConstants(int octave, int layer_rows, int layer_cols)
+        void loadOctaveConstants(int octave, int layer_rows, int layer_cols, cudaStream_t stream)
         {
-            cudaSafeCall( cudaMemcpyToSymbol(c_octave, &octave, sizeof(octave)) );
-            cudaSafeCall( cudaMemcpyToSymbol(c_layer_rows, &layer_rows, sizeof(layer_rows)) );
-            cudaSafeCall( cudaMemcpyToSymbol(c_layer_cols, &layer_cols, sizeof(layer_cols)) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_octave, &octave, sizeof(octave), 0, cudaMemcpyHostToDevice, stream) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_layer_rows, &layer_rows, sizeof(layer_rows), 0, cudaMemcpyHostToDevice, stream) );
+            cudaSafeCall( cudaMemcpyToSymbolAsync(c_layer_cols, &layer_cols, sizeof(layer_cols), 0, cudaMemcpyHostToDevice, stream) );
         }
 
         ////////////////////////////////////////////////////////////////////////
@@ -232,7 +232,7 @@ namespace cv { namespace cuda { namespace device
         }
 
         void icvCalcLayerDetAndTrace_gpu(const PtrStepf& det, const PtrStepf& trace, int img_rows, int img_cols,
-            int octave, int nOctaveLayers)
+            int octave, int nOctaveLayers, cudaStream_t stream)
         {
             const int min_size = calcSize(octave, 0);
             const int max_samples_i = 1 + ((img_rows - min_size) >> octave);
@@ -244,10 +244,11 @@ namespace cv { namespace cuda { namespace device
             grid.x = divUp(max_samples_j, threads.x);
             grid.y = divUp(max_samples_i, threads.y) * (nOctaveLayers + 2);
 
-            icvCalcLayerDetAndTrace<<<grid, threads>>>(det, trace);
+            icvCalcLayerDetAndTrace<<<grid, threads, 0, stream>>>(det, trace);
             cudaSafeCall( cudaGetLastError() );
 
-            cudaSafeCall( cudaDeviceSynchronize() );
+            if (stream == 0)
+                cudaSafeCall( cudaDeviceSynchronize() );
         }
 
         ////////////////////////////////////////////////////////////////////////
@@ -375,7 +376,7 @@ namespace cv { namespace cuda { namespace device
         }
 
         void icvFindMaximaInLayer_gpu(const PtrStepf& det, const PtrStepf& trace, int4* maxPosBuffer, unsigned int* maxCounter,
-            int img_rows, int img_cols, int octave, bool use_mask, int nOctaveLayers)
+            int img_rows, int img_cols, int octave, bool use_mask, int nOctaveLayers, cudaStream_t stream)
         {
             const int layer_rows = img_rows >> octave;
             const int layer_cols = img_cols >> octave;
@@ -391,13 +392,14 @@ namespace cv { namespace cuda { namespace device
             const size_t smem_size = threads.x * threads.y * 3 * sizeof(float);
 
             if (use_mask)
-                icvFindMaximaInLayer<WithMask><<<grid, threads, smem_size>>>(det, trace, maxPosBuffer, maxCounter);
+                icvFindMaximaInLayer<WithMask><<<grid, threads, smem_size, stream>>>(det, trace, maxPosBuffer, maxCounter);
             else
-                icvFindMaximaInLayer<WithOutMask><<<grid, threads, smem_size>>>(det, trace, maxPosBuffer, maxCounter);
+                icvFindMaximaInLayer<WithOutMask><<<grid, threads, smem_size, stream>>>(det, trace, maxPosBuffer, maxCounter);
 
             cudaSafeCall( cudaGetLastError() );
 
-            cudaSafeCall( cudaDeviceSynchronize() );
+            if (stream == 0)
+                cudaSafeCall( cudaDeviceSynchronize() );
         }
 
         ////////////////////////////////////////////////////////////////////////
@@ -405,7 +407,7 @@ namespace cv { namespace cuda { namespace device
 
         __global__ void icvInterpolateKeypoint(const PtrStepf det, const int4* maxPosBuffer,
             float* featureX, float* featureY, int* featureLaplacian, int* featureOctave, float* featureSize, float* featureHessian,
-            unsigned int* featureCounter)
+            unsigned int* featureCounter, cudaStream_t stream)
         {
             #if defined __CUDA_ARCH__ && __CUDA_ARCH__ >= 110
 
@@ -509,7 +511,7 @@ namespace cv { namespace cuda { namespace device
 
         void icvInterpolateKeypoint_gpu(const PtrStepf& det, const int4* maxPosBuffer, unsigned int maxCounter,
             float* featureX, float* featureY, int* featureLaplacian, int* featureOctave, float* featureSize, float* featureHessian,
-            unsigned int* featureCounter)
+            unsigned int* featureCounter, cudaStream_t stream)
         {
             dim3 threads;
             threads.x = 3;
@@ -519,10 +521,11 @@ namespace cv { namespace cuda { namespace device
             dim3 grid;
             grid.x = maxCounter;
 
-            icvInterpolateKeypoint<<<grid, threads>>>(det, maxPosBuffer, featureX, featureY, featureLaplacian, featureOctave, featureSize, featureHessian, featureCounter);
+            icvInterpolateKeypoint<<<grid, threads, 0, stream>>>(det, maxPosBuffer, featureX, featureY, featureLaplacian, featureOctave, featureSize, featureHessian, featureCounter);
             cudaSafeCall( cudaGetLastError() );
 
-            cudaSafeCall( cudaDeviceSynchronize() );
+            if (stream == 0)
+                cudaSafeCall( cudaDeviceSynchronize() );
         }
 
         ////////////////////////////////////////////////////////////////////////
@@ -676,7 +679,7 @@ namespace cv { namespace cuda { namespace device
         #undef ORI_WIN
         #undef ORI_SAMPLES
 
-        void icvCalcOrientation_gpu(const float* featureX, const float* featureY, const float* featureSize, float* featureDir, int nFeatures)
+        void icvCalcOrientation_gpu(const float* featureX, const float* featureY, const float* featureSize, float* featureDir, int nFeatures, cudaStream_t stream)
         {
             dim3 threads;
             threads.x = 32;
@@ -685,10 +688,11 @@ namespace cv { namespace cuda { namespace device
             dim3 grid;
             grid.x = nFeatures;
 
-            icvCalcOrientation<<<grid, threads>>>(featureX, featureY, featureSize, featureDir);
+            icvCalcOrientation<<<grid, threads, 0, stream>>>(featureX, featureY, featureSize, featureDir);
             cudaSafeCall( cudaGetLastError() );
 
-            cudaSafeCall( cudaDeviceSynchronize() );
+            if (stream == 0)
+                cudaSafeCall( cudaDeviceSynchronize() );
         }
 
         ////////////////////////////////////////////////////////////////////////
@@ -925,33 +929,31 @@ namespace cv { namespace cuda { namespace device
             descriptor_base[threadIdx.x] = val / s_len;
         }
 
-        void compute_descriptors_gpu(PtrStepSz<float4> descriptors, const float* featureX, const float* featureY, const float* featureSize, const float* featureDir, int nFeatures)
+        void compute_descriptors_gpu(PtrStepSz<float4> descriptors, const float* featureX, const float* featureY, const float* featureSize, const float* featureDir, int nFeatures, cudaStream_t stream)
         {
             // compute unnormalized descriptors, then normalize them - odd indexing since grid must be 2D
 
             if (descriptors.cols == 64)
             {
-                compute_descriptors_64<<<nFeatures, dim3(32, 16)>>>(descriptors, featureX, featureY, featureSize, featureDir);
+                compute_descriptors_64<<<nFeatures, dim3(32, 16), 0, stream>>>(descriptors, featureX, featureY, featureSize, featureDir);
                 cudaSafeCall( cudaGetLastError() );
 
-                cudaSafeCall( cudaDeviceSynchronize() );
-
-                normalize_descriptors<64><<<nFeatures, 64>>>((PtrStepSzf) descriptors);
+                normalize_descriptors<64><<<nFeatures, 64, 0, stream>>>((PtrStepSzf) descriptors);
                 cudaSafeCall( cudaGetLastError() );
 
-                cudaSafeCall( cudaDeviceSynchronize() );
+                if (stream == 0)
+                    cudaSafeCall( cudaDeviceSynchronize() );
             }
             else
             {
-                compute_descriptors_128<<<nFeatures, dim3(32, 16)>>>(descriptors, featureX, featureY, featureSize, featureDir);
+                compute_descriptors_128<<<nFeatures, dim3(32, 16), 0, stream>>>(descriptors, featureX, featureY, featureSize, featureDir);
                 cudaSafeCall( cudaGetLastError() );
 
-                cudaSafeCall( cudaDeviceSynchronize() );
-
-                normalize_descriptors<128><<<nFeatures, 128>>>((PtrStepSzf) descriptors);
+                normalize_descriptors<128><<<nFeatures, 128, 0, stream>>>((PtrStepSzf) descriptors);
                 cudaSafeCall( cudaGetLastError() );
 
-                cudaSafeCall( cudaDeviceSynchronize() );
+                if (stream == 0)
+                    cudaSafeCall( cudaDeviceSynchronize() );
             }
         }
     } // namespace surf
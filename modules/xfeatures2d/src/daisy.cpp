@@ -169,6 +169,24 @@ public:
      */
     virtual bool GetUnnormalizedDescriptor( double y, double x, int orientation, float* descriptor, double* H ) const;
 
+    /**
+     * @param image image to extract descriptors
+     * @param half_precision store the layers as half precision values
+     */
+    virtual void prepareImage( InputArray image, bool half_precision );
+
+    /**
+     * @param keypoints of interest within the prepared image
+     * @param descriptors resulted descriptors array
+     */
+    virtual void computePrepared( const std::vector<KeyPoint>& keypoints, OutputArray descriptors );
+
+    /** @overload
+     * @param roi region of interest within the prepared image
+     * @param descriptors resulted descriptors array
+     */
+    virtual void computePrepared( Rect roi, OutputArray descriptors );
+
 protected:
 
     /*
@@ -228,6 +246,12 @@ protected:
     // internal float image.
     Mat m_image;
 
+    // copy of the user supplied image of the cached layers
+    Mat m_source_image;
+
+    // if set to true, the cached layers are half precision values (CV_16S)
+    bool m_half_layers;
+
     // image roi
     Rect m_roi;
 
@@ -275,6 +299,13 @@ private:
     // image set image as working
     inline void set_image( InputArray image );
 
+    // computes the smoothed gradient layers of the image unless they are
+    // cached for the same image already.
+    inline void prepare_layers( InputArray image, bool half_precision );
+
+    // converts the smoothed gradient layers to half precision values.
+    inline void convert_layers_fp16();
+
     // releases all the used memory; call this if you want to process
     // multiple images within a loop.
     inline void reset();
@@ -331,6 +362,7 @@ private:
 inline void DAISY_Impl::reset()
 {
     m_image.release();
+    m_source_image.release();
 
     m_scale_map.release();
     m_orientation_map.release();
@@ -572,6 +604,38 @@ static void normalize_descriptor( float* desc, const int nrm_type, const int _gr
         CV_Error( Error::StsInternal, "No such normalization" );
 }
 
+// converts a half precision value stored as 16-bit integer to float
+static inline float half_to_float( ushort h )
+{
+    Cv32suf out;
+    unsigned sign = (unsigned)(h & 0x8000) << 16;
+    unsigned e = (h >> 10) & 0x1f, m = h & 0x3ff;
+    if( e == 0 )
+    {
+      // zero or subnormal value: m * 2^-24
+      out.f = m * (1.f/16777216.f);
+      out.u |= sign;
+    }
+    else if( e == 31 )
+      out.u = sign | 0x7f800000 | (m << 13);
+    else
+      out.u = sign | ((e + 112) << 23) | (m << 13);
+    return out.f;
+}
+
+// returns the histogram stored at (y,x) of the cube; histograms of half
+// precision cubes are converted into the supplied buffer.
+static inline const float* get_cube_histogram( const Mat* hcube, int y, int x, float* buf )
+{
+    if( hcube->depth() == CV_32F )
+      return hcube->ptr<float>(y,x,0);
+
+    const ushort* hptr = hcube->ptr<ushort>(y,x,0);
+    for( int h=0; h<hcube->size[2]; h++ )
+      buf[h] = half_to_float( hptr[h] );
+    return buf;
+}
+
 static void ni_get_histogram( float* histogram, const int y, const int x, const int shift, const Mat* hcube )
 {
 
@@ -580,7 +644,8 @@ static void ni_get_histogram( float* histogram, const int y, const int x, const
        ) return;
 
     int _hist_th_q_no = hcube->size[2];
-    const float* hptr = hcube->ptr<float>(y,x,0);
+    float hbuf[MAX_CUBE_NO];
+    const float* hptr = get_cube_histogram( hcube, y, x, hbuf );
     for( int h=0; h<_hist_th_q_no; h++ )
     {
       int hi = h+shift;
@@ -602,10 +667,11 @@ static void bi_get_histogram( float* histogram, const double y, const double x,
 
     // A C --> pixel positions
     // B D
-    const float* A = hcube->ptr<float>( mny   ,  mnx   , 0);
-    const float* B = hcube->ptr<float>((mny+1),  mnx   , 0);
-    const float* C = hcube->ptr<float>( mny   , (mnx+1), 0);
-    const float* D = hcube->ptr<float>((mny+1), (mnx+1), 0);
+    float hbuf[4][MAX_CUBE_NO];
+    const float* A = get_cube_histogram( hcube,  mny   ,  mnx   , hbuf[0] );
+    const float* B = get_cube_histogram( hcube, (mny+1),  mnx   , hbuf[1] );
+    const float* C = get_cube_histogram( hcube,  mny   , (mnx+1), hbuf[2] );
+    const float* D = get_cube_histogram( hcube, (mny+1), (mnx+1), hbuf[3] );
 
     double alpha = mnx+1-x;
     double beta  = mny+1-y;
@@ -1429,6 +1495,16 @@ inline void DAISY_Impl::compute_orientations()
 }
 
 
+inline void DAISY_Impl::convert_layers_fp16()
+{
+    for( size_t r=0; r<m_smoothed_gradient_layers.size(); r++ )
+    {
+      Mat half;
+      convertFp16( m_smoothed_gradient_layers[r], half );
+      m_smoothed_gradient_layers[r] = half;
+    }
+}
+
 inline void DAISY_Impl::initialize_single_descriptor_mode( )
 {
     initialize();
@@ -1477,20 +1553,76 @@ inline void DAISY_Impl::set_image( InputArray _image )
 }
 
 
+inline void DAISY_Impl::prepare_layers( InputArray _image, bool half_precision )
+{
+    Mat image = _image.getMat();
+    // image cannot be empty
+    CV_Assert( ! image.empty() );
+
+    // reuse the layers of the same image
+    if( !m_smoothed_gradient_layers.empty() && half_precision == m_half_layers &&
+        image.size() == m_source_image.size() && image.type() == m_source_image.type() &&
+        norm( image, m_source_image, NORM_INF ) == 0 )
+      return;
+
+    set_image( image );
+
+    set_parameters();
+    initialize_single_descriptor_mode();
+
+    if( half_precision )
+      convert_layers_fp16();
+
+    m_source_image = image.clone();
+    m_half_layers = half_precision;
+}
+
+struct ComputeKeypointsDescriptorsInvoker : ParallelLoopBody
+{
+    ComputeKeypointsDescriptorsInvoker( const DAISY* _daisy, const std::vector<KeyPoint>* _keypoints,
+                                        Mat* _descriptors, double* _H, bool _use_orientation )
+    {
+      daisy = _daisy;
+      keypoints = _keypoints;
+      descriptors = _descriptors;
+      H = _H;
+      use_orientation = _use_orientation;
+    }
+
+    void operator ()(const cv::Range& range) const
+    {
+      for (int k = range.start; k < range.end; ++k)
+      {
+        const KeyPoint& kp = keypoints->at(k);
+        int orientation = use_orientation ? (int) kp.angle : 0;
+        if( H )
+          daisy->GetDescriptor( kp.pt.y, kp.pt.x, orientation, descriptors->ptr<float>( k ), H );
+        else
+          daisy->GetDescriptor( kp.pt.y, kp.pt.x, orientation, descriptors->ptr<float>( k ) );
+      }
+    }
+
+    const DAISY* daisy;
+    const std::vector<KeyPoint>* keypoints;
+    Mat* descriptors;
+    double* H;
+    bool use_orientation;
+};
+
+
 // -------------------------------------------------
 /* DAISY interface implementation */
 
-// keypoint scope
-void DAISY_Impl::compute( InputArray _image, std::vector<KeyPoint>& keypoints, OutputArray _descriptors )
+// prepare image layers
+void DAISY_Impl::prepareImage( InputArray _image, bool half_precision )
 {
-    // do nothing if no image
-    if( _image.getMat().empty() )
-      return;
-
-    set_image( _image );
+    prepare_layers( _image, half_precision );
+}
 
-    // whole image
-    m_roi = Rect( 0, 0, m_image.cols, m_image.rows );
+// keypoint scope of prepared image
+void DAISY_Impl::computePrepared( const std::vector<KeyPoint>& keypoints, OutputArray _descriptors )
+{
+    CV_Assert( ! m_smoothed_gradient_layers.empty() );
 
     // get homography
     Mat H = m_h_matrix;
@@ -1499,10 +1631,6 @@ void DAISY_Impl::compute( InputArray _image, std::vector<KeyPoint>& keypoints, O
     if ( H.depth() != CV_64F )
         H.convertTo( H, CV_64F );
 
-    set_parameters();
-
-    initialize_single_descriptor_mode();
-
     // allocate array
     _descriptors.create( (int) keypoints.size(), m_descriptor_size, CV_32F );
 
@@ -1512,46 +1640,22 @@ void DAISY_Impl::compute( InputArray _image, std::vector<KeyPoint>& keypoints, O
 
     // iterate over keypoints
     // and fill computed descriptors
-    if ( H.empty() )
-      for (int k = 0; k < (int) keypoints.size(); k++)
-      {
-          get_descriptor( keypoints[k].pt.y, keypoints[k].pt.x,
-                          m_use_orientation ? (int) keypoints[k].angle : 0,
-                          &descriptors.at<float>( k, 0 ), &m_smoothed_gradient_layers,
-                          &m_oriented_grid_points, m_orientation_shift_table, m_th_q_no,
-                          m_hist_th_q_no, m_grid_point_number, m_descriptor_size, m_enable_interpolation,
-                          m_nrm_type );
-      }
-    else
-      for (int k = 0; k < (int) keypoints.size(); k++)
-      {
-        get_descriptor_h( keypoints[k].pt.y, keypoints[k].pt.x,
-                          m_use_orientation ? (int) keypoints[k].angle : 0,
-                          &descriptors.at<float>( k, 0 ), &H.at<double>( 0 ), &m_smoothed_gradient_layers,
-                          m_cube_sigmas, &m_grid_points, m_orientation_shift_table, m_th_q_no,
-                          m_hist_th_q_no, m_grid_point_number, m_descriptor_size, m_enable_interpolation,
-                          m_nrm_type );
-      }
-
+    parallel_for_( Range(0, (int) keypoints.size()),
+        ComputeKeypointsDescriptorsInvoker( this, &keypoints, &descriptors,
+                                            H.empty() ? 0 : H.ptr<double>(), m_use_orientation )
+    );
 }
 
-// full scope with roi
-void DAISY_Impl::compute( InputArray _image, Rect roi, OutputArray _descriptors )
+// full scope with roi of prepared image
+void DAISY_Impl::computePrepared( Rect roi, OutputArray _descriptors )
 {
-    // do nothing if no image
-    if( _image.getMat().empty() )
-      return;
-
+    CV_Assert( ! m_smoothed_gradient_layers.empty() );
     CV_Assert( m_h_matrix.empty() );
     CV_Assert( ! m_use_orientation );
-
-    set_image( _image );
+    CV_Assert( ( roi & Rect( 0, 0, m_image.cols, m_image.rows ) ) == roi );
 
     m_roi = roi;
 
-    set_parameters();
-    initialize_single_descriptor_mode();
-
     _descriptors.create( m_roi.width*m_roi.height, m_descriptor_size, CV_32F );
 
     Mat descriptors = _descriptors.getMat();
@@ -1561,31 +1665,40 @@ void DAISY_Impl::compute( InputArray _image, Rect roi, OutputArray _descriptors
     normalize_descriptors( &descriptors );
 }
 
-// full scope
-void DAISY_Impl::compute( InputArray _image, OutputArray _descriptors )
+// keypoint scope
+void DAISY_Impl::compute( InputArray _image, std::vector<KeyPoint>& keypoints, OutputArray _descriptors )
 {
     // do nothing if no image
     if( _image.getMat().empty() )
       return;
 
-    CV_Assert( m_h_matrix.empty() );
-    CV_Assert( ! m_use_orientation );
-
-    set_image( _image );
+    prepare_layers( _image, m_half_layers );
+    computePrepared( keypoints, _descriptors );
+}
 
-    // whole image
-    m_roi = Rect( 0, 0, m_image.cols, m_image.rows );
+// full scope with roi
+void DAISY_Impl::compute( InputArray _image, Rect roi, OutputArray _descriptors )
+{
+    // do nothing if no image
+    if( _image.getMat().empty() )
+      return;
 
-    set_parameters();
-    initialize_single_descriptor_mode();
+    CV_Assert( m_h_matrix.empty() );
+    CV_Assert( ! m_use_orientation );
 
-    _descriptors.create( m_roi.width*m_roi.height, m_descriptor_size, CV_32F );
+    prepare_layers( _image, m_half_layers );
+    computePrepared( roi, _descriptors );
+}
 
-    Mat descriptors = _descriptors.getMat();
+// full scope
+void DAISY_Impl::compute( InputArray _image, OutputArray _descriptors )
+{
+    // do nothing if no image
+    if( _image.getMat().empty() )
+      return;
 
-    // compute full desc
-    compute_descriptors( &descriptors );
-    normalize_descriptors( &descriptors );
+    // whole image
+    compute( _image, Rect( Point(), _image.size() ), _descriptors );
 }
 
 // constructor
@@ -1597,6 +1710,7 @@ DAISY_Impl::DAISY_Impl( float _radius, int _q_radius, int _q_theta, int _q_hist,
 
     m_descriptor_size = 0;
     m_grid_point_number = 0;
+    m_half_layers = false;
 
     m_scale_invariant = false;
     m_rotation_invariant = false;
@@ -40,6 +40,7 @@
 #include <algorithm>
 #include <iomanip>
 #include <string.h>
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -91,15 +92,27 @@ protected:
 
     void buildPattern();
 
+    struct PatternPoint;
+
+    template <typename imgType, typename iiType>
+    imgType meanIntensity( const Mat& image, const Mat& integral, const PatternPoint& point,
+                          const float kp_x, const float kp_y ) const;
+
     template <typename imgType, typename iiType>
-    imgType meanIntensity( InputArray image, InputArray integral, const float kp_x, const float kp_y,
-                          const unsigned int scale, const unsigned int rot, const unsigned int point );
+    void meanIntensities( const Mat& image, const Mat& integral, const float kp_x, const float kp_y,
+                          const unsigned int scale, const unsigned int rot, imgType* values ) const;
+
+    template <typename imgType>
+    int estimateOrientation( const imgType* pointsValue, float& angle ) const;
 
     template <typename srcMatType, typename iiMatType>
     void computeDescriptors( InputArray image, std::vector<KeyPoint>& keypoints, OutputArray descriptors );
 
     template <typename srcMatType>
-    void extractDescriptor(srcMatType *pointsValue, void ** ptr);
+    void extractDescriptor( const srcMatType* pointsValue, uchar* desc ) const;
+
+    template <typename srcMatType, typename iiMatType>
+    class DescriptorInvoker;
 
     bool orientationNormalized; //true if the orientation is normalized, false otherwise
     bool scaleNormalized; //true if the scale is normalized, false otherwise
@@ -362,284 +375,232 @@ void FREAK_Impl::compute( InputArray _image, std::vector<KeyPoint>& keypoints, O
     }
 }
 
+// The descriptor keeps the bit order of the former SSE2 implementation: bit g of byte 16*b+l holds
+// the comparison of pair 128*b+16*g+15-l (the first 128 comparisons remain globally the same, which
+// does not affect the 128,384 bits segmented matching strategy)
 template <typename srcMatType>
-void FREAK_Impl::extractDescriptor(srcMatType *pointsValue, void ** ptr)
+void FREAK_Impl::extractDescriptor( const srcMatType* pointsValue, uchar* desc ) const
 {
-    std::bitset<FREAK_NB_PAIRS>** ptrScalar = (std::bitset<FREAK_NB_PAIRS>**) ptr;
-
-    // extracting descriptor preserving the order of SSE version
-    int cnt = 0;
-    for( int n = 7; n < FREAK_NB_PAIRS; n += 128)
+    for( int b = 0; b < FREAK_NB_PAIRS/128; ++b )
     {
-        for( int m = 8; m--; )
+        for( int l = 0; l < 16; ++l )
         {
-            int nm = n-m;
-            for(int kk = nm+15*8; kk >= nm; kk-=8, ++cnt)
+            int byte = 0;
+            for( int g = 0; g < 8; ++g )
             {
-                (*ptrScalar)->set(kk, pointsValue[descriptionPairs[cnt].i] >= pointsValue[descriptionPairs[cnt].j]);
+                const DescriptionPair& pair = descriptionPairs[128*b + 16*g + 15 - l];
+                byte |= (pointsValue[pair.i] >= pointsValue[pair.j]) << g;
             }
+            desc[16*b + l] = (uchar)byte;
         }
     }
-    --(*ptrScalar);
 }
 
-#if CV_SSE2
+#if CV_SIMD128
 template <>
-void FREAK_Impl::extractDescriptor(uchar *pointsValue, void ** ptr)
+void FREAK_Impl::extractDescriptor( const uchar* pointsValue, uchar* desc ) const
 {
-    __m128i** ptrSSE = (__m128i**) ptr;
+    // gather the intensities of the pairs in the bit order of the descriptor
+    CV_DECL_ALIGNED(16) uchar first[FREAK_NB_PAIRS];
+    CV_DECL_ALIGNED(16) uchar second[FREAK_NB_PAIRS];
+    for( int k = 0; k < FREAK_NB_PAIRS; ++k )
+    {
+        const DescriptionPair& pair = descriptionPairs[k ^ 15];
+        first[k] = pointsValue[pair.i];
+        second[k] = pointsValue[pair.j];
+    }
 
-    // note that comparisons order is modified in each block (but first 128 comparisons remain globally the same-->does not affect the 128,384 bits segmanted matching strategy)
-    int cnt = 0;
-    for( int n = FREAK_NB_PAIRS/128; n-- ; )
+    // 16 comparisons at a time, merged into the bytes of each 128 bits segment
+    for( int b = 0; b < FREAK_NB_PAIRS/128; ++b )
     {
-        __m128i result128 = _mm_setzero_si128();
-        for( int m = 128/16; m--; cnt += 16 )
+        v_uint8x16 result = v_setzero_u8();
+        for( int g = 0; g < 8; ++g )
         {
-            __m128i operand1 = _mm_set_epi8(pointsValue[descriptionPairs[cnt+0].i],
-                                            pointsValue[descriptionPairs[cnt+1].i],
-                                            pointsValue[descriptionPairs[cnt+2].i],
-                                            pointsValue[descriptionPairs[cnt+3].i],
-                                            pointsValue[descriptionPairs[cnt+4].i],
-                                            pointsValue[descriptionPairs[cnt+5].i],
-                                            pointsValue[descriptionPairs[cnt+6].i],
-                                            pointsValue[descriptionPairs[cnt+7].i],
-                                            pointsValue[descriptionPairs[cnt+8].i],
-                                            pointsValue[descriptionPairs[cnt+9].i],
-                                            pointsValue[descriptionPairs[cnt+10].i],
-                                            pointsValue[descriptionPairs[cnt+11].i],
-                                            pointsValue[descriptionPairs[cnt+12].i],
-                                            pointsValue[descriptionPairs[cnt+13].i],
-                                            pointsValue[descriptionPairs[cnt+14].i],
-                                            pointsValue[descriptionPairs[cnt+15].i]);
-
-            __m128i operand2 = _mm_set_epi8(pointsValue[descriptionPairs[cnt+0].j],
-                                            pointsValue[descriptionPairs[cnt+1].j],
-                                            pointsValue[descriptionPairs[cnt+2].j],
-                                            pointsValue[descriptionPairs[cnt+3].j],
-                                            pointsValue[descriptionPairs[cnt+4].j],
-                                            pointsValue[descriptionPairs[cnt+5].j],
-                                            pointsValue[descriptionPairs[cnt+6].j],
-                                            pointsValue[descriptionPairs[cnt+7].j],
-                                            pointsValue[descriptionPairs[cnt+8].j],
-                                            pointsValue[descriptionPairs[cnt+9].j],
-                                            pointsValue[descriptionPairs[cnt+10].j],
-                                            pointsValue[descriptionPairs[cnt+11].j],
-                                            pointsValue[descriptionPairs[cnt+12].j],
-                                            pointsValue[descriptionPairs[cnt+13].j],
-                                            pointsValue[descriptionPairs[cnt+14].j],
-                                            pointsValue[descriptionPairs[cnt+15].j]);
-
-            __m128i workReg = _mm_min_epu8(operand1, operand2); // emulated "not less than" for 8-bit UNSIGNED integers
-            workReg = _mm_cmpeq_epi8(workReg, operand2);        // emulated "not less than" for 8-bit UNSIGNED integers
-
-            workReg = _mm_and_si128(_mm_set1_epi16(short(0x8080 >> m)), workReg); // merge the last 16 bits with the 128bits std::vector until full
-            result128 = _mm_or_si128(result128, workReg);
+            const int k = 128*b + 16*g;
+            v_uint8x16 notLess = v_load_aligned(first + k) >= v_load_aligned(second + k);
+            result |= notLess & v_setall_u8((uchar)(1 << g));
         }
-        (**ptrSSE) = result128;
-        ++(*ptrSSE);
+        v_store(desc + 16*b, result);
     }
-    (*ptrSSE) -= 8;
 }
 #endif
 
-template <typename srcMatType, typename iiMatType>
-void FREAK_Impl::computeDescriptors( InputArray _image, std::vector<KeyPoint>& keypoints, OutputArray _descriptors ){
-
-    Mat image = _image.getMat();
-    Mat imgIntegral;
-    integral(image, imgIntegral, DataType<iiMatType>::type);
-    std::vector<int> kpScaleIdx(keypoints.size()); // used to save pattern scale index corresponding to each keypoints
-    const std::vector<int>::iterator ScaleIdxBegin = kpScaleIdx.begin(); // used in std::vector erase function
-    const std::vector<cv::KeyPoint>::iterator kpBegin = keypoints.begin(); // used in std::vector erase function
-    const float sizeCst = static_cast<float>(FREAK_NB_SCALES/(FREAK_LOG2* nOctaves));
-    srcMatType pointsValue[FREAK_NB_POINTS];
-    int thetaIdx = 0;
-    int direction0;
-    int direction1;
-
-    // compute the scale index corresponding to the keypoint size and remove keypoints close to the border
-    if( scaleNormalized )
+template <typename imgType>
+int FREAK_Impl::estimateOrientation( const imgType* pointsValue, float& angle ) const
+{
+    int direction0 = 0;
+    int direction1 = 0;
+    for( int m = 45; m--; )
     {
-        for( size_t k = keypoints.size(); k--; )
-        {
-            //Is k non-zero? If so, decrement it and continue"
-            kpScaleIdx[k] = std::max( (int)(std::log(keypoints[k].size/FREAK_SMALLEST_KP_SIZE)*sizeCst+0.5) ,0);
-            if( kpScaleIdx[k] >= FREAK_NB_SCALES )
-                kpScaleIdx[k] = FREAK_NB_SCALES-1;
-
-            if( keypoints[k].pt.x <= patternSizes[kpScaleIdx[k]] || //check if the description at this specific position and scale fits inside the image
-                 keypoints[k].pt.y <= patternSizes[kpScaleIdx[k]] ||
-                 keypoints[k].pt.x >= image.cols-patternSizes[kpScaleIdx[k]] ||
-                 keypoints[k].pt.y >= image.rows-patternSizes[kpScaleIdx[k]]
-               )
-            {
-                keypoints.erase(kpBegin+k);
-                kpScaleIdx.erase(ScaleIdxBegin+k);
-            }
-        }
+        //iterate through the orientation pairs
+        const int delta = (pointsValue[ orientationPairs[m].i ]-pointsValue[ orientationPairs[m].j ]);
+        direction0 += delta*(orientationPairs[m].weight_dx)/2048;
+        direction1 += delta*(orientationPairs[m].weight_dy)/2048;
     }
+
+    angle = static_cast<float>(atan2((float)direction1,(float)direction0)*(180.0/CV_PI));//estimate orientation
+
+    int thetaIdx;
+    if(angle < 0.f)
+        thetaIdx = int(FREAK_NB_ORIENTATION*angle*(1/360.0)-0.5);
     else
+        thetaIdx = int(FREAK_NB_ORIENTATION*angle*(1/360.0)+0.5);
+
+    if( thetaIdx < 0 )
+        thetaIdx += FREAK_NB_ORIENTATION;
+
+    if( thetaIdx >= FREAK_NB_ORIENTATION )
+        thetaIdx -= FREAK_NB_ORIENTATION;
+    return thetaIdx;
+}
+
+/*!
+ ParallelLoopBody computing the orientation and the descriptor of each keypoint
+ */
+template <typename srcMatType, typename iiMatType>
+class FREAK_Impl::DescriptorInvoker : public ParallelLoopBody
+{
+public:
+    DescriptorInvoker( const FREAK_Impl& _freak, const Mat& _image, const Mat& _integral,
+                       std::vector<KeyPoint>& _keypoints, const std::vector<int>& _kpScaleIdx,
+                       Mat& _descriptors )
+        : freak(_freak), image(_image), integral(_integral), keypoints(_keypoints),
+          kpScaleIdx(_kpScaleIdx), descriptors(_descriptors) {}
+
+    void operator()( const Range& range ) const
     {
-        const int scIdx = std::max( (int)(1.0986122886681*sizeCst+0.5) ,0);
-        for( size_t k = keypoints.size(); k--; )
+        srcMatType pointsValue[FREAK_NB_POINTS];
+        for( int k = range.start; k < range.end; ++k )
         {
-            kpScaleIdx[k] = scIdx; // equivalent to the formule when the scale is normalized with a constant size of keypoints[k].size=3*SMALLEST_KP_SIZE
-            if( kpScaleIdx[k] >= FREAK_NB_SCALES )
+            KeyPoint& kp = keypoints[k];
+            int thetaIdx = 0;
+
+            // estimate orientation (gradient)
+            if( !freak.orientationNormalized )
             {
-                kpScaleIdx[k] = FREAK_NB_SCALES-1;
+                kp.angle = 0.0; // assign 0° to all keypoints
             }
-            if( keypoints[k].pt.x <= patternSizes[kpScaleIdx[k]] ||
-                keypoints[k].pt.y <= patternSizes[kpScaleIdx[k]] ||
-                keypoints[k].pt.x >= image.cols-patternSizes[kpScaleIdx[k]] ||
-                keypoints[k].pt.y >= image.rows-patternSizes[kpScaleIdx[k]]
-               )
+            else
             {
-                keypoints.erase(kpBegin+k);
-                kpScaleIdx.erase(ScaleIdxBegin+k);
+                // get the points intensity value in the un-rotated pattern
+                freak.meanIntensities<srcMatType, iiMatType>(image, integral, kp.pt.x, kp.pt.y,
+                                                             kpScaleIdx[k], 0, pointsValue);
+                thetaIdx = freak.estimateOrientation(pointsValue, kp.angle);
             }
-        }
-    }
-
-    // allocate descriptor memory, estimate orientations, extract descriptors
-    if( !extAll )
-    {
-        // extract the best comparisons only
-        _descriptors.create((int)keypoints.size(), FREAK_NB_PAIRS/8, CV_8U);
-        _descriptors.setTo(Scalar::all(0));
-        Mat descriptors = _descriptors.getMat();
 
-        void *ptr = descriptors.data+(keypoints.size()-1)*descriptors.step[0];
+            // get the points intensity value in the rotated pattern
+            freak.meanIntensities<srcMatType, iiMatType>(image, integral, kp.pt.x, kp.pt.y,
+                                                         kpScaleIdx[k], thetaIdx, pointsValue);
 
-        for( size_t k = keypoints.size(); k--; ) {
-            // estimate orientation (gradient)
-            if( !orientationNormalized )
+            if( !freak.extAll )
             {
-                thetaIdx = 0; // assign 0° to all keypoints
-                keypoints[k].angle = 0.0;
+                // extract the best comparisons only
+                freak.extractDescriptor(pointsValue, descriptors.ptr(k));
             }
             else
             {
-                // get the points intensity value in the un-rotated pattern
-                for( int i = FREAK_NB_POINTS; i--; ) {
-                    pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
-                                                                          keypoints[k].pt.x, keypoints[k].pt.y,
-                                                                          kpScaleIdx[k], 0, i);
-                }
-                direction0 = 0;
-                direction1 = 0;
-                for( int m = 45; m--; )
+                // extract all possible comparisons for selection
+                std::bitset<1024>* ptr = (std::bitset<1024>*) descriptors.ptr(k);
+                int cnt(0);
+                for( int i = 1; i < FREAK_NB_POINTS; ++i )
                 {
-                    //iterate through the orientation pairs
-                    const int delta = (pointsValue[ orientationPairs[m].i ]-pointsValue[ orientationPairs[m].j ]);
-                    direction0 += delta*(orientationPairs[m].weight_dx)/2048;
-                    direction1 += delta*(orientationPairs[m].weight_dy)/2048;
+                    //(generate all the pairs)
+                    for( int j = 0; j < i; ++j )
+                    {
+                        ptr->set(cnt, pointsValue[i] >= pointsValue[j] );
+                        ++cnt;
+                    }
                 }
+            }
+        }
+    }
 
-                keypoints[k].angle = static_cast<float>(atan2((float)direction1,(float)direction0)*(180.0/CV_PI));//estimate orientation
+private:
+    DescriptorInvoker& operator=( const DescriptorInvoker& ); // to quiet MSVC
 
-                if(keypoints[k].angle < 0.f)
-                    thetaIdx = int(FREAK_NB_ORIENTATION*keypoints[k].angle*(1/360.0)-0.5);
-                else
-                    thetaIdx = int(FREAK_NB_ORIENTATION*keypoints[k].angle*(1/360.0)+0.5);
+    const FREAK_Impl& freak;
+    const Mat& image;
+    const Mat& integral;
+    std::vector<KeyPoint>& keypoints;
+    const std::vector<int>& kpScaleIdx;
+    Mat& descriptors;
+};
 
-                if( thetaIdx < 0 )
-                    thetaIdx += FREAK_NB_ORIENTATION;
+template <typename srcMatType, typename iiMatType>
+void FREAK_Impl::computeDescriptors( InputArray _image, std::vector<KeyPoint>& keypoints, OutputArray _descriptors ){
 
-                if( thetaIdx >= FREAK_NB_ORIENTATION )
-                    thetaIdx -= FREAK_NB_ORIENTATION;
-            }
-            // extract descriptor at the computed orientation
-            for( int i = FREAK_NB_POINTS; i--; ) {
-                pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
-                                                                      keypoints[k].pt.x, keypoints[k].pt.y,
-                                                                      kpScaleIdx[k], thetaIdx, i);
-            }
+    Mat image = _image.getMat();
+    Mat imgIntegral;
+    integral(image, imgIntegral, DataType<iiMatType>::type);
+    const float sizeCst = static_cast<float>(FREAK_NB_SCALES/(FREAK_LOG2* nOctaves));
 
-            // Extract descriptor
-            extractDescriptor<srcMatType>(pointsValue, &ptr);
-        }
-    }
-    else // extract all possible comparisons for selection
+    // compute the scale index corresponding to the keypoint size and remove keypoints close to the border,
+    // keeping the order of the remaining ones
+    std::vector<int> kpScaleIdx(keypoints.size()); // used to save pattern scale index corresponding to each keypoints
+    // equivalent to the formula when the scale is normalized with a constant size of keypoints[k].size=3*SMALLEST_KP_SIZE
+    const int constScaleIdx = std::min( std::max( (int)(1.0986122886681*sizeCst+0.5) ,0), FREAK_NB_SCALES-1 );
+    size_t nKept = 0;
+    for( size_t k = 0; k < keypoints.size(); ++k )
     {
-        _descriptors.create((int)keypoints.size(), 128, CV_8U);
-        _descriptors.setTo(Scalar::all(0));
-        Mat descriptors = _descriptors.getMat();
-        std::bitset<1024>* ptr = (std::bitset<1024>*) (descriptors.data+(keypoints.size()-1)*descriptors.step[0]);
-
-        for( size_t k = keypoints.size(); k--; )
+        int scaleIdx = constScaleIdx;
+        if( scaleNormalized )
         {
-            //estimate orientation (gradient)
-            if( !orientationNormalized )
-            {
-                thetaIdx = 0;//assign 0° to all keypoints
-                keypoints[k].angle = 0.0;
-            }
-            else
-            {
-                //get the points intensity value in the un-rotated pattern
-                for( int i = FREAK_NB_POINTS;i--; )
-                    pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
-                                                                          keypoints[k].pt.x,keypoints[k].pt.y,
-                                                                          kpScaleIdx[k], 0, i);
-
-                direction0 = 0;
-                direction1 = 0;
-                for( int m = 45; m--; )
-                {
-                    //iterate through the orientation pairs
-                    const int delta = (pointsValue[ orientationPairs[m].i ]-pointsValue[ orientationPairs[m].j ]);
-                    direction0 += delta*(orientationPairs[m].weight_dx)/2048;
-                    direction1 += delta*(orientationPairs[m].weight_dy)/2048;
-                }
+            scaleIdx = std::max( (int)(std::log(keypoints[k].size/FREAK_SMALLEST_KP_SIZE)*sizeCst+0.5) ,0);
+            if( scaleIdx >= FREAK_NB_SCALES )
+                scaleIdx = FREAK_NB_SCALES-1;
+        }
 
-                keypoints[k].angle = static_cast<float>(atan2((float)direction1,(float)direction0)*(180.0/CV_PI)); //estimate orientation
+        //check if the description at this specific position and scale fits inside the image
+        const int patternSize = patternSizes[scaleIdx];
+        if( keypoints[k].pt.x <= patternSize ||
+            keypoints[k].pt.y <= patternSize ||
+            keypoints[k].pt.x >= image.cols-patternSize ||
+            keypoints[k].pt.y >= image.rows-patternSize
+           )
+            continue;
+
+        kpScaleIdx[nKept] = scaleIdx;
+        keypoints[nKept++] = keypoints[k];
+    }
+    keypoints.resize(nKept);
+    kpScaleIdx.resize(nKept);
 
-                if(keypoints[k].angle < 0.f)
-                    thetaIdx = int(FREAK_NB_ORIENTATION*keypoints[k].angle*(1/360.0)-0.5);
-                else
-                    thetaIdx = int(FREAK_NB_ORIENTATION*keypoints[k].angle*(1/360.0)+0.5);
+    // allocate descriptor memory, estimate orientations, extract descriptors
+    _descriptors.create((int)keypoints.size(), extAll ? 128 : FREAK_NB_PAIRS/8, CV_8U);
+    _descriptors.setTo(Scalar::all(0));
+    Mat descriptors = _descriptors.getMat();
 
-                if( thetaIdx < 0 )
-                    thetaIdx += FREAK_NB_ORIENTATION;
+    parallel_for_(Range(0, (int)keypoints.size()),
+                  DescriptorInvoker<srcMatType, iiMatType>(*this, image, imgIntegral, keypoints,
+                                                           kpScaleIdx, descriptors));
+}
 
-                if( thetaIdx >= FREAK_NB_ORIENTATION )
-                    thetaIdx -= FREAK_NB_ORIENTATION;
-            }
-            // get the points intensity value in the rotated pattern
-            for( int i = FREAK_NB_POINTS; i--; ) {
-                pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
-                                                                      keypoints[k].pt.x, keypoints[k].pt.y,
-                                                                      kpScaleIdx[k], thetaIdx, i);
-            }
+// mean of the integral image over [x_left, x_right) x [y_top, y_bottom)
+template <typename imgType, typename iiType>
+static inline imgType boxMean( const Mat& integral, const int x_left, const int y_top,
+                               const int x_right, const int y_bottom )
+{
+    const iiType* top = integral.ptr<iiType>(y_top);
+    const iiType* bottom = integral.ptr<iiType>(y_bottom);
+    iiType ret_val;
 
-            int cnt(0);
-            for( int i = 1; i < FREAK_NB_POINTS; ++i )
-            {
-                //(generate all the pairs)
-                for( int j = 0; j < i; ++j )
-                {
-                    ptr->set(cnt, pointsValue[i] >= pointsValue[j] );
-                    ++cnt;
-                }
-            }
-            --ptr;
-        }
-    }
+    ret_val = bottom[x_right];//bottom right corner
+    ret_val -= bottom[x_left];
+    ret_val += top[x_left];
+    ret_val -= top[x_right];
+    const int area = (x_right - x_left) * (y_bottom - y_top);
+    ret_val = (ret_val + area/2) / area;
+    return static_cast<imgType>(ret_val);
 }
 
 // simply take average on a square patch, not even gaussian approx
 template <typename imgType, typename iiType>
-imgType FREAK_Impl::meanIntensity( InputArray _image, InputArray _integral,
+imgType FREAK_Impl::meanIntensity( const Mat& image, const Mat& integral,
+                              const PatternPoint& FreakPoint,
                               const float kp_x,
-                              const float kp_y,
-                              const unsigned int scale,
-                              const unsigned int rot,
-                              const unsigned int point)
+                              const float kp_y ) const
 {
-    Mat image = _image.getMat(), integral = _integral.getMat();
     // get point position in image
-    const PatternPoint& FreakPoint = patternLookup[scale*FREAK_NB_ORIENTATION*FREAK_NB_POINTS + rot*FREAK_NB_POINTS + point];
     const float xf = FreakPoint.x+kp_x;
     const float yf = FreakPoint.y+kp_y;
     const int x = int(xf);
@@ -656,12 +617,14 @@ imgType FREAK_Impl::meanIntensity( InputArray _image, InputArray _integral,
         const int r_y = static_cast<int>((yf-y)*1024);
         const int r_x_1 = (1024-r_x);
         const int r_y_1 = (1024-r_y);
+        const imgType* row0 = image.ptr<imgType>(y);
+        const imgType* row1 = image.ptr<imgType>(y+1);
         unsigned int ret_val;
         // linear interpolation:
-        ret_val = r_x_1*r_y_1*int(image.at<imgType>(y  , x  ))
-                + r_x  *r_y_1*int(image.at<imgType>(y  , x+1))
-                + r_x_1*r_y  *int(image.at<imgType>(y+1, x  ))
-                + r_x  *r_y  *int(image.at<imgType>(y+1, x+1));
+        ret_val = r_x_1*r_y_1*int(row0[x])
+                + r_x  *r_y_1*int(row0[x+1])
+                + r_x_1*r_y  *int(row1[x])
+                + r_x  *r_y  *int(row1[x+1]);
         //return the rounded mean
         ret_val += 2 * 1024 * 1024;
         return static_cast<imgType>(ret_val / (4 * 1024 * 1024));
@@ -674,16 +637,41 @@ imgType FREAK_Impl::meanIntensity( InputArray _image, InputArray _integral,
     const int y_top = int(yf-radius+0.5);
     const int x_right = int(xf+radius+1.5);//integral image is 1px wider
     const int y_bottom = int(yf+radius+1.5);//integral image is 1px higher
-    iiType ret_val;
+    return boxMean<imgType, iiType>(integral, x_left, y_top, x_right, y_bottom);
+}
 
-    ret_val = integral.at<iiType>(y_bottom,x_right);//bottom right corner
-    ret_val -= integral.at<iiType>(y_bottom,x_left);
-    ret_val += integral.at<iiType>(y_top,x_left);
-    ret_val -= integral.at<iiType>(y_top,x_right);
-    const int area = (x_right - x_left) * (y_bottom - y_top);
-    ret_val = (ret_val + area/2) / area;
-    //~ std::cout<<integral.step[1]<<std::endl;
-    return static_cast<imgType>(ret_val);
+// intensities of all the pattern points at the given keypoint, scale and orientation
+template <typename imgType, typename iiType>
+void FREAK_Impl::meanIntensities( const Mat& image, const Mat& integral,
+                                  const float kp_x, const float kp_y,
+                                  const unsigned int scale, const unsigned int rot,
+                                  imgType* values ) const
+{
+    const PatternPoint* points = &patternLookup[scale*FREAK_NB_ORIENTATION*FREAK_NB_POINTS + rot*FREAK_NB_POINTS];
+    int i = 0;
+#if CV_SIMD128
+    // box borders of 4 points at a time, the integral image is then sampled at their corners
+    const v_float32x4 v_kp_x = v_setall_f32(kp_x), v_kp_y = v_setall_f32(kp_y);
+    const v_float32x4 v_half = v_setall_f32(0.5f), v_one_half = v_setall_f32(1.5f);
+    CV_DECL_ALIGNED(16) int x_left[4], y_top[4], x_right[4], y_bottom[4];
+    for( ; i <= FREAK_NB_POINTS - 4; i += 4 )
+    {
+        v_float32x4 px, py, radius;
+        v_load_deinterleave(&points[i].x, px, py, radius);
+        // the smallest points are interpolated instead
+        if( v_check_any(radius < v_half) )
+            break;
+        v_float32x4 xf = px + v_kp_x, yf = py + v_kp_y;
+        v_store_aligned(x_left, v_trunc(xf - radius + v_half));
+        v_store_aligned(y_top, v_trunc(yf - radius + v_half));
+        v_store_aligned(x_right, v_trunc(xf + radius + v_one_half));
+        v_store_aligned(y_bottom, v_trunc(yf + radius + v_one_half));
+        for( int k = 0; k < 4; ++k )
+            values[i + k] = boxMean<imgType, iiType>(integral, x_left[k], y_top[k], x_right[k], y_bottom[k]);
+    }
+#endif
+    for( ; i < FREAK_NB_POINTS; ++i )
+        values[i] = meanIntensity<imgType, iiType>(image, integral, points[i], kp_x, kp_y);
 }
 
 // pair selection algorithm from a set of training images and corresponding keypoints
@@ -44,6 +44,7 @@
 //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <algorithm>
 #include <vector>
 
@@ -93,220 +94,111 @@ namespace cv
         void CalcuateSums(int count, const std::vector<int> &points, bool rotationInvariance, const Mat &grayImage, const KeyPoint &pt, int &suma, int &sumc, float cos_theta, float sin_theta, int half_ssd_size);
 
 
-        static void pixelTests1(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
+        // computes the descriptors of a range of keypoints, each bit compares the
+        // SSDs of the patches of one sampling triplet
+        class LATCHPixelTestsInvoker : public ParallelLoopBody
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
+        public:
+            LATCHPixelTestsInvoker(const Mat& _grayImage, const std::vector<KeyPoint>& _keypoints, Mat& _descriptors,
+                                   const std::vector<int>& _points, bool _rotationInvariance, int _half_ssd_size, int _bytes) :
+                grayImage(_grayImage), keypoints(_keypoints), descriptors(_descriptors), points(_points),
+                rotationInvariance(_rotationInvariance), half_ssd_size(_half_ssd_size), bytes(_bytes)
             {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 1; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
             }
-        }
-
 
-        static void pixelTests2(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
-        {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
+            void operator()(const Range& range) const
             {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 2; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
+                for (int i = range.start; i < range.end; ++i)
+                {
+                    uchar* desc = descriptors.ptr(i);
+                    const KeyPoint& pt = keypoints[i];
+                    int count = 0;
+
+                    //handling keypoint orientation
+                    float angle = pt.angle;
+                    angle *= (float)(CV_PI / 180.f);
+                    float cos_theta = cos(angle);
+                    float sin_theta = sin(angle);
+                    for (int ix = 0; ix < bytes; ix++){
+                        desc[ix] = 0;
+                        for (int j = 7; j >= 0; j--){
+
+                            int suma = 0;
+                            int sumc = 0;
+
+                            CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
+                            desc[ix] += (uchar)((suma < sumc) << j);
+
+                            count += 6;
+                        }
                     }
                 }
             }
-        }
 
+        private:
+            const Mat& grayImage;
+            const std::vector<KeyPoint>& keypoints;
+            Mat& descriptors;
+            const std::vector<int>& points;
+            bool rotationInvariance;
+            int half_ssd_size;
+            int bytes;
+        };
 
-        static void pixelTests4(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
+        template <int bytes>
+        static void pixelTests(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
         {
             Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 4; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
+            parallel_for_(Range(0, (int)keypoints.size()),
+                          LATCHPixelTestsInvoker(grayImage, keypoints, descriptors, points, rotationInvariance, half_ssd_size, bytes));
         }
 
-
-
-        static void pixelTests8(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
+        // sums of squared differences of the (2*K+1)x(2*K+1) patches a-b and c-b,
+        // the pointers are the top left corners of the patches
+        static inline void tripletSSD(const uchar* Mi_a, const uchar* Mi_b, const uchar* Mi_c, size_t step, int K, int &suma, int &sumc)
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
+            const int w = 2 * K + 1;
+#if CV_SIMD128
+            // the last row chunk is masked; the gray image is padded on
+            // the right so that the full 8 pixels loads stay inside of it
+            short mask_buf[8];
+            for (int k = 0; k < 8; k++)
+                mask_buf[k] = (short)((w & 7) == 0 || k < (w & 7) ? -1 : 0);
+            v_int16x8 v_mask = v_load(mask_buf);
+            const int wfull = (w - 1) & ~7;
+            v_int32x4 v_suma = v_setzero_s32(), v_sumc = v_setzero_s32();
+            for (int iy = 0; iy < w; iy++, Mi_a += step, Mi_b += step, Mi_c += step)
             {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 8; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
+                int ix = 0;
+                for (; ix < wfull; ix += 8)
+                {
+                    v_int16x8 pb = v_reinterpret_as_s16(v_load_expand(Mi_b + ix));
+                    v_int16x8 da = v_reinterpret_as_s16(v_load_expand(Mi_a + ix)) - pb;
+                    v_int16x8 dc = v_reinterpret_as_s16(v_load_expand(Mi_c + ix)) - pb;
+                    v_suma += v_dotprod(da, da);
+                    v_sumc += v_dotprod(dc, dc);
                 }
+                v_int16x8 pb = v_reinterpret_as_s16(v_load_expand(Mi_b + ix));
+                v_int16x8 da = (v_reinterpret_as_s16(v_load_expand(Mi_a + ix)) - pb) & v_mask;
+                v_int16x8 dc = (v_reinterpret_as_s16(v_load_expand(Mi_c + ix)) - pb) & v_mask;
+                v_suma += v_dotprod(da, da);
+                v_sumc += v_dotprod(dc, dc);
             }
-        }
-
-
-        static void pixelTests16(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
-        {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
+            suma += v_reduce_sum(v_suma);
+            sumc += v_reduce_sum(v_sumc);
+#else
+            for (int iy = 0; iy < w; iy++, Mi_a += step, Mi_b += step, Mi_c += step)
             {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 16; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
-        }
-
-
-        static void pixelTests32(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
-        {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 32; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
-        }
-
+                for (int ix = 0; ix < w; ix++)
+                {
+                    int difa = Mi_a[ix] - Mi_b[ix];
+                    suma += difa*difa;
 
-        static void pixelTests64(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
-        {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 64; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
+                    int difc = Mi_c[ix] - Mi_b[ix];
+                    sumc += difc*difc;
                 }
             }
+#endif
         }
 
         void CalcuateSums(int count, const std::vector<int> &points, bool rotationInvariance, const Mat &grayImage, const KeyPoint &pt, int &suma, int &sumc, float cos_theta, float sin_theta, int half_ssd_size)
@@ -383,22 +275,11 @@ namespace cv
 
 
             int K = half_ssd_size;
-            for (int iy = -K; iy <= K; iy++)
-            {
-                const uchar * Mi_a = grayImage.ptr<uchar>(ay2 + iy);
-                const uchar * Mi_b = grayImage.ptr<uchar>(by2 + iy);
-                const uchar * Mi_c = grayImage.ptr<uchar>(cy2 + iy);
-
-                for (int ix = -K; ix <= K; ix++)
-                {
-                    double difa = Mi_a[ax2 + ix] - Mi_b[bx2 + ix];
-                    suma += (int)((difa)*(difa));
-
-                    double difc = Mi_c[cx2 + ix] - Mi_b[bx2 + ix];
-                    sumc += (int)((difc)*(difc));
-                }
-            }
-
+            size_t step = grayImage.step;
+            tripletSSD(grayImage.ptr<uchar>(ay2 - K) + ax2 - K,
+                       grayImage.ptr<uchar>(by2 - K) + bx2 - K,
+                       grayImage.ptr<uchar>(cy2 - K) + cx2 - K,
+                       step, K, suma, sumc);
         }
 
 
@@ -409,25 +290,25 @@ namespace cv
             switch (bytes)
             {
             case 1:
-                test_fn_ = pixelTests1;
+                test_fn_ = pixelTests<1>;
                 break;
             case 2:
-                test_fn_ = pixelTests2;
+                test_fn_ = pixelTests<2>;
                 break;
             case 4:
-                test_fn_ = pixelTests4;
+                test_fn_ = pixelTests<4>;
                 break;
             case 8:
-                test_fn_ = pixelTests8;
+                test_fn_ = pixelTests<8>;
                 break;
             case 16:
-                test_fn_ = pixelTests16;
+                test_fn_ = pixelTests<16>;
                 break;
             case 32:
-                test_fn_ = pixelTests32;
+                test_fn_ = pixelTests<32>;
                 break;
             case 64:
-                test_fn_ = pixelTests64;
+                test_fn_ = pixelTests<64>;
                 break;
             default:
                 CV_Error(Error::StsBadArg, "descriptorSize must be 1,2, 4, 8, 16, 32, or 64");
@@ -457,25 +338,25 @@ namespace cv
             switch (dSize)
             {
             case 1:
-                test_fn_ = pixelTests1;
+                test_fn_ = pixelTests<1>;
                 break;
             case 2:
-                test_fn_ = pixelTests2;
+                test_fn_ = pixelTests<2>;
                 break;
             case 4:
-                test_fn_ = pixelTests4;
+                test_fn_ = pixelTests<4>;
                 break;
             case 8:
-                test_fn_ = pixelTests8;
+                test_fn_ = pixelTests<8>;
                 break;
             case 16:
-                test_fn_ = pixelTests16;
+                test_fn_ = pixelTests<16>;
                 break;
             case 32:
-                test_fn_ = pixelTests32;
+                test_fn_ = pixelTests<32>;
                 break;
             case 64:
-                test_fn_ = pixelTests64;
+                test_fn_ = pixelTests<64>;
                 break;
             default:
                 CV_Error(Error::StsBadArg, "descriptorSize must be 1,2, 4, 8, 16, 32, or 64");
@@ -501,10 +382,13 @@ namespace cv
                 return;
 
 
-            Mat grayImage;
-            GaussianBlur(image, grayImage, cv::Size(3, 3), 2, 2);
-
-            if (image.type() != CV_8U) cvtColor(image, grayImage, COLOR_BGR2GRAY);
+            // the gray image is padded on the right for the vectorized SSDs
+            Mat grayBuffer(image.rows, image.cols + 8, CV_8U);
+            Mat grayImage = grayBuffer.colRange(0, image.cols);
+            if (image.type() != CV_8U)
+                cvtColor(image, grayImage, COLOR_BGR2GRAY);
+            else
+                GaussianBlur(image, grayImage, cv::Size(3, 3), 2, 2);
 
 
 
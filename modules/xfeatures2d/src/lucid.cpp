@@ -47,6 +47,7 @@ the use of this software, even if advised of the possibility of such damage.
 */
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv {
     namespace xfeatures2d {
@@ -97,6 +98,83 @@ namespace cv {
             return NORM_HAMMING;
         }
 
+        /** sorts the m values of a descriptor in place; ties keep no order since only the values are output */
+        static void sortDescriptor(uchar* desc, int m, ushort* keys) {
+#if CV_SIMD128
+            // rank every value against all the others, 8 ranks at a time; a key holds the value and its index,
+            // so equal values get distinct ranks and the ranks form a permutation
+            if (m <= 128) {
+                int n = (m + 7) & ~7, i, j;
+                for (i = 0; i < m; ++i)
+                    keys[i] = (ushort)((desc[i] << 7) | i);
+                for (; i < n; ++i)
+                    keys[i] = (ushort)0xFFFF;
+
+                const v_uint16x8 one = v_setall_u16(1);
+                CV_DECL_ALIGNED(16) ushort rank[8];
+                for (i = 0; i < m; i += 8) {
+                    v_uint16x8 v = v_load(keys + i), cnt = v_setzero_u16();
+                    for (j = 0; j < m; ++j)
+                        cnt += (v_setall_u16(keys[j]) < v) & one;
+                    v_store_aligned(rank, cnt);
+                    for (int k = 0; k < 8 && i + k < m; ++k)
+                        desc[rank[k]] = (uchar)(keys[i + k] >> 7);
+                }
+                return;
+            }
+#else
+            (void)keys;
+#endif
+            int hist[256] = {0};
+            for (int i = 0; i < m; ++i)
+                ++hist[desc[i]];
+            for (int v = 0, i = 0; i < m; ++v)
+                for (int c = hist[v]; c > 0; --c)
+                    desc[i++] = (uchar)v;
+        }
+
+        class LUCIDInvoker : public ParallelLoopBody {
+            public:
+                LUCIDInvoker(const Mat_<Vec3b>& _src, const std::vector<KeyPoint>& _keypoints, Mat_<uchar>& _desc, int _l_kernel) :
+                    src(_src), keypoints(_keypoints), desc(_desc), l_kernel(_l_kernel) {
+                }
+
+                void operator()(const Range& range) const {
+                    int side = l_kernel*2+1, m = desc.cols, width = src.cols, height = src.rows;
+                    AutoBuffer<ushort> keys((m + 7) & ~7);
+
+                    for (int i = range.start; i < range.end; ++i) {
+                        int x = static_cast<int>(keypoints[i].pt.x)-l_kernel, y = static_cast<int>(keypoints[i].pt.y)-l_kernel;
+                        uchar* d = desc.ptr(i);
+
+                        for (int r = 0; r < side; ++r, d += side*3) {
+                            int yy = y+r;
+                            const Vec3b* row = src[yy < 0 ? height+yy : yy >= height ? yy-height : yy];
+
+                            if (x >= 0 && x+side <= width)
+                                memcpy(d, row+x, side*3);
+                            else {
+                                for (int c = 0; c < side; ++c) {
+                                    int xx = x+c;
+                                    const Vec3b& pix = row[xx < 0 ? width+xx : xx >= width ? xx-width : xx];
+                                    d[c*3] = pix[0];
+                                    d[c*3+1] = pix[1];
+                                    d[c*3+2] = pix[2];
+                                }
+                            }
+                        }
+
+                        sortDescriptor(desc.ptr(i), m, keys);
+                    }
+                }
+
+            private:
+                const Mat_<Vec3b>& src;
+                const std::vector<KeyPoint>& keypoints;
+                Mat_<uchar>& desc;
+                int l_kernel;
+        };
+
         // gliese581h suggested filling a cv::Mat with descriptors to enable BFmatcher compatibility
         // speed-ups and enhancements by gliese581h
         void LUCIDImpl::compute(InputArray _src, std::vector<KeyPoint> &keypoints, OutputArray _desc) {
@@ -105,38 +183,19 @@ namespace cv {
                 return;
             CV_Assert(src_input.depth() == CV_8U && src_input.channels() == 3);
 
+            if (!_desc.needed())
+                return;
+
             Mat_<Vec3b> src;
 
             blur(src_input, src, cv::Size(b_kernel, b_kernel));
 
-            int x, y, j, d, p, m = (l_kernel*2+1)*(l_kernel*2+1)*3, width = src.cols, height = src.rows, r, c;
-
-            Mat_<uchar> desc(static_cast<int>(keypoints.size()), m);
-
-            for (std::size_t i = 0; i < keypoints.size(); ++i) {
-                x = static_cast<int>(keypoints[i].pt.x)-l_kernel, y = static_cast<int>(keypoints[i].pt.y)-l_kernel, d = x+2*l_kernel, p = y+2*l_kernel, j = x, r = static_cast<int>(i), c = 0;
+            int m = (l_kernel*2+1)*(l_kernel*2+1)*3;
 
-                while (x <= d) {
-                    Vec3b &pix = src((y < 0 ? height+y : y >= height ? y-height : y), (x < 0 ? width+x : x >= width ? x-width : x));
-
-                    desc(r, c++) = pix[0];
-                    desc(r, c++) = pix[1];
-                    desc(r, c++) = pix[2];
-
-                    ++x;
-                    if (x > d) {
-                        if (y < p) {
-                            ++y;
-                            x = j;
-                        }
-                        else
-                            break;
-                    }
-                }
-            }
+            _desc.create(static_cast<int>(keypoints.size()), m, CV_8U);
+            Mat_<uchar> desc = _desc.getMat();
 
-            if (_desc.needed())
-                sort(desc, _desc, SORT_EVERY_ROW | SORT_ASCENDING);
+            parallel_for_(Range(0, static_cast<int>(keypoints.size())), LUCIDInvoker(src, keypoints, desc, l_kernel));
         }
     }
 } // END NAMESPACE CV
@@ -55,6 +55,7 @@ University of Bologna, Open Perception
  */
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <limits>
 
 namespace cv
@@ -135,46 +136,43 @@ namespace cv
         {
         public:
 
-            // Multi-threaded contextualSelfDissimilarity method
+            // Multi-threaded contextualSelfDissimilarity method, over column chunks of all the pyramid levels
             struct MSDSelfDissimilarityScan : ParallelLoopBody
             {
 
-                MSDSelfDissimilarityScan(MSDDetector_Impl& _detector, std::vector< std::vector<float> >* _saliency, cv::Mat& _img, int _level, int _border, int _split)
+                MSDSelfDissimilarityScan(const MSDDetector_Impl& _detector, std::vector< std::vector<float> >* _saliency, const std::vector<cv::Mat>& _scaleSpace, int _border, int _split)
                 {
                     detector = &_detector;
                     saliency = _saliency;
-                    img = &_img;
+                    scaleSpace = &_scaleSpace;
                     split = _split;
-                    level = _level;
                     border = _border;
-                    int w = img->cols - border * 2;
-                    chunkSize = w / split;
-                    remains = w - chunkSize*split;
                 }
 
                 void operator()(const Range& range) const
                 {
                     for (int i = range.start; i < range.end; i++)
                     {
-                        int start = border + i*chunkSize;
-                        int end = border + (i + 1) * chunkSize;
-                        if (remains > 0)
-                            if (i == split - 1)
-                            {
-                                end = img->cols - border;
-                            }
-                        detector->contextualSelfDissimilarity(*img, start, end, &saliency->at(level)[0]);
+                        int level = i / split;
+                        int chunk = i % split;
+                        const cv::Mat& img = (*scaleSpace)[level];
+                        int w = img.cols - border * 2;
+                        if (w <= 0 || img.rows <= border * 2)
+                            continue;
+                        int chunkSize = w / split;
+                        int start = border + chunk * chunkSize;
+                        int end = border + (chunk + 1) * chunkSize;
+                        if (chunk == split - 1)
+                            end = img.cols - border;
+                        detector->contextualSelfDissimilarity(img, start, end, &saliency->at(level)[0]);
                     }
                 }
 
-                MSDDetector_Impl* detector;
+                const MSDDetector_Impl* detector;
                 std::vector< std::vector<float> >* saliency;
-                cv::Mat* img;
-                int level;
+                const std::vector<cv::Mat>* scaleSpace;
                 int split;
                 int border;
-                int chunkSize;
-                int remains;
             };
 
             /**
@@ -230,11 +228,9 @@ namespace cv
                     fill(saliency[r].begin(), saliency[r].end(), 0.0f);
                 }
 
-                for (int r = 0; r < m_cur_n_scales; r++)
-                {
-                    int steps = cv::getNumThreads();
-                    parallel_for_(Range(0, steps), MSDSelfDissimilarityScan((*this), &saliency, m_scaleSpace[r], r, border, steps));
-                }
+                // all the levels are scanned at once, so the threads stay busy on the small ones
+                int steps = cv::getNumThreads();
+                parallel_for_(Range(0, m_cur_n_scales * steps), MSDSelfDissimilarityScan((*this), &saliency, m_scaleSpace, border, steps));
 
                 nonMaximaSuppression(saliency, keypoints);
 
@@ -278,22 +274,6 @@ namespace cv
             // Input binary mask
             cv::Mat m_mask;
 
-            /**
-             * Computes the normalized average value of input vector
-             * @param minVals input vector
-             * @param den normalization factor (pre-multiplied by the number of elements of the input vector, assumed constant)
-             * @return normalized average value
-             */
-            inline float computeAvgDistance(std::vector<int> &minVals, int den)
-            {
-                float avg_dist = 0.0f;
-                for (unsigned int i = 0; i < minVals.size(); i++)
-                    avg_dist += minVals[i];
-
-                avg_dist /= den;
-                return avg_dist;
-            }
-
             /**
              * Computer the Contextual Self-Dissimilarity (CSD, [1]) for a specific range of image pixels (row-wise)
              * @param img input image
@@ -301,7 +281,7 @@ namespace cv
              * @param xmax right-most range limit for the image pixels being processed
              * @param saliency output array being filled with the CSD value computed at each input pixel
              */
-            void contextualSelfDissimilarity(cv::Mat &img, int xmin, int xmax, float* saliency);
+            void contextualSelfDissimilarity(const cv::Mat &img, int xmin, int xmax, float* saliency) const;
 
             /**
              * Associates a canonical orientation (computed as in [1]) to each extracted key-point
@@ -383,7 +363,7 @@ namespace cv
             return true;
         }
 
-        void MSDDetector_Impl::contextualSelfDissimilarity(cv::Mat &img, int xmin, int xmax, float* saliency)
+        void MSDDetector_Impl::contextualSelfDissimilarity(const cv::Mat &img, int xmin, int xmax, float* saliency) const
         {
             int r_s = m_patch_radius;
             int r_b = m_search_area_radius;
@@ -395,194 +375,129 @@ namespace cv
             int side_s = 2 * r_s + 1;
             int side_b = 2 * r_b + 1;
             int border = r_s + r_b;
-            int temp;
             int den = side_s * side_s * k;
 
-            std::vector<int> minVals(k);
-            int *acc = new int[side_b * side_b];
-            int **vCol = new int *[w];
-            for (int i = 0; i < w; i++)
-                vCol[i] = new int[side_b * side_b];
-
-            //first position
-            int x = xmin;
-            int y = border;
-
-            int ctrInd = 0;
-            for (int kk = 0; kk < k; kk++)
-                minVals[kk] = std::numeric_limits<int>::max();
-
-            for (int j = y - r_b; j <= y + r_b; j++)
+            int nx = xmax - xmin;
+            if (nx <= 0 || k <= 0)
+                return;
+
+            // offsets of the search area, the center excluded
+            std::vector<cv::Point> offsets;
+            offsets.reserve(side_b * side_b - 1);
+            for (int dj = -r_b; dj <= r_b; dj++)
+                for (int di = -r_b; di <= r_b; di++)
+                    if (di != 0 || dj != 0)
+                        offsets.push_back(cv::Point(di, dj));
+            int nOffsets = (int) offsets.size();
+
+            // columns covered by the patches of the range
+            int cmin = xmin - r_s;
+            int ncols = nx + 2 * r_s;
+
+            // For each offset, vertical sums over the patch rows of the squared differences between the
+            // image and its shifted copy, one per column. They slide down by one row at a time, and the
+            // patch SSDs of a row of pixels are the horizontal sums of side_s of them.
+            cv::AutoBuffer<int> _colSums(nOffsets * ncols);
+            // k smallest SSDs of each pixel of the row, sorted, minVals[kk * nx + x]
+            cv::AutoBuffer<int> _minVals(k * nx);
+            int* colSums = _colSums;
+            int* minVals = _minVals;
+
+            for (int y = border; y < h - border; y++)
             {
+                for (int i = 0; i < k * nx; i++)
+                    minVals[i] = std::numeric_limits<int>::max();
 
-                for (int i = x - r_b; i <= x + r_b; i++)
+                for (int o = 0; o < nOffsets; o++)
                 {
-                    if (j == y && i == x)
-                        continue;
+                    int di = offsets[o].x, dj = offsets[o].y;
+                    int* col = colSums + o * ncols;
 
-                    acc[ctrInd] = 0;
-                    for (int u = -r_s; u <= r_s; u++)
+                    if (y == border)
                     {
-                        vCol[x + u][ctrInd] = 0;
+                        // first row, full vertical sums
+                        for (int c = 0; c < ncols; c++)
+                            col[c] = 0;
                         for (int v = -r_s; v <= r_s; v++)
                         {
-
-                            temp = img.at<unsigned char>(j + v, i + u) - img.at<unsigned char>(y + v, x + u);
-                            vCol[x + u][ctrInd] += (temp * temp);
-                        }
-                        acc[ctrInd] += vCol[x + u][ctrInd];
-                    }
-
-                    if (acc[ctrInd] < minVals[k - 1])
-                    {
-                        minVals[k - 1] = acc[ctrInd];
-
-                        for (int kk = k - 2; kk >= 0; kk--)
-                        {
-                            if (minVals[kk] > minVals[kk + 1])
+                            const uchar* ref = img.ptr<uchar>(y + v) + cmin;
+                            const uchar* shifted = img.ptr<uchar>(y + v + dj) + cmin + di;
+                            for (int c = 0; c < ncols; c++)
                             {
-                                std::swap(minVals[kk], minVals[kk + 1]);
-                            } else
-                                break;
+                                int temp = shifted[c] - ref[c];
+                                col[c] += temp * temp;
+                            }
                         }
                     }
-
-                    ctrInd++;
-                }
-            }
-            saliency[y * w + x] = computeAvgDistance(minVals, den);
-
-            for (x = xmin + 1; x < xmax; x++)
-            {
-                ctrInd = 0;
-                for (int kk = 0; kk < k; kk++)
-                    minVals[kk] = std::numeric_limits<int>::max();
-
-                for (int j = y - r_b; j <= y + r_b; j++)
-                {
-                    for (int i = x - r_b; i <= x + r_b; i++)
+                    else
                     {
-                        if (j == y && i == x)
-                            continue;
-
-                        vCol[x + r_s][ctrInd] = 0;
-                        for (int v = -r_s; v <= r_s; v++)
+                        // add the row entering the patches, remove the one leaving them
+                        const uchar* refIn = img.ptr<uchar>(y + r_s) + cmin;
+                        const uchar* shiftedIn = img.ptr<uchar>(y + r_s + dj) + cmin + di;
+                        const uchar* refOut = img.ptr<uchar>(y - r_s - 1) + cmin;
+                        const uchar* shiftedOut = img.ptr<uchar>(y - r_s - 1 + dj) + cmin + di;
+                        int c = 0;
+#if CV_SIMD128
+                        for (; c <= ncols - 8; c += 8)
                         {
-                            temp = img.at<unsigned char>(j + v, i + r_s) - img.at<unsigned char>(y + v, x + r_s);
-                            vCol[x + r_s][ctrInd] += (temp * temp);
+                            v_int16x8 dIn = v_reinterpret_as_s16(v_load_expand(shiftedIn + c)) - v_reinterpret_as_s16(v_load_expand(refIn + c));
+                            v_int16x8 dOut = v_reinterpret_as_s16(v_load_expand(shiftedOut + c)) - v_reinterpret_as_s16(v_load_expand(refOut + c));
+                            // dIn^2 - dOut^2 of each column as a dot product of interleaved pairs
+                            v_int16x8 a0, a1, b0, b1;
+                            v_zip(dIn, dOut, a0, a1);
+                            v_zip(dIn, v_setzero_s16() - dOut, b0, b1);
+                            v_store(col + c, v_load(col + c) + v_dotprod(a0, b0));
+                            v_store(col + c + 4, v_load(col + c + 4) + v_dotprod(a1, b1));
                         }
-
-                        acc[ctrInd] = acc[ctrInd] + vCol[x + r_s][ctrInd] - vCol[x - r_s - 1][ctrInd];
-
-                        if (acc[ctrInd] < minVals[k - 1])
+#endif
+                        for (; c < ncols; c++)
                         {
-                            minVals[k - 1] = acc[ctrInd];
-                            for (int kk = k - 2; kk >= 0; kk--)
-                            {
-                                if (minVals[kk] > minVals[kk + 1])
-                                {
-                                    std::swap(minVals[kk], minVals[kk + 1]);
-                                } else
-                                    break;
-                            }
+                            int tIn = shiftedIn[c] - refIn[c];
+                            int tOut = shiftedOut[c] - refOut[c];
+                            col[c] += tIn * tIn - tOut * tOut;
                         }
-
-                        ctrInd++;
                     }
-                }
-                saliency[y * w + x] = computeAvgDistance(minVals, den);
-            }
-
-            for (y = border + 1; y < h - border; y++)
-            {
-                ctrInd = 0;
-                for (int kk = 0; kk < k; kk++)
-                    minVals[kk] = std::numeric_limits<int>::max();
-                x = xmin;
 
-                for (int j = y - r_b; j <= y + r_b; j++)
-                {
-                    for (int i = x - r_b; i <= x + r_b; i++)
+                    // patch SSDs of the row, inserted into the sorted k smallest ones of each pixel
+                    int x = 0;
+#if CV_SIMD128
+                    for (; x <= nx - 4; x += 4)
                     {
-                        if (j == y && i == x)
-                            continue;
-
-                        acc[ctrInd] = 0;
-                        for (int u = -r_s; u <= r_s; u++)
+                        v_int32x4 ssd = v_load(col + x);
+                        for (int u = 1; u < side_s; u++)
+                            ssd += v_load(col + x + u);
+                        for (int kk = 0; kk < k; kk++)
                         {
-                            temp = img.at<unsigned char>(j + r_s, i + u) - img.at<unsigned char>(y + r_s, x + u);
-                            vCol[x + u][ctrInd] += (temp * temp);
-
-                            temp = img.at<unsigned char>(j - r_s - 1, i + u) - img.at<unsigned char>(y - r_s - 1, x + u);
-                            vCol[x + u][ctrInd] -= (temp * temp);
-
-                            acc[ctrInd] += vCol[x + u][ctrInd];
+                            v_int32x4 m = v_load(minVals + kk * nx + x);
+                            v_store(minVals + kk * nx + x, v_min(m, ssd));
+                            ssd = v_max(m, ssd);
                         }
-
-                        if (acc[ctrInd] < minVals[k - 1])
+                    }
+#endif
+                    for (; x < nx; x++)
+                    {
+                        int ssd = col[x];
+                        for (int u = 1; u < side_s; u++)
+                            ssd += col[x + u];
+                        for (int kk = 0; kk < k; kk++)
                         {
-                            minVals[k - 1] = acc[ctrInd];
-
-                            for (int kk = k - 2; kk >= 0; kk--)
-                            {
-                                if (minVals[kk] > minVals[kk + 1])
-                                {
-                                    std::swap(minVals[kk], minVals[kk + 1]);
-                                } else
-                                    break;
-                            }
+                            int& m = minVals[kk * nx + x];
+                            if (ssd < m)
+                                std::swap(m, ssd);
                         }
-
-                        ctrInd++;
                     }
                 }
-                saliency[y * w + x] = computeAvgDistance(minVals, den);
 
-                for (x = xmin + 1; x < xmax; x++)
+                // normalized average of the k smallest SSDs
+                float* saliency_y = saliency + y * w + xmin;
+                for (int x = 0; x < nx; x++)
                 {
-                    ctrInd = 0;
+                    float avg_dist = 0.0f;
                     for (int kk = 0; kk < k; kk++)
-                        minVals[kk] = std::numeric_limits<int>::max();
-
-                    for (int j = y - r_b; j <= y + r_b; j++)
-                    {
-                        for (int i = x - r_b; i <= x + r_b; i++)
-                        {
-                            if (j == y && i == x)
-                                continue;
-
-                            temp = img.at<unsigned char>(j + r_s, i + r_s) - img.at<unsigned char>(y + r_s, x + r_s);
-                            vCol[x + r_s][ctrInd] += (temp * temp);
-
-                            temp = img.at<unsigned char>(j - r_s - 1, i + r_s) - img.at<unsigned char>(y - r_s - 1, x + r_s);
-                            vCol[x + r_s][ctrInd] -= (temp * temp);
-
-                            acc[ctrInd] = acc[ctrInd] + vCol[x + r_s][ctrInd] - vCol[x - r_s - 1][ctrInd];
-
-                            if (acc[ctrInd] < minVals[k - 1])
-                            {
-                                minVals[k - 1] = acc[ctrInd];
-
-                                for (int kk = k - 2; kk >= 0; kk--)
-                                {
-                                    if (minVals[kk] > minVals[kk + 1])
-                                    {
-                                        std::swap(minVals[kk], minVals[kk + 1]);
-                                    } else
-                                        break;
-                                }
-                            }
-                            ctrInd++;
-                        }
-                    }
-                    saliency[y * w + x] = computeAvgDistance(minVals, den);
+                        avg_dist += minVals[kk * nx + x];
+                    saliency_y[x] = avg_dist / den;
                 }
             }
-
-            for (int i = 0; i < w; i++)
-                delete[] vCol[i];
-            delete[] vCol;
-            delete[] acc;
         }
 
         float MSDDetector_Impl::computeOrientation(cv::Mat &img, int x, int y, std::vector<cv::Point2f> circle)
@@ -68,6 +68,227 @@ namespace cv
     {
         namespace pct_signatures
         {
+            /**
+            * @brief Uniform grid over the spatial coordinates (X_IDX, Y_IDX) of cluster centroids.
+            *       For all supported distance functions except L_INFINITY, the distance of two points
+            *       is at least a function of the difference of any single coordinate, so the cells far
+            *       enough from the point can be skipped in the nearest centroid search without changing
+            *       its result.
+            */
+            class ClusterGrid
+            {
+            public:
+                ClusterGrid() : mGridSize(0) {}
+
+                /**
+                * @brief Builds the grid over the cluster centroids.
+                *       The grid is not used (brute-force search is performed instead) for small numbers
+                *       of clusters and for the distance functions without a spatial bound.
+                */
+                void build(const Mat& clusters, int distanceFunction)
+                {
+                    mDistanceFunction = distanceFunction;
+                    mGridSize = 0;
+                    if (clusters.rows < MIN_CLUSTERS || distanceFunction == PCTSignatures::L_INFINITY)
+                    {
+                        return;
+                    }
+
+                    mMinX = mMaxX = clusters.at<float>(0, X_IDX);
+                    mMinY = mMaxY = clusters.at<float>(0, Y_IDX);
+                    for (int i = 1; i < clusters.rows; i++)
+                    {
+                        mMinX = std::min(mMinX, clusters.at<float>(i, X_IDX));
+                        mMaxX = std::max(mMaxX, clusters.at<float>(i, X_IDX));
+                        mMinY = std::min(mMinY, clusters.at<float>(i, Y_IDX));
+                        mMaxY = std::max(mMaxY, clusters.at<float>(i, Y_IDX));
+                    }
+                    mCellSize = std::max(mMaxX - mMinX, mMaxY - mMinY);
+                    if (!(mCellSize > 0))
+                    {
+                        return;
+                    }
+
+                    // about CLUSTERS_PER_CELL centroids in each cell of uniformly distributed clusters
+                    mGridSize = std::max(1, cvRound(std::sqrt((double)clusters.rows / CLUSTERS_PER_CELL)));
+                    mCellSize /= mGridSize;
+
+                    // counting sort of the clusters by their cells
+                    std::vector<int> cells(clusters.rows);
+                    mCellStart.assign(mGridSize * mGridSize + 1, 0);
+                    for (int i = 0; i < clusters.rows; i++)
+                    {
+                        cells[i] = cellY(clusters.at<float>(i, Y_IDX)) * mGridSize + cellX(clusters.at<float>(i, X_IDX));
+                        mCellStart[cells[i] + 1]++;
+                    }
+                    for (size_t c = 1; c < mCellStart.size(); c++)
+                    {
+                        mCellStart[c] += mCellStart[c - 1];
+                    }
+                    std::vector<int> fill(mCellStart.begin(), mCellStart.end() - 1);
+                    mCellItems.resize(clusters.rows);
+                    for (int i = 0; i < clusters.rows; i++)
+                    {
+                        mCellItems[fill[cells[i]]++] = i;
+                    }
+                }
+
+                /**
+                * @brief Find closest cluster to selected point.
+                *       Ties are resolved by the lower cluster index, as in the brute-force search.
+                * @param clusters List of cluster centroids (the one used to build the grid).
+                * @param points List of points.
+                * @param pointIdx Index to the list of points.
+                * @return Index to clusters list pointing at the closest cluster.
+                */
+                int findClosestCluster(const Mat& clusters, const Mat& points, const int pointIdx) const
+                {
+                    int iClosest = 0;
+                    float minDistance = computeDistance(mDistanceFunction, clusters, 0, points, pointIdx);
+
+                    if (mGridSize == 0)
+                    {
+                        for (int iCluster = 1; iCluster < clusters.rows; iCluster++)
+                        {
+                            float distance = computeDistance(mDistanceFunction, clusters, iCluster, points, pointIdx);
+                            if (distance < minDistance)
+                            {
+                                iClosest = iCluster;
+                                minDistance = distance;
+                            }
+                        }
+                        return iClosest;
+                    }
+
+                    const int cx = cellX(points.at<float>(pointIdx, X_IDX));
+                    const int cy = cellY(points.at<float>(pointIdx, Y_IDX));
+
+                    // visit rings of cells around the cell of the point
+                    for (int ring = 0; ring < mGridSize; ring++)
+                    {
+                        // all the unvisited centroids differ at least by (ring - 1) cells in x or y
+                        if (ring > 1 && distanceBound((ring - 1) * mCellSize) > minDistance)
+                        {
+                            break;
+                        }
+                        for (int y = std::max(cy - ring, 0); y <= std::min(cy + ring, mGridSize - 1); y++)
+                        {
+                            const bool border = (y == cy - ring || y == cy + ring);
+                            const int step = border ? 1 : 2 * ring;
+                            for (int x = cx - ring; x <= cx + ring; x += step)
+                            {
+                                if (x < 0 || x >= mGridSize)
+                                {
+                                    continue;
+                                }
+                                const int cell = y * mGridSize + x;
+                                for (int k = mCellStart[cell]; k < mCellStart[cell + 1]; k++)
+                                {
+                                    const int iCluster = mCellItems[k];
+                                    float distance = computeDistance(mDistanceFunction, clusters, iCluster, points, pointIdx);
+                                    if (distance < minDistance || (distance == minDistance && iCluster < iClosest))
+                                    {
+                                        iClosest = iCluster;
+                                        minDistance = distance;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                    return iClosest;
+                }
+
+            private:
+                static const int MIN_CLUSTERS = 32;
+                static const int CLUSTERS_PER_CELL = 4;
+
+                int cellX(float x) const
+                {
+                    return std::min(std::max((int)((x - mMinX) / mCellSize), 0), mGridSize - 1);
+                }
+
+                int cellY(float y) const
+                {
+                    return std::min(std::max((int)((y - mMinY) / mCellSize), 0), mGridSize - 1);
+                }
+
+                /**
+                * @brief Lower bound of the distance of two points that differ by d in one coordinate.
+                *       The bound is slightly reduced to stay valid under floating point rounding.
+                */
+                float distanceBound(float d) const
+                {
+                    d *= 0.999f;
+                    return mDistanceFunction == PCTSignatures::L2SQUARED ? d * d : d;
+                }
+
+                int mDistanceFunction;
+                int mGridSize;
+                float mMinX, mMaxX, mMinY, mMaxY;
+                float mCellSize;
+                std::vector<int> mCellStart;
+                std::vector<int> mCellItems;
+            };
+
+
+            /**
+            * @brief Number of samples in one chunk of the parallel assignment step.
+            *       The chunks do not depend on the number of threads, so the result is deterministic.
+            */
+            const int CLUSTERIZER_CHUNK_SIZE = 256;
+
+
+            /**
+            * @brief Class implementing parallel assignment of samples to the closest clusters.
+            *       Each chunk of samples sums the coordinates and counts of its samples for each cluster,
+            *       the sums of the chunks are reduced afterwards.
+            */
+            class Parallel_assignSamples : public ParallelLoopBody
+            {
+            private:
+                const ClusterGrid* mGrid;
+                const Mat* mClusters;
+                const Mat* mSamples;
+                std::vector<Mat>* mChunkSums;
+
+            public:
+                Parallel_assignSamples(
+                    const ClusterGrid* grid,
+                    const Mat* clusters,
+                    const Mat* samples,
+                    std::vector<Mat>* chunkSums)
+                    : mGrid(grid),
+                    mClusters(clusters),
+                    mSamples(samples),
+                    mChunkSums(chunkSums)
+                {
+                }
+
+                void operator()(const Range& range) const
+                {
+                    for (int chunk = range.start; chunk < range.end; chunk++)
+                    {
+                        Mat& sums = (*mChunkSums)[chunk];
+                        sums.create(mClusters->size(), CV_32F);
+                        sums = 0;
+
+                        const int end = std::min((chunk + 1) * CLUSTERIZER_CHUNK_SIZE, mSamples->rows);
+                        for (int iSample = chunk * CLUSTERIZER_CHUNK_SIZE; iSample < end; iSample++)
+                        {
+                            int iClosest = mGrid->findClosestCluster(*mClusters, *mSamples, iSample);
+                            const float* sample = mSamples->ptr<float>(iSample);
+                            float* sum = sums.ptr<float>(iClosest);
+                            for (int iDimension = 1; iDimension < SIGNATURE_DIMENSION; iDimension++)
+                            {
+                                sum[iDimension] += sample[iDimension];
+                            }
+                            sum[WEIGHT_IDX]++;
+                        }
+                    }
+                }
+            };
+
+
             class PCTClusterizer_Impl : public PCTClusterizer
             {
             public:
@@ -141,26 +362,30 @@ namespace cv
                     dropLightPoints(clusters);
 
 
+                    ClusterGrid grid;
+                    std::vector<Mat> chunkSums;
+
                     // Main iterations cycle. Our implementation has fixed number of iterations.
                     for (int iteration = 0; iteration < mIterationCount; iteration++)
                     {
-                        // Prepare space for new centroid values.
-                        Mat tmpCentroids(clusters.size(), clusters.type());
-                        tmpCentroids = 0;
-
-                        // Clear weights for new iteration.
-                        clusters(Rect(WEIGHT_IDX, 0, 1, clusters.rows)) = 0;
+                        if (clusters.rows == 0)
+                        {
+                            break;
+                        }
 
                         // Compute affiliation of points and sum new coordinates for centroids.
-                        for (int iSample = 0; iSample < samples.rows; iSample++)
+                        grid.build(clusters, mDistanceFunction);
+                        const int chunks = (samples.rows + CLUSTERIZER_CHUNK_SIZE - 1) / CLUSTERIZER_CHUNK_SIZE;
+                        chunkSums.resize(chunks);
+                        parallel_for_(Range(0, chunks), Parallel_assignSamples(&grid, &clusters, &samples, &chunkSums));
+
+                        // Reduce the sums of the chunks, the weights of the clusters are the counts of their points.
+                        Mat tmpCentroids = chunkSums[0];
+                        for (int chunk = 1; chunk < chunks; chunk++)
                         {
-                            int iClosest = findClosestCluster(clusters, samples, iSample);
-                            for (int iDimension = 1; iDimension < SIGNATURE_DIMENSION; iDimension++)
-                            {
-                                tmpCentroids.at<float>(iClosest, iDimension) += samples.at<float>(iSample, iDimension);
-                            }
-                            clusters.at<float>(iClosest, WEIGHT_IDX)++;
+                            tmpCentroids += chunkSums[chunk];
                         }
+                        tmpCentroids(Rect(WEIGHT_IDX, 0, 1, clusters.rows)).copyTo(clusters(Rect(WEIGHT_IDX, 0, 1, clusters.rows)));
 
                         // Compute average from tmp coordinates and throw away too small clusters.
                         int lastIdx = 0;
@@ -269,31 +494,6 @@ namespace cv
                 }
 
 
-                /**
-                * @brief Find closest cluster to selected point.
-                * @param clusters List of cluster centroids.
-                * @param points List of points.
-                * @param pointIdx Index to the list of points (the point for which the closest cluster is being found).
-                * @return Index to clusters list pointing at the closest cluster.
-                */
-                int findClosestCluster(const Mat& clusters, const Mat& points, const int pointIdx) const    // HOT PATH: 35%
-                {
-                    int iClosest = 0;
-                    float minDistance = computeDistance(mDistanceFunction, clusters, 0, points, pointIdx);
-
-                    for (int iCluster = 1; iCluster < clusters.rows; iCluster++)
-                    {
-                        float distance = computeDistance(mDistanceFunction, clusters, iCluster, points, pointIdx);
-                        if (distance < minDistance)
-                        {
-                            iClosest = iCluster;
-                            minDistance = distance;
-                        }
-                    }
-                    return iClosest;
-                }
-
-
                 /**
                 * @brief Make sure that the number of clusters does not exceed maxClusters parameter.
                 *       If it does, the clusters are sorted by their weights and the smallest clusters
@@ -0,0 +1,273 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef _OPENCV_XFEATURES_2D_PCT_SIGNATURES_SIGNATURE_BLOCK_HPP_
+#define _OPENCV_XFEATURES_2D_PCT_SIGNATURES_SIGNATURE_BLOCK_HPP_
+
+#ifdef __cplusplus
+
+#include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+#include "constants.hpp"
+
+namespace cv
+{
+    namespace xfeatures2d
+    {
+        namespace pct_signatures
+        {
+            /**
+            * @brief Number of centroids processed together by the block similarity kernels.
+            */
+            const int SIGNATURE_BLOCK_WIDTH = 4;
+
+            /**
+            * @brief Signature stored as structure of arrays.
+            *       Row d of the data contains the d-th column of the signature (row 0 contains weights),
+            *       the number of columns is rounded up to SIGNATURE_BLOCK_WIDTH
+            *       and the padding centroids are zero.
+            */
+            struct SignatureBlock
+            {
+                SignatureBlock() : count(0), selfSimilarity(0) {}
+
+                int count;              //!< number of centroids
+                Mat data;               //!< SIGNATURE_DIMENSION x padded count, CV_32F
+                float selfSimilarity;   //!< partial SQFD of the signature with itself
+
+                const float* row(int d) const { return data.ptr<float>(d); }
+            };
+
+
+            static inline void packSignature(const Mat& signature, SignatureBlock& block)
+            {
+                CV_Assert(signature.type() == CV_32F && signature.cols == SIGNATURE_DIMENSION);
+                block.count = signature.rows;
+                int padded = (block.count + SIGNATURE_BLOCK_WIDTH - 1) / SIGNATURE_BLOCK_WIDTH * SIGNATURE_BLOCK_WIDTH;
+                block.data.create(SIGNATURE_DIMENSION, padded, CV_32F);
+                for (int i = 0; i < block.count; i++)
+                {
+                    const float* src = signature.ptr<float>(i);
+                    for (int d = 0; d < SIGNATURE_DIMENSION; d++)
+                    {
+                        block.data.at<float>(d, i) = src[d];
+                    }
+                }
+                for (int i = block.count; i < padded; i++)
+                {
+                    for (int d = 0; d < SIGNATURE_DIMENSION; d++)
+                    {
+                        block.data.at<float>(d, i) = 0;
+                    }
+                }
+            }
+
+
+            /**
+            * @brief Computes similarities of one centroid with SIGNATURE_BLOCK_WIDTH
+            *       consecutive centroids of the block starting at column j.
+            * @param point The centroid, SIGNATURE_DIMENSION values (the weight is not used).
+            * @param block The other signature.
+            * @param j The first column of the block.
+            * @param similarities Output, SIGNATURE_BLOCK_WIDTH values.
+            */
+            static inline void computeBlockSimilarities(
+                const int distanceFunction,
+                const int similarityFunction,
+                const float alpha,
+                const float* point,
+                const SignatureBlock& block,
+                int j,
+                float* similarities)
+            {
+#if CV_SIMD128
+                v_float32x4 result = v_setzero_f32();
+                for (int d = 1; d < SIGNATURE_DIMENSION; ++d)
+                {
+                    v_float32x4 difference = v_setall_f32(point[d]) - v_load(block.row(d) + j);
+                    switch (distanceFunction)
+                    {
+                    case PCTSignatures::L0_25:
+                        result += v_sqrt(v_sqrt(v_abs(difference)));
+                        break;
+                    case PCTSignatures::L0_5:
+                        result += v_sqrt(v_abs(difference));
+                        break;
+                    case PCTSignatures::L1:
+                        result += v_abs(difference);
+                        break;
+                    case PCTSignatures::L2:
+                    case PCTSignatures::L2SQUARED:
+                        result += difference * difference;
+                        break;
+                    case PCTSignatures::L5:
+                    {
+                        v_float32x4 d2 = difference * difference;
+                        result += v_abs(difference) * d2 * d2;
+                        break;
+                    }
+                    case PCTSignatures::L_INFINITY:
+                        result = v_max(result, difference);
+                        break;
+                    default:
+                        CV_Error(Error::StsBadArg, "Distance function not implemented!");
+                    }
+                }
+                switch (distanceFunction)
+                {
+                case PCTSignatures::L0_25:
+                    result *= result;
+                    result *= result;
+                    break;
+                case PCTSignatures::L0_5:
+                    result *= result;
+                    break;
+                case PCTSignatures::L2:
+                    result = v_sqrt(result);
+                    break;
+                }
+                switch (similarityFunction)
+                {
+                case PCTSignatures::MINUS:
+                    v_store(similarities, v_setzero_f32() - result);
+                    return;
+                case PCTSignatures::HEURISTIC:
+                    if (distanceFunction != PCTSignatures::L5)
+                    {
+                        v_store(similarities, v_setall_f32(1.f) / (v_setall_f32(alpha) + result));
+                        return;
+                    }
+                    break;
+                }
+                v_store(similarities, result);
+#else
+                for (int k = 0; k < SIGNATURE_BLOCK_WIDTH; k++)
+                {
+                    float result = 0;
+                    for (int d = 1; d < SIGNATURE_DIMENSION; ++d)
+                    {
+                        float difference = point[d] - block.row(d)[j + k];
+                        switch (distanceFunction)
+                        {
+                        case PCTSignatures::L0_25:
+                            result += std::sqrt(std::sqrt(std::abs(difference)));
+                            break;
+                        case PCTSignatures::L0_5:
+                            result += std::sqrt(std::abs(difference));
+                            break;
+                        case PCTSignatures::L1:
+                            result += std::abs(difference);
+                            break;
+                        case PCTSignatures::L2:
+                        case PCTSignatures::L2SQUARED:
+                            result += difference * difference;
+                            break;
+                        case PCTSignatures::L5:
+                            result += std::abs(difference) * difference * difference * difference * difference;
+                            break;
+                        case PCTSignatures::L_INFINITY:
+                            result = std::max(result, difference);
+                            break;
+                        default:
+                            CV_Error(Error::StsBadArg, "Distance function not implemented!");
+                        }
+                    }
+                    switch (distanceFunction)
+                    {
+                    case PCTSignatures::L0_25:
+                        result *= result;
+                        result *= result;
+                        break;
+                    case PCTSignatures::L0_5:
+                        result *= result;
+                        break;
+                    case PCTSignatures::L2:
+                        result = std::sqrt(result);
+                        break;
+                    }
+                    similarities[k] = result;
+                }
+                if (similarityFunction == PCTSignatures::MINUS)
+                {
+                    for (int k = 0; k < SIGNATURE_BLOCK_WIDTH; k++)
+                        similarities[k] = -similarities[k];
+                    return;
+                }
+                if (similarityFunction == PCTSignatures::HEURISTIC && distanceFunction != PCTSignatures::L5)
+                {
+                    for (int k = 0; k < SIGNATURE_BLOCK_WIDTH; k++)
+                        similarities[k] = 1 / (alpha + similarities[k]);
+                    return;
+                }
+#endif
+                // functions without the vector implementation
+                for (int k = 0; k < SIGNATURE_BLOCK_WIDTH; k++)
+                {
+                    float distance = similarities[k];
+                    if (distanceFunction == PCTSignatures::L5)
+                    {
+                        distance = std::pow(distance, (float)0.2);
+                    }
+                    switch (similarityFunction)
+                    {
+                    case PCTSignatures::MINUS:
+                        similarities[k] = -distance;
+                        break;
+                    case PCTSignatures::GAUSSIAN:
+                        similarities[k] = exp(-alpha + distance * distance);
+                        break;
+                    case PCTSignatures::HEURISTIC:
+                        similarities[k] = 1 / (alpha + distance);
+                        break;
+                    default:
+                        CV_Error(Error::StsNotImplemented, "Similarity function not implemented!");
+                    }
+                }
+            }
+
+
+            /**
+            * @brief Computes sum of w0_i * w1_j * similarity(c0_i, c1_j) over all pairs of centroids.
+            */
+            static inline float computeBlockPartialSQFD(
+                const int distanceFunction,
+                const int similarityFunction,
+                const float alpha,
+                const SignatureBlock& block0,
+                const SignatureBlock& block1)
+            {
+                const int width = block1.data.cols;
+                const float* weights1 = block1.row(WEIGHT_IDX);
+                float similarities[SIGNATURE_BLOCK_WIDTH];
+                float point[SIGNATURE_DIMENSION];
+                double result = 0;
+                for (int i = 0; i < block0.count; i++)
+                {
+                    for (int d = 0; d < SIGNATURE_DIMENSION; d++)
+                    {
+                        point[d] = block0.row(d)[i];
+                    }
+                    float sum = 0;
+                    for (int j = 0; j < width; j += SIGNATURE_BLOCK_WIDTH)
+                    {
+                        computeBlockSimilarities(distanceFunction, similarityFunction, alpha, point, block1, j, similarities);
+                        // the similarities of the padding are skipped, they may be infinite
+                        const int n = std::min(SIGNATURE_BLOCK_WIDTH, block1.count - j);
+                        for (int k = 0; k < n; k++)
+                        {
+                            sum += weights1[j + k] * similarities[k];
+                        }
+                    }
+                    result += point[WEIGHT_IDX] * sum;
+                }
+                return (float)result;
+            }
+        }
+    }
+}
+
+#endif
+
+#endif
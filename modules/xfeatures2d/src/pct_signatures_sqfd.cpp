@@ -59,7 +59,7 @@ References:
 #include "precomp.hpp"
 
 #include "pct_signatures/constants.hpp"
-#include "pct_signatures/similarity.hpp"
+#include "pct_signatures/signature_block.hpp"
 
 namespace cv
 {
@@ -91,65 +91,161 @@ namespace cv
                     const std::vector<Mat>& imageSignatures,
                     std::vector<float>& distances) const;
 
+                void computeNearestSignatures(
+                    const Mat& sourceSignature,
+                    const std::vector<Mat>& imageSignatures,
+                    int k,
+                    std::vector<int>& indices,
+                    std::vector<float>& distances) const;
+
+                /**
+                * @brief Packs the signature and computes its partial SQFD with itself.
+                */
+                void prepareSignature(
+                    const Mat& signature,
+                    SignatureBlock& block) const;
+
+                /**
+                * @brief SQFD of two prepared signatures.
+                */
+                float computeBlockSQFD(
+                    const SignatureBlock& block0,
+                    const SignatureBlock& block1) const;
+
 
             private:
                 int mDistanceFunction;
                 int mSimilarityFunction;
                 float mSimilarityParameter;
 
-                float computePartialSQFD(
-                    const Mat& signature0,
-                    const Mat& signature1) const;
+                void computeTiles(
+                    const Mat& sourceSignature,
+                    const std::vector<Mat>& imageSignatures,
+                    int k,
+                    std::vector<float>* distances,
+                    std::vector<std::vector<std::pair<float, int> > >* tileNearest) const;
 
             };
 
 
+            static void checkSignature(const Mat& signature)
+            {
+                if (signature.cols != SIGNATURE_DIMENSION)
+                {
+                    CV_Error_(Error::StsBadArg, ("Signature dimension must be %d!", SIGNATURE_DIMENSION));
+                }
+
+                if (signature.rows <= 0)
+                {
+                    CV_Error(Error::StsBadArg, "Signature count must be greater than 0!");
+                }
+            }
+
+
+            /**
+            * @brief Number of image signatures processed by one task of the parallel loop.
+            */
+            const int SQFD_TILE_SIZE = 64;
+
+
             /**
             * @brief Class implementing parallel computing of SQFD distance for multiple images.
+            *       The image signatures are processed in tiles; for the nearest neighbour search
+            *       each tile keeps only its k nearest signatures.
             */
             class Parallel_computeSQFDs : public ParallelLoopBody
             {
             private:
-                const PCTSignaturesSQFD* mPctSignaturesSQFDAlgorithm;
-                const Mat* mSourceSignature;
+                const PCTSignaturesSQFD_Impl* mPctSignaturesSQFDAlgorithm;
+                const SignatureBlock* mSourceBlock;
                 const std::vector<Mat>* mImageSignatures;
+                int mK;
                 std::vector<float>* mDistances;
+                std::vector<std::vector<std::pair<float, int> > >* mTileNearest;
 
             public:
                 Parallel_computeSQFDs(
-                    const PCTSignaturesSQFD* pctSignaturesSQFDAlgorithm,
-                    const Mat* sourceSignature,
+                    const PCTSignaturesSQFD_Impl* pctSignaturesSQFDAlgorithm,
+                    const SignatureBlock* sourceBlock,
                     const std::vector<Mat>* imageSignatures,
-                    std::vector<float>* distances)
+                    int k,
+                    std::vector<float>* distances,
+                    std::vector<std::vector<std::pair<float, int> > >* tileNearest)
                     : mPctSignaturesSQFDAlgorithm(pctSignaturesSQFDAlgorithm),
-                    mSourceSignature(sourceSignature),
+                    mSourceBlock(sourceBlock),
                     mImageSignatures(imageSignatures),
-                    mDistances(distances)
+                    mK(k),
+                    mDistances(distances),
+                    mTileNearest(tileNearest)
                 {
-                    mDistances->resize(imageSignatures->size());
                 }
 
                 void operator()(const Range& range) const
                 {
-                    if (mSourceSignature->empty())
-                    {
-                        CV_Error(Error::StsBadArg, "Source signature is empty!");
-                    }
+                    const int count = (int)mImageSignatures->size();
+                    SignatureBlock block;
+                    std::vector<std::pair<float, int> > tile;
 
-                    for (int i = range.start; i < range.end; i++)
+                    for (int t = range.start; t < range.end; t++)
                     {
-                        if (mImageSignatures[i].empty())
+                        const int begin = t * SQFD_TILE_SIZE;
+                        const int end = std::min(begin + SQFD_TILE_SIZE, count);
+                        tile.clear();
+
+                        for (int i = begin; i < end; i++)
                         {
-                            CV_Error_(Error::StsBadArg, ("Signature ID: %d is empty!", i));
+                            const Mat& signature = (*mImageSignatures)[i];
+                            if (signature.empty())
+                            {
+                                CV_Error_(Error::StsBadArg, ("Signature ID: %d is empty!", i));
+                            }
+                            checkSignature(signature);
+
+                            mPctSignaturesSQFDAlgorithm->prepareSignature(signature, block);
+                            float distance = mPctSignaturesSQFDAlgorithm->computeBlockSQFD(*mSourceBlock, block);
+
+                            if (mDistances)
+                            {
+                                (*mDistances)[i] = distance;
+                            }
+                            else
+                            {
+                                tile.push_back(std::make_pair(distance, i));
+                            }
                         }
 
-                        (*mDistances)[i] = mPctSignaturesSQFDAlgorithm->computeQuadraticFormDistance(
-                            *mSourceSignature, (*mImageSignatures)[i]);
+                        if (mTileNearest)
+                        {
+                            const int k = std::min(mK, (int)tile.size());
+                            std::partial_sort(tile.begin(), tile.begin() + k, tile.end());
+                            (*mTileNearest)[t].assign(tile.begin(), tile.begin() + k);
+                        }
                     }
                 }
             };
 
 
+            void PCTSignaturesSQFD_Impl::prepareSignature(
+                      const Mat& signature,
+                      SignatureBlock& block) const
+            {
+                packSignature(signature, block);
+                block.selfSimilarity = computeBlockPartialSQFD(
+                    mDistanceFunction, mSimilarityFunction, mSimilarityParameter, block, block);
+            }
+
+
+            float PCTSignaturesSQFD_Impl::computeBlockSQFD(
+                      const SignatureBlock& block0,
+                      const SignatureBlock& block1) const
+            {
+                float result = block0.selfSimilarity + block1.selfSimilarity;
+                result -= computeBlockPartialSQFD(
+                    mDistanceFunction, mSimilarityFunction, mSimilarityParameter, block0, block1) * 2;
+                return sqrt(result);
+            }
+
+
             float PCTSignaturesSQFD_Impl::computeQuadraticFormDistance(
                       InputArray _signature0,
                       InputArray _signature1) const
@@ -162,49 +258,81 @@ namespace cv
 
                 Mat signature0 = _signature0.getMat();
                 Mat signature1 = _signature1.getMat();
+                checkSignature(signature0);
+                checkSignature(signature1);
 
-                if (signature0.cols != SIGNATURE_DIMENSION || signature1.cols != SIGNATURE_DIMENSION)
-                {
-                    CV_Error_(Error::StsBadArg, ("Signature dimension must be %d!", SIGNATURE_DIMENSION));
-                }
+                // compute sqfd
+                SignatureBlock block0, block1;
+                prepareSignature(signature0, block0);
+                prepareSignature(signature1, block1);
+                return computeBlockSQFD(block0, block1);
+            }
 
-                if (signature0.rows <= 0 || signature1.rows <= 0)
+
+            void PCTSignaturesSQFD_Impl::computeTiles(
+                      const Mat& sourceSignature,
+                      const std::vector<Mat>& imageSignatures,
+                      int k,
+                      std::vector<float>* distances,
+                      std::vector<std::vector<std::pair<float, int> > >* tileNearest) const
+            {
+                if (sourceSignature.empty())
                 {
-                    CV_Error(Error::StsBadArg, "Signature count must be greater than 0!");
+                    CV_Error(Error::StsBadArg, "Source signature is empty!");
                 }
+                checkSignature(sourceSignature);
 
-                // compute sqfd
-                float result = 0;
-                result += computePartialSQFD(signature0, signature0);
-                result += computePartialSQFD(signature1, signature1);
-                result -= computePartialSQFD(signature0, signature1) * 2;
+                SignatureBlock sourceBlock;
+                prepareSignature(sourceSignature, sourceBlock);
 
-                return sqrt(result);
+                const int tiles = ((int)imageSignatures.size() + SQFD_TILE_SIZE - 1) / SQFD_TILE_SIZE;
+                if (tileNearest)
+                {
+                    tileNearest->assign(tiles, std::vector<std::pair<float, int> >());
+                }
+                parallel_for_(Range(0, tiles),
+                    Parallel_computeSQFDs(this, &sourceBlock, &imageSignatures, k, distances, tileNearest));
             }
 
+
             void PCTSignaturesSQFD_Impl::computeQuadraticFormDistances(
                       const Mat& sourceSignature,
                       const std::vector<Mat>& imageSignatures,
                       std::vector<float>& distances) const
             {
-                parallel_for_(Range(0, (int)imageSignatures.size()),
-                    Parallel_computeSQFDs(this, &sourceSignature, &imageSignatures, &distances));
+                distances.resize(imageSignatures.size());
+                computeTiles(sourceSignature, imageSignatures, 0, &distances, NULL);
             }
 
-            float PCTSignaturesSQFD_Impl::computePartialSQFD(
-                      const Mat& signature0,
-                      const Mat& signature1) const
+
+            void PCTSignaturesSQFD_Impl::computeNearestSignatures(
+                      const Mat& sourceSignature,
+                      const std::vector<Mat>& imageSignatures,
+                      int k,
+                      std::vector<int>& indices,
+                      std::vector<float>& distances) const
             {
-                float result = 0;
-                for (int i = 0; i < signature0.rows; i++)
+                CV_Assert(k > 0);
+
+                std::vector<std::vector<std::pair<float, int> > > tileNearest;
+                computeTiles(sourceSignature, imageSignatures, k, NULL, &tileNearest);
+
+                // merge the candidates of the tiles, ties are resolved by the lower index
+                std::vector<std::pair<float, int> > nearest;
+                for (size_t t = 0; t < tileNearest.size(); t++)
                 {
-                    for (int j = 0; j < signature1.rows; j++)
-                    {
-                        result += signature0.at<float>(i, WEIGHT_IDX) * signature1.at<float>(j, WEIGHT_IDX)
-                            * computeSimilarity(mDistanceFunction, mSimilarityFunction, mSimilarityParameter, signature0, i, signature1, j);
-                    }
+                    nearest.insert(nearest.end(), tileNearest[t].begin(), tileNearest[t].end());
+                }
+                k = std::min(k, (int)nearest.size());
+                std::partial_sort(nearest.begin(), nearest.begin() + k, nearest.end());
+
+                indices.resize(k);
+                distances.resize(k);
+                for (int i = 0; i < k; i++)
+                {
+                    distances[i] = nearest[i].first;
+                    indices[i] = nearest[i].second;
                 }
-                return result;
             }
 
 
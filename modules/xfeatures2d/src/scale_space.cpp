@@ -0,0 +1,213 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html
+
+#include "precomp.hpp"
+#include "scale_space.hpp"
+
+namespace cv
+{
+namespace xfeatures2d
+{
+
+ScaleSpace::ScaleSpace() : numOctaves(0)
+{
+}
+
+ScaleSpace::ScaleSpace(const Mat & img, int octavesN_, int layersN_, float sigma0_, int omin_, bool _DOG) :
+    numOctaves(0)
+{
+    build(img, octavesN_, layersN_, sigma0_, omin_, _DOG);
+}
+
+void ScaleSpace::build(const Mat & img, int octavesN_, int layersN_, float sigma0_, int omin_, bool _DOG)
+{
+    params = Params(octavesN_, layersN_, sigma0_, omin_);
+    build(img, _DOG);
+}
+
+/**
+ * Build gaussian pyramid with layersN_ + 3 layers and 2^(1/layersN_) step between layers
+ * each octave is downsampled of a factor of 2
+ */
+void ScaleSpace::build(const Mat& img, bool DOG)
+{
+    Size ksize(0, 0);
+    int gsize;
+
+    Size imgSize = img.size();
+    int minSize = MIN(imgSize.width, imgSize.height);
+    int octavesN = MIN(params.octavesN, int(floor(log((double) minSize)/log((float)2))));
+    float sigma0 = params.sigma0;
+    float sigma;
+    int layersN = params.layersN + 3;
+    int omin = params.omin;
+    float k = params.step;
+
+    /*layer to downsample*/
+    int down_lay = int(1 / log(k));
+
+    double sigmaN = 0.5;
+
+    int first = omin < 0 ? 1 : 0;
+    numOctaves = octavesN + first;
+    if ((int)octaves.size() < numOctaves)
+        octaves.resize(numOctaves);
+    if (DOG && (int)DOG_octaves.size() < numOctaves)
+        DOG_octaves.resize(numOctaves);
+    if (!DOG)
+        DOG_octaves.clear();
+    for (int octave = 0; octave < numOctaves; octave++)
+    {
+        octaves[octave].resize(layersN);
+        if (DOG)
+            DOG_octaves[octave].resize(layersN - 1);
+    }
+
+    if (omin < 0)
+    {
+        omin = -1;
+        gsize = int(ceil(sigmaN * 3)) * 2 + 1;
+        GaussianBlur(img, blurred, Size(gsize,gsize), sigmaN);
+        resize(blurred, octaves[0][0], ksize, 2, 2, INTER_AREA);
+
+        buildOctave(0, sigma0, DOG);
+    }
+
+    /* Presmoothing on first layer */
+    float sb = float(sigmaN) / powf(2.0f, (float) omin);
+    sigma = sigma0;
+    if (sigma0 > sb)
+        sigma = sqrt(sigma0 * sigma0 - sb * sb);
+
+    /*1° step on image*/
+    gsize = int(ceil(sigma * 3)) * 2 + 1;
+    GaussianBlur(img, octaves[first][0], Size(gsize,gsize), sigma);
+
+    /*for every octave build layers*/
+    for (int octave = first; octave < numOctaves; octave++)
+    {
+        /*the first octave starts from the presmoothed image, the others from the layer with sigma0*/
+        buildOctave(octave, octave == first ? sigma : sigma0, DOG);
+
+        /*the downsampled layer of the last octave is not used*/
+        if (octave + 1 < numOctaves)
+            resize(octaves[octave][down_lay], octaves[octave + 1][0], ksize, 1.0f / 2, 1.0f / 2, INTER_AREA);
+    }
+}
+
+/**
+ * Builds the layers of the octave from its first layer
+ * sigma_prev: standard deviation of the first layer
+ */
+void ScaleSpace::buildOctave(int octave, float sigma_prev, bool DOG)
+{
+    std::vector<Mat>& layers = octaves[octave];
+    for (int layer = 1; layer < (int)layers.size(); layer++)
+    {
+        float sigma_curr = getSigma(layer);
+        float sigma = sqrt(powf(sigma_curr, 2) - powf(sigma_prev, 2));
+
+        /* smoothing is applied on previous layer so sigma_curr^2 = sigma^2 + sigma_prev^2 */
+        int gsize = int(ceil(sigma * 3)) * 2 + 1;
+        GaussianBlur(layers[layer - 1], layers[layer], Size(gsize,gsize), sigma);
+
+        if (DOG)
+            absdiff(layers[layer], layers[layer - 1], DOG_octaves[octave][layer - 1]);
+        sigma_prev = sigma_curr;
+    }
+}
+
+/**
+ * Return layer at indicated octave and layer numbers
+ */
+const Mat& ScaleSpace::getLayer(int octave, int layer) const
+{
+    CV_Assert(0 <= octave && octave < numOctaves);
+    CV_Assert(0 <= layer && layer < (int) octaves[octave].size());
+    return octaves[octave][layer];
+}
+
+/**
+ * Return DOG layer at indicated octave and layer numbers
+ */
+const Mat& ScaleSpace::getDOGLayer(int octave, int layer) const
+{
+    CV_Assert(!DOG_octaves.empty());
+    CV_Assert(0 <= octave && octave < numOctaves);
+    CV_Assert(0 <= layer && layer < (int) DOG_octaves[octave].size());
+    return DOG_octaves[octave][layer];
+}
+
+/**
+ * Return sigma value of indicated octave and layer
+ */
+float ScaleSpace::getSigma(int octave, int layer) const
+{
+    return powf(2.0f, float(octave)) * powf(params.step, float(layer)) * params.sigma0;
+}
+
+/**
+ * Return sigma value of indicated layer
+ * sigma value of layer is the same at each octave
+ * i.e. sigma of first layer at each octave is sigma0
+ */
+float ScaleSpace::getSigma(int layer) const
+{
+    return powf(params.step, float(layer)) * params.sigma0;
+}
+
+/**
+ * Release the layers and clear params
+ */
+void ScaleSpace::clear()
+{
+    numOctaves = 0;
+    octaves.clear();
+    DOG_octaves.clear();
+    blurred.release();
+    params.clear();
+}
+
+bool ScaleSpace::empty() const
+{
+    return numOctaves == 0;
+}
+
+ScaleSpace::Params::Params()
+{
+    clear();
+}
+
+/**
+ * Params for ScaleSpace class
+ */
+ScaleSpace::Params::Params(int octavesN_, int layersN_, float sigma0_, int omin_) :
+    octavesN(octavesN_), layersN(layersN_), sigma0(sigma0_), omin(omin_)
+{
+    CV_Assert(layersN > 0 && octavesN_>0);
+    step = powf(2, 1.0f / layersN);
+}
+
+/**
+ * Returns ScaleSpace's params
+ */
+ScaleSpace::Params ScaleSpace::getParams() const
+{
+    return params;
+}
+
+/**
+ * Set to zero all params
+ */
+void ScaleSpace::Params::clear()
+{
+    octavesN = 0;
+    layersN = 0;
+    sigma0 = 0;
+    omin = 0;
+    step = 0;
+}
+
+}
+}
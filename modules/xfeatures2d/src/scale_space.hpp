@@ -0,0 +1,79 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html
+
+#ifndef __OPENCV_XFEATURES2D_SCALE_SPACE_HPP__
+#define __OPENCV_XFEATURES2D_SCALE_SPACE_HPP__
+
+#include "precomp.hpp"
+
+namespace cv
+{
+namespace xfeatures2d
+{
+
+/**
+ * Gaussian (and optionally DoG) scale space of an image.
+ * The object keeps its layers between builds, so building the scale space of images
+ * of the same size again does not allocate memory.
+ */
+class ScaleSpace
+{
+public:
+    class Params
+    {
+    public:
+        int octavesN;
+        int layersN;
+        float sigma0;
+        int omin;
+        float step;
+        Params();
+        Params(int octavesN, int layersN, float sigma0, int omin);
+        void clear();
+    };
+    Params params;
+
+    ScaleSpace();
+    ScaleSpace(const Mat& img, int octavesN, int layersN = 2, float sigma0 = 1, int omin = 0,
+            bool DOG = false);
+
+    /**
+     * Builds the scale space of the image, reusing the layers of the previous build
+     * octavesN: number of octaves
+     * layersN: number of layers before subsampling layer
+     * sigma0: starting sigma (depends on detector's type, i.e. SIFT sigma0 = 1.6, Harris sigma0 = 1)
+     * omin: if omin<0 an octave is added before first octave. In this octave the image size is doubled
+     * DOG: if true, a DOG pyramid is build
+     */
+    void build(const Mat& img, int octavesN, int layersN = 2, float sigma0 = 1, int omin = 0,
+            bool DOG = false);
+
+    const Mat& getLayer(int octave, int layer) const;
+    const Mat& getDOGLayer(int octave, int layer) const;
+    float getSigma(int octave, int layer) const;
+    float getSigma(int layer) const;
+
+    /**
+     * Number of octaves of the last build, including the upsampled one if omin < 0
+     */
+    int getNumOctaves() const { return numOctaves; }
+
+    Params getParams() const;
+    void clear();
+    bool empty() const;
+
+private:
+    void build(const Mat& img, bool DOG);
+    void buildOctave(int octave, float sigma_prev, bool DOG);
+
+    int numOctaves;
+    std::vector<std::vector<Mat> > octaves;
+    std::vector<std::vector<Mat> > DOG_octaves;
+    Mat blurred;
+};
+
+}
+}
+
+#endif
@@ -106,6 +106,7 @@
 #include <iostream>
 #include <stdarg.h>
 #include <opencv2/core/hal/hal.hpp>
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -151,6 +152,10 @@ protected:
     CV_PROP_RW double contrastThreshold;
     CV_PROP_RW double edgeThreshold;
     CV_PROP_RW double sigma;
+
+    // buffers of the last processed image, they are reused when the next image has the same size
+    Mat baseImage;
+    std::vector<Mat> gaussPyramid, dogPyramid;
 };
 
 Ptr<SIFT> SIFT::create( int _nfeatures, int _nOctaveLayers,
@@ -216,7 +221,42 @@ unpackOctave(const KeyPoint& kpt, int& octave, int& layer, float& scale)
     scale = octave >= 0 ? 1.f/(1 << octave) : (float)(1 << -octave);
 }
 
-static Mat createInitialImage( const Mat& img, bool doubleImageSize, float sigma )
+// Blurs horizontal stripes of the image in parallel. The filter reads the rows around each stripe
+// from the whole image, so the result is the same as the one of a single GaussianBlur() call.
+class GaussianBlurComputer : public ParallelLoopBody
+{
+public:
+    GaussianBlurComputer(const Mat& _src, Mat& _dst, double _sig, int _nstripes)
+        : src(_src), dst(_dst), sig(_sig), nstripes(_nstripes) { }
+
+    void operator()( const cv::Range& range ) const
+    {
+        const int row0 = src.rows*range.start/nstripes;
+        const int row1 = src.rows*range.end/nstripes;
+        Mat dst_stripe = dst.rowRange(row0, row1);
+        GaussianBlur(src.rowRange(row0, row1), dst_stripe, Size(), sig, sig);
+    }
+
+private:
+    const Mat& src;
+    Mat& dst;
+    double sig;
+    int nstripes;
+};
+
+static void parallelGaussianBlur( const Mat& src, Mat& dst, double sig )
+{
+    CV_Assert( src.data != dst.data || src.empty() );
+    dst.create(src.size(), src.type());
+    // stripes much thinner than the kernel would mostly filter the same rows again
+    const int nstripes = std::max(1, std::min(getNumThreads(), src.rows/64));
+    if( nstripes == 1 )
+        GaussianBlur(src, dst, Size(), sig, sig);
+    else
+        parallel_for_(Range(0, nstripes), GaussianBlurComputer(src, dst, sig, nstripes));
+}
+
+static void createInitialImage( const Mat& img, bool doubleImageSize, float sigma, Mat& dst )
 {
     Mat gray, gray_fpt;
     if( img.channels() == 3 || img.channels() == 4 )
@@ -234,14 +274,12 @@ static Mat createInitialImage( const Mat& img, bool doubleImageSize, float sigma
         sig_diff = sqrtf( std::max(sigma * sigma - SIFT_INIT_SIGMA * SIFT_INIT_SIGMA * 4, 0.01f) );
         Mat dbl;
         resize(gray_fpt, dbl, Size(gray_fpt.cols*2, gray_fpt.rows*2), 0, 0, INTER_LINEAR);
-        GaussianBlur(dbl, dbl, Size(), sig_diff, sig_diff);
-        return dbl;
+        parallelGaussianBlur(dbl, dst, sig_diff);
     }
     else
     {
         sig_diff = sqrtf( std::max(sigma * sigma - SIFT_INIT_SIGMA * SIFT_INIT_SIGMA, 0.01f) );
-        GaussianBlur(gray_fpt, gray_fpt, Size(), sig_diff, sig_diff);
-        return gray_fpt;
+        parallelGaussianBlur(gray_fpt, dst, sig_diff);
     }
 }
 
@@ -279,7 +317,7 @@ void SIFT_Impl::buildGaussianPyramid( const Mat& base, std::vector<Mat>& pyr, in
             else
             {
                 const Mat& src = pyr[o*(nOctaveLayers + 3) + i-1];
-                GaussianBlur(src, dst, Size(), sig[i], sig[i]);
+                parallelGaussianBlur(src, dst, sig[i]);
             }
         }
     }
@@ -398,6 +436,27 @@ static float calcOrientationHist( const Mat& img, Point pt, int radius,
             temphist[bin_buf[7]] += w_mul_mag_buf[7];
         }
     }
+#endif
+#if CV_SIMD128
+    {
+        const v_float32x4 nd360 = v_setall_f32(n/360.f);
+        const v_int32x4 vn = v_setall_s32(n), vzero = v_setzero_s32();
+        int CV_DECL_ALIGNED(16) bin_buf[4];
+        float CV_DECL_ALIGNED(16) w_mul_mag_buf[4];
+        for( ; k <= len - 4; k += 4 )
+        {
+            v_int32x4 bin = v_round(nd360*v_load(Ori + k));
+            bin -= vn & (bin >= vn);
+            bin += vn & (bin < vzero);
+            v_store_aligned(bin_buf, bin);
+            v_store_aligned(w_mul_mag_buf, v_load(W + k)*v_load(Mag + k));
+
+            temphist[bin_buf[0]] += w_mul_mag_buf[0];
+            temphist[bin_buf[1]] += w_mul_mag_buf[1];
+            temphist[bin_buf[2]] += w_mul_mag_buf[2];
+            temphist[bin_buf[3]] += w_mul_mag_buf[3];
+        }
+    }
 #endif
     for( ; k < len; k++ )
     {
@@ -446,6 +505,18 @@ static float calcOrientationHist( const Mat& img, Point pt, int radius,
             _mm256_storeu_ps(&hist[i], __hist);
         }
     }
+#endif
+#if CV_SIMD128
+    {
+        const v_float32x4 d_1_16 = v_setall_f32(1.f/16.f), d_4_16 = v_setall_f32(4.f/16.f), d_6_16 = v_setall_f32(6.f/16.f);
+        for( ; i <= n - 4; i += 4 )
+        {
+            v_float32x4 h = (v_load(temphist + i - 2) + v_load(temphist + i + 2))*d_1_16 +
+                            (v_load(temphist + i - 1) + v_load(temphist + i + 1))*d_4_16 +
+                            v_load(temphist + i)*d_6_16;
+            v_store(hist + i, h);
+        }
+    }
 #endif
     for( ; i < n; i++ )
     {
@@ -569,6 +640,163 @@ static bool adjustLocalExtrema( const std::vector<Mat>& dog_pyr, KeyPoint& kpt,
 }
 
 
+class findScaleSpaceExtremaComputer : public ParallelLoopBody
+{
+public:
+    findScaleSpaceExtremaComputer(
+        int _o,
+        int _i,
+        int _threshold,
+        int _nOctaveLayers,
+        double _contrastThreshold,
+        double _edgeThreshold,
+        double _sigma,
+        const std::vector<Mat>& _gauss_pyr,
+        const std::vector<Mat>& _dog_pyr,
+        std::vector<std::vector<KeyPoint> >& _row_keypoints)
+
+        : o(_o),
+          i(_i),
+          threshold(_threshold),
+          nOctaveLayers(_nOctaveLayers),
+          contrastThreshold(_contrastThreshold),
+          edgeThreshold(_edgeThreshold),
+          sigma(_sigma),
+          gauss_pyr(_gauss_pyr),
+          dog_pyr(_dog_pyr),
+          row_keypoints(_row_keypoints) { }
+
+    void operator()( const cv::Range& range ) const
+    {
+        const int begin = range.start;
+        const int end = range.end;
+
+        static const int n = SIFT_ORI_HIST_BINS;
+        float hist[n];
+
+        const int idx = o*(nOctaveLayers+2)+i;
+        const Mat& img = dog_pyr[idx];
+        const Mat& prev = dog_pyr[idx-1];
+        const Mat& next = dog_pyr[idx+1];
+        const int step = (int)img.step1();
+        const int cols = img.cols;
+
+        for( int r = begin; r < end; r++)
+        {
+            std::vector<KeyPoint>& kpts = row_keypoints[r];
+            const sift_wt* currptr = img.ptr<sift_wt>(r);
+            const sift_wt* prevptr = prev.ptr<sift_wt>(r);
+            const sift_wt* nextptr = next.ptr<sift_wt>(r);
+            int c = SIFT_IMG_BORDER;
+
+#if CV_SIMD128
+            // the maximum and the minimum of the 26 neighbors are compared for 4 pixels at once,
+            // the few candidates are then refined one by one in the same order as below
+            const v_float32x4 vthr = v_setall_f32((float)threshold), vnthr = v_setall_f32(-(float)threshold);
+            for( ; c <= cols - SIFT_IMG_BORDER - 4; c += 4 )
+            {
+                v_float32x4 val = v_load(currptr + c);
+                v_float32x4 a = v_load(currptr + c - 1), b = v_load(currptr + c + 1);
+                v_float32x4 vmax = v_max(a, b), vmin = v_min(a, b);
+#define SIFT_UPDATE_MINMAX(ptr) \
+                a = v_load((ptr) - 1); b = v_load(ptr); \
+                vmax = v_max(vmax, v_max(a, b)); vmin = v_min(vmin, v_min(a, b)); \
+                a = v_load((ptr) + 1); \
+                vmax = v_max(vmax, a); vmin = v_min(vmin, a);
+                SIFT_UPDATE_MINMAX(currptr + c - step)
+                SIFT_UPDATE_MINMAX(currptr + c + step)
+                SIFT_UPDATE_MINMAX(prevptr + c - step)
+                SIFT_UPDATE_MINMAX(prevptr + c)
+                SIFT_UPDATE_MINMAX(prevptr + c + step)
+                SIFT_UPDATE_MINMAX(nextptr + c - step)
+                SIFT_UPDATE_MINMAX(nextptr + c)
+                SIFT_UPDATE_MINMAX(nextptr + c + step)
+#undef SIFT_UPDATE_MINMAX
+                int mask = v_signmask(((val > vthr) & (val >= vmax)) | ((val < vnthr) & (val <= vmin)));
+                for( int k = 0; mask != 0; k++, mask >>= 1 )
+                {
+                    if( mask & 1 )
+                        processCandidate(r, c + k, kpts, hist);
+                }
+            }
+#endif
+            for( ; c < cols-SIFT_IMG_BORDER; c++)
+            {
+                sift_wt val = currptr[c];
+
+                // find local extrema with pixel accuracy
+                if( std::abs(val) > threshold &&
+                   ((val > 0 && val >= currptr[c-1] && val >= currptr[c+1] &&
+                     val >= currptr[c-step-1] && val >= currptr[c-step] && val >= currptr[c-step+1] &&
+                     val >= currptr[c+step-1] && val >= currptr[c+step] && val >= currptr[c+step+1] &&
+                     val >= nextptr[c] && val >= nextptr[c-1] && val >= nextptr[c+1] &&
+                     val >= nextptr[c-step-1] && val >= nextptr[c-step] && val >= nextptr[c-step+1] &&
+                     val >= nextptr[c+step-1] && val >= nextptr[c+step] && val >= nextptr[c+step+1] &&
+                     val >= prevptr[c] && val >= prevptr[c-1] && val >= prevptr[c+1] &&
+                     val >= prevptr[c-step-1] && val >= prevptr[c-step] && val >= prevptr[c-step+1] &&
+                     val >= prevptr[c+step-1] && val >= prevptr[c+step] && val >= prevptr[c+step+1]) ||
+                    (val < 0 && val <= currptr[c-1] && val <= currptr[c+1] &&
+                     val <= currptr[c-step-1] && val <= currptr[c-step] && val <= currptr[c-step+1] &&
+                     val <= currptr[c+step-1] && val <= currptr[c+step] && val <= currptr[c+step+1] &&
+                     val <= nextptr[c] && val <= nextptr[c-1] && val <= nextptr[c+1] &&
+                     val <= nextptr[c-step-1] && val <= nextptr[c-step] && val <= nextptr[c-step+1] &&
+                     val <= nextptr[c+step-1] && val <= nextptr[c+step] && val <= nextptr[c+step+1] &&
+                     val <= prevptr[c] && val <= prevptr[c-1] && val <= prevptr[c+1] &&
+                     val <= prevptr[c-step-1] && val <= prevptr[c-step] && val <= prevptr[c-step+1] &&
+                     val <= prevptr[c+step-1] && val <= prevptr[c+step] && val <= prevptr[c+step+1])))
+                {
+                    processCandidate(r, c, kpts, hist);
+                }
+            }
+        }
+    }
+
+private:
+    // refines the extremum and adds a keypoint for every dominant orientation
+    void processCandidate( int r, int c, std::vector<KeyPoint>& kpts, float* hist ) const
+    {
+        static const int n = SIFT_ORI_HIST_BINS;
+        KeyPoint kpt;
+        int r1 = r, c1 = c, layer = i;
+        if( !adjustLocalExtrema(dog_pyr, kpt, o, layer, r1, c1,
+                                nOctaveLayers, (float)contrastThreshold,
+                                (float)edgeThreshold, (float)sigma) )
+            return;
+        float scl_octv = kpt.size*0.5f/(1 << o);
+        float omax = calcOrientationHist(gauss_pyr[o*(nOctaveLayers+3) + layer],
+                                         Point(c1, r1),
+                                         cvRound(SIFT_ORI_RADIUS * scl_octv),
+                                         SIFT_ORI_SIG_FCTR * scl_octv,
+                                         hist, n);
+        float mag_thr = (float)(omax * SIFT_ORI_PEAK_RATIO);
+        for( int j = 0; j < n; j++ )
+        {
+            int l = j > 0 ? j - 1 : n - 1;
+            int r2 = j < n-1 ? j + 1 : 0;
+
+            if( hist[j] > hist[l]  &&  hist[j] > hist[r2]  &&  hist[j] >= mag_thr )
+            {
+                float bin = j + 0.5f * (hist[l]-hist[r2]) / (hist[l] - 2*hist[j] + hist[r2]);
+                bin = bin < 0 ? n + bin : bin >= n ? bin - n : bin;
+                kpt.angle = 360.f - (float)((360.f/n) * bin);
+                if(std::abs(kpt.angle - 360.f) < FLT_EPSILON)
+                    kpt.angle = 0.f;
+                kpts.push_back(kpt);
+            }
+        }
+    }
+
+    int o, i;
+    int threshold;
+    int nOctaveLayers;
+    double contrastThreshold;
+    double edgeThreshold;
+    double sigma;
+    const std::vector<Mat>& gauss_pyr;
+    const std::vector<Mat>& dog_pyr;
+    std::vector<std::vector<KeyPoint> >& row_keypoints;
+};
+
 //
 // Detects features at extrema in DoG scale space.  Bad features are discarded
 // based on contrast and ratio of principal curvatures.
@@ -577,83 +805,32 @@ void SIFT_Impl::findScaleSpaceExtrema( const std::vector<Mat>& gauss_pyr, const
 {
     int nOctaves = (int)gauss_pyr.size()/(nOctaveLayers + 3);
     int threshold = cvFloor(0.5 * contrastThreshold / nOctaveLayers * 255 * SIFT_FIXPT_SCALE);
-    const int n = SIFT_ORI_HIST_BINS;
-    float hist[n];
-    KeyPoint kpt;
 
     keypoints.clear();
+    // the keypoints of every row are collected separately and concatenated in the row order,
+    // so the result does not depend on the number of threads
+    std::vector<std::vector<KeyPoint> > row_keypoints;
 
     for( int o = 0; o < nOctaves; o++ )
         for( int i = 1; i <= nOctaveLayers; i++ )
         {
-            int idx = o*(nOctaveLayers+2)+i;
-            const Mat& img = dog_pyr[idx];
-            const Mat& prev = dog_pyr[idx-1];
-            const Mat& next = dog_pyr[idx+1];
-            int step = (int)img.step1();
-            int rows = img.rows, cols = img.cols;
-
-            for( int r = SIFT_IMG_BORDER; r < rows-SIFT_IMG_BORDER; r++)
-            {
-                const sift_wt* currptr = img.ptr<sift_wt>(r);
-                const sift_wt* prevptr = prev.ptr<sift_wt>(r);
-                const sift_wt* nextptr = next.ptr<sift_wt>(r);
+            const int idx = o*(nOctaveLayers+2)+i;
+            const int rows = dog_pyr[idx].rows;
+            if( rows <= 2*SIFT_IMG_BORDER )
+                continue;
 
-                for( int c = SIFT_IMG_BORDER; c < cols-SIFT_IMG_BORDER; c++)
-                {
-                    sift_wt val = currptr[c];
-
-                    // find local extrema with pixel accuracy
-                    if( std::abs(val) > threshold &&
-                       ((val > 0 && val >= currptr[c-1] && val >= currptr[c+1] &&
-                         val >= currptr[c-step-1] && val >= currptr[c-step] && val >= currptr[c-step+1] &&
-                         val >= currptr[c+step-1] && val >= currptr[c+step] && val >= currptr[c+step+1] &&
-                         val >= nextptr[c] && val >= nextptr[c-1] && val >= nextptr[c+1] &&
-                         val >= nextptr[c-step-1] && val >= nextptr[c-step] && val >= nextptr[c-step+1] &&
-                         val >= nextptr[c+step-1] && val >= nextptr[c+step] && val >= nextptr[c+step+1] &&
-                         val >= prevptr[c] && val >= prevptr[c-1] && val >= prevptr[c+1] &&
-                         val >= prevptr[c-step-1] && val >= prevptr[c-step] && val >= prevptr[c-step+1] &&
-                         val >= prevptr[c+step-1] && val >= prevptr[c+step] && val >= prevptr[c+step+1]) ||
-                        (val < 0 && val <= currptr[c-1] && val <= currptr[c+1] &&
-                         val <= currptr[c-step-1] && val <= currptr[c-step] && val <= currptr[c-step+1] &&
-                         val <= currptr[c+step-1] && val <= currptr[c+step] && val <= currptr[c+step+1] &&
-                         val <= nextptr[c] && val <= nextptr[c-1] && val <= nextptr[c+1] &&
-                         val <= nextptr[c-step-1] && val <= nextptr[c-step] && val <= nextptr[c-step+1] &&
-                         val <= nextptr[c+step-1] && val <= nextptr[c+step] && val <= nextptr[c+step+1] &&
-                         val <= prevptr[c] && val <= prevptr[c-1] && val <= prevptr[c+1] &&
-                         val <= prevptr[c-step-1] && val <= prevptr[c-step] && val <= prevptr[c-step+1] &&
-                         val <= prevptr[c+step-1] && val <= prevptr[c+step] && val <= prevptr[c+step+1])))
-                    {
-                        int r1 = r, c1 = c, layer = i;
-                        if( !adjustLocalExtrema(dog_pyr, kpt, o, layer, r1, c1,
-                                                nOctaveLayers, (float)contrastThreshold,
-                                                (float)edgeThreshold, (float)sigma) )
-                            continue;
-                        float scl_octv = kpt.size*0.5f/(1 << o);
-                        float omax = calcOrientationHist(gauss_pyr[o*(nOctaveLayers+3) + layer],
-                                                         Point(c1, r1),
-                                                         cvRound(SIFT_ORI_RADIUS * scl_octv),
-                                                         SIFT_ORI_SIG_FCTR * scl_octv,
-                                                         hist, n);
-                        float mag_thr = (float)(omax * SIFT_ORI_PEAK_RATIO);
-                        for( int j = 0; j < n; j++ )
-                        {
-                            int l = j > 0 ? j - 1 : n - 1;
-                            int r2 = j < n-1 ? j + 1 : 0;
-
-                            if( hist[j] > hist[l]  &&  hist[j] > hist[r2]  &&  hist[j] >= mag_thr )
-                            {
-                                float bin = j + 0.5f * (hist[l]-hist[r2]) / (hist[l] - 2*hist[j] + hist[r2]);
-                                bin = bin < 0 ? n + bin : bin >= n ? bin - n : bin;
-                                kpt.angle = 360.f - (float)((360.f/n) * bin);
-                                if(std::abs(kpt.angle - 360.f) < FLT_EPSILON)
-                                    kpt.angle = 0.f;
-                                keypoints.push_back(kpt);
-                            }
-                        }
-                    }
-                }
-            }
+            row_keypoints.resize(rows);
+            for( int r = 0; r < rows; r++ )
+                row_keypoints[r].clear();
+
+            parallel_for_(Range(SIFT_IMG_BORDER, rows-SIFT_IMG_BORDER),
+                findScaleSpaceExtremaComputer(
+                    o, i, threshold, nOctaveLayers,
+                    contrastThreshold, edgeThreshold, sigma,
+                    gauss_pyr, dog_pyr, row_keypoints));
+
+            for( int r = SIFT_IMG_BORDER; r < rows-SIFT_IMG_BORDER; r++ )
+                keypoints.insert(keypoints.end(), row_keypoints[r].begin(), row_keypoints[r].end());
         }
 }
 
@@ -804,6 +981,63 @@ static void calcSIFTDescriptor( const Mat& img, Point2f ptf, float ori, float sc
             #undef HIST_SUM_HELPER
         }
     }
+#endif
+#if CV_SIMD128
+    {
+        int CV_DECL_ALIGNED(16) idx_buf[4];
+        float CV_DECL_ALIGNED(16) rco_buf[32];
+        const v_float32x4 v_ori = v_setall_f32(ori), v_bins_per_rad = v_setall_f32(bins_per_rad);
+        const v_float32x4 v_one = v_setall_f32(1.f), v_d2 = v_setall_f32((float)(d + 2)), v_n2 = v_setall_f32((float)(n + 2));
+        const v_int32x4 v_n = v_setall_s32(n), v_zero = v_setzero_s32();
+        for( ; k <= len - 4; k += 4 )
+        {
+            v_float32x4 rbin = v_load(RBin + k), cbin = v_load(CBin + k);
+            v_float32x4 obin = (v_load(Ori + k) - v_ori)*v_bins_per_rad;
+            v_float32x4 mag = v_load(Mag + k)*v_load(W + k);
+
+            v_int32x4 r0 = v_floor(rbin), c0 = v_floor(cbin), o0 = v_floor(obin);
+            v_float32x4 r0f = v_cvt_f32(r0), c0f = v_cvt_f32(c0);
+            rbin -= r0f;
+            cbin -= c0f;
+            obin -= v_cvt_f32(o0);
+            o0 += v_n & (o0 < v_zero);
+            o0 -= v_n & (o0 >= v_n);
+
+            v_float32x4 v_r1 = mag*rbin, v_r0 = mag - v_r1;
+            v_float32x4 v_rc11 = v_r1*cbin, v_rc10 = v_r1 - v_rc11;
+            v_float32x4 v_rc01 = v_r0*cbin, v_rc00 = v_r0 - v_rc01;
+            v_float32x4 v_rco111 = v_rc11*obin, v_rco110 = v_rc11 - v_rco111;
+            v_float32x4 v_rco101 = v_rc10*obin, v_rco100 = v_rc10 - v_rco101;
+            v_float32x4 v_rco011 = v_rc01*obin, v_rco010 = v_rc01 - v_rco011;
+            v_float32x4 v_rco001 = v_rc00*obin, v_rco000 = v_rc00 - v_rco001;
+
+            // the indices are small, so they are exact in floating point
+            v_int32x4 idx = v_round(((r0f + v_one)*v_d2 + c0f + v_one)*v_n2) + o0;
+            v_store_aligned(idx_buf, idx);
+
+            v_store_aligned(rco_buf,      v_rco000);
+            v_store_aligned(rco_buf + 4,  v_rco001);
+            v_store_aligned(rco_buf + 8,  v_rco010);
+            v_store_aligned(rco_buf + 12, v_rco011);
+            v_store_aligned(rco_buf + 16, v_rco100);
+            v_store_aligned(rco_buf + 20, v_rco101);
+            v_store_aligned(rco_buf + 24, v_rco110);
+            v_store_aligned(rco_buf + 28, v_rco111);
+
+            for( int id = 0; id < 4; id++ )
+            {
+                float* h = hist + idx_buf[id];
+                h[0] += rco_buf[id];
+                h[1] += rco_buf[4 + id];
+                h[n+2] += rco_buf[8 + id];
+                h[n+3] += rco_buf[12 + id];
+                h[(d+2)*(n+2)] += rco_buf[16 + id];
+                h[(d+2)*(n+2)+1] += rco_buf[20 + id];
+                h[(d+3)*(n+2)] += rco_buf[24 + id];
+                h[(d+3)*(n+2)+1] += rco_buf[28 + id];
+            }
+        }
+    }
 #endif
     for( ; k < len; k++ )
     {
@@ -879,6 +1113,17 @@ static void calcSIFTDescriptor( const Mat& img, Point2f ptf, float ori, float sc
         nrm2 = nrm2_buf[0] + nrm2_buf[1] + nrm2_buf[2] + nrm2_buf[3] +
                nrm2_buf[4] + nrm2_buf[5] + nrm2_buf[6] + nrm2_buf[7];
     }
+#endif
+#if CV_SIMD128
+    {
+        v_float32x4 v_nrm2 = v_setzero_f32();
+        for( ; k <= len - 4; k += 4 )
+        {
+            v_float32x4 v_dst = v_load(dst + k);
+            v_nrm2 += v_dst*v_dst;
+        }
+        nrm2 += v_reduce_sum(v_nrm2);
+    }
 #endif
     for( ; k < len; k++ )
         nrm2 += dst[k]*dst[k];
@@ -935,6 +1180,16 @@ static void calcSIFTDescriptor( const Mat& img, Point2f ptf, float ori, float sc
             _mm256_storeu_ps(&dst[k], __dst);
         }
     }
+#endif
+#if CV_SIMD128
+    {
+        const v_float32x4 v_nrm2 = v_setall_f32(nrm2), v_lo = v_setzero_f32(), v_hi = v_setall_f32(255.0f);
+        for( ; k <= len - 4; k += 4 )
+        {
+            v_float32x4 v_dst = v_cvt_f32(v_round(v_load(dst + k)*v_nrm2));
+            v_store(dst + k, v_min(v_max(v_dst, v_lo), v_hi));
+        }
+    }
 #endif
     for( ; k < len; k++ )
     {
@@ -1065,8 +1320,10 @@ void SIFT_Impl::detectAndCompute(InputArray _image, InputArray _mask,
         actualNOctaves = maxOctave - firstOctave + 1;
     }
 
-    Mat base = createInitialImage(image, firstOctave < 0, (float)sigma);
-    std::vector<Mat> gpyr, dogpyr;
+    createInitialImage(image, firstOctave < 0, (float)sigma, baseImage);
+    const Mat& base = baseImage;
+    std::vector<Mat>& gpyr = gaussPyramid;
+    std::vector<Mat>& dogpyr = dogPyramid;
     int nOctaves = actualNOctaves > 0 ? actualNOctaves : cvRound(std::log( (double)std::min( base.cols, base.rows ) ) / std::log(2.) - 2) - firstOctave;
 
     //double t, tf = getTickFrequency();
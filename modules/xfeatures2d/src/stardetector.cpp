@@ -40,6 +40,7 @@
 //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -138,49 +139,174 @@ computeIntegralImages( const Mat& matI, Mat& matS, Mat& matT, Mat& _FT,
     }
 }
 
+static const int STAR_MAX_PATTERN = 17;
+static const int STAR_MAX_PAIR = 12;
+
+template <typename iiMatType> struct StarFeature
+{
+    int area;
+    iiMatType* p[8];
+};
+
+// the generic integral types have no vectorized path
 template <typename iiMatType> static int
-StarDetectorComputeResponses( const Mat& img, Mat& responses, Mat& sizes,
-                              int maxSize, int iiType )
+StarDetectorResponsesRowSIMD( const StarFeature<iiMatType>*, const int (*)[2], const float (*)[2],
+                              const int*, int, int, int, int x, int, float*, short* )
 {
-    const int MAX_PATTERN = 17;
-    static const int sizes0[] = {1, 2, 3, 4, 6, 8, 11, 12, 16, 22, 23, 32, 45, 46, 64, 90, 128, -1};
-    static const int pairs[12][2] = {{1, 0}, {3, 1}, {4, 2}, {5, 3}, {7, 4}, {8, 5}, {9, 6},
-                                     {11, 8}, {13, 10}, {14, 11}, {15, 12}, {16, 14}};
-    const int MAX_PAIR = sizeof(pairs)/sizeof(pairs[0]);
-    float invSizes[MAX_PATTERN][2];
-    int sizes1[MAX_PATTERN];
-
-#if CV_SSE2
-    __m128 invSizes4[MAX_PATTERN][2];
-    __m128 sizes1_4[MAX_PATTERN];
-    union { int i; float f; } absmask;
-    absmask.i = 0x7fffffff;
-    volatile bool useSIMD = cv::checkHardwareSupport(CV_CPU_SSE2) && iiType == CV_32S;
+    return x;
+}
+
+// the 32-bit integral images wrap around, the box sums are still exact
+static int
+StarDetectorResponsesRowSIMD( const StarFeature<unsigned>* f, const int (*pairs)[2], const float (*invSizes)[2],
+                              const int* sizes1, int npatterns, int maxIdx, int ofs0, int x, int xend,
+                              float* r_ptr, short* s_ptr )
+{
+#if CV_SIMD128
+    v_float32x4 vals[STAR_MAX_PATTERN];
+
+    for( ; x <= xend - 4; x += 4 )
+    {
+        int ofs = ofs0 + x;
+
+        for(int i = 0; i <= maxIdx; i++ )
+        {
+            const int* const* p = (const int* const*)&f[i].p[0];
+            v_int32x4 r0 = v_load(p[0] + ofs) - v_load(p[1] + ofs);
+            v_int32x4 r1 = v_load(p[3] + ofs) - v_load(p[2] + ofs);
+            v_int32x4 r2 = v_load(p[4] + ofs) - v_load(p[5] + ofs);
+            v_int32x4 r3 = v_load(p[7] + ofs) - v_load(p[6] + ofs);
+            vals[i] = v_cvt_f32((r0 + r1) + (r2 + r3));
+        }
+
+        v_float32x4 bestResponse = v_setzero_f32(), bestAbs = v_setzero_f32();
+        v_int32x4 bestSize = v_setzero_s32();
+
+        for(int i = 0; i < npatterns; i++ )
+        {
+            v_float32x4 inner_sum = vals[pairs[i][1]];
+            v_float32x4 outer_sum = vals[pairs[i][0]] - inner_sum;
+            v_float32x4 response = inner_sum*v_setall_f32(invSizes[i][1]) - outer_sum*v_setall_f32(invSizes[i][0]);
+            v_float32x4 absResponse = v_abs(response);
+            v_float32x4 swapmask = absResponse > bestAbs;
+            bestResponse = v_select(swapmask, response, bestResponse);
+            bestAbs = v_select(swapmask, absResponse, bestAbs);
+            bestSize = v_select(v_reinterpret_as_s32(swapmask), v_setall_s32(sizes1[pairs[i][0]]), bestSize);
+        }
+
+        v_store(r_ptr + x, bestResponse);
+        v_pack_store(s_ptr + x, bestSize);
+    }
+#else
+    (void)f; (void)pairs; (void)invSizes; (void)sizes1; (void)npatterns; (void)maxIdx;
+    (void)ofs0; (void)xend; (void)r_ptr; (void)s_ptr;
 #endif
+    return x;
+}
+
+template <typename iiMatType> class StarDetectorResponsesInvoker : public ParallelLoopBody
+{
+public:
+    StarDetectorResponsesInvoker( const StarFeature<iiMatType>* _f, const int (*_pairs)[2],
+                                  const float (*_invSizes)[2], const int* _sizes1, int _npatterns,
+                                  int _maxIdx, int _border, int _step, Mat& _responses, Mat& _sizes ) :
+        f(_f), pairs(_pairs), invSizes(_invSizes), sizes1(_sizes1), npatterns(_npatterns),
+        maxIdx(_maxIdx), border(_border), step(_step), responses(_responses), sizes(_sizes)
+    {
+    }
 
-    struct StarFeature
+    void operator()( const Range& range ) const
     {
-        int area;
-        iiMatType* p[8];
-    };
+        int rows = responses.rows, cols = responses.cols;
+
+        for( int y = range.start; y < range.end; y++ )
+        {
+            float* r_ptr = responses.ptr<float>(y);
+            short* s_ptr = sizes.ptr<short>(y);
+
+            if( y < border || y >= rows - border )
+            {
+                memset( r_ptr, 0, cols*sizeof(r_ptr[0]));
+                memset( s_ptr, 0, cols*sizeof(s_ptr[0]));
+                continue;
+            }
+
+            memset( r_ptr, 0, border*sizeof(r_ptr[0]));
+            memset( s_ptr, 0, border*sizeof(s_ptr[0]));
+            memset( r_ptr + cols - border, 0, border*sizeof(r_ptr[0]));
+            memset( s_ptr + cols - border, 0, border*sizeof(s_ptr[0]));
+
+            int x = StarDetectorResponsesRowSIMD( f, pairs, invSizes, sizes1, npatterns, maxIdx,
+                                                  y*step, border, cols - border, r_ptr, s_ptr );
+
+            for( ; x < cols - border; x++ )
+            {
+                int ofs = y*step + x;
+                int vals[STAR_MAX_PATTERN];
+                float bestResponse = 0;
+                int bestSize = 0;
+
+                for(int i = 0; i <= maxIdx; i++ )
+                {
+                    const iiMatType* const* p = (const iiMatType* const*)&f[i].p[0];
+                    vals[i] = (int)(p[0][ofs] - p[1][ofs] - p[2][ofs] + p[3][ofs] +
+                        p[4][ofs] - p[5][ofs] - p[6][ofs] + p[7][ofs]);
+                }
+                for(int i = 0; i < npatterns; i++ )
+                {
+                    int inner_sum = vals[pairs[i][1]];
+                    int outer_sum = vals[pairs[i][0]] - inner_sum;
+                    float response = inner_sum*invSizes[i][1] - outer_sum*invSizes[i][0];
+                    if( fabs(response) > fabs(bestResponse) )
+                    {
+                        bestResponse = response;
+                        bestSize = sizes1[pairs[i][0]];
+                    }
+                }
 
-    StarFeature f[MAX_PATTERN];
+                r_ptr[x] = bestResponse;
+                s_ptr[x] = (short)bestSize;
+            }
+        }
+    }
+
+private:
+    const StarFeature<iiMatType>* f;
+    const int (*pairs)[2];
+    const float (*invSizes)[2];
+    const int* sizes1;
+    int npatterns, maxIdx, border, step;
+    Mat& responses;
+    Mat& sizes;
+};
+
+template <typename iiMatType> static int
+StarDetectorComputeResponses( const Mat& img, Mat& responses, Mat& sizes,
+                              int maxSize, int iiType )
+{
+    static const int sizes0[] = {1, 2, 3, 4, 6, 8, 11, 12, 16, 22, 23, 32, 45, 46, 64, 90, 128, -1};
+    static const int pairs[STAR_MAX_PAIR][2] = {{1, 0}, {3, 1}, {4, 2}, {5, 3}, {7, 4}, {8, 5}, {9, 6},
+                                                {11, 8}, {13, 10}, {14, 11}, {15, 12}, {16, 14}};
+    float invSizes[STAR_MAX_PATTERN][2];
+    int sizes1[STAR_MAX_PATTERN];
+
+    StarFeature<iiMatType> f[STAR_MAX_PATTERN];
 
     Mat sum, tilted, flatTilted;
-    int y, rows = img.rows, cols = img.cols;
+    int rows = img.rows, cols = img.cols;
     int border, npatterns=0, maxIdx=0;
 
     responses.create( img.size(), CV_32F );
     sizes.create( img.size(), CV_16S );
 
-    while( npatterns < MAX_PAIR && !
+    while( npatterns < STAR_MAX_PAIR && !
           ( sizes0[pairs[npatterns][0]] >= maxSize
            || sizes0[pairs[npatterns+1][0]] + sizes0[pairs[npatterns+1][0]]/2 >= std::min(rows, cols) ) )
     {
         ++npatterns;
     }
 
-    if (npatterns-1 < MAX_PAIR)
+    if (npatterns-1 < STAR_MAX_PAIR)
         ++npatterns;
     maxIdx = pairs[npatterns-1][0];
 
@@ -232,119 +358,12 @@ StarDetectorComputeResponses( const Mat& img, Mat& responses, Mat& sizes,
         invSizes[i][1] = 1.f/innerArea;
     }
 
-#if CV_SSE2
-    if( useSIMD )
-    {
-        for(int i = 0; i < npatterns; i++ )
-        {
-            _mm_store_ps((float*)&invSizes4[i][0], _mm_set1_ps(invSizes[i][0]));
-            _mm_store_ps((float*)&invSizes4[i][1], _mm_set1_ps(invSizes[i][1]));
-        }
-
-        for(int i = 0; i <= maxIdx; i++ )
-            _mm_store_ps((float*)&sizes1_4[i], _mm_set1_ps((float)sizes1[i]));
-    }
-#endif
-
-    for( y = 0; y < border; y++ )
-    {
-        float* r_ptr = responses.ptr<float>(y);
-        float* r_ptr2 = responses.ptr<float>(rows - 1 - y);
-        short* s_ptr = sizes.ptr<short>(y);
-        short* s_ptr2 = sizes.ptr<short>(rows - 1 - y);
-
-        memset( r_ptr, 0, cols*sizeof(r_ptr[0]));
-        memset( r_ptr2, 0, cols*sizeof(r_ptr2[0]));
-        memset( s_ptr, 0, cols*sizeof(s_ptr[0]));
-        memset( s_ptr2, 0, cols*sizeof(s_ptr2[0]));
-    }
-
-    for( y = border; y < rows - border; y++ )
-    {
-        int x = border;
-        float* r_ptr = responses.ptr<float>(y);
-        short* s_ptr = sizes.ptr<short>(y);
-
-        memset( r_ptr, 0, border*sizeof(r_ptr[0]));
-        memset( s_ptr, 0, border*sizeof(s_ptr[0]));
-        memset( r_ptr + cols - border, 0, border*sizeof(r_ptr[0]));
-        memset( s_ptr + cols - border, 0, border*sizeof(s_ptr[0]));
-
-#if CV_SSE2
-        if( useSIMD )
-        {
-            __m128 absmask4 = _mm_set1_ps(absmask.f);
-            for( ; x <= cols - border - 4; x += 4 )
-            {
-                int ofs = y*step + x;
-                __m128 vals[MAX_PATTERN];
-                __m128 bestResponse = _mm_setzero_ps();
-                __m128 bestSize = _mm_setzero_ps();
-
-                for(int i = 0; i <= maxIdx; i++ )
-                {
-                    const iiMatType** p = (const iiMatType**)&f[i].p[0];
-                    __m128i r0 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[0]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[1]+ofs)));
-                    __m128i r1 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[3]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[2]+ofs)));
-                    __m128i r2 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[4]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[5]+ofs)));
-                    __m128i r3 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[7]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[6]+ofs)));
-                    r0 = _mm_add_epi32(_mm_add_epi32(r0,r1), _mm_add_epi32(r2,r3));
-                    _mm_store_ps((float*)&vals[i], _mm_cvtepi32_ps(r0));
-                }
-
-                for(int i = 0; i < npatterns; i++ )
-                {
-                    __m128 inner_sum = vals[pairs[i][1]];
-                    __m128 outer_sum = _mm_sub_ps(vals[pairs[i][0]], inner_sum);
-                    __m128 response = _mm_sub_ps(_mm_mul_ps(inner_sum, invSizes4[i][1]),
-                        _mm_mul_ps(outer_sum, invSizes4[i][0]));
-                    __m128 swapmask = _mm_cmpgt_ps(_mm_and_ps(response,absmask4),
-                        _mm_and_ps(bestResponse,absmask4));
-                    bestResponse = _mm_xor_ps(bestResponse,
-                        _mm_and_ps(_mm_xor_ps(response,bestResponse), swapmask));
-                    bestSize = _mm_xor_ps(bestSize,
-                        _mm_and_ps(_mm_xor_ps(sizes1_4[pairs[i][0]], bestSize), swapmask));
-                }
-
-                _mm_storeu_ps(r_ptr + x, bestResponse);
-                _mm_storel_epi64((__m128i*)(s_ptr + x),
-                    _mm_packs_epi32(_mm_cvtps_epi32(bestSize),_mm_setzero_si128()));
-            }
-        }
-#endif
-        for( ; x < cols - border; x++ )
-        {
-            int ofs = y*step + x;
-            int vals[MAX_PATTERN];
-            float bestResponse = 0;
-            int bestSize = 0;
-
-            for(int i = 0; i <= maxIdx; i++ )
-            {
-                const iiMatType** p = (const iiMatType**)&f[i].p[0];
-                vals[i] = (int)(p[0][ofs] - p[1][ofs] - p[2][ofs] + p[3][ofs] +
-                    p[4][ofs] - p[5][ofs] - p[6][ofs] + p[7][ofs]);
-            }
-            for(int i = 0; i < npatterns; i++ )
-            {
-                int inner_sum = vals[pairs[i][1]];
-                int outer_sum = vals[pairs[i][0]] - inner_sum;
-                float response = inner_sum*invSizes[i][1] - outer_sum*invSizes[i][0];
-                if( fabs(response) > fabs(bestResponse) )
-                {
-                    bestResponse = response;
-                    bestSize = sizes1[pairs[i][0]];
-                }
-            }
-
-            r_ptr[x] = bestResponse;
-            s_ptr[x] = (short)bestSize;
-        }
-    }
+    // every row takes the best response over all the levels at once, so the rows are split
+    // between the threads rather than the levels
+    parallel_for_( Range(0, rows),
+                   StarDetectorResponsesInvoker<iiMatType>( f, pairs, invSizes, sizes1, npatterns, maxIdx,
+                                                            border, step, responses, sizes ),
+                   rows*(double)cols/(1 << 16) );
 
     return border;
 }
@@ -388,87 +407,167 @@ static bool StarDetectorSuppressLines( const Mat& responses, const Mat& sizes, P
 }
 
 
+// suppresses the tiles starting at row y; colMax receives the largest absolute response of every
+// column of the tile row, so that the tiles without any response above the threshold are skipped at once
 static void
-StarDetectorSuppressNonmax( const Mat& responses, const Mat& sizes,
-                            std::vector<KeyPoint>& keypoints, int border,
-                            int responseThreshold,
-                            int lineThresholdProjected,
-                            int lineThresholdBinarized,
-                            int suppressNonmaxSize )
+StarDetectorSuppressNonmaxRow( const Mat& responses, const Mat& sizes,
+                               std::vector<KeyPoint>& keypoints, int border, int y,
+                               float* colMax,
+                               int responseThreshold,
+                               int lineThresholdProjected,
+                               int lineThresholdBinarized,
+                               int suppressNonmaxSize )
 {
-    int x, y, x1, y1, delta = suppressNonmaxSize/2;
+    int x, y1, x1, delta = suppressNonmaxSize/2;
     int rows = responses.rows, cols = responses.cols;
     const float* r_ptr = responses.ptr<float>();
     int rstep = (int)(responses.step/sizeof(r_ptr[0]));
     const short* s_ptr = sizes.ptr<short>();
     int sstep = (int)(sizes.step/sizeof(s_ptr[0]));
     short featureSize = 0;
+    int tileEndY = MIN(y + delta, rows - border - 1);
+
+    x = border;
+#if CV_SIMD128
+    for( ; x <= cols - border - 4; x += 4 )
+    {
+        v_float32x4 m = v_abs(v_load(r_ptr + y*rstep + x));
+        for( y1 = y + 1; y1 <= tileEndY; y1++ )
+            m = v_max(m, v_abs(v_load(r_ptr + y1*rstep + x)));
+        v_store(colMax + x, m);
+    }
+#endif
+    for( ; x < cols - border; x++ )
+    {
+        float m = std::abs(r_ptr[y*rstep + x]);
+        for( y1 = y + 1; y1 <= tileEndY; y1++ )
+            m = std::max(m, std::abs(r_ptr[y1*rstep + x]));
+        colMax[x] = m;
+    }
 
-    for( y = border; y < rows - border; y += delta+1 )
-        for( x = border; x < cols - border; x += delta+1 )
+    for( x = border; x < cols - border; x += delta+1 )
+    {
+        float maxResponse = (float)responseThreshold;
+        float minResponse = (float)-responseThreshold;
+        Point maxPt(-1, -1), minPt(-1, -1);
+        int tileEndX = MIN(x + delta, cols - border - 1);
+
+        for( x1 = x; x1 <= tileEndX; x1++ )
+            if( colMax[x1] > maxResponse )
+                break;
+        if( x1 > tileEndX )
+            continue;
+
+        for( y1 = y; y1 <= tileEndY; y1++ )
+            for( x1 = x; x1 <= tileEndX; x1++ )
+            {
+                float val = r_ptr[y1*rstep + x1];
+                if( maxResponse < val )
+                {
+                    maxResponse = val;
+                    maxPt = Point(x1, y1);
+                }
+                else if( minResponse > val )
+                {
+                    minResponse = val;
+                    minPt = Point(x1, y1);
+                }
+            }
+
+        if( maxPt.x >= 0 )
         {
-            float maxResponse = (float)responseThreshold;
-            float minResponse = (float)-responseThreshold;
-            Point maxPt(-1, -1), minPt(-1, -1);
-            int tileEndY = MIN(y + delta, rows - border - 1);
-            int tileEndX = MIN(x + delta, cols - border - 1);
-
-            for( y1 = y; y1 <= tileEndY; y1++ )
-                for( x1 = x; x1 <= tileEndX; x1++ )
+            for( y1 = maxPt.y - delta; y1 <= maxPt.y + delta; y1++ )
+                for( x1 = maxPt.x - delta; x1 <= maxPt.x + delta; x1++ )
                 {
                     float val = r_ptr[y1*rstep + x1];
-                    if( maxResponse < val )
-                    {
-                        maxResponse = val;
-                        maxPt = Point(x1, y1);
-                    }
-                    else if( minResponse > val )
-                    {
-                        minResponse = val;
-                        minPt = Point(x1, y1);
-                    }
+                    if( val >= maxResponse && (y1 != maxPt.y || x1 != maxPt.x))
+                        goto skip_max;
                 }
 
-            if( maxPt.x >= 0 )
+            if( (featureSize = s_ptr[maxPt.y*sstep + maxPt.x]) >= 4 &&
+                !StarDetectorSuppressLines( responses, sizes, maxPt, lineThresholdProjected,
+                                            lineThresholdBinarized ))
             {
-                for( y1 = maxPt.y - delta; y1 <= maxPt.y + delta; y1++ )
-                    for( x1 = maxPt.x - delta; x1 <= maxPt.x + delta; x1++ )
-                    {
-                        float val = r_ptr[y1*rstep + x1];
-                        if( val >= maxResponse && (y1 != maxPt.y || x1 != maxPt.x))
-                            goto skip_max;
-                    }
-
-                if( (featureSize = s_ptr[maxPt.y*sstep + maxPt.x]) >= 4 &&
-                    !StarDetectorSuppressLines( responses, sizes, maxPt, lineThresholdProjected,
-                                                lineThresholdBinarized ))
-                {
-                    KeyPoint kpt((float)maxPt.x, (float)maxPt.y, featureSize, -1, maxResponse);
-                    keypoints.push_back(kpt);
-                }
+                KeyPoint kpt((float)maxPt.x, (float)maxPt.y, featureSize, -1, maxResponse);
+                keypoints.push_back(kpt);
             }
-        skip_max:
-            if( minPt.x >= 0 )
-            {
-                for( y1 = minPt.y - delta; y1 <= minPt.y + delta; y1++ )
-                    for( x1 = minPt.x - delta; x1 <= minPt.x + delta; x1++ )
-                    {
-                        float val = r_ptr[y1*rstep + x1];
-                        if( val <= minResponse && (y1 != minPt.y || x1 != minPt.x))
-                            goto skip_min;
-                    }
-
-                if( (featureSize = s_ptr[minPt.y*sstep + minPt.x]) >= 4 &&
-                    !StarDetectorSuppressLines( responses, sizes, minPt,
-                                               lineThresholdProjected, lineThresholdBinarized))
+        }
+    skip_max:
+        if( minPt.x >= 0 )
+        {
+            for( y1 = minPt.y - delta; y1 <= minPt.y + delta; y1++ )
+                for( x1 = minPt.x - delta; x1 <= minPt.x + delta; x1++ )
                 {
-                    KeyPoint kpt((float)minPt.x, (float)minPt.y, featureSize, -1, maxResponse);
-                    keypoints.push_back(kpt);
+                    float val = r_ptr[y1*rstep + x1];
+                    if( val <= minResponse && (y1 != minPt.y || x1 != minPt.x))
+                        goto skip_min;
                 }
+
+            if( (featureSize = s_ptr[minPt.y*sstep + minPt.x]) >= 4 &&
+                !StarDetectorSuppressLines( responses, sizes, minPt,
+                                           lineThresholdProjected, lineThresholdBinarized))
+            {
+                KeyPoint kpt((float)minPt.x, (float)minPt.y, featureSize, -1, maxResponse);
+                keypoints.push_back(kpt);
             }
-        skip_min:
-            ;
         }
+    skip_min:
+        ;
+    }
+}
+
+class StarDetectorSuppressNonmaxInvoker : public ParallelLoopBody
+{
+public:
+    StarDetectorSuppressNonmaxInvoker( const Mat& _responses, const Mat& _sizes,
+                                       std::vector<std::vector<KeyPoint> >& _tileRowKeypoints, int _border,
+                                       int _responseThreshold, int _lineThresholdProjected,
+                                       int _lineThresholdBinarized, int _suppressNonmaxSize ) :
+        responses(_responses), sizes(_sizes), tileRowKeypoints(_tileRowKeypoints), border(_border),
+        responseThreshold(_responseThreshold), lineThresholdProjected(_lineThresholdProjected),
+        lineThresholdBinarized(_lineThresholdBinarized), suppressNonmaxSize(_suppressNonmaxSize)
+    {
+    }
+
+    void operator()( const Range& range ) const
+    {
+        AutoBuffer<float> colMax(responses.cols);
+
+        for( int i = range.start; i < range.end; i++ )
+            StarDetectorSuppressNonmaxRow( responses, sizes, tileRowKeypoints[i], border,
+                                           border + i*(suppressNonmaxSize/2 + 1), colMax,
+                                           responseThreshold, lineThresholdProjected,
+                                           lineThresholdBinarized, suppressNonmaxSize );
+    }
+
+private:
+    const Mat& responses;
+    const Mat& sizes;
+    std::vector<std::vector<KeyPoint> >& tileRowKeypoints;
+    int border, responseThreshold, lineThresholdProjected, lineThresholdBinarized, suppressNonmaxSize;
+};
+
+static void
+StarDetectorSuppressNonmax( const Mat& responses, const Mat& sizes,
+                            std::vector<KeyPoint>& keypoints, int border,
+                            int responseThreshold,
+                            int lineThresholdProjected,
+                            int lineThresholdBinarized,
+                            int suppressNonmaxSize )
+{
+    int tileRows = responses.rows - 2*border, tileStep = suppressNonmaxSize/2 + 1;
+    if( tileRows <= 0 || responses.cols <= 2*border )
+        return;
+
+    // the tile rows are suppressed in parallel and their keypoints joined in order
+    std::vector<std::vector<KeyPoint> > tileRowKeypoints((tileRows + tileStep - 1)/tileStep);
+    parallel_for_( Range(0, (int)tileRowKeypoints.size()),
+                   StarDetectorSuppressNonmaxInvoker( responses, sizes, tileRowKeypoints, border,
+                                                      responseThreshold, lineThresholdProjected,
+                                                      lineThresholdBinarized, suppressNonmaxSize ) );
+
+    for( size_t i = 0; i < tileRowKeypoints.size(); i++ )
+        keypoints.insert( keypoints.end(), tileRowKeypoints[i].begin(), tileRowKeypoints[i].end() );
 }
 
 StarDetectorImpl::StarDetectorImpl(int _maxSize, int _responseThreshold,
@@ -495,10 +594,10 @@ void StarDetectorImpl::detect( InputArray _image, std::vector<KeyPoint>& keypoin
     Mat responses, sizes;
     int border;
 
-    // Use 32-bit integers if we won't overflow in the integral image
-    if ((grayImage.depth() == CV_8U || grayImage.depth() == CV_8S) &&
-        (int)grayImage.total() < 8388608 ) // 8388608 = 2 ^ (32 - 8(bit depth) - 1(sign bit))
-        border = StarDetectorComputeResponses<int>( grayImage, responses, sizes, maxSize, CV_32S );
+    // Use 32-bit integers for 8-bit images whatever their size: the integral images may wrap around,
+    // but the sums over the patterns always fit and are recovered exactly by modular arithmetic
+    if (grayImage.depth() == CV_8U || grayImage.depth() == CV_8S)
+        border = StarDetectorComputeResponses<unsigned>( grayImage, responses, sizes, maxSize, CV_32S );
     else
         border = StarDetectorComputeResponses<double>( grayImage, responses, sizes, maxSize, CV_64F );
 
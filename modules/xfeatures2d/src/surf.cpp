@@ -109,6 +109,7 @@ Modifications by Ian Mahon
 */
 #include "precomp.hpp"
 #include "surf.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -145,6 +146,41 @@ inline float calcHaarPattern( const int* origin, const SurfHF* f, int n )
     return (float)d;
 }
 
+#if CV_SIMD128
+/* Same as calcHaarPattern for 4 consecutive samples which are 'sampleStep'
+ pixels apart. The box sums are exact in int32, only the weighting is done
+ in single precision. */
+inline v_float32x4 calcHaarPattern4( const int* origin, int sampleStep, const SurfHF* f, int n )
+{
+    v_float32x4 d = v_setzero_f32();
+    if( sampleStep == 1 )
+    {
+        for( int k = 0; k < n; k++ )
+        {
+            v_int32x4 s = v_load(origin + f[k].p0) + v_load(origin + f[k].p3) -
+                          v_load(origin + f[k].p1) - v_load(origin + f[k].p2);
+            d += v_cvt_f32(s)*v_setall_f32(f[k].w);
+        }
+    }
+    else
+    {
+        const int* o1 = origin + sampleStep;
+        const int* o2 = o1 + sampleStep;
+        const int* o3 = o2 + sampleStep;
+        for( int k = 0; k < n; k++ )
+        {
+            int p0 = f[k].p0, p1 = f[k].p1, p2 = f[k].p2, p3 = f[k].p3;
+            v_int32x4 s(origin[p0] + origin[p3] - origin[p1] - origin[p2],
+                        o1[p0] + o1[p3] - o1[p1] - o1[p2],
+                        o2[p0] + o2[p3] - o2[p1] - o2[p2],
+                        o3[p0] + o3[p3] - o3[p1] - o3[p2]);
+            d += v_cvt_f32(s)*v_setall_f32(f[k].w);
+        }
+    }
+    return d;
+}
+#endif
+
 static void
 resizeHaarPattern( const int src[][5], SurfHF* dst, int n, int oldSize, int newSize, int widthStep )
 {
@@ -196,7 +232,25 @@ static void calcLayerDetAndTrace( const Mat& sum, int size, int sampleStep,
         const int* sum_ptr = sum.ptr<int>(i*sampleStep);
         float* det_ptr = &det.at<float>(i+margin, margin);
         float* trace_ptr = &trace.at<float>(i+margin, margin);
-        for( int j = 0; j < samples_j; j++ )
+        int j = 0;
+#if CV_SIMD128
+        v_float32x4 v_081 = v_setall_f32(0.81f);
+        for( ; j <= samples_j - 8; j += 8, sum_ptr += 8*sampleStep )
+        {
+            const int* sum_ptr1 = sum_ptr + 4*sampleStep;
+            v_float32x4 dx0  = calcHaarPattern4( sum_ptr, sampleStep, Dx , 3 );
+            v_float32x4 dy0  = calcHaarPattern4( sum_ptr, sampleStep, Dy , 3 );
+            v_float32x4 dxy0 = calcHaarPattern4( sum_ptr, sampleStep, Dxy, 4 );
+            v_float32x4 dx1  = calcHaarPattern4( sum_ptr1, sampleStep, Dx , 3 );
+            v_float32x4 dy1  = calcHaarPattern4( sum_ptr1, sampleStep, Dy , 3 );
+            v_float32x4 dxy1 = calcHaarPattern4( sum_ptr1, sampleStep, Dxy, 4 );
+            v_store(det_ptr + j, dx0*dy0 - v_081*dxy0*dxy0);
+            v_store(det_ptr + j + 4, dx1*dy1 - v_081*dxy1*dxy1);
+            v_store(trace_ptr + j, dx0 + dy0);
+            v_store(trace_ptr + j + 4, dx1 + dy1);
+        }
+#endif
+        for( ; j < samples_j; j++ )
         {
             float dx  = calcHaarPattern( sum_ptr, Dx , 3 );
             float dy  = calcHaarPattern( sum_ptr, Dy , 3 );
@@ -577,6 +631,8 @@ struct SURFInvoker : ParallelLoopBody
         float X[nOriSampleBound], Y[nOriSampleBound], angle[nOriSampleBound];
         uchar PATCH[PATCH_SZ+1][PATCH_SZ+1];
         float DX[PATCH_SZ][PATCH_SZ], DY[PATCH_SZ][PATCH_SZ];
+        // per column sums of the descriptor bins over a row of subregions
+        float SUMS[8][PATCH_SZ];
         Mat _patch(PATCH_SZ+1, PATCH_SZ+1, CV_8U, PATCH);
 
         int dsize = extended ? 128 : 64;
@@ -774,7 +830,21 @@ struct SURFInvoker : ParallelLoopBody
 
             // Calculate gradients in x and y with wavelets of size 2s
             for( i = 0; i < PATCH_SZ; i++ )
-                for( j = 0; j < PATCH_SZ; j++ )
+            {
+                j = 0;
+#if CV_SIMD128
+                for( ; j <= PATCH_SZ - 4; j += 4 )
+                {
+                    v_float32x4 p00 = v_cvt_f32(v_reinterpret_as_s32(v_load_expand_q(&PATCH[i][j])));
+                    v_float32x4 p01 = v_cvt_f32(v_reinterpret_as_s32(v_load_expand_q(&PATCH[i][j+1])));
+                    v_float32x4 p10 = v_cvt_f32(v_reinterpret_as_s32(v_load_expand_q(&PATCH[i+1][j])));
+                    v_float32x4 p11 = v_cvt_f32(v_reinterpret_as_s32(v_load_expand_q(&PATCH[i+1][j+1])));
+                    v_float32x4 dw = v_load(&DW[i*PATCH_SZ + j]);
+                    v_store(&DX[i][j], (p01 - p00 + p11 - p10)*dw);
+                    v_store(&DY[i][j], (p10 - p00 + p11 - p01)*dw);
+                }
+#endif
+                for( ; j < PATCH_SZ; j++ )
                 {
                     float dw = DW[i*PATCH_SZ + j];
                     float vx = (PATCH[i][j+1] - PATCH[i][j] + PATCH[i+1][j+1] - PATCH[i+1][j])*dw;
@@ -782,65 +852,93 @@ struct SURFInvoker : ParallelLoopBody
                     DX[i][j] = vx;
                     DY[i][j] = vy;
                 }
+            }
 
-            // Construct the descriptor
+            // Construct the descriptor. The responses of each row of 4x4 subregions
+            // are first summed over the 5 rows of the subregions, separately for
+            // every column and every bin, and then over the 5 columns of each subregion.
+            int nbins = extended ? 8 : 4;
             vec = descriptors->ptr<float>(k);
-            for( kk = 0; kk < dsize; kk++ )
-                vec[kk] = 0;
             double square_mag = 0;
-            if( extended )
+            for( i = 0; i < 4; i++ )
             {
-                // 128-bin descriptor
-                for( i = 0; i < 4; i++ )
-                    for( j = 0; j < 4; j++ )
+                int x = 0;
+#if CV_SIMD128
+                for( ; x <= PATCH_SZ - 4; x += 4 )
+                {
+                    v_float32x4 z = v_setzero_f32();
+                    v_float32x4 s0 = z, s1 = z, s2 = z, s3 = z, s4 = z, s5 = z, s6 = z, s7 = z;
+                    for( int y = i*5; y < i*5+5; y++ )
                     {
-                        for(int y = i*5; y < i*5+5; y++ )
+                        v_float32x4 tx = v_load(&DX[y][x]), ty = v_load(&DY[y][x]);
+                        v_float32x4 atx = v_abs(tx), aty = v_abs(ty);
+                        if( extended )
                         {
-                            for(int x = j*5; x < j*5+5; x++ )
-                            {
-                                float tx = DX[y][x], ty = DY[y][x];
-                                if( ty >= 0 )
-                                {
-                                    vec[0] += tx;
-                                    vec[1] += (float)fabs(tx);
-                                } else {
-                                    vec[2] += tx;
-                                    vec[3] += (float)fabs(tx);
-                                }
-                                if ( tx >= 0 )
-                                {
-                                    vec[4] += ty;
-                                    vec[5] += (float)fabs(ty);
-                                } else {
-                                    vec[6] += ty;
-                                    vec[7] += (float)fabs(ty);
-                                }
-                            }
+                            // 128-bin descriptor, the masked parts go to the "ty >= 0" and "tx >= 0" bins
+                            v_float32x4 mx = ty >= z, my = tx >= z;
+                            v_float32x4 tx0 = tx & mx, atx0 = atx & mx;
+                            v_float32x4 ty0 = ty & my, aty0 = aty & my;
+                            s0 += tx0; s1 += atx0; s2 += tx - tx0; s3 += atx - atx0;
+                            s4 += ty0; s5 += aty0; s6 += ty - ty0; s7 += aty - aty0;
+                        }
+                        else
+                        {
+                            // 64-bin descriptor
+                            s0 += tx; s1 += ty; s2 += atx; s3 += aty;
                         }
-                        for( kk = 0; kk < 8; kk++ )
-                            square_mag += vec[kk]*vec[kk];
-                        vec += 8;
                     }
-            }
-            else
-            {
-                // 64-bin descriptor
-                for( i = 0; i < 4; i++ )
-                    for( j = 0; j < 4; j++ )
+                    v_store(&SUMS[0][x], s0); v_store(&SUMS[1][x], s1);
+                    v_store(&SUMS[2][x], s2); v_store(&SUMS[3][x], s3);
+                    v_store(&SUMS[4][x], s4); v_store(&SUMS[5][x], s5);
+                    v_store(&SUMS[6][x], s6); v_store(&SUMS[7][x], s7);
+                }
+#endif
+                for( ; x < PATCH_SZ; x++ )
+                {
+                    for( kk = 0; kk < nbins; kk++ )
+                        SUMS[kk][x] = 0;
+                    for( int y = i*5; y < i*5+5; y++ )
                     {
-                        for(int y = i*5; y < i*5+5; y++ )
+                        float tx = DX[y][x], ty = DY[y][x];
+                        if( extended )
                         {
-                            for(int x = j*5; x < j*5+5; x++ )
+                            // 128-bin descriptor
+                            if( ty >= 0 )
                             {
-                                float tx = DX[y][x], ty = DY[y][x];
-                                vec[0] += tx; vec[1] += ty;
-                                vec[2] += (float)fabs(tx); vec[3] += (float)fabs(ty);
+                                SUMS[0][x] += tx;
+                                SUMS[1][x] += (float)fabs(tx);
+                            } else {
+                                SUMS[2][x] += tx;
+                                SUMS[3][x] += (float)fabs(tx);
                             }
+                            if ( tx >= 0 )
+                            {
+                                SUMS[4][x] += ty;
+                                SUMS[5][x] += (float)fabs(ty);
+                            } else {
+                                SUMS[6][x] += ty;
+                                SUMS[7][x] += (float)fabs(ty);
+                            }
+                        }
+                        else
+                        {
+                            // 64-bin descriptor
+                            SUMS[0][x] += tx; SUMS[1][x] += ty;
+                            SUMS[2][x] += (float)fabs(tx); SUMS[3][x] += (float)fabs(ty);
                         }
-                        for( kk = 0; kk < 4; kk++ )
-                            square_mag += vec[kk]*vec[kk];
-                        vec+=4;
                     }
+                }
+
+                for( j = 0; j < 4; j++ )
+                {
+                    for( kk = 0; kk < nbins; kk++ )
+                    {
+                        const float* col = &SUMS[kk][j*5];
+                        vec[kk] = col[0] + col[1] + col[2] + col[3] + col[4];
+                        square_mag += vec[kk]*vec[kk];
+                    }
+                    vec += nbins;
+                }
             }
 
             // unit vector is essential for contrast invariance
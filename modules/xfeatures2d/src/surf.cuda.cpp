@@ -60,6 +60,9 @@ void cv::cuda::SURF_CUDA::operator()(const GpuMat&, const GpuMat&, GpuMat&, GpuM
 void cv::cuda::SURF_CUDA::operator()(const GpuMat&, const GpuMat&, std::vector<KeyPoint>&) { throw_no_cuda(); }
 void cv::cuda::SURF_CUDA::operator()(const GpuMat&, const GpuMat&, std::vector<KeyPoint>&, GpuMat&, bool) { throw_no_cuda(); }
 void cv::cuda::SURF_CUDA::operator()(const GpuMat&, const GpuMat&, std::vector<KeyPoint>&, std::vector<float>&, bool) { throw_no_cuda(); }
+void cv::cuda::SURF_CUDA::operator()(const GpuMat&, const GpuMat&, GpuMat&, Stream&) { throw_no_cuda(); }
+void cv::cuda::SURF_CUDA::operator()(const GpuMat&, const GpuMat&, GpuMat&, GpuMat&, bool, Stream&) { throw_no_cuda(); }
+void cv::cuda::SURF_CUDA::uploadImage(const Mat&, GpuMat&, Stream&) { throw_no_cuda(); }
 void cv::cuda::SURF_CUDA::releaseMemory() { throw_no_cuda(); }
 
 #else // !defined (HAVE_CUDA)
@@ -68,26 +71,26 @@ namespace cv { namespace cuda { namespace device
 {
     namespace surf
     {
-        void loadGlobalConstants(int maxCandidates, int maxFeatures, int img_rows, int img_cols, int nOctaveLayers, float hessianThreshold);
-        void loadOctaveConstants(int octave, int layer_rows, int layer_cols);
+        void loadGlobalConstants(int maxCandidates, int maxFeatures, int img_rows, int img_cols, int nOctaveLayers, float hessianThreshold, cudaStream_t stream);
+        void loadOctaveConstants(int octave, int layer_rows, int layer_cols, cudaStream_t stream);
 
         void bindImgTex(PtrStepSzb img);
         size_t bindSumTex(PtrStepSz<unsigned int> sum);
         size_t bindMaskSumTex(PtrStepSz<unsigned int> maskSum);
 
         void icvCalcLayerDetAndTrace_gpu(const PtrStepf& det, const PtrStepf& trace, int img_rows, int img_cols,
-            int octave, int nOctaveLayer);
+            int octave, int nOctaveLayer, cudaStream_t stream);
 
         void icvFindMaximaInLayer_gpu(const PtrStepf& det, const PtrStepf& trace, int4* maxPosBuffer, unsigned int* maxCounter,
-            int img_rows, int img_cols, int octave, bool use_mask, int nLayers);
+            int img_rows, int img_cols, int octave, bool use_mask, int nLayers, cudaStream_t stream);
 
         void icvInterpolateKeypoint_gpu(const PtrStepf& det, const int4* maxPosBuffer, unsigned int maxCounter,
             float* featureX, float* featureY, int* featureLaplacian, int* featureOctave, float* featureSize, float* featureHessian,
-            unsigned int* featureCounter);
+            unsigned int* featureCounter, cudaStream_t stream);
 
-        void icvCalcOrientation_gpu(const float* featureX, const float* featureY, const float* featureSize, float* featureDir, int nFeatures);
+        void icvCalcOrientation_gpu(const float* featureX, const float* featureY, const float* featureSize, float* featureDir, int nFeatures, cudaStream_t stream);
 
-        void compute_descriptors_gpu(PtrStepSz<float4> descriptors, const float* featureX, const float* featureY, const float* featureSize, const float* featureDir, int nFeatures);
+        void compute_descriptors_gpu(PtrStepSz<float4> descriptors, const float* featureX, const float* featureY, const float* featureSize, const float* featureDir, int nFeatures, cudaStream_t stream);
     }
 }}}
 
@@ -97,6 +100,14 @@ namespace
 {
     Mutex mtx;
 
+    // The kernels read the global textures and constants, so the next call must not rebind them
+    // until the work of the previous one is done. It is recorded to this event at the end of each call.
+    Event& lastCallEvent()
+    {
+        static Event event(Event::DISABLE_TIMING);
+        return event;
+    }
+
     int calcSize(int octave, int layer)
     {
         /* Wavelet size at first layer of first octave. */
@@ -115,8 +126,8 @@ namespace
     class SURF_CUDA_Invoker
     {
     public:
-        SURF_CUDA_Invoker(cv::cuda::SURF_CUDA& surf, const GpuMat& img, const GpuMat& mask) :
-            surf_(surf),
+        SURF_CUDA_Invoker(cv::cuda::SURF_CUDA& surf, const GpuMat& img, const GpuMat& mask, Stream& stream) :
+            surf_(surf), stream_(stream), cudaStream(StreamAccessor::getStream(stream)),
             img_cols(img.cols), img_rows(img.rows),
             use_mask(!mask.empty())
         {
@@ -139,24 +150,33 @@ namespace
 
             CV_Assert(maxFeatures > 0);
 
-            counters.create(1, surf_.nOctaves + 1, CV_32SC1);
-            counters.setTo(Scalar::all(0));
+            ensureSizeIsEnough(1, surf_.nOctaves + 1, CV_32SC1, surf_.counters);
+            surf_.counters.setTo(Scalar::all(0), stream_);
+            surf_.countersHost.create(1, surf_.nOctaves + 1, CV_32SC1);
+
+            // the previous call may still use the textures and constants in another stream
+            lastCallEvent().waitForCompletion();
 
-            loadGlobalConstants(maxCandidates, maxFeatures, img_rows, img_cols, surf_.nOctaveLayers, static_cast<float>(surf_.hessianThreshold));
+            loadGlobalConstants(maxCandidates, maxFeatures, img_rows, img_cols, surf_.nOctaveLayers, static_cast<float>(surf_.hessianThreshold), cudaStream);
 
             bindImgTex(img);
 
-            cuda::integral(img, surf_.sum);
+            cuda::integral(img, surf_.sum, stream_);
             sumOffset = bindSumTex(surf_.sum);
 
             if (use_mask)
             {
-                cuda::min(mask, 1.0, surf_.mask1);
-                cuda::integral(surf_.mask1, surf_.maskSum);
+                cuda::min(mask, 1.0, surf_.mask1, stream_);
+                cuda::integral(surf_.mask1, surf_.maskSum, stream_);
                 maskOffset = bindMaskSumTex(surf_.maskSum);
             }
         }
 
+        ~SURF_CUDA_Invoker()
+        {
+            lastCallEvent().record(stream_);
+        }
+
         void detectKeypoints(GpuMat& keypoints)
         {
             ensureSizeIsEnough(img_rows * (surf_.nOctaveLayers + 2), img_cols, CV_32FC1, surf_.det);
@@ -164,21 +184,22 @@ namespace
 
             ensureSizeIsEnough(1, maxCandidates, CV_32SC4, surf_.maxPosBuffer);
             ensureSizeIsEnough(SURF_CUDA::ROWS_COUNT, maxFeatures, CV_32FC1, keypoints);
-            keypoints.setTo(Scalar::all(0));
+            keypoints.setTo(Scalar::all(0), stream_);
+
+            unsigned int* counters = surf_.counters.ptr<unsigned int>();
 
             for (int octave = 0; octave < surf_.nOctaves; ++octave)
             {
                 const int layer_rows = img_rows >> octave;
                 const int layer_cols = img_cols >> octave;
-                loadOctaveConstants(octave, layer_rows, layer_cols);
+                loadOctaveConstants(octave, layer_rows, layer_cols, cudaStream);
 
-                icvCalcLayerDetAndTrace_gpu(surf_.det, surf_.trace, img_rows, img_cols, octave, surf_.nOctaveLayers);
+                icvCalcLayerDetAndTrace_gpu(surf_.det, surf_.trace, img_rows, img_cols, octave, surf_.nOctaveLayers, cudaStream);
 
-                icvFindMaximaInLayer_gpu(surf_.det, surf_.trace, surf_.maxPosBuffer.ptr<int4>(), counters.ptr<unsigned int>() + 1 + octave,
-                    img_rows, img_cols, octave, use_mask, surf_.nOctaveLayers);
+                icvFindMaximaInLayer_gpu(surf_.det, surf_.trace, surf_.maxPosBuffer.ptr<int4>(), counters + 1 + octave,
+                    img_rows, img_cols, octave, use_mask, surf_.nOctaveLayers, cudaStream);
 
-                unsigned int maxCounter;
-                cudaSafeCall( cudaMemcpy(&maxCounter, counters.ptr<unsigned int>() + 1 + octave, sizeof(unsigned int), cudaMemcpyDeviceToHost) );
+                unsigned int maxCounter = readCounter(1 + octave);
                 maxCounter = std::min(maxCounter, static_cast<unsigned int>(maxCandidates));
 
                 if (maxCounter > 0)
@@ -187,17 +208,16 @@ namespace
                         keypoints.ptr<float>(SURF_CUDA::X_ROW), keypoints.ptr<float>(SURF_CUDA::Y_ROW),
                         keypoints.ptr<int>(SURF_CUDA::LAPLACIAN_ROW), keypoints.ptr<int>(SURF_CUDA::OCTAVE_ROW),
                         keypoints.ptr<float>(SURF_CUDA::SIZE_ROW), keypoints.ptr<float>(SURF_CUDA::HESSIAN_ROW),
-                        counters.ptr<unsigned int>());
+                        counters, cudaStream);
                 }
             }
-            unsigned int featureCounter;
-            cudaSafeCall( cudaMemcpy(&featureCounter, counters.ptr<unsigned int>(), sizeof(unsigned int), cudaMemcpyDeviceToHost) );
+            unsigned int featureCounter = readCounter(0);
             featureCounter = std::min(featureCounter, static_cast<unsigned int>(maxFeatures));
 
             keypoints.cols = featureCounter;
 
             if (surf_.upright)
-                keypoints.row(SURF_CUDA::ANGLE_ROW).setTo(Scalar::all(360.0 - 90.0));
+                keypoints.row(SURF_CUDA::ANGLE_ROW).setTo(Scalar::all(360.0 - 90.0), stream_);
             else
                 findOrientation(keypoints);
         }
@@ -208,7 +228,7 @@ namespace
             if (nFeatures > 0)
             {
                 icvCalcOrientation_gpu(keypoints.ptr<float>(SURF_CUDA::X_ROW), keypoints.ptr<float>(SURF_CUDA::Y_ROW),
-                    keypoints.ptr<float>(SURF_CUDA::SIZE_ROW), keypoints.ptr<float>(SURF_CUDA::ANGLE_ROW), nFeatures);
+                    keypoints.ptr<float>(SURF_CUDA::SIZE_ROW), keypoints.ptr<float>(SURF_CUDA::ANGLE_ROW), nFeatures, cudaStream);
             }
         }
 
@@ -219,7 +239,7 @@ namespace
             {
                 ensureSizeIsEnough(nFeatures, descriptorSize, CV_32F, descriptors);
                 compute_descriptors_gpu(descriptors, keypoints.ptr<float>(SURF_CUDA::X_ROW), keypoints.ptr<float>(SURF_CUDA::Y_ROW),
-                    keypoints.ptr<float>(SURF_CUDA::SIZE_ROW), keypoints.ptr<float>(SURF_CUDA::ANGLE_ROW), nFeatures);
+                    keypoints.ptr<float>(SURF_CUDA::SIZE_ROW), keypoints.ptr<float>(SURF_CUDA::ANGLE_ROW), nFeatures, cudaStream);
             }
         }
 
@@ -227,7 +247,18 @@ namespace
         SURF_CUDA_Invoker(const SURF_CUDA_Invoker&);
         SURF_CUDA_Invoker& operator =(const SURF_CUDA_Invoker&);
 
+        // the only host synchronization point: the number of candidates defines the next launch
+        unsigned int readCounter(int idx)
+        {
+            unsigned int* dst = surf_.countersHost.createMatHeader().ptr<unsigned int>() + idx;
+            cudaSafeCall( cudaMemcpyAsync(dst, surf_.counters.ptr<unsigned int>() + idx, sizeof(unsigned int), cudaMemcpyDeviceToHost, cudaStream) );
+            stream_.waitForCompletion();
+            return *dst;
+        }
+
         SURF_CUDA& surf_;
+        Stream& stream_;
+        cudaStream_t cudaStream;
 
         int img_cols, img_rows;
 
@@ -238,8 +269,6 @@ namespace
 
         size_t maskOffset;
         size_t sumOffset;
-
-        GpuMat counters;
     };
 }
 
@@ -251,6 +280,7 @@ cv::cuda::SURF_CUDA::SURF_CUDA()
     nOctaveLayers = 2;
     keypointsRatio = 0.01f;
     upright = false;
+    uploadIndex = 0;
 }
 
 cv::cuda::SURF_CUDA::SURF_CUDA(double _threshold, int _nOctaves, int _nOctaveLayers, bool _extended, float _keypointsRatio, bool _upright)
@@ -261,6 +291,7 @@ cv::cuda::SURF_CUDA::SURF_CUDA(double _threshold, int _nOctaves, int _nOctaveLay
     nOctaveLayers = _nOctaveLayers;
     keypointsRatio = _keypointsRatio;
     upright = _upright;
+    uploadIndex = 0;
 }
 
 int cv::cuda::SURF_CUDA::descriptorSize() const
@@ -356,23 +387,34 @@ void cv::cuda::SURF_CUDA::downloadDescriptors(const GpuMat& descriptorsGPU, std:
 }
 
 void cv::cuda::SURF_CUDA::operator()(const GpuMat& img, const GpuMat& mask, GpuMat& keypoints)
+{
+    (*this)(img, mask, keypoints, Stream::Null());
+}
+
+void cv::cuda::SURF_CUDA::operator()(const GpuMat& img, const GpuMat& mask, GpuMat& keypoints, GpuMat& descriptors,
+                                   bool useProvidedKeypoints)
+{
+    (*this)(img, mask, keypoints, descriptors, useProvidedKeypoints, Stream::Null());
+}
+
+void cv::cuda::SURF_CUDA::operator()(const GpuMat& img, const GpuMat& mask, GpuMat& keypoints, Stream& stream)
 {
     AutoLock lock(mtx);
     if (!img.empty())
     {
-        SURF_CUDA_Invoker surf(*this, img, mask);
+        SURF_CUDA_Invoker surf(*this, img, mask, stream);
 
         surf.detectKeypoints(keypoints);
     }
 }
 
 void cv::cuda::SURF_CUDA::operator()(const GpuMat& img, const GpuMat& mask, GpuMat& keypoints, GpuMat& descriptors,
-                                   bool useProvidedKeypoints)
+                                   bool useProvidedKeypoints, Stream& stream)
 {
     AutoLock lock(mtx);
     if (!img.empty())
     {
-        SURF_CUDA_Invoker surf(*this, img, mask);
+        SURF_CUDA_Invoker surf(*this, img, mask, stream);
 
         if (!useProvidedKeypoints)
             surf.detectKeypoints(keypoints);
@@ -420,6 +462,25 @@ void cv::cuda::SURF_CUDA::operator()(const GpuMat& img, const GpuMat& mask, std:
     downloadDescriptors(descriptorsGPU, descriptors);
 }
 
+void cv::cuda::SURF_CUDA::uploadImage(const Mat& frame, GpuMat& img, Stream& stream)
+{
+    CV_Assert(!frame.empty() && frame.type() == CV_8UC1);
+
+    // the buffer could still be copied to the device by the call before the previous one
+    HostMem& buffer = uploadBuffers[uploadIndex];
+    Event& event = uploadEvents[uploadIndex];
+    event.waitForCompletion();
+
+    buffer.create(frame.size(), frame.type());
+    Mat bufferHeader = buffer.createMatHeader();
+    frame.copyTo(bufferHeader);
+
+    img.upload(buffer, stream);
+    event.record(stream);
+
+    uploadIndex ^= 1;
+}
+
 void cv::cuda::SURF_CUDA::releaseMemory()
 {
     sum.release();
@@ -428,6 +489,12 @@ void cv::cuda::SURF_CUDA::releaseMemory()
     det.release();
     trace.release();
     maxPosBuffer.release();
+    counters.release();
+    countersHost.release();
+    uploadEvents[0].waitForCompletion();
+    uploadEvents[1].waitForCompletion();
+    uploadBuffers[0].release();
+    uploadBuffers[1].release();
 }
 
 #endif // !defined (HAVE_CUDA)
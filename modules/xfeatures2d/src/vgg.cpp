@@ -298,7 +298,9 @@ static void get_desc( const Mat Patch, Mat& PatchTrans, int anglebins, bool img_
     Mat GMagT = GMag.t();
 
     // % feature channels
-    PatchTrans = Mat( (int)Patch.total(), anglebins, CV_32F, Scalar::all(0) );
+    // (PatchTrans can be a view into the columns of a batch matrix)
+    PatchTrans.create( (int)Patch.total(), anglebins, CV_32F );
+    PatchTrans.setTo( Scalar::all(0) );
 
     for ( int i = 0; i < anglebins; i++ )
     {
@@ -315,6 +317,12 @@ static void get_desc( const Mat Patch, Mat& PatchTrans, int anglebins, bool img_
 // -------------------------------------------------
 /* VGG interface implementation */
 
+// number of keypoints evaluated together
+static const int VGG_BATCH_SIZE = 32;
+
+// The invoker runs over batches of keypoints. Feature channels of all
+// patches in a batch are stored side by side, so pooling and projection
+// are a single GEMM each for the whole batch.
 struct ComputeVGGInvoker : ParallelLoopBody
 {
     ComputeVGGInvoker( const Mat& _image, Mat* _descriptors,
@@ -322,14 +330,9 @@ struct ComputeVGGInvoker : ParallelLoopBody
                         const Mat& _PRFilters, const Mat& _Proj,
                         const int _anglebins, const bool _img_normalize,
                         const bool _use_scale_orientation, const float _scale_factor )
+      : image( _image ), descriptors( _descriptors ), keypoints( _keypoints ),
+        PRFilters( _PRFilters ), Proj( _Proj )
     {
-      image = _image;
-      keypoints = _keypoints;
-      descriptors = _descriptors;
-
-      Proj = _Proj;
-      PRFilters = _PRFilters;
-
       anglebins = _anglebins;
       scale_factor = _scale_factor;
       img_normalize = _img_normalize;
@@ -338,31 +341,49 @@ struct ComputeVGGInvoker : ParallelLoopBody
 
     void operator ()(const cv::Range& range) const
     {
-      Mat Desc, PatchTrans;
       Mat Patch( 64, 64, CV_32F );
-      for (int k = range.start; k < range.end; k++)
+      // feature channels of the batch: patch pixels x (keypoints*anglebins)
+      Mat PatchTrans( (int)Patch.total(), VGG_BATCH_SIZE*anglebins, CV_32F );
+      Mat Pooled, Features;
+      for (int batch = range.start; batch < range.end; batch++)
       {
-        // sample patch from image
-        get_patch( keypoints[k], Patch, image, use_scale_orientation, scale_factor );
-        // compute transform
-        get_desc( Patch, PatchTrans, anglebins, img_normalize );
+        const int k0 = batch * VGG_BATCH_SIZE;
+        const int nkp = std::min( VGG_BATCH_SIZE, (int) keypoints.size() - k0 );
+        for (int b = 0; b < nkp; b++)
+        {
+          // sample patch from image
+          get_patch( keypoints[k0 + b], Patch, image, use_scale_orientation, scale_factor );
+          // compute transform
+          Mat Trans = PatchTrans.colRange( b*anglebins, (b+1)*anglebins );
+          get_desc( Patch, Trans, anglebins, img_normalize );
+        }
         // pool features
-        Desc = PRFilters * PatchTrans;
-        // crop
-        min( Desc, 1.0f, Desc );
-        // reshape
-        Desc = Desc.reshape( 1, (int)Desc.total() );
+        gemm( PRFilters, PatchTrans.colRange( 0, nkp*anglebins ), 1, noArray(), 0, Pooled );
+        // crop & reshape, one row of (pool regions x anglebins) per keypoint
+        const int nPR = Pooled.rows;
+        Features.create( nkp, nPR*anglebins, CV_32F );
+        for (int r = 0; r < nPR; r++)
+        {
+          const float* pooled = Pooled.ptr<float>(r);
+          for (int b = 0; b < nkp; b++)
+          {
+            float* feat = Features.ptr<float>(b) + r*anglebins;
+            for (int i = 0; i < anglebins; i++)
+              feat[i] = std::min( pooled[b*anglebins + i], 1.0f );
+          }
+        }
         // project
-        descriptors->row( k ) = Desc.t() * Proj.t();
+        Mat Desc = descriptors->rowRange( k0, k0 + nkp );
+        gemm( Features, Proj, 1, noArray(), 0, Desc, GEMM_2_T );
       }
     }
 
-    Mat image;
+    const Mat& image;
     Mat *descriptors;
-    vector<KeyPoint> keypoints;
+    const vector<KeyPoint>& keypoints;
 
-    Mat Proj;
-    Mat PRFilters;
+    const Mat& PRFilters;
+    const Mat& Proj;
 
     int anglebins;
     float scale_factor;
@@ -402,7 +423,8 @@ void VGG_Impl::compute( InputArray _image, vector<KeyPoint>& keypoints, OutputAr
     Mat descriptors = _descriptors.getMat();
     descriptors.setTo( Scalar(0) );
 
-    parallel_for_( Range( 0, (int) keypoints.size() ),
+    int nbatches = ( (int) keypoints.size() + VGG_BATCH_SIZE - 1 ) / VGG_BATCH_SIZE;
+    parallel_for_( Range( 0, nbatches ),
         ComputeVGGInvoker( m_image, &descriptors, keypoints, m_PRFilters, m_Proj,
                             m_anglebins, m_img_normalize, m_use_scale_orientation,
                             m_scale_factor )
@@ -997,6 +997,31 @@ TEST( Features2d_Detector_STAR, regression )
     test.safe_run();
 }
 
+TEST( Features2d_Detector_STAR, largeImage )
+{
+    string path = string(cvtest::TS::ptr()->get_data_path() + "detectors_descriptors_evaluation/images_datasets/graf");
+    Mat img = imread(path + "/img1.png", 0);
+    ASSERT_FALSE(img.empty());
+
+    // more than 2^23 pixels, the 8-bit integral images wrap around while the 16-bit ones are kept in doubles
+    Mat img8u, img16u;
+    resize(img, img8u, Size(4096, 2560));
+    img8u.convertTo(img16u, CV_16U);
+
+    Ptr<StarDetector> detector = StarDetector::create();
+    vector<KeyPoint> keypoints8u, keypoints16u;
+    detector->detect(img8u, keypoints8u);
+    detector->detect(img16u, keypoints16u);
+
+    ASSERT_FALSE(keypoints8u.empty());
+    ASSERT_EQ(keypoints16u.size(), keypoints8u.size());
+    for( size_t i = 0; i < keypoints8u.size(); i++ )
+    {
+        EXPECT_EQ(keypoints16u[i].pt, keypoints8u[i].pt);
+        EXPECT_EQ(keypoints16u[i].size, keypoints8u[i].size);
+    }
+}
+
 TEST( Features2d_Detector_Harris_Laplace, regression )
 {
     CV_FeatureDetectorTest test( "detector-harris-laplace", HarrisLaplaceFeatureDetector::create() );
@@ -1361,6 +1386,74 @@ TEST(DISABLED_Features2d_SURF_using_mask, regression)
     test.safe_run();
 }
 
+TEST( Features2d_SIFT, reproducibility )
+{
+    string path = string(cvtest::TS::ptr()->get_data_path() + "detectors_descriptors_evaluation/images_datasets/graf");
+    Mat img1 = imread(path + "/img1.png", 0), img2 = imread(path + "/img2.png", 0);
+    ASSERT_FALSE(img1.empty());
+    ASSERT_FALSE(img2.empty());
+    resize(img2, img2, Size(), 0.5, 0.5);
+
+    int nthreads = getNumThreads();
+    setNumThreads(1);
+    vector<KeyPoint> ref_keypoints;
+    Mat ref_descriptors;
+    SIFT::create()->detectAndCompute(img1, noArray(), ref_keypoints, ref_descriptors);
+    setNumThreads(nthreads);
+
+    // the same detector on images of different sizes, which reallocates the pyramid buffers
+    Ptr<SIFT> sift = SIFT::create();
+    vector<KeyPoint> keypoints;
+    Mat descriptors;
+    sift->detectAndCompute(img1, noArray(), keypoints, descriptors);
+    sift->detectAndCompute(img2, noArray(), keypoints, descriptors);
+    sift->detectAndCompute(img1, noArray(), keypoints, descriptors);
+
+    ASSERT_EQ(ref_keypoints.size(), keypoints.size());
+    for( size_t i = 0; i < keypoints.size(); i++ )
+    {
+        EXPECT_EQ(ref_keypoints[i].pt, keypoints[i].pt);
+        EXPECT_EQ(ref_keypoints[i].octave, keypoints[i].octave);
+    }
+    EXPECT_EQ(0, cvtest::norm(ref_descriptors, descriptors, NORM_INF));
+}
+
+TEST( Features2d_DAISY, preparedImage )
+{
+    string path = string(cvtest::TS::ptr()->get_data_path() + "detectors_descriptors_evaluation/images_datasets/graf");
+    Mat img1 = imread(path + "/img1.png", 0), img2 = imread(path + "/img2.png", 0);
+    ASSERT_FALSE(img1.empty());
+    ASSERT_FALSE(img2.empty());
+
+    vector<KeyPoint> keypoints;
+    FAST(img1, keypoints, 40);
+    ASSERT_FALSE(keypoints.empty());
+    vector<KeyPoint> half_keypoints(keypoints.begin(), keypoints.begin() + keypoints.size()/2);
+
+    Mat ref_descriptors, ref_half_descriptors, ref_dense;
+    DAISY::create()->compute(img1, keypoints, ref_descriptors);
+    DAISY::create()->compute(img1, half_keypoints, ref_half_descriptors);
+    DAISY::create()->compute(img1, Rect(10, 20, 30, 40), ref_dense);
+
+    // the cached layers are replaced by the ones of the prepared image
+    Ptr<DAISY> daisy = DAISY::create();
+    Mat descriptors;
+    daisy->compute(img2, keypoints, descriptors);
+    daisy->prepareImage(img1);
+    daisy->computePrepared(keypoints, descriptors);
+    EXPECT_EQ(0, cvtest::norm(ref_descriptors, descriptors, NORM_INF));
+    daisy->computePrepared(half_keypoints, descriptors);
+    EXPECT_EQ(0, cvtest::norm(ref_half_descriptors, descriptors, NORM_INF));
+    daisy->computePrepared(Rect(10, 20, 30, 40), descriptors);
+    EXPECT_EQ(0, cvtest::norm(ref_dense, descriptors, NORM_INF));
+    daisy->compute(img1, keypoints, descriptors);
+    EXPECT_EQ(0, cvtest::norm(ref_descriptors, descriptors, NORM_INF));
+
+    daisy->prepareImage(img1, true);
+    daisy->computePrepared(keypoints, descriptors);
+    EXPECT_LE(cvtest::norm(ref_descriptors, descriptors, NORM_L2), 1e-2 * cvtest::norm(ref_descriptors, NORM_L2));
+}
+
 TEST( XFeatures2d_DescriptorExtractor, batch )
 {
     string path = string(cvtest::TS::ptr()->get_data_path() + "detectors_descriptors_evaluation/images_datasets/graf");
@@ -1388,3 +1481,40 @@ TEST( XFeatures2d_DescriptorExtractor, batch )
         EXPECT_GT(descriptors[i].rows, 100);
     }
 }
+
+TEST( Features2d_PCTSignaturesSQFD, nearestSignatures )
+{
+    RNG rng(12345);
+    vector<Mat> signatures(150);
+    for( size_t i = 0; i < signatures.size(); i++ )
+    {
+        signatures[i].create(1 + rng.uniform(0, 20), 8, CV_32F);
+        rng.fill(signatures[i], RNG::UNIFORM, 0, 1);
+    }
+
+    int distances[] = { PCTSignatures::L1, PCTSignatures::L2 };
+    for( int d = 0; d < 2; d++ )
+    {
+        Ptr<PCTSignaturesSQFD> sqfd = PCTSignaturesSQFD::create(distances[d], PCTSignatures::HEURISTIC, 1.0f);
+
+        vector<float> all;
+        sqfd->computeQuadraticFormDistances(signatures[0], signatures, all);
+        ASSERT_EQ(signatures.size(), all.size());
+        for( size_t i = 0; i < signatures.size(); i += 37 )
+            EXPECT_EQ(sqfd->computeQuadraticFormDistance(signatures[0], signatures[i]), all[i]);
+
+        vector<int> indices;
+        vector<float> nearest;
+        sqfd->computeNearestSignatures(signatures[0], signatures, 10, indices, nearest);
+        ASSERT_EQ(10, (int)indices.size());
+        ASSERT_EQ(10, (int)nearest.size());
+
+        vector<float> sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+        for( int i = 0; i < 10; i++ )
+        {
+            EXPECT_EQ(all[indices[i]], nearest[i]);
+            EXPECT_EQ(sorted[i], nearest[i]);
+        }
+    }
+}
@@ -171,6 +171,44 @@ CUDA_TEST_P(SURF, Descriptor)
     EXPECT_GT(matchedRatio, 0.6);
 }
 
+CUDA_TEST_P(SURF, Async)
+{
+    cv::Mat image = readImage("../gpu/features2d/aloe.png", cv::IMREAD_GRAYSCALE);
+    ASSERT_FALSE(image.empty());
+
+    cv::cuda::SURF_CUDA surf;
+    surf.hessianThreshold = hessianThreshold;
+    surf.nOctaves = nOctaves;
+    surf.nOctaveLayers = nOctaveLayers;
+    surf.extended = extended;
+    surf.upright = upright;
+    surf.keypointsRatio = 0.05f;
+
+    std::vector<cv::KeyPoint> keypoints_gold;
+    surf(loadMat(image), cv::cuda::GpuMat(), keypoints_gold);
+
+    cv::cuda::Stream stream;
+    cv::cuda::GpuMat d_image[2], keypoints[2], descriptors[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        surf.uploadImage(image, d_image[i], stream);
+        surf(d_image[i], cv::cuda::GpuMat(), keypoints[i], descriptors[i], false, stream);
+    }
+    stream.waitForCompletion();
+
+    // the order of the keypoints depends on the scheduling of the blocks, so they are compared as sets
+    for (int i = 0; i < 2; ++i)
+    {
+        std::vector<cv::KeyPoint> h_keypoints;
+        surf.downloadKeypoints(keypoints[i], h_keypoints);
+
+        ASSERT_EQ(keypoints_gold.size(), h_keypoints.size());
+        EXPECT_EQ(static_cast<int>(h_keypoints.size()), descriptors[i].rows);
+        int matchedCount = getMatchedPointsCount(keypoints_gold, h_keypoints);
+        EXPECT_EQ(static_cast<int>(keypoints_gold.size()), matchedCount);
+    }
+}
+
 INSTANTIATE_TEST_CASE_P(CUDA_Features2D, SURF, testing::Combine(
     testing::Values(SURF_HessianThreshold(100.0), SURF_HessianThreshold(500.0), SURF_HessianThreshold(1000.0)),
     testing::Values(SURF_Octaves(3), SURF_Octaves(4)),
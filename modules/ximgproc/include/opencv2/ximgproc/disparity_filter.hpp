@@ -120,6 +120,14 @@ public:
     /** @brief Get the ROI used in the last filter call
      */
     CV_WRAP virtual Rect getROI() = 0;
+
+    /** @brief StreamingMode keeps the internal Fast Global Smoother solver between filter calls, which is
+    meant for consecutive frames of a stereo camera. The weights of the solver are then recomputed only for
+    the rows of the left view which differ from the previous frame. It is disabled by default.
+     */
+    CV_WRAP virtual bool getStreamingMode() = 0;
+    /** @see getStreamingMode */
+    CV_WRAP virtual void setStreamingMode(bool _streaming_mode) = 0;
 };
 
 /** @brief Convenience factory method that creates an instance of DisparityWLSFilter and sets up all the relevant
@@ -58,6 +58,13 @@ enum EdgeAwareFiltersList
     AM_FILTER
 };
 
+//! Computation modes of jointBilateralFilter
+enum JointBilateralFilterMode
+{
+    JBF_EXACT, //!< direct convolution over the neighborhood of each pixel
+    JBF_FAST   //!< approximation on a bilateral grid or a permutohedral lattice
+};
+
 
 /** @brief Interface for realizations of Domain Transform filter.
 
@@ -179,6 +186,33 @@ space into bilateralFilter.
 @sa bilateralFilter, dtFilter, amFilter */
 CV_EXPORTS_W void guidedFilter(InputArray guide, InputArray src, OutputArray dst, int radius, double eps, int dDepth = -1);
 
+/** @brief Guided Filter call for very large images with bounded memory usage.
+
+The image is processed by horizontal strips of stripHeight rows, each of them with a halo of 2*radius
+rows on both sides, and the working buffers of the strips are reused. The output is equal to the
+output of guidedFilter (up to the floating point rounding), but the temporary memory is proportional to
+(stripHeight + 4*radius) * width instead of the size of the image.
+
+@param guide guided image with up to 3 channels, if it have more then 3 channels then only first 3
+channels will be used.
+
+@param src filtering image with any numbers of channels.
+
+@param dst output image.
+
+@param radius radius of Guided Filter.
+
+@param eps regularization term of Guided Filter. \f${eps}^2\f$ is similar to the sigma in the color
+space into bilateralFilter.
+
+@param dDepth optional depth of the output image.
+
+@param stripHeight number of output rows computed at once.
+
+@sa guidedFilter */
+CV_EXPORTS_W void guidedFilterStrips(InputArray guide, InputArray src, OutputArray dst, int radius, double eps,
+                                     int dDepth = -1, int stripHeight = 256);
+
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
@@ -199,6 +233,10 @@ Number of iterations to computed the eigenvector.
 Specify adjust outliers using Eq. 9 or not.
 -   member bool use_RNG = true
 Specify use random number generator to compute eigenvector or not.
+-   member int tile_size = 0
+If positive, images larger than tile_size are filtered in overlapping square tiles of about this
+size, which bounds the memory used for large images. The result is close to, but not exactly the
+same as, filtering the whole image at once.
  */
 class CV_EXPORTS_W AdaptiveManifoldFilter : public Algorithm
 {
@@ -241,6 +279,10 @@ public:
     virtual bool getUseRNG() const = 0;
     /** @copybrief getUseRNG @see getUseRNG */
     virtual void setUseRNG(bool val) = 0;
+    /** @see setTileSize */
+    virtual int getTileSize() const = 0;
+    /** @copybrief getTileSize @see getTileSize */
+    virtual void setTileSize(int val) = 0;
 };
 
 /** @brief Factory method, create instance of AdaptiveManifoldFilter and produce some initialization routines.
@@ -309,12 +351,18 @@ proportional to sigmaSpace .
 
 @param borderType
 
-@note bilateralFilter and jointBilateralFilter use L1 norm to compute difference between colors.
+@param mode JBF_EXACT computes the filter over the neighborhood of each pixel. JBF_FAST computes an
+approximation whose cost doesn't depend on the neighborhood size: a bilateral grid @cite Paris2006
+is used for 1-channel joint images and a permutohedral lattice @cite Adams2010 for 3-channel ones. In
+this mode d and borderType are ignored and the spatial kernel is a Gaussian with sigmaSpace.
+
+@note bilateralFilter and jointBilateralFilter use L1 norm to compute difference between colors,
+the permutohedral lattice uses L2 norm.
 
 @sa bilateralFilter, amFilter
 */
 CV_EXPORTS_W
-void jointBilateralFilter(InputArray joint, InputArray src, OutputArray dst, int d, double sigmaColor, double sigmaSpace, int borderType = BORDER_DEFAULT);
+void jointBilateralFilter(InputArray joint, InputArray src, OutputArray dst, int d, double sigmaColor, double sigmaSpace, int borderType = BORDER_DEFAULT, int mode = JBF_EXACT);
 
 /** @brief Applies the bilateral texture filter to an image. It performs structure-preserving texture filter.
 For more details about this filter see @cite Cho2014.
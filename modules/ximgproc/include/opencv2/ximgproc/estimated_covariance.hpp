@@ -72,6 +72,9 @@ to the bottom right corner. Each location of the window represents a sample.
 If the window is the size of the image, then this gives the exact covariance matrix.
 For all other cases, the sizes of the window will impact the number of samples
 and the number of elements in the estimated covariance matrix.
+The elements of a window are numbered column by column and the entries are the sums of their
+products over all the samples, without conjugation, so the matrix is symmetric. It is computed
+from the FFT-based autocorrelation of the image, which keeps large windows practical.
 */
 
 CV_EXPORTS_W void covarianceEstimation(InputArray src, OutputArray dst, int windowRows, int windowCols);
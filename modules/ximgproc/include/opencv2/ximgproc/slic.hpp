@@ -100,6 +100,23 @@ public:
      */
     CV_WRAP virtual void iterate( int num_iterations = 10 ) = 0;
 
+    /** @brief Continues the segmentation on the next frame of a video sequence.
+
+    @param image Next frame of the same size, number of channels and depth as the image used in
+    createSuperpixelSLIC().
+
+    @param num_iterations Number of iterations. Because the superpixels start from the result of the
+    previous frame one or two iterations are usually enough.
+
+    @param change_threshold Minimum sum of absolute channel differences to the previous frame for a
+    pixel to be considered changed.
+
+    The superpixel centers of the previous frame are used as seeds. For SLIC and SLICO only pixels
+    within the region size from changed pixels are assigned again, the labels of the static parts
+    of the scene are kept. MSLIC runs the iterations over the whole frame.
+     */
+    CV_WRAP virtual void updateFrame( InputArray image, int num_iterations = 2, float change_threshold = 8.0f ) = 0;
+
     /** @brief Returns the segmentation labeling of the image.
 
     Each label represents a superpixel, and each pixel is assigned to one superpixel label.
@@ -73,6 +73,10 @@ public:
 
 /** @brief Sparse match interpolation algorithm based on modified locally-weighted affine
 estimator from @cite Revaud2015 and Fast Global Smoother as post-processing filter.
+
+The geodesic graph of the matches and their nearest neighbors are kept between the calls of
+interpolate(). When from_image, the positions of from_points and the parameters K and Lambda are
+the same as in the previous call, only the affine fitting is repeated for the new to_points.
  */
 class CV_EXPORTS_W EdgeAwareInterpolator : public SparseMatchInterpolator
 {
@@ -0,0 +1,41 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+
+namespace cvtest
+{
+
+using std::tr1::tuple;
+using std::tr1::get;
+using namespace perf;
+using namespace testing;
+using namespace cv;
+using namespace cv::ximgproc;
+
+typedef tuple<Size, int> CovarianceTestParam;
+typedef TestBaseWithParam<CovarianceTestParam> CovarianceTest;
+
+PERF_TEST_P(CovarianceTest, perf,
+    Combine(
+    Values(szVGA, sz1080p),
+    Values(5, 15, 31))
+)
+{
+    CovarianceTestParam params = GetParam();
+    Size sz     = get<0>(params);
+    int window  = get<1>(params);
+
+    Mat src(sz, CV_32FC2), dst;
+    declare.in(src, WARMUP_RNG);
+
+    TEST_CYCLE()
+    {
+        covarianceEstimation(src, dst, window, window);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+}
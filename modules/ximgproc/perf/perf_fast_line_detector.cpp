@@ -0,0 +1,53 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "perf_precomp.hpp"
+
+namespace cvtest
+{
+
+using std::tr1::tuple;
+using std::tr1::get;
+using namespace perf;
+using namespace testing;
+using namespace cv;
+using namespace cv::ximgproc;
+
+typedef tuple<Size, bool> FLDTestParam;
+typedef TestBaseWithParam<FLDTestParam> FLDTest;
+
+PERF_TEST_P(FLDTest, detect,
+    Combine(
+    Values(szVGA, sz1080p, Size(3840, 2160)),
+    Values(false, true))
+)
+{
+    FLDTestParam params = GetParam();
+    Size sz         = get<0>(params);
+    bool do_merge   = get<1>(params);
+
+    // random segments on a noisy background
+    Mat src(sz, CV_8UC1);
+    RNG rnd(sz.width + do_merge);
+    rnd.fill(src, RNG::UNIFORM, 0, 32);
+    for (int i = 0; i < sz.area() / 4000; i++)
+    {
+        Point p1(rnd.uniform(0, sz.width), rnd.uniform(0, sz.height));
+        Point p2(rnd.uniform(0, sz.width), rnd.uniform(0, sz.height));
+        line(src, p1, p2, Scalar(rnd.uniform(96, 256)), rnd.uniform(1, 4));
+    }
+
+    Ptr<FastLineDetector> fld = createFastLineDetector(10, 1.414213562f, 50.0, 50.0, 3, do_merge);
+    std::vector<Vec4f> lines;
+
+    declare.in(src);
+
+    TEST_CYCLE()
+    {
+        fld->detect(src, lines);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+}
@@ -85,4 +85,34 @@
 
      SANITY_CHECK_NOTHING();
  }
+ typedef tuple<Size, int, int> WMFLargeTestParam;
+ typedef TestBaseWithParam<WMFLargeTestParam> WeightedMedianFilterLargeTest;
+
+ PERF_TEST_P(WeightedMedianFilterLargeTest, perf,
+     Combine(
+     Values(sz720p, sz1080p),
+     Values(1, 3),
+     Values(10, 20))
+ )
+ {
+     WMFLargeTestParam params = GetParam();
+
+     Size sz = get<0>(params);
+     int jCn = get<1>(params);
+     int r   = get<2>(params);
+
+     Mat joint(sz, CV_MAKE_TYPE(CV_8U, jCn));
+     Mat src(sz, CV_8UC1);
+     Mat dst(sz, src.type());
+
+     cv::setNumThreads(cv::getNumberOfCPUs());
+     declare.in(joint, src, WARMUP_RNG).out(dst).tbb_threads(cv::getNumberOfCPUs());
+
+     TEST_CYCLE_N(1)
+     {
+         weightedMedianFilter(joint, src, dst, r, 25.5, WMF_EXP);
+     }
+
+     SANITY_CHECK_NOTHING();
+ }
  }
@@ -104,6 +104,53 @@ static void splitChannels(InputArrayOfArrays src, vector<Mat>& dst)
     }
 }
 
+/*
+Keeps released buffers so that the nodes of the manifold tree and the tiles
+reuse them instead of allocating their own.
+*/
+class BufferPool
+{
+public:
+
+    Mat get(Size sz, int type)
+    {
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            if (buffers[i].size() == sz && buffers[i].type() == type)
+            {
+                Mat buf = buffers[i];
+                buffers[i] = buffers.back();
+                buffers.pop_back();
+                return buf;
+            }
+        }
+        return Mat(sz, type);
+    }
+
+    void put(Mat& buf)
+    {
+        if (!buf.empty())
+            buffers.push_back(buf);
+        buf.release();
+    }
+
+    void put(vector<Mat>& bufs)
+    {
+        for (size_t i = 0; i < bufs.size(); i++)
+            put(bufs[i]);
+        bufs.clear();
+    }
+
+    void clear()
+    {
+        buffers.clear();
+    }
+
+private:
+
+    vector<Mat> buffers;
+};
+
 class AdaptiveManifoldFilterN : public AdaptiveManifoldFilter
 {
 public:
@@ -119,6 +166,7 @@ public:
     CV_IMPL_PROPERTY(int, PCAIterations, num_pca_iterations_)
     CV_IMPL_PROPERTY(bool, AdjustOutliers, adjust_outliers_)
     CV_IMPL_PROPERTY(bool, UseRNG, useRNG)
+    CV_IMPL_PROPERTY(int, TileSize, tile_size_)
 
 protected:
 
@@ -128,6 +176,7 @@ protected:
     int tree_height_;
     int num_pca_iterations_;
     bool useRNG;
+    int tile_size_;
 
 private:
     
@@ -150,6 +199,8 @@ private:
 
     Mat1f minDistToManifoldSquared;
     
+    BufferPool pool;
+
     int curTreeHeight;
     float sigma_r_over_sqrt_2;
 
@@ -209,6 +260,10 @@ private: /*inline functions*/
 
 private:
 
+    void filterTiled(InputArray src_, OutputArray dst_, InputArray joint_);
+
+    void filterImpl(InputArray src_, OutputArray dst_, InputArray joint_);
+
     void initBuffers(InputArray src_, InputArray joint_);
 
     void initSrcAndJoint(InputArray src_, InputArray joint_);
@@ -221,7 +276,9 @@ private:
 
     void computeClusters(Mat1b& cluster, Mat1b& cluster_minus, Mat1b& cluster_plus);
 
-    void computeEta(Mat& teta, Mat1b& cluster, vector<Mat>& etaDst);
+    void computeEta(Mat& w, Mat1b& cluster, vector<Mat>& etaDst);
+
+    void accumulateProduct(Mat& dst, Mat& src1, Mat& src2);
 
 
     static void h_filter(const Mat1f& src, Mat& dst, float sigma);
@@ -274,6 +331,7 @@ AdaptiveManifoldFilterN::AdaptiveManifoldFilterN()
     num_pca_iterations_ = 1;
     adjust_outliers_ = false;
     useRNG = true;
+    tile_size_ = 0;
 }
 
 void AdaptiveManifoldFilterN::initBuffers(InputArray src_, InputArray joint_)
@@ -293,10 +351,12 @@ void AdaptiveManifoldFilterN::initBuffers(InputArray src_, InputArray joint_)
     for (int i = 0; i < srcCnNum; i++)
     {
         //srcCn[i].create(srcSize, CV_32FC1);
-        sum_w_ki_Psi_blur_[i] = Mat::zeros(srcSize, CV_32FC1);
+        sum_w_ki_Psi_blur_[i].create(srcSize, CV_32FC1);
+        sum_w_ki_Psi_blur_[i].setTo(0);
     }
 
-    sum_w_ki_Psi_blur_0_ = Mat::zeros(srcSize, CV_32FC1);
+    sum_w_ki_Psi_blur_0_.create(srcSize, CV_32FC1);
+    sum_w_ki_Psi_blur_0_.setTo(0);
     w_k.create(srcSize, CV_32FC1);
     Psi_splat_0_small.create(smallSize, CV_32FC1);
     
@@ -306,6 +366,10 @@ void AdaptiveManifoldFilterN::initBuffers(InputArray src_, InputArray joint_)
 
 void AdaptiveManifoldFilterN::initSrcAndJoint(InputArray src_, InputArray joint_)
 {
+    //buffers of other tiles or images would only accumulate in the pool
+    if (src_.size() != srcSize)
+        pool.clear();
+
     srcSize = src_.size();
     smallSize = getSmallSize();
     srcCnNum = src_.channels();
@@ -355,6 +419,74 @@ void AdaptiveManifoldFilterN::filter(InputArray src, OutputArray dst, InputArray
     CV_Assert(sigma_s_ >= 1 && (sigma_r_ > 0 && sigma_r_ <= 1));
     num_pca_iterations_ = std::max(1, num_pca_iterations_);
 
+    Size sz = src.size();
+    if (tile_size_ > 0 && (sz.width > tile_size_ || sz.height > tile_size_))
+        filterTiled(src, dst, joint);
+    else
+        filterImpl(src, dst, joint);
+}
+
+void AdaptiveManifoldFilterN::filterTiled(InputArray src_, OutputArray dst_, InputArray joint_)
+{
+    Mat src = src_.getMat();
+    if (dst_.getObj() == src_.getObj())
+        src = src.clone();
+
+    bool selfJoint = joint_.empty() || joint_.getObj() == src_.getObj();
+    vector<Mat> joint;
+    if (!selfJoint)
+    {
+        if (joint_.isMatVector() || joint_.isUMatVector())
+            joint_.getMatVector(joint);
+        else
+            joint.push_back(joint_.getMat());
+
+        for (size_t i = 0; i < joint.size(); i++)
+        {
+            CV_Assert(joint[i].size() == src.size());
+            if (joint_.getObj() == dst_.getObj())
+                joint[i] = joint[i].clone();
+        }
+    }
+
+    dst_.create(src.size(), src.type());
+    Mat dst = dst_.getMat();
+
+    //the tiles and their overlap are aligned to the downsampling grid
+    int df = (int)getResizeRatio();
+    int tile = (int)alignSize(std::max(tile_size_, df), df);
+    int border = (int)alignSize(cvCeil(3.0 * sigma_s_), df);
+
+    Rect imageRect(0, 0, src.cols, src.rows);
+    vector<Mat> jointTile(joint.size());
+    Mat dstTile;
+
+    for (int y = 0; y < src.rows; y += tile)
+    {
+        for (int x = 0; x < src.cols; x += tile)
+        {
+            Rect inner(x, y, std::min(tile, src.cols - x), std::min(tile, src.rows - y));
+            Rect outer(inner.x - border, inner.y - border, inner.width + 2*border, inner.height + 2*border);
+            outer &= imageRect;
+
+            if (selfJoint)
+            {
+                filterImpl(src(outer), dstTile, noArray());
+            }
+            else
+            {
+                for (size_t i = 0; i < joint.size(); i++)
+                    jointTile[i] = joint[i](outer);
+                filterImpl(src(outer), dstTile, jointTile);
+            }
+
+            dstTile(inner - outer.tl()).copyTo(dst(inner));
+        }
+    }
+}
+
+void AdaptiveManifoldFilterN::filterImpl(InputArray src, OutputArray dst, InputArray joint)
+{
     initBuffers(src, joint);
 
     curTreeHeight = tree_height_ <= 0 ? computeManifoldTreeHeight(sigma_s_, sigma_r_) : tree_height_;
@@ -434,11 +566,14 @@ void AdaptiveManifoldFilterN::buildManifoldsAndPerformFiltering(vector<Mat>& eta
     
     //blurring
     Psi_splat_small.resize(srcCnNum);
-    for (int si = 0; si < srcCnNum; si++)
     {
-        Mat tmp;
-        multiply(srcCn[si], w_k, tmp);
-        downsample(tmp, Psi_splat_small[si]);
+        Mat tmp = pool.get(srcSize, CV_32FC1);
+        for (int si = 0; si < srcCnNum; si++)
+        {
+            multiply(srcCn[si], w_k, tmp);
+            downsample(tmp, Psi_splat_small[si]);
+        }
+        pool.put(tmp);
     }
     downsample(w_k, Psi_splat_0_small);
 
@@ -451,39 +586,48 @@ void AdaptiveManifoldFilterN::buildManifoldsAndPerformFiltering(vector<Mat>& eta
 
     //slicing
     {
-        Mat tmp;
+        Mat tmp = pool.get(srcSize, CV_32FC1);
         for (int i = 0; i < srcCnNum; i++)
         {
             upsample(Psi_splat_small_blur[i], tmp);
-            multiply(tmp, w_k, tmp);
-            add(sum_w_ki_Psi_blur_[i], tmp, sum_w_ki_Psi_blur_[i]);
+            accumulateProduct(sum_w_ki_Psi_blur_[i], tmp, w_k);
         }
         upsample(Psi_splat_0_small_blur, tmp);
-        multiply(tmp, w_k, tmp);
-        add(sum_w_ki_Psi_blur_0_, tmp, sum_w_ki_Psi_blur_0_);
+        accumulateProduct(sum_w_ki_Psi_blur_0_, tmp, w_k);
+        pool.put(tmp);
     }
 
+    //return memory to the pool to continue deep recursion
+    pool.put(eta);
+
     //build new manifolds
     if (treeLevel < curTreeHeight)
     {
-        Mat1b cluster_minus, cluster_plus;
+        Mat1b cluster_minus = pool.get(srcSize, CV_8UC1);
+        Mat1b cluster_plus = pool.get(srcSize, CV_8UC1);
 
         computeClusters(cluster, cluster_minus, cluster_plus);
+        pool.put(cluster);
 
-        vector<Mat> eta_minus(jointCnNum), eta_plus(jointCnNum);
-        {
-            Mat1f teta = 1.0 - w_k;
-            computeEta(teta, cluster_minus, eta_minus);
-            computeEta(teta, cluster_plus, eta_plus);
-        }
-
-        //free memory to continue deep recursion
-        eta.clear();
-        cluster.release();
+        vector<Mat> eta_minus, eta_plus;
+        computeEta(w_k, cluster_minus, eta_minus);
+        computeEta(w_k, cluster_plus, eta_plus);
 
         buildManifoldsAndPerformFiltering(eta_minus, cluster_minus, treeLevel + 1);
         buildManifoldsAndPerformFiltering(eta_plus, cluster_plus, treeLevel + 1);
     }
+    else
+    {
+        pool.put(cluster);
+    }
+}
+
+void AdaptiveManifoldFilterN::accumulateProduct(Mat& dst, Mat& src1, Mat& src2)
+{
+    CV_DbgAssert(dst.size() == src1.size() && dst.size() == src2.size());
+
+    for (int i = 0; i < dst.rows; i++)
+        add_mul(dst.ptr<float>(i), src1.ptr<float>(i), src2.ptr<float>(i), dst.cols);
 }
 
 void AdaptiveManifoldFilterN::collectGarbage()
@@ -498,6 +642,7 @@ void AdaptiveManifoldFilterN::collectGarbage()
     w_k.release();
     Psi_splat_0_small.release();
     minDistToManifoldSquared.release();
+    pool.clear();
 }
 
 void AdaptiveManifoldFilterN::h_filter(const Mat1f& src, Mat& dst, float sigma)
@@ -581,10 +726,11 @@ void AdaptiveManifoldFilterN::compute_w_k(vector<Mat>& etak, Mat& dst, float sig
         }
 
         mul(dstRow, dstRow, argConst, srcSize.width);
-        //Exp_32f(dstRow, dstRow, srcSize.width);
-    }
 
-    cv::exp(dst, dst);
+        //exponentiate the row while it is still in cache
+        Mat dstRowMat(1, srcSize.width, CV_32FC1, dstRow);
+        cv::exp(dstRowMat, dstRowMat);
+    }
 }
 
 void AdaptiveManifoldFilterN::computeDTHor(vector<Mat>& srcCn, Mat& dst, float sigma_s, float sigma_r)
@@ -697,16 +843,22 @@ void AdaptiveManifoldFilterN::computeClusters(Mat1b& cluster, Mat1b& cluster_min
 
         vector<Mat> difEtaSrc(jointCnNum);
         for (int i = 0; i < jointCnNum; i++)
+        {
+            difEtaSrc[i] = pool.get(srcSize, CV_32FC1);
             subtract(jointCn[i], etaFull[i], difEtaSrc[i]);
+        }
 
         Mat1f eigenVec(1, jointCnNum);
         computeEigenVector(difEtaSrc, cluster, eigenVec, num_pca_iterations_, initVec);
 
+        difOreientation = pool.get(srcSize, CV_32FC1);
         computeOrientation(difEtaSrc, eigenVec, difOreientation);
         CV_DbgAssert(difOreientation.size() == srcSize);
+        pool.put(difEtaSrc);
     }
     else
     {
+        difOreientation = pool.get(srcSize, CV_32FC1);
         subtract(jointCn[0], etaFull[0], difOreientation);
     }
 
@@ -715,30 +867,39 @@ void AdaptiveManifoldFilterN::computeClusters(Mat1b& cluster, Mat1b& cluster_min
 
     compare(difOreientation, 0, cluster_plus, CMP_GE);
     bitwise_and(cluster_plus, cluster, cluster_plus);
+
+    pool.put(difOreientation);
 }
 
-void AdaptiveManifoldFilterN::computeEta(Mat& teta, Mat1b& cluster, vector<Mat>& etaDst)
+void AdaptiveManifoldFilterN::computeEta(Mat& w, Mat1b& cluster, vector<Mat>& etaDst)
 {
-    CV_DbgAssert(teta.size() == srcSize && cluster.size() == srcSize);
+    CV_DbgAssert(w.size() == srcSize && cluster.size() == srcSize);
+
+    //teta = 1 - w inside the cluster, 0 outside
+    Mat1f tetaMasked = pool.get(srcSize, CV_32FC1);
+    for (int i = 0; i < srcSize.height; i++)
+        masked_one_minus(tetaMasked[i], w.ptr<float>(i), cluster[i], srcSize.width);
 
-    Mat1f tetaMasked = Mat1f::zeros(srcSize);
-    teta.copyTo(tetaMasked, cluster);
-    
     float sigma_s = (float)(sigma_s_ / getResizeRatio());
 
-    Mat1f tetaMaskedBlur;
+    Mat1f tetaMaskedBlur = pool.get(smallSize, CV_32FC1);
     downsample(tetaMasked, tetaMaskedBlur);
     h_filter(tetaMaskedBlur, tetaMaskedBlur, sigma_s);
 
-    Mat mul;
+    Mat mul = pool.get(srcSize, CV_32FC1);
     etaDst.resize(jointCnNum);
     for (int i = 0; i < jointCnNum; i++)
     {
+        etaDst[i] = pool.get(smallSize, CV_32FC1);
         multiply(tetaMasked, jointCn[i], mul);
         downsample(mul, etaDst[i]);
         h_filter(etaDst[i], etaDst[i], sigma_s);
         divide(etaDst[i], tetaMaskedBlur, etaDst[i]);
     }
+
+    pool.put(mul);
+    pool.put(tetaMasked);
+    pool.put(tetaMaskedBlur);
 }
 
 void AdaptiveManifoldFilterN::computeEigenVector(const vector<Mat>& X, const Mat1b& mask, Mat1f& vecDst, int num_pca_iterations, const Mat1f& vecRand)
@@ -200,40 +200,56 @@ public:
 };
 
 #ifdef HAVE_OPENCL
+// iterations done by one launch, i.e. the halo of the tiles kept in local memory
+static const int OCL_AD_FUSED_ITERS = 4;
+static const int OCL_AD_TILE = 16;
+
 static bool ocl_anisotropicDiffusion(InputArray src_, OutputArray dst_,
                                      float alpha, int niters,
                                      const std::vector<float>& exptab)
 {
+    if (ocl::Device::getDefault().maxWorkGroupSize() < (size_t)(OCL_AD_TILE*OCL_AD_TILE))
+        return false;
+
     UMat src0 = src_.getUMat(), dst0 = dst_.getUMat();
     int type = src0.type();
     int rows = src0.rows, cols = src0.cols;
 
-    ocl::Kernel k("anisodiff", ocl::ximgproc::anisodiff_oclsrc, "");
-    if (k.empty())
-        return false;
-
-    UMat temp0x(rows + 2, cols + 2, type);
-    UMat temp1x(rows + 2, cols + 2, type);
-    UMat temp0(temp0x, Rect(1, 1, cols, rows));
-    UMat temp1(temp1x, Rect(1, 1, cols, rows));
+    // the tiles read the halo written by their neighbours
+    if (src0.u == dst0.u)
+        src0 = src0.clone();
 
     int tabsz = (int)exptab.size();
-    UMat uexptab = Mat(1, tabsz, CV_32F, (void*)&exptab[0]).getUMat(ACCESS_READ);
+    UMat uexptab;
+    Mat(1, tabsz, CV_32F, (void*)&exptab[0]).copyTo(uexptab);
 
-    for (int t = 0; t < niters; t++)
+    size_t globalsize[] = { (size_t)alignSize(cols, OCL_AD_TILE), (size_t)alignSize(rows, OCL_AD_TILE) };
+    size_t localsize[] = { (size_t)OCL_AD_TILE, (size_t)OCL_AD_TILE };
+
+    // the iterates stay on the device, ping-ponging between two buffers
+    UMat temp[2];
+    UMat src = src0;
+    for (int t = 0, i = 0; t < niters; i ^= 1)
     {
-        UMat src = temp0, dst = t == niters-1 ? dst0 : temp1;
-        copyMakeBorder(t == 0 ? src0 : src, temp0x, 1, 1, 1, 1, BORDER_REPLICATE);
+        int n = std::min(OCL_AD_FUSED_ITERS, niters - t);
+        ocl::Kernel k("anisodiff", ocl::ximgproc::anisodiff_oclsrc, format("-D NITERS=%d", n));
+        if (k.empty())
+            return false;
+
+        t += n;
+        UMat dst = dst0;
+        if (t < niters)
+        {
+            temp[i].create(rows, cols, type);
+            dst = temp[i];
+        }
 
         k.args(ocl::KernelArg::ReadOnlyNoSize(src), ocl::KernelArg::WriteOnly(dst),
                ocl::KernelArg::PtrReadOnly(uexptab), alpha);
-
-        size_t globalsize[] = { (size_t)cols, (size_t)rows };
-        if(!k.run(2, globalsize, NULL, true))
+        if (!k.run(2, globalsize, localsize, false))
             return false;
 
-        std::swap(temp0, temp1);
-        std::swap(temp0x, temp1x);
+        src = dst;
     }
     return true;
 }
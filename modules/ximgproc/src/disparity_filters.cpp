@@ -37,6 +37,8 @@
 #include "precomp.hpp"
 #include "opencv2/ximgproc/disparity_filter.hpp"
 #include "opencv2/imgcodecs.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "edgeaware_filters_common.hpp"
 #include <math.h>
 #include <vector>
 
@@ -61,10 +63,13 @@ protected:
     float depth_discontinuity_roll_off_factor;
     float resize_factor;
     int num_stripes;
+    bool streaming_mode;
+    Ptr<FastGlobalSmootherFilter> solver; /*kept between the calls in the streaming mode*/
 
     void init(double _lambda, double _sigma_color, bool _use_confidence, int l_offs, int r_offs, int t_offs, int b_offs, int _min_disp);
     void computeDepthDiscontinuityMaps(Mat& left_disp, Mat& right_disp, Mat& left_dst, Mat& right_dst);
     void computeConfidenceMap(InputArray left_disp, InputArray right_disp);
+    Ptr<FastGlobalSmootherFilter> getSolver(Mat& guide);
 
 protected:
     struct ComputeDiscontinuityAwareLRC_ParBody : public ParallelLoopBody
@@ -91,6 +96,24 @@ protected:
 
     typedef void (DisparityWLSFilterImpl::*MatOp)(Mat& src, Mat& dst);
 
+    struct ComputeWeightedDisparity_ParBody : public ParallelLoopBody
+    {
+        Mat *disp, *conf, *dst;
+        int nstripes, stripe_sz;
+
+        ComputeWeightedDisparity_ParBody(Mat& _disp, Mat& _conf, Mat& _dst, int _nstripes);
+        void operator () (const Range& range) const;
+    };
+
+    struct NormalizeDisparity_ParBody : public ParallelLoopBody
+    {
+        Mat *disp_mul_conf, *conf, *dst;
+        int nstripes, stripe_sz;
+
+        NormalizeDisparity_ParBody(Mat& _disp_mul_conf, Mat& _conf, Mat& _dst, int _nstripes);
+        void operator () (const Range& range) const;
+    };
+
     struct ParallelMatOp_ParBody : public ParallelLoopBody
     {
         DisparityWLSFilterImpl* wls;
@@ -137,6 +160,9 @@ public:
 
     Mat getConfidenceMap() {return confidence_map;}
     Rect getROI() {return valid_disp_ROI;}
+
+    bool getStreamingMode() {return streaming_mode;}
+    void setStreamingMode(bool _streaming_mode) {streaming_mode = _streaming_mode; if(!streaming_mode) solver.release();}
 };
 
 void DisparityWLSFilterImpl::init(double _lambda, double _sigma_color, bool _use_confidence,  int l_offs, int r_offs, int t_offs, int b_offs, int _min_disp)
@@ -156,6 +182,8 @@ void DisparityWLSFilterImpl::init(double _lambda, double _sigma_color, bool _use
     depth_discontinuity_roll_off_factor = 0.001f;
     resize_factor = 1.0;
     num_stripes = getNumThreads();
+    streaming_mode = false;
+    solver.release();
 }
 
 void DisparityWLSFilterImpl::computeDepthDiscontinuityMaps(Mat& left_disp, Mat& right_disp, Mat& left_dst, Mat& right_dst)
@@ -206,7 +234,14 @@ void DisparityWLSFilterImpl::computeConfidenceMap(InputArray left_disp, InputArr
     confidence_map = depth_discontinuity_map_left;
 
     parallel_for_(Range(0,num_stripes),ComputeDiscontinuityAwareLRC_ParBody(*this,ldisp,rdisp, depth_discontinuity_map_left,depth_discontinuity_map_right,confidence_map,valid_disp_ROI,right_view_valid_disp_ROI,num_stripes));
-    confidence_map = 255.0f*confidence_map;
+}
+
+Ptr<FastGlobalSmootherFilter> DisparityWLSFilterImpl::getSolver(Mat& guide)
+{
+    if(!streaming_mode)
+        return createFastGlobalSmootherFilter(guide,lambda,sigma_color);
+    updateFastGlobalSmootherFilter(solver,guide,lambda,sigma_color);
+    return solver;
 }
 
 Ptr<DisparityWLSFilterImpl> DisparityWLSFilterImpl::create(bool _use_confidence, int l_offs=0, int r_offs=0, int t_offs=0, int b_offs=0, int min_disp=0)
@@ -254,7 +289,7 @@ void DisparityWLSFilterImpl::filter(InputArray disparity_map_left, InputArray le
         dst_full_size = Scalar(16*(min_disp-1));
         dst = Mat(dst_full_size,ROI);
         Mat filtered_disp;
-        fastGlobalSmootherFilter(src,disp,filtered_disp,lambda,sigma_color);
+        getSolver(src)->filter(disp,filtered_disp);
         filtered_disp.copyTo(dst);
     }
     else
@@ -285,15 +320,13 @@ void DisparityWLSFilterImpl::filter(InputArray disparity_map_left, InputArray le
         dst = Mat(dst_full_size,ROI);
         Mat conf(confidence_map,ROI);
 
-        Mat disp_mul_conf;
-        disp.convertTo(disp_mul_conf,CV_32F);
-        disp_mul_conf = conf.mul(disp_mul_conf);
+        Mat disp_mul_conf(disp.size(),CV_32F);
+        parallel_for_(Range(0,num_stripes),ComputeWeightedDisparity_ParBody(disp,conf,disp_mul_conf,num_stripes));
         Mat conf_filtered;
-        Ptr<FastGlobalSmootherFilter> wls = createFastGlobalSmootherFilter(src,lambda,sigma_color);
+        Ptr<FastGlobalSmootherFilter> wls = getSolver(src);
         wls->filter(disp_mul_conf,disp_mul_conf);
         wls->filter(conf,conf_filtered);
-        disp_mul_conf = disp_mul_conf.mul(1/(conf_filtered+EPS));
-        disp_mul_conf.convertTo(dst,CV_16S);
+        parallel_for_(Range(0,num_stripes),NormalizeDisparity_ParBody(disp_mul_conf,conf_filtered,dst,num_stripes));
     }
 }
 
@@ -332,10 +365,12 @@ void DisparityWLSFilterImpl::ComputeDiscontinuityAwareLRC_ParBody::operator() (c
             if( right_idx>=right_ROI.x && right_idx<right_end)
             {
                 if(abs(row_left[j] + row_right[right_idx])< thresh)
-                    row_dst[j] = min(row_left_conf[j],row_right_conf[right_idx]);
+                    row_dst[j] = 255.0f*min(row_left_conf[j],row_right_conf[right_idx]);
                 else
                     row_dst[j] = 0.0f;
             }
+            else
+                row_dst[j] = 255.0f*row_left_conf[j];
         }
     }
 }
@@ -372,6 +407,74 @@ void DisparityWLSFilterImpl::ComputeDepthDisc_ParBody::operator() (const Range&
     }
 }
 
+DisparityWLSFilterImpl::ComputeWeightedDisparity_ParBody::ComputeWeightedDisparity_ParBody(Mat& _disp, Mat& _conf, Mat& _dst, int _nstripes):
+disp(&_disp),conf(&_conf),dst(&_dst),nstripes(_nstripes)
+{
+    stripe_sz = (int)ceil(disp->rows/(double)nstripes);
+}
+
+// dst = conf*disp without the intermediate floating-point copy of the disparity map
+void DisparityWLSFilterImpl::ComputeWeightedDisparity_ParBody::operator() (const Range& range) const
+{
+    int h = disp->rows;
+    int w = disp->cols;
+    int start = std::min(range.start * stripe_sz, h);
+    int end   = std::min(range.end   * stripe_sz, h);
+
+    for(int i=start;i<end;i++)
+    {
+        const short* row_disp = disp->ptr<short>(i);
+        const float* row_conf = conf->ptr<float>(i);
+        float* row_dst = dst->ptr<float>(i);
+        int j=0;
+#if CV_SIMD128
+        for(;j<=w-8;j+=8)
+        {
+            v_int32x4 d0, d1;
+            v_expand(v_load(row_disp+j),d0,d1);
+            v_store(row_dst+j,  v_load(row_conf+j)  *v_cvt_f32(d0));
+            v_store(row_dst+j+4,v_load(row_conf+j+4)*v_cvt_f32(d1));
+        }
+#endif
+        for(;j<w;j++)
+            row_dst[j] = row_conf[j]*row_disp[j];
+    }
+}
+
+DisparityWLSFilterImpl::NormalizeDisparity_ParBody::NormalizeDisparity_ParBody(Mat& _disp_mul_conf, Mat& _conf, Mat& _dst, int _nstripes):
+disp_mul_conf(&_disp_mul_conf),conf(&_conf),dst(&_dst),nstripes(_nstripes)
+{
+    stripe_sz = (int)ceil(dst->rows/(double)nstripes);
+}
+
+// dst = saturate_cast<short>(disp_mul_conf/(conf+EPS)), the normalization and the conversion in one pass
+void DisparityWLSFilterImpl::NormalizeDisparity_ParBody::operator() (const Range& range) const
+{
+    int h = dst->rows;
+    int w = dst->cols;
+    int start = std::min(range.start * stripe_sz, h);
+    int end   = std::min(range.end   * stripe_sz, h);
+
+    for(int i=start;i<end;i++)
+    {
+        const float* row_disp = disp_mul_conf->ptr<float>(i);
+        const float* row_conf = conf->ptr<float>(i);
+        short* row_dst = dst->ptr<short>(i);
+        int j=0;
+#if CV_SIMD128
+        v_float32x4 eps = v_setall_f32(EPS), one = v_setall_f32(1.0f);
+        for(;j<=w-8;j+=8)
+        {
+            v_float32x4 r0 = v_load(row_disp+j)  *(one/(v_load(row_conf+j)  +eps));
+            v_float32x4 r1 = v_load(row_disp+j+4)*(one/(v_load(row_conf+j+4)+eps));
+            v_store(row_dst+j,v_pack(v_round(r0),v_round(r1)));
+        }
+#endif
+        for(;j<w;j++)
+            row_dst[j] = saturate_cast<short>(row_disp[j]*(1.0f/(row_conf[j]+EPS)));
+    }
+}
+
 DisparityWLSFilterImpl::ParallelMatOp_ParBody::ParallelMatOp_ParBody(DisparityWLSFilterImpl& _wls, vector<MatOp> _ops, vector<Mat*>& _src, vector<Mat*>& _dst):
 wls(&_wls),ops(_ops),src(_src),dst(_dst)
 {}
@@ -36,6 +36,7 @@
 
 #include "precomp.hpp"
 #include "dtfilter_cpu.hpp"
+#include "opencl_kernels_ximgproc.hpp"
 
 namespace cv
 {
@@ -119,8 +120,109 @@ void DTFilterCPU::init(InputArray guide_, double sigmaSpatial_, double sigmaColo
     #undef CREATE_DTF
 }
 
+#ifdef HAVE_OPENCL
+bool DTFilterCPU::ocl_filter(InputArray src_, OutputArray dst_, int dDepth)
+{
+    int cn = src_.channels(), depth = src_.depth();
+    if ((mode != DTF_NC && mode != DTF_RF) || h < 2 || w < 2 ||
+        src_.rows() != h || src_.cols() != w || cn > 4 || (depth != CV_8U && depth != CV_32F))
+        return false;
+
+    String opts = format("-D cn=%d", cn);
+    ocl::Kernel kHor, kVert;
+    if (mode == DTF_NC)
+    {
+        kHor.create("dtf_nc_integrate", ocl::ximgproc::dtfilter_oclsrc, opts);
+        kVert.create("dtf_nc_pass", ocl::ximgproc::dtfilter_oclsrc, opts);
+    }
+    else
+    {
+        kHor.create("dtf_rf_hor", ocl::ximgproc::dtfilter_oclsrc, opts);
+        kVert.create("dtf_rf_vert", ocl::ximgproc::dtfilter_oclsrc, opts);
+    }
+    if (kHor.empty() || kVert.empty())
+        return false;
+
+    if (singleFilterCall)
+    {
+        CV_Assert(numFilterCalls == 0);
+    }
+    numFilterCalls++;
+
+    if (dDepth == -1) dDepth = depth;
+
+    UMat res;
+    src_.getUMat().convertTo(res, CV_MAKETYPE(CV_32F, cn));
+
+    if (mode == DTF_NC)
+    {
+        if (uidistHor.empty())
+        {
+            idistHor.copyTo(uidistHor);
+            idistVert.copyTo(uidistVert);
+        }
+
+        UMat resT(w, h, res.type());
+        UMat isrc(h, w + 1, res.type()), isrcT(w, h + 1, res.type());
+
+        for (int iter = 1; iter <= numIters; iter++)
+        {
+            float radius = getIterRadius(iter);
+
+            size_t horThreads = (size_t)h;
+            size_t horGlobal[] = { (size_t)w, (size_t)h };
+            kHor.args(ocl::KernelArg::ReadOnly(res), ocl::KernelArg::WriteOnlyNoSize(isrc));
+            if (!kHor.run(1, &horThreads, NULL, false))
+                return false;
+            kVert.args(ocl::KernelArg::ReadOnlyNoSize(isrc), ocl::KernelArg::ReadOnlyNoSize(uidistHor),
+                       ocl::KernelArg::WriteOnlyNoSize(resT), h, w, radius);
+            if (!kVert.run(2, horGlobal, NULL, false))
+                return false;
+
+            size_t vertThreads = (size_t)w;
+            size_t vertGlobal[] = { (size_t)h, (size_t)w };
+            kHor.args(ocl::KernelArg::ReadOnly(resT), ocl::KernelArg::WriteOnlyNoSize(isrcT));
+            if (!kHor.run(1, &vertThreads, NULL, false))
+                return false;
+            kVert.args(ocl::KernelArg::ReadOnlyNoSize(isrcT), ocl::KernelArg::ReadOnlyNoSize(uidistVert),
+                       ocl::KernelArg::WriteOnlyNoSize(res), w, h, radius);
+            if (!kVert.run(2, vertGlobal, NULL, false))
+                return false;
+        }
+    }
+    else
+    {
+        if (ua0distHor.empty())
+        {
+            a0distHor.copyTo(ua0distHor);
+            a0distVert.copyTo(ua0distVert);
+        }
+
+        // the weights are squared in place at every iteration after the first one
+        UMat adHor = ua0distHor.clone(), adVert = ua0distVert.clone();
+
+        for (int iter = 1; iter <= numIters; iter++)
+        {
+            size_t horThreads = (size_t)h, vertThreads = (size_t)w;
+            kHor.args(ocl::KernelArg::ReadWrite(res), ocl::KernelArg::ReadWriteNoSize(adHor), iter);
+            if (!kHor.run(1, &horThreads, NULL, false))
+                return false;
+            kVert.args(ocl::KernelArg::ReadWrite(res), ocl::KernelArg::ReadWriteNoSize(adVert), iter);
+            if (!kVert.run(1, &vertThreads, NULL, false))
+                return false;
+        }
+    }
+
+    res.convertTo(dst_, dDepth);
+    return true;
+}
+#endif
+
 void DTFilterCPU::filter(InputArray src_, OutputArray dst_, int dDepth)
 {
+    CV_OCL_RUN(src_.isUMat() && dst_.isUMat(),
+               ocl_filter(src_, dst_, dDepth));
+
     Mat src = src_.getMat();
     dst_.create(src.size(), src.type());
     Mat& dst = dst_.getMatRef();
@@ -180,6 +282,12 @@ void DTFilterCPU::release()
 
     adistHor.release();
     adistVert.release();
+
+    uidistHor.release();
+    uidistVert.release();
+
+    ua0distHor.release();
+    ua0distVert.release();
 }
 
 Mat DTFilterCPU::getWExtendedMat(int h, int w, int type, int brdleft /*= 0*/, int brdRight /*= 0*/, int cacheAlign /*= 0*/)
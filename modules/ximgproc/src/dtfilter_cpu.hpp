@@ -103,6 +103,9 @@ public: /*Members declarations*/
     Mat adistHor, adistVert;
     int numIters;
 
+    UMat uidistHor, uidistVert;     /*copies of idist and a0dist on the device*/
+    UMat ua0distHor, ua0distVert;
+
 protected: /*Functions declarations*/
 
     DTFilterCPU() : mode(-1), singleFilterCall(false), numFilterCalls(0) {}
@@ -111,6 +114,10 @@ protected: /*Functions declarations*/
 
     void release();
 
+#ifdef HAVE_OPENCL
+    bool ocl_filter(InputArray src, OutputArray dst, int dDepth);
+#endif
+
     template<typename GuideVec>
     inline IDistType getTransformedDistance(const GuideVec &l, const GuideVec &r)
     {
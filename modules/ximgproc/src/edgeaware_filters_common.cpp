@@ -41,6 +41,7 @@
 #include <opencv2/core/cvdef.h>
 #include <opencv2/core/utility.hpp>
 #include <cmath>
+#include <cstring>
 using namespace std;
 
 #ifndef SQR
@@ -57,6 +58,14 @@ inline bool CPU_SUPPORT_SSE1()
     return is_supported;
 }
 
+#if CV_SSE2
+inline bool CPU_SUPPORT_SSE2()
+{
+    static const bool is_supported = cv::checkHardwareSupport(CV_CPU_SSE2);
+    return is_supported;
+}
+#endif
+
 }  // end
 #endif
 
@@ -527,6 +536,34 @@ void min_(register float *dst, register float *src1, register float *src2, int w
         dst[j] = std::min(src1[j], src2[j]);
 }
 
+void masked_one_minus(register float *dst, register float *src, register uchar *mask, int w)
+{
+    register int j = 0;
+#if CV_SSE2
+    if (CPU_SUPPORT_SSE2())
+    {
+        __m128 one = _mm_set_ps1(1.0f);
+        __m128i zero = _mm_setzero_si128();
+        __m128i m;
+        __m128 a;
+        for (; j < w - 3; j += 4)
+        {
+            int maskBytes;
+            std::memcpy(&maskBytes, mask + j, sizeof(maskBytes));
+            m = _mm_cvtsi32_si128(maskBytes);
+            m = _mm_unpacklo_epi16(_mm_unpacklo_epi8(m, zero), zero);
+            m = _mm_cmpgt_epi32(m, zero);
+
+            a = _mm_sub_ps(one, _mm_loadu_ps(src + j));
+            a = _mm_and_ps(a, _mm_castsi128_ps(m));
+            _mm_storeu_ps(dst + j, a);
+        }
+    }
+#endif
+    for (; j < w; j++)
+        dst[j] = mask[j] ? 1.0f - src[j] : 0.0f;
+}
+
 void rf_vert_row_pass(register float *curRow, register float *prevRow, float alphaVal, int w)
 {
     register int j = 0;
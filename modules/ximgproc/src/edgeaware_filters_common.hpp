@@ -45,6 +45,10 @@ namespace ximgproc
 
 Ptr<DTFilter> createDTFilterRF(InputArray adistHor, InputArray adistVert, double sigmaSpatial, double sigmaColor, int numIters);
 
+/* Sets a new guide of a FastGlobalSmootherFilter, recomputing only the weights of the changed rows.
+ An empty fgs is created with the default attenuation and number of iterations. */
+void updateFastGlobalSmootherFilter(Ptr<FastGlobalSmootherFilter>& fgs, InputArray guide, double lambda, double sigma_color);
+
 int getTotalNumberOfChannels(InputArrayOfArrays src);
 
 void checkSameSizeAndDepth(InputArrayOfArrays src, Size &sz, int &depth);
@@ -87,6 +91,9 @@ namespace intrinsics
 
     void min_(register float *dst, register float *src1, register float *src2, int w);
 
+    //dst = mask ? 1 - src : 0
+    void masked_one_minus(register float *dst, register float *src, register uchar *mask, int w);
+
     void rf_vert_row_pass(register float *curRow, register float *prevRow, float alphaVal, int w);
 }
 
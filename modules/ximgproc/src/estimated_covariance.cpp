@@ -50,297 +50,230 @@ A previous and less efficient version of the algorithm can be found:
 */
 
 #include "precomp.hpp"
-
-using namespace cv;
-using namespace std;
-
+#include <complex>
 
 namespace cv{
 namespace ximgproc{
 
+/*
+The entry of the windows positions (r1,c1) and (r1+dr,c1+dc) is the sum of I(y,x)*I(y+dr,x+dc) over
+the box of (nr-pr+1)x(nc-pc+1) pixels starting at (r1,c1). It is the same sum over the whole image,
+i.e. the autocorrelation at (dr,dc) computed by FFT, minus the strips outside the box: less than pr
+rows and pc columns along the border. Their sums are shared by all the entries of an offset, so the
+cost is O(N log N) for the FFT plus O(w^3 (nr + nc)) for the strips instead of O(N w^2).
+*/
+
+typedef std::complex<double> Complexd;
+typedef std::complex<float> Complexf;
+
+// the bound of the complex elements of an FFT buffer; larger images are correlated in horizontal bands
+static const int COV_FFT_BUDGET = 1 << 18;
+
+static inline Complexd dotProduct(const Complexf* a, const Complexf* b, int n)
+{
+    double re = 0, im = 0;
+    for (int i = 0; i < n; i++)
+    {
+        re += (double)a[i].real()*b[i].real() - (double)a[i].imag()*b[i].imag();
+        im += (double)a[i].real()*b[i].imag() + (double)a[i].imag()*b[i].real();
+    }
+    return Complexd(re, im);
+}
+
+// sums[(t+1)*(KC+1) + u+1] is the sum of I(y,x)*I(y+dr,x+dc) for y = y0 + ystep*t', x = x0 + xstep*u',
+// t' <= t, u' <= u
+static void cornerPrefixSums(const Mat& input, int y0, int ystep, int x0, int xstep,
+                             int dr, int dc, int KR, int KC, std::vector<Complexd>& sums)
+{
+    int w = KC + 1;
+    sums.assign((KR + 1)*w, Complexd());
+    for (int t = 0; t < KR; t++)
+    {
+        const Complexf* row1 = input.ptr<Complexf>(y0 + ystep*t);
+        const Complexf* row2 = input.ptr<Complexf>(y0 + ystep*t + dr);
+        Complexd rowSum;
+        for (int u = 0; u < KC; u++)
+        {
+            int x = x0 + xstep*u;
+            rowSum += Complexd(row1[x])*Complexd(row2[x + dc]);
+            sums[(t + 1)*w + u + 1] = sums[t*w + u + 1] + rowSum;
+        }
+    }
+}
+
 class EstimateCovariance{
 
 public:
-    EstimateCovariance(int pr_, int pc_);
-    ~EstimateCovariance();
+    EstimateCovariance(int pr_, int pc_) : pr(pr_), pc(pc_), nr(0), nc(0) {}
 
-    void computeEstimateCovariance(Mat inputData,Mat outputData);
-    int combinationCount();
+    void computeEstimateCovariance(const Mat& inputData, Mat& outputData);
 
 private:
-    typedef struct {
-        int mult1r;
-        int mult1c;
-        int mult2r;
-        int mult2c;
-        int type2; // 0 - for the first P*P. 1 - for the next (P-1)(P-1)
-        int id;
-    } Combination;
-
-    void initInternalDataStructures();
-    void buildCombinationsTable();
-
-    void iterateCombinations(Mat inputData,Mat outputData);
-    void computeOneCombination(int comb_id, Mat inputData , Mat outputData,
-        Mat outputVector,std::vector<int> finalMatPosR, std::vector<int> finalMatPosC);
-
-    inline void complexSubtract(std::complex<float>& src, std::complex<float>& dst){dst-=src;}
-    inline void complexAdd(std::complex<float>& src, std::complex<float>& dst){dst+=src;}
-    inline void complexConjMulAndAdd(std::complex<float>& a, std::complex<float>& b,
-            std::complex<float>& dst){dst += a*b;}
-    inline void complexConjMul(std::complex<float>& a, std::complex<float>& b,
-            std::complex<float>& dst){dst = a*b;}
+    class AutocorrelationInvoker;
+    class OffsetInvoker;
+
+    void correlateBand(int y0, int y1, int dftCols, Mat& dst) const;
+    void computeAutocorrelation();
+    void computeOffset(int dr, int dc, Mat& outputData) const;
 
-private:
-    int nr;
-    int nc;
     int pr;
     int pc;
+    int nr;
+    int nc;
 
-    std::vector<Combination> combinationsTable;
+    Mat input;          // CV_32FC2
+    Mat leftT, rightT;  // the first and the last pc columns, transposed
+    Mat acorr;          // the autocorrelation for dr in [0, pr), dc in (-pc, pc), CV_64FC2
 };
 
+class EstimateCovariance::AutocorrelationInvoker : public ParallelLoopBody
+{
+public:
+    AutocorrelationInvoker(const EstimateCovariance& est_, int bandRows_, int dftCols_, std::vector<Mat>& bands_)
+        : est(est_), bandRows(bandRows_), dftCols(dftCols_), bands(bands_) {}
 
+    void operator () (const Range& range) const
+    {
+        for (int i = range.start; i < range.end; i++)
+            est.correlateBand(i*bandRows, std::min((i + 1)*bandRows, est.nr), dftCols, bands[i]);
+    }
 
-EstimateCovariance::EstimateCovariance(int pr_, int pc_){
-    pr=pr_; pc=pc_;
-}
-
-EstimateCovariance::~EstimateCovariance(){
-
-}
+private:
+    const EstimateCovariance& est;
+    int bandRows, dftCols;
+    std::vector<Mat>& bands;
+};
 
-void EstimateCovariance::initInternalDataStructures(){
-    int combCount = combinationCount();
-    combinationsTable.resize(combCount);
-    buildCombinationsTable();
-}
+class EstimateCovariance::OffsetInvoker : public ParallelLoopBody
+{
+public:
+    OffsetInvoker(const EstimateCovariance& est_, Mat& outputData_)
+        : est(est_), outputData(outputData_) {}
+
+    void operator () (const Range& range) const
+    {
+        int ndc = 2*est.pc - 1;
+        for (int i = range.start; i < range.end; i++)
+        {
+            int dr = i / ndc, dc = i % ndc - (est.pc - 1);
+            // the transposed entries are written with the opposite offset
+            if (dr > 0 || dc >= 0)
+                est.computeOffset(dr, dc, outputData);
+        }
+    }
 
-int EstimateCovariance::combinationCount(){
-    return  (pr*pc+(pr-1)*(pc-1));
-}
+private:
+    const EstimateCovariance& est;
+    Mat& outputData;
+};
 
-void EstimateCovariance::buildCombinationsTable()
+void EstimateCovariance::correlateBand(int y0, int y1, int dftCols, Mat& dst) const
 {
-    int idx_row,idx_col;
-    int comb_idx = 0;
-    Combination comb;
-
-    // The first element of the product is [0,0] and the second is to down and to the right of it.
-    for (idx_col=0; idx_col<pc; ++idx_col)  {
-        for (idx_row=0; idx_row<pr; ++idx_row)      {
-            comb.mult1r=0;
-            comb.mult1c=0;
-            comb.mult2r=idx_row;
-            comb.mult2c=idx_col;
-            comb.type2 = 0;
-            comb.id = comb_idx;
-            memcpy(&combinationsTable[comb_idx++], &comb, sizeof(Combination));
-        }
+    int h = y1 - y0, hb = std::min(nr, y1 + pr - 1) - y0;
+    int dftRows = getOptimalDFTSize(h + pr - 1);
+
+    // sum_n a(n)*b(n+d) = IDFT(DFT(b)*conj(DFT(conj(a))))(d); the padding keeps the circular
+    // correlation from wrapping for the offsets needed
+    Mat a = Mat::zeros(dftRows, dftCols, CV_64FC2), b = Mat::zeros(dftRows, dftCols, CV_64FC2);
+    Mat aroi = a(Rect(0, 0, nc, h)), broi = b(Rect(0, 0, nc, hb));
+    input.rowRange(y0, y1).convertTo(aroi, CV_64F);
+    input.rowRange(y0, y0 + hb).convertTo(broi, CV_64F);
+    for (int y = 0; y < h; y++)
+    {
+        Complexd* p = aroi.ptr<Complexd>(y);
+        for (int x = 0; x < nc; x++)
+            p[x] = std::conj(p[x]);
     }
 
-    // The first element is on the top right, and the second element is to the left and down of it.
-    for (idx_row=1; idx_row<pr; ++idx_row)  {
-        for (idx_col=1; idx_col<pc; ++idx_col)      {
-            comb.mult1r=idx_row;
-            comb.mult1c=0;
-            comb.mult2r=0;
-            comb.mult2c=idx_col;
-
-            comb.type2 = 1;
-            comb.id = comb_idx;
-            memcpy(&combinationsTable[comb_idx++], &comb, sizeof(Combination));
-        }
+    dft(a, a, 0, h);
+    dft(b, b, 0, hb);
+    mulSpectrums(b, a, b, 0, true);
+    dft(b, b, DFT_INVERSE | DFT_SCALE, pr);
+
+    dst.create(pr, 2*pc - 1, CV_64FC2);
+    for (int dr = 0; dr < pr; dr++)
+    {
+        const Complexd* src = b.ptr<Complexd>(dr);
+        Complexd* d = dst.ptr<Complexd>(dr);
+        for (int dc = -(pc - 1); dc < pc; dc++)
+            d[dc + pc - 1] = src[dc < 0 ? dc + dftCols : dc];
     }
 }
 
-void EstimateCovariance::computeEstimateCovariance(Mat inputData,Mat outputData){
-    initInternalDataStructures();
-    nr=inputData.rows;
-    nc=inputData.cols;
-
-    iterateCombinations(inputData,outputData);
-}
+void EstimateCovariance::computeAutocorrelation()
+{
+    int dftCols = getOptimalDFTSize(nc + pc - 1);
+    int bandRows = std::max(COV_FFT_BUDGET / dftCols - (pr - 1), pr);
+    int nbands = (nr + bandRows - 1) / bandRows;
 
+    std::vector<Mat> bands(nbands);
+    parallel_for_(Range(0, nbands), AutocorrelationInvoker(*this, bandRows, dftCols, bands));
 
-void EstimateCovariance::iterateCombinations(Mat inputData,Mat outputData)
-{
-    Mat outputVector(pr*pc,1,  DataType<std::complex<float> >::type);
-
-    std::vector<int> finalMatPosR(pr*pc,0);
-    std::vector<int> finalMatPosC(pr*pc,0);
-    int combs=combinationCount();
-    for (int idx=0; idx<combs; idx++){
-        outputVector.setTo(Scalar(0,0));
-        for (unsigned x=0; x<finalMatPosR.size(); x++)
-            finalMatPosR[x]=0;
-        for (unsigned x=0; x<finalMatPosC.size(); x++)
-            finalMatPosC[x]=0;
-        computeOneCombination(idx++, inputData, outputData,
-                outputVector,finalMatPosR, finalMatPosC);
-    }
+    // summed in order, the result doesn't depend on the threads
+    acorr = Mat::zeros(pr, 2*pc - 1, CV_64FC2);
+    for (int i = 0; i < nbands; i++)
+        acorr += bands[i];
 }
 
-void EstimateCovariance::computeOneCombination(int comb_id,Mat inputData, Mat outputData,
-            Mat outputVector,std::vector<int> finalMatPosR, std::vector<int> finalMatPosC)
+void EstimateCovariance::computeOffset(int dr, int dc, Mat& outputData) const
 {
-    Combination* comb = &combinationsTable[comb_id];
-    int type2 = comb->type2;
-    int deltaR = (int)abs((int)(comb->mult1r-comb->mult2r));
-    int deltaC = (int)abs((int)(comb->mult1c-comb->mult2c));
-    int numElementsInBlock = pr-abs(deltaR);
-    int numBlocks = pc-deltaC;
-    const int DR= nr-pr;
-    const int DC= nc-pc;
-
-    int elementC=0;
-    std::complex<float> temp_res = std::complex<float>(0,0);
-    int i,j,r,c;
-
-    if (!type2) {
-        // Computing the first index of the combination.
-        // This index is made up
-        for(i=0; i<=( DR); i++) {
-            int iPdr=i+deltaR;
-            for(j=0; j<= (DC); j++) {
-                int jPdc = j+deltaC;
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(i,j), inputData.at<std::complex<float> >(iPdr,jPdc), temp_res);
-            }
-        }
-    }else{
-        // Computing the first index of the combination.
-        for(i=0; i<=( DR); i++) {
-            int iPdr=i+deltaR;
-            for(j=0; j<= (DC); j++) {
-                int jPdc = j+deltaC;
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(iPdr,j), inputData.at<std::complex<float> >(i,jPdc), temp_res);
-            }
-        }
+    // the columns x in [xlo, xhi) have their partner x+dc inside the image
+    int xlo = std::max(0, -dc), xhi = std::min(nc, nc - dc);
+    int ylast = nr - dr - 1;
+    int KR = pr - 1 - dr, KC = pc - 1 - std::abs(dc);
+
+    // prefix sums of the rows (columns) outside the boxes, from the border inwards
+    std::vector<Complexd> rowTop(KR + 1), rowBottom(KR + 1), colLeft(KC + 1), colRight(KC + 1);
+    for (int t = 0; t < KR; t++)
+    {
+        rowTop[t + 1] = rowTop[t] + dotProduct(input.ptr<Complexf>(t) + xlo,
+                                               input.ptr<Complexf>(t + dr) + xlo + dc, xhi - xlo);
+        rowBottom[t + 1] = rowBottom[t] + dotProduct(input.ptr<Complexf>(ylast - t) + xlo,
+                                                     input.ptr<Complexf>(ylast - t + dr) + xlo + dc, xhi - xlo);
     }
-    outputVector.at<std::complex<float> >(0,0) = temp_res;
-
-    // Checking if the first element belongs to the first set of combinatons.
-    // The combination that the first element is above the second.
-    if (!type2) {
-        finalMatPosR[0]=0;
-        finalMatPosC[0]=pr*deltaC+deltaR;
-        elementC++;
-    }else{
-        finalMatPosR[0]=deltaR;
-        finalMatPosC[0]=pr*deltaC;
-        elementC++;
+    for (int u = 0; u < KC; u++)
+    {
+        int xl = xlo + u, xr = xhi - 1 - u - (nc - pc);
+        colLeft[u + 1] = colLeft[u] + dotProduct(leftT.ptr<Complexf>(xl), leftT.ptr<Complexf>(xl + dc) + dr, nr - dr);
+        colRight[u + 1] = colRight[u] + dotProduct(rightT.ptr<Complexf>(xr), rightT.ptr<Complexf>(xr + dc) + dr, nr - dr);
     }
 
-    for(r=1;r<(pr-deltaR);r++){
-        std::complex<float> newRowSum = std::complex<float>(0,0),oldRowSum = std::complex<float>(0,0);
-        std::complex<float> addRows  = std::complex<float>(0,0);
-
-        int rM1 = r-1;
-        int k = DR+1 + rM1;
-        int kPdr = k+deltaR;
-        int rM1Pdr = rM1 + deltaR;
-        int cPdc;
-
-        if (!type2) {
-            for(c=0;c<=(DC); c++){
-                cPdc = c+deltaC;
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(k,c),inputData.at<std::complex<float> >(kPdr,cPdc),newRowSum);
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(rM1,c),inputData.at<std::complex<float> >(rM1Pdr,cPdc),oldRowSum);
-            }
-        }else{
-            for(c=0;c<=(DC); c++){
-                cPdc = c+deltaC;
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(kPdr,c),inputData.at<std::complex<float> >(k,cPdc),newRowSum);
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(rM1Pdr,c),inputData.at<std::complex<float> >(rM1,cPdc),oldRowSum);
-            }
+    // the corners are subtracted twice
+    std::vector<Complexd> topLeft, topRight, bottomLeft, bottomRight;
+    cornerPrefixSums(input, 0, 1, xlo, 1, dr, dc, KR, KC, topLeft);
+    cornerPrefixSums(input, 0, 1, xhi - 1, -1, dr, dc, KR, KC, topRight);
+    cornerPrefixSums(input, ylast, -1, xlo, 1, dr, dc, KR, KC, bottomLeft);
+    cornerPrefixSums(input, ylast, -1, xhi - 1, -1, dr, dc, KR, KC, bottomRight);
+
+    int w = KC + 1;
+    Complexd full = acorr.at<Complexd>(dr, dc + pc - 1);
+    for (int r1 = 0; r1 < pr - dr; r1++)
+    {
+        int kt = r1, kb = KR - r1;
+        for (int c1 = xlo; c1 < pc - std::max(dc, 0); c1++)
+        {
+            int kl = c1 - xlo, kr = KC - kl;
+            Complexd v = full - rowTop[kt] - rowBottom[kb] - colLeft[kl] - colRight[kr] +
+                         topLeft[kt*w + kl] + topRight[kt*w + kr] + bottomLeft[kb*w + kl] + bottomRight[kb*w + kr];
+
+            // the elements of a window are numbered column by column
+            int p = pr*c1 + r1, q = pr*(c1 + dc) + r1 + dr;
+            outputData.at<Complexf>(p, q) = outputData.at<Complexf>(q, p) = Complexf(v);
         }
-        complexAdd(newRowSum,addRows);
-        complexSubtract(oldRowSum,addRows);
-        complexAdd(outputVector.at<std::complex<float> >(rM1,0),outputVector.at<std::complex<float> >(r,0));
-        complexAdd(addRows,outputVector.at<std::complex<float> >(r,0));
-
-        finalMatPosR[elementC]=finalMatPosR[elementC-1]+1;;
-        finalMatPosC[elementC]=finalMatPosC[elementC-1]+1;
-        elementC++;
-    }
-
-    for(c=1; c<numBlocks; c++)  {
-        std::complex<float> newColSum = std::complex<float>(0,0),oldColSum = std::complex<float>(0,0);
-        std::complex<float> addCols  = std::complex<float>(0,0);
-
-        // Index arithmetic
-        int cM1 = c-1;
-        int dcPc = DC+c;
-        int q = DC+1 + cM1;
-        int cM1PdeltaC = cM1 + deltaC;
-        int dcPcPdeltaC = dcPc+deltaC;
-
-        if (!type2) {
-            for(r=0;r<=(DR); r++){
-                int rPdr = r+deltaR;
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(r,q),inputData.at<std::complex<float> >(rPdr,q+deltaC),newColSum);
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(r,cM1),inputData.at<std::complex<float> >(rPdr,cM1+deltaC),oldColSum);
-            }
-        }else{
-            for(r=0;r<=(DR); r++){
-                int rPdr = r+deltaR;
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(rPdr,q),inputData.at<std::complex<float> >(r,q+deltaC),newColSum);
-                complexConjMulAndAdd(inputData.at<std::complex<float> >(rPdr,cM1),inputData.at<std::complex<float> >(r,cM1+deltaC),oldColSum);
-            }
-        }
-        complexAdd(newColSum,addCols);
-        complexSubtract(oldColSum,addCols);
-        complexAdd(outputVector.at<std::complex<float> >((c-1)*numElementsInBlock,0),outputVector.at<std::complex<float> >(c*numElementsInBlock,0));
-        complexAdd(addCols,outputVector.at<std::complex<float> >(c*numElementsInBlock,0));
-
-        finalMatPosR[elementC]=finalMatPosR[elementC-numElementsInBlock]+pr;
-        finalMatPosC[elementC]=finalMatPosC[elementC-numElementsInBlock]+pr;
-        elementC++;
-
-        for(r=1; r<numElementsInBlock; r++) {
-            std::complex<float> w = std::complex<float>(0,0),x = std::complex<float>(0,0),
-                y = std::complex<float>(0,0),z = std::complex<float>(0,0),deltaRowSum = std::complex<float>(0,0);
-            std::complex<float> tempRes = std::complex<float>(0,0);
-            // Index arithmetic
-            int rM1 = r-1;
-            int drPr = DR+r;
-            int rM1PdeltaR = rM1 + deltaR;
-            int drPrPdeltaR = drPr+deltaR;
-
-            if (!type2) {
-                complexConjMul(inputData.at<std::complex<float> >(rM1,cM1),inputData.at<std::complex<float> >(rM1PdeltaR,cM1PdeltaC),w);
-                complexConjMul(inputData.at<std::complex<float> >(rM1,dcPc),inputData.at<std::complex<float> >(rM1PdeltaR,dcPcPdeltaC),x);
-                complexConjMul(inputData.at<std::complex<float> >(drPr,cM1),inputData.at<std::complex<float> >(drPrPdeltaR,cM1PdeltaC),y);
-                complexConjMul(inputData.at<std::complex<float> >(drPr,dcPc),inputData.at<std::complex<float> >(drPrPdeltaR,dcPcPdeltaC),z);
-            }else{
-                complexConjMul(inputData.at<std::complex<float> >(rM1PdeltaR,cM1),inputData.at<std::complex<float> >(rM1,cM1PdeltaC),w);
-                complexConjMul(inputData.at<std::complex<float> >(rM1PdeltaR,dcPc),inputData.at<std::complex<float> >(rM1,dcPcPdeltaC),x);
-                complexConjMul(inputData.at<std::complex<float> >(drPrPdeltaR,cM1),inputData.at<std::complex<float> >(drPr,cM1PdeltaC),y);
-                complexConjMul(inputData.at<std::complex<float> >(drPrPdeltaR,dcPc),inputData.at<std::complex<float> >(drPr,dcPcPdeltaC),z);
-            }
-            complexAdd(w,tempRes);
-            complexSubtract(x,tempRes);
-            complexSubtract(y,tempRes);
-            complexAdd(z,tempRes);
-
-            complexAdd(outputVector.at<std::complex<float> >((c-1)*numElementsInBlock + r,0),deltaRowSum);
-            complexSubtract(outputVector.at<std::complex<float> >((c-1)*numElementsInBlock+ rM1,0),deltaRowSum);
-
-            complexAdd(deltaRowSum,tempRes);
-            complexAdd(outputVector.at<std::complex<float> >(c*numElementsInBlock+rM1,0),tempRes);
-            complexAdd(tempRes,outputVector.at<std::complex<float> >(c*numElementsInBlock+r,0));
-
-            finalMatPosR[elementC]=finalMatPosR[elementC-1]+1;
-            finalMatPosC[elementC]=finalMatPosC[elementC-1]+1;
-            elementC++;
-        }
-    }
-
-    for(i=0; i<numElementsInBlock*numBlocks; i++){
-        outputData.at<std::complex<float> >(finalMatPosR[i],finalMatPosC[i])=outputVector.at<std::complex<float> >(i,0);
     }
 }
 
+void EstimateCovariance::computeEstimateCovariance(const Mat& inputData, Mat& outputData)
+{
+    input = inputData;
+    nr = input.rows;
+    nc = input.cols;
+    transpose(input.colRange(0, pc), leftT);
+    transpose(input.colRange(nc - pc, nc), rightT);
+
+    computeAutocorrelation();
+    parallel_for_(Range(0, pr*(2*pc - 1)), OffsetInvoker(*this, outputData));
+}
 
 
 void covarianceEstimation(InputArray input_, OutputArray output_,int windowRows, int windowCols){
@@ -360,9 +293,9 @@ void covarianceEstimation(InputArray input_, OutputArray output_,int windowRows,
 
     }
 
-    EstimateCovariance estCov(windowRows,windowCols);
+    CV_Assert(windowRows > 0 && windowCols > 0 && windowRows <= input.rows && windowCols <= input.cols);
 
-    //input_.getMat().convertTo(input, CV_32FC2);
+    EstimateCovariance estCov(windowRows,windowCols);
 
     output_.create(windowRows*windowCols,windowRows*windowCols,  DataType<std::complex<float> >::type);
 
@@ -42,6 +42,8 @@
 //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include <algorithm>
 
 namespace cv { namespace ximgproc {
 
@@ -49,67 +51,152 @@ namespace cv { namespace ximgproc {
     typedef __int32 int32_t;
 #endif
 
-template<typename T, int D, HoughOp Op>
-struct HoughOperator { };
-#define SPECIALIZE_HOUGHOP(TOp, body)                                         \
-    template<typename T, int D>                                               \
-    struct HoughOperator<T, D, TOp> {                                         \
-        static void operate(T *pDst, T *pSrc0, T* pSrc1, int len) {           \
-            Mat dst (Size(1, len), D, pDst);                                  \
-            Mat src0(Size(1, len), D, pSrc0);                                 \
-            Mat src1(Size(1, len), D, pSrc1);                                 \
-            body;                                                             \
+template<typename T> struct HoughAveWorkType { typedef float type; };
+template<> struct HoughAveWorkType<int> { typedef double type; };
+template<> struct HoughAveWorkType<float> { typedef double type; };
+template<> struct HoughAveWorkType<double> { typedef double type; };
+
+// element-wise operations, the results are the same as of add, min, max and
+// addWeighted(src0, 0.5, src1, 0.5, 0.0) for the corresponding depth
+template<typename T, HoughOp Op>
+struct HoughScalarOp { };
+template<typename T>
+struct HoughScalarOp<T, FHT_ADD> {
+    static inline T apply(T a, T b) { return saturate_cast<T>(a + b); }
+};
+template<typename T>
+struct HoughScalarOp<T, FHT_MIN> {
+    static inline T apply(T a, T b) { return std::min(a, b); }
+};
+template<typename T>
+struct HoughScalarOp<T, FHT_MAX> {
+    static inline T apply(T a, T b) { return std::max(a, b); }
+};
+template<typename T>
+struct HoughScalarOp<T, FHT_AVE> {
+    static inline T apply(T a, T b) {
+        typedef typename HoughAveWorkType<T>::type WT;
+        return saturate_cast<T>(a * (WT)0.5 + b * (WT)0.5 + (WT)0);
+    }
+};
+
+// processes the beginning of the rows with universal intrinsics, returns the
+// number of processed elements
+template<typename T, HoughOp Op>
+struct HoughVecOperator {
+    static inline int operate(T *, const T *, const T *, int) { return 0; }
+};
+#if CV_SIMD128
+#define SPECIALIZE_HOUGHVECOP(T, VT, TOp, expr)                               \
+    template<>                                                                \
+    struct HoughVecOperator<T, TOp> {                                         \
+        static inline int operate(T *pDst, const T *pSrc0, const T *pSrc1,    \
+                                  int len) {                                  \
+            int i = 0;                                                        \
+            for (; i <= len - VT::nlanes; i += VT::nlanes) {                  \
+                VT a = v_load(pSrc0 + i), b = v_load(pSrc1 + i);              \
+                v_store(pDst + i, expr);                                      \
+            }                                                                 \
+            return i;                                                         \
         }                                                                     \
     };
-SPECIALIZE_HOUGHOP(FHT_ADD, add(src0, src1, dst));
-SPECIALIZE_HOUGHOP(FHT_MIN, min(src0, src1, dst));
-SPECIALIZE_HOUGHOP(FHT_MAX, max(src0, src1, dst));
-SPECIALIZE_HOUGHOP(FHT_AVE, addWeighted(src0, 0.5, src1, 0.5, 0.0, dst));
-#undef SPECIALIZE_HOUGHOP
+#define SPECIALIZE_HOUGHVECOPS(T, VT)                                         \
+    SPECIALIZE_HOUGHVECOP(T, VT, FHT_ADD, a + b)                              \
+    SPECIALIZE_HOUGHVECOP(T, VT, FHT_MIN, v_min(a, b))                        \
+    SPECIALIZE_HOUGHVECOP(T, VT, FHT_MAX, v_max(a, b))
+SPECIALIZE_HOUGHVECOPS(uchar, v_uint8x16)
+SPECIALIZE_HOUGHVECOPS(schar, v_int8x16)
+SPECIALIZE_HOUGHVECOPS(ushort, v_uint16x8)
+SPECIALIZE_HOUGHVECOPS(short, v_int16x8)
+SPECIALIZE_HOUGHVECOPS(int, v_int32x4)
+SPECIALIZE_HOUGHVECOPS(float, v_float32x4)
+#if CV_SIMD128_64F
+SPECIALIZE_HOUGHVECOPS(double, v_float64x2)
+#endif
+#undef SPECIALIZE_HOUGHVECOPS
+#undef SPECIALIZE_HOUGHVECOP
+#endif
+
+template<typename T, HoughOp Op>
+struct HoughOperator {
+    static void operate(T *pDst, const T *pSrc0, const T *pSrc1, int len) {
+        int i = HoughVecOperator<T, Op>::operate(pDst, pSrc0, pSrc1, len);
+        for (; i < len; i++)
+            pDst[i] = HoughScalarOp<T, Op>::apply(pSrc0[i], pSrc1[i]);
+    }
+};
 
 //----------------------fht----------------------------------------------------
 
-template <typename T, int D, HoughOp OP>
-void fhtCore(Mat     &img0,
-             Mat     &img1,
-             int32_t  y0,
-             int32_t  h,
-             bool     isPositiveShift,
-             int      level,
-             double   aspl)
+// Segment [y0, y0 + h) of rows processed by one recursive call of fht.
+// The segments of the same depth don't intersect, so they are processed
+// together, from the deepest one to the root.
+struct FHTSegment
+{
+    int32_t y0;
+    int32_t h;
+    int     level;
+};
+
+static void collectFHTSegments(std::vector<std::vector<FHTSegment> > &depths,
+                               int32_t y0,
+                               int32_t h,
+                               int     level,
+                               size_t  depth)
 {
     if (level <= 0)
         return;
 
     CV_Assert(h > 0);
+    if (depths.size() <= depth)
+        depths.resize(depth + 1);
+    FHTSegment segment = { y0, h, level };
+    depths[depth].push_back(segment);
     if (h == 1)
-    {
-        if ((aspl != 0.0) && (level == 1))
-        {
-            int w = img0.cols;
-            uchar* pLine0 = img0.data + img0.step * y0;
-            uchar* pLine1 = img1.data + img1.step * y0;
-            int dLine = cvRound(y0 * aspl);
-            dLine = dLine % w;
-            dLine = dLine * (int)(img1.elemSize());
-            int wLine = img0.cols * (int)(img0.elemSize());
-            memcpy(pLine0, pLine1 + wLine - dLine, dLine);
-            memcpy(pLine0 + dLine, pLine1, wLine - dLine);
-        }
-        else
-        {
-            memcpy(img0.data + img0.step * y0,
-                   img1.data + img1.step * y0,
-                   img0.cols * (int)(img0.elemSize()));
-        }
         return;
-    }
+
     const int32_t k = h >> 1;
-    fhtCore<T, D, OP>(img1, img0, y0, k,
-                      isPositiveShift, level - 1, aspl);
-    fhtCore<T, D, OP>(img1, img0, y0 + k, h - k,
-                      isPositiveShift, level - 1, aspl);
+    collectFHTSegments(depths, y0, k, level - 1, depth + 1);
+    collectFHTSegments(depths, y0 + k, h - k, level - 1, depth + 1);
+}
 
+static void fhtCopyLine(Mat     &img0,
+                        Mat     &img1,
+                        int32_t  y0,
+                        int      level,
+                        double   aspl)
+{
+    if ((aspl != 0.0) && (level == 1))
+    {
+        int w = img0.cols;
+        uchar* pLine0 = img0.data + img0.step * y0;
+        uchar* pLine1 = img1.data + img1.step * y0;
+        int dLine = cvRound(y0 * aspl);
+        dLine = dLine % w;
+        dLine = dLine * (int)(img1.elemSize());
+        int wLine = img0.cols * (int)(img0.elemSize());
+        memcpy(pLine0, pLine1 + wLine - dLine, dLine);
+        memcpy(pLine0 + dLine, pLine1, wLine - dLine);
+    }
+    else
+    {
+        memcpy(img0.data + img0.step * y0,
+               img1.data + img1.step * y0,
+               img0.cols * (int)(img0.elemSize()));
+    }
+}
+
+template <typename T, HoughOp OP>
+void fhtMergeLine(Mat     &img0,
+                  Mat     &img1,
+                  int32_t  y0,
+                  int32_t  h,
+                  int32_t  s,
+                  bool     isPositiveShift,
+                  int      level,
+                  double   aspl)
+{
+    const int32_t k = h >> 1;
     int au = 2 * k - 2;
     int ad = 2 * h - 2 * k - 2;
     int b = h - 1;
@@ -117,93 +204,135 @@ void fhtCore(Mat     &img0,
     int w = img0.cols;
     int wm = (h / w + 1) * w;
 
-    for (int32_t s = 0; s < h; s++)
+    int su = (s * au + b) / d;
+    int sd = (s * ad + b) / d;
+    int rd = isPositiveShift ? sd - s : s - sd;
+    rd = (rd + wm) % w;
+    uchar *pLine0 = img0.data + img0.step * (y0 + s);
+    uchar *pLineU = img1.data + img1.step * (y0 + su);
+    uchar *pLineD = img1.data + img1.step * (y0 + k + sd);
+    int w0 = img0.channels() * rd;
+    int w1 = img0.channels() * (w - rd);
+
+    if ((aspl != 0.0) && (level == 1))
     {
-        int su = (s * au + b) / d;
-        int sd = (s * ad + b) / d;
-        int rd = isPositiveShift ? sd - s : s - sd;
-        rd = (rd + wm) % w;
-        uchar *pLine0 = img0.data + img0.step * (y0 + s);
-        uchar *pLineU = img1.data + img1.step * (y0 + su);
-        uchar *pLineD = img1.data + img1.step * (y0 + k + sd);
-        int w0 = img0.channels() * rd;
-        int w1 = img0.channels() * (w - rd);
-
-        if ((aspl != 0.0) && (level == 1))
+        int dU = cvRound((y0 + su) * aspl);
+        dU = dU % w;
+        dU *= img0.channels();
+        int dD = cvRound((y0 + k + sd) * aspl);
+        dD = dD % w;
+        dD *= img0.channels();
+        int wB = w * img0.channels();
+
+        int dX = dD - dU;
+        if (w0 >= dX)
         {
-            int dU = cvRound((y0 + su) * aspl);
-            dU = dU % w;
-            dU *= img0.channels();
-            int dD = cvRound((y0 + k + sd) * aspl);
-            dD = dD % w;
-            dD *= img0.channels();
-            int wB = w * img0.channels();
-
-            int dX = dD - dU;
-            if (w0 >= dX)
+            if (w0 >= dD)
             {
-                if (w0 >= dD)
-                {
-                    HoughOperator<T, D, OP>::operate((T *)pLine0 + dU,
-                                               (T *)pLineU,
-                                               (T *)pLineD + (w0 - dX),
-                                               w1 + dX);
-                    HoughOperator<T, D, OP>::operate((T *)pLine0 + (w1 + dD),
-                                               (T *)pLineU + (w1 + dX),
-                                               (T *)pLineD,
-                                               w0 - dD);
-                    HoughOperator<T, D, OP>::operate((T *)pLine0,
-                                               (T *)pLineU + (wB - dU),
-                                               (T *)pLineD + (w0 - dD),
-                                               dU);
-                }
-                else
-                {
-                    HoughOperator<T, D, OP>::operate((T *)pLine0 + dU,
-                                               (T *)pLineU,
-                                               (T *)pLineD + (w0 - dX),
-                                               wB - dU);
-                    HoughOperator<T, D, OP>::operate((T *)pLine0,
-                                               (T *)pLineU + (wB - dU),
-                                               (T *)pLineD + (w0 + wB - dD),
-                                               dD - w0);
-                    HoughOperator<T, D, OP>::operate((T *)pLine0 + (dD - w0),
-                                               (T *)pLineU + (w1 + dX),
-                                               (T *)pLineD,
-                                               w0 - dX);
-                }
+                HoughOperator<T, OP>::operate((T *)pLine0 + dU,
+                                              (T *)pLineU,
+                                              (T *)pLineD + (w0 - dX),
+                                              w1 + dX);
+                HoughOperator<T, OP>::operate((T *)pLine0 + (w1 + dD),
+                                              (T *)pLineU + (w1 + dX),
+                                              (T *)pLineD,
+                                              w0 - dD);
+                HoughOperator<T, OP>::operate((T *)pLine0,
+                                              (T *)pLineU + (wB - dU),
+                                              (T *)pLineD + (w0 - dD),
+                                              dU);
             }
             else
             {
-                HoughOperator<T, D, OP>::operate((T *)pLine0 + dU,
-                                           (T *)pLineU,
-                                           (T *)pLineD + (wB - (dX - w0)),
-                                           dX - w0);
-                HoughOperator<T, D, OP>::operate((T *)pLine0 + (dD - w0),
-                                           (T *)pLineU + (dX - w0),
-                                           (T *)pLineD,
-                                           wB - (dX - w0) - dU);
-                HoughOperator<T, D, OP>::operate((T *)pLine0,
-                                           (T *)pLineU + (wB - dU),
-                                           (T *)pLineD + (wB - (dX - w0) - dU),
-                                           dU);
+                HoughOperator<T, OP>::operate((T *)pLine0 + dU,
+                                              (T *)pLineU,
+                                              (T *)pLineD + (w0 - dX),
+                                              wB - dU);
+                HoughOperator<T, OP>::operate((T *)pLine0,
+                                              (T *)pLineU + (wB - dU),
+                                              (T *)pLineD + (w0 + wB - dD),
+                                              dD - w0);
+                HoughOperator<T, OP>::operate((T *)pLine0 + (dD - w0),
+                                              (T *)pLineU + (w1 + dX),
+                                              (T *)pLineD,
+                                              w0 - dX);
             }
         }
         else
         {
-            HoughOperator<T, D, OP>::operate((T *)pLine0,
-                                        (T *)pLineU,
-                                        (T *)pLineD + w0,
-                                        w1);
-            HoughOperator<T, D, OP>::operate((T *)pLine0 + w1,
-                                        (T *)pLineU + w1,
-                                        (T *)pLineD,
-                                        w0);
+            HoughOperator<T, OP>::operate((T *)pLine0 + dU,
+                                          (T *)pLineU,
+                                          (T *)pLineD + (wB - (dX - w0)),
+                                          dX - w0);
+            HoughOperator<T, OP>::operate((T *)pLine0 + (dD - w0),
+                                          (T *)pLineU + (dX - w0),
+                                          (T *)pLineD,
+                                          wB - (dX - w0) - dU);
+            HoughOperator<T, OP>::operate((T *)pLine0,
+                                          (T *)pLineU + (wB - dU),
+                                          (T *)pLineD + (wB - (dX - w0) - dU),
+                                          dU);
         }
     }
+    else
+    {
+        HoughOperator<T, OP>::operate((T *)pLine0,
+                                      (T *)pLineU,
+                                      (T *)pLineD + w0,
+                                      w1);
+        HoughOperator<T, OP>::operate((T *)pLine0 + w1,
+                                      (T *)pLineU + w1,
+                                      (T *)pLineD,
+                                      w0);
+    }
 }
 
-template <typename T, int D, HoughOp Op>
+// Processes all lines of the segments of one depth. Segments of even depth
+// write to img0 and read img1, segments of odd depth do the opposite.
+template <typename T, HoughOp OP>
+class FHTDepthInvoker : public ParallelLoopBody
+{
+public:
+    FHTDepthInvoker(Mat                          &img0,
+                    Mat                          &img1,
+                    const std::vector<FHTSegment> &segments,
+                    const std::vector<int>        &lineStart,
+                    bool                           isPositiveShift,
+                    double                         aspl)
+        : img0_(img0), img1_(img1), segments_(segments), lineStart_(lineStart),
+          isPositiveShift_(isPositiveShift), aspl_(aspl) { }
+
+    void operator()(const Range &range) const
+    {
+        // index of the segment containing the line range.start
+        size_t i = std::upper_bound(lineStart_.begin(), lineStart_.end(),
+                                    range.start) - lineStart_.begin() - 1;
+        for (int line = range.start; line < range.end; line++)
+        {
+            while (line >= lineStart_[i + 1])
+                i++;
+            const FHTSegment &seg = segments_[i];
+            if (seg.h == 1)
+                fhtCopyLine(img0_, img1_, seg.y0, seg.level, aspl_);
+            else
+                fhtMergeLine<T, OP>(img0_, img1_, seg.y0, seg.h,
+                                    line - lineStart_[i],
+                                    isPositiveShift_, seg.level, aspl_);
+        }
+    }
+
+private:
+    FHTDepthInvoker &operator=(const FHTDepthInvoker &);
+
+    Mat                           &img0_;
+    Mat                           &img1_;
+    const std::vector<FHTSegment> &segments_;
+    const std::vector<int>        &lineStart_;
+    bool                           isPositiveShift_;
+    double                         aspl_;
+};
+
+template <typename T, HoughOp Op>
 void fhtVoT(Mat    &img0,
             Mat    &img1,
             bool    isPositiveShift,
@@ -213,10 +342,29 @@ void fhtVoT(Mat    &img0,
     for (int thres = 1; img0.rows > thres; thres <<= 1)
         level++;
 
-    fhtCore<T, D, Op>(img0, img1, 0, img0.rows, isPositiveShift, level, aspl);
+    std::vector<std::vector<FHTSegment> > depths;
+    collectFHTSegments(depths, 0, img0.rows, level, 0);
+
+    const double nstripes = std::max(1.0, img0.total() * img0.elemSize() / 65536.0);
+    std::vector<int> lineStart;
+    for (size_t depth = depths.size(); depth-- > 0; )
+    {
+        const std::vector<FHTSegment> &segments = depths[depth];
+        lineStart.resize(segments.size() + 1);
+        lineStart[0] = 0;
+        for (size_t i = 0; i < segments.size(); i++)
+            lineStart[i + 1] = lineStart[i] + segments[i].h;
+
+        Mat &dst = (depth & 1) ? img1 : img0;
+        Mat &src = (depth & 1) ? img0 : img1;
+        parallel_for_(Range(0, lineStart.back()),
+                      FHTDepthInvoker<T, Op>(dst, src, segments, lineStart,
+                                             isPositiveShift, aspl),
+                      nstripes);
+    }
 }
 
-template <typename T, int D>
+template <typename T>
 void fhtVo(Mat    &img0,
            Mat    &img1,
            bool    isPositiveShift,
@@ -226,16 +374,16 @@ void fhtVo(Mat    &img0,
     switch (operation)
     {
     case FHT_ADD:
-        fhtVoT<T, D, FHT_ADD>(img0, img1, isPositiveShift, aspl);
+        fhtVoT<T, FHT_ADD>(img0, img1, isPositiveShift, aspl);
         break;
     case FHT_AVE:
-        fhtVoT<T, D, FHT_AVE>(img0, img1, isPositiveShift, aspl);
+        fhtVoT<T, FHT_AVE>(img0, img1, isPositiveShift, aspl);
         break;
     case FHT_MAX:
-        fhtVoT<T, D, FHT_MAX>(img0, img1, isPositiveShift, aspl);
+        fhtVoT<T, FHT_MAX>(img0, img1, isPositiveShift, aspl);
         break;
     case FHT_MIN:
-        fhtVoT<T, D, FHT_MIN>(img0, img1, isPositiveShift, aspl);
+        fhtVoT<T, FHT_MIN>(img0, img1, isPositiveShift, aspl);
         break;
     default:
         CV_Error_(CV_StsNotImplemented, ("Unknown operation %d", operation));
@@ -253,25 +401,25 @@ static void fhtVo(Mat    &img0,
     switch (depth)
     {
     case CV_8U:
-        fhtVo<uchar, CV_8UC1>(img0, img1, isPositiveShift, operation, aspl);
+        fhtVo<uchar>(img0, img1, isPositiveShift, operation, aspl);
         break;
     case CV_8S:
-        fhtVo<schar, CV_8SC1>(img0, img1, isPositiveShift, operation, aspl);
+        fhtVo<schar>(img0, img1, isPositiveShift, operation, aspl);
         break;
     case CV_16U:
-        fhtVo<ushort, CV_16UC1>(img0, img1, isPositiveShift, operation, aspl);
+        fhtVo<ushort>(img0, img1, isPositiveShift, operation, aspl);
         break;
     case CV_16S:
-        fhtVo<short, CV_16SC1>(img0, img1, isPositiveShift, operation, aspl);
+        fhtVo<short>(img0, img1, isPositiveShift, operation, aspl);
         break;
     case CV_32S:
-        fhtVo<int, CV_32SC1>(img0, img1, isPositiveShift, operation, aspl);
+        fhtVo<int>(img0, img1, isPositiveShift, operation, aspl);
         break;
     case CV_32F:
-        fhtVo<float, CV_32FC1>(img0, img1, isPositiveShift, operation, aspl);
+        fhtVo<float>(img0, img1, isPositiveShift, operation, aspl);
         break;
     case CV_64F:
-        fhtVo<double, CV_64FC1>(img0, img1, isPositiveShift, operation, aspl);
+        fhtVo<double>(img0, img1, isPositiveShift, operation, aspl);
         break;
     default:
         CV_Error_(CV_StsNotImplemented, ("Unknown depth %d", depth));
@@ -545,6 +693,54 @@ static void skewQuadrant(Mat         &quad,
     }
 }
 
+static void processFHTQuadrant(Mat       &dst,
+                               const Mat &imgSrc,
+                               int        operation,
+                               int        quadrant,
+                               int        makeSkew,
+                               uchar     *pBuf)
+{
+    calculateFHTQuadrant(dst, imgSrc, operation, quadrant);
+    if (quadrant == ARO_315_0 || quadrant == ARO_45_90 || quadrant == ARO_CTR_VER)
+        flip(dst, dst, 0);
+    if (HDO_DESKEW == makeSkew)
+        skewQuadrant(dst, imgSrc, pBuf, quadrant);
+}
+
+// Quadrants of a wide angle range are computed to separate matrices in
+// parallel, the neighbouring regions of dst share a line.
+class FHTQuadrantsInvoker : public ParallelLoopBody
+{
+public:
+    FHTQuadrantsInvoker(std::vector<Mat>       &quads,
+                        const std::vector<Mat*> &imgSrcs,
+                        const std::vector<int>  &quadrants,
+                        int                      operation,
+                        int                      makeSkew)
+        : quads_(quads), imgSrcs_(imgSrcs), quadrants_(quadrants),
+          operation_(operation), makeSkew_(makeSkew) { }
+
+    void operator()(const Range &range) const
+    {
+        for (int i = range.start; i < range.end; i++)
+        {
+            Mat &quad = quads_[i];
+            std::vector<uchar> buf(quad.cols * quad.elemSize());
+            processFHTQuadrant(quad, *imgSrcs_[i], operation_, quadrants_[i],
+                               makeSkew_, &buf[0]);
+        }
+    }
+
+private:
+    FHTQuadrantsInvoker &operator=(const FHTQuadrantsInvoker &);
+
+    std::vector<Mat>        &quads_;
+    const std::vector<Mat*> &imgSrcs_;
+    const std::vector<int>  &quadrants_;
+    int                      operation_;
+    int                      makeSkew_;
+};
+
 void FastHoughTransform(InputArray  src,
                         OutputArray dst,
                         int         dstMatDepth,
@@ -560,112 +756,66 @@ void FastHoughTransform(InputArray  src,
     createDstFhtMat(dst, src, dstMatDepth, angleRange);
     Mat dstMat = dst.getMat();
 
-    Mat imgRegDst;
     const int len = dstMat.cols * static_cast<int>(dstMat.elemSize());
     CV_Assert(len > 0);
-    std::vector<uchar> buf_(len);
-    uchar *buf(&buf_[0]);
-
-    if (angleRange == ARO_315_135)
-    {
-        {
-            Mat imgSrc;
-            createFHTSrc(imgSrc, srcMat, ARO_315_45);
-
-            setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_315_0, angleRange);
-            calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_315_0);
-            flip(imgRegDst, imgRegDst, 0);
-            if (HDO_DESKEW == makeSkew)
-                skewQuadrant(imgRegDst, imgSrc, buf, ARO_315_0);
-
-            setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_0_45, angleRange);
-            calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_0_45);
-            if (HDO_DESKEW == makeSkew)
-                skewQuadrant(imgRegDst, imgSrc, buf, ARO_0_45);
-        }
-        {
-            Mat imgSrc;
-            createFHTSrc(imgSrc, srcMat, ARO_45_135);
-
-            setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_45_90, angleRange);
-            calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_45_90);
-            flip(imgRegDst, imgRegDst, 0);
-            if (HDO_DESKEW == makeSkew)
-                skewQuadrant(imgRegDst, imgSrc, buf, ARO_45_90);
-
-            setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_90_135, angleRange);
-            calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_90_135);
-            if (HDO_DESKEW == makeSkew)
-                skewQuadrant(imgRegDst, imgSrc, buf, ARO_90_135);
-        }
-        return;
-    }
-
-    Mat imgSrc;
-    createFHTSrc(imgSrc, srcMat, angleRange);
 
+    Mat imgSrc, imgSrcHor;
+    std::vector<int> quadrants;
+    std::vector<Mat*> imgSrcs;
     switch (angleRange)
     {
     case ARO_315_0:
-        calculateFHTQuadrant(dstMat, imgSrc, operation, angleRange);
-        flip(dstMat, dstMat, 0);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(dstMat, imgSrc, buf, angleRange);
-        return;
     case ARO_0_45:
-        calculateFHTQuadrant(dstMat, imgSrc, operation, angleRange);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(dstMat, imgSrc, buf, angleRange);
-        return;
     case ARO_45_90:
-        calculateFHTQuadrant(dstMat, imgSrc, operation, angleRange);
-        flip(dstMat, dstMat, 0);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(dstMat, imgSrc, buf, angleRange);
-        return;
     case ARO_90_135:
-        calculateFHTQuadrant(dstMat, imgSrc, operation, angleRange);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(dstMat, imgSrc, buf, angleRange);
-        return;
-    case ARO_315_45:
-        setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_315_0, angleRange);
-        calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_315_0);
-        flip(imgRegDst, imgRegDst, 0);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(imgRegDst, imgSrc, buf, ARO_315_0);
-
-        setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_0_45, angleRange);
-        calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_0_45);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(imgRegDst, imgSrc, buf, ARO_0_45);
-        return;
-    case ARO_45_135:
-        setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_45_90, angleRange);
-        calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_45_90);
-        flip(imgRegDst, imgRegDst, 0);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(imgRegDst, imgSrc, buf, ARO_45_90);
-
-        setFHTDstRegion(imgRegDst, dstMat, srcMat, ARO_90_135, angleRange);
-        calculateFHTQuadrant(imgRegDst, imgSrc, operation, ARO_90_135);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(imgRegDst, imgSrc, buf, ARO_90_135);
-        return;
     case ARO_CTR_VER:
-        calculateFHTQuadrant(dstMat, imgSrc, operation, angleRange);
-        flip(dstMat, dstMat, 0);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(dstMat, imgSrc, buf, angleRange);
-        return;
     case ARO_CTR_HOR:
-        calculateFHTQuadrant(dstMat, imgSrc, operation, angleRange);
-        if (HDO_DESKEW == makeSkew)
-            skewQuadrant(dstMat, imgSrc, buf, angleRange);
+    {
+        std::vector<uchar> buf_(len);
+        createFHTSrc(imgSrc, srcMat, angleRange);
+        processFHTQuadrant(dstMat, imgSrc, operation, angleRange, makeSkew, &buf_[0]);
         return;
+    }
+    case ARO_315_45:
+        createFHTSrc(imgSrc, srcMat, angleRange);
+        quadrants.push_back(ARO_315_0);
+        quadrants.push_back(ARO_0_45);
+        imgSrcs.assign(2, &imgSrc);
+        break;
+    case ARO_45_135:
+        createFHTSrc(imgSrc, srcMat, angleRange);
+        quadrants.push_back(ARO_45_90);
+        quadrants.push_back(ARO_90_135);
+        imgSrcs.assign(2, &imgSrc);
+        break;
+    case ARO_315_135:
+        createFHTSrc(imgSrc, srcMat, ARO_315_45);
+        createFHTSrc(imgSrcHor, srcMat, ARO_45_135);
+        quadrants.push_back(ARO_315_0);
+        quadrants.push_back(ARO_0_45);
+        quadrants.push_back(ARO_45_90);
+        quadrants.push_back(ARO_90_135);
+        imgSrcs.assign(2, &imgSrc);
+        imgSrcs.resize(4, &imgSrcHor);
+        break;
     default:
         CV_Error_(CV_StsNotImplemented, ("Unknown angleRange %d", angleRange));
     }
+
+    std::vector<Mat> quads(quadrants.size());
+    std::vector<Mat> regions(quadrants.size());
+    for (size_t i = 0; i < quadrants.size(); i++)
+    {
+        setFHTDstRegion(regions[i], dstMat, srcMat, quadrants[i], angleRange);
+        quads[i].create(regions[i].size(), regions[i].type());
+    }
+
+    parallel_for_(Range(0, (int)quadrants.size()),
+                  FHTQuadrantsInvoker(quads, imgSrcs, quadrants, operation, makeSkew));
+
+    // the later quadrant overwrites the shared line as in sequential processing
+    for (size_t i = 0; i < quadrants.size(); i++)
+        quads[i].copyTo(regions[i]);
 }
 
 //-----------------------------------------------------------------------------
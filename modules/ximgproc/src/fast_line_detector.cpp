@@ -3,6 +3,7 @@
 // of this distribution and at http://opencv.org/license.html.
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <vector>
 #include <iostream>
 
@@ -68,19 +69,25 @@ class FastLineDetectorImpl : public FastLineDetector
         int canny_aperture_size;
         bool do_merge;
 
+        class ChainSegmentsInvoker;
+
         FastLineDetectorImpl& operator= (const FastLineDetectorImpl&); // to quiet MSVC
         template<class T>
-            void incidentPoint(const Mat& l, T& pt);
+            void incidentPoint(const Vec3d& l, T& pt);
 
         void mergeLines(const SEGMENT& seg1, const SEGMENT& seg2, SEGMENT& seg_merged);
 
         bool mergeSegments(const SEGMENT& seg1, const SEGMENT& seg2, SEGMENT& seg_merged);
 
+        void mergeAllSegments(const Mat& src, std::vector<SEGMENT>& segments);
+
         bool getPointChain(const Mat& img, Point pt, Point& chained_pt, float& direction, int step);
 
-        double distPointLine(const Mat& p, Mat& l);
+        double distPointLine(const Vec3d& p, Vec3d& l);
+
+        void extractSegments(const Point2i* points, int total, std::vector<SEGMENT>& segments );
 
-        void extractSegments(const std::vector<Point2i>& points, std::vector<SEGMENT>& segments );
+        void chainSegments(const Mat& src, const Point2i* points, int total, std::vector<SEGMENT>& segments);
 
         void lineDetection(const Mat& src, std::vector<SEGMENT>& segments_all);
 
@@ -260,40 +267,26 @@ void FastLineDetectorImpl::mergeLines(const SEGMENT& seg1, const SEGMENT& seg2,
     seg_merged.y2 = (float)delta2y;
 }
 
-double FastLineDetectorImpl::distPointLine(const Mat& p, Mat& l)
+double FastLineDetectorImpl::distPointLine(const Vec3d& p, Vec3d& l)
 {
-    double x = l.at<double>(0,0);
-    double y = l.at<double>(1,0);
+    double x = l[0];
+    double y = l[1];
     double w = sqrt(x*x+y*y);
 
-    l.at<double>(0,0) = x / w;
-    l.at<double>(1,0) = y / w;
-    l.at<double>(2,0) = l.at<double>(2,0) / w;
+    l[0] = x / w;
+    l[1] = y / w;
+    l[2] = l[2] / w;
 
     return l.dot(p);
 }
 
 bool FastLineDetectorImpl::mergeSegments(const SEGMENT& seg1, const SEGMENT& seg2, SEGMENT& seg_merged)
 {
-    double o[] = { 0.0, 0.0, 1.0 };
-    double a[] = { 0.0, 0.0, 1.0 };
-    double b[] = { 0.0, 0.0, 1.0 };
-    double c[3];
-
-    o[0] = ( seg2.x1 + seg2.x2 ) / 2.0;
-    o[1] = ( seg2.y1 + seg2.y2 ) / 2.0;
-
-    a[0] = seg1.x1;
-    a[1] = seg1.y1;
-    b[0] = seg1.x2;
-    b[1] = seg1.y2;
+    Vec3d ori(( seg2.x1 + seg2.x2 ) / 2.0, ( seg2.y1 + seg2.y2 ) / 2.0, 1.0);
+    Vec3d p1(seg1.x1, seg1.y1, 1.0);
+    Vec3d p2(seg1.x2, seg1.y2, 1.0);
 
-    Mat ori = Mat(3, 1, CV_64FC1, o).clone();
-    Mat p1 = Mat(3, 1, CV_64FC1, a).clone();
-    Mat p2 = Mat(3, 1, CV_64FC1, b).clone();
-    Mat l1 = Mat(3, 1, CV_64FC1, c).clone();
-
-    l1 = p1.cross(p2);
+    Vec3d l1 = p1.cross(p2);
 
     Point2f seg1mid, seg2mid;
     seg1mid.x = (seg1.x1 + seg1.x2) /2.0f;
@@ -321,30 +314,27 @@ bool FastLineDetectorImpl::mergeSegments(const SEGMENT& seg1, const SEGMENT& seg
 }
 
 template<class T>
-    void FastLineDetectorImpl::incidentPoint(const Mat& l, T& pt)
+    void FastLineDetectorImpl::incidentPoint(const Vec3d& l, T& pt)
     {
-        double a[] = { (double)pt.x, (double)pt.y, 1.0 };
-        double b[] = { l.at<double>(0,0), l.at<double>(1,0), 0.0 };
-        double c[3];
-
-        Mat xk = Mat(3, 1, CV_64FC1, a).clone();
-        Mat lh = Mat(3, 1, CV_64FC1, b).clone();
-        Mat lk = Mat(3, 1, CV_64FC1, c).clone();
+        Vec3d xk((double)pt.x, (double)pt.y, 1.0);
+        Vec3d lh(l[0], l[1], 0.0);
 
-        lk = xk.cross(lh);
+        Vec3d lk = xk.cross(lh);
         xk = lk.cross(l);
 
-        xk.convertTo(xk, -1, 1.0 / xk.at<double>(2,0));
+        xk *= 1.0 / xk[2];
 
         Point2f pt_tmp;
-        pt_tmp.x = (float)xk.at<double>(0,0) < 0.0f ? 0.0f : (float)xk.at<double>(0,0)
-            >= (imagewidth - 1.0f) ? (imagewidth - 1.0f) : (float)xk.at<double>(0,0);
-        pt_tmp.y = (float)xk.at<double>(1,0) < 0.0f ? 0.0f : (float)xk.at<double>(1,0)
-            >= (imageheight - 1.0f) ? (imageheight - 1.0f) : (float)xk.at<double>(1,0);
+        pt_tmp.x = (float)xk[0] < 0.0f ? 0.0f : (float)xk[0]
+            >= (imagewidth - 1.0f) ? (imagewidth - 1.0f) : (float)xk[0];
+        pt_tmp.y = (float)xk[1] < 0.0f ? 0.0f : (float)xk[1]
+            >= (imageheight - 1.0f) ? (imageheight - 1.0f) : (float)xk[1];
         pt = T(pt_tmp);
     }
 
-void FastLineDetectorImpl::extractSegments(const std::vector<Point2i>& points, std::vector<SEGMENT>& segments )
+// the points fitted to a segment are always a contiguous run of the chain, so they are passed
+// to fitLine in place instead of being copied
+void FastLineDetectorImpl::extractSegments(const Point2i* points, int total, std::vector<SEGMENT>& segments )
 {
     bool is_line;
 
@@ -352,92 +342,54 @@ void FastLineDetectorImpl::extractSegments(const std::vector<Point2i>& points, s
     SEGMENT seg;
     Point2i ps, pe, pt;
 
-    std::vector<Point2i> l_points;
-
-    int total = (int)points.size();
-
     for ( i = 0; i + threshold_length < total; i++ )
     {
         ps = points[i];
         pe = points[i + threshold_length];
 
-        double a[] = { (double)ps.x, (double)ps.y, 1 };
-        double b[] = { (double)pe.x, (double)pe.y, 1 };
-        double c[3], d[3];
-
-        Mat p1 = Mat(3, 1, CV_64FC1, a).clone();
-        Mat p2 = Mat(3, 1, CV_64FC1, b).clone();
-        Mat p = Mat(3, 1, CV_64FC1, c).clone();
-        Mat l = Mat(3, 1, CV_64FC1, d).clone();
-        l = p1.cross(p2);
+        Vec3d p1((double)ps.x, (double)ps.y, 1);
+        Vec3d p2((double)pe.x, (double)pe.y, 1);
+        Vec3d l = p1.cross(p2);
 
         is_line = true;
 
-        l_points.clear();
-        l_points.push_back(ps);
-
         for ( j = 1; j < threshold_length; j++ )
         {
-            pt.x = points[i+j].x;
-            pt.y = points[i+j].y;
+            pt = points[i+j];
 
-            p.at<double>(0,0) = (double)pt.x;
-            p.at<double>(1,0) = (double)pt.y;
-            p.at<double>(2,0) = 1.0;
-
-            double dist = distPointLine(p, l);
+            double dist = distPointLine(Vec3d((double)pt.x, (double)pt.y, 1.0), l);
 
             if ( fabs( dist ) > threshold_dist )
             {
                 is_line = false;
                 break;
             }
-            l_points.push_back(pt);
         }
 
         // Line check fail, test next point
         if ( is_line == false )
             continue;
 
-        l_points.push_back(pe);
+        // the run points[i..i+count-1] is the current set of line points
+        int count = threshold_length + 1;
 
         Vec4f line;
-        fitLine( Mat(l_points), line, DIST_L2, 0, 0.01, 0.01);
-        a[0] = line[2];
-        a[1] = line[3];
-        b[0] = line[2] + line[0];
-        b[1] = line[3] + line[1];
-
-        p1 = Mat(3, 1, CV_64FC1, a).clone();
-        p2 = Mat(3, 1, CV_64FC1, b).clone();
-
-        l = p1.cross(p2);
+        fitLine( Mat(count, 1, CV_32SC2, (void*)(points + i)), line, DIST_L2, 0, 0.01, 0.01);
+        l = Vec3d(line[2], line[3], 1).cross(Vec3d(line[2] + line[0], line[3] + line[1], 1));
 
         incidentPoint(l, ps);
 
         // Extending line
         for ( j = threshold_length + 1; i + j < total; j++ )
         {
-            pt.x = points[i+j].x;
-            pt.y = points[i+j].y;
-
-            p.at<double>(0,0) = (double)pt.x;
-            p.at<double>(1,0) = (double)pt.y;
-            p.at<double>(2,0) = 1.0;
+            pt = points[i+j];
+            Vec3d p((double)pt.x, (double)pt.y, 1.0);
 
             double dist = distPointLine(p, l);
             if ( fabs( dist ) > threshold_dist )
             {
-                fitLine( Mat(l_points), line, DIST_L2, 0, 0.01, 0.01);
-                a[0] = line[2];
-                a[1] = line[3];
-                b[0] = line[2] + line[0];
-                b[1] = line[3] + line[1];
-
-                p1 = Mat(3, 1, CV_64FC1, a).clone();
-                p2 = Mat(3, 1, CV_64FC1, b).clone();
-
-                l = p1.cross(p2);
+                fitLine( Mat(count, 1, CV_32SC2, (void*)(points + i)), line, DIST_L2, 0, 0.01, 0.01);
+                l = Vec3d(line[2], line[3], 1).cross(Vec3d(line[2] + line[0], line[3] + line[1], 1));
                 dist = distPointLine(p, l);
                 if ( fabs( dist ) > threshold_dist ) {
                     j--;
@@ -445,18 +397,10 @@ void FastLineDetectorImpl::extractSegments(const std::vector<Point2i>& points, s
                 }
             }
             pe = pt;
-            l_points.push_back(pt);
+            count++;
         }
-        fitLine( Mat(l_points), line, DIST_L2, 0, 0.01, 0.01);
-        a[0] = line[2];
-        a[1] = line[3];
-        b[0] = line[2] + line[0];
-        b[1] = line[3] + line[1];
-
-        p1 = Mat(3, 1, CV_64FC1, a).clone();
-        p2 = Mat(3, 1, CV_64FC1, b).clone();
-
-        l = p1.cross(p2);
+        fitLine( Mat(count, 1, CV_32SC2, (void*)(points + i)), line, DIST_L2, 0, 0.01, 0.01);
+        l = Vec3d(line[2], line[3], 1).cross(Vec3d(line[2] + line[0], line[3] + line[1], 1));
 
         Point2f e1, e2;
         e1.x = (float)ps.x;
@@ -470,6 +414,7 @@ void FastLineDetectorImpl::extractSegments(const std::vector<Point2i>& points, s
         seg.y1 = e1.y;
         seg.x2 = e2.x;
         seg.y2 = e2.y;
+        seg.angle = 0.0f;
 
         segments.push_back(seg);
         i = i + j;
@@ -536,31 +481,89 @@ bool FastLineDetectorImpl::getPointChain(const Mat& img, Point pt,
     return false;
 }
 
+// runs over a range of chains, each writing its segments to its own vector
+class FastLineDetectorImpl::ChainSegmentsInvoker : public ParallelLoopBody
+{
+    public:
+        ChainSegmentsInvoker(FastLineDetectorImpl& _fld, const Mat& _src, const std::vector<Point2i>& _points,
+                const std::vector<int>& _chain_ofs, std::vector<std::vector<SEGMENT> >& _chain_segments) :
+            fld(_fld), src(_src), points(_points), chain_ofs(_chain_ofs), chain_segments(_chain_segments)
+        {
+        }
+
+        void operator()(const Range& range) const
+        {
+            for ( int i = range.start; i < range.end; i++ )
+                fld.chainSegments(src, &points[chain_ofs[i]], chain_ofs[i + 1] - chain_ofs[i], chain_segments[i]);
+        }
+
+    private:
+        FastLineDetectorImpl& fld;
+        const Mat& src;
+        const std::vector<Point2i>& points;
+        const std::vector<int>& chain_ofs;
+        std::vector<std::vector<SEGMENT> >& chain_segments;
+
+        ChainSegmentsInvoker& operator= (const ChainSegmentsInvoker&);
+};
+
+void FastLineDetectorImpl::chainSegments(const Mat& src, const Point2i* points, int total, std::vector<SEGMENT>& segments)
+{
+    std::vector<SEGMENT> chain_segments;
+    extractSegments(points, total, chain_segments);
+
+    for ( size_t i = 0; i < chain_segments.size(); i++ )
+    {
+        SEGMENT seg = chain_segments[i];
+        float length = sqrt((seg.x1 - seg.x2)*(seg.x1 - seg.x2) +
+                (seg.y1 - seg.y2)*(seg.y1 - seg.y2));
+        if(length < threshold_length)
+            continue;
+        if( (seg.x1 <= 5.0f && seg.x2 <= 5.0f) ||
+            (seg.y1 <= 5.0f && seg.y2 <= 5.0f) ||
+            (seg.x1 >= imagewidth - 5.0f && seg.x2 >= imagewidth - 5.0f) ||
+            (seg.y1 >= imageheight - 5.0f && seg.y2 >= imageheight - 5.0f) )
+            continue;
+        additionalOperationsOnSegment(src, seg);
+        segments.push_back(seg);
+    }
+}
+
 void FastLineDetectorImpl::lineDetection(const Mat& src, std::vector<SEGMENT>& segments_all)
 {
     int r, c;
     imageheight=src.rows; imagewidth=src.cols;
 
+    // the chains are traced one after the other into a single pool of points,
+    // chain i being points[chain_ofs[i]] .. points[chain_ofs[i+1]-1]
     std::vector<Point2i> points;
-    std::vector<SEGMENT> segments, segments_tmp;
+    std::vector<int> chain_ofs(1, 0);
     Mat canny;
     Canny(src, canny, canny_th1, canny_th2, canny_aperture_size);
 
     canny.colRange(0,6).rowRange(0,6) = 0;
     canny.colRange(src.cols-5,src.cols).rowRange(src.rows-5,src.rows) = 0;
 
-    SEGMENT seg, seg1, seg2;
-
     for ( r = 0; r < imageheight; r++ )
     {
+        const uchar* row = canny.ptr<uchar>(r);
         for ( c = 0; c < imagewidth; c++ )
         {
+#if CV_SIMD128
+            // skip the runs without seeds
+            const v_uint8x16 zero = v_setzero_u8();
+            while ( c <= imagewidth - 16 && v_check_all(v_load(row + c) == zero) )
+                c += 16;
+            if ( c >= imagewidth )
+                break;
+#endif
             // Find seeds - skip for non-seeds
-            if ( canny.at<unsigned char>(r,c) == 0 )
+            if ( row[c] == 0 )
                 continue;
 
             // Found seeds
             Point2i pt = Point2i(c,r);
+            size_t start = points.size();
 
             points.push_back(pt);
             canny.at<unsigned char>(pt.y, pt.x) = 0;
@@ -574,72 +577,98 @@ void FastLineDetectorImpl::lineDetection(const Mat& src, std::vector<SEGMENT>& s
                 canny.at<unsigned char>(pt.y, pt.x) = 0;
             }
 
-            if ( points.size() < (unsigned int)threshold_length + 1 )
+            if ( points.size() - start < (unsigned int)threshold_length + 1 )
             {
-                points.clear();
+                points.resize(start);
                 continue;
             }
+            chain_ofs.push_back((int)points.size());
+        }
+    }
 
-            extractSegments(points, segments);
+    // the chains are independent, their segments are joined in the order of the chains
+    int nchains = (int)chain_ofs.size() - 1;
+    std::vector<std::vector<SEGMENT> > chain_segments(nchains);
+    parallel_for_(Range(0, nchains), ChainSegmentsInvoker(*this, src, points, chain_ofs, chain_segments));
 
-            if ( segments.size() == 0 )
-            {
-                points.clear();
-                continue;
-            }
-            for ( int i = 0; i < (int)segments.size(); i++ )
+    std::vector<SEGMENT> segments_tmp;
+    for ( int i = 0; i < nchains; i++ )
+        segments_tmp.insert(segments_tmp.end(), chain_segments[i].begin(), chain_segments[i].end());
+
+    if(do_merge)
+        mergeAllSegments(src, segments_tmp);
+    segments_all.swap(segments_tmp);
+}
+
+/*
+ Incremental merging: from the last segment down, every segment absorbs the closest preceding one
+ it can be merged with, as long as there is one. Two segments only merge if their angles differ
+ by at most 5 degrees, so the candidates are looked up in bins of angles rather than by scanning
+ all the preceding segments; merged-away segments are only marked dead so that the order is kept.
+ */
+void FastLineDetectorImpl::mergeAllSegments(const Mat& src, std::vector<SEGMENT>& segments)
+{
+    int n = (int)segments.size();
+    if ( n < 3 )
+        return;
+
+    // slightly wider than the 5 degrees tolerance so that rounding can't hide a candidate
+    const float bin_width = (float)(CV_PI / 180.0 * 5.5);
+    const int nbins = cvCeil(2.0 * CV_PI / bin_width) + 1;
+    std::vector<std::vector<int> > bins(nbins);
+    std::vector<int> seg_bin(n);
+    for ( int i = 0; i < n; i++ )
+    {
+        seg_bin[i] = std::min(std::max(cvFloor(segments[i].angle / bin_width), 0), nbins - 1);
+        bins[seg_bin[i]].push_back(i);
+    }
+
+    std::vector<uchar> alive(n, (uchar)1);
+    int ith = n - 1;
+    // number of alive segments before ith, the first two segments are never merged together
+    int rank = n - 1;
+    while ( rank > 1 )
+    {
+        int b = std::min(std::max(cvFloor(segments[ith].angle / bin_width), 0), nbins - 1);
+        int best = -1;
+        SEGMENT best_merged = SEGMENT();
+        for ( int k = std::max(b - 1, 0); k <= std::min(b + 1, nbins - 1); k++ )
+        {
+            const std::vector<int>& bin = bins[k];
+            for ( int q = (int)(std::lower_bound(bin.begin(), bin.end(), ith) - bin.begin()) - 1; q >= 0; q-- )
             {
-                seg = segments[i];
-                float length = sqrt((seg.x1 - seg.x2)*(seg.x1 - seg.x2) +
-                        (seg.y1 - seg.y2)*(seg.y1 - seg.y2));
-                if(length < threshold_length)
-                    continue;
-                if( (seg.x1 <= 5.0f && seg.x2 <= 5.0f) ||
-                    (seg.y1 <= 5.0f && seg.y2 <= 5.0f) ||
-                    (seg.x1 >= imagewidth - 5.0f && seg.x2 >= imagewidth - 5.0f) ||
-                    (seg.y1 >= imageheight - 5.0f && seg.y2 >= imageheight - 5.0f) )
-                    continue;
-                additionalOperationsOnSegment(src, seg);
-                if(!do_merge)
-                    segments_all.push_back(seg);
-                segments_tmp.push_back(seg);
+                int jth = bin[q];
+                if ( jth <= best )
+                    break;
+                SEGMENT seg_merged;
+                if ( alive[jth] && mergeSegments(segments[ith], segments[jth], seg_merged) )
+                {
+                    best = jth;
+                    best_merged = seg_merged;
+                    break;
+                }
             }
-            points.clear();
-            segments.clear();
         }
-    }
-    if(!do_merge)
-        return;
 
-    bool is_merged = false;
-    int ith = (int)segments_tmp.size() - 1;
-    int jth = ith - 1;
-    while(ith > 1 || jth > 0)
-    {
-        seg1 = segments_tmp[ith];
-        seg2 = segments_tmp[jth];
-        SEGMENT seg_merged;
-        is_merged = mergeSegments(seg1, seg2, seg_merged);
-        if(is_merged == true)
+        if ( best >= 0 )
         {
-            seg2 = seg_merged;
-            additionalOperationsOnSegment(src, seg2);
-            std::vector<SEGMENT>::iterator it = segments_tmp.begin() + ith;
-            *it = seg2;
-            segments_tmp.erase(segments_tmp.begin()+jth);
-            ith--;
-            jth = ith - 1;
+            additionalOperationsOnSegment(src, best_merged);
+            segments[ith] = best_merged;
+            alive[best] = 0;
+            rank--;
         }
         else
         {
-            jth--;
-        }
-        if(jth < 0) {
-            ith--;
-            jth = ith - 1;
+            do ith--; while ( !alive[ith] );
+            rank--;
         }
     }
-    segments_all = segments_tmp;
+
+    int m = 0;
+    for ( int i = 0; i < n; i++ )
+        if ( alive[i] )
+            segments[m++] = segments[i];
+    segments.resize(m);
 }
 
 inline void FastLineDetectorImpl::getAngle(SEGMENT& seg)
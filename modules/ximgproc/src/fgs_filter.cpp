@@ -36,6 +36,9 @@
 
 #include "precomp.hpp"
 #include "opencv2/core/hal/intrin.hpp"
+#include "opencl_kernels_ximgproc.hpp"
+#include "edgeaware_filters_common.hpp"
+#include <string.h>
 #include <vector>
 
 namespace cv {
@@ -63,6 +66,8 @@ class FastGlobalSmootherFilterImpl : public FastGlobalSmootherFilter
 public:
     static Ptr<FastGlobalSmootherFilterImpl> create(InputArray guide, double lambda, double sigma_color, int num_iter,double lambda_attenuation);
     void filter(InputArray src, OutputArray dst);
+    void updateGuide(InputArray guide, double _lambda, double _sigmaColor);
+    void keepGuide(InputArray guide) {guide.getMat().copyTo(prev_guide);}
 
 protected:
     int w,h;
@@ -73,9 +78,16 @@ protected:
     Mat weights_LUT;
     Mat Chor, Cvert;
     Mat interD;
+    UMat uChor, uCvert; /*copies of the weights on the device*/
+    Mat prev_guide; /*guide of the last updateGuide() call, to find the rows which have changed*/
     void init(InputArray guide,double _lambda,double _sigmaColor,int _num_iter,double _lambda_attenuation);
+    void computeLUT();
+    void computeWeights(Mat& guide, const uchar* dirty_rows);
     void horizontalPass(Mat& cur);
     void verticalPass(Mat& cur);
+#ifdef HAVE_OPENCL
+    bool ocl_filter(InputArray src, OutputArray dst);
+#endif
 protected:
     struct HorizontalPass_ParBody : public ParallelLoopBody
     {
@@ -106,10 +118,11 @@ protected:
     {
         FastGlobalSmootherFilterImpl* fgs;
         Mat* guide;
+        const uchar* dirty_rows; /*rows of the guide to process, all of them if NULL*/
         int nstripes, stripe_sz;
         int h;
 
-        ComputeHorizontalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, int _nstripes, int _h);
+        ComputeHorizontalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, const uchar* _dirty_rows, int _nstripes, int _h);
         void operator () (const Range& range) const;
     };
 
@@ -118,10 +131,11 @@ protected:
     {
         FastGlobalSmootherFilterImpl* fgs;
         Mat* guide;
+        const uchar* dirty_rows; /*rows of the guide to process, all of them if NULL*/
         int nstripes, stripe_sz;
         int w;
 
-        ComputeVerticalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, int _nstripes, int _w);
+        ComputeVerticalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, const uchar* _dirty_rows, int _nstripes, int _w);
         void operator () (const Range& range) const;
     };
 
@@ -147,11 +161,7 @@ void FastGlobalSmootherFilterImpl::init(InputArray guide,double _lambda,double _
     lambda_attenuation = (float)_lambda_attenuation;
     num_iter = _num_iter;
     num_stripes = getNumThreads();
-    int num_levels = 3*256*256;
-    weights_LUT.create(1,num_levels,WorkVec::type);
-
-    WorkType* LUT = (WorkType*)weights_LUT.ptr(0);
-    parallel_for_(Range(0,num_stripes),ComputeLUT_ParBody(*this,LUT,num_stripes,num_levels));
+    computeLUT();
 
     w = guide.cols();
     h = guide.rows();
@@ -159,17 +169,83 @@ void FastGlobalSmootherFilterImpl::init(InputArray guide,double _lambda,double _
     Cvert. create(h,w,WorkVec::type);
     interD.create(h,w,WorkVec::type);
     Mat guideMat = guide.getMat();
+    computeWeights(guideMat,NULL);
+}
 
+void FastGlobalSmootherFilterImpl::computeLUT()
+{
+    int num_levels = 3*256*256;
+    weights_LUT.create(1,num_levels,WorkVec::type);
+
+    WorkType* LUT = (WorkType*)weights_LUT.ptr(0);
+    parallel_for_(Range(0,num_stripes),ComputeLUT_ParBody(*this,LUT,num_stripes,num_levels));
+}
+
+void FastGlobalSmootherFilterImpl::computeWeights(Mat& guide, const uchar* dirty_rows)
+{
     if(guide.channels() == 1)
     {
-        parallel_for_(Range(0,num_stripes),ComputeHorizontalWeights_ParBody<get_weight_1channel,1>(*this,guideMat,num_stripes,h));
-        parallel_for_(Range(0,num_stripes),ComputeVerticalWeights_ParBody  <get_weight_1channel,1>(*this,guideMat,num_stripes,w));
+        parallel_for_(Range(0,num_stripes),ComputeHorizontalWeights_ParBody<get_weight_1channel,1>(*this,guide,dirty_rows,num_stripes,h));
+        parallel_for_(Range(0,num_stripes),ComputeVerticalWeights_ParBody  <get_weight_1channel,1>(*this,guide,dirty_rows,num_stripes,w));
     }
     if(guide.channels() == 3)
     {
-        parallel_for_(Range(0,num_stripes),ComputeHorizontalWeights_ParBody<get_weight_3channel,3>(*this,guideMat,num_stripes,h));
-        parallel_for_(Range(0,num_stripes),ComputeVerticalWeights_ParBody  <get_weight_3channel,3>(*this,guideMat,num_stripes,w));
+        parallel_for_(Range(0,num_stripes),ComputeHorizontalWeights_ParBody<get_weight_3channel,3>(*this,guide,dirty_rows,num_stripes,h));
+        parallel_for_(Range(0,num_stripes),ComputeVerticalWeights_ParBody  <get_weight_3channel,3>(*this,guide,dirty_rows,num_stripes,w));
     }
+    uChor.release();
+    uCvert.release();
+}
+
+/* Replaces the guide without creating the filter again, which is meant for consecutive video frames:
+ the LUT is recomputed only if sigma_color has changed and the buffers only if the size has changed.
+ A horizontal weight depends on one row of the guide and a vertical weight on two consecutive rows,
+ so only the weights of the rows which differ from the previous guide are recomputed. */
+void FastGlobalSmootherFilterImpl::updateGuide(InputArray guide, double _lambda, double _sigmaColor)
+{
+    CV_Assert( !guide.empty() && _lambda >= 0 && _sigmaColor >= 0 );
+    CV_Assert( guide.depth() == CV_8U && (guide.channels() == 1 || guide.channels() == 3) );
+    lambda = (float)_lambda;
+    num_stripes = getNumThreads();
+    if(sigmaColor != (float)_sigmaColor)
+    {
+        sigmaColor = (float)_sigmaColor;
+        computeLUT();
+        prev_guide.release();
+    }
+
+    Mat guideMat = guide.getMat();
+    if(guideMat.rows != h || guideMat.cols != w)
+    {
+        w = guideMat.cols;
+        h = guideMat.rows;
+        Chor.  create(h,w,WorkVec::type);
+        Cvert. create(h,w,WorkVec::type);
+        interD.create(h,w,WorkVec::type);
+        prev_guide.release();
+    }
+
+    if(prev_guide.empty() || prev_guide.type() != guideMat.type())
+    {
+        computeWeights(guideMat,NULL);
+        guideMat.copyTo(prev_guide);
+        return;
+    }
+
+    vector<uchar> dirty_rows(h);
+    size_t row_sz = w*guideMat.elemSize();
+    bool changed = false;
+    for(int i=0;i<h;i++)
+    {
+        dirty_rows[i] = memcmp(guideMat.ptr(i),prev_guide.ptr(i),row_sz) != 0;
+        if(dirty_rows[i])
+        {
+            memcpy(prev_guide.ptr(i),guideMat.ptr(i),row_sz);
+            changed = true;
+        }
+    }
+    if(changed)
+        computeWeights(guideMat,&dirty_rows[0]);
 }
 
 Ptr<FastGlobalSmootherFilterImpl> FastGlobalSmootherFilterImpl::create(InputArray guide, double lambda, double sigma_color, int num_iter, double lambda_attenuation)
@@ -179,6 +255,48 @@ Ptr<FastGlobalSmootherFilterImpl> FastGlobalSmootherFilterImpl::create(InputArra
     return Ptr<FastGlobalSmootherFilterImpl>(fgs);
 }
 
+#ifdef HAVE_OPENCL
+bool FastGlobalSmootherFilterImpl::ocl_filter(InputArray src, OutputArray dst)
+{
+    if (h < 2 || w < 2)
+        return false;
+
+    int cn = src.channels();
+    String opts = format("-D cn=%d", cn);
+    ocl::Kernel kHor("fgs_hor", ocl::ximgproc::fgs_filter_oclsrc, opts);
+    ocl::Kernel kVert("fgs_vert", ocl::ximgproc::fgs_filter_oclsrc, opts);
+    if (kHor.empty() || kVert.empty())
+        return false;
+
+    if (uChor.empty())
+    {
+        Chor.copyTo(uChor);
+        Cvert.copyTo(uCvert);
+    }
+
+    UMat cur, uinterD(h, w, WorkVec::type);
+    src.getUMat().convertTo(cur, CV_MAKETYPE(WorkVec::depth, cn));
+
+    float cur_lambda = lambda;
+    size_t horThreads = (size_t)h, vertThreads = (size_t)w;
+    for (int n = 0; n < num_iter; n++)
+    {
+        kHor.args(ocl::KernelArg::ReadWrite(cur), ocl::KernelArg::ReadOnlyNoSize(uChor),
+                  ocl::KernelArg::ReadWriteNoSize(uinterD), cur_lambda);
+        if (!kHor.run(1, &horThreads, NULL, false))
+            return false;
+        kVert.args(ocl::KernelArg::ReadWrite(cur), ocl::KernelArg::ReadOnlyNoSize(uCvert),
+                   ocl::KernelArg::ReadWriteNoSize(uinterD), cur_lambda);
+        if (!kVert.run(1, &vertThreads, NULL, false))
+            return false;
+        cur_lambda *= lambda_attenuation;
+    }
+
+    cur.convertTo(dst, src.depth());
+    return true;
+}
+#endif
+
 void FastGlobalSmootherFilterImpl::filter(InputArray src, OutputArray dst)
 {
     CV_Assert(!src.empty() && (src.depth() == CV_8U || src.depth() == CV_16S || src.depth() == CV_32F) && src.channels()<=4);
@@ -188,6 +306,9 @@ void FastGlobalSmootherFilterImpl::filter(InputArray src, OutputArray dst)
         return;
     }
 
+    CV_OCL_RUN(src.isUMat() && dst.isUMat(),
+               ocl_filter(src, dst));
+
     vector<Mat> src_channels;
     vector<Mat> dst_channels;
     if(src.channels()==1)
@@ -584,8 +705,8 @@ void FastGlobalSmootherFilterImpl::VerticalPass_ParBody::operator()(const Range&
 }
 
 template<get_weight_op get_weight, const int num_ch>
-FastGlobalSmootherFilterImpl::ComputeHorizontalWeights_ParBody<get_weight,num_ch>::ComputeHorizontalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, int _nstripes, int _h):
-fgs(&_fgs),guide(&_guide), nstripes(_nstripes), h(_h)
+FastGlobalSmootherFilterImpl::ComputeHorizontalWeights_ParBody<get_weight,num_ch>::ComputeHorizontalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, const uchar* _dirty_rows, int _nstripes, int _h):
+fgs(&_fgs),guide(&_guide), dirty_rows(_dirty_rows), nstripes(_nstripes), h(_h)
 {
     stripe_sz = (int)ceil(h/(double)nstripes);
 }
@@ -602,6 +723,8 @@ void FastGlobalSmootherFilterImpl::ComputeHorizontalWeights_ParBody<get_weight,n
 
     for(int i=start;i<end;i++)
     {
+        if(dirty_rows && !dirty_rows[i])
+            continue;
         row = guide->ptr(i);
         Chor_row = (WorkType*)fgs->Chor.ptr(i);
         Chor_row[0] = get_weight(LUT,row,row+num_ch);
@@ -616,8 +739,8 @@ void FastGlobalSmootherFilterImpl::ComputeHorizontalWeights_ParBody<get_weight,n
 }
 
 template<get_weight_op get_weight, const int num_ch>
-FastGlobalSmootherFilterImpl::ComputeVerticalWeights_ParBody<get_weight,num_ch>::ComputeVerticalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, int _nstripes, int _w):
-fgs(&_fgs),guide(&_guide), nstripes(_nstripes), w(_w)
+FastGlobalSmootherFilterImpl::ComputeVerticalWeights_ParBody<get_weight,num_ch>::ComputeVerticalWeights_ParBody(FastGlobalSmootherFilterImpl &_fgs, Mat& _guide, const uchar* _dirty_rows, int _nstripes, int _w):
+fgs(&_fgs),guide(&_guide), dirty_rows(_dirty_rows), nstripes(_nstripes), w(_w)
 {
     stripe_sz = (int)ceil(w/(double)nstripes);
 }
@@ -635,15 +758,20 @@ void FastGlobalSmootherFilterImpl::ComputeVerticalWeights_ParBody<get_weight,num
     Cvert_row = (WorkType*)fgs->Cvert.ptr(0);
     row = guide->ptr(0)+start*num_ch;
     row_next = guide->ptr(1)+start*num_ch;
-    for(int j=start;j<end;j++)
+    if(!dirty_rows || dirty_rows[0] || dirty_rows[1])
     {
-        Cvert_row[j] = get_weight(LUT,row,row_next);
-        row+=num_ch;
-        row_next+=num_ch;
+        for(int j=start;j<end;j++)
+        {
+            Cvert_row[j] = get_weight(LUT,row,row_next);
+            row+=num_ch;
+            row_next+=num_ch;
+        }
     }
 
     for(int i=1;i<fgs->h-1;i++)
     {
+        if(dirty_rows && !dirty_rows[i] && !dirty_rows[i+1])
+            continue;
         row = guide->ptr(i)+start*num_ch;
         row_next = guide->ptr(i+1)+start*num_ch;
         Cvert_row = (WorkType*)fgs->Cvert.ptr(i);
@@ -683,6 +811,19 @@ Ptr<FastGlobalSmootherFilter> createFastGlobalSmootherFilter(InputArray guide, d
     return Ptr<FastGlobalSmootherFilter>(FastGlobalSmootherFilterImpl::create(guide, lambda, sigma_color, num_iter, lambda_attenuation));
 }
 
+void updateFastGlobalSmootherFilter(Ptr<FastGlobalSmootherFilter>& fgs, InputArray guide, double lambda, double sigma_color)
+{
+    Ptr<FastGlobalSmootherFilterImpl> impl = fgs.dynamicCast<FastGlobalSmootherFilterImpl>();
+    if(impl.empty())
+    {
+        impl = FastGlobalSmootherFilterImpl::create(guide, lambda, sigma_color, 3, 0.25);
+        impl->keepGuide(guide);
+        fgs = impl;
+    }
+    else
+        impl->updateGuide(guide, lambda, sigma_color);
+}
+
 CV_EXPORTS_W
 void fastGlobalSmootherFilter(InputArray guide, InputArray src, OutputArray dst, double lambda, double sigma_color, double lambda_attenuation, int num_iter)
 {
@@ -61,25 +61,11 @@ namespace cv {
                     }
             };
 
-            // A point in the sets of points
-            class PointSetElement {
-                public:
-                    int p;
-                    int size;
-
-                    PointSetElement() { }
-
-                    PointSetElement(int p_) {
-                        p = p_;
-                        size = 1;
-                    }
-            };
-
-            // An object to manage set of points, who can be fusionned
+            // An object to manage set of points, who can be fusionned.
+            // Parents and sizes are stored in separate arrays, so finding the base point only touches parents.
             class PointSet {
                 public:
                     PointSet(int nb_elements_);
-                    ~PointSet();
 
                     int nb_elements;
 
@@ -90,10 +76,11 @@ namespace cv {
                     void joinPoints(int p_a, int p_b);
 
                     // Return the set size of a set (based on the main point)
-                    int size(unsigned int p) { return mapping[p].size; }
+                    int size(unsigned int p) { return sizes[p]; }
 
                 private:
-                    PointSetElement* mapping;
+                    std::vector<int> parents;
+                    std::vector<int> sizes;
 
             };
 
@@ -145,16 +132,16 @@ namespace cv {
                     void filter(const Mat &img, Mat &img_filtered);
 
                     // Build the graph between each pixels
-                    void buildGraph(Edge **edges, int &nb_edges, const Mat &img_filtered);
+                    void buildGraph(std::vector<Edge> &edges, const Mat &img_filtered);
 
                     // Segment the graph
-                    void segmentGraph(Edge * edges, const int &nb_edges, const Mat & img_filtered, PointSet **es);
+                    void segmentGraph(std::vector<Edge> &edges, const Mat & img_filtered, PointSet &es);
 
                     // Remove areas too small
-                    void filterSmallAreas(Edge *edges, const int &nb_edges, PointSet *es);
+                    void filterSmallAreas(const std::vector<Edge> &edges, PointSet &es);
 
                     // Map the segemented graph to a Mat with uniques, sequentials ids
-                    void finalMapping(PointSet *es, Mat &output);
+                    void finalMapping(PointSet &es, Mat &output);
             };
 
             void GraphSegmentationImpl::filter(const Mat &img, Mat &img_filtered) {
@@ -168,96 +155,170 @@ namespace cv {
                 GaussianBlur(img_converted, img_filtered, Size(0, 0), sigma, sigma);
             }
 
-            void GraphSegmentationImpl::buildGraph(Edge **edges, int &nb_edges, const Mat &img_filtered) {
+            // Edges of the right and bottom neighbours of the pixels of a range of rows.
+            // Horizontal edges are stored first, so each row writes to a known place in the buffer.
+            class BuildGraphInvoker : public ParallelLoopBody {
+                public:
+                    BuildGraphInvoker(const Mat &img_filtered_, Edge *edges_) : img_filtered(img_filtered_), edges(edges_) {}
+
+                    void operator()(const Range& range) const {
+                        const int rows = img_filtered.rows;
+                        const int cols = img_filtered.cols;
+                        const int nb_channels = img_filtered.channels();
+                        const int nb_horizontal = rows * (cols - 1);
+
+                        for (int i = range.start; i < range.end; i++) {
+                            const float* p = img_filtered.ptr<float>(i);
+
+                            Edge* e = edges + i * (cols - 1);
+
+                            for (int j = 0; j < cols - 1; j++, e++) {
+                                e->weight = distance(p + j * nb_channels, p + (j + 1) * nb_channels, nb_channels);
+                                e->from = i * cols + j;
+                                e->to = i * cols + j + 1;
+                            }
+
+                            if (i + 1 < rows) {
+                                const float* p2 = img_filtered.ptr<float>(i + 1);
 
-                *edges = new Edge[img_filtered.rows * img_filtered.cols * 4];
+                                e = edges + nb_horizontal + i * cols;
 
-                nb_edges = 0;
+                                for (int j = 0; j < cols; j++, e++) {
+                                    e->weight = distance(p + j * nb_channels, p2 + j * nb_channels, nb_channels);
+                                    e->from = i * cols + j;
+                                    e->to = (i + 1) * cols + j;
+                                }
+                            }
+                        }
+                    }
 
-                int nb_channels = img_filtered.channels();
+                private:
+                    static inline float distance(const float* a, const float* b, int nb_channels) {
+                        float tmp_total = 0;
 
-                for (int i = 0; i < (int)img_filtered.rows; i++) {
-                    const float* p = img_filtered.ptr<float>(i);
+                        for (int channel = 0; channel < nb_channels; channel++) {
+                            float d = a[channel] - b[channel];
+                            tmp_total += d * d;
+                        }
 
-                    for (int j = 0; j < (int)img_filtered.cols; j++) {
+                        return std::sqrt(tmp_total);
+                    }
 
-                        //Take the right, left, top and down pixel
-                        for (int delta = -1; delta <= 1; delta += 2) {
-                            for (int delta_j = 0, delta_i = 1; delta_j <= 1; delta_j++ || delta_i--) {
+                    const Mat &img_filtered;
+                    Edge *edges;
+            };
 
-                                int i2 = i + delta * delta_i;
-                                int j2 = j + delta * delta_j;
+            // Sort edges by weight with a stable LSD radix sort. Weights are non-negative,
+            // so the order of their IEEE bit patterns is the order of the values.
+            static void sortEdges(std::vector<Edge> &edges) {
 
-                                if (i2 >= 0 && i2 < img_filtered.rows && j2 >= 0 && j2 < img_filtered.cols) {
-                                    const float* p2 = img_filtered.ptr<float>(i2);
+                const int nb_edges = (int)edges.size();
 
-                                    float tmp_total = 0;
+                if (nb_edges < 2)
+                    return;
 
-                                    for ( int channel = 0; channel < nb_channels; channel++) {
-                                        tmp_total += pow(p[j * nb_channels + channel] - p2[j2 * nb_channels + channel], 2);
-                                    }
+                const int bits = 11;
+                const int nb_buckets = 1 << bits;
+                const unsigned mask = nb_buckets - 1;
 
-                                    float diff = 0;
-                                    diff = sqrt(tmp_total);
+                std::vector<Edge> buffer(nb_edges);
+                std::vector<int> offsets(nb_buckets);
 
-                                    (*edges)[nb_edges].weight = diff;
-                                    (*edges)[nb_edges].from = i * img_filtered.cols +  j;
-                                    (*edges)[nb_edges].to = i2 * img_filtered.cols + j2;
+                Edge* src = &edges[0];
+                Edge* dst = &buffer[0];
 
-                                    nb_edges++;
-                                }
-                            }
-                        }
+                for (int shift = 0; shift < 32; shift += bits) {
+
+                    std::fill(offsets.begin(), offsets.end(), 0);
+
+                    Cv32suf key;
+
+                    for (int i = 0; i < nb_edges; i++) {
+                        key.f = src[i].weight;
+                        offsets[(key.u >> shift) & mask]++;
+                    }
+
+                    // Nothing to do if all the edges have the same digit
+                    key.f = src[0].weight;
+                    if (offsets[(key.u >> shift) & mask] == nb_edges)
+                        continue;
+
+                    int total = 0;
+
+                    for (int b = 0; b < nb_buckets; b++) {
+                        int count = offsets[b];
+                        offsets[b] = total;
+                        total += count;
+                    }
+
+                    for (int i = 0; i < nb_edges; i++) {
+                        key.f = src[i].weight;
+                        dst[offsets[(key.u >> shift) & mask]++] = src[i];
                     }
+
+                    std::swap(src, dst);
                 }
+
+                if (src != &edges[0])
+                    std::copy(src, src + nb_edges, edges.begin());
             }
 
-            void GraphSegmentationImpl::segmentGraph(Edge *edges, const int &nb_edges, const Mat &img_filtered, PointSet **es) {
+            void GraphSegmentationImpl::buildGraph(std::vector<Edge> &edges, const Mat &img_filtered) {
+
+                const int rows = img_filtered.rows;
+                const int cols = img_filtered.cols;
+
+                // Each pair of neighbouring pixels gives one edge
+                edges.resize(rows * (cols - 1) + (rows - 1) * cols);
+
+                if (edges.empty())
+                    return;
+
+                parallel_for_(Range(0, rows), BuildGraphInvoker(img_filtered, &edges[0]));
+            }
+
+            void GraphSegmentationImpl::segmentGraph(std::vector<Edge> &edges, const Mat &img_filtered, PointSet &es) {
 
                 int total_points = ( int)(img_filtered.rows * img_filtered.cols);
 
                 // Sort edges
-                std::sort(edges, edges + nb_edges);
-
-                // Create a set with all point (by default mapped to themselfs)
-                *es = new PointSet(img_filtered.cols * img_filtered.rows);
+                sortEdges(edges);
 
                 // Thresholds
-                float* thresholds = new float[total_points];
+                std::vector<float> thresholds(total_points, k);
 
-                for (int i = 0; i < total_points; i++)
-                    thresholds[i] = k;
+                const int nb_edges = (int)edges.size();
 
                 for ( int i = 0; i < nb_edges; i++) {
 
-                    int p_a = (*es)->getBasePoint(edges[i].from);
-                    int p_b = (*es)->getBasePoint(edges[i].to);
+                    int p_a = es.getBasePoint(edges[i].from);
+                    int p_b = es.getBasePoint(edges[i].to);
 
                     if (p_a != p_b) {
                         if (edges[i].weight <= thresholds[p_a] && edges[i].weight <= thresholds[p_b]) {
-                            (*es)->joinPoints(p_a, p_b);
-                            p_a = (*es)->getBasePoint(p_a);
-                            thresholds[p_a] = edges[i].weight + k / (*es)->size(p_a);
+                            es.joinPoints(p_a, p_b);
+                            p_a = es.getBasePoint(p_a);
+                            thresholds[p_a] = edges[i].weight + k / es.size(p_a);
 
                             edges[i].weight = 0;
                         }
                     }
                 }
-
-                delete [] thresholds;
             }
 
-            void GraphSegmentationImpl::filterSmallAreas(Edge *edges, const int &nb_edges, PointSet *es) {
+            void GraphSegmentationImpl::filterSmallAreas(const std::vector<Edge> &edges, PointSet &es) {
+
+                const int nb_edges = (int)edges.size();
 
                 for ( int i = 0; i < nb_edges; i++) {
 
                     if (edges[i].weight > 0) {
 
-                        int p_a = es->getBasePoint(edges[i].from);
-                        int p_b = es->getBasePoint(edges[i].to);
+                        int p_a = es.getBasePoint(edges[i].from);
+                        int p_b = es.getBasePoint(edges[i].to);
 
-                        if (p_a != p_b && (es->size(p_a) < min_size || es->size(p_b) < min_size)) {
-                            es->joinPoints(p_a, p_b);
+                        if (p_a != p_b && (es.size(p_a) < min_size || es.size(p_b) < min_size)) {
+                            es.joinPoints(p_a, p_b);
 
                         }
                     }
@@ -265,15 +326,12 @@ namespace cv {
 
             }
 
-            void GraphSegmentationImpl::finalMapping(PointSet *es, Mat &output) {
+            void GraphSegmentationImpl::finalMapping(PointSet &es, Mat &output) {
 
                 int maximum_size = ( int)(output.rows * output.cols);
 
                 int last_id = 0;
-                int * mapped_id = new int[maximum_size];
-
-                for ( int i = 0; i < maximum_size; i++)
-                    mapped_id[i] = -1;
+                std::vector<int> mapped_id(maximum_size, -1);
 
                 int rows = output.rows;
                 int cols = output.cols;
@@ -289,7 +347,7 @@ namespace cv {
 
                     for (int j = 0; j < cols; j++) {
 
-                        int point = es->getBasePoint(i * cols + j);
+                        int point = es.getBasePoint(i * cols + j);
 
                         if (mapped_id[point] == -1) {
                             mapped_id[point] = last_id;
@@ -299,8 +357,6 @@ namespace cv {
                         p[j] = mapped_id[point];
                     }
                 }
-
-                delete [] mapped_id;
             }
 
             void GraphSegmentationImpl::processImage(InputArray src, OutputArray dst) {
@@ -316,25 +372,21 @@ namespace cv {
                 filter(img, img_filtered);
 
                 // Build graph
-                Edge *edges;
-                int nb_edges;
+                std::vector<Edge> edges;
 
-                buildGraph(&edges, nb_edges, img_filtered);
+                buildGraph(edges, img_filtered);
 
                 // Segment graph
-                PointSet *es;
+                PointSet es(img_filtered.cols * img_filtered.rows);
 
-                segmentGraph(edges, nb_edges, img_filtered, &es);
+                segmentGraph(edges, img_filtered, es);
 
                 // Remove small areas
-                filterSmallAreas(edges, nb_edges, es);
+                filterSmallAreas(edges, es);
 
                 // Map to final output
                 finalMapping(es, output);
 
-                delete [] edges;
-                delete es;
-
             }
 
             Ptr<GraphSegmentation> createGraphSegmentation(double sigma, float k, int min_size) {
@@ -348,30 +400,28 @@ namespace cv {
                 return graphseg;
             }
 
-            PointSet::PointSet(int nb_elements_) {
+            PointSet::PointSet(int nb_elements_) : parents(nb_elements_), sizes(nb_elements_, 1) {
                 nb_elements = nb_elements_;
 
-                mapping = new PointSetElement[nb_elements];
-
                 for ( int i = 0; i < nb_elements; i++) {
-                    mapping[i] = PointSetElement(i);
+                    parents[i] = i;
                 }
             }
 
-            PointSet::~PointSet() {
-                delete [] mapping;
-            }
-
             int PointSet::getBasePoint( int p) {
 
-                 int base_p = p;
+                int base_p = p;
 
-                while (base_p != mapping[base_p].p) {
-                    base_p = mapping[base_p].p;
+                while (base_p != parents[base_p]) {
+                    base_p = parents[base_p];
                 }
 
-                // Save mapping for faster acces later
-                mapping[p].p = base_p;
+                // Compress the whole path for faster acces later
+                while (p != base_p) {
+                    int next = parents[p];
+                    parents[p] = base_p;
+                    p = next;
+                }
 
                 return base_p;
             }
@@ -379,11 +429,11 @@ namespace cv {
             void PointSet::joinPoints(int p_a, int p_b) {
 
                 // Always target smaller set, to avoid redirection in getBasePoint
-                if (mapping[p_a].size < mapping[p_b].size)
+                if (sizes[p_a] < sizes[p_b])
                     swap(p_a, p_b);
 
-                mapping[p_b].p = p_a;
-                mapping[p_a].size += mapping[p_b].size;
+                parents[p_b] = p_a;
+                sizes[p_a] += sizes[p_b];
 
                 nb_elements--;
             }
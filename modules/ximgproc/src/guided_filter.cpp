@@ -132,6 +132,8 @@ public:
 
     void filter(InputArray src, OutputArray dst, int dDepth = -1);
 
+    static void filterByStrips(const Mat& guide, const Mat& src, Mat& dst, int radius, double eps, int stripHeight);
+
 protected:
 
     int radius;
@@ -758,6 +760,46 @@ void GuidedFilterImpl::filter(InputArray src, OutputArray dst, int dDepth /*= -1
     merge(beta, dst);
 }
 
+/* Copies rows [y0, y1) of src to dst, the rows outside of the image are reflected
+ as by BORDER_REFLECT in the box filters.
+*/
+static void copyRowsReflected(const Mat& src, int y0, int y1, Mat& dst)
+{
+    dst.create(y1 - y0, src.cols, src.type());
+    for (int y = y0; y < y1; y++)
+    {
+        Mat dstRow = dst.row(y - y0);
+        src.row(borderInterpolate(y, src.rows, BORDER_REFLECT)).copyTo(dstRow);
+    }
+}
+
+void GuidedFilterImpl::filterByStrips(const Mat& guide, const Mat& src, Mat& dst, int radius, double eps, int stripHeight)
+{
+    /* Box filters of the guide and the source give the coefficients of the rows in the radius around the row,
+     the second box filter of the coefficients gives the output. So the output rows of the strip
+     depend only on the rows in the halo of 2*radius around the strip. The reflected rows of the halo
+     at the image borders give the same sums as the reflected borders of the whole image. */
+    const int halo = 2 * radius;
+    const int dDepth = dst.depth();
+
+    GuidedFilterImpl gf;
+    Mat guideStrip, srcStrip, dstStrip;
+
+    for (int y0 = 0; y0 < src.rows; y0 += stripHeight)
+    {
+        int y1 = std::min(y0 + stripHeight, src.rows);
+
+        copyRowsReflected(guide, y0 - halo, y1 + halo, guideStrip);
+        copyRowsReflected(src, y0 - halo, y1 + halo, srcStrip);
+
+        gf.init(guideStrip, radius, eps);
+        gf.filter(srcStrip, dstStrip, dDepth);
+
+        Mat dstRows = dst.rowRange(y0, y1);
+        dstStrip.rowRange(halo, halo + y1 - y0).copyTo(dstRows);
+    }
+}
+
 void GuidedFilterImpl::computeCovGuideAndSrc(vector<Mat>& srcCn, vector<Mat>& srcCnMean, vector<vector<Mat> >& cov)
 {
     int srcCnNum = (int)srcCn.size();
@@ -794,5 +836,30 @@ void guidedFilter(InputArray guide, InputArray src, OutputArray dst, int radius,
     gf->filter(src, dst, dDepth);
 }
 
+CV_EXPORTS_W
+void guidedFilterStrips(InputArray guide, InputArray src, OutputArray dst, int radius, double eps, int dDepth, int stripHeight)
+{
+    CV_Assert( !guide.empty() && !src.empty() && radius >= 0 && stripHeight > 0 );
+    CV_Assert( src.depth() == CV_32F || src.depth() == CV_8U );
+
+    Mat guideMat = guide.getMat(), srcMat = src.getMat();
+    if (guideMat.size() != srcMat.size())
+        CV_Error(Error::StsBadSize, "Size of filtering image must be equal to size of guide image");
+
+    if (stripHeight >= srcMat.rows)
+    {
+        guidedFilter(guideMat, srcMat, dst, radius, eps, dDepth);
+        return;
+    }
+
+    if (dDepth == -1) dDepth = srcMat.depth();
+    dst.create(srcMat.size(), CV_MAKE_TYPE(dDepth, srcMat.channels()));
+    Mat dstMat = dst.getMat();
+    // the strips of the output must not overwrite the halo rows of the next strips
+    if (dstMat.data == srcMat.data) srcMat = srcMat.clone();
+    if (dstMat.data == guideMat.data) guideMat = guideMat.clone();
+    GuidedFilterImpl::filterByStrips(guideMat, srcMat, dstMat, radius, eps, stripHeight);
+}
+
 }
 }
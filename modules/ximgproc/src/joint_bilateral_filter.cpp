@@ -35,6 +35,7 @@
  */
 
 #include "precomp.hpp"
+#include "opencl_kernels_ximgproc.hpp"
 #include <climits>
 #include <iostream>
 using namespace std;
@@ -59,6 +60,10 @@ void jointBilateralFilter_32f(Mat& joint, Mat& src, Mat& dst, int radius, double
 
 void jointBilateralFilter_8u(Mat& joint, Mat& src, Mat& dst, int radius, double sigmaColor, double sigmaSpace, int borderType);
 
+void jointBilateralFilterGrid(const Mat& joint, const Mat& src, Mat& dst, double sigmaColor, double sigmaSpace);
+
+void jointBilateralFilterLattice(const Mat& joint, const Mat& src, Mat& dst, double sigmaColor, double sigmaSpace);
+
 template<typename JointVec, typename SrcVec>
 class JointBilateralFilter_32f : public ParallelLoopBody
 {
@@ -336,20 +341,122 @@ void jointBilateralFilter_8u(Mat& joint, Mat& src, Mat& dst, int radius, double
     }
 }
 
-void jointBilateralFilter(InputArray joint_, InputArray src_, OutputArray dst_, int d, double sigmaColor, double sigmaSpace, int borderType)
+static void jointBilateralFilterFast(const Mat& joint, const Mat& src, Mat& dst, double sigmaColor, double sigmaSpace)
+{
+    Mat joint32f, src32f, dst32f;
+    joint.convertTo(joint32f, CV_32F);
+    src.convertTo(src32f, CV_32F);
+
+    if (joint.channels() == 1)
+        jointBilateralFilterGrid(joint32f, src32f, dst32f, sigmaColor, sigmaSpace);
+    else
+        jointBilateralFilterLattice(joint32f, src32f, dst32f, sigmaColor, sigmaSpace);
+
+    dst32f.convertTo(dst, src.type());
+}
+
+#ifdef HAVE_OPENCL
+static bool ocl_jointBilateralFilter(InputArray joint_, InputArray src_, OutputArray dst_, int d, double sigmaColor, double sigmaSpace, int borderType)
+{
+    UMat joint = joint_.getUMat(), src = src_.getUMat();
+    int depth = src.depth(), jCn = joint.channels(), sCn = src.channels();
+
+    // same data is handled by bilateralFilter
+    if ((joint.u == src.u && joint.offset == src.offset) || joint.size() != src.size() || joint.depth() != depth ||
+        (depth != CV_8U && depth != CV_32F) || (jCn != 1 && jCn != 3) || (sCn != 1 && sCn != 3))
+        return false;
+
+    const char* borderMap[] = { "BORDER_CONSTANT", "BORDER_REPLICATE", "BORDER_REFLECT", "BORDER_WRAP", "BORDER_REFLECT_101" };
+    borderType &= ~BORDER_ISOLATED;
+    if (borderType == BORDER_CONSTANT || borderType < 0 || borderType > BORDER_REFLECT_101)
+        return false;
+
+    if (sigmaColor <= 0)
+        sigmaColor = 1;
+    if (sigmaSpace <= 0)
+        sigmaSpace = 1;
+
+    int radius;
+    if (d <= 0)
+        radius = cvRound(sigmaSpace*1.5);
+    else
+        radius = d / 2;
+    radius = std::max(radius, 1);
+
+    // the border is extrapolated once
+    if (radius >= std::min(src.rows, src.cols))
+        return false;
+
+    ocl::Kernel k("joint_bilateral", ocl::ximgproc::joint_bilateral_filter_oclsrc,
+                  format("-D T=%s -D jcn=%d -D scn=%d -D %s%s", ocl::typeToStr(depth), jCn, sCn,
+                         borderMap[borderType], depth == CV_8U ? " -D DEPTH_8U" : ""));
+    if (k.empty())
+        return false;
+
+    double gaussColorCoeff = -0.5 / (sigmaColor*sigmaColor);
+    double gaussSpaceCoeff = -0.5 / (sigmaSpace*sigmaSpace);
+
+    int d2 = 2*radius + 1;
+    Mat spaceWeights(1, d2*d2, CV_32F), spaceOfs(1, d2*d2, CV_32SC2);
+    int maxk = 0;
+    for (int i = -radius; i <= radius; i++)
+    {
+        for (int j = -radius; j <= radius; j++)
+        {
+            double r2 = i*i + j*j;
+            if (r2 > SQR(radius))
+                continue;
+
+            spaceWeights.at<float>(maxk) = (float)std::exp(r2 * gaussSpaceCoeff);
+            spaceOfs.at<Vec2i>(maxk) = Vec2i(j, i);
+            maxk++;
+        }
+    }
+
+    Mat expLUT(1, depth == CV_8U ? jCn*256 : 1, CV_32F);
+    for (int i = 0; i < (int)expLUT.total(); i++)
+        expLUT.at<float>(i) = (float)std::exp(i * i * gaussColorCoeff);
+
+    UMat uspaceWeights, uspaceOfs, uexpLUT;
+    spaceWeights.copyTo(uspaceWeights);
+    spaceOfs.copyTo(uspaceOfs);
+    expLUT.copyTo(uexpLUT);
+
+    dst_.create(src.size(), src.type());
+    UMat dst = dst_.getUMat();
+    if (dst.u == joint.u)
+        joint = joint.clone();
+    if (dst.u == src.u)
+        src = src.clone();
+
+    k.args(ocl::KernelArg::ReadOnlyNoSize(joint), ocl::KernelArg::ReadOnlyNoSize(src), ocl::KernelArg::WriteOnly(dst),
+           ocl::KernelArg::PtrReadOnly(uspaceOfs), ocl::KernelArg::PtrReadOnly(uspaceWeights), maxk,
+           ocl::KernelArg::PtrReadOnly(uexpLUT), (float)gaussColorCoeff, radius);
+
+    size_t globalsize[] = { (size_t)src.cols, (size_t)src.rows };
+    return k.run(2, globalsize, NULL, false);
+}
+#endif
+
+void jointBilateralFilter(InputArray joint_, InputArray src_, OutputArray dst_, int d, double sigmaColor, double sigmaSpace, int borderType, int mode)
 {
+    CV_Assert(mode == JBF_EXACT || mode == JBF_FAST);
+
     CV_Assert(!src_.empty());
 
-    if (joint_.empty())
+    if (joint_.empty() && mode == JBF_EXACT)
     {
         bilateralFilter(src_, dst_, d, sigmaColor, sigmaSpace, borderType);
         return;
     }
 
+    CV_OCL_RUN(dst_.isUMat() && mode == JBF_EXACT && !joint_.empty(),
+               ocl_jointBilateralFilter(joint_, src_, dst_, d, sigmaColor, sigmaSpace, borderType))
+
     Mat src = src_.getMat();
-    Mat joint = joint_.getMat();
+    Mat joint = joint_.empty() ? src : joint_.getMat();
 
-    if (src.data == joint.data)
+    if (src.data == joint.data && mode == JBF_EXACT)
     {
         bilateralFilter(src_, dst_, d, sigmaColor, sigmaSpace, borderType);
         return;
@@ -383,7 +490,11 @@ void jointBilateralFilter(InputArray joint_, InputArray src_, OutputArray dst_,
 
     if ( (srcCnNum == 1 || srcCnNum == 3) && (jointCnNum == 1 || jointCnNum == 3) )
     {
-        if (joint.depth() == CV_8U)
+        if (mode == JBF_FAST)
+        {
+            jointBilateralFilterFast(joint, src, dst, sigmaColor, sigmaSpace);
+        }
+        else if (joint.depth() == CV_8U)
         {
             jointBilateralFilter_8u(joint, src, dst, radius, sigmaColor, sigmaSpace, borderType);
         }
@@ -0,0 +1,645 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "precomp.hpp"
+#include <vector>
+
+namespace cv
+{
+namespace ximgproc
+{
+
+/* Approximations of the joint bilateral filter whose cost doesn't depend on the spatial sigma.
+ * Both downsample the space of (position, joint color) with the sampling rate of the sigmas,
+ * blur the homogeneous values (src * w, w) there and interpolate them back.
+ */
+
+void jointBilateralFilterGrid(const Mat& joint, const Mat& src, Mat& dst, double sigmaColor, double sigmaSpace);
+
+void jointBilateralFilterLattice(const Mat& joint, const Mat& src, Mat& dst, double sigmaColor, double sigmaSpace);
+
+namespace
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Bilateral grid (1-channel joint image)
+
+// 3D grid of (x, y, joint value) cells, each cell stores vd floats, z index is the fastest
+class BilateralGrid
+{
+public:
+
+    BilateralGrid(int width_, int height_, int depth_, int vd_)
+        : width(width_), height(height_), depth(depth_), vd(vd_), data((size_t)width_*height_*depth_*vd_, 0.0f) {}
+
+    float* cell(int x, int y, int z) { return &data[(((size_t)y*width + x)*depth + z)*vd]; }
+    const float* cell(int x, int y, int z) const { return &data[(((size_t)y*width + x)*depth + z)*vd]; }
+
+    int width, height, depth, vd;
+    std::vector<float> data;
+};
+
+// Gaussian blur with sigma of one cell along one axis of the grid
+class GridBlurInvoker : public ParallelLoopBody
+{
+public:
+
+    GridBlurInvoker(const BilateralGrid& src_, BilateralGrid& dst_, int axis_)
+        : src(src_), dst(dst_), axis(axis_)
+    {
+        for (int t = -radius; t <= radius; t++)
+            kernel[t + radius] = (float)std::exp(-0.5*t*t);
+    }
+
+    int numLines() const
+    {
+        return axis == 0 ? src.height*src.depth : axis == 1 ? src.width*src.depth : src.width*src.height;
+    }
+
+    void operator () (const Range& range) const
+    {
+        const int vd = src.vd;
+        size_t stride;
+        int len;
+        if (axis == 0)
+        {
+            stride = (size_t)src.depth*vd;
+            len = src.width;
+        }
+        else if (axis == 1)
+        {
+            stride = (size_t)src.width*src.depth*vd;
+            len = src.height;
+        }
+        else
+        {
+            stride = vd;
+            len = src.depth;
+        }
+
+        for (int l = range.start; l < range.end; l++)
+        {
+            const float* s;
+            float* d;
+            if (axis == 0)
+            {
+                int y = l / src.depth, z = l % src.depth;
+                s = src.cell(0, y, z); d = dst.cell(0, y, z);
+            }
+            else if (axis == 1)
+            {
+                int x = l / src.depth, z = l % src.depth;
+                s = src.cell(x, 0, z); d = dst.cell(x, 0, z);
+            }
+            else
+            {
+                int x = l % src.width, y = l / src.width;
+                s = src.cell(x, y, 0); d = dst.cell(x, y, 0);
+            }
+
+            for (int p = 0; p < len; p++)
+            {
+                float* dp = d + p*stride;
+                for (int c = 0; c < vd; c++)
+                    dp[c] = 0.0f;
+
+                int t0 = std::max(-radius, -p), t1 = std::min(+radius, len - 1 - p);
+                for (int t = t0; t <= t1; t++)
+                {
+                    const float* sp = s + (ptrdiff_t)(p + t)*(ptrdiff_t)stride;
+                    float w = kernel[t + radius];
+                    for (int c = 0; c < vd; c++)
+                        dp[c] += w*sp[c];
+                }
+            }
+        }
+    }
+
+    static const int radius = 2;
+
+private:
+
+    const BilateralGrid& src;
+    BilateralGrid& dst;
+    int axis;
+    float kernel[2*radius + 1];
+};
+
+// Trilinear interpolation of the blurred grid at the positions of pixels
+class GridSliceInvoker : public ParallelLoopBody
+{
+public:
+
+    GridSliceInvoker(const BilateralGrid& grid_, const Mat& joint_, Mat& dst_, float invSigmaSpace_, float invSigmaColor_, float jointMin_, int pad_)
+        : grid(grid_), joint(joint_), dst(dst_), invSigmaSpace(invSigmaSpace_), invSigmaColor(invSigmaColor_), jointMin(jointMin_), pad(pad_) {}
+
+    void operator () (const Range& range) const
+    {
+        const int cn = dst.channels();
+        const int vd = grid.vd;
+        std::vector<float> acc(vd);
+
+        for (int i = range.start; i < range.end; i++)
+        {
+            const float* jrow = joint.ptr<float>(i);
+            float* drow = dst.ptr<float>(i);
+
+            float fy = i*invSigmaSpace + pad;
+            int y0 = std::min((int)fy, grid.height - 2);
+            float wy = fy - y0;
+
+            for (int j = 0; j < dst.cols; j++)
+            {
+                float fx = j*invSigmaSpace + pad;
+                float fz = (jrow[j] - jointMin)*invSigmaColor + pad;
+                int x0 = std::min((int)fx, grid.width - 2);
+                int z0 = std::min((int)fz, grid.depth - 2);
+                float wx = fx - x0, wz = fz - z0;
+
+                std::fill(acc.begin(), acc.end(), 0.0f);
+                for (int dy = 0; dy < 2; dy++)
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    float wxy = (dy ? wy : 1.0f - wy)*(dx ? wx : 1.0f - wx);
+                    const float* c0 = grid.cell(x0 + dx, y0 + dy, z0);
+                    const float* c1 = c0 + vd;
+                    for (int c = 0; c < vd; c++)
+                        acc[c] += wxy*((1.0f - wz)*c0[c] + wz*c1[c]);
+                }
+
+                float norm = acc[cn] > 0 ? 1.0f / acc[cn] : 0.0f;
+                for (int c = 0; c < cn; c++)
+                    drow[j*cn + c] = acc[c]*norm;
+            }
+        }
+    }
+
+private:
+
+    const BilateralGrid& grid;
+    const Mat& joint;
+    Mat& dst;
+    float invSigmaSpace, invSigmaColor, jointMin;
+    int pad;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Permutohedral lattice (3-channel joint image)
+
+// Open addressing hash table of the lattice points, keys are the first d coordinates of the points
+class LatticeHashTable
+{
+public:
+
+    LatticeHashTable(int d_, int vd_, int capacity)
+        : d(d_), vd(vd_), numEntries(0)
+    {
+        int n = 1;
+        while (n < 2*capacity)
+            n <<= 1;
+        slots.assign(n, -1);
+        keys.reserve((size_t)capacity*d);
+        values.reserve((size_t)capacity*vd);
+    }
+
+    int size() const { return numEntries; }
+
+    const int* getKey(int idx) const { return &keys[(size_t)idx*d]; }
+    float* getValue(int idx) { return &values[(size_t)idx*vd]; }
+
+    // Index of the point with the given key; it is added if create is set, otherwise -1 is returned for missing points
+    int find(const int* key, bool create)
+    {
+        if (create && 2*numEntries >= (int)slots.size())
+            grow();
+
+        size_t mask = slots.size() - 1;
+        size_t h = hash(key) & mask;
+        for (;;)
+        {
+            int idx = slots[h];
+            if (idx < 0)
+            {
+                if (!create)
+                    return -1;
+                slots[h] = numEntries;
+                keys.insert(keys.end(), key, key + d);
+                values.resize(values.size() + vd, 0.0f);
+                return numEntries++;
+            }
+            if (std::equal(key, key + d, getKey(idx)))
+                return idx;
+            h = (h + 1) & mask;
+        }
+    }
+
+    // Thread-safe lookup of existing points
+    int find(const int* key) const
+    {
+        size_t mask = slots.size() - 1;
+        size_t h = hash(key) & mask;
+        for (;;)
+        {
+            int idx = slots[h];
+            if (idx < 0 || std::equal(key, key + d, getKey(idx)))
+                return idx;
+            h = (h + 1) & mask;
+        }
+    }
+
+    std::vector<float>& getValues() { return values; }
+
+private:
+
+    size_t hash(const int* key) const
+    {
+        size_t h = 0;
+        for (int i = 0; i < d; i++)
+        {
+            h += (size_t)key[i];
+            h *= 2531011;
+        }
+        return h;
+    }
+
+    void grow()
+    {
+        std::vector<int> newSlots(slots.size()*2, -1);
+        size_t mask = newSlots.size() - 1;
+        for (int idx = 0; idx < numEntries; idx++)
+        {
+            size_t h = hash(getKey(idx)) & mask;
+            while (newSlots[h] >= 0)
+                h = (h + 1) & mask;
+            newSlots[h] = idx;
+        }
+        slots.swap(newSlots);
+    }
+
+    int d, vd, numEntries;
+    std::vector<int> slots;
+    std::vector<int> keys;
+    std::vector<float> values;
+};
+
+// Enclosing simplex of a point in the lattice of dimension d, see Adams et al. 2010
+class LatticeSimplex
+{
+public:
+
+    explicit LatticeSimplex(int d_)
+        : d(d_), elevated(d_ + 1), scaleFactor(d_), greedy(d_ + 1), rank(d_ + 1), barycentric(d_ + 2), canonical((d_ + 1)*(d_ + 1))
+    {
+        // Features with unit variance are blurred by the lattice with unit sigma
+        float invStdDev = std::sqrt(2.0f / 3.0f)*(d + 1);
+        for (int i = 0; i < d; i++)
+            scaleFactor[i] = invStdDev / std::sqrt((float)(i + 1)*(i + 2));
+
+        for (int i = 0; i <= d; i++)
+        {
+            for (int j = 0; j <= d - i; j++)
+                canonical[i*(d + 1) + j] = i;
+            for (int j = d - i + 1; j <= d; j++)
+                canonical[i*(d + 1) + j] = i - (d + 1);
+        }
+    }
+
+    // Finds the simplex of the position, its vertices are then given by vertexKey()
+    void compute(const float* position)
+    {
+        // Elevate the position to the hyperplane of the lattice
+        float sm = 0;
+        for (int i = d; i > 0; i--)
+        {
+            float cf = position[i - 1]*scaleFactor[i - 1];
+            elevated[i] = sm - i*cf;
+            sm += cf;
+        }
+        elevated[0] = sm;
+
+        // Closest remainder-0 point
+        const float downFactor = 1.0f / (d + 1);
+        int sum = 0;
+        for (int i = 0; i <= d; i++)
+        {
+            int rd = cvRound(downFactor*elevated[i]);
+            greedy[i] = rd*(d + 1);
+            sum += rd;
+        }
+
+        // Rank differential to find the permutation between this simplex and the canonical one
+        std::fill(rank.begin(), rank.end(), 0);
+        for (int i = 0; i < d; i++)
+        {
+            for (int j = i + 1; j <= d; j++)
+            {
+                if (elevated[i] - greedy[i] < elevated[j] - greedy[j])
+                    rank[i]++;
+                else
+                    rank[j]++;
+            }
+        }
+
+        if (sum > 0)
+        {
+            for (int i = 0; i <= d; i++)
+            {
+                if (rank[i] >= d + 1 - sum)
+                {
+                    greedy[i] -= d + 1;
+                    rank[i] += sum - (d + 1);
+                }
+                else
+                    rank[i] += sum;
+            }
+        }
+        else if (sum < 0)
+        {
+            for (int i = 0; i <= d; i++)
+            {
+                if (rank[i] < -sum)
+                {
+                    greedy[i] += d + 1;
+                    rank[i] += (d + 1) + sum;
+                }
+                else
+                    rank[i] += sum;
+            }
+        }
+
+        // Barycentric coordinates of the position in the simplex
+        std::fill(barycentric.begin(), barycentric.end(), 0.0f);
+        for (int i = 0; i <= d; i++)
+        {
+            float delta = (elevated[i] - greedy[i])*downFactor;
+            barycentric[d - rank[i]] += delta;
+            barycentric[d + 1 - rank[i]] -= delta;
+        }
+        barycentric[0] += 1.0f + barycentric[d + 1];
+    }
+
+    void vertexKey(int remainder, int* key) const
+    {
+        for (int i = 0; i < d; i++)
+            key[i] = greedy[i] + canonical[remainder*(d + 1) + rank[i]];
+    }
+
+    float weight(int remainder) const { return barycentric[remainder]; }
+
+private:
+
+    int d;
+    std::vector<float> elevated, scaleFactor;
+    std::vector<int> greedy, rank;
+    std::vector<float> barycentric;
+    std::vector<int> canonical;
+};
+
+static inline void latticePosition(const float* jointPix, int i, int j, int jointCn, float invSigmaSpace, float invSigmaColor, float* position)
+{
+    position[0] = j*invSigmaSpace;
+    position[1] = i*invSigmaSpace;
+    for (int c = 0; c < jointCn; c++)
+        position[2 + c] = jointPix[c]*invSigmaColor;
+}
+
+// Blur of the lattice values along one of the d + 1 lattice directions with [1 2 1] / 4
+class LatticeBlurInvoker : public ParallelLoopBody
+{
+public:
+
+    LatticeBlurInvoker(const LatticeHashTable& table_, const std::vector<float>& src_, std::vector<float>& dst_, int d_, int vd_, int direction_)
+        : table(table_), src(src_), dst(dst_), d(d_), vd(vd_), direction(direction_) {}
+
+    void operator () (const Range& range) const
+    {
+        std::vector<int> n1(d), n2(d);
+
+        for (int idx = range.start; idx < range.end; idx++)
+        {
+            const int* key = table.getKey(idx);
+            for (int k = 0; k < d; k++)
+            {
+                n1[k] = key[k] - 1;
+                n2[k] = key[k] + 1;
+            }
+            if (direction < d)
+            {
+                n1[direction] = key[direction] + d;
+                n2[direction] = key[direction] - d;
+            }
+
+            int i1 = table.find(&n1[0]);
+            int i2 = table.find(&n2[0]);
+
+            const float* v0 = &src[(size_t)idx*vd];
+            float* out = &dst[(size_t)idx*vd];
+            for (int c = 0; c < vd; c++)
+                out[c] = 0.5f*v0[c];
+            if (i1 >= 0)
+            {
+                const float* v1 = &src[(size_t)i1*vd];
+                for (int c = 0; c < vd; c++)
+                    out[c] += 0.25f*v1[c];
+            }
+            if (i2 >= 0)
+            {
+                const float* v2 = &src[(size_t)i2*vd];
+                for (int c = 0; c < vd; c++)
+                    out[c] += 0.25f*v2[c];
+            }
+        }
+    }
+
+private:
+
+    const LatticeHashTable& table;
+    const std::vector<float>& src;
+    std::vector<float>& dst;
+    int d, vd, direction;
+};
+
+// Interpolation of the blurred lattice values at the positions of pixels
+class LatticeSliceInvoker : public ParallelLoopBody
+{
+public:
+
+    LatticeSliceInvoker(const LatticeHashTable& table_, const std::vector<float>& values_, const Mat& joint_, Mat& dst_,
+                        int d_, float invSigmaSpace_, float invSigmaColor_)
+        : table(table_), values(values_), joint(joint_), dst(dst_), d(d_), invSigmaSpace(invSigmaSpace_), invSigmaColor(invSigmaColor_) {}
+
+    void operator () (const Range& range) const
+    {
+        const int jointCn = joint.channels();
+        const int cn = dst.channels();
+        const int vd = cn + 1;
+
+        LatticeSimplex simplex(d);
+        std::vector<float> position(d), acc(vd);
+        std::vector<int> key(d);
+
+        for (int i = range.start; i < range.end; i++)
+        {
+            const float* jrow = joint.ptr<float>(i);
+            float* drow = dst.ptr<float>(i);
+
+            for (int j = 0; j < dst.cols; j++)
+            {
+                latticePosition(jrow + j*jointCn, i, j, jointCn, invSigmaSpace, invSigmaColor, &position[0]);
+                simplex.compute(&position[0]);
+
+                std::fill(acc.begin(), acc.end(), 0.0f);
+                for (int r = 0; r <= d; r++)
+                {
+                    simplex.vertexKey(r, &key[0]);
+                    int idx = table.find(&key[0]);
+                    if (idx < 0)
+                        continue;
+                    const float* v = &values[(size_t)idx*vd];
+                    float w = simplex.weight(r);
+                    for (int c = 0; c < vd; c++)
+                        acc[c] += w*v[c];
+                }
+
+                float norm = acc[cn] > 0 ? 1.0f / acc[cn] : 0.0f;
+                for (int c = 0; c < cn; c++)
+                    drow[j*cn + c] = acc[c]*norm;
+            }
+        }
+    }
+
+private:
+
+    const LatticeHashTable& table;
+    const std::vector<float>& values;
+    const Mat& joint;
+    Mat& dst;
+    int d;
+    float invSigmaSpace, invSigmaColor;
+};
+
+}
+
+void jointBilateralFilterGrid(const Mat& joint, const Mat& src, Mat& dst, double sigmaColor, double sigmaSpace)
+{
+    CV_DbgAssert(joint.type() == CV_32FC1 && src.depth() == CV_32F && joint.size() == src.size());
+
+    const int cn = src.channels();
+    const int vd = cn + 1;
+    const int pad = GridBlurInvoker::radius;
+
+    // The grid can't be finer than the image
+    const double cellSize = std::max(sigmaSpace, 1.0);
+
+    double jointMin, jointMax;
+    minMaxLoc(joint, &jointMin, &jointMax);
+
+    const float invSigmaSpace = (float)(1.0 / cellSize);
+    const float invSigmaColor = (float)(1.0 / sigmaColor);
+
+    BilateralGrid grid((int)((src.cols - 1)*invSigmaSpace) + 2 + 2*pad,
+                       (int)((src.rows - 1)*invSigmaSpace) + 2 + 2*pad,
+                       (int)((jointMax - jointMin)*invSigmaColor) + 2 + 2*pad, vd);
+
+    // Splat the homogeneous values with trilinear weights
+    for (int i = 0; i < src.rows; i++)
+    {
+        const float* jrow = joint.ptr<float>(i);
+        const float* srow = src.ptr<float>(i);
+
+        float fy = i*invSigmaSpace + pad;
+        int y0 = (int)fy;
+        float wy = fy - y0;
+
+        for (int j = 0; j < src.cols; j++)
+        {
+            float fx = j*invSigmaSpace + pad;
+            float fz = (jrow[j] - (float)jointMin)*invSigmaColor + pad;
+            int x0 = (int)fx, z0 = (int)fz;
+            float wx = fx - x0, wz = fz - z0;
+            const float* spix = srow + j*cn;
+
+            for (int dy = 0; dy < 2; dy++)
+            for (int dx = 0; dx < 2; dx++)
+            for (int dz = 0; dz < 2; dz++)
+            {
+                float w = (dy ? wy : 1.0f - wy)*(dx ? wx : 1.0f - wx)*(dz ? wz : 1.0f - wz);
+                float* c = grid.cell(x0 + dx, y0 + dy, z0 + dz);
+                for (int k = 0; k < cn; k++)
+                    c[k] += w*spix[k];
+                c[cn] += w;
+            }
+        }
+    }
+
+    // Separable blur of the grid
+    BilateralGrid tmp(grid.width, grid.height, grid.depth, vd);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        GridBlurInvoker body(grid, tmp, axis);
+        parallel_for_(Range(0, body.numLines()), body);
+        grid.data.swap(tmp.data);
+    }
+
+    dst.create(src.size(), src.type());
+    parallel_for_(Range(0, src.rows), GridSliceInvoker(grid, joint, dst, invSigmaSpace, invSigmaColor, (float)jointMin, pad));
+}
+
+void jointBilateralFilterLattice(const Mat& joint, const Mat& src, Mat& dst, double sigmaColor, double sigmaSpace)
+{
+    CV_DbgAssert(joint.depth() == CV_32F && src.depth() == CV_32F && joint.size() == src.size());
+
+    const int jointCn = joint.channels();
+    const int cn = src.channels();
+    const int vd = cn + 1;
+    const int d = 2 + jointCn;
+
+    const float invSigmaSpace = (float)(1.0 / std::max(sigmaSpace, 1e-3));
+    const float invSigmaColor = (float)(1.0 / sigmaColor);
+
+    // Most of the pixels share lattice points, the table grows if needed
+    LatticeHashTable table(d, vd, std::max(1024, (int)(src.total() / 4)));
+    LatticeSimplex simplex(d);
+    std::vector<float> position(d);
+    std::vector<int> key(d);
+
+    // Splat the homogeneous values with barycentric weights
+    for (int i = 0; i < src.rows; i++)
+    {
+        const float* jrow = joint.ptr<float>(i);
+        const float* srow = src.ptr<float>(i);
+
+        for (int j = 0; j < src.cols; j++)
+        {
+            latticePosition(jrow + j*jointCn, i, j, jointCn, invSigmaSpace, invSigmaColor, &position[0]);
+            simplex.compute(&position[0]);
+
+            const float* spix = srow + j*cn;
+            for (int r = 0; r <= d; r++)
+            {
+                simplex.vertexKey(r, &key[0]);
+                float* v = table.getValue(table.find(&key[0], true));
+                float w = simplex.weight(r);
+                for (int c = 0; c < cn; c++)
+                    v[c] += w*spix[c];
+                v[cn] += w;
+            }
+        }
+    }
+
+    // Blur along each lattice direction
+    std::vector<float>& values = table.getValues();
+    std::vector<float> tmp(values.size());
+    for (int direction = 0; direction <= d; direction++)
+    {
+        parallel_for_(Range(0, table.size()), LatticeBlurInvoker(table, values, tmp, d, vd, direction));
+        values.swap(tmp);
+    }
+
+    dst.create(src.size(), src.type());
+    parallel_for_(Range(0, src.rows), LatticeSliceInvoker(table, values, joint, dst, d, invSigmaSpace, invSigmaColor));
+}
+
+}
+}
@@ -37,6 +37,7 @@
 #include "precomp.hpp"
 #include <vector>
 #include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <opencv2/imgproc.hpp>
 
 using namespace cv;
@@ -44,199 +45,245 @@ using namespace std;
 
 namespace
 {
+    // index of the neighbour of the first element for the 1-pixel derivative with BORDER_REFLECT_101
+    inline int reflectedFirst(int len)
+    {
+        return len > 1 ? 1 : 0;
+    }
 
-    class ParallelDft : public ParallelLoopBody
+    // h, v subproblem: forward differences of all channels (BORDER_REPLICATE),
+    // zeroed where the squared gradient magnitude summed over channels is not above the threshold
+    class ParallelShrink : public ParallelLoopBody
     {
     private:
-        vector<Mat> src_;
+        const vector<Mat> &S_;
+        vector<Mat> &h_;
+        vector<Mat> &v_;
+        float threshold_;
+
     public:
-        ParallelDft(vector<Mat> &s)
-        {
-            src_ = s;
-        }
+        ParallelShrink(const vector<Mat> &S, vector<Mat> &h, vector<Mat> &v, float threshold)
+            : S_(S), h_(h), v_(v), threshold_(threshold) {}
+
         void operator() (const Range& range) const
         {
-            for (int i = range.start; i != range.end; i++)
+            const int cn = (int)S_.size();
+            const int rows = S_[0].rows;
+            const int cols = S_[0].cols;
+            vector<float> magBuf(cols);
+            float* mag = &magBuf[0];
+
+            for (int y = range.start; y != range.end; y++)
             {
-                dft(src_[i], src_[i]);
+                const int yNext = std::min(y + 1, rows - 1);
+
+                std::fill(magBuf.begin(), magBuf.end(), 0.0f);
+
+                for (int c = 0; c < cn; c++)
+                {
+                    const float* s = S_[c].ptr<float>(y);
+                    const float* sNext = S_[c].ptr<float>(yNext);
+                    float* h = h_[c].ptr<float>(y);
+                    float* v = v_[c].ptr<float>(y);
+
+                    int x = 0;
+#if CV_SIMD128
+                    for (; x <= cols - 5; x += 4)
+                    {
+                        v_float32x4 s0 = v_load(s + x);
+                        v_float32x4 hx = v_load(s + x + 1) - s0;
+                        v_float32x4 vx = v_load(sNext + x) - s0;
+                        v_store(h + x, hx);
+                        v_store(v + x, vx);
+                        v_store(mag + x, v_load(mag + x) + hx * hx + vx * vx);
+                    }
+#endif
+                    for (; x < cols; x++)
+                    {
+                        float hx = s[std::min(x + 1, cols - 1)] - s[x];
+                        float vx = sNext[x] - s[x];
+                        h[x] = hx;
+                        v[x] = vx;
+                        mag[x] += hx * hx + vx * vx;
+                    }
+                }
+
+                for (int c = 0; c < cn; c++)
+                {
+                    float* h = h_[c].ptr<float>(y);
+                    float* v = v_[c].ptr<float>(y);
+
+                    int x = 0;
+#if CV_SIMD128
+                    v_float32x4 thr = v_setall_f32(threshold_);
+                    v_float32x4 zero = v_setzero_f32();
+                    for (; x <= cols - 4; x += 4)
+                    {
+                        v_float32x4 keep = v_load(mag + x) > thr;
+                        v_store(h + x, v_select(keep, v_load(h + x), zero));
+                        v_store(v + x, v_select(keep, v_load(v + x), zero));
+                    }
+#endif
+                    for (; x < cols; x++)
+                    {
+                        if (!(mag[x] > threshold_))
+                        {
+                            h[x] = 0;
+                            v[x] = 0;
+                        }
+                    }
+                }
             }
         }
     };
 
-    class ParallelIdft : public ParallelLoopBody
+    // divergence of (h, v): backward differences with BORDER_REFLECT_101
+    class ParallelDivergence : public ParallelLoopBody
     {
     private:
-        vector<Mat> src_;
+        const vector<Mat> &h_;
+        const vector<Mat> &v_;
+        vector<Mat> &dst_;
+
     public:
-        ParallelIdft(vector<Mat> &s)
-        {
-            src_ = s;
-        }
+        ParallelDivergence(const vector<Mat> &h, const vector<Mat> &v, vector<Mat> &dst)
+            : h_(h), v_(v), dst_(dst) {}
+
         void operator() (const Range& range) const
         {
-            for (int i = range.start; i != range.end; i++)
+            const int cn = (int)h_.size();
+            const int rows = h_[0].rows;
+            const int cols = h_[0].cols;
+
+            for (int y = range.start; y != range.end; y++)
             {
-                idft(src_[i], src_[i],DFT_SCALE);
+                const int yPrev = y > 0 ? y - 1 : reflectedFirst(rows);
+
+                for (int c = 0; c < cn; c++)
+                {
+                    const float* h = h_[c].ptr<float>(y);
+                    const float* v = v_[c].ptr<float>(y);
+                    const float* vPrev = v_[c].ptr<float>(yPrev);
+                    float* d = dst_[c].ptr<float>(y);
+
+                    d[0] = (h[reflectedFirst(cols)] - h[0]) + (vPrev[0] - v[0]);
+
+                    int x = 1;
+#if CV_SIMD128
+                    for (; x <= cols - 4; x += 4)
+                    {
+                        v_float32x4 hGrad = v_load(h + x - 1) - v_load(h + x);
+                        v_float32x4 vGrad = v_load(vPrev + x) - v_load(v + x);
+                        v_store(d + x, hGrad + vGrad);
+                    }
+#endif
+                    for (; x < cols; x++)
+                    {
+                        d[x] = (h[x - 1] - h[x]) + (vPrev[x] - v[x]);
+                    }
+                }
             }
         }
     };
 
-    class ParallelDivComplexByReal : public ParallelLoopBody
+    // S subproblem in the frequency domain: (F(I) + beta * F(div)) / (1 + beta * |F(grad)|^2),
+    // all spectrums are in CCS packed format, so the operations are element-wise on real values
+    class ParallelSolve : public ParallelLoopBody
     {
     private:
-        vector<Mat> numer_;
-        vector<Mat> denom_;
-        vector<Mat> dst_;
+        const vector<Mat> &numerConst_;
+        const Mat &denomConst_;
+        vector<Mat> &freq_;
+        float beta_;
 
     public:
-        ParallelDivComplexByReal(vector<Mat> &numer, vector<Mat> &denom, vector<Mat> &dst)
-        {
-            numer_ = numer;
-            denom_ = denom;
-            dst_ = dst;
-        }
+        ParallelSolve(const vector<Mat> &numerConst, const Mat &denomConst, vector<Mat> &freq, float beta)
+            : numerConst_(numerConst), denomConst_(denomConst), freq_(freq), beta_(beta) {}
+
         void operator() (const Range& range) const
         {
-            for (int i = range.start; i != range.end; i++)
-            {
-                Mat aPanels[2];
-                Mat bPanels[2];
-                split(numer_[i], aPanels);
-                split(denom_[i], bPanels);
+            const int cn = (int)freq_.size();
+            const int cols = denomConst_.cols;
 
-                Mat realPart;
-                Mat imaginaryPart;
-
-                divide(aPanels[0], denom_[i], realPart);
-                divide(aPanels[1], denom_[i], imaginaryPart);
-
-                aPanels[0] = realPart;
-                aPanels[1] = imaginaryPart;
+            for (int y = range.start; y != range.end; y++)
+            {
+                const float* denom = denomConst_.ptr<float>(y);
 
-                merge(aPanels, 2, dst_[i]);
+                for (int c = 0; c < cn; c++)
+                {
+                    const float* numer = numerConst_[c].ptr<float>(y);
+                    float* freq = freq_[c].ptr<float>(y);
+
+                    int x = 0;
+#if CV_SIMD128
+                    v_float32x4 b = v_setall_f32(beta_);
+                    v_float32x4 one = v_setall_f32(1.0f);
+                    for (; x <= cols - 4; x += 4)
+                    {
+                        v_float32x4 n = v_load(numer + x) + b * v_load(freq + x);
+                        v_store(freq + x, n / (one + b * v_load(denom + x)));
+                    }
+#endif
+                    for (; x < cols; x++)
+                    {
+                        freq[x] = (numer[x] + beta_ * freq[x]) / (1.0f + beta_ * denom[x]);
+                    }
+                }
             }
         }
     };
 
-
-    void shift(InputArray src, OutputArray dst, int shift_x, int shift_y)
+    class ParallelDft : public ParallelLoopBody
     {
-        Mat S = src.getMat();
-        Mat D = dst.getMat();
+    private:
+        const vector<Mat> &src_;
+        vector<Mat> &dst_;
+        int flags_;
+    public:
+        ParallelDft(const vector<Mat> &src, vector<Mat> &dst, int flags)
+            : src_(src), dst_(dst), flags_(flags) {}
 
-        if(S.data == D.data)
+        void operator() (const Range& range) const
         {
-            S = S.clone();
-        }
-
-        D.create(S.size(), S.type());
-
-        Mat s0(S, Rect(0, 0, S.cols - shift_x, S.rows - shift_y));
-        Mat s1(S, Rect(S.cols - shift_x, 0, shift_x, S.rows - shift_y));
-        Mat s2(S, Rect(0, S.rows - shift_y, S.cols-shift_x, shift_y));
-        Mat s3(S, Rect(S.cols - shift_x, S.rows- shift_y, shift_x, shift_y));
-
-        Mat d0(D, Rect(shift_x, shift_y, S.cols - shift_x, S.rows - shift_y));
-        Mat d1(D, Rect(0, shift_y, shift_x, S.rows - shift_y));
-        Mat d2(D, Rect(shift_x, 0, S.cols-shift_x, shift_y));
-        Mat d3(D, Rect(0,0,shift_x, shift_y));
-
-        s0.copyTo(d0);
-        s1.copyTo(d1);
-        s2.copyTo(d2);
-        s3.copyTo(d3);
-    }
-
-    // dft after padding imaginary
-    void fft(InputArray src, OutputArray dst)
-    {
-        Mat S = src.getMat();
-        Mat planes[] = {S.clone(), Mat::zeros(S.size(), S.type())};
-        Mat x;
-        merge(planes, 2, dst);
-
-        // compute the result
-        dft(dst, dst);
-    }
-
-    void psf2otf(InputArray src, OutputArray dst, int height, int width)
-    {
-        Mat S = src.getMat();
-        Mat D = dst.getMat();
-
-        Mat padded;
-
-        if(S.data == D.data){
-            S = S.clone();
-        }
-
-        // add padding
-        copyMakeBorder(S, padded, 0, height - S.rows, 0, width - S.cols,
-            BORDER_CONSTANT, Scalar::all(0));
-
-        shift(padded, padded, width - S.cols / 2, height - S.rows / 2);
-
-        // convert to frequency domain
-        fft(padded, dst);
-    }
-
-    void dftMultiChannel(InputArray src, vector<Mat> &dst)
-    {
-        Mat S = src.getMat();
-
-        split(S, dst);
-
-        for(int i = 0; i < S.channels(); i++){
-            Mat planes[] = {dst[i].clone(), Mat::zeros(dst[i].size(), dst[i].type())};
-            merge(planes, 2, dst[i]);
+            for (int i = range.start; i != range.end; i++)
+            {
+                dft(src_[i], dst_[i], flags_);
+            }
         }
+    };
 
-        parallel_for_(cv::Range(0,S.channels()), ParallelDft(dst));
-
-    }
-
-    void idftMultiChannel(const vector<Mat> &src, OutputArray dst)
+    // 1 - cos of the frequencies of the real DFT elements in CCS packed format, for one dimension
+    void ccsFrequencies(int len, bool packed, vector<float> &dst)
     {
-        vector<Mat> channels(src);
-
-        parallel_for_(Range(0, int(src.size())), ParallelIdft(channels));
-
-        for(int i = 0; unsigned(i) < src.size(); i++){
-            Mat panels[2];
-            split(channels[i], panels);
-            channels[i] = panels[0];
+        dst.resize(len);
+        for (int i = 0; i < len; i++)
+        {
+            int f = packed ? (i + 1) / 2 : i;
+            dst[i] = (float)(2.0 - 2.0 * std::cos(2.0 * CV_PI * f / len));
         }
-
-        Mat D;
-        merge(channels, D);
-        D.copyTo(dst);
     }
 
-    void divComplexByRealMultiChannel(vector<Mat> &numer,
-        vector<Mat> &denom, vector<Mat> &dst)
+    // |F(dx)|^2 + |F(dy)|^2 for the [1, -1] kernels, arranged as the real and imaginary parts
+    // of the CCS packed spectrum of a rows x cols real image
+    Mat gradientDenominator(int rows, int cols)
     {
+        vector<float> wx, wyPacked, wyFull;
+        ccsFrequencies(cols, true, wx);
+        ccsFrequencies(rows, true, wyPacked);
+        ccsFrequencies(rows, false, wyFull);
 
-        for(int i = 0; unsigned(i) < numer.size(); i++)
+        Mat denom(rows, cols, CV_32F);
+        for (int y = 0; y < rows; y++)
         {
-            dst[i].create(numer[i].size(), numer[i].type());
+            float* d = denom.ptr<float>(y);
+            for (int x = 0; x < cols; x++)
+            {
+                // the first and, for the even width, the last columns are packed along y too
+                bool packedColumn = x == 0 || (cols % 2 == 0 && x == cols - 1);
+                d[x] = wx[x] + (packedColumn ? wyPacked[y] : wyFull[y]);
+            }
         }
-        parallel_for_(Range(0, int(numer.size())), ParallelDivComplexByReal(numer, denom, dst));
-
-    }
-
-        // power of 2 of the absolute value of the complex
-    Mat pow2absComplex(InputArray src)
-    {
-        Mat S = src.getMat();
-
-        Mat sPanels[2];
-        split(S, sPanels);
-
-        Mat mag;
-        magnitude(sPanels[0], sPanels[1], mag);
-        pow(mag, 2, mag);
-
-        return mag;
+        return denom;
     }
 }
 
@@ -274,93 +321,49 @@ namespace cv
             }
 
             const double betaMax = 100000;
+            const int cn = S.channels();
+            const int rows = S.rows;
+            const int cols = S.cols;
 
             // gradient operators in frequency domain
-            Mat otfFx, otfFy;
-            float kernel[2] = {-1, 1};
-            float kernel_inv[2] = {1,-1};
-            psf2otf(Mat(1,2,CV_32FC1, kernel_inv), otfFx, S.rows, S.cols);
-            psf2otf(Mat(2,1,CV_32FC1, kernel_inv), otfFy, S.rows, S.cols);
+            Mat denomConst = gradientDenominator(rows, cols);
 
-            vector<Mat> denomConst;
-            Mat tmp = pow2absComplex(otfFx) + pow2absComplex(otfFy);
+            // channels are solved separately, the buffers are allocated once for all iterations
+            vector<Mat> planes;
+            split(S, planes);
 
-            for(int i = 0; i < S.channels(); i++)
+            vector<Mat> h(cn), v(cn), hvGrad(cn), freq(cn);
+            for(int i = 0; i < cn; i++)
             {
-                denomConst.push_back(tmp);
+                h[i].create(rows, cols, CV_32F);
+                v[i].create(rows, cols, CV_32F);
+                hvGrad[i].create(rows, cols, CV_32F);
+                freq[i].create(rows, cols, CV_32F);
             }
 
             // input image in frequency domain
-            vector<Mat> numerConst;
-            dftMultiChannel(S, numerConst);
+            vector<Mat> numerConst(cn);
+            parallel_for_(Range(0, cn), ParallelDft(planes, numerConst, 0));
+
             /*********************************
             * solver
             *********************************/
             double beta = 2 * lambda;
             while(beta < betaMax){
                 // h, v subproblem
-                Mat h, v;
-
-                filter2D(S, h, -1, Mat(1, 2, CV_32FC1, kernel), Point(0, 0),
-                0, BORDER_REPLICATE);
-                filter2D(S, v, -1, Mat(2, 1, CV_32FC1, kernel), Point(0, 0),
-                0, BORDER_REPLICATE);
-
-                Mat hvMag = h.mul(h) + v.mul(v);
-
-                Mat mask;
-                if(S.channels() == 1)
-                {
-                    threshold(hvMag, mask, lambda/beta, 1, THRESH_BINARY);
-                }
-                else if(S.channels() > 1)
-                {
-                    vector<Mat> channels(S.channels());
-                    split(hvMag, channels);
-                    hvMag = channels[0];
-
-                    for(int i = 1; i < S.channels(); i++)
-                    {
-                        hvMag = hvMag + channels[i];
-                    }
-
-                    threshold(hvMag, mask, lambda/beta, 1, THRESH_BINARY);
-
-                    Mat in[] = {mask, mask, mask};
-                    merge(in, 3, mask);
-                }
-
-                h = h.mul(mask);
-                v = v.mul(mask);
+                parallel_for_(Range(0, rows), ParallelShrink(planes, h, v, (float)(lambda/beta)));
 
                 // S subproblem
-                vector<Mat> denom(S.channels());
-                for(int i = 0; i < S.channels(); i++)
-                {
-                    denom[i] = beta * denomConst[i] + 1;
-                }
-
-                Mat hGrad, vGrad;
-                filter2D(h, hGrad, -1, Mat(1, 2, CV_32FC1, kernel_inv));
-                filter2D(v, vGrad, -1, Mat(2, 1, CV_32FC1, kernel_inv));
-
-                vector<Mat> hvGradFreq;
-                dftMultiChannel(hGrad+vGrad, hvGradFreq);
-
-                vector<Mat> numer(S.channels());
-                for(int i = 0; i < S.channels(); i++)
-                {
-                    numer[i] = numerConst[i] + hvGradFreq[i] * beta;
-                }
-
-                vector<Mat> sFreq(S.channels());
-                divComplexByRealMultiChannel(numer, denom, sFreq);
-
-                idftMultiChannel(sFreq, S);
+                parallel_for_(Range(0, rows), ParallelDivergence(h, v, hvGrad));
+                parallel_for_(Range(0, cn), ParallelDft(hvGrad, freq, 0));
+                parallel_for_(Range(0, rows), ParallelSolve(numerConst, denomConst, freq, (float)beta));
+                parallel_for_(Range(0, cn), ParallelDft(freq, planes, DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT));
 
                 beta = beta * kappa;
             }
 
+            merge(planes, S);
+
             Mat D = dst.getMat();
             if(D.depth() == CV_8U)
             {
@@ -46,6 +46,7 @@
 #include <map>
 #include <queue>
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 using namespace std;
 
@@ -131,6 +132,18 @@ private:
     // W
     Mat m_W;
 
+    // 1 / W
+    Mat m_invW;
+
+    // distance features, they
+    // only depend on x or y
+    vector<float> m_featx1, m_featx2;
+    vector<float> m_featy1, m_featy2;
+
+    // color features, two
+    // planes per channel
+    vector<Mat> m_featc;
+
     // labels storage
     Mat m_klabels;
 
@@ -143,6 +156,9 @@ private:
     // precompute vector space
     inline void GetFeatureSpace();
 
+    // precompute features
+    inline void GetFeaturePlanes();
+
     // LSC
     inline void PerformLSC( const int& num_iterations );
 
@@ -219,6 +235,9 @@ SuperpixelLSCImpl::SuperpixelLSCImpl( InputArray _image, int _region_size, float
 
     // feature space
     GetFeatureSpace();
+
+    // features of all pixels
+    GetFeaturePlanes();
 }
 
 SuperpixelLSCImpl::~SuperpixelLSCImpl()
@@ -1190,48 +1209,70 @@ inline void SuperpixelLSCImpl::GetFeatureSpace()
                    m_stepx, m_stepy ) );
 }
 
-struct FeatureSpaceCenters : ParallelLoopBody
+/*
+ * Compute Feature Planes
+ *
+ * The features of the k-means are the distance and color terms divided by W.
+ * The distance terms only depend on x or y, the color terms are stored as
+ * float planes, so the k-means does not evaluate any trigonometric function.
+ */
+inline void SuperpixelLSCImpl::GetFeaturePlanes()
 {
-    FeatureSpaceCenters( const vector< Mat >& _chvec, const Mat& _W,
-                         const vector<float>& _kseedsx, const vector<float>& _kseedsy,
-                         vector<float>* _centerX1, vector<float>* _centerX2,
-                         vector<float>* _centerY1, vector<float>* _centerY2,
-                         vector< vector<float> >* _centerC1, vector< vector<float> >* _centerC2,
-                         const int _nr_channels, const float _chvec_max,
-                         const float _dist_coeff, const float _color_coeff,
-                         const int _stepx, const int _stepy )
+    const float PI2 = float(CV_PI / 2.0f);
+
+    m_featx1.resize( m_width ); m_featx2.resize( m_width );
+    for( int x = 0; x < m_width; x++ )
     {
-      W = _W;
-      chvec = _chvec;
-      stepx = _stepx;
-      stepy = _stepy;
-      chvec_max = _chvec_max;
-      dist_coeff = _dist_coeff;
-      nr_channels = _nr_channels;
-      color_coeff = _color_coeff;
+      float thetaX = ( (float) x / (float) m_stepx ) * PI2;
+      m_featx1[x] = m_dist_coeff * cos(thetaX);
+      m_featx2[x] = m_dist_coeff * sin(thetaX);
+    }
 
-      PI2 = float(CV_PI / 2.0f);
+    m_featy1.resize( m_height ); m_featy2.resize( m_height );
+    for( int y = 0; y < m_height; y++ )
+    {
+      float thetaY = ( (float) y / (float) m_stepy ) * PI2;
+      m_featy1[y] = m_dist_coeff * cos(thetaY);
+      m_featy2[y] = m_dist_coeff * sin(thetaY);
+    }
 
-      kseedsx = _kseedsx;
-      kseedsy = _kseedsy;
-      width  = chvec[0].cols;
-      height = chvec[0].rows;
+    m_featc.resize( 2 * m_nr_channels );
+    Mat thetaC;
+    for( int b = 0; b < m_nr_channels; b++ )
+    {
+      m_chvec[b].convertTo( thetaC, CV_32F, PI2 / m_chvec_max );
+      polarToCart( Mat(), thetaC, m_featc[2*b], m_featc[2*b+1] );
+      m_featc[2*b]   *= m_color_coeff / m_nr_channels;
+      m_featc[2*b+1] *= m_color_coeff / m_nr_channels;
+    }
 
-      centerX1 = _centerX1; centerX2 = _centerX2;
-      centerY1 = _centerY1; centerY2 = _centerY2;
-      centerC1 = _centerC1; centerC2 = _centerC2;
+    divide( 1.0, m_W, m_invW );
+}
+
+struct FeatureSpaceCenters : ParallelLoopBody
+{
+    FeatureSpaceCenters( Mat* _centers, const vector<Mat>& _featc, const Mat& _invW,
+                         const vector<float>& _featx1, const vector<float>& _featx2,
+                         const vector<float>& _featy1, const vector<float>& _featy2,
+                         const vector<float>& _kseedsx, const vector<float>& _kseedsy,
+                         const int _stepx, const int _stepy )
+      : centers(_centers), featc(_featc), invW(_invW),
+        featx1(_featx1), featx2(_featx2), featy1(_featy1), featy2(_featy2),
+        kseedsx(_kseedsx), kseedsy(_kseedsy), stepx(_stepx), stepy(_stepy)
+    {
+      width  = invW.cols;
+      height = invW.rows;
     }
 
     void operator()( const Range& range ) const
     {
+      int nr_feats = (int) featc.size();
+
       for( int i = range.start; i < range.end; i++ )
       {
-        centerX1->at(i) = 0.0f; centerX2->at(i) = 0.0f;
-        centerY1->at(i) = 0.0f; centerY2->at(i) = 0.0f;
-        for( int b = 0; b < nr_channels; b++ )
-        {
-          centerC1->at(b)[i] = 0.0f; centerC2->at(b)[i] = 0.0f;
-        }
+        float* center = centers->ptr<float>(i);
+        for( int f = 0; f < 4 + nr_feats; f++ )
+          center[f] = 0.0f;
 
         int X = (int)kseedsx[i]; int Y = (int)kseedsy[i];
         int minX = (X-stepx/4 <= 0) ? 0 : X-stepx/4;
@@ -1239,491 +1280,222 @@ struct FeatureSpaceCenters : ParallelLoopBody
         int maxX = (X+stepx/4 >= width -1) ? width -1 : X+stepx/4;
         int maxY = (Y+stepy/4 >= height-1) ? height-1 : Y+stepy/4;
 
-        int count = 0;
-        for( int x = minX; x <= maxX; x++ )
+        for( int y = minY; y <= maxY; y++ )
         {
-          float thetaX = ( (float) x / (float) stepx ) * PI2;
-
-          float tx1 = dist_coeff * cos(thetaX);
-          float tx2 = dist_coeff * sin(thetaX);
-
-          for( int y = minY; y <= maxY; y++ )
+          const float* iw = invW.ptr<float>(y);
+          for( int x = minX; x <= maxX; x++ )
           {
-            count++;
-            float thetaY = ( (float) y / (float) stepy ) * PI2;
-
-            // we do not store pre-computed x1, x2
-            float x1 = tx1 / W.at<float>(y,x);
-            float x2 = tx2 / W.at<float>(y,x);
-
-            // we do not store pre-computed y1, y2
-            float y1 = (dist_coeff * cos(thetaY)) / W.at<float>(y,x);
-            float y2 = (dist_coeff * sin(thetaY)) / W.at<float>(y,x);
-
-            centerX1->at(i) += x1; centerX2->at(i) += x2;
-            centerY1->at(i) += y1; centerY2->at(i) += y2;
-
-            for( int b = 0; b < nr_channels; b++ )
-            {
-              float thetaC = 0.0f;
-              switch ( chvec[b].depth() )
-              {
-                case CV_8U:
-                  thetaC = ( (float) chvec[b].at<uchar>(y,x)  / chvec_max ) * PI2;
-                  break;
-                case CV_8S:
-                  thetaC = ( (float) chvec[b].at<char>(y,x)   / chvec_max ) * PI2;
-                  break;
-                case CV_16U:
-                  thetaC = ( (float) chvec[b].at<ushort>(y,x) / chvec_max ) * PI2;
-                  break;
-                case CV_16S:
-                  thetaC = ( (float) chvec[b].at<short>(y,x)  / chvec_max ) * PI2;
-                  break;
-                case CV_32S:
-                  thetaC = ( (float) chvec[b].at<int>(y,x)    / chvec_max ) * PI2;
-                  break;
-                case CV_32F:
-                  thetaC = ( (float) chvec[b].at<float>(y,x)  / chvec_max ) * PI2;
-                  break;
-                case CV_64F:
-                  thetaC = ( (float) chvec[b].at<double>(y,x) / chvec_max ) * PI2;
-                  break;
-                default:
-                  CV_Error( Error::StsInternal, "Invalid matrix depth" );
-                  break;
-              }
-              // we do not store pre-computed C1[b], C2[b]
-              float C1 = (color_coeff * cos(thetaC) / nr_channels) / W.at<float>(y,x);
-              float C2 = (color_coeff * sin(thetaC) / nr_channels) / W.at<float>(y,x);
-
-              centerC1->at(b)[i] += C1; centerC2->at(b)[i] += C2;
-            }
+            center[0] += featx1[x] * iw[x]; center[1] += featx2[x] * iw[x];
+            center[2] += featy1[y] * iw[x]; center[3] += featy2[y] * iw[x];
+            for( int f = 0; f < nr_feats; f++ )
+              center[4+f] += featc[f].ptr<float>(y)[x] * iw[x];
           }
         }
+
         // normalize
-        centerX1->at(i) /= count; centerX2->at(i) /= count;
-        centerY1->at(i) /= count; centerY2->at(i) /= count;
-        for( int b = 0; b < nr_channels; b++ )
-        {
-          centerC1->at(b)[i] /= count; centerC2->at(b)[i] /= count;
-        }
+        int count = (maxX - minX + 1) * (maxY - minY + 1);
+        for( int f = 0; f < 4 + nr_feats; f++ )
+          center[f] /= count;
       }
     }
 
-    Mat W;
-    float PI2;
-    int nr_channels;
+    Mat* centers;
+    const vector<Mat>& featc;
+    const Mat& invW;
+    const vector<float>& featx1;
+    const vector<float>& featx2;
+    const vector<float>& featy1;
+    const vector<float>& featy2;
+    const vector<float>& kseedsx;
+    const vector<float>& kseedsy;
     int stepx, stepy;
     int width, height;
-
-    float chvec_max;
-    float dist_coeff;
-    float color_coeff;
-
-    vector<Mat> chvec;
-    vector<float> kseedsx, kseedsy;
-    vector< vector<float> >* centerC1;
-    vector< vector<float> >* centerC2;
-    vector<float> *centerX1, *centerX2;
-    vector<float> *centerY1, *centerY2;
 };
 
+/*
+ * Assigns the pixels of horizontal stripes to the nearest center. Each
+ * stripe visits the centers in the same order, so the result does not
+ * depend on the number of threads, and the stripes never write the same
+ * pixels.
+ */
 struct FeatureSpaceKmeans : ParallelLoopBody
 {
-    FeatureSpaceKmeans( Mat* _klabels, Mat* _dist,
-                        const vector< Mat >& _chvec, const Mat& _W,
+    FeatureSpaceKmeans( Mat* _klabels, Mat* _dist, const Mat& _centers,
+                        const vector<Mat>& _featc, const Mat& _invW,
+                        const vector<float>& _featx1, const vector<float>& _featx2,
+                        const vector<float>& _featy1, const vector<float>& _featy2,
                         const vector<float>& _kseedsx, const vector<float>& _kseedsy,
-                        vector<float>& _centerX1, vector<float>& _centerX2,
-                        vector<float>& _centerY1, vector<float>& _centerY2,
-                        vector< vector<float> >& _centerC1, vector< vector<float> >& _centerC2,
-                        const int _nr_channels, const float _chvec_max,
-                        const float _dist_coeff, const float _color_coeff,
-                        const int _stepx, const int _stepy )
+                        const int _stepx, const int _stepy, const int _stripe )
+      : klabels(_klabels), dist(_dist), centers(_centers), featc(_featc), invW(_invW),
+        featx1(_featx1), featx2(_featx2), featy1(_featy1), featy2(_featy2),
+        kseedsx(_kseedsx), kseedsy(_kseedsy), stepx(_stepx), stepy(_stepy), stripe(_stripe)
     {
-      W = _W;
-      dist = _dist;
-      chvec = _chvec;
-      stepx = _stepx;
-      stepy = _stepy;
-      klabels = _klabels;
-      chvec_max = _chvec_max;
-      dist_coeff = _dist_coeff;
-      nr_channels = _nr_channels;
-      color_coeff = _color_coeff;
-
-      PI2 = float(CV_PI / 2.0f);
-
-      kseedsx = _kseedsx;
-      kseedsy = _kseedsy;
-      width  = chvec[0].cols;
-      height = chvec[0].rows;
-
-      centerX1 = _centerX1; centerX2 = _centerX2;
-      centerY1 = _centerY1; centerY2 = _centerY2;
-      centerC1 = _centerC1; centerC2 = _centerC2;
+      width  = invW.cols;
+      height = invW.rows;
     }
 
     void operator()( const Range& range ) const
     {
-      for( int i = range.start; i < range.end; i++ )
+      AutoBuffer<const float*> rows( featc.size() + 1 );
+
+      for( int s = range.start; s < range.end; s++ )
       {
-        int X = (int)kseedsx[i]; int Y = (int)kseedsy[i];
-        int minX = (X-(stepx) <= 0) ? 0 : X-stepx;
-        int minY = (Y-(stepy) <= 0) ? 0 : Y-stepy;
-        int maxX = (X+(stepx) >= width -1) ? width -1 : X+stepx;
-        int maxY = (Y+(stepy) >= height-1) ? height-1 : Y+stepy;
+        int stripeMinY = s * stripe;
+        int stripeMaxY = std::min( stripeMinY + stripe, height ) - 1;
 
-        for( int x = minX; x <= maxX; x++ )
+        for( int i = 0; i < centers.rows; i++ )
         {
-          float thetaX = ( (float) x / (float) stepx ) * PI2;
+          int X = (int)kseedsx[i]; int Y = (int)kseedsy[i];
+          int minY = std::max( Y - stepy, stripeMinY );
+          int maxY = std::min( Y + stepy, stripeMaxY );
+          if ( minY > maxY )
+            continue;
 
-          float tx1 = dist_coeff * cos(thetaX);
-          float tx2 = dist_coeff * sin(thetaX);
+          // only the 2S x 2S window around the seed
+          int minX = std::max( X - stepx, 0 );
+          int maxX = std::min( X + stepx, width - 1 );
 
           for( int y = minY; y <= maxY; y++ )
-          {
-            float thetaY = ( (float) y / (float) stepy ) * PI2;
-
-            // we do not store pre-computed x1, x2
-            float x1 = tx1 / W.at<float>(y,x);
-            float x2 = tx2 / W.at<float>(y,x);
-            // we do not store pre-computed y1, y2
-            float y1 = (dist_coeff * cos(thetaY)) / W.at<float>(y,x);
-            float y2 = (dist_coeff * sin(thetaY)) / W.at<float>(y,x);
-
-            float diffx1 = x1 - centerX1[i]; float diffx2 = x2 - centerX2[i];
-            float diffy1 = y1 - centerY1[i]; float diffy2 = y2 - centerY2[i];
-
-            // compute distance given distance terms
-            double D = (diffx1 * diffx1) + (diffx2 * diffx2)
-                     + (diffy1 * diffy1) + (diffy2 * diffy2);
-
-            // compute distance given channels terms
-            for( int b = 0; b < nr_channels; b++ )
-            {
-              float thetaC = 0.0f;
-              switch ( chvec[b].depth() )
-              {
-                case CV_8U:
-                  thetaC = ( (float) chvec[b].at<uchar>(y,x)  / chvec_max ) * PI2;
-                  break;
-                case CV_8S:
-                  thetaC = ( (float) chvec[b].at<char>(y,x)   / chvec_max ) * PI2;
-                  break;
-                case CV_16U:
-                  thetaC = ( (float) chvec[b].at<ushort>(y,x) / chvec_max ) * PI2;
-                  break;
-                case CV_16S:
-                  thetaC = ( (float) chvec[b].at<short>(y,x)  / chvec_max ) * PI2;
-                  break;
-                case CV_32S:
-                  thetaC = ( (float) chvec[b].at<int>(y,x)    / chvec_max ) * PI2;
-                  break;
-                case CV_32F:
-                  thetaC = ( (float) chvec[b].at<float>(y,x)  / chvec_max ) * PI2;
-                  break;
-                case CV_64F:
-                  thetaC = ( (float) chvec[b].at<double>(y,x) / chvec_max ) * PI2;
-                  break;
-                default:
-                  CV_Error( Error::StsInternal, "Invalid matrix depth" );
-                  break;
-              }
-              // we do not store pre-computed C1[b], C2[b]
-              float C1 = (color_coeff * cos(thetaC) / nr_channels) / W.at<float>(y,x);
-              float C2 = (color_coeff * sin(thetaC) / nr_channels) / W.at<float>(y,x);
-
-              float diffC1 = C1 - centerC1[b][i]; float diffC2 = C2 - centerC2[b][i];
-
-              D += (diffC1 * diffC1) + (diffC2 * diffC2);
-            }
-
-            // assign label if within D
-            if ( D < dist->at<float>(y,x) )
-            {
-              dist->at<float>(y,x) = (float)D;
-              klabels->at<int>(y,x) = i;
-            }
-          }
+            assignRow( y, minX, maxX + 1, i, rows );
         }
-
       }
     }
 
-    Mat W;
-    float PI2;
-    int nr_channels;
-    int stepx, stepy;
-    int width, height;
-
-    float chvec_max;
-    float dist_coeff;
-    float color_coeff;
-
-    Mat* dist;
-    Mat* klabels;
-    vector<Mat> chvec;
-    vector<float> kseedsx, kseedsy;
-    vector<float> centerX1, centerX2;
-    vector<float> centerY1, centerY2;
-    vector< vector<float> > centerC1;
-    vector< vector<float> > centerC2;
-};
-
-struct FeatureCenterDists
-{
-    FeatureCenterDists( const vector< Mat >& _chvec, const Mat& _W, const Mat& _klabels,
-                        const int _nr_channels, const float _chvec_max, const float _dist_coeff,
-                        const float _color_coeff, const int _stepx, const int _stepy, const int _numlabels )
+    void assignRow( int y, int minX, int maxX, int label, AutoBuffer<const float*>& rows ) const
     {
-      W = _W;
-      chvec = _chvec;
-      stepx = _stepx;
-      stepy = _stepy;
-      klabels = _klabels;
-      numlabels = _numlabels;
-      chvec_max = _chvec_max;
-      dist_coeff = _dist_coeff;
-      nr_channels = _nr_channels;
-      color_coeff = _color_coeff;
-
-      PI2 = float(CV_PI / 2.0f);
-
-      Wsum.resize(numlabels);
-      kseedsx.resize(numlabels);
-      kseedsy.resize(numlabels);
-      centerX1.resize(numlabels);
-      centerX2.resize(numlabels);
-      centerY1.resize(numlabels);
-      centerY2.resize(numlabels);
-      centerC1.resize(nr_channels);
-      centerC2.resize(nr_channels);
-      clusterSize.resize(numlabels);
-      for( int b = 0; b < nr_channels; b++ )
+      int nr_feats = (int) featc.size();
+      const float* center = centers.ptr<float>(label);
+      const float* iw = invW.ptr<float>(y);
+      const float* fx1 = &featx1[0];
+      const float* fx2 = &featx2[0];
+      const float fy1 = featy1[y];
+      const float fy2 = featy2[y];
+      float* d = dist->ptr<float>(y);
+      int* l = klabels->ptr<int>(y);
+      for( int f = 0; f < nr_feats; f++ )
+        rows[f] = featc[f].ptr<float>(y);
+
+      int x = minX;
+#if CV_SIMD128
+      v_float32x4 vcx1 = v_setall_f32(center[0]), vcx2 = v_setall_f32(center[1]);
+      v_float32x4 vcy1 = v_setall_f32(center[2]), vcy2 = v_setall_f32(center[3]);
+      v_float32x4 vfy1 = v_setall_f32(fy1), vfy2 = v_setall_f32(fy2);
+      v_int32x4 vlabel = v_setall_s32(label);
+      for( ; x <= maxX - 4; x += 4 )
       {
-        centerC1[b].resize(numlabels);
-        centerC2[b].resize(numlabels);
-      }
-      // refill with zero all arrays
-      fill(centerX1.begin(), centerX1.end(), 0.0f);
-      fill(centerX2.begin(), centerX2.end(), 0.0f);
-      fill(centerY1.begin(), centerY1.end(), 0.0f);
-      fill(centerY2.begin(), centerY2.end(), 0.0f);
-      for( int b = 0; b < nr_channels; b++ )
-      {
-        fill(centerC1[b].begin(), centerC1[b].end(), 0.0f);
-        fill(centerC2[b].begin(), centerC2[b].end(), 0.0f);
-      }
-      fill(Wsum.begin(), Wsum.end(), 0.0f);
-      fill(kseedsx.begin(), kseedsx.end(), 0.0f);
-      fill(kseedsy.begin(), kseedsy.end(), 0.0f);
-      fill(clusterSize.begin(), clusterSize.end(), 0);
-    }
+        v_float32x4 w = v_load(iw + x);
+        v_float32x4 t = v_load(fx1 + x) * w - vcx1;
+        v_float32x4 D = t * t;
+        t = v_load(fx2 + x) * w - vcx2; D += t * t;
+        t = vfy1 * w - vcy1; D += t * t;
+        t = vfy2 * w - vcy2; D += t * t;
+        for( int f = 0; f < nr_feats; f++ )
+        {
+          t = v_load(rows[f] + x) * w - v_setall_f32(center[4+f]);
+          D += t * t;
+        }
 
-    FeatureCenterDists( const FeatureCenterDists& counter, Split )
-    {
-      *this = counter;
-      // refill with zero all arrays
-      fill(centerX1.begin(), centerX1.end(), 0.0f);
-      fill(centerX2.begin(), centerX2.end(), 0.0f);
-      fill(centerY1.begin(), centerY1.end(), 0.0f);
-      fill(centerY2.begin(), centerY2.end(), 0.0f);
-      for( int b = 0; b < nr_channels; b++ )
-      {
-        fill(centerC1[b].begin(), centerC1[b].end(), 0.0f);
-        fill(centerC2[b].begin(), centerC2[b].end(), 0.0f);
+        // assign label if within D
+        v_float32x4 old = v_load(d + x);
+        v_float32x4 mask = D < old;
+        v_store(d + x, v_select(mask, D, old));
+        v_store(l + x, v_select(v_reinterpret_as_s32(mask), vlabel, v_load(l + x)));
       }
-      fill(Wsum.begin(), Wsum.end(), 0.0f);
-      fill(kseedsx.begin(), kseedsx.end(), 0.0f);
-      fill(kseedsy.begin(), kseedsy.end(), 0.0f);
-      fill(clusterSize.begin(), clusterSize.end(), 0);
-
-    }
-
-    void operator()( const BlockedRange& range )
-    {
-      // previous block state
-      vector<float> tmp_Wsum = Wsum;
-      vector<float> tmp_kseedsx = kseedsx;
-      vector<float> tmp_kseedsy = kseedsy;
-      vector<float> tmp_centerX1 = centerX1;
-      vector<float> tmp_centerX2 = centerX2;
-      vector<float> tmp_centerY1 = centerY1;
-      vector<float> tmp_centerY2 = centerY2;
-      vector< vector<float> > tmp_centerC1 = centerC1;
-      vector< vector<float> > tmp_centerC2 = centerC2;
-      vector<int> tmp_clusterSize = clusterSize;
-
-      for ( int x = range.begin(); x != range.end(); x++ )
+#endif
+      for( ; x < maxX; x++ )
       {
-
-        float thetaX = ( (float) x / (float) stepx ) * PI2;
-
-        // we do not store pre-computed x1, x2
-        float x1 = (dist_coeff * cos(thetaX));
-        float x2 = (dist_coeff * sin(thetaX));
-
-        for( int y = 0; y < chvec[0].rows; y++ )
+        float w = iw[x];
+        float t = fx1[x] * w - center[0];
+        float D = t * t;
+        t = fx2[x] * w - center[1]; D += t * t;
+        t = fy1 * w - center[2]; D += t * t;
+        t = fy2 * w - center[3]; D += t * t;
+        for( int f = 0; f < nr_feats; f++ )
         {
-          float thetaY = ( (float) y / (float) stepy ) * PI2;
-
-          // we do not store pre-computed y1, y2
-          float y1 = (dist_coeff * cos(thetaY));
-          float y2 = (dist_coeff * sin(thetaY));
-
-          int L = klabels.at<int>(y,x);
-
-          tmp_centerX1[L] += x1; tmp_centerX2[L] += x2;
-          tmp_centerY1[L] += y1; tmp_centerY2[L] += y2;
-
-          // compute distance given channels terms
-          for( int b = 0; b < nr_channels; b++ )
-          {
-            float thetaC = 0.0f;
-            switch ( chvec[b].depth() )
-            {
-              case CV_8U:
-                thetaC = ( (float) chvec[b].at<uchar>(y,x)  / chvec_max ) * PI2;
-                break;
-              case CV_8S:
-                thetaC = ( (float) chvec[b].at<char>(y,x)   / chvec_max ) * PI2;
-                break;
-              case CV_16U:
-                thetaC = ( (float) chvec[b].at<ushort>(y,x) / chvec_max ) * PI2;
-                break;
-              case CV_16S:
-                thetaC = ( (float) chvec[b].at<short>(y,x)  / chvec_max ) * PI2;
-                break;
-              case CV_32S:
-                thetaC = ( (float) chvec[b].at<int>(y,x)    / chvec_max ) * PI2;
-                break;
-              case CV_32F:
-                thetaC = ( (float) chvec[b].at<float>(y,x)  / chvec_max ) * PI2;
-                break;
-              case CV_64F:
-                thetaC = ( (float) chvec[b].at<double>(y,x) / chvec_max ) * PI2;
-                break;
-              default:
-                CV_Error( Error::StsInternal, "Invalid matrix depth" );
-                break;
-            }
-
-            // we do not store pre-computed C1[b], C2[b]
-            float C1 = (color_coeff * cos(thetaC) / nr_channels);
-            float C2 = (color_coeff * sin(thetaC) / nr_channels);
-
-            tmp_centerC1[b][L] += C1; tmp_centerC2[b][L] += C2;
-
-          }
-          tmp_clusterSize[L]++;
-          tmp_Wsum[L] += W.at<float>(y,x);
-          tmp_kseedsx[L] += x; tmp_kseedsy[L] += y;
+          t = rows[f][x] * w - center[4+f];
+          D += t * t;
         }
-      }
 
-      Wsum = tmp_Wsum;
-      kseedsx = tmp_kseedsx;
-      kseedsy = tmp_kseedsy;
-      clusterSize = tmp_clusterSize;
-      centerX1 = tmp_centerX1; centerX2 = tmp_centerX2;
-      centerY1 = tmp_centerY1; centerY2 = tmp_centerY2;
-      centerC1 = tmp_centerC1; centerC2 = tmp_centerC2;
-    }
-
-    void join( FeatureCenterDists& fcd )
-    {
-      for (int l = 0; l < numlabels; l++)
-      {
-        Wsum[l] += fcd.Wsum[l];
-        kseedsx[l] += fcd.kseedsx[l];
-        kseedsy[l] += fcd.kseedsy[l];
-        centerX1[l] += fcd.centerX1[l];
-        centerX2[l] += fcd.centerX2[l];
-        centerY1[l] += fcd.centerY1[l];
-        centerY2[l] += fcd.centerY2[l];
-        clusterSize[l] += fcd.clusterSize[l];
-        for( int b = 0; b < nr_channels; b++ )
+        // assign label if within D
+        if ( D < d[x] )
         {
-            centerC1[b][l] += fcd.centerC1[b][l];
-            centerC2[b][l] += fcd.centerC2[b][l];
+          d[x] = D;
+          l[x] = label;
         }
       }
     }
 
-    Mat W;
-    float PI2;
-    int numlabels;
-    int nr_channels;
+    Mat* klabels;
+    Mat* dist;
+    const Mat& centers;
+    const vector<Mat>& featc;
+    const Mat& invW;
+    const vector<float>& featx1;
+    const vector<float>& featx2;
+    const vector<float>& featy1;
+    const vector<float>& featy2;
+    const vector<float>& kseedsx;
+    const vector<float>& kseedsy;
     int stepx, stepy;
-
-    float chvec_max;
-    float dist_coeff;
-    float color_coeff;
-
-    Mat klabels;
-    vector<Mat> chvec;
-
-    vector<float> Wsum;
-    vector<int> clusterSize;
-    vector<float> kseedsx, kseedsy;
-    vector<float> centerX1, centerX2;
-    vector<float> centerY1, centerY2;
-    vector< vector<float> > centerC1, centerC2;
-
+    int stripe;
+    int width, height;
 };
 
-struct FeatureNormals : ParallelLoopBody
+/*
+ * Accumulates the unweighted features, W, the position and the size of
+ * each cluster. Each stripe of rows sums into its own row of sums.
+ */
+struct FeatureCenterDists : ParallelLoopBody
 {
-    FeatureNormals( const vector<float>& _Wsum, const vector<int>& _clusterSize,
-                    vector<float>* _kseedsx, vector<float>* _kseedsy,
-                    vector<float>* _centerX1, vector<float>* _centerX2,
-                    vector<float>* _centerY1, vector<float>* _centerY2,
-                    vector< vector<float> >* _centerC1, vector< vector<float> >* _centerC2,
-                    const int _numlabels, const int _nr_channels )
+    FeatureCenterDists( Mat* _sums, const Mat& _klabels, const vector<Mat>& _featc,
+                        const Mat& _W, const vector<float>& _featx1, const vector<float>& _featx2,
+                        const vector<float>& _featy1, const vector<float>& _featy2,
+                        const int _stripe )
+      : sums(_sums), klabels(_klabels), featc(_featc), W(_W),
+        featx1(_featx1), featx2(_featx2), featy1(_featy1), featy2(_featy2), stripe(_stripe)
     {
-      Wsum = _Wsum;
-      numlabels = _numlabels;
-      clusterSize = _clusterSize;
-      nr_channels = _nr_channels;
-
-      kseedsx = _kseedsx; kseedsy = _kseedsy;
-      centerX1 = _centerX1; centerX2 = _centerX2;
-      centerY1 = _centerY1; centerY2 = _centerY2;
-      centerC1 = _centerC1; centerC2 = _centerC2;
     }
 
     void operator()( const Range& range ) const
     {
-      for( int i = range.start; i < range.end; i++ )
+      int nr_feats = (int) featc.size();
+      int nr_sums = 8 + nr_feats;
+
+      for( int s = range.start; s < range.end; s++ )
       {
-        if ( Wsum[i] != 0 )
+        sums->row(s).setTo( Scalar::all(0) );
+        double* sum = sums->ptr<double>(s);
+
+        int maxY = std::min( (s + 1) * stripe, klabels.rows );
+        for( int y = s * stripe; y < maxY; y++ )
         {
-          centerX1->at(i) /= Wsum[i]; centerX2->at(i) /= Wsum[i];
-          centerY1->at(i) /= Wsum[i]; centerY2->at(i) /= Wsum[i];
-          for( int b = 0; b < nr_channels; b++ )
+          const int* l = klabels.ptr<int>(y);
+          const float* w = W.ptr<float>(y);
+          for( int x = 0; x < klabels.cols; x++ )
           {
-            centerC1->at(b)[i] /= Wsum[i]; centerC2->at(b)[i] /= Wsum[i];
+            double* acc = sum + l[x] * nr_sums;
+            acc[0] += featx1[x]; acc[1] += featx2[x];
+            acc[2] += featy1[y]; acc[3] += featy2[y];
+            for( int f = 0; f < nr_feats; f++ )
+              acc[4+f] += featc[f].ptr<float>(y)[x];
+            acc[4+nr_feats] += w[x];
+            acc[5+nr_feats] += x;
+            acc[6+nr_feats] += y;
+            acc[7+nr_feats] += 1;
           }
         }
-        if ( clusterSize[i] != 0 )
-        {
-          kseedsx->at(i) /= clusterSize[i];
-          kseedsy->at(i) /= clusterSize[i];
-        }
       }
     }
 
-    int numlabels;
-    vector<float> Wsum;
-    vector<int> clusterSize;
-    int nr_channels;
-
-    vector<float> *kseedsx, *kseedsy;
-    vector<float> *centerX1, *centerX2;
-    vector<float> *centerY1, *centerY2;
-    vector< vector<float> > *centerC1;
-    vector< vector<float> > *centerC2;
+    Mat* sums;
+    const Mat& klabels;
+    const vector<Mat>& featc;
+    const Mat& W;
+    const vector<float>& featx1;
+    const vector<float>& featx2;
+    const vector<float>& featy1;
+    const vector<float>& featy2;
+    int stripe;
 };
 
 
@@ -1736,29 +1508,30 @@ struct FeatureNormals : ParallelLoopBody
  */
 inline void SuperpixelLSCImpl::PerformLSC( const int&  itrnum )
 {
+    int nr_feats = 2 * m_nr_channels;
+    int nr_sums = 8 + nr_feats;
+
     // allocate initial workspaces
     cv::Mat dist( m_height, m_width, CV_32F );
 
-    vector<float> centerX1( m_numlabels );
-    vector<float> centerX2( m_numlabels );
-    vector<float> centerY1( m_numlabels );
-    vector<float> centerY2( m_numlabels );
-    vector< vector<float> > centerC1( m_nr_channels );
-    vector< vector<float> > centerC2( m_nr_channels );
-    for( int b = 0; b < m_nr_channels; b++ )
-    {
-      centerC1[b].resize( m_numlabels );
-      centerC2[b].resize( m_numlabels );
-    }
-    vector<float> Wsum( m_numlabels );
-    vector<int> clusterSize( m_numlabels );
+    // one row of features per center
+    cv::Mat centers( m_numlabels, 4 + nr_feats, CV_32F );
+
+    // one row of sums per stripe
+    int nr_sum_stripes = std::max( 1, std::min( getNumThreads(), m_height ) );
+    int sum_stripe = (m_height + nr_sum_stripes - 1) / nr_sum_stripes;
+    nr_sum_stripes = (m_height + sum_stripe - 1) / sum_stripe;
+    cv::Mat sums( nr_sum_stripes, m_numlabels * nr_sums, CV_64F );
+    cv::Mat total;
+
+    // stripes of the assignment step
+    int stripe = std::max( 1, m_stepy );
+    int nr_stripes = (m_height + stripe - 1) / stripe;
 
     // compute weighted distance centers
     parallel_for_( Range(0, m_numlabels), FeatureSpaceCenters(
-                   m_chvec, m_W, m_kseedsx, m_kseedsy,
-                   &centerX1, &centerX2, &centerY1, &centerY2,
-                   &centerC1, &centerC2, m_nr_channels, m_chvec_max,
-                   m_dist_coeff, m_color_coeff, m_stepx, m_stepy ) );
+                   &centers, m_featc, m_invW, m_featx1, m_featx2, m_featy1, m_featy2,
+                   m_kseedsx, m_kseedsy, m_stepx, m_stepy ) );
 
     // K-Means
     for( int itr = 0; itr < itrnum; itr++ )
@@ -1767,32 +1540,31 @@ inline void SuperpixelLSCImpl::PerformLSC( const int&  itrnum )
       dist.setTo( FLT_MAX );
 
       // k-mean
-      parallel_for_( Range(0, m_numlabels), FeatureSpaceKmeans(
-                     &m_klabels, &dist, m_chvec, m_W, m_kseedsx, m_kseedsy,
-                     centerX1, centerX2, centerY1, centerY2, centerC1, centerC2,
-                     m_nr_channels, m_chvec_max, m_dist_coeff, m_color_coeff,
-                     m_stepx, m_stepy ) );
-
-      // parallel reduce structure
-      FeatureCenterDists fcd( m_chvec, m_W, m_klabels, m_nr_channels, m_chvec_max,
-                              m_dist_coeff, m_color_coeff, m_stepx, m_stepy, m_numlabels );
+      parallel_for_( Range(0, nr_stripes), FeatureSpaceKmeans(
+                     &m_klabels, &dist, centers, m_featc, m_invW,
+                     m_featx1, m_featx2, m_featy1, m_featy2,
+                     m_kseedsx, m_kseedsy, m_stepx, m_stepy, stripe ) );
 
       // accumulate center distances
-      parallel_reduce( BlockedRange(0, m_width), fcd );
+      parallel_for_( Range(0, nr_sum_stripes), FeatureCenterDists(
+                     &sums, m_klabels, m_featc, m_W,
+                     m_featx1, m_featx2, m_featy1, m_featy2, sum_stripe ) );
+      reduce( sums, total, 0, REDUCE_SUM );
 
-      // featch out the results
-      Wsum = fcd.Wsum; clusterSize = fcd.clusterSize;
-      m_kseedsx = fcd.kseedsx; m_kseedsy = fcd.kseedsy;
-      centerX1 = fcd.centerX1; centerX2 = fcd.centerX2;
-      centerY1 = fcd.centerY1; centerY2 = fcd.centerY2;
-      centerC1 = fcd.centerC1; centerC2 = fcd.centerC2;
+      // normalize accumulated distances
+      const double* sum = total.ptr<double>();
+      for( int i = 0; i < m_numlabels; i++, sum += nr_sums )
+      {
+        float* center = centers.ptr<float>(i);
+        double Wsum = sum[4+nr_feats];
+        double clusterSize = sum[7+nr_feats];
 
+        for( int f = 0; f < 4 + nr_feats; f++ )
+          center[f] = (float)( Wsum != 0 ? sum[f] / Wsum : sum[f] );
 
-      // normalize accumulated distances
-      parallel_for_( Range(0, m_numlabels), FeatureNormals(
-                     Wsum, clusterSize, &m_kseedsx, &m_kseedsy,
-                     &centerX1, &centerX2, &centerY1, &centerY2,
-                     &centerC1, &centerC2, m_numlabels, m_nr_channels ) );
+        m_kseedsx[i] = (float)( clusterSize != 0 ? sum[5+nr_feats] / clusterSize : sum[5+nr_feats] );
+        m_kseedsy[i] = (float)( clusterSize != 0 ? sum[6+nr_feats] / clusterSize : sum[6+nr_feats] );
+      }
     }
 }
 
@@ -1,39 +1,82 @@
+// Every work-group diffuses a TILE x TILE block of the image NITERS times.
+// The block and a halo of NITERS pixels are loaded to local memory once; at
+// iteration t the cells that are at least t pixels away from the halo edge
+// are updated from iteration t-1, so the block itself is exact after NITERS
+// iterations. Neighbours are clamped to the image, which is the replicated
+// border of the previous iterate.
+
+#define TILE 16
+#define LSIZE (TILE + 2*NITERS)
+
 __kernel void anisodiff(__global const uchar * srcptr, int srcstep, int srcoffset,
                         __global uchar * dstptr, int dststep, int dstoffset,
                         int rows, int cols, __constant float* exptab, float alpha)
 {
-    int x = get_global_id(0);
-    int y = get_global_id(1);
+    __local uchar4 buf[2][LSIZE*LSIZE];
+
+    int lx = get_local_id(0), ly = get_local_id(1);
+    int x0 = get_group_id(0)*TILE - NITERS;
+    int y0 = get_group_id(1)*TILE - NITERS;
+
+    for (int i = ly; i < LSIZE; i += TILE)
+        for (int j = lx; j < LSIZE; j += TILE)
+        {
+            int x = x0 + j, y = y0 + i;
+            if (x >= 0 && x < cols && y >= 0 && y < rows)
+            {
+                int ofs = mad24(y, srcstep, mad24(x, 3, srcoffset));
+                buf[0][mad24(i, LSIZE, j)] = (uchar4)(srcptr[ofs], srcptr[ofs+1], srcptr[ofs+2], 0);
+            }
+        }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int t = 1; t <= NITERS; t++)
+    {
+        __local const uchar4* src = buf[(t-1) & 1];
+        __local uchar4* dst = buf[t & 1];
+
+        for (int i = ly + t; i < LSIZE - t; i += TILE)
+            for (int j = lx + t; j < LSIZE - t; j += TILE)
+            {
+                int x = x0 + j, y = y0 + i;
+                if (x < 0 || x >= cols || y < 0 || y >= rows)
+                    continue;
+
+                int jl = x > 0 ? j - 1 : j, jr = x < cols - 1 ? j + 1 : j;
+                int iu = y > 0 ? i - 1 : i, id = y < rows - 1 ? i + 1 : i;
+                float4 c = convert_float4(src[mad24(i, LSIZE, j)]);
+                float4 s = 0.f;
+                float4 delta, adelta;
+                float w;
+
+                #define UPDATE_SUM(ni, nj) \
+                    delta = convert_float4(src[mad24(ni, LSIZE, nj)]) - c; \
+                    adelta = fabs(delta); \
+                    w = exptab[convert_int(adelta.x + adelta.y + adelta.z)]; \
+                    s += delta*w
+
+                UPDATE_SUM(i, jr);
+                UPDATE_SUM(i, jl);
+                UPDATE_SUM(iu, jl);
+                UPDATE_SUM(iu, j);
+                UPDATE_SUM(iu, jr);
+                UPDATE_SUM(id, jl);
+                UPDATE_SUM(id, j);
+                UPDATE_SUM(id, jr);
+
+                s = s*alpha + c;
+                dst[mad24(i, LSIZE, j)] = convert_uchar4_sat(convert_int4_rte(s));
+            }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
 
-    if( x < cols && y < rows )
+    int x = x0 + NITERS + lx, y = y0 + NITERS + ly;
+    if (x < cols && y < rows)
     {
-        int yofs = y*dststep + x*3;
-        int xofs = y*srcstep + x*3;
-        float4 s = 0.f;
-
-        float4 c = (float4)(srcptr[xofs], srcptr[xofs+1], srcptr[xofs+2], 0.f);
-        float4 delta, adelta;
-        float w;
-
-        #define UPDATE_SUM(xofs1) \
-            delta = (float4)(srcptr[xofs + xofs1], srcptr[xofs + xofs1 + 1], srcptr[xofs + xofs1 + 2], 0.f) - c; \
-            adelta = fabs(delta); \
-            w = exptab[convert_int(adelta.x + adelta.y + adelta.z)]; \
-            s += delta*w
-
-        UPDATE_SUM(3);
-        UPDATE_SUM(-3);
-        UPDATE_SUM(-srcstep-3);
-        UPDATE_SUM(-srcstep);
-        UPDATE_SUM(-srcstep+3);
-        UPDATE_SUM(srcstep-3);
-        UPDATE_SUM(srcstep);
-        UPDATE_SUM(srcstep+3);
-
-        s = s*alpha + c;
-        uchar4 d = convert_uchar4_sat(convert_int4_rte(s));
-        dstptr[yofs] = d.x;
-        dstptr[yofs+1] = d.y;
-        dstptr[yofs+2] = d.z;
+        uchar4 d = buf[NITERS & 1][mad24(NITERS + ly, LSIZE, NITERS + lx)];
+        int ofs = mad24(y, dststep, mad24(x, 3, dstoffset));
+        dstptr[ofs] = d.x;
+        dstptr[ofs+1] = d.y;
+        dstptr[ofs+2] = d.z;
     }
 }
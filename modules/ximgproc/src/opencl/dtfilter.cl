@@ -0,0 +1,148 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+// Domain transform filter, "cn" is the number of channels of the float images.
+// Recursive passes process a whole row (column) by one work item, so neighbouring
+// work items of the vertical pass access neighbouring memory.
+
+__kernel void dtf_rf_hor(__global uchar * resptr, int resstep, int resoffset, int rows, int cols,
+                         __global uchar * adptr, int adstep, int adoffset, int iteration)
+{
+    int i = get_global_id(0);
+
+    if (i < rows)
+    {
+        __global float * res = (__global float *)(resptr + mad24(i, resstep, resoffset));
+        __global float * ad = (__global float *)(adptr + mad24(i, adstep, adoffset));
+        int j, c;
+
+        if (iteration > 1)
+        {
+            for (j = cols - 2; j >= 0; j--)
+                ad[j] *= ad[j];
+        }
+
+        for (j = 1; j < cols; j++)
+        {
+            float a = ad[j - 1];
+            for (c = 0; c < cn; c++)
+                res[j*cn + c] += a * (res[(j - 1)*cn + c] - res[j*cn + c]);
+        }
+
+        for (j = cols - 2; j >= 0; j--)
+        {
+            float a = ad[j];
+            for (c = 0; c < cn; c++)
+                res[j*cn + c] += a * (res[(j + 1)*cn + c] - res[j*cn + c]);
+        }
+    }
+}
+
+__kernel void dtf_rf_vert(__global uchar * resptr, int resstep, int resoffset, int rows, int cols,
+                          __global uchar * adptr, int adstep, int adoffset, int iteration)
+{
+    int j = get_global_id(0);
+
+    if (j < cols)
+    {
+        int resofs = mad24(j, cn*(int)sizeof(float), resoffset);
+        int adofs = mad24(j, (int)sizeof(float), adoffset);
+        int i, c;
+
+        for (i = 1; i < rows; i++)
+        {
+            __global float * cur = (__global float *)(resptr + mad24(i, resstep, resofs));
+            __global const float * prev = (__global const float *)(resptr + mad24(i - 1, resstep, resofs));
+            __global float * ad = (__global float *)(adptr + mad24(i - 1, adstep, adofs));
+
+            float a = ad[0];
+            if (iteration > 1)
+            {
+                a *= a;
+                ad[0] = a;
+            }
+            for (c = 0; c < cn; c++)
+                cur[c] += a * (prev[c] - cur[c]);
+        }
+
+        for (i = rows - 2; i >= 0; i--)
+        {
+            __global float * cur = (__global float *)(resptr + mad24(i, resstep, resofs));
+            __global const float * next = (__global const float *)(resptr + mad24(i + 1, resstep, resofs));
+            float a = *(__global const float *)(adptr + mad24(i, adstep, adofs));
+
+            for (c = 0; c < cn; c++)
+                cur[c] += a * (next[c] - cur[c]);
+        }
+    }
+}
+
+// isrc is the integral of the rows of src, (cols + 1) elements per row
+__kernel void dtf_nc_integrate(__global const uchar * srcptr, int srcstep, int srcoffset, int rows, int cols,
+                               __global uchar * isrcptr, int isrcstep, int isrcoffset)
+{
+    int i = get_global_id(0);
+
+    if (i < rows)
+    {
+        __global const float * src = (__global const float *)(srcptr + mad24(i, srcstep, srcoffset));
+        __global float * isrc = (__global float *)(isrcptr + mad24(i, isrcstep, isrcoffset));
+        float sum[cn];
+        int j, c;
+
+        for (c = 0; c < cn; c++)
+        {
+            sum[c] = 0.f;
+            isrc[c] = 0.f;
+        }
+
+        for (j = 0; j < cols; j++)
+        {
+            for (c = 0; c < cn; c++)
+            {
+                sum[c] += src[j*cn + c];
+                isrc[(j + 1)*cn + c] = sum[c];
+            }
+        }
+    }
+}
+
+// first index in [lo, hi] such that v[index] >= value, v[hi] >= value must hold
+inline int dtf_lower_bound(__global const float * v, int lo, int hi, float value)
+{
+    while (lo < hi)
+    {
+        int mid = (lo + hi) >> 1;
+        if (v[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// box filter in the transformed domain, the result is written transposed
+__kernel void dtf_nc_pass(__global const uchar * isrcptr, int isrcstep, int isrcoffset,
+                          __global const uchar * idistptr, int idiststep, int idistoffset,
+                          __global uchar * dstptr, int dststep, int dstoffset,
+                          int rows, int cols, float radius)
+{
+    int j = get_global_id(0);
+    int i = get_global_id(1);
+
+    if (j < cols && i < rows)
+    {
+        __global const float * isrc = (__global const float *)(isrcptr + mad24(i, isrcstep, isrcoffset));
+        __global const float * idist = (__global const float *)(idistptr + mad24(i, idiststep, idistoffset));
+        __global float * dst = (__global float *)(dstptr + mad24(j, dststep, mad24(i, cn*(int)sizeof(float), dstoffset)));
+
+        float curVal = idist[j];
+        int leftBound = dtf_lower_bound(idist, 0, j, curVal - radius);
+        int rightBound = dtf_lower_bound(idist, j + 1, cols, curVal + radius) - 1;
+        float scale = 1.f / (float)(rightBound + 1 - leftBound);
+
+        for (int c = 0; c < cn; c++)
+            dst[c] = (isrc[(rightBound + 1)*cn + c] - isrc[leftBound*cn + c]) * scale;
+    }
+}
@@ -0,0 +1,93 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+// Fast global smoother: the tridiagonal systems of the rows (columns) are solved
+// in parallel by the Thomas algorithm, one system per work item. All "cn" channels
+// share the weights, so they are solved together.
+
+__kernel void fgs_hor(__global uchar * curptr, int curstep, int curoffset, int rows, int cols,
+                      __global const uchar * cptr, int cstep, int coffset,
+                      __global uchar * dptr, int dstep, int doffset, float lambda)
+{
+    int i = get_global_id(0);
+
+    if (i < rows)
+    {
+        __global float * cur = (__global float *)(curptr + mad24(i, curstep, curoffset));
+        __global const float * C = (__global const float *)(cptr + mad24(i, cstep, coffset));
+        __global float * interD = (__global float *)(dptr + mad24(i, dstep, doffset));
+        int j, c;
+
+        //forward pass:
+        float coef_prev = lambda*C[0];
+        interD[0] = coef_prev/(1 - coef_prev);
+        for (c = 0; c < cn; c++)
+            cur[c] = cur[c]/(1 - coef_prev);
+
+        for (j = 1; j < cols; j++)
+        {
+            float coef_cur = lambda*C[j];
+            float denom = (1 - coef_prev - coef_cur) - interD[j - 1]*coef_prev;
+            interD[j] = coef_cur/denom;
+            for (c = 0; c < cn; c++)
+                cur[j*cn + c] = (cur[j*cn + c] - cur[(j - 1)*cn + c]*coef_prev)/denom;
+            coef_prev = coef_cur;
+        }
+
+        //backward pass:
+        for (j = cols - 2; j >= 0; j--)
+        {
+            for (c = 0; c < cn; c++)
+                cur[j*cn + c] = cur[j*cn + c] - interD[j]*cur[(j + 1)*cn + c];
+        }
+    }
+}
+
+__kernel void fgs_vert(__global uchar * curptr, int curstep, int curoffset, int rows, int cols,
+                       __global const uchar * cptr, int cstep, int coffset,
+                       __global uchar * dptr, int dstep, int doffset, float lambda)
+{
+    int j = get_global_id(0);
+
+    if (j < cols)
+    {
+        int curofs = mad24(j, cn*(int)sizeof(float), curoffset);
+        int cofs = mad24(j, (int)sizeof(float), coffset);
+        int dofs = mad24(j, (int)sizeof(float), doffset);
+        int i, c;
+
+        //forward pass:
+        __global float * cur = (__global float *)(curptr + curofs);
+        float coef_prev = lambda * *(__global const float *)(cptr + cofs);
+        float interD_prev = coef_prev/(1 - coef_prev);
+        *(__global float *)(dptr + dofs) = interD_prev;
+        for (c = 0; c < cn; c++)
+            cur[c] = cur[c]/(1 - coef_prev);
+
+        for (i = 1; i < rows; i++)
+        {
+            __global const float * prev = cur;
+            cur = (__global float *)(curptr + mad24(i, curstep, curofs));
+
+            float coef_cur = lambda * *(__global const float *)(cptr + mad24(i, cstep, cofs));
+            float denom = (1 - coef_prev - coef_cur) - interD_prev*coef_prev;
+            interD_prev = coef_cur/denom;
+            *(__global float *)(dptr + mad24(i, dstep, dofs)) = interD_prev;
+            for (c = 0; c < cn; c++)
+                cur[c] = (cur[c] - prev[c]*coef_prev)/denom;
+            coef_prev = coef_cur;
+        }
+
+        //backward pass:
+        for (i = rows - 2; i >= 0; i--)
+        {
+            __global const float * next = cur;
+            cur = (__global float *)(curptr + mad24(i, curstep, curofs));
+
+            float interD = *(__global const float *)(dptr + mad24(i, dstep, dofs));
+            for (c = 0; c < cn; c++)
+                cur[c] = cur[c] - interD*next[c];
+        }
+    }
+}
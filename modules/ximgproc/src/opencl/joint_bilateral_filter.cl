@@ -0,0 +1,93 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+// Exact joint bilateral filter, one pixel per work item. The neighbours of the
+// disk-shaped kernel are given by "spaceOfs" (dx, dy pairs) with their spatial
+// weights; pixels outside the image are taken from the border extrapolation
+// instead of a padded copy. The color weight depends on the L1 distance of the
+// joint pixels: 8-bit images look it up in "expLUT", floating-point images
+// evaluate the Gaussian with "colorCoeff".
+
+#if defined BORDER_REPLICATE
+#define EXTRAPOLATE(p, len) clamp(p, 0, (len) - 1)
+#elif defined BORDER_REFLECT
+#define EXTRAPOLATE(p, len) ((p) < 0 ? -(p) - 1 : (p) >= (len) ? 2*(len) - (p) - 1 : (p))
+#elif defined BORDER_REFLECT_101
+#define EXTRAPOLATE(p, len) ((p) < 0 ? -(p) : (p) >= (len) ? 2*(len) - (p) - 2 : (p))
+#elif defined BORDER_WRAP
+#define EXTRAPOLATE(p, len) ((p) < 0 ? (p) + (len) : (p) >= (len) ? (p) - (len) : (p))
+#endif
+
+#if jcn == 3
+#define LOAD_JOINT(p) convert_float3(vload3(0, p))
+#define JOINT_DIST(a, b) (fabs((a).x - (b).x) + fabs((a).y - (b).y) + fabs((a).z - (b).z))
+typedef float3 jointT;
+#else
+#define LOAD_JOINT(p) convert_float(*(p))
+#define JOINT_DIST(a, b) fabs((a) - (b))
+typedef float jointT;
+#endif
+
+#if scn == 3
+#define LOAD_SRC(p) convert_float3(vload3(0, p))
+typedef float3 srcT;
+#else
+#define LOAD_SRC(p) convert_float(*(p))
+typedef float srcT;
+#endif
+
+__kernel void joint_bilateral(__global const uchar * jointptr, int jointstep, int jointoffset,
+                              __global const uchar * srcptr, int srcstep, int srcoffset,
+                              __global uchar * dstptr, int dststep, int dstoffset, int rows, int cols,
+                              __global const int * spaceOfs, __global const float * spaceWeights, int maxk,
+                              __global const float * expLUT, float colorCoeff, int radius)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
+    if (x < cols && y < rows)
+    {
+        bool inner = x >= radius && x < cols - radius && y >= radius && y < rows - radius;
+        jointT jointPix0 = LOAD_JOINT((__global const T *)(jointptr + mad24(y, jointstep, jointoffset)) + x*jcn);
+        srcT srcSum = (srcT)(0.f);
+        float wSum = 0.f;
+
+        for (int k = 0; k < maxk; k++)
+        {
+            int xk = x + spaceOfs[2*k], yk = y + spaceOfs[2*k + 1];
+            if (!inner)
+            {
+                xk = EXTRAPOLATE(xk, cols);
+                yk = EXTRAPOLATE(yk, rows);
+            }
+
+            jointT jointPix = LOAD_JOINT((__global const T *)(jointptr + mad24(yk, jointstep, jointoffset)) + xk*jcn);
+            float alpha = JOINT_DIST(jointPix0, jointPix);
+#ifdef DEPTH_8U
+            float weight = spaceWeights[k] * expLUT[convert_int(alpha)];
+#else
+            float weight = spaceWeights[k] * exp(alpha*alpha*colorCoeff);
+#endif
+
+            srcSum += weight * LOAD_SRC((__global const T *)(srcptr + mad24(yk, srcstep, srcoffset)) + xk*scn);
+            wSum += weight;
+        }
+
+        __global T * dst = (__global T *)(dstptr + mad24(y, dststep, dstoffset)) + x*scn;
+        srcT res = srcSum / wSum;
+#ifdef DEPTH_8U
+#if scn == 3
+        vstore3(convert_uchar3_sat_rte(res), 0, dst);
+#else
+        *dst = convert_uchar_sat_rte(res);
+#endif
+#else
+#if scn == 3
+        vstore3(res, 0, dst);
+#else
+        *dst = res;
+#endif
+#endif
+    }
+}
@@ -0,0 +1,219 @@
+/*
+ *  By downloading, copying, installing or using the software you agree to this license.
+ *  If you do not agree to this license, do not download, install,
+ *  copy or use the software.
+ *
+ *
+ *  License Agreement
+ *  For Open Source Computer Vision Library
+ *  (3 - clause BSD License)
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met :
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and / or other materials provided with the distribution.
+ *
+ *  * Neither the names of the copyright holders nor the names of the contributors
+ *  may be used to endorse or promote products derived from this software
+ *  without specific prior written permission.
+ *
+ *  This software is provided by the copyright holders and contributors "as is" and
+ *  any express or implied warranties, including, but not limited to, the implied
+ *  warranties of merchantability and fitness for a particular purpose are disclaimed.
+ *  In no event shall copyright holders or contributors be liable for any direct,
+ *  indirect, incidental, special, exemplary, or consequential damages
+ *  (including, but not limited to, procurement of substitute goods or services;
+ *  loss of use, data, or profits; or business interruption) however caused
+ *  and on any theory of liability, whether in contract, strict liability,
+ *  or tort(including negligence or otherwise) arising in any way out of
+ *  the use of this software, even if advised of the possibility of such damage.
+ */
+#include "precomp.hpp"
+#include "recursive_filter.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+namespace cv {
+namespace ximgproc {
+
+// filters n samples spaced by step; buf receives the causal pass, the result is written back in place
+static void recursiveFilterLine(float* data, size_t step, int n, const RecursiveFilterCoeffs& c, float* buf)
+{
+    float x = data[0], xp = x;
+    float p1 = c.i0*x, p2 = c.i1*x;
+    buf[0] = p1;
+    for (int k = 1; k < n; k++)
+    {
+        x = data[k*step];
+        float p = c.a0*x + c.a1*xp + c.b1*p1 + c.b2*p2;
+        buf[k] = p;
+        p2 = p1; p1 = p; xp = x;
+    }
+
+    float* row = data + (n - 1)*step;
+    float xa = row[0], xb = c.xr*xa;
+    float m1 = c.j0*xa, m2 = c.j1*xa;
+    row[0] = c.cp*buf[n - 1] + c.cm*m1;
+    for (int k = n - 2; k >= 0; k--)
+    {
+        row = data + k*step;
+        x = row[0];
+        float m = c.a2*x + c.a3*xa + c.a4*xb + c.b1*m1 + c.b2*m2;
+        row[0] = c.cp*buf[k] + c.cm*m;
+        m2 = m1; m1 = m; xb = xa; xa = x;
+    }
+}
+
+#if CV_SIMD128
+// the same as recursiveFilterLine on 8 adjacent columns, buf holds 8*n floats
+static void recursiveFilterLines8(float* data, size_t step, int n, const RecursiveFilterCoeffs& c, float* buf)
+{
+    v_float32x4 a0 = v_setall_f32(c.a0), a1 = v_setall_f32(c.a1), a2 = v_setall_f32(c.a2);
+    v_float32x4 a3 = v_setall_f32(c.a3), a4 = v_setall_f32(c.a4);
+    v_float32x4 b1 = v_setall_f32(c.b1), b2 = v_setall_f32(c.b2);
+    v_float32x4 cp = v_setall_f32(c.cp), cm = v_setall_f32(c.cm);
+
+    v_float32x4 x0 = v_load(data), x1 = v_load(data + 4), xp0 = x0, xp1 = x1;
+    v_float32x4 p10 = x0*v_setall_f32(c.i0), p11 = x1*v_setall_f32(c.i0);
+    v_float32x4 p20 = x0*v_setall_f32(c.i1), p21 = x1*v_setall_f32(c.i1);
+    v_store(buf, p10);
+    v_store(buf + 4, p11);
+    for (int k = 1; k < n; k++)
+    {
+        const float* row = data + k*step;
+        x0 = v_load(row);
+        x1 = v_load(row + 4);
+        v_float32x4 p0 = a0*x0 + a1*xp0 + b1*p10 + b2*p20;
+        v_float32x4 p1 = a0*x1 + a1*xp1 + b1*p11 + b2*p21;
+        v_store(buf + k*8, p0);
+        v_store(buf + k*8 + 4, p1);
+        p20 = p10; p21 = p11; p10 = p0; p11 = p1; xp0 = x0; xp1 = x1;
+    }
+
+    float* row = data + (n - 1)*step;
+    v_float32x4 xa0 = v_load(row), xa1 = v_load(row + 4);
+    v_float32x4 xb0 = xa0*v_setall_f32(c.xr), xb1 = xa1*v_setall_f32(c.xr);
+    v_float32x4 m10 = xa0*v_setall_f32(c.j0), m11 = xa1*v_setall_f32(c.j0);
+    v_float32x4 m20 = xa0*v_setall_f32(c.j1), m21 = xa1*v_setall_f32(c.j1);
+    v_store(row, cp*v_load(buf + (n - 1)*8) + cm*m10);
+    v_store(row + 4, cp*v_load(buf + (n - 1)*8 + 4) + cm*m11);
+    for (int k = n - 2; k >= 0; k--)
+    {
+        row = data + k*step;
+        x0 = v_load(row);
+        x1 = v_load(row + 4);
+        v_float32x4 m0 = a2*x0 + a3*xa0 + a4*xb0 + b1*m10 + b2*m20;
+        v_float32x4 m1 = a2*x1 + a3*xa1 + a4*xb1 + b1*m11 + b2*m21;
+        v_store(row, cp*v_load(buf + k*8) + cm*m0);
+        v_store(row + 4, cp*v_load(buf + k*8 + 4) + cm*m1);
+        m20 = m10; m21 = m11; m10 = m0; m11 = m1; xb0 = xa0; xb1 = xa1; xa0 = x0; xa1 = x1;
+    }
+}
+
+// copies a 4x4 block from src to dst transposed
+static inline void transpose4x4(const float* src, size_t sstep, float* dst, size_t dstep)
+{
+    v_float32x4 r0 = v_load(src), r1 = v_load(src + sstep), r2 = v_load(src + 2*sstep), r3 = v_load(src + 3*sstep);
+    v_float32x4 t0, t1, t2, t3;
+    v_transpose4x4(r0, r1, r2, r3, t0, t1, t2, t3);
+    v_store(dst, t0);
+    v_store(dst + dstep, t1);
+    v_store(dst + 2*dstep, t2);
+    v_store(dst + 3*dstep, t3);
+}
+#endif
+
+class RecursiveFilterColsInvoker : public ParallelLoopBody
+{
+public:
+    RecursiveFilterColsInvoker(Mat& _img, const RecursiveFilterCoeffs& _c) : img(_img), c(_c) {}
+
+    void operator()(const Range& range) const
+    {
+        int rows = img.rows, x = range.start*8, xend = std::min(range.end*8, img.cols);
+        size_t step = img.step1();
+        AutoBuffer<float> buf(rows*8);
+
+#if CV_SIMD128
+        for (; x <= xend - 8; x += 8)
+            recursiveFilterLines8(img.ptr<float>() + x, step, rows, c, buf);
+#endif
+        for (; x < xend; x++)
+            recursiveFilterLine(img.ptr<float>() + x, step, rows, c, buf);
+    }
+
+private:
+    Mat& img;
+    RecursiveFilterCoeffs c;
+};
+
+class RecursiveFilterRowsInvoker : public ParallelLoopBody
+{
+public:
+    RecursiveFilterRowsInvoker(Mat& _img, const RecursiveFilterCoeffs& _c) : img(_img), c(_c) {}
+
+    void operator()(const Range& range) const
+    {
+        int cols = img.cols, y = range.start*8, yend = std::min(range.end*8, img.rows);
+        size_t step = img.step1();
+        AutoBuffer<float> buf(cols*8);
+
+#if CV_SIMD128
+        // the rows of a block are transposed into columns of tbuf, filtered as columns and transposed back
+        AutoBuffer<float> tbuf(cols*8);
+        for (; y <= yend - 8; y += 8)
+        {
+            float* block = img.ptr<float>(y);
+            int x = 0;
+            for (; x <= cols - 4; x += 4)
+            {
+                transpose4x4(block + x, step, tbuf + x*8, 8);
+                transpose4x4(block + 4*step + x, step, tbuf + x*8 + 4, 8);
+            }
+            for (; x < cols; x++)
+                for (int k = 0; k < 8; k++)
+                    tbuf[x*8 + k] = block[k*step + x];
+
+            recursiveFilterLines8(tbuf, 8, cols, c, buf);
+
+            for (x = 0; x <= cols - 4; x += 4)
+            {
+                transpose4x4(tbuf + x*8, 8, block + x, step);
+                transpose4x4(tbuf + x*8 + 4, 8, block + 4*step + x, step);
+            }
+            for (; x < cols; x++)
+                for (int k = 0; k < 8; k++)
+                    block[k*step + x] = tbuf[x*8 + k];
+        }
+#endif
+        for (; y < yend; y++)
+            recursiveFilterLine(img.ptr<float>(y), 1, cols, c, buf);
+    }
+
+private:
+    Mat& img;
+    RecursiveFilterCoeffs c;
+};
+
+void recursiveFilterCols(Mat& img, const RecursiveFilterCoeffs& c)
+{
+    CV_Assert(img.type() == CV_32FC1);
+    if (img.empty())
+        return;
+    parallel_for_(Range(0, (img.cols + 7)/8), RecursiveFilterColsInvoker(img, c));
+}
+
+void recursiveFilterRows(Mat& img, const RecursiveFilterCoeffs& c)
+{
+    CV_Assert(img.type() == CV_32FC1);
+    if (img.empty())
+        return;
+    parallel_for_(Range(0, (img.rows + 7)/8), RecursiveFilterRowsInvoker(img, c));
+}
+
+}
+}
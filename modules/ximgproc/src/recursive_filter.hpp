@@ -0,0 +1,69 @@
+/*
+ *  By downloading, copying, installing or using the software you agree to this license.
+ *  If you do not agree to this license, do not download, install,
+ *  copy or use the software.
+ *
+ *
+ *  License Agreement
+ *  For Open Source Computer Vision Library
+ *  (3 - clause BSD License)
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met :
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and / or other materials provided with the distribution.
+ *
+ *  * Neither the names of the copyright holders nor the names of the contributors
+ *  may be used to endorse or promote products derived from this software
+ *  without specific prior written permission.
+ *
+ *  This software is provided by the copyright holders and contributors "as is" and
+ *  any express or implied warranties, including, but not limited to, the implied
+ *  warranties of merchantability and fitness for a particular purpose are disclaimed.
+ *  In no event shall copyright holders or contributors be liable for any direct,
+ *  indirect, incidental, special, exemplary, or consequential damages
+ *  (including, but not limited to, procurement of substitute goods or services;
+ *  loss of use, data, or profits; or business interruption) however caused
+ *  and on any theory of liability, whether in contract, strict liability,
+ *  or tort(including negligence or otherwise) arising in any way out of
+ *  the use of this software, even if advised of the possibility of such damage.
+ */
+
+#ifndef __RECURSIVE_FILTER_HPP__
+#define __RECURSIVE_FILTER_HPP__
+#ifdef __cplusplus
+
+namespace cv
+{
+namespace ximgproc
+{
+
+/* Second order recursive filter made of a causal and an anticausal pass:
+     p[n] = a0*x[n] + a1*x[n-1] + b1*p[n-1] + b2*p[n-2]
+     m[n] = a2*x[n] + a3*x[n+1] + a4*x[n+2] + b1*m[n+1] + b2*m[n+2]
+     y[n] = cp*p[n] + cm*m[n]
+ The passes start with p[0] = i0*x[0], p[-1] = i1*x[0] and m[N-1] = j0*x[N-1], m[N] = j1*x[N-1], x[N] = xr*x[N-1]. */
+struct RecursiveFilterCoeffs
+{
+    float a0, a1, a2, a3, a4;
+    float b1, b2;
+    float i0, i1, j0, j1, xr;
+    float cp, cm;
+};
+
+/* Filters every column of a CV_32FC1 image in place, 8 columns at a time. */
+void recursiveFilterCols(Mat& img, const RecursiveFilterCoeffs& c);
+
+/* Filters every row of a CV_32FC1 image in place, 8 rows at a time through blocked transposes. */
+void recursiveFilterRows(Mat& img, const RecursiveFilterCoeffs& c);
+
+}
+}
+
+#endif
+#endif
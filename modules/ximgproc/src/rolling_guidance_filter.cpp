@@ -41,11 +41,38 @@ namespace cv
 {
 namespace ximgproc
 {
+#ifdef HAVE_OPENCL
+    static bool ocl_rollingGuidanceFilter(InputArray src_, OutputArray dst_, int d,
+                                          double sigmaColor, double sigmaSpace, int numOfIter, int borderType)
+    {
+        int depth = src_.depth(), cn = src_.channels();
+        if ((depth != CV_8U && depth != CV_32F) || (cn != 1 && cn != 3))
+            return false;
+
+        UMat src = src_.getUMat();
+
+        // the guidance stays on the device, ping-ponging between two buffers;
+        // the first one is a copy so that the joint filter is not turned into bilateralFilter
+        UMat guidance[2];
+        src.copyTo(guidance[0]);
+        int cur = 0;
+        for (int i = 0; i < numOfIter; i++, cur ^= 1)
+        {
+            jointBilateralFilter(guidance[cur], src, guidance[cur ^ 1], d, sigmaColor, sigmaSpace, borderType);
+        }
+        guidance[cur].copyTo(dst_);
+        return true;
+    }
+#endif
+
     void rollingGuidanceFilter(InputArray src_, OutputArray dst_, int d,
                                double sigmaColor, double sigmaSpace,  int numOfIter, int borderType)
     {
         CV_Assert(!src_.empty());
 
+        CV_OCL_RUN(dst_.isUMat(),
+                   ocl_rollingGuidanceFilter(src_, dst_, d, sigmaColor, sigmaSpace, numOfIter, borderType))
+
         Mat guidance = src_.getMat();
         Mat src = src_.getMat();
 
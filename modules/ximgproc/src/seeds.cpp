@@ -52,6 +52,7 @@
 #include <algorithm>
 #include <vector>
 #include <cstdlib>
+#include "opencv2/core/hal/intrin.hpp"
 using namespace std;
 
 
@@ -61,6 +62,9 @@ using namespace std;
 
 #define MINIMUM_NR_SUBLABELS 1
 
+// side of the tiles of parallel block updates, in top level superpixels
+#define TILE_NR_SUPERPIXELS 2
+
 
 // the type of the histogram and the T array
 typedef float HISTN;
@@ -123,6 +127,23 @@ private:
     //main loop for block updates
     void updateBlocks(int level, float req_confidence = 0.0f);
 
+    // try to move the block (x,y) or its right/lower neighbour to the other superpixel,
+    // returns true if the neighbour was moved
+    bool updateBlockHorizontal(int level, int x, int y, float req_confidence);
+    bool updateBlockVertical(int level, int x, int y, float req_confidence);
+
+    // update the blocks of one tile, pairs of superpixels not owned by the tile are deferred
+    void updateBlocksTile(int level, int tile, bool horizontal, float req_confidence,
+            vector<Point>& deferred);
+    friend class BlockUpdateInvoker;
+
+    // tile owning a top level label
+    inline int homeTile(int label) const {
+        int nr_w_top = nr_wh[2 * seeds_top_level];
+        return ((label / nr_w_top) / TILE_NR_SUPERPIXELS) * nr_tiles_w
+                + (label % nr_w_top) / TILE_NR_SUPERPIXELS;
+    }
+
     /* go to next block level */
     int goDownOneLevel();
 
@@ -167,6 +188,8 @@ private:
     int* labels; //output labels: labels of level==seeds_top_level
     unsigned int* nr_partitions; //[label] how many partitions label has on toplevel
 
+    int nr_tiles_w, nr_tiles_h; //tiles of parallel block updates
+
     int histogram_size; //== pow(nr_bins, nr_channels)
     int histogram_size_aligned;
     vector<HISTN*> histogram; //[level][label * histogram_size_aligned + j]
@@ -303,6 +326,8 @@ void SuperpixelSEEDSImpl::initialize(int num_superpixels, int num_levels)
     }
     nr_partitions_mat = Mat(nr_wh[2 * seeds_top_level + 1],
             nr_wh[2 * seeds_top_level], CV_32SC1);
+    nr_tiles_w = (nr_wh[2 * seeds_top_level] + TILE_NR_SUPERPIXELS - 1) / TILE_NR_SUPERPIXELS;
+    nr_tiles_h = (nr_wh[2 * seeds_top_level + 1] + TILE_NR_SUPERPIXELS - 1) / TILE_NR_SUPERPIXELS;
     nr_partitions = (unsigned int*)nr_partitions_mat.data;
 
     //preinit the labels (these are not changed anymore later)
@@ -471,138 +496,252 @@ void SuperpixelSEEDSImpl::computeHistograms(int until_level)
     }
 }
 
+/* Updates the blocks of the tiles of one color in parallel.
+ *
+ * The block grid is split in tiles of TILE_NR_SUPERPIXELS x TILE_NR_SUPERPIXELS
+ * top level superpixels, colored like a checkerboard with 4 colors. A tile only
+ * moves blocks between superpixels whose grid position lies inside of it, so
+ * tiles of the same color never modify the same histograms, and they are far
+ * enough apart not to read blocks modified by each other. */
+class BlockUpdateInvoker : public ParallelLoopBody
+{
+public:
+    BlockUpdateInvoker(SuperpixelSEEDSImpl* _seeds, int _level, bool _horizontal,
+            float _req_confidence, const vector<int>& _tiles, vector<vector<Point> >& _deferred)
+        : seeds(_seeds), level(_level), horizontal(_horizontal),
+          req_confidence(_req_confidence), tiles(_tiles), deferred(_deferred)
+    {
+    }
+
+    virtual void operator()(const Range& range) const
+    {
+        for (int i = range.start; i < range.end; i++)
+            seeds->updateBlocksTile(level, tiles[i], horizontal, req_confidence, deferred[tiles[i]]);
+    }
+
+private:
+    SuperpixelSEEDSImpl* seeds;
+    int level;
+    bool horizontal;
+    float req_confidence;
+    const vector<int>& tiles;
+    vector<vector<Point> >& deferred;
+};
+
 void SuperpixelSEEDSImpl::updateBlocks(int level, float req_confidence)
 {
-    int labelA;
-    int labelB;
-    int sublabel;
-    bool done;
+    vector<vector<Point> > deferred(nr_tiles_w * nr_tiles_h);
+    vector<int> tiles;
+
+    // horizontal bidirectional block updating, then vertical bidirectional
+    for (int direction = 0; direction < 2; direction++)
+    {
+        bool horizontal = direction == 0;
+
+        for (int color = 0; color < 4; color++)
+        {
+            tiles.clear();
+            for (int ty = color / 2; ty < nr_tiles_h; ty += 2)
+                for (int tx = color % 2; tx < nr_tiles_w; tx += 2)
+                    tiles.push_back(ty * nr_tiles_w + tx);
+
+            parallel_for_(Range(0, (int)tiles.size()),
+                    BlockUpdateInvoker(this, level, horizontal, req_confidence, tiles, deferred));
+        }
+
+        // blocks between superpixels of different tiles
+        for (size_t t = 0; t < deferred.size(); t++)
+        {
+            for (size_t i = 0; i < deferred[t].size(); i++)
+            {
+                const Point& pt = deferred[t][i];
+                if( horizontal )
+                    updateBlockHorizontal(level, pt.x, pt.y, req_confidence);
+                else
+                    updateBlockVertical(level, pt.x, pt.y, req_confidence);
+            }
+            deferred[t].clear();
+        }
+    }
+}
+
+void SuperpixelSEEDSImpl::updateBlocksTile(int level, int tile, bool horizontal,
+        float req_confidence, vector<Point>& deferred)
+{
     int step = nr_wh[2 * level];
+    int tile_blocks = TILE_NR_SUPERPIXELS << (seeds_top_level - level);
+    int tx = tile % nr_tiles_w;
+    int ty = tile / nr_tiles_w;
 
-    // horizontal bidirectional block updating
-    for (int y = 1; y < nr_wh[2 * level + 1] - 1; y++)
+    // the last tiles also hold the blocks left over by the superpixel grid
+    int x_begin = std::max(tx * tile_blocks, 1);
+    int y_begin = std::max(ty * tile_blocks, 1);
+    int x_end = tx == nr_tiles_w - 1 ? nr_wh[2 * level] : (tx + 1) * tile_blocks;
+    int y_end = ty == nr_tiles_h - 1 ? nr_wh[2 * level + 1] : (ty + 1) * tile_blocks;
+
+    if( horizontal )
     {
-        for (int x = 1; x < nr_wh[2 * level] - 2; x++)
+        x_end = std::min(x_end, nr_wh[2 * level] - 2);
+        y_end = std::min(y_end, nr_wh[2 * level + 1] - 1);
+
+        for (int y = y_begin; y < y_end; y++)
         {
-            // choose a label at the current level
-            sublabel = y * step + x;
-            // get the label at the top level (= superpixel label)
-            labelA = parent[level][y * step + x];
-            // get the neighboring label at the top level (= superpixel label)
-            labelB = parent[level][y * step + x + 1];
-
-            if( labelA == labelB )
-                continue;
-
-            // get the surrounding labels at the top level, to check for splitting
-            int a11 = parent[level][(y - 1) * step + (x - 1)];
-            int a12 = parent[level][(y - 1) * step + (x)];
-            int a21 = parent[level][(y) * step + (x - 1)];
-            int a22 = parent[level][(y) * step + (x)];
-            int a31 = parent[level][(y + 1) * step + (x - 1)];
-            int a32 = parent[level][(y + 1) * step + (x)];
-            done = false;
-
-            if( nr_partitions[labelA] == 2 || (nr_partitions[labelA] > 2 // 3 or more partitions
-                    && checkSplit_hf(a11, a12, a21, a22, a31, a32)) )
+            for (int x = x_begin; x < x_end; x++)
             {
-                // run algorithm as usual
-                float conf = intersectConf(seeds_top_level, labelB, labelA, level, sublabel);
-                if( conf > req_confidence )
-                {
-                    deleteBlockToplevel(labelA, level, sublabel);
-                    addBlockToplevel(labelB, level, sublabel);
-                    done = true;
-                }
+                int labelA = parent[level][y * step + x];
+                int labelB = parent[level][y * step + x + 1];
+
+                if( labelA == labelB )
+                    continue;
+
+                if( homeTile(labelA) != tile || homeTile(labelB) != tile )
+                    deferred.push_back(Point(x, y));
+                else if( updateBlockHorizontal(level, x, y, req_confidence) )
+                    x++;
             }
+        }
+    }
+    else
+    {
+        x_end = std::min(x_end, nr_wh[2 * level] - 1);
+        y_end = std::min(y_end, nr_wh[2 * level + 1] - 2);
 
-            if( !done && (nr_partitions[labelB] > MINIMUM_NR_SUBLABELS) )
+        for (int x = x_begin; x < x_end; x++)
+        {
+            for (int y = y_begin; y < y_end; y++)
             {
-                // try opposite direction
-                sublabel = y * step + x + 1;
-                int a13 = parent[level][(y - 1) * step + (x + 1)];
-                int a14 = parent[level][(y - 1) * step + (x + 2)];
-                int a23 = parent[level][(y) * step + (x + 1)];
-                int a24 = parent[level][(y) * step + (x + 2)];
-                int a33 = parent[level][(y + 1) * step + (x + 1)];
-                int a34 = parent[level][(y + 1) * step + (x + 2)];
-                if( nr_partitions[labelB] <= 2 // == 2
-                        || (nr_partitions[labelB] > 2 && checkSplit_hb(a13, a14, a23, a24, a33, a34)) )
-                {
-                    // run algorithm as usual
-                    float conf = intersectConf(seeds_top_level, labelA, labelB, level, sublabel);
-                    if( conf > req_confidence )
-                    {
-                        deleteBlockToplevel(labelB, level, sublabel);
-                        addBlockToplevel(labelA, level, sublabel);
-                        x++;
-                    }
-                }
+                int labelA = parent[level][y * step + x];
+                int labelB = parent[level][(y + 1) * step + x];
+
+                if( labelA == labelB )
+                    continue;
+
+                if( homeTile(labelA) != tile || homeTile(labelB) != tile )
+                    deferred.push_back(Point(x, y));
+                else if( updateBlockVertical(level, x, y, req_confidence) )
+                    y++;
             }
         }
     }
+}
+
+bool SuperpixelSEEDSImpl::updateBlockHorizontal(int level, int x, int y, float req_confidence)
+{
+    int step = nr_wh[2 * level];
+    // choose a label at the current level
+    int sublabel = y * step + x;
+    // get the label at the top level (= superpixel label)
+    int labelA = parent[level][y * step + x];
+    // get the neighboring label at the top level (= superpixel label)
+    int labelB = parent[level][y * step + x + 1];
+
+    if( labelA == labelB )
+        return false;
+
+    // get the surrounding labels at the top level, to check for splitting
+    int a11 = parent[level][(y - 1) * step + (x - 1)];
+    int a12 = parent[level][(y - 1) * step + (x)];
+    int a21 = parent[level][(y) * step + (x - 1)];
+    int a22 = parent[level][(y) * step + (x)];
+    int a31 = parent[level][(y + 1) * step + (x - 1)];
+    int a32 = parent[level][(y + 1) * step + (x)];
+
+    if( nr_partitions[labelA] == 2 || (nr_partitions[labelA] > 2 // 3 or more partitions
+            && checkSplit_hf(a11, a12, a21, a22, a31, a32)) )
+    {
+        // run algorithm as usual
+        float conf = intersectConf(seeds_top_level, labelB, labelA, level, sublabel);
+        if( conf > req_confidence )
+        {
+            deleteBlockToplevel(labelA, level, sublabel);
+            addBlockToplevel(labelB, level, sublabel);
+            return false;
+        }
+    }
 
-    // vertical bidirectional
-    for (int x = 1; x < nr_wh[2 * level] - 1; x++)
+    if( nr_partitions[labelB] > MINIMUM_NR_SUBLABELS )
     {
-        for (int y = 1; y < nr_wh[2 * level + 1] - 2; y++)
+        // try opposite direction
+        sublabel = y * step + x + 1;
+        int a13 = parent[level][(y - 1) * step + (x + 1)];
+        int a14 = parent[level][(y - 1) * step + (x + 2)];
+        int a23 = parent[level][(y) * step + (x + 1)];
+        int a24 = parent[level][(y) * step + (x + 2)];
+        int a33 = parent[level][(y + 1) * step + (x + 1)];
+        int a34 = parent[level][(y + 1) * step + (x + 2)];
+        if( nr_partitions[labelB] <= 2 // == 2
+                || (nr_partitions[labelB] > 2 && checkSplit_hb(a13, a14, a23, a24, a33, a34)) )
         {
-            // choose a label at the current level
-            sublabel = y * step + x;
-            // get the label at the top level (= superpixel label)
-            labelA = parent[level][y * step + x];
-            // get the neighboring label at the top level (= superpixel label)
-            labelB = parent[level][(y + 1) * step + x];
-
-            if( labelA == labelB )
-                continue;
-
-            int a11 = parent[level][(y - 1) * step + (x - 1)];
-            int a12 = parent[level][(y - 1) * step + (x)];
-            int a13 = parent[level][(y - 1) * step + (x + 1)];
-            int a21 = parent[level][(y) * step + (x - 1)];
-            int a22 = parent[level][(y) * step + (x)];
-            int a23 = parent[level][(y) * step + (x + 1)];
-
-            done = false;
-            if( nr_partitions[labelA] == 2 || (nr_partitions[labelA] > 2 // 3 or more partitions
-                    && checkSplit_vf(a11, a12, a13, a21, a22, a23)) )
+            // run algorithm as usual
+            float conf = intersectConf(seeds_top_level, labelA, labelB, level, sublabel);
+            if( conf > req_confidence )
             {
-                // run algorithm as usual
-                float conf = intersectConf(seeds_top_level, labelB, labelA, level, sublabel);
-                if( conf > req_confidence )
-                {
-                    deleteBlockToplevel(labelA, level, sublabel);
-                    addBlockToplevel(labelB, level, sublabel);
-                    done = true;
-                }
+                deleteBlockToplevel(labelB, level, sublabel);
+                addBlockToplevel(labelA, level, sublabel);
+                return true;
             }
+        }
+    }
+    return false;
+}
+
+bool SuperpixelSEEDSImpl::updateBlockVertical(int level, int x, int y, float req_confidence)
+{
+    int step = nr_wh[2 * level];
+    // choose a label at the current level
+    int sublabel = y * step + x;
+    // get the label at the top level (= superpixel label)
+    int labelA = parent[level][y * step + x];
+    // get the neighboring label at the top level (= superpixel label)
+    int labelB = parent[level][(y + 1) * step + x];
+
+    if( labelA == labelB )
+        return false;
+
+    int a11 = parent[level][(y - 1) * step + (x - 1)];
+    int a12 = parent[level][(y - 1) * step + (x)];
+    int a13 = parent[level][(y - 1) * step + (x + 1)];
+    int a21 = parent[level][(y) * step + (x - 1)];
+    int a22 = parent[level][(y) * step + (x)];
+    int a23 = parent[level][(y) * step + (x + 1)];
+
+    if( nr_partitions[labelA] == 2 || (nr_partitions[labelA] > 2 // 3 or more partitions
+            && checkSplit_vf(a11, a12, a13, a21, a22, a23)) )
+    {
+        // run algorithm as usual
+        float conf = intersectConf(seeds_top_level, labelB, labelA, level, sublabel);
+        if( conf > req_confidence )
+        {
+            deleteBlockToplevel(labelA, level, sublabel);
+            addBlockToplevel(labelB, level, sublabel);
+            return false;
+        }
+    }
 
-            if( !done && (nr_partitions[labelB] > MINIMUM_NR_SUBLABELS) )
+    if( nr_partitions[labelB] > MINIMUM_NR_SUBLABELS )
+    {
+        // try opposite direction
+        sublabel = (y + 1) * step + x;
+        int a31 = parent[level][(y + 1) * step + (x - 1)];
+        int a32 = parent[level][(y + 1) * step + (x)];
+        int a33 = parent[level][(y + 1) * step + (x + 1)];
+        int a41 = parent[level][(y + 2) * step + (x - 1)];
+        int a42 = parent[level][(y + 2) * step + (x)];
+        int a43 = parent[level][(y + 2) * step + (x + 1)];
+        if( nr_partitions[labelB] <= 2 // == 2
+                || (nr_partitions[labelB] > 2 && checkSplit_vb(a31, a32, a33, a41, a42, a43)) )
+        {
+            // run algorithm as usual
+            float conf = intersectConf(seeds_top_level, labelA, labelB, level, sublabel);
+            if( conf > req_confidence )
             {
-                // try opposite direction
-                sublabel = (y + 1) * step + x;
-                int a31 = parent[level][(y + 1) * step + (x - 1)];
-                int a32 = parent[level][(y + 1) * step + (x)];
-                int a33 = parent[level][(y + 1) * step + (x + 1)];
-                int a41 = parent[level][(y + 2) * step + (x - 1)];
-                int a42 = parent[level][(y + 2) * step + (x)];
-                int a43 = parent[level][(y + 2) * step + (x + 1)];
-                if( nr_partitions[labelB] <= 2 // == 2
-                        || (nr_partitions[labelB] > 2 && checkSplit_vb(a31, a32, a33, a41, a42, a43)) )
-                {
-                    // run algorithm as usual
-                    float conf = intersectConf(seeds_top_level, labelA, labelB, level, sublabel);
-                    if( conf > req_confidence )
-                    {
-                        deleteBlockToplevel(labelB, level, sublabel);
-                        addBlockToplevel(labelA, level, sublabel);
-                        y++;
-                    }
-                }
+                deleteBlockToplevel(labelB, level, sublabel);
+                addBlockToplevel(labelA, level, sublabel);
+                return true;
             }
         }
     }
+    return false;
 }
 
 int SuperpixelSEEDSImpl::goDownOneLevel()
@@ -882,15 +1021,12 @@ void SuperpixelSEEDSImpl::addBlock(int level, int label, int sublevel,
 
     //add the (sublevel, sublabel) block to the block (level, label)
     int n = 0;
-#if CV_SSSE3
+#if CV_SIMD128
     const int loop_end = histogram_size - 3;
     for (; n < loop_end; n += 4)
     {
         //this does exactly the same as the loop peeling below, but 4 elements at a time
-        __m128 h_labelp = _mm_load_ps(h_label + n);
-        __m128 h_sublabelp = _mm_load_ps(h_sublabel + n);
-        h_labelp = _mm_add_ps(h_labelp, h_sublabelp);
-        _mm_store_ps(h_label + n, h_labelp);
+        v_store_aligned(h_label + n, v_load_aligned(h_label + n) + v_load_aligned(h_sublabel + n));
     }
 #endif
 
@@ -914,15 +1050,12 @@ void SuperpixelSEEDSImpl::deleteBlockToplevel(int label, int sublevel, int subla
 
     //do the reverse operation of add_block_toplevel
     int n = 0;
-#if CV_SSSE3
+#if CV_SIMD128
     const int loop_end = histogram_size - 3;
     for (; n < loop_end; n += 4)
     {
         //this does exactly the same as the loop peeling below, but 4 elements at a time
-        __m128 h_labelp = _mm_load_ps(h_label + n);
-        __m128 h_sublabelp = _mm_load_ps(h_sublabel + n);
-        h_labelp = _mm_sub_ps(h_labelp, h_sublabelp);
-        _mm_store_ps(h_label + n, h_labelp);
+        v_store_aligned(h_label + n, v_load_aligned(h_label + n) - v_load_aligned(h_sublabel + n));
     }
 #endif
 
@@ -1109,54 +1242,29 @@ float SuperpixelSEEDSImpl::intersectConf(int level1, int label1A, int label1B,
      */
 
     int n = 0;
-#if CV_SSSE3
-    __m128 count1Ap = _mm_set1_ps(count1A);
-    __m128 count2p = _mm_set1_ps(count2);
-    __m128 count1Bp = _mm_set1_ps(count1B);
-    __m128 sumAp = _mm_set1_ps(0.0f);
-    __m128 sumBp = _mm_set1_ps(0.0f);
+#if CV_SIMD128
+    v_float32x4 count1Ap = v_setall_f32(count1A);
+    v_float32x4 count2p = v_setall_f32(count2);
+    v_float32x4 count1Bp = v_setall_f32(count1B);
+    v_float32x4 sumAp = v_setzero_f32();
+    v_float32x4 sumBp = v_setzero_f32();
 
     const int loop_end = histogram_size - 3;
     for(; n < loop_end; n += 4)
     {
         //this does exactly the same as the loop peeling below, but 4 elements at a time
+        v_float32x4 h1Ap = v_load_aligned(h1A + n);
+        v_float32x4 h1Bp = v_load_aligned(h1B + n);
+        v_float32x4 h2p = v_load_aligned(h2 + n);
 
         // normal
-        __m128 h1Ap = _mm_load_ps(h1A + n);
-        __m128 h1Bp = _mm_load_ps(h1B + n);
-        __m128 h2p = _mm_load_ps(h2 + n);
-
-        __m128 h1ApC2 = _mm_mul_ps(h1Ap, count2p);
-        __m128 h2pC1A = _mm_mul_ps(h2p, count1Ap);
-        __m128 maskA = _mm_cmple_ps(h1ApC2, h2pC1A);
-        __m128 sum1AddA = _mm_and_ps(maskA, h1ApC2);
-        __m128 sum2AddA = _mm_andnot_ps(maskA, h2pC1A);
-        sumAp = _mm_add_ps(sumAp, sum1AddA);
-        sumAp = _mm_add_ps(sumAp, sum2AddA);
+        sumAp += v_min(h1Ap * count2p, h2p * count1Ap);
 
         // del
-        __m128 diffp = _mm_sub_ps(h1Bp, h2p);
-        __m128 h1BpC2 = _mm_mul_ps(diffp, count2p);
-        __m128 h2pC1B = _mm_mul_ps(h2p, count1Bp);
-        __m128 maskB = _mm_cmple_ps(h1BpC2, h2pC1B);
-        __m128 sum1AddB = _mm_and_ps(maskB, h1BpC2);
-        __m128 sum2AddB = _mm_andnot_ps(maskB, h2pC1B);
-        sumBp = _mm_add_ps(sumBp, sum1AddB);
-        sumBp = _mm_add_ps(sumBp, sum2AddB);
+        sumBp += v_min((h1Bp - h2p) * count2p, h2p * count1Bp);
     }
-    // merge results (quite expensive)
-    float sum1Asse;
-    sumAp = _mm_hadd_ps(sumAp, sumAp);
-    sumAp = _mm_hadd_ps(sumAp, sumAp);
-    _mm_store_ss(&sum1Asse, sumAp);
-
-    float sum1Bsse;
-    sumBp = _mm_hadd_ps(sumBp, sumBp);
-    sumBp = _mm_hadd_ps(sumBp, sumBp);
-    _mm_store_ss(&sum1Bsse, sumBp);
-
-    sumA += sum1Asse;
-    sumB += sum1Bsse;
+    sumA += v_reduce_sum(sumAp);
+    sumB += v_reduce_sum(sumBp);
 #endif
 
     //loop peeling
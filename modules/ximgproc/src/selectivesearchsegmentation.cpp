@@ -40,8 +40,10 @@ the use of this software, even if advised of the possibility of such damage.
 
 #include "precomp.hpp"
 #include "opencv2/ximgproc/segmentation.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include <iostream>
+#include <queue>
 
 namespace cv {
     namespace ximgproc {
@@ -109,6 +111,105 @@ namespace cv {
                     }
             };
 
+            // Sum of minimums of the bins of two histograms
+            static float histogramIntersection(const float* h1, const float* h2, int size) {
+                float r = 0;
+                int i = 0;
+
+#if CV_SIMD128
+                v_float32x4 vr = v_setzero_f32();
+
+                for (; i <= size - 4; i += 4) {
+                    vr += v_min(v_load(h1 + i), v_load(h2 + i));
+                }
+
+                r = v_reduce_sum(vr);
+#endif
+
+                for (; i < size; i++) {
+                    r += min(h1[i], h2[i]);
+                }
+
+                return r;
+            }
+
+            // Both histograms are replaced by their average weighted by the regions sizes
+            static void mergeHistograms(float* h1, float* h2, int size, int size_r1, int size_r2) {
+                int i = 0;
+
+#if CV_SIMD128
+                v_float32x4 vs1 = v_setall_f32((float)size_r1);
+                v_float32x4 vs2 = v_setall_f32((float)size_r2);
+                v_float32x4 vs = v_setall_f32((float)(size_r1 + size_r2));
+
+                for (; i <= size - 4; i += 4) {
+                    v_float32x4 v = (v_load(h1 + i) * vs1 + v_load(h2 + i) * vs2) / vs;
+                    v_store(h1 + i, v);
+                    v_store(h2 + i, v);
+                }
+#endif
+
+                for (; i < size; i++) {
+                    h1[i] = (h1[i] * size_r1 + h2[i] * size_r2) / (size_r1 + size_r2);
+                    h2[i] = h1[i];
+                }
+            }
+
+            // Bounding rects of all the regions of a segmentation, computed in one pass
+            static void computeBoundingRects(const Mat& regions, int nb_segs, std::vector<Rect>& bounding_rects) {
+                std::vector<Point> tl(nb_segs, Point(INT_MAX, INT_MAX));
+                std::vector<Point> br(nb_segs, Point(INT_MIN, INT_MIN));
+
+                for (int i = 0; i < (int)regions.rows; i++) {
+                    const int* p = regions.ptr<int>(i);
+
+                    for (int j = 0; j < (int)regions.cols; j++) {
+                        Point& a = tl[p[j]];
+                        Point& b = br[p[j]];
+
+                        a.x = std::min(a.x, j);
+                        a.y = std::min(a.y, i);
+                        b.x = std::max(b.x, j);
+                        b.y = std::max(b.y, i);
+                    }
+                }
+
+                bounding_rects.resize(nb_segs);
+
+                for (int seg = 0; seg < nb_segs; seg++) {
+                    if (br[seg].x < tl[seg].x) { // Empty region
+                        bounding_rects[seg] = Rect();
+                    } else {
+                        bounding_rects[seg] = Rect(tl[seg].x, tl[seg].y, br[seg].x - tl[seg].x + 1, br[seg].y - tl[seg].y + 1);
+                    }
+                }
+            }
+
+            // Color histograms (uniform bins over [0, 256) for each channel) of all regions, computed in one pass
+            template<typename T>
+            static void accumulateColorHistograms(const Mat& img, const Mat& regions, int histogram_bins_size, Mat_<int>& counts) {
+                const int cn = img.channels();
+                const float scale = histogram_bins_size / 256.0f;
+
+                for (int i = 0; i < img.rows; i++) {
+                    const T* p = img.ptr<T>(i);
+                    const int* r = regions.ptr<int>(i);
+
+                    for (int j = 0; j < img.cols; j++, p += cn) {
+                        int* histogram = counts.ptr<int>(r[j]);
+
+                        for (int c = 0; c < cn; c++) {
+                            float val = (float)p[c];
+
+                            // Values out of range are ignored, as calcHist does
+                            if (val >= 0 && val < 256) {
+                                histogram[c * histogram_bins_size + (int)(val * scale)]++;
+                            }
+                        }
+                    }
+                }
+            }
+
             /****************************************
              * Stragegy / Color
              ***************************************/
@@ -144,14 +245,8 @@ namespace cv {
 
                 if (image_id == -1 || last_image_id != image_id) {
 
-                    std::vector<Mat> img_planes;
-                    split(img, img_planes);
-
                     int histogram_bins_size = 25;
 
-                    float range[] = {0, 256};
-                    const float* histogram_ranges = {range};
-
                     double min, max;
                     minMaxLoc(regions, &min, &max);
                     int nb_segs = (int)max + 1;
@@ -160,43 +255,35 @@ namespace cv {
 
                     histograms = Mat_<float>(nb_segs, histogram_size);
 
-                    for (int r = 0; r < nb_segs; r++) {
+                    // Bins for histograms of all regions
+                    Mat_<int> tmp_histograms = Mat_<int>::zeros(nb_segs, histogram_size);
 
-                        // Generate mask
-                        Mat mask = Mat(img.rows, img.cols, CV_8UC1);
+                    switch (img.depth()) {
+                        case CV_8U:
+                            accumulateColorHistograms<uchar>(img, regions, histogram_bins_size, tmp_histograms);
+                            break;
+                        case CV_16U:
+                            accumulateColorHistograms<ushort>(img, regions, histogram_bins_size, tmp_histograms);
+                            break;
+                        case CV_32F:
+                            accumulateColorHistograms<float>(img, regions, histogram_bins_size, tmp_histograms);
+                            break;
+                        default:
+                            CV_Error(Error::StsUnsupportedFormat, "Only 8U, 16U and 32F images are supported");
+                    }
 
-                        int* regions_data = (int*)regions.data;
-                        char* mask_data = (char*)mask.data;
+                    // Normalize historgrams
+                    for (int r = 0; r < nb_segs; r++) {
 
-                        for (unsigned int x = 0; x < regions.total(); x++) {
-                            mask_data[x] = regions_data[x] == r ? 255 : 0;
-                        }
+                        float* histogram = histograms.ptr<float>(r);
+                        const int* tmp_histogram = tmp_histograms.ptr<int>(r);
 
-                        // Compute histogram for each channels
                         float tt = 0;
 
-                        Mat tmp_hists = Mat(histogram_size, 1, CV_32F);
-                        float *tmp_histogram = tmp_hists.ptr<float>(0);
-                        int h_pos = 0;
-                        Mat tmp_hist;
-
-                        for (int p = 0; p < img.channels(); p++) {
-
-                            calcHist(&img_planes[p], 1, 0, mask, tmp_hist, 1, &histogram_bins_size, &histogram_ranges);
-
-                            float *tmp_hist_ = tmp_hist.ptr<float>(0);
-
-                            // Copy local histogram to global histogram
-                            for (int pos = 0; pos < histogram_bins_size; pos++) {
-                                tmp_histogram[pos + h_pos] = tmp_hist_[pos];
-                                tt += tmp_histogram[pos + h_pos];
-                            }
-                            h_pos += histogram_bins_size;
+                        for (int h_pos2 = 0; h_pos2 < histogram_size; h_pos2++) {
+                            tt += tmp_histogram[h_pos2];
                         }
 
-                        // Normalize historgrams
-                        float* histogram = histograms.ptr<float>(r);
-
                         for (int h_pos2 = 0; h_pos2 < histogram_size; h_pos2++) {
                             histogram[h_pos2] = tmp_histogram[h_pos2] / tt;
                         }
@@ -215,28 +302,11 @@ namespace cv {
 
             float SelectiveSearchSegmentationStrategyColorImpl::get(int r1, int r2) {
 
-                float r = 0;
-                float* h1 = histograms.ptr<float>(r1);
-                float* h2 = histograms.ptr<float>(r2);
-
-                for (int i = 0; i < histogram_size; i++) {
-                    r += min(h1[i], h2[i]);
-                }
-
-                return r;
+                return histogramIntersection(histograms.ptr<float>(r1), histograms.ptr<float>(r2), histogram_size);
             }
 
             void SelectiveSearchSegmentationStrategyColorImpl::merge(int r1, int r2) {
-                int size_r1 = sizes.at<int>(r1);
-                int size_r2 = sizes.at<int>(r2);
-
-                float* h1 = histograms.ptr<float>(r1);
-                float* h2 = histograms.ptr<float>(r2);
-
-                for (int i = 0; i < histogram_size; i++) {
-                    h1[i] = (h1[i] * size_r1 + h2[i] * size_r2) / (size_r1 + size_r2);
-                    h2[i] = h1[i];
-                }
+                mergeHistograms(histograms.ptr<float>(r1), histograms.ptr<float>(r2), histogram_size, sizes.at<int>(r1), sizes.at<int>(r2));
             }
 
 
@@ -432,25 +502,8 @@ namespace cv {
 
                 int nb_segs = (int)max + 1;
 
-                // Build a list of points for each regions
-                std::vector<std::vector<cv::Point> > points;
-
-                points.resize(nb_segs);
-
-                for (int i = 0; i < (int)regions.rows; i++) {
-                    const int* p = regions.ptr<int>(i);
-
-                    for (int j = 0; j < (int)regions.cols; j++) {
-                        points[p[j]].push_back(cv::Point(j, i));
-                    }
-                }
-
                 // Compute bounding rects for each regions
-                bounding_rects.resize(nb_segs);
-
-                for(int seg = 0; seg < nb_segs; seg++) {
-                    bounding_rects[seg] = cv::boundingRect(points[seg]);
-                }
+                computeBoundingRects(regions, nb_segs, bounding_rects);
             }
 
             float SelectiveSearchSegmentationStrategyFillImpl::get(int r1, int r2) {
@@ -611,6 +664,20 @@ namespace cv {
                     // Bins for histograms
                     Mat_<int> tmp_histograms = Mat_<int>::zeros(nb_segs, histogram_size);
 
+                    // Offset of the bin of each value in the histogram of one gaussian
+                    int bin_of_value[256];
+
+                    for (int val = 0; val < 256; val++) {
+                        bin_of_value[val] = (int)((float)val / (range[1] / histogram_bins_size));
+                    }
+
+                    const int nb_gaussians = img.channels() * 8;
+                    std::vector<const uchar*> gaussians_data(nb_gaussians);
+
+                    for (int g = 0; g < nb_gaussians; g++) {
+                        gaussians_data[g] = img_gaussians[g].ptr<uchar>();
+                    }
+
                     int* regions_data = (int*)regions.data;
 
                     for (unsigned int x = 0; x < regions.total(); x++) {
@@ -618,17 +685,11 @@ namespace cv {
 
                         int* histogram = tmp_histograms.ptr<int>(region);
 
-                        for (int p = 0; p < img.channels(); p++) {
-                            for (unsigned int i = 0; i < 8; i++) {
-
-                                int val = (int)((unsigned char*)img_gaussians[p * 8 + i].data)[x];
-
-                                int bin = (int)((float)val / (range[1] / histogram_bins_size));
-
-                                histogram[(p * 8 + i) * histogram_bins_size + bin]++;
-                                totals[region]++;
-                            }
+                        for (int g = 0; g < nb_gaussians; g++) {
+                            histogram[g * histogram_bins_size + bin_of_value[gaussians_data[g][x]]]++;
                         }
+
+                        totals[region] += nb_gaussians;
                     }
 
                     // Normalisation per segments
@@ -653,28 +714,11 @@ namespace cv {
 
             float SelectiveSearchSegmentationStrategyTextureImpl::get(int r1, int r2) {
 
-                float r = 0;
-                float* h1 = histograms.ptr<float>(r1);
-                float* h2 = histograms.ptr<float>(r2);
-
-                for (int i = 0; i < histogram_size; i++) {
-                    r += min(h1[i], h2[i]);
-                }
-
-                return r;
+                return histogramIntersection(histograms.ptr<float>(r1), histograms.ptr<float>(r2), histogram_size);
             }
 
             void SelectiveSearchSegmentationStrategyTextureImpl::merge(int r1, int r2) {
-                int size_r1 = sizes.at<int>(r1);
-                int size_r2 = sizes.at<int>(r2);
-
-                float* h1 = histograms.ptr<float>(r1);
-                float* h2 = histograms.ptr<float>(r2);
-
-                for (int i = 0; i < histogram_size; i++) {
-                    h1[i] = (h1[i] * size_r1 + h2[i] * size_r2) / (size_r1 + size_r2);
-                    h2[i] = h1[i];
-                }
+                mergeHistograms(histograms.ptr<float>(r1), histograms.ptr<float>(r2), histogram_size, sizes.at<int>(r1), sizes.at<int>(r2));
             }
 
 
@@ -685,6 +729,95 @@ namespace cv {
 
             // Core
 
+            // Initial segmentation of one image by one graph segmentation
+            struct InitialSegmentation {
+                Mat img_regions;
+                Mat_<int> sizes;
+                int nb_segs;
+                std::vector<Rect> bounding_rects;
+                std::vector<std::vector<int> > neighbours; // Sorted lists of neighbouring regions
+            };
+
+            static inline void addNeighbour(std::vector<std::vector<int> >& neighbours, int r1, int r2) {
+                if (r1 != r2) {
+                    std::vector<int>& n = neighbours[r1];
+
+                    // Most of the time the pixels before have the same neighbour
+                    if (n.empty() || n.back() != r2) {
+                        n.push_back(r2);
+                    }
+                }
+            }
+
+            static void computeInitialSegmentation(const Mat& image, const Ptr<GraphSegmentation>& gs, InitialSegmentation& seg) {
+
+                // Compute initial segmentation
+                gs->processImage(image, seg.img_regions);
+
+                const Mat& img_regions = seg.img_regions;
+
+                // Get number of regions
+                double min, max;
+                minMaxLoc(img_regions, &min, &max);
+                seg.nb_segs = (int)max + 1;
+
+                // Compute bouding rects, sizes and neighbours
+                computeBoundingRects(img_regions, seg.nb_segs, seg.bounding_rects);
+
+                seg.sizes = Mat::zeros(seg.nb_segs, 1, CV_32SC1);
+                seg.neighbours.assign(seg.nb_segs, std::vector<int>());
+
+                int* sizes = seg.sizes.ptr<int>();
+                std::vector<std::vector<int> >& neighbours = seg.neighbours;
+
+                const int* previous_p = NULL;
+
+                for (int i = 0; i < (int)img_regions.rows; i++) {
+                    const int* p = img_regions.ptr<int>(i);
+
+                    for (int j = 0; j < (int)img_regions.cols; j++) {
+
+                        sizes[p[j]]++;
+
+                        if (i > 0 && j > 0) {
+
+                            addNeighbour(neighbours, p[j], p[j - 1]);
+                            addNeighbour(neighbours, p[j], previous_p[j]);
+                            addNeighbour(neighbours, p[j], previous_p[j - 1]);
+
+                            addNeighbour(neighbours, p[j - 1], p[j]);
+                            addNeighbour(neighbours, previous_p[j], p[j]);
+                            addNeighbour(neighbours, previous_p[j - 1], p[j]);
+                        }
+                    }
+                    previous_p = p;
+                }
+
+                for (int seg_id = 0; seg_id < seg.nb_segs; seg_id++) {
+                    std::vector<int>& n = neighbours[seg_id];
+                    std::sort(n.begin(), n.end());
+                    n.erase(std::unique(n.begin(), n.end()), n.end());
+                }
+            }
+
+            // Computes the initial segmentations of all the combinations of images and graph segmentations
+            class InitialSegmentationInvoker : public ParallelLoopBody {
+                public:
+                    InitialSegmentationInvoker(const std::vector<Mat>& images_, const std::vector<Ptr<GraphSegmentation> >& segmentations_, std::vector<InitialSegmentation>& results_)
+                        : images(images_), segmentations(segmentations_), results(results_) {}
+
+                    void operator()(const Range& range) const {
+                        for (int c = range.start; c < range.end; c++) {
+                            computeInitialSegmentation(images[c / segmentations.size()], segmentations[c % segmentations.size()], results[c]);
+                        }
+                    }
+
+                private:
+                    const std::vector<Mat>& images;
+                    const std::vector<Ptr<GraphSegmentation> >& segmentations;
+                    std::vector<InitialSegmentation>& results;
+            };
+
             class SelectiveSearchSegmentationImpl : public SelectiveSearchSegmentation {
                 public:
                     SelectiveSearchSegmentationImpl() {
@@ -728,7 +861,7 @@ namespace cv {
                     std::vector<Ptr<GraphSegmentation> > segmentations;
                     std::vector<Ptr<SelectiveSearchSegmentationStrategy> > strategies;
 
-                    void hierarchicalGrouping(const Mat& img, Ptr<SelectiveSearchSegmentationStrategy>& s, const Mat& img_regions, const Mat_<char>& is_neighbour, const Mat_<int>& sizes, int& nb_segs, const std::vector<Rect>& bounding_rects, std::vector<Region>& regions, int region_id);
+                    void hierarchicalGrouping(const Mat& img, Ptr<SelectiveSearchSegmentationStrategy>& s, const InitialSegmentation& seg, std::vector<Region>& regions, int image_id);
             };
 
             void SelectiveSearchSegmentationImpl::setBaseImage(InputArray img) {
@@ -888,73 +1021,26 @@ namespace cv {
 
                 std::vector<Region> all_regions;
 
-                int image_id = 0;
-
-                for(std::vector<Mat>::iterator image = images.begin(); image != images.end(); ++image) {
-                    for(std::vector<Ptr<GraphSegmentation> >::iterator gs = segmentations.begin(); gs != segmentations.end(); ++gs) {
-
-                        Mat img_regions;
-                        Mat_<char> is_neighbour;
-                        Mat_<int> sizes;
-
-                        // Compute initial segmentation
-                        (*gs)->processImage(*image, img_regions);
-
-                        // Get number of regions
-                        double min, max;
-                        minMaxLoc(img_regions, &min, &max);
-                        int nb_segs = (int)max + 1;
-
-                        // Compute bouding rects and neighbours
-                        std::vector<Rect> bounding_rects;
-                        bounding_rects.resize(nb_segs);
-
-                        std::vector<std::vector<cv::Point> > points;
-
-                        points.resize(nb_segs);
-
-                        is_neighbour = Mat::zeros(nb_segs, nb_segs, CV_8UC1);
-                        sizes = Mat::zeros(nb_segs, 1, CV_32SC1);
-
-                        const int* previous_p = NULL;
-
-                        for (int i = 0; i < (int)img_regions.rows; i++) {
-                            const int* p = img_regions.ptr<int>(i);
-
-                            for (int j = 0; j < (int)img_regions.cols; j++) {
-
-                                points[p[j]].push_back(cv::Point(j, i));
-                                sizes.at<int>(p[j], 0) = sizes.at<int>(p[j], 0) + 1;
-
-                                if (i > 0 && j > 0) {
+                // Graph segmentations don't depend on each other, while strategies keep their state
+                // between calls and may be shared, so only the first step is done in parallel
+                std::vector<InitialSegmentation> segs(images.size() * segmentations.size());
 
-                                    is_neighbour.at<char>(p[j], p[j - 1]) = 1;
-                                    is_neighbour.at<char>(p[j], previous_p[j]) = 1;
-                                    is_neighbour.at<char>(p[j], previous_p[j - 1]) = 1;
+                parallel_for_(Range(0, (int)segs.size()), InitialSegmentationInvoker(images, segmentations, segs));
 
-                                    is_neighbour.at<char>(p[j - 1], p[j]) = 1;
-                                    is_neighbour.at<char>(previous_p[j], p[j]) = 1;
-                                    is_neighbour.at<char>(previous_p[j - 1], p[j]) = 1;
-                                }
-                            }
-                            previous_p = p;
-                        }
-
-                        for(int seg = 0; seg < nb_segs; seg++) {
-                            bounding_rects[seg] = cv::boundingRect(points[seg]);
-                        }
+                for (int image_id = 0; image_id < (int)segs.size(); image_id++) {
+                    const Mat& image = images[image_id / segmentations.size()];
 
-                        for(std::vector<Ptr<SelectiveSearchSegmentationStrategy> >::iterator strategy = strategies.begin(); strategy != strategies.end(); ++strategy) {
-                            std::vector<Region> regions;
-                            hierarchicalGrouping(*image, *strategy, img_regions, is_neighbour, sizes, nb_segs, bounding_rects, regions, image_id);
+                    for(std::vector<Ptr<SelectiveSearchSegmentationStrategy> >::iterator strategy = strategies.begin(); strategy != strategies.end(); ++strategy) {
+                        std::vector<Region> regions;
+                        hierarchicalGrouping(image, *strategy, segs[image_id], regions, image_id);
 
-                            for(std::vector<Region>::iterator region = regions.begin(); region != regions.end(); ++region) {
-                                all_regions.push_back(*region);
-                            }
+                        for(std::vector<Region>::iterator region = regions.begin(); region != regions.end(); ++region) {
+                            all_regions.push_back(*region);
                         }
-
-                        image_id++;
                     }
+
+                    // Free memory as soon as possible
+                    segs[image_id] = InitialSegmentation();
                 }
 
                 std::sort(all_regions.begin(), all_regions.end());
@@ -973,16 +1059,29 @@ namespace cv {
 
             }
 
-            void SelectiveSearchSegmentationImpl::hierarchicalGrouping(const Mat& img, Ptr<SelectiveSearchSegmentationStrategy>& s, const Mat& img_regions, const Mat_<char>& is_neighbour, const Mat_<int>& sizes_, int& nb_segs, const std::vector<Rect>& bounding_rects, std::vector<Region>& regions, int image_id) {
+            void SelectiveSearchSegmentationImpl::hierarchicalGrouping(const Mat& img, Ptr<SelectiveSearchSegmentationStrategy>& s, const InitialSegmentation& seg, std::vector<Region>& regions, int image_id) {
+
+                const int nb_segs = seg.nb_segs;
+
+                Mat sizes = seg.sizes.clone();
 
-                Mat sizes = sizes_.clone();
+                // Similarities of the pairs are only computed once: pairs with a merged region are
+                // skipped when they reach the top of the queue
+                std::priority_queue<Neighbour> similarities;
+
+                // Neighbours of the regions, indexed as regions. Lists can reference merged regions.
+                std::vector<std::vector<int> > neighbours(seg.neighbours);
+                neighbours.reserve(2 * nb_segs);
+
+                // Last region for which the region was added to the neighbours
+                std::vector<int> marks(2 * nb_segs, -1);
 
-                std::vector<Neighbour> similarities;
                 regions.clear();
+                regions.reserve(2 * nb_segs);
 
                 /////////////////////////////////////////
 
-                s->setImage(img, img_regions, sizes, image_id);
+                s->setImage(img, seg.img_regions, sizes, image_id);
 
                 // Compute initial similarities
                 for (int i = 0; i < nb_segs; i++) {
@@ -991,32 +1090,30 @@ namespace cv {
                     r.id = i;
                     r.level = 1;
                     r.merged_to = -1;
-                    r.bounding_box = bounding_rects[i];
+                    r.bounding_box = seg.bounding_rects[i];
 
                     regions.push_back(r);
 
-                    for (int j = i + 1; j < nb_segs; j++) {
-                        if (is_neighbour.at<char>(i, j)) {
+                    for (std::vector<int>::const_iterator j = neighbours[i].begin(); j != neighbours[i].end(); ++j) {
+                        if (*j > i) {
                             Neighbour n;
                             n.from = i;
-                            n.to = j;
-                            n.similarity = s->get(i, j);
+                            n.to = *j;
+                            n.similarity = s->get(i, *j);
 
-                            similarities.push_back(n);
+                            similarities.push(n);
                         }
                     }
                 }
 
-                while(similarities.size() > 0) {
-
-                    std::sort(similarities.begin(), similarities.end());
+                while(!similarities.empty()) {
 
-                    // for(std::vector<Neighbour>::iterator similarity = similarities.begin(); similarity != similarities.end(); ++similarity) {
-                    //     std::cout << *similarity << std::endl;
-                    // }
+                    Neighbour p = similarities.top();
+                    similarities.pop();
 
-                    Neighbour p = similarities.back();
-                    similarities.pop_back();
+                    if (regions[p.from].merged_to != -1 || regions[p.to].merged_to != -1) {
+                        continue;
+                    }
 
                     Region region_from = regions[p.from];
                     Region region_to = regions[p.to];
@@ -1029,8 +1126,10 @@ namespace cv {
 
                     regions.push_back(new_r);
 
-                    regions[p.from].merged_to = (int)regions.size() - 1;
-                    regions[p.to].merged_to = (int)regions.size() - 1;
+                    const int new_id = (int)regions.size() - 1;
+
+                    regions[p.from].merged_to = new_id;
+                    regions[p.to].merged_to = new_id;
 
                     // Merge
                     s->merge(region_from.id, region_to.id);
@@ -1039,45 +1138,36 @@ namespace cv {
                     sizes.at<int>(region_from.id, 0) += sizes.at<int>(region_to.id, 0);
                     sizes.at<int>(region_to.id, 0) = sizes.at<int>(region_from.id, 0);
 
+                    // Neighbours of the new region are the live neighbours of the merged ones
                     std::vector<int> local_neighbours;
 
-                    for(std::vector<Neighbour>::iterator similarity = similarities.begin(); similarity != similarities.end();) {
-                        if ((*similarity).from == p.from || (*similarity).to == p.from || (*similarity).from == p.to || (*similarity).to == p.to) {
-                            int from = 0;
-
-                            if ((*similarity).from == p.from || (*similarity).from == p.to) {
-                                from = (*similarity).to;
-                            } else {
-                                from = (*similarity).from;
-                            }
-
-                            bool already_neighboor = false;
+                    for (int k = 0; k < 2; k++) {
+                        const std::vector<int>& n = neighbours[k == 0 ? p.from : p.to];
 
-                            for(std::vector<int>::iterator local_neighbour = local_neighbours.begin(); local_neighbour != local_neighbours.end(); local_neighbour++) {
-                                if (*local_neighbour == from) {
-                                    already_neighboor = true;
-                                }
+                        for (std::vector<int>::const_iterator local_neighbour = n.begin(); local_neighbour != n.end(); ++local_neighbour) {
+                            if (regions[*local_neighbour].merged_to == -1 && marks[*local_neighbour] != new_id) {
+                                marks[*local_neighbour] = new_id;
+                                local_neighbours.push_back(*local_neighbour);
                             }
-
-                            if (!already_neighboor) {
-                                local_neighbours.push_back(from);
-                            }
-
-                            similarity = similarities.erase(similarity);
-                        } else {
-                            similarity++;
                         }
                     }
 
+                    std::vector<int>().swap(neighbours[p.from]);
+                    std::vector<int>().swap(neighbours[p.to]);
+
                     for(std::vector<int>::iterator local_neighbour = local_neighbours.begin(); local_neighbour != local_neighbours.end(); local_neighbour++) {
 
+                        neighbours[*local_neighbour].push_back(new_id);
+
                         Neighbour n;
-                        n.from = (int)regions.size() - 1;
+                        n.from = new_id;
                         n.to = *local_neighbour;
                         n.similarity = s->get(regions[n.from].id, regions[n.to].id);
 
-                        similarities.push_back(n);
+                        similarities.push(n);
                     }
+
+                    neighbours.push_back(local_neighbours);
                 }
 
                 // Compute regions' rank
@@ -59,6 +59,7 @@
  */
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 using namespace std;
 
@@ -77,6 +78,9 @@ public:
     // perform amount of iteration
     virtual void iterate( int num_iterations = 10 );
 
+    // continue iterations on the next frame
+    virtual void updateFrame( InputArray image, int num_iterations = 2, float change_threshold = 8.0f );
+
     // get amount of superpixels
     virtual int getNumberOfSuperpixels() const;
 
@@ -150,6 +154,14 @@ private:
     // merge threshold (MSLIC)
     float m_merge;
 
+    // color and spatial distances (SLICO)
+    Mat m_distchans;
+    Mat m_distxy;
+
+    // max color and spatial distances (SLICO)
+    vector<float> m_maxchans;
+    vector<float> m_maxxy;
+
     // initialization
     inline void initialize();
 
@@ -165,11 +177,17 @@ private:
     // fetch seeds
     inline void GetChSeedsK();
 
-    // SLIC
-    inline void PerformSLIC( const int& num_iterations );
+    // SLIC, only pixels in mask are updated if it isn't empty
+    inline void PerformSLIC( const int& num_iterations, const Mat& mask = Mat() );
+
+    // SLICO, only pixels in mask are updated if it isn't empty
+    inline void PerformSLICO( const int& num_iterations, const Mat& mask = Mat() );
 
-    // SLICO
-    inline void PerformSLICO( const int& num_iterations );
+    // recalculate the seeds from labels
+    inline void UpdateSeedsFromLabels();
+
+    // recalculate max distances of clusters (SLICO)
+    inline void UpdateMaxDistances();
 
     // MSLIC
     inline void PerformMSLIC( const int& num_iterations );
@@ -986,12 +1004,121 @@ struct SeedsCenters
     vector< vector<float> > sigma;
 };
 
+/*
+ * Squared color distances of a row of pixels to the seed, accumulated
+ * over the channels.
+ */
+template<typename T>
+static inline void accumRowChDist( const T* src, float seed, float* dist, int len )
+{
+    for( int x = 0; x < len; x++ )
+    {
+      float diff = src[x] - seed;
+      dist[x] += diff * diff;
+    }
+}
+
+#if CV_SIMD128
+template<>
+inline void accumRowChDist<uchar>( const uchar* src, float seed, float* dist, int len )
+{
+    int x = 0;
+    v_float32x4 vseed = v_setall_f32(seed);
+    for( ; x <= len - 4; x += 4 )
+    {
+      v_float32x4 diff = v_cvt_f32(v_reinterpret_as_s32(v_load_expand_q(src + x))) - vseed;
+      v_store(dist + x, v_load(dist + x) + diff * diff);
+    }
+    for( ; x < len; x++ )
+    {
+      float diff = src[x] - seed;
+      dist[x] += diff * diff;
+    }
+}
+
+template<>
+inline void accumRowChDist<float>( const float* src, float seed, float* dist, int len )
+{
+    int x = 0;
+    v_float32x4 vseed = v_setall_f32(seed);
+    for( ; x <= len - 4; x += 4 )
+    {
+      v_float32x4 diff = v_load(src + x) - vseed;
+      v_store(dist + x, v_load(dist + x) + diff * diff);
+    }
+    for( ; x < len; x++ )
+    {
+      float diff = src[x] - seed;
+      dist[x] += diff * diff;
+    }
+}
+#endif
+
+static void computeRowChDist( const vector<Mat>& chvec, const vector< vector<float> >& kseeds,
+                              int n, int y, int x1, int len, int nr_channels, float* dist )
+{
+    std::fill( dist, dist + len, 0.0f );
+
+    for( int b = 0; b < nr_channels; b++ )
+    {
+      const Mat& ch = chvec[b];
+      const float seed = kseeds[b][n];
+
+      switch ( ch.depth() )
+      {
+        case CV_8U:
+          accumRowChDist( ch.ptr<uchar>(y) + x1, seed, dist, len );
+          break;
+
+        case CV_8S:
+          accumRowChDist( ch.ptr<schar>(y) + x1, seed, dist, len );
+          break;
+
+        case CV_16U:
+          accumRowChDist( ch.ptr<ushort>(y) + x1, seed, dist, len );
+          break;
+
+        case CV_16S:
+          accumRowChDist( ch.ptr<short>(y) + x1, seed, dist, len );
+          break;
+
+        case CV_32S:
+          accumRowChDist( ch.ptr<int>(y) + x1, seed, dist, len );
+          break;
+
+        case CV_32F:
+          accumRowChDist( ch.ptr<float>(y) + x1, seed, dist, len );
+          break;
+
+        case CV_64F:
+          accumRowChDist( ch.ptr<double>(y) + x1, seed, dist, len );
+          break;
+
+        default:
+          CV_Error( Error::StsInternal, "Invalid matrix depth" );
+          break;
+      }
+    }
+}
+
+/*
+ * Tells if the search window of the seed contains pixels to update,
+ * dirtysum is the integral of the update mask.
+ */
+static inline bool isWindowDirty( const Mat& dirtysum, int x1, int x2, int y1, int y2 )
+{
+    if ( dirtysum.empty() ) return true;
+
+    return dirtysum.at<int>(y2,x2) - dirtysum.at<int>(y1,x2)
+         - dirtysum.at<int>(y2,x1) + dirtysum.at<int>(y1,x1) > 0;
+}
+
 struct SLICOGrowInvoker : ParallelLoopBody
 {
     SLICOGrowInvoker( vector<Mat>* _chvec, Mat* _distchans, Mat* _distxy, Mat* _distvec,
                       Mat* _klabels, float _kseedsxn, float _kseedsyn, float _xywt,
                       float _maxchansn, vector< vector<float> > *_kseeds,
-                      int _x1, int _x2, int _nr_channels, int _n )
+                      int _x1, int _x2, int _nr_channels, int _n, const Mat* _mask = NULL )
     {
       chvec = _chvec;
       distchans = _distchans;
@@ -1007,102 +1134,75 @@ struct SLICOGrowInvoker : ParallelLoopBody
       n = _n;
       xywt = _xywt;
       nr_channels = _nr_channels;
+      mask = _mask;
     }
 
     void operator ()(const cv::Range& range) const
     {
-      int cols = klabels->cols;
-      int rows = klabels->rows;
+      if ( x2 <= x1 ) return;
+
+      vector<float> chdist( x2 - x1 );
+
       for (int y = range.start; y < range.end; ++y)
       {
-        for( int x = x1; x < x2; x++ )
+        computeRowChDist( *chvec, *kseeds, n, y, x1, x2 - x1, nr_channels, &chdist[0] );
+
+        const float* pchdist = &chdist[0] - x1;
+        float* pdistchans = distchans->ptr<float>(y);
+        float* pdistxy = distxy->ptr<float>(y);
+        float* pdistvec = distvec->ptr<float>(y);
+        int* plabels = klabels->ptr<int>(y);
+        const uchar* pmask = mask ? mask->ptr<uchar>(y) : NULL;
+
+        float dify = y - kseedsyn;
+        int x = x1;
+
+#if CV_SIMD128
+        v_float32x4 vseedx = v_setall_f32(kseedsxn);
+        v_float32x4 vdify2 = v_setall_f32(dify*dify);
+        v_float32x4 vmaxchans = v_setall_f32(maxchansn);
+        v_float32x4 vxywt = v_setall_f32(xywt);
+        v_int32x4 vn = v_setall_s32(n);
+        v_int32x4 vx(x, x + 1, x + 2, x + 3), vfour = v_setall_s32(4);
+        for( ; x <= x2 - 4; x += 4, vx += vfour )
         {
-          CV_Assert( y < rows && x < cols && y >= 0 && x >= 0 );
-          distchans->at<float>(y,x) = 0;
-
-            switch ( chvec->at(0).depth() )
-            {
-              case CV_8U:
-                for( int b = 0; b < nr_channels; b++ )
-                {
-                  float diff = chvec->at(b).at<uchar>(y,x)
-                             - kseeds->at(b)[n];
-                  distchans->at<float>(y,x) += diff * diff;
-                }
-                break;
-
-              case CV_8S:
-                for( int b = 0; b < nr_channels; b++ )
-                {
-                  float diff = chvec->at(b).at<char>(y,x)
-                             - kseeds->at(b)[n];
-                  distchans->at<float>(y,x) += diff * diff;
-                }
-                break;
-
-              case CV_16U:
-                for( int b = 0; b < nr_channels; b++ )
-                {
-                  float diff = chvec->at(b).at<ushort>(y,x)
-                             - kseeds->at(b)[n];
-                  distchans->at<float>(y,x) += diff * diff;
-                }
-                break;
-
-              case CV_16S:
-                for( int b = 0; b < nr_channels; b++ )
-                {
-                  float diff = chvec->at(b).at<short>(y,x)
-                             - kseeds->at(b)[n];
-                  distchans->at<float>(y,x) += diff * diff;
-                }
-                break;
-
-              case CV_32S:
-                for( int b = 0; b < nr_channels; b++ )
-                {
-                  float diff = chvec->at(b).at<int>(y,x)
-                             - kseeds->at(b)[n];
-                  distchans->at<float>(y,x) += diff * diff;
-                }
-                break;
-
-              case CV_32F:
-                for( int b = 0; b < nr_channels; b++ )
-                {
-                  float diff = chvec->at(b).at<float>(y,x)
-                             - kseeds->at(b)[n];
-                  distchans->at<float>(y,x) += diff * diff;
-                }
-                break;
-
-              case CV_64F:
-                for( int b = 0; b < nr_channels; b++ )
-                {
-                  float diff = float(chvec->at(b).at<double>(y,x)
-                             - kseeds->at(b)[n]);
-                  distchans->at<float>(y,x) += diff * diff;
-                }
-                break;
+          v_float32x4 vchdist = v_load(pchdist + x);
+          v_float32x4 difx = v_cvt_f32(vx) - vseedx;
+          v_float32x4 vdistxy = difx*difx + vdify2;
+          v_float32x4 dist = vchdist / vmaxchans + vdistxy / vxywt;
+          v_float32x4 prev = v_load(pdistvec + x);
+          v_float32x4 upd = dist < prev;
+
+          if( pmask )
+          {
+            v_float32x4 m = v_reinterpret_as_f32(v_load_expand_q(pmask + x) != v_setall_u32(0));
+            upd = upd & m;
+            vchdist = v_select(m, vchdist, v_load(pdistchans + x));
+            vdistxy = v_select(m, vdistxy, v_load(pdistxy + x));
+          }
 
-              default:
-                CV_Error( Error::StsInternal, "Invalid matrix depth" );
-                break;
-            }
+          v_store(pdistchans + x, vchdist);
+          v_store(pdistxy + x, vdistxy);
+          v_store(pdistvec + x, v_select(upd, dist, prev));
+          v_store(plabels + x, v_select(v_reinterpret_as_s32(upd), vn, v_load(plabels + x)));
+        }
+#endif
+        for( ; x < x2; x++ )
+        {
+          if( pmask && !pmask[x] ) continue;
 
+          pdistchans[x] = pchdist[x];
 
           float difx = x - kseedsxn;
-          float dify = y - kseedsyn;
-          distxy->at<float>(y,x) = difx*difx + dify*dify;
+          pdistxy[x] = difx*difx + dify*dify;
 
           // only varying m, prettier superpixels
-          float dist = distchans->at<float>(y,x)
-                     / maxchansn + distxy->at<float>(y,x)/xywt;
+          float dist = pdistchans[x] / maxchansn + pdistxy[x] / xywt;
 
-          if( dist < distvec->at<float>(y,x) )
+          if( dist < pdistvec[x] )
           {
-            distvec->at<float>(y,x) = dist;
-            klabels->at<int>(y,x) = n;
+            pdistvec[x] = dist;
+            plabels[x] = n;
           }
         } // end for x
       } // end for y
@@ -1115,6 +1215,7 @@ struct SLICOGrowInvoker : ParallelLoopBody
     Mat *distchans, *distxy, *distvec;
     float kseedsxn, kseedsyn;
     int x1, x2, nr_channels, n;
+    const Mat* mask;
 };
 
 /*
@@ -1135,19 +1236,30 @@ struct SLICOGrowInvoker : ParallelLoopBody
  * not the step size S.
  *
  */
-inline void SuperpixelSLICImpl::PerformSLICO( const int&  itrnum )
+inline void SuperpixelSLICImpl::PerformSLICO( const int&  itrnum, const Mat& mask )
 {
-    Mat distxy( m_height, m_width, CV_32F, Scalar::all(FLT_MAX) );
     Mat distvec( m_height, m_width, CV_32F, Scalar::all(FLT_MAX) );
-    Mat distchans( m_height, m_width, CV_32F, Scalar::all(FLT_MAX) );
 
-    // this is the variable value of M, just start with 10
-    vector<float> maxchans( m_numlabels, FLT_MIN );
-    // this is the variable value of M, just start with 10
-    vector<float> maxxy( m_numlabels, FLT_MIN );
     // note: this is different from how usual SLIC/LKM works
     const float xywt = float(m_region_size*m_region_size);
 
+    // the distances of the pixels out of mask are kept from the previous frame
+    Mat dirtysum;
+    if( mask.empty() )
+    {
+        m_distxy.create( m_height, m_width, CV_32F );
+        m_distchans.create( m_height, m_width, CV_32F );
+        m_distxy.setTo(FLT_MAX);
+        m_distchans.setTo(FLT_MAX);
+
+        // this is the variable value of M, just start with 10
+        m_maxchans.assign( m_numlabels, FLT_MIN );
+        // this is the variable value of M, just start with 10
+        m_maxxy.assign( m_numlabels, FLT_MIN );
+    }
+    else
+        integral( mask, dirtysum, CV_32S );
+
     for( int itr = 0; itr < itrnum; itr++ )
     {
         distvec.setTo(FLT_MAX);
@@ -1158,46 +1270,27 @@ inline void SuperpixelSLICImpl::PerformSLICO( const int&  itrnum )
             int x1 = max(0, (int) m_kseedsx[n] - m_region_size);
             int x2 = min((int) m_width,(int) m_kseedsx[n] + m_region_size);
 
-            parallel_for_( Range(y1, y2), SLICOGrowInvoker( &m_chvec, &distchans, &distxy, &distvec,
-                           &m_klabels, m_kseedsx[n], m_kseedsy[n], xywt, maxchans[n], &m_kseeds,
-                           x1, x2, m_nr_channels, n ) );
+            if( !isWindowDirty( dirtysum, x1, x2, y1, y2 ) ) continue;
+
+            parallel_for_( Range(y1, y2), SLICOGrowInvoker( &m_chvec, &m_distchans, &m_distxy, &distvec,
+                           &m_klabels, m_kseedsx[n], m_kseedsy[n], xywt, m_maxchans[n], &m_kseeds,
+                           x1, x2, m_nr_channels, n, mask.empty() ? NULL : &mask ) );
         }
         //-----------------------------------------------------------------
         // Assign the max color distance for a cluster
         //-----------------------------------------------------------------
         if( itr == 0 )
         {
-            maxchans.assign(m_numlabels,FLT_MIN);
-            maxxy.assign(m_numlabels,FLT_MIN);
+            m_maxchans.assign(m_numlabels,FLT_MIN);
+            m_maxxy.assign(m_numlabels,FLT_MIN);
         }
 
-        for( int x = 0; x < m_width; x++ )
-        {
-          for( int y = 0; y < m_height; y++ )
-          {
-              int idx = m_klabels.at<int>(y,x);
-
-              if( maxchans[idx] < distchans.at<float>(y,x) )
-                  maxchans[idx] = distchans.at<float>(y,x);
+        UpdateMaxDistances();
 
-              if( maxxy[idx] < distxy.at<float>(y,x) )
-                  maxxy[idx] = distxy.at<float>(y,x);
-          }
-        }
         //-----------------------------------------------------------------
         // Recalculate the centroid and store in the seed values
         //-----------------------------------------------------------------
-
-        // parallel reduce structure
-        SeedsCenters sc( m_chvec, m_klabels, m_numlabels, m_nr_channels );
-
-        // accumulate center distances
-        parallel_reduce( BlockedRange(0, m_width), sc );
-
-        // normalize centers
-        parallel_for_( Range(0, m_numlabels), SeedNormInvoker( &m_kseeds, &sc.sigma,
-                       &sc.clustersize, &sc.sigmax, &sc.sigmay, &m_kseedsx, &m_kseedsy, m_nr_channels  ) );
-
+        UpdateSeedsFromLabels();
     }
 }
 
@@ -1206,7 +1299,7 @@ struct SLICGrowInvoker : ParallelLoopBody
     SLICGrowInvoker( vector<Mat>* _chvec, Mat* _distvec, Mat* _klabels,
                      float _kseedsxn, float _kseedsyn, float _xywt,
                      vector< vector<float> > *_kseeds, int _x1, int _x2,
-                     int _nr_channels, int _n )
+                     int _nr_channels, int _n, const Mat* _mask = NULL )
     {
       chvec = _chvec;
       distvec = _distvec;
@@ -1219,92 +1312,63 @@ struct SLICGrowInvoker : ParallelLoopBody
       n = _n;
       xywt = _xywt;
       nr_channels = _nr_channels;
+      mask = _mask;
     }
 
     void operator ()(const cv::Range& range) const
     {
+      if ( x2 <= x1 ) return;
+
+      vector<float> chdist( x2 - x1 );
+
       for (int y = range.start; y < range.end; ++y)
       {
-        for( int x = x1; x < x2; x++ )
+        computeRowChDist( *chvec, *kseeds, n, y, x1, x2 - x1, nr_channels, &chdist[0] );
+
+        const float* pchdist = &chdist[0] - x1;
+        float* pdistvec = distvec->ptr<float>(y);
+        int* plabels = klabels->ptr<int>(y);
+        const uchar* pmask = mask ? mask->ptr<uchar>(y) : NULL;
+
+        float dify = y - kseedsyn;
+        int x = x1;
+
+#if CV_SIMD128
+        v_float32x4 vseedx = v_setall_f32(kseedsxn);
+        v_float32x4 vdify2 = v_setall_f32(dify*dify);
+        v_float32x4 vxywt = v_setall_f32(xywt);
+        v_int32x4 vn = v_setall_s32(n);
+        v_int32x4 vx(x, x + 1, x + 2, x + 3), vfour = v_setall_s32(4);
+        for( ; x <= x2 - 4; x += 4, vx += vfour )
         {
-          float dist = 0;
+          v_float32x4 difx = v_cvt_f32(vx) - vseedx;
+          v_float32x4 dist = v_load(pchdist + x) + (difx*difx + vdify2) / vxywt;
+          v_float32x4 prev = v_load(pdistvec + x);
+          v_float32x4 upd = dist < prev;
 
-          switch ( chvec->at(0).depth() )
-          {
-            case CV_8U:
-              for( int b = 0; b < nr_channels; b++ )
-              {
-                float diff = chvec->at(b).at<uchar>(y,x) - kseeds->at(b)[n];
-                dist += diff * diff;
-              }
-              break;
-
-            case CV_8S:
-              for( int b = 0; b < nr_channels; b++ )
-              {
-                float diff = chvec->at(b).at<char>(y,x) - kseeds->at(b)[n];
-                dist += diff * diff;
-              }
-              break;
-
-            case CV_16U:
-              for( int b = 0; b < nr_channels; b++ )
-              {
-                float diff = chvec->at(b).at<ushort>(y,x) - kseeds->at(b)[n];
-                dist += diff * diff;
-              }
-              break;
-
-            case CV_16S:
-              for( int b = 0; b < nr_channels; b++ )
-              {
-                float diff = chvec->at(b).at<short>(y,x) - kseeds->at(b)[n];
-                dist += diff * diff;
-              }
-              break;
-
-            case CV_32S:
-              for( int b = 0; b < nr_channels; b++ )
-              {
-                float diff = chvec->at(b).at<int>(y,x) - kseeds->at(b)[n];
-                dist += diff * diff;
-              }
-              break;
-
-            case CV_32F:
-              for( int b = 0; b < nr_channels; b++ )
-              {
-                float diff = chvec->at(b).at<float>(y,x) - kseeds->at(b)[n];
-                dist += diff * diff;
-              }
-              break;
-
-            case CV_64F:
-              for( int b = 0; b < nr_channels; b++ )
-              {
-                float diff = float(chvec->at(b).at<double>(y,x) - kseeds->at(b)[n]);
-                dist += diff * diff;
-              }
-              break;
-
-            default:
-              CV_Error( Error::StsInternal, "Invalid matrix depth" );
-              break;
-          }
+          if( pmask )
+            upd = upd & v_reinterpret_as_f32(v_load_expand_q(pmask + x) != v_setall_u32(0));
+
+          v_store(pdistvec + x, v_select(upd, dist, prev));
+          v_store(plabels + x, v_select(v_reinterpret_as_s32(upd), vn, v_load(plabels + x)));
+        }
+#endif
+        for( ; x < x2; x++ )
+        {
+          if( pmask && !pmask[x] ) continue;
 
           float difx = x - kseedsxn;
-          float dify = y - kseedsyn;
           float distxy = difx*difx + dify*dify;
 
-          dist += distxy / xywt;
+          float dist = pchdist[x] + distxy / xywt;
 
           //this would be more exact but expensive
           //dist = sqrt(dist) + sqrt(distxy/xywt);
 
-          if( dist < distvec->at<float>(y,x) )
+          if( dist < pdistvec[x] )
           {
-            distvec->at<float>(y,x) = dist;
-            klabels->at<int>(y,x) = n;
+            pdistvec[x] = dist;
+            plabels[x] = n;
           }
         } //end for x
       } // end for y
@@ -1317,6 +1381,7 @@ struct SLICGrowInvoker : ParallelLoopBody
     Mat *distvec;
     float kseedsxn, kseedsyn;
     int x1, x2, nr_channels, n;
+    const Mat* mask;
 };
 
 /*
@@ -1326,12 +1391,16 @@ struct SLICGrowInvoker : ParallelLoopBody
  * over the entire image.
  *
  */
-inline void SuperpixelSLICImpl::PerformSLIC( const int&  itrnum )
+inline void SuperpixelSLICImpl::PerformSLIC( const int&  itrnum, const Mat& mask )
 {
     Mat distvec( m_height, m_width, CV_32F );
 
     const float xywt = (m_region_size/m_ruler)*(m_region_size/m_ruler);
 
+    Mat dirtysum;
+    if( !mask.empty() )
+        integral( mask, dirtysum, CV_32S );
+
     for( int itr = 0; itr < itrnum; itr++ )
     {
         distvec.setTo(FLT_MAX);
@@ -1342,34 +1411,138 @@ inline void SuperpixelSLICImpl::PerformSLIC( const int&  itrnum )
             int x1 = max(0, (int) m_kseedsx[n] - m_region_size);
             int x2 = min((int) m_width,(int) m_kseedsx[n] + m_region_size);
 
+            if( !isWindowDirty( dirtysum, x1, x2, y1, y2 ) ) continue;
+
             parallel_for_( Range(y1, y2), SLICGrowInvoker( &m_chvec, &distvec,
                            &m_klabels, m_kseedsx[n], m_kseedsy[n], xywt, &m_kseeds,
-                           x1, x2, m_nr_channels, n ) );
+                           x1, x2, m_nr_channels, n, mask.empty() ? NULL : &mask ) );
         }
 
         //-----------------------------------------------------------------
         // Recalculate the centroid and store in the seed values
         //-----------------------------------------------------------------
-        // instead of reassigning memory on each iteration, just reset.
+        UpdateSeedsFromLabels();
+    }
+}
 
-        // parallel reduce structure
-        SeedsCenters sc( m_chvec, m_klabels, m_numlabels, m_nr_channels );
+/*
+ * UpdateSeedsFromLabels
+ *
+ *   centroids of the current labels become the seeds
+ */
+inline void SuperpixelSLICImpl::UpdateSeedsFromLabels()
+{
+    // labels may be renumbered by enforceLabelConnectivity
+    m_kseedsx.resize( m_numlabels );
+    m_kseedsy.resize( m_numlabels );
+    for( int b = 0; b < m_nr_channels; b++ )
+      m_kseeds[b].resize( m_numlabels );
 
-        // accumulate center distances
-        parallel_reduce( BlockedRange(0, m_width), sc );
+    // instead of reassigning memory on each iteration, just reset.
 
-        // normalize centers
-        parallel_for_( Range(0, m_numlabels), SeedNormInvoker( &m_kseeds, &sc.sigma,
-                       &sc.clustersize, &sc.sigmax, &sc.sigmay, &m_kseedsx, &m_kseedsy, m_nr_channels  ) );
+    // parallel reduce structure
+    SeedsCenters sc( m_chvec, m_klabels, m_numlabels, m_nr_channels );
 
-    }
+    // accumulate center distances
+    parallel_reduce( BlockedRange(0, m_width), sc );
+
+    // normalize centers
+    parallel_for_( Range(0, m_numlabels), SeedNormInvoker( &m_kseeds, &sc.sigma,
+                   &sc.clustersize, &sc.sigmax, &sc.sigmay, &m_kseedsx, &m_kseedsy, m_nr_channels  ) );
 }
 
 /*
- *    PerformSuperpixelMSLIC
+ * UpdateMaxDistances
  *
+ *   max color and spatial distances of the clusters (SLICO)
+ */
+inline void SuperpixelSLICImpl::UpdateMaxDistances()
+{
+    for( int y = 0; y < m_height; y++ )
+    {
+      const int* plabels = m_klabels.ptr<int>(y);
+      const float* pdistchans = m_distchans.ptr<float>(y);
+      const float* pdistxy = m_distxy.ptr<float>(y);
+
+      for( int x = 0; x < m_width; x++ )
+      {
+          int idx = plabels[x];
+
+          if( m_maxchans[idx] < pdistchans[x] )
+              m_maxchans[idx] = pdistchans[x];
+
+          if( m_maxxy[idx] < pdistxy[x] )
+              m_maxxy[idx] = pdistxy[x];
+      }
+    }
+}
+
+/*
+ * updateFrame
  *
+ *   continues segmentation on the next frame of a video: the seeds are
+ *   kept from the previous frame and only pixels around changes are
+ *   assigned again
  */
+void SuperpixelSLICImpl::updateFrame( InputArray _image, int num_iterations, float change_threshold )
+{
+    vector<Mat> chvec;
+    if ( _image.isMat() )
+      split( _image.getMat(), chvec );
+    else if ( _image.isMatVector() )
+      _image.getMatVector( chvec );
+    else
+      CV_Error( Error::StsInternal, "Invalid InputArray." );
+
+    CV_Assert( (int) chvec.size() == m_nr_channels );
+    CV_Assert( chvec[0].size() == Size( m_width, m_height ) );
+    CV_Assert( chvec[0].depth() == m_chvec[0].depth() );
+    CV_Assert( num_iterations >= 0 && change_threshold >= 0 );
+
+    // the labels may be changed after the last iteration
+    if( m_algorithm != MSLIC )
+    {
+      UpdateSeedsFromLabels();
+
+      if( m_algorithm == SLICO && !m_distchans.empty() )
+      {
+        m_maxchans.assign( m_numlabels, FLT_MIN );
+        m_maxxy.assign( m_numlabels, FLT_MIN );
+        UpdateMaxDistances();
+      }
+    }
+
+    // L1 color difference to the previous frame
+    Mat diff, change = Mat::zeros( m_height, m_width, CV_32F );
+    for( int b = 0; b < m_nr_channels; b++ )
+    {
+      absdiff( chvec[b], m_chvec[b], diff );
+      add( change, diff, change, noArray(), CV_32F );
+    }
+
+    // changed pixels may move the seeds of all superpixels around them
+    Mat mask = change > change_threshold;
+    dilate( mask, mask, getStructuringElement( MORPH_RECT,
+            Size( 2*m_region_size + 1, 2*m_region_size + 1 ) ) );
+
+    m_chvec = chvec;
+    m_iterations = num_iterations;
+
+    if( m_algorithm == SLICO && !m_distchans.empty() )
+      PerformSLICO( num_iterations, mask );
+    else if( m_algorithm == SLICO )
+      PerformSLICO( num_iterations );
+    else if( m_algorithm == SLIC )
+      PerformSLIC( num_iterations, mask );
+    else if( m_algorithm == MSLIC )
+      PerformMSLIC( num_iterations );
+    else
+      CV_Error( Error::StsInternal, "No such algorithm" );
+
+    // re-update amount of labels
+    m_numlabels = (int)m_kseeds[0].size();
+}
+
 inline void SuperpixelSLICImpl::PerformMSLIC( const int&  itrnum )
 {
     vector< vector<float> > sigma(m_nr_channels);
@@ -80,10 +80,19 @@ protected:
     int match_num;
 
     //internal buffers:
-    vector<node>* g;
+    vector<int>  graph_offsets; // neighbors of match i are graph_nodes[graph_offsets[i]..graph_offsets[i+1]-1]
+    vector<node> graph_nodes;
     Mat labels;
     Mat NNlabels;
     Mat NNdistances;
+    Mat NNweights;
+
+    //state of the previous call, reused when the image and the matched positions do not change:
+    Mat cached_image;
+    Mat cached_cost_map;
+    float cached_lambda;
+    int cached_k;
+    vector<Point2f> cached_positions;
 
     //tunable parameters:
     float lambda;
@@ -101,7 +110,7 @@ protected:
     RNG rngs[ransac_num_stripes];
 
     void init();
-    void preprocessData(Mat& src, vector<SparseMatch>& matches);
+    void preprocessData(vector<SparseMatch>& matches);
     void computeGradientMagnitude(Mat& src, Mat& dst);
     void geodesicDistanceTransform(Mat& distances, Mat& cost_map);
     void buildGraph(Mat& distances, Mat& cost_map);
@@ -157,6 +166,8 @@ void EdgeAwareInterpolatorImpl::init()
     fgs_lambda    = 500.0f;
     fgs_sigma     = 1.5f;
     regularization_coef = 0.01f;
+    cached_lambda = -1.0f;
+    cached_k      = -1;
 }
 
 Ptr<EdgeAwareInterpolatorImpl> EdgeAwareInterpolatorImpl::create()
@@ -186,29 +197,47 @@ void EdgeAwareInterpolatorImpl::interpolate(InputArray from_image, InputArray fr
     CV_Assert(match_num<SHRT_MAX);
 
     Mat src = from_image.getMat();
-    labels = Mat(h,w,CV_16S);
-    labels = Scalar(-1);
-    NNlabels = Mat(match_num,k,CV_16S);
-    NNlabels = Scalar(-1);
-    NNdistances = Mat(match_num,k,CV_32F);
-    NNdistances = Scalar(0.0f);
-    g = new vector<node>[match_num];
+    vector<Point2f> positions(match_num);
+    for(int i=0;i<match_num;i++)
+        positions[i] = matches_vector[i].reference_image_pos;
 
-    preprocessData(src,matches_vector);
+    // the cost map only depends on the image, the geodesic graph and the nearest neighbors
+    // additionally depend on the matched positions in it (but not on the target positions):
+    bool same_image = !cached_image.empty() && cached_image.size()==src.size() && cached_image.type()==src.type() &&
+                      cached_lambda==lambda && norm(src,cached_image,NORM_INF)==0;
+    if(!same_image)
+    {
+        cached_cost_map.create(h,w,CV_32F);
+        computeGradientMagnitude(src,cached_cost_map);
+        cached_cost_map = (1000.0f-lambda) + lambda*cached_cost_map;
+        src.copyTo(cached_image);
+        cached_lambda = lambda;
+        cached_positions.clear();
+    }
+    if(!same_image || cached_k!=k || cached_positions!=positions)
+    {
+        preprocessData(matches_vector);
+        cached_positions = positions;
+        cached_k = k;
+    }
 
     dense_flow.create(from_image.size(),CV_32FC2);
     Mat dst = dense_flow.getMat();
     ransacInterpolation(matches_vector,dst);
     if(use_post_proc)
         fastGlobalSmootherFilter(src,dst,dst,fgs_lambda,fgs_sigma);
-
-    delete[] g;
 }
 
-void EdgeAwareInterpolatorImpl::preprocessData(Mat& src, vector<SparseMatch>& matches)
+void EdgeAwareInterpolatorImpl::preprocessData(vector<SparseMatch>& matches)
 {
+    labels = Mat(h,w,CV_16S);
+    labels = Scalar(-1);
+    NNlabels = Mat(match_num,k,CV_16S);
+    NNlabels = Scalar(-1);
+    NNdistances = Mat(match_num,k,CV_32F);
+    NNdistances = Scalar(0.0f);
+
     Mat distances(h,w,CV_32F);
-    Mat cost_map (h,w,CV_32F);
     distances = Scalar(INF);
 
     int x,y;
@@ -221,12 +250,13 @@ void EdgeAwareInterpolatorImpl::preprocessData(Mat& src, vector<SparseMatch>& ma
         labels.at<short>(y,x) = (short)i;
     }
 
-    computeGradientMagnitude(src,cost_map);
-    cost_map = (1000.0f-lambda) + lambda*cost_map;
+    geodesicDistanceTransform(distances,cached_cost_map);
+    buildGraph(distances,cached_cost_map);
 
-    geodesicDistanceTransform(distances,cost_map);
-    buildGraph(distances,cost_map);
-    parallel_for_(Range(0,getNumThreads()),GetKNNMatches_ParBody(*this,getNumThreads()));
+    // matches are sorted in raster order, so each stripe is a band of neighboring superpixels whose
+    // searches visit the same part of the graph; several stripes per thread balance the load:
+    int num_stripes = std::max(1,std::min(match_num,8*getNumThreads()));
+    parallel_for_(Range(0,num_stripes),GetKNNMatches_ParBody(*this,num_stripes));
 }
 
 void EdgeAwareInterpolatorImpl::computeGradientMagnitude(Mat& src, Mat& dst)
@@ -367,6 +397,7 @@ void EdgeAwareInterpolatorImpl::buildGraph(Mat& distances, Mat& cost_map)
     const float c2 = sqrt(2.0f)/2.0f;
     float d;
     bool found;
+    vector< vector<node> > g(match_num);
 
 #define CHECK(cur_dist,cur_label,cur_cost,prev_dist,prev_label,prev_cost,coef)\
     if(cur_label!=prev_label)\
@@ -445,6 +476,15 @@ void EdgeAwareInterpolatorImpl::buildGraph(Mat& distances, Mat& cost_map)
                 g[neighbors[j].label].push_back(node((short)i,neighbors[j].dist));
         }
     }
+
+    // store the graph in one contiguous array for the searches:
+    graph_offsets.resize(match_num+1);
+    graph_offsets[0] = 0;
+    for(i=0;i<match_num;i++)
+        graph_offsets[i+1] = graph_offsets[i] + (int)g[i].size();
+    graph_nodes.resize(graph_offsets[match_num]);
+    for(i=0;i<match_num;i++)
+        std::copy(g[i].begin(),g[i].end(),graph_nodes.begin()+graph_offsets[i]);
 }
 
 struct nodeHeap
@@ -474,10 +514,12 @@ struct nodeHeap
         delete[] heap_pos;
     }
 
+    // only the positions of the nodes left in the heap are non-zero, so clearing is O(size):
     void clear()
     {
+        for(short i=1;i<=size;i++)
+            heap_pos[heap[i].label] = 0;
         size=0;
-        memset(heap_pos,0,sizeof(short)*num_labels);
     }
 
     inline bool empty()
@@ -590,16 +632,17 @@ void EdgeAwareInterpolatorImpl::GetKNNMatches_ParBody::operator() (const Range&
     nodeHeap q((short)inst->match_num);
     int num_expanded_vertices;
     unsigned char* expanded_flag = new unsigned char[inst->match_num];
-    node* neighbors;
+    memset(expanded_flag,0,inst->match_num);
+    const int* offsets = &inst->graph_offsets.front();
+    const node* nodes = inst->graph_nodes.empty() ? 0 : &inst->graph_nodes.front();
+    const node* neighbors;
 
     for(int i=start;i<end;i++)
     {
-        if(inst->g[i].empty())
+        if(offsets[i]==offsets[i+1])
             continue;
 
         num_expanded_vertices = 0;
-        memset(expanded_flag,0,inst->match_num);
-        q.clear();
         q.add(node((short)i,0.0f));
         short* NNlabels_row    = inst->NNlabels.ptr<short>(i);
         float* NNdistances_row = inst->NNdistances.ptr<float>(i);
@@ -614,13 +657,19 @@ void EdgeAwareInterpolatorImpl::GetKNNMatches_ParBody::operator() (const Range&
             num_expanded_vertices++;
 
             //update the heap:
-            neighbors = &inst->g[vert_for_expansion.label].front();
-            for(int j=0;j<(int)inst->g[vert_for_expansion.label].size();j++)
+            neighbors = nodes + offsets[vert_for_expansion.label];
+            int num_neighbors = offsets[vert_for_expansion.label+1] - offsets[vert_for_expansion.label];
+            for(int j=0;j<num_neighbors;j++)
             {
                 if(!expanded_flag[neighbors[j].label])
                     q.updateNode(node(neighbors[j].label,vert_for_expansion.dist+neighbors[j].dist));
             }
         }
+
+        //reset only what this search touched instead of the whole buffers:
+        for(int j=0;j<num_expanded_vertices;j++)
+            expanded_flag[NNlabels_row[j]] = 0;
+        q.clear();
     }
     delete[] expanded_flag;
 }
@@ -760,13 +809,14 @@ void EdgeAwareInterpolatorImpl::RansacInterpolation_ParBody::operator() (const R
     int num_inliers;
     Point2f a,b;
 
+    const int* offsets = &inst->graph_offsets.front();
     for(int i=start;i!=end;i+=inc)
     {
-        if(inst->g[i].empty())
+        if(offsets[i]==offsets[i+1])
             continue;
 
         KNNlabels    = inst->NNlabels.ptr<short>(i);
-        KNNdistances = inst->NNdistances.ptr<float>(i);
+        KNNdistances = inst->NNweights.ptr<float>(i);
         if(inc>0) //forward pass
         {
             cv::hal::exp32f(KNNdistances,KNNdistances,inst->k);
@@ -792,8 +842,8 @@ void EdgeAwareInterpolatorImpl::RansacInterpolation_ParBody::operator() (const R
         }
 
         //propagate hypotheses from neighbors:
-        node* neighbors = &inst->g[i].front();
-        for(int j=0;j<(int)inst->g[i].size();j++)
+        const node* neighbors = &inst->graph_nodes[offsets[i]];
+        for(int j=0;j<offsets[i+1]-offsets[i];j++)
         {
             if((inc*neighbors[j].label)<(inc*i) && (inc*neighbors[j].label)>=(inc*start)) //already processed this neighbor
                 verifyHypothesis(KNNlabels,KNNdistances,inst->k,matches,eps[i],inst->regularization_coef,transforms[neighbors[j].label],transforms[i],weighted_inlier_nums[i]);
@@ -829,7 +879,8 @@ void EdgeAwareInterpolatorImpl::RansacInterpolation_ParBody::operator() (const R
 
 void EdgeAwareInterpolatorImpl::ransacInterpolation(vector<SparseMatch>& matches, Mat& dst_dense_flow)
 {
-    NNdistances *= (-sigma*sigma);
+    // NNdistances are kept intact for the next call, the weights are computed in a separate buffer:
+    NNdistances.convertTo(NNweights,CV_32F,-sigma*sigma);
 
     Mat* transforms = new Mat[match_num];
     float* weighted_inlier_nums = new float[match_num];
@@ -44,6 +44,8 @@
 #include <cmath>
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/hal.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include "advanced_types.hpp"
 
@@ -149,8 +151,41 @@ static cv::Mat rgb2luv(const cv::Mat &src)
     {
         const float *pSrc = src.ptr<float>(i);
         float *pDst = dst.ptr<float>(i);
+        int j = 0;
+
+#if CV_SIMD128
+        // the same arithmetic as below for 4 pixels, except of the table lookup
+        const v_float32x4 vmX0 = v_setall_f32(mX[0]), vmX1 = v_setall_f32(mX[1]), vmX2 = v_setall_f32(mX[2]);
+        const v_float32x4 vmY0 = v_setall_f32(mY[0]), vmY1 = v_setall_f32(mY[1]), vmY2 = v_setall_f32(mY[2]);
+        const v_float32x4 vmZ0 = v_setall_f32(mZ[0]), vmZ1 = v_setall_f32(mZ[1]), vmZ2 = v_setall_f32(mZ[2]);
+        const v_float32x4 v1024 = v_setall_f32(1024.0f), vtiny = v_setall_f32(1e-35f), vone = v_setall_f32(1.0f);
+        const v_float32x4 v15 = v_setall_f32(15.0f), v3 = v_setall_f32(3.0f);
+        const v_float32x4 v52 = v_setall_f32(13*4.0f), v117 = v_setall_f32(13*9.0f);
+        const v_float32x4 vun = v_setall_f32(13*un), vvn = v_setall_f32(13*vn);
+        const v_float32x4 vminu = v_setall_f32(minu), vminv = v_setall_f32(minv);
+
+        for (; j <= (src.cols - 4)*nchannels; j += 4*nchannels)
+        {
+            v_float32x4 r, g, b;
+            v_load_deinterleave(pSrc + j, r, g, b);
+
+            v_float32x4 x = vmX0*r + vmX1*g + vmX2*b;
+            v_float32x4 y = vmY0*r + vmY1*g + vmY2*b;
+            v_float32x4 z = vmZ0*r + vmZ1*g + vmZ2*b;
+            v_float32x4 nz = vone / (x + v15*y + v3*z + vtiny);
+
+            int CV_DECL_ALIGNED(16) idx[4];
+            v_store_aligned(idx, v_floor(v1024*y));
+            float CV_DECL_ALIGNED(16) lbuf[4] = {lTable[idx[0]], lTable[idx[1]], lTable[idx[2]], lTable[idx[3]]};
+            v_float32x4 l = v_load_aligned(lbuf);
+
+            v_float32x4 u = l*(v52*x*nz - vun) - vminu;
+            v_float32x4 v = l*(v117*y*nz - vvn) - vminv;
+            v_store_interleave(pDst + j, l, u, v);
+        }
+#endif
 
-        for (int j = 0; j < src.cols*nchannels; j += nchannels)
+        for (; j < src.cols*nchannels; j += nchannels)
         {
             const float rgb[] = {pSrc[j + 0], pSrc[j + 1], pSrc[j + 2]};
 
@@ -201,6 +236,9 @@ static void gradientHist(const cv::Mat &src, cv::Mat &magnitude, cv::Mat &histog
 
     int nchannels = src.channels();
 
+    // derivatives of the channel with the largest gradient, for the whole row
+    std::vector <float> rowDx(src.cols), rowDy(src.cols);
+
     for (int i = 0; i < src.rows; ++i)
     {
         const float *pDx = Dx.ptr<float>(i);
@@ -224,11 +262,20 @@ static void gradientHist(const cv::Mat &src, cv::Mat &magnitude, cv::Mat &histog
             }
 
             pMagnitude[j/nchannels] = sqrtf(fMagn);
+            rowDx[j/nchannels] = fdx;
+            rowDy[j/nchannels] = fdy;
+        }
 
-            float angle = cv::fastAtan2(fdy, fdx) / 180.0f - 1.0f * (fdy < 0);
+        // vectorized atan2 of the row
+        cv::hal::fastAtan2(&rowDy[0], &rowDx[0], pPhase, src.cols, true);
+
+        for (int j = 0; j < src.cols; ++j)
+        {
+            const float fdx = rowDx[j], fdy = rowDy[j];
+            float angle = pPhase[j] / 180.0f - 1.0f * (fdy < 0);
             if (std::fabs(fdx) + std::fabs(fdy) < 1e-5)
                 angle = 0.5f;
-            pPhase[j/nchannels] = angle;
+            pPhase[j] = angle;
         }
     }
 
@@ -406,6 +453,244 @@ Ptr<RFFeatureGetter> createRFFeatureGetter()
 }
 }
 
+/********************* Random forest evaluation *********************/
+
+namespace cv
+{
+namespace ximgproc
+{
+
+/*!
+ * Node of the flattened random forest. The feature of the node is addressed by
+ * its row and column (column is x*nchannels + channel) inside the feature patch,
+ * so all the data which is needed to go down the tree is kept together.
+ */
+struct RandomForestNode
+{
+    float threshold; /*!< features less than threshold go to child, other go to child + 1 */
+    int child;       /*!< absolute index of the left child, 0 for leaves */
+    short rowA;      /*!< position of the regular feature or of the first feature of pair */
+    short colA;
+    short rowB;      /*!< position of the second feature of self similarity pair, -1 for regular feature */
+    short colB;
+};
+
+/*!
+ * The function converts the trees from the model representation (tree relative
+ * childs and linear feature ids) to the flattened RandomForestNode array.
+ *
+ * \param nchannels : number of channels of the feature image
+ * \param patchSize : size of the feature patch (in the shrunk feature image)
+ * \param gridSize : number of self similarity cells
+ */
+static void flattenForest(const std::vector <int> &childs, const std::vector <int> &featureIds,
+                          const std::vector <float> &thresholds, const int nTreesNodes,
+                          const int nchannels, const int patchSize, const int gridSize,
+                          std::vector <RandomForestNode> &nodes)
+{
+    const int nFeatures = CV_SQR(patchSize)*nchannels;
+
+    // positions of the self similarity pairs, in the order of the feature ids
+    int hc = cvRound( patchSize / (2.0*gridSize) );
+    std::vector <int> gridPositions;
+    for(int i = 0; i < gridSize; i++)
+        gridPositions.push_back( int( (i+1)*(patchSize + 2*hc - 1)/(gridSize + 1.0) - hc + 0.5f ) );
+
+    std::vector <Vec4s> pairs;
+    for (int i = 0; i < CV_SQR(gridSize)*nchannels; ++i)
+        for (int j = (i%CV_SQR(gridSize)) + 1; j < CV_SQR(gridSize); ++j)
+        {
+            int z = i / CV_SQR(gridSize);
+
+            int x1 = gridPositions[i%CV_SQR(gridSize)%gridSize];
+            int y1 = gridPositions[i%CV_SQR(gridSize)/gridSize];
+
+            int x2 = gridPositions[j%gridSize];
+            int y2 = gridPositions[j/gridSize];
+
+            pairs.push_back( Vec4s( (short)x1, (short)(y1*nchannels + z), (short)x2, (short)(y2*nchannels + z) ) );
+        }
+
+    nodes.resize(childs.size());
+    for (size_t n = 0; n < childs.size(); ++n)
+    {
+        RandomForestNode &node = nodes[n];
+        node.threshold = thresholds[n];
+        node.rowA = node.colA = 0;
+        node.rowB = node.colB = -1;
+
+        if (childs[n] == 0)
+        {
+            node.child = 0;
+            continue;
+        }
+
+        int baseNode = int(n) / nTreesNodes * nTreesNodes;
+        node.child = baseNode + childs[n] - 1;
+
+        int id = featureIds[n];
+        if (id >= nFeatures)
+        {
+            CV_Assert( id - nFeatures < (int)pairs.size() );
+            const Vec4s &pair = pairs[id - nFeatures];
+            node.rowA = pair[0];
+            node.colA = pair[1];
+            node.rowB = pair[2];
+            node.colB = pair[3];
+        }
+        else
+        {
+            int z = id / CV_SQR(patchSize);
+            int y = ( id % CV_SQR(patchSize) )/patchSize;
+            int x = ( id % CV_SQR(patchSize) )%patchSize;
+
+            node.rowA = (short)x;
+            node.colA = (short)(y*nchannels + z);
+        }
+    }
+}
+
+/*!
+ * The class evaluating the trees for the rows of patch locations. The trees of
+ * several locations are traversed together, one level per iteration, so the
+ * memory accesses of the different trees overlap.
+ */
+class RandomForestInvoker : public cv::ParallelLoopBody
+{
+public:
+    RandomForestInvoker(const std::vector <RandomForestNode> &_nodes, const Mat &_regFeatures,
+                        const Mat &_ssFeatures, Mat &_indexes, int _nTrees, int _nTreesEval,
+                        int _nTreesNodes, int _stride, int _shrink)
+        : nodes(_nodes), regFeatures(_regFeatures), ssFeatures(_ssFeatures), indexes(_indexes),
+          nTrees(_nTrees), nTreesEval(_nTreesEval), nTreesNodes(_nTreesNodes), stride(_stride),
+          shrink(_shrink) {}
+
+    void operator()(const cv::Range &range) const
+    {
+        enum { BATCH = 16 };
+
+        const int nchannels = regFeatures.channels();
+        const int rowStep = regFeatures.cols*nchannels;
+        const int width = indexes.cols;
+        const int count = width*nTreesEval;
+        const RandomForestNode *tree = &nodes[0];
+
+        for (int i = range.start; i < range.end; ++i)
+        {
+            const float *regFeaturesPtr = regFeatures.ptr<float>(i*stride/shrink);
+            const float  *ssFeaturesPtr = ssFeatures.ptr<float>(i*stride/shrink);
+
+            int *indexPtr = indexes.ptr<int>(i);
+
+            for (int first = 0; first < count; first += BATCH)
+            {
+                // for j,k in [0;width)x[0;nTreesEval), index = j*nTreesEval + k
+                const int n = std::min(int(BATCH), count - first);
+                int currentNode[BATCH], offset[BATCH];
+
+                for (int l = 0; l < n; ++l)
+                {
+                    int j = (first + l) / nTreesEval, k = (first + l) % nTreesEval;
+                    // select root node of the tree to evaluate
+                    currentNode[l] = ( ((i + j)%(2*nTreesEval) + k)%nTrees )*nTreesNodes;
+                    offset[l] = (j*stride/shrink)*nchannels;
+                }
+
+                for (bool active = true; active; )
+                {
+                    active = false;
+                    for (int l = 0; l < n; ++l)
+                    {
+                        const RandomForestNode &node = tree[currentNode[l]];
+                        if (node.child == 0)
+                            continue;
+
+                        float currentFeature;
+                        if (node.rowB >= 0)
+                            currentFeature = ssFeaturesPtr[offset[l] + node.rowA*rowStep + node.colA]
+                                           - ssFeaturesPtr[offset[l] + node.rowB*rowStep + node.colB];
+                        else
+                            currentFeature = regFeaturesPtr[offset[l] + node.rowA*rowStep + node.colA];
+
+                        // compare feature to threshold and move left or right accordingly
+                        currentNode[l] = node.child + (currentFeature < node.threshold ? 0 : 1);
+                        active = true;
+                    }
+                }
+
+                for (int l = 0; l < n; ++l)
+                    indexPtr[first + l] = currentNode[l];
+            }
+        }
+    }
+
+private:
+    RandomForestInvoker &operator=(const RandomForestInvoker &);
+
+    const std::vector <RandomForestNode> &nodes;
+    const Mat &regFeatures;
+    const Mat &ssFeatures;
+    Mat &indexes;
+    const int nTrees, nTreesEval, nTreesNodes, stride, shrink;
+};
+
+/*!
+ * The class accumulating the edge maps of the leaves. The rows of patch
+ * locations i run over phase + m*t, so the inner patches of a range do not intersect.
+ */
+class EdgeAccumulationInvoker : public cv::ParallelLoopBody
+{
+public:
+    EdgeAccumulationInvoker(const Mat &_indexes, const std::vector <int> &_edgeBoundaries,
+                            const std::vector <int> &_edgeBins, const std::vector <int> &_offsetE,
+                            Mat &_dstM, int _nTreesEval, int _stride, int _phase, int _m, float _step)
+        : indexes(_indexes), edgeBoundaries(_edgeBoundaries), edgeBins(_edgeBins), offsetE(_offsetE),
+          dstM(_dstM), nTreesEval(_nTreesEval), stride(_stride), phase(_phase), m(_m), step(_step) {}
+
+    void operator()(const cv::Range &range) const
+    {
+        const int width = indexes.cols;
+        const int outNum = dstM.channels();
+
+        for (int t = range.start; t < range.end; ++t)
+        {
+            const int i = phase + t*m;
+            const int *pIndex = indexes.ptr<int>(i);
+            float *pDst = dstM.ptr<float>(i*stride);
+
+            for (int j = 0, k = 0; j < width; ++k, j += !(k %= nTreesEval))
+            {// for j,k in [0;width)x[0;nTreesEval)
+
+                int currentNode = pIndex[j*nTreesEval + k];
+
+                int start  = edgeBoundaries[currentNode];
+                int finish = edgeBoundaries[currentNode + 1];
+
+                if (start == finish)
+                    continue;
+
+                int offset = j*stride*outNum;
+                for (int p = start; p < finish; ++p)
+                    pDst[offset + offsetE[edgeBins[p]]] += step;
+            }
+        }
+    }
+
+private:
+    EdgeAccumulationInvoker &operator=(const EdgeAccumulationInvoker &);
+
+    const Mat &indexes;
+    const std::vector <int> &edgeBoundaries;
+    const std::vector <int> &edgeBins;
+    const std::vector <int> &offsetE;
+    Mat &dstM;
+    const int nTreesEval, stride, phase, m;
+    const float step;
+};
+
+}
+}
+
 /********************* StructuredEdgeDetection class *********************/
 
 namespace cv
@@ -515,6 +800,11 @@ public:
         }
 
         __rf.numberOfTreeNodes = int( __rf.childs.size() ) / __rf.options.numberOfTrees;
+
+        flattenForest( __rf.childs, __rf.featureIds, __rf.thresholds, __rf.numberOfTreeNodes,
+            __rf.options.numberOfOutputChannels,
+            __rf.options.patchSize/__rf.options.shrinkNumber,
+            __rf.options.selfsimilarityGridSize, __rf.nodes );
     }
 
     /*!
@@ -665,7 +955,6 @@ protected:
         const int nchannels = features.channels();
         int pSize  = __rf.options.patchSize;
 
-        int nFeatures = CV_SQR(pSize/shrink)*nchannels;
         int outNum = __rf.options.numberOfOutputChannels;
 
         int stride = __rf.options.stride;
@@ -683,16 +972,15 @@ protected:
 
         NChannelsMat indexes(height, width, CV_MAKETYPE(DataType<int>::type, nTreesEval));
 
-        std::vector <int> offsetI(/**/ CV_SQR(pSize/shrink)*nchannels, 0);
-        for (int i = 0; i < CV_SQR(pSize/shrink)*nchannels; ++i)
+        // the flattened forest is built for the feature channels of the model
+        std::vector <RandomForestNode> otherNodes;
+        const std::vector <RandomForestNode> *nodes = &__rf.nodes;
+        if (nchannels != outNum)
         {
-            int z = i / CV_SQR(pSize/shrink);
-            int y = ( i % CV_SQR(pSize/shrink) )/(pSize/shrink);
-            int x = ( i % CV_SQR(pSize/shrink) )%(pSize/shrink);
-
-            offsetI[i] = x*features.cols*nchannels + y*nchannels + z;
+            flattenForest( __rf.childs, __rf.featureIds, __rf.thresholds, nTreesNodes,
+                nchannels, pSize/shrink, gridSize, otherNodes );
+            nodes = &otherNodes;
         }
-        // lookup table for mapping linear index to offsets
 
         std::vector <int> offsetE(/**/ CV_SQR(ipSize)*outNum, 0);
         for (int i = 0; i < CV_SQR(ipSize)*outNum; ++i)
@@ -705,105 +993,22 @@ protected:
         }
         // lookup table for mapping linear index to offsets
 
-        std::vector <int> offsetX( CV_SQR(gridSize)*(CV_SQR(gridSize) - 1)/2 * nchannels, 0);
-        std::vector <int> offsetY( CV_SQR(gridSize)*(CV_SQR(gridSize) - 1)/2 * nchannels, 0);
-
-        int hc = cvRound( (pSize/shrink) / (2.0*gridSize) );
-        // half of cell
-        std::vector <int> gridPositions;
-        for(int i = 0; i < gridSize; i++)
-            gridPositions.push_back( int( (i+1)*(pSize/shrink + 2*hc - 1)/(gridSize + 1.0) - hc + 0.5f ) );
-
-        for (int i = 0, n = 0; i < CV_SQR(gridSize)*nchannels; ++i)
-            for (int j = (i%CV_SQR(gridSize)) + 1; j < CV_SQR(gridSize); ++j, ++n)
-            {
-                int z = i / CV_SQR(gridSize);
-
-                int x1 = gridPositions[i%CV_SQR(gridSize)%gridSize];
-                int y1 = gridPositions[i%CV_SQR(gridSize)/gridSize];
-
-                int x2 = gridPositions[j%gridSize];
-                int y2 = gridPositions[j/gridSize];
-
-                offsetX[n] = x1*features.cols*nchannels + y1*nchannels + z;
-                offsetY[n] = x2*features.cols*nchannels + y2*nchannels + z;
-            }
-            // lookup tables for mapping linear index to offset pairs
-        #ifdef _OPENMP
-        #pragma omp parallel for
-        #endif
-        for (int i = 0; i < height; ++i)
-        {
-            float *regFeaturesPtr = regFeatures.ptr<float>(i*stride/shrink);
-            float  *ssFeaturesPtr = ssFeatures.ptr<float>(i*stride/shrink);
-
-            int *indexPtr = indexes.ptr<int>(i);
-
-            for (int j = 0, k = 0; j < width; ++k, j += !(k %= nTreesEval))
-                // for j,k in [0;width)x[0;nTreesEval)
-            {
-                int baseNode = ( ((i + j)%(2*nTreesEval) + k)%nTrees )*nTreesNodes;
-                int currentNode = baseNode;
-                // select root node of the tree to evaluate
-
-                int offset = (j*stride/shrink)*nchannels;
-                while ( __rf.childs[currentNode] != 0 )
-                {
-                    int currentId = __rf.featureIds[currentNode];
-                    float currentFeature;
-
-                    if (currentId >= nFeatures)
-                    {
-                        int xIndex = offsetX[currentId - nFeatures];
-                        float A = ssFeaturesPtr[offset + xIndex];
-
-                        int yIndex = offsetY[currentId - nFeatures];
-                        float B = ssFeaturesPtr[offset + yIndex];
-
-                        currentFeature = A - B;
-                    }
-                    else
-                        currentFeature = regFeaturesPtr[offset + offsetI[currentId]];
-
-                    // compare feature to threshold and move left or right accordingly
-                    if (currentFeature < __rf.thresholds[currentNode])
-                        currentNode = baseNode + __rf.childs[currentNode] - 1;
-                    else
-                        currentNode = baseNode + __rf.childs[currentNode];
-                }
-
-                indexPtr[j*nTreesEval + k] = currentNode;
-            }
-        }
+        cv::parallel_for_( cv::Range(0, height), RandomForestInvoker(*nodes, regFeatures, ssFeatures,
+            indexes, nTrees, nTreesEval, nTreesNodes, stride, shrink) );
 
         NChannelsMat dstM(dst.size(),
             CV_MAKETYPE(DataType<float>::type, outNum));
         dstM.setTo(0);
 
+        // the inner patches of the locations i and i + m don't intersect, all the summands are
+        // equal, so the result doesn't depend on the order of summation
         float step = 2.0f * CV_SQR(stride) / CV_SQR(ipSize) / nTreesEval;
-        #ifdef _OPENMP
-        #pragma omp parallel for
-        #endif
-        for (int i = 0; i < height; ++i)
+        const int m = (ipSize + stride - 1) / stride;
+        for (int phase = 0; phase < std::min(m, height); ++phase)
         {
-            int *pIndex = indexes.ptr<int>(i);
-            float *pDst = dstM.ptr<float>(i*stride);
-
-                for (int j = 0, k = 0; j < width; ++k, j += !(k %= nTreesEval))
-                {// for j,k in [0;width)x[0;nTreesEval)
-
-                    int currentNode = pIndex[j*nTreesEval + k];
-
-                    int start  = __rf.edgeBoundaries[currentNode];
-                    int finish = __rf.edgeBoundaries[currentNode + 1];
-
-                    if (start == finish)
-                        continue;
-
-                    int offset = j*stride*outNum;
-                    for (int p = start; p < finish; ++p)
-                        pDst[offset + offsetE[__rf.edgeBins[p]]] += step;
-                }
+            cv::parallel_for_( cv::Range(0, (height - phase + m - 1) / m),
+                EdgeAccumulationInvoker(indexes, __rf.edgeBoundaries, __rf.edgeBins, offsetE, dstM,
+                    nTreesEval, stride, phase, m, step) );
         }
 
         cv::reduce( dstM.reshape(1, int( dstM.total() ) ), dstM, 2, CV_REDUCE_SUM);
@@ -865,6 +1070,8 @@ protected:
 
         std::vector <int> edgeBoundaries; /*!< ... */
         std::vector <int> edgeBins;       /*!< ... */
+
+        std::vector <RandomForestNode> nodes; /*!< flattened trees for the evaluation */
     } __rf;
 };
 
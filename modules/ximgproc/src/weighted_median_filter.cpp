@@ -394,26 +394,40 @@ void featureIndexing(Mat &F, float **&wMap, int &nF, float sigmaI, int weightTyp
     F = FNew;
 }
 
-Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, Mat mask=Mat())
+/***************************************************************
+ * Class: FilterCore_ParBody
+ * Description: filtering of a range of image columns, the joint-histogram is
+ *                built independently for each column, so the columns are
+ *                processed in parallel, each range with its own histograms.
+ ***************************************************************/
+class FilterCore_ParBody : public ParallelLoopBody
 {
-    // Check validation
-    assert(I.depth() == CV_32S && I.channels()==1);//input image: 32SC1
-    assert(F.depth() == CV_32S && F.channels()==1);//feature image: 32SC1
+public:
+    FilterCore_ParBody(const Mat &I_, const Mat &F_, float **wMap_, int r_, int nF_, int nI_,
+                       const Mat &mask_, Mat &outImg_)
+        : I(I_), F(F_), wMap(wMap_), r(r_), nF(nF_), nI(nI_), mask(mask_), outImg(outImg_) {}
 
-    // Configuration and declaration
-    int rows = I.rows, cols = I.cols;
-    Mat outImg = I.clone();
+    void operator () (const Range& range) const;
 
-    // Handle Mask
-    if(mask.empty())
-    {
-        mask = Mat(I.size(),CV_8U);
-        mask = Scalar(1);
-    }
+private:
+    FilterCore_ParBody &operator=(const FilterCore_ParBody &);
+
+    const Mat &I;
+    const Mat &F;
+    float **wMap;
+    int r, nF, nI;
+    const Mat &mask;
+    Mat &outImg;
+};
+
+void FilterCore_ParBody::operator () (const Range& range) const
+{
+    int rows = I.rows, cols = I.cols;
 
     // Allocate memory for joint-histogram and BCB
     int **H = int2D(nI,nF);
     int *BCB = new int[nF];
+    memset(H[0], 0, sizeof(int)*nF*nI);
 
     // Allocate links for necklace table
     int **Hf = int2D(nI,nF);//forward link
@@ -422,11 +436,11 @@ Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, M
     int *BCBb = new int[nF];//backward link
 
     // Column Scanning
-    for(int x=0;x<cols;x++)
+    for(int x=range.start;x<range.end;x++)
     {
         // Reset histogram and BCB for each column
+        // (the joint-histogram is already empty, see the end of the column)
         memset(BCB, 0, sizeof(int)*nF);
-        memset(H[0], 0, sizeof(int)*nF*nI);
         for(int i=0;i<nI;i++)Hf[i][0]=Hb[i][0]=0;
         BCBf[0]=BCBb[0]=0;
 
@@ -441,9 +455,9 @@ Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, M
         int upY = min(rows-1,r);
         for(int i=0;i<=upY;i++)
         {
-            int *IPtr = I.ptr<int>(i);
-            int *FPtr = F.ptr<int>(i);
-            uchar *maskPtr = mask.ptr<uchar>(i);
+            const int *IPtr = I.ptr<int>(i);
+            const int *FPtr = F.ptr<int>(i);
+            const uchar *maskPtr = mask.ptr<uchar>(i);
 
             for(int j=downX;j<=upX;j++)
             {
@@ -554,9 +568,9 @@ Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, M
             int rownum = y + r + 1;
             if(rownum < rows)
             {
-                    int *inputImgPtr = I.ptr<int>(rownum);
-                    int *guideImgPtr = F.ptr<int>(rownum);
-                    uchar *maskPtr = mask.ptr<uchar>(rownum);
+                    const int *inputImgPtr = I.ptr<int>(rownum);
+                    const int *guideImgPtr = F.ptr<int>(rownum);
+                    const uchar *maskPtr = mask.ptr<uchar>(rownum);
 
                     for(int j=downX;j<=upX;j++)
                     {
@@ -590,9 +604,9 @@ Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, M
                 rownum = y - r;
                 if(rownum >= 0)
                 {
-                    int *inputImgPtr = I.ptr<int>(rownum);
-                    int *guideImgPtr = F.ptr<int>(rownum);
-                    uchar *maskPtr = mask.ptr<uchar>(rownum);
+                    const int *inputImgPtr = I.ptr<int>(rownum);
+                    const int *guideImgPtr = F.ptr<int>(rownum);
+                    const uchar *maskPtr = mask.ptr<uchar>(rownum);
 
                     for(int j=downX;j<=upX;j++)
                     {
@@ -620,6 +634,21 @@ Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, M
                     }
                 }
         }
+
+        // Remove the pixels of the last window from the joint-histogram, it is cheaper
+        // than clearing the whole nI x nF histogram for the next column
+        for(int i=max(0,rows-r);i<rows;i++)
+        {
+            const int *IPtr = I.ptr<int>(i);
+            const int *FPtr = F.ptr<int>(i);
+            const uchar *maskPtr = mask.ptr<uchar>(i);
+
+            for(int j=downX;j<=upX;j++)
+            {
+                if(maskPtr[j])
+                    H[IPtr[j]][FPtr[j]] = 0;
+            }
+        }
     }
 
     // Deallocate the memory
@@ -631,6 +660,26 @@ Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, M
         int2D_release(Hf);
         int2D_release(Hb);
     }
+}
+
+Mat filterCore(Mat &I, Mat &F, float **wMap, int r=20, int nF=256, int nI=256, Mat mask=Mat())
+{
+    // Check validation
+    assert(I.depth() == CV_32S && I.channels()==1);//input image: 32SC1
+    assert(F.depth() == CV_32S && F.channels()==1);//feature image: 32SC1
+
+    // Configuration and declaration
+    Mat outImg = I.clone();
+
+    // Handle Mask
+    if(mask.empty())
+    {
+        mask = Mat(I.size(),CV_8U);
+        mask = Scalar(1);
+    }
+
+    // Column Scanning
+    parallel_for_(Range(0, I.cols), FilterCore_ParBody(I, F, wMap, r, nF, nI, mask, outImg));
 
     // end of the function
     return outImg;
@@ -93,6 +93,35 @@ TEST(AdaptiveManifoldTest, SplatSurfaceAccuracy)
     }
 }
 
+TEST(AdaptiveManifoldTest, TiledSplatSurfaceAccuracy)
+{
+    RNG rnd(0);
+
+    for (int i = 0; i < 3; i++)
+    {
+        Size sz(rnd.uniform(512, 1024), rnd.uniform(512, 1024));
+
+        int guideCn = rnd.uniform(1, 8);
+        Mat guide(sz, CV_MAKE_TYPE(CV_32F, guideCn));
+        randu(guide, 0, 1);
+
+        Scalar surfaceValue;
+        int srcCn = rnd.uniform(1, 4);
+        rnd.fill(surfaceValue, RNG::UNIFORM, 0, 255);
+        Mat src(sz, CV_MAKE_TYPE(CV_8U, srcCn), surfaceValue);
+
+        Ptr<AdaptiveManifoldFilter> amf = createAMFilter(rnd.uniform(1.0, 50.0), rnd.uniform(0.1, 0.9), false);
+        amf->setTileSize(rnd.uniform(128, 256));
+
+        Mat res;
+        amf->filter(src, res, guide);
+
+        EXPECT_EQ(sz, res.size());
+        double normInf = cvtest::norm(src, res, NORM_INF);
+        EXPECT_EQ(normInf, 0);
+    }
+}
+
 TEST(AdaptiveManifoldTest, AuthorsReferenceAccuracy)
 {
     String srcImgPath = "cv/edgefilter/kodim23.png";
@@ -191,6 +191,7 @@ namespace
         CV_IMPL_PROPERTY(int, PCAIterations, num_pca_iterations_)
         CV_IMPL_PROPERTY(bool, AdjustOutliers, adjust_outliers_)
         CV_IMPL_PROPERTY(bool, UseRNG, useRNG)
+        CV_IMPL_PROPERTY(int, TileSize, tile_size_)
 
     protected:
         bool adjust_outliers_;
@@ -199,6 +200,7 @@ namespace
         int tree_height_;
         int num_pca_iterations_;
         bool useRNG;
+        int tile_size_;
 
     private:
         void buildManifoldsAndPerformFiltering(const Mat_<Point3f>& eta_k, const Mat_<uchar>& cluster_k, int current_tree_level);
@@ -227,6 +229,7 @@ namespace
         num_pca_iterations_ = 1;
         adjust_outliers_ = false;
         useRNG = true;
+        tile_size_ = 0;
     }
 
     void AdaptiveManifoldFilterRefImpl::collectGarbage()
@@ -23,3 +23,22 @@ TEST(ximgproc_AnisotropicDiffusion, regression)
     //printf("psnr=%.2f\n", adiff_psnr);
     ASSERT_GT(adiff_psnr, 25.0);
 }
+
+TEST(ximgproc_AnisotropicDiffusion, UMatAccuracy)
+{
+    string folder = string(cvtest::TS::ptr()->get_data_path()) + "cv/shared/";
+    string original_path = folder + "fruits.png";
+
+    Mat original = imread(original_path, IMREAD_COLOR);
+
+    ASSERT_FALSE(original.empty()) << "Could not load input image " << original_path;
+
+    // not a multiple of the iterations fused by one OpenCL launch
+    int niters = 10;
+    Mat result;
+    UMat uresult;
+    ximgproc::anisotropicDiffusion(original, result, 1.0f, 0.02f, niters);
+    ximgproc::anisotropicDiffusion(original.getUMat(ACCESS_READ), uresult, 1.0f, 0.02f, niters);
+
+    ASSERT_GT(cvtest::PSNR(result, uresult.getMat(ACCESS_READ)), 50.0);
+}
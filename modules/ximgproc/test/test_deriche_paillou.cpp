@@ -0,0 +1,65 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+using namespace cv;
+using namespace cv::ximgproc;
+
+namespace {
+
+// the X gradient of an image is the transposed Y gradient of the transposed image, the columns and
+// the rows being filtered by different code paths; odd sizes leave remainders to both
+TEST(ximgproc_GradientDeriche, transposeSymmetry)
+{
+    RNG rng(0);
+    Mat src(67, 93, CV_8UC3);
+    rng.fill(src, RNG::UNIFORM, 0, 256);
+
+    Mat dx, dyT, srcT;
+    transpose(src, srcT);
+    GradientDericheX(src, dx, 1.0, 1.0);
+    GradientDericheY(srcT, dyT, 1.0, 1.0);
+    ASSERT_EQ(CV_32FC3, dx.type());
+
+    Mat dy;
+    transpose(dyT, dy);
+    EXPECT_LE(cvtest::norm(dx, dy, NORM_INF), 1e-3 * cvtest::norm(dx, NORM_INF));
+}
+
+TEST(ximgproc_GradientPaillou, transposeSymmetry)
+{
+    RNG rng(0);
+    Mat src(93, 67, CV_16UC1);
+    rng.fill(src, RNG::UNIFORM, 0, 4096);
+
+    Mat dx, dyT, srcT;
+    transpose(src, srcT);
+    GradientPaillouX(src, dx, 1.0, 0.1);
+    GradientPaillouY(srcT, dyT, 1.0, 0.1);
+    ASSERT_EQ(CV_32FC1, dx.type());
+
+    Mat dy;
+    transpose(dyT, dy);
+    EXPECT_LE(cvtest::norm(dx, dy, NORM_INF), 1e-3 * cvtest::norm(dx, NORM_INF));
+}
+
+TEST(ximgproc_GradientDeriche, stepEdge)
+{
+    Mat src(40, 64, CV_8UC1, Scalar(0));
+    src.colRange(32, 64).setTo(Scalar(200));
+
+    Mat dx;
+    GradientDericheX(src, dx, 1.0, 1.0);
+
+    // the largest response of every row lies on the edge
+    for (int y = 0; y < dx.rows; y++)
+    {
+        Point maxLoc;
+        minMaxLoc(cv::abs(dx.row(y)), NULL, NULL, NULL, &maxLoc);
+        EXPECT_TRUE(maxLoc.x == 31 || maxLoc.x == 32) << "row " << y << " max at " << maxLoc.x;
+    }
+}
+
+}
@@ -150,5 +150,56 @@ TEST_P(DisparityWLSFilterTest, MultiThreadReproducibility)
         EXPECT_LE(cv::norm(resSingleThread, resMultiThread, NORM_L1), MAX_MEAN_DIF*left.total());
     }
 }
+
+TEST_P(DisparityWLSFilterTest, StreamingMode)
+{
+    RNG rng(0);
+
+    DisparityWLSParams params = GetParam();
+    Size size          = get<0>(params);
+    int srcType        = get<1>(params);
+    int guideType      = get<2>(params);
+    bool use_conf      = get<3>(params);
+    bool use_downscale = get<4>(params);
+
+    int max_disp = (int)(size.width*0.1);
+    Rect ROI(max_disp,0,size.width-max_disp,size.height);
+    Mat left(size, guideType);
+    randu(left, 0, 255);
+
+    Ptr<DisparityWLSFilter> streaming_filter = createDisparityWLSFilterGeneric(use_conf);
+    streaming_filter->setStreamingMode(true);
+    ASSERT_TRUE(streaming_filter->getStreamingMode());
+
+    for (int frame = 0; frame < 4; frame++)
+    {
+        // a moving object in the guide, the last frame has a new sigma:
+        Rect object(rng.uniform(0,size.width/2),rng.uniform(0,size.height/2),size.width/4,size.height/4);
+        Mat(left,object) = Scalar::all(rng.uniform(0,255));
+        double sigma = frame < 3 ? 1.5 : 0.8;
+
+        Mat left_disp(size,srcType), right_disp(size,srcType);
+        randu(left_disp, 0, 16*max_disp-1);
+        randu(right_disp, -16*max_disp+1, 0);
+        Rect disp_ROI = ROI;
+        if(use_downscale)
+        {
+            resize(left_disp,left_disp,Size(),0.5,0.5);
+            resize(right_disp,right_disp,Size(),0.5,0.5);
+            disp_ROI = Rect(ROI.x/2,ROI.y/2,ROI.width/2,ROI.height/2);
+        }
+
+        streaming_filter->setSigmaColor(sigma);
+        Mat res;
+        streaming_filter->filter(left_disp,left,res,right_disp,disp_ROI);
+
+        Ptr<DisparityWLSFilter> ref_filter = createDisparityWLSFilterGeneric(use_conf);
+        ref_filter->setSigmaColor(sigma);
+        Mat ref;
+        ref_filter->filter(left_disp,left,ref,right_disp,disp_ROI);
+
+        EXPECT_EQ(0, cv::norm(res, ref, NORM_INF));
+    }
+}
 INSTANTIATE_TEST_CASE_P(FullSet,DisparityWLSFilterTest,Combine(Values(szODD, szQVGA), SrcTypes::all(), GuideTypes::all(),Values(true,false),Values(true,false)));
 }
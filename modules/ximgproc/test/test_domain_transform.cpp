@@ -219,6 +219,26 @@ TEST(DomainTransformTest, BoxFilter_NC_accuracy)
     EXPECT_LE(cv::norm(res_dt, res_box, NORM_L2), MAX_DIF*src.total());
 }
 
+TEST(DomainTransformTest, UMatAccuracy)
+{
+    RNG rng(0);
+    Size sz = szVGA;
+    Mat guide = randomMat(rng, sz, CV_8UC3, 0, 255, true);
+    Mat src = randomMat(rng, sz, CV_32FC3, 0, 255, true);
+
+    int modes[] = { DTF_NC, DTF_RF };
+    for (int i = 0; i < 2; i++)
+    {
+        Mat res;
+        UMat ures;
+        Ptr<DTFilter> dtf = createDTFilter(guide, 40, 30, modes[i]);
+        dtf->filter(src, res);
+        dtf->filter(src.getUMat(ACCESS_READ), ures);
+
+        EXPECT_LE(cv::norm(res, ures.getMat(ACCESS_READ), NORM_INF), 1e-2);
+    }
+}
+
 TEST(DomainTransformTest, AuthorReferenceAccuracy)
 {
     string dir = getOpenCVExtraDir() + "cv/edgefilter";
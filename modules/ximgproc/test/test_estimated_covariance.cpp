@@ -0,0 +1,87 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+using namespace cv;
+using namespace cv::ximgproc;
+
+namespace {
+
+// the sums of the products of the window elements over all the window positions
+static Mat covarianceReference(const Mat& src, int pr, int pc)
+{
+    int n = pr*pc;
+    Mat ref = Mat::zeros(n, n, CV_64FC2);
+    std::vector<std::complex<double> > w(n);
+    for (int i = 0; i + pr <= src.rows; i++)
+        for (int j = 0; j + pc <= src.cols; j++)
+        {
+            for (int c = 0; c < pc; c++)
+                for (int r = 0; r < pr; r++)
+                    w[pr*c + r] = std::complex<double>(src.at<std::complex<float> >(i + r, j + c));
+            for (int p = 0; p < n; p++)
+                for (int q = 0; q < n; q++)
+                    ref.at<std::complex<double> >(p, q) += w[p]*w[q];
+        }
+    return ref;
+}
+
+static void checkCovariance(const Mat& src, int pr, int pc)
+{
+    Mat res;
+    covarianceEstimation(src, res, pr, pc);
+    ASSERT_EQ(CV_32FC2, res.type());
+    ASSERT_EQ(Size(pr*pc, pr*pc), res.size());
+
+    Mat ref = covarianceReference(src, pr, pc), res64;
+    res.convertTo(res64, CV_64F);
+    EXPECT_LE(cvtest::norm(res64, ref, NORM_INF), 1e-5 * cvtest::norm(ref, NORM_INF))
+        << "window " << pr << "x" << pc << ", image " << src.size();
+}
+
+TEST(ximgproc_CovarianceEstimation, accuracy)
+{
+    RNG rng(0);
+    const Size sizes[] = { Size(13, 9), Size(40, 31), Size(5, 7) };
+    const Size windows[] = { Size(1, 1), Size(3, 2), Size(4, 5), Size(5, 7) };
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+        for (size_t j = 0; j < sizeof(windows)/sizeof(windows[0]); j++)
+        {
+            if (windows[j].width > sizes[i].width || windows[j].height > sizes[i].height)
+                continue;
+            Mat src(sizes[i], CV_32FC2);
+            rng.fill(src, RNG::UNIFORM, -1, 1);
+            checkCovariance(src, windows[j].height, windows[j].width);
+        }
+}
+
+// real images get a zero imaginary part; the window of the image size gives one sample
+TEST(ximgproc_CovarianceEstimation, realInput)
+{
+    RNG rng(1);
+    Mat src(6, 8, CV_8UC1);
+    rng.fill(src, RNG::UNIFORM, 0, 256);
+
+    Mat src2;
+    Mat planes[] = { Mat_<float>(src), Mat::zeros(src.size(), CV_32F) };
+    merge(planes, 2, src2);
+    checkCovariance(src2, 6, 8);
+
+    Mat res, res2;
+    covarianceEstimation(src, res, 3, 4);
+    covarianceEstimation(src2, res2, 3, 4);
+    EXPECT_EQ(0, cvtest::norm(res, res2, NORM_INF));
+}
+
+// wide enough to be correlated in several bands
+TEST(ximgproc_CovarianceEstimation, bands)
+{
+    RNG rng(2);
+    Mat src(300, 2000, CV_32FC2);
+    rng.fill(src, RNG::UNIFORM, -1, 1);
+    checkCovariance(src, 3, 3);
+}
+
+} // namespace
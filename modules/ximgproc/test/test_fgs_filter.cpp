@@ -106,6 +106,24 @@ TEST(FastGlobalSmootherTest, ReferenceAccuracy)
     EXPECT_LE(cvtest::norm(res, ref, NORM_INF), 1);
 }
 
+TEST(FastGlobalSmootherTest, UMatAccuracy)
+{
+    RNG rnd(0);
+    Size sz(rnd.uniform(300, 600), rnd.uniform(300, 600));
+
+    Mat guide(sz, CV_8UC3), src(sz, CV_32FC3);
+    randu(guide, 0, 255);
+    randu(src, 0, 255);
+
+    Mat res;
+    UMat ures;
+    Ptr<FastGlobalSmootherFilter> fgs = createFastGlobalSmootherFilter(guide, 1000.0, 10.0);
+    fgs->filter(src, res);
+    fgs->filter(src.getUMat(ACCESS_READ), ures);
+
+    EXPECT_LE(cvtest::norm(res, ures.getMat(ACCESS_READ), NORM_INF), 1e-2);
+}
+
 TEST_P(FastGlobalSmootherTest, MultiThreadReproducibility)
 {
     if (cv::getNumberOfCPUs() == 1)
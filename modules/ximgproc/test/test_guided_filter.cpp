@@ -428,6 +428,35 @@ TEST_P(GuidedFilterTest, smallParamsIssue)
     EXPECT_LE(whiteRate, 0.1);
 }
 
+TEST(GuidedFilterStrips, equalToGuidedFilter)
+{
+    RNG rng(42);
+    Size sz(97, 253);
+    int guideTypes[] = { CV_8UC1, CV_8UC3, CV_32FC3 };
+    int srcTypes[] = { CV_8UC1, CV_32FC1, CV_8UC3 };
+    int radii[] = { 0, 3, 20, 70 };
+    int stripHeights[] = { 1, 16, 100 };
+
+    for (int t = 0; t < 3; t++)
+    {
+        Mat guide(sz, guideTypes[t]), src(sz, srcTypes[t]);
+        rng.fill(guide, RNG::UNIFORM, 0, 255);
+        rng.fill(src, RNG::UNIFORM, 0, 255);
+
+        for (int r = 0; r < 4; r++)
+            for (int s = 0; s < 3; s++)
+            {
+                Mat res, resRef;
+                guidedFilter(guide, src, resRef, radii[r], 100.0, CV_32F);
+                guidedFilterStrips(guide, src, res, radii[r], 100.0, CV_32F, stripHeights[s]);
+
+                ASSERT_EQ(resRef.type(), res.type());
+                EXPECT_LE(cv::norm(res, resRef, NORM_INF), 1e-2)
+                    << "radius=" << radii[r] << " stripHeight=" << stripHeights[s];
+            }
+    }
+}
+
 INSTANTIATE_TEST_CASE_P(TypicalSet, GuidedFilterTest,
     Combine(
     Values(1, 3),
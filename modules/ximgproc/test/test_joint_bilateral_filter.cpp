@@ -284,4 +284,53 @@ INSTANTIATE_TEST_CASE_P(Set1, JointBilateralFilterTest_BilateralRef,
     )
 );
 
+typedef tuple<string, int> JBFFastParams;
+typedef TestWithParam<JBFFastParams> JointBilateralFilterTest_Fast;
+
+TEST_P(JointBilateralFilterTest_Fast, ExactRef)
+{
+    JBFFastParams param = GetParam();
+    double sigmaS       = 8.0;
+    double sigmaC       = 30.0;
+    string srcPath      = get<0>(param);
+    int jointType       = get<1>(param);
+
+    Mat src = imread(getOpenCVExtraDir() + srcPath);
+    ASSERT_TRUE(!src.empty());
+    Mat joint = convertTypeAndSize(src, jointType, src.size());
+
+    cv::setNumThreads(cv::getNumberOfCPUs());
+
+    Mat resRef;
+    jointBilateralFilter(joint, src, resRef, 0, sigmaC, sigmaS, BORDER_DEFAULT, JBF_EXACT);
+
+    Mat res;
+    jointBilateralFilter(joint, src, res, 0, sigmaC, sigmaS, BORDER_DEFAULT, JBF_FAST);
+
+    ASSERT_EQ(src.type(), res.type());
+    ASSERT_EQ(src.size(), res.size());
+    EXPECT_GE(PSNR(res, resRef), 25.0);
+}
+
+TEST_P(JointBilateralFilterTest_Fast, ConstantImage)
+{
+    JBFFastParams param = GetParam();
+    int jointType       = get<1>(param);
+
+    Mat joint(Size(97, 61), jointType, Scalar::all(100));
+    Mat src(joint.size(), CV_8UC3, Scalar(10, 20, 30));
+
+    Mat res;
+    jointBilateralFilter(joint, src, res, 0, 10.0, 5.0, BORDER_DEFAULT, JBF_FAST);
+
+    EXPECT_LE(cvtest::norm(res, src, NORM_INF), 1.0);
+}
+
+INSTANTIATE_TEST_CASE_P(Set1, JointBilateralFilterTest_Fast,
+    Combine(
+    Values("/cv/shared/lena.png"),
+    Values(CV_8UC1, CV_8UC3)
+    )
+);
+
 }
@@ -163,6 +163,28 @@ TEST_P(RollingGuidanceFilterTest, MultiThreadReproducibility)
     }
 }
 
+TEST_P(RollingGuidanceFilterTest, UMatAccuracy)
+{
+    RGFParams params = GetParam();
+    double sigmaS   = get<0>(params);
+    int depth       = get<1>(params);
+    int srcCn       = get<2>(params);
+
+    Mat src = imread(getOpenCVExtraDir() + "cv/shared/pic2.png");
+    ASSERT_TRUE(!src.empty());
+    src = convertTypeAndSize(src, CV_MAKE_TYPE(depth, srcCn), src.size());
+
+    double sigmaC = 30.0;
+    int iterNum = 4;
+
+    Mat res;
+    UMat ures;
+    rollingGuidanceFilter(src, res, -1, sigmaC, sigmaS, iterNum);
+    rollingGuidanceFilter(src.getUMat(ACCESS_READ), ures, -1, sigmaC, sigmaS, iterNum);
+
+    checkSimilarity(ures.getMat(ACCESS_READ), res);
+}
+
 INSTANTIATE_TEST_CASE_P(TypicalSet1, RollingGuidanceFilterTest,
     Combine(
     Values(2.0, 5.0),
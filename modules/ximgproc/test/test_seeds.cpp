@@ -0,0 +1,57 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+using namespace cv;
+using namespace cv::ximgproc;
+
+namespace {
+
+static Mat createFrame()
+{
+    Mat frame(Size(640, 480), CV_8UC3, Scalar(40, 80, 120));
+    rectangle(frame, Rect(60, 40, 200, 160), Scalar(200, 30, 30), -1);
+    circle(frame, Point(420, 300), 110, Scalar(20, 220, 60), -1);
+    RNG rng(0);
+    Mat noise(frame.size(), frame.type());
+    rng.fill(noise, RNG::UNIFORM, 0, 20);
+    add(frame, noise, frame);
+    return frame;
+}
+
+static Mat computeLabels(const Mat& frame, int threads)
+{
+    int prevThreads = getNumThreads();
+    setNumThreads(threads);
+
+    Ptr<SuperpixelSEEDS> seeds = createSuperpixelSEEDS(frame.cols, frame.rows, frame.channels(), 400, 4);
+    seeds->iterate(frame, 4);
+
+    Mat labels;
+    seeds->getLabels(labels);
+
+    setNumThreads(prevThreads);
+
+    double minVal = 0, maxVal = 0;
+    minMaxLoc(labels, &minVal, &maxVal);
+    EXPECT_GE(minVal, 0);
+    EXPECT_LT(maxVal, seeds->getNumberOfSuperpixels());
+
+    return labels.clone();
+}
+
+TEST(SuperpixelSEEDSTest, SameLabelsForAnyNumberOfThreads)
+{
+    Mat frame = createFrame();
+
+    Mat single = computeLabels(frame, 1);
+    Mat multi = computeLabels(frame, getNumberOfCPUs());
+
+    ASSERT_EQ(CV_32SC1, single.type());
+    ASSERT_EQ(frame.size(), single.size());
+    EXPECT_EQ(0, cvtest::norm(single, multi, NORM_INF));
+}
+
+} // namespace
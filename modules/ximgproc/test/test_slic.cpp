@@ -0,0 +1,72 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+using namespace cv;
+using namespace cv::ximgproc;
+
+namespace {
+
+static Mat createFrame(int shift)
+{
+    Mat frame(Size(160, 120), CV_8UC3, Scalar(40, 80, 120));
+    rectangle(frame, Rect(10, 10, 50, 40), Scalar(200, 30, 30), -1);
+    circle(frame, Point(100 + shift, 70), 25, Scalar(20, 220, 60), -1);
+    return frame;
+}
+
+static void checkLabels(const Ptr<SuperpixelSLIC>& slic, Size size)
+{
+    Mat labels;
+    slic->getLabels(labels);
+    ASSERT_EQ(CV_32SC1, labels.type());
+    ASSERT_EQ(size, labels.size());
+
+    double minVal = 0, maxVal = 0;
+    minMaxLoc(labels, &minVal, &maxVal);
+    EXPECT_GE(minVal, 0);
+    EXPECT_LT(maxVal, slic->getNumberOfSuperpixels());
+}
+
+typedef testing::TestWithParam<int> SuperpixelSLICTest;
+
+TEST_P(SuperpixelSLICTest, UpdateFrameOnStaticScene)
+{
+    // MSLIC always runs over the whole frame
+    if (GetParam() == MSLIC)
+        return;
+
+    Mat frame = createFrame(0);
+    Ptr<SuperpixelSLIC> slic = createSuperpixelSLIC(frame, GetParam(), 10);
+    slic->iterate(5);
+
+    Mat before;
+    slic->getLabels(before);
+    before = before.clone();
+
+    slic->updateFrame(frame);
+
+    Mat after;
+    slic->getLabels(after);
+    EXPECT_EQ(0, cvtest::norm(before, after, NORM_INF));
+}
+
+TEST_P(SuperpixelSLICTest, UpdateFrameOnMovingObject)
+{
+    Ptr<SuperpixelSLIC> slic = createSuperpixelSLIC(createFrame(0), GetParam(), 10);
+    slic->iterate(5);
+    slic->enforceLabelConnectivity();
+
+    for (int shift = 4; shift <= 16; shift += 4)
+    {
+        Mat frame = createFrame(shift);
+        slic->updateFrame(frame);
+        checkLabels(slic, frame.size());
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(ximgproc, SuperpixelSLICTest, testing::Values((int)SLIC, (int)SLICO, (int)MSLIC));
+
+} // namespace
@@ -183,6 +183,14 @@ TEST_P(InterpolatorTest, MultiThreadReproducibility)
         Mat resMultiThread;
         interpolator->interpolate(from,from_points,Mat(),to_points,resMultiThread);
 
+        // a new instance, the same one would reuse the graph and the neighbors of the previous call:
+        interpolator = createEdgeAwareInterpolator();
+        interpolator->setK(K);
+        interpolator->setSigma(sigma);
+        interpolator->setUsePostProcessing(true);
+        interpolator->setFGSLambda(FGSlambda);
+        interpolator->setFGSSigma(FGSsigma);
+
         cv::setNumThreads(1);
         Mat resSingleThread;
         interpolator->interpolate(from,from_points,Mat(),to_points,resSingleThread);
@@ -191,5 +199,50 @@ TEST_P(InterpolatorTest, MultiThreadReproducibility)
         EXPECT_LE(cv::norm(resSingleThread, resMultiThread, NORM_L1) , MAX_MEAN_DIF*resMultiThread.total());
     }
 }
+
+TEST_P(InterpolatorTest, ReusedGraph)
+{
+    RNG rng(0);
+
+    InterpolatorParams params = GetParam();
+    Size size       = get<0>(params);
+    int guideType   = get<1>(params);
+
+    Mat from(size, guideType);
+    randu(from, 0, 255);
+
+    int num_matches = 2000;
+    vector<Point2f> from_points;
+    vector<Point2f> to_points1, to_points2, to_points3;
+    for(int i=0;i<num_matches;i++)
+    {
+        from_points.push_back(Point2f(rng.uniform(0.01f,(float)size.width-1.01f),rng.uniform(0.01f,(float)size.height-1.01f)));
+        to_points1.push_back(from_points.back() + Point2f(rng.uniform(-2.0f,2.0f),rng.uniform(-2.0f,2.0f)));
+        to_points2.push_back(from_points.back() + Point2f(rng.uniform(-4.0f,4.0f),rng.uniform(-4.0f,4.0f)));
+    }
+    vector<Point2f> from_points3(from_points.begin(),from_points.end()-1);
+    to_points3.assign(to_points2.begin(),to_points2.end()-1);
+
+    Ptr<EdgeAwareInterpolator> interpolator = createEdgeAwareInterpolator();
+    interpolator->setK(32);
+    Mat res;
+    interpolator->interpolate(from,from_points,Mat(),to_points1,res);
+
+    // the same image and positions with new targets, then a change of the positions:
+    Mat res2, res3;
+    interpolator->interpolate(from,from_points,Mat(),to_points2,res2);
+    interpolator->interpolate(from,from_points3,Mat(),to_points3,res3);
+
+    Ptr<EdgeAwareInterpolator> ref_interpolator = createEdgeAwareInterpolator();
+    ref_interpolator->setK(32);
+    Mat ref2, ref3;
+    ref_interpolator->interpolate(from,from_points,Mat(),to_points2,ref2);
+    ref_interpolator = createEdgeAwareInterpolator();
+    ref_interpolator->setK(32);
+    ref_interpolator->interpolate(from,from_points3,Mat(),to_points3,ref3);
+
+    EXPECT_EQ(0, cv::norm(res2, ref2, NORM_INF));
+    EXPECT_EQ(0, cv::norm(res3, ref3, NORM_INF));
+}
 INSTANTIATE_TEST_CASE_P(FullSet,InterpolatorTest, Combine(Values(szODD,szVGA), GuideTypes::all()));
 }
\ No newline at end of file
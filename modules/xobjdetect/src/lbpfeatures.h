@@ -71,6 +71,9 @@ public:
     virtual float operator()(int featureIdx)
     { return (float)features[featureIdx].calc( cur_sum ); }
     virtual void writeFeatures( cv::FileStorage &fs, const cv::Mat& featureMap ) const;
+    // the first of the 3x3 blocks of the feature, relative to the window
+    cv::Rect getFeatureRect(int featureIdx) const
+    { return features[featureIdx].rect; }
 protected:
     virtual void generateFeatures();
 
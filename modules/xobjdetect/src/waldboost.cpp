@@ -43,6 +43,7 @@ the use of this software, even if advised of the possibility of such damage.
 */
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv {
 namespace xobjdetect {
@@ -118,66 +119,215 @@ std::vector<int> WaldBoost::get_feature_indices()
     return feature_indices_;
 }
 
-void WaldBoost::detect(Ptr<CvFeatureEvaluator> eval,
-            const Mat& img, const std::vector<float>& scales,
-            std::vector<Rect>& bboxes, Mat1f& confidences)
+// LBP code of a window, as CvLBPEvaluator::Feature::calc with the points p
+static inline uchar lbpCode(const int* psum, const int* p)
 {
-    bboxes.clear();
-    confidences.release();
+    int cval = psum[p[5]] - psum[p[6]] - psum[p[9]] + psum[p[10]];
+
+    return (uchar)((psum[p[0]] - psum[p[1]] - psum[p[4]] + psum[p[5]] >= cval ? 128 : 0) |   // 0
+        (psum[p[1]] - psum[p[2]] - psum[p[5]] + psum[p[6]] >= cval ? 64 : 0) |    // 1
+        (psum[p[2]] - psum[p[3]] - psum[p[6]] + psum[p[7]] >= cval ? 32 : 0) |    // 2
+        (psum[p[6]] - psum[p[7]] - psum[p[10]] + psum[p[11]] >= cval ? 16 : 0) |  // 5
+        (psum[p[10]] - psum[p[11]] - psum[p[14]] + psum[p[15]] >= cval ? 8 : 0) | // 8
+        (psum[p[9]] - psum[p[10]] - psum[p[13]] + psum[p[14]] >= cval ? 4 : 0) |  // 7
+        (psum[p[8]] - psum[p[9]] - psum[p[12]] + psum[p[13]] >= cval ? 2 : 0) |   // 6
+        (psum[p[4]] - psum[p[5]] - psum[p[8]] + psum[p[9]] >= cval ? 1 : 0));     // 3
+}
 
-    Mat resized_img;
-    int step = 4;
-    float h;
-    for (size_t i = 0; i < scales.size(); ++i) {
-        float scale = scales[i];
-        resize(img, resized_img, Size(), scale, scale);
-        eval->setImage(resized_img, 0, 0, feature_indices_);
-        int n_rows = (int)(24 / scale);
-        int n_cols = (int)(24 / scale);
-        for (int r = 0; r + 24 < resized_img.rows; r += step) {
-            for (int c = 0; c + 24 < resized_img.cols; c += step) {
-                //eval->setImage(resized_img(Rect(c, r, 24, 24)), 0, 0);
-                eval->setWindow(Point(c, r));
-                if (predict(eval, &h) == +1) {
-                    int row = (int)(r / scale);
-                    int col = (int)(c / scale);
-                    bboxes.push_back(Rect(col, row, n_cols, n_rows));
-                    confidences.push_back(h);
+#if CV_SIMD128
+// LBP codes of the windows at psum, psum + 4, psum + 8 and psum + 12
+static inline v_int32x4 lbpCode4(const int* psum, const int* p)
+{
+    v_int32x4 s[16], unused;
+    for (int k = 0; k < 16; ++k)
+        v_load_deinterleave(psum + p[k], s[k], unused, unused, unused);
+
+    v_int32x4 cval = s[5] - s[6] - s[9] + s[10];
+    return (((s[0] - s[1] - s[4] + s[5]) >= cval) & v_setall_s32(128)) |
+        (((s[1] - s[2] - s[5] + s[6]) >= cval) & v_setall_s32(64)) |
+        (((s[2] - s[3] - s[6] + s[7]) >= cval) & v_setall_s32(32)) |
+        (((s[6] - s[7] - s[10] + s[11]) >= cval) & v_setall_s32(16)) |
+        (((s[10] - s[11] - s[14] + s[15]) >= cval) & v_setall_s32(8)) |
+        (((s[9] - s[10] - s[13] + s[14]) >= cval) & v_setall_s32(4)) |
+        (((s[8] - s[9] - s[12] + s[13]) >= cval) & v_setall_s32(2)) |
+        (((s[4] - s[5] - s[8] + s[9]) >= cval) & v_setall_s32(1));
+}
+#endif
+
+/* Evaluates the cascade on the windows of the scales in parallel. The first weak classifiers
+ * are evaluated on four neighbouring windows at once, the windows still alive after them are
+ * compacted and finish the cascade one by one. The results are the same as predict().
+ */
+class WaldBoostScalesInvoker : public ParallelLoopBody
+{
+public:
+    WaldBoostScalesInvoker(const Mat& _img, const std::vector<float>& _scales, const std::vector<Rect>& _featureRects,
+                           const std::vector<float>& _thresholds, const std::vector<float>& _alphas,
+                           const std::vector<int>& _polarities, const std::vector<float>& _cascadeThresholds,
+                           std::vector< std::vector<Rect> >& _bboxes, std::vector< std::vector<float> >& _confidences) :
+        img(_img), scales(_scales), featureRects(_featureRects), thresholds(_thresholds), alphas(_alphas),
+        polarities(_polarities), cascadeThresholds(_cascadeThresholds), bboxes(_bboxes), confidences(_confidences)
+    {}
+
+    void operator()(const Range& range) const
+    {
+        const int count = (int)featureRects.size();
+        const int step = 4;
+        // number of weak classifiers evaluated on groups of windows
+        const int groupCount = std::min(count, 16);
+        Mat resized_img, sum;
+        AutoBuffer<int> _points(16 * count);
+        int* points = _points;
+        std::vector<int> alive_cols;
+        std::vector<float> alive_res;
+
+        for (int si = range.start; si < range.end; ++si) {
+            float scale = scales[si];
+            resize(img, resized_img, Size(), scale, scale);
+            integral(resized_img, sum, CV_32S);
+            const int offset = int(sum.ptr<int>(1) - sum.ptr<int>());
+            for (int i = 0; i < count; ++i) {
+                int* p = points + 16 * i;
+                Rect rect = featureRects[i], tr = rect;
+                CV_SUM_OFFSETS( p[0], p[1], p[4], p[5], tr, offset )
+                tr.x += 2*rect.width;
+                CV_SUM_OFFSETS( p[2], p[3], p[6], p[7], tr, offset )
+                tr.y +=2*rect.height;
+                CV_SUM_OFFSETS( p[10], p[11], p[14], p[15], tr, offset )
+                tr.x -= 2*rect.width;
+                CV_SUM_OFFSETS( p[8], p[9], p[12], p[13], tr, offset )
+            }
+
+            int n_rows = (int)(24 / scale);
+            int n_cols = (int)(24 / scale);
+            float h;
+            for (int r = 0; r + 24 < resized_img.rows; r += step) {
+                const int* psum = sum.ptr<int>(r);
+                int c = 0;
+                alive_cols.clear();
+                alive_res.clear();
+#if CV_SIMD128
+                const v_float32x4 zero = v_setzero_f32();
+                for (; c + 3 * step + 24 < resized_img.cols; c += 4 * step) {
+                    v_float32x4 res = zero;
+                    v_float32x4 alive = v_reinterpret_as_f32(v_setall_s32(-1));
+                    for (int i = 0; i < groupCount; ++i) {
+                        v_float32x4 val = v_cvt_f32(lbpCode4(psum + c, points + 16 * i));
+                        v_float32x4 positive = (v_setall_f32((float)polarities[i]) * (val - v_setall_f32(thresholds[i]))) > zero;
+                        res += v_select(positive, v_setall_f32(alphas[i]), v_setall_f32(-alphas[i]));
+                        alive = alive & ~(res < v_setall_f32(cascadeThresholds[i]));
+                        if (v_signmask(alive) == 0)
+                            break;
+                    }
+                    int mask = v_signmask(alive);
+                    if (mask == 0)
+                        continue;
+                    float lanes[4];
+                    v_store(lanes, res);
+                    for (int l = 0; l < 4; ++l) {
+                        if (mask & (1 << l)) {
+                            alive_cols.push_back(c + l * step);
+                            alive_res.push_back(lanes[l]);
+                        }
+                    }
+                }
+#endif
+                for (size_t k = 0; k < alive_cols.size(); ++k) {
+                    if (finish(psum + alive_cols[k], points, groupCount, alive_res[k], &h))
+                        push(alive_cols[k], r, scale, n_cols, n_rows, h, si);
+                }
+                for (; c + 24 < resized_img.cols; c += step) {
+                    if (finish(psum + c, points, 0, 0.f, &h))
+                        push(c, r, scale, n_cols, n_rows, h, si);
                 }
             }
         }
     }
-    groupRectangles(bboxes, 3, 0.7);
-}
 
-void WaldBoost::detect(Ptr<CvFeatureEvaluator> eval,
+private:
+    // continue the cascade of a window from the weak classifier start
+    bool finish(const int* psum, const int* points, int start, float res, float *h) const
+    {
+        const int count = (int)featureRects.size();
+        for (int i = start; i < count; ++i) {
+            float val = (float)lbpCode(psum, points + 16 * i);
+            int label = polarities[i] * (val - thresholds[i]) > 0 ? +1: -1;
+            res += alphas[i] * label;
+            if (res < cascadeThresholds[i]) {
+                return false;
+            }
+        }
+        *h = res;
+        return res > cascadeThresholds[count - 1];
+    }
+
+    void push(int c, int r, float scale, int n_cols, int n_rows, float h, int si) const
+    {
+        int row = (int)(r / scale);
+        int col = (int)(c / scale);
+        bboxes[si].push_back(Rect(col, row, n_cols, n_rows));
+        confidences[si].push_back(h);
+    }
+
+    const Mat& img;
+    const std::vector<float>& scales;
+    const std::vector<Rect>& featureRects;
+    const std::vector<float>& thresholds;
+    const std::vector<float>& alphas;
+    const std::vector<int>& polarities;
+    const std::vector<float>& cascadeThresholds;
+    std::vector< std::vector<Rect> >& bboxes;
+    std::vector< std::vector<float> >& confidences;
+
+    WaldBoostScalesInvoker& operator=(const WaldBoostScalesInvoker&);
+};
+
+void WaldBoost::detectWindows(Ptr<CvFeatureEvaluator> eval,
             const Mat& img, const std::vector<float>& scales,
-            std::vector<Rect>& bboxes, std::vector<double>& confidences)
+            std::vector<Rect>& bboxes, std::vector<float>& confidences) const
 {
+    CV_Assert(img.type() == CV_8UC1);
+    CV_Assert(weak_count_ > 0 && feature_indices_.size() == size_t(weak_count_));
+    Ptr<CvLBPEvaluator> lbp = eval.dynamicCast<CvLBPEvaluator>();
+    CV_Assert(!lbp.empty());
+
+    std::vector<Rect> featureRects(weak_count_);
+    for (int i = 0; i < weak_count_; ++i)
+        featureRects[i] = lbp->getFeatureRect(feature_indices_[i]);
+
+    std::vector< std::vector<Rect> > scaleBboxes(scales.size());
+    std::vector< std::vector<float> > scaleConfidences(scales.size());
+    parallel_for_(Range(0, (int)scales.size()),
+                  WaldBoostScalesInvoker(img, scales, featureRects, thresholds_, alphas_, polarities_,
+                                         cascade_thresholds_, scaleBboxes, scaleConfidences));
+
     bboxes.clear();
     confidences.clear();
-
-    Mat resized_img;
-    int step = 4;
-    float h;
     for (size_t i = 0; i < scales.size(); ++i) {
-        float scale = scales[i];
-        resize(img, resized_img, Size(), scale, scale);
-        eval->setImage(resized_img, 0, 0, feature_indices_);
-        int n_rows = (int)(24 / scale);
-        int n_cols = (int)(24 / scale);
-        for (int r = 0; r + 24 < resized_img.rows; r += step) {
-            for (int c = 0; c + 24 < resized_img.cols; c += step) {
-                eval->setWindow(Point(c, r));
-                if (predict(eval, &h) == +1) {
-                    int row = (int)(r / scale);
-                    int col = (int)(c / scale);
-                    bboxes.push_back(Rect(col, row, n_cols, n_rows));
-                    confidences.push_back(h);
-                }
-            }
-        }
+        bboxes.insert(bboxes.end(), scaleBboxes[i].begin(), scaleBboxes[i].end());
+        confidences.insert(confidences.end(), scaleConfidences[i].begin(), scaleConfidences[i].end());
     }
+}
+
+void WaldBoost::detect(Ptr<CvFeatureEvaluator> eval,
+            const Mat& img, const std::vector<float>& scales,
+            std::vector<Rect>& bboxes, Mat1f& confidences)
+{
+    std::vector<float> h;
+    detectWindows(eval, img, scales, bboxes, h);
+    confidences.release();
+    if (!h.empty())
+        Mat1f(h, true).copyTo(confidences);
+    groupRectangles(bboxes, 3, 0.7);
+}
+
+void WaldBoost::detect(Ptr<CvFeatureEvaluator> eval,
+            const Mat& img, const std::vector<float>& scales,
+            std::vector<Rect>& bboxes, std::vector<double>& confidences)
+{
+    std::vector<float> h;
+    detectWindows(eval, img, scales, bboxes, h);
+    confidences.assign(h.begin(), h.end());
     std::vector<int> levels(bboxes.size(), 0);
     groupRectangles(bboxes, levels, confidences, 3, 0.7);
 }
@@ -80,6 +80,14 @@ public:
     ~WaldBoost();
 
 private:
+    // windows of all the scales that pass the cascade, in the order of
+    // the scales, rows and columns
+    void detectWindows(Ptr<CvFeatureEvaluator> eval,
+                       const Mat& img,
+                       const std::vector<float>& scales,
+                       std::vector<Rect>& bboxes,
+                       std::vector<float>& confidences) const;
+
     int weak_count_;
     std::vector<float> thresholds_;
     std::vector<float> alphas_;
@@ -43,6 +43,7 @@
 #define __OPENCV_BM3D_DENOISING_INVOKER_COMMONS_HPP__
 
 #include "bm3d_denoising_invoker_structs.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 // std::isnan is a part of C++11 and it is not supported in MSVS2010/2012
 #if defined _MSC_VER && _MSC_VER < 1800 /* MSVC 2013 */
@@ -57,6 +58,9 @@ namespace cv
 namespace xphoto
 {
 
+// Width of the column tiles processed by the invokers
+enum { BM3D_TILE_WIDTH = 512 };
+
 // Returns largest power of 2 smaller than the input value
 inline int getLargestPowerOf2SmallerThan(unsigned x)
 {
@@ -158,6 +162,89 @@ inline static int WienerFiltering(BlockMatch<T, DT, CT> *zSrc, BlockMatch<T, DT,
     return wienerCoeffs;
 }
 
+#if CV_SIMD128
+inline v_uint32x4 bm3dLoadExpand(const uchar *ptr)
+{
+    return v_load_expand_q(ptr);
+}
+
+inline v_uint32x4 bm3dLoadExpand(const ushort *ptr)
+{
+    return v_load_expand(ptr);
+}
+
+struct DistAbsVec
+{
+    static inline v_int32x4 f(const v_uint32x4 &a, const v_uint32x4 &b)
+    {
+        return v_reinterpret_as_s32(v_absdiff(a, b));
+    }
+};
+
+struct DistSquaredVec
+{
+    static inline v_int32x4 f(const v_uint32x4 &a, const v_uint32x4 &b)
+    {
+        v_int32x4 d = v_reinterpret_as_s32(v_absdiff(a, b));
+        return d * d;
+    }
+};
+
+template <typename VD, typename T>
+inline int updateDistSumsRow_(
+    T a_up, T a_down, const T *b_up, const T *b_down,
+    int *distSums, int *colDistSums, int *lastColDistSums, int n)
+{
+    const v_uint32x4 va_up = v_setall_u32(a_up);
+    const v_uint32x4 va_down = v_setall_u32(a_down);
+
+    int x = 0;
+    for (; x <= n - 4; x += 4)
+    {
+        v_int32x4 col = v_load(lastColDistSums + x) +
+            VD::f(va_down, bm3dLoadExpand(b_down + x)) - VD::f(va_up, bm3dLoadExpand(b_up + x));
+
+        v_store(distSums + x, v_load(distSums + x) - v_load(colDistSums + x) + col);
+        v_store(colDistSums + x, col);
+        v_store(lastColDistSums + x, col);
+    }
+    return x;
+}
+#endif
+
+// Moves the column sums of a search window row one pixel down and updates the window sums.
+// Returns the number of processed elements, the rest is left to the scalar code.
+template <typename D, typename T>
+inline int updateDistSumsRow(T, T, const T *, const T *, int *, int *, int *, int)
+{
+    return 0;
+}
+
+#if CV_SIMD128
+template <>
+inline int updateDistSumsRow<DistAbs, uchar>(
+    uchar a_up, uchar a_down, const uchar *b_up, const uchar *b_down,
+    int *distSums, int *colDistSums, int *lastColDistSums, int n)
+{
+    return updateDistSumsRow_<DistAbsVec>(a_up, a_down, b_up, b_down, distSums, colDistSums, lastColDistSums, n);
+}
+
+template <>
+inline int updateDistSumsRow<DistAbs, ushort>(
+    ushort a_up, ushort a_down, const ushort *b_up, const ushort *b_down,
+    int *distSums, int *colDistSums, int *lastColDistSums, int n)
+{
+    return updateDistSumsRow_<DistAbsVec>(a_up, a_down, b_up, b_down, distSums, colDistSums, lastColDistSums, n);
+}
+
+template <>
+inline int updateDistSumsRow<DistSquared, uchar>(
+    uchar a_up, uchar a_down, const uchar *b_up, const uchar *b_down,
+    int *distSums, int *colDistSums, int *lastColDistSums, int n)
+{
+    return updateDistSumsRow_<DistSquaredVec>(a_up, a_down, b_up, b_down, distSums, colDistSums, lastColDistSums, n);
+}
+#endif
 
 }  // namespace xphoto
 }  // namespace cv
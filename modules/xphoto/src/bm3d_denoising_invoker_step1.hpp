@@ -75,6 +75,7 @@ private:
 
     void calcDistSumsForFirstElementInRow(
         int i,
+        int j,
         Array2d<int>& distSums,
         Array3d<int>& colDistSums,
         Array3d<int>& lastColDistSums,
@@ -84,6 +85,7 @@ private:
     void calcDistSumsForAllElementsInFirstRow(
         int i,
         int j,
+        int colFrom,
         int firstColNum,
         Array2d<int>& distSums,
         Array3d<int>& colDistSums,
@@ -177,9 +179,6 @@ inline Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::~Bm3dDenoisingInvokerStep1()
 template <typename T, typename D, typename WT, typename TT, typename TC>
 void Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::operator() (const Range& range) const
 {
-    const int size = (range.size() + 2 * borderSize_) * srcExtended_.cols;
-    std::vector<WT> weightedSum(size, 0.0);
-    std::vector<WT> weights(size, 0.0);
     int row_from = range.start;
     int row_to = range.end - 1;
 
@@ -194,10 +193,6 @@ void Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::operator() (const Range& range
     const int groupSize = groupSize_;
 
     const int step = srcExtended_.cols;
-    const int dstStep = srcExtended_.cols;
-    const int weiStep = srcExtended_.cols;
-    const int dstcstep = dstStep - blockSize;
-    const int weicstep = weiStep - blockSize;
 
     // Buffer to store 3D group
     BlockMatch<TT, int, TT> *bm = new BlockMatch<TT, int, TT>[searchWindowSizeSq];
@@ -213,210 +208,232 @@ void Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::operator() (const Range& range
     // Sums of columns for current pixel (for lazy calc optimization)
     Array3d<int> colDistSums(blockSize, searchWindowSize, searchWindowSize);
 
-    // Last elements of column sum (for each element in a row)
-    Array3d<int> lastColDistSums(src_.cols, searchWindowSize, searchWindowSize);
+    // The columns are processed in tiles, so the buffers below do not grow with the image width.
+    // The patches of a margin around a tile are processed with it, they contribute to its pixels.
+    const int margin = halfSearchWindowSize_ + blockSize;
+    const int maxTileColumns = std::min(src_.cols, BM3D_TILE_WIDTH + 2 * margin + slidingStep_);
+
+    // Last elements of column sum (for each element in a row of the tile)
+    Array3d<int> lastColDistSums(maxTileColumns, searchWindowSize, searchWindowSize);
+
+    // Accumulation buffers of the tile
+    std::vector<WT> weightedSum, weights;
 
-    int firstColNum = -1;
-    for (int j = row_from, jj = 0; j <= row_to; j += slidingStep_, jj += slidingStep_)
+    for (int tileFrom = 0; tileFrom < src_.cols; tileFrom += BM3D_TILE_WIDTH)
     {
-        for (int i = 0; i < src_.cols; i += slidingStep_)
+        const int tileTo = std::min(src_.cols, tileFrom + BM3D_TILE_WIDTH);
+        const int colFrom = std::max(0, tileFrom - margin) / slidingStep_ * slidingStep_;
+        const int colTo = std::min(src_.cols, tileTo + margin);
+
+        const int dstStep = colTo - colFrom + 2 * borderSize_;
+        const int dstcstep = dstStep - blockSize;
+        const int weicstep = dstStep - blockSize;
+        weightedSum.assign((range.size() + 2 * borderSize_) * dstStep, 0.0f);
+        weights.assign((range.size() + 2 * borderSize_) * dstStep, 0.0f);
+
+        int firstColNum = -1;
+        for (int j = row_from, jj = 0; j <= row_to; j += slidingStep_, jj += slidingStep_)
         {
-            const T *currentPixel = srcExtended_.ptr<T>(0) + step*j + i;
-            int elementSize = 1;
-
-            // Calculate distSums using moving average filter approach.
-            if (i == 0)
-            {
-                // Calculate distSums for the first element in a row
-                calcDistSumsForFirstElementInRow(j, distSums, colDistSums, lastColDistSums, bm, elementSize);
-                firstColNum = 0;
-            }
-            else
+            for (int i = colFrom; i < colTo; i += slidingStep_)
             {
-                if (j == row_from)
+                const T *currentPixel = srcExtended_.ptr<T>(0) + step*j + i;
+                int elementSize = 1;
+
+                // Calculate distSums using moving average filter approach.
+                if (i == colFrom)
                 {
-                    // Calculate distSums for all elements in the first row
-                    calcDistSumsForAllElementsInFirstRow(
-                        j, i, firstColNum, distSums, colDistSums, lastColDistSums, bm, elementSize);
+                    // Calculate distSums for the first element in a row
+                    calcDistSumsForFirstElementInRow(j, colFrom, distSums, colDistSums, lastColDistSums, bm, elementSize);
+                    firstColNum = 0;
                 }
                 else
                 {
-                    const int start_bx = blockSize + i - 1;
-                    const int start_by = j - 1;
-                    const int ax = halfSearchWindowSize + start_bx;
-                    const int ay = halfSearchWindowSize + start_by;
-
-                    const T a_up = srcExtended_.at<T>(ay, ax);
-                    const T a_down = srcExtended_.at<T>(ay + blockSize, ax);
-
-                    for (TT y = 0; y < searchWindowSize; y++)
+                    if (j == row_from)
+                    {
+                        // Calculate distSums for all elements in the first row
+                        calcDistSumsForAllElementsInFirstRow(
+                            j, i, colFrom, firstColNum, distSums, colDistSums, lastColDistSums, bm, elementSize);
+                    }
+                    else
                     {
-                        int *distSumsRow = distSums.row_ptr(y);
-                        int *colDistSumsRow = colDistSums.row_ptr(firstColNum, y);
-                        int *lastColDistSumsRow = lastColDistSums.row_ptr(i, y);
+                        const int start_bx = blockSize + i - 1;
+                        const int start_by = j - 1;
+                        const int ax = halfSearchWindowSize + start_bx;
+                        const int ay = halfSearchWindowSize + start_by;
 
-                        const T *b_up_ptr = srcExtended_.ptr<T>(start_by + y);
-                        const T *b_down_ptr = srcExtended_.ptr<T>(start_by + y + blockSize);
+                        const T a_up = srcExtended_.at<T>(ay, ax);
+                        const T a_down = srcExtended_.at<T>(ay + blockSize, ax);
 
-                        for (TT x = 0; x < searchWindowSize; x++)
+                        for (TT y = 0; y < searchWindowSize; y++)
                         {
-                            // Remove from current pixel sum column sum with index "firstColNum"
-                            distSumsRow[x] -= colDistSumsRow[x];
-
-                            const int bx = start_bx + x;
-                            colDistSumsRow[x] = lastColDistSumsRow[x] +
-                                D::template calcUpDownDist<T>(a_up, a_down, b_up_ptr[bx], b_down_ptr[bx]);
-
-                            distSumsRow[x] += colDistSumsRow[x];
-                            lastColDistSumsRow[x] = colDistSumsRow[x];
-
-                            if (x == halfSearchWindowSize && y == halfSearchWindowSize)
-                                continue;
-
-                            // Save the distance, coordinate and increase the counter
-                            if (distSumsRow[x] < hBM)
-                                bm[elementSize++](distSumsRow[x], x, y);
+                            int *distSumsRow = distSums.row_ptr(y);
+                            int *colDistSumsRow = colDistSums.row_ptr(firstColNum, y);
+                            int *lastColDistSumsRow = lastColDistSums.row_ptr(i - colFrom, y);
+
+                            const T *b_up_ptr = srcExtended_.ptr<T>(start_by + y) + start_bx;
+                            const T *b_down_ptr = srcExtended_.ptr<T>(start_by + y + blockSize) + start_bx;
+
+                            // Update the new column sums from the ones of the previous row, most of them with SIMD
+                            const int simdCount = updateDistSumsRow<D>(a_up, a_down, b_up_ptr, b_down_ptr,
+                                distSumsRow, colDistSumsRow, lastColDistSumsRow, searchWindowSize);
+                            for (int x = simdCount; x < searchWindowSize; x++)
+                            {
+                                // Remove from current pixel sum column sum with index "firstColNum"
+                                distSumsRow[x] -= colDistSumsRow[x];
+
+                                colDistSumsRow[x] = lastColDistSumsRow[x] +
+                                    D::template calcUpDownDist<T>(a_up, a_down, b_up_ptr[x], b_down_ptr[x]);
+
+                                distSumsRow[x] += colDistSumsRow[x];
+                                lastColDistSumsRow[x] = colDistSumsRow[x];
+                            }
+
+                            for (TT x = 0; x < searchWindowSize; x++)
+                            {
+                                if (x == halfSearchWindowSize && y == halfSearchWindowSize)
+                                    continue;
+
+                                // Save the distance, coordinate and increase the counter
+                                if (distSumsRow[x] < hBM)
+                                    bm[elementSize++](distSumsRow[x], x, y);
+                            }
                         }
                     }
-                }
 
-                firstColNum = (firstColNum + 1) % blockSize;
-            }
+                    firstColNum = (firstColNum + 1) % blockSize;
+                }
 
-            // Sort bm by distance (first element is already sorted)
-            std::sort(bm + 1, bm + elementSize);
+                // Sort bm by distance (first element is already sorted)
+                std::sort(bm + 1, bm + elementSize);
 
-            // Find the nearest power of 2 and cap the group size from the top
-            elementSize = getLargestPowerOf2SmallerThan(elementSize);
-            if (elementSize > groupSize)
-                elementSize = groupSize;
+                // Find the nearest power of 2 and cap the group size from the top
+                elementSize = getLargestPowerOf2SmallerThan(elementSize);
+                if (elementSize > groupSize)
+                    elementSize = groupSize;
 
-            // Transform 2D patches
-            for (int n = 0; n < elementSize; ++n)
-            {
-                const T *candidatePatch = currentPixel + step * bm[n].coord_y + bm[n].coord_x;
-                TC::forwardTransform2D(candidatePatch, bm[n].data(), step, blockSize);
-            }
-
-            // Transform and shrink 1D columns
-            TT sumNonZero = 0;
-            TT *thrMapPtr1D = thrMap_ + (elementSize - 1) * blockSizeSq;
-            switch (elementSize)
-            {
-            case 16:
-                for (int n = 0; n < blockSizeSq; n++)
-                {
-                    TC::forwardTransform16(bm, n);
-                    sumNonZero += HardThreshold<16>(bm, n, thrMapPtr1D);
-                    TC::inverseTransform16(bm, n);
-                }
-                break;
-            case 8:
-                for (int n = 0; n < blockSizeSq; n++)
-                {
-                    TC::forwardTransform8(bm, n);
-                    sumNonZero += HardThreshold<8>(bm, n, thrMapPtr1D);
-                    TC::inverseTransform8(bm, n);
-                }
-                break;
-            case 4:
-                for (int n = 0; n < blockSizeSq; n++)
-                {
-                    TC::forwardTransform4(bm, n);
-                    sumNonZero += HardThreshold<4>(bm, n, thrMapPtr1D);
-                    TC::inverseTransform4(bm, n);
-                }
-                break;
-            case 2:
-                for (int n = 0; n < blockSizeSq; n++)
+                // Transform 2D patches
+                for (int n = 0; n < elementSize; ++n)
                 {
-                    TC::forwardTransform2(bm, n);
-                    TC::forwardTransform2(bm, n);
-                    sumNonZero += HardThreshold<2>(bm, n, thrMapPtr1D);
-                    TC::inverseTransform2(bm, n);
+                    const T *candidatePatch = currentPixel + step * bm[n].coord_y + bm[n].coord_x;
+                    TC::forwardTransform2D(candidatePatch, bm[n].data(), step, blockSize);
                 }
-                break;
-            case 1:
+
+                // Transform and shrink 1D columns
+                TT sumNonZero = 0;
+                TT *thrMapPtr1D = thrMap_ + (elementSize - 1) * blockSizeSq;
+                switch (elementSize)
                 {
-                    TT *block = bm[0].data();
+                case 16:
+                    TC::template forwardTransformGroup<16>(bm, blockSizeSq);
                     for (int n = 0; n < blockSizeSq; n++)
-                        shrink(block[n], sumNonZero, *thrMapPtr1D++);
-                }
-                break;
-            default:
-                for (int n = 0; n < blockSizeSq; n++)
-                {
-                    TC::forwardTransformN(bm, n, elementSize);
-                    sumNonZero += HardThreshold(bm, n, thrMapPtr1D, elementSize);
-                    TC::inverseTransformN(bm, n, elementSize);
+                        sumNonZero += HardThreshold<16>(bm, n, thrMapPtr1D);
+                    TC::template inverseTransformGroup<16>(bm, blockSizeSq);
+                    break;
+                case 8:
+                    TC::template forwardTransformGroup<8>(bm, blockSizeSq);
+                    for (int n = 0; n < blockSizeSq; n++)
+                        sumNonZero += HardThreshold<8>(bm, n, thrMapPtr1D);
+                    TC::template inverseTransformGroup<8>(bm, blockSizeSq);
+                    break;
+                case 4:
+                    TC::template forwardTransformGroup<4>(bm, blockSizeSq);
+                    for (int n = 0; n < blockSizeSq; n++)
+                        sumNonZero += HardThreshold<4>(bm, n, thrMapPtr1D);
+                    TC::template inverseTransformGroup<4>(bm, blockSizeSq);
+                    break;
+                case 2:
+                    for (int n = 0; n < blockSizeSq; n++)
+                    {
+                        TC::forwardTransform2(bm, n);
+                        TC::forwardTransform2(bm, n);
+                        sumNonZero += HardThreshold<2>(bm, n, thrMapPtr1D);
+                        TC::inverseTransform2(bm, n);
+                    }
+                    break;
+                case 1:
+                    {
+                        TT *block = bm[0].data();
+                        for (int n = 0; n < blockSizeSq; n++)
+                            shrink(block[n], sumNonZero, *thrMapPtr1D++);
+                    }
+                    break;
+                default:
+                    for (int n = 0; n < blockSizeSq; n++)
+                    {
+                        TC::forwardTransformN(bm, n, elementSize);
+                        sumNonZero += HardThreshold(bm, n, thrMapPtr1D, elementSize);
+                        TC::inverseTransformN(bm, n, elementSize);
+                    }
                 }
-            }
-
-            // Inverse 2D transform
-            for (int n = 0; n < elementSize; ++n)
-                TC::inverseTransform2D(bm[n].data(), blockSize);
 
-            // Aggregate the results (increase sumNonZero to avoid division by zero)
-            float weight = 1.0f / (float)(++sumNonZero);
+                // Inverse 2D transform
+                for (int n = 0; n < elementSize; ++n)
+                    TC::inverseTransform2D(bm[n].data(), blockSize);
 
-            // Scale weight by element size
-            weight *= elementSize;
-            weight /= groupSize;
+                // Aggregate the results (increase sumNonZero to avoid division by zero)
+                float weight = 1.0f / (float)(++sumNonZero);
 
-            // Put patches back to their original positions
-            WT *dstPtr = weightedSum.data() + jj * dstStep + i;
-            WT *weiPtr = weights.data() + jj * dstStep + i;
-            const float *kaiser = kaiser_;
+                // Scale weight by element size
+                weight *= elementSize;
+                weight /= groupSize;
 
-            for (int l = 0; l < elementSize; ++l)
-            {
-                const TT *block = bm[l].data();
-                int offset = bm[l].coord_y * dstStep + bm[l].coord_x;
-                WT *d = dstPtr + offset;
-                WT *dw = weiPtr + offset;
+                // Put patches back to their original positions
+                WT *dstPtr = weightedSum.data() + jj * dstStep + (i - colFrom);
+                WT *weiPtr = weights.data() + jj * dstStep + (i - colFrom);
+                const float *kaiser = kaiser_;
 
-                for (int n = 0; n < blockSize; ++n)
+                for (int l = 0; l < elementSize; ++l)
                 {
-                    for (int m = 0; m < blockSize; ++m)
+                    const TT *block = bm[l].data();
+                    int offset = bm[l].coord_y * dstStep + bm[l].coord_x;
+                    WT *d = dstPtr + offset;
+                    WT *dw = weiPtr + offset;
+
+                    for (int n = 0; n < blockSize; ++n)
                     {
-                        unsigned idx = n * blockSize + m;
-                        *d += kaiser[idx] * block[idx] * weight;
-                        *dw += kaiser[idx] * weight;
-                        ++d, ++dw;
+                        for (int m = 0; m < blockSize; ++m)
+                        {
+                            unsigned idx = n * blockSize + m;
+                            *d += kaiser[idx] * block[idx] * weight;
+                            *dw += kaiser[idx] * weight;
+                            ++d, ++dw;
+                        }
+                        d += dstcstep;
+                        dw += weicstep;
                     }
-                    d += dstcstep;
-                    dw += weicstep;
                 }
-            }
-        } // i
-    } // j
+            } // i
+        } // j
+
+        // Divide accumulation buffer by the corresponding weights
+        for (int i = row_from, ii = 0; i <= row_to; ++i, ++ii)
+        {
+            T *d = dst_.ptr<T>(i);
+            const int offset = (ii + halfSearchWindowSize + halfBlockSize) * dstStep + halfSearchWindowSize + halfBlockSize - colFrom;
+            const float *dE = weightedSum.data() + offset;
+            const float *dw = weights.data() + offset;
+            for (int j = tileFrom; j < tileTo; ++j)
+                d[j] = cv::saturate_cast<T>(dE[j] / dw[j]);
+        }
+    } // tiles
 
     // Cleanup
     for (int i = 0; i < searchWindowSizeSq; ++i)
         bm[i].release();
     delete[] bm;
 
-    // Divide accumulation buffer by the corresponding weights
-    for (int i = row_from, ii = 0; i <= row_to; ++i, ++ii)
-    {
-        T *d = dst_.ptr<T>(i);
-        float *dE = weightedSum.data() + (ii + halfSearchWindowSize + halfBlockSize) * dstStep + halfSearchWindowSize;
-        float *dw = weights.data() + (ii + halfSearchWindowSize + halfBlockSize) * dstStep + halfSearchWindowSize;
-        for (int j = 0; j < dst_.cols; ++j)
-            d[j] = cv::saturate_cast<T>(dE[j + halfBlockSize] / dw[j + halfBlockSize]);
-    }
 }
 
 template <typename T, typename D, typename WT, typename TT, typename TC>
 inline void Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::calcDistSumsForFirstElementInRow(
     int i,
+    int j,
     Array2d<int>& distSums,
     Array3d<int>& colDistSums,
     Array3d<int>& lastColDistSums,
     BlockMatch<TT, int, TT> *bm,
     int &elementSize) const
 {
-    int j = 0;
     const int hBM = hBM_;
     const int blockSize = templateWindowSize_;
     const int searchWindowSize = searchWindowSize_;
@@ -450,7 +467,7 @@ inline void Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::calcDistSumsForFirstEle
                     colDistSums[tx][y][x] += dist;
                 }
 
-            lastColDistSums[j][y][x] = colDistSums[blockSize - 1][y][x];
+            lastColDistSums[0][y][x] = colDistSums[blockSize - 1][y][x];
 
             if (x == halfSearchWindowSize && y == halfSearchWindowSize)
                 continue;
@@ -465,6 +482,7 @@ template <typename T, typename D, typename WT, typename TT, typename TC>
 inline void Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::calcDistSumsForAllElementsInFirstRow(
     int i,
     int j,
+    int colFrom,
     int firstColNum,
     Array2d<int>& distSums,
     Array3d<int>& colDistSums,
@@ -500,7 +518,7 @@ inline void Bm3dDenoisingInvokerStep1<T, D, WT, TT, TC>::calcDistSumsForAllEleme
                     bx);
 
             distSums[y][x] += colDistSums[firstColNum][y][x];
-            lastColDistSums[j][y][x] = colDistSums[firstColNum][y][x];
+            lastColDistSums[j - colFrom][y][x] = colDistSums[firstColNum][y][x];
 
             if (x == halfSearchWindowSize && y == halfSearchWindowSize)
                 continue;
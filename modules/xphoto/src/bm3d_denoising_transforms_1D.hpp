@@ -42,6 +42,8 @@
 #ifndef __OPENCV_BM3D_DENOISING_TRANSFORMS_1D_HPP__
 #define __OPENCV_BM3D_DENOISING_TRANSFORMS_1D_HPP__
 
+#include "opencv2/core/hal/intrin.hpp"
+
 namespace cv
 {
 namespace xphoto
@@ -62,6 +64,84 @@ class HaarTransform1D
         }
     }
 
+    template <int N, typename T, typename DT, typename CT>
+    inline static int ForwardTransformGroupSIMD(BlockMatch<T, DT, CT> *, const int &)
+    {
+        return 0;
+    }
+
+    template <int N, typename T, typename DT, typename CT>
+    inline static int InverseTransformGroupSIMD(BlockMatch<T, DT, CT> *, const int &)
+    {
+        return 0;
+    }
+
+#if CV_SIMD128
+    // Same computations as in ForwardTransform4/8/16, for 8 coefficients at once
+    template <int N>
+    inline static int ForwardTransformGroupSIMD(BlockMatch<short, int, short> *z, const int &blockSizeSq)
+    {
+        const v_int16x8 one = v_setall_s16(1);
+
+        int n = 0;
+        for (; n <= blockSizeSq - 8; n += 8)
+        {
+            v_int16x8 cur[N], out[N];
+            for (int i = 0; i < N; ++i)
+                cur[i] = v_load(z[i].data() + n);
+
+            for (int m = N; m > 1; m >>= 1)
+            {
+                for (int j = 0; j < (m >> 1); ++j)
+                {
+                    const v_int16x8 a = cur[2 * j];
+                    const v_int16x8 b = cur[2 * j + 1];
+                    out[(m >> 1) + j] = a - b;
+                    cur[j] = v_shr<1>(a + b + one);
+                }
+            }
+            out[0] = cur[0];
+
+            // ForwardTransform16 takes the difference of the differences of the previous level
+            if (N == 16)
+                out[1] = out[2] - out[3];
+
+            for (int i = 0; i < N; ++i)
+                v_store(z[i].data() + n, out[i]);
+        }
+        return n;
+    }
+
+    // Same computations as in InverseTransform4/8/16, for 8 coefficients at once
+    template <int N>
+    inline static int InverseTransformGroupSIMD(BlockMatch<short, int, short> *z, const int &blockSizeSq)
+    {
+        int n = 0;
+        for (; n <= blockSizeSq - 8; n += 8)
+        {
+            v_int16x8 src[N], cur[N], next[N];
+            for (int i = 0; i < N; ++i)
+                src[i] = v_load(z[i].data() + n);
+
+            cur[0] = src[0] + src[0];
+            for (int m = 2; m <= N; m <<= 1)
+            {
+                for (int k = 0; k < (m >> 1); ++k)
+                {
+                    next[2 * k] = cur[k] + src[(m >> 1) + k];
+                    next[2 * k + 1] = cur[k] - src[(m >> 1) + k];
+                }
+                for (int k = 0; k < m; ++k)
+                    cur[k] = next[k];
+            }
+
+            for (int i = 0; i < N; ++i)
+                v_store(z[i].data() + n, v_shr<1>(cur[i]));
+        }
+        return n;
+    }
+#endif
+
 public:
     /// 1D forward transformations of array of arbitrary size
     template <typename T, typename DT, typename CT>
@@ -141,6 +221,36 @@ public:
         delete[] dstX;
     }
 
+    /// 1D forward transformation of fixed array size 4, 8 or 16 of all the coefficients of a group
+    template <int N, typename T, typename DT, typename CT>
+    inline static void ForwardTransformGroup(BlockMatch<T, DT, CT> *z, const int &blockSizeSq)
+    {
+        for (int n = ForwardTransformGroupSIMD<N>(z, blockSizeSq); n < blockSizeSq; ++n)
+        {
+            if (N == 16)
+                ForwardTransform16(z, n);
+            else if (N == 8)
+                ForwardTransform8(z, n);
+            else
+                ForwardTransform4(z, n);
+        }
+    }
+
+    /// 1D inverse transformation of fixed array size 4, 8 or 16 of all the coefficients of a group
+    template <int N, typename T, typename DT, typename CT>
+    inline static void InverseTransformGroup(BlockMatch<T, DT, CT> *z, const int &blockSizeSq)
+    {
+        for (int n = InverseTransformGroupSIMD<N>(z, blockSizeSq); n < blockSizeSq; ++n)
+        {
+            if (N == 16)
+                InverseTransform16(z, n);
+            else if (N == 8)
+                InverseTransform8(z, n);
+            else
+                InverseTransform4(z, n);
+        }
+    }
+
     /// 1D forward transformations of fixed array size: 2, 4, 8 and 16
 
     template <typename T, typename DT, typename CT>
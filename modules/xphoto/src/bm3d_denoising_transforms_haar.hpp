@@ -237,6 +237,19 @@ public:
         }
     }
 
+    // 1D transforms of fixed size 4, 8 or 16 of all the coefficients of a group
+    template <int N>
+    static void forwardTransformGroup(BlockMatch<TT, int, TT> *z, const int &blockSizeSq)
+    {
+        HaarTransform1D::ForwardTransformGroup<N>(z, blockSizeSq);
+    }
+
+    template <int N>
+    static void inverseTransformGroup(BlockMatch<TT, int, TT> *z, const int &blockSizeSq)
+    {
+        HaarTransform1D::InverseTransformGroup<N>(z, blockSizeSq);
+    }
+
     // 2D transform pointers
     static typename Transform<T, TT>::Forward2D forwardTransform2D;
     static typename Transform<T, TT>::Inverse2D inverseTransform2D;
@@ -48,6 +48,7 @@
 
 #include "opencv2/core.hpp"
 #include "opencv2/core/core_c.h"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include "opencv2/core/types.hpp"
 #include "opencv2/core/types_c.h"
@@ -62,73 +63,170 @@ namespace xphoto
     void dctDenoising(const Mat &, Mat &, const double, const int);
 
 
+    /* Orthonormal DCT-II matrix, C * X * C^T is the same transform as dct(X) */
+    static Mat getDctMatrix(const int psize)
+    {
+        Mat C(psize, psize, CV_32FC1);
+        for (int k = 0; k < psize; ++k)
+        {
+            const double scale = std::sqrt((k == 0 ? 1.0 : 2.0) / psize);
+            for (int m = 0; m < psize; ++m)
+                C.at<float>(k, m) = float( scale * std::cos(CV_PI * (2*m + 1) * k / (2.0 * psize)) );
+        }
+        return C;
+    }
+
+    /* dst.row(r) (+)= src.row(r) * M for psize x psize blocks */
+    static inline void mulBlock(const float *src, const size_t srcStep, const float *M,
+                                float *dst, const size_t dstStep, const int psize, const bool accumulate)
+    {
+        for (int r = 0; r < psize; ++r, src += srcStep, dst += dstStep)
+        {
+            int k = 0;
+#if CV_SIMD128
+            for (; k <= psize - 4; k += 4)
+            {
+                v_float32x4 sum = accumulate ? v_load(dst + k) : v_setzero_f32();
+                for (int j = 0; j < psize; ++j)
+                    sum += v_setall_f32(src[j]) * v_load(M + j*psize + k);
+                v_store(dst + k, sum);
+            }
+#endif
+            for (; k < psize; ++k)
+            {
+                float sum = accumulate ? dst[k] : 0.0f;
+                for (int j = 0; j < psize; ++j)
+                    sum += src[j] * M[j*psize + k];
+                dst[k] = sum;
+            }
+        }
+    }
+
+    /* Denoises the patches of a stripe of patch rows and sums them up.
+     * The vertical transforms are shared by all the patches of a row: the columns of the rows under
+     * the patches are transformed once, and the horizontally inverse transformed patches are summed
+     * up before a single vertical inverse transform. Each stripe writes its own rows of the result,
+     * the rows it shares with the next stripe are kept aside in tails.
+     */
     struct grayDctDenoisingInvoker : public ParallelLoopBody
     {
     public:
-        grayDctDenoisingInvoker(const Mat &src, std::vector <Mat> &patches, const double sigma, const int psize);
+        grayDctDenoisingInvoker(const Mat &src, Mat &res, std::vector <Mat> &tails,
+                                const double sigma, const int psize, const int stripeRows);
         ~grayDctDenoisingInvoker(){};
 
         void operator() (const Range &range) const;
 
     protected:
         const Mat &src;
-        std::vector <Mat> &patches; // image decomposition into sliding patches
+        Mat &res; // sums of the denoised patches
+        std::vector <Mat> &tails; // sums of the rows below each stripe
 
         const int psize; // size of block to compute dct
         const double sigma; // expected noise standard deviation
         const double thresh; // thresholding estimate
+        const int stripeRows; // number of patch rows in a stripe
+
+        Mat C, Ct; // dct matrix and its transpose
 
         void operator =(const grayDctDenoisingInvoker&) const {};
     };
 
-    grayDctDenoisingInvoker::grayDctDenoisingInvoker(const Mat &_src, std::vector <Mat> &_patches,
-                                                     const double _sigma, const int _psize)
-        : src(_src), patches(_patches), psize(_psize), sigma(_sigma), thresh(3*_sigma) {}
+    grayDctDenoisingInvoker::grayDctDenoisingInvoker(const Mat &_src, Mat &_res, std::vector <Mat> &_tails,
+                                                     const double _sigma, const int _psize, const int _stripeRows)
+        : src(_src), res(_res), tails(_tails), psize(_psize), sigma(_sigma), thresh(3*_sigma), stripeRows(_stripeRows)
+    {
+        C = getDctMatrix(psize);
+        Ct = C.t();
+    }
 
     void grayDctDenoisingInvoker::operator() (const Range &range) const
     {
-        for (int i = range.start; i <= range.end - 1; ++i)
-        {
-            int y = i / (src.cols - psize);
-            int x = i % (src.cols - psize);
+        const int patchRows = src.rows - psize;
+        const int patchCols = src.cols - psize;
+        const float fthresh = (float)thresh;
 
-            Rect patchNum( x, y, psize, psize );
+        Mat columns, rowSums, rows;
+        Mat coeffs(psize, psize, CV_32FC1);
 
-            Mat patch(psize, psize, CV_32FC1);
-            src(patchNum).copyTo( patch );
-
-            dct(patch, patch);
-            float *data = (float *) patch.data;
-            for (int k = 0; k < psize*psize; ++k)
-                data[k] *= fabs(data[k]) > thresh;
-            idct(patch, patches[i]);
+        for (int stripe = range.start; stripe < range.end; ++stripe)
+        {
+            const int y0 = stripe*stripeRows;
+            const int y1 = std::min(y0 + stripeRows, patchRows);
+
+            Mat acc(y1 - y0 + psize - 1, src.cols, CV_32FC1, Scalar::all(0));
+            for (int y = y0; y < y1; ++y)
+            {
+                // vertical dct of all the columns under the patches of the row
+                gemm(C, src.rowRange(y, y + psize), 1.0, noArray(), 0.0, columns);
+                rowSums.create(psize, src.cols, CV_32FC1);
+                rowSums.setTo(Scalar::all(0));
+
+                const size_t step = columns.step1();
+                for (int x = 0; x < patchCols; ++x)
+                {
+                    float *data = coeffs.ptr<float>();
+
+                    // horizontal dct, then thresholding and horizontal inverse dct
+                    mulBlock(columns.ptr<float>() + x, step, Ct.ptr<float>(), data, psize, psize, false);
+                    for (int k = 0; k < psize*psize; ++k)
+                        data[k] *= fabs(data[k]) > fthresh;
+                    mulBlock(data, psize, C.ptr<float>(), rowSums.ptr<float>() + x, rowSums.step1(), psize, true);
+                }
+
+                // vertical inverse dct of the sum of the patches
+                gemm(C, rowSums, 1.0, noArray(), 0.0, rows, GEMM_1_T);
+                Mat dst = acc.rowRange(y - y0, y - y0 + psize);
+                dst += rows;
+            }
+
+            acc.rowRange(0, y1 - y0).copyTo( res.rowRange(y0, y1) );
+            tails[stripe] = acc.rowRange(y1 - y0, acc.rows).clone();
         }
     }
 
+    /* Number of patches at positions [0, npatches) covering each position of a line */
+    static std::vector <float> getPatchCounts(const int length, const int npatches, const int psize)
+    {
+        std::vector <float> counts(length, 0.0f);
+        for (int i = 0; i < length; ++i)
+            counts[i] = (float)std::max( std::min(i, npatches - 1) - std::max(0, i - psize + 1) + 1, 0 );
+        return counts;
+    }
+
     void grayDctDenoising(const Mat &src, Mat &dst, const double sigma, const int psize)
     {
         CV_Assert( src.type() == CV_MAKE_TYPE(CV_32F, 1) );
 
-        int npixels = (src.rows - psize)*(src.cols - psize);
-
-        std::vector <Mat> patches;
-        for (int i = 0; i < npixels; ++i)
-            patches.push_back( Mat(psize, psize, CV_32FC1) );
-        parallel_for_( cv::Range(0, npixels),
-            grayDctDenoisingInvoker(src, patches, sigma, psize) );
+        const int patchRows = src.rows - psize;
+        const int patchCols = src.cols - psize;
 
-        Mat res( src.size(), CV_32FC1, 0.0f ),
-            num( src.size(), CV_32FC1, 0.0f );
-
-        for (int k = 0; k < npixels; ++k)
+        Mat res( src.size(), CV_32FC1, 0.0f );
+        if (patchRows > 0 && patchCols > 0)
         {
-            int i = k / (src.cols - psize);
-            int j = k % (src.cols - psize);
+            const int stripeRows = 2*psize;
+            const int nstripes = (patchRows + stripeRows - 1) / stripeRows;
+
+            std::vector <Mat> tails(nstripes);
+            parallel_for_( cv::Range(0, nstripes),
+                grayDctDenoisingInvoker(src, res, tails, sigma, psize, stripeRows) );
+
+            for (int i = 0; i < nstripes; ++i)
+            {
+                const int y1 = std::min((i + 1)*stripeRows, patchRows);
+                res.rowRange(y1, y1 + tails[i].rows) += tails[i];
+            }
+        }
 
-            res( Rect(j, i, psize, psize) ) += patches[k];
-            num( Rect(j, i, psize, psize) ) += Mat::ones(psize, psize, CV_32FC1);
+        // every pixel is divided by the number of the patches covering it
+        const std::vector <float> rowCounts = getPatchCounts(src.rows, patchRows, psize);
+        const std::vector <float> colCounts = getPatchCounts(src.cols, patchCols, psize);
+        for (int i = 0; i < res.rows; ++i)
+        {
+            float *data = res.ptr<float>(i);
+            for (int j = 0; j < res.cols; ++j)
+                data[j] /= rowCounts[i]*colCounts[j];
         }
-        res /= num;
 
         res.convertTo( dst, src.type() );
     }
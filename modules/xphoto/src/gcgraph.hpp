@@ -97,6 +97,9 @@ GCGraph<TWeight>::~GCGraph()
 template <class TWeight>
 void GCGraph<TWeight>::create( unsigned int vtxCount, unsigned int edgeCount )
 {
+    // the storage of a previous graph is reused
+    vtcs.clear();
+    edges.clear();
     vtcs.reserve( vtxCount );
     edges.reserve( edgeCount + 2 );
     flow = 0;
@@ -66,6 +66,23 @@ struct hist_elem
 bool operator<(const hist_elem &a, const hist_elem &b);
 bool operator<(const hist_elem &a, const hist_elem &b) { return a.hist_val > b.hist_val; }
 
+/* Adds the non-masked pixels to the (B,G,R) histogram. bin_lut maps the values to their bins
+ * (-1 for the values out of the histogram range).
+ */
+template <typename T>
+static inline void accumulateHistogram(float *hist, const int *bin_lut, int hist_bin_num, const T *src_ptr,
+                                       const uchar *mask_ptr, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        if (!mask_ptr[i])
+            continue;
+        int b = bin_lut[src_ptr[3 * i]], g = bin_lut[src_ptr[3 * i + 1]], r = bin_lut[src_ptr[3 * i + 2]];
+        if ((b | g | r) >= 0)
+            hist[(b * hist_bin_num + g) * hist_bin_num + r] += 1.0f;
+    }
+}
+
 class LearningBasedWBImpl : public LearningBasedWB
 {
   private:
@@ -77,14 +94,18 @@ class LearningBasedWBImpl : public LearningBasedWB
     Mat feature_idx_Mat, thresh_vals_Mat, leaf_vals_Mat;
     Mat mask;
     int src_max_val;
+    vector<int> bin_lut;
+    vector<float> hist;
+    vector<float> palette_r, palette_g;
 
     void preprocessing(Mat &src);
     void getAverageAndBrightestColorChromaticity(Vec2f &average_chromaticity, Vec2f &brightest_chromaticity, Mat &src);
-    void getColorPaletteMode(Vec2f &dst, hist_elem *palette);
-    void getHistogramBasedFeatures(Vec2f &dominant_chromaticity, Vec2f &chromaticity_palette_mode, Mat &src);
+    void getColorPaletteMode(Vec2f &dst, const vector<hist_elem> &palette);
+    void getHistogramBasedFeatures(Vec2f &dominant_chromaticity, Vec2f &chromaticity_palette_mode);
 
-    float regressionTreePredict(Vec2f src, uchar *tree_feature_idx, float *tree_thresh_vals, float *tree_leaf_vals);
-    Vec2f predictIlluminant(vector<Vec2f> features);
+    Vec2f regressionTreePredict(const Vec2f &src, const uchar *tree_feature_idx, const float *tree_thresh_vals,
+                                const float *tree_leaf_vals);
+    Vec2f predictIlluminant(const vector<Vec2f> &features);
 
   public:
     LearningBasedWBImpl(String path_to_model)
@@ -117,6 +138,7 @@ class LearningBasedWBImpl : public LearningBasedWB
             thresh_vals = thresh_vals_Mat.ptr<float>();
             leaf_vals = leaf_vals_Mat.ptr<float>();
         }
+        tree_depth = cvRound( (log(static_cast<float>(num_tree_nodes)) / log(2.0f)) );
     }
 
     int getRangeMaxVal() const { return range_max_val; }
@@ -138,7 +160,7 @@ class LearningBasedWBImpl : public LearningBasedWB
 
         preprocessing(src);
         getAverageAndBrightestColorChromaticity(dst[0], dst[1], src);
-        getHistogramBasedFeatures(dst[2], dst[3], src);
+        getHistogramBasedFeatures(dst[2], dst[3]);
         Mat(dst).convertTo(_dst, CV_32F);
     }
 
@@ -240,6 +262,16 @@ void LearningBasedWBImpl::preprocessing(Mat &src)
                 mask_ptr[i] = 0;
         }
     }
+
+    // Histogram bins of the values, the same as calcHist computes for the range [0, max(hist_bin_num, src_max_val))
+    double bin_scale = hist_bin_num / (double)max(hist_bin_num, src_max_val);
+    bin_lut.resize(max(src_max_val, 0) + 1);
+    for (int v = 0; v < (int)bin_lut.size(); v++)
+    {
+        int idx = cvFloor(v * bin_scale);
+        bin_lut[v] = idx < hist_bin_num ? idx : -1;
+    }
+    hist.assign(hist_bin_num * hist_bin_num * hist_bin_num, 0.0f);
 }
 
 void LearningBasedWBImpl::getAverageAndBrightestColorChromaticity(Vec2f &average_chromaticity,
@@ -298,6 +330,9 @@ void LearningBasedWBImpl::getAverageAndBrightestColorChromaticity(Vec2f &average
             v_SG += v_uint1 + v_uint2;
             v_expand(v_sR1, v_uint1, v_uint2);
             v_SR += v_uint1 + v_uint2;
+
+            // the pixels are still in the cache
+            accumulateHistogram(&hist[0], &bin_lut[0], hist_bin_num, src_ptr + 3 * i, mask_ptr + i, 16);
         }
         sumB = v_reduce_sum(v_SB);
         sumG = v_reduce_sum(v_SG);
@@ -318,6 +353,7 @@ void LearningBasedWBImpl::getAverageAndBrightestColorChromaticity(Vec2f &average
             }
         }
 #endif
+        accumulateHistogram(&hist[0], &bin_lut[0], hist_bin_num, src_ptr + 3 * i, mask_ptr + i, src_len - i);
         for (; i < src_len; i++)
         {
             uint sum_val = src_ptr[3 * i] + src_ptr[3 * i + 1] + src_ptr[3 * i + 2];
@@ -388,6 +424,9 @@ void LearningBasedWBImpl::getAverageAndBrightestColorChromaticity(Vec2f &average
             v_SG += v_uint64_1 + v_uint64_2;
             v_expand(v_iR1, v_uint64_1, v_uint64_2);
             v_SR += v_uint64_1 + v_uint64_2;
+
+            // the pixels are still in the cache
+            accumulateHistogram(&hist[0], &bin_lut[0], hist_bin_num, src_ptr + 3 * i, mask_ptr + i, 8);
         }
         uint64 sum_arr[2];
         v_store(sum_arr, v_SB);
@@ -412,6 +451,7 @@ void LearningBasedWBImpl::getAverageAndBrightestColorChromaticity(Vec2f &average
             }
         }
 #endif
+        accumulateHistogram(&hist[0], &bin_lut[0], hist_bin_num, src_ptr + 3 * i, mask_ptr + i, src_len - i);
         for (; i < src_len; i++)
         {
             uint sum_val = src_ptr[3 * i] + src_ptr[3 * i + 1] + src_ptr[3 * i + 2];
@@ -439,73 +479,81 @@ void LearningBasedWBImpl::getAverageAndBrightestColorChromaticity(Vec2f &average
  * Uses a simplistic kernel density estimator with a Epanechnikov kernel and
  * fixed bandwidth.
  */
-void LearningBasedWBImpl::getColorPaletteMode(Vec2f &dst, hist_elem *palette)
+void LearningBasedWBImpl::getColorPaletteMode(Vec2f &dst, const vector<hist_elem> &palette)
 {
+    const int size = (int)palette.size();
+    palette_r.resize(size);
+    palette_g.resize(size);
+    for (int i = 0; i < size; i++)
+    {
+        palette_r[i] = palette[i].r;
+        palette_g[i] = palette[i].g;
+    }
+
+    dst = Vec2f(0.0f, 0.0f);
     float max_density = -1.0f;
     float denom = palette_bandwidth * palette_bandwidth;
-    for (int i = 0; i < palette_size; i++)
+    for (int i = 0; i < size; i++)
     {
         float cur_density = 0.0f;
         float cur_dist_sq;
-
-        for (int j = 0; j < palette_size; j++)
+        int j = 0;
+#if CV_SIMD128
+        v_float32x4 v_r = v_setall_f32(palette_r[i]), v_g = v_setall_f32(palette_g[i]);
+        v_float32x4 v_denom = v_setall_f32(denom), v_one = v_setall_f32(1.0f), v_zero = v_setzero_f32();
+        v_float32x4 v_density = v_setzero_f32();
+        for (; j < size - 3; j += 4)
         {
-            cur_dist_sq = (palette[i].r - palette[j].r) * (palette[i].r - palette[j].r) +
-                          (palette[i].g - palette[j].g) * (palette[i].g - palette[j].g);
+            v_float32x4 v_dr = v_r - v_load(&palette_r[j]);
+            v_float32x4 v_dg = v_g - v_load(&palette_g[j]);
+            v_density += v_max(v_one - (v_dr * v_dr + v_dg * v_dg) / v_denom, v_zero);
+        }
+        cur_density = v_reduce_sum(v_density);
+#endif
+        for (; j < size; j++)
+        {
+            cur_dist_sq = (palette_r[i] - palette_r[j]) * (palette_r[i] - palette_r[j]) +
+                          (palette_g[i] - palette_g[j]) * (palette_g[i] - palette_g[j]);
             cur_density += max((1.0f - (cur_dist_sq / denom)), 0.0f);
         }
 
         if (cur_density > max_density)
         {
             max_density = cur_density;
-            dst[0] = palette[i].r;
-            dst[1] = palette[i].g;
+            dst[0] = palette_r[i];
+            dst[1] = palette_g[i];
         }
     }
 }
 
-void LearningBasedWBImpl::getHistogramBasedFeatures(Vec2f &dominant_chromaticity, Vec2f &chromaticity_palette_mode,
-                                                    Mat &src)
+/* The histogram is accumulated in getAverageAndBrightestColorChromaticity, a single scan over it
+ * finds the dominant color and the palette of the most common colors.
+ */
+void LearningBasedWBImpl::getHistogramBasedFeatures(Vec2f &dominant_chromaticity, Vec2f &chromaticity_palette_mode)
 {
-    MatND hist;
-    int channels[] = {0, 1, 2};
-    int histSize[] = {hist_bin_num, hist_bin_num, hist_bin_num};
-    float range[] = {0, (float)max(hist_bin_num, src_max_val)};
-    const float *ranges[] = {range, range, range};
-    calcHist(&src, 1, channels, mask, hist, 3, histSize, ranges);
-
     int dominant_B = 0, dominant_G = 0, dominant_R = 0;
     double max_hist_val = 0;
-    float *hist_ptr = hist.ptr<float>();
-    for (int i = 0; i < hist_bin_num; i++)
-        for (int j = 0; j < hist_bin_num; j++)
-            for (int k = 0; k < hist_bin_num; k++)
-            {
-                if (*hist_ptr > max_hist_val)
-                {
-                    max_hist_val = *hist_ptr;
-                    dominant_B = i;
-                    dominant_G = j;
-                    dominant_R = k;
-                }
-                hist_ptr++;
-            }
-    getChromaticity(dominant_chromaticity, (float)dominant_R, (float)dominant_G, (float)dominant_B);
+    const float *hist_ptr = &hist[0];
 
     vector<hist_elem> palette;
     palette.reserve(palette_size);
-    hist_ptr = hist.ptr<float>();
     // extract top palette_size most common colors and add them to the palette:
     for (int i = 0; i < hist_bin_num; i++)
         for (int j = 0; j < hist_bin_num; j++)
             for (int k = 0; k < hist_bin_num; k++)
             {
-                float bin_count = *hist_ptr;
+                float bin_count = *hist_ptr++;
                 if (bin_count < EPS)
-                {
-                    hist_ptr++;
                     continue;
+
+                if (bin_count > max_hist_val)
+                {
+                    max_hist_val = bin_count;
+                    dominant_B = i;
+                    dominant_G = j;
+                    dominant_R = k;
                 }
+
                 Vec2f chromaticity;
                 getChromaticity(chromaticity, (float)k, (float)j, (float)i);
                 hist_elem el(bin_count, chromaticity);
@@ -522,50 +570,54 @@ void LearningBasedWBImpl::getHistogramBasedFeatures(Vec2f &dominant_chromaticity
                     palette.back() = el;
                     push_heap(palette.begin(), palette.end());
                 }
-                hist_ptr++;
             }
-    getColorPaletteMode(chromaticity_palette_mode, (hist_elem *)(&palette[0]));
+    getChromaticity(dominant_chromaticity, (float)dominant_R, (float)dominant_G, (float)dominant_B);
+    getColorPaletteMode(chromaticity_palette_mode, palette);
 }
 
-float LearningBasedWBImpl::regressionTreePredict(Vec2f src, uchar *tree_feature_idx, float *tree_thresh_vals,
-                                                 float *tree_leaf_vals)
+/* Walks the trees of both chromaticity components at once, the g tree
+ * follows the r one in the model arrays.
+ */
+Vec2f LearningBasedWBImpl::regressionTreePredict(const Vec2f &src, const uchar *tree_feature_idx,
+                                                 const float *tree_thresh_vals, const float *tree_leaf_vals)
 {
-    int node_idx = 0;
+    const uchar *g_feature_idx = tree_feature_idx + num_tree_nodes - 1;
+    const float *g_thresh_vals = tree_thresh_vals + num_tree_nodes - 1;
+    const float *g_leaf_vals = tree_leaf_vals + num_tree_nodes;
+
+    int node_r = 0, node_g = 0;
     for (int i = 0; i < tree_depth; i++)
     {
-        if (src[tree_feature_idx[node_idx]] <= tree_thresh_vals[node_idx])
-            node_idx = 2 * node_idx + 1;
-        else
-            node_idx = 2 * node_idx + 2;
+        node_r = 2 * node_r + (src[tree_feature_idx[node_r]] <= tree_thresh_vals[node_r] ? 1 : 2);
+        node_g = 2 * node_g + (src[g_feature_idx[node_g]] <= g_thresh_vals[node_g] ? 1 : 2);
     }
-    return tree_leaf_vals[node_idx - num_tree_nodes + 1];
+    return Vec2f(tree_leaf_vals[node_r - num_tree_nodes + 1], g_leaf_vals[node_g - num_tree_nodes + 1]);
 }
 
-Vec2f LearningBasedWBImpl::predictIlluminant(vector<Vec2f> features)
+Vec2f LearningBasedWBImpl::predictIlluminant(const vector<Vec2f> &features)
 {
     int feature_model_size = 2 * (num_tree_nodes - 1);
     int local_model_size = num_features * feature_model_size;
     int feature_model_size_leaf = 2 * num_tree_nodes;
     int local_model_size_leaf = num_features * feature_model_size_leaf;
-    tree_depth = cvRound( (log(static_cast<float>(num_tree_nodes)) / log(2.0f)) );
 
     vector<float> consensus_r, consensus_g;
     vector<float> all_r, all_g;
+    consensus_r.reserve(num_trees * num_features);
+    consensus_g.reserve(num_trees * num_features);
+    all_r.reserve(num_trees * num_features);
+    all_g.reserve(num_trees * num_features);
     for (int i = 0; i < num_trees; i++)
     {
         Vec2f local_predictions[num_features];
         for (int j = 0; j < num_features; j++)
         {
-            float r = regressionTreePredict(features[j], feature_idx + local_model_size * i + feature_model_size * j,
-                                            thresh_vals + local_model_size * i + feature_model_size * j,
-                                            leaf_vals + local_model_size_leaf * i + feature_model_size_leaf * j);
-            float g = regressionTreePredict(
-              features[j], feature_idx + local_model_size * i + feature_model_size * j + feature_model_size / 2,
-              thresh_vals + local_model_size * i + feature_model_size * j + feature_model_size / 2,
-              leaf_vals + local_model_size_leaf * i + feature_model_size_leaf * j + feature_model_size_leaf / 2);
-            local_predictions[j] = Vec2f(r, g);
-            all_r.push_back(r);
-            all_g.push_back(g);
+            Vec2f rg = regressionTreePredict(features[j], feature_idx + local_model_size * i + feature_model_size * j,
+                                             thresh_vals + local_model_size * i + feature_model_size * j,
+                                             leaf_vals + local_model_size_leaf * i + feature_model_size_leaf * j);
+            local_predictions[j] = rg;
+            all_r.push_back(rg[0]);
+            all_g.push_back(rg[1]);
         }
         int agreement_degree = 0;
         for (int j = 0; j < num_features - 1; j++)
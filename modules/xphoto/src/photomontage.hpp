@@ -88,7 +88,7 @@ private:
 
     std::vector <labelTp> &labelSeq;                   // current best labeling
 
-    TWeight singleExpansion(const int alpha);          // single neighbor computing
+    TWeight singleExpansion(const int alpha, GCGraph <TWeight> &graph); // single neighbor computing
 
     class ParallelExpansion : public cv::ParallelLoopBody
     {
@@ -100,8 +100,10 @@ private:
 
         void operator () (const cv::Range &range) const
         {
+            // the graph arrays are allocated once per range
+            GCGraph <TWeight> graph;
             for (int i = range.start; i <= range.end - 1; ++i)
-                main->distances[i] = main->singleExpansion(i);
+                main->distances[i] = main->singleExpansion(i, graph);
         }
     } parallelExpansion;
 
@@ -161,9 +163,13 @@ setWeights(GCGraph <TWeight> &graph, const int idx1, const int idx2,
 }
 
 template <typename Tp> TWeight Photomontage <Tp>::
-singleExpansion(const int alpha)
+singleExpansion(const int alpha, GCGraph <TWeight> &graph)
 {
-    GCGraph <TWeight> graph( 3*int(pointSeq.size()), 4*int(pointSeq.size()) );
+    /** Every link adds at most one vertex and two pairs of edges **/
+    int nlinks = 0;
+    for (size_t i = 0; i < linkIdx.size(); ++i)
+        nlinks += int(linkIdx[i].size());
+    graph.create( int(pointSeq.size()) + nlinks, 4*nlinks );
 
     /** Terminal links **/
     for (size_t i = 0; i < maskSeq.size(); ++i)
@@ -195,7 +201,8 @@ gradientDescent()
     for (int num = -1; /**/; num = -1)
     {
         int range = int( pointSeq[0].size() );
-        parallel_for_( cv::Range(0, range), parallelExpansion );
+        parallel_for_( cv::Range(0, range), parallelExpansion,
+            std::min(range, std::max(cv::getNumThreads(), 1)) );
 
         int minIndex = min_idx(distances);
         TWeight minValue = distances[minIndex];
@@ -225,6 +232,109 @@ Photomontage( const std::vector <std::vector <Tp> > &_pointSeq,
       std::vector <labelTp>( lsize ) );
 }
 
+/** Splits the points into the groups connected by links, returns the number of groups **/
+static inline int linkedComponents(const std::vector <std::vector <int> > &linkIdx,
+    std::vector <int> &component)
+{
+    const int npoints = int( linkIdx.size() );
+
+    /** Links are one-way, the adjacency is made symmetric **/
+    std::vector <std::vector <int> > adjacency( npoints );
+    for (int i = 0; i < npoints; ++i)
+        for (size_t j = 0; j < linkIdx[i].size(); ++j)
+        {
+            int k = linkIdx[i][j];
+            if (k >= 0 && k < npoints && k != i)
+            {
+                adjacency[i].push_back(k);
+                adjacency[k].push_back(i);
+            }
+        }
+
+    int ncomponents = 0;
+    component.assign( npoints, -1 );
+    std::stack <int> front;
+    for (int i = 0; i < npoints; ++i)
+    {
+        if (component[i] != -1)
+            continue;
+
+        component[i] = ncomponents;
+        front.push(i);
+        while ( !front.empty() )
+        {
+            int v = front.top();
+            front.pop();
+            for (size_t j = 0; j < adjacency[v].size(); ++j)
+                if (component[adjacency[v][j]] == -1)
+                {
+                    component[adjacency[v][j]] = ncomponents;
+                    front.push( adjacency[v][j] );
+                }
+        }
+        ++ncomponents;
+    }
+
+    return ncomponents;
+}
+
+/** The energy is a sum over the linked groups of points, so every group
+    is stitched on its own, with its own sequence of expansions **/
+template <typename Tp> class ParallelComponents : public cv::ParallelLoopBody
+{
+public:
+    ParallelComponents(const std::vector <std::vector <Tp> > &_pointSeq,
+                       const std::vector <std::vector <uchar> > &_maskSeq,
+                       const std::vector <std::vector <int> > &_linkIdx,
+                       const std::vector <std::vector <int> > &_members,
+                       const std::vector <int> &_localIdx,
+                       std::vector <labelTp> &_labelSeq)
+        : pointSeq(_pointSeq), maskSeq(_maskSeq), linkIdx(_linkIdx),
+          members(_members), localIdx(_localIdx), labelSeq(_labelSeq) {}
+
+    void operator () (const cv::Range &range) const
+    {
+        for (int c = range.start; c <= range.end - 1; ++c)
+        {
+            const std::vector <int> &idx = members[c];
+
+            std::vector <std::vector <Tp> > subPointSeq( idx.size() );
+            std::vector <std::vector <uchar> > subMaskSeq( idx.size() );
+            std::vector <std::vector <int> > subLinkIdx( idx.size() );
+            std::vector <labelTp> subLabelSeq( idx.size() );
+
+            for (size_t i = 0; i < idx.size(); ++i)
+            {
+                subPointSeq[i] = pointSeq[idx[i]];
+                subMaskSeq[i] = maskSeq[idx[i]];
+                subLabelSeq[i] = labelSeq[idx[i]];
+
+                for (size_t j = 0; j < linkIdx[idx[i]].size(); ++j)
+                {
+                    int k = linkIdx[idx[i]][j];
+                    bool linked = k >= 0 && k < int(localIdx.size()) && k != idx[i];
+                    subLinkIdx[i].push_back( linked ? localIdx[k] : -1 );
+                }
+            }
+
+            Photomontage <Tp>(subPointSeq, subMaskSeq, subLinkIdx, subLabelSeq).gradientDescent();
+
+            for (size_t i = 0; i < idx.size(); ++i)
+                labelSeq[idx[i]] = subLabelSeq[i];
+        }
+    }
+
+private:
+    const std::vector <std::vector <Tp> > &pointSeq;
+    const std::vector <std::vector <uchar> > &maskSeq;
+    const std::vector <std::vector <int> > &linkIdx;
+    const std::vector <std::vector <int> > &members;
+    const std::vector <int> &localIdx;
+    std::vector <labelTp> &labelSeq;
+
+    void operator =(const ParallelComponents <Tp>&) const {};
+};
+
 }
 
 template <typename Tp> static inline
@@ -233,8 +343,29 @@ void photomontage( const std::vector <std::vector <Tp> > &pointSeq,
                    const std::vector <std::vector <int> > &linkIdx,
                    std::vector <gcoptimization::labelTp> &labelSeq )
 {
-    gcoptimization::Photomontage <Tp>(pointSeq, maskSeq,
-        linkIdx, labelSeq).gradientDescent();
+    if ( pointSeq.empty() )
+        return;
+
+    std::vector <int> component;
+    int ncomponents = gcoptimization::linkedComponents(linkIdx, component);
+
+    if (ncomponents == 1)
+    {
+        gcoptimization::Photomontage <Tp>(pointSeq, maskSeq,
+            linkIdx, labelSeq).gradientDescent();
+        return;
+    }
+
+    std::vector <std::vector <int> > members( ncomponents );
+    std::vector <int> localIdx( component.size() );
+    for (size_t i = 0; i < component.size(); ++i)
+    {
+        localIdx[i] = int( members[component[i]].size() );
+        members[component[i]].push_back( int(i) );
+    }
+
+    parallel_for_( cv::Range(0, ncomponents), gcoptimization::ParallelComponents <Tp>(
+        pointSeq, maskSeq, linkIdx, members, localIdx, labelSeq) );
 }
 
 #endif /* __PHOTOMONTAGE_HPP__ */